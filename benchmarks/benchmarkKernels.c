@@ -0,0 +1,765 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Local headers. */
+#include "runner_doiact_grav.h"
+#include "runner_doiact_vec.h"
+#include "space_getsid.h"
+#include "swift.h"
+
+#define NODE_ID 0
+
+/* Just a forward declaration... */
+void runner_doself1_density(struct runner *r, struct cell *c);
+void runner_dopair1_density(struct runner *r, struct cell *ci, struct cell *cj,
+                            const int sid, const double *shift);
+void runner_doself2_force(struct runner *r, struct cell *c);
+void runner_dopair2_force(struct runner *r, struct cell *ci, struct cell *cj,
+                          const int sid, const double *shift);
+void runner_doself_branch_stars_density(struct runner *r, struct cell *c);
+void runner_dopair_branch_stars_density(struct runner *r, struct cell *ci,
+                                        struct cell *cj);
+
+/* Can we time the explicitly vectorized versions of the hydro loops? */
+#if defined(WITH_VECTORIZATION) && \
+    (defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH))
+#define BENCHMARK_HYDRO_VEC
+#endif
+
+/**
+ * @brief The timing of one kernel over all the runs.
+ */
+struct benchmark {
+
+  /*! Number of calls of the kernel */
+  long long calls;
+
+  /*! Number of particle-particle (or multipole) interactions */
+  long long interactions;
+
+  /*! Number of bytes of particle data read by the kernel */
+  long long bytes;
+
+  /*! Time spent in the kernel */
+  ticks time;
+};
+
+/**
+ * @brief Constructs a cell with particles of all the types on a perturbed
+ * Cartesian grid.
+ *
+ * @param n The cube root of the number of gas and dark matter particles.
+ * @param n_stars The cube root of the number of star particles.
+ * @param offset The position of the cell offset from (0,0,0).
+ * @param size The cell size.
+ * @param h The smoothing length of the particles in units of the inter-particle
+ * separation.
+ * @param partId The running counter of IDs.
+ * @param pert The perturbation to apply to the particles in the cell in units
+ * of the inter-particle separation.
+ */
+struct cell *make_cell(size_t n, size_t n_stars, double *offset, double size,
+                       double h, long long *partId, double pert) {
+
+  const size_t count = n * n * n;
+  const size_t scount = n_stars * n_stars * n_stars;
+  const double volume = size * size * size;
+  float h_max = 0.f, stars_h_max = 0.f;
+  struct cell *cell = (struct cell *)malloc(sizeof(struct cell));
+  bzero(cell, sizeof(struct cell));
+
+  if (posix_memalign((void **)&cell->hydro.parts, part_align,
+                     count * sizeof(struct part)) != 0 ||
+      posix_memalign((void **)&cell->hydro.xparts, xpart_align,
+                     count * sizeof(struct xpart)) != 0 ||
+      posix_memalign((void **)&cell->grav.parts, gpart_align,
+                     count * sizeof(struct gpart)) != 0 ||
+      posix_memalign((void **)&cell->stars.parts, spart_align,
+                     scount * sizeof(struct spart)) != 0)
+    error("couldn't allocate particles, no. of particles: %d", (int)count);
+  bzero(cell->hydro.parts, count * sizeof(struct part));
+  bzero(cell->hydro.xparts, count * sizeof(struct xpart));
+  bzero(cell->grav.parts, count * sizeof(struct gpart));
+  bzero(cell->stars.parts, scount * sizeof(struct spart));
+
+  /* Construct the parts and the gparts at the same positions */
+  struct part *part = cell->hydro.parts;
+  struct gpart *gpart = cell->grav.parts;
+  for (size_t x = 0; x < n; ++x) {
+    for (size_t y = 0; y < n; ++y) {
+      for (size_t z = 0; z < n; ++z) {
+        part->x[0] =
+            offset[0] +
+            size * (x + 0.5 + random_uniform(-0.5, 0.5) * pert) / (float)n;
+        part->x[1] =
+            offset[1] +
+            size * (y + 0.5 + random_uniform(-0.5, 0.5) * pert) / (float)n;
+        part->x[2] =
+            offset[2] +
+            size * (z + 0.5 + random_uniform(-0.5, 0.5) * pert) / (float)n;
+        part->v[0] = random_uniform(-0.05, 0.05);
+        part->v[1] = random_uniform(-0.05, 0.05);
+        part->v[2] = random_uniform(-0.05, 0.05);
+        part->h = size * h / (float)n;
+        h_max = fmaxf(h_max, part->h);
+        part->id = ++(*partId);
+
+#if defined(GIZMO_MFV_SPH) || defined(SHADOWFAX_SPH)
+        part->conserved.mass = volume / count;
+#else
+        part->mass = volume / count;
+#endif
+        hydro_set_init_internal_energy(part, 1.f);
+        part->time_bin = 1;
+
+#ifdef SWIFT_DEBUG_CHECKS
+        part->ti_drift = 8;
+        part->ti_kick = 8;
+#endif
+
+        gpart->x[0] = part->x[0];
+        gpart->x[1] = part->x[1];
+        gpart->x[2] = part->x[2];
+        gpart->mass = volume / count;
+        gpart->time_bin = 1;
+        gpart->type = swift_type_dark_matter;
+        gpart->id_or_neg_offset = part->id;
+#ifdef SWIFT_DEBUG_CHECKS
+        gpart->ti_drift = 8;
+        gpart->ti_kick = 8;
+        gpart->initialised = 1;
+#endif
+
+        ++part;
+        ++gpart;
+      }
+    }
+  }
+
+  /* Construct the sparts */
+  struct spart *spart = cell->stars.parts;
+  for (size_t x = 0; x < n_stars; ++x) {
+    for (size_t y = 0; y < n_stars; ++y) {
+      for (size_t z = 0; z < n_stars; ++z) {
+        spart->x[0] = offset[0] +
+                      size * (x + 0.5 + random_uniform(-0.5, 0.5) * pert) /
+                          (float)n_stars;
+        spart->x[1] = offset[1] +
+                      size * (y + 0.5 + random_uniform(-0.5, 0.5) * pert) /
+                          (float)n_stars;
+        spart->x[2] = offset[2] +
+                      size * (z + 0.5 + random_uniform(-0.5, 0.5) * pert) /
+                          (float)n_stars;
+        spart->h = size * h / (float)n;
+        stars_h_max = fmaxf(stars_h_max, spart->h);
+        spart->id = ++(*partId);
+        spart->time_bin = 1;
+
+#ifdef SWIFT_DEBUG_CHECKS
+        spart->ti_drift = 8;
+        spart->ti_kick = 8;
+#endif
+        ++spart;
+      }
+    }
+  }
+
+  /* Cell properties */
+  cell->split = 0;
+  cell->hydro.h_max = h_max;
+  cell->hydro.count = count;
+  cell->stars.h_max = stars_h_max;
+  cell->stars.count = scount;
+  cell->grav.count = count;
+  cell->width[0] = size;
+  cell->width[1] = size;
+  cell->width[2] = size;
+  cell->loc[0] = offset[0];
+  cell->loc[1] = offset[1];
+  cell->loc[2] = offset[2];
+
+  cell->hydro.ti_old_part = 8;
+  cell->hydro.ti_end_min = 8;
+  cell->hydro.ti_end_max = 8;
+  cell->stars.ti_old_part = 8;
+  cell->stars.ti_end_min = 8;
+  cell->stars.ti_end_max = 8;
+  cell->grav.ti_old_part = 8;
+  cell->grav.ti_old_multipole = 8;
+  cell->grav.ti_end_min = 8;
+  cell->grav.ti_end_max = 8;
+  cell->nodeID = NODE_ID;
+
+  shuffle_particles(cell->hydro.parts, cell->hydro.count);
+  shuffle_sparticles(cell->stars.parts, cell->stars.count);
+
+  /* Build the multipole of the cell */
+  cell->grav.multipole =
+      (struct gravity_tensors *)malloc(sizeof(struct gravity_tensors));
+  if (cell->grav.multipole == NULL) error("couldn't allocate the multipole");
+  gravity_reset(cell->grav.multipole);
+  gravity_P2M(cell->grav.multipole, cell->grav.parts, cell->grav.count);
+  cell->grav.multipole->r_max = sqrt(3.) * size;
+
+  return cell;
+}
+
+void clean_up(struct cell *ci) {
+  free(ci->hydro.parts);
+  free(ci->hydro.xparts);
+  free(ci->grav.parts);
+  free(ci->stars.parts);
+  free(ci->grav.multipole);
+  cell_free_hydro_sorts(ci);
+  cell_free_stars_sorts(ci);
+  free(ci);
+}
+
+/**
+ * @brief Initializes all particles field to be ready for a density calculation
+ */
+void zero_particle_fields(struct cell *c) {
+  for (int pid = 0; pid < c->hydro.count; pid++)
+    hydro_init_part(&c->hydro.parts[pid], NULL);
+  for (int pid = 0; pid < c->stars.count; pid++)
+    stars_init_spart(&c->stars.parts[pid]);
+  for (int pid = 0; pid < c->grav.count; pid++)
+    gravity_init_gpart(&c->grav.parts[pid]);
+}
+
+/**
+ * @brief Finishes the density loop of a cell and gets its particles ready for
+ * a force calculation.
+ */
+void prepare_force(struct cell *c, const struct cosmology *cosmo,
+                   const struct hydro_props *hydro_props) {
+  for (int pid = 0; pid < c->hydro.count; pid++) {
+    struct part *p = &c->hydro.parts[pid];
+    hydro_end_density(p, cosmo);
+    hydro_prepare_force(p, &c->hydro.xparts[pid], cosmo, hydro_props, 0.);
+    hydro_reset_acceleration(p);
+  }
+}
+
+/**
+ * @brief Counts the hydro interactions between two cells (or within one cell).
+ *
+ * A particle i interacts with j if j is within the kernel support of i or, for
+ * the force loop, if i is within the support of j.
+ *
+ * @param ci The first #cell.
+ * @param cj The second #cell (can be ci).
+ * @param force Are we counting the interactions of the force loop?
+ */
+long long count_hydro_interactions(const struct cell *ci, const struct cell *cj,
+                                   int force) {
+
+  long long count = 0;
+  for (int pid = 0; pid < ci->hydro.count; pid++) {
+    const struct part *pi = &ci->hydro.parts[pid];
+    const float hig2 = pi->h * pi->h * kernel_gamma2;
+    for (int pjd = 0; pjd < cj->hydro.count; pjd++) {
+      const struct part *pj = &cj->hydro.parts[pjd];
+      if (pi == pj) continue;
+      const float hjg2 = pj->h * pj->h * kernel_gamma2;
+      const float dx[3] = {pi->x[0] - pj->x[0], pi->x[1] - pj->x[1],
+                           pi->x[2] - pj->x[2]};
+      const float r2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+
+      /* Density: i gathers from j and, for pairs, j gathers from i */
+      if (!force) {
+        if (r2 < hig2) count++;
+        if (ci != cj && r2 < hjg2) count++;
+      } else if (r2 < hig2 || r2 < hjg2) {
+        count += (ci != cj) ? 2 : 1;
+      }
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Counts the star-gas interactions between two cells (or within one
+ * cell).
+ *
+ * @param ci The #cell with the stars.
+ * @param cj The #cell with the gas (can be ci).
+ */
+long long count_stars_interactions(const struct cell *ci,
+                                   const struct cell *cj) {
+
+  long long count = 0;
+  for (int sid = 0; sid < ci->stars.count; sid++) {
+    const struct spart *si = &ci->stars.parts[sid];
+    const float hig2 = si->h * si->h * kernel_gamma2;
+    for (int pjd = 0; pjd < cj->hydro.count; pjd++) {
+      const struct part *pj = &cj->hydro.parts[pjd];
+      const float dx[3] = {si->x[0] - pj->x[0], si->x[1] - pj->x[1],
+                           si->x[2] - pj->x[2]};
+      const float r2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+      if (r2 < hig2) count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Prints the timing of one kernel.
+ *
+ * @param name The name of the kernel.
+ * @param b The #benchmark of the kernel.
+ */
+void benchmark_print(const char *name, const struct benchmark *b) {
+
+  if (b->calls == 0) {
+    printf("%-40s %14s\n", name, "skipped");
+    return;
+  }
+
+  const double time = clocks_from_ticks(b->time);
+  printf("%-40s %14.6f %16.4e %12.1f %12lld\n", name, time / b->calls,
+         (time > 0.) ? 1e3 * b->interactions / time : 0.,
+         (b->interactions > 0) ? (double)b->bytes / b->interactions : 0.,
+         b->interactions / b->calls);
+}
+
+/* And go... */
+int main(int argc, char *argv[]) {
+
+#ifdef HAVE_SETAFFINITY
+  engine_pin();
+#endif
+
+  size_t runs = 0, particles = 0, sparticles = 0;
+  double h = 1.23485, perturbation = 0.1, contrast = 1.;
+  const double size = 1.;
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+  /* Get some randomness going */
+  srand(0);
+
+  char c;
+  while ((c = getopt(argc, argv, "c:d:h:n:r:s:")) != -1) {
+    switch (c) {
+      case 'c':
+        sscanf(optarg, "%lf", &contrast);
+        break;
+      case 'd':
+        sscanf(optarg, "%lf", &perturbation);
+        break;
+      case 'h':
+        sscanf(optarg, "%lf", &h);
+        break;
+      case 'n':
+        sscanf(optarg, "%zu", &particles);
+        break;
+      case 'r':
+        sscanf(optarg, "%zu", &runs);
+        break;
+      case 's':
+        sscanf(optarg, "%zu", &sparticles);
+        break;
+      case '?':
+        error("Unknown option.");
+        break;
+    }
+  }
+
+  if (h < 0 || particles == 0 || runs == 0 || contrast <= 0.) {
+    printf(
+        "\nUsage: %s -n PARTICLES_PER_AXIS -r NUMBER_OF_RUNS [OPTIONS...]\n"
+        "\nGenerates 27 cells filled with gas, dark matter and star particles "
+        "\nand times the hydro, stars and gravity interactions of the central "
+        "\ncell with itself and its 26 neighbours."
+        "\n\nOptions:"
+        "\n-h DISTANCE=1.2348 - Smoothing length in units of <x>"
+        "\n-d pert=0.1        - Perturbation to apply to the particles [0,1["
+        "\n-c contrast=1      - Density of the neighbours relative to the "
+        "central cell"
+        "\n-s STARS_PER_AXIS  - Number of stars per axis (default: "
+        "PARTICLES_PER_AXIS / 2)\n",
+        argv[0]);
+    exit(1);
+  }
+  if (sparticles == 0) sparticles = max(particles / 2, (size_t)1);
+
+  /* The neighbours have the same mass per particle but a different density */
+  const size_t nparticles =
+      max((size_t)lround(particles * cbrt(contrast)), (size_t)1);
+
+  /* Help users... */
+  message("Hydro implementation: %s", SPH_IMPLEMENTATION);
+  message("Kernel:               %s", kernel_name);
+  message("Vector size:          %d", VEC_SIZE);
+  message("Multipole order:      %d", SELF_GRAVITY_MULTIPOLE_ORDER);
+  message("Particles per axis:   %zu (central), %zu (neighbours)", particles,
+          nparticles);
+  message("Stars per axis:       %zu", sparticles);
+  message("Neighbour target: N = %f", pow_dimension(h) * kernel_norm);
+
+  printf("\n");
+
+  /* Build the infrastructure */
+  struct space space;
+  bzero(&space, sizeof(struct space));
+  space.periodic = 1;
+  space.dim[0] = 3.;
+  space.dim[1] = 3.;
+  space.dim[2] = 3.;
+
+  struct hydro_props hp;
+  hydro_props_init_no_hydro(&hp);
+  hp.eta_neighbours = h;
+  hp.h_tolerance = 1e0;
+  hp.h_max = FLT_MAX;
+  hp.max_smoothing_iterations = 1;
+  hp.CFL_condition = 0.1;
+
+  struct stars_props stars_p;
+  bzero(&stars_p, sizeof(struct stars_props));
+  stars_p.eta_neighbours = h;
+  stars_p.h_tolerance = 1e0;
+  stars_p.max_smoothing_iterations = 1;
+
+  struct gravity_props grav_p;
+  bzero(&grav_p, sizeof(struct gravity_props));
+  grav_p.multipole_order = SELF_GRAVITY_MULTIPOLE_ORDER;
+  grav_p.theta_crit2 = 0.;
+  grav_p.epsilon_cur = 0.01 * size / particles;
+  grav_p.epsilon_cur_inv = 1.f / grav_p.epsilon_cur;
+
+  struct pm_mesh mesh;
+  bzero(&mesh, sizeof(struct pm_mesh));
+  mesh.periodic = 0;
+  mesh.dim[0] = 3.;
+  mesh.dim[1] = 3.;
+  mesh.dim[2] = 3.;
+  mesh.r_s = FLT_MAX;
+  mesh.r_s_inv = 0.;
+  mesh.r_cut_min = 0.;
+  mesh.r_cut_max = FLT_MAX;
+
+  struct engine *engine = (struct engine *)malloc(sizeof(struct engine));
+  if (engine == NULL) error("Failed to allocate the engine.");
+  bzero(engine, sizeof(struct engine));
+  engine->s = &space;
+  engine->time = 0.1f;
+  engine->ti_current = 8;
+  engine->time_base = 1e-10;
+  engine->max_active_bin = num_time_bins;
+  engine->hydro_properties = &hp;
+  engine->stars_properties = &stars_p;
+  engine->gravity_properties = &grav_p;
+  engine->mesh = &mesh;
+  engine->nodeID = NODE_ID;
+
+  struct cosmology cosmo;
+  cosmology_init_no_cosmo(&cosmo);
+  engine->cosmology = &cosmo;
+
+  struct runner runner;
+  bzero(&runner, sizeof(struct runner));
+  runner.e = engine;
+
+  /* Construct some cells */
+  struct cell *cells[27];
+  long long partId = 0;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      for (int k = 0; k < 3; ++k) {
+        double offset[3] = {i * size, j * size, k * size};
+        const int is_main = (i == 1 && j == 1 && k == 1);
+        struct cell *ci =
+            make_cell(is_main ? particles : nparticles, sparticles, offset,
+                      size, h, &partId, perturbation);
+
+        runner_do_drift_part(&runner, ci, 0);
+        runner_do_drift_spart(&runner, ci, 0);
+        runner_do_hydro_sort(&runner, ci, 0x1FFF, 0, 0);
+        runner_do_stars_sort(&runner, ci, 0x1FFF, 0, 0);
+        cells[i * 9 + j * 3 + k] = ci;
+      }
+    }
+  }
+  struct cell *main_cell = cells[13];
+
+  /* Make the caches large enough for any of the cells */
+  const int max_count = max(main_cell->hydro.count, cells[0]->hydro.count);
+#ifdef WITH_VECTORIZATION
+  cache_init(&runner.ci_cache, max_count);
+  cache_init(&runner.cj_cache, max_count);
+#endif
+  gravity_cache_init(&runner.ci_gravity_cache, max_count);
+  gravity_cache_init(&runner.cj_gravity_cache, max_count);
+
+  /* Get the sort IDs and shifts of all the pairs, with the cells in the
+   * order space_getsid() wants them */
+  struct cell *pair_ci[27], *pair_cj[27];
+  int pair_sid[27];
+  double pair_shift[27][3];
+  for (int j = 0; j < 27; ++j) {
+    pair_ci[j] = main_cell;
+    pair_cj[j] = cells[j];
+    if (j == 13) continue;
+    pair_sid[j] = space_getsid(&space, &pair_ci[j], &pair_cj[j], pair_shift[j]);
+  }
+
+  /* Count the interactions each kernel computes and the bytes of particle
+   * data it reads */
+  const long long part_bytes = main_cell->hydro.count * sizeof(struct part);
+  const long long npart_bytes = cells[0]->hydro.count * sizeof(struct part);
+  const long long gpart_bytes = main_cell->grav.count * sizeof(struct gpart);
+  const long long ngpart_bytes = cells[0]->grav.count * sizeof(struct gpart);
+  const long long spart_bytes = main_cell->stars.count * sizeof(struct spart);
+
+  long long self_density = count_hydro_interactions(main_cell, main_cell, 0);
+  long long self_force = count_hydro_interactions(main_cell, main_cell, 1);
+  long long self_stars = count_stars_interactions(main_cell, main_cell);
+  long long pair_density = 0, pair_force = 0, pair_stars = 0;
+  for (int j = 0; j < 27; ++j) {
+    if (j == 13) continue;
+    pair_density += count_hydro_interactions(main_cell, cells[j], 0);
+    pair_force += count_hydro_interactions(main_cell, cells[j], 1);
+    pair_stars += count_stars_interactions(main_cell, cells[j]) +
+                  count_stars_interactions(cells[j], main_cell);
+  }
+
+  /* All the benchmarks */
+  struct benchmark b_self_density, b_pair_density, b_self_force, b_pair_force;
+  struct benchmark b_self_density_vec, b_pair_density_vec, b_self_force_vec,
+      b_pair_force_vec;
+  struct benchmark b_self_stars, b_pair_stars, b_self_grav, b_pair_grav;
+  struct benchmark b_m2l, b_m2l_batch;
+  bzero(&b_self_density, sizeof(struct benchmark));
+  bzero(&b_pair_density, sizeof(struct benchmark));
+  bzero(&b_self_force, sizeof(struct benchmark));
+  bzero(&b_pair_force, sizeof(struct benchmark));
+  bzero(&b_self_density_vec, sizeof(struct benchmark));
+  bzero(&b_pair_density_vec, sizeof(struct benchmark));
+  bzero(&b_self_force_vec, sizeof(struct benchmark));
+  bzero(&b_pair_force_vec, sizeof(struct benchmark));
+  bzero(&b_self_stars, sizeof(struct benchmark));
+  bzero(&b_pair_stars, sizeof(struct benchmark));
+  bzero(&b_self_grav, sizeof(struct benchmark));
+  bzero(&b_pair_grav, sizeof(struct benchmark));
+  bzero(&b_m2l, sizeof(struct benchmark));
+  bzero(&b_m2l_batch, sizeof(struct benchmark));
+
+  /* The multipoles of the neighbours, for the M2L kernels */
+  const struct gravity_tensors *multi_j[26];
+  for (int j = 0, k = 0; j < 27; ++j)
+    if (j != 13) multi_j[k++] = cells[j]->grav.multipole;
+
+  for (size_t i = 0; i < runs; ++i) {
+
+    /* Hydro density, scalar version */
+    for (int j = 0; j < 27; ++j) zero_particle_fields(cells[j]);
+    ticks tic = getticks();
+    runner_doself1_density(&runner, main_cell);
+    b_self_density.time += getticks() - tic;
+    tic = getticks();
+    for (int j = 0; j < 27; ++j)
+      if (j != 13)
+        runner_dopair1_density(&runner, pair_ci[j], pair_cj[j], pair_sid[j],
+                               pair_shift[j]);
+    b_pair_density.time += getticks() - tic;
+
+#ifdef BENCHMARK_HYDRO_VEC
+    /* Hydro density, vector version (the corners are always scalar) */
+    for (int j = 0; j < 27; ++j) zero_particle_fields(cells[j]);
+    tic = getticks();
+    runner_doself1_density_vec(&runner, main_cell);
+    b_self_density_vec.time += getticks() - tic;
+    tic = getticks();
+    for (int j = 0; j < 27; ++j) {
+      if (j == 13) continue;
+      if (!sort_is_corner(pair_sid[j]))
+        runner_dopair1_density_vec(&runner, pair_ci[j], pair_cj[j],
+                                   pair_sid[j], pair_shift[j]);
+      else
+        runner_dopair1_density(&runner, pair_ci[j], pair_cj[j], pair_sid[j],
+                               pair_shift[j]);
+    }
+    b_pair_density_vec.time += getticks() - tic;
+#endif
+
+#ifndef EXTRA_HYDRO_LOOP
+    /* Get the densities of all the cells for the force loop */
+    for (int j = 0; j < 27; ++j) {
+      if (j != 13) runner_doself1_density(&runner, cells[j]);
+      prepare_force(cells[j], &cosmo, &hp);
+    }
+
+    /* Hydro force, scalar version */
+    tic = getticks();
+    runner_doself2_force(&runner, main_cell);
+    b_self_force.time += getticks() - tic;
+    tic = getticks();
+    for (int j = 0; j < 27; ++j)
+      if (j != 13)
+        runner_dopair2_force(&runner, pair_ci[j], pair_cj[j], pair_sid[j],
+                             pair_shift[j]);
+    b_pair_force.time += getticks() - tic;
+
+#ifdef BENCHMARK_HYDRO_VEC
+    /* Hydro force, vector version */
+    for (int j = 0; j < 27; ++j)
+      for (int k = 0; k < cells[j]->hydro.count; k++)
+        hydro_reset_acceleration(&cells[j]->hydro.parts[k]);
+    tic = getticks();
+    runner_doself2_force_vec(&runner, main_cell);
+    b_self_force_vec.time += getticks() - tic;
+    tic = getticks();
+    for (int j = 0; j < 27; ++j)
+      if (j != 13)
+        runner_dopair2_force_vec(&runner, pair_ci[j], pair_cj[j], pair_sid[j],
+                                 pair_shift[j]);
+    b_pair_force_vec.time += getticks() - tic;
+#endif
+#endif /* EXTRA_HYDRO_LOOP */
+
+    /* Stars density */
+    tic = getticks();
+    runner_doself_branch_stars_density(&runner, main_cell);
+    b_self_stars.time += getticks() - tic;
+    tic = getticks();
+    for (int j = 0; j < 27; ++j)
+      if (j != 13)
+        runner_dopair_branch_stars_density(&runner, main_cell, cells[j]);
+    b_pair_stars.time += getticks() - tic;
+
+    /* Gravity P-P */
+    tic = getticks();
+    runner_doself_grav_pp(&runner, main_cell);
+    b_self_grav.time += getticks() - tic;
+    tic = getticks();
+    for (int j = 0; j < 27; ++j)
+      if (j != 13)
+        runner_dopair_grav_pp(&runner, main_cell, cells[j], /*symmetric=*/1,
+                              /*allow_mpole=*/0);
+    b_pair_grav.time += getticks() - tic;
+
+    /* Gravity M2L, one multipole at a time and batched */
+    struct grav_tensor *pot = &main_cell->grav.multipole->pot;
+    const double *CoM = main_cell->grav.multipole->CoM;
+    gravity_field_tensors_init(pot, engine->ti_current);
+    tic = getticks();
+    for (int k = 0; k < 26; ++k)
+      gravity_M2L_nonsym(pot, &multi_j[k]->m_pole, CoM, multi_j[k]->CoM,
+                         &grav_p, mesh.periodic, mesh.dim, mesh.r_s_inv);
+    b_m2l.time += getticks() - tic;
+    gravity_field_tensors_init(pot, engine->ti_current);
+    tic = getticks();
+    for (int k = 0; k < 26; k += gravity_M2L_batch_size)
+      gravity_M2L_nonsym_batch(pot, &multi_j[k],
+                               min(26 - k, gravity_M2L_batch_size), CoM,
+                               &grav_p, mesh.periodic, mesh.dim, mesh.r_s_inv);
+    b_m2l_batch.time += getticks() - tic;
+  }
+
+  /* Collect the counts */
+  b_self_density.calls = runs;
+  b_self_density.interactions = runs * self_density;
+  b_self_density.bytes = runs * part_bytes;
+  b_pair_density.calls = 26 * runs;
+  b_pair_density.interactions = runs * pair_density;
+  b_pair_density.bytes = 26 * runs * (part_bytes + npart_bytes);
+#ifdef BENCHMARK_HYDRO_VEC
+  b_self_density_vec = b_self_density;
+  b_pair_density_vec = b_pair_density;
+#endif
+#ifndef EXTRA_HYDRO_LOOP
+  b_self_force.calls = runs;
+  b_self_force.interactions = runs * self_force;
+  b_self_force.bytes = runs * part_bytes;
+  b_pair_force.calls = 26 * runs;
+  b_pair_force.interactions = runs * pair_force;
+  b_pair_force.bytes = 26 * runs * (part_bytes + npart_bytes);
+#ifdef BENCHMARK_HYDRO_VEC
+  b_self_force_vec = b_self_force;
+  b_pair_force_vec = b_pair_force;
+#endif
+#endif
+  b_self_stars.calls = runs;
+  b_self_stars.interactions = runs * self_stars;
+  b_self_stars.bytes = runs * (spart_bytes + part_bytes);
+  b_pair_stars.calls = 26 * runs;
+  b_pair_stars.interactions = runs * pair_stars;
+  b_pair_stars.bytes =
+      26 * runs * (2 * spart_bytes + part_bytes + npart_bytes);
+  b_self_grav.calls = runs;
+  b_self_grav.interactions =
+      runs * main_cell->grav.count * (main_cell->grav.count - 1ll);
+  b_self_grav.bytes = runs * gpart_bytes;
+  b_pair_grav.calls = 26 * runs;
+  b_pair_grav.interactions =
+      26 * runs * 2ll * main_cell->grav.count * cells[0]->grav.count;
+  b_pair_grav.bytes = 26 * runs * (gpart_bytes + ngpart_bytes);
+  b_m2l.calls = 26 * runs;
+  b_m2l.interactions = 26 * runs;
+  b_m2l.bytes = 26 * runs * sizeof(struct gravity_tensors);
+  b_m2l_batch.calls = runs * ((26 + gravity_M2L_batch_size - 1) /
+                              gravity_M2L_batch_size);
+  b_m2l_batch.interactions = b_m2l.interactions;
+  b_m2l_batch.bytes = b_m2l.bytes;
+
+  /* Output timing */
+  printf("# %-38s %14s %16s %12s %12s\n", "Kernel", "Time/call [ms]",
+         "Interactions/s", "Bytes/inter.", "Inter./call");
+  benchmark_print("runner_doself1_density", &b_self_density);
+  benchmark_print("runner_doself1_density_vec", &b_self_density_vec);
+  benchmark_print("runner_dopair1_density", &b_pair_density);
+  benchmark_print("runner_dopair1_density_vec", &b_pair_density_vec);
+  benchmark_print("runner_doself2_force", &b_self_force);
+  benchmark_print("runner_doself2_force_vec", &b_self_force_vec);
+  benchmark_print("runner_dopair2_force", &b_pair_force);
+  benchmark_print("runner_dopair2_force_vec", &b_pair_force_vec);
+  benchmark_print("runner_doself_branch_stars_density", &b_self_stars);
+  benchmark_print("runner_dopair_branch_stars_density", &b_pair_stars);
+  benchmark_print("runner_doself_grav_pp", &b_self_grav);
+  benchmark_print("runner_dopair_grav_pp", &b_pair_grav);
+  benchmark_print("gravity_M2L_nonsym", &b_m2l);
+  benchmark_print("gravity_M2L_nonsym_batch", &b_m2l_batch);
+
+  /* Clean things to make the sanitizer happy ... */
+  for (int i = 0; i < 27; ++i) clean_up(cells[i]);
+
+#ifdef WITH_VECTORIZATION
+  cache_clean(&runner.ci_cache);
+  cache_clean(&runner.cj_cache);
+#endif
+  gravity_cache_clean(&runner.ci_gravity_cache);
+  gravity_cache_clean(&runner.cj_gravity_cache);
+  sort_arena_clean(&runner.sort_arena);
+  free(engine);
+
+  return 0;
+}
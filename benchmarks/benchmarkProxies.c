@@ -0,0 +1,564 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* MPI headers. */
+#include <mpi.h>
+
+/* Local headers. */
+#include "proxy.h"
+#include "swift.h"
+
+/* Maximal number of top-level cells in a decomposition. */
+#define max_nr_cells (1 << 24)
+
+/**
+ * @brief The timing of the messages of one communication sub-type.
+ */
+struct benchmark {
+
+  /*! Number of messages sent by this rank in one replay */
+  long long messages;
+
+  /*! Number of bytes sent by this rank in one replay */
+  long long bytes;
+
+  /*! Time spent exchanging the messages */
+  ticks time;
+
+  /*! Time spent exchanging the messages with no data */
+  ticks time_empty;
+};
+
+/**
+ * @brief Reads a decomposition written by dumpCellRanks().
+ *
+ * The ranks of the file are folded onto the ranks of this run and cells
+ * without particle counts (files written before the counts were added) get
+ * the given number of particles.
+ *
+ * @param fname The name of the file.
+ * @param s The #space to fill with the top-level cells.
+ * @param nr_nodes The number of ranks of this run.
+ * @param count The number of particles of the cells without counts.
+ */
+void read_decomposition(const char *fname, struct space *s, const int nr_nodes,
+                        const int count) {
+
+  FILE *file = fopen(fname, "r");
+  if (file == NULL) error("Failed to open the decomposition file '%s'.", fname);
+
+  /* Read all the cells. */
+  double(*data)[10] = NULL;
+  int nr_cells = 0, size = 0;
+  char line[512];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    const char *p = line;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '#' || *p == '\n' || *p == '\0') continue;
+
+    if (nr_cells == size) {
+      size = size ? 2 * size : 1024;
+      if (size > max_nr_cells) error("Too many cells in '%s'.", fname);
+      if ((data = realloc(data, size * sizeof(*data))) == NULL)
+        error("Failed to allocate the cells.");
+    }
+    double *d = data[nr_cells];
+    const int n = sscanf(p, "%lf %lf %lf %lf %lf %lf %lf %lf %lf %lf", &d[0],
+                         &d[1], &d[2], &d[3], &d[4], &d[5], &d[6], &d[7],
+                         &d[8], &d[9]);
+    if (n == 7) {
+      d[7] = d[8] = count;
+      d[9] = 0.;
+    } else if (n != 10) {
+      error("Invalid line in '%s': %s", fname, line);
+    }
+    nr_cells++;
+  }
+  fclose(file);
+  if (nr_cells == 0) error("No cells in '%s'.", fname);
+
+  /* Recover the grid of top-level cells. */
+  for (int k = 0; k < 3; k++) {
+    s->width[k] = data[0][3 + k];
+    s->iwidth[k] = 1. / s->width[k];
+    s->cdim[k] = 0;
+    for (int i = 0; i < nr_cells; i++)
+      s->cdim[k] =
+          max(s->cdim[k], (int)lround(data[i][k] * s->iwidth[k]) + 1);
+    s->dim[k] = s->cdim[k] * s->width[k];
+  }
+  if (s->cdim[0] * s->cdim[1] * s->cdim[2] != nr_cells)
+    error("The %d cells of '%s' do not fill a %dx%dx%d grid.", nr_cells,
+          fname, s->cdim[0], s->cdim[1], s->cdim[2]);
+
+  /* Create the cells and their (empty) multipoles. */
+  s->nr_cells = nr_cells;
+  if (swift_memalign("cells_top", (void **)&s->cells_top, cell_align,
+                     nr_cells * sizeof(struct cell)) != 0 ||
+      swift_memalign("multipoles_top", (void **)&s->multipoles_top,
+                     multipole_align,
+                     nr_cells * sizeof(struct gravity_tensors)) != 0)
+    error("Failed to allocate the top-level cells.");
+  bzero(s->cells_top, nr_cells * sizeof(struct cell));
+  bzero(s->multipoles_top, nr_cells * sizeof(struct gravity_tensors));
+
+  for (int i = 0; i < nr_cells; i++) {
+    int ind[3];
+    for (int k = 0; k < 3; k++) ind[k] = lround(data[i][k] * s->iwidth[k]);
+    const int cid = cell_getid(s->cdim, ind[0], ind[1], ind[2]);
+    struct cell *c = &s->cells_top[cid];
+    for (int k = 0; k < 3; k++) {
+      c->loc[k] = ind[k] * s->width[k];
+      c->width[k] = s->width[k];
+    }
+    c->dmin = min3(c->width[0], c->width[1], c->width[2]);
+    c->nodeID = ((int)data[i][6]) % nr_nodes;
+    c->hydro.count = data[i][7];
+    c->grav.count = data[i][8];
+    c->stars.count = data[i][9];
+    c->grav.multipole = &s->multipoles_top[cid];
+  }
+  free(data);
+}
+
+/**
+ * @brief Estimated number of cells in the tree of a top-level cell.
+ *
+ * @param count The number of particles in the cell.
+ * @param split_size The maximal number of particles in a leaf.
+ */
+int tree_size(int count, const int split_size) {
+
+  int size = 1, level = 1;
+  while (count > split_size) {
+    level *= 8;
+    size += level;
+    count /= 8;
+  }
+  return size;
+}
+
+/**
+ * @brief Replays the messages of one communication sub-type.
+ *
+ * The messages to and from every proxy are posted in the order of the
+ * cells of the proxy, like the send and recv tasks of a time-step, with a
+ * message per cell of the requested depth below the top level.
+ *
+ * @param e The #engine with the proxies.
+ * @param subtype The communication sub-type.
+ * @param bytes_per_cell Size of the messages of each top-level cell, in
+ * bytes.
+ * @param cell_type The #proxy_cell_type of the cells that communicate.
+ * @param depth The depth of the cells of the messages.
+ * @param empty Send empty messages instead?
+ * @param b (output) The #benchmark to update.
+ */
+void replay(struct engine *e, const int subtype, const size_t *bytes_per_cell,
+            const int cell_type, const int depth, const int empty,
+            struct benchmark *b) {
+
+  const struct cell *cells = e->s->cells_top;
+  const int split = 1 << (3 * depth);
+  int *tag_ub, flag;
+  MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_TAG_UB, &tag_ub, &flag);
+  const int max_tag = flag ? *tag_ub : 32767;
+
+  /* Size the buffers. */
+  size_t nr_reqs = 0, size_in = 0, size_out = 0;
+  for (int p = 0; p < e->nr_proxies; p++) {
+    const struct proxy *prox = &e->proxies[p];
+    for (int k = 0; k < prox->nr_cells_in; k++)
+      if (prox->cells_in_type[k] & cell_type) {
+        nr_reqs += split;
+        size_in += bytes_per_cell[prox->cells_in[k] - cells];
+      }
+    for (int k = 0; k < prox->nr_cells_out; k++)
+      if (prox->cells_out_type[k] & cell_type) {
+        nr_reqs += split;
+        size_out = max(size_out, bytes_per_cell[prox->cells_out[k] - cells]);
+      }
+  }
+  MPI_Request *reqs = malloc(nr_reqs * sizeof(MPI_Request) + 1);
+  char *buff_in = malloc(size_in + 1);
+  char *buff_out = calloc(size_out + 1, 1);
+  if (reqs == NULL || buff_in == NULL || buff_out == NULL)
+    error("Failed to allocate the message buffers.");
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  const ticks tic = getticks();
+
+  /* Post the receives first, as the recv tasks are enqueued first... */
+  int nr_posted = 0;
+  size_t offset = 0;
+  for (int p = 0; p < e->nr_proxies; p++) {
+    const struct proxy *prox = &e->proxies[p];
+    for (int k = 0; k < prox->nr_cells_in; k++) {
+      if (!(prox->cells_in_type[k] & cell_type)) continue;
+      const int cid = prox->cells_in[k] - cells;
+      for (int j = 0; j < split; j++) {
+        const size_t size =
+            empty ? 0
+                  : bytes_per_cell[cid] / split +
+                        (j == 0 ? bytes_per_cell[cid] % split : 0);
+        const int tag = ((long long)cid * split + j) % max_tag;
+        int err = MPI_Irecv(&buff_in[offset], size, MPI_BYTE, prox->nodeID,
+                            tag, subtaskMPI_comms[subtype],
+                            &reqs[nr_posted++]);
+        if (err != MPI_SUCCESS) mpi_error(err, "Failed to post a receive.");
+        offset += size;
+      }
+    }
+  }
+
+  /* ...then the sends. */
+  for (int p = 0; p < e->nr_proxies; p++) {
+    const struct proxy *prox = &e->proxies[p];
+    for (int k = 0; k < prox->nr_cells_out; k++) {
+      if (!(prox->cells_out_type[k] & cell_type)) continue;
+      const int cid = prox->cells_out[k] - cells;
+      for (int j = 0; j < split; j++) {
+        const size_t size =
+            empty ? 0
+                  : bytes_per_cell[cid] / split +
+                        (j == 0 ? bytes_per_cell[cid] % split : 0);
+        const int tag = ((long long)cid * split + j) % max_tag;
+        int err = MPI_Isend(buff_out, size, MPI_BYTE, prox->nodeID, tag,
+                            subtaskMPI_comms[subtype], &reqs[nr_posted++]);
+        if (err != MPI_SUCCESS) mpi_error(err, "Failed to post a send.");
+        if (!empty) {
+          b->messages++;
+          b->bytes += size;
+        }
+      }
+    }
+  }
+
+  if (MPI_Waitall(nr_posted, reqs, MPI_STATUSES_IGNORE) != MPI_SUCCESS)
+    error("MPI_Waitall failed.");
+
+  if (empty)
+    b->time_empty += getticks() - tic;
+  else
+    b->time += getticks() - tic;
+
+  free(reqs);
+  free(buff_in);
+  free(buff_out);
+}
+
+/**
+ * @brief Prints the timing of one communication sub-type, on rank 0.
+ *
+ * @param name The name of the sub-type.
+ * @param b The #benchmark of the sub-type.
+ * @param runs The number of runs.
+ */
+void benchmark_print(const char *name, const struct benchmark *b,
+                     const int runs) {
+
+  /* Totals over the ranks and time of the slowest rank. */
+  long long counts[2] = {b->messages, b->bytes}, max_messages = 0;
+  double times[2] = {clocks_from_ticks(b->time),
+                     clocks_from_ticks(b->time_empty)};
+  MPI_Allreduce(MPI_IN_PLACE, counts, 2, MPI_LONG_LONG_INT, MPI_SUM,
+                MPI_COMM_WORLD);
+  MPI_Allreduce(&b->messages, &max_messages, 1, MPI_LONG_LONG_INT, MPI_MAX,
+                MPI_COMM_WORLD);
+  MPI_Allreduce(MPI_IN_PLACE, times, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  if (engine_rank != 0) return;
+
+  if (counts[0] == 0) {
+    printf("%-12s %12s\n", name, "skipped");
+    return;
+  }
+
+  /* Times are in ms. */
+  printf("%-12s %12lld %14.3f %12.3f %12.3f %12.3f\n", name, counts[0] / runs,
+         counts[1] / (1024. * 1024. * runs), times[0] / runs,
+         (times[0] > 0.) ? counts[1] / (1e6 * times[0]) : 0.,
+         (max_messages > 0) ? 1e3 * times[1] / max_messages : 0.);
+}
+
+/* And go... */
+int main(int argc, char *argv[]) {
+
+  /* Start MPI like SWIFT does. */
+  int res, prov, nr_nodes, myrank;
+  if ((res = MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &prov)) !=
+      MPI_SUCCESS)
+    error("Call to MPI_Init failed with error %i.", res);
+  if (prov != MPI_THREAD_MULTIPLE)
+    error(
+        "MPI does not provide the level of threading"
+        " required (MPI_THREAD_MULTIPLE).");
+  MPI_Comm_size(MPI_COMM_WORLD, &nr_nodes);
+  MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+  engine_rank = myrank;
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+  int runs = 10, with_gravity = 0, periodic = 1, count = 1000, compress = 0;
+  int compact = 0, depth = 0, split_size = 400, nr_threads = 1, mesh_size = 0;
+  double theta = 0.7;
+
+  char c;
+  while ((c = getopt(argc, argv, "cCd:gm:n:Pr:s:t:T:")) != -1) {
+    switch (c) {
+      case 'c':
+        compress = 1;
+        break;
+      case 'C':
+        compact = 1;
+        break;
+      case 'd':
+        sscanf(optarg, "%d", &depth);
+        break;
+      case 'g':
+        with_gravity = 1;
+        break;
+      case 'm':
+        sscanf(optarg, "%d", &mesh_size);
+        break;
+      case 'n':
+        sscanf(optarg, "%d", &count);
+        break;
+      case 'P':
+        periodic = 0;
+        break;
+      case 'r':
+        sscanf(optarg, "%d", &runs);
+        break;
+      case 's':
+        sscanf(optarg, "%d", &split_size);
+        break;
+      case 't':
+        sscanf(optarg, "%lf", &theta);
+        break;
+      case 'T':
+        sscanf(optarg, "%d", &nr_threads);
+        break;
+      case '?':
+        error("Unknown option.");
+        break;
+    }
+  }
+
+  if (optind != argc - 1 || runs <= 0 || depth < 0 || depth > 4 ||
+      split_size <= 0 || nr_threads <= 0 || theta <= 0. || theta >= 1.) {
+    if (myrank == 0)
+      printf(
+          "\nUsage: mpirun -np N %s [OPTIONS...] CELL_RANKS_FILE\n"
+          "\nReads a domain decomposition written by dumpCellRanks(), builds"
+          "\nthe proxies of each rank with engine_makeproxies(), times the"
+          "\nexchange of the cells with proxy_cells_exchange() and replays"
+          "\nthe messages of the send and recv tasks of a time-step,"
+          "\nreporting the bandwidth and latency of each sub-type. The ranks"
+          "\nof the file are folded onto the N ranks of the run."
+          "\n\nOptions:"
+          "\n-r RUNS=10     - Number of runs"
+          "\n-g             - Add the gravity proxies and messages"
+          "\n-t THETA=0.7   - Opening angle of the gravity proxies"
+          "\n-m MESH=0      - Side of the gravity mesh (0: 2 cells per "
+          "top-level cell)"
+          "\n-P             - Non-periodic domain"
+          "\n-d DEPTH=0     - Depth below the top-level of the cells that "
+          "\n                 communicate particles"
+          "\n-s SPLIT=400   - Particles per leaf, to size the cell trees"
+          "\n-n COUNT=1000  - Particles of the cells of files without counts"
+          "\n-c             - Compress the exchanged cells"
+          "\n-C             - Compact hydro messages (if the scheme has them)"
+          "\n-T THREADS=1   - Number of threads\n",
+          argv[0]);
+    MPI_Finalize();
+    exit(1);
+  }
+#if !hydro_has_compact_mpi
+  if (compact) error("The hydro scheme does not have compact messages.");
+#endif
+
+  /* Create the MPI types and communicators. */
+  part_create_mpi_types();
+  multipole_create_mpi_types();
+  proxy_create_mpi_type();
+  task_create_mpi_comms();
+
+  /* Build the space and the bits of the engine the proxies need. */
+  struct space s;
+  struct engine e;
+  struct gravity_props gravity_properties;
+  struct pm_mesh mesh;
+  bzero(&s, sizeof(struct space));
+  bzero(&e, sizeof(struct engine));
+  bzero(&gravity_properties, sizeof(struct gravity_props));
+  bzero(&mesh, sizeof(struct pm_mesh));
+  read_decomposition(argv[optind], &s, nr_nodes, count);
+  s.periodic = periodic;
+  s.e = &e;
+
+  gravity_properties.theta_crit = theta;
+  gravity_properties.theta_crit2 = theta * theta;
+  gravity_properties.theta_crit_inv = 1. / theta;
+
+  /* The default Gravity:r_cut_max and Gravity:a_smooth of the mesh. */
+  if (mesh_size == 0) mesh_size = 2 * s.cdim[0];
+  mesh.r_cut_max = periodic ? 4.5 * 1.25 * s.dim[0] / mesh_size : FLT_MAX;
+
+  e.nodeID = myrank;
+  e.nr_nodes = nr_nodes;
+  e.s = &s;
+  e.policy = engine_policy_hydro;
+  if (with_gravity) e.policy |= engine_policy_self_gravity;
+  e.gravity_properties = &gravity_properties;
+  e.mesh = &mesh;
+  if ((e.proxies = calloc(engine_maxproxies, sizeof(struct proxy))) == NULL)
+    error("Failed to allocate the proxies.");
+  threadpool_init(&e.threadpool, nr_threads);
+
+  /* Help users... */
+  int nr_cells_in = 0, nr_cells_out = 0;
+  engine_makeproxies(&e);
+  for (int p = 0; p < e.nr_proxies; p++) {
+    nr_cells_in += e.proxies[p].nr_cells_in;
+    nr_cells_out += e.proxies[p].nr_cells_out;
+  }
+  if (myrank == 0) {
+    message("Top-level cells:      %dx%dx%d", s.cdim[0], s.cdim[1],
+            s.cdim[2]);
+    message("Ranks:                %d", nr_nodes);
+    message("Hydro implementation: %s", SPH_IMPLEMENTATION);
+    message("Gravity proxies:      %s", with_gravity ? "yes" : "no");
+  }
+  for (int k = 0; k < nr_nodes; k++) {
+    if (k == myrank)
+      message("%d proxies, %d cells in, %d cells out.", e.nr_proxies,
+              nr_cells_in, nr_cells_out);
+    MPI_Barrier(MPI_COMM_WORLD);
+  }
+
+  /* Size of the messages of each cell and sub-type. */
+  const int nr_cells = s.nr_cells;
+  size_t *bytes = malloc(6 * nr_cells * sizeof(size_t));
+  if (bytes == NULL) error("Failed to allocate the message sizes.");
+  size_t *bytes_xv = &bytes[0], *bytes_rho = &bytes[nr_cells];
+  size_t *bytes_tend = &bytes[2 * nr_cells];
+  size_t *bytes_gpart = &bytes[3 * nr_cells];
+  size_t *bytes_multipole = &bytes[4 * nr_cells];
+  size_t *bytes_spart = &bytes[5 * nr_cells];
+  int with_stars = 0;
+  for (int k = 0; k < nr_cells; k++) {
+    const struct cell *ci = &s.cells_top[k];
+    const int pcell_size = tree_size(ci->grav.count, split_size);
+    size_t part_size = sizeof(struct part);
+#if hydro_has_compact_mpi
+    if (compact) part_size = cell_pack_hydro_size(task_subtype_xv);
+#endif
+    bytes_xv[k] = ci->hydro.count * part_size;
+#if hydro_has_compact_mpi
+    if (compact) part_size = cell_pack_hydro_size(task_subtype_rho);
+#endif
+    bytes_rho[k] = ci->hydro.count * part_size;
+    bytes_tend[k] = pcell_size * sizeof(struct pcell_step_hydro);
+    bytes_gpart[k] = ci->grav.count * sizeof(struct gpart);
+    bytes_multipole[k] = pcell_size * sizeof(struct gravity_tensors);
+    bytes_spart[k] = ci->stars.count * sizeof(struct spart);
+    if (ci->stars.count > 0) with_stars = 1;
+  }
+
+  struct benchmark b_xv, b_rho, b_tend_part, b_gpart, b_multipole, b_tend_gpart,
+      b_spart;
+  bzero(&b_xv, sizeof(struct benchmark));
+  bzero(&b_rho, sizeof(struct benchmark));
+  bzero(&b_tend_part, sizeof(struct benchmark));
+  bzero(&b_gpart, sizeof(struct benchmark));
+  bzero(&b_multipole, sizeof(struct benchmark));
+  bzero(&b_tend_gpart, sizeof(struct benchmark));
+  bzero(&b_spart, sizeof(struct benchmark));
+  double time_cells = 0.;
+
+  for (int run = 0; run < runs; run++) {
+
+    /* The exchange of the cells at a rebuild. */
+    MPI_Barrier(MPI_COMM_WORLD);
+    const ticks tic = getticks();
+    proxy_cells_exchange(e.proxies, e.nr_proxies, &s, with_gravity, compress);
+    time_cells += clocks_from_ticks(getticks() - tic);
+
+    /* The messages of a time-step, in the order of the tasks. */
+    for (int empty = 0; empty < 2; empty++) {
+      replay(&e, task_subtype_xv, bytes_xv, proxy_cell_type_hydro, depth,
+             empty, &b_xv);
+      replay(&e, task_subtype_rho, bytes_rho, proxy_cell_type_hydro, depth,
+             empty, &b_rho);
+      replay(&e, task_subtype_tend_part, bytes_tend, proxy_cell_type_hydro,
+             /*depth=*/0, empty, &b_tend_part);
+      if (with_gravity) {
+        replay(&e, task_subtype_gpart, bytes_gpart, proxy_cell_type_gravity,
+               depth, empty, &b_gpart);
+        replay(&e, task_subtype_multipole, bytes_multipole,
+               proxy_cell_type_gravity, /*depth=*/0, empty, &b_multipole);
+        replay(&e, task_subtype_tend_gpart, bytes_tend,
+               proxy_cell_type_gravity, /*depth=*/0, empty, &b_tend_gpart);
+      }
+      if (with_stars)
+        replay(&e, task_subtype_spart, bytes_spart, proxy_cell_type_hydro,
+               depth, empty, &b_spart);
+    }
+  }
+
+  /* Report the timings of the slowest rank. */
+  MPI_Allreduce(MPI_IN_PLACE, &time_cells, 1, MPI_DOUBLE, MPI_MAX,
+                MPI_COMM_WORLD);
+  if (myrank == 0) {
+    printf("\n");
+    message("Cell exchange: %.3f %s per run.", time_cells / runs,
+            clocks_getunit());
+    printf("\n%-12s %12s %14s %12s %12s %12s\n", "# Sub-type", "Messages",
+           "Volume [MB]", "Time [ms]", "Bw [GB/s]", "Latency [us]");
+  }
+  benchmark_print("xv", &b_xv, runs);
+  benchmark_print("rho", &b_rho, runs);
+  benchmark_print("tend_part", &b_tend_part, runs);
+  benchmark_print("gpart", &b_gpart, runs);
+  benchmark_print("multipole", &b_multipole, runs);
+  benchmark_print("tend_gpart", &b_tend_gpart, runs);
+  benchmark_print("spart", &b_spart, runs);
+
+  /* Be clean */
+  free(bytes);
+  free(e.proxies);
+  free(e.proxy_ind);
+  threadpool_clean(&e.threadpool);
+  swift_free("cells_top", s.cells_top);
+  swift_free("multipoles_top", s.multipoles_top);
+
+  MPI_Finalize();
+  return 0;
+}
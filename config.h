@@ -0,0 +1,728 @@
+/* config.h.  Generated from config.h.in by configure.  */
+/* config.h.in.  Generated from configure.ac by autoheader.  */
+
+/* ANARCHY (DU) SPH */
+/* #undef ANARCHY_DU_SPH */
+
+/* ANARCHY (PU) SPH */
+/* #undef ANARCHY_PU_SPH */
+
+/* EAGLE black hole model */
+/* #undef BLACK_HOLES_EAGLE */
+
+/* No black hole model */
+#define BLACK_HOLES_NONE 1
+
+/* Chemistry taken from the EAGLE model */
+/* #undef CHEMISTRY_EAGLE */
+
+/* Chemistry taken from the GEAR model */
+/* #undef CHEMISTRY_GEAR */
+
+/* No chemistry function */
+#define CHEMISTRY_NONE 1
+
+/* Use doubles in grackle */
+/* #undef CONFIG_BFLOAT_8 */
+
+/* Compton cooling off the CMB */
+/* #undef COOLING_COMPTON */
+
+/* Const du/dt cooling function */
+/* #undef COOLING_CONST_DU */
+
+/* Const Lambda cooling function */
+/* #undef COOLING_CONST_LAMBDA */
+
+/* Cooling following the EAGLE model */
+/* #undef COOLING_EAGLE */
+
+/* Cooling via the grackle library */
+/* #undef COOLING_GRACKLE */
+
+/* Grackle chemistry network, mode 3 */
+/* #undef COOLING_GRACKLE_MODE */
+
+/* No cooling function */
+#define COOLING_NONE 1
+
+/* Cubic spline kernel */
+#define CUBIC_SPLINE_KERNEL 1
+
+/* Enable interaction debugging */
+/* #undef DEBUG_INTERACTIONS_SPH */
+
+/* Enable interaction debugging for stars */
+/* #undef DEBUG_INTERACTIONS_STARS */
+
+/* Default gravity scheme */
+#define DEFAULT_GRAVITY 1
+
+/* Default SPH */
+/* #undef DEFAULT_SPH */
+
+/* EAGLE entropy floor */
+/* #undef ENTROPY_FLOOR_EAGLE */
+
+/* No entropy floor */
+#define ENTROPY_FLOOR_NONE 1
+
+/* Ideal gas equation of state */
+#define EOS_IDEAL_GAS 1
+
+/* Isothermal gas equation of state */
+/* #undef EOS_ISOTHERMAL_GAS */
+
+/* All planetary equations of state */
+/* #undef EOS_PLANETARY */
+
+/* Disc-patch external potential */
+/* #undef EXTERNAL_POTENTIAL_DISC_PATCH */
+
+/* Hernquist external potential */
+/* #undef EXTERNAL_POTENTIAL_HERNQUIST */
+
+/* Isothermal external potential */
+/* #undef EXTERNAL_POTENTIAL_ISOTHERMAL */
+
+/* Navarro-Frenk-White external potential */
+/* #undef EXTERNAL_POTENTIAL_NFW */
+
+/* No external potential */
+#define EXTERNAL_POTENTIAL_NONE 1
+
+/* Point-mass external potential */
+/* #undef EXTERNAL_POTENTIAL_POINTMASS */
+
+/* Point mass potential for Keplerian Ring (Hopkins 2015). */
+/* #undef EXTERNAL_POTENTIAL_POINTMASS_RING */
+
+/* Softened point-mass potential with form 1/(r^2 + softening^2). */
+/* #undef EXTERNAL_POTENTIAL_POINTMASS_SOFT */
+
+/* Sine wave external potential in 1D */
+/* #undef EXTERNAL_POTENTIAL_SINE_WAVE */
+
+/* EAGLE stellar feedback and evolution model */
+/* #undef FEEDBACK_EAGLE */
+
+/* No feedback */
+#define FEEDBACK_NONE 1
+
+/* Gadget-2 SPH */
+#define GADGET2_SPH 1
+
+/* GIZMO MFM SPH */
+/* #undef GIZMO_MFM_SPH */
+
+/* GIZMO MFV SPH */
+/* #undef GIZMO_MFV_SPH */
+
+/* Define to 1 to support Advanced Bit Manipulation */
+#define HAVE_ABM 1
+
+/* Define to 1 to support Multi-Precision Add-Carry Instruction Extensions */
+#define HAVE_ADX 1
+
+/* Define to 1 to support Advanced Encryption Standard New Instruction Set
+   (AES-NI) */
+#define HAVE_AES 1
+
+/* Support Altivec instructions */
+/* #undef HAVE_ALTIVEC */
+
+/* Define to 1 if you have the <altivec.h> header file. */
+/* #undef HAVE_ALTIVEC_H */
+
+/* Define if you have enabled the CNTVCT cycle counter on ARMv7a */
+/* #undef HAVE_ARMV7A_CNTVCT */
+
+/* Define if you have enabled the PMCCNTR cycle counter on ARMv7a */
+/* #undef HAVE_ARMV7A_PMCCNTR */
+
+/* Define to 1 if the ARM v8.1a instruction CNTVCT_EL0 exists. */
+/* #undef HAVE_ARMV8_CNTVCT_EL0 */
+
+/* Define to 1 if the ARM v8.1a instruction PMCCNTR_EL0 exists. */
+/* #undef HAVE_ARMV8_PMCCNTR_EL0 */
+
+/* Define to 1 to support Advanced Vector Extensions */
+#define HAVE_AVX 1
+
+/* Define to 1 to support Advanced Vector Extensions 2 */
+#define HAVE_AVX2 1
+
+/* Define to 1 to support AVX-512 Byte and Word Instructions */
+#define HAVE_AVX512_BW 1
+
+/* Define to 1 to support AVX-512 Conflict Detection Instructions */
+#define HAVE_AVX512_CD 1
+
+/* Define to 1 to support AVX-512 Doubleword and Quadword Instructions */
+#define HAVE_AVX512_DQ 1
+
+/* Define to 1 to support AVX-512 Exponential & Reciprocal Instructions */
+/* #undef HAVE_AVX512_ER */
+
+/* Define to 1 to support AVX-512 Foundation Extensions */
+#define HAVE_AVX512_F 1
+
+/* Define to 1 to support AVX-512 Integer Fused Multiply Add Instructions */
+#define HAVE_AVX512_IFMA 1
+
+/* Define to 1 to support AVX-512 Conflict Prefetch Instructions */
+/* #undef HAVE_AVX512_PF */
+
+/* Define to 1 to support AVX-512 Vector Byte Manipulation Instructions */
+#define HAVE_AVX512_VBMI 1
+
+/* Define to 1 to support AVX-512 Vector Length Extensions */
+#define HAVE_AVX512_VL 1
+
+/* Define to 1 to support Bit Manipulation Instruction Set 1 */
+#define HAVE_BMI1 1
+
+/* Define to 1 to support Bit Manipulation Instruction Set 2 */
+#define HAVE_BMI2 1
+
+/* Define to 1 if you have the `clock_gettime' function. */
+#define HAVE_CLOCK_GETTIME 1
+
+/* Define to 1 if you have the <c_asm.h> header file. */
+/* #undef HAVE_C_ASM_H */
+
+/* Define to 1 if you have the <dlfcn.h> header file. */
+#define HAVE_DLFCN_H 1
+
+/* The dummy VELOCIraptor library is present. */
+/* #undef HAVE_DUMMY_VELOCIRAPTOR */
+
+/* The exp10 function is present. */
+#define HAVE_EXP10 1
+
+/* The exp10f function is present. */
+#define HAVE_EXP10F 1
+
+/* Defined if the floating-point exception can be enabled using non-standard
+   GNU functions. */
+#define HAVE_FE_ENABLE_EXCEPT 1
+
+/* The FFTW library appears to be present. */
+/* #undef HAVE_FFTW */
+
+/* Define to 1 to support Fused Multiply-Add Extensions 3 */
+#define HAVE_FMA3 1
+
+/* Define to 1 to support Fused Multiply-Add Extensions 4 */
+/* #undef HAVE_FMA4 */
+
+/* Define to 1 if you have the `gethrtime' function. */
+/* #undef HAVE_GETHRTIME */
+
+/* The GRACKLE library appears to be present. */
+/* #undef HAVE_GRACKLE */
+
+/* Defined if you have HDF5 support */
+#define HAVE_HDF5 1
+
+/* Define to 1 if hrtime_t is defined in <sys/time.h> */
+/* #undef HAVE_HRTIME_T */
+
+/* Define to 1 if you have the <immintrin.h> header file. */
+#define HAVE_IMMINTRIN_H 1
+
+/* Define to 1 if you have the <intrinsics.h> header file. */
+/* #undef HAVE_INTRINSICS_H */
+
+/* Define to 1 if you have the <inttypes.h> header file. */
+#define HAVE_INTTYPES_H 1
+
+/* The jemalloc library appears to be present. */
+/* #undef HAVE_JEMALLOC */
+
+/* The GSL library appears to be present. */
+/* #undef HAVE_LIBGSL */
+
+/* The GSL CBLAS library appears to be present. */
+/* #undef HAVE_LIBGSLCBLAS */
+
+/* Define to 1 if you have the `m' library (-lm). */
+#define HAVE_LIBM 1
+
+/* The NUMA library appears to be present. */
+#define HAVE_LIBNUMA 1
+
+/* Define to 1 if you have the `mach_absolute_time' function. */
+/* #undef HAVE_MACH_ABSOLUTE_TIME */
+
+/* Define to 1 if you have the <mach/mach_time.h> header file. */
+/* #undef HAVE_MACH_MACH_TIME_H */
+
+/* Define to 1 if you have the <malloc.h> header file. */
+#define HAVE_MALLOC_H 1
+
+/* Define to 1 if you have the `malloc_usable_size' function. */
+#define HAVE_MALLOC_USABLE_SIZE 1
+
+/* The METIS library is present. */
+/* #undef HAVE_METIS */
+
+/* Define to 1 if you have the <minix/config.h> header file. */
+/* #undef HAVE_MINIX_CONFIG_H */
+
+/* Define to 1 to support Multimedia Extensions */
+#define HAVE_MMX 1
+
+/* Define if you have the MPI library. */
+#define HAVE_MPI 1
+
+/* The MPI FFTW library appears to be present. */
+/* #undef HAVE_MPI_FFTW */
+
+/* Define to 1 to support Memory Protection Extensions */
+/* #undef HAVE_MPX */
+
+/* HDF5 library supports parallel access */
+/* #undef HAVE_PARALLEL_HDF5 */
+
+/* The ParMETIS library is present. */
+/* #undef HAVE_PARMETIS */
+
+/* The posix library implements file allocation functions. */
+#define HAVE_POSIX_FALLOCATE 1
+
+/* Define to 1 if `posix_memalign' works. */
+#define HAVE_POSIX_MEMALIGN 1
+
+/* Define to 1 to support Prefetch Vector Data Into Caches WT1 */
+/* #undef HAVE_PREFETCHWT1 */
+
+/* The posix library implements barriers */
+#define HAVE_PTHREAD_BARRIERS 1
+
+/* Have PTHREAD_PRIO_INHERIT. */
+#define HAVE_PTHREAD_PRIO_INHERIT 1
+
+/* Define to 1 to support Digital Random Number Generator */
+#define HAVE_RDRND 1
+
+/* Define to 1 if you have the `read_real_time' function. */
+/* #undef HAVE_READ_REAL_TIME */
+
+/* Defined if pthread_setaffinity_np exists. */
+#define HAVE_SETAFFINITY 1
+
+/* Define to 1 to support Secure Hash Algorithm Extension */
+#define HAVE_SHA 1
+
+/* Defined if the POSIX shared memory functions exist. */
+#define HAVE_SHM_OPEN 1
+
+/* Define to 1 to support Streaming SIMD Extensions */
+#define HAVE_SSE 1
+
+/* Define to 1 to support Streaming SIMD Extensions */
+#define HAVE_SSE2 1
+
+/* Define to 1 to support Streaming SIMD Extensions 3 */
+#define HAVE_SSE3 1
+
+/* Define to 1 to support Streaming SIMD Extensions 4.1 */
+#define HAVE_SSE4_1 1
+
+/* Define to 1 to support Streaming SIMD Extensions 4.2 */
+#define HAVE_SSE4_2 1
+
+/* Define to 1 to support AMD Streaming SIMD Extensions 4a */
+/* #undef HAVE_SSE4a */
+
+/* Define to 1 to support Supplemental Streaming SIMD Extensions 3 */
+#define HAVE_SSSE3 1
+
+/* Define to 1 if you have the <stdint.h> header file. */
+#define HAVE_STDINT_H 1
+
+/* Define to 1 if you have the <stdio.h> header file. */
+#define HAVE_STDIO_H 1
+
+/* Define to 1 if you have the <stdlib.h> header file. */
+#define HAVE_STDLIB_H 1
+
+/* Define to 1 if you have the <strings.h> header file. */
+#define HAVE_STRINGS_H 1
+
+/* Define to 1 if you have the <string.h> header file. */
+#define HAVE_STRING_H 1
+
+/* Define to 1 if you have the <sys/stat.h> header file. */
+#define HAVE_SYS_STAT_H 1
+
+/* Define to 1 if you have the <sys/time.h> header file. */
+#define HAVE_SYS_TIME_H 1
+
+/* Define to 1 if you have the <sys/types.h> header file. */
+#define HAVE_SYS_TYPES_H 1
+
+/* The TBBmalloc library appears to be present. */
+/* #undef HAVE_TBBMALLOC */
+
+/* The tcmalloc library appears to be present. */
+/* #undef HAVE_TCMALLOC */
+
+/* The threaded FFTW library appears to be present. */
+/* #undef HAVE_THREADED_FFTW */
+
+/* Define to 1 if you have the `time_base_to_time' function. */
+/* #undef HAVE_TIME_BASE_TO_TIME */
+
+/* Define to 1 if you have the <unistd.h> header file. */
+#define HAVE_UNISTD_H 1
+
+/* The VELOCIraptor library appears to be present. */
+/* #undef HAVE_VELOCIRAPTOR */
+
+/* The VELOCIraptor library can read the particles on demand. */
+/* #undef HAVE_VELOCIRAPTOR_STREAMED */
+
+/* Support VSX instructions */
+/* #undef HAVE_VSX */
+
+/* Define to 1 if you have the <wchar.h> header file. */
+#define HAVE_WCHAR_H 1
+
+/* Define to 1 to support eXtended Operations Extensions */
+/* #undef HAVE_XOP */
+
+/* Define if you have the UNICOS _rtc() intrinsic. */
+/* #undef HAVE__RTC */
+
+/* The __exp10 function is present. */
+/* #undef HAVE___EXP10 */
+
+/* The __exp10f function is present. */
+/* #undef HAVE___EXP10F */
+
+/* Pressure-Entropy SPH */
+/* #undef HOPKINS_PE_SPH */
+
+/* Pressure-Energy SPH */
+/* #undef HOPKINS_PU_SPH */
+
+/* Pressure-Energy SPH with M&M Variable A.V. */
+/* #undef HOPKINS_PU_SPH_MONAGHAN */
+
+/* 1D solver */
+/* #undef HYDRO_DIMENSION_1D */
+
+/* 2D solver */
+/* #undef HYDRO_DIMENSION_2D */
+
+/* 3D solver */
+#define HYDRO_DIMENSION_3D 3
+
+/* Collect the gradient quantities in the density loop */
+/* #undef HYDRO_FUSED_GRADIENT_LOOP */
+
+/* Adiabatic index is 2 */
+/* #undef HYDRO_GAMMA_2_1 */
+
+/* Adiabatic index is 4/3 */
+/* #undef HYDRO_GAMMA_4_3 */
+
+/* Adiabatic index is 5/3 */
+#define HYDRO_GAMMA_5_3 5./3.
+
+/* Adiabatic index is 7/5 */
+/* #undef HYDRO_GAMMA_7_5 */
+
+/* Interpolate the SPH kernel from a table */
+/* #undef KERNEL_TABULATED */
+
+/* Define to the sub-directory where libtool stores uninstalled libraries. */
+#define LT_OBJDIR ".libs/"
+
+/* The maximum number of particle neighbours to be logged */
+/* #undef MAX_NUM_OF_NEIGHBOURS */
+
+/* The maximum number of particle neighbours to be logged for stars */
+/* #undef MAX_NUM_OF_NEIGHBOURS_STARS */
+
+/* Use single precision for the gravity mesh. */
+/* #undef MESH_SINGLE_PRECISION */
+
+/* Minimal SPH */
+/* #undef MINIMAL_SPH */
+
+/* Name of package */
+#define PACKAGE "swift"
+
+/* Define to the address where bug reports for this package should be sent. */
+#define PACKAGE_BUGREPORT "https://gitlab.cosma.dur.ac.uk/swift/swiftsim"
+
+/* Define to the full name of this package. */
+#define PACKAGE_NAME "SWIFT"
+
+/* Define to the full name and version of this package. */
+#define PACKAGE_STRING "SWIFT 0.8.2"
+
+/* Define to the one symbol short name of this package. */
+#define PACKAGE_TARNAME "swift"
+
+/* Package web pages */
+#define PACKAGE_URL "www.swiftsim.com"
+
+/* Define to the version of this package. */
+#define PACKAGE_VERSION "0.8.2"
+
+/* Planetary SPH */
+/* #undef PLANETARY_SPH */
+
+/* Gravity scheme with potential calculation */
+/* #undef POTENTIAL_GRAVITY */
+
+/* Define to necessary symbol if this constant uses a non-standard name on
+   your system. */
+/* #undef PTHREAD_CREATE_JOINABLE */
+
+/* Quartic spline kernel */
+/* #undef QUARTIC_SPLINE_KERNEL */
+
+/* Quintic spline kernel */
+/* #undef QUINTIC_SPLINE_KERNEL */
+
+/* Exact Riemann solver */
+/* #undef RIEMANN_SOLVER_EXACT */
+
+/* Harten-Lax-van Leer-Contact Riemann solver */
+/* #undef RIEMANN_SOLVER_HLLC */
+
+/* No Riemann solver */
+#define RIEMANN_SOLVER_NONE 1
+
+/* Two Rarefaction Riemann Solver */
+/* #undef RIEMANN_SOLVER_TRRS */
+
+/* Multipole order */
+#define SELF_GRAVITY_MULTIPOLE_ORDER 4
+
+/* Shadowfax SPH */
+/* #undef SHADOWFAX_SPH */
+
+/* EAGLE stellar model */
+/* #undef STARS_EAGLE */
+
+/* GEAR stellar model */
+/* #undef STARS_GEAR */
+
+/* Basic stellar model */
+#define STARS_NONE 1
+
+/* EAGLE star formation model (Schaye and Dalla Vecchia (2008)) */
+/* #undef STAR_FORMATION_EAGLE */
+
+/* GEAR star formation model (Revaz and Jablonka (2018)) */
+/* #undef STAR_FORMATION_GEAR */
+
+/* No star formation */
+#define STAR_FORMATION_NONE 1
+
+/* Define to 1 if all of the C90 standard headers exist (not just the ones
+   required in a freestanding environment). This macro is provided for
+   backward compatibility; new code need not use it. */
+#define STDC_HEADERS 1
+
+/* Enable cell graph */
+/* #undef SWIFT_CELL_GRAPH */
+
+/* Flags passed to configure */
+#define SWIFT_CONFIG_FLAGS "--disable-vec --disable-hand-vec --disable-compiler-warnings --no-create --no-recursion"
+
+/* Enable expensive debugging */
+/* #undef SWIFT_DEBUG_CHECKS */
+
+/* Enable task debugging */
+/* #undef SWIFT_DEBUG_TASKS */
+
+/* Enable threadpool debugging */
+/* #undef SWIFT_DEBUG_THREADPOOL */
+
+/* Enable developer code options */
+/* #undef SWIFT_DEVELOP_MODE */
+
+/* Enable gravity brute-force checks */
+/* #undef SWIFT_GRAVITY_FORCE_CHECKS */
+
+/* Make the code run in a way to produce a glass file for gravity/cosmology */
+/* #undef SWIFT_MAKE_GRAVITY_GLASS */
+
+/* Enable memory usage reports */
+/* #undef SWIFT_MEMUSE_REPORTS */
+
+/* The MPI library name, if known. */
+#define SWIFT_MPI_LIBRARY "Open MPI"
+
+/* Particles with smaller ID than this will have zero gravity forces */
+/* #undef SWIFT_NO_GRAVITY_BELOW_ID */
+
+/* Sample performance counters around the tasks */
+/* #undef SWIFT_TASK_COUNTERS */
+
+/* Enable use of naive cell interaction functions */
+/* #undef SWIFT_USE_NAIVE_INTERACTIONS */
+
+/* Enable use of naive cell interaction functions for stars */
+/* #undef SWIFT_USE_NAIVE_INTERACTIONS_STARS */
+
+/* Enable individual timers */
+/* #undef SWIFT_USE_TIMERS */
+
+/* Define to 1 if you can safely include both <sys/time.h> and <time.h>. This
+   macro is obsolete. */
+#define TIME_WITH_SYS_TIME 1
+
+/* Tracers taken from the EAGLE model */
+/* #undef TRACERS_EAGLE */
+
+/* No tracers function */
+#define TRACERS_NONE 1
+
+/* Enable extensions on AIX 3, Interix.  */
+#ifndef _ALL_SOURCE
+# define _ALL_SOURCE 1
+#endif
+/* Enable general extensions on macOS.  */
+#ifndef _DARWIN_C_SOURCE
+# define _DARWIN_C_SOURCE 1
+#endif
+/* Enable general extensions on Solaris.  */
+#ifndef __EXTENSIONS__
+# define __EXTENSIONS__ 1
+#endif
+/* Enable GNU extensions on systems that have them.  */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+/* Enable X/Open compliant socket functions that do not require linking
+   with -lxnet on HP-UX 11.11.  */
+#ifndef _HPUX_ALT_XOPEN_SOCKET_API
+# define _HPUX_ALT_XOPEN_SOCKET_API 1
+#endif
+/* Identify the host operating system as Minix.
+   This macro does not affect the system headers' behavior.
+   A future release of Autoconf may stop defining this macro.  */
+#ifndef _MINIX
+/* # undef _MINIX */
+#endif
+/* Enable general extensions on NetBSD.
+   Enable NetBSD compatibility extensions on Minix.  */
+#ifndef _NETBSD_SOURCE
+# define _NETBSD_SOURCE 1
+#endif
+/* Enable OpenBSD compatibility extensions on NetBSD.
+   Oddly enough, this does nothing on OpenBSD.  */
+#ifndef _OPENBSD_SOURCE
+# define _OPENBSD_SOURCE 1
+#endif
+/* Define to 1 if needed for POSIX-compatible behavior.  */
+#ifndef _POSIX_SOURCE
+/* # undef _POSIX_SOURCE */
+#endif
+/* Define to 2 if needed for POSIX-compatible behavior.  */
+#ifndef _POSIX_1_SOURCE
+/* # undef _POSIX_1_SOURCE */
+#endif
+/* Enable POSIX-compatible threading on Solaris.  */
+#ifndef _POSIX_PTHREAD_SEMANTICS
+# define _POSIX_PTHREAD_SEMANTICS 1
+#endif
+/* Enable extensions specified by ISO/IEC TS 18661-5:2014.  */
+#ifndef __STDC_WANT_IEC_60559_ATTRIBS_EXT__
+# define __STDC_WANT_IEC_60559_ATTRIBS_EXT__ 1
+#endif
+/* Enable extensions specified by ISO/IEC TS 18661-1:2014.  */
+#ifndef __STDC_WANT_IEC_60559_BFP_EXT__
+# define __STDC_WANT_IEC_60559_BFP_EXT__ 1
+#endif
+/* Enable extensions specified by ISO/IEC TS 18661-2:2015.  */
+#ifndef __STDC_WANT_IEC_60559_DFP_EXT__
+# define __STDC_WANT_IEC_60559_DFP_EXT__ 1
+#endif
+/* Enable extensions specified by ISO/IEC TS 18661-4:2015.  */
+#ifndef __STDC_WANT_IEC_60559_FUNCS_EXT__
+# define __STDC_WANT_IEC_60559_FUNCS_EXT__ 1
+#endif
+/* Enable extensions specified by ISO/IEC TS 18661-3:2015.  */
+#ifndef __STDC_WANT_IEC_60559_TYPES_EXT__
+# define __STDC_WANT_IEC_60559_TYPES_EXT__ 1
+#endif
+/* Enable extensions specified by ISO/IEC TR 24731-2:2010.  */
+#ifndef __STDC_WANT_LIB_EXT2__
+# define __STDC_WANT_LIB_EXT2__ 1
+#endif
+/* Enable extensions specified by ISO/IEC 24747:2009.  */
+#ifndef __STDC_WANT_MATH_SPEC_FUNCS__
+# define __STDC_WANT_MATH_SPEC_FUNCS__ 1
+#endif
+/* Enable extensions on HP NonStop.  */
+#ifndef _TANDEM_SOURCE
+# define _TANDEM_SOURCE 1
+#endif
+/* Enable X/Open extensions.  Define to 500 only if necessary
+   to make mbstate_t available.  */
+#ifndef _XOPEN_SOURCE
+/* # undef _XOPEN_SOURCE */
+#endif
+
+
+/* Version number of package */
+#define VERSION "0.8.2"
+
+/* Wendland-C2 kernel */
+/* #undef WENDLAND_C2_KERNEL */
+
+/* Wendland-C4 kernel */
+/* #undef WENDLAND_C4_KERNEL */
+
+/* Wendland-C6 kernel */
+/* #undef WENDLAND_C6_KERNEL */
+
+/* Enable custom icbrtf */
+/* #undef WITH_ICBRTF */
+
+/* logger enabled */
+/* #undef WITH_LOGGER */
+
+/* Link against the gperftools profiling library. */
+/* #undef WITH_PROFILER */
+
+/* Enable hand-written vectorization */
+/* #undef WITH_VECTORIZATION */
+
+/* Hack for min() and max() using g++ 6+ */
+#define _GLIBCXX_INCLUDE_NEXT_C_HEADERS 1
+
+/* Needed to get PRIxxx macros from stdint.h when not using C99 */
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS 1
+#endif
+
+/* Define to `__inline__' or `__inline' if that's what the C compiler
+   calls it, or to nothing if 'inline' is not supported under any name.  */
+#ifndef __cplusplus
+/* #undef inline */
+#endif
+
+/* Define to the equivalent of the C99 'restrict' keyword, or to
+   nothing if this is not supported.  Do not define if restrict is
+   supported only directly.  */
+#define restrict __restrict__
+/* Work around a bug in older versions of Sun C++, which did not
+   #define __restrict__ or support _Restrict or __restrict__
+   even though the corresponding Sun C compiler ended up with
+   "#define restrict _Restrict" or "#define restrict __restrict__"
+   in the previous line.  This workaround can be removed once
+   we assume Oracle Developer Studio 12.5 (2016) or later.  */
+#if defined __SUNPRO_CC && !defined __RESTRICT && !defined __restrict__
+# define _Restrict
+# define __restrict__
+#endif
@@ -100,6 +100,7 @@ int main(int argc, char *argv[]) {
   struct entropy_floor_properties entropy_floor;
   struct black_holes_props black_holes_properties;
   struct fof_props fof_properties;
+  struct lightcone_props lightcone_properties;
   struct part *parts = NULL;
   struct phys_const prog_const;
   struct space s;
@@ -149,6 +150,7 @@ int main(int argc, char *argv[]) {
   int dry_run = 0;
   int dump_tasks = 0;
   int dump_threadpool = 0;
+  int threadpool_stats = 0;
   int nsteps = -2;
   int restart = 0;
   int with_cosmology = 0;
@@ -171,6 +173,7 @@ int main(int argc, char *argv[]) {
   int nr_threads = 1;
   int with_verbose_timers = 0;
   char *output_parameters_filename = NULL;
+  char *phase_summary_filename = NULL;
   char *cpufreqarg = NULL;
   char *param_filename = NULL;
   char restart_file[200] = "";
@@ -243,6 +246,10 @@ int main(int argc, char *argv[]) {
                   NULL, 0, 0),
       OPT_STRING('o', "output-params", &output_parameters_filename,
                  "Generate a default output parameter file.", NULL, 0, 0),
+      OPT_STRING(0, "phase-summary", &phase_summary_filename,
+                 "Append the time spent in the rebuilds, tasks, communications "
+                 "and i/o of the run to this file.",
+                 NULL, 0, 0),
       OPT_STRING('P', "param", &buffer,
                  "Set parameter value, overiding the value read from the "
                  "parameter file. Can be used more than once {sec:par:value}.",
@@ -264,6 +271,10 @@ int main(int argc, char *argv[]) {
       OPT_INTEGER('Y', "threadpool-dumps", &dump_threadpool,
                   "Time-step frequency at which threadpool tasks are dumped.",
                   NULL, 0, 0),
+      OPT_INTEGER(0, "threadpool-stats", &threadpool_stats,
+                  "Time-step frequency at which the statistics of the "
+                  "threadpool mappers are written.",
+                  NULL, 0, 0),
       OPT_END(),
   };
   struct argparse argparse;
@@ -591,6 +602,7 @@ int main(int argc, char *argv[]) {
 
   /* Common variables for restart and IC sections. */
   int clean_smoothing_length_values = 0;
+  int fast_start = 0;
   int flag_entropy_ICs = 0;
 
   /* Work out where we will read and write restart files. */
@@ -630,6 +642,13 @@ int main(int argc, char *argv[]) {
   const int resubmit_after_max_hours =
       parser_get_opt_param_int(params, "Restarts:resubmit_on_exit", 0);
 
+  /* Map the particle arrays of the restart files rather than reading them? */
+  const int restart_map = parser_get_opt_param_int(params, "Restarts:mmap", 0);
+
+  /* Back the particle and cell arrays with huge pages? */
+  memuse_huge_pages =
+      parser_get_opt_param_int(params, "Scheduler:huge_pages", 0);
+
   /* What command should we run to resubmit at the end? */
   char resubmit_command[PARSER_MAX_LINE_SIZE];
   if (resubmit_after_max_hours)
@@ -643,6 +662,13 @@ int main(int argc, char *argv[]) {
     char **restart_files = NULL;
     int restart_nfiles = 0;
 
+#ifdef WITH_MPI
+    /* Can we restart on a different number of ranks than the one that wrote
+     * the restart files? */
+    const int restart_remap_ranks =
+        parser_get_opt_param_int(params, "Restarts:remap_ranks", 0);
+#endif
+
     if (myrank == 0) {
       message("Restarting SWIFT");
 
@@ -652,8 +678,12 @@ int main(int argc, char *argv[]) {
       if (restart_nfiles == 0)
         error("Failed to locate any restart files in %s", restart_dir);
 
-      /* We need one file per rank. */
+      /* We need one file per rank, unless we are allowed to remap. */
+#ifdef WITH_MPI
+      if (restart_nfiles != nr_nodes && !restart_remap_ranks)
+#else
       if (restart_nfiles != nr_nodes)
+#endif
         error("Incorrect number of restart files, expected %d found %d",
               nr_nodes, restart_nfiles);
 
@@ -663,16 +693,40 @@ int main(int argc, char *argv[]) {
     }
 
 #ifdef WITH_MPI
-    /* Distribute the restart files, need one for each rank. */
+    /* Distribute the restart files, need one for each rank. When remapping,
+     * rank i also takes over the particles of the files i + nr_nodes,
+     * i + 2 * nr_nodes, ... and the ranks without a file of their own read
+     * the engine of another one without keeping its particles. */
+    MPI_Bcast(&restart_nfiles, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    int restart_nextra = 0;
+    for (int j = myrank + nr_nodes; j < restart_nfiles; j += nr_nodes)
+      restart_nextra++;
+    char **restart_extra = NULL;
+    if (restart_nextra > 0) {
+      restart_extra = (char **)malloc(restart_nextra * sizeof(char *));
+      if (restart_extra == NULL) error("Failed to allocate restart file list");
+      for (int k = 0; k < restart_nextra; k++) {
+        restart_extra[k] = (char *)malloc(200);
+        if (restart_extra[k] == NULL)
+          error("Failed to allocate restart file name");
+      }
+    }
+
     if (myrank == 0) {
 
       for (int i = 1; i < nr_nodes; i++) {
-        strcpy(restart_file, restart_files[i]);
+        strcpy(restart_file, restart_files[i % restart_nfiles]);
         MPI_Send(restart_file, 200, MPI_BYTE, i, 0, MPI_COMM_WORLD);
+        for (int j = i + nr_nodes; j < restart_nfiles; j += nr_nodes) {
+          strcpy(restart_file, restart_files[j]);
+          MPI_Send(restart_file, 200, MPI_BYTE, i, 0, MPI_COMM_WORLD);
+        }
       }
 
-      /* Keep local file. */
+      /* Keep local files. */
       strcpy(restart_file, restart_files[0]);
+      for (int k = 0; k < restart_nextra; k++)
+        strcpy(restart_extra[k], restart_files[(k + 1) * nr_nodes]);
 
       /* Finished with the list. */
       restart_locate_free(restart_nfiles, restart_files);
@@ -680,6 +734,9 @@ int main(int argc, char *argv[]) {
     } else {
       MPI_Recv(restart_file, 200, MPI_BYTE, 0, 0, MPI_COMM_WORLD,
                MPI_STATUS_IGNORE);
+      for (int k = 0; k < restart_nextra; k++)
+        MPI_Recv(restart_extra[k], 200, MPI_BYTE, 0, 0, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
     }
     if (verbose > 1) message("local restart file = %s", restart_file);
 #else
@@ -689,7 +746,20 @@ int main(int argc, char *argv[]) {
 #endif
 
     /* Now read it. */
-    restart_read(&e, restart_file);
+    restart_read(&e, restart_file, restart_map);
+
+#ifdef WITH_MPI
+    /* Gather our particles from the files of the previous ranks. */
+    if (restart_nfiles != nr_nodes) {
+      if (myrank == 0)
+        message("Remapping %d restart files onto %d ranks", restart_nfiles,
+                nr_nodes);
+      restart_remap(&e, /*keep=*/myrank < restart_nfiles, restart_extra,
+                    restart_nextra);
+    }
+    for (int k = 0; k < restart_nextra; k++) free(restart_extra[k]);
+    free(restart_extra);
+#endif
 
     /* And initialize the engine with the space and policies. */
     if (myrank == 0) clocks_gettime(&tic);
@@ -723,13 +793,19 @@ int main(int argc, char *argv[]) {
 
     /* Read particles and space information from ICs */
     char ICfileName[200] = "";
-    parser_get_param_string(params, "InitialConditions:file_name", ICfileName);
+    const int generate_ics =
+        parser_get_opt_param_int(params, "InitialConditions:generate_ics", 0);
+    if (!generate_ics)
+      parser_get_param_string(params, "InitialConditions:file_name",
+                              ICfileName);
     const int periodic =
         parser_get_param_int(params, "InitialConditions:periodic");
     const int replicate =
         parser_get_opt_param_int(params, "InitialConditions:replicate", 1);
     clean_smoothing_length_values = parser_get_opt_param_int(
         params, "InitialConditions:cleanup_smoothing_lengths", 0);
+    fast_start =
+        parser_get_opt_param_int(params, "InitialConditions:fast_start", 0);
     const int cleanup_h = parser_get_opt_param_int(
         params, "InitialConditions:cleanup_h_factors", 0);
     const int cleanup_sqrt_a = parser_get_opt_param_int(
@@ -742,6 +818,10 @@ int main(int argc, char *argv[]) {
       error("Can't generate gas if the entropy flag is set in the ICs.");
     if (generate_gas_in_ics && !with_cosmology)
       error("Can't generate gas if the run is not cosmological.");
+    if (generate_ics && !with_cosmology)
+      error("Can't generate the ICs if the run is not cosmological.");
+    if (generate_ics && !with_self_gravity)
+      error("Can't generate the ICs if the run has no self-gravity.");
 
     /* Initialise the cosmology */
     if (with_cosmology)
@@ -843,8 +923,14 @@ int main(int argc, char *argv[]) {
     bzero(&fof_properties, sizeof(struct fof_props));
     if (with_fof) fof_init(&fof_properties, params, &prog_const, &us);
 
+    /* Initialise the IC generator */
+    struct ic_generator ic_generator;
+    if (generate_ics) ic_generator_init(&ic_generator, params, &prog_const);
+
     /* Be verbose about what happens next */
-    if (myrank == 0) message("Reading ICs from file '%s'", ICfileName);
+    if (myrank == 0 && generate_ics) ic_generator_print(&ic_generator);
+    if (myrank == 0 && !generate_ics)
+      message("Reading ICs from file '%s'", ICfileName);
     if (myrank == 0 && cleanup_h)
       message("Cleaning up h-factors (h=%f)", cosmo.h);
     if (myrank == 0 && cleanup_sqrt_a)
@@ -855,34 +941,43 @@ int main(int argc, char *argv[]) {
     size_t Ngas = 0, Ngpart = 0, Nspart = 0, Nbpart = 0;
     double dim[3] = {0., 0., 0.};
     if (myrank == 0) clocks_gettime(&tic);
+    if (generate_ics) {
+      ic_generator_generate(&ic_generator, &cosmo, dim, &gparts, &Ngpart,
+                            nr_threads, talking, dry_run);
+    } else {
 #if defined(HAVE_HDF5)
 #if defined(WITH_MPI)
+      /* Replicated ICs can't be read by the cells of their meta-data */
+      struct partition* ic_partition =
+          (replicate == 1) ? &initial_partition : NULL;
 #if defined(HAVE_PARALLEL_HDF5)
-    read_ic_parallel(ICfileName, &us, dim, &parts, &gparts, &sparts, &bparts,
+      read_ic_parallel(ICfileName, &us, dim, &parts, &gparts, &sparts, &bparts,
+                       &Ngas, &Ngpart, &Nspart, &Nbpart, &flag_entropy_ICs,
+                       with_hydro, (with_external_gravity || with_self_gravity),
+                       with_stars, with_black_holes, cleanup_h, cleanup_sqrt_a,
+                       cosmo.h, cosmo.a, ic_partition, myrank, nr_nodes,
+                       MPI_COMM_WORLD, MPI_INFO_NULL, nr_threads, dry_run);
+#else
+      read_ic_serial(ICfileName, &us, dim, &parts, &gparts, &sparts, &bparts,
                      &Ngas, &Ngpart, &Nspart, &Nbpart, &flag_entropy_ICs,
                      with_hydro, (with_external_gravity || with_self_gravity),
                      with_stars, with_black_holes, cleanup_h, cleanup_sqrt_a,
-                     cosmo.h, cosmo.a, myrank, nr_nodes, MPI_COMM_WORLD,
-                     MPI_INFO_NULL, nr_threads, dry_run);
-#else
-    read_ic_serial(ICfileName, &us, dim, &parts, &gparts, &sparts, &bparts,
-                   &Ngas, &Ngpart, &Nspart, &Nbpart, &flag_entropy_ICs,
-                   with_hydro, (with_external_gravity || with_self_gravity),
-                   with_stars, with_black_holes, cleanup_h, cleanup_sqrt_a,
-                   cosmo.h, cosmo.a, myrank, nr_nodes, MPI_COMM_WORLD,
-                   MPI_INFO_NULL, nr_threads, dry_run);
+                     cosmo.h, cosmo.a, ic_partition, myrank, nr_nodes,
+                     MPI_COMM_WORLD, MPI_INFO_NULL, nr_threads, dry_run);
 #endif
 #else
-    read_ic_single(ICfileName, &us, dim, &parts, &gparts, &sparts, &bparts,
-                   &Ngas, &Ngpart, &Nspart, &Nbpart, &flag_entropy_ICs,
-                   with_hydro, (with_external_gravity || with_self_gravity),
-                   with_stars, with_black_holes, cleanup_h, cleanup_sqrt_a,
-                   cosmo.h, cosmo.a, nr_threads, dry_run);
+      read_ic_single(ICfileName, &us, dim, &parts, &gparts, &sparts, &bparts,
+                     &Ngas, &Ngpart, &Nspart, &Nbpart, &flag_entropy_ICs,
+                     with_hydro, (with_external_gravity || with_self_gravity),
+                     with_stars, with_black_holes, cleanup_h, cleanup_sqrt_a,
+                     cosmo.h, cosmo.a, nr_threads, dry_run);
 #endif
 #endif
+    }
     if (myrank == 0) {
       clocks_gettime(&toc);
-      message("Reading initial conditions took %.3f %s.",
+      message("%s initial conditions took %.3f %s.",
+              generate_ics ? "Generating" : "Reading",
               clocks_diff(&tic, &toc), clocks_getunit());
       fflush(stdout);
     }
@@ -950,6 +1045,10 @@ int main(int argc, char *argv[]) {
       potential_init(params, &prog_const, &us, &s, &potential);
     if (myrank == 0) potential_print(&potential);
 
+    /* Initialise the lightcone built during the drifts */
+    lightcone_init(&lightcone_properties, params, &prog_const, s.dim,
+                   s.periodic, myrank);
+
     /* Initialise the long-range gravity mesh */
     if (with_self_gravity && periodic) {
 #ifdef HAVE_FFTW
@@ -1052,7 +1151,8 @@ int main(int argc, char *argv[]) {
                 &hydro_properties, &entropy_floor, &gravity_properties,
                 &stars_properties, &black_holes_properties,
                 &feedback_properties, &mesh, &potential, &cooling_func,
-                &starform, &chemistry, &fof_properties);
+                &starform, &chemistry, &fof_properties,
+                &lightcone_properties);
     engine_config(/*restart=*/0, /*fof=*/0, &e, params, nr_nodes, myrank,
                   nr_threads, with_aff, talking, restart_file);
 
@@ -1095,7 +1195,8 @@ int main(int argc, char *argv[]) {
 
 /* Initialise the table of Ewald corrections for the gravity checks */
 #ifdef SWIFT_GRAVITY_FORCE_CHECKS
-  if (s.periodic) gravity_exact_force_ewald_init(e.s->dim[0]);
+  if (s.periodic)
+    gravity_exact_force_ewald_init(e.s->dim[0], &e.threadpool, /*use_file=*/1);
 #endif
 
 /* Init the runner history. */
@@ -1107,12 +1208,12 @@ int main(int argc, char *argv[]) {
 
 #ifdef WITH_MPI
     /* Split the space. */
-    engine_split(&e, &initial_partition);
-    engine_redistribute(&e);
+    if (engine_split(&e, &initial_partition)) engine_redistribute(&e);
 #endif
 
     /* Initialise the particles */
-    engine_init_particles(&e, flag_entropy_ICs, clean_smoothing_length_values);
+    engine_init_particles(&e, flag_entropy_ICs, clean_smoothing_length_values,
+                          fast_start);
 
     /* Write the state of the system before starting time integration. */
 #ifdef WITH_LOGGER
@@ -1166,6 +1267,8 @@ int main(int argc, char *argv[]) {
   /* Main simulation loop */
   /* ==================== */
   int force_stop = 0, resubmit = 0;
+  const int step_start = e.step;
+  if (threadpool_stats) threadpool_collect_stats(&e.threadpool, 1);
   for (int j = 0; !engine_is_done(&e) && e.step - 1 != nsteps && !force_stop;
        j++) {
 
@@ -1201,13 +1304,26 @@ int main(int argc, char *argv[]) {
     /* Dump the task data using the given frequency. */
     if (dump_tasks && (dump_tasks == 1 || j % dump_tasks == 1)) {
 #ifdef SWIFT_DEBUG_TASKS
-      task_dump_all(&e, j + 1);
+      if (e.task_dumps_binary)
+        task_dump_binary(&e, j + 1);
+      else
+        task_dump_all(&e, j + 1);
 #endif
 
       /* Generate the task statistics. */
       char dumpfile[40];
       snprintf(dumpfile, 40, "thread_stats-step%d.dat", j + 1);
       task_dump_stats(dumpfile, &e, /* header = */ 0, /* allranks = */ 1);
+
+#ifdef SWIFT_TASK_COUNTERS
+      /* And the performance counters of this rank. */
+#ifdef WITH_MPI
+      snprintf(dumpfile, 40, "task_counters-rank%d-step%d.dat", myrank, j + 1);
+#else
+      snprintf(dumpfile, 40, "task_counters-step%d.dat", j + 1);
+#endif
+      task_dump_counters(dumpfile, &e);
+#endif
     }
 
       /* Dump memory use report if collected. */
@@ -1239,6 +1355,19 @@ int main(int argc, char *argv[]) {
       threadpool_reset_log(&e.threadpool);
     }
 #endif  // SWIFT_DEBUG_THREADPOOL
+
+    /* Write the statistics of the mappers using the given frequency. */
+    if (threadpool_stats && (j + 1) % threadpool_stats == 0) {
+      char dumpfile[PARSER_MAX_LINE_SIZE];
+#ifdef WITH_MPI
+      snprintf(dumpfile, PARSER_MAX_LINE_SIZE,
+               "threadpool_stats-rank%d-step%d.dat", engine_rank, j + 1);
+#else
+      snprintf(dumpfile, PARSER_MAX_LINE_SIZE, "threadpool_stats-step%d.dat",
+               j + 1);
+#endif  // WITH_MPI
+      threadpool_dump_stats(&e.threadpool, dumpfile, 1);
+    }
   }
 
 /* Print the values of the runner histogram. */
@@ -1252,6 +1381,10 @@ int main(int argc, char *argv[]) {
            (double)runner_hist_bins[k]);
 #endif
 
+  /* Summarise where the time of the steps went? */
+  if (phase_summary_filename != NULL)
+    engine_write_phase_summary(&e, phase_summary_filename, e.step - step_start);
+
   /* Write final time information */
   if (myrank == 0) {
 
@@ -91,6 +91,7 @@ int main(int argc, char *argv[]) {
   struct gpart *gparts = NULL;
   struct gravity_props gravity_properties;
   struct fof_props fof_properties;
+  struct lightcone_props lightcone_properties;
   struct part *parts = NULL;
   struct phys_const prog_const;
   struct space s;
@@ -417,6 +418,9 @@ int main(int argc, char *argv[]) {
   bzero(&fof_properties, sizeof(struct fof_props));
   if (with_fof) fof_init(&fof_properties, params, &prog_const, &us);
 
+  /* No particle is drifted, hence no lightcone */
+  bzero(&lightcone_properties, sizeof(struct lightcone_props));
+
   /* Be verbose about what happens next */
   if (myrank == 0) message("Reading ICs from file '%s'", ICfileName);
   if (myrank == 0 && cleanup_h)
@@ -432,19 +436,22 @@ int main(int argc, char *argv[]) {
   if (myrank == 0) clocks_gettime(&tic);
 #if defined(HAVE_HDF5)
 #if defined(WITH_MPI)
+  /* Replicated ICs can't be read by the cells of their meta-data */
+  struct partition* ic_partition = (replicate == 1) ? &initial_partition : NULL;
 #if defined(HAVE_PARALLEL_HDF5)
   read_ic_parallel(ICfileName, &us, dim, &parts, &gparts, &sparts, &bparts,
                    &Ngas, &Ngpart, &Nspart, &Nbpart, &flag_entropy_ICs,
                    with_hydro, /*with_grav=*/1, with_stars, with_black_holes,
-                   cleanup_h, cleanup_sqrt_a, cosmo.h, cosmo.a, myrank,
-                   nr_nodes, MPI_COMM_WORLD, MPI_INFO_NULL, nr_threads,
-                   /*dry_run=*/0);
+                   cleanup_h, cleanup_sqrt_a, cosmo.h, cosmo.a,
+                   ic_partition, myrank, nr_nodes, MPI_COMM_WORLD,
+                   MPI_INFO_NULL, nr_threads, /*dry_run=*/0);
 #else
   read_ic_serial(ICfileName, &us, dim, &parts, &gparts, &sparts, &bparts, &Ngas,
                  &Ngpart, &Nspart, &Nbpart, &flag_entropy_ICs, with_hydro,
                  /*with_grav=*/1, with_stars, with_black_holes, cleanup_h,
-                 cleanup_sqrt_a, cosmo.h, cosmo.a, myrank, nr_nodes,
-                 MPI_COMM_WORLD, MPI_INFO_NULL, nr_threads, /*dry_run=*/0);
+                 cleanup_sqrt_a, cosmo.h, cosmo.a, ic_partition, myrank,
+                 nr_nodes, MPI_COMM_WORLD, MPI_INFO_NULL, nr_threads,
+                 /*dry_run=*/0);
 #endif
 #else
   read_ic_single(ICfileName, &us, dim, &parts, &gparts, &sparts, &bparts, &Ngas,
@@ -500,7 +507,9 @@ int main(int argc, char *argv[]) {
     fflush(stdout);
   }
 
-  /* Initialise the long-range gravity mesh */
+  /* Initialise the long-range gravity mesh. No force is computed, so the
+   * mesh is only needed to construct the communications over MPI. */
+#ifdef WITH_MPI
   if (periodic) {
 #ifdef HAVE_FFTW
     pm_mesh_init(&mesh, &gravity_properties, s.dim, nr_threads);
@@ -511,6 +520,9 @@ int main(int argc, char *argv[]) {
   } else {
     pm_mesh_init_no_mesh(&mesh, s.dim);
   }
+#else
+  pm_mesh_init_no_mesh(&mesh, s.dim);
+#endif
 
     /* Also update the total counts (in case of changes due to replication) */
 #if defined(WITH_MPI)
@@ -554,7 +566,8 @@ int main(int argc, char *argv[]) {
               /*stars_properties=*/NULL, /*black_holes_properties=*/NULL,
               /*feedback_properties=*/NULL, &mesh, /*potential=*/NULL,
               /*cooling_func=*/NULL,
-              /*starform=*/NULL, /*chemistry=*/NULL, &fof_properties);
+              /*starform=*/NULL, /*chemistry=*/NULL, &fof_properties,
+              &lightcone_properties);
   engine_config(/*restart=*/0, /*fof=*/1, &e, params, nr_nodes, myrank,
                 nr_threads, with_aff, talking, NULL);
 
@@ -583,16 +596,21 @@ int main(int argc, char *argv[]) {
 
 #ifdef WITH_MPI
   /* Split the space. */
-  engine_split(&e, &initial_partition);
-  engine_redistribute(&e);
+  if (engine_split(&e, &initial_partition)) engine_redistribute(&e);
 #endif
 
 #ifdef SWIFT_DEBUG_TASKS
   e.tic_step = getticks();
 #endif
 
+#ifdef WITH_MPI
   /* Initialise the tree and communication tasks */
   engine_rebuild(&e, /*repartitionned=*/0, clean_smoothing_length_values);
+#else
+  /* Only build the gravity tree, the FOF tasks are made by engine_fof() */
+  engine_rebuild_fof(&e);
+  if (clean_smoothing_length_values) space_sanitize(&s);
+#endif
 
 #ifdef SWIFT_DEBUG_TASKS
   e.toc_step = getticks();
@@ -0,0 +1,669 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_HDF5
+#include <hdf5.h>
+#endif
+
+/* This object's header. */
+#include "logger_reader.h"
+
+/* Local headers. */
+#include "clocks.h"
+#include "error.h"
+#include "minmax.h"
+#include "part_type.h"
+
+/**
+ * @brief Read the header of a record.
+ *
+ * @param reader The #logger_reader.
+ * @param offset The offset of the record.
+ * @param mask (return) The mask of the record.
+ * @param prev (return) The offset of the previous record of the same chain,
+ * 0 if this is the first one.
+ *
+ * @return Pointer to the data following the header.
+ */
+static const char *logger_reader_read_header(const struct logger_reader *reader,
+                                             size_t offset, unsigned int *mask,
+                                             size_t *prev) {
+
+  if (offset + logger_header_bytes > reader->size)
+    error("Trying to read a record beyond the end of the log (%zd).", offset);
+
+  const char *buff = reader->data + offset;
+
+  *mask = 0;
+  memcpy(mask, buff, logger_mask_size);
+  buff += logger_mask_size;
+
+  size_t diff = 0;
+  memcpy(&diff, buff, logger_offset_size);
+  buff += logger_offset_size;
+
+  *prev = offset - diff;
+  return buff;
+}
+
+/**
+ * @brief Time (or scale-factor) of the record at a given offset, i.e. the
+ * time of the last timestamp written before it.
+ *
+ * @param reader The #logger_reader.
+ * @param offset The offset of the record.
+ */
+static double logger_reader_time_of_offset(const struct logger_reader *reader,
+                                           size_t offset) {
+
+  if (reader->nr_times == 0 || reader->times[0].offset > offset)
+    error("No timestamp before the record at offset %zd.", offset);
+
+  /* Bisection over the timestamps */
+  size_t lo = 0, hi = reader->nr_times;
+  while (hi - lo > 1) {
+    const size_t mid = (lo + hi) / 2;
+    if (reader->times[mid].offset < offset)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return reader->times[lo].time;
+}
+
+/**
+ * @brief Decode the raw fields of a particle record.
+ *
+ * The fields missing from the mask are left untouched.
+ *
+ * @param reader The #logger_reader.
+ * @param buff The fields of the record.
+ * @param mask The mask of the fields.
+ * @param p The #logger_reader_particle to fill.
+ */
+static void logger_reader_read_fields(const struct logger_reader *reader,
+                                      const char *buff, unsigned int mask,
+                                      struct logger_reader_particle *p) {
+
+  if (mask & logger_mask_data[logger_x].mask) {
+    memcpy(p->x, buff, sizeof(p->x));
+    buff += reader->mask_size[logger_x];
+  }
+
+  if (mask & logger_mask_data[logger_v].mask) {
+    memcpy(p->v, buff, sizeof(p->v));
+    buff += reader->mask_size[logger_v];
+  }
+
+  if (mask & logger_mask_data[logger_a].mask) {
+    memcpy(p->a, buff, sizeof(p->a));
+    buff += reader->mask_size[logger_a];
+  }
+
+  if (mask & logger_mask_data[logger_u].mask) {
+    memcpy(&p->entropy, buff, sizeof(float));
+    buff += reader->mask_size[logger_u];
+  }
+
+  if (mask & logger_mask_data[logger_h].mask) {
+    memcpy(&p->h, buff, sizeof(float));
+    buff += reader->mask_size[logger_h];
+  }
+
+  if (mask & logger_mask_data[logger_rho].mask) {
+    memcpy(&p->rho, buff, sizeof(float));
+    buff += reader->mask_size[logger_rho];
+  }
+
+  if (mask & logger_mask_data[logger_consts].mask) {
+    memcpy(&p->mass, buff, sizeof(float));
+    memcpy(&p->id, buff + sizeof(float), sizeof(long long));
+  }
+}
+
+/**
+ * @brief Decode a particle record.
+ *
+ * Delta-encoded records are decoded on top of the previous record of the
+ * particle, itself decoded recursively down to the last full record.
+ *
+ * @param reader The #logger_reader.
+ * @param offset The offset of the record.
+ * @param p The #logger_reader_particle to fill.
+ */
+static void logger_reader_read_record(const struct logger_reader *reader,
+                                      size_t offset,
+                                      struct logger_reader_particle *p) {
+
+  unsigned int mask;
+  size_t prev;
+  const char *buff = logger_reader_read_header(reader, offset, &mask, &prev);
+
+  if (mask & logger_mask_data[logger_timestamp].mask)
+    error("Trying to read a timestamp as a particle (offset %zd).", offset);
+
+  const double time = logger_reader_time_of_offset(reader, offset);
+
+  if (!reader->delta_encoding) {
+    logger_reader_read_fields(reader, buff, mask, p);
+  } else if (*buff++ == logger_record_full) {
+    logger_reader_read_fields(reader, buff, mask, p);
+  } else {
+    if (prev == 0)
+      error("Delta-encoded record without reference (offset %zd).", offset);
+
+    /* Start from the previous record */
+    logger_reader_read_record(reader, prev, p);
+    const double dt = time - p->time;
+
+    long long q;
+    for (int k = 0; k < 3; k++) {
+      buff = logger_read_varint(buff, &q);
+      p->x[k] = logger_predict_position(p->x[k], p->v[k], dt) +
+                q * reader->position_tolerance;
+    }
+    for (int k = 0; k < 3; k++) {
+      buff = logger_read_varint(buff, &q);
+      p->v[k] = (float)(p->v[k] + q * reader->velocity_tolerance);
+    }
+
+    const unsigned int mask_xv =
+        logger_mask_data[logger_x].mask | logger_mask_data[logger_v].mask;
+    logger_reader_read_fields(reader, buff, mask & ~mask_xv, p);
+  }
+
+  p->time = time;
+}
+
+/**
+ * @brief Interpolate linearly between two states of a particle.
+ *
+ * The positions are interpolated along the shortest path in periodic boxes.
+ *
+ * @param reader The #logger_reader.
+ * @param before The state before the requested time.
+ * @param after The state after the requested time.
+ * @param time The requested time.
+ * @param p (return) The interpolated state.
+ */
+static void logger_reader_interpolate(
+    const struct logger_reader *reader,
+    const struct logger_reader_particle *before,
+    const struct logger_reader_particle *after, double time,
+    struct logger_reader_particle *p) {
+
+  const double w = (time - before->time) / (after->time - before->time);
+  const float wf = (float)w;
+
+  *p = *before;
+  for (int k = 0; k < 3; k++) {
+    double dx = after->x[k] - before->x[k];
+    if (reader->periodic) {
+      if (dx > 0.5 * reader->dim[k]) dx -= reader->dim[k];
+      if (dx < -0.5 * reader->dim[k]) dx += reader->dim[k];
+    }
+    p->x[k] = before->x[k] + w * dx;
+    if (reader->periodic) {
+      if (p->x[k] < 0.) p->x[k] += reader->dim[k];
+      if (p->x[k] >= reader->dim[k]) p->x[k] -= reader->dim[k];
+    }
+
+    p->v[k] = before->v[k] + wf * (after->v[k] - before->v[k]);
+    p->a[k] = before->a[k] + wf * (after->a[k] - before->a[k]);
+  }
+  p->entropy = before->entropy + wf * (after->entropy - before->entropy);
+  p->h = before->h + wf * (after->h - before->h);
+  p->rho = before->rho + wf * (after->rho - before->rho);
+  p->time = time;
+}
+
+/**
+ * @brief Reconstruct the state of one particle at a given time.
+ *
+ * The chain of records is followed backwards from the given offset until a
+ * record older than the requested time is found, and the state is then
+ * interpolated with the next record. A particle whose last record is older
+ * than the requested time is returned in its last logged state, one whose
+ * first record is more recent in its first logged state.
+ *
+ * @param reader The #logger_reader.
+ * @param time The requested time.
+ * @param offset The offset of a record of the particle more recent than the
+ * requested time.
+ * @param p (return) The state of the particle.
+ */
+static void logger_reader_read_particle(const struct logger_reader *reader,
+                                        double time, size_t offset,
+                                        struct logger_reader_particle *p) {
+
+  /* Walk back in time, only looking at the headers */
+  unsigned int mask;
+  size_t prev, next = 0;
+  logger_reader_read_header(reader, offset, &mask, &prev);
+  double t = logger_reader_time_of_offset(reader, offset);
+  while (t > time && prev != 0) {
+    next = offset;
+    offset = prev;
+    logger_reader_read_header(reader, offset, &mask, &prev);
+    t = logger_reader_time_of_offset(reader, offset);
+  }
+
+  /* Decode the records around the requested time */
+  bzero(p, sizeof(struct logger_reader_particle));
+  logger_reader_read_record(reader, offset, p);
+  if (t > time || next == 0) return;
+
+  struct logger_reader_particle after = *p;
+  logger_reader_read_record(reader, next, &after);
+  if (after.time == p->time) {
+    *p = after;
+    return;
+  }
+
+  const struct logger_reader_particle before = *p;
+  logger_reader_interpolate(reader, &before, &after, time, p);
+}
+
+/**
+ * @brief Data needed by #logger_reader_read_particles_mapper.
+ */
+struct logger_reader_mapper_data {
+  const struct logger_reader *reader;
+  const size_t *offsets;
+  struct logger_reader_particle *parts;
+  double time;
+};
+
+/**
+ * @brief Reconstruct the state of a chunk of particles.
+ *
+ * @param map_data The offsets of the particles.
+ * @param num_elements The number of particles in the chunk.
+ * @param extra_data The #logger_reader_mapper_data.
+ */
+static void logger_reader_read_particles_mapper(void *map_data,
+                                                int num_elements,
+                                                void *extra_data) {
+
+  const struct logger_reader_mapper_data *data =
+      (struct logger_reader_mapper_data *)extra_data;
+  const size_t *offsets = (const size_t *)map_data;
+  const size_t first = offsets - data->offsets;
+
+  for (int i = 0; i < num_elements; i++)
+    logger_reader_read_particle(data->reader, data->time, offsets[i],
+                                &data->parts[first + i]);
+}
+
+/**
+ * @brief Reconstruct the state of a set of particles at a given time.
+ *
+ * @param reader The #logger_reader.
+ * @param time The requested time (or scale-factor).
+ * @param offsets The offsets of records of the particles more recent than the
+ * requested time, e.g. read from an index file.
+ * @param count The number of particles.
+ * @param parts (return) The states of the particles.
+ */
+void logger_reader_read_particles(struct logger_reader *reader, double time,
+                                  const size_t *offsets, size_t count,
+                                  struct logger_reader_particle *parts) {
+
+  const ticks tic = getticks();
+
+  struct logger_reader_mapper_data data;
+  data.reader = reader;
+  data.offsets = offsets;
+  data.parts = parts;
+  data.time = time;
+
+  threadpool_map(&reader->threadpool, logger_reader_read_particles_mapper,
+                 (size_t *)offsets, count, sizeof(size_t),
+                 threadpool_auto_chunk_size, &data);
+
+  if (reader->verbose)
+    message("Reading %zd particles took %.3f %s.", count,
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+}
+
+/**
+ * @brief Read the timestamps of the log.
+ *
+ * The chain of timestamps is followed backwards from the given one.
+ *
+ * @param reader The #logger_reader.
+ * @param last_offset The offset of the last timestamp of interest.
+ */
+void logger_reader_read_timestamps(struct logger_reader *reader,
+                                   size_t last_offset) {
+
+  /* Count them */
+  size_t count = 0;
+  for (size_t offset = last_offset; offset != 0; count++) {
+    unsigned int mask;
+    logger_reader_read_header(reader, offset, &mask, &offset);
+    if (mask != logger_mask_data[logger_timestamp].mask)
+      error("Record at offset %zd is not a timestamp.", offset);
+  }
+
+  free(reader->times);
+  reader->times = (struct logger_reader_timestamp *)malloc(
+      count * sizeof(struct logger_reader_timestamp));
+  if (reader->times == NULL && count > 0)
+    error("Failed to allocate the timestamps.");
+  reader->nr_times = count;
+
+  /* And read them, the oldest first */
+  size_t offset = last_offset;
+  for (size_t k = count; k > 0; k--) {
+    struct logger_reader_timestamp *t = &reader->times[k - 1];
+    unsigned int mask;
+    size_t prev;
+    const char *buff = logger_reader_read_header(reader, offset, &mask, &prev);
+    t->offset = offset;
+    memcpy(&t->ti, buff, sizeof(integertime_t));
+    memcpy(&t->time, buff + sizeof(integertime_t), sizeof(double));
+    offset = prev;
+  }
+
+  if (reader->verbose)
+    message("Read %zd timestamps.", reader->nr_times);
+}
+
+#ifdef HAVE_HDF5
+
+/**
+ * @brief Read an attribute of the header of an index file.
+ */
+static void logger_reader_read_attribute(hid_t h_grp, const char *name,
+                                         hid_t type, void *data) {
+
+  const hid_t h_attr = H5Aopen(h_grp, name, H5P_DEFAULT);
+  if (h_attr < 0) error("Error while opening attribute '%s'.", name);
+  if (H5Aread(h_attr, type, data) < 0)
+    error("Error while reading attribute '%s'.", name);
+  H5Aclose(h_attr);
+}
+
+/**
+ * @brief Read the meta-data of an index file.
+ *
+ * @param reader The #logger_reader.
+ * @param index The #logger_reader_index to fill, with its file name set.
+ */
+static void logger_reader_read_index_header(struct logger_reader *reader,
+                                            struct logger_reader_index *index) {
+
+  const hid_t h_file = H5Fopen(index->filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (h_file < 0) error("Error while opening file '%s'.", index->filename);
+
+  hid_t h_grp = H5Gopen(h_file, "/Header", H5P_DEFAULT);
+  if (h_grp < 0) error("Error while opening the index header.");
+  logger_reader_read_attribute(h_grp, "Time", H5T_NATIVE_DOUBLE, &index->time);
+  unsigned long long time_offset = 0;
+  logger_reader_read_attribute(h_grp, "Time Offset", H5T_NATIVE_ULLONG,
+                               &time_offset);
+  index->time_offset = time_offset;
+  logger_reader_read_attribute(h_grp, "BoxSize", H5T_NATIVE_DOUBLE,
+                               reader->dim);
+  long long N[swift_type_count];
+  logger_reader_read_attribute(h_grp, "NumPart_ThisFile", H5T_NATIVE_LLONG, N);
+  index->count = N[swift_type_gas];
+  H5Gclose(h_grp);
+
+  h_grp = H5Gopen(h_file, "/RuntimePars", H5P_DEFAULT);
+  if (h_grp < 0) error("Error while opening the runtime parameters.");
+  logger_reader_read_attribute(h_grp, "PeriodicBoundariesOn", H5T_NATIVE_INT,
+                               &reader->periodic);
+  H5Gclose(h_grp);
+
+  H5Fclose(h_file);
+}
+
+/**
+ * @brief Read the offsets of the particles stored in an index file.
+ *
+ * @param index The #logger_reader_index.
+ * @param offsets (return) The offsets, of size index->count.
+ */
+static void logger_reader_read_index_offsets(
+    const struct logger_reader_index *index, size_t *offsets) {
+
+  const hid_t h_file = H5Fopen(index->filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (h_file < 0) error("Error while opening file '%s'.", index->filename);
+
+  const hid_t h_data = H5Dopen(h_file, "/PartType0/Offset", H5P_DEFAULT);
+  if (h_data < 0) error("Error while opening the offsets dataset.");
+
+  unsigned long long *temp = NULL;
+  if (sizeof(size_t) == sizeof(unsigned long long))
+    temp = (unsigned long long *)offsets;
+  else if ((temp = (unsigned long long *)malloc(
+                index->count * sizeof(unsigned long long))) == NULL)
+    error("Failed to allocate the offsets.");
+
+  if (H5Dread(h_data, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, temp) <
+      0)
+    error("Error while reading the offsets.");
+
+  if ((void *)temp != (void *)offsets) {
+    for (size_t k = 0; k < index->count; k++) offsets[k] = temp[k];
+    free(temp);
+  }
+
+  H5Dclose(h_data);
+  H5Fclose(h_file);
+}
+
+#endif /* HAVE_HDF5 */
+
+/**
+ * @brief Sort the index files by increasing time.
+ */
+static int logger_reader_compare_index(const void *a, const void *b) {
+  const struct logger_reader_index *ia = (const struct logger_reader_index *)a;
+  const struct logger_reader_index *ib = (const struct logger_reader_index *)b;
+  return (ia->time > ib->time) - (ia->time < ib->time);
+}
+
+/**
+ * @brief Open a log and its index files.
+ *
+ * The log <basename>.dump is memory-mapped and its header is checked. The
+ * index files <basename>_XXXX.hdf5 are listed and the timestamps are read
+ * up to the last one of the most recent index.
+ *
+ * @param reader The #logger_reader.
+ * @param basename The common part of the names of the log and index files.
+ * @param nr_threads The number of threads following the particles' chains.
+ * @param verbose Are we talkative?
+ */
+void logger_reader_init(struct logger_reader *reader, const char *basename,
+                        int nr_threads, int verbose) {
+
+  bzero(reader, sizeof(struct logger_reader));
+  strncpy(reader->basename, basename, logger_string_length - 1);
+  reader->verbose = verbose;
+  reader->fd = -1;
+
+  /* Map the log */
+  char filename[logger_string_length + 16];
+  snprintf(filename, sizeof(filename), "%s.dump", basename);
+  if ((reader->fd = open(filename, O_RDONLY)) < 0)
+    error("Failed to open the log '%s' (%s).", filename, strerror(errno));
+  struct stat st;
+  if (fstat(reader->fd, &st) != 0)
+    error("Failed to stat the log (%s).", strerror(errno));
+  reader->size = st.st_size;
+  if (reader->size == 0) error("The log '%s' is empty.", filename);
+  void *data = mmap(NULL, reader->size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+  if (data == MAP_FAILED)
+    error("Failed to map the log (%s).", strerror(errno));
+  reader->data = (const char *)data;
+
+  /* The chains are followed in a random order */
+  madvise(data, reader->size, MADV_RANDOM);
+
+  /* Read the header: version, direction of the offsets and first record */
+  const char *buff = reader->data + logger_version_size;
+  int reversed = 0;
+  memcpy(&reversed, buff, logger_number_size);
+  buff += logger_number_size;
+  if (reversed) error("Logs with forward offsets are not supported.");
+  memcpy(&reader->first_offset, buff, logger_offset_size);
+  buff += logger_offset_size;
+
+  /* The masks */
+  int label_size = 0, count_mask = 0;
+  memcpy(&label_size, buff, logger_number_size);
+  buff += logger_number_size;
+  memcpy(&count_mask, buff, logger_number_size);
+  buff += logger_number_size;
+  if (count_mask != logger_count_mask)
+    error("The log has %d masks, expected %d.", count_mask, logger_count_mask);
+  for (int k = 0; k < count_mask; k++) {
+    if (strncmp(buff, logger_mask_data[k].name, label_size) != 0)
+      error("Unexpected mask '%.*s' in the log.", label_size, buff);
+    buff += label_size;
+    memcpy(&reader->mask_size[k], buff, logger_number_size);
+    buff += logger_number_size;
+  }
+
+  /* The encoding of the records, if written */
+  if (buff < reader->data + reader->first_offset) {
+    memcpy(&reader->delta_encoding, buff, logger_number_size);
+    buff += logger_number_size;
+    memcpy(&reader->position_tolerance, buff, sizeof(double));
+    buff += sizeof(double);
+    memcpy(&reader->velocity_tolerance, buff, sizeof(double));
+    buff += sizeof(double);
+  }
+
+  /* List the index files */
+  for (int k = 0;; k++) {
+    snprintf(filename, sizeof(filename), "%s_%04i.hdf5", basename, k);
+    if (access(filename, R_OK) != 0) break;
+    reader->nr_index++;
+  }
+  if (reader->nr_index > 0) {
+#ifdef HAVE_HDF5
+    reader->index = (struct logger_reader_index *)malloc(
+        reader->nr_index * sizeof(struct logger_reader_index));
+    if (reader->index == NULL) error("Failed to allocate the index list.");
+    for (int k = 0; k < reader->nr_index; k++) {
+      snprintf(reader->index[k].filename, sizeof(reader->index[k].filename),
+               "%s_%04i.hdf5", basename, k);
+      logger_reader_read_index_header(reader, &reader->index[k]);
+    }
+    qsort(reader->index, reader->nr_index, sizeof(struct logger_reader_index),
+          logger_reader_compare_index);
+
+    /* All the timestamps we can reach */
+    size_t last_offset = 0;
+    for (int k = 0; k < reader->nr_index; k++)
+      last_offset = max(last_offset, reader->index[k].time_offset);
+    logger_reader_read_timestamps(reader, last_offset);
+#else
+    error("Can't read the index files without HDF5.");
+#endif
+  }
+
+  if (verbose)
+    message("Opened a log of %zd bytes with %d index files.", reader->size,
+            reader->nr_index);
+
+  threadpool_init(&reader->threadpool, nr_threads);
+}
+
+/**
+ * @brief Reconstruct the state of all the particles at a given time.
+ *
+ * The offsets are read from the first index file written after the requested
+ * time, or from the last one if there is none.
+ *
+ * @param reader The #logger_reader.
+ * @param time The requested time (or scale-factor).
+ * @param parts (return) The states of the particles, to be freed by the
+ * caller.
+ *
+ * @return The number of particles.
+ */
+size_t logger_reader_read_all_particles(struct logger_reader *reader,
+                                        double time,
+                                        struct logger_reader_particle **parts) {
+
+  if (reader->nr_index == 0) error("No index file found for the log.");
+
+#ifdef HAVE_HDF5
+  /* The index closest to the requested time, in the future. The particles
+   * are logged at the start of their steps, so an index written exactly at
+   * the requested time does not point to the records of that time yet. */
+  int k = 0;
+  while (k < reader->nr_index - 1 && reader->index[k].time <= time) k++;
+  const struct logger_reader_index *index = &reader->index[k];
+
+  if (reader->verbose)
+    message("Using the index '%s' written at t=%e.", index->filename,
+            index->time);
+
+  size_t *offsets = (size_t *)malloc(index->count * sizeof(size_t));
+  *parts = (struct logger_reader_particle *)malloc(
+      index->count * sizeof(struct logger_reader_particle));
+  if (offsets == NULL || *parts == NULL)
+    error("Failed to allocate memory for %zd particles.", index->count);
+
+  logger_reader_read_index_offsets(index, offsets);
+  logger_reader_read_particles(reader, time, offsets, index->count, *parts);
+
+  free(offsets);
+  return index->count;
+#else
+  error("Can't read the index files without HDF5.");
+  return 0;
+#endif
+}
+
+/**
+ * @brief Close the log.
+ *
+ * @param reader The #logger_reader.
+ */
+void logger_reader_clean(struct logger_reader *reader) {
+
+  threadpool_clean(&reader->threadpool);
+  if (munmap((void *)reader->data, reader->size) != 0)
+    error("Failed to unmap the log (%s).", strerror(errno));
+  if (close(reader->fd) != 0) error("Failed to close the log.");
+  free(reader->times);
+  free(reader->index);
+}
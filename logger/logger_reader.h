@@ -0,0 +1,173 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_LOGGER_READER_H
+#define SWIFT_LOGGER_READER_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Standard headers */
+#include <stddef.h>
+
+/* Local headers */
+#include "logger.h"
+#include "threadpool.h"
+#include "timeline.h"
+
+/**
+ * @brief The state of a particle as reconstructed from the logger.
+ */
+struct logger_reader_particle {
+
+  /*! Particle ID */
+  long long id;
+
+  /*! Position */
+  double x[3];
+
+  /*! Velocity */
+  float v[3];
+
+  /*! Acceleration */
+  float a[3];
+
+  /*! Internal energy (or entropy, if Gadget-SPH is used) */
+  float entropy;
+
+  /*! Smoothing length */
+  float h;
+
+  /*! Density */
+  float rho;
+
+  /*! Mass */
+  float mass;
+
+  /*! Time (or scale-factor) of the returned state */
+  double time;
+};
+
+/**
+ * @brief A timestamp of the log, i.e. the start of a time-step.
+ */
+struct logger_reader_timestamp {
+
+  /*! Offset of the timestamp in the log */
+  size_t offset;
+
+  /*! Integer time of the step */
+  integertime_t ti;
+
+  /*! Time (or scale-factor) of the step */
+  double time;
+};
+
+/**
+ * @brief An index file, i.e. the offsets of the last record of every
+ * particle at a given time.
+ */
+struct logger_reader_index {
+
+  /*! Name of the file */
+  char filename[logger_string_length + 16];
+
+  /*! Time (or scale-factor) at which the index was written */
+  double time;
+
+  /*! Offset of the last timestamp written before the index */
+  size_t time_offset;
+
+  /*! Number of particles in the index */
+  size_t count;
+};
+
+/**
+ * @brief Reader of the particle log written by the #logger.
+ *
+ * The log is memory-mapped read-only and the particles' chains of records
+ * are followed backwards from the offsets stored in the index file closest
+ * to the requested time, using one thread per chunk of particles.
+ */
+struct logger_reader {
+
+  /*! Common part of the names of the log and index files */
+  char basename[logger_string_length];
+
+  /*! The memory-mapped log */
+  const char *data;
+
+  /*! Size of the log in bytes */
+  size_t size;
+
+  /*! File descriptor of the log */
+  int fd;
+
+  /*! Offset of the first record */
+  size_t first_offset;
+
+  /*! Size of each of the masks' fields, as read from the log's header */
+  int mask_size[logger_count_mask];
+
+  /*! Are the positions and velocities stored as quantised deltas? */
+  int delta_encoding;
+
+  /*! Maximal error on the delta-encoded positions */
+  double position_tolerance;
+
+  /*! Maximal error on the delta-encoded velocities */
+  double velocity_tolerance;
+
+  /*! The timestamps, sorted by offset (and hence by time) */
+  struct logger_reader_timestamp *times;
+
+  /*! Number of timestamps */
+  size_t nr_times;
+
+  /*! The index files, sorted by time */
+  struct logger_reader_index *index;
+
+  /*! Number of index files */
+  int nr_index;
+
+  /*! Box size, read from the index files */
+  double dim[3];
+
+  /*! Are the boundary conditions periodic? */
+  int periodic;
+
+  /*! The threads following the particles' chains */
+  struct threadpool threadpool;
+
+  /*! Are we talkative? */
+  int verbose;
+};
+
+void logger_reader_init(struct logger_reader *reader, const char *basename,
+                        int nr_threads, int verbose);
+void logger_reader_read_timestamps(struct logger_reader *reader,
+                                   size_t last_offset);
+size_t logger_reader_read_all_particles(struct logger_reader *reader,
+                                        double time,
+                                        struct logger_reader_particle **parts);
+void logger_reader_read_particles(struct logger_reader *reader, double time,
+                                  const size_t *offsets, size_t count,
+                                  struct logger_reader_particle *parts);
+void logger_reader_clean(struct logger_reader *reader);
+
+#endif /* SWIFT_LOGGER_READER_H */
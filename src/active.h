@@ -243,6 +243,23 @@ __attribute__((always_inline)) INLINE static int cell_is_active_stars(
   return (c->stars.ti_end_min == e->ti_current);
 }
 
+/**
+ * @brief Does a cell contain any s-particle finishing their time-step now
+ * that may still do some feedback?
+ *
+ * Only valid for local cells, as the flag is not communicated.
+ *
+ * @param c The #cell.
+ * @param e The #engine containing information about the current time.
+ * @return 1 if the #cell contains at least an active particle that may do
+ * feedback, 0 otherwise.
+ */
+__attribute__((always_inline)) INLINE static int cell_is_active_stars_feedback(
+    const struct cell *c, const struct engine *e) {
+
+  return cell_is_active_stars(c, e) && c->stars.do_feedback;
+}
+
 /**
  * @brief Does a cell contain any b-particle finishing their time-step now ?
  *
@@ -265,6 +282,45 @@ __attribute__((always_inline)) INLINE static int cell_is_active_black_holes(
   return (c->black_holes.ti_end_min == e->ti_current);
 }
 
+/**
+ * @brief When will this #cell next have tasks to unskip?
+ *
+ * Only the particle types the #cell contains and that the #engine policies
+ * would have us unskip tasks for are considered.
+ *
+ * @param c The #cell.
+ * @param e The #engine.
+ * @return The smallest end of time-step of these particles, -1 if there are
+ * none.
+ */
+__attribute__((always_inline)) INLINE static integertime_t
+cell_get_next_active_time(const struct cell *c, const struct engine *e) {
+
+  const int with_hydro = e->policy & engine_policy_hydro;
+  const int with_grav =
+      (e->policy & engine_policy_self_gravity) ||
+      ((e->policy & engine_policy_external_gravity) && c->nodeID == e->nodeID);
+  const int with_stars =
+      (e->policy & engine_policy_feedback) ||
+      ((e->policy & engine_policy_stars) && c->nodeID == e->nodeID);
+  const int with_black_holes = e->policy & engine_policy_black_holes;
+
+  integertime_t ti_next = -1;
+  if (with_hydro && c->hydro.count > 0 &&
+      (ti_next < 0 || c->hydro.ti_end_min < ti_next))
+    ti_next = c->hydro.ti_end_min;
+  if (with_grav && c->grav.count > 0 &&
+      (ti_next < 0 || c->grav.ti_end_min < ti_next))
+    ti_next = c->grav.ti_end_min;
+  if (with_stars && c->stars.count > 0 &&
+      (ti_next < 0 || c->stars.ti_end_min < ti_next))
+    ti_next = c->stars.ti_end_min;
+  if (with_black_holes && c->black_holes.count > 0 &&
+      (ti_next < 0 || c->black_holes.ti_end_min < ti_next))
+    ti_next = c->black_holes.ti_end_min;
+  return ti_next;
+}
+
 /**
  * @brief Is this particle finishing its time-step now ?
  *
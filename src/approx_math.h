@@ -20,6 +20,7 @@
 #define SWIFT_APPROX_MATH_H
 
 #include "inline.h"
+#include "vector.h"
 
 /**
  * @brief Approximate version of the complementay error function erfcf(x).
@@ -85,4 +86,118 @@ __attribute__((always_inline, const)) INLINE static double good_approx_exp(
                                         x * ((1. / 120.) + (1. / 720.) * x)))));
 }
 
+#ifdef WITH_VECTORIZATION
+
+/**
+ * @brief Approximate version of expf(x) using a 4th order Taylor expansion
+ * (vector version).
+ *
+ * Same expression, and hence same accuracy, as approx_expf().
+ *
+ * @param x The numbers to take the exponential of.
+ */
+__attribute__((always_inline, const)) INLINE static vector approx_expf_vec(
+    const vector x) {
+
+  vector res;
+  res.v = vec_fma(x.v, vec_set1(1.f / 24.f), vec_set1(1.f / 6.f));
+  res.v = vec_fma(x.v, res.v, vec_set1(0.5f));
+  res.v = vec_fma(x.v, res.v, vec_set1(1.f));
+  res.v = vec_fma(x.v, res.v, vec_set1(1.f));
+  return res;
+}
+
+/**
+ * @brief Approximate version of expf(x) using a 6th order Taylor expansion
+ * (vector version).
+ *
+ * Same expression, and hence same accuracy, as good_approx_expf().
+ *
+ * @param x The numbers to take the exponential of.
+ */
+__attribute__((always_inline, const)) INLINE static vector
+good_approx_expf_vec(const vector x) {
+
+  vector res;
+  res.v = vec_fma(x.v, vec_set1(1.f / 720.f), vec_set1(1.f / 120.f));
+  res.v = vec_fma(x.v, res.v, vec_set1(1.f / 24.f));
+  res.v = vec_fma(x.v, res.v, vec_set1(1.f / 6.f));
+  res.v = vec_fma(x.v, res.v, vec_set1(0.5f));
+  res.v = vec_fma(x.v, res.v, vec_set1(1.f));
+  res.v = vec_fma(x.v, res.v, vec_set1(1.f));
+  return res;
+}
+
+/**
+ * @brief Approximate version of the complementay error function erfcf(x)
+ * (vector version).
+ *
+ * Same Abramowitz & Stegun (eq. 7.1.27) expression as approx_erfcf().
+ * The absolute error is < 4.7*10^-4 over the range 0 < x < infinity.
+ *
+ * Arguments above 100 are clamped to avoid overflows (erfc(100) ~ 0).
+ * Returns garbage for x < 0.
+ * @param x The numbers to compute erfc for.
+ */
+__attribute__((always_inline, const)) INLINE static vector approx_erfcf_vec(
+    const vector x) {
+
+  vector y;
+  y.v = vec_fmin(x.v, vec_set1(100.f));
+
+  /* 1 + 0.278393*x + 0.230389*x^2 + 0.000972*x^3 + 0.078108*x^4 */
+  vector arg;
+  arg.v = vec_set1(0.078108f);
+  arg.v = vec_fma(y.v, arg.v, vec_set1(0.000972f));
+  arg.v = vec_fma(y.v, arg.v, vec_set1(0.230389f));
+  arg.v = vec_fma(y.v, arg.v, vec_set1(0.278393f));
+  arg.v = vec_fma(y.v, arg.v, vec_set1(1.f));
+
+  /* 1 / arg^4 */
+  vector arg4;
+  arg4.v = vec_mul(arg.v, arg.v);
+  arg4.v = vec_mul(arg4.v, arg4.v);
+  return vec_reciprocal(arg4);
+}
+
+/**
+ * @brief Approximate version of expf(x) for negative arguments (vector
+ * version).
+ *
+ * We evaluate the 6th order Taylor expansion of good_approx_expf() at x/32
+ * and square the result 5 times. This only uses floating-point
+ * multiplications and hence maps to every instruction set supported by
+ * vector.h.
+ *
+ * The relative error is smaller than 2 * 10^-6 for -5 < x < 0.
+ * The absolute error is smaller than 1 * 10^-7 for -25 < x < 0.
+ * Arguments below -25 are clamped (giving exp(-25) ~ 1.4 * 10^-11).
+ *
+ * @param x The numbers to take the exponential of (must be <= 0).
+ */
+__attribute__((always_inline, const)) INLINE static vector
+approx_expf_neg_vec(const vector x) {
+
+  vector y;
+  y.v = vec_mul(vec_fmax(x.v, vec_set1(-25.f)), vec_set1(1.f / 32.f));
+
+  vector w;
+  w.v = vec_fma(y.v, vec_set1(1.f / 720.f), vec_set1(1.f / 120.f));
+  w.v = vec_fma(y.v, w.v, vec_set1(1.f / 24.f));
+  w.v = vec_fma(y.v, w.v, vec_set1(1.f / 6.f));
+  w.v = vec_fma(y.v, w.v, vec_set1(0.5f));
+  w.v = vec_fma(y.v, w.v, vec_set1(1.f));
+  w.v = vec_fma(y.v, w.v, vec_set1(1.f));
+
+  /* (e^(x/32))^32 */
+  w.v = vec_mul(w.v, w.v);
+  w.v = vec_mul(w.v, w.v);
+  w.v = vec_mul(w.v, w.v);
+  w.v = vec_mul(w.v, w.v);
+  w.v = vec_mul(w.v, w.v);
+  return w;
+}
+
+#endif /* WITH_VECTORIZATION */
+
 #endif /* SWIFT_APPROX_MATH_H */
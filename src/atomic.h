@@ -34,6 +34,8 @@
 #define atomic_dec(v) atomic_sub(v, 1)
 #define atomic_cas(v, o, n) __sync_val_compare_and_swap(v, o, n)
 #define atomic_swap(v, n) __sync_lock_test_and_set(v, n)
+#define atomic_load_acquire(v) __atomic_load_n(v, __ATOMIC_ACQUIRE)
+#define atomic_store_release(v, n) __atomic_store_n(v, n, __ATOMIC_RELEASE)
 
 /**
  * @brief Atomic min operation on floats.
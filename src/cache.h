@@ -22,10 +22,14 @@
 /* Config parameters. */
 #include "../config.h"
 
+/* Some standard headers. */
+#include <string.h>
+
 /* Local headers */
 #include "align.h"
 #include "cell.h"
 #include "error.h"
+#include "hydro_soa.h"
 #include "part.h"
 #include "sort_part.h"
 #include "vector.h"
@@ -80,6 +84,21 @@ struct cache {
   /* Particle sound speed. */
   float *restrict soundspeed SWIFT_CACHE_ALIGN;
 
+  /* Particle internal energy. */
+  float *restrict u SWIFT_CACHE_ALIGN;
+
+  /* Smoothed pressure. */
+  float *restrict pressure_bar SWIFT_CACHE_ALIGN;
+
+  /* Maximal signal velocity. */
+  float *restrict v_sig SWIFT_CACHE_ALIGN;
+
+  /* Artificial viscosity parameter. */
+  float *restrict alpha_visc SWIFT_CACHE_ALIGN;
+
+  /* Thermal diffusion parameter. */
+  float *restrict alpha_diff SWIFT_CACHE_ALIGN;
+
   /* Cache size. */
   int count;
 };
@@ -146,6 +165,11 @@ __attribute__((always_inline)) INLINE void cache_init(struct cache *c,
     free(c->pOrho2);
     free(c->balsara);
     free(c->soundspeed);
+    free(c->u);
+    free(c->pressure_bar);
+    free(c->v_sig);
+    free(c->alpha_visc);
+    free(c->alpha_diff);
   }
 
   error += posix_memalign((void **)&c->x, SWIFT_CACHE_ALIGNMENT, sizeBytes);
@@ -167,6 +191,15 @@ __attribute__((always_inline)) INLINE void cache_init(struct cache *c,
       posix_memalign((void **)&c->balsara, SWIFT_CACHE_ALIGNMENT, sizeBytes);
   error +=
       posix_memalign((void **)&c->soundspeed, SWIFT_CACHE_ALIGNMENT, sizeBytes);
+  error += posix_memalign((void **)&c->u, SWIFT_CACHE_ALIGNMENT, sizeBytes);
+  error += posix_memalign((void **)&c->pressure_bar, SWIFT_CACHE_ALIGNMENT,
+                          sizeBytes);
+  error +=
+      posix_memalign((void **)&c->v_sig, SWIFT_CACHE_ALIGNMENT, sizeBytes);
+  error +=
+      posix_memalign((void **)&c->alpha_visc, SWIFT_CACHE_ALIGNMENT, sizeBytes);
+  error +=
+      posix_memalign((void **)&c->alpha_diff, SWIFT_CACHE_ALIGNMENT, sizeBytes);
 
   if (error != 0)
     error("Couldn't allocate cache, no. of particles: %d", (int)count);
@@ -176,15 +209,20 @@ __attribute__((always_inline)) INLINE void cache_init(struct cache *c,
 /**
  * @brief Populate cache by reading in the particles in unsorted order.
  *
+ * If a #hydro_soa copy of the cell is provided, the hot fields are copied
+ * straight from its arrays.
+ *
  * @param ci The #cell.
+ * @param soa The #hydro_soa copy of ci (can be NULL).
  * @param ci_cache The cache.
  * @return uninhibited_count The no. of uninhibited particles.
  */
 __attribute__((always_inline)) INLINE int cache_read_particles(
     const struct cell *restrict const ci,
+    const struct hydro_soa *restrict const soa,
     struct cache *restrict const ci_cache) {
 
-#if defined(GADGET2_SPH)
+#if defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH)
 
   /* Let the compiler know that the data is aligned and create pointers to the
    * arrays inside the cache. */
@@ -196,6 +234,9 @@ __attribute__((always_inline)) INLINE int cache_read_particles(
   swift_declare_aligned_ptr(float, vx, ci_cache->vx, SWIFT_CACHE_ALIGNMENT);
   swift_declare_aligned_ptr(float, vy, ci_cache->vy, SWIFT_CACHE_ALIGNMENT);
   swift_declare_aligned_ptr(float, vz, ci_cache->vz, SWIFT_CACHE_ALIGNMENT);
+#ifdef ANARCHY_PU_SPH
+  swift_declare_aligned_ptr(float, u, ci_cache->u, SWIFT_CACHE_ALIGNMENT);
+#endif
 
   const int count = ci->hydro.count;
   const struct part *restrict parts = ci->hydro.parts;
@@ -206,28 +247,59 @@ __attribute__((always_inline)) INLINE int cache_read_particles(
                                -(2. * ci->width[2] + max_dx)};
   const float h_padded = ci->hydro.h_max / 4.;
 
-  /* Shift the particles positions to a local frame so single precision can be
-   * used instead of double precision. */
-  for (int i = 0; i < count; i++) {
+  if (soa != NULL) {
+
+    /* The copy is already in the local frame. */
+    memcpy(x, soa->x, count * sizeof(float));
+    memcpy(y, soa->y, count * sizeof(float));
+    memcpy(z, soa->z, count * sizeof(float));
+    memcpy(h, soa->h, count * sizeof(float));
+    memcpy(m, soa->m, count * sizeof(float));
+    memcpy(vx, soa->vx, count * sizeof(float));
+    memcpy(vy, soa->vy, count * sizeof(float));
+    memcpy(vz, soa->vz, count * sizeof(float));
+#ifdef ANARCHY_PU_SPH
+    for (int i = 0; i < count; i++) u[i] = parts[i].u;
+#endif
 
     /* Pad inhibited particles. */
-    if (parts[i].time_bin >= time_bin_inhibited) {
-      x[i] = pos_padded[0];
-      y[i] = pos_padded[1];
-      z[i] = pos_padded[2];
-      h[i] = h_padded;
-
-      continue;
+    for (int i = 0; i < count; i++) {
+      if (h[i] < 0.f) {
+        x[i] = pos_padded[0];
+        y[i] = pos_padded[1];
+        z[i] = pos_padded[2];
+        h[i] = h_padded;
+      }
     }
 
-    x[i] = (float)(parts[i].x[0] - loc[0]);
-    y[i] = (float)(parts[i].x[1] - loc[1]);
-    z[i] = (float)(parts[i].x[2] - loc[2]);
-    h[i] = parts[i].h;
-    m[i] = parts[i].mass;
-    vx[i] = parts[i].v[0];
-    vy[i] = parts[i].v[1];
-    vz[i] = parts[i].v[2];
+  } else {
+
+    /* Shift the particles positions to a local frame so single precision can
+     * be used instead of double precision. */
+    for (int i = 0; i < count; i++) {
+
+      /* Pad inhibited particles. */
+      if (parts[i].time_bin >= time_bin_inhibited) {
+        x[i] = pos_padded[0];
+        y[i] = pos_padded[1];
+        z[i] = pos_padded[2];
+        h[i] = h_padded;
+
+        continue;
+      }
+
+      x[i] = (float)(parts[i].x[0] - loc[0]);
+      y[i] = (float)(parts[i].x[1] - loc[1]);
+      z[i] = (float)(parts[i].x[2] - loc[2]);
+      h[i] = parts[i].h;
+      m[i] = parts[i].mass;
+      vx[i] = parts[i].v[0];
+      vy[i] = parts[i].v[1];
+      vz[i] = parts[i].v[2];
+#ifdef ANARCHY_PU_SPH
+      u[i] = parts[i].u;
+#endif
+    }
   }
 
   /* Pad cache if the no. of particles is not a multiple of double the vector
@@ -496,7 +568,7 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
     const struct cell *restrict const ci,
     struct cache *restrict const ci_cache) {
 
-#if defined(GADGET2_SPH)
+#if defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH)
 
   /* Let the compiler know that the data is aligned and create pointers to the
    * arrays inside the cache. */
@@ -517,6 +589,17 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
                             SWIFT_CACHE_ALIGNMENT);
   swift_declare_aligned_ptr(float, soundspeed, ci_cache->soundspeed,
                             SWIFT_CACHE_ALIGNMENT);
+#ifdef ANARCHY_PU_SPH
+  swift_declare_aligned_ptr(float, u, ci_cache->u, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, pressure_bar, ci_cache->pressure_bar,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, v_sig, ci_cache->v_sig,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, alpha_visc, ci_cache->alpha_visc,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, alpha_diff, ci_cache->alpha_diff,
+                            SWIFT_CACHE_ALIGNMENT);
+#endif
 
   const int count = ci->hydro.count;
   const struct part *restrict parts = ci->hydro.parts;
@@ -542,6 +625,13 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
       pOrho2[i] = 1.f;
       balsara[i] = 1.f;
       soundspeed[i] = 1.f;
+#ifdef ANARCHY_PU_SPH
+      u[i] = 1.f;
+      pressure_bar[i] = 1.f;
+      v_sig[i] = 1.f;
+      alpha_visc[i] = 1.f;
+      alpha_diff[i] = 1.f;
+#endif
 
       continue;
     }
@@ -556,9 +646,17 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
     vz[i] = parts[i].v[2];
     rho[i] = parts[i].rho;
     grad_h[i] = parts[i].force.f;
-    pOrho2[i] = parts[i].force.P_over_rho2;
     balsara[i] = parts[i].force.balsara;
     soundspeed[i] = parts[i].force.soundspeed;
+#ifdef GADGET2_SPH
+    pOrho2[i] = parts[i].force.P_over_rho2;
+#else
+    u[i] = parts[i].u;
+    pressure_bar[i] = parts[i].pressure_bar;
+    v_sig[i] = parts[i].viscosity.v_sig;
+    alpha_visc[i] = parts[i].viscosity.alpha;
+    alpha_diff[i] = parts[i].diffusion.alpha;
+#endif
   }
 
   /* Pad cache if there is a serial remainder. */
@@ -579,6 +677,13 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
       pOrho2[i] = 1.f;
       balsara[i] = 1.f;
       soundspeed[i] = 1.f;
+#ifdef ANARCHY_PU_SPH
+      u[i] = 1.f;
+      pressure_bar[i] = 1.f;
+      v_sig[i] = 1.f;
+      alpha_visc[i] = 1.f;
+      alpha_diff[i] = 1.f;
+#endif
     }
   }
 
@@ -595,8 +700,13 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
  * each other within the adjoining cell.Also read the particles into the cache
  * in sorted order.
  *
+ * If #hydro_soa copies of the cells are provided, the hot fields are gathered
+ * from their arrays rather than from the particles.
+ *
  * @param ci The i #cell.
  * @param cj The j #cell.
+ * @param soa_i The #hydro_soa copy of ci (can be NULL).
+ * @param soa_j The #hydro_soa copy of cj (can be NULL).
  * @param ci_cache The #cache for cell ci.
  * @param cj_cache The #cache for cell cj.
  * @param sort_i The array of sorted particle indices for cell ci.
@@ -607,6 +717,8 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
  */
 __attribute__((always_inline)) INLINE void cache_read_two_partial_cells_sorted(
     const struct cell *restrict const ci, const struct cell *restrict const cj,
+    const struct hydro_soa *restrict const soa_i,
+    const struct hydro_soa *restrict const soa_j,
     struct cache *restrict const ci_cache,
     struct cache *restrict const cj_cache, const struct entry *restrict sort_i,
     const struct entry *restrict sort_j, const double *restrict const shift,
@@ -654,6 +766,9 @@ __attribute__((always_inline)) INLINE void cache_read_two_partial_cells_sorted(
   swift_declare_aligned_ptr(float, vx, ci_cache->vx, SWIFT_CACHE_ALIGNMENT);
   swift_declare_aligned_ptr(float, vy, ci_cache->vy, SWIFT_CACHE_ALIGNMENT);
   swift_declare_aligned_ptr(float, vz, ci_cache->vz, SWIFT_CACHE_ALIGNMENT);
+#ifdef ANARCHY_PU_SPH
+  swift_declare_aligned_ptr(float, u, ci_cache->u, SWIFT_CACHE_ALIGNMENT);
+#endif
 
   int ci_cache_count = ci->hydro.count - first_pi_align;
   const double max_dx = max(ci->hydro.dx_max_part, cj->hydro.dx_max_part);
@@ -664,34 +779,82 @@ __attribute__((always_inline)) INLINE void cache_read_two_partial_cells_sorted(
 
   /* Shift the particles positions to a local frame (ci frame) so single
    * precision can be used instead of double precision.  */
-  for (int i = 0; i < ci_cache_count; i++) {
-    const int idx = sort_i[i + first_pi_align].i;
+  if (soa_i != NULL) {
 
-    /* Put inhibited particles out of range. */
-    if (parts_i[idx].time_bin >= time_bin_inhibited) {
-      x[i] = pos_padded_i[0];
-      y[i] = pos_padded_i[1];
-      z[i] = pos_padded_i[2];
-      h[i] = h_padded_i;
+    /* The copy is relative to ci's corner, move it to the frame of cj. */
+    const float soa_shift[3] = {(float)(ci->loc[0] - total_ci_shift[0]),
+                                (float)(ci->loc[1] - total_ci_shift[1]),
+                                (float)(ci->loc[2] - total_ci_shift[2])};
 
-      m[i] = 1.f;
-      vx[i] = 1.f;
-      vy[i] = 1.f;
-      vz[i] = 1.f;
+    for (int i = 0; i < ci_cache_count; i++) {
+      const int idx = sort_i[i + first_pi_align].i;
 
-      continue;
+      /* Put inhibited particles out of range. */
+      if (soa_i->h[idx] < 0.f) {
+        x[i] = pos_padded_i[0];
+        y[i] = pos_padded_i[1];
+        z[i] = pos_padded_i[2];
+        h[i] = h_padded_i;
+
+        m[i] = 1.f;
+        vx[i] = 1.f;
+        vy[i] = 1.f;
+        vz[i] = 1.f;
+#ifdef ANARCHY_PU_SPH
+        u[i] = 1.f;
+#endif
+
+        continue;
+      }
+
+      x[i] = soa_i->x[idx] + soa_shift[0];
+      y[i] = soa_i->y[idx] + soa_shift[1];
+      z[i] = soa_i->z[idx] + soa_shift[2];
+      h[i] = soa_i->h[idx];
+      m[i] = soa_i->m[idx];
+      vx[i] = soa_i->vx[idx];
+      vy[i] = soa_i->vy[idx];
+      vz[i] = soa_i->vz[idx];
+#ifdef ANARCHY_PU_SPH
+      u[i] = parts_i[idx].u;
+#endif
     }
+  } else {
+    for (int i = 0; i < ci_cache_count; i++) {
+      const int idx = sort_i[i + first_pi_align].i;
 
-    x[i] = (float)(parts_i[idx].x[0] - total_ci_shift[0]);
-    y[i] = (float)(parts_i[idx].x[1] - total_ci_shift[1]);
-    z[i] = (float)(parts_i[idx].x[2] - total_ci_shift[2]);
-    h[i] = parts_i[idx].h;
-    vx[i] = parts_i[idx].v[0];
-    vy[i] = parts_i[idx].v[1];
-    vz[i] = parts_i[idx].v[2];
-#ifdef GADGET2_SPH
-    m[i] = parts_i[idx].mass;
+      /* Put inhibited particles out of range. */
+      if (parts_i[idx].time_bin >= time_bin_inhibited) {
+        x[i] = pos_padded_i[0];
+        y[i] = pos_padded_i[1];
+        z[i] = pos_padded_i[2];
+        h[i] = h_padded_i;
+
+        m[i] = 1.f;
+        vx[i] = 1.f;
+        vy[i] = 1.f;
+        vz[i] = 1.f;
+#ifdef ANARCHY_PU_SPH
+        u[i] = 1.f;
+#endif
+
+        continue;
+      }
+
+      x[i] = (float)(parts_i[idx].x[0] - total_ci_shift[0]);
+      y[i] = (float)(parts_i[idx].x[1] - total_ci_shift[1]);
+      z[i] = (float)(parts_i[idx].x[2] - total_ci_shift[2]);
+      h[i] = parts_i[idx].h;
+      vx[i] = parts_i[idx].v[0];
+      vy[i] = parts_i[idx].v[1];
+      vz[i] = parts_i[idx].v[2];
+#if defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH)
+      m[i] = parts_i[idx].mass;
 #endif
+#ifdef ANARCHY_PU_SPH
+      u[i] = parts_i[idx].u;
+#endif
+    }
   }
 
 #ifdef SWIFT_DEBUG_CHECKS
@@ -748,6 +911,9 @@ __attribute__((always_inline)) INLINE void cache_read_two_partial_cells_sorted(
     vx[i] = 1.f;
     vy[i] = 1.f;
     vz[i] = 1.f;
+#ifdef ANARCHY_PU_SPH
+    u[i] = 1.f;
+#endif
   }
 
   /* Let the compiler know that the data is aligned and create pointers to the
@@ -760,40 +926,87 @@ __attribute__((always_inline)) INLINE void cache_read_two_partial_cells_sorted(
   swift_declare_aligned_ptr(float, vxj, cj_cache->vx, SWIFT_CACHE_ALIGNMENT);
   swift_declare_aligned_ptr(float, vyj, cj_cache->vy, SWIFT_CACHE_ALIGNMENT);
   swift_declare_aligned_ptr(float, vzj, cj_cache->vz, SWIFT_CACHE_ALIGNMENT);
+#ifdef ANARCHY_PU_SPH
+  swift_declare_aligned_ptr(float, uj, cj_cache->u, SWIFT_CACHE_ALIGNMENT);
+#endif
 
   const float pos_padded_j[3] = {-(2. * cj->width[0] + max_dx),
                                  -(2. * cj->width[1] + max_dx),
                                  -(2. * cj->width[2] + max_dx)};
   const float h_padded_j = cj->hydro.h_max / 4.;
 
-  for (int i = 0; i <= last_pj_align; i++) {
-    const int idx = sort_j[i].i;
+  if (soa_j != NULL) {
 
-    /* Put inhibited particles out of range. */
-    if (parts_j[idx].time_bin >= time_bin_inhibited) {
-      xj[i] = pos_padded_j[0];
-      yj[i] = pos_padded_j[1];
-      zj[i] = pos_padded_j[2];
-      hj[i] = h_padded_j;
+    /* The copy is already in the frame of cj. */
+    for (int i = 0; i <= last_pj_align; i++) {
+      const int idx = sort_j[i].i;
 
-      mj[i] = 1.f;
-      vxj[i] = 1.f;
-      vyj[i] = 1.f;
-      vzj[i] = 1.f;
+      /* Put inhibited particles out of range. */
+      if (soa_j->h[idx] < 0.f) {
+        xj[i] = pos_padded_j[0];
+        yj[i] = pos_padded_j[1];
+        zj[i] = pos_padded_j[2];
+        hj[i] = h_padded_j;
+
+        mj[i] = 1.f;
+        vxj[i] = 1.f;
+        vyj[i] = 1.f;
+        vzj[i] = 1.f;
+#ifdef ANARCHY_PU_SPH
+        uj[i] = 1.f;
+#endif
 
-      continue;
+        continue;
+      }
+
+      xj[i] = soa_j->x[idx];
+      yj[i] = soa_j->y[idx];
+      zj[i] = soa_j->z[idx];
+      hj[i] = soa_j->h[idx];
+      mj[i] = soa_j->m[idx];
+      vxj[i] = soa_j->vx[idx];
+      vyj[i] = soa_j->vy[idx];
+      vzj[i] = soa_j->vz[idx];
+#ifdef ANARCHY_PU_SPH
+      uj[i] = parts_j[idx].u;
+#endif
     }
+  } else {
+    for (int i = 0; i <= last_pj_align; i++) {
+      const int idx = sort_j[i].i;
 
-    xj[i] = (float)(parts_j[idx].x[0] - total_cj_shift[0]);
-    yj[i] = (float)(parts_j[idx].x[1] - total_cj_shift[1]);
-    zj[i] = (float)(parts_j[idx].x[2] - total_cj_shift[2]);
-    hj[i] = parts_j[idx].h;
-    vxj[i] = parts_j[idx].v[0];
-    vyj[i] = parts_j[idx].v[1];
-    vzj[i] = parts_j[idx].v[2];
-#ifdef GADGET2_SPH
-    mj[i] = parts_j[idx].mass;
+      /* Put inhibited particles out of range. */
+      if (parts_j[idx].time_bin >= time_bin_inhibited) {
+        xj[i] = pos_padded_j[0];
+        yj[i] = pos_padded_j[1];
+        zj[i] = pos_padded_j[2];
+        hj[i] = h_padded_j;
+
+        mj[i] = 1.f;
+        vxj[i] = 1.f;
+        vyj[i] = 1.f;
+        vzj[i] = 1.f;
+#ifdef ANARCHY_PU_SPH
+        uj[i] = 1.f;
 #endif
+
+        continue;
+      }
+
+      xj[i] = (float)(parts_j[idx].x[0] - total_cj_shift[0]);
+      yj[i] = (float)(parts_j[idx].x[1] - total_cj_shift[1]);
+      zj[i] = (float)(parts_j[idx].x[2] - total_cj_shift[2]);
+      hj[i] = parts_j[idx].h;
+      vxj[i] = parts_j[idx].v[0];
+      vyj[i] = parts_j[idx].v[1];
+      vzj[i] = parts_j[idx].v[2];
+#if defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH)
+      mj[i] = parts_j[idx].mass;
+#endif
+#ifdef ANARCHY_PU_SPH
+      uj[i] = parts_j[idx].u;
+#endif
+    }
   }
 
 #ifdef SWIFT_DEBUG_CHECKS
@@ -838,6 +1051,9 @@ __attribute__((always_inline)) INLINE void cache_read_two_partial_cells_sorted(
     vxj[i] = 1.f;
     vyj[i] = 1.f;
     vzj[i] = 1.f;
+#ifdef ANARCHY_PU_SPH
+    uj[i] = 1.f;
+#endif
   }
 }
 
@@ -914,6 +1130,17 @@ cache_read_two_partial_cells_sorted_force(
                             SWIFT_CACHE_ALIGNMENT);
   swift_declare_aligned_ptr(float, soundspeed, ci_cache->soundspeed,
                             SWIFT_CACHE_ALIGNMENT);
+#ifdef ANARCHY_PU_SPH
+  swift_declare_aligned_ptr(float, u, ci_cache->u, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, pressure_bar, ci_cache->pressure_bar,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, v_sig, ci_cache->v_sig,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, alpha_visc, ci_cache->alpha_visc,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, alpha_diff, ci_cache->alpha_diff,
+                            SWIFT_CACHE_ALIGNMENT);
+#endif
 
   int ci_cache_count = ci->hydro.count - first_pi_align;
   const double max_dx = max(ci->hydro.dx_max_part, cj->hydro.dx_max_part);
@@ -943,6 +1170,13 @@ cache_read_two_partial_cells_sorted_force(
       pOrho2[i] = 1.f;
       balsara[i] = 1.f;
       soundspeed[i] = 1.f;
+#ifdef ANARCHY_PU_SPH
+      u[i] = 1.f;
+      pressure_bar[i] = 1.f;
+      v_sig[i] = 1.f;
+      alpha_visc[i] = 1.f;
+      alpha_diff[i] = 1.f;
+#endif
 
       continue;
     }
@@ -954,13 +1188,21 @@ cache_read_two_partial_cells_sorted_force(
     vx[i] = parts_i[idx].v[0];
     vy[i] = parts_i[idx].v[1];
     vz[i] = parts_i[idx].v[2];
-#ifdef GADGET2_SPH
+#if defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH)
     m[i] = parts_i[idx].mass;
     rho[i] = parts_i[idx].rho;
     grad_h[i] = parts_i[idx].force.f;
-    pOrho2[i] = parts_i[idx].force.P_over_rho2;
     balsara[i] = parts_i[idx].force.balsara;
     soundspeed[i] = parts_i[idx].force.soundspeed;
+#endif
+#ifdef GADGET2_SPH
+    pOrho2[i] = parts_i[idx].force.P_over_rho2;
+#elif defined(ANARCHY_PU_SPH)
+    u[i] = parts_i[idx].u;
+    pressure_bar[i] = parts_i[idx].pressure_bar;
+    v_sig[i] = parts_i[idx].viscosity.v_sig;
+    alpha_visc[i] = parts_i[idx].viscosity.alpha;
+    alpha_diff[i] = parts_i[idx].diffusion.alpha;
 #endif
   }
 
@@ -982,6 +1224,13 @@ cache_read_two_partial_cells_sorted_force(
     pOrho2[i] = 1.f;
     balsara[i] = 1.f;
     soundspeed[i] = 1.f;
+#ifdef ANARCHY_PU_SPH
+    u[i] = 1.f;
+    pressure_bar[i] = 1.f;
+    v_sig[i] = 1.f;
+    alpha_visc[i] = 1.f;
+    alpha_diff[i] = 1.f;
+#endif
   }
 
   /* Let the compiler know that the data is aligned and create pointers to the
@@ -1003,6 +1252,17 @@ cache_read_two_partial_cells_sorted_force(
                             SWIFT_CACHE_ALIGNMENT);
   swift_declare_aligned_ptr(float, soundspeedj, cj_cache->soundspeed,
                             SWIFT_CACHE_ALIGNMENT);
+#ifdef ANARCHY_PU_SPH
+  swift_declare_aligned_ptr(float, uj, cj_cache->u, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, pressure_barj, cj_cache->pressure_bar,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, v_sigj, cj_cache->v_sig,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, alpha_viscj, cj_cache->alpha_visc,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, alpha_diffj, cj_cache->alpha_diff,
+                            SWIFT_CACHE_ALIGNMENT);
+#endif
 
   const float pos_padded_j[3] = {-(2. * cj->width[0] + max_dx),
                                  -(2. * cj->width[1] + max_dx),
@@ -1027,6 +1287,13 @@ cache_read_two_partial_cells_sorted_force(
       pOrho2j[i] = 1.f;
       balsaraj[i] = 1.f;
       soundspeedj[i] = 1.f;
+#ifdef ANARCHY_PU_SPH
+      uj[i] = 1.f;
+      pressure_barj[i] = 1.f;
+      v_sigj[i] = 1.f;
+      alpha_viscj[i] = 1.f;
+      alpha_diffj[i] = 1.f;
+#endif
 
       continue;
     }
@@ -1038,13 +1305,21 @@ cache_read_two_partial_cells_sorted_force(
     vxj[i] = parts_j[idx].v[0];
     vyj[i] = parts_j[idx].v[1];
     vzj[i] = parts_j[idx].v[2];
-#ifdef GADGET2_SPH
+#if defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH)
     mj[i] = parts_j[idx].mass;
     rhoj[i] = parts_j[idx].rho;
     grad_hj[i] = parts_j[idx].force.f;
-    pOrho2j[i] = parts_j[idx].force.P_over_rho2;
     balsaraj[i] = parts_j[idx].force.balsara;
     soundspeedj[i] = parts_j[idx].force.soundspeed;
+#endif
+#ifdef GADGET2_SPH
+    pOrho2j[i] = parts_j[idx].force.P_over_rho2;
+#elif defined(ANARCHY_PU_SPH)
+    uj[i] = parts_j[idx].u;
+    pressure_barj[i] = parts_j[idx].pressure_bar;
+    v_sigj[i] = parts_j[idx].viscosity.v_sig;
+    alpha_viscj[i] = parts_j[idx].viscosity.alpha;
+    alpha_diffj[i] = parts_j[idx].diffusion.alpha;
 #endif
   }
 
@@ -1065,6 +1340,13 @@ cache_read_two_partial_cells_sorted_force(
     pOrho2j[i] = 1.f;
     balsaraj[i] = 1.f;
     soundspeedj[i] = 1.f;
+#ifdef ANARCHY_PU_SPH
+    uj[i] = 1.f;
+    pressure_barj[i] = 1.f;
+    v_sigj[i] = 1.f;
+    alpha_viscj[i] = 1.f;
+    alpha_diffj[i] = 1.f;
+#endif
   }
 }
 
@@ -1089,6 +1371,11 @@ static INLINE void cache_clean(struct cache *c) {
     free(c->pOrho2);
     free(c->balsara);
     free(c->soundspeed);
+    free(c->u);
+    free(c->pressure_bar);
+    free(c->v_sig);
+    free(c->alpha_visc);
+    free(c->alpha_diff);
   }
   c->count = 0;
 }
@@ -91,4 +91,51 @@ __attribute__((always_inline)) INLINE static float icbrtf(float x_in) {
   return res;
 }
 
+#ifdef WITH_VECTORIZATION
+
+#include "vector.h"
+
+/**
+ * @brief Compute the inverse cube root of single-precision floating-point
+ * numbers (vector version).
+ *
+ * The first guess comes from the bits of the input read as an integer, which
+ * are close to a scaled and shifted log2(x), and is then refined with three
+ * Newton iterations. Only floating-point operations and conversions are
+ * needed. The relative error is smaller than 1 * 10^-6, as for icbrtf().
+ *
+ * This function does not care about zero or non-finite inputs.
+ *
+ * @param x_in The input values.
+ *
+ * @return The inverse cubic roots of @c x_in.
+ */
+__attribute__((always_inline)) INLINE static vector icbrtf_vec(
+    const vector x_in) {
+
+  /* First guess from the bits of |x|: y ~ 2^(-log2(|x|) / 3). |x| is taken
+   * as max(x, -x) since vec_fabs() needs AVX512DQ on AVX512 builds. */
+  vector abs_x, y;
+  abs_x.v = vec_fmax(x_in.v, vec_mul(x_in.v, vec_set1(-1.f)));
+  y.v = vec_itof(abs_x.m);
+  y.m = vec_ftoi(vec_fnma(y.v, vec_set1(1.f / 3.f), vec_set1(1419993600.f)));
+
+  /* Give it the sign of x. */
+  mask_t negative;
+  vec_create_mask(negative, vec_cmp_lt(x_in.v, vec_setzero()));
+  y.v = vec_blend(negative, y.v, vec_mul(y.v, vec_set1(-1.f)));
+
+  /* Newton iterations: y *= (4 - x * y^3) / 3. */
+  for (int k = 0; k < 3; k++) {
+    vector y3;
+    y3.v = vec_mul(vec_mul(y.v, y.v), y.v);
+    y.v = vec_mul(vec_mul(y.v, vec_set1(1.f / 3.f)),
+                  vec_fnma(x_in.v, y3.v, vec_set1(4.f)));
+  }
+
+  return y;
+}
+
+#endif /* WITH_VECTORIZATION */
+
 #endif /* SWIFT_CBRT_H */
@@ -59,6 +59,7 @@
 #include "gravity.h"
 #include "hydro.h"
 #include "hydro_properties.h"
+#include "lightcone.h"
 #include "memswap.h"
 #include "minmax.h"
 #include "scheduler.h"
@@ -309,6 +310,20 @@ int cell_link_bparts(struct cell *c, struct bpart *bparts) {
   return c->black_holes.count;
 }
 
+/**
+ * @brief Sets the queue owning a cell and all its progeny.
+ *
+ * @param c The #cell.
+ * @param owner The queue.
+ */
+void cell_set_owner(struct cell *c, const int owner) {
+
+  c->owner = owner;
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL) cell_set_owner(c->progeny[k], owner);
+}
+
 /**
  * @brief Recurse down foreign cells until reaching one with hydro
  * tasks; then trigger the linking of the #part array from that
@@ -729,6 +744,133 @@ int cell_unpack_tags(const int *tags, struct cell *restrict c) {
 #endif
 }
 
+/**
+ * @brief Size in bytes per particle of the compact hydro communications.
+ *
+ * @param subtype The communication sub-type (xv, rho or gradient).
+ */
+size_t cell_pack_hydro_size(const int subtype) {
+
+#if hydro_has_compact_mpi
+  switch (subtype) {
+    case task_subtype_xv:
+      return sizeof(struct xv_part_pack);
+    case task_subtype_rho:
+      return sizeof(struct rho_part_pack);
+#ifdef EXTRA_HYDRO_LOOP
+    case task_subtype_gradient:
+      return sizeof(struct gradient_part_pack);
+#endif
+    default:
+      error("Invalid communication sub-type (%d).", subtype);
+      return 0;
+  }
+#else
+  error("The hydro scheme does not support compact communications.");
+  return 0;
+#endif
+}
+
+/**
+ * @brief Pack the fields of the particles of a cell needed by the foreign
+ * hydro loops of the given communication sub-type.
+ *
+ * @param c The #cell.
+ * @param buff (output) The buffer of #cell_pack_hydro_size(subtype) bytes per
+ * particle to pack into.
+ * @param subtype The communication sub-type (xv, rho or gradient).
+ */
+void cell_pack_hydro(const struct cell *c, void *buff, const int subtype) {
+
+#if hydro_has_compact_mpi
+  const struct part *parts = c->hydro.parts;
+  const int count = c->hydro.count;
+
+  if (subtype == task_subtype_xv) {
+    struct xv_part_pack *pack = (struct xv_part_pack *)buff;
+    for (int k = 0; k < count; k++) {
+      const struct part *p = &parts[k];
+      pack[k].x[0] = p->x[0];
+      pack[k].x[1] = p->x[1];
+      pack[k].x[2] = p->x[2];
+      pack[k].id = p->id;
+      pack[k].v[0] = p->v[0];
+      pack[k].v[1] = p->v[1];
+      pack[k].v[2] = p->v[2];
+      pack[k].h = p->h;
+      pack[k].mass = p->mass;
+      pack[k].chemistry_data = p->chemistry_data;
+      pack[k].time_bin = p->time_bin;
+#ifdef SWIFT_DEBUG_CHECKS
+      pack[k].ti_drift = p->ti_drift;
+#endif
+    }
+  } else if (subtype == task_subtype_rho) {
+    struct rho_part_pack *pack = (struct rho_part_pack *)buff;
+    for (int k = 0; k < count; k++) hydro_pack_rho(&parts[k], &pack[k]);
+#ifdef EXTRA_HYDRO_LOOP
+  } else if (subtype == task_subtype_gradient) {
+    struct gradient_part_pack *pack = (struct gradient_part_pack *)buff;
+    for (int k = 0; k < count; k++) hydro_pack_gradient(&parts[k], &pack[k]);
+#endif
+  } else {
+    error("Invalid communication sub-type (%d).", subtype);
+  }
+#else
+  error("The hydro scheme does not support compact communications.");
+#endif
+}
+
+/**
+ * @brief Unpack the fields received by a compact hydro communication into
+ * the particles of a foreign cell.
+ *
+ * @param c The foreign #cell.
+ * @param buff The buffer filled by #cell_pack_hydro on the sending side.
+ * @param subtype The communication sub-type (xv, rho or gradient).
+ */
+void cell_unpack_hydro(struct cell *c, const void *buff, const int subtype) {
+
+#if hydro_has_compact_mpi
+  struct part *parts = c->hydro.parts;
+  const int count = c->hydro.count;
+
+  if (subtype == task_subtype_xv) {
+    const struct xv_part_pack *pack = (const struct xv_part_pack *)buff;
+    for (int k = 0; k < count; k++) {
+      struct part *p = &parts[k];
+      p->x[0] = pack[k].x[0];
+      p->x[1] = pack[k].x[1];
+      p->x[2] = pack[k].x[2];
+      p->id = pack[k].id;
+      p->v[0] = pack[k].v[0];
+      p->v[1] = pack[k].v[1];
+      p->v[2] = pack[k].v[2];
+      p->h = pack[k].h;
+      p->mass = pack[k].mass;
+      p->chemistry_data = pack[k].chemistry_data;
+      p->time_bin = pack[k].time_bin;
+#ifdef SWIFT_DEBUG_CHECKS
+      p->ti_drift = pack[k].ti_drift;
+#endif
+    }
+  } else if (subtype == task_subtype_rho) {
+    const struct rho_part_pack *pack = (const struct rho_part_pack *)buff;
+    for (int k = 0; k < count; k++) hydro_unpack_rho(&parts[k], &pack[k]);
+#ifdef EXTRA_HYDRO_LOOP
+  } else if (subtype == task_subtype_gradient) {
+    const struct gradient_part_pack *pack =
+        (const struct gradient_part_pack *)buff;
+    for (int k = 0; k < count; k++) hydro_unpack_gradient(&parts[k], &pack[k]);
+#endif
+  } else {
+    error("Invalid communication sub-type (%d).", subtype);
+  }
+#else
+  error("The hydro scheme does not support compact communications.");
+#endif
+}
+
 /**
  * @brief Pack the time information of the given cell and all it's sub-cells.
  *
@@ -1038,7 +1180,7 @@ int cell_unpack_multipoles(struct cell *restrict c,
 #ifdef WITH_MPI
 
   /* Unpack this cell's data. */
-  *c->grav.multipole = pcells[0];
+  gravity_tensors_mpi_copy(c->grav.multipole, &pcells[0]);
 
   /* Fill in the progeny, depth-first recursion. */
   int count = 1;
@@ -1889,6 +2031,114 @@ void cell_clean_links(struct cell *c, void *data) {
   c->black_holes.feedback = NULL;
 }
 
+/**
+ * @brief Clears all the pointers to tasks and task links in a given cell.
+ *
+ * The super-cell pointers are left untouched.
+ *
+ * @param c Cell to act upon
+ * @param data Unused parameter
+ */
+void cell_clean_task_pointers(struct cell *c, void *data) {
+  cell_clean_links(c, data);
+  c->hydro.sorts = NULL;
+  c->hydro.drift = NULL;
+  c->hydro.ghost_in = NULL;
+  c->hydro.ghost_out = NULL;
+  c->hydro.ghost = NULL;
+  c->hydro.extra_ghost = NULL;
+  c->hydro.end_force = NULL;
+  c->hydro.cooling = NULL;
+  c->hydro.star_formation = NULL;
+  c->grav.drift = NULL;
+  c->grav.drift_out = NULL;
+  c->grav.init = NULL;
+  c->grav.init_out = NULL;
+  c->grav.long_range = NULL;
+  c->grav.down_in = NULL;
+  c->grav.mesh = NULL;
+  c->grav.down = NULL;
+  c->grav.end_force = NULL;
+  c->stars.ghost = NULL;
+  c->stars.sorts = NULL;
+  c->stars.drift = NULL;
+  c->stars.stars_in = NULL;
+  c->stars.stars_out = NULL;
+  c->black_holes.drift = NULL;
+  c->black_holes.black_holes_in = NULL;
+  c->black_holes.black_holes_out = NULL;
+  c->black_holes.ghost = NULL;
+  c->kick1 = NULL;
+  c->kick2 = NULL;
+  c->timestep = NULL;
+  c->timestep_limiter = NULL;
+  c->logger = NULL;
+#ifdef WITH_MPI
+  c->mpi.send = NULL;
+#endif
+  c->nr_tasks = 0;
+  c->grav.nr_mm_tasks = 0;
+}
+
+/**
+ * @brief Copies all the pointers to tasks and task links from one cell to
+ * another.
+ *
+ * The super-cell pointers are not copied.
+ *
+ * @param dst Cell to copy to.
+ * @param src Cell to copy from.
+ */
+void cell_copy_task_pointers(struct cell *dst, const struct cell *src) {
+  dst->hydro.density = src->hydro.density;
+  dst->hydro.gradient = src->hydro.gradient;
+  dst->hydro.force = src->hydro.force;
+  dst->hydro.limiter = src->hydro.limiter;
+  dst->grav.grav = src->grav.grav;
+  dst->grav.mm = src->grav.mm;
+  dst->stars.density = src->stars.density;
+  dst->stars.feedback = src->stars.feedback;
+  dst->black_holes.density = src->black_holes.density;
+  dst->black_holes.feedback = src->black_holes.feedback;
+  dst->hydro.sorts = src->hydro.sorts;
+  dst->hydro.drift = src->hydro.drift;
+  dst->hydro.ghost_in = src->hydro.ghost_in;
+  dst->hydro.ghost_out = src->hydro.ghost_out;
+  dst->hydro.ghost = src->hydro.ghost;
+  dst->hydro.extra_ghost = src->hydro.extra_ghost;
+  dst->hydro.end_force = src->hydro.end_force;
+  dst->hydro.cooling = src->hydro.cooling;
+  dst->hydro.star_formation = src->hydro.star_formation;
+  dst->grav.drift = src->grav.drift;
+  dst->grav.drift_out = src->grav.drift_out;
+  dst->grav.init = src->grav.init;
+  dst->grav.init_out = src->grav.init_out;
+  dst->grav.long_range = src->grav.long_range;
+  dst->grav.down_in = src->grav.down_in;
+  dst->grav.mesh = src->grav.mesh;
+  dst->grav.down = src->grav.down;
+  dst->grav.end_force = src->grav.end_force;
+  dst->stars.ghost = src->stars.ghost;
+  dst->stars.sorts = src->stars.sorts;
+  dst->stars.drift = src->stars.drift;
+  dst->stars.stars_in = src->stars.stars_in;
+  dst->stars.stars_out = src->stars.stars_out;
+  dst->black_holes.drift = src->black_holes.drift;
+  dst->black_holes.black_holes_in = src->black_holes.black_holes_in;
+  dst->black_holes.black_holes_out = src->black_holes.black_holes_out;
+  dst->black_holes.ghost = src->black_holes.ghost;
+  dst->kick1 = src->kick1;
+  dst->kick2 = src->kick2;
+  dst->timestep = src->timestep;
+  dst->timestep_limiter = src->timestep_limiter;
+  dst->logger = src->logger;
+#ifdef WITH_MPI
+  dst->mpi.send = src->mpi.send;
+#endif
+  dst->nr_tasks = src->nr_tasks;
+  dst->grav.nr_mm_tasks = src->grav.nr_mm_tasks;
+}
+
 /**
  * @brief Checks that the #part in a cell are at the
  * current point in time
@@ -2064,6 +2314,7 @@ void cell_make_multipoles(struct cell *c, integertime_t ti_current) {
     /* Compute CoM of all progenies */
     double CoM[3] = {0., 0., 0.};
     double mass = 0.;
+    float min_old_a_grav_norm = FLT_MAX;
 
     for (int k = 0; k < 8; ++k) {
       if (c->progeny[k] != NULL) {
@@ -2072,6 +2323,9 @@ void cell_make_multipoles(struct cell *c, integertime_t ti_current) {
         CoM[1] += m->CoM[1] * m->m_pole.M_000;
         CoM[2] += m->CoM[2] * m->m_pole.M_000;
         mass += m->m_pole.M_000;
+        if (m->m_pole.M_000 != 0.f)
+          min_old_a_grav_norm =
+              min(m->m_pole.min_old_a_grav_norm, min_old_a_grav_norm);
       }
     }
 
@@ -2103,6 +2357,10 @@ void cell_make_multipoles(struct cell *c, integertime_t ti_current) {
         r_max = max(r_max, cp->grav.multipole->r_max + sqrt(r2));
       }
     }
+
+    /* Minimal acceleration norm of all the progenies */
+    c->grav.multipole->m_pole.min_old_a_grav_norm = min_old_a_grav_norm;
+
     /* Alternative upper limit of max CoM<->gpart distance */
     const double dx = c->grav.multipole->CoM[0] > c->loc[0] + c->width[0] * 0.5
                           ? c->grav.multipole->CoM[0] - c->loc[0]
@@ -2244,6 +2502,8 @@ void cell_check_multipole(struct cell *c) {
 void cell_clean(struct cell *c) {
   /* Hydro */
   cell_free_hydro_sorts(c);
+  cell_free_hydro_bins(c);
+  cell_free_hydro_soa(c);
 
   /* Stars */
   cell_free_stars_sorts(c);
@@ -2454,6 +2714,17 @@ void cell_activate_drift_bpart(struct cell *c, struct scheduler *s) {
  * @brief Activate the drifts on the given cell.
  */
 void cell_activate_limiter(struct cell *c, struct scheduler *s) {
+
+  /* With the sparse limiter, the limiter loop marks the cells to visit. */
+  if (s->space->e->hydro_properties->sparse_limiter) {
+#ifdef SWIFT_DEBUG_CHECKS
+    if (c->super->timestep_limiter == NULL)
+      error("Trying to activate un-existing c->super->timestep_limiter");
+#endif
+    scheduler_activate(s, c->super->timestep_limiter);
+    return;
+  }
+
   /* If this cell is already marked for limiting, quit early. */
   if (cell_get_flag(c, cell_flag_do_hydro_limiter)) return;
 
@@ -2488,6 +2759,31 @@ void cell_activate_limiter(struct cell *c, struct scheduler *s) {
   }
 }
 
+/**
+ * @brief Marks a cell in which the limiter loop may have woken up some
+ * particles, so that the time-step limiter visits it.
+ *
+ * Only used by the sparse limiter. This is called by the limiter loop tasks,
+ * which all run before the time-step limiter of the super-cell.
+ */
+void cell_mark_for_limiter(struct cell *c) {
+
+  /* If this cell is already marked for limiting, quit early. */
+  if (cell_get_flag(c, cell_flag_do_hydro_limiter)) return;
+
+  /* Mark this cell for limiting. */
+  cell_set_flag(c, cell_flag_do_hydro_limiter);
+
+  /* Set the do_sub_limiter all the way up to the super-cell. */
+  if (c == c->super) return;
+  for (struct cell *parent = c->parent;
+       parent != NULL && !cell_get_flag(parent, cell_flag_do_hydro_sub_limiter);
+       parent = parent->parent) {
+    cell_set_flag(parent, cell_flag_do_hydro_sub_limiter);
+    if (parent == c->super) break;
+  }
+}
+
 /**
  * @brief Activate the sorts up a cell hierarchy.
  */
@@ -2675,11 +2971,16 @@ void cell_activate_subcell_hydro_tasks(struct cell *ci, struct cell *cj,
 
     /* Otherwise, activate the sorts and drifts. */
     else if (cell_is_active_hydro(ci, e) || cell_is_active_hydro(cj, e)) {
+      /* Small pairs are interacted without sorting the cells. */
+      const int with_sorts = !cell_pair_skips_hydro_sorts(ci, cj);
+
       /* We are going to interact this pair, so store some values. */
-      atomic_or(&ci->hydro.requires_sorts, 1 << sid);
-      atomic_or(&cj->hydro.requires_sorts, 1 << sid);
-      ci->hydro.dx_max_sort_old = ci->hydro.dx_max_sort;
-      cj->hydro.dx_max_sort_old = cj->hydro.dx_max_sort;
+      if (with_sorts) {
+        atomic_or(&ci->hydro.requires_sorts, 1 << sid);
+        atomic_or(&cj->hydro.requires_sorts, 1 << sid);
+        ci->hydro.dx_max_sort_old = ci->hydro.dx_max_sort;
+        cj->hydro.dx_max_sort_old = cj->hydro.dx_max_sort;
+      }
 
       /* Activate the drifts if the cells are local. */
       if (ci->nodeID == engine_rank) cell_activate_drift_part(ci, s);
@@ -2692,12 +2993,36 @@ void cell_activate_subcell_hydro_tasks(struct cell *ci, struct cell *cj,
         cell_activate_limiter(cj, s);
 
       /* Do we need to sort the cells? */
-      cell_activate_hydro_sorts(ci, sid, s);
-      cell_activate_hydro_sorts(cj, sid, s);
+      if (with_sorts) {
+        cell_activate_hydro_sorts(ci, sid, s);
+        cell_activate_hydro_sorts(cj, sid, s);
+      }
     }
   } /* Otherwise, pair interation */
 }
 
+/**
+ * @brief Does a cell need the stars loops of one of its tasks?
+ *
+ * The cells without any star that can still do feedback are skipped, but only
+ * for tasks involving local cells alone, as the flag is not known on the other
+ * nodes and they must take the same decision.
+ *
+ * @param c The #cell.
+ * @param e The #engine.
+ * @param all_local Are all the cells of the task local?
+ * @param with_star_formation Are we running with star formation switched on?
+ */
+__attribute__((always_inline)) INLINE static int cell_need_stars_loops(
+    const struct cell *c, const struct engine *e, const int all_local,
+    const int with_star_formation) {
+
+  const int stars_active = all_local ? cell_is_active_stars_feedback(c, e)
+                                     : cell_is_active_stars(c, e);
+
+  return stars_active || (with_star_formation && cell_is_active_hydro(c, e));
+}
+
 /**
  * @brief Traverse a sub-cell task and activate the stars drift tasks that are
  * required by a stars task
@@ -2725,11 +3050,14 @@ void cell_activate_subcell_stars_tasks(struct cell *ci, struct cell *cj,
     cj->hydro.h_max_old = cj->hydro.h_max;
   }
 
+  const int all_local =
+      (ci->nodeID == e->nodeID) && (cj == NULL || cj->nodeID == e->nodeID);
+
   /* Self interaction? */
   if (cj == NULL) {
 
-    const int ci_active = cell_is_active_stars(ci, e) ||
-                          (with_star_formation && cell_is_active_hydro(ci, e));
+    const int ci_active =
+        cell_need_stars_loops(ci, e, all_local, with_star_formation);
 
     /* Do anything? */
     if (!ci_active || ci->hydro.count == 0 ||
@@ -2763,10 +3091,10 @@ void cell_activate_subcell_stars_tasks(struct cell *ci, struct cell *cj,
     double shift[3];
     const int sid = space_getsid(s->space, &ci, &cj, shift);
 
-    const int ci_active = cell_is_active_stars(ci, e) ||
-                          (with_star_formation && cell_is_active_hydro(ci, e));
-    const int cj_active = cell_is_active_stars(cj, e) ||
-                          (with_star_formation && cell_is_active_hydro(cj, e));
+    const int ci_active =
+        cell_need_stars_loops(ci, e, all_local, with_star_formation);
+    const int cj_active =
+        cell_need_stars_loops(cj, e, all_local, with_star_formation);
 
     /* Should we even bother? */
     if (!ci_active && !cj_active) return;
@@ -2965,15 +3293,9 @@ void cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
       return;
     if (ci->grav.count == 0 || cj->grav.count == 0) return;
 
-    /* Atomically drift the multipole in ci */
-    lock_lock(&ci->grav.mlock);
-    if (ci->grav.ti_old_multipole < e->ti_current) cell_drift_multipole(ci, e);
-    if (lock_unlock(&ci->grav.mlock) != 0) error("Impossible to unlock m-pole");
-
-    /* Atomically drift the multipole in cj */
-    lock_lock(&cj->grav.mlock);
-    if (cj->grav.ti_old_multipole < e->ti_current) cell_drift_multipole(cj, e);
-    if (lock_unlock(&cj->grav.mlock) != 0) error("Impossible to unlock m-pole");
+    /* Atomically drift the multipoles of ci and cj */
+    cell_drift_multipole_on_use(ci, e);
+    cell_drift_multipole_on_use(cj, e);
 
     /* Can we use multipoles ? */
     if (cell_can_use_pair_mm(ci, cj, e, sp)) {
@@ -3115,11 +3437,16 @@ int cell_unskip_hydro_tasks(struct cell *c, struct scheduler *s) {
 
       /* Set the correct sorting flags and activate hydro drifts */
       else if (t->type == task_type_pair) {
+        /* Small pairs are interacted without sorting the cells. */
+        const int with_sorts = !cell_pair_skips_hydro_sorts(ci, cj);
+
         /* Store some values. */
-        atomic_or(&ci->hydro.requires_sorts, 1 << t->flags);
-        atomic_or(&cj->hydro.requires_sorts, 1 << t->flags);
-        ci->hydro.dx_max_sort_old = ci->hydro.dx_max_sort;
-        cj->hydro.dx_max_sort_old = cj->hydro.dx_max_sort;
+        if (with_sorts) {
+          atomic_or(&ci->hydro.requires_sorts, 1 << t->flags);
+          atomic_or(&cj->hydro.requires_sorts, 1 << t->flags);
+          ci->hydro.dx_max_sort_old = ci->hydro.dx_max_sort;
+          cj->hydro.dx_max_sort_old = cj->hydro.dx_max_sort;
+        }
 
         /* Activate the drift tasks. */
         if (ci_nodeID == nodeID) cell_activate_drift_part(ci, s);
@@ -3130,8 +3457,10 @@ int cell_unskip_hydro_tasks(struct cell *c, struct scheduler *s) {
         if (cj_nodeID == nodeID && with_limiter) cell_activate_limiter(cj, s);
 
         /* Check the sorts and activate them if needed. */
-        cell_activate_hydro_sorts(ci, t->flags, s);
-        cell_activate_hydro_sorts(cj, t->flags, s);
+        if (with_sorts) {
+          cell_activate_hydro_sorts(ci, t->flags, s);
+          cell_activate_hydro_sorts(cj, t->flags, s);
+        }
       }
 
       /* Store current values of dx_max and h_max. */
@@ -3512,12 +3841,15 @@ int cell_unskip_stars_tasks(struct cell *c, struct scheduler *s,
     const int cj_nodeID = nodeID;
 #endif
 
-    const int ci_active = cell_is_active_stars(ci, e) ||
-                          (with_star_formation && cell_is_active_hydro(ci, e));
+    const int all_local =
+        (ci_nodeID == nodeID) && (cj == NULL || cj_nodeID == nodeID);
+
+    const int ci_active =
+        cell_need_stars_loops(ci, e, all_local, with_star_formation);
 
     const int cj_active =
-        (cj != NULL) && (cell_is_active_stars(cj, e) ||
-                         (with_star_formation && cell_is_active_hydro(cj, e)));
+        (cj != NULL) &&
+        cell_need_stars_loops(cj, e, all_local, with_star_formation);
 
     /* Activate the drifts */
     if (t->type == task_type_self && ci_active) {
@@ -3666,12 +3998,15 @@ int cell_unskip_stars_tasks(struct cell *c, struct scheduler *s,
     const int cj_nodeID = nodeID;
 #endif
 
-    const int ci_active = cell_is_active_stars(ci, e) ||
-                          (with_star_formation && cell_is_active_hydro(ci, e));
+    const int all_local =
+        (ci_nodeID == nodeID) && (cj == NULL || cj_nodeID == nodeID);
+
+    const int ci_active =
+        cell_need_stars_loops(ci, e, all_local, with_star_formation);
 
     const int cj_active =
-        (cj != NULL) && (cell_is_active_stars(cj, e) ||
-                         (with_star_formation && cell_is_active_hydro(cj, e)));
+        (cj != NULL) &&
+        cell_need_stars_loops(cj, e, all_local, with_star_formation);
 
     if (t->type == task_type_self && ci_active) {
       scheduler_activate(s, t);
@@ -3701,12 +4036,16 @@ int cell_unskip_stars_tasks(struct cell *c, struct scheduler *s,
 
   /* Unskip all the other task types. */
   if (c->nodeID == nodeID) {
-    if (cell_is_active_stars(c, e) ||
-        (with_star_formation && cell_is_active_hydro(c, e))) {
+    if (cell_need_stars_loops(c, e, /*all_local=*/1, with_star_formation)) {
 
       if (c->stars.ghost != NULL) scheduler_activate(s, c->stars.ghost);
       if (c->stars.stars_in != NULL) scheduler_activate(s, c->stars.stars_in);
       if (c->stars.stars_out != NULL) scheduler_activate(s, c->stars.stars_out);
+    }
+
+    if (cell_is_active_stars(c, e) ||
+        (with_star_formation && cell_is_active_hydro(c, e))) {
+
       if (c->kick1 != NULL) scheduler_activate(s, c->kick1);
       if (c->kick2 != NULL) scheduler_activate(s, c->kick2);
       if (c->timestep != NULL) scheduler_activate(s, c->timestep);
@@ -4215,6 +4554,11 @@ void cell_drift_part(struct cell *c, const struct engine *e, int force) {
       }
     }
 
+    /* Record the particles without a gpart that crossed the light cone */
+    if (e->lightcone_properties->enabled)
+      lightcone_check_parts(e->lightcone_properties, e, parts, xparts,
+                            nr_parts, dt_drift, ti_old_part, ti_current);
+
     /* Now, get the maximal particle motion from its square */
     dx_max = sqrtf(dx2_max);
     dx_max_sort = sqrtf(dx2_max_sort);
@@ -4341,6 +4685,11 @@ void cell_drift_gpart(struct cell *c, const struct engine *e, int force) {
       }
     }
 
+    /* Record the particles that crossed the light cone */
+    if (e->lightcone_properties->enabled)
+      lightcone_check_gparts(e->lightcone_properties, e, gparts, nr_gparts,
+                             dt_drift, ti_old_gpart, ti_current);
+
     /* Update the time of the last drift */
     c->grav.ti_old_part = ti_current;
   }
@@ -4706,16 +5055,17 @@ void cell_drift_all_multipoles(struct cell *c, const struct engine *e) {
 }
 
 /**
- * @brief Drifts the multipole of a cell to the current time.
+ * @brief Drifts the multipole of a cell from a given time to the current time.
  *
- * Only drifts the multipole at this level. Multipoles deeper in the
- * tree are not updated.
+ * Only drifts the multipole at this level and does not update the time of
+ * the last drift.
  *
  * @param c The #cell.
  * @param e The #engine (to get ti_current).
+ * @param ti_old_multipole The time the multipole was last drifted to.
  */
-void cell_drift_multipole(struct cell *c, const struct engine *e) {
-  const integertime_t ti_old_multipole = c->grav.ti_old_multipole;
+static void cell_do_drift_multipole(struct cell *c, const struct engine *e,
+                                    const integertime_t ti_old_multipole) {
   const integertime_t ti_current = e->ti_current;
 
 #ifdef SWIFT_DEBUG_CHECKS
@@ -4732,9 +5082,49 @@ void cell_drift_multipole(struct cell *c, const struct engine *e) {
     dt_drift = (ti_current - ti_old_multipole) * e->time_base;
 
   if (ti_current > ti_old_multipole) gravity_drift(c->grav.multipole, dt_drift);
+}
 
-  /* Update the time of the last drift */
-  c->grav.ti_old_multipole = ti_current;
+/**
+ * @brief Drifts the multipole of a cell to the current time on its first use
+ * in the step.
+ *
+ * The multipoles are not drifted ahead of the gravity tasks. Instead, this is
+ * called before the position or size of a multipole is read. It can be called
+ * by several threads at once on the same cell, including from tasks holding
+ * the m-pole lock of that cell, so it does not use that lock. The first thread
+ * seeing an out-of-date multipole claims it by swapping its drift time for a
+ * marker, drifts it and then publishes the new time. Any other thread only
+ * waits for the duration of that drift.
+ *
+ * @param c The #cell.
+ * @param e The #engine (to get ti_current).
+ */
+void cell_drift_multipole_on_use(struct cell *c, const struct engine *e) {
+
+  const integertime_t ti_current = e->ti_current;
+
+  while (1) {
+
+    const integertime_t ti_old_multipole =
+        atomic_load_acquire(&c->grav.ti_old_multipole);
+
+    /* Already drifted? */
+    if (ti_old_multipole == ti_current) return;
+
+    /* Being drifted by another thread? */
+    if (ti_old_multipole == cell_multipole_drift_in_progress) continue;
+
+    /* Claim the drift of this multipole */
+    if (atomic_cas(&c->grav.ti_old_multipole, ti_old_multipole,
+                   cell_multipole_drift_in_progress) != ti_old_multipole)
+      continue;
+
+    cell_do_drift_multipole(c, e, ti_old_multipole);
+
+    /* Publish the drifted multipole */
+    atomic_store_release(&c->grav.ti_old_multipole, ti_current);
+    return;
+  }
 }
 
 /**
@@ -4900,53 +5290,81 @@ void cell_check_sort_flags(const struct cell *c) {
 }
 
 /**
- * @brief Recursively update the pointer and counter for #spart after the
- * addition of a new particle.
+ * @brief Recursively update the pointer and counter for #spart to open free
+ * slots at the end of a leaf-cell.
+ *
+ * Each leaf stored after the one getting the new particles moves its first
+ * n #spart after its last ones and is shifted by n positions. The leaves are
+ * visited from the last one backwards, such that the slots after each of them
+ * have already been freed by the ones that follow, the last one using the
+ * first extra particles of the top-level cell.
  *
  * @param c The cell we are working on.
  * @param progeny_list The list of the progeny index at each level for the
- * leaf-cell where the particle was added.
+ * leaf-cell where the particles are added.
  * @param main_branch Are we in a cell directly above the leaf where the new
- * particle was added?
+ * particles are added?
+ * @param sparts The global array of #spart (for re-linking).
+ * @param n The number of slots to open.
  */
 void cell_recursively_shift_sparts(struct cell *c,
                                    const int progeny_list[space_cell_maxdepth],
-                                   const int main_branch) {
+                                   const int main_branch,
+                                   struct spart *sparts, const int n) {
   if (c->split) {
-    /* No need to recurse in progenies located before the insestion point */
+    /* No need to recurse in progenies located before the insertion point */
     const int first_progeny = main_branch ? progeny_list[(int)c->depth] : 0;
 
-    for (int k = first_progeny; k < 8; ++k) {
+    for (int k = 7; k >= first_progeny; --k) {
       if (c->progeny[k] != NULL)
         cell_recursively_shift_sparts(c->progeny[k], progeny_list,
-                                      main_branch && (k == first_progeny));
+                                      main_branch && (k == first_progeny),
+                                      sparts, n);
     }
+  } else if (!main_branch && c->stars.count > 0) {
+
+    /* Move the first particles after the last ones, or after the slots if
+     * there are fewer particles than slots */
+    const int nr_moved = min(n, c->stars.count);
+    struct spart *sp = &c->stars.parts[max(n, c->stars.count)];
+    memcpy(sp, &c->stars.parts[0], nr_moved * sizeof(struct spart));
+    for (int k = 0; k < nr_moved; k++)
+      if (sp[k].gpart != NULL)
+        sp[k].gpart->id_or_neg_offset = -(&sp[k] - sparts);
   }
 
-  /* When directly above the leaf with the new particle: increase the particle
+  /* When directly above the leaf with the new particles: increase the particle
    * count */
-  /* When after the leaf with the new particle: shift by one position */
+  /* When after the leaf with the new particles: shift by n positions */
   if (main_branch)
-    c->stars.count++;
+    c->stars.count += n;
   else
-    c->stars.parts++;
+    c->stars.parts += n;
 }
 
 /**
- * @brief "Add" a #spart in a given #cell.
+ * @brief "Add" a batch of #spart in a given #cell.
+ *
+ * This function will add up to n #spart at the end of the current cell's
+ * array by moving the first #spart of each of the following leaves of the
+ * top-level cell to their end, which takes one lock and one pass over the
+ * leaves for the whole batch. All the pointers and cell counts are updated
+ * accordingly.
  *
- * This function will a a #spart at the start of the current cell's array by
- * shifting all the #spart in the top-level cell by one position. All the
- * pointers and cell counts are updated accordingly.
+ * If fewer extra #spart than requested are left in the top-level cell, only
+ * those are added and a rebuild is requested. A rebuild is also requested,
+ * and the number of extra #spart per top-level cell increased, once the cell
+ * runs low on them, such that they get replenished before running out.
  *
  * @param e The #engine.
  * @param c The leaf-cell in which to add the #spart.
+ * @param n The number of #spart wanted.
  *
- * @return A pointer to the newly added #spart. The spart has a been zeroed and
- * given a position within the cell as well as set to the minimal active time
- * bin.
+ * @return The number of #spart added, the last ones of the cell. They have
+ * been zeroed and given a position within the cell as well as set to the
+ * minimal active time bin.
  */
-struct spart *cell_add_spart(struct engine *e, struct cell *const c) {
+int cell_add_sparts(struct engine *e, struct cell *const c, const int n) {
   /* Perform some basic consitency checks */
   if (c->nodeID != engine_rank) error("Adding spart on a foreign node");
   if (c->grav.ti_old_part != e->ti_current) error("Undrifted cell!");
@@ -4985,80 +5403,91 @@ struct spart *cell_add_spart(struct engine *e, struct cell *const c) {
   /* Lock the top-level cell as we are going to operate on it */
   lock_lock(&top->stars.star_formation_lock);
 
-  /* Are there any extra particles left? */
-  if (top->stars.count == top->stars.count_total - 1) {
+  /* Are there enough extra particles left? */
+  const int nr_free = top->stars.count_total - 1 - top->stars.count;
+  const int nr_added = min(n, nr_free);
+  if (nr_added < n) {
+    message("We ran out of star particles!");
+    e->s->extra_sparts_low = 1;
+    atomic_inc(&e->forcerebuild);
+  }
+  if (nr_added <= 0) {
     /* Release the local lock before exiting. */
     if (lock_unlock(&top->stars.star_formation_lock) != 0)
       error("Failed to unlock the top-level cell.");
-    message("We ran out of star particles!");
-    atomic_inc(&e->forcerebuild);
-    return NULL;
+    return 0;
   }
 
-  /* Number of particles to shift in order to get a free space. */
-  const size_t n_copy = &top->stars.parts[top->stars.count] - c->stars.parts;
-
-#ifdef SWIFT_DEBUG_CHECKS
-  if (c->stars.parts + n_copy > top->stars.parts + top->stars.count)
-    error("Copying beyond the allowed range");
-#endif
-
-  if (n_copy > 0) {
-    // MATTHIEU: This can be improved. We don't need to copy everything, just
-    // need to swap a few particles.
-    memmove(&c->stars.parts[1], &c->stars.parts[0],
-            n_copy * sizeof(struct spart));
-
-    /* Update the gpart->spart links (shift by 1) */
-    for (size_t i = 0; i < n_copy; ++i) {
-#ifdef SWIFT_DEBUG_CHECKS
-      if (c->stars.parts[i + 1].gpart == NULL) {
-        error("Incorrectly linked spart!");
-      }
-#endif
-      c->stars.parts[i + 1].gpart->id_or_neg_offset--;
-    }
+  /* Ask for more extra particles at the next rebuild, which we trigger now,
+   * if we are running low on them. */
+  if (nr_free - nr_added <
+      space_extra_sparts_low_fraction * space_extra_sparts) {
+    e->s->extra_sparts_low = 1;
+    if (!e->forcerebuild) atomic_inc(&e->forcerebuild);
   }
 
-  /* Recursively shift all the stars to get a free spot at the start of the
-   * current cell*/
-  cell_recursively_shift_sparts(top, progeny, /* main_branch=*/1);
+  /* Open free spots at the end of the current cell by moving the first stars
+   * of each of the following leaves. */
+  cell_recursively_shift_sparts(top, progeny, /* main_branch=*/1,
+                                e->s->sparts, nr_added);
 
-  /* Make sure the gravity will be recomputed for this particle in the next step
-   */
+  /* Make sure the gravity will be recomputed for these particles in the next
+   * step and that the new stars will do their feedback */
   struct cell *top2 = c;
   while (top2->parent != NULL) {
     top2->stars.ti_old_part = e->ti_current;
+    top2->stars.do_feedback = 1;
     top2 = top2->parent;
   }
   top2->stars.ti_old_part = e->ti_current;
+  top2->stars.do_feedback = 1;
 
   /* Release the lock */
   if (lock_unlock(&top->stars.star_formation_lock) != 0)
     error("Failed to unlock the top-level cell.");
 
-  /* We now have an empty spart as the first particle in that cell */
-  struct spart *sp = &c->stars.parts[0];
-  bzero(sp, sizeof(struct spart));
+  /* We now have empty sparts as the last particles in that cell */
+  for (int k = c->stars.count - nr_added; k < c->stars.count; k++) {
+    struct spart *sp = &c->stars.parts[k];
+    bzero(sp, sizeof(struct spart));
 
-  /* Give it a decent position */
-  sp->x[0] = c->loc[0] + 0.5 * c->width[0];
-  sp->x[1] = c->loc[1] + 0.5 * c->width[1];
-  sp->x[2] = c->loc[2] + 0.5 * c->width[2];
+    /* Give it a decent position */
+    sp->x[0] = c->loc[0] + 0.5 * c->width[0];
+    sp->x[1] = c->loc[1] + 0.5 * c->width[1];
+    sp->x[2] = c->loc[2] + 0.5 * c->width[2];
 
-  /* Set it to the current time-bin */
-  sp->time_bin = e->min_active_bin;
+    /* Set it to the current time-bin */
+    sp->time_bin = e->min_active_bin;
 
 #ifdef SWIFT_DEBUG_CHECKS
-  /* Specify it was drifted to this point */
-  sp->ti_drift = e->ti_current;
+    /* Specify it was drifted to this point */
+    sp->ti_drift = e->ti_current;
 #endif
+  }
 
-  /* Register that we used one of the free slots. */
-  const size_t one = 1;
-  atomic_sub(&e->s->nr_extra_sparts, one);
+  /* Register that we used some of the free slots. */
+  const size_t used = nr_added;
+  atomic_sub(&e->s->nr_extra_sparts, used);
 
-  return sp;
+  return nr_added;
+}
+
+/**
+ * @brief "Add" a #spart in a given #cell.
+ *
+ * See cell_add_sparts().
+ *
+ * @param e The #engine.
+ * @param c The leaf-cell in which to add the #spart.
+ *
+ * @return A pointer to the newly added #spart, NULL if we ran out of them.
+ * The spart has a been zeroed and given a position within the cell as well
+ * as set to the minimal active time bin.
+ */
+struct spart *cell_add_spart(struct engine *e, struct cell *const c) {
+
+  if (cell_add_sparts(e, c, /*n=*/1) == 0) return NULL;
+  return &c->stars.parts[c->stars.count - 1];
 }
 
 /**
@@ -5275,12 +5704,6 @@ struct gpart *cell_convert_spart_to_gpart(const struct engine *e,
  */
 struct spart *cell_convert_part_to_spart(struct engine *e, struct cell *c,
                                          struct part *p, struct xpart *xp) {
-  /* Quick cross-check */
-  if (c->nodeID != e->nodeID)
-    error("Can't remove a particle in a foreign cell.");
-
-  if (p->gpart == NULL)
-    error("Trying to convert part without gpart friend to star!");
 
   /* Create a fresh (empty) spart */
   struct spart *sp = cell_add_spart(e, c);
@@ -5288,6 +5711,32 @@ struct spart *cell_convert_part_to_spart(struct engine *e, struct cell *c,
   /* Did we run out of free spart slots? */
   if (sp == NULL) return NULL;
 
+  cell_convert_part_to_added_spart(e, c, p, xp, sp);
+
+  /* Here comes the Sun! */
+  return sp;
+}
+
+/**
+ * @brief Turn a #part into a #spart already added to the #cell with
+ * cell_add_sparts(), see cell_convert_part_to_spart().
+ *
+ * @param e The #engine.
+ * @param c The #cell from which to remove the #part.
+ * @param p The #part to remove (must be inside c).
+ * @param xp The extended data of the #part.
+ * @param sp The empty #spart added to c.
+ */
+void cell_convert_part_to_added_spart(struct engine *e, struct cell *c,
+                                      struct part *p, struct xpart *xp,
+                                      struct spart *sp) {
+  /* Quick cross-check */
+  if (c->nodeID != e->nodeID)
+    error("Can't remove a particle in a foreign cell.");
+
+  if (p->gpart == NULL)
+    error("Trying to convert part without gpart friend to star!");
+
   /* Copy over the distance since rebuild */
   sp->x_diff[0] = xp->x_diff[0];
   sp->x_diff[1] = xp->x_diff[1];
@@ -5323,9 +5772,6 @@ struct spart *cell_convert_part_to_spart(struct engine *e, struct cell *c,
 
   /* Set a smoothing length */
   sp->h = max(c->stars.h_max, c->hydro.h_max);
-
-  /* Here comes the Sun! */
-  return sp;
 }
 
 /**
@@ -5499,7 +5945,6 @@ void cell_reorder_extra_gparts(struct cell *c, struct part *parts,
  */
 int cell_can_use_pair_mm(const struct cell *ci, const struct cell *cj,
                          const struct engine *e, const struct space *s) {
-  const double theta_crit2 = e->gravity_properties->theta_crit2;
   const int periodic = s->periodic;
   const double dim[3] = {s->dim[0], s->dim[1], s->dim[2]};
 
@@ -5520,7 +5965,8 @@ int cell_can_use_pair_mm(const struct cell *ci, const struct cell *cj,
   }
   const double r2 = dx * dx + dy * dy + dz * dz;
 
-  return gravity_M2L_accept(multi_i->r_max, multi_j->r_max, theta_crit2, r2);
+  return gravity_M2L_accept_adaptive(e->gravity_properties, multi_i, multi_j,
+                                     multi_i->r_max, multi_j->r_max, r2);
 }
 
 /**
@@ -34,8 +34,11 @@
 #include "align.h"
 #include "kernel_hydro.h"
 #include "lock.h"
+#include "hydro_soa.h"
 #include "multipole.h"
+#include "neighbour_list.h"
 #include "part.h"
+#include "sort_arena.h"
 #include "sort_part.h"
 #include "space.h"
 #include "star_formation_logger_struct.h"
@@ -54,6 +57,15 @@ struct scheduler;
 
 #define cell_align 128
 
+/* Packing of the entries of the per-cell time-bin lists: the #part index is
+ * stored above the time-bin, which needs 6 bits. */
+#define cell_bins_shift 6
+#define cell_bins_mask ((1 << cell_bins_shift) - 1)
+
+/* Value of the multipole drift time of a cell while a thread is drifting it
+ * (see cell_drift_multipole_on_use()). */
+#define cell_multipole_drift_in_progress ((integertime_t)-1)
+
 /* Global variables. */
 extern int cell_next_tag;
 
@@ -288,28 +300,26 @@ enum cell_flags {
   cell_flag_do_stars_drift = (1UL << 9),
   cell_flag_do_stars_sub_drift = (1UL << 10),
   cell_flag_do_bh_drift = (1UL << 11),
-  cell_flag_do_bh_sub_drift = (1UL << 12)
+  cell_flag_do_bh_sub_drift = (1UL << 12),
+  cell_flag_do_collect = (1UL << 13) /* Set from the time-step cells up */
 };
 
 /**
  * @brief Cell within the tree structure.
  *
  * Contains particles, links to tasks, a multipole object and counters.
+ *
+ * The tree links, flags, counts and times read by the recursive walks over
+ * the tree (unskipping, drifting, collecting the end of the steps) come first
+ * in the cell and in each of its physics blocks, and the task pointers, sort
+ * arrays and other bulky data used by the tasks themselves come last, so that
+ * the walks only touch the first cache lines of each block.
  */
 struct cell {
 
-  /*! The cell location on the grid. */
-  double loc[3];
-
-  /*! The cell dimensions. */
-  double width[3];
-
   /*! Pointers to the next level of cells. */
   struct cell *progeny[8];
 
-  /*! Linking pointer for "memory management". */
-  struct cell *next;
-
   /*! Parent cell. */
   struct cell *parent;
 
@@ -322,22 +332,95 @@ struct cell {
   /*! Cell flags bit-mask. */
   volatile uint32_t flags;
 
+  /*! ID of the node this cell lives on. */
+  int nodeID;
+
+  /*! Minimum dimension, i.e. smallest edge of this cell (min(width)). */
+  float dmin;
+
+  /*! Number of tasks that are associated with this cell. */
+  short int nr_tasks;
+
+  /*! The depth of this cell in the tree. */
+  char depth;
+
+  /*! Is this cell split ? */
+  char split;
+
+  /*! The maximal depth of this cell and its progenies */
+  char maxdepth;
+
   /*! Hydro variables */
   struct {
 
+    /*! Nr of #part in this cell. */
+    int count;
+
+    /*! Nr of #part this cell can hold after addition of new #part. */
+    int count_total;
+
+    /*! Number of #part updated in this cell. */
+    int updated;
+
+    /*! Number of #part inhibited in this cell. */
+    int inhibited;
+
+    /*! Minimum end of (integer) time step in this cell for hydro tasks. */
+    integertime_t ti_end_min;
+
+    /*! Maximum end of (integer) time step in this cell for hydro tasks. */
+    integertime_t ti_end_max;
+
+    /*! Maximum beginning of (integer) time step in this cell for hydro tasks.
+     */
+    integertime_t ti_beg_max;
+
+    /*! Last (integer) time the cell's part were drifted forward in time. */
+    integertime_t ti_old_part;
+
+    /*! Max smoothing length in this cell. */
+    double h_max;
+
+    /*! Maximum part movement in this cell since last construction. */
+    float dx_max_part;
+
+    /*! Maximum particle movement in this cell since the last sort. */
+    float dx_max_sort;
+
+    /*! Values of h_max before the drifts, used for sub-cell tasks. */
+    float h_max_old;
+
+    /*! Values of dx_max before the drifts, used for sub-cell tasks. */
+    float dx_max_part_old;
+
+    /*! Values of dx_max_sort before the drifts, used for sub-cell tasks. */
+    float dx_max_sort_old;
+
+    /*! Bit mask of sort directions that will be needed in the next timestep. */
+    uint16_t requires_sorts;
+
+    /*! Bit mask of sorts that need to be computed for this cell. */
+    uint16_t do_sort;
+
+    /*! Bit-mask indicating the sorted directions */
+    uint16_t sorted;
+
     /*! Pointer to the #part data. */
     struct part *parts;
 
     /*! Pointer to the #xpart data. */
     struct xpart *xparts;
 
-    /*! Pointer for the sorted indices. */
-    struct entry *sort[13];
-
     /*! Super cell, i.e. the highest-level parent cell that has a hydro
      * pair/self tasks */
     struct cell *super;
 
+    /*! Is the #part data of this cell being used in a sub-cell? */
+    int hold;
+
+    /*! Spin lock for various uses (#part case). */
+    swift_lock_type lock;
+
     /*! The task computing this cell's sorts. */
     struct task *sorts;
 
@@ -377,75 +460,75 @@ struct cell {
     /*! Task for star formation */
     struct task *star_formation;
 
-    /*! Max smoothing length in this cell. */
-    double h_max;
+    /*! Largest signal velocity of the active #part, recorded at the end of
+     * the force loop for the sparse time-step limiter. */
+    float v_sig_max_active;
 
-    /*! Last (integer) time the cell's part were drifted forward in time. */
-    integertime_t ti_old_part;
+    /*! Time at which v_sig_max_active was recorded. */
+    integertime_t ti_v_sig_max_active;
 
-    /*! Minimum end of (integer) time step in this cell for hydro tasks. */
-    integertime_t ti_end_min;
+    /*! Pointer for the sorted indices. */
+    struct entry *sort[13];
 
-    /*! Maximum end of (integer) time step in this cell for hydro tasks. */
-    integertime_t ti_end_max;
+    /*! Indices of the #part in this leaf sorted by time-bin, packed with their
+     * time-bin (see cell_hydro_bins_index()). */
+    int *bins_ind;
 
-    /*! Maximum beginning of (integer) time step in this cell for hydro tasks.
-     */
-    integertime_t ti_beg_max;
+    /*! Number of entries in bins_ind, -1 if the list is not up to date. */
+    int bins_count;
 
-    /*! Spin lock for various uses (#part case). */
-    swift_lock_type lock;
+    /*! Allocated size of bins_ind. */
+    int bins_size;
 
-    /*! Maximum part movement in this cell since last construction. */
-    float dx_max_part;
+    /*! Interaction lists recorded by the gradient loop for the force loop. */
+    struct cell_neighbour_lists *neighbour_lists;
 
-    /*! Maximum particle movement in this cell since the last sort. */
-    float dx_max_sort;
+    /*! Launch in which the neighbour_lists were recorded. */
+    int neighbour_lists_generation;
 
-    /*! Values of h_max before the drifts, used for sub-cell tasks. */
-    float h_max_old;
+    /*! Structure-of-arrays copy of the hot fields of the #part. */
+    struct hydro_soa soa;
 
-    /*! Values of dx_max before the drifts, used for sub-cell tasks. */
-    float dx_max_part_old;
+#ifdef SWIFT_DEBUG_CHECKS
 
-    /*! Values of dx_max_sort before the drifts, used for sub-cell tasks. */
-    float dx_max_sort_old;
+    /*! Last (integer) time the cell's sort arrays were updated. */
+    integertime_t ti_sort;
 
-    /*! Nr of #part in this cell. */
+#endif
+
+  } hydro;
+
+  /*! Grav variables */
+  struct {
+
+    /*! Nr of #gpart in this cell. */
     int count;
 
-    /*! Nr of #part this cell can hold after addition of new #part. */
+    /*! Nr of #gpart this cell can hold after addition of new #gpart. */
     int count_total;
 
-    /*! Number of #part updated in this cell. */
+    /*! Number of #gpart updated in this cell. */
     int updated;
 
-    /*! Number of #part inhibited in this cell. */
+    /*! Number of #gpart inhibited in this cell. */
     int inhibited;
 
-    /*! Is the #part data of this cell being used in a sub-cell? */
-    int hold;
-
-    /*! Bit mask of sort directions that will be needed in the next timestep. */
-    uint16_t requires_sorts;
-
-    /*! Bit mask of sorts that need to be computed for this cell. */
-    uint16_t do_sort;
-
-    /*! Bit-mask indicating the sorted directions */
-    uint16_t sorted;
-
-#ifdef SWIFT_DEBUG_CHECKS
+    /*! Minimum end of (integer) time step in this cell for gravity tasks. */
+    integertime_t ti_end_min;
 
-    /*! Last (integer) time the cell's sort arrays were updated. */
-    integertime_t ti_sort;
+    /*! Maximum end of (integer) time step in this cell for gravity tasks. */
+    integertime_t ti_end_max;
 
-#endif
+    /*! Maximum beginning of (integer) time step in this cell for gravity tasks.
+     */
+    integertime_t ti_beg_max;
 
-  } hydro;
+    /*! Last (integer) time the cell's gpart were drifted forward in time. */
+    integertime_t ti_old_part;
 
-  /*! Grav variables */
-  struct {
+    /*! Last (integer) time the cell's multipole was drifted forward in time
+     * (#cell_multipole_drift_in_progress while it is being drifted). */
+    integertime_t ti_old_multipole;
 
     /*! Pointer to the #gpart data. */
     struct gpart *parts;
@@ -457,6 +540,21 @@ struct cell {
      * tasks */
     struct cell *super;
 
+    /*! Is the #gpart data of this cell being used in a sub-cell? */
+    int phold;
+
+    /*! Is the #multipole data of this cell being used in a sub-cell? */
+    int mhold;
+
+    /*! Spin lock for various uses (#gpart case). */
+    swift_lock_type plock;
+
+    /*! Spin lock for various uses (#multipole case). */
+    swift_lock_type mlock;
+
+    /*! Number of M-M tasks that are associated with this cell. */
+    short int nr_mm_tasks;
+
     /*! The drift task for gparts */
     struct task *drift;
 
@@ -490,53 +588,65 @@ struct cell {
     /*! The task to end the force calculation */
     struct task *end_force;
 
-    /*! Minimum end of (integer) time step in this cell for gravity tasks. */
+  } grav;
+
+  /*! Stars variables */
+  struct {
+
+    /*! Nr of #spart in this cell. */
+    int count;
+
+    /*! Nr of #spart this cell can hold after addition of new #spart. */
+    int count_total;
+
+    /*! Number of #spart updated in this cell. */
+    int updated;
+
+    /*! Number of #spart inhibited in this cell. */
+    int inhibited;
+
+    /*! Maximum end of (integer) time step in this cell for star tasks. */
     integertime_t ti_end_min;
 
-    /*! Maximum end of (integer) time step in this cell for gravity tasks. */
+    /*! Maximum end of (integer) time step in this cell for star tasks. */
     integertime_t ti_end_max;
 
-    /*! Maximum beginning of (integer) time step in this cell for gravity tasks.
+    /*! Maximum beginning of (integer) time step in this cell for star tasks.
      */
     integertime_t ti_beg_max;
 
-    /*! Last (integer) time the cell's gpart were drifted forward in time. */
+    /*! Last (integer) time the cell's spart were drifted forward in time. */
     integertime_t ti_old_part;
 
-    /*! Last (integer) time the cell's multipole was drifted forward in time. */
-    integertime_t ti_old_multipole;
-
-    /*! Spin lock for various uses (#gpart case). */
-    swift_lock_type plock;
-
-    /*! Spin lock for various uses (#multipole case). */
-    swift_lock_type mlock;
+    /*! Max smoothing length in this cell. */
+    double h_max;
 
-    /*! Nr of #gpart in this cell. */
-    int count;
+    /*! Values of h_max before the drifts, used for sub-cell tasks. */
+    float h_max_old;
 
-    /*! Nr of #gpart this cell can hold after addition of new #gpart. */
-    int count_total;
+    /*! Maximum part movement in this cell since last construction. */
+    float dx_max_part;
 
-    /*! Number of #gpart updated in this cell. */
-    int updated;
+    /*! Values of dx_max before the drifts, used for sub-cell tasks. */
+    float dx_max_part_old;
 
-    /*! Number of #gpart inhibited in this cell. */
-    int inhibited;
+    /*! Maximum particle movement in this cell since the last sort. */
+    float dx_max_sort;
 
-    /*! Is the #gpart data of this cell being used in a sub-cell? */
-    int phold;
+    /*! Values of dx_max_sort before the drifts, used for sub-cell tasks. */
+    float dx_max_sort_old;
 
-    /*! Is the #multipole data of this cell being used in a sub-cell? */
-    int mhold;
+    /*! Bit mask of sort directions that will be needed in the next timestep. */
+    uint16_t requires_sorts;
 
-    /*! Number of M-M tasks that are associated with this cell. */
-    short int nr_mm_tasks;
+    /*! Bit-mask indicating the sorted directions */
+    uint16_t sorted;
 
-  } grav;
+    /*! Bit mask of sorts that need to be computed for this cell. */
+    uint16_t do_sort;
 
-  /*! Stars variables */
-  struct {
+    /*! Does this cell contain any #spart that may still do feedback? */
+    int do_feedback;
 
     /*! Pointer to the #spart data. */
     struct spart *parts;
@@ -544,6 +654,15 @@ struct cell {
     /*! Pointer to the #spart data at rebuild time. */
     struct spart *parts_rebuild;
 
+    /*! Is the #spart data of this cell being used in a sub-cell? */
+    int hold;
+
+    /*! Spin lock for various uses (#spart case). */
+    swift_lock_type lock;
+
+    /*! Spin lock for star formation use. */
+    swift_lock_type star_formation_lock;
+
     /*! The star ghost task itself */
     struct task *ghost;
 
@@ -566,86 +685,75 @@ struct cell {
     /*! Implicit tasks marking the exit of the stellar physics block of tasks */
     struct task *stars_out;
 
-    /*! Max smoothing length in this cell. */
-    double h_max;
-
-    /*! Last (integer) time the cell's spart were drifted forward in time. */
-    integertime_t ti_old_part;
-
-    /*! Spin lock for various uses (#spart case). */
-    swift_lock_type lock;
-
-    /*! Spin lock for star formation use. */
-    swift_lock_type star_formation_lock;
-
-    /*! Nr of #spart in this cell. */
-    int count;
+    /*! Pointer for the sorted indices. */
+    struct entry *sort[13];
 
-    /*! Nr of #spart this cell can hold after addition of new #spart. */
-    int count_total;
+    /*! Neighbours recorded by the density loop for the feedback loop. */
+    struct cell_neighbour_lists *neighbour_lists;
 
-    /*! Values of h_max before the drifts, used for sub-cell tasks. */
-    float h_max_old;
+    /*! Launch in which the neighbour_lists were recorded. */
+    int neighbour_lists_generation;
 
-    /*! Maximum part movement in this cell since last construction. */
-    float dx_max_part;
+    /*! Star formation history struct */
+    struct star_formation_history sfh;
 
-    /*! Values of dx_max before the drifts, used for sub-cell tasks. */
-    float dx_max_part_old;
+#ifdef SWIFT_DEBUG_CHECKS
+    /*! Last (integer) time the cell's sort arrays were updated. */
+    integertime_t ti_sort;
+#endif
 
-    /*! Maximum particle movement in this cell since the last sort. */
-    float dx_max_sort;
+  } stars;
 
-    /*! Values of dx_max_sort before the drifts, used for sub-cell tasks. */
-    float dx_max_sort_old;
+  /*! Black hole variables */
+  struct {
 
-    /*! Pointer for the sorted indices. */
-    struct entry *sort[13];
+    /*! Nr of #bpart in this cell. */
+    int count;
 
-    /*! Bit mask of sort directions that will be needed in the next timestep. */
-    uint16_t requires_sorts;
+    /*! Nr of #bpart this cell can hold after addition of new #bpart. */
+    int count_total;
 
-    /*! Bit-mask indicating the sorted directions */
-    uint16_t sorted;
+    /*! Number of #bpart updated in this cell. */
+    int updated;
 
-    /*! Bit mask of sorts that need to be computed for this cell. */
-    uint16_t do_sort;
+    /*! Number of #bpart inhibited in this cell. */
+    int inhibited;
 
-    /*! Maximum end of (integer) time step in this cell for star tasks. */
+    /*! Maximum end of (integer) time step in this cell for black tasks. */
     integertime_t ti_end_min;
 
-    /*! Maximum end of (integer) time step in this cell for star tasks. */
+    /*! Maximum end of (integer) time step in this cell for black hole tasks. */
     integertime_t ti_end_max;
 
-    /*! Maximum beginning of (integer) time step in this cell for star tasks.
+    /*! Maximum beginning of (integer) time step in this cell for black hole
+     * tasks.
      */
     integertime_t ti_beg_max;
 
-    /*! Number of #spart updated in this cell. */
-    int updated;
-
-    /*! Number of #spart inhibited in this cell. */
-    int inhibited;
+    /*! Last (integer) time the cell's bpart were drifted forward in time. */
+    integertime_t ti_old_part;
 
-    /*! Is the #spart data of this cell being used in a sub-cell? */
-    int hold;
+    /*! Max smoothing length in this cell. */
+    double h_max;
 
-    /*! Star formation history struct */
-    struct star_formation_history sfh;
+    /*! Values of h_max before the drifts, used for sub-cell tasks. */
+    float h_max_old;
 
-#ifdef SWIFT_DEBUG_CHECKS
-    /*! Last (integer) time the cell's sort arrays were updated. */
-    integertime_t ti_sort;
-#endif
+    /*! Maximum part movement in this cell since last construction. */
+    float dx_max_part;
 
-  } stars;
+    /*! Values of dx_max before the drifts, used for sub-cell tasks. */
+    float dx_max_part_old;
 
-  /*! Black hole variables */
-  struct {
+    /*! Is the #bpart data of this cell being used in a sub-cell? */
+    int hold;
 
     /*! Pointer to the #bpart data. */
     struct bpart *parts;
 
+    /*! Spin lock for various uses (#bpart case). */
+    swift_lock_type lock;
+
     /*! The drift task for bparts */
     struct task *drift;
 
@@ -665,51 +773,34 @@ struct cell {
     /*! Linked list of the tasks computing this cell's star feedback. */
     struct link *feedback;
 
-    /*! Max smoothing length in this cell. */
-    double h_max;
-
-    /*! Last (integer) time the cell's bpart were drifted forward in time. */
-    integertime_t ti_old_part;
-
-    /*! Spin lock for various uses (#bpart case). */
-    swift_lock_type lock;
-
-    /*! Nr of #bpart in this cell. */
-    int count;
-
-    /*! Nr of #bpart this cell can hold after addition of new #bpart. */
-    int count_total;
-
-    /*! Values of h_max before the drifts, used for sub-cell tasks. */
-    float h_max_old;
+  } black_holes;
 
-    /*! Maximum part movement in this cell since last construction. */
-    float dx_max_part;
+  /*! The first kick task (the time-step task if the kicks are fused) */
+  struct task *kick1;
 
-    /*! Values of dx_max before the drifts, used for sub-cell tasks. */
-    float dx_max_part_old;
+  /*! The second kick task (the time-step task if the kicks are fused) */
+  struct task *kick2;
 
-    /*! Maximum end of (integer) time step in this cell for black tasks. */
-    integertime_t ti_end_min;
+  /*! The task to compute time-steps */
+  struct task *timestep;
 
-    /*! Maximum end of (integer) time step in this cell for black hole tasks. */
-    integertime_t ti_end_max;
+  /*! The task to limit the time-step of inactive particles */
+  struct task *timestep_limiter;
 
-    /*! Maximum beginning of (integer) time step in this cell for black hole
-     * tasks.
-     */
-    integertime_t ti_beg_max;
+  /*! The logger task */
+  struct task *logger;
 
-    /*! Number of #bpart updated in this cell. */
-    int updated;
+  /*! The cell location on the grid. */
+  double loc[3];
 
-    /*! Number of #bpart inhibited in this cell. */
-    int inhibited;
+  /*! The cell dimensions. */
+  double width[3];
 
-    /*! Is the #bpart data of this cell being used in a sub-cell? */
-    int hold;
+  /*! Linking pointer for "memory management". */
+  struct cell *next;
 
-  } black_holes;
+  /*! ID of the previous owner, e.g. runner. */
+  int owner;
 
 #ifdef WITH_MPI
   /*! MPI variables */
@@ -738,42 +829,6 @@ struct cell {
   } mpi;
 #endif
 
-  /*! The first kick task */
-  struct task *kick1;
-
-  /*! The second kick task */
-  struct task *kick2;
-
-  /*! The task to compute time-steps */
-  struct task *timestep;
-
-  /*! The task to limit the time-step of inactive particles */
-  struct task *timestep_limiter;
-
-  /*! The logger task */
-  struct task *logger;
-
-  /*! Minimum dimension, i.e. smallest edge of this cell (min(width)). */
-  float dmin;
-
-  /*! ID of the previous owner, e.g. runner. */
-  int owner;
-
-  /*! ID of the node this cell lives on. */
-  int nodeID;
-
-  /*! Number of tasks that are associated with this cell. */
-  short int nr_tasks;
-
-  /*! The depth of this cell in the tree. */
-  char depth;
-
-  /*! Is this cell split ? */
-  char split;
-
-  /*! The maximal depth of this cell and its progenies */
-  char maxdepth;
-
 #if defined(SWIFT_DEBUG_CHECKS) || defined(SWIFT_CELL_GRAPH)
   /* Cell ID (for debugging) */
   int cellID;
@@ -813,6 +868,9 @@ int cell_unpack(struct pcell *pc, struct cell *c, struct space *s,
                 const int with_gravity);
 int cell_pack_tags(const struct cell *c, int *tags);
 int cell_unpack_tags(const int *tags, struct cell *c);
+size_t cell_pack_hydro_size(const int subtype);
+void cell_pack_hydro(const struct cell *c, void *buff, const int subtype);
+void cell_unpack_hydro(struct cell *c, const void *buff, const int subtype);
 int cell_pack_end_step_hydro(struct cell *c, struct pcell_step_hydro *pcell);
 int cell_unpack_end_step_hydro(struct cell *c, struct pcell_step_hydro *pcell);
 int cell_pack_end_step_grav(struct cell *c, struct pcell_step_grav *pcell);
@@ -832,11 +890,14 @@ int cell_link_parts(struct cell *c, struct part *parts);
 int cell_link_gparts(struct cell *c, struct gpart *gparts);
 int cell_link_sparts(struct cell *c, struct spart *sparts);
 int cell_link_bparts(struct cell *c, struct bpart *bparts);
+void cell_set_owner(struct cell *c, const int owner);
 int cell_link_foreign_parts(struct cell *c, struct part *parts);
 int cell_link_foreign_gparts(struct cell *c, struct gpart *gparts);
 int cell_count_parts_for_tasks(const struct cell *c);
 int cell_count_gparts_for_tasks(const struct cell *c);
 void cell_clean_links(struct cell *c, void *data);
+void cell_clean_task_pointers(struct cell *c, void *data);
+void cell_copy_task_pointers(struct cell *dst, const struct cell *src);
 void cell_make_multipoles(struct cell *c, integertime_t ti_current);
 void cell_check_multipole(struct cell *c);
 void cell_check_foreign_multipole(const struct cell *c);
@@ -855,7 +916,7 @@ void cell_drift_part(struct cell *c, const struct engine *e, int force);
 void cell_drift_gpart(struct cell *c, const struct engine *e, int force);
 void cell_drift_spart(struct cell *c, const struct engine *e, int force);
 void cell_drift_bpart(struct cell *c, const struct engine *e, int force);
-void cell_drift_multipole(struct cell *c, const struct engine *e);
+void cell_drift_multipole_on_use(struct cell *c, const struct engine *e);
 void cell_drift_all_multipoles(struct cell *c, const struct engine *e);
 void cell_check_timesteps(struct cell *c);
 void cell_store_pre_drift_values(struct cell *c);
@@ -878,6 +939,7 @@ void cell_activate_drift_bpart(struct cell *c, struct scheduler *s);
 void cell_activate_hydro_sorts(struct cell *c, int sid, struct scheduler *s);
 void cell_activate_stars_sorts(struct cell *c, int sid, struct scheduler *s);
 void cell_activate_limiter(struct cell *c, struct scheduler *s);
+void cell_mark_for_limiter(struct cell *c);
 void cell_clear_drift_flags(struct cell *c, void *data);
 void cell_clear_limiter_flags(struct cell *c, void *data);
 void cell_set_super_mapper(void *map_data, int num_elements, void *extra_data);
@@ -895,6 +957,7 @@ void cell_remove_spart(const struct engine *e, struct cell *c,
                        struct spart *sp);
 void cell_remove_bpart(const struct engine *e, struct cell *c,
                        struct bpart *bp);
+int cell_add_sparts(struct engine *e, struct cell *c, const int n);
 struct spart *cell_add_spart(struct engine *e, struct cell *c);
 struct gpart *cell_convert_part_to_gpart(const struct engine *e, struct cell *c,
                                          struct part *p, struct xpart *xp);
@@ -902,6 +965,9 @@ struct gpart *cell_convert_spart_to_gpart(const struct engine *e,
                                           struct cell *c, struct spart *sp);
 struct spart *cell_convert_part_to_spart(struct engine *e, struct cell *c,
                                          struct part *p, struct xpart *xp);
+void cell_convert_part_to_added_spart(struct engine *e, struct cell *c,
+                                      struct part *p, struct xpart *xp,
+                                      struct spart *sp);
 void cell_reorder_extra_parts(struct cell *c, const ptrdiff_t parts_offset);
 void cell_reorder_extra_gparts(struct cell *c, struct part *parts,
                                struct spart *sparts);
@@ -1056,11 +1122,12 @@ cell_can_recurse_in_pair_black_holes_task(const struct cell *ci,
   /* If so, is the cut-off radius plus the max distance the parts have moved */
   /* smaller than the sub-cell sizes ? */
   /* Note: We use the _old values as these might have been updated by a drift */
+  /* Note: All the loops are over the neighbours of the black holes, so the */
+  /* smoothing length of the gas plays no role and only its motion matters. */
   return ci->split && cj->split &&
          ((kernel_gamma * ci->black_holes.h_max_old +
-           ci->black_holes.dx_max_part_old) < 0.5f * ci->dmin) &&
-         ((kernel_gamma * cj->hydro.h_max_old + cj->hydro.dx_max_part_old) <
-          0.5f * cj->dmin);
+           ci->black_holes.dx_max_part_old + cj->hydro.dx_max_part_old) <
+          0.5f * ci->dmin);
 }
 
 /**
@@ -1073,9 +1140,9 @@ __attribute__((always_inline)) INLINE static int
 cell_can_recurse_in_self_black_holes_task(const struct cell *c) {
 
   /* Is the cell split and not smaller than the smoothing length? */
+  /* Note: As for the pairs, the gas smoothing length plays no role here. */
   return c->split &&
-         (kernel_gamma * c->black_holes.h_max_old < 0.5f * c->dmin) &&
-         (kernel_gamma * c->hydro.h_max_old < 0.5f * c->dmin);
+         (kernel_gamma * c->black_holes.h_max_old < 0.5f * c->dmin);
 }
 
 /**
@@ -1098,6 +1165,25 @@ __attribute__((always_inline)) INLINE static int cell_can_split_pair_hydro_task(
          (space_stretch * kernel_gamma * c->black_holes.h_max < 0.5f * c->dmin);
 }
 
+/**
+ * @brief Are the hydro interactions of a pair of cells computed by brute
+ * force rather than along the sorted lists of their particles?
+ *
+ * The brute-force loop costs the product of the particle counts, which for
+ * small cells is less than sorting them in the pair's direction. The
+ * decision only depends on the counts, so that the activation of the sorts
+ * and the pair interactions agree on it until the next rebuild.
+ *
+ * @param ci The first #cell.
+ * @param cj The second #cell.
+ */
+__attribute__((always_inline)) INLINE static int cell_pair_skips_hydro_sorts(
+    const struct cell *ci, const struct cell *cj) {
+
+  return (long long)ci->hydro.count * cj->hydro.count <
+         space_nosort_pair_hydro;
+}
+
 /**
  * @brief Can a self hydro task associated with a cell be split into smaller
  * sub-tasks.
@@ -1215,8 +1301,9 @@ cell_need_rebuild_for_black_holes_pair(const struct cell *ci,
   /* Is the cut-off radius plus the max distance the parts in both cells have */
   /* moved larger than the cell size ? */
   /* Note ci->dmin == cj->dmin */
-  if (kernel_gamma * max(ci->black_holes.h_max, cj->hydro.h_max) +
-          ci->black_holes.dx_max_part + cj->hydro.dx_max_part >
+  /* Note the gas smoothing length plays no role in the black hole loops */
+  if (kernel_gamma * ci->black_holes.h_max + ci->black_holes.dx_max_part +
+          cj->hydro.dx_max_part >
       cj->dmin) {
     return 1;
   }
@@ -1249,77 +1336,226 @@ __attribute__((always_inline)) INLINE static void cell_ensure_tagged(
 /**
  * @brief Allocate hydro sort memory for cell.
  *
+ * The arrays are taken from the #sort_arena of the runner doing the sort.
+ *
  * @param c The #cell that will require sorting.
  * @param flags Cell flags.
+ * @param arena The #sort_arena to allocate from.
  */
 __attribute__((always_inline)) INLINE static void cell_malloc_hydro_sorts(
-    struct cell *c, int flags) {
+    struct cell *c, int flags, struct sort_arena *arena) {
 
   const int count = c->hydro.count;
 
   /* Note that sorts can be used by different tasks at the same time (but not
    * on the same dimensions), so we need separate allocations per dimension. */
   for (int j = 0; j < 13; j++) {
-    if ((flags & (1 << j)) && c->hydro.sort[j] == NULL) {
-      if ((c->hydro.sort[j] = (struct entry *)swift_malloc(
-               "hydro.sort", sizeof(struct entry) * (count + 1))) == NULL)
-        error("Failed to allocate sort memory.");
-    }
+    if ((flags & (1 << j)) && c->hydro.sort[j] == NULL)
+      c->hydro.sort[j] = sort_arena_alloc(arena, count + 1);
   }
 }
 
 /**
  * @brief Free hydro sort memory for cell.
  *
+ * The memory belongs to a #sort_arena and is only recovered when the arenas
+ * are reset at the next rebuild, so we only drop the pointers here.
+ *
  * @param c The #cell.
  */
 __attribute__((always_inline)) INLINE static void cell_free_hydro_sorts(
     struct cell *c) {
 
-  for (int i = 0; i < 13; i++) {
-    if (c->hydro.sort[i] != NULL) {
-      swift_free("hydro.sort", c->hydro.sort[i]);
-      c->hydro.sort[i] = NULL;
+  for (int i = 0; i < 13; i++) c->hydro.sort[i] = NULL;
+}
+
+/**
+ * @brief Free the hydro time-bin index list of a cell.
+ *
+ * @param c The #cell.
+ */
+__attribute__((always_inline)) INLINE static void cell_free_hydro_bins(
+    struct cell *c) {
+
+  if (c->hydro.bins_ind != NULL) {
+    swift_free("hydro.bins", c->hydro.bins_ind);
+    c->hydro.bins_ind = NULL;
+  }
+  c->hydro.bins_size = 0;
+  c->hydro.bins_count = -1;
+}
+
+/**
+ * @brief Free the structure-of-arrays copy of the #part of a cell.
+ *
+ * @param c The #cell.
+ */
+__attribute__((always_inline)) INLINE static void cell_free_hydro_soa(
+    struct cell *c) {
+
+  hydro_soa_free(&c->hydro.soa);
+}
+
+/**
+ * @brief Get the structure-of-arrays copy of the #part of a cell for a given
+ * loop, filling it first if it is not up to date.
+ *
+ * Must only be called from within a task that has locked the cell.
+ *
+ * @param c The #cell.
+ * @param generation The current launch of the tasks.
+ * @param loop The hydro loop (#task_subtypes) that is about to read it.
+ */
+__attribute__((always_inline)) INLINE static const struct hydro_soa *
+cell_get_hydro_soa(struct cell *c, const int generation, const int loop) {
+
+  struct hydro_soa *soa = &c->hydro.soa;
+
+  if (soa->generation != generation || soa->loop != loop ||
+      soa->count != c->hydro.count) {
+    hydro_soa_fill(soa, c->hydro.parts, c->hydro.count, c->loc, generation,
+                   loop);
+  }
+#ifdef SWIFT_DEBUG_CHECKS
+  else {
+    /* Nothing the copy holds can have changed since it was filled. */
+    for (int i = 0; i < c->hydro.count; i++) {
+      const struct part *p = &c->hydro.parts[i];
+      if (p->time_bin >= time_bin_inhibited) {
+        if (soa->h[i] >= 0.f)
+          error("Hydro SoA copy out of date (particle inhibited).");
+      } else if (soa->h[i] != p->h || soa->x[i] != (float)(p->x[0] - c->loc[0]))
+        error("Hydro SoA copy out of date (id=%lld).", p->id);
     }
   }
+#endif
+
+  return soa;
+}
+
+/**
+ * @brief Rebuild the list of #part indices of a leaf cell sorted by time-bin.
+ *
+ * Each entry packs the index of the particle with its time-bin, such that the
+ * kicks can stop at the first entry beyond the largest active bin. Inhibited
+ * and not-yet-created particles are left out of the list.
+ *
+ * @param c The leaf #cell.
+ */
+__attribute__((always_inline)) INLINE static void cell_build_hydro_bins(
+    struct cell *c) {
+
+  const int count = c->hydro.count;
+  const struct part *parts = c->hydro.parts;
+
+  /* Make sure we have enough space. */
+  if (c->hydro.bins_size < count) {
+    if (c->hydro.bins_ind != NULL) swift_free("hydro.bins", c->hydro.bins_ind);
+    if ((c->hydro.bins_ind =
+             (int *)swift_malloc("hydro.bins", sizeof(int) * count)) == NULL)
+      error("Failed to allocate time-bin index memory.");
+    c->hydro.bins_size = count;
+  }
+
+  /* Counting sort over the time-bins. */
+  int offsets[num_time_bins + 2] = {0};
+  for (int k = 0; k < count; k++) {
+    const timebin_t bin = parts[k].time_bin;
+    if (bin >= 0 && bin <= num_time_bins) offsets[bin + 1]++;
+  }
+  for (int b = 0; b <= num_time_bins; b++) offsets[b + 1] += offsets[b];
+  for (int k = 0; k < count; k++) {
+    const timebin_t bin = parts[k].time_bin;
+    if (bin >= 0 && bin <= num_time_bins)
+      c->hydro.bins_ind[offsets[bin]++] = (k << cell_bins_shift) | bin;
+  }
+
+  /* After the scatter, offsets[num_time_bins] is the number of entries. */
+  c->hydro.bins_count = offsets[num_time_bins];
+}
+
+/**
+ * @brief Get the hydro time-bin index list of a cell up to a given bin.
+ *
+ * @param c The leaf #cell.
+ * @param max_bin The largest time-bin to return.
+ * @param ind (return) The packed entries, use cell_hydro_bins_index() on them.
+ * @return The number of entries in ind or -1 if the list is not up to date and
+ * all the particles have to be scanned.
+ */
+__attribute__((always_inline)) INLINE static int cell_get_hydro_bins(
+    const struct cell *c, const timebin_t max_bin, const int **ind) {
+
+  if (c->hydro.bins_ind == NULL || c->hydro.bins_count < 0) return -1;
+
+  const int *bins_ind = c->hydro.bins_ind;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  /* The particles can only have been removed since the list was built. */
+  int nr_parts = 0;
+  for (int k = 0; k < c->hydro.count; k++)
+    if (c->hydro.parts[k].time_bin <= num_time_bins) nr_parts++;
+  if (nr_parts > c->hydro.bins_count)
+    error("Time-bin list is missing particles.");
+  for (int k = 0; k < c->hydro.bins_count; k++) {
+    const timebin_t bin =
+        c->hydro.parts[bins_ind[k] >> cell_bins_shift].time_bin;
+    if (bin <= num_time_bins && bin != (bins_ind[k] & cell_bins_mask))
+      error("Time-bin list is out of date.");
+  }
+#endif
+
+  int n = 0;
+  while (n < c->hydro.bins_count &&
+         (bins_ind[n] & cell_bins_mask) <= (int)max_bin)
+    n++;
+
+  *ind = bins_ind;
+  return n;
+}
+
+/**
+ * @brief Unpack the #part index of an entry of the hydro time-bin list.
+ */
+__attribute__((always_inline)) INLINE static int cell_hydro_bins_index(
+    const int entry) {
+  return entry >> cell_bins_shift;
 }
 
 /**
  * @brief Allocate stars sort memory for cell.
  *
+ * The arrays are taken from the #sort_arena of the runner doing the sort.
+ *
  * @param c The #cell that will require sorting.
  * @param flags Cell flags.
+ * @param arena The #sort_arena to allocate from.
  */
 __attribute__((always_inline)) INLINE static void cell_malloc_stars_sorts(
-    struct cell *c, int flags) {
+    struct cell *c, int flags, struct sort_arena *arena) {
 
   const int count = c->stars.count;
 
   /* Note that sorts can be used by different tasks at the same time (but not
    * on the same dimensions), so we need separate allocations per dimension. */
   for (int j = 0; j < 13; j++) {
-    if ((flags & (1 << j)) && c->stars.sort[j] == NULL) {
-      if ((c->stars.sort[j] = (struct entry *)swift_malloc(
-               "stars.sort", sizeof(struct entry) * (count + 1))) == NULL)
-        error("Failed to allocate sort memory.");
-    }
+    if ((flags & (1 << j)) && c->stars.sort[j] == NULL)
+      c->stars.sort[j] = sort_arena_alloc(arena, count + 1);
   }
 }
 
 /**
  * @brief Free stars sort memory for cell.
  *
+ * The memory belongs to a #sort_arena and is only recovered when the arenas
+ * are reset at the next rebuild, so we only drop the pointers here.
+ *
  * @param c The #cell.
  */
 __attribute__((always_inline)) INLINE static void cell_free_stars_sorts(
     struct cell *c) {
 
-  for (int i = 0; i < 13; i++) {
-    if (c->stars.sort[i] != NULL) {
-      swift_free("stars.sort", c->stars.sort[i]);
-      c->stars.sort[i] = NULL;
-    }
-  }
+  for (int i = 0; i < 13; i++) c->stars.sort[i] = NULL;
 }
 
 /** Set the given flag for the given cell. */
@@ -1340,6 +1576,24 @@ __attribute__((always_inline)) INLINE static int cell_get_flag(
   return (c->flags & flag) > 0;
 }
 
+/**
+ * @brief Flag a cell and all its parents as needing their end-of-step values
+ * collected.
+ *
+ * Stops at the first cell already flagged as its parents then are (or are
+ * being) flagged too.
+ *
+ * @param c The #cell whose values changed.
+ */
+__attribute__((always_inline)) INLINE static void cell_set_collect_flag_up(
+    struct cell *c) {
+
+  for (struct cell *p = c; p != NULL; p = p->parent) {
+    if (cell_get_flag(p, cell_flag_do_collect)) break;
+    cell_set_flag(p, cell_flag_do_collect);
+  }
+}
+
 /**
  * @brief Check if a cell has a recv task of the given subtype.
  */
@@ -50,11 +50,13 @@ INLINE static int chemistry_read_particles(struct part* parts,
  * @brief Specifies which particle fields to write to a dataset
  *
  * @param parts The particle array.
+ * @param xparts The extended data particle array.
  * @param list The list of i/o properties to write.
  *
  * @return Returns the number of fields to write.
  */
 INLINE static int chemistry_write_particles(const struct part* parts,
+                                            const struct xpart* xparts,
                                             struct io_props* list) {
 
   /* List what we want to write */
@@ -75,24 +77,24 @@ INLINE static int chemistry_write_particles(const struct part* parts,
       chemistry_data.smoothed_metal_mass_fraction_total);
 
   list[4] = io_make_output_field("TotalMassFromSNIa", FLOAT, 1, UNIT_CONV_MASS,
-                                 parts, chemistry_data.mass_from_SNIa);
+                                 xparts, chemistry_data.mass_from_SNIa);
 
   list[5] = io_make_output_field("MetalMassFracFromSNIa", FLOAT, 1,
-                                 UNIT_CONV_NO_UNITS, parts,
+                                 UNIT_CONV_NO_UNITS, xparts,
                                  chemistry_data.metal_mass_fraction_from_SNIa);
 
   list[6] = io_make_output_field("TotalMassFromAGB", FLOAT, 1, UNIT_CONV_MASS,
-                                 parts, chemistry_data.mass_from_AGB);
+                                 xparts, chemistry_data.mass_from_AGB);
 
   list[7] =
       io_make_output_field("MetalMassFracFromAGB", FLOAT, 1, UNIT_CONV_NO_UNITS,
-                           parts, chemistry_data.metal_mass_fraction_from_AGB);
+                           xparts, chemistry_data.metal_mass_fraction_from_AGB);
 
   list[8] = io_make_output_field("TotalMassFromSNII", FLOAT, 1, UNIT_CONV_MASS,
-                                 parts, chemistry_data.mass_from_SNII);
+                                 xparts, chemistry_data.mass_from_SNII);
 
   list[9] = io_make_output_field("MetalMassFracFromSNII", FLOAT, 1,
-                                 UNIT_CONV_NO_UNITS, parts,
+                                 UNIT_CONV_NO_UNITS, xparts,
                                  chemistry_data.metal_mass_fraction_from_SNII);
 
   list[10] =
@@ -135,25 +137,25 @@ INLINE static int chemistry_write_sparticles(const struct spart* sparts,
       chemistry_data.smoothed_metal_mass_fraction_total);
 
   list[4] = io_make_output_field("TotalMassFromSNIa", FLOAT, 1, UNIT_CONV_MASS,
-                                 sparts, chemistry_data.mass_from_SNIa);
+                                 sparts, chemistry_history.mass_from_SNIa);
 
-  list[5] = io_make_output_field("MetalMassFracFromSNIa", FLOAT, 1,
-                                 UNIT_CONV_NO_UNITS, sparts,
-                                 chemistry_data.metal_mass_fraction_from_SNIa);
+  list[5] = io_make_output_field(
+      "MetalMassFracFromSNIa", FLOAT, 1, UNIT_CONV_NO_UNITS, sparts,
+      chemistry_history.metal_mass_fraction_from_SNIa);
 
   list[6] = io_make_output_field("TotalMassFromAGB", FLOAT, 1, UNIT_CONV_MASS,
-                                 sparts, chemistry_data.mass_from_AGB);
+                                 sparts, chemistry_history.mass_from_AGB);
 
-  list[7] =
-      io_make_output_field("MetalMassFracFromAGB", FLOAT, 1, UNIT_CONV_NO_UNITS,
-                           sparts, chemistry_data.metal_mass_fraction_from_AGB);
+  list[7] = io_make_output_field(
+      "MetalMassFracFromAGB", FLOAT, 1, UNIT_CONV_NO_UNITS, sparts,
+      chemistry_history.metal_mass_fraction_from_AGB);
 
   list[8] = io_make_output_field("TotalMassFromSNII", FLOAT, 1, UNIT_CONV_MASS,
-                                 sparts, chemistry_data.mass_from_SNII);
+                                 sparts, chemistry_history.mass_from_SNII);
 
-  list[9] = io_make_output_field("MetalMassFracFromSNII", FLOAT, 1,
-                                 UNIT_CONV_NO_UNITS, sparts,
-                                 chemistry_data.metal_mass_fraction_from_SNII);
+  list[9] = io_make_output_field(
+      "MetalMassFracFromSNII", FLOAT, 1, UNIT_CONV_NO_UNITS, sparts,
+      chemistry_history.metal_mass_fraction_from_SNII);
 
   list[10] =
       io_make_output_field("IronMassFracFromSNIa", FLOAT, 1, UNIT_CONV_NO_UNITS,
@@ -64,6 +64,21 @@ struct chemistry_part_data {
   /*! Smoothed fraction of the particle mass in *all* metals */
   float smoothed_metal_mass_fraction_total;
 
+  /*! Fraction of total gas mass in Iron coming from SNIa */
+  float iron_mass_fraction_from_SNIa;
+
+  /*! Smoothed fraction of total gas mass in Iron coming from SNIa */
+  float smoothed_iron_mass_fraction_from_SNIa;
+};
+
+/**
+ * @brief Enrichment history of the #xpart (and #spart) in the EAGLE model.
+ *
+ * These are only updated by the feedback loop and written to the snapshots,
+ * so they are kept out of the #part read by the hydro loops.
+ */
+struct chemistry_xpart_data {
+
   /*! Mass coming from SNIa */
   float mass_from_SNIa;
 
@@ -81,12 +96,6 @@ struct chemistry_part_data {
 
   /*! Fraction of total gas mass in metals coming from SNII */
   float metal_mass_fraction_from_SNII;
-
-  /*! Fraction of total gas mass in Iron coming from SNIa */
-  float iron_mass_fraction_from_SNIa;
-
-  /*! Smoothed fraction of total gas mass in Iron coming from SNIa */
-  float smoothed_iron_mass_fraction_from_SNIa;
 };
 
 #endif /* SWIFT_CHEMISTRY_STRUCT_EAGLE_H */
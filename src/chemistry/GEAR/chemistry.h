@@ -123,15 +123,16 @@ __attribute__((always_inline)) INLINE static void chemistry_end_density(
   const float factor = pow_dimension(h_inv) / p->rho; /* 1 / h^d * rho */
   const float m = p->mass;
 
+  const float m_root = m * kernel_root;
+
   struct chemistry_part_data* cpd = &p->chemistry_data;
+  float* restrict smoothed = cpd->smoothed_metal_mass_fraction;
+  const float* restrict metals = cpd->metal_mass_fraction;
 
   for (int i = 0; i < chemistry_element_count; i++) {
-    /* Final operation on the density (add self-contribution). */
-    cpd->smoothed_metal_mass_fraction[i] +=
-        m * cpd->metal_mass_fraction[i] * kernel_root;
-
-    /* Finish the calculation by inserting the missing h-factors */
-    cpd->smoothed_metal_mass_fraction[i] *= factor;
+    /* Final operation on the density (add self-contribution) and finish the
+     * calculation by inserting the missing h-factors */
+    smoothed[i] = (smoothed[i] + m_root * metals[i]) * factor;
   }
 }
 
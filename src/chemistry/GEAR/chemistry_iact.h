@@ -67,12 +67,19 @@ __attribute__((always_inline)) INLINE static void runner_iact_chemistry(
   const float uj = r / hj;
   kernel_deval(uj, &wj, &wj_dx);
 
+  /* The element arrays of the two particles never overlap: tell the compiler
+   * so that it updates all the elements with SIMD instructions. */
+  float *restrict smoothed_i = chi->smoothed_metal_mass_fraction;
+  float *restrict smoothed_j = chj->smoothed_metal_mass_fraction;
+  const float *restrict metals_i = chi->metal_mass_fraction;
+  const float *restrict metals_j = chj->metal_mass_fraction;
+  const float mj_wi = mj * wi;
+  const float mi_wj = mi * wj;
+
   /* Compute contribution to the smooth metallicity */
   for (int i = 0; i < chemistry_element_count; i++) {
-    chi->smoothed_metal_mass_fraction[i] +=
-        mj * chj->metal_mass_fraction[i] * wi;
-    chj->smoothed_metal_mass_fraction[i] +=
-        mi * chi->metal_mass_fraction[i] * wj;
+    smoothed_i[i] += mj_wi * metals_j[i];
+    smoothed_j[i] += mi_wj * metals_i[i];
   }
 }
 
@@ -108,11 +115,14 @@ __attribute__((always_inline)) INLINE static void runner_iact_nonsym_chemistry(
   const float ui = r / hi;
   kernel_deval(ui, &wi, &wi_dx);
 
+  /* See runner_iact_chemistry() */
+  float *restrict smoothed_i = chi->smoothed_metal_mass_fraction;
+  const float *restrict metals_j = chj->metal_mass_fraction;
+  const float mj_wi = mj * wi;
+
   /* Compute contribution to the smooth metallicity */
-  for (int i = 0; i < chemistry_element_count; i++) {
-    chi->smoothed_metal_mass_fraction[i] +=
-        mj * chj->metal_mass_fraction[i] * wi;
-  }
+  for (int i = 0; i < chemistry_element_count; i++)
+    smoothed_i[i] += mj_wi * metals_j[i];
 }
 
 #endif /* SWIFT_GEAR_CHEMISTRY_IACT_H */
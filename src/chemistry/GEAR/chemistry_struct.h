@@ -58,4 +58,11 @@ struct chemistry_part_data {
   float Z;
 };
 
+/**
+ * @brief Chemistry properties carried by the #xpart.
+ *
+ * Nothing here.
+ */
+struct chemistry_xpart_data {};
+
 #endif /* SWIFT_CHEMISTRY_STRUCT_GEAR_H */
@@ -43,4 +43,11 @@ struct chemistry_global_data {};
  */
 struct chemistry_part_data {};
 
+/**
+ * @brief Chemistry properties carried by the #xpart.
+ *
+ * Nothing here.
+ */
+struct chemistry_xpart_data {};
+
 #endif /* SWIFT_CHEMISTRY_STRUCT_NONE_H */
@@ -70,6 +70,12 @@ static MPI_Datatype mpicollectgroup1_type;
  */
 static MPI_Op mpicollectgroup1_reduce_op;
 
+/**
+ * @brief Buffers and request of the reduction in flight.
+ */
+static struct mpicollectgroup1 mpicollectgroup1_send, mpicollectgroup1_recv;
+static MPI_Request mpicollectgroup1_request = MPI_REQUEST_NULL;
+
 #endif
 
 /**
@@ -223,67 +229,116 @@ void collectgroup1_init(
  */
 void collectgroup1_reduce(struct collectgroup1 *grp1) {
 
+  collectgroup1_reduce_start(grp1);
+  collectgroup1_reduce_finish(grp1);
+}
+
+/**
+ * @brief Starts the processing of the group without waiting for it to
+ * complete.
+ *
+ * With MPI, this posts a non-blocking reduction across all nodes. The values
+ * in the group must not be used until collectgroup1_reduce_finish() has been
+ * called. There can only be a single reduction in flight at any time.
+ *
+ * @param grp1 the #collectgroup1 struct already initialised by a call
+ *             to collectgroup1_init.
+ */
+void collectgroup1_reduce_start(struct collectgroup1 *grp1) {
+
 #ifdef WITH_MPI
 
-  /* Populate an MPI group struct and reduce this across all nodes. */
-  struct mpicollectgroup1 mpigrp11;
-  mpigrp11.updated = grp1->updated;
-  mpigrp11.g_updated = grp1->g_updated;
-  mpigrp11.s_updated = grp1->s_updated;
-  mpigrp11.b_updated = grp1->b_updated;
-  mpigrp11.inhibited = grp1->inhibited;
-  mpigrp11.g_inhibited = grp1->g_inhibited;
-  mpigrp11.s_inhibited = grp1->s_inhibited;
-  mpigrp11.b_inhibited = grp1->b_inhibited;
-  mpigrp11.ti_hydro_end_min = grp1->ti_hydro_end_min;
-  mpigrp11.ti_gravity_end_min = grp1->ti_gravity_end_min;
-  mpigrp11.ti_stars_end_min = grp1->ti_stars_end_min;
-  mpigrp11.ti_black_holes_end_min = grp1->ti_black_holes_end_min;
-  mpigrp11.ti_hydro_end_max = grp1->ti_hydro_end_max;
-  mpigrp11.ti_gravity_end_max = grp1->ti_gravity_end_max;
-  mpigrp11.ti_stars_end_max = grp1->ti_stars_end_max;
-  mpigrp11.ti_black_holes_end_max = grp1->ti_black_holes_end_max;
-  mpigrp11.ti_hydro_beg_max = grp1->ti_hydro_beg_max;
-  mpigrp11.ti_gravity_beg_max = grp1->ti_gravity_beg_max;
-  mpigrp11.ti_stars_beg_max = grp1->ti_stars_beg_max;
-  mpigrp11.ti_black_holes_beg_max = grp1->ti_black_holes_beg_max;
-  mpigrp11.forcerebuild = grp1->forcerebuild;
-  mpigrp11.total_nr_cells = grp1->total_nr_cells;
-  mpigrp11.total_nr_tasks = grp1->total_nr_tasks;
-  mpigrp11.tasks_per_cell_max = grp1->tasks_per_cell_max;
-  mpigrp11.sfh = grp1->sfh;
-
-  struct mpicollectgroup1 mpigrp12;
-  if (MPI_Allreduce(&mpigrp11, &mpigrp12, 1, mpicollectgroup1_type,
-                    mpicollectgroup1_reduce_op, MPI_COMM_WORLD) != MPI_SUCCESS)
+  if (mpicollectgroup1_request != MPI_REQUEST_NULL)
+    error("A reduction of the collectgroup1 is already in flight.");
+
+  /* Populate an MPI group struct to reduce across all nodes. */
+  struct mpicollectgroup1 *mpigrp11 = &mpicollectgroup1_send;
+  mpigrp11->updated = grp1->updated;
+  mpigrp11->g_updated = grp1->g_updated;
+  mpigrp11->s_updated = grp1->s_updated;
+  mpigrp11->b_updated = grp1->b_updated;
+  mpigrp11->inhibited = grp1->inhibited;
+  mpigrp11->g_inhibited = grp1->g_inhibited;
+  mpigrp11->s_inhibited = grp1->s_inhibited;
+  mpigrp11->b_inhibited = grp1->b_inhibited;
+  mpigrp11->ti_hydro_end_min = grp1->ti_hydro_end_min;
+  mpigrp11->ti_gravity_end_min = grp1->ti_gravity_end_min;
+  mpigrp11->ti_stars_end_min = grp1->ti_stars_end_min;
+  mpigrp11->ti_black_holes_end_min = grp1->ti_black_holes_end_min;
+  mpigrp11->ti_hydro_end_max = grp1->ti_hydro_end_max;
+  mpigrp11->ti_gravity_end_max = grp1->ti_gravity_end_max;
+  mpigrp11->ti_stars_end_max = grp1->ti_stars_end_max;
+  mpigrp11->ti_black_holes_end_max = grp1->ti_black_holes_end_max;
+  mpigrp11->ti_hydro_beg_max = grp1->ti_hydro_beg_max;
+  mpigrp11->ti_gravity_beg_max = grp1->ti_gravity_beg_max;
+  mpigrp11->ti_stars_beg_max = grp1->ti_stars_beg_max;
+  mpigrp11->ti_black_holes_beg_max = grp1->ti_black_holes_beg_max;
+  mpigrp11->forcerebuild = grp1->forcerebuild;
+  mpigrp11->total_nr_cells = grp1->total_nr_cells;
+  mpigrp11->total_nr_tasks = grp1->total_nr_tasks;
+  mpigrp11->tasks_per_cell_max = grp1->tasks_per_cell_max;
+  mpigrp11->sfh = grp1->sfh;
+
+#if MPI_VERSION >= 3
+  if (MPI_Iallreduce(&mpicollectgroup1_send, &mpicollectgroup1_recv, 1,
+                     mpicollectgroup1_type, mpicollectgroup1_reduce_op,
+                     MPI_COMM_WORLD,
+                     &mpicollectgroup1_request) != MPI_SUCCESS)
+    error("Failed to start the reduction of mpicollection1.");
+#else
+  /* No non-blocking collectives, so just do it now. */
+  if (MPI_Allreduce(&mpicollectgroup1_send, &mpicollectgroup1_recv, 1,
+                    mpicollectgroup1_type, mpicollectgroup1_reduce_op,
+                    MPI_COMM_WORLD) != MPI_SUCCESS)
     error("Failed to reduce mpicollection1.");
+#endif
+
+#endif
+}
+
+/**
+ * @brief Waits for the processing started by collectgroup1_reduce_start() to
+ * complete and updates the group with the result.
+ *
+ * @param grp1 the #collectgroup1 struct passed to
+ *             collectgroup1_reduce_start().
+ */
+void collectgroup1_reduce_finish(struct collectgroup1 *grp1) {
+
+#ifdef WITH_MPI
+
+#if MPI_VERSION >= 3
+  if (MPI_Wait(&mpicollectgroup1_request, MPI_STATUS_IGNORE) != MPI_SUCCESS)
+    error("Failed to reduce mpicollection1.");
+#endif
 
   /* And update. */
-  grp1->updated = mpigrp12.updated;
-  grp1->g_updated = mpigrp12.g_updated;
-  grp1->s_updated = mpigrp12.s_updated;
-  grp1->b_updated = mpigrp12.b_updated;
-  grp1->inhibited = mpigrp12.inhibited;
-  grp1->g_inhibited = mpigrp12.g_inhibited;
-  grp1->s_inhibited = mpigrp12.s_inhibited;
-  grp1->b_inhibited = mpigrp12.b_inhibited;
-  grp1->ti_hydro_end_min = mpigrp12.ti_hydro_end_min;
-  grp1->ti_gravity_end_min = mpigrp12.ti_gravity_end_min;
-  grp1->ti_stars_end_min = mpigrp12.ti_stars_end_min;
-  grp1->ti_black_holes_end_min = mpigrp12.ti_black_holes_end_min;
-  grp1->ti_hydro_end_max = mpigrp12.ti_hydro_end_max;
-  grp1->ti_gravity_end_max = mpigrp12.ti_gravity_end_max;
-  grp1->ti_stars_end_max = mpigrp12.ti_stars_end_max;
-  grp1->ti_black_holes_end_max = mpigrp12.ti_black_holes_end_max;
-  grp1->ti_hydro_beg_max = mpigrp12.ti_hydro_beg_max;
-  grp1->ti_gravity_beg_max = mpigrp12.ti_gravity_beg_max;
-  grp1->ti_stars_beg_max = mpigrp12.ti_stars_beg_max;
-  grp1->ti_black_holes_beg_max = mpigrp12.ti_black_holes_beg_max;
-  grp1->forcerebuild = mpigrp12.forcerebuild;
-  grp1->total_nr_cells = mpigrp12.total_nr_cells;
-  grp1->total_nr_tasks = mpigrp12.total_nr_tasks;
-  grp1->tasks_per_cell_max = mpigrp12.tasks_per_cell_max;
-  grp1->sfh = mpigrp12.sfh;
+  const struct mpicollectgroup1 *mpigrp12 = &mpicollectgroup1_recv;
+  grp1->updated = mpigrp12->updated;
+  grp1->g_updated = mpigrp12->g_updated;
+  grp1->s_updated = mpigrp12->s_updated;
+  grp1->b_updated = mpigrp12->b_updated;
+  grp1->inhibited = mpigrp12->inhibited;
+  grp1->g_inhibited = mpigrp12->g_inhibited;
+  grp1->s_inhibited = mpigrp12->s_inhibited;
+  grp1->b_inhibited = mpigrp12->b_inhibited;
+  grp1->ti_hydro_end_min = mpigrp12->ti_hydro_end_min;
+  grp1->ti_gravity_end_min = mpigrp12->ti_gravity_end_min;
+  grp1->ti_stars_end_min = mpigrp12->ti_stars_end_min;
+  grp1->ti_black_holes_end_min = mpigrp12->ti_black_holes_end_min;
+  grp1->ti_hydro_end_max = mpigrp12->ti_hydro_end_max;
+  grp1->ti_gravity_end_max = mpigrp12->ti_gravity_end_max;
+  grp1->ti_stars_end_max = mpigrp12->ti_stars_end_max;
+  grp1->ti_black_holes_end_max = mpigrp12->ti_black_holes_end_max;
+  grp1->ti_hydro_beg_max = mpigrp12->ti_hydro_beg_max;
+  grp1->ti_gravity_beg_max = mpigrp12->ti_gravity_beg_max;
+  grp1->ti_stars_beg_max = mpigrp12->ti_stars_beg_max;
+  grp1->ti_black_holes_beg_max = mpigrp12->ti_black_holes_beg_max;
+  grp1->forcerebuild = mpigrp12->forcerebuild;
+  grp1->total_nr_cells = mpigrp12->total_nr_cells;
+  grp1->total_nr_tasks = mpigrp12->total_nr_tasks;
+  grp1->tasks_per_cell_max = mpigrp12->tasks_per_cell_max;
+  grp1->sfh = mpigrp12->sfh;
 
 #endif
 }
@@ -33,14 +33,17 @@
 #include "hydro_io.h"
 #include "io_properties.h"
 #include "kernel_hydro.h"
+#include "minmax.h"
 #include "part.h"
 #include "part_type.h"
+#include "partition.h"
 #include "stars_io.h"
 #include "threadpool.h"
 #include "units.h"
 #include "version.h"
 
 /* Some standard headers. */
+#include <float.h>
 #include <math.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -389,7 +392,8 @@ void io_write_engine_policy(hid_t h_file, const struct engine* e) {
 
 void io_write_cell_offsets(hid_t h_grp, const int cdim[3],
                            const struct cell* cells_top, const int nr_cells,
-                           const double width[3], const int nodeID,
+                           const int* cells_order, const double width[3],
+                           const int nodeID,
                            const long long global_counts[swift_type_count],
                            const long long global_offsets[swift_type_count],
                            const struct unit_system* internal_units,
@@ -423,12 +427,15 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3],
   offset_spart[0] = 0;
   offset_bpart[0] = 0;
 
-  /* Collect the cell information of *local* cells */
+  /* Collect the cell information of *local* cells, in the order their
+   * particles are stored in (see space_rebuild()) */
   long long local_offset_part = 0;
   long long local_offset_gpart = 0;
   long long local_offset_spart = 0;
   long long local_offset_bpart = 0;
-  for (int i = 0; i < nr_cells; ++i) {
+  for (int k = 0; k < nr_cells; ++k) {
+
+    const int i = cells_order != NULL ? cells_order[k] : k;
 
     if (cells_top[i].nodeID == nodeID) {
 
@@ -441,7 +448,8 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3],
       count_part[i] = cells_top[i].hydro.count - cells_top[i].hydro.inhibited;
       count_gpart[i] = cells_top[i].grav.count - cells_top[i].grav.inhibited;
       count_spart[i] = cells_top[i].stars.count - cells_top[i].stars.inhibited;
-      count_bpart[i] = cells_top[i].stars.count - cells_top[i].stars.inhibited;
+      count_bpart[i] =
+          cells_top[i].black_holes.count - cells_top[i].black_holes.inhibited;
 
       /* Only count DM gpart (gpart without friends) */
       count_gpart[i] -= count_part[i];
@@ -454,7 +462,8 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3],
       offset_gpart[i] =
           local_offset_gpart + global_offsets[swift_type_dark_matter];
       offset_spart[i] = local_offset_spart + global_offsets[swift_type_stars];
-      offset_bpart[i] = local_offset_bpart + global_offsets[swift_type_stars];
+      offset_bpart[i] =
+          local_offset_bpart + global_offsets[swift_type_black_hole];
 
       local_offset_part += count_part[i];
       local_offset_gpart += count_gpart[i];
@@ -785,6 +794,323 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3],
   free(offset_bpart);
 }
 
+/**
+ * @brief Selects particles of a list of ranges in the dataspace of a field
+ * of the ICs.
+ *
+ * The ranges are seen as a single list of particles, of which we select
+ * count particles starting at first.
+ *
+ * @param h_filespace The dataspace of the field.
+ * @param ranges The ranges of particles, as pairs of offset and count sorted
+ * by offset.
+ * @param nr_ranges The number of ranges.
+ * @param first The index of the first particle to select in the list.
+ * @param count The number of particles to select.
+ * @param dimension The number of elements per particle of the field.
+ */
+void io_select_ranges(hid_t h_filespace, const long long* ranges,
+                      int nr_ranges, long long first, long long count,
+                      int dimension) {
+
+  H5Sselect_none(h_filespace);
+
+  H5S_seloper_t op = H5S_SELECT_SET;
+  for (int r = 0; r < nr_ranges && count > 0; r++) {
+
+    /* Skip the ranges before the first particle */
+    long long offset = ranges[2 * r];
+    long long length = ranges[2 * r + 1];
+    if (first >= length) {
+      first -= length;
+      continue;
+    }
+    offset += first;
+    length -= first;
+    first = 0;
+    if (length > count) length = count;
+
+    const hsize_t offsets[2] = {(hsize_t)offset, 0};
+    const hsize_t shape[2] = {(hsize_t)length, (hsize_t)dimension};
+    if (H5Sselect_hyperslab(h_filespace, op, offsets, NULL, shape, NULL) < 0)
+      error("Error while selecting the particles to read.");
+    op = H5S_SELECT_OR;
+    count -= length;
+  }
+}
+
+#ifdef WITH_MPI
+
+/**
+ * @brief Reads one of the arrays written by io_write_cell_offsets().
+ *
+ * @param h_grp The group holding the array.
+ * @param name The name of the array.
+ * @param nr_cells The number of cells.
+ * @param data (output) The array, sizeof number of cells.
+ *
+ * @return 1 if the array exists and has the right size, 0 otherwise.
+ */
+static int io_read_cell_array(hid_t h_grp, const char* name, int nr_cells,
+                              long long* data) {
+
+  const htri_t exist = H5Lexists(h_grp, name, 0);
+  if (exist < 0) error("Error while checking the existence of '%s'.", name);
+  if (exist == 0) return 0;
+
+  const hid_t h_data = H5Dopen(h_grp, name, H5P_DEFAULT);
+  if (h_data < 0) error("Error while opening cell array '%s'.", name);
+  const hid_t h_space = H5Dget_space(h_data);
+  const hssize_t size = H5Sget_simple_extent_npoints(h_space);
+  H5Sclose(h_space);
+
+  int found = 0;
+  if (size == nr_cells) {
+    if (H5Dread(h_data, io_hdf5_type(LONGLONG), H5S_ALL, H5S_ALL, H5P_DEFAULT,
+                data) < 0)
+      error("Error while reading cell array '%s'.", name);
+    found = 1;
+  }
+  H5Dclose(h_data);
+  return found;
+}
+
+/**
+ * @brief Reads the cell meta-data of ICs that are SWIFT snapshots.
+ *
+ * @param h_file The open ICs file.
+ * @param N_total The total number of particles of each type in the file.
+ * @param cdim (output) The number of cells per dimension.
+ * @param width (output) The width of the cells, in the units of the file.
+ * @param counts (output) The number of particles of each type in each cell,
+ * indexed by type * nr_cells + cell.
+ * @param offsets (output) The offsets in the file of the particles of each
+ * type in each cell, indexed the same way.
+ *
+ * @return The number of cells, 0 if the file has no (usable) cell meta-data.
+ */
+static int io_read_ic_cells(hid_t h_file,
+                            const long long N_total[swift_type_count],
+                            int cdim[3], double width[3], long long** counts,
+                            long long** offsets) {
+
+  /* Plain ICs have no cell meta-data */
+  const htri_t exist = H5Lexists(h_file, "/Cells", 0);
+  if (exist < 0) error("Error while checking the existence of '/Cells'.");
+  if (exist == 0 || H5Lexists(h_file, "/Cells/Meta-data", 0) <= 0 ||
+      H5Lexists(h_file, "/Cells/Counts", 0) <= 0 ||
+      H5Lexists(h_file, "/Cells/Offsets", 0) <= 0)
+    return 0;
+
+  const hid_t h_grp = H5Gopen(h_file, "/Cells/Meta-data", H5P_DEFAULT);
+  if (h_grp < 0) error("Error while opening the cell meta-data.");
+  io_read_attribute(h_grp, "dimension", INT, cdim);
+  io_read_attribute(h_grp, "size", DOUBLE, width);
+  H5Gclose(h_grp);
+  const int nr_cells = cdim[0] * cdim[1] * cdim[2];
+
+  *counts = (long long*)calloc(swift_type_count * nr_cells, sizeof(long long));
+  *offsets =
+      (long long*)calloc(swift_type_count * nr_cells, sizeof(long long));
+  if (*counts == NULL || *offsets == NULL)
+    error("Unable to allocate memory for the cell meta-data.");
+
+  const hid_t h_counts = H5Gopen(h_file, "/Cells/Counts", H5P_DEFAULT);
+  const hid_t h_offsets = H5Gopen(h_file, "/Cells/Offsets", H5P_DEFAULT);
+  if (h_counts < 0 || h_offsets < 0)
+    error("Error while opening the cell counts and offsets.");
+
+  /* Read the cells of all the types present and check they cover exactly
+   * the particles of the file */
+  int valid = 1;
+  for (int ptype = 0; ptype < swift_type_count && valid; ptype++) {
+
+    if (N_total[ptype] == 0) continue;
+
+    char name[PARTICLE_GROUP_BUFFER_SIZE];
+    snprintf(name, PARTICLE_GROUP_BUFFER_SIZE, "PartType%d", ptype);
+    long long* c = *counts + ptype * nr_cells;
+    long long* o = *offsets + ptype * nr_cells;
+    valid = io_read_cell_array(h_counts, name, nr_cells, c) &&
+            io_read_cell_array(h_offsets, name, nr_cells, o);
+
+    long long total = 0;
+    for (int k = 0; k < nr_cells && valid; k++) {
+      if (c[k] < 0 || o[k] < 0 || o[k] + c[k] > N_total[ptype]) valid = 0;
+      total += c[k];
+    }
+    if (total != N_total[ptype]) valid = 0;
+  }
+
+  H5Gclose(h_counts);
+  H5Gclose(h_offsets);
+
+  if (!valid) {
+    message("The cell meta-data of the ICs do not match their particles.");
+    free(*counts);
+    free(*offsets);
+    *counts = NULL;
+    *offsets = NULL;
+    return 0;
+  }
+  return nr_cells;
+}
+
+/**
+ * @brief Sorts ranges of particles by their offset.
+ */
+static int io_rangecmp(const void* p1, const void* p2) {
+  const long long* r1 = (const long long*)p1;
+  const long long* r2 = (const long long*)p2;
+  return (r1[0] > r2[0]) - (r1[0] < r2[0]);
+}
+
+/**
+ * @brief Decides which particles of the ICs each rank reads.
+ *
+ * ICs that are SWIFT snapshots carry the number of particles of each type in
+ * each top-level cell and their offsets in the file, see
+ * io_write_cell_offsets(). When they do, the cells are partitioned amongst
+ * the ranks (see partition_ic_cells()) and each rank reads the particles of
+ * its own cells only, so that they need not be redistributed once read.
+ * Otherwise each rank reads an equal slice of the particles of each type.
+ *
+ * @param h_file The open ICs file, only used on rank 0.
+ * @param initial_partition The #partition in which to decide and keep the
+ * partition of the cells, NULL to always read slices.
+ * @param length_factor The factor converting the lengths of the file to
+ * internal units.
+ * @param N_total The total number of particles of each type in the file.
+ * @param mpi_rank The MPI rank of this node.
+ * @param mpi_size The number of MPI ranks.
+ * @param comm The MPI communicator.
+ * @param N (output) The number of particles of each type to read on this
+ * rank.
+ * @param ranges (output) The ranges of particles of each type to read on this
+ * rank, as pairs of offset and count sorted by offset. To be freed.
+ * @param nr_ranges (output) The number of ranges of each type.
+ */
+void io_get_ic_ranges(hid_t h_file, struct partition* initial_partition,
+                      double length_factor,
+                      const long long N_total[swift_type_count], int mpi_rank,
+                      int mpi_size, MPI_Comm comm, size_t N[swift_type_count],
+                      long long* ranges[swift_type_count],
+                      int nr_ranges[swift_type_count]) {
+
+  int cdim[3] = {0, 0, 0};
+  double width[3] = {0., 0., 0.};
+  long long *counts = NULL, *offsets = NULL;
+  const int *celllist = NULL;
+
+  /* Rank 0 reads the cell meta-data, if any, and shares it */
+  int nr_cells = 0;
+  if (initial_partition != NULL && initial_partition->use_ic_cells &&
+      mpi_size > 1) {
+    if (mpi_rank == 0)
+      nr_cells =
+          io_read_ic_cells(h_file, N_total, cdim, width, &counts, &offsets);
+    MPI_Bcast(&nr_cells, 1, MPI_INT, 0, comm);
+  }
+
+  if (nr_cells > 0) {
+    MPI_Bcast(cdim, 3, MPI_INT, 0, comm);
+    MPI_Bcast(width, 3, MPI_DOUBLE, 0, comm);
+    if (mpi_rank != 0) {
+      counts =
+          (long long*)malloc(swift_type_count * nr_cells * sizeof(long long));
+      offsets =
+          (long long*)malloc(swift_type_count * nr_cells * sizeof(long long));
+      if (counts == NULL || offsets == NULL)
+        error("Unable to allocate memory for the cell meta-data.");
+    }
+    MPI_Bcast(counts, swift_type_count * nr_cells, MPI_LONG_LONG_INT, 0, comm);
+    MPI_Bcast(offsets, swift_type_count * nr_cells, MPI_LONG_LONG_INT, 0,
+              comm);
+    for (int k = 0; k < 3; k++) width[k] *= length_factor;
+
+    /* Balance the memory used by the particles of the cells */
+    const size_t sizes[swift_type_count] = {
+        sizeof(struct part),  sizeof(struct gpart), sizeof(struct gpart),
+        sizeof(struct gpart), sizeof(struct spart), sizeof(struct bpart)};
+    double* weights = (double*)calloc(nr_cells, sizeof(double));
+    if (weights == NULL) error("Unable to allocate memory for cell weights.");
+    for (int ptype = 0; ptype < swift_type_count; ptype++)
+      for (int k = 0; k < nr_cells; k++)
+        weights[k] += counts[ptype * nr_cells + k] * (double)sizes[ptype];
+
+    /* Every rank gets the same partition */
+    celllist = partition_ic_cells(initial_partition, mpi_size, cdim, width,
+                                  weights);
+    free(weights);
+
+    if (celllist == NULL && mpi_rank == 0)
+      message("Could not partition the cells of the ICs, reading slices.");
+    else if (mpi_rank == 0)
+      message("Reading the ICs by cells, [ %i %i %i ] cells.", cdim[0],
+              cdim[1], cdim[2]);
+  }
+
+  for (int ptype = 0; ptype < swift_type_count; ptype++) {
+
+    if (celllist == NULL) {
+
+      /* An equal slice for every rank */
+      const long long offset = mpi_rank * N_total[ptype] / mpi_size;
+      N[ptype] = (mpi_rank + 1) * N_total[ptype] / mpi_size - offset;
+      ranges[ptype] = (long long*)malloc(2 * sizeof(long long));
+      if (ranges[ptype] == NULL)
+        error("Unable to allocate memory for the ranges to read.");
+      ranges[ptype][0] = offset;
+      ranges[ptype][1] = N[ptype];
+      nr_ranges[ptype] = 1;
+      continue;
+    }
+
+    /* The particles of our cells... */
+    const long long* c = counts + ptype * nr_cells;
+    const long long* o = offsets + ptype * nr_cells;
+    int count = 0;
+    for (int k = 0; k < nr_cells; k++)
+      if (celllist[k] == mpi_rank && c[k] > 0) count++;
+    ranges[ptype] = (long long*)malloc(2 * max(count, 1) * sizeof(long long));
+    if (ranges[ptype] == NULL)
+      error("Unable to allocate memory for the ranges to read.");
+    count = 0;
+    for (int k = 0; k < nr_cells; k++) {
+      if (celllist[k] == mpi_rank && c[k] > 0) {
+        ranges[ptype][2 * count] = o[k];
+        ranges[ptype][2 * count + 1] = c[k];
+        count++;
+      }
+    }
+
+    /* ...in the order of the file, merging the consecutive ones. */
+    qsort(ranges[ptype], count, 2 * sizeof(long long), io_rangecmp);
+    int merged = 0;
+    N[ptype] = 0;
+    for (int k = 0; k < count; k++) {
+      const long long offset = ranges[ptype][2 * k];
+      const long long length = ranges[ptype][2 * k + 1];
+      long long* last =
+          (merged > 0) ? &ranges[ptype][2 * (merged - 1)] : NULL;
+      if (last != NULL && last[0] + last[1] == offset) {
+        last[1] += length;
+      } else {
+        ranges[ptype][2 * merged] = offset;
+        ranges[ptype][2 * merged + 1] = length;
+        merged++;
+      }
+      N[ptype] += length;
+    }
+    nr_ranges[ptype] = merged;
+  }
+
+  free(counts);
+  free(offsets);
+}
+
+#endif /* WITH_MPI */
+
 #endif /* HAVE_HDF5 */
 
 /**
@@ -1317,6 +1643,217 @@ void io_copy_temp_buffer(void* temp, const struct engine* e,
   }
 }
 
+/**
+ * @brief Can a field be written to disk straight from the particle arrays?
+ *
+ * This is the case of the fields that are copied verbatim from the particles
+ * and that need no unit conversion. HDF5 can then gather them directly from
+ * the particle structures using a strided memory dataspace (see
+ * #io_make_in_place_memspace()) without any temporary copy of the field.
+ *
+ * @param props The #io_props corresponding to the particle field.
+ * @param internal_units The system of units used internally.
+ * @param snapshot_units The system of units used for the snapshots.
+ */
+int io_can_write_in_place(const struct io_props props,
+                          const struct unit_system* internal_units,
+                          const struct unit_system* snapshot_units) {
+
+  if (props.conversion != 0 || props.field == NULL) return 0;
+
+  const double factor =
+      units_conversion_factor(internal_units, snapshot_units, props.units);
+  if (factor != 1.) return 0;
+
+  /* The stride must be a whole number of elements */
+  const size_t typeSize = io_sizeof_type(props.type);
+  return (props.partSize % typeSize == 0) &&
+         ((size_t)props.field % typeSize == 0);
+}
+
+/**
+ * @brief Creates the HDF5 memory dataspace selecting a field in the array of
+ * particles it belongs to.
+ *
+ * The particle array is seen as an N x (partSize / typeSize) array of
+ * elements starting at the field of the first particle, from which we select
+ * the first props.dimension columns. The buffer to pass to H5Dwrite() is then
+ * props.field.
+ *
+ * @param props The #io_props corresponding to the particle field.
+ * @param N The number of particles to write.
+ */
+hid_t io_make_in_place_memspace(const struct io_props props, size_t N) {
+
+  const size_t typeSize = io_sizeof_type(props.type);
+  const hsize_t shape[2] = {N, props.partSize / typeSize};
+  const hsize_t start[2] = {0, 0};
+  const hsize_t count[2] = {N, props.dimension};
+
+  const hid_t h_memspace = H5Screate_simple(2, shape, NULL);
+  if (h_memspace < 0)
+    error("Error while creating data space (memory) for field '%s'.",
+          props.name);
+
+  hid_t h_err;
+  if (N > 0)
+    h_err = H5Sselect_hyperslab(h_memspace, H5S_SELECT_SET, start, NULL,
+                                count, NULL);
+  else
+    h_err = H5Sselect_none(h_memspace);
+  if (h_err < 0)
+    error("Error while selecting the memory data space of field '%s'.",
+          props.name);
+
+  return h_memspace;
+}
+
+/**
+ * @brief The conversions to apply to a field read from the ICs.
+ */
+struct io_read_conversion {
+
+  /*! The field being read */
+  struct io_props props;
+
+  /*! The buffer the field was read into */
+  const char* temp;
+
+  /*! Size of the field of one particle */
+  size_t copySize;
+
+  /*! Conversion factors (in the precision used for each of them) */
+  double unit_factor, h_factor_d, vel_factor_d;
+  float h_factor_f, vel_factor_f;
+
+  /*! Which conversions to apply */
+  int with_units, with_h, with_vel;
+};
+
+/**
+ * @brief Mapper function converting a range of particles of a field read from
+ * the ICs and copying them into the particle arrays.
+ *
+ * @param map_data The start of the range in the read buffer.
+ * @param N The number of particles in the range.
+ * @param extra_data The #io_read_conversion.
+ */
+void io_convert_read_buffer_mapper(void* restrict map_data, int N,
+                                   void* restrict extra_data) {
+
+  const struct io_read_conversion* c =
+      (const struct io_read_conversion*)extra_data;
+  char* temp = (char*)map_data;
+  const size_t first = (temp - c->temp) / c->copySize;
+  const size_t num_elements = (size_t)N * c->props.dimension;
+
+  if (!c->with_units && !c->with_h && !c->with_vel) {
+    /* Nothing to convert */
+  } else if (io_is_double_precision(c->props.type)) {
+    double* temp_d = (double*)temp;
+    if (c->with_units)
+      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= c->unit_factor;
+    if (c->with_h)
+      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= c->h_factor_d;
+    if (c->with_vel)
+      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= c->vel_factor_d;
+
+  } else {
+    float* temp_f = (float*)temp;
+    if (c->with_units) {
+
+#ifdef SWIFT_DEBUG_CHECKS
+      float maximum = 0.f;
+      float minimum = FLT_MAX;
+#endif
+
+      /* Loop that converts the Units */
+      for (size_t i = 0; i < num_elements; ++i) {
+
+#ifdef SWIFT_DEBUG_CHECKS
+        /* Find the absolute minimum and maximum values */
+        const float abstemp_f = fabsf(temp_f[i]);
+        if (abstemp_f != 0.f) {
+          maximum = max(maximum, abstemp_f);
+          minimum = min(minimum, abstemp_f);
+        }
+#endif
+
+        /* Convert the float units */
+        temp_f[i] *= c->unit_factor;
+      }
+
+#ifdef SWIFT_DEBUG_CHECKS
+      /* The two possible errors: larger than float or smaller
+       * than float precision. */
+      if (c->unit_factor * maximum > FLT_MAX) {
+        error("Unit conversion results in numbers larger than floats");
+      } else if (c->unit_factor * minimum < FLT_MIN) {
+        error("Numbers smaller than float precision");
+      }
+#endif
+    }
+    if (c->with_h)
+      for (size_t i = 0; i < num_elements; ++i) temp_f[i] *= c->h_factor_f;
+    if (c->with_vel)
+      for (size_t i = 0; i < num_elements; ++i) temp_f[i] *= c->vel_factor_f;
+  }
+
+  /* Copy temporary buffer to particle data */
+  for (int i = 0; i < N; ++i)
+    memcpy(c->props.field + (first + i) * c->props.partSize,
+           &temp[i * c->copySize], c->copySize);
+}
+
+/**
+ * @brief Converts a field read from the ICs to the internal units, cleans
+ * the h and sqrt(a) factors if requested, and copies it into the particle
+ * arrays, using the threads of the given #threadpool.
+ *
+ * @param tp The #threadpool.
+ * @param props The #io_props of the field read.
+ * @param N The number of particles read.
+ * @param temp The buffer the field was read into (modified).
+ * @param internal_units The #unit_system used internally.
+ * @param ic_units The #unit_system used in the ICs.
+ * @param cleanup_h Are we removing h-factors from the ICs?
+ * @param cleanup_sqrt_a Are we cleaning-up the sqrt(a) factors in the Gadget
+ * IC velocities?
+ * @param h The value of the reduced Hubble constant to use for cleaning.
+ * @param a The current value of the scale-factor.
+ */
+void io_convert_read_buffer(struct threadpool* tp, const struct io_props props,
+                            size_t N, void* temp,
+                            const struct unit_system* internal_units,
+                            const struct unit_system* ic_units, int cleanup_h,
+                            int cleanup_sqrt_a, double h, double a) {
+
+  struct io_read_conversion c;
+  c.props = props;
+  c.temp = (const char*)temp;
+  c.copySize = io_sizeof_type(props.type) * props.dimension;
+
+  /* Unit conversion if necessary */
+  c.unit_factor =
+      units_conversion_factor(ic_units, internal_units, props.units);
+  c.with_units = (c.unit_factor != 1.);
+
+  /* Clean-up h if necessary */
+  const float h_factor_exp = units_h_factor(internal_units, props.units);
+  c.with_h = cleanup_h && h_factor_exp != 0.f;
+  c.h_factor_d = pow(h, h_factor_exp);
+  c.h_factor_f = pow(h, h_factor_exp);
+
+  /* Clean-up a if necessary */
+  c.with_vel =
+      cleanup_sqrt_a && a != 1. && (strcmp(props.name, "Velocities") == 0);
+  c.vel_factor_d = sqrt(a);
+  c.vel_factor_f = sqrt(a);
+
+  threadpool_map(tp, io_convert_read_buffer_mapper, temp, N, c.copySize,
+                 threadpool_auto_chunk_size, &c);
+}
+
 void io_prepare_dm_gparts_mapper(void* restrict data, int Ndm, void* dummy) {
 
   struct gpart* restrict gparts = (struct gpart*)data;
@@ -1538,6 +2075,102 @@ void io_duplicate_black_holes_gparts(struct threadpool* tp,
                  Nblackholes, sizeof(struct bpart), 0, &data);
 }
 
+/**
+ * @brief Decides from its ID whether a particle is part of the subsample
+ * written in the snipshots.
+ *
+ * The ID is hashed (splitmix64 finaliser) such that the same particles are
+ * picked in every snipshot and that they sample the volume evenly.
+ *
+ * @param id The ID of the particle.
+ * @param fraction The fraction of the particles to keep.
+ */
+__attribute__((always_inline)) INLINE static int io_snipshot_keep_id(
+    const long long id, const float fraction) {
+
+  if (fraction >= 1.f) return 1;
+
+  unsigned long long x = (unsigned long long)id + 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+
+  /* Uniform deviate in [0, 1) from the top 53 bits */
+  return (double)(x >> 11) * (1. / 9007199254740992.) < fraction;
+}
+
+/**
+ * @brief Decides whether a #part is written in the current output.
+ *
+ * @param p The #part.
+ * @param fraction The fraction of the particles picked by ID.
+ * @param density_threshold The comoving density above which all the particles
+ * are written.
+ */
+__attribute__((always_inline)) INLINE static int io_part_to_write(
+    const struct part* p, const float fraction,
+    const float density_threshold) {
+
+  if (p->time_bin == time_bin_inhibited || p->time_bin == time_bin_not_created)
+    return 0;
+
+  return io_snipshot_keep_id(p->id, fraction) ||
+         hydro_get_comoving_density(p) >= density_threshold;
+}
+
+/**
+ * @brief Counts the particles of each type written in a snipshot.
+ *
+ * Full snapshots use the counters of the #space directly; this goes through
+ * the particles to apply the subsampling of the snipshots.
+ *
+ * @param s The #space.
+ * @param fraction The fraction of the particles picked by ID.
+ * @param density_threshold The comoving density above which all the gas
+ * particles are written.
+ * @param Ngas (return) The number of gas particles to write.
+ * @param Ndm (return) The number of DM particles to write.
+ * @param Nstars (return) The number of star particles to write.
+ * @param Nblackholes (return) The number of black hole particles to write.
+ */
+void io_count_snipshot_particles(const struct space* s, const float fraction,
+                                 const float density_threshold, size_t* Ngas,
+                                 size_t* Ndm, size_t* Nstars,
+                                 size_t* Nblackholes) {
+
+  *Ngas = 0;
+  for (size_t i = 0; i < s->nr_parts; ++i)
+    if (io_part_to_write(&s->parts[i], fraction, density_threshold)) ++*Ngas;
+
+  *Ndm = 0;
+  for (size_t i = 0; i < s->nr_gparts; ++i) {
+    const struct gpart* gp = &s->gparts[i];
+    if (gp->time_bin != time_bin_inhibited &&
+        gp->time_bin != time_bin_not_created &&
+        gp->type == swift_type_dark_matter &&
+        io_snipshot_keep_id(gp->id_or_neg_offset, fraction))
+      ++*Ndm;
+  }
+
+  *Nstars = 0;
+  for (size_t i = 0; i < s->nr_sparts; ++i) {
+    const struct spart* sp = &s->sparts[i];
+    if (sp->time_bin != time_bin_inhibited &&
+        sp->time_bin != time_bin_not_created &&
+        io_snipshot_keep_id(sp->id, fraction))
+      ++*Nstars;
+  }
+
+  *Nblackholes = 0;
+  for (size_t i = 0; i < s->nr_bparts; ++i) {
+    const struct bpart* bp = &s->bparts[i];
+    if (bp->time_bin != time_bin_inhibited &&
+        bp->time_bin != time_bin_not_created &&
+        io_snipshot_keep_id(bp->id, fraction))
+      ++*Nblackholes;
+  }
+}
+
 /**
  * @brief Copy every non-inhibited #part into the parts_written array.
  *
@@ -1549,13 +2182,18 @@ void io_duplicate_black_holes_gparts(struct threadpool* tp,
  * write.
  * @param Nparts The total number of #part.
  * @param Nparts_written The total number of #part to write.
+ * @param fraction The fraction of the particles picked by ID (1 for full
+ * snapshots).
+ * @param density_threshold The comoving density above which all the
+ * particles are written (FLT_MAX for full snapshots).
  */
 void io_collect_parts_to_write(const struct part* restrict parts,
                                const struct xpart* restrict xparts,
                                struct part* restrict parts_written,
                                struct xpart* restrict xparts_written,
-                               const size_t Nparts,
-                               const size_t Nparts_written) {
+                               const size_t Nparts, const size_t Nparts_written,
+                               const float fraction,
+                               const float density_threshold) {
 
   size_t count = 0;
 
@@ -1563,8 +2201,7 @@ void io_collect_parts_to_write(const struct part* restrict parts,
   for (size_t i = 0; i < Nparts; ++i) {
 
     /* And collect the ones that have not been removed */
-    if (parts[i].time_bin != time_bin_inhibited &&
-        parts[i].time_bin != time_bin_not_created) {
+    if (io_part_to_write(&parts[i], fraction, density_threshold)) {
 
       parts_written[count] = parts[i];
       xparts_written[count] = xparts[i];
@@ -1586,11 +2223,14 @@ void io_collect_parts_to_write(const struct part* restrict parts,
  * write.
  * @param Nsparts The total number of #part.
  * @param Nsparts_written The total number of #part to write.
+ * @param fraction The fraction of the particles picked by ID (1 for full
+ * snapshots).
  */
 void io_collect_sparts_to_write(const struct spart* restrict sparts,
                                 struct spart* restrict sparts_written,
                                 const size_t Nsparts,
-                                const size_t Nsparts_written) {
+                                const size_t Nsparts_written,
+                                const float fraction) {
 
   size_t count = 0;
 
@@ -1599,7 +2239,8 @@ void io_collect_sparts_to_write(const struct spart* restrict sparts,
 
     /* And collect the ones that have not been removed */
     if (sparts[i].time_bin != time_bin_inhibited &&
-        sparts[i].time_bin != time_bin_not_created) {
+        sparts[i].time_bin != time_bin_not_created &&
+        io_snipshot_keep_id(sparts[i].id, fraction)) {
 
       sparts_written[count] = sparts[i];
       count++;
@@ -1620,11 +2261,14 @@ void io_collect_sparts_to_write(const struct spart* restrict sparts,
  * write.
  * @param Nbparts The total number of #part.
  * @param Nbparts_written The total number of #part to write.
+ * @param fraction The fraction of the particles picked by ID (1 for full
+ * snapshots).
  */
 void io_collect_bparts_to_write(const struct bpart* restrict bparts,
                                 struct bpart* restrict bparts_written,
                                 const size_t Nbparts,
-                                const size_t Nbparts_written) {
+                                const size_t Nbparts_written,
+                                const float fraction) {
 
   size_t count = 0;
 
@@ -1633,7 +2277,8 @@ void io_collect_bparts_to_write(const struct bpart* restrict bparts,
 
     /* And collect the ones that have not been removed */
     if (bparts[i].time_bin != time_bin_inhibited &&
-        bparts[i].time_bin != time_bin_not_created) {
+        bparts[i].time_bin != time_bin_not_created &&
+        io_snipshot_keep_id(bparts[i].id, fraction)) {
 
       bparts_written[count] = bparts[i];
       count++;
@@ -1658,13 +2303,16 @@ void io_collect_bparts_to_write(const struct bpart* restrict bparts,
  * @param Ngparts The total number of #part.
  * @param Ngparts_written The total number of #part to write.
  * @param with_stf Are we running with STF? i.e. do we want to collect vr data?
+ * @param fraction The fraction of the particles picked by ID (1 for full
+ * snapshots).
  */
 void io_collect_gparts_to_write(
     const struct gpart* restrict gparts,
     const struct velociraptor_gpart_data* restrict vr_data,
     struct gpart* restrict gparts_written,
     struct velociraptor_gpart_data* restrict vr_data_written,
-    const size_t Ngparts, const size_t Ngparts_written, const int with_stf) {
+    const size_t Ngparts, const size_t Ngparts_written, const int with_stf,
+    const float fraction) {
 
   size_t count = 0;
 
@@ -1674,7 +2322,8 @@ void io_collect_gparts_to_write(
     /* And collect the ones that have not been removed */
     if ((gparts[i].time_bin != time_bin_inhibited) &&
         (gparts[i].time_bin != time_bin_not_created) &&
-        (gparts[i].type == swift_type_dark_matter)) {
+        (gparts[i].type == swift_type_dark_matter) &&
+        io_snipshot_keep_id(gparts[i].id_or_neg_offset, fraction)) {
 
       if (with_stf) vr_data_written[count] = vr_data[i];
 
@@ -1722,7 +2371,7 @@ void io_check_output_fields(const struct swift_params* params,
 
       case swift_type_gas:
         hydro_write_particles(&p, &xp, list, &num_fields);
-        num_fields += chemistry_write_particles(&p, list + num_fields);
+        num_fields += chemistry_write_particles(&p, &xp, list + num_fields);
         break;
 
       case swift_type_dark_matter:
@@ -1743,9 +2392,14 @@ void io_check_output_fields(const struct swift_params* params,
 
       char section_name[PARSER_MAX_LINE_SIZE];
 
-      /* Skip if wrong section */
-      sprintf(section_name, "SelectOutput:");
-      if (strstr(param_name, section_name) == NULL) continue;
+      /* Skip if wrong section (full snapshots or snipshots) */
+      const char* section = NULL;
+      if (strncmp(param_name, "SelectOutput:", 13) == 0)
+        section = "SelectOutput";
+      else if (strncmp(param_name, "SelectOutputSnipshot:", 21) == 0)
+        section = "SelectOutputSnipshot";
+      else
+        continue;
 
       /* Skip if wrong particle type */
       sprintf(section_name, "_%s", part_type_names[ptype]);
@@ -1756,22 +2410,30 @@ void io_check_output_fields(const struct swift_params* params,
       /* loop over each possible output field */
       for (int field_id = 0; field_id < num_fields; field_id++) {
         char field_name[PARSER_MAX_LINE_SIZE];
-        sprintf(field_name, "SelectOutput:%s_%s", list[field_id].name,
-                part_type_names[ptype]);
+        if (snprintf(field_name, PARSER_MAX_LINE_SIZE, "%s:%s_%s", section,
+                     list[field_id].name,
+                     part_type_names[ptype]) >= PARSER_MAX_LINE_SIZE)
+          continue;
 
         if (strcmp(param_name, field_name) == 0) {
           found = 1;
-          /* check if correct input */
+          /* check if correct input: 0, 1 or the name of a filter */
+          const char* value = params->data[param_id].value;
           int retParam = 0;
           char str[PARSER_MAX_LINE_SIZE];
-          sscanf(params->data[param_id].value, "%d%s", &retParam, str);
-
-          /* Check that we have a 0 or 1 */
-          if (retParam != 0 && retParam != 1)
+          int valid = 0;
+          if (sscanf(value, "%d%s", &retParam, str) == 1)
+            valid = (retParam == 0 || retParam == 1);
+          else
+            for (int k = 0; k < compression_level_count && !valid; k++)
+              if (strcmp(value, lossy_compression_schemes_names[k]) == 0)
+                valid = 1;
+
+          if (!valid)
             message(
-                "WARNING: Unexpected input for %s. Received %i but expect 0 or "
-                "1. ",
-                field_name, retParam);
+                "WARNING: Unexpected input for %s. Received '%s' but expect 0, "
+                "1 or the name of a lossy compression scheme.",
+                field_name, value);
 
           /* Found it, so move to the next one. */
           break;
@@ -1808,7 +2470,7 @@ void io_write_output_field_parameter(const char* filename) {
 
       case swift_type_gas:
         hydro_write_particles(NULL, NULL, list, &num_fields);
-        num_fields += chemistry_write_particles(NULL, list + num_fields);
+        num_fields += chemistry_write_particles(NULL, NULL, list + num_fields);
         break;
 
       case swift_type_dark_matter:
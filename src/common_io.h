@@ -23,6 +23,11 @@
 /* Config parameters. */
 #include "../config.h"
 
+/* MPI headers. */
+#ifdef WITH_MPI
+#include <mpi.h>
+#endif
+
 /* Local includes. */
 #include "part_type.h"
 #include "units.h"
@@ -42,7 +47,9 @@ struct bpart;
 struct xpart;
 struct io_props;
 struct engine;
+struct partition;
 struct threadpool;
+struct space;
 
 /**
  * @brief The different types of data used in the GADGET IC files.
@@ -82,12 +89,26 @@ void io_write_engine_policy(hid_t h_file, const struct engine* e);
 
 void io_write_cell_offsets(hid_t h_grp, const int cdim[3],
                            const struct cell* cells_top, const int nr_cells,
-                           const double width[3], const int nodeID,
+                           const int* cells_order, const double width[3],
+                           const int nodeID,
                            const long long global_counts[swift_type_count],
                            const long long global_offsets[swift_type_count],
                            const struct unit_system* internal_units,
                            const struct unit_system* snapshot_units);
 
+void io_select_ranges(hid_t h_filespace, const long long* ranges,
+                      int nr_ranges, long long first, long long count,
+                      int dimension);
+
+#ifdef WITH_MPI
+void io_get_ic_ranges(hid_t h_file, struct partition* initial_partition,
+                      double length_factor,
+                      const long long N_total[swift_type_count], int mpi_rank,
+                      int mpi_size, MPI_Comm comm, size_t N[swift_type_count],
+                      long long* ranges[swift_type_count],
+                      int nr_ranges[swift_type_count]);
+#endif
+
 void io_read_unit_system(hid_t h_file, struct unit_system* ic_units,
                          const struct unit_system* internal_units,
                          int mpi_rank);
@@ -98,32 +119,49 @@ void io_copy_temp_buffer(void* temp, const struct engine* e,
                          const struct io_props props, size_t N,
                          const struct unit_system* internal_units,
                          const struct unit_system* snapshot_units);
+int io_can_write_in_place(const struct io_props props,
+                          const struct unit_system* internal_units,
+                          const struct unit_system* snapshot_units);
+hid_t io_make_in_place_memspace(const struct io_props props, size_t N);
 
 #endif /* defined HDF5 */
 
 size_t io_sizeof_type(enum IO_DATA_TYPE type);
 int io_is_double_precision(enum IO_DATA_TYPE type);
 
+void io_count_snipshot_particles(const struct space* s, const float fraction,
+                                 const float density_threshold, size_t* Ngas,
+                                 size_t* Ndm, size_t* Nstars,
+                                 size_t* Nblackholes);
 void io_collect_parts_to_write(const struct part* restrict parts,
                                const struct xpart* restrict xparts,
                                struct part* restrict parts_written,
                                struct xpart* restrict xparts_written,
-                               const size_t Nparts,
-                               const size_t Nparts_written);
+                               const size_t Nparts, const size_t Nparts_written,
+                               const float fraction,
+                               const float density_threshold);
 void io_collect_sparts_to_write(const struct spart* restrict sparts,
                                 struct spart* restrict sparts_written,
                                 const size_t Nsparts,
-                                const size_t Nsparts_written);
+                                const size_t Nsparts_written,
+                                const float fraction);
 void io_collect_bparts_to_write(const struct bpart* restrict bparts,
                                 struct bpart* restrict bparts_written,
                                 const size_t Nbparts,
-                                const size_t Nbparts_written);
+                                const size_t Nbparts_written,
+                                const float fraction);
 void io_collect_gparts_to_write(const struct gpart* restrict gparts,
                                 const struct velociraptor_gpart_data* vr_data,
                                 struct gpart* restrict gparts_written,
                                 struct velociraptor_gpart_data* vr_data_written,
                                 const size_t Ngparts,
-                                const size_t Ngparts_written, int with_stf);
+                                const size_t Ngparts_written, int with_stf,
+                                const float fraction);
+void io_convert_read_buffer(struct threadpool* tp, const struct io_props props,
+                            size_t N, void* temp,
+                            const struct unit_system* internal_units,
+                            const struct unit_system* ic_units, int cleanup_h,
+                            int cleanup_sqrt_a, double h, double a);
 void io_prepare_dm_gparts(struct threadpool* tp, struct gpart* const gparts,
                           size_t Ndm);
 void io_duplicate_hydro_gparts(struct threadpool* tp, struct part* const parts,
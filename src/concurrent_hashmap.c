@@ -0,0 +1,205 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <stdlib.h>
+#include <string.h>
+
+/* This object's header. */
+#include "concurrent_hashmap.h"
+
+/* Local headers. */
+#include "atomic.h"
+#include "error.h"
+#include "memuse.h"
+#include "threadpool.h"
+
+/* Smallest table we allocate. */
+#define CONCURRENT_HASHMAP_MIN_TABLE_SIZE (64)
+
+/**
+ * @brief Hash function for the keys (the 64-bit finaliser of MurmurHash3).
+ *
+ * The FOF keys are particle indices, i.e. consecutive integers, so we need a
+ * proper mixing to avoid long runs of occupied slots with linear probing.
+ */
+__attribute__((always_inline)) INLINE static size_t concurrent_hashmap_hash(
+    hashmap_key_t key) {
+
+  unsigned long long h = (unsigned long long)key;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (size_t)h;
+}
+
+void concurrent_hashmap_init(concurrent_hashmap_t *m, size_t max_size) {
+
+  /* Get the smallest power of two respecting the fill ratio. */
+  size_t table_size = CONCURRENT_HASHMAP_MIN_TABLE_SIZE;
+  while (table_size * CONCURRENT_HASHMAP_MAX_FILL_RATIO < max_size)
+    table_size *= 2;
+
+  m->data = (hashmap_element_t *)swift_malloc(
+      "concurrent_hashmap", table_size * sizeof(hashmap_element_t));
+  if (m->data == NULL)
+    error("Unable to allocate a concurrent hashmap of size %zu.", table_size);
+
+  /* Empty keys and values at zero. */
+  bzero(m->data, table_size * sizeof(hashmap_element_t));
+  for (size_t k = 0; k < table_size; k++)
+    m->data[k].key = CONCURRENT_HASHMAP_EMPTY_KEY;
+
+  m->table_size = table_size;
+  m->size = 0;
+}
+
+/**
+ * @brief Find the element of a given key, creating it if requested.
+ *
+ * The key of a slot is only ever changed once, from the empty key to its final
+ * value, with a CAS. We use linear probing from the hashed offset.
+ */
+static hashmap_element_t *concurrent_hashmap_find(concurrent_hashmap_t *m,
+                                                  hashmap_key_t key,
+                                                  const int create_new) {
+#ifdef SWIFT_DEBUG_CHECKS
+  if (key == CONCURRENT_HASHMAP_EMPTY_KEY)
+    error("Trying to use the empty key in a concurrent hashmap.");
+#endif
+
+  const size_t mask = m->table_size - 1;
+  size_t offset = concurrent_hashmap_hash(key) & mask;
+
+  for (size_t i = 0; i < m->table_size; i++) {
+
+    hashmap_element_t *element = &m->data[offset];
+    hashmap_key_t current = ((volatile hashmap_element_t *)element)->key;
+
+    /* Found it? */
+    if (current == key) return element;
+
+    /* Empty slot? Try to claim it. */
+    if (current == CONCURRENT_HASHMAP_EMPTY_KEY) {
+
+      /* The key is not in the map. */
+      if (!create_new) return NULL;
+
+      current = atomic_cas(&element->key, CONCURRENT_HASHMAP_EMPTY_KEY, key);
+
+      /* We got the slot or someone else inserted the same key. */
+      if (current == CONCURRENT_HASHMAP_EMPTY_KEY) {
+        atomic_inc(&m->size);
+        return element;
+      } else if (current == key) {
+        return element;
+      }
+    }
+
+    /* Collision, try the next slot. */
+    offset = (offset + 1) & mask;
+  }
+
+  /* The table is full. */
+  return NULL;
+}
+
+hashmap_value_t *concurrent_hashmap_get(concurrent_hashmap_t *m,
+                                        hashmap_key_t key) {
+  hashmap_element_t *element = concurrent_hashmap_find(m, key, 1);
+  return element ? &element->value : NULL;
+}
+
+hashmap_value_t *concurrent_hashmap_lookup(concurrent_hashmap_t *m,
+                                           hashmap_key_t key) {
+  hashmap_element_t *element = concurrent_hashmap_find(m, key, 0);
+  return element ? &element->value : NULL;
+}
+
+int concurrent_hashmap_add(concurrent_hashmap_t *m, hashmap_key_t key,
+                           long long value_st, double value_dbl) {
+
+  hashmap_value_t *value = concurrent_hashmap_get(m, key);
+  if (value == NULL) return 0;
+
+  if (value_st != 0) atomic_add(&value->value_st, value_st);
+  if (value_dbl != 0.) atomic_add_d(&value->value_dbl, value_dbl);
+  return 1;
+}
+
+void concurrent_hashmap_iterate(concurrent_hashmap_t *m, hashmap_mapper_t f,
+                                void *data) {
+
+  for (size_t k = 0; k < m->table_size; k++) {
+    hashmap_element_t *element = &m->data[k];
+    if (element->key != CONCURRENT_HASHMAP_EMPTY_KEY)
+      f(element->key, &element->value, data);
+  }
+}
+
+/* Data passed to the parallel iteration mapper. */
+struct concurrent_hashmap_iterate_data {
+  hashmap_mapper_t f;
+  void *data;
+};
+
+/**
+ * @brief Mapper function calling the user function on a range of slots.
+ */
+static void concurrent_hashmap_iterate_mapper(void *map_data, int num_elements,
+                                              void *extra_data) {
+
+  hashmap_element_t *elements = (hashmap_element_t *)map_data;
+  struct concurrent_hashmap_iterate_data *iter_data =
+      (struct concurrent_hashmap_iterate_data *)extra_data;
+
+  for (int k = 0; k < num_elements; k++) {
+    hashmap_element_t *element = &elements[k];
+    if (element->key != CONCURRENT_HASHMAP_EMPTY_KEY)
+      iter_data->f(element->key, &element->value, iter_data->data);
+  }
+}
+
+void concurrent_hashmap_iterate_parallel(concurrent_hashmap_t *m,
+                                         struct threadpool *tp,
+                                         hashmap_mapper_t f, void *data) {
+
+  struct concurrent_hashmap_iterate_data iter_data = {f, data};
+  threadpool_map(tp, concurrent_hashmap_iterate_mapper, m->data, m->table_size,
+                 sizeof(hashmap_element_t), 0, &iter_data);
+}
+
+void concurrent_hashmap_free(concurrent_hashmap_t *m) {
+  swift_free("concurrent_hashmap", m->data);
+  m->data = NULL;
+  m->table_size = 0;
+  m->size = 0;
+}
+
+size_t concurrent_hashmap_size(concurrent_hashmap_t *m) {
+  if (m != NULL)
+    return m->size;
+  else
+    return 0;
+}
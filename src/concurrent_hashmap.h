@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+/*
+ * Lock-free open-addressing hashmap.
+ *
+ * All the threads insert into the same table. Keys are claimed with a CAS on
+ * an empty slot and the values are then updated in-place with atomics by the
+ * callers. The table has a fixed capacity set at initialisation time and is
+ * never re-hashed, so the pointers to the values remain valid until the map
+ * is freed.
+ */
+#ifndef SWIFT_CONCURRENT_HASHMAP_H
+#define SWIFT_CONCURRENT_HASHMAP_H
+
+/* Some standard headers. */
+#include <stddef.h>
+
+/* Local headers. */
+#include "hashmap.h"
+
+/* Forward declarations. */
+struct threadpool;
+
+/* Key used to mark the empty slots. */
+#define CONCURRENT_HASHMAP_EMPTY_KEY ((hashmap_key_t)-1)
+
+/* Maximal fill ratio of the table. */
+#define CONCURRENT_HASHMAP_MAX_FILL_RATIO (0.5)
+
+/* A concurrent hashmap has a fixed capacity (a power of two) and a current
+ * size, as well as the data to hold. */
+typedef struct _concurrent_hashmap {
+  size_t table_size;
+  volatile size_t size;
+  hashmap_element_t *data;
+} concurrent_hashmap_t;
+
+/**
+ * @brief Initialize a concurrent hashmap able to hold at least max_size keys.
+ */
+void concurrent_hashmap_init(concurrent_hashmap_t *m, size_t max_size);
+
+/**
+ * @brief Get the value for a given key. If no value exists a new one,
+ * initialised to zero, will be created.
+ *
+ * Can be called concurrently by any number of threads. The value must then be
+ * updated with atomic operations. Returns NULL if the table is full.
+ */
+extern hashmap_value_t *concurrent_hashmap_get(concurrent_hashmap_t *m,
+                                               hashmap_key_t key);
+
+/**
+ * @brief Look for the given key and return a pointer to its value or NULL if
+ * it is not in the hashmap.
+ */
+extern hashmap_value_t *concurrent_hashmap_lookup(concurrent_hashmap_t *m,
+                                                  hashmap_key_t key);
+
+/**
+ * @brief Atomically add to the values of a given key, creating it if needed.
+ *
+ * Returns 0 if the table is full, 1 otherwise.
+ */
+extern int concurrent_hashmap_add(concurrent_hashmap_t *m, hashmap_key_t key,
+                                  long long value_st, double value_dbl);
+
+/**
+ * @brief Iterate the function parameter over each element in the hashmap.
+ *
+ * The function `f` takes three arguments, the first and second are the element
+ * key and a pointer to the correspondig value, respectively, while the third
+ * is the `void *data` argument.
+ */
+extern void concurrent_hashmap_iterate(concurrent_hashmap_t *m,
+                                       hashmap_mapper_t f, void *data);
+
+/**
+ * @brief Iterate the function parameter over each element in the hashmap
+ * using the threads of a #threadpool.
+ *
+ * The function `f` is called concurrently and must be thread-safe.
+ */
+extern void concurrent_hashmap_iterate_parallel(concurrent_hashmap_t *m,
+                                                struct threadpool *tp,
+                                                hashmap_mapper_t f, void *data);
+
+/**
+ * @brief De-allocate memory associated with this hashmap.
+ */
+extern void concurrent_hashmap_free(concurrent_hashmap_t *m);
+
+/**
+ * Get the current size of a concurrent hashmap
+ */
+extern size_t concurrent_hashmap_size(concurrent_hashmap_t *m);
+
+#endif /* SWIFT_CONCURRENT_HASHMAP_H */
@@ -28,6 +28,7 @@
 #include <float.h>
 #include <hdf5.h>
 #include <math.h>
+#include <string.h>
 #include <time.h>
 
 /* Local includes. */
@@ -46,6 +47,7 @@
 #include "part.h"
 #include "physical_constants.h"
 #include "space.h"
+#include "timers.h"
 #include "units.h"
 
 /* Maximum number of iterations for bisection scheme */
@@ -119,7 +121,8 @@ __attribute__((always_inline)) INLINE void get_redshift_index(
  * given time-step or redshift. Predominantly used to read cooling tables
  * above and below the current redshift, if not already read in.
  *
- * Also calls the additional H reionisation energy injection if need be.
+ * Also calls the additional H reionisation energy injection if need be and
+ * re-tabulates the rates in energy space if they are used.
  *
  * @param cosmo The current cosmological model.
  * @param cooling The #cooling_function_data used in the run.
@@ -155,7 +158,10 @@ void cooling_update(const struct cosmology *cosmo,
   }
 
   /* Do we already have the correct tables loaded? */
-  if (cooling->z_index == z_index) return;
+  if (cooling->z_index == z_index) {
+    compute_energy_space_rates(cooling, cosmo->z);
+    return;
+  }
 
   /* Which table should we load ? */
   if (z_index >= eagle_cooling_N_redshifts) {
@@ -182,6 +188,15 @@ void cooling_update(const struct cosmology *cosmo,
 
   /* Store the currently loaded index */
   cooling->z_index = z_index;
+
+  /* Read the files of the next redshift bin in the background */
+  if (z_index == eagle_cooling_N_redshifts + 1)
+    cooling_prefetch_tables(cooling, eagle_cooling_N_redshifts - 2);
+  else if (z_index < eagle_cooling_N_redshifts)
+    cooling_prefetch_tables(cooling, z_index - 1);
+
+  /* Re-tabulate the rates in energy space for the new tables */
+  compute_energy_space_rates(cooling, cosmo->z);
 }
 
 /**
@@ -342,74 +357,56 @@ INLINE static double bisection_iter(
 }
 
 /**
- * @brief Apply the cooling function to a particle.
- *
- * We want to compute u_new such that u_new = u_old + dt * du/dt(u_new, X),
- * where X stands for the metallicity, density and redshift. These are
- * kept constant.
- *
- * We first compute du/dt(u_old). If dt * du/dt(u_old) is small enough, we
- * use an explicit integration and use this as our solution.
- *
- * Otherwise, we try to find a solution to the implicit time-integration
- * problem. This leads to the root-finding problem:
- *
- * f(u_new) = u_new - u_old - dt * du/dt(u_new, X) = 0
- *
- * We first try a few Newton-Raphson iteration if it does not converge, we
- * revert to a bisection scheme.
- *
- * This is done by first bracketing the solution and then iterating
- * towards the solution by reducing the window down to a certain tolerance.
- * Note there is always at least one solution since
- * f(+inf) is < 0 and f(-inf) is > 0.
+ * @brief Computes the quantities that stay constant while integrating the
+ * cooling of a particle.
  *
  * @param phys_const The physical constants in internal units.
  * @param us The internal system of units.
  * @param cosmo The current cosmological model.
  * @param hydro_properties the hydro_props struct
- * @param floor_props Properties of the entropy floor.
  * @param cooling The #cooling_function_data used in the run.
  * @param p Pointer to the particle data.
  * @param xp Pointer to the extended particle data.
  * @param dt The cooling time-step of this particle.
  * @param dt_therm The hydro time-step of this particle.
+ * @param u_start (return) Internal energy at the last kick step.
+ * @param u_0_cgs (return) Internal energy to integrate from in CGS.
+ * @param n_H_cgs (return) Hydrogen number density in CGS.
+ * @param ratefact_cgs (return) Multiplication factor to get a cooling rate.
+ * @param dt_cgs (return) The time-step in CGS.
+ * @param Lambda_He_reion_cgs (return) Cooling rate from He reionization.
+ * @param abundance_ratio (return) Ratios of metal abundance to solar.
+ * @param n_H_index (return) Hydrogen number density index.
+ * @param d_n_H (return) Hydrogen number density offset.
+ * @param He_index (return) Helium fraction index.
+ * @param d_He (return) Helium fraction offset.
  */
-void cooling_cool_part(const struct phys_const *phys_const,
-                       const struct unit_system *us,
-                       const struct cosmology *cosmo,
-                       const struct hydro_props *hydro_properties,
-                       const struct entropy_floor_properties *floor_props,
-                       const struct cooling_function_data *cooling,
-                       struct part *restrict p, struct xpart *restrict xp,
-                       const float dt, const float dt_therm) {
-
-  /* No cooling happens over zero time */
-  if (dt == 0.) return;
-
-#ifdef SWIFT_DEBUG_CHECKS
-  if (cooling->Redshifts == NULL)
-    error(
-        "Cooling function has not been initialised. Did you forget the "
-        "--cooling runtime flag?");
-#endif
+__attribute__((always_inline)) INLINE static void cooling_prepare_part(
+    const struct phys_const *phys_const, const struct unit_system *us,
+    const struct cosmology *cosmo, const struct hydro_props *hydro_properties,
+    const struct cooling_function_data *cooling, const struct part *restrict p,
+    const struct xpart *restrict xp, const float dt, const float dt_therm,
+    float *u_start, double *u_0_cgs, double *n_H_cgs, double *ratefact_cgs,
+    double *dt_cgs, double *Lambda_He_reion_cgs,
+    float abundance_ratio[chemistry_element_count + 2], int *n_H_index,
+    float *d_n_H, int *He_index, float *d_He) {
 
   /* Get internal energy at the last kick step */
-  const float u_start = hydro_get_physical_internal_energy(p, xp, cosmo);
+  *u_start = hydro_get_physical_internal_energy(p, xp, cosmo);
 
   /* Get the change in internal energy due to hydro forces */
   const float hydro_du_dt = hydro_get_physical_internal_energy_dt(p, cosmo);
 
   /* Get internal energy at the end of the step (assuming dt does not
    * increase) */
-  double u_0 = (u_start + hydro_du_dt * dt_therm);
+  double u_0 = (*u_start + hydro_du_dt * dt_therm);
 
   /* Check for minimal energy */
   u_0 = max(u_0, hydro_properties->minimal_internal_energy);
 
   /* Convert to CGS units */
-  const double u_0_cgs = u_0 * cooling->internal_energy_to_cgs;
-  const double dt_cgs = dt * units_cgs_conversion_factor(us, UNIT_CONV_TIME);
+  *u_0_cgs = u_0 * cooling->internal_energy_to_cgs;
+  *dt_cgs = dt * units_cgs_conversion_factor(us, UNIT_CONV_TIME);
 
   /* Change in redshift over the course of this time-step
      (See cosmology theory document for the derivation) */
@@ -419,7 +416,6 @@ void cooling_cool_part(const struct phys_const *phys_const,
    * Note that we need to add S and Ca that are in the tables but not tracked
    * by the particles themselves.
    * The order is [H, He, C, N, O, Ne, Mg, Si, S, Ca, Fe] */
-  float abundance_ratio[chemistry_element_count + 2];
   abundance_ratio_to_solar(p, cooling, abundance_ratio);
 
   /* Get the Hydrogen and Helium mass fractions */
@@ -435,21 +431,19 @@ void cooling_cool_part(const struct phys_const *phys_const,
   /* convert Hydrogen mass fraction into physical Hydrogen number density */
   const double n_H =
       hydro_get_physical_density(p, cosmo) * XH / phys_const->const_proton_mass;
-  const double n_H_cgs = n_H * cooling->number_density_to_cgs;
+  *n_H_cgs = n_H * cooling->number_density_to_cgs;
 
   /* ratefact = n_H * n_H / rho; Might lead to round-off error: replaced by
    * equivalent expression  below */
-  const double ratefact_cgs = n_H_cgs * (XH * cooling->inv_proton_mass_cgs);
+  *ratefact_cgs = *n_H_cgs * (XH * cooling->inv_proton_mass_cgs);
 
   /* compute hydrogen number density and helium fraction table indices and
    * offsets (These are fixed for any value of u, so no need to recompute them)
    */
-  int He_index, n_H_index;
-  float d_He, d_n_H;
-  get_index_1d(cooling->HeFrac, eagle_cooling_N_He_frac, HeFrac, &He_index,
-               &d_He);
-  get_index_1d(cooling->nH, eagle_cooling_N_density, log10(n_H_cgs), &n_H_index,
-               &d_n_H);
+  get_index_1d(cooling->HeFrac, eagle_cooling_N_He_frac, HeFrac, He_index,
+               d_He);
+  get_index_1d(cooling->nH, eagle_cooling_N_density, log10(*n_H_cgs), n_H_index,
+               d_n_H);
 
   /* Start by computing the cooling (heating actually) rate from Helium
      re-ionization as this needs to be added on no matter what */
@@ -459,34 +453,30 @@ void cooling_cool_part(const struct phys_const *phys_const,
       eagle_helium_reionization_extraheat(cosmo->z, delta_redshift, cooling);
 
   /* Convert this into a rate */
-  const double Lambda_He_reion_cgs =
-      Helium_reion_heat_cgs / (dt_cgs * ratefact_cgs);
-
-  /* Let's compute the internal energy at the end of the step */
-  /* Initialise to the initial energy to appease compiler; this will never not
-     be overwritten. */
-  double u_final_cgs = u_0_cgs;
-
-  /* First try an explicit integration (note we ignore the derivative) */
-  const double LambdaNet_cgs =
-      Lambda_He_reion_cgs +
-      eagle_cooling_rate(log10(u_0_cgs), cosmo->z, n_H_cgs, abundance_ratio,
-                         n_H_index, d_n_H, He_index, d_He, cooling);
-
-  /* if cooling rate is small, take the explicit solution */
-  if (fabs(ratefact_cgs * LambdaNet_cgs * dt_cgs) <
-      explicit_tolerance * u_0_cgs) {
-
-    u_final_cgs = u_0_cgs + ratefact_cgs * LambdaNet_cgs * dt_cgs;
-
-  } else {
+  *Lambda_He_reion_cgs = Helium_reion_heat_cgs / (*dt_cgs * *ratefact_cgs);
+}
 
-    /* Otherwise, go the bisection route. */
-    u_final_cgs =
-        bisection_iter(u_0_cgs, n_H_cgs, cosmo->z, n_H_index, d_n_H, He_index,
-                       d_He, Lambda_He_reion_cgs, ratefact_cgs, cooling,
-                       abundance_ratio, dt_cgs, p->id);
-  }
+/**
+ * @brief Applies the limits to the energy reached by the cooling of a
+ * particle and turns it into a rate of change.
+ *
+ * @param cosmo The current cosmological model.
+ * @param hydro_properties the hydro_props struct
+ * @param floor_props Properties of the entropy floor.
+ * @param cooling The #cooling_function_data used in the run.
+ * @param p Pointer to the particle data.
+ * @param xp Pointer to the extended particle data.
+ * @param dt The cooling time-step of this particle.
+ * @param dt_therm The hydro time-step of this particle.
+ * @param u_start Internal energy at the last kick step.
+ * @param u_final_cgs Internal energy at the end of the step in CGS.
+ */
+__attribute__((always_inline)) INLINE static void cooling_finish_part(
+    const struct cosmology *cosmo, const struct hydro_props *hydro_properties,
+    const struct entropy_floor_properties *floor_props,
+    const struct cooling_function_data *cooling, struct part *restrict p,
+    struct xpart *restrict xp, const float dt, const float dt_therm,
+    const float u_start, const double u_final_cgs) {
 
   /* Convert back to internal units */
   double u_final = u_final_cgs * cooling->internal_energy_from_cgs;
@@ -518,6 +508,414 @@ void cooling_cool_part(const struct phys_const *phys_const,
   xp->cooling_data.radiated_energy -= hydro_get_mass(p) * cooling_du_dt * dt;
 }
 
+/**
+ * @brief Checks whether the net cooling rate stored in a particle can be
+ * used instead of interpolating the tables again.
+ *
+ * This is the case when the particle cools (or heats) over more than a
+ * Hubble time and its energy, density and the redshift have changed by less
+ * than the tolerance since the rate was computed. The change of energy over
+ * the step is then negligible and so is the error made on it.
+ *
+ * @param cosmo The current cosmological model.
+ * @param cooling The #cooling_function_data used in the run.
+ * @param xp Pointer to the extended particle data.
+ * @param u_0_cgs Internal energy to integrate from in CGS.
+ * @param n_H_cgs Hydrogen number density in CGS.
+ * @param ratefact_cgs Multiplication factor to get a cooling rate.
+ */
+__attribute__((always_inline)) INLINE static int cooling_stored_rate_valid(
+    const struct cosmology *cosmo, const struct cooling_function_data *cooling,
+    const struct xpart *restrict xp, const double u_0_cgs,
+    const double n_H_cgs, const double ratefact_cgs) {
+
+  const float tol = cooling->rate_cache_tolerance;
+  const struct cooling_xpart_data *c = &xp->cooling_data;
+
+  /* No rate stored or no Hubble time to compare to? */
+  if (tol <= 0.f || c->rate_u_cgs <= 0.f || cosmo->H <= 0.) return 0;
+
+  if (fabs(u_0_cgs - c->rate_u_cgs) > tol * c->rate_u_cgs) return 0;
+  if (fabs(n_H_cgs - c->rate_n_H_cgs) > tol * c->rate_n_H_cgs) return 0;
+  if (fabs(cosmo->z - c->rate_z) > tol * (1. + c->rate_z)) return 0;
+
+  /* Is the cooling time longer than the Hubble time? */
+  const double t_H_cgs = cooling->time_to_cgs / cosmo->H;
+  return fabs(ratefact_cgs * c->rate_cgs) * t_H_cgs < u_0_cgs;
+}
+
+/**
+ * @brief Stores the net cooling rate of a particle for the next steps.
+ *
+ * @param cosmo The current cosmological model.
+ * @param cooling The #cooling_function_data used in the run.
+ * @param xp Pointer to the extended particle data.
+ * @param u_0_cgs Internal energy the rate was computed at in CGS.
+ * @param n_H_cgs Hydrogen number density in CGS.
+ * @param rate_cgs The net cooling rate (without He reionization).
+ */
+__attribute__((always_inline)) INLINE static void cooling_store_rate(
+    const struct cosmology *cosmo, const struct cooling_function_data *cooling,
+    struct xpart *restrict xp, const double u_0_cgs, const double n_H_cgs,
+    const double rate_cgs) {
+
+  if (cooling->rate_cache_tolerance <= 0.f) return;
+
+  xp->cooling_data.rate_cgs = rate_cgs;
+  xp->cooling_data.rate_u_cgs = u_0_cgs;
+  xp->cooling_data.rate_n_H_cgs = n_H_cgs;
+  xp->cooling_data.rate_z = cosmo->z;
+}
+
+/**
+ * @brief Apply the cooling function to a particle.
+ *
+ * We want to compute u_new such that u_new = u_old + dt * du/dt(u_new, X),
+ * where X stands for the metallicity, density and redshift. These are
+ * kept constant.
+ *
+ * We first compute du/dt(u_old). If dt * du/dt(u_old) is small enough, we
+ * use an explicit integration and use this as our solution.
+ *
+ * Otherwise, we try to find a solution to the implicit time-integration
+ * problem. This leads to the root-finding problem:
+ *
+ * f(u_new) = u_new - u_old - dt * du/dt(u_new, X) = 0
+ *
+ * We first try a few Newton-Raphson iteration if it does not converge, we
+ * revert to a bisection scheme.
+ *
+ * This is done by first bracketing the solution and then iterating
+ * towards the solution by reducing the window down to a certain tolerance.
+ * Note there is always at least one solution since
+ * f(+inf) is < 0 and f(-inf) is > 0.
+ *
+ * @param phys_const The physical constants in internal units.
+ * @param us The internal system of units.
+ * @param cosmo The current cosmological model.
+ * @param hydro_properties the hydro_props struct
+ * @param floor_props Properties of the entropy floor.
+ * @param cooling The #cooling_function_data used in the run.
+ * @param p Pointer to the particle data.
+ * @param xp Pointer to the extended particle data.
+ * @param dt The cooling time-step of this particle.
+ * @param dt_therm The hydro time-step of this particle.
+ */
+void cooling_cool_part(const struct phys_const *phys_const,
+                       const struct unit_system *us,
+                       const struct cosmology *cosmo,
+                       const struct hydro_props *hydro_properties,
+                       const struct entropy_floor_properties *floor_props,
+                       const struct cooling_function_data *cooling,
+                       struct part *restrict p, struct xpart *restrict xp,
+                       const float dt, const float dt_therm) {
+
+  /* No cooling happens over zero time */
+  if (dt == 0.) return;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (cooling->Redshifts == NULL)
+    error(
+        "Cooling function has not been initialised. Did you forget the "
+        "--cooling runtime flag?");
+#endif
+
+  /* Get everything that does not depend on the final energy */
+  float u_start, abundance_ratio[chemistry_element_count + 2];
+  double u_0_cgs, n_H_cgs, ratefact_cgs, dt_cgs, Lambda_He_reion_cgs;
+  int He_index, n_H_index;
+  float d_He, d_n_H;
+  cooling_prepare_part(phys_const, us, cosmo, hydro_properties, cooling, p, xp,
+                       dt, dt_therm, &u_start, &u_0_cgs, &n_H_cgs,
+                       &ratefact_cgs, &dt_cgs, &Lambda_He_reion_cgs,
+                       abundance_ratio, &n_H_index, &d_n_H, &He_index, &d_He);
+
+  /* Let's compute the internal energy at the end of the step */
+  /* Initialise to the initial energy to appease compiler; this will never not
+     be overwritten. */
+  double u_final_cgs = u_0_cgs;
+
+  /* First try an explicit integration (note we ignore the derivative) */
+  double Lambda_cgs;
+  if (cooling_stored_rate_valid(cosmo, cooling, xp, u_0_cgs, n_H_cgs,
+                                ratefact_cgs)) {
+    Lambda_cgs = xp->cooling_data.rate_cgs;
+    COUNTER_ADD(counter_cooling_skipped, 1);
+  } else {
+    Lambda_cgs =
+        eagle_cooling_rate(log10(u_0_cgs), cosmo->z, n_H_cgs, abundance_ratio,
+                           n_H_index, d_n_H, He_index, d_He, cooling);
+    cooling_store_rate(cosmo, cooling, xp, u_0_cgs, n_H_cgs, Lambda_cgs);
+  }
+  const double LambdaNet_cgs = Lambda_He_reion_cgs + Lambda_cgs;
+
+  /* if cooling rate is small, take the explicit solution */
+  if (fabs(ratefact_cgs * LambdaNet_cgs * dt_cgs) <
+      explicit_tolerance * u_0_cgs) {
+
+    u_final_cgs = u_0_cgs + ratefact_cgs * LambdaNet_cgs * dt_cgs;
+
+  } else {
+
+    /* Otherwise, go the bisection route. */
+    u_final_cgs =
+        bisection_iter(u_0_cgs, n_H_cgs, cosmo->z, n_H_index, d_n_H, He_index,
+                       d_He, Lambda_He_reion_cgs, ratefact_cgs, cooling,
+                       abundance_ratio, dt_cgs, p->id);
+  }
+
+  /* Apply the limits and update the particle */
+  cooling_finish_part(cosmo, hydro_properties, floor_props, cooling, p, xp, dt,
+                      dt_therm, u_start, u_final_cgs);
+}
+
+/**
+ * @brief The per-particle state of the integration of a batch of particles,
+ * stored as a structure of arrays.
+ */
+struct cooling_batch {
+
+  /*! Constant properties of each particle */
+  double u_0_cgs[cooling_batch_size];
+  double n_H_cgs[cooling_batch_size];
+  double ratefact_cgs[cooling_batch_size];
+  double dt_cgs[cooling_batch_size];
+  double Lambda_He_reion_cgs[cooling_batch_size];
+  float abundance_ratio[cooling_batch_size][chemistry_element_count + 2];
+  float u_start[cooling_batch_size];
+  float d_n_H[cooling_batch_size];
+  float d_He[cooling_batch_size];
+  int n_H_index[cooling_batch_size];
+  int He_index[cooling_batch_size];
+
+  /*! State of the root finding */
+  double u_lower_cgs[cooling_batch_size];
+  double u_upper_cgs[cooling_batch_size];
+  double u_test_cgs[cooling_batch_size];
+  double LambdaNet_cgs[cooling_batch_size];
+  double u_final_cgs[cooling_batch_size];
+  int is_cooling[cooling_batch_size];
+
+  /*! Indices of the particles that need the implicit solution */
+  int implicit[cooling_batch_size];
+
+  /*! Indices of the particles that are still being iterated */
+  int active[cooling_batch_size];
+};
+
+/**
+ * @brief Evaluates the net cooling rate at the trial energy of the particles
+ * of a batch that are still active.
+ *
+ * The table look-ups depend on the indices of each particle and are hence
+ * done one particle after the other.
+ *
+ * @param b The #cooling_batch.
+ * @param num_active The number of active particles.
+ * @param redshift The current redshift.
+ * @param cooling The #cooling_function_data used in the run.
+ */
+__attribute__((always_inline)) INLINE static void cooling_batch_rates(
+    struct cooling_batch *b, const int num_active, const double redshift,
+    const struct cooling_function_data *cooling) {
+
+  for (int a = 0; a < num_active; a++) {
+    const int k = b->active[a];
+    b->LambdaNet_cgs[k] =
+        b->Lambda_He_reion_cgs[k] +
+        eagle_cooling_rate(log10(b->u_test_cgs[k]), redshift, b->n_H_cgs[k],
+                           b->abundance_ratio[k], b->n_H_index[k], b->d_n_H[k],
+                           b->He_index[k], b->d_He[k], cooling);
+  }
+}
+
+/**
+ * @brief Apply the cooling function to a batch of particles.
+ *
+ * This solves the same problem as cooling_cool_part() and gives bit-wise
+ * identical results, but all the particles of the batch progress in
+ * lockstep through the explicit step, the bracketing and the bisection.
+ * Each stage is a short loop over the particles still iterating, so the
+ * cooling tables are read for many particles in a row and the bookkeeping
+ * of the root finding is done on contiguous arrays.
+ *
+ * @param phys_const The physical constants in internal units.
+ * @param us The internal system of units.
+ * @param cosmo The current cosmological model.
+ * @param hydro_properties the hydro_props struct
+ * @param floor_props Properties of the entropy floor.
+ * @param cooling The #cooling_function_data used in the run.
+ * @param parts Pointers to the particle data.
+ * @param xparts Pointers to the extended particle data.
+ * @param dt The cooling time-step of each particle.
+ * @param dt_therm The hydro time-step of each particle.
+ * @param count The number of particles (at most #cooling_batch_size).
+ */
+void cooling_cool_part_batch(const struct phys_const *phys_const,
+                             const struct unit_system *us,
+                             const struct cosmology *cosmo,
+                             const struct hydro_props *hydro_properties,
+                             const struct entropy_floor_properties *floor_props,
+                             const struct cooling_function_data *cooling,
+                             struct part **parts, struct xpart **xparts,
+                             const double *dt, const double *dt_therm,
+                             const int count) {
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (cooling->Redshifts == NULL)
+    error(
+        "Cooling function has not been initialised. Did you forget the "
+        "--cooling runtime flag?");
+  if (count > cooling_batch_size) error("Too many particles in the batch.");
+#endif
+
+  struct cooling_batch b;
+  const double redshift = cosmo->z;
+
+  /* Gather the constant properties; no cooling happens over zero time */
+  int num_active = 0, num_stored = 0;
+  for (int k = 0; k < count; k++) {
+    if (dt[k] == 0.) continue;
+    cooling_prepare_part(phys_const, us, cosmo, hydro_properties, cooling,
+                         parts[k], xparts[k], dt[k], dt_therm[k],
+                         &b.u_start[k], &b.u_0_cgs[k], &b.n_H_cgs[k],
+                         &b.ratefact_cgs[k], &b.dt_cgs[k],
+                         &b.Lambda_He_reion_cgs[k], b.abundance_ratio[k],
+                         &b.n_H_index[k], &b.d_n_H[k], &b.He_index[k],
+                         &b.d_He[k]);
+    b.u_test_cgs[k] = b.u_0_cgs[k];
+
+    /* Can we skip the tables for this one? (use implicit as scratch) */
+    if (cooling_stored_rate_valid(cosmo, cooling, xparts[k], b.u_0_cgs[k],
+                                  b.n_H_cgs[k], b.ratefact_cgs[k])) {
+      b.LambdaNet_cgs[k] =
+          b.Lambda_He_reion_cgs[k] + xparts[k]->cooling_data.rate_cgs;
+      b.implicit[num_stored++] = k;
+    } else {
+      b.active[num_active++] = k;
+    }
+  }
+  COUNTER_ADD(counter_cooling_skipped, num_stored);
+
+  /* First try an explicit integration (note we ignore the derivative) */
+  cooling_batch_rates(&b, num_active, redshift, cooling);
+  for (int a = 0; a < num_active; a++) {
+    const int k = b.active[a];
+    cooling_store_rate(cosmo, cooling, xparts[k], b.u_0_cgs[k], b.n_H_cgs[k],
+                       b.LambdaNet_cgs[k] - b.Lambda_He_reion_cgs[k]);
+  }
+  for (int a = 0; a < num_stored; a++) b.active[num_active++] = b.implicit[a];
+
+  /* Take the explicit solution where the change is small and start
+   * bracketing the solution of the others */
+  int num_left = 0;
+  for (int a = 0; a < num_active; a++) {
+    const int k = b.active[a];
+    const double du_cgs = b.ratefact_cgs[k] * b.LambdaNet_cgs[k] * b.dt_cgs[k];
+    if (fabs(du_cgs) < explicit_tolerance * b.u_0_cgs[k]) {
+      b.u_final_cgs[k] = b.u_0_cgs[k] + du_cgs;
+    } else {
+      b.is_cooling[k] = (b.LambdaNet_cgs[k] < 0);
+      b.u_lower_cgs[k] = b.u_0_cgs[k] / bracket_factor;
+      b.u_upper_cgs[k] = b.u_0_cgs[k] * bracket_factor;
+      b.u_test_cgs[k] = b.is_cooling[k] ? b.u_lower_cgs[k] : b.u_upper_cgs[k];
+      b.implicit[num_left++] = k;
+    }
+  }
+  const int num_implicit = num_left;
+  num_active = num_implicit;
+  memcpy(b.active, b.implicit, num_implicit * sizeof(int));
+
+  /* Widen the brackets until they contain the solution */
+  int i = 0;
+  while (num_active > 0) {
+
+    cooling_batch_rates(&b, num_active, redshift, cooling);
+
+    num_left = 0;
+    for (int a = 0; a < num_active; a++) {
+      const int k = b.active[a];
+      const double f = b.u_test_cgs[k] - b.u_0_cgs[k] -
+                       b.LambdaNet_cgs[k] * b.ratefact_cgs[k] * b.dt_cgs[k];
+      if (i >= bisection_max_iterations)
+        error(
+            "particle %llu exceeded max iterations searching for bounds when "
+            "%s, u_ini_cgs %.5e n_H_cgs %.5e",
+            parts[k]->id, b.is_cooling[k] ? "cooling" : "heating",
+            b.u_0_cgs[k], b.n_H_cgs[k]);
+      if (b.is_cooling[k] ? (f > 0) : (f < 0)) {
+        if (b.is_cooling[k]) {
+          b.u_lower_cgs[k] /= bracket_factor;
+          b.u_upper_cgs[k] /= bracket_factor;
+          b.u_test_cgs[k] = b.u_lower_cgs[k];
+        } else {
+          b.u_lower_cgs[k] *= bracket_factor;
+          b.u_upper_cgs[k] *= bracket_factor;
+          b.u_test_cgs[k] = b.u_upper_cgs[k];
+        }
+        b.active[num_left++] = k;
+      }
+    }
+    num_active = num_left;
+    i++;
+  }
+
+  /* Now reduce the brackets down to the tolerance */
+  num_active = num_implicit;
+  memcpy(b.active, b.implicit, num_implicit * sizeof(int));
+  i = 0;
+  while (num_active > 0) {
+
+    for (int a = 0; a < num_active; a++) {
+      const int k = b.active[a];
+      b.u_test_cgs[k] = 0.5 * (b.u_lower_cgs[k] + b.u_upper_cgs[k]);
+    }
+
+    cooling_batch_rates(&b, num_active, redshift, cooling);
+
+    num_left = 0;
+    for (int a = 0; a < num_active; a++) {
+      const int k = b.active[a];
+      const double u_next_cgs = b.u_test_cgs[k];
+#ifdef SWIFT_DEBUG_CHECKS
+      if (u_next_cgs <= 0)
+        error(
+            "Got negative energy! u_next_cgs=%.5e u_upper=%.5e u_lower=%.5e "
+            "Lambda=%.5e",
+            u_next_cgs, b.u_upper_cgs[k], b.u_lower_cgs[k],
+            b.LambdaNet_cgs[k]);
+#endif
+      if (u_next_cgs - b.u_0_cgs[k] -
+              b.LambdaNet_cgs[k] * b.ratefact_cgs[k] * b.dt_cgs[k] >
+          0.0) {
+        b.u_upper_cgs[k] = u_next_cgs;
+      } else {
+        b.u_lower_cgs[k] = u_next_cgs;
+      }
+
+      if (i + 1 >= bisection_max_iterations)
+        error("Particle id %llu failed to converge", parts[k]->id);
+
+      if (fabs(b.u_upper_cgs[k] - b.u_lower_cgs[k]) / u_next_cgs >
+          bisection_tolerance) {
+        b.active[num_left++] = k;
+      } else {
+        b.u_final_cgs[k] = b.u_upper_cgs[k];
+      }
+    }
+    num_active = num_left;
+    i++;
+  }
+
+  /* Apply the limits and update the particles */
+  for (int k = 0; k < count; k++) {
+    if (dt[k] == 0.) continue;
+    cooling_finish_part(cosmo, hydro_properties, floor_props, cooling,
+                        parts[k], xparts[k], dt[k], dt_therm[k], b.u_start[k],
+                        b.u_final_cgs[k]);
+  }
+}
+
 /**
  * @brief Computes the cooling time-step.
  *
@@ -561,6 +959,10 @@ __attribute__((always_inline)) INLINE void cooling_first_init_part(
     const struct part *restrict p, struct xpart *restrict xp) {
 
   xp->cooling_data.radiated_energy = 0.f;
+  xp->cooling_data.rate_cgs = 0.f;
+  xp->cooling_data.rate_u_cgs = 0.f;
+  xp->cooling_data.rate_n_H_cgs = 0.f;
+  xp->cooling_data.rate_z = 0.f;
 }
 
 /**
@@ -718,6 +1120,21 @@ void cooling_init_backend(struct swift_params *parameter_file,
   cooling->S_over_Si_ratio_in_solar = parser_get_opt_param_float(
       parameter_file, "EAGLECooling:S_over_Si_in_solar", 1.f);
 
+  /* Optional parameter to read the next tables ahead of time */
+  cooling->prefetch_tables = parser_get_opt_param_int(
+      parameter_file, "EAGLECooling:prefetch_tables", 1);
+  memset(&cooling->prefetch, 0, sizeof(struct cooling_tables_prefetch));
+
+  /* Optional parameter to tabulate the rates on the internal energy grid */
+  cooling->rates_in_energy_space = parser_get_opt_param_int(
+      parameter_file, "EAGLECooling:rates_in_energy_space", 0);
+  cooling->energy_rates_valid = 0;
+  cooling->energy_rates = NULL;
+
+  /* Optional parameter to re-use the rates of the slowly cooling particles */
+  cooling->rate_cache_tolerance = parser_get_opt_param_float(
+      parameter_file, "EAGLECooling:rate_cache_tolerance", 0.f);
+
   /* Convert H_reion_heat_cgs and He_reion_heat_cgs to cgs
    * (units used internally by the cooling routines). This is done by
    * multiplying by 'eV/m_H' in internal units, then converting to cgs units.
@@ -749,6 +1166,7 @@ void cooling_init_backend(struct swift_params *parameter_file,
   cooling->internal_energy_from_cgs = 1. / cooling->internal_energy_to_cgs;
   cooling->number_density_to_cgs =
       units_cgs_conversion_factor(us, UNIT_CONV_NUMBER_DENSITY);
+  cooling->time_to_cgs = units_cgs_conversion_factor(us, UNIT_CONV_TIME);
 
   /* Store some constants in CGS units */
   const double proton_mass_cgs =
@@ -827,6 +1245,12 @@ void cooling_restore_tables(struct cooling_function_data *cooling,
 void cooling_print_backend(const struct cooling_function_data *cooling) {
 
   message("Cooling function is 'EAGLE'.");
+
+  if (cooling->rate_cache_tolerance > 0.f)
+    message(
+        "Re-using the rates of the gas cooling slower than the Hubble time "
+        "(tolerance: %.3f).",
+        cooling->rate_cache_tolerance);
 }
 
 /**
@@ -848,11 +1272,8 @@ void cooling_clean(struct cooling_function_data *cooling) {
   swift_free("cooling", cooling->SolarAbundances_inv);
 
   /* Free the tables */
-  swift_free("cooling-tables", cooling->table.metal_heating);
-  swift_free("cooling-tables", cooling->table.electron_abundance);
-  swift_free("cooling-tables", cooling->table.temperature);
-  swift_free("cooling-tables", cooling->table.H_plus_He_heating);
-  swift_free("cooling-tables", cooling->table.H_plus_He_electron_abundance);
+  cooling_prefetch_clean(cooling);
+  clean_cooling_tables(cooling);
 }
 
 /**
@@ -879,6 +1300,9 @@ void cooling_struct_dump(const struct cooling_function_data *cooling,
   cooling_copy.table.H_plus_He_electron_abundance = NULL;
   cooling_copy.table.temperature = NULL;
   cooling_copy.table.electron_abundance = NULL;
+  memset(&cooling_copy.prefetch, 0, sizeof(struct cooling_tables_prefetch));
+  cooling_copy.energy_rates = NULL;
+  cooling_copy.energy_rates_valid = 0;
 
   restart_write_blocks((void *)&cooling_copy,
                        sizeof(struct cooling_function_data), 1, stream,
@@ -34,6 +34,9 @@ struct hydro_props;
 struct entropy_floor_properties;
 struct space;
 
+/*! Number of particles cooled together by cooling_cool_part_batch() */
+#define cooling_batch_size 32
+
 void cooling_update(const struct cosmology *cosmo,
                     struct cooling_function_data *cooling, struct space *s);
 
@@ -46,6 +49,16 @@ void cooling_cool_part(const struct phys_const *phys_const,
                        struct part *restrict p, struct xpart *restrict xp,
                        const float dt, const float dt_therm);
 
+void cooling_cool_part_batch(const struct phys_const *phys_const,
+                             const struct unit_system *us,
+                             const struct cosmology *cosmo,
+                             const struct hydro_props *hydro_properties,
+                             const struct entropy_floor_properties *floor_props,
+                             const struct cooling_function_data *cooling,
+                             struct part **parts, struct xpart **xparts,
+                             const double *dt, const double *dt_therm,
+                             const int count);
+
 float cooling_timestep(const struct cooling_function_data *restrict cooling,
                        const struct phys_const *restrict phys_const,
                        const struct cosmology *restrict cosmo,
@@ -517,10 +517,69 @@ INLINE static double eagle_metal_cooling_rate(
   return Lambda_net;
 }
 
+/**
+ * @brief Computes the net cooling rate from the rates tabulated on the
+ * internal energy grid by compute_energy_space_rates().
+ *
+ * The metal-free rate and the rates of all the metals are interpolated
+ * together, as they are stored next to each other in the table.
+ *
+ * @param log10_u_cgs Log base 10 of internal energy per unit mass in CGS units.
+ * @param abundance_ratio Ratio of element abundance to solar.
+ * @param n_H_index Particle hydrogen number density index
+ * @param d_n_H Particle hydrogen number density offset
+ * @param He_index Particle helium fraction index
+ * @param d_He Particle helium fraction offset
+ * @param cooling #cooling_function_data structure
+ *
+ * @return The cooling rate
+ */
+INLINE static double eagle_cooling_rate_energy_space(
+    const double log10_u_cgs,
+    const float abundance_ratio[chemistry_element_count + 2],
+    const int n_H_index, const float d_n_H, const int He_index,
+    const float d_He, const struct cooling_function_data *cooling) {
+
+  /* Get index of u along the internal energy axis */
+  int u_index;
+  float d_u;
+  get_index_1d(cooling->Therm, eagle_cooling_N_temperature, log10_u_cgs,
+               &u_index, &d_u);
+
+  /* Weight of each rate (elements with no abundance do not contribute) */
+  float weights[eagle_cooling_N_energy_rates];
+  weights[0] = 1.f;
+  for (int elem = 2; elem < eagle_cooling_N_metal + 2; elem++)
+    weights[elem - 1] =
+        abundance_ratio[elem] > 0.f ? abundance_ratio[elem] : 0.f;
+
+  /* Linear interpolation along each axis of the 8 corners */
+  double Lambda_net = 0.;
+  for (int c = 0; c < 8; c++) {
+    const int di = (c >> 2) & 1, dj = (c >> 1) & 1, dk = c & 1;
+    const float w = (di ? d_n_H : 1.f - d_n_H) * (dj ? d_He : 1.f - d_He) *
+                    (dk ? d_u : 1.f - d_u);
+
+    const float *rates = &cooling->energy_rates[row_major_index_3d(
+                             n_H_index + di, He_index + dj, u_index + dk,
+                             eagle_cooling_N_density, eagle_cooling_N_He_frac,
+                             eagle_cooling_N_temperature) *
+                         eagle_cooling_N_energy_rates];
+
+    float corner = 0.f;
+    for (int r = 0; r < eagle_cooling_N_energy_rates; r++)
+      corner += weights[r] * rates[r];
+    Lambda_net += w * corner;
+  }
+
+  return Lambda_net;
+}
+
 /**
  * @brief Wrapper function used to calculate cooling rate.
  * Table indices and offsets for redshift, hydrogen number density and
  * helium fraction are passed it so as to compute them only once per particle.
+ * If they are available, the rates tabulated in energy space are used.
  *
  * @param log10_u_cgs Log base 10 of internal energy per unit mass in CGS units.
  * @param redshift The current redshift.
@@ -541,6 +600,13 @@ INLINE static double eagle_cooling_rate(
     const int n_H_index, const float d_n_H, const int He_index,
     const float d_He, const struct cooling_function_data *cooling) {
 
+  /* Use the rates tabulated in energy space if we have them (energies below
+   * the start of the table, as defined by get_index_1d(), are special) */
+  if (cooling->energy_rates_valid && log10_u_cgs >= cooling->Therm[0] + 1e-4f)
+    return eagle_cooling_rate_energy_space(log10_u_cgs, abundance_ratio,
+                                           n_H_index, d_n_H, He_index, d_He,
+                                           cooling);
+
   return eagle_metal_cooling_rate(log10_u_cgs, redshift, n_H_cgs,
                                   abundance_ratio, n_H_index, d_n_H, He_index,
                                   d_He, cooling, /* element_lambda=*/NULL);
@@ -19,6 +19,14 @@
 #ifndef SWIFT_COOLING_STRUCT_EAGLE_H
 #define SWIFT_COOLING_STRUCT_EAGLE_H
 
+/* Some standard headers. */
+#include <pthread.h>
+#include <stddef.h>
+
+#ifdef WITH_MPI
+#include <mpi.h>
+#endif
+
 #define eagle_table_path_name_length 500
 
 /**
@@ -42,6 +50,31 @@ struct cooling_tables {
   float *electron_abundance;
 };
 
+/**
+ * @brief Raw content of the table files of the next redshift bin, read ahead
+ * of time by a background thread.
+ */
+struct cooling_tables_prefetch {
+
+  /*! Thread reading the files */
+  pthread_t thread;
+
+  /*! Has the thread been started and not joined yet? */
+  int running;
+
+  /*! Redshift indices of the files */
+  int z_index[2];
+
+  /*! Names of the files */
+  char fname[2][eagle_table_path_name_length + 12];
+
+  /*! Content of the files (NULL if not read) */
+  void *data[2];
+
+  /*! Size of the files in bytes */
+  size_t size[2];
+};
+
 /**
  * @brief Properties of the cooling function.
  */
@@ -109,6 +142,9 @@ struct cooling_function_data {
   /*! Number density conversion from internal units to CGS (for quick access) */
   double number_density_to_cgs;
 
+  /*! Time conversion from internal units to CGS (for quick access) */
+  double time_to_cgs;
+
   /*! Inverse of proton mass in cgs (for quick access) */
   double inv_proton_mass_cgs;
 
@@ -126,6 +162,37 @@ struct cooling_function_data {
 
   /*! Index of the previous tables along the redshift index of the tables */
   int previous_z_index;
+
+  /*! Is this rank the one reading the tables into memory? */
+  int tables_reader;
+
+  /*! Read the files of the next redshift bin in the background? */
+  int prefetch_tables;
+
+  /*! Files of the next redshift bin */
+  struct cooling_tables_prefetch prefetch;
+
+  /*! Tabulate the net cooling rates on the internal energy grid? */
+  int rates_in_energy_space;
+
+  /*! Are the energy-space rates valid for the current redshift? */
+  int energy_rates_valid;
+
+  /*! Relative change of u, n_H and 1+z below which the rates of the
+   * particles cooling slower than the Hubble time are re-used (0 to never
+   * re-use them) */
+  float rate_cache_tolerance;
+
+  /*! Net cooling rates of H+He and of each metal on the (n_H, He, u) grid */
+  float *energy_rates;
+
+#ifdef WITH_MPI
+  /*! Communicator of the ranks of this node, which share the tables */
+  MPI_Comm tables_comm;
+
+  /*! Shared-memory window holding the tables of this node */
+  MPI_Win tables_win;
+#endif
 };
 
 /**
@@ -135,6 +202,19 @@ struct cooling_xpart_data {
 
   /*! Cumulative energy radiated by the particle */
   float radiated_energy;
+
+  /*! Net cooling rate (without He reionization) last computed for this
+   * particle in CGS */
+  float rate_cgs;
+
+  /*! Internal energy at which rate_cgs was computed in CGS (0 if none) */
+  float rate_u_cgs;
+
+  /*! Hydrogen number density at which rate_cgs was computed in CGS */
+  float rate_n_H_cgs;
+
+  /*! Redshift at which rate_cgs was computed */
+  float rate_z;
 };
 
 #endif /* SWIFT_COOLING_STRUCT_EAGLE_H */
@@ -27,6 +27,8 @@
 
 #include <hdf5.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -310,6 +312,9 @@ void read_cooling_header(const char *fname,
 /**
  * @brief Allocate space for cooling tables.
  *
+ * With MPI, the ranks of a node share a single copy of the tables, held in an
+ * MPI-3 shared-memory window, and only one of them reads the files.
+ *
  * @param cooling #cooling_function_data structure
  */
 void allocate_cooling_tables(struct cooling_function_data *restrict cooling) {
@@ -318,6 +323,58 @@ void allocate_cooling_tables(struct cooling_function_data *restrict cooling) {
    * cooling rates with one table being for the redshift above current redshift
    * and one below. */
 
+#ifdef WITH_MPI
+
+  /* Size of the tables, rounded up to keep all of them aligned */
+  const size_t align = SWIFT_STRUCT_ALIGNMENT / sizeof(float);
+  size_t sizes[5] = {num_elements_metal_heating,
+                     num_elements_electron_abundance, num_elements_temperature,
+                     num_elements_HpHe_heating,
+                     num_elements_HpHe_electron_abundance};
+  size_t total = 0;
+  for (int i = 0; i < 5; i++) {
+    sizes[i] *= eagle_cooling_N_loaded_redshifts;
+    sizes[i] = ((sizes[i] + align - 1) / align) * align;
+    total += sizes[i];
+  }
+
+  /* Gather the ranks of this node */
+  int rank, node_rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  if (MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank,
+                          MPI_INFO_NULL, &cooling->tables_comm) != MPI_SUCCESS)
+    error("Failed to create the node communicator for the cooling tables");
+  MPI_Comm_rank(cooling->tables_comm, &node_rank);
+  cooling->tables_reader = (node_rank == 0);
+
+  /* The first rank of the node holds the memory, the others map it */
+  float *tables = NULL;
+  const MPI_Aint size = cooling->tables_reader ? total * sizeof(float) : 0;
+  if (MPI_Win_allocate_shared(size, sizeof(float), MPI_INFO_NULL,
+                              cooling->tables_comm, &tables,
+                              &cooling->tables_win) != MPI_SUCCESS)
+    error("Failed to allocate the shared cooling tables");
+  MPI_Aint shared_size;
+  int disp_unit;
+  MPI_Win_shared_query(cooling->tables_win, 0, &shared_size, &disp_unit,
+                       &tables);
+  if ((size_t)shared_size < total * sizeof(float))
+    error("Shared cooling tables are too small");
+
+  /* Keep a passive epoch open to be able to synchronise the copies */
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, cooling->tables_win);
+
+  cooling->table.metal_heating = tables;
+  cooling->table.electron_abundance = cooling->table.metal_heating + sizes[0];
+  cooling->table.temperature = cooling->table.electron_abundance + sizes[1];
+  cooling->table.H_plus_He_heating = cooling->table.temperature + sizes[2];
+  cooling->table.H_plus_He_electron_abundance =
+      cooling->table.H_plus_He_heating + sizes[3];
+
+#else
+
+  cooling->tables_reader = 1;
+
   if (swift_memalign("cooling-tables", (void **)&cooling->table.metal_heating,
                      SWIFT_STRUCT_ALIGNMENT,
                      eagle_cooling_N_loaded_redshifts *
@@ -351,6 +408,224 @@ void allocate_cooling_tables(struct cooling_function_data *restrict cooling) {
                          num_elements_HpHe_electron_abundance *
                          sizeof(float)) != 0)
     error("Failed to allocate H_plus_He_electron_abundance array");
+
+#endif /* WITH_MPI */
+}
+
+/**
+ * @brief Prepares the update of the cooling tables.
+ *
+ * With MPI, waits for all the ranks of the node to be done with the current
+ * tables as they are shared.
+ *
+ * @param cooling #cooling_function_data structure
+ * @return Whether this rank should read the new tables.
+ */
+static int cooling_tables_begin_update(
+    const struct cooling_function_data *restrict cooling) {
+
+#ifdef WITH_MPI
+  MPI_Barrier(cooling->tables_comm);
+#endif
+
+  return cooling->tables_reader;
+}
+
+/**
+ * @brief Finishes the update of the cooling tables.
+ *
+ * With MPI, waits for the reading rank and makes the new tables visible to all
+ * the ranks of the node.
+ *
+ * @param cooling #cooling_function_data structure
+ */
+static void cooling_tables_end_update(
+    const struct cooling_function_data *restrict cooling) {
+
+#ifdef WITH_MPI
+  MPI_Win_sync(cooling->tables_win);
+  MPI_Barrier(cooling->tables_comm);
+  MPI_Win_sync(cooling->tables_win);
+#endif
+}
+
+/**
+ * @brief Frees the cooling tables.
+ *
+ * @param cooling #cooling_function_data structure
+ */
+void clean_cooling_tables(struct cooling_function_data *restrict cooling) {
+
+  /* The energy-space rates are private to each rank */
+  if (cooling->energy_rates != NULL)
+    swift_free("cooling-tables", cooling->energy_rates);
+  cooling->energy_rates = NULL;
+  cooling->energy_rates_valid = 0;
+
+#ifdef WITH_MPI
+
+  /* If MPI is gone, so is the shared memory */
+  int finalized;
+  MPI_Finalized(&finalized);
+  if (!finalized) {
+    MPI_Win_unlock_all(cooling->tables_win);
+    MPI_Win_free(&cooling->tables_win);
+    MPI_Comm_free(&cooling->tables_comm);
+  }
+
+#else
+
+  swift_free("cooling-tables", cooling->table.metal_heating);
+  swift_free("cooling-tables", cooling->table.electron_abundance);
+  swift_free("cooling-tables", cooling->table.temperature);
+  swift_free("cooling-tables", cooling->table.H_plus_He_heating);
+  swift_free("cooling-tables", cooling->table.H_plus_He_electron_abundance);
+
+#endif
+}
+
+/**
+ * @brief Body of the thread reading the table files of the next redshift bin.
+ *
+ * Only reads the raw bytes, the files are decoded by HDF5 in the main thread
+ * when the tables are needed.
+ *
+ * @param arg The #cooling_tables_prefetch.
+ */
+static void *cooling_prefetch_runner(void *arg) {
+
+  struct cooling_tables_prefetch *pf = (struct cooling_tables_prefetch *)arg;
+
+  for (int k = 0; k < 2; k++) {
+    pf->data[k] = NULL;
+    pf->size[k] = 0;
+
+    /* Failures are not fatal, the file will be read the usual way */
+    FILE *file = fopen(pf->fname[k], "rb");
+    if (file == NULL) continue;
+    if (fseek(file, 0, SEEK_END) == 0) {
+      const long size = ftell(file);
+      void *data = (size > 0) ? malloc(size) : NULL;
+      if (data != NULL) {
+        rewind(file);
+        if (fread(data, 1, size, file) == (size_t)size) {
+          pf->data[k] = data;
+          pf->size[k] = size;
+        } else {
+          free(data);
+        }
+      }
+    }
+    fclose(file);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Waits for the background reading of the table files to be done.
+ *
+ * @param cooling #cooling_function_data structure
+ */
+static void cooling_prefetch_wait(
+    struct cooling_function_data *restrict cooling) {
+
+  if (cooling->prefetch.running) {
+    if (pthread_join(cooling->prefetch.thread, NULL) != 0)
+      error("Failed to join the cooling tables prefetch thread");
+    cooling->prefetch.running = 0;
+  }
+}
+
+/**
+ * @brief Frees the table files read in the background.
+ *
+ * @param cooling #cooling_function_data structure
+ */
+void cooling_prefetch_clean(struct cooling_function_data *restrict cooling) {
+
+  cooling_prefetch_wait(cooling);
+  for (int k = 0; k < 2; k++) {
+    free(cooling->prefetch.data[k]);
+    cooling->prefetch.data[k] = NULL;
+    cooling->prefetch.size[k] = 0;
+  }
+}
+
+/**
+ * @brief Starts reading the table files of a pair of redshifts in the
+ * background.
+ *
+ * Only the rank reading the tables does so and only if the user asked for it.
+ *
+ * @param cooling #cooling_function_data structure
+ * @param low_z_index Index of the lowest redshift of the pair (nothing is done
+ * if negative).
+ */
+void cooling_prefetch_tables(struct cooling_function_data *restrict cooling,
+                             const int low_z_index) {
+
+  if (!cooling->prefetch_tables || !cooling->tables_reader) return;
+  if (low_z_index < 0) return;
+
+  cooling_prefetch_clean(cooling);
+
+  struct cooling_tables_prefetch *pf = &cooling->prefetch;
+  for (int k = 0; k < 2; k++) {
+    pf->z_index[k] = low_z_index + k;
+    sprintf(pf->fname[k], "%sz_%1.3f.hdf5", cooling->cooling_table_path,
+            cooling->Redshifts[low_z_index + k]);
+  }
+
+  if (pthread_create(&pf->thread, NULL, cooling_prefetch_runner, pf) != 0)
+    error("Failed to create the cooling tables prefetch thread");
+  pf->running = 1;
+}
+
+/**
+ * @brief Opens the table file of a given redshift, using its content read in
+ * the background if available.
+ *
+ * @param cooling #cooling_function_data structure
+ * @param fname Name of the file.
+ * @param z_index Index of the redshift of the file.
+ * @return The HDF5 handle of the (read-only) file.
+ */
+static hid_t cooling_open_table_file(
+    struct cooling_function_data *restrict cooling, const char *fname,
+    const int z_index) {
+
+  struct cooling_tables_prefetch *pf = &cooling->prefetch;
+  for (int k = 0; k < 2; k++) {
+    if ((pf->running || pf->data[k] != NULL) && pf->z_index[k] == z_index) {
+
+      cooling_prefetch_wait(cooling);
+      if (pf->data[k] == NULL) break;
+
+      /* Let HDF5 work on a copy of the file in memory. The core driver
+         insists on a name that does not exist on disk. */
+      hid_t fapl_id = H5Pcreate(H5P_FILE_ACCESS);
+      if (fapl_id < 0) error("Failed to create the file access property list");
+      if (H5Pset_fapl_core(fapl_id, pf->size[k], /*backing_store=*/0) < 0)
+        error("Failed to select the HDF5 core driver");
+      if (H5Pset_file_image(fapl_id, pf->data[k], pf->size[k]) < 0)
+        error("Failed to set the image of file %s", fname);
+      char image_name[eagle_table_path_name_length + 20];
+      sprintf(image_name, "%s.image", fname);
+      const hid_t file_id = H5Fopen(image_name, H5F_ACC_RDONLY, fapl_id);
+      H5Pclose(fapl_id);
+
+      /* HDF5 has its own copy now */
+      free(pf->data[k]);
+      pf->data[k] = NULL;
+      pf->size[k] = 0;
+
+      if (file_id >= 0) return file_id;
+      break;
+    }
+  }
+
+  return H5Fopen(fname, H5F_ACC_RDONLY, H5P_DEFAULT);
 }
 
 /**
@@ -371,6 +646,12 @@ void get_redshift_invariant_table(
     struct cooling_function_data *restrict cooling, const int photodis) {
 #ifdef HAVE_HDF5
 
+  /* Only one rank per node reads the shared tables */
+  if (!cooling_tables_begin_update(cooling)) {
+    cooling_tables_end_update(cooling);
+    return;
+  }
+
   /* Temporary tables */
   float *net_cooling_rate = NULL;
   float *electron_abundance = NULL;
@@ -547,6 +828,8 @@ void get_redshift_invariant_table(
   swift_free("cooling-temp", he_net_cooling_rate);
   swift_free("cooling-temp", he_electron_abundance);
 
+  cooling_tables_end_update(cooling);
+
 #ifdef SWIFT_DEBUG_CHECKS
   message("done reading in redshift invariant table");
 #endif
@@ -576,6 +859,12 @@ void get_cooling_table(struct cooling_function_data *restrict cooling,
 
 #ifdef HAVE_HDF5
 
+  /* Only one rank per node reads the shared tables */
+  if (!cooling_tables_begin_update(cooling)) {
+    cooling_tables_end_update(cooling);
+    return;
+  }
+
   /* Temporary tables */
   float *net_cooling_rate = NULL;
   float *electron_abundance = NULL;
@@ -624,7 +913,7 @@ void get_cooling_table(struct cooling_function_data *restrict cooling,
     message("Reading cooling table 'z_%1.3f.hdf5'",
             cooling->Redshifts[z_index]);
 
-    hid_t file_id = H5Fopen(fname, H5F_ACC_RDONLY, H5P_DEFAULT);
+    hid_t file_id = cooling_open_table_file(cooling, fname, z_index);
     if (file_id < 0) error("unable to open file %s", fname);
 
     char set_name[64];
@@ -763,6 +1052,8 @@ void get_cooling_table(struct cooling_function_data *restrict cooling,
   swift_free("cooling-temp", he_net_cooling_rate);
   swift_free("cooling-temp", he_electron_abundance);
 
+  cooling_tables_end_update(cooling);
+
 #ifdef SWIFT_DEBUG_CHECKS
   message("Done reading in general cooling table");
 #endif
@@ -771,3 +1062,137 @@ void get_cooling_table(struct cooling_function_data *restrict cooling,
   error("Need HDF5 to read cooling tables");
 #endif
 }
+
+/**
+ * @brief Interpolates a row of the loaded tables (i.e. a set of values along
+ * the temperature axis) in redshift and temperature.
+ *
+ * @param row_low The row of the table at the lower redshift.
+ * @param row_high The row of the table at the higher redshift.
+ * @param T_index The index along the temperature axis.
+ * @param d_T The offset along the temperature axis.
+ * @param dz The offset along the redshift axis.
+ */
+static float interpolate_row_z_T(const float *row_low, const float *row_high,
+                                 const int T_index, const float d_T,
+                                 const float dz) {
+
+  const float low = (1.f - d_T) * row_low[T_index] + d_T * row_low[T_index + 1];
+  const float high =
+      (1.f - d_T) * row_high[T_index] + d_T * row_high[T_index + 1];
+  return (1.f - dz) * low + dz * high;
+}
+
+/**
+ * @brief Tabulates the net cooling rates directly on the internal energy grid
+ * of the tables for the current redshift.
+ *
+ * For each node of the (n_H, He, u) grid, we get the temperature and then the
+ * metal-free rate and the rate of each metal (already multiplied by the ratio
+ * of electron abundances) from the tables loaded for the two bracketing
+ * redshifts. The rates of a node are stored contiguously, so that the rate of
+ * a particle can later be obtained from a single 3D interpolation in energy
+ * space, without having to invert the temperature table first.
+ *
+ * The rates are not tabulated when the Compton cooling or the redshift
+ * invariant tables are in use. eagle_cooling_rate() then uses the tables
+ * themselves, as it does for energies below the start of the table.
+ *
+ * @param cooling #cooling_function_data structure
+ * @param redshift The current redshift.
+ */
+void compute_energy_space_rates(struct cooling_function_data *restrict cooling,
+                                const double redshift) {
+
+  cooling->energy_rates_valid = 0;
+  if (!cooling->rates_in_energy_space) return;
+
+  /* Same conditions as in eagle_metal_cooling_rate() */
+  if ((redshift > cooling->Redshifts[eagle_cooling_N_redshifts - 1]) ||
+      (redshift > cooling->H_reion_z))
+    return;
+
+  /* Allocate the table the first time through */
+  if (cooling->energy_rates == NULL) {
+    const size_t size = (size_t)eagle_cooling_N_density *
+                        eagle_cooling_N_He_frac * eagle_cooling_N_temperature *
+                        eagle_cooling_N_energy_rates;
+    if (swift_memalign("cooling-tables", (void **)&cooling->energy_rates,
+                       SWIFT_STRUCT_ALIGNMENT, size * sizeof(float)) != 0)
+      error("Failed to allocate energy-space cooling rates");
+  }
+
+  const float dz = cooling->dz;
+  const struct cooling_tables *table = &cooling->table;
+
+  for (int i = 0; i < eagle_cooling_N_density; i++) {
+
+    /* Rows of the solar electron abundance table */
+    const float *ne_sol_low = &table->electron_abundance[row_major_index_3d(
+        0, i, 0, eagle_cooling_N_loaded_redshifts, eagle_cooling_N_density,
+        eagle_cooling_N_temperature)];
+    const float *ne_sol_high = &table->electron_abundance[row_major_index_3d(
+        1, i, 0, eagle_cooling_N_loaded_redshifts, eagle_cooling_N_density,
+        eagle_cooling_N_temperature)];
+
+    for (int j = 0; j < eagle_cooling_N_He_frac; j++) {
+
+      /* Offsets of the rows of the H+He tables */
+      const int low = row_major_index_4d(
+          0, i, j, 0, eagle_cooling_N_loaded_redshifts, eagle_cooling_N_density,
+          eagle_cooling_N_He_frac, eagle_cooling_N_temperature);
+      const int high = row_major_index_4d(
+          1, i, j, 0, eagle_cooling_N_loaded_redshifts, eagle_cooling_N_density,
+          eagle_cooling_N_He_frac, eagle_cooling_N_temperature);
+
+      for (int k = 0; k < eagle_cooling_N_temperature; k++) {
+
+        /* Temperature of this node. Energies below the table are treated
+         * separately in eagle_convert_u_to_temp() and not tabulated here */
+        const float log_10_T = (1.f - dz) * table->temperature[low + k] +
+                               dz * table->temperature[high + k];
+
+        int T_index;
+        float d_T;
+        get_index_1d(cooling->Temp, eagle_cooling_N_temperature, log_10_T,
+                     &T_index, &d_T);
+
+        float *rates = &cooling->energy_rates[row_major_index_3d(
+                           i, j, k, eagle_cooling_N_density,
+                           eagle_cooling_N_He_frac,
+                           eagle_cooling_N_temperature) *
+                       eagle_cooling_N_energy_rates];
+
+        /* Metal-free cooling */
+        rates[0] = interpolate_row_z_T(&table->H_plus_He_heating[low],
+                                       &table->H_plus_He_heating[high],
+                                       T_index, d_T, dz);
+
+        /* Ratio of the H+He electron abundance to the solar one */
+        const float ne_HHe = interpolate_row_z_T(
+            &table->H_plus_He_electron_abundance[low],
+            &table->H_plus_He_electron_abundance[high], T_index, d_T, dz);
+        const float ne_sol =
+            interpolate_row_z_T(ne_sol_low, ne_sol_high, T_index, d_T, dz);
+        const float electron_abundance_ratio = ne_HHe / ne_sol;
+
+        /* Metal-line cooling */
+        for (int elem = 0; elem < eagle_cooling_N_metal; elem++) {
+          const float *metal_low = &table->metal_heating[row_major_index_4d(
+              elem, 0, i, 0, eagle_cooling_N_metal,
+              eagle_cooling_N_loaded_redshifts, eagle_cooling_N_density,
+              eagle_cooling_N_temperature)];
+          const float *metal_high = &table->metal_heating[row_major_index_4d(
+              elem, 1, i, 0, eagle_cooling_N_metal,
+              eagle_cooling_N_loaded_redshifts, eagle_cooling_N_density,
+              eagle_cooling_N_temperature)];
+          rates[elem + 1] =
+              interpolate_row_z_T(metal_low, metal_high, T_index, d_T, dz) *
+              electron_abundance_ratio;
+        }
+      }
+    }
+  }
+
+  cooling->energy_rates_valid = 1;
+}
@@ -50,6 +50,9 @@
 /*! Number of different bins along the abundances axis of the tables */
 #define eagle_cooling_N_abundances 11
 
+/*! Number of rates stored at each node of the energy-space tables */
+#define eagle_cooling_N_energy_rates (eagle_cooling_N_metal + 1)
+
 void get_cooling_redshifts(struct cooling_function_data *cooling);
 
 void read_cooling_header(const char *fname,
@@ -57,9 +60,19 @@ void read_cooling_header(const char *fname,
 
 void allocate_cooling_tables(struct cooling_function_data *restrict cooling);
 
+void clean_cooling_tables(struct cooling_function_data *restrict cooling);
+
+void cooling_prefetch_tables(struct cooling_function_data *restrict cooling,
+                             const int low_z_index);
+
+void cooling_prefetch_clean(struct cooling_function_data *restrict cooling);
+
 void get_redshift_invariant_table(
     struct cooling_function_data *restrict cooling, const int photodis);
 void get_cooling_table(struct cooling_function_data *restrict cooling,
                        const int low_z_index, const int high_z_index);
 
+void compute_energy_space_rates(struct cooling_function_data *restrict cooling,
+                                const double redshift);
+
 #endif
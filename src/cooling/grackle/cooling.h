@@ -628,6 +628,60 @@ __attribute__((always_inline)) INLINE static gr_float cooling_time(
   return cooling_time;
 }
 
+/**
+ * @brief Turns the energy reached by Grackle into a rate of change of the
+ * internal energy of a particle, making sure it does not become too small.
+ *
+ * @param cosmo The current cosmological model.
+ * @param hydro_props the hydro_props struct, used for
+ * getting the minimal internal energy allowed in by SWIFT.
+ * @param p Pointer to the particle data.
+ * @param xp Pointer to the particle extra data
+ * @param u_old The energy at the start of the step.
+ * @param u_new The energy after dt, as computed by Grackle.
+ * @param hydro_du_dt The rate of change of energy due to hydro forces.
+ * @param dt The time-step of this particle.
+ * @param dt_therm The hydro time-step of this particle.
+ */
+__attribute__((always_inline)) INLINE static void cooling_set_energy_change(
+    const struct cosmology* restrict cosmo,
+    const struct hydro_props* hydro_props, struct part* restrict p,
+    struct xpart* restrict xp, const float u_old, const gr_float u_new,
+    const float hydro_du_dt, const double dt, const double dt_therm) {
+
+  float delta_u = u_new - u_old + hydro_du_dt * dt_therm;
+
+  /* We now need to check that we are not going to go below any of the limits */
+
+  /* First, check whether we may end up below the minimal energy after
+   * this step 1/2 kick + another 1/2 kick that could potentially be for
+   * a time-step twice as big. We hence check for 1.5 delta_u. */
+  if (u_old + 1.5 * delta_u < hydro_props->minimal_internal_energy) {
+    delta_u = (hydro_props->minimal_internal_energy - u_old) / 1.5;
+  }
+
+  /* Second, check whether the energy used in the prediction could get negative.
+   * We need to check for the 1/2 dt kick followed by a full time-step drift
+   * that could potentially be for a time-step twice as big. We hence check
+   * for 2.5 delta_u but this time against 0 energy not the minimum.
+   * To avoid numerical rounding bringing us below 0., we add a tiny tolerance.
+   */
+  const float rounding_tolerance = 1.0e-4;
+
+  if (u_old + 2.5 * delta_u < 0.) {
+    delta_u = -u_old / (2.5 + rounding_tolerance);
+  }
+
+  /* Turn this into a rate of change (including cosmology term) */
+  const float cooling_du_dt = delta_u / dt_therm;
+
+  /* Update the internal energy time derivative */
+  hydro_set_physical_internal_energy_dt(p, cosmo, cooling_du_dt);
+
+  /* Store the radiated energy */
+  xp->cooling_data.radiated_energy -= hydro_get_mass(p) * cooling_du_dt * dt;
+}
+
 /**
  * @brief Apply the cooling function to a particle.
  *
@@ -664,37 +718,259 @@ __attribute__((always_inline)) INLINE static void cooling_cool_part(
   gr_float u_new =
       cooling_new_energy(phys_const, us, cosmo, cooling, p, xp, dt);
 
-  float delta_u = u_new - u_old + hydro_du_dt * dt_therm;
+  /* Apply the limits and update the particle */
+  cooling_set_energy_change(cosmo, hydro_props, p, xp, u_old, u_new,
+                            hydro_du_dt, dt, dt_therm);
+}
 
-  /* We now need to check that we are not going to go below any of the limits */
+/*! Number of particles cooled together by cooling_cool_part_batch() */
+#define cooling_batch_size 128
 
-  /* First, check whether we may end up below the minimal energy after
-   * this step 1/2 kick + another 1/2 kick that could potentially be for
-   * a time-step twice as big. We hence check for 1.5 delta_u. */
-  if (u_old + 1.5 * delta_u < hydro_props->minimal_internal_energy) {
-    delta_u = (hydro_props->minimal_internal_energy - u_old) / 1.5;
-  }
+/**
+ * @brief The Grackle fields of a batch of particles.
+ *
+ * The arrays live on the stack of the runner cooling the batch, so every
+ * thread has its own.
+ */
+struct cooling_grackle_batch {
 
-  /* Second, check whether the energy used in the prediction could get negative.
-   * We need to check for the 1/2 dt kick followed by a full time-step drift
-   * that could potentially be for a time-step twice as big. We hence check
-   * for 2.5 delta_u but this time against 0 energy not the minimum.
-   * To avoid numerical rounding bringing us below 0., we add a tiny tolerance.
-   */
-  const float rounding_tolerance = 1.0e-4;
+  gr_float density[cooling_batch_size];
+  gr_float internal_energy[cooling_batch_size];
+  gr_float metal_density[cooling_batch_size];
 
-  if (u_old + 2.5 * delta_u < 0.) {
-    delta_u = -u_old / (2.5 + rounding_tolerance);
-  }
+#if COOLING_GRACKLE_MODE > 0
+  gr_float HI_density[cooling_batch_size];
+  gr_float HII_density[cooling_batch_size];
+  gr_float HeI_density[cooling_batch_size];
+  gr_float HeII_density[cooling_batch_size];
+  gr_float HeIII_density[cooling_batch_size];
+  gr_float e_density[cooling_batch_size];
+#endif
+#if COOLING_GRACKLE_MODE > 1
+  gr_float HM_density[cooling_batch_size];
+  gr_float H2I_density[cooling_batch_size];
+  gr_float H2II_density[cooling_batch_size];
+#endif
+#if COOLING_GRACKLE_MODE > 2
+  gr_float DI_density[cooling_batch_size];
+  gr_float DII_density[cooling_batch_size];
+  gr_float HDI_density[cooling_batch_size];
+#endif
+};
 
-  /* Turn this into a rate of change (including cosmology term) */
-  const float cooling_du_dt = delta_u / dt_therm;
+/**
+ * @brief copy a single field of a #xpart to the grackle arrays of a batch
+ *
+ * @param b The #cooling_grackle_batch
+ * @param n The position in the batch
+ * @param xp The #xpart
+ * @param rho Particle density
+ * @param field The field to copy
+ */
+#define cooling_copy_field_to_batch(b, n, xp, rho, field) \
+  b.field##_density[n] = xp->cooling_data.field##_frac * rho;
 
-  /* Update the internal energy time derivative */
-  hydro_set_physical_internal_energy_dt(p, cosmo, cooling_du_dt);
+/**
+ * @brief copy a single field of the grackle arrays of a batch to a #xpart
+ *
+ * @param b The #cooling_grackle_batch
+ * @param n The position in the batch
+ * @param xp The #xpart
+ * @param rho Particle density
+ * @param field The field to copy
+ */
+#define cooling_copy_field_from_batch(b, n, xp, rho, field) \
+  xp->cooling_data.field##_frac = b.field##_density[n] / rho;
 
-  /* Store the radiated energy */
-  xp->cooling_data.radiated_energy -= hydro_get_mass(p) * cooling_du_dt * dt;
+/**
+ * @brief Apply the cooling function to a batch of particles.
+ *
+ * All the particles with the same time-step are handed over to Grackle as
+ * a single one-dimensional grid, so that its loops over the cells of the
+ * grid run over many particles and its set-up is paid once per call rather
+ * than once per particle. The results are the same as with
+ * cooling_cool_part().
+ *
+ * @param phys_const The physical constants in internal units.
+ * @param us The internal system of units.
+ * @param cosmo The current cosmological model.
+ * @param hydro_props the hydro_props struct
+ * @param floor_props Properties of the entropy floor.
+ * @param cooling The #cooling_function_data used in the run.
+ * @param parts Pointers to the particle data.
+ * @param xparts Pointers to the extended particle data.
+ * @param dt The time-step of each particle.
+ * @param dt_therm The hydro time-step of each particle.
+ * @param count The number of particles (at most #cooling_batch_size).
+ */
+__attribute__((always_inline)) INLINE static void cooling_cool_part_batch(
+    const struct phys_const* restrict phys_const,
+    const struct unit_system* restrict us,
+    const struct cosmology* restrict cosmo,
+    const struct hydro_props* hydro_props,
+    const struct entropy_floor_properties* floor_props,
+    const struct cooling_function_data* restrict cooling,
+    struct part** parts, struct xpart** xparts, const double* dt,
+    const double* dt_therm, const int count) {
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (count > cooling_batch_size) error("Too many particles in the batch.");
+#endif
+
+  struct cooling_grackle_batch b;
+  int members[cooling_batch_size];
+  char done[cooling_batch_size];
+
+  /* No cooling happens over zero time */
+  for (int k = 0; k < count; k++) done[k] = (dt[k] == 0.);
+
+  for (int first = 0; first < count; first++) {
+
+    if (done[first]) continue;
+
+    /* Collect all the particles with this time-step */
+    const double dt_group = dt[first];
+    int n = 0;
+    for (int k = first; k < count; k++) {
+      if (done[k] || dt[k] != dt_group) continue;
+      done[k] = 1;
+      members[n] = k;
+
+      const struct part* p = parts[k];
+      const struct xpart* xp = xparts[k];
+      const gr_float rho = hydro_get_physical_density(p, cosmo);
+      b.density[n] = rho;
+      b.internal_energy[n] = hydro_get_physical_internal_energy(p, xp, cosmo);
+      b.metal_density[n] = chemistry_metal_mass_fraction(p, xp) * rho;
+
+#if COOLING_GRACKLE_MODE > 0
+      cooling_copy_field_to_batch(b, n, xp, rho, HI);
+      cooling_copy_field_to_batch(b, n, xp, rho, HII);
+      cooling_copy_field_to_batch(b, n, xp, rho, HeI);
+      cooling_copy_field_to_batch(b, n, xp, rho, HeII);
+      cooling_copy_field_to_batch(b, n, xp, rho, HeIII);
+      cooling_copy_field_to_batch(b, n, xp, rho, e);
+#endif
+#if COOLING_GRACKLE_MODE > 1
+      cooling_copy_field_to_batch(b, n, xp, rho, HM);
+      cooling_copy_field_to_batch(b, n, xp, rho, H2I);
+      cooling_copy_field_to_batch(b, n, xp, rho, H2II);
+#endif
+#if COOLING_GRACKLE_MODE > 2
+      cooling_copy_field_to_batch(b, n, xp, rho, DI);
+      cooling_copy_field_to_batch(b, n, xp, rho, DII);
+      cooling_copy_field_to_batch(b, n, xp, rho, HDI);
+#endif
+      n++;
+    }
+
+    /* Describe the batch to grackle as a 1D grid */
+    code_units units = cooling->units;
+    grackle_field_data data;
+    int grid_dimension[GRACKLE_RANK] = {n, 1, 1};
+    int grid_start[GRACKLE_RANK] = {0, 0, 0};
+    int grid_end[GRACKLE_RANK] = {n - 1, 0, 0};
+
+    data.grid_dx = 0.;
+    data.grid_rank = GRACKLE_RANK;
+    data.grid_dimension = grid_dimension;
+    data.grid_start = grid_start;
+    data.grid_end = grid_end;
+
+    data.density = b.density;
+    data.internal_energy = b.internal_energy;
+    data.metal_density = b.metal_density;
+
+    /* grackle 3.0 doc: "Currently not used" */
+    data.x_velocity = NULL;
+    data.y_velocity = NULL;
+    data.z_velocity = NULL;
+
+#if COOLING_GRACKLE_MODE > 0
+    data.HI_density = b.HI_density;
+    data.HII_density = b.HII_density;
+    data.HeI_density = b.HeI_density;
+    data.HeII_density = b.HeII_density;
+    data.HeIII_density = b.HeIII_density;
+    data.e_density = b.e_density;
+#else
+    data.HI_density = NULL;
+    data.HII_density = NULL;
+    data.HeI_density = NULL;
+    data.HeII_density = NULL;
+    data.HeIII_density = NULL;
+    data.e_density = NULL;
+#endif
+#if COOLING_GRACKLE_MODE > 1
+    data.HM_density = b.HM_density;
+    data.H2I_density = b.H2I_density;
+    data.H2II_density = b.H2II_density;
+#else
+    data.HM_density = NULL;
+    data.H2I_density = NULL;
+    data.H2II_density = NULL;
+#endif
+#if COOLING_GRACKLE_MODE > 2
+    data.DI_density = b.DI_density;
+    data.DII_density = b.DII_density;
+    data.HDI_density = b.HDI_density;
+#else
+    data.DI_density = NULL;
+    data.DII_density = NULL;
+    data.HDI_density = NULL;
+#endif
+
+    data.volumetric_heating_rate = NULL;
+    data.specific_heating_rate = NULL;
+    data.RT_heating_rate = NULL;
+    data.RT_HI_ionization_rate = NULL;
+    data.RT_HeI_ionization_rate = NULL;
+    data.RT_HeII_ionization_rate = NULL;
+    data.RT_H2_dissociation_rate = NULL;
+
+    /* Keep the energies at the start of the step */
+    float u_old[cooling_batch_size];
+    for (int m = 0; m < n; m++) u_old[m] = b.internal_energy[m];
+
+    /* solve chemistry */
+    chemistry_data chemistry_grackle = cooling->chemistry;
+    if (local_solve_chemistry(&chemistry_grackle, &grackle_rates, &units,
+                              &data, dt_group) == 0) {
+      error("Error in solve_chemistry.");
+    }
+
+    /* Copy the results back and update the particles */
+    for (int m = 0; m < n; m++) {
+      const int k = members[m];
+      struct part* p = parts[k];
+      struct xpart* xp = xparts[k];
+
+#if COOLING_GRACKLE_MODE > 0
+      const gr_float rho = b.density[m];
+      cooling_copy_field_from_batch(b, m, xp, rho, HI);
+      cooling_copy_field_from_batch(b, m, xp, rho, HII);
+      cooling_copy_field_from_batch(b, m, xp, rho, HeI);
+      cooling_copy_field_from_batch(b, m, xp, rho, HeII);
+      cooling_copy_field_from_batch(b, m, xp, rho, HeIII);
+      cooling_copy_field_from_batch(b, m, xp, rho, e);
+#endif
+#if COOLING_GRACKLE_MODE > 1
+      cooling_copy_field_from_batch(b, m, xp, rho, HM);
+      cooling_copy_field_from_batch(b, m, xp, rho, H2I);
+      cooling_copy_field_from_batch(b, m, xp, rho, H2II);
+#endif
+#if COOLING_GRACKLE_MODE > 2
+      cooling_copy_field_from_batch(b, m, xp, rho, DI);
+      cooling_copy_field_from_batch(b, m, xp, rho, DII);
+      cooling_copy_field_from_batch(b, m, xp, rho, HDI);
+#endif
+
+      const float hydro_du_dt = hydro_get_physical_internal_energy_dt(p, cosmo);
+      cooling_set_energy_change(cosmo, hydro_props, p, xp, u_old[m],
+                                b.internal_energy[m], hydro_du_dt, dt[k],
+                                dt_therm[k]);
+    }
+  }
 }
 
 static INLINE float cooling_get_temperature(
@@ -71,6 +71,36 @@ static INLINE double interp_table(double *table, double x, double x_min,
     return table[ii - 1] + (table[ii] - table[ii - 1]) * (xx - ii);
 }
 
+/**
+ * @brief Returns the cached kick and drift factors of an interval of the
+ * time-line, if it has any.
+ *
+ * The kicks and the drifts of a step run over intervals of length 2^k
+ * that start or end at the current time. Their factors are computed once
+ * per step by cosmology_update_factors() so that the per-particle calls
+ * are a table look-up rather than two interpolations.
+ *
+ * @param c The current #cosmology.
+ * @param ti_start the (integer) time of the start of the interval.
+ * @param ti_end the (integer) time of the end of the interval.
+ * @return The cached factors or NULL if the interval is not cached.
+ */
+static INLINE const struct cosmology_factors *cosmology_cached_factors(
+    const struct cosmology *c, integertime_t ti_start, integertime_t ti_end) {
+
+  const integertime_t dti = ti_end - ti_start;
+
+  /* Only non-empty intervals with a power-of-two length are cached */
+  if (dti <= 0 || (dti & (dti - 1)) != 0) return NULL;
+
+  if (ti_end == c->factors_ti_current)
+    return &c->factors_ending[__builtin_ctzll(dti)];
+  else if (ti_start == c->factors_ti_current)
+    return &c->factors_starting[__builtin_ctzll(dti)];
+  else
+    return NULL;
+}
+
 /**
  * @brief Computes the dark-energy equation of state at a given scale-factor a.
  *
@@ -202,6 +232,48 @@ void cosmology_update(struct cosmology *c, const struct phys_const *phys_const,
   /* Time */
   c->time = cosmology_get_time_since_big_bang(c, a);
   c->lookback_time = c->universe_age_at_present_day - c->time;
+
+  /* Kick and drift factors of the intervals starting or ending now */
+  cosmology_update_factors(c, ti_current);
+}
+
+/**
+ * @brief Builds the caches of the kick and drift factors of all the
+ * power-of-two intervals starting or ending at the given time.
+ *
+ * @param c The #cosmology.
+ * @param ti_current The current point on the integer time-line.
+ */
+void cosmology_update_factors(struct cosmology *c,
+                              integertime_t ti_current) {
+
+  /* Disable the look-up while we fill the caches */
+  c->factors_ti_current = -1;
+
+  for (int k = 0; k < num_time_bins + 2; ++k) {
+
+    const integertime_t dti = 1LL << k;
+
+    struct cosmology_factors *end = &c->factors_ending[k];
+    end->drift = cosmology_get_drift_factor(c, ti_current - dti, ti_current);
+    end->grav_kick =
+        cosmology_get_grav_kick_factor(c, ti_current - dti, ti_current);
+    end->hydro_kick =
+        cosmology_get_hydro_kick_factor(c, ti_current - dti, ti_current);
+    end->corr_kick =
+        cosmology_get_corr_kick_factor(c, ti_current - dti, ti_current);
+
+    struct cosmology_factors *start = &c->factors_starting[k];
+    start->drift = cosmology_get_drift_factor(c, ti_current, ti_current + dti);
+    start->grav_kick =
+        cosmology_get_grav_kick_factor(c, ti_current, ti_current + dti);
+    start->hydro_kick =
+        cosmology_get_hydro_kick_factor(c, ti_current, ti_current + dti);
+    start->corr_kick =
+        cosmology_get_corr_kick_factor(c, ti_current, ti_current + dti);
+  }
+
+  c->factors_ti_current = ti_current;
 }
 
 /**
@@ -532,6 +604,7 @@ void cosmology_init(struct swift_params *params, const struct unit_system *us,
   c->time_interp_table = NULL;
   c->time_interp_table_offset = 0.;
   cosmology_init_tables(c);
+  c->factors_ti_current = -1;
 
   /* Set remaining variables to alid values */
   cosmology_update(c, phys_const, 0);
@@ -611,6 +684,9 @@ void cosmology_init_no_cosmo(struct cosmology *c) {
 
   c->time_begin = 0.;
   c->time_end = 0.;
+
+  /* No cached kick and drift factors */
+  c->factors_ti_current = -1;
 }
 
 /**
@@ -630,6 +706,10 @@ double cosmology_get_drift_factor(const struct cosmology *c,
   if (ti_end < ti_start) error("ti_end must be >= ti_start");
 #endif
 
+  const struct cosmology_factors *cached =
+      cosmology_cached_factors(c, ti_start, ti_end);
+  if (cached != NULL) return cached->drift;
+
   const double a_start = c->log_a_begin + ti_start * c->time_base;
   const double a_end = c->log_a_begin + ti_end * c->time_base;
 
@@ -658,6 +738,10 @@ double cosmology_get_grav_kick_factor(const struct cosmology *c,
   if (ti_end < ti_start) error("ti_end must be >= ti_start");
 #endif
 
+  const struct cosmology_factors *cached =
+      cosmology_cached_factors(c, ti_start, ti_end);
+  if (cached != NULL) return cached->grav_kick;
+
   const double a_start = c->log_a_begin + ti_start * c->time_base;
   const double a_end = c->log_a_begin + ti_end * c->time_base;
 
@@ -687,6 +771,10 @@ double cosmology_get_hydro_kick_factor(const struct cosmology *c,
   if (ti_end < ti_start) error("ti_end must be >= ti_start");
 #endif
 
+  const struct cosmology_factors *cached =
+      cosmology_cached_factors(c, ti_start, ti_end);
+  if (cached != NULL) return cached->hydro_kick;
+
   const double a_start = c->log_a_begin + ti_start * c->time_base;
   const double a_end = c->log_a_begin + ti_end * c->time_base;
 
@@ -716,6 +804,10 @@ double cosmology_get_corr_kick_factor(const struct cosmology *c,
   if (ti_end < ti_start) error("ti_end must be >= ti_start");
 #endif
 
+  const struct cosmology_factors *cached =
+      cosmology_cached_factors(c, ti_start, ti_end);
+  if (cached != NULL) return cached->corr_kick;
+
   const double a_start = c->log_a_begin + ti_start * c->time_base;
   const double a_end = c->log_a_begin + ti_end * c->time_base;
 
@@ -745,6 +837,10 @@ double cosmology_get_therm_kick_factor(const struct cosmology *c,
   if (ti_end < ti_start) error("ti_end must be >= ti_start");
 #endif
 
+  const struct cosmology_factors *cached =
+      cosmology_cached_factors(c, ti_start, ti_end);
+  if (cached != NULL) return cached->drift;
+
   const double a_start = c->log_a_begin + ti_start * c->time_base;
   const double a_end = c->log_a_begin + ti_end * c->time_base;
 
@@ -829,6 +925,67 @@ double cosmology_get_scale_factor(const struct cosmology *c, double t) {
   return a + c->a_begin;
 }
 
+/**
+ * @brief Computes \f$ 1 / (a E(a))^3 \f$ for the current cosmology.
+ *
+ * @param a The scale-factor of interest.
+ * @param param The current #cosmology.
+ */
+double growth_integrand(double a, void *param) {
+
+  const struct cosmology *c = (const struct cosmology *)param;
+  const double Omega_r = c->Omega_r;
+  const double Omega_m = c->Omega_m;
+  const double Omega_k = c->Omega_k;
+  const double Omega_l = c->Omega_lambda;
+  const double w_0 = c->w_0;
+  const double w_a = c->w_a;
+
+  const double a_E = a * E(Omega_r, Omega_m, Omega_k, Omega_l, w_0, w_a, a);
+
+  return 1. / (a_E * a_E * a_E);
+}
+
+/**
+ * @brief Computes the linear growth factor of the matter perturbations at a
+ * given scale-factor, normalised to 1 at \f$a=1\f$.
+ *
+ * Uses \f$ D(a) \propto E(a) \int_0^a da' / (a' E(a'))^3 \f$, which is
+ * exact for a cosmological constant and a good approximation otherwise.
+ *
+ * @param c The current #cosmology.
+ * @param a Scale-factor of interest.
+ */
+double cosmology_get_growth_factor(const struct cosmology *c, double a) {
+
+#ifdef HAVE_LIBGSL
+
+  gsl_integration_workspace *space =
+      gsl_integration_workspace_alloc(GSL_workspace_size);
+  gsl_function F = {&growth_integrand, (void *)c};
+
+  double D_a, D_1, abserr;
+  gsl_integration_qag(&F, 0., a, 0, 1.0e-10, GSL_workspace_size,
+                      GSL_INTEG_GAUSS61, space, &D_a, &abserr);
+  gsl_integration_qag(&F, 0., 1., 0, 1.0e-10, GSL_workspace_size,
+                      GSL_INTEG_GAUSS61, space, &D_1, &abserr);
+  gsl_integration_workspace_free(space);
+
+  const double E_a = E(c->Omega_r, c->Omega_m, c->Omega_k, c->Omega_lambda,
+                       c->w_0, c->w_a, a);
+  const double E_1 = E(c->Omega_r, c->Omega_m, c->Omega_k, c->Omega_lambda,
+                       c->w_0, c->w_a, 1.);
+
+  return (E_a * D_a) / (E_1 * D_1);
+
+#else
+
+  error("Code not compiled with GSL. Can't compute cosmology integrals.");
+  return 0.;
+
+#endif
+}
+
 /**
  * @brief Prints the #cosmology model to stdout.
  */
@@ -27,6 +27,25 @@
 #include "timeline.h"
 #include "units.h"
 
+/**
+ * @brief The cosmology factors of the kick and drift operators over one
+ * interval of the integer time-line.
+ */
+struct cosmology_factors {
+
+  /*! Drift factor (also used for the thermal kick) */
+  double drift;
+
+  /*! Gravity kick factor */
+  double grav_kick;
+
+  /*! Hydro kick factor */
+  double hydro_kick;
+
+  /*! Hydro kick correction factor (GIZMO-MFV only) */
+  double corr_kick;
+};
+
 /**
  * @brief Cosmological parameters
  */
@@ -186,10 +205,22 @@ struct cosmology {
 
   /*! Time at the present-day (a=1) */
   double universe_age_at_present_day;
+
+  /*------------------------------------------------------------------ */
+
+  /*! Integer time the factor caches were built for (-1 if not built) */
+  integertime_t factors_ti_current;
+
+  /*! Factors over [ti_current - 2^k, ti_current], indexed by k */
+  struct cosmology_factors factors_ending[num_time_bins + 2];
+
+  /*! Factors over [ti_current, ti_current + 2^k], indexed by k */
+  struct cosmology_factors factors_starting[num_time_bins + 2];
 };
 
 void cosmology_update(struct cosmology *c, const struct phys_const *phys_const,
                       integertime_t ti_current);
+void cosmology_update_factors(struct cosmology *c, integertime_t ti_current);
 
 double cosmology_get_drift_factor(const struct cosmology *cosmo,
                                   integertime_t ti_start, integertime_t ti_end);
@@ -215,6 +246,7 @@ double cosmology_get_delta_time_from_scale_factors(const struct cosmology *c,
 double cosmology_get_scale_factor(const struct cosmology *cosmo, double t);
 
 double cosmology_get_time_since_big_bang(const struct cosmology *c, double a);
+double cosmology_get_growth_factor(const struct cosmology *c, double a);
 void cosmology_init(struct swift_params *params, const struct unit_system *us,
                     const struct phys_const *phys_const, struct cosmology *c);
 
@@ -642,13 +642,14 @@ void dumpMETISGraph(const char *prefix, idx_t nvertices, idx_t nvertexweights,
 
 #ifdef HAVE_MPI
 /**
- * @brief Dump the positions and MPI ranks of the given top-level cells
- *        to a simple text file.
+ * @brief Dump the positions, MPI ranks and particle counts of the given
+ *        top-level cells to a simple text file.
  *
  * Can be used to visualise the partitioning of an MPI run. Note should
  * be used immediately after repartitioning when the top-level cells
  * have been assigned their nodes. Each time this is called a new file
  * with the given prefix, a unique integer and type of .dat is created.
+ * The files can be replayed by the benchmarkProxies benchmark.
  *
  * @param prefix base output filename
  * @param cells_top the top-level cells.
@@ -667,15 +668,17 @@ void dumpCellRanks(const char *prefix, struct cell *cells_top, int nr_cells) {
   file = fopen(fname, "w");
 
   /* Header. */
-  fprintf(file, "# %6s %6s %6s %6s %6s %6s %6s\n", "x", "y", "z", "xw", "yw",
-          "zw", "rank");
+  fprintf(file, "# %12s %12s %12s %12s %12s %12s %6s %10s %10s %10s\n", "x",
+          "y", "z", "xw", "yw", "zw", "rank", "count", "gcount", "scount");
 
   /* Output */
   for (int i = 0; i < nr_cells; i++) {
     struct cell *c = &cells_top[i];
-    fprintf(file, "  %6.3f %6.3f %6.3f %6.3f %6.3f %6.3f %6d\n", c->loc[0],
-            c->loc[1], c->loc[2], c->width[0], c->width[1], c->width[2],
-            c->nodeID);
+    fprintf(file,
+            "  %12.6e %12.6e %12.6e %12.6e %12.6e %12.6e %6d %10d %10d %10d\n",
+            c->loc[0], c->loc[1], c->loc[2], c->width[0], c->width[1],
+            c->width[2], c->nodeID, c->hydro.count, c->grav.count,
+            c->stars.count);
   }
 
   fclose(file);
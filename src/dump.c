@@ -36,6 +36,7 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 /**
@@ -55,9 +56,68 @@ void *dump_get(struct dump *d, size_t count, size_t *offset) {
   return (char *)d->data + local_offset;
 }
 
+/**
+ * @brief Flush the data written since the last flush to disk.
+ *
+ * The caller must hold the sync_lock of the #dump. The last, partially
+ * filled, page is flushed again on the next call.
+ *
+ * @param d The #dump.
+ */
+static void dump_sync_new_data(struct dump *d) {
+
+  const size_t count = d->count;
+  const size_t start =
+      d->sync_offset > d->file_offset ? d->sync_offset - d->file_offset : 0;
+  if (count <= start) return;
+
+  /* msync() wants page-aligned addresses. */
+  const size_t local_start = start & d->page_mask;
+  if (msync((char *)d->data + local_start, count - local_start, MS_SYNC) != 0)
+    error("Failed to sync memory-mapped data (%s).", strerror(errno));
+
+  d->sync_offset = d->file_offset + (count & d->page_mask);
+}
+
+/**
+ * @brief Body of the thread flushing the #dump in the background.
+ *
+ * Wakes-up every sync_interval seconds and writes the new data to disk, so
+ * that the threads filling the #dump never wait on the file system.
+ *
+ * @param arg The #dump.
+ */
+static void *dump_sync_runner(void *arg) {
+
+  struct dump *d = (struct dump *)arg;
+  const long long interval_ns = d->sync_interval * 1e9;
+
+  pthread_mutex_lock(&d->sync_lock);
+  while (!d->sync_stop) {
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    const long long ns = deadline.tv_nsec + interval_ns;
+    deadline.tv_sec += ns / 1000000000LL;
+    deadline.tv_nsec = ns % 1000000000LL;
+
+    pthread_cond_timedwait(&d->sync_cond, &d->sync_lock, &deadline);
+    if (d->sync_stop) break;
+
+    dump_sync_new_data(d);
+  }
+  pthread_mutex_unlock(&d->sync_lock);
+
+  return NULL;
+}
+
 /**
  * @brief Ensure that at least size bytes are available in the #dump.
  *
+ * The mapped window slides along the file: the pages that are already full
+ * are released and the rest of the window is grown in place with mremap(),
+ * which keeps the current mapping of the partially-filled page.
+ *
  * @param d The #dump.
  * @param required_size The required size for the #dump
  * @param increase_size If not enough size, increase by this amount
@@ -67,45 +127,88 @@ void dump_ensure(struct dump *d, size_t required_size, size_t increase_size) {
   /* If we have enough space already, just bail. */
   if (d->size - d->count > required_size) return;
 
+  /* Keep the flushing thread away from the mapping. */
+  pthread_mutex_lock(&d->sync_lock);
+
+  /* Size of the new window, starting at the last incomplete page. */
+  const size_t trunc_count = d->count & d->page_mask;
+  const size_t new_size =
+      (d->count - trunc_count + increase_size + ~d->page_mask) & d->page_mask;
+
+  /* Extend the file. */
+  if (posix_fallocate(d->fd, d->file_offset + trunc_count, new_size) != 0) {
+    error("Failed to pre-allocate the dump file.");
+  }
+
+#ifdef MREMAP_MAYMOVE
+  /* Release the full pages and grow what remains of the window. */
+  if (trunc_count > 0 && munmap(d->data, trunc_count) != 0) {
+    error("Failed to unmap %zi bytes of dump data (%s).", trunc_count,
+          strerror(errno));
+  }
+  if (trunc_count < d->size) {
+    d->data = mremap((char *)d->data + trunc_count, d->size - trunc_count,
+                     new_size, MREMAP_MAYMOVE);
+  } else {
+    d->data = mmap(NULL, new_size, PROT_WRITE, MAP_SHARED, d->fd,
+                   d->file_offset + trunc_count);
+  }
+  if (d->data == MAP_FAILED) {
+    error("Failed to grow map to %zi bytes (%s).", new_size, strerror(errno));
+  }
+#else
   /* Unmap the current data. */
   if (munmap(d->data, d->size) != 0) {
     error("Failed to unmap %zi bytes of dump data (%s).", d->size,
           strerror(errno));
   }
 
+  /* Re-map starting at the end of the file. */
+  if ((d->data = mmap(NULL, new_size, PROT_WRITE, MAP_SHARED, d->fd,
+                      d->file_offset + trunc_count)) == MAP_FAILED) {
+    error("Failed to allocate map of size %zi bytes (%s).", new_size,
+          strerror(errno));
+  }
+#endif
+
   /* Update the size and count. */
-  const size_t trunc_count = d->count & d->page_mask;
   d->file_offset += trunc_count;
   d->count -= trunc_count;
-  d->size = (d->count + increase_size + ~d->page_mask) & d->page_mask;
-
-  /* Re-allocate the file size. */
-  if (posix_fallocate(d->fd, d->file_offset, d->size) != 0) {
-    error("Failed to pre-allocate the dump file.");
-  }
+  d->size = new_size;
 
-  /* Re-map starting at the end of the file. */
-  if ((d->data = mmap(NULL, d->size, PROT_WRITE, MAP_SHARED, d->fd,
-                      d->file_offset)) == MAP_FAILED) {
-    error("Failed to allocate map of size %zi bytes (%s).", d->size,
-          strerror(errno));
-  }
+  pthread_mutex_unlock(&d->sync_lock);
 }
 
 /**
  * @brief Flush the #dump to disk.
  */
 void dump_sync(struct dump *d) {
+  pthread_mutex_lock(&d->sync_lock);
   if (msync(d->data, d->count, MS_SYNC) != 0)
     error("Failed to sync memory-mapped data.");
+  d->sync_offset = d->file_offset + (d->count & d->page_mask);
+  pthread_mutex_unlock(&d->sync_lock);
 }
 
 /**
  * @brief Finalize the #dump.
  */
 void dump_close(struct dump *d) {
+
+  /* Stop the flushing thread. */
+  if (d->sync_interval > 0.) {
+    pthread_mutex_lock(&d->sync_lock);
+    d->sync_stop = 1;
+    pthread_cond_signal(&d->sync_cond);
+    pthread_mutex_unlock(&d->sync_lock);
+    if (pthread_join(d->sync_thread, NULL) != 0)
+      error("Failed to join the dump flushing thread.");
+  }
+  pthread_cond_destroy(&d->sync_cond);
+  pthread_mutex_destroy(&d->sync_lock);
+
   /* Unmap the data in memory. */
-  if (munmap(d->data, d->count) != 0) {
+  if (munmap(d->data, d->size) != 0) {
     error("Failed to unmap dump data (%s).", strerror(errno));
   }
 
@@ -125,8 +228,11 @@ void dump_close(struct dump *d) {
  * @param filename The fully qualified name of the file in which to dump,
  *                 note that it will be overwritten.
  * @param size The initial buffer size for this #dump.
+ * @param sync_interval Time in seconds between two flushes of the data by
+ *                      the background thread (<= 0 to not use one).
  */
-void dump_init(struct dump *d, const char *filename, size_t size) {
+void dump_init(struct dump *d, const char *filename, size_t size,
+               double sync_interval) {
 
   /* Create the output file.
      The option O_RDWR seems to be required by mmap.
@@ -156,6 +262,17 @@ void dump_init(struct dump *d, const char *filename, size_t size) {
   d->count = 0;
   d->file_offset = 0;
   d->page_mask = page_mask;
+
+  /* Start the thread flushing the data in the background. */
+  d->sync_offset = 0;
+  d->sync_interval = sync_interval;
+  d->sync_stop = 0;
+  if (pthread_mutex_init(&d->sync_lock, NULL) != 0 ||
+      pthread_cond_init(&d->sync_cond, NULL) != 0)
+    error("Failed to initialise the dump flushing lock.");
+  if (sync_interval > 0. &&
+      pthread_create(&d->sync_thread, NULL, &dump_sync_runner, d) != 0)
+    error("Failed to create the dump flushing thread.");
 }
 
 #endif
@@ -25,6 +25,7 @@
 #ifdef HAVE_POSIX_FALLOCATE /* Are we on a sensible platform? */
 
 /* Standard headers */
+#include <pthread.h>
 #include <stdlib.h>
 
 /** The dump struct. */
@@ -47,10 +48,29 @@ struct dump {
 
   /* Mask containing the significant bits for page addresses. */
   size_t page_mask;
+
+  /* Offset in the file up to which the data has been flushed to disk. */
+  size_t sync_offset;
+
+  /* Lock protecting the mapping against the flushing thread. */
+  pthread_mutex_t sync_lock;
+
+  /* Condition used to wake-up or stop the flushing thread. */
+  pthread_cond_t sync_cond;
+
+  /* The background thread flushing the data to disk. */
+  pthread_t sync_thread;
+
+  /* Time (in seconds) between two flushes, <= 0 for no flushing thread. */
+  double sync_interval;
+
+  /* Has the flushing thread been asked to stop? */
+  int sync_stop;
 };
 
 /* Function prototypes. */
-void dump_init(struct dump *d, const char *filename, size_t size);
+void dump_init(struct dump *d, const char *filename, size_t size,
+               double sync_interval);
 void dump_ensure(struct dump *d, size_t required_size, size_t increase_size);
 void dump_sync(struct dump *d);
 void dump_close(struct dump *d);
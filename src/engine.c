@@ -69,6 +69,7 @@
 #include "gravity.h"
 #include "gravity_cache.h"
 #include "hydro.h"
+#include "hydro_io.h"
 #include "logger.h"
 #include "logger_io.h"
 #include "map.h"
@@ -124,6 +125,9 @@ const char *engine_policy_names[] = {"none",
                                      "fof search",
                                      "time-step limiter"};
 
+const char *engine_phase_names[engine_phase_count] = {"rebuild", "tasks",
+                                                      "comms", "io"};
+
 /** The rank of the engine as a global variable (for messages). */
 int engine_rank;
 
@@ -144,6 +148,8 @@ struct end_of_step_data {
       ti_black_holes_beg_max;
   struct engine *e;
   struct star_formation_history sfh;
+  int collect_all;
+  int nr_moved;
 };
 
 /**
@@ -163,8 +169,18 @@ void engine_addlink(struct engine *e, struct link **l, struct task *t) {
   }
 #endif
 
-  /* Get the next free link. */
-  const size_t ind = atomic_inc(&e->nr_links);
+  /* Get the next free link, from the block of links of this thread. */
+  struct scheduler_thread_block *b = scheduler_get_thread_block(&e->sched);
+  size_t ind;
+  if (b->unblocked) {
+    ind = atomic_inc(&e->nr_links);
+  } else {
+    if (b->link_next == b->link_end) {
+      b->link_next = atomic_add(&e->nr_links, e->link_block_size);
+      b->link_end = b->link_next + e->link_block_size;
+    }
+    ind = b->link_next++;
+  }
   if (ind >= e->size_links) {
     error(
         "Link table overflow. Increase the value of "
@@ -178,114 +194,153 @@ void engine_addlink(struct engine *e, struct link **l, struct task *t) {
 }
 
 #ifdef WITH_MPI
+
 /**
- * Do the exchange of one type of particles with all the other nodes.
+ * @brief The exchange of one type of particles with all the other nodes.
+ */
+struct redist_exchange {
+
+  /*! A label for the memory allocations of this particle type */
+  const char *label;
+
+  /*! 2D array with the counts of particles to exchange with each node */
+  const int *counts;
+
+  /*! The particle data to exchange */
+  const char *parts;
+
+  /*! The number of particles this node will have after the exchange */
+  size_t new_nr_parts;
+
+  /*! sizeof the particle struct */
+  size_t sizeofparts;
+
+  /*! The memory alignment required for this particle type */
+  size_t alignsize;
+
+  /*! The MPI_Datatype for these particles */
+  MPI_Datatype mpi_type;
+
+  /*! (return) The new particle data constructed from the exchange */
+  char *parts_new;
+};
+
+/**
+ * Do the exchanges of several types of particles with all the other nodes at
+ * the same time.
  *
- * @param label a label for the memory allocations of this particle type.
- * @param counts 2D array with the counts of particles to exchange with
- *               each other node.
- * @param parts the particle data to exchange
- * @param new_nr_parts the number of particles this node will have after all
- *                     exchanges have completed.
- * @param sizeofparts sizeof the particle struct.
- * @param alignsize the memory alignment required for this particle type.
- * @param mpi_type the MPI_Datatype for these particles.
+ * All the messages of all the types are in flight together, in chunks of at
+ * most 2Gb per message. Messages of different types between the same two
+ * nodes share their tags but are always posted in the same order on both
+ * sides, so they cannot be mismatched.
+ *
+ * @param ex the exchanges to do.
+ * @param nr_ex the number of exchanges.
  * @param nr_nodes the number of nodes to exchange with.
  * @param nodeID the id of this node.
- *
- * @result new particle data constructed from all the exchanges with the
- *         given alignment.
  */
-static void *engine_do_redistribute(const char *label, int *counts, char *parts,
-                                    size_t new_nr_parts, size_t sizeofparts,
-                                    size_t alignsize, MPI_Datatype mpi_type,
-                                    int nr_nodes, int nodeID) {
+static void engine_do_redistribute_exchanges(struct redist_exchange *ex,
+                                             int nr_ex, int nr_nodes,
+                                             int nodeID) {
 
-  /* Allocate a new particle array with some extra margin */
-  char *parts_new = NULL;
-  if (swift_memalign(
-          label, (void **)&parts_new, alignsize,
-          sizeofparts * new_nr_parts * engine_redistribute_alloc_margin) != 0)
-    error("Failed to allocate new particle data.");
+  /* Allocate the new particle arrays with some extra margin */
+  for (int i = 0; i < nr_ex; i++) {
+    ex[i].parts_new = NULL;
+    if (swift_memalign(ex[i].label, (void **)&ex[i].parts_new,
+                       ex[i].alignsize,
+                       ex[i].sizeofparts * ex[i].new_nr_parts *
+                           engine_redistribute_alloc_margin) != 0)
+      error("Failed to allocate new particle data.");
+  }
 
   /* Prepare MPI requests for the asynchronous communications */
+  const int nr_reqs = 2 * nr_nodes * nr_ex;
   MPI_Request *reqs;
-  if ((reqs = (MPI_Request *)malloc(sizeof(MPI_Request) * 2 * nr_nodes)) ==
-      NULL)
+  if ((reqs = (MPI_Request *)malloc(sizeof(MPI_Request) * nr_reqs)) == NULL)
     error("Failed to allocate MPI request list.");
+  MPI_Status *stats;
+  if ((stats = (MPI_Status *)malloc(sizeof(MPI_Status) * nr_reqs)) == NULL)
+    error("Failed to allocate MPI status list.");
 
   /* Only send and receive only "chunk" particles per request. So we need to
    * loop as many times as necessary here. Make 2Gb/sizeofparts so we only
    * send 2Gb packets. */
-  const int chunk = INT_MAX / sizeofparts;
-  int sent = 0;
-  int recvd = 0;
-
   int activenodes = 1;
-  while (activenodes) {
-
-    for (int k = 0; k < 2 * nr_nodes; k++) reqs[k] = MPI_REQUEST_NULL;
+  for (int round = 0; activenodes; round++) {
 
-    /* Emit the sends and recvs for the data. */
-    size_t offset_send = sent;
-    size_t offset_recv = recvd;
+    for (int k = 0; k < nr_reqs; k++) reqs[k] = MPI_REQUEST_NULL;
     activenodes = 0;
 
-    for (int k = 0; k < nr_nodes; k++) {
+    for (int i = 0; i < nr_ex; i++) {
 
-      /* Indices in the count arrays of the node of interest */
-      const int ind_send = nodeID * nr_nodes + k;
-      const int ind_recv = k * nr_nodes + nodeID;
+      const size_t sizeofparts = ex[i].sizeofparts;
+      const int *counts = ex[i].counts;
+      const char *parts = ex[i].parts;
+      char *parts_new = ex[i].parts_new;
+      MPI_Request *ex_reqs = &reqs[2 * nr_nodes * i];
+      const int chunk = INT_MAX / sizeofparts;
+      const long long done = (long long)round * chunk;
 
-      /* Are we sending any data this loop? */
-      int sending = counts[ind_send] - sent;
-      if (sending > 0) {
-        activenodes++;
-        if (sending > chunk) sending = chunk;
+      /* Emit the sends and recvs for the data. */
+      size_t offset_send = done;
+      size_t offset_recv = done;
 
-        /* If the send and receive is local then just copy. */
-        if (k == nodeID) {
-          int receiving = counts[ind_recv] - recvd;
-          if (receiving > chunk) receiving = chunk;
-          memcpy(&parts_new[offset_recv * sizeofparts],
-                 &parts[offset_send * sizeofparts], sizeofparts * receiving);
-        } else {
-          /* Otherwise send it. */
-          int res =
-              MPI_Isend(&parts[offset_send * sizeofparts], sending, mpi_type, k,
-                        ind_send, MPI_COMM_WORLD, &reqs[2 * k + 0]);
-          if (res != MPI_SUCCESS)
-            mpi_error(res, "Failed to isend parts to node %i.", k);
-        }
-      }
+      for (int k = 0; k < nr_nodes; k++) {
 
-      /* If we're sending to this node, then move past it to next. */
-      if (counts[ind_send] > 0) offset_send += counts[ind_send];
+        /* Indices in the count arrays of the node of interest */
+        const int ind_send = nodeID * nr_nodes + k;
+        const int ind_recv = k * nr_nodes + nodeID;
 
-      /* Are we receiving any data from this node? Note already done if coming
-       * from this node. */
-      if (k != nodeID) {
-        int receiving = counts[ind_recv] - recvd;
-        if (receiving > 0) {
+        /* Are we sending any data this loop? */
+        long long sending = counts[ind_send] - done;
+        if (sending > 0) {
           activenodes++;
-          if (receiving > chunk) receiving = chunk;
-          int res = MPI_Irecv(&parts_new[offset_recv * sizeofparts], receiving,
-                              mpi_type, k, ind_recv, MPI_COMM_WORLD,
-                              &reqs[2 * k + 1]);
-          if (res != MPI_SUCCESS)
-            mpi_error(res, "Failed to emit irecv of parts from node %i.", k);
+          if (sending > chunk) sending = chunk;
+
+          /* If the send and receive is local then just copy. */
+          if (k == nodeID) {
+            long long receiving = counts[ind_recv] - done;
+            if (receiving > chunk) receiving = chunk;
+            memcpy(&parts_new[offset_recv * sizeofparts],
+                   &parts[offset_send * sizeofparts], sizeofparts * receiving);
+          } else {
+            /* Otherwise send it. */
+            int res = MPI_Isend(&parts[offset_send * sizeofparts],
+                                (int)sending, ex[i].mpi_type, k, ind_send,
+                                MPI_COMM_WORLD, &ex_reqs[2 * k + 0]);
+            if (res != MPI_SUCCESS)
+              mpi_error(res, "Failed to isend %s to node %i.", ex[i].label, k);
+          }
+        }
+
+        /* If we're sending to this node, then move past it to next. */
+        if (counts[ind_send] > 0) offset_send += counts[ind_send];
+
+        /* Are we receiving any data from this node? Note already done if
+         * coming from this node. */
+        if (k != nodeID) {
+          long long receiving = counts[ind_recv] - done;
+          if (receiving > 0) {
+            activenodes++;
+            if (receiving > chunk) receiving = chunk;
+            int res = MPI_Irecv(&parts_new[offset_recv * sizeofparts],
+                                (int)receiving, ex[i].mpi_type, k, ind_recv,
+                                MPI_COMM_WORLD, &ex_reqs[2 * k + 1]);
+            if (res != MPI_SUCCESS)
+              mpi_error(res, "Failed to emit irecv of %s from node %i.",
+                        ex[i].label, k);
+          }
         }
-      }
 
-      /* If we're receiving from this node, then move past it to next. */
-      if (counts[ind_recv] > 0) offset_recv += counts[ind_recv];
+        /* If we're receiving from this node, then move past it to next. */
+        if (counts[ind_recv] > 0) offset_recv += counts[ind_recv];
+      }
     }
 
     /* Wait for all the sends and recvs to tumble in. */
-    MPI_Status stats[2 * nr_nodes];
     int res;
-    if ((res = MPI_Waitall(2 * nr_nodes, reqs, stats)) != MPI_SUCCESS) {
-      for (int k = 0; k < 2 * nr_nodes; k++) {
+    if ((res = MPI_Waitall(nr_reqs, reqs, stats)) != MPI_SUCCESS) {
+      for (int k = 0; k < nr_reqs; k++) {
         char buff[MPI_MAX_ERROR_STRING];
         MPI_Error_string(stats[k].MPI_ERROR, buff, &res);
         message("request from source %i, tag %i has error '%s'.",
@@ -293,17 +348,42 @@ static void *engine_do_redistribute(const char *label, int *counts, char *parts,
       }
       error("Failed during waitall for part data.");
     }
-
-    /* Move to next chunks. */
-    sent += chunk;
-    recvd += chunk;
   }
 
   /* Free temps. */
   free(reqs);
+  free(stats);
+}
+
+/**
+ * Do the exchange of one type of particles with all the other nodes.
+ *
+ * @param label a label for the memory allocations of this particle type.
+ * @param counts 2D array with the counts of particles to exchange with
+ *               each other node.
+ * @param parts the particle data to exchange
+ * @param new_nr_parts the number of particles this node will have after all
+ *                     exchanges have completed.
+ * @param sizeofparts sizeof the particle struct.
+ * @param alignsize the memory alignment required for this particle type.
+ * @param mpi_type the MPI_Datatype for these particles.
+ * @param nr_nodes the number of nodes to exchange with.
+ * @param nodeID the id of this node.
+ *
+ * @result new particle data constructed from all the exchanges with the
+ *         given alignment.
+ */
+static void *engine_do_redistribute(const char *label, int *counts, char *parts,
+                                    size_t new_nr_parts, size_t sizeofparts,
+                                    size_t alignsize, MPI_Datatype mpi_type,
+                                    int nr_nodes, int nodeID) {
+
+  struct redist_exchange ex = {label,       counts,    parts,    new_nr_parts,
+                               sizeofparts, alignsize, mpi_type, NULL};
+  engine_do_redistribute_exchanges(&ex, 1, nr_nodes, nodeID);
 
   /* And return new memory. */
-  return parts_new;
+  return ex.parts_new;
 }
 #endif
 
@@ -736,8 +816,8 @@ void engine_redistribute(struct engine *e) {
 
   /* Sort the particles according to their cell index. */
   if (nr_parts > 0)
-    space_parts_sort(s->parts, s->xparts, dest, &counts[nodeID * nr_nodes],
-                     nr_nodes, 0);
+    space_parts_sort(&e->threadpool, s->parts, s->xparts, dest,
+                     &counts[nodeID * nr_nodes], nr_nodes, 0);
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Verify that the part have been sorted correctly. */
@@ -801,8 +881,8 @@ void engine_redistribute(struct engine *e) {
 
   /* Sort the particles according to their cell index. */
   if (nr_sparts > 0)
-    space_sparts_sort(s->sparts, s_dest, &s_counts[nodeID * nr_nodes], nr_nodes,
-                      0);
+    space_sparts_sort(&e->threadpool, s->sparts, s_dest,
+                      &s_counts[nodeID * nr_nodes], nr_nodes, 0);
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Verify that the spart have been sorted correctly. */
@@ -865,8 +945,8 @@ void engine_redistribute(struct engine *e) {
 
   /* Sort the particles according to their cell index. */
   if (nr_bparts > 0)
-    space_bparts_sort(s->bparts, b_dest, &b_counts[nodeID * nr_nodes], nr_nodes,
-                      0);
+    space_bparts_sort(&e->threadpool, s->bparts, b_dest,
+                      &b_counts[nodeID * nr_nodes], nr_nodes, 0);
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Verify that the bpart have been sorted correctly. */
@@ -929,8 +1009,9 @@ void engine_redistribute(struct engine *e) {
 
   /* Sort the gparticles according to their cell index. */
   if (nr_gparts > 0)
-    space_gparts_sort(s->gparts, s->parts, s->sparts, s->bparts, g_dest,
-                      &g_counts[nodeID * nr_nodes], nr_nodes);
+    space_gparts_sort(&e->threadpool, s->gparts, s->parts, s->sparts,
+                      s->bparts, g_dest, &g_counts[nodeID * nr_nodes],
+                      nr_nodes);
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Verify that the gpart have been sorted correctly. */
@@ -1037,51 +1118,86 @@ void engine_redistribute(struct engine *e) {
   for (int k = 0; k < nr_nodes; k++)
     nr_bparts_new += b_counts[k * nr_nodes + nodeID];
 
-  /* Now exchange the particles, type by type to keep the memory required
-   * under control. */
+  /* Now exchange the particles. Either all the types at once or type by type
+   * to keep the memory required under control. */
+  if (e->reparttype->concurrent_redistribute) {
+
+    struct redist_exchange ex[5] = {
+        {"parts", counts, (char *)s->parts, nr_parts_new, sizeof(struct part),
+         part_align, part_mpi_type, NULL},
+        {"xparts", counts, (char *)s->xparts, nr_parts_new,
+         sizeof(struct xpart), xpart_align, xpart_mpi_type, NULL},
+        {"gparts", g_counts, (char *)s->gparts, nr_gparts_new,
+         sizeof(struct gpart), gpart_align, gpart_mpi_type, NULL},
+        {"sparts", s_counts, (char *)s->sparts, nr_sparts_new,
+         sizeof(struct spart), spart_align, spart_mpi_type, NULL},
+        {"bparts", b_counts, (char *)s->bparts, nr_bparts_new,
+         sizeof(struct bpart), bpart_align, bpart_mpi_type, NULL}};
+    engine_do_redistribute_exchanges(ex, 5, nr_nodes, nodeID);
 
-  /* SPH particles. */
-  void *new_parts = engine_do_redistribute(
-      "parts", counts, (char *)s->parts, nr_parts_new, sizeof(struct part),
-      part_align, part_mpi_type, nr_nodes, nodeID);
-  swift_free("parts", s->parts);
-  s->parts = (struct part *)new_parts;
-  s->nr_parts = nr_parts_new;
-  s->size_parts = engine_redistribute_alloc_margin * nr_parts_new;
-
-  /* Extra SPH particle properties. */
-  new_parts = engine_do_redistribute(
-      "xparts", counts, (char *)s->xparts, nr_parts_new, sizeof(struct xpart),
-      xpart_align, xpart_mpi_type, nr_nodes, nodeID);
-  swift_free("xparts", s->xparts);
-  s->xparts = (struct xpart *)new_parts;
+    swift_free("parts", s->parts);
+    swift_free("xparts", s->xparts);
+    swift_free("gparts", s->gparts);
+    swift_free("sparts", s->sparts);
+    swift_free("bparts", s->bparts);
+    s->parts = (struct part *)ex[0].parts_new;
+    s->xparts = (struct xpart *)ex[1].parts_new;
+    s->gparts = (struct gpart *)ex[2].parts_new;
+    s->sparts = (struct spart *)ex[3].parts_new;
+    s->bparts = (struct bpart *)ex[4].parts_new;
+    s->nr_parts = nr_parts_new;
+    s->nr_gparts = nr_gparts_new;
+    s->nr_sparts = nr_sparts_new;
+    s->nr_bparts = nr_bparts_new;
+    s->size_parts = engine_redistribute_alloc_margin * nr_parts_new;
+    s->size_gparts = engine_redistribute_alloc_margin * nr_gparts_new;
+    s->size_sparts = engine_redistribute_alloc_margin * nr_sparts_new;
+    s->size_bparts = engine_redistribute_alloc_margin * nr_bparts_new;
 
-  /* Gravity particles. */
-  new_parts = engine_do_redistribute(
-      "gparts", g_counts, (char *)s->gparts, nr_gparts_new,
-      sizeof(struct gpart), gpart_align, gpart_mpi_type, nr_nodes, nodeID);
-  swift_free("gparts", s->gparts);
-  s->gparts = (struct gpart *)new_parts;
-  s->nr_gparts = nr_gparts_new;
-  s->size_gparts = engine_redistribute_alloc_margin * nr_gparts_new;
-
-  /* Star particles. */
-  new_parts = engine_do_redistribute(
-      "sparts", s_counts, (char *)s->sparts, nr_sparts_new,
-      sizeof(struct spart), spart_align, spart_mpi_type, nr_nodes, nodeID);
-  swift_free("sparts", s->sparts);
-  s->sparts = (struct spart *)new_parts;
-  s->nr_sparts = nr_sparts_new;
-  s->size_sparts = engine_redistribute_alloc_margin * nr_sparts_new;
-
-  /* Black holes particles. */
-  new_parts = engine_do_redistribute(
-      "bparts", b_counts, (char *)s->bparts, nr_bparts_new,
-      sizeof(struct bpart), bpart_align, bpart_mpi_type, nr_nodes, nodeID);
-  swift_free("bparts", s->bparts);
-  s->bparts = (struct bpart *)new_parts;
-  s->nr_bparts = nr_bparts_new;
-  s->size_bparts = engine_redistribute_alloc_margin * nr_bparts_new;
+  } else {
+    /* SPH particles. */
+    void *new_parts = engine_do_redistribute(
+        "parts", counts, (char *)s->parts, nr_parts_new, sizeof(struct part),
+        part_align, part_mpi_type, nr_nodes, nodeID);
+    swift_free("parts", s->parts);
+    s->parts = (struct part *)new_parts;
+    s->nr_parts = nr_parts_new;
+    s->size_parts = engine_redistribute_alloc_margin * nr_parts_new;
+
+    /* Extra SPH particle properties. */
+    new_parts = engine_do_redistribute(
+        "xparts", counts, (char *)s->xparts, nr_parts_new, sizeof(struct xpart),
+        xpart_align, xpart_mpi_type, nr_nodes, nodeID);
+    swift_free("xparts", s->xparts);
+    s->xparts = (struct xpart *)new_parts;
+
+    /* Gravity particles. */
+    new_parts = engine_do_redistribute(
+        "gparts", g_counts, (char *)s->gparts, nr_gparts_new,
+        sizeof(struct gpart), gpart_align, gpart_mpi_type, nr_nodes, nodeID);
+    swift_free("gparts", s->gparts);
+    s->gparts = (struct gpart *)new_parts;
+    s->nr_gparts = nr_gparts_new;
+    s->size_gparts = engine_redistribute_alloc_margin * nr_gparts_new;
+
+    /* Star particles. */
+    new_parts = engine_do_redistribute(
+        "sparts", s_counts, (char *)s->sparts, nr_sparts_new,
+        sizeof(struct spart), spart_align, spart_mpi_type, nr_nodes, nodeID);
+    swift_free("sparts", s->sparts);
+    s->sparts = (struct spart *)new_parts;
+    s->nr_sparts = nr_sparts_new;
+    s->size_sparts = engine_redistribute_alloc_margin * nr_sparts_new;
+
+    /* Black holes particles. */
+    new_parts = engine_do_redistribute(
+        "bparts", b_counts, (char *)s->bparts, nr_bparts_new,
+        sizeof(struct bpart), bpart_align, bpart_mpi_type, nr_nodes, nodeID);
+    swift_free("bparts", s->bparts);
+    s->bparts = (struct bpart *)new_parts;
+    s->nr_bparts = nr_bparts_new;
+    s->size_bparts = engine_redistribute_alloc_margin * nr_bparts_new;
+  }
 
   /* All particles have now arrived. Time for some final operations on the
      stuff we just received */
@@ -1170,6 +1286,8 @@ void engine_redistribute(struct engine *e) {
   /* Flag that a redistribute has taken place */
   e->step_props |= engine_step_prop_redistribute;
 
+  e->phase_ticks[engine_phase_comms] += getticks() - tic;
+
   if (e->verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
@@ -1185,7 +1303,7 @@ void engine_redistribute(struct engine *e) {
  */
 void engine_repartition(struct engine *e) {
 
-#if defined(WITH_MPI) && (defined(HAVE_PARMETIS) || defined(HAVE_METIS))
+#ifdef WITH_MPI
 
   ticks tic = getticks();
 
@@ -1252,7 +1370,7 @@ void engine_repartition(struct engine *e) {
             clocks_getunit());
 #else
   if (e->reparttype->type != REPART_NONE)
-    error("SWIFT was not compiled with MPI and METIS or ParMETIS support.");
+    error("SWIFT was not compiled with MPI support.");
 
   /* Clear the repartition flag. */
   e->forcerepart = 0;
@@ -1372,7 +1490,8 @@ void engine_exchange_cells(struct engine *e) {
   const ticks tic = getticks();
 
   /* Exchange the cell structure with neighbouring ranks. */
-  proxy_cells_exchange(e->proxies, e->nr_proxies, e->s, with_gravity);
+  proxy_cells_exchange(e->proxies, e->nr_proxies, e->s, with_gravity,
+                       e->reparttype->compress_cells);
 
   if (e->verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
@@ -1881,18 +2000,61 @@ void engine_exchange_top_multipoles(struct engine *e) {
 #endif
 
   /* Each node (space) has constructed its own top-level multipoles.
-   * We now need to make sure every other node has a copy of everything.
-   *
-   * We use our home-made reduction operation that simply performs a XOR
-   * operation on the multipoles. Since only local multipoles are non-zero and
-   * each multipole is only present once, the bit-by-bit XOR will
-   * create the desired result.
-   */
-  int err = MPI_Allreduce(MPI_IN_PLACE, e->s->multipoles_top, e->s->nr_cells,
-                          multipole_mpi_type, multipole_mpi_reduce_op,
-                          MPI_COMM_WORLD);
-  if (err != MPI_SUCCESS)
-    mpi_error(err, "Failed to all-reduce the top-level multipoles.");
+   * We now need to make sure every other node has a copy of everything. */
+  if (e->sched.flags & scheduler_flag_gather_multipoles) {
+
+    /* Every node knows who owns which cell, so we can directly gather the
+     * local multipoles of every node, in the order of the cells. */
+    const int nr_cells = e->s->nr_cells;
+    const int nr_nodes = e->nr_nodes;
+    int *counts = (int *)calloc(nr_nodes, sizeof(int));
+    int *offsets = (int *)malloc(nr_nodes * sizeof(int));
+    struct gravity_tensors *buffer = NULL;
+    if (counts == NULL || offsets == NULL ||
+        swift_memalign("multipoles_gather", (void **)&buffer,
+                       SWIFT_STRUCT_ALIGNMENT,
+                       nr_cells * sizeof(struct gravity_tensors)) != 0)
+      error("Failed to allocate the multipole gather buffers.");
+
+    for (int i = 0; i < nr_cells; ++i) counts[e->s->cells_top[i].nodeID]++;
+    offsets[0] = 0;
+    for (int k = 1; k < nr_nodes; ++k)
+      offsets[k] = offsets[k - 1] + counts[k - 1];
+
+    /* Pack our own multipoles where they belong in the gathered array */
+    int count = offsets[engine_rank];
+    for (int i = 0; i < nr_cells; ++i)
+      if (e->s->cells_top[i].nodeID == engine_rank)
+        buffer[count++] = e->s->multipoles_top[i];
+
+    int err = MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, buffer,
+                             counts, offsets, multipole_mpi_type,
+                             MPI_COMM_WORLD);
+    if (err != MPI_SUCCESS)
+      mpi_error(err, "Failed to all-gather the top-level multipoles.");
+
+    /* Unpack everything, re-using the offsets as running counters */
+    for (int i = 0; i < nr_cells; ++i)
+      gravity_tensors_mpi_copy(&e->s->multipoles_top[i],
+                               &buffer[offsets[e->s->cells_top[i].nodeID]++]);
+
+    swift_free("multipoles_gather", buffer);
+    free(offsets);
+    free(counts);
+
+  } else {
+
+    /* We use our home-made reduction operation that simply performs a XOR
+     * operation on the multipoles. Since only local multipoles are non-zero
+     * and each multipole is only present once, the bit-by-bit XOR will
+     * create the desired result.
+     */
+    int err = MPI_Allreduce(MPI_IN_PLACE, e->s->multipoles_top,
+                            e->s->nr_cells, multipole_mpi_type,
+                            multipole_mpi_reduce_op, MPI_COMM_WORLD);
+    if (err != MPI_SUCCESS)
+      mpi_error(err, "Failed to all-reduce the top-level multipoles.");
+  }
 
 #ifdef SWIFT_DEBUG_CHECKS
   long long counter = 0;
@@ -2082,6 +2244,244 @@ void engine_exchange_proxy_multipoles(struct engine *e) {
 #endif
 }
 
+#ifdef WITH_MPI
+/**
+ * @brief Find the nodes sharing our memory, whose hydro particles we then
+ * read in place.
+ *
+ * @param e The #engine.
+ */
+static void engine_init_shm(struct engine *e) {
+
+  struct scheduler *s = &e->sched;
+  const int nr_nodes = e->nr_nodes;
+
+  if (MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, e->nodeID,
+                          MPI_INFO_NULL, &s->shm_comm) != MPI_SUCCESS ||
+      MPI_Comm_dup(MPI_COMM_WORLD, &s->shm_release_comm) != MPI_SUCCESS)
+    error("Failed to create the communicators of the shared memory.");
+
+  /* Rank of each node in the shared communicator. */
+  MPI_Group world_group, shm_group;
+  MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+  MPI_Comm_group(s->shm_comm, &shm_group);
+  int *ranks = (int *)malloc(sizeof(int) * nr_nodes);
+  s->shm_rank = (int *)malloc(sizeof(int) * nr_nodes);
+  if (ranks == NULL || s->shm_rank == NULL)
+    error("Failed to allocate the ranks of the shared memory.");
+  for (int k = 0; k < nr_nodes; k++) ranks[k] = k;
+  MPI_Group_translate_ranks(world_group, nr_nodes, ranks, shm_group,
+                            s->shm_rank);
+  for (int k = 0; k < nr_nodes; k++)
+    if (s->shm_rank[k] == MPI_UNDEFINED) s->shm_rank[k] = -1;
+  free(ranks);
+  MPI_Group_free(&world_group);
+  MPI_Group_free(&shm_group);
+
+  /* Nothing mapped yet. */
+  s->shm_parts = (struct part **)calloc(nr_nodes, sizeof(struct part *));
+  s->shm_size = (size_t *)calloc(nr_nodes, sizeof(size_t));
+  s->shm_name = calloc(nr_nodes, memuse_node_shared_name_length);
+  if (s->shm_parts == NULL || s->shm_size == NULL || s->shm_name == NULL)
+    error("Failed to allocate the shared particle arrays.");
+
+  /* From now on, the particles go in shared memory. */
+  memuse_node_shared = 1;
+
+  if (e->verbose) {
+    int count = 0;
+    for (int k = 0; k < nr_nodes; k++) count += (s->shm_rank[k] >= 0);
+    message("Sharing the memory of %d nodes.", count);
+  }
+}
+
+/**
+ * @brief Move the local hydro particles to memory shared with the other
+ * nodes of the machine, if they are not there yet.
+ *
+ * This is only needed for the particles read from the initial conditions
+ * or the restart files, every later allocation being shared. The cells get
+ * linked to the new array by the rebuild that follows and the #gpart only
+ * store offsets in it.
+ *
+ * @param e The #engine.
+ */
+static void engine_share_parts(struct engine *e) {
+
+  struct space *s = e->s;
+  char name[memuse_node_shared_name_length];
+  size_t size;
+  if (s->parts == NULL || memuse_node_shared_name(s->parts, name, &size))
+    return;
+
+  struct part *parts_new = NULL;
+  if (swift_memalign("parts", (void **)&parts_new, part_align,
+                     sizeof(struct part) * s->size_parts) != 0)
+    error("Failed to allocate the shared particles.");
+  memcpy(parts_new, s->parts, sizeof(struct part) * s->nr_parts);
+  swift_free("parts", s->parts);
+  s->parts = parts_new;
+}
+
+/**
+ * @brief Map the particle arrays of the nodes sharing our memory and link
+ * the foreign cells we read in place to them.
+ *
+ * The nodes exchange the names of their arrays, which change every time
+ * these get re-allocated, and the offsets in them of the cells they send.
+ *
+ * @param e The #engine.
+ */
+static void engine_link_shared_parts(struct engine *e) {
+
+  struct space *s = e->s;
+  struct scheduler *sched = &e->sched;
+  const int nr_nodes = e->nr_nodes;
+
+  /* Tell the other nodes where our particles are. */
+  char name[memuse_node_shared_name_length] = {0};
+  size_t size = 0;
+  if (s->parts != NULL && !memuse_node_shared_name(s->parts, name, &size))
+    error("The particles are not in shared memory.");
+  unsigned long long size_out = size;
+
+  int nr_shm = 0;
+  MPI_Comm_size(sched->shm_comm, &nr_shm);
+  char(*names)[memuse_node_shared_name_length] =
+      malloc(nr_shm * memuse_node_shared_name_length);
+  unsigned long long *sizes =
+      (unsigned long long *)malloc(sizeof(unsigned long long) * nr_shm);
+  if (names == NULL || sizes == NULL)
+    error("Failed to allocate the names of the shared particles.");
+  if (MPI_Allgather(name, memuse_node_shared_name_length, MPI_CHAR, names,
+                    memuse_node_shared_name_length, MPI_CHAR,
+                    sched->shm_comm) != MPI_SUCCESS ||
+      MPI_Allgather(&size_out, 1, MPI_UNSIGNED_LONG_LONG, sizes, 1,
+                    MPI_UNSIGNED_LONG_LONG, sched->shm_comm) != MPI_SUCCESS)
+    error("Failed to exchange the names of the shared particles.");
+
+  /* Map the arrays that changed since the last rebuild. */
+  for (int k = 0; k < nr_nodes; k++) {
+    const int rank = sched->shm_rank[k];
+    if (k == e->nodeID || rank < 0) continue;
+    if (strcmp(sched->shm_name[k], names[rank]) == 0) continue;
+
+    memuse_node_shared_unmap(sched->shm_parts[k], sched->shm_size[k]);
+    sched->shm_parts[k] = NULL;
+    sched->shm_size[k] = 0;
+    strcpy(sched->shm_name[k], names[rank]);
+    if (names[rank][0] == '\0') continue;
+
+    sched->shm_parts[k] =
+        (struct part *)memuse_node_shared_map(names[rank], sizes[rank]);
+    if (sched->shm_parts[k] == NULL)
+      error("Failed to map the particles of node %d.", k);
+    sched->shm_size[k] = sizes[rank];
+  }
+  free(names);
+  free(sizes);
+
+  /* Everybody mapped our particles, they can lose their name. */
+  MPI_Barrier(sched->shm_comm);
+  if (s->parts != NULL) memuse_node_shared_unlink(s->parts);
+
+  /* Exchange the offsets of the top-level cells in the arrays. */
+  long long **offsets_out =
+      (long long **)calloc(e->nr_proxies, sizeof(long long *));
+  long long **offsets_in =
+      (long long **)calloc(e->nr_proxies, sizeof(long long *));
+  MPI_Request *reqs =
+      (MPI_Request *)malloc(sizeof(MPI_Request) * 2 * e->nr_proxies);
+  if (offsets_out == NULL || offsets_in == NULL || reqs == NULL)
+    error("Failed to allocate the offsets of the shared cells.");
+  int nr_reqs = 0;
+  for (int k = 0; k < e->nr_proxies; k++) {
+    const struct proxy *p = &e->proxies[k];
+    if (!scheduler_reads_in_place(sched, p->nodeID)) continue;
+    const int rank = sched->shm_rank[p->nodeID];
+
+    offsets_out[k] = (long long *)malloc(sizeof(long long) *
+                                         (p->nr_cells_out + 1));
+    offsets_in[k] =
+        (long long *)malloc(sizeof(long long) * (p->nr_cells_in + 1));
+    if (offsets_out[k] == NULL || offsets_in[k] == NULL)
+      error("Failed to allocate the offsets of the shared cells.");
+    for (int j = 0; j < p->nr_cells_out; j++)
+      offsets_out[k][j] = p->cells_out[j]->hydro.parts - s->parts;
+
+    if (MPI_Isend(offsets_out[k], p->nr_cells_out, MPI_LONG_LONG, rank, 0,
+                  sched->shm_comm, &reqs[nr_reqs++]) != MPI_SUCCESS ||
+        MPI_Irecv(offsets_in[k], p->nr_cells_in, MPI_LONG_LONG, rank, 0,
+                  sched->shm_comm, &reqs[nr_reqs++]) != MPI_SUCCESS)
+      error("Failed to exchange the offsets of the shared cells.");
+  }
+  if (MPI_Waitall(nr_reqs, reqs, MPI_STATUSES_IGNORE) != MPI_SUCCESS)
+    error("Failed to exchange the offsets of the shared cells.");
+
+  /* Link the foreign cells to the particles of their node. */
+  for (int k = 0; k < e->nr_proxies; k++) {
+    const struct proxy *p = &e->proxies[k];
+    if (offsets_in[k] == NULL) continue;
+    struct part *parts = sched->shm_parts[p->nodeID];
+    for (int j = 0; j < p->nr_cells_in; j++)
+      if (p->cells_in_type[j] & proxy_cell_type_hydro)
+        cell_link_parts(p->cells_in[j], &parts[offsets_in[k][j]]);
+    free(offsets_out[k]);
+    free(offsets_in[k]);
+  }
+  free(offsets_out);
+  free(offsets_in);
+  free(reqs);
+}
+
+/**
+ * @brief #threadpool mapper function writing to one byte of each page of a
+ * buffer.
+ *
+ * @param map_data The start of the pages to touch.
+ * @param num_pages The number of pages to touch.
+ * @param extra_data The end of the buffer.
+ */
+static void engine_prefault_mapper(void *map_data, int num_pages,
+                                   void *extra_data) {
+
+  char *const start = (char *)map_data;
+  char *const end = (char *)extra_data;
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+
+  for (int k = 0; k < num_pages; k++) {
+    char *const p = start + k * page_size;
+    *(volatile char *)(p < end ? p : end - 1) = 0;
+  }
+}
+
+/**
+ * @brief Touches every page of a freshly allocated buffer using the threads
+ * of the #threadpool.
+ *
+ * The pages are placed by the first touch (or by the NUMA policy of the
+ * buffer), so this spreads them over the threads instead of faulting them in
+ * one at a time in whichever thread writes to them first.
+ *
+ * @param e The #engine.
+ * @param buffer The start of the buffer.
+ * @param size The size of the buffer in bytes.
+ */
+static void engine_prefault(struct engine *e, void *buffer,
+                            const size_t size) {
+
+  if (buffer == NULL || size == 0) return;
+
+  /* One more page in case the buffer does not start on a page boundary */
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t nr_pages = size / page_size + 2;
+
+  threadpool_map(&e->threadpool, engine_prefault_mapper, buffer, nr_pages,
+                 page_size, threadpool_auto_chunk_size,
+                 (char *)buffer + size);
+}
+#endif /* WITH_MPI */
+
 /**
  * @brief Allocate memory for the foreign particles.
  *
@@ -2098,6 +2498,7 @@ void engine_allocate_foreign_particles(struct engine *e) {
 
   const int nr_proxies = e->nr_proxies;
   struct space *s = e->s;
+  const int nr_queues = s->nr_queues;
   ticks tic = getticks();
 
   /* Count the number of particles we need to import and re-allocate
@@ -2105,9 +2506,15 @@ void engine_allocate_foreign_particles(struct engine *e) {
   size_t count_parts_in = 0, count_gparts_in = 0, count_sparts_in = 0,
          count_bparts_in = 0;
   for (int k = 0; k < nr_proxies; k++) {
+
+    /* Do we read the hydro particles of that node in place? */
+    const int in_place = scheduler_reads_in_place(&e->sched,
+                                                  e->proxies[k].nodeID);
+
     for (int j = 0; j < e->proxies[k].nr_cells_in; j++) {
 
-      if (e->proxies[k].cells_in_type[j] & proxy_cell_type_hydro) {
+      if ((e->proxies[k].cells_in_type[j] & proxy_cell_type_hydro) &&
+          !in_place) {
         count_parts_in += cell_count_parts_for_tasks(e->proxies[k].cells_in[j]);
       }
 
@@ -2132,7 +2539,8 @@ void engine_allocate_foreign_particles(struct engine *e) {
   tic = getticks();
 
   /* Allocate space for the foreign particles we will receive */
-  if (count_parts_in > s->size_parts_foreign) {
+  const int new_parts = count_parts_in > s->size_parts_foreign;
+  if (new_parts) {
     if (s->parts_foreign != NULL)
       swift_free("sparts_foreign", s->parts_foreign);
     s->size_parts_foreign = engine_foreign_alloc_margin * count_parts_in;
@@ -2142,7 +2550,8 @@ void engine_allocate_foreign_particles(struct engine *e) {
   }
 
   /* Allocate space for the foreign particles we will receive */
-  if (count_gparts_in > s->size_gparts_foreign) {
+  const int new_gparts = count_gparts_in > s->size_gparts_foreign;
+  if (new_gparts) {
     if (s->gparts_foreign != NULL)
       swift_free("gparts_foreign", s->gparts_foreign);
     s->size_gparts_foreign = engine_foreign_alloc_margin * count_gparts_in;
@@ -2153,7 +2562,8 @@ void engine_allocate_foreign_particles(struct engine *e) {
   }
 
   /* Allocate space for the foreign particles we will receive */
-  if (count_sparts_in > s->size_sparts_foreign) {
+  const int new_sparts = count_sparts_in > s->size_sparts_foreign;
+  if (new_sparts) {
     if (s->sparts_foreign != NULL)
       swift_free("sparts_foreign", s->sparts_foreign);
     s->size_sparts_foreign = engine_foreign_alloc_margin * count_sparts_in;
@@ -2164,7 +2574,8 @@ void engine_allocate_foreign_particles(struct engine *e) {
   }
 
   /* Allocate space for the foreign particles we will receive */
-  if (count_bparts_in > s->size_bparts_foreign) {
+  const int new_bparts = count_bparts_in > s->size_bparts_foreign;
+  if (new_bparts) {
     if (s->bparts_foreign != NULL)
       swift_free("bparts_foreign", s->bparts_foreign);
     s->size_bparts_foreign = engine_foreign_alloc_margin * count_bparts_in;
@@ -2191,16 +2602,41 @@ void engine_allocate_foreign_particles(struct engine *e) {
   struct spart *sparts = s->sparts_foreign;
   struct bpart *bparts = s->bparts_foreign;
   for (int k = 0; k < nr_proxies; k++) {
+
+    /* Do we read the hydro particles of that node in place? */
+    const int in_place = scheduler_reads_in_place(&e->sched,
+                                                  e->proxies[k].nodeID);
+
     for (int j = 0; j < e->proxies[k].nr_cells_in; j++) {
 
-      if (e->proxies[k].cells_in_type[j] & proxy_cell_type_hydro) {
+      const struct cell *c = e->proxies[k].cells_in[j];
+      const int link_parts =
+          (e->proxies[k].cells_in_type[j] & proxy_cell_type_hydro) &&
+          !in_place;
+      const int link_gparts =
+          e->proxies[k].cells_in_type[j] & proxy_cell_type_gravity;
+
+      /* Set the ownership according to the start of the particles of the
+       * cell in the foreign arrays, as for the local cells. */
+      int owner = 0;
+      if (link_parts && c->hydro.count > 0 && count_parts_in > 0)
+        owner = (parts - s->parts_foreign) * nr_queues / count_parts_in;
+      else if (link_gparts && c->grav.count > 0 && count_gparts_in > 0)
+        owner = (gparts - s->gparts_foreign) * nr_queues / count_gparts_in;
+      else if (c->stars.count > 0)
+        owner = (sparts - s->sparts_foreign) * nr_queues / count_sparts_in;
+      else if (c->black_holes.count > 0)
+        owner = (bparts - s->bparts_foreign) * nr_queues / count_bparts_in;
+      cell_set_owner(e->proxies[k].cells_in[j], owner);
+
+      if (link_parts) {
 
         const size_t count_parts =
             cell_link_foreign_parts(e->proxies[k].cells_in[j], parts);
         parts = &parts[count_parts];
       }
 
-      if (e->proxies[k].cells_in_type[j] & proxy_cell_type_gravity) {
+      if (link_gparts) {
 
         const size_t count_gparts =
             cell_link_foreign_gparts(e->proxies[k].cells_in[j], gparts);
@@ -2224,10 +2660,38 @@ void engine_allocate_foreign_particles(struct engine *e) {
   s->nr_sparts_foreign = sparts - s->sparts_foreign;
   s->nr_bparts_foreign = bparts - s->bparts_foreign;
 
+  /* Link the cells whose particles we read in place. */
+  if (e->sched.flags & scheduler_flag_mpi_shm) engine_link_shared_parts(e);
+
   if (e->verbose)
     message("Recursively linking foreign arrays took %.3f %s.",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 
+  /* Move the foreign particles to the NUMA domain of the queues owning
+   * their cells. */
+  if (e->sched.queue_domain != NULL)
+    space_numa_place_foreign_particles(s, e->sched.queue_domain, e->verbose);
+
+  /* Fault the pages of the new buffers in now, in parallel, rather than in
+   * the receives of the next step. */
+  tic = getticks();
+  if (new_parts)
+    engine_prefault(e, s->parts_foreign,
+                    sizeof(struct part) * s->size_parts_foreign);
+  if (new_gparts)
+    engine_prefault(e, s->gparts_foreign,
+                    sizeof(struct gpart) * s->size_gparts_foreign);
+  if (new_sparts)
+    engine_prefault(e, s->sparts_foreign,
+                    sizeof(struct spart) * s->size_sparts_foreign);
+  if (new_bparts)
+    engine_prefault(e, s->bparts_foreign,
+                    sizeof(struct bpart) * s->size_bparts_foreign);
+
+  if (e->verbose && (new_parts || new_gparts || new_sparts || new_bparts))
+    message("Pre-faulting the new foreign arrays took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
 #else
   error("SWIFT was not compiled with MPI support.");
 #endif
@@ -2444,6 +2908,90 @@ int engine_estimate_nr_tasks(const struct engine *e) {
   return (int)(ncells * tasks_per_cell);
 }
 
+/**
+ * @brief Report the current and peak memory use of each category of
+ * allocations, the maximum over all the ranks.
+ *
+ * @param e The #engine.
+ */
+static void engine_report_memuse_categories(struct engine *e) {
+
+  long long current[memuse_category_count];
+  long long peak[memuse_category_count];
+  memuse_categories(current, peak);
+
+  /* How much memory ended up on huge pages? */
+  long long huge = memuse_huge_pages ? memuse_huge_pages_in_use() : 0;
+
+#ifdef WITH_MPI
+  if (e->nodeID == 0) {
+    MPI_Reduce(MPI_IN_PLACE, current, memuse_category_count, MPI_LONG_LONG,
+               MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(MPI_IN_PLACE, peak, memuse_category_count, MPI_LONG_LONG,
+               MPI_MAX, 0, MPI_COMM_WORLD);
+    if (memuse_huge_pages)
+      MPI_Reduce(MPI_IN_PLACE, &huge, 1, MPI_LONG_LONG, MPI_MAX, 0,
+                 MPI_COMM_WORLD);
+  } else {
+    MPI_Reduce(current, NULL, memuse_category_count, MPI_LONG_LONG, MPI_MAX,
+               0, MPI_COMM_WORLD);
+    MPI_Reduce(peak, NULL, memuse_category_count, MPI_LONG_LONG, MPI_MAX, 0,
+               MPI_COMM_WORLD);
+    if (memuse_huge_pages)
+      MPI_Reduce(&huge, NULL, 1, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+  }
+#endif
+
+  if (e->nodeID != 0) return;
+
+  if (memuse_huge_pages && (e->verbose || e->step == 0)) {
+    if (huge < 0)
+      message("Memory backed by transparent huge pages: unknown.");
+    else
+      message("Memory backed by transparent huge pages: %.3f MB.",
+              huge / (1024. * 1024.));
+  }
+
+  if (e->file_memuse != NULL) {
+    fprintf(e->file_memuse, "  %6d %14e", e->step, e->time);
+    for (int k = 0; k < memuse_category_count; k++)
+      fprintf(e->file_memuse, " %14.3f %14.3f", current[k] / (1024. * 1024.),
+              peak[k] / (1024. * 1024.));
+    fprintf(e->file_memuse, "\n");
+    fflush(e->file_memuse);
+  }
+
+  if (e->verbose)
+    for (int k = 0; k < memuse_category_count; k++)
+      message("Memory use of %-10s: %10.3f MB (peak %10.3f MB).",
+              memuse_category_names[k], current[k] / (1024. * 1024.),
+              peak[k] / (1024. * 1024.));
+}
+
+/**
+ * @brief Give the top-level cells more extra #spart if any of them, on any
+ * node, ran low on them since the last rebuild.
+ *
+ * @param e The #engine.
+ */
+static void engine_grow_extra_sparts(struct engine *e) {
+
+  int low = e->s->extra_sparts_low;
+  e->s->extra_sparts_low = 0;
+
+#ifdef WITH_MPI
+  /* All the nodes size the foreign cells with the same number of extras. */
+  MPI_Allreduce(MPI_IN_PLACE, &low, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+#endif
+
+  if (!low || space_extra_sparts >= space_extra_sparts_max) return;
+
+  space_extra_sparts = min(2 * space_extra_sparts, space_extra_sparts_max);
+  if (e->nodeID == 0)
+    message("Growing the number of extra sparts per top-level cell to %d.",
+            space_extra_sparts);
+}
+
 /**
  * @brief Rebuild the space and tasks.
  *
@@ -2461,9 +3009,33 @@ void engine_rebuild(struct engine *e, int repartitioned,
   e->forcerebuild = 0;
   e->restarting = 0;
 
+#ifdef WITH_MPI
+  /* Make the particles readable by the other nodes sharing our memory. */
+  if (e->sched.flags & scheduler_flag_mpi_shm) engine_share_parts(e);
+#endif
+
+  /* Make room for more new stars where they ran low. */
+  if (e->policy & engine_policy_star_formation) engine_grow_extra_sparts(e);
+
   /* Re-build the space. */
   space_rebuild(e->s, repartitioned, e->verbose);
 
+  /* All the sort arrays have been dropped by the cells, recycle them. */
+  size_t sort_arena_used = 0, sort_arena_capacity = 0;
+  for (int k = 0; k < e->nr_threads; k++) {
+    sort_arena_used += e->runners[k].sort_arena.used;
+    sort_arena_capacity += e->runners[k].sort_arena.capacity;
+    sort_arena_reset(&e->runners[k].sort_arena);
+  }
+  if (e->verbose)
+    message("Sort arenas: %zd MB used out of %zd MB since the last rebuild.",
+            sort_arena_used * sizeof(struct entry) / (1024 * 1024),
+            sort_arena_capacity * sizeof(struct entry) / (1024 * 1024));
+
+  /* Move the particles to the NUMA domain of the queues owning them. */
+  if (e->sched.queue_domain != NULL)
+    space_numa_place_particles(e->s, e->sched.queue_domain, e->verbose);
+
   /* Report the number of cells and memory */
   if (e->verbose)
     message(
@@ -2508,10 +3080,17 @@ void engine_rebuild(struct engine *e, int repartitioned,
     message("updating particle counts took %.3f %s.",
             clocks_from_ticks(getticks() - tic2), clocks_getunit());
 
-  /* Re-compute the mesh forces */
-  if ((e->policy & engine_policy_self_gravity) && e->s->periodic)
+  /* Re-compute the mesh forces. Note that this is the only place where the
+   * mesh is built, so it relies on the drift of all the particle types done
+   * before the rebuild and does not need a drift of its own. */
+  if ((e->policy & engine_policy_self_gravity) && e->s->periodic) {
     pm_mesh_compute_potential(e->mesh, e->s, &e->threadpool, e->verbose);
 
+    /* Freeze the mesh forces until the next rebuild? */
+    if (e->mesh->multiple_time_stepping)
+      pm_mesh_store_forces(e->mesh, e->s, &e->threadpool, e->verbose);
+  }
+
   /* Re-compute the maximal RMS displacement constraint */
   if (e->policy & engine_policy_cosmology)
     engine_recompute_displacement_constraint(e);
@@ -2527,10 +3106,16 @@ void engine_rebuild(struct engine *e, int repartitioned,
 
 /* If in parallel, exchange the cell structure, top-level and neighbouring
  * multipoles. */
+  ticks comms = 0;
 #ifdef WITH_MPI
+  const ticks tic_comms = getticks();
+
   if (e->policy & engine_policy_self_gravity) engine_exchange_top_multipoles(e);
 
   engine_exchange_cells(e);
+
+  comms = getticks() - tic_comms;
+  e->phase_ticks[engine_phase_comms] += comms;
 #endif
 
 #ifdef SWIFT_DEBUG_CHECKS
@@ -2548,8 +3133,8 @@ void engine_rebuild(struct engine *e, int repartitioned,
   }
 #endif
 
-  /* Re-build the tasks. */
-  engine_maketasks(e);
+  /* Re-build the tasks, unless the ones we have are still valid. */
+  if (!engine_reuse_tasks(e)) engine_maketasks(e);
 
   /* Make the list of top-level cells that have tasks */
   space_list_useful_top_level_cells(e->s);
@@ -2585,6 +3170,54 @@ void engine_rebuild(struct engine *e, int repartitioned,
   /* Flag that a rebuild has taken place */
   e->step_props |= engine_step_prop_rebuild;
 
+  e->phase_ticks[engine_phase_rebuild] += getticks() - tic - comms;
+
+  /* Report the memory used by the different parts of the code */
+  engine_report_memuse_categories(e);
+
+  if (e->verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+}
+
+/**
+ * @brief Re-build the gravity tree of the space without constructing any of
+ * the tasks of a time-step.
+ *
+ * This is all the stand-alone FOF tool needs on a single rank: the FOF tasks
+ * are constructed by engine_fof() and the scheduler is only sized for them.
+ * The long-range mesh is not computed and no communication takes place, so
+ * this cannot replace engine_rebuild() over MPI.
+ *
+ * @param e The #engine.
+ */
+void engine_rebuild_fof(struct engine *e) {
+
+  const ticks tic = getticks();
+
+#ifdef WITH_MPI
+  if (e->nr_nodes > 1)
+    error("The FOF tree can only be re-built on its own on a single rank.");
+#endif
+
+  /* Clear the forcerebuild flag, whatever it was. */
+  e->forcerebuild = 0;
+
+  /* Re-build the space. */
+  space_rebuild(e->s, /*repartitioned=*/0, e->verbose);
+
+  /* Update the global counters of particles */
+  e->total_nr_parts = e->s->nr_parts - e->s->nr_extra_parts;
+  e->total_nr_gparts = e->s->nr_gparts - e->s->nr_extra_gparts;
+  e->total_nr_sparts = e->s->nr_sparts - e->s->nr_extra_sparts;
+  e->total_nr_bparts = e->s->nr_bparts - e->s->nr_extra_bparts;
+
+  /* Room for one self and 13 pairs per top-level cell and for the splitting
+   * of the self tasks (8 selfs and 28 pairs per split cell). */
+  const int nr_fof_tasks =
+      14 * e->s->nr_cells + 5 * (e->s->tot_cells - e->s->nr_cells);
+  scheduler_reset(&e->sched, max(nr_fof_tasks, 1));
+
   if (e->verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
@@ -2662,8 +3295,13 @@ void engine_prepare(struct engine *e) {
   }
 #endif
 
-  /* Re-rank the tasks every now and then. XXX this never executes. */
-  if (e->tasks_age % engine_tasksreweight == 1) {
+  /* Re-weight the tasks after every step that did not rebuild when using
+   * adaptive weights, as the tasks then carry the run times of the previous
+   * step. The periodic re-weighting never triggers while
+   * engine_tasksreweight is 1. */
+  if (e->tasks_age % engine_tasksreweight == 1 ||
+      ((e->sched.flags & scheduler_flag_adaptive_weights) &&
+       e->tasks_age > 0)) {
     scheduler_reweight(&e->sched, e->verbose);
   }
   e->tasks_age += 1;
@@ -2675,6 +3313,35 @@ void engine_prepare(struct engine *e) {
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 }
 
+/**
+ * @brief Get the #runner threads to work on the map of the #threadpool
+ * instead of tasks, see threadpool_share_threads().
+ *
+ * @param tp The #threadpool.
+ * @param launch_data Pointer to the #engine.
+ */
+static void engine_launch_mappers(struct threadpool *tp, void *launch_data) {
+
+  struct engine *e = (struct engine *)launch_data;
+
+  /* The runners are busy with the tasks, do all the work ourselves. */
+  if (e->runners_tasking) {
+    threadpool_chomp(tp, tp->num_threads - 1);
+    return;
+  }
+
+  /* Release the runners... */
+  e->runners_mapping = 1;
+  swift_barrier_wait(&e->run_barrier);
+
+  /* ...do our share of the work... */
+  threadpool_chomp(tp, tp->num_threads - 1);
+
+  /* ...and wait for them to be done. */
+  swift_barrier_wait(&e->wait_barrier);
+  e->runners_mapping = 0;
+}
+
 /**
  * @brief Implements a barrier for the #runner threads.
  *
@@ -2698,9 +3365,11 @@ void engine_barrier(struct engine *e) {
  *
  * @param c The #cell to recurse into.
  * @param e The #engine.
+ * @param full Recurse into all the progeny rather than only the flagged ones?
  */
 void engine_collect_end_of_step_recurse_hydro(struct cell *c,
-                                              const struct engine *e) {
+                                              const struct engine *e,
+                                              const int full) {
 
   /* Skip super-cells (Their values are already set) */
   if (c->timestep != NULL) return;
@@ -2730,8 +3399,9 @@ void engine_collect_end_of_step_recurse_hydro(struct cell *c,
     struct cell *cp = c->progeny[k];
     if (cp != NULL && cp->hydro.count > 0) {
 
-      /* Recurse */
-      engine_collect_end_of_step_recurse_hydro(cp, e);
+      /* Recurse (only into the branches whose values changed) */
+      if (full || cell_get_flag(cp, cell_flag_do_collect))
+        engine_collect_end_of_step_recurse_hydro(cp, e, full);
 
       /* And update */
       ti_hydro_end_min = min(ti_hydro_end_min, cp->hydro.ti_end_min);
@@ -2774,9 +3444,11 @@ void engine_collect_end_of_step_recurse_hydro(struct cell *c,
  *
  * @param c The #cell to recurse into.
  * @param e The #engine.
+ * @param full Recurse into all the progeny rather than only the flagged ones?
  */
 void engine_collect_end_of_step_recurse_grav(struct cell *c,
-                                             const struct engine *e) {
+                                             const struct engine *e,
+                                             const int full) {
 
   /* Skip super-cells (Their values are already set) */
   if (c->timestep != NULL) return;
@@ -2799,8 +3471,9 @@ void engine_collect_end_of_step_recurse_grav(struct cell *c,
     struct cell *cp = c->progeny[k];
     if (cp != NULL && cp->grav.count > 0) {
 
-      /* Recurse */
-      engine_collect_end_of_step_recurse_grav(cp, e);
+      /* Recurse (only into the branches whose values changed) */
+      if (full || cell_get_flag(cp, cell_flag_do_collect))
+        engine_collect_end_of_step_recurse_grav(cp, e, full);
 
       /* And update */
       ti_grav_end_min = min(ti_grav_end_min, cp->grav.ti_end_min);
@@ -2832,9 +3505,11 @@ void engine_collect_end_of_step_recurse_grav(struct cell *c,
  *
  * @param c The #cell to recurse into.
  * @param e The #engine.
+ * @param full Recurse into all the progeny rather than only the flagged ones?
  */
 void engine_collect_end_of_step_recurse_stars(struct cell *c,
-                                              const struct engine *e) {
+                                              const struct engine *e,
+                                              const int full) {
 
   /* Skip super-cells (Their values are already set) */
   if (c->timestep != NULL) return;
@@ -2856,8 +3531,9 @@ void engine_collect_end_of_step_recurse_stars(struct cell *c,
     struct cell *cp = c->progeny[k];
     if (cp != NULL && cp->stars.count > 0) {
 
-      /* Recurse */
-      engine_collect_end_of_step_recurse_stars(cp, e);
+      /* Recurse (only into the branches whose values changed) */
+      if (full || cell_get_flag(cp, cell_flag_do_collect))
+        engine_collect_end_of_step_recurse_stars(cp, e, full);
 
       /* And update */
       ti_stars_end_min = min(ti_stars_end_min, cp->stars.ti_end_min);
@@ -2889,9 +3565,11 @@ void engine_collect_end_of_step_recurse_stars(struct cell *c,
  *
  * @param c The #cell to recurse into.
  * @param e The #engine.
+ * @param full Recurse into all the progeny rather than only the flagged ones?
  */
 void engine_collect_end_of_step_recurse_black_holes(struct cell *c,
-                                                    const struct engine *e) {
+                                                    const struct engine *e,
+                                                    const int full) {
 
   /* Skip super-cells (Their values are already set) */
   if (c->timestep != NULL) return;
@@ -2913,8 +3591,9 @@ void engine_collect_end_of_step_recurse_black_holes(struct cell *c,
     struct cell *cp = c->progeny[k];
     if (cp != NULL && cp->black_holes.count > 0) {
 
-      /* Recurse */
-      engine_collect_end_of_step_recurse_black_holes(cp, e);
+      /* Recurse (only into the branches whose values changed) */
+      if (full || cell_get_flag(cp, cell_flag_do_collect))
+        engine_collect_end_of_step_recurse_black_holes(cp, e, full);
 
       /* And update */
       ti_black_holes_end_min =
@@ -2940,6 +3619,23 @@ void engine_collect_end_of_step_recurse_black_holes(struct cell *c,
   c->black_holes.inhibited = inhibited;
 }
 
+/**
+ * @brief Clears the end-of-step collection flags of a #cell and of all its
+ * flagged progeny.
+ *
+ * @param c The #cell.
+ */
+static void engine_collect_end_of_step_clear_flags(struct cell *c) {
+
+  if (!cell_get_flag(c, cell_flag_do_collect)) return;
+  cell_clear_flag(c, cell_flag_do_collect);
+
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL)
+        engine_collect_end_of_step_clear_flags(c->progeny[k]);
+}
+
 /**
  * @brief Mapping function to collect the data from the end of the step
  *
@@ -2965,6 +3661,8 @@ void engine_collect_end_of_step_mapper(void *map_data, int num_elements,
   struct space *s = e->s;
   int *local_cells = (int *)map_data;
   struct star_formation_history *sfh_top = &data->sfh;
+  const int collect_all = data->collect_all;
+  const int nodeID = e->nodeID;
 
   /* Local collectible */
   size_t updated = 0, g_updated = 0, s_updated = 0, b_updated = 0;
@@ -2985,23 +3683,31 @@ void engine_collect_end_of_step_mapper(void *map_data, int num_elements,
   star_formation_logger_init(&sfh_updated);
 
   for (int ind = 0; ind < num_elements; ind++) {
-    struct cell *c = &s->cells_top[local_cells[ind]];
+    const int cid = local_cells[ind];
+    struct cell *c = &s->cells_top[cid];
+
+    /* Nothing below a local cell has changed if none of its time-step tasks
+     * ran, its top-level values are then still valid. Within a local cell,
+     * only the branches leading to a time-step task that ran are flagged
+     * and need recursing into. */
+    const int full = collect_all || c->nodeID != nodeID;
+    const int dirty = full || cell_get_flag(c, cell_flag_do_collect);
 
     if (c->hydro.count > 0 || c->grav.count > 0 || c->stars.count > 0 ||
         c->black_holes.count > 0) {
 
       /* Make the top-cells recurse */
-      if (with_hydro) {
-        engine_collect_end_of_step_recurse_hydro(c, e);
+      if (with_hydro && dirty) {
+        engine_collect_end_of_step_recurse_hydro(c, e, full);
       }
-      if (with_grav) {
-        engine_collect_end_of_step_recurse_grav(c, e);
+      if (with_grav && dirty) {
+        engine_collect_end_of_step_recurse_grav(c, e, full);
       }
-      if (with_stars) {
-        engine_collect_end_of_step_recurse_stars(c, e);
+      if (with_stars && dirty) {
+        engine_collect_end_of_step_recurse_stars(c, e, full);
       }
-      if (with_black_holes) {
-        engine_collect_end_of_step_recurse_black_holes(c, e);
+      if (with_black_holes && dirty) {
+        engine_collect_end_of_step_recurse_black_holes(c, e, full);
       }
 
       /* And aggregate */
@@ -3053,6 +3759,17 @@ void engine_collect_end_of_step_mapper(void *map_data, int num_elements,
       c->stars.updated = 0;
       c->black_holes.updated = 0;
     }
+
+    /* Collected, so clear the flags for next time. */
+    engine_collect_end_of_step_clear_flags(c);
+
+    /* Record the cells that need moving to the list of another bin. */
+    if (dirty && s->active_cells_valid) {
+      const integertime_t ti_next = cell_get_next_active_time(c, e);
+      const int bin = (ti_next > 0) ? get_max_active_bin(ti_next) : -1;
+      if (bin != s->active_cells_bin[cid])
+        s->active_cells_buffer[atomic_inc(&data->nr_moved)] = cid;
+    }
   }
 
   /* Let's write back to the global data.
@@ -3139,6 +3856,12 @@ void engine_collect_end_of_step(struct engine *e, int apply) {
   /* Initialize the total SFH of the simulation to zero */
   star_formation_logger_init(&data.sfh);
 
+  /* Do we need to recurse into all the cells? The star formation histories
+   * of the cells above the super-level are accumulated at every recursion. */
+  data.collect_all =
+      !s->active_cells_valid || (e->policy & engine_policy_star_formation);
+  data.nr_moved = 0;
+
   /* Collect information from the local top-level cells */
   threadpool_map(&e->threadpool, engine_collect_end_of_step_mapper,
                  s->local_cells_with_tasks_top, s->nr_local_cells_with_tasks,
@@ -3162,9 +3885,32 @@ void engine_collect_end_of_step(struct engine *e, int apply) {
       e->s->tot_cells, e->sched.nr_tasks,
       (float)e->sched.nr_tasks / (float)e->s->tot_cells, data.sfh);
 
-/* Aggregate collective data from the different nodes for this step. */
+/* Start aggregating the collective data from the different nodes for this
+ * step. The reduction proceeds while we do the purely local work below. */
 #ifdef WITH_MPI
-  collectgroup1_reduce(&e->collect_group1);
+  collectgroup1_reduce_start(&e->collect_group1);
+#endif
+
+  /* Update the lists of active cells, or build them after a rebuild. */
+  if (s->active_cells_valid) {
+    for (int k = 0; k < data.nr_moved; k++) {
+      const int cid = s->active_cells_buffer[k];
+      space_active_cells_update(
+          s, cid, cell_get_next_active_time(&s->cells_top[cid], e));
+    }
+  } else if (s->active_cells_next != NULL) {
+    space_active_cells_reset(s);
+    for (int k = 0; k < s->nr_local_cells_with_tasks; k++) {
+      const int cid = s->local_cells_with_tasks_top[k];
+      space_active_cells_update(
+          s, cid, cell_get_next_active_time(&s->cells_top[cid], e));
+    }
+    s->active_cells_valid = 1;
+  }
+
+/* And wait for the collective data to arrive. */
+#ifdef WITH_MPI
+  collectgroup1_reduce_finish(&e->collect_group1);
 
 #ifdef SWIFT_DEBUG_CHECKS
   {
@@ -3241,6 +3987,9 @@ void engine_collect_end_of_step(struct engine *e, int apply) {
 /**
  * @brief Print the conserved quantities statistics to a log file
  *
+ * All the particles are drifted to the current time (if they are not
+ * already) on the way.
+ *
  * @param e The #engine.
  */
 void engine_print_stats(struct engine *e) {
@@ -3248,11 +3997,6 @@ void engine_print_stats(struct engine *e) {
   const ticks tic = getticks();
 
 #ifdef SWIFT_DEBUG_CHECKS
-  /* Check that all cells have been drifted to the current time.
-   * That can include cells that have not
-   * previously been active on this rank. */
-  space_check_drift_point(e->s, e->ti_current, /*chek_mpoles=*/0);
-
   /* Be verbose about this */
   if (e->nodeID == 0) {
     if (e->policy & engine_policy_cosmology)
@@ -3276,8 +4020,9 @@ void engine_print_stats(struct engine *e) {
   struct statistics stats;
   stats_init(&stats);
 
-  /* Collect the stats on this node */
-  stats_collect(e->s, &stats);
+  /* Drift everything that has not been drifted yet and collect the stats on
+   * this node in the same pass */
+  engine_drift_all_and_collect_stats(e, &stats);
 
 /* Aggregate the data from the different nodes. */
 #ifdef WITH_MPI
@@ -3390,29 +4135,219 @@ void engine_launch(struct engine *e) {
   space_reset_task_counters(e->s);
 #endif
 
+  /* Forget the data attached to the cells during the previous launch. */
+  e->launch_generation++;
+  if ((e->hydro_properties != NULL && e->hydro_properties->neighbour_lists) ||
+      (e->stars_properties != NULL &&
+       e->stars_properties->feedback_neighbour_lists)) {
+    for (int k = 0; k < e->nr_threads; k++)
+      neighbour_list_arena_reset(&e->runners[k].neighbour_lists);
+  }
+
   /* Prepare the scheduler. */
   atomic_inc(&e->sched.waiting);
 
+  /* Load the tasks, using the runners through the threadpool. */
+  scheduler_start(&e->sched);
+
   /* Cry havoc and let loose the dogs of war. */
+  e->runners_tasking = 1;
   swift_barrier_wait(&e->run_barrier);
 
-  /* Load the tasks. */
-  scheduler_start(&e->sched);
-
   /* Remove the safeguard. */
-  pthread_mutex_lock(&e->sched.sleep_mutex);
-  atomic_dec(&e->sched.waiting);
-  pthread_cond_broadcast(&e->sched.sleep_cond);
-  pthread_mutex_unlock(&e->sched.sleep_mutex);
+  if (atomic_dec(&e->sched.waiting) == 1) scheduler_wake_all(&e->sched);
 
   /* Sit back and wait for the runners to come home. */
   swift_barrier_wait(&e->wait_barrier);
+  e->runners_tasking = 0;
+
+  e->phase_ticks[engine_phase_tasks] += getticks() - tic;
 
   if (e->verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
 }
 
+/*! Number of gas particles per node whose smoothing length and density read
+ * from the ICs are checked against the values of the first time-step when
+ * skipping the initial density calculation. */
+#define engine_fast_start_sample_size 1000
+
+/*! Maximal relative difference between the smoothing lengths and densities
+ * of the ICs and those of the first time-step for a fast start. */
+#define engine_fast_start_tolerance 0.05f
+
+/**
+ * @brief The ICs values of a particle checked after a fast start.
+ */
+struct engine_fast_start_sample {
+
+  /*! ID of the particle */
+  long long id;
+
+  /*! Smoothing length and density read from the ICs */
+  float h, rho;
+};
+
+/**
+ * @brief Sort function for #engine_fast_start_sample%s, by ID.
+ */
+static int engine_fast_start_sample_cmp(const void *a, const void *b) {
+  const struct engine_fast_start_sample *sa =
+      (const struct engine_fast_start_sample *)a;
+  const struct engine_fast_start_sample *sb =
+      (const struct engine_fast_start_sample *)b;
+  return (sa->id > sb->id) - (sa->id < sb->id);
+}
+
+/**
+ * @brief Finds the density field read from the ICs by the hydro scheme.
+ *
+ * @param s The #space.
+ * @return The #io_props of the field, with a NULL field if the scheme does not
+ * read any density.
+ */
+static struct io_props engine_fast_start_density_field(struct space *s) {
+
+  struct io_props list[100];
+  int num_fields = 0;
+  hydro_read_particles(s->parts, list, &num_fields);
+  for (int i = 0; i < num_fields; i++)
+    if (strcmp(list[i].name, "Density") == 0) return list[i];
+
+  struct io_props none;
+  bzero(&none, sizeof(struct io_props));
+  return none;
+}
+
+/**
+ * @brief Keeps the ICs values needed to skip the initial density calculation.
+ *
+ * The smoothing lengths (and densities, if the ICs provide them) of a random
+ * sample of the gas particles are saved for engine_fast_start_check(). If the
+ * internal energies still need to be converted, the densities of all the
+ * particles are saved as well since they are needed for the conversion but
+ * are reset when the particles are first initialised.
+ *
+ * @param e The #engine.
+ * @param need_density Do we need the densities of all the particles?
+ * @param sample (return) The sample of particles, sorted by ID.
+ * @param sample_count (return) The number of particles in the sample.
+ * @return The densities of all the particles or NULL if not needed.
+ */
+static float *engine_fast_start_save(struct engine *e, int need_density,
+                                     struct engine_fast_start_sample **sample,
+                                     int *sample_count) {
+
+  struct space *s = e->s;
+  const struct io_props density = engine_fast_start_density_field(s);
+  if (need_density && density.field == NULL)
+    error(
+        "The hydro scheme does not read the densities from the ICs. Cannot "
+        "skip the initial density calculation.");
+
+  /* Check and collect the densities of the ICs */
+  float *rho = NULL;
+  if (need_density && s->nr_parts > 0) {
+    rho = (float *)swift_malloc("rho_ics", s->nr_parts * sizeof(float));
+    if (rho == NULL) error("Failed to allocate the densities of the ICs.");
+    for (size_t k = 0; k < s->nr_parts; k++) {
+      const struct part *p = &s->parts[k];
+      rho[k] = *(const float *)(density.field + k * density.partSize);
+      if (p->time_bin != time_bin_not_created && !part_is_inhibited(p, e) &&
+          !(rho[k] > 0.f))
+        error(
+            "Invalid density for part %lld in the ICs (rho=%e). Cannot skip "
+            "the initial density calculation.",
+            p->id, rho[k]);
+    }
+  }
+
+  /* Pick the particles to check at random */
+  *sample = (struct engine_fast_start_sample *)malloc(
+      engine_fast_start_sample_size * sizeof(struct engine_fast_start_sample));
+  if (*sample == NULL) error("Failed to allocate the fast-start sample.");
+  *sample_count = 0;
+  unsigned int seed = e->nodeID;
+  for (int i = 0; i < engine_fast_start_sample_size && s->nr_parts > 0; i++) {
+    const size_t k = ((size_t)rand_r(&seed) * RAND_MAX + rand_r(&seed)) %
+                     s->nr_parts;
+    const struct part *p = &s->parts[k];
+    if (p->time_bin == time_bin_not_created || part_is_inhibited(p, e))
+      continue;
+
+    struct engine_fast_start_sample *sp = &(*sample)[*sample_count];
+    sp->id = p->id;
+    sp->h = p->h;
+    sp->rho = density.field != NULL
+                  ? *(const float *)(density.field + k * density.partSize)
+                  : 0.f;
+    (*sample_count)++;
+  }
+  qsort(*sample, *sample_count, sizeof(struct engine_fast_start_sample),
+        engine_fast_start_sample_cmp);
+
+  return rho;
+}
+
+/**
+ * @brief Puts back the densities of the ICs saved by engine_fast_start_save().
+ *
+ * @param e The #engine.
+ * @param rho The densities, indexed like the particles.
+ */
+static void engine_fast_start_restore_density(struct engine *e,
+                                              const float *rho) {
+
+  struct space *s = e->s;
+  const struct io_props density = engine_fast_start_density_field(s);
+  for (size_t k = 0; k < s->nr_parts; k++)
+    *(float *)(density.field + k * density.partSize) = rho[k];
+}
+
+/**
+ * @brief Checks that the sampled ICs values agree with the ones of the first
+ * time-step.
+ *
+ * @param e The #engine.
+ * @param sample The sample of particles, sorted by ID.
+ * @param sample_count The number of particles in the sample.
+ */
+static void engine_fast_start_check(
+    const struct engine *e, const struct engine_fast_start_sample *sample,
+    int sample_count) {
+
+  const struct space *s = e->s;
+  int failed = 0;
+  float max_diff = 0.f;
+  for (size_t k = 0; k < s->nr_parts && sample_count > 0; k++) {
+    const struct part *p = &s->parts[k];
+    const struct engine_fast_start_sample key = {p->id, 0.f, 0.f};
+    const struct engine_fast_start_sample *sp =
+        (const struct engine_fast_start_sample *)bsearch(
+            &key, sample, sample_count, sizeof(struct engine_fast_start_sample),
+            engine_fast_start_sample_cmp);
+    if (sp == NULL) continue;
+
+    float diff = fabsf(p->h - sp->h) / p->h;
+    if (sp->rho > 0.f) {
+      const float rho = hydro_get_comoving_density(p);
+      diff = max(diff, fabsf(rho - sp->rho) / rho);
+    }
+    max_diff = max(max_diff, diff);
+    if (diff > engine_fast_start_tolerance) failed++;
+  }
+
+  if (e->verbose)
+    message("Largest relative difference with the ICs: %e", max_diff);
+  if (failed > 0)
+    error(
+        "%d of the %d sampled particles have smoothing lengths or densities "
+        "differing by more than %.0f%% from the ICs. The ICs are not "
+        "converged, do not skip the initial density calculation.",
+        failed, sample_count, 100.f * engine_fast_start_tolerance);
+}
+
 /**
  * @brief Calls the 'first init' function on the particles of all types.
  *
@@ -3441,9 +4376,11 @@ void engine_first_init_particles(struct engine *e) {
  * @param flag_entropy_ICs Did the 'Internal Energy' of the particles actually
  * contain entropy ?
  * @param clean_h_values Are we cleaning up the values of h before building
+ * @param fast_start Do we trust the smoothing lengths and densities of the ICs
+ * and skip the initial density calculation?
  */
 void engine_init_particles(struct engine *e, int flag_entropy_ICs,
-                           int clean_h_values) {
+                           int clean_h_values, int fast_start) {
 
   struct space *s = e->s;
 
@@ -3459,32 +4396,48 @@ void engine_init_particles(struct engine *e, int flag_entropy_ICs,
     hydro_props_update(e->hydro_properties, e->gravity_properties,
                        e->cosmology);
 
+  /* Keep what we need of the ICs to skip the initial density calculation */
+  float *rho_ics = NULL;
+  struct engine_fast_start_sample *sample = NULL;
+  int sample_count = 0;
+  if (fast_start)
+    rho_ics = engine_fast_start_save(e, !flag_entropy_ICs, &sample,
+                                     &sample_count);
+
   /* Start by setting the particles in a good state */
   if (e->nodeID == 0) message("Setting particles to a valid state...");
   engine_first_init_particles(e);
 
-  if (e->nodeID == 0) message("Computing initial gas densities.");
+  if (!fast_start) {
 
-  /* Construct all cells and tasks to start everything */
-  engine_rebuild(e, 0, clean_h_values);
+    if (e->nodeID == 0) message("Computing initial gas densities.");
 
-  /* No time integration. We just want the density and ghosts */
-  engine_skip_force_and_kick(e);
+    /* Construct all cells and tasks to start everything */
+    engine_rebuild(e, 0, clean_h_values);
 
-  /* Print the number of active tasks ? */
-  if (e->verbose) engine_print_task_counts(e);
+    /* No time integration. We just want the density and ghosts */
+    engine_skip_force_and_kick(e);
 
-  /* Init the particle data (by hand). */
-  space_init_parts(s, e->verbose);
-  space_init_gparts(s, e->verbose);
-  space_init_sparts(s, e->verbose);
-  space_init_bparts(s, e->verbose);
+    /* Print the number of active tasks ? */
+    if (e->verbose) engine_print_task_counts(e);
+
+    /* Init the particle data (by hand). */
+    space_init_parts(s, e->verbose);
+    space_init_gparts(s, e->verbose);
+    space_init_sparts(s, e->verbose);
+    space_init_bparts(s, e->verbose);
+  }
 
   /* Update the cooling function */
   if ((e->policy & engine_policy_cooling) ||
       (e->policy & engine_policy_temperature))
     cooling_update(e->cosmology, e->cooling_func, e->s);
 
+  /* Update the feedback model */
+  if (e->policy & engine_policy_feedback)
+    feedback_update(e->feedback_props, e->cosmology, e->time,
+                    e->policy & engine_policy_cosmology);
+
 #ifdef WITH_LOGGER
   /* Mark the first time step in the particle logger file. */
   logger_log_timestamp(e->logger, e->ti_current, e->time,
@@ -3495,9 +4448,18 @@ void engine_init_particles(struct engine *e, int flag_entropy_ICs,
 #endif
 
   /* Now, launch the calculation */
-  TIMER_TIC;
-  engine_launch(e);
-  TIMER_TOC(timer_runners);
+  if (!fast_start) {
+    TIMER_TIC;
+    engine_launch(e);
+    TIMER_TOC(timer_runners);
+  } else {
+    if (e->nodeID == 0)
+      message("Using the smoothing lengths and densities of the ICs.");
+    if (rho_ics != NULL) {
+      engine_fast_start_restore_density(e, rho_ics);
+      swift_free("rho_ics", rho_ics);
+    }
+  }
 
   /* Apply some conversions (e.g. internal energy -> entropy) */
   if (!flag_entropy_ICs) {
@@ -3507,7 +4469,7 @@ void engine_init_particles(struct engine *e, int flag_entropy_ICs,
     space_convert_quantities(e->s, e->verbose);
 
     /* Correct what we did (e.g. in PE-SPH, need to recompute rho_bar) */
-    if (hydro_need_extra_init_loop) {
+    if (hydro_need_extra_init_loop && !fast_start) {
       engine_marktasks(e);
       engine_skip_force_and_kick(e);
       engine_launch(e);
@@ -3517,7 +4479,7 @@ void engine_init_particles(struct engine *e, int flag_entropy_ICs,
 #ifdef SWIFT_DEBUG_CHECKS
   /* Check that we have the correct total mass in the top-level multipoles */
   long long num_gpart_mpole = 0;
-  if (e->policy & engine_policy_self_gravity) {
+  if ((e->policy & engine_policy_self_gravity) && !fast_start) {
     for (int i = 0; i < e->s->nr_cells; ++i)
       num_gpart_mpole += e->s->cells_top[i].grav.multipole->m_pole.num_gpart;
     if (num_gpart_mpole != e->total_nr_gparts)
@@ -3533,7 +4495,7 @@ void engine_init_particles(struct engine *e, int flag_entropy_ICs,
   if (e->nodeID == 0) message("Running initial fake time-step.");
 
   /* Construct all cells again for a new round (need to update h_max) */
-  engine_rebuild(e, 0, 0);
+  engine_rebuild(e, 0, fast_start ? clean_h_values : 0);
 
   /* No drift this time */
   engine_skip_drift(e);
@@ -3562,6 +4524,12 @@ void engine_init_particles(struct engine *e, int flag_entropy_ICs,
   engine_launch(e);
   TIMER_TOC2(timer_runners);
 
+  /* Were the ICs as good as we trusted them to be? */
+  if (fast_start) {
+    engine_fast_start_check(e, sample, sample_count);
+    free(sample);
+  }
+
 #ifdef SWIFT_GRAVITY_FORCE_CHECKS
   /* Check the accuracy of the gravity calculation */
   if (e->policy & engine_policy_self_gravity)
@@ -3664,21 +4632,99 @@ void engine_init_particles(struct engine *e, int flag_entropy_ICs,
     }
   }
 
-  clocks_gettime(&time2);
+  clocks_gettime(&time2);
+
+#ifdef SWIFT_DEBUG_CHECKS
+  space_check_timesteps(e->s);
+  part_verify_links(e->s->parts, e->s->gparts, e->s->sparts, e->s->bparts,
+                    e->s->nr_parts, e->s->nr_gparts, e->s->nr_sparts,
+                    e->s->nr_bparts, e->verbose);
+#endif
+
+  /* Ready to go */
+  e->step = 0;
+  e->forcerebuild = 1;
+  e->wallclock_time = (float)clocks_diff(&time1, &time2);
+
+  if (e->verbose) message("took %.3f %s.", e->wallclock_time, clocks_getunit());
+}
+
+/**
+ * @brief Reduce the histograms of the task timings of all the threads and all
+ * the nodes, write them and clear them for the next steps.
+ *
+ * @param e The #engine.
+ */
+static void engine_dump_task_histograms(struct engine *e) {
+
+  const ticks tic = getticks();
+
+  /* Collect the histograms of all our threads. */
+  struct task_histograms local;
+  task_histograms_init(&local);
+  for (int k = 0; k < e->nr_threads; k++) {
+    struct task_histograms *h = &e->runners[k].histograms;
+    task_histograms_merge(&local, h->entries, task_histograms_size);
+    local.nr_dropped += h->nr_dropped;
+    task_histograms_reset(h);
+  }
+
+#ifdef WITH_MPI
+  /* Collect the used entries of all the nodes on the first one. */
+  struct task_histogram *packed = NULL;
+  if ((packed = (struct task_histogram *)malloc(
+           task_histograms_size * sizeof(struct task_histogram))) == NULL)
+    error("Failed to allocate the packed task histograms.");
+  const int nr_packed = task_histograms_pack(&local, packed);
+  const int size = nr_packed * sizeof(struct task_histogram);
+
+  int *sizes = NULL, *displs = NULL;
+  char *all = NULL;
+  if (e->nodeID == 0) {
+    if ((sizes = (int *)malloc(e->nr_nodes * sizeof(int))) == NULL ||
+        (displs = (int *)malloc(e->nr_nodes * sizeof(int))) == NULL)
+      error("Failed to allocate the task histograms sizes.");
+  }
+  MPI_Gather(&size, 1, MPI_INT, sizes, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  int total = 0;
+  if (e->nodeID == 0) {
+    for (int k = 0; k < e->nr_nodes; k++) {
+      displs[k] = total;
+      total += sizes[k];
+    }
+    if ((all = (char *)malloc(total)) == NULL)
+      error("Failed to allocate the task histograms of all the nodes.");
+  }
+  MPI_Gatherv(packed, size, MPI_BYTE, all, sizes, displs, MPI_BYTE, 0,
+              MPI_COMM_WORLD);
+
+  unsigned int nr_dropped = 0;
+  MPI_Reduce(&local.nr_dropped, &nr_dropped, 1, MPI_UNSIGNED, MPI_SUM, 0,
+             MPI_COMM_WORLD);
 
-#ifdef SWIFT_DEBUG_CHECKS
-  space_check_timesteps(e->s);
-  part_verify_links(e->s->parts, e->s->gparts, e->s->sparts, e->s->bparts,
-                    e->s->nr_parts, e->s->nr_gparts, e->s->nr_sparts,
-                    e->s->nr_bparts, e->verbose);
+  if (e->nodeID == 0) {
+    task_histograms_reset(&local);
+    task_histograms_merge(&local, (struct task_histogram *)all,
+                          total / sizeof(struct task_histogram));
+    local.nr_dropped += nr_dropped;
+  }
+  free(all);
+  free(displs);
+  free(sizes);
+  free(packed);
 #endif
 
-  /* Ready to go */
-  e->step = 0;
-  e->forcerebuild = 1;
-  e->wallclock_time = (float)clocks_diff(&time1, &time2);
+  /* And write them. */
+  if (e->nodeID == 0) {
+    task_histograms_write(&local, e->file_task_histograms, e->step);
+    fflush(e->file_task_histograms);
+  }
+  task_histograms_clean(&local);
 
-  if (e->verbose) message("took %.3f %s.", e->wallclock_time, clocks_getunit());
+  if (e->verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
 }
 
 /**
@@ -3717,14 +4763,21 @@ void engine_step(struct engine *e) {
       fflush(e->sfh_logger);
     }
 
-    if (!e->restarting)
+    if (!e->restarting) {
       fprintf(
           e->file_timesteps,
           "  %6d %14e %12.7f %12.7f %14e %4d %4d %12lld %12lld %12lld %12lld "
-          "%21.3f %6d\n",
+          "%21.3f %6d",
           e->step, e->time, e->cosmology->a, e->cosmology->z, e->time_step,
           e->min_active_bin, e->max_active_bin, e->updates, e->g_updates,
           e->s_updates, e->b_updates, e->wallclock_time, e->step_props);
+
+      /* Where the time of the tasks went, with the slowest ones on a
+       * comment line. */
+      if (e->step_analysis)
+        profiler_write_step_analysis(&e->last_analysis, e->file_timesteps);
+      fprintf(e->file_timesteps, "\n");
+    }
 #ifdef SWIFT_DEBUG_CHECKS
     fflush(e->file_timesteps);
 #endif
@@ -3762,6 +4815,11 @@ void engine_step(struct engine *e) {
       (e->policy & engine_policy_temperature))
     cooling_update(e->cosmology, e->cooling_func, e->s);
 
+  /* Update the feedback model */
+  if (e->policy & engine_policy_feedback)
+    feedback_update(e->feedback_props, e->cosmology, e->time,
+                    e->policy & engine_policy_cosmology);
+
   /*****************************************************/
   /* OK, we now know what the next end of time-step is */
   /*****************************************************/
@@ -3797,18 +4855,21 @@ void engine_step(struct engine *e) {
   logger_ensure_size(e->logger, e->total_nr_parts, e->total_nr_gparts, 0);
 #endif
 
+  /* Are we checking the gravity accuracy in this step? The exact forces
+   * need all the gparts at the current time. */
+  const int check_gravity = e->gravity_accuracy.every > 0 &&
+                            e->step % e->gravity_accuracy.every == 0;
+
   /* Are we drifting everything (a la Gadget/GIZMO) ? */
-  if (e->policy & engine_policy_drift_all && !e->forcerebuild)
+  if (((e->policy & engine_policy_drift_all) || check_gravity) &&
+      !e->forcerebuild)
     engine_drift_all(e, /*drift_mpole=*/1);
 
-  /* Are we reconstructing the multipoles or drifting them ?*/
-  if ((e->policy & engine_policy_self_gravity) && !e->forcerebuild) {
-
-    if (e->policy & engine_policy_reconstruct_mpoles)
-      engine_reconstruct_multipoles(e);
-    else
-      engine_drift_top_multipoles(e);
-  }
+  /* Are we reconstructing the multipoles? Otherwise, they are drifted on
+   * their first use in the step (see cell_drift_multipole_on_use()). */
+  if ((e->policy & engine_policy_self_gravity) &&
+      (e->policy & engine_policy_reconstruct_mpoles) && !e->forcerebuild)
+    engine_reconstruct_multipoles(e);
 
 #ifdef WITH_MPI
   /* Repartition the space amongst the nodes? */
@@ -3844,11 +4905,30 @@ void engine_step(struct engine *e) {
     gravity_exact_force_compute(e->s, e);
 #endif
 
+  /* Pick the gparts whose gravity we check */
+  if (check_gravity) gravity_accuracy_monitor_sample(&e->gravity_accuracy, e);
+
   /* Start all the tasks. */
   TIMER_TIC;
+  const ticks tic_launch = getticks();
   engine_launch(e);
   TIMER_TOC(timer_runners);
 
+  /* Compare their accelerations to the exact ones */
+  if (check_gravity) gravity_accuracy_monitor_check(&e->gravity_accuracy, e);
+
+  /* Record the costs of the tasks for the tuning of the split sizes. */
+  if (e->s->split_tuning != NULL)
+    space_split_tuning_collect(e->s, &e->sched, tic_launch);
+
+  /* Work out where the time of the tasks went? */
+  if (e->step_analysis)
+    task_analyse_step(e, tic_launch, getticks(), &e->last_analysis);
+
+  /* Write the histograms of the task timings? */
+  if (e->task_histograms_steps > 0 && e->step % e->task_histograms_steps == 0)
+    engine_dump_task_histograms(e);
+
 #ifdef SWIFT_GRAVITY_FORCE_CHECKS
   /* Check the accuracy of the gravity calculation */
   if (e->policy & engine_policy_self_gravity)
@@ -3881,7 +4961,13 @@ void engine_step(struct engine *e) {
   /* Create a restart file if needed. */
   engine_dump_restarts(e, 0, e->restart_onexit && engine_is_done(e));
 
+  /* Write the outputs, not counting the tasks they may have launched. */
+  const ticks tic_io = getticks();
+  const ticks tasks_io = e->phase_ticks[engine_phase_tasks];
   engine_check_for_dumps(e);
+  e->phase_ticks[engine_phase_io] += getticks() - tic_io -
+                                     (e->phase_ticks[engine_phase_tasks] -
+                                      tasks_io);
 
   TIMER_TOC2(timer_step);
 
@@ -3892,66 +4978,87 @@ void engine_step(struct engine *e) {
   e->toc_step = getticks();
 }
 
+/*! The kinds of output that can take place between two steps */
+enum engine_output_type {
+  engine_output_none,
+  engine_output_snapshot,
+  engine_output_statistics,
+  engine_output_stf
+};
+
 /**
- * @brief Check whether any kind of i/o has to be performed during this
- * step.
- *
- * This includes snapshots, stats and halo finder. We also handle the case
- * of multiple outputs between two steps.
+ * @brief Find the earliest output (amongst all kinds) that takes place before
+ * the next time-step.
  *
  * @param e The #engine.
+ * @param ti_output (return) The time of that output on the time-line.
+ * @return The kind of output or #engine_output_none.
  */
-void engine_check_for_dumps(struct engine *e) {
+static enum engine_output_type engine_next_output(const struct engine *e,
+                                                  integertime_t *ti_output) {
 
-  const int with_cosmology = (e->policy & engine_policy_cosmology);
   const int with_stf = (e->policy & engine_policy_structure_finding);
 
-  /* What kind of output are we getting? */
-  enum output_type {
-    output_none,
-    output_snapshot,
-    output_statistics,
-    output_stf
-  };
-
-  /* What kind of output do we want? And at which time ?
-   * Find the earliest output (amongst all kinds) that takes place
-   * before the next time-step */
-  enum output_type type = output_none;
-  integertime_t ti_output = max_nr_timesteps;
+  enum engine_output_type type = engine_output_none;
+  *ti_output = max_nr_timesteps;
 
   /* Save some statistics ? */
   if (e->ti_end_min > e->ti_next_stats && e->ti_next_stats > 0) {
-    if (e->ti_next_stats < ti_output) {
-      ti_output = e->ti_next_stats;
-      type = output_statistics;
+    if (e->ti_next_stats < *ti_output) {
+      *ti_output = e->ti_next_stats;
+      type = engine_output_statistics;
     }
   }
 
   /* Do we want a snapshot? */
   if (e->ti_end_min > e->ti_next_snapshot && e->ti_next_snapshot > 0) {
-    if (e->ti_next_snapshot < ti_output) {
-      ti_output = e->ti_next_snapshot;
-      type = output_snapshot;
+    if (e->ti_next_snapshot < *ti_output) {
+      *ti_output = e->ti_next_snapshot;
+      type = engine_output_snapshot;
     }
   }
 
   /* Do we want to perform structure finding? */
   if (with_stf) {
     if (e->ti_end_min > e->ti_next_stf && e->ti_next_stf > 0) {
-      if (e->ti_next_stf < ti_output) {
-        ti_output = e->ti_next_stf;
-        type = output_stf;
+      if (e->ti_next_stf < *ti_output) {
+        *ti_output = e->ti_next_stf;
+        type = engine_output_stf;
       }
     }
   }
 
+  return type;
+}
+
+/**
+ * @brief Check whether any kind of i/o has to be performed during this
+ * step.
+ *
+ * This includes snapshots, stats and halo finder. We also handle the case
+ * of multiple outputs between two steps. Outputs falling on the same point
+ * of the time-line share a single drift of all the particles.
+ *
+ * @param e The #engine.
+ */
+void engine_check_for_dumps(struct engine *e) {
+
+  const int with_cosmology = (e->policy & engine_policy_cosmology);
+  const int with_stf = (e->policy & engine_policy_structure_finding);
+
+  /* What kind of output do we want? And at which time ? */
+  integertime_t ti_output;
+  enum engine_output_type type = engine_next_output(e, &ti_output);
+
   /* Store information before attempting extra dump-related drifts */
   const integertime_t ti_current = e->ti_current;
   const timebin_t max_active_bin = e->max_active_bin;
   const double time = e->time;
 
-  while (type != output_none) {
+  /* Time to which everything was last drifted for an output */
+  integertime_t ti_drifted = -1;
+
+  while (type != engine_output_none) {
 
     /* Let's fake that we are at the dump time */
     e->ti_current = ti_output;
@@ -3963,17 +5070,22 @@ void engine_check_for_dumps(struct engine *e) {
       e->time = ti_output * e->time_base + e->time_begin;
     }
 
-    /* Drift everyone */
-    engine_drift_all(e, /*drift_mpole=*/0);
+    /* Drift everyone (the statistics are collected during their own drift)
+     * unless a previous output already did it for this time */
+    if (type != engine_output_statistics && ti_output != ti_drifted) {
+      engine_drift_all(e, /*drift_mpole=*/0);
+      ti_drifted = ti_output;
+    }
 
     /* Write some form of output */
     switch (type) {
-      case output_snapshot:
+      case engine_output_snapshot:
 
         /* Do we want a corresponding VELOCIraptor output? */
         if (with_stf && e->snapshot_invoke_stf) {
 
 #ifdef HAVE_VELOCIRAPTOR
+          engine_wait_for_snapshot(e);
           velociraptor_invoke(e, /*linked_with_snap=*/1);
           e->step_props |= engine_step_prop_stf;
 #else
@@ -4003,7 +5115,7 @@ void engine_check_for_dumps(struct engine *e) {
         engine_compute_next_snapshot_time(e);
         break;
 
-      case output_statistics:
+      case engine_output_statistics:
 
         /* Dump */
         engine_print_stats(e);
@@ -4013,10 +5125,11 @@ void engine_check_for_dumps(struct engine *e) {
 
         break;
 
-      case output_stf:
+      case engine_output_stf:
 
 #ifdef HAVE_VELOCIRAPTOR
         /* Unleash the raptor! */
+        engine_wait_for_snapshot(e);
         velociraptor_invoke(e, /*linked_with_snap=*/0);
         e->step_props |= engine_step_prop_stf;
 
@@ -4035,35 +5148,7 @@ void engine_check_for_dumps(struct engine *e) {
 
     /* We need to see whether whether we are in the pathological case
      * where there can be another dump before the next step. */
-
-    type = output_none;
-    ti_output = max_nr_timesteps;
-
-    /* Save some statistics ? */
-    if (e->ti_end_min > e->ti_next_stats && e->ti_next_stats > 0) {
-      if (e->ti_next_stats < ti_output) {
-        ti_output = e->ti_next_stats;
-        type = output_statistics;
-      }
-    }
-
-    /* Do we want a snapshot? */
-    if (e->ti_end_min > e->ti_next_snapshot && e->ti_next_snapshot > 0) {
-      if (e->ti_next_snapshot < ti_output) {
-        ti_output = e->ti_next_snapshot;
-        type = output_snapshot;
-      }
-    }
-
-    /* Do we want to perform structure finding? */
-    if (with_stf) {
-      if (e->ti_end_min > e->ti_next_stf && e->ti_next_stf > 0) {
-        if (e->ti_next_stf < ti_output) {
-          ti_output = e->ti_next_stf;
-          type = output_stf;
-        }
-      }
-    }
+    type = engine_next_output(e, &ti_output);
 
   } /* While loop over output types */
 
@@ -4099,13 +5184,17 @@ void engine_dump_restarts(struct engine *e, int drifted_all, int force) {
 
       if (e->nodeID == 0) message("Writing restart files");
 
+      /* Let the previous dump complete before touching its files. */
+      restart_write_wait(e);
+
       /* Clean out the previous saved files, if found. Do this now as we are
        * MPI synchronized. */
       restart_remove_previous(e->restart_file);
 
       /* Drift all particles first (may have just been done). */
       if (!drifted_all) engine_drift_all(e, /*drift_mpole=*/1);
-      restart_write(e, e->restart_file);
+      /* Forced dumps precede an exit, no point in overlapping them. */
+      restart_write(e, e->restart_file, /*async=*/!force);
 
       if (e->verbose)
         message("Dumping restart files took %.3f %s",
@@ -4116,10 +5205,64 @@ void engine_dump_restarts(struct engine *e, int drifted_all, int force) {
 
       /* Flag that we dumped the restarts */
       e->step_props |= engine_step_prop_restarts;
+
+      e->phase_ticks[engine_phase_io] += getticks() - tic;
     }
   }
 }
 
+/**
+ * @brief Appends a summary of the time spent in the rebuilds, tasks,
+ * communications and i/o since the start of the run to a file.
+ *
+ * The file gets a header when it is created so that the summaries of a
+ * series of runs (e.g. a scaling test) can be collected in the same file. The
+ * times are the maximum over the ranks, so this must be called by all ranks.
+ *
+ * @param e The #engine.
+ * @param filename The name of the file to append to.
+ * @param nr_steps The number of steps taken by this run.
+ */
+void engine_write_phase_summary(struct engine *e, const char *filename,
+                                int nr_steps) {
+
+  /* The time in each phase and the total time of the run. */
+  double times[engine_phase_count + 1];
+  for (int k = 0; k < engine_phase_count; k++)
+    times[k] = clocks_from_ticks(e->phase_ticks[k]);
+  times[engine_phase_count] = clocks_get_hours_since_start() * 3600. * 1000.;
+
+#ifdef WITH_MPI
+  int res = MPI_Reduce((e->nodeID == 0 ? MPI_IN_PLACE : times), times,
+                       engine_phase_count + 1, MPI_DOUBLE, MPI_MAX, 0,
+                       MPI_COMM_WORLD);
+  if (res != MPI_SUCCESS) mpi_error(res, "Failed to reduce the phase times");
+#endif
+
+  if (e->nodeID != 0) return;
+
+  FILE *file = fopen(filename, "a");
+  if (file == NULL)
+    error("Failed to open the phase summary file '%s'.", filename);
+
+  /* New file? */
+  if (ftell(file) == 0) {
+    fprintf(file, "# %6s %8s %8s %14s %14s %14s", "Ranks", "Threads", "Steps",
+            "Gas", "DM", "Stars");
+    for (int k = 0; k < engine_phase_count; k++)
+      fprintf(file, " %16s [%s]", engine_phase_names[k], clocks_getunit());
+    fprintf(file, " %16s [%s]\n", "total", clocks_getunit());
+  }
+
+  fprintf(file, "  %6d %8d %8d %14lld %14lld %14lld", e->nr_nodes,
+          e->nr_threads, nr_steps, e->total_nr_parts, e->total_nr_gparts,
+          e->total_nr_sparts);
+  for (int k = 0; k <= engine_phase_count; k++)
+    fprintf(file, " %21.3f", times[k]);
+  fprintf(file, "\n");
+  fclose(file);
+}
+
 /**
  * @brief Returns 1 if the simulation has reached its end point, 0 otherwise
  */
@@ -4127,6 +5270,20 @@ int engine_is_done(struct engine *e) {
   return !(e->ti_current < max_nr_timesteps);
 }
 
+/**
+ * @brief Cost of unskipping the tasks of a top-level cell, taken as its
+ * number of particles.
+ *
+ * @param map_data Pointer to the index of the cell.
+ * @param extra_data Pointer to an #engine.
+ */
+static double engine_unskip_cost(void *map_data, void *extra_data) {
+  const struct engine *e = (const struct engine *)extra_data;
+  const struct cell *c = &e->s->cells_top[*(int *)map_data];
+  return 1. + c->hydro.count + c->grav.count + c->stars.count +
+         c->black_holes.count;
+}
+
 /**
  * @brief Unskip all the tasks that act on active cells at this time.
  *
@@ -4152,10 +5309,21 @@ void engine_unskip(struct engine *e) {
   ProfilerStart(filename);
 #endif  // WITH_PROFILER
 
+  /* Only look at the cells that may be active now, if we know them. */
+  int *local_cells;
+  int num_cells;
+  if (s->active_cells_valid) {
+    local_cells = s->active_cells_buffer;
+    num_cells = space_active_cells_get(s, get_max_active_bin(e->ti_current),
+                                       local_cells);
+  } else {
+    local_cells = s->local_cells_with_tasks_top;
+    num_cells = s->nr_local_cells_with_tasks;
+  }
+
   /* Move the active local cells to the top of the list. */
-  int *local_cells = e->s->local_cells_with_tasks_top;
   int num_active_cells = 0;
-  for (int k = 0; k < s->nr_local_cells_with_tasks; k++) {
+  for (int k = 0; k < num_cells; k++) {
     struct cell *c = &s->cells_top[local_cells[k]];
 
     if ((with_hydro && cell_is_active_hydro(c, e)) ||
@@ -4172,9 +5340,30 @@ void engine_unskip(struct engine *e) {
     }
   }
 
+#ifdef SWIFT_DEBUG_CHECKS
+  /* Check that the lists did not miss any active cell. */
+  if (s->active_cells_valid) {
+    for (int k = 0; k < s->nr_local_cells_with_tasks; k++) {
+      const int cid = s->local_cells_with_tasks_top[k];
+      const struct cell *c = &s->cells_top[cid];
+      const integertime_t ti_next = cell_get_next_active_time(c, e);
+      if (ti_next == e->ti_current &&
+          s->active_cells_bin[cid] != get_max_active_bin(e->ti_current))
+        error("Active cell %d is in the list of bin %d instead of %d.", cid,
+              s->active_cells_bin[cid], get_max_active_bin(e->ti_current));
+      if (ti_next >= 0 && ti_next < e->ti_current)
+        error("Cell %d should have been active before.", cid);
+    }
+  }
+#endif
+
+  if (e->verbose)
+    message("Found %d active top-level cells out of %d candidates.",
+            num_active_cells, num_cells);
+
   /* Activate all the regular tasks */
-  threadpool_map(&e->threadpool, runner_do_unskip_mapper, local_cells,
-                 num_active_cells, sizeof(int), 1, e);
+  threadpool_map_weighted(&e->threadpool, runner_do_unskip_mapper, local_cells,
+                          num_active_cells, sizeof(int), engine_unskip_cost, e);
 
 #ifdef WITH_PROFILER
   ProfilerStop();
@@ -4507,13 +5696,71 @@ void engine_makeproxies(struct engine *e) {
 #endif
 }
 
+#ifdef WITH_MPI
+/**
+ * @brief Node of the top-level cell containing a position.
+ *
+ * @param s The #space.
+ * @param x The position.
+ */
+static int engine_node_of_position(const struct space *s, const double x[3]) {
+
+  int ind[3];
+  for (int k = 0; k < 3; k++) {
+    ind[k] = (int)(x[k] * s->iwidth[k]);
+    if (ind[k] < 0) ind[k] = 0;
+    if (ind[k] > s->cdim[k] - 1) ind[k] = s->cdim[k] - 1;
+  }
+  return s->cells_top[cell_getid(s->cdim, ind[0], ind[1], ind[2])].nodeID;
+}
+
+/**
+ * @brief Checks whether all the particles of all the nodes are in a cell of
+ * their node or of one of its proxies.
+ *
+ * The particles on the wrong node are then few and next to their cell, they
+ * are sent by the first rebuild as for any particle leaving its node.
+ *
+ * @param e The #engine.
+ */
+static int engine_particles_are_placed(const struct engine *e) {
+
+  const struct space *s = e->s;
+  long long misplaced = 0;
+
+#define ENGINE_COUNT_MISPLACED(array, count)                        \
+  for (size_t k = 0; k < count; k++) {                              \
+    const int node = engine_node_of_position(s, array[k].x);        \
+    if (node != e->nodeID && e->proxy_ind[node] < 0) misplaced++;   \
+  }
+
+  ENGINE_COUNT_MISPLACED(s->parts, s->nr_parts);
+  ENGINE_COUNT_MISPLACED(s->gparts, s->nr_gparts);
+  ENGINE_COUNT_MISPLACED(s->sparts, s->nr_sparts);
+  ENGINE_COUNT_MISPLACED(s->bparts, s->nr_bparts);
+#undef ENGINE_COUNT_MISPLACED
+
+  MPI_Allreduce(MPI_IN_PLACE, &misplaced, 1, MPI_LONG_LONG_INT, MPI_SUM,
+                MPI_COMM_WORLD);
+  if (e->verbose && e->nodeID == 0)
+    message("%lld particles are far from their node.", misplaced);
+  return (misplaced == 0);
+}
+#endif
+
 /**
  * @brief Split the underlying space into regions and assign to separate nodes.
  *
+ * When the ICs were read cell by cell (see io_get_ic_ranges()), the particles
+ * are already on their node and need not be redistributed.
+ *
  * @param e The #engine.
  * @param initial_partition structure defining the cell partition technique
+ *
+ * @return 1 if the particles must now be redistributed with
+ * engine_redistribute(), 0 if they are already on their nodes.
  */
-void engine_split(struct engine *e, struct partition *initial_partition) {
+int engine_split(struct engine *e, struct partition *initial_partition) {
 
 #ifdef WITH_MPI
   const ticks tic = getticks();
@@ -4522,6 +5769,9 @@ void engine_split(struct engine *e, struct partition *initial_partition) {
 
   /* Do the initial partition of the cells. */
   partition_initial_partition(initial_partition, e->nodeID, e->nr_nodes, s);
+  const int from_ics = (initial_partition->ic_celllist != NULL);
+  free(initial_partition->ic_celllist);
+  initial_partition->ic_celllist = NULL;
 
   /* Make the proxies. */
   engine_makeproxies(e);
@@ -4624,12 +5874,18 @@ void engine_split(struct engine *e, struct partition *initial_partition) {
                     s->nr_gparts, s->nr_sparts, s->nr_bparts, e->verbose);
 #endif
 
+  /* Particles read by cells only need a redistribution if some ended up far
+   * from their cell. */
+  const int redistribute = !from_ics || !engine_particles_are_placed(e);
+
   if (e->verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
 
+  return redistribute;
 #else
   error("SWIFT was not compiled with MPI support.");
+  return 0;
 #endif
 }
 
@@ -4746,6 +6002,12 @@ void engine_dump_snapshot(struct engine *e) {
   engine_collect_stars_counter(e);
 #endif
 
+  /* Only every n-th output is a full snapshot, the others are snipshots */
+  e->snapshot_is_snipshot =
+      (e->snapshot_output_count % e->snapshot_full_every) != 0;
+  if (e->snapshot_is_snipshot && e->verbose)
+    message("Writing a snipshot.");
+
 /* Dump... */
 #if defined(HAVE_HDF5)
 #if defined(WITH_MPI)
@@ -4773,6 +6035,19 @@ void engine_dump_snapshot(struct engine *e) {
             (float)clocks_diff(&time1, &time2), clocks_getunit());
 }
 
+/**
+ * @brief Waits for a snapshot being written asynchronously (if any) to be
+ * complete.
+ *
+ * @param e The #engine.
+ */
+void engine_wait_for_snapshot(struct engine *e) {
+
+#if defined(HAVE_HDF5) && !defined(WITH_MPI)
+  write_output_single_wait(e);
+#endif
+}
+
 /**
  * @brief Writes an index file with the current state of the engine
  *
@@ -4826,6 +6101,48 @@ cpu_set_t *engine_entry_affinity(void) {
 
   return &entry_affinity;
 }
+
+/**
+ * @brief Returns the ID of the last-level cache of a core, as reported by
+ * the kernel, or -1 if it is not known.
+ *
+ * @param cpu The core.
+ */
+static int engine_cpu_llc_id(int cpu) {
+
+  int level_max = 0, id = -1;
+  for (int index = 0;; index++) {
+    char path[PARSER_MAX_LINE_SIZE];
+    int level, cid;
+    char type[32];
+
+    /* Level and type of this cache, we ran out of them if we can't read it. */
+    sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu,
+            index);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) break;
+    const int nr_read = fscanf(file, "%d", &level);
+    fclose(file);
+    if (nr_read != 1) break;
+    sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu,
+            index);
+    if ((file = fopen(path, "r")) == NULL) continue;
+    if (fscanf(file, "%31s", type) != 1) type[0] = '\0';
+    fclose(file);
+    if (strcmp(type, "Instruction") == 0 || level <= level_max) continue;
+
+    sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/id", cpu,
+            index);
+    if ((file = fopen(path, "r")) == NULL) continue;
+    if (fscanf(file, "%d", &cid) == 1) {
+      level_max = level;
+      id = cid;
+    }
+    fclose(file);
+  }
+
+  return id;
+}
 #endif
 
 /**
@@ -4896,6 +6213,7 @@ void engine_unpin(void) {
  * @param starform The #star_formation model of this run.
  * @param chemistry The chemistry information.
  * @param fof_properties The #fof_props.
+ * @param lightcone_properties The #lightcone_props.
  */
 void engine_init(struct engine *e, struct space *s, struct swift_params *params,
                  long long Ngas, long long Ngparts, long long Nstars,
@@ -4907,12 +6225,13 @@ void engine_init(struct engine *e, struct space *s, struct swift_params *params,
                  const struct entropy_floor_properties *entropy_floor,
                  struct gravity_props *gravity, const struct stars_props *stars,
                  const struct black_holes_props *black_holes,
-                 const struct feedback_props *feedback, struct pm_mesh *mesh,
+                 struct feedback_props *feedback, struct pm_mesh *mesh,
                  const struct external_potential *potential,
                  struct cooling_function_data *cooling_func,
                  const struct star_formation *starform,
                  const struct chemistry_global_data *chemistry,
-                 struct fof_props *fof_properties) {
+                 struct fof_props *fof_properties,
+                 struct lightcone_props *lightcone_properties) {
 
   /* Clean-up everything */
   bzero(e, sizeof(struct engine));
@@ -4952,6 +6271,25 @@ void engine_init(struct engine *e, struct space *s, struct swift_params *params,
       parser_get_opt_param_int(params, "Snapshots:int_time_label_on", 0);
   e->snapshot_invoke_stf =
       parser_get_opt_param_int(params, "Snapshots:invoke_stf", 0);
+  e->snapshot_asynchronous =
+      parser_get_opt_param_int(params, "Snapshots:asynchronous", 0);
+  e->snapshot_async = NULL;
+  e->snapshot_aggregators_per_node =
+      parser_get_opt_param_int(params, "Snapshots:aggregators_per_node", 0);
+  if (e->snapshot_aggregators_per_node < 0)
+    error("Snapshots:aggregators_per_node must be positive or zero.");
+  e->snapshot_full_every =
+      parser_get_opt_param_int(params, "Snapshots:full_every", 1);
+  e->snipshot_subsample_fraction = parser_get_opt_param_float(
+      params, "Snapshots:snipshot_subsample_fraction", 1.f);
+  e->snipshot_density_threshold = parser_get_opt_param_float(
+      params, "Snapshots:snipshot_density_threshold", FLT_MAX);
+  e->snapshot_is_snipshot = 0;
+  if (e->snapshot_full_every < 1)
+    error("Snapshots:full_every must be strictly positive.");
+  if (e->snipshot_subsample_fraction < 0.f ||
+      e->snipshot_subsample_fraction > 1.f)
+    error("Snapshots:snipshot_subsample_fraction must be in [0, 1].");
   e->snapshot_units = (struct unit_system *)malloc(sizeof(struct unit_system));
   units_init_default(e->snapshot_units, params, "Snapshots", internal_units);
   e->snapshot_output_count = 0;
@@ -4986,6 +6324,7 @@ void engine_init(struct engine *e, struct space *s, struct swift_params *params,
   e->feedback_props = feedback;
   e->chemistry = chemistry;
   e->fof_properties = fof_properties;
+  e->lightcone_properties = lightcone_properties;
   e->parameter_file = params;
 #ifdef WITH_MPI
   e->cputime_last_step = 0;
@@ -5047,7 +6386,10 @@ void engine_init(struct engine *e, struct space *s, struct swift_params *params,
         params, "StructureFinding:scale_factor_first", 0.1);
     e->delta_time_stf =
         parser_get_opt_param_double(params, "StructureFinding:delta_time", -1.);
+    e->stf_asynchronous = parser_get_opt_param_int(
+        params, "StructureFinding:asynchronous", 0);
   }
+  e->stf_async = NULL;
 
   /* Initialise FoF calls frequency. */
   if (e->policy & engine_policy_fof) {
@@ -5104,12 +6446,22 @@ void engine_config(int restart, int fof, struct engine *e,
   e->step_props = engine_step_prop_none;
   e->links = NULL;
   e->nr_links = 0;
+  e->link_block_size = 1;
   e->file_stats = NULL;
   e->file_timesteps = NULL;
+  e->file_task_histograms = NULL;
+  e->file_memuse = NULL;
+  e->runners_mapping = 0;
+  e->runners_tasking = 0;
   e->sfh_logger = NULL;
   e->verbose = verbose;
   e->wallclock_time = 0.f;
   e->restart_dump = 0;
+  e->restart_asynchronous = 0;
+  e->restart_async = NULL;
+  e->restart_incremental = 0;
+  e->restart_direct_io = 0;
+  e->restart_compress = 0;
   e->restart_file = restart_file;
   e->restart_next = 0;
   e->restart_dt = 0;
@@ -5133,6 +6485,16 @@ void engine_config(int restart, int fof, struct engine *e,
     message("Number of task queues set to %d", nr_queues);
   e->s->nr_queues = nr_queues;
 
+  /* Do we map the queues and particles to NUMA domains? */
+  const int numa_aware =
+      parser_get_opt_param_int(params, "Scheduler:numa_aware", 0);
+  int *core_domain = NULL;
+
+  /* Do we group the queues by last-level cache? */
+  const int cache_aware =
+      parser_get_opt_param_int(params, "Scheduler:cache_aware", 0);
+  int *core_group = NULL;
+
 /* Deal with affinity. For now, just figure out the number of cores. */
 #if defined(HAVE_SETAFFINITY)
   const int nr_cores = sysconf(_SC_NPROCESSORS_ONLN);
@@ -5169,7 +6531,27 @@ void engine_config(int restart, int fof, struct engine *e,
     }
 
 #if defined(HAVE_LIBNUMA) && defined(_GNU_SOURCE)
-    if ((e->policy & engine_policy_cputight) != engine_policy_cputight) {
+    if (numa_aware && numa_available() >= 0) {
+      if (nodeID == 0) message("grouping queues by NUMA domain");
+
+      /* Order the cores by NUMA node, keeping the cpuid order within each
+       * node, so that consecutive queues live on the same socket. */
+      core_domain = (int *)malloc(nr_affinity_cores * sizeof(int));
+      for (int i = 0; i < nr_affinity_cores; i++)
+        core_domain[i] = numa_node_of_cpu(cpuid[i]);
+      for (int i = 1; i < nr_affinity_cores; i++) {
+        const int c = cpuid[i], d = core_domain[i];
+        int j = i;
+        for (; j > 0 && core_domain[j - 1] > d; j--) {
+          cpuid[j] = cpuid[j - 1];
+          core_domain[j] = core_domain[j - 1];
+        }
+        cpuid[j] = c;
+        core_domain[j] = d;
+      }
+
+    } else if ((e->policy & engine_policy_cputight) !=
+               engine_policy_cputight) {
 
       if (numa_available() >= 0) {
         if (nodeID == 0) message("prefer NUMA-distant CPUs");
@@ -5224,6 +6606,31 @@ void engine_config(int restart, int fof, struct engine *e,
       }
     }
 #endif
+
+    if (cache_aware) {
+      if (nodeID == 0) message("grouping queues by last-level cache");
+
+      /* Order the cores by last-level cache, within their NUMA domain if
+       * we group by those too, so that consecutive queues share a cache. */
+      core_group = (int *)malloc(nr_affinity_cores * sizeof(int));
+      for (int i = 0; i < nr_affinity_cores; i++)
+        core_group[i] = engine_cpu_llc_id(cpuid[i]);
+      for (int i = 1; i < nr_affinity_cores; i++) {
+        const int c = cpuid[i], g = core_group[i];
+        const int d = (core_domain != NULL) ? core_domain[i] : 0;
+        int j = i;
+        for (; j > 0; j--) {
+          const int dj = (core_domain != NULL) ? core_domain[j - 1] : 0;
+          if (dj < d || (dj == d && core_group[j - 1] <= g)) break;
+          cpuid[j] = cpuid[j - 1];
+          core_group[j] = core_group[j - 1];
+          if (core_domain != NULL) core_domain[j] = core_domain[j - 1];
+        }
+        cpuid[j] = c;
+        core_group[j] = g;
+        if (core_domain != NULL) core_domain[j] = d;
+      }
+    }
   } else {
     if (nodeID == 0) message("no processor affinity used");
 
@@ -5236,6 +6643,18 @@ void engine_config(int restart, int fof, struct engine *e,
   if (with_aff) engine_unpin();
 #endif
 
+  if (numa_aware &&
+      (core_domain == NULL ||
+       (e->policy & engine_policy_setaffinity) != engine_policy_setaffinity))
+    error(
+        "Scheduler:numa_aware requires thread pinning (-a) and SWIFT compiled "
+        "with libnuma.");
+
+  if (cache_aware &&
+      (core_group == NULL ||
+       (e->policy & engine_policy_setaffinity) != engine_policy_setaffinity))
+    error("Scheduler:cache_aware requires thread pinning (-a).");
+
   if (with_aff && nodeID == 0) {
 #ifdef HAVE_SETAFFINITY
 #ifdef WITH_MPI
@@ -5262,6 +6681,30 @@ void engine_config(int restart, int fof, struct engine *e,
 #endif
   }
 
+  /* Do we analyse the task graph of each step? Not by default. */
+  e->step_analysis =
+      parser_get_opt_param_int(params, "Scheduler:step_analysis", 0);
+  bzero(&e->last_analysis, sizeof(struct task_step_analysis));
+
+  /* No time spent in any phase yet. */
+  bzero(e->phase_ticks, sizeof(e->phase_ticks));
+
+  /* Every how many steps do we write the histograms of the task timings?
+   * Not collected by default. */
+  e->task_histograms_steps =
+      fof ? 0
+          : parser_get_opt_param_int(params, "Scheduler:task_histograms_steps",
+                                     0);
+
+  /* Do we write the task dumps in the compact binary format, and for which
+   * ranks? */
+  e->task_dumps_binary =
+      parser_get_opt_param_int(params, "Scheduler:task_dumps_binary", 0);
+  e->task_dumps_rank_stride =
+      parser_get_opt_param_int(params, "Scheduler:task_dumps_rank_stride", 1);
+  if (e->task_dumps_rank_stride < 1)
+    error("Scheduler:task_dumps_rank_stride must be at least 1.");
+
   /* Open some global files */
   if (!fof && e->nodeID == 0) {
 
@@ -5326,13 +6769,50 @@ void engine_config(int restart, int fof, struct engine *e,
 
       fprintf(
           e->file_timesteps,
-          "# %6s %14s %12s %12s %14s %9s %12s %12s %12s %12s %16s [%s] %6s\n",
+          "# %6s %14s %12s %12s %14s %9s %12s %12s %12s %12s %16s [%s] %6s",
           "Step", "Time", "Scale-factor", "Redshift", "Time-step", "Time-bins",
           "Updates", "g-Updates", "s-Updates", "b-Updates", "Wall-clock time",
           clocks_getunit(), "Props");
+      if (e->step_analysis)
+        profiler_write_step_analysis_header(e->file_timesteps);
+      fprintf(e->file_timesteps, "\n");
       fflush(e->file_timesteps);
     }
 
+    char memusefileName[200] = "";
+    sprintf(memusefileName, "memuse_categories_%d.txt", nr_nodes * nr_threads);
+    e->file_memuse = fopen(memusefileName, mode);
+    if (e->file_memuse == NULL)
+      error("Failed to open the file '%s'.", memusefileName);
+    if (!restart) {
+      fprintf(e->file_memuse,
+              "# Memory use per category at each rebuild, maximum over the "
+              "ranks [MB]\n");
+      fprintf(e->file_memuse, "# %6s %14s", "Step", "Time");
+      for (int k = 0; k < memuse_category_count; k++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%s", memuse_category_names[k]);
+        fprintf(e->file_memuse, " %14s", name);
+        snprintf(name, sizeof(name), "%s_peak", memuse_category_names[k]);
+        fprintf(e->file_memuse, " %14s", name);
+      }
+      fprintf(e->file_memuse, "\n");
+      fflush(e->file_memuse);
+    }
+
+    if (e->task_histograms_steps > 0) {
+      char histogramsfileName[200] = "";
+      sprintf(histogramsfileName, "task_histograms_%d.txt",
+              nr_nodes * nr_threads);
+      e->file_task_histograms = fopen(histogramsfileName, mode);
+      if (e->file_task_histograms == NULL)
+        error("Failed to open the file '%s'.", histogramsfileName);
+      if (!restart) {
+        task_histograms_write_header(e->file_task_histograms);
+        fflush(e->file_task_histograms);
+      }
+    }
+
     /* Initialize the SFH logger if running with star formation */
     if (e->policy & engine_policy_star_formation) {
       e->sfh_logger = fopen("SFR.txt", mode);
@@ -5344,6 +6824,15 @@ void engine_config(int restart, int fof, struct engine *e,
     }
   }
 
+  /* Periodic checks of the gravity accuracy */
+  gravity_accuracy_monitor_init(&e->gravity_accuracy, params, e, restart);
+
+  /* Pick the kick and time-step kernels compiled for our policies */
+  e->runner_variant =
+      ((e->policy & engine_policy_cosmology) ? runner_variant_cosmology : 0) |
+      ((e->policy & engine_policy_cooling) ? runner_variant_cooling : 0) |
+      ((e->policy & engine_policy_limiter) ? runner_variant_limiter : 0);
+
   /* Print policy */
   engine_print_policy(e);
 
@@ -5533,6 +7022,20 @@ void engine_config(int restart, int fof, struct engine *e,
           "activated at runtime (Use --velociraptor).");
     }
 
+#if defined(WITH_MPI) || !defined(HAVE_HDF5)
+    if (e->snapshot_asynchronous)
+      error(
+          "Asynchronous snapshots are only supported by the non-MPI "
+          "single-file writer.");
+#endif
+
+#ifdef WITH_MPI
+    if (e->stf_asynchronous)
+      error(
+          "Asynchronous VELOCIraptor calls are not supported in MPI runs as "
+          "VELOCIraptor's communications would interleave with ours.");
+#endif
+
     /* Whether restarts are enabled. Yes by default. Can be changed on restart.
      */
     e->restart_dump = parser_get_opt_param_int(params, "Restarts:enable", 1);
@@ -5544,6 +7047,30 @@ void engine_config(int restart, int fof, struct engine *e,
      * on restart. */
     e->restart_onexit = parser_get_opt_param_int(params, "Restarts:onexit", 0);
 
+    /* Whether restarts are written by a separate thread. Can be changed on
+     * restart. */
+    e->restart_asynchronous =
+        parser_get_opt_param_int(params, "Restarts:asynchronous", 0);
+    e->restart_async = NULL;
+
+    /* Number of incremental dumps after each complete one. Can be changed on
+     * restart. */
+    e->restart_incremental =
+        parser_get_opt_param_int(params, "Restarts:incremental", 0);
+    if (e->restart_incremental < 0)
+      error("Restarts:incremental must be positive or zero.");
+
+    /* Whether to write the particles in parallel using direct i/o. Can be
+     * changed on restart. */
+    e->restart_direct_io =
+        parser_get_opt_param_int(params, "Restarts:direct_io", 0);
+
+    /* Whether to compress the particles. Can be changed on restart. */
+    e->restart_compress =
+        parser_get_opt_param_int(params, "Restarts:compress", 0);
+    if (e->restart_compress && e->restart_incremental > 0)
+      error("Restarts:compress cannot be used with Restarts:incremental.");
+
     /* Hours between restart dumps. Can be changed on restart. */
     float dhours =
         parser_get_opt_param_float(params, "Restarts:delta_hours", 6.0);
@@ -5608,9 +7135,191 @@ void engine_config(int restart, int fof, struct engine *e,
   e->links_per_tasks =
       parser_get_opt_param_int(params, "Scheduler:links_per_tasks", 25);
 
+  /* Type of task queues to use */
+  char queue_type[PARSER_MAX_LINE_SIZE];
+  parser_get_opt_param_string(params, "Scheduler:queue_type", queue_type,
+                              "heap");
+  unsigned int sched_flags = (e->policy & scheduler_flag_steal);
+  if (strcmp(queue_type, "deque") == 0) {
+    sched_flags |= scheduler_flag_deques;
+    if (e->nodeID == 0) message("Using lock-free work-stealing task queues.");
+  } else if (strcmp(queue_type, "heap") != 0) {
+    error(
+        "Invalid value for Scheduler:queue_type ('%s'), must be 'heap' or "
+        "'deque'.",
+        queue_type);
+  }
+
+  /* Do we only send the fields used by the foreign hydro loops? */
+  if (parser_get_opt_param_int(params, "Scheduler:compact_hydro_exchange", 0)) {
+    if (!hydro_has_compact_mpi)
+      error(
+          "The hydro scheme '%s' does not support "
+          "Scheduler:compact_hydro_exchange.",
+          SPH_IMPLEMENTATION);
+    sched_flags |= scheduler_flag_compact_hydro;
+    if (e->nodeID == 0 && nr_nodes > 1)
+      message("Exchanging compact foreign hydro particles.");
+  }
+
+  /* Do we gather the top-level multipoles rather than all-reducing them? */
+  if (parser_get_opt_param_int(params, "Scheduler:gather_top_multipoles", 0)) {
+    sched_flags |= scheduler_flag_gather_multipoles;
+    if (e->nodeID == 0 && nr_nodes > 1)
+      message("Gathering the top-level multipoles.");
+  }
+
+  /* Do we leave the MPI requests to a dedicated progress thread? */
+  if (parser_get_opt_param_int(params, "Scheduler:mpi_progress_thread", 0) &&
+      nr_nodes > 1) {
+    sched_flags |= scheduler_flag_mpi_progress;
+    if (e->nodeID == 0)
+      message("Progressing the MPI communications in a dedicated thread.");
+  }
+
+  /* Do we re-use the requests of the particle messages between rebuilds?
+   * Off by default until validated on multi-rank runs. */
+  if (parser_get_opt_param_int(params, "Scheduler:mpi_persistent_requests",
+                               0) &&
+      nr_nodes > 1)
+    sched_flags |= scheduler_flag_mpi_persistent;
+
+  /* Do we put the compact hydro particles directly in the foreign buffers? */
+  if (parser_get_opt_param_int(params, "Scheduler:mpi_rma_exchange", 0) &&
+      nr_nodes > 1) {
+    if (!(sched_flags & scheduler_flag_compact_hydro))
+      error(
+          "Scheduler:mpi_rma_exchange requires "
+          "Scheduler:compact_hydro_exchange.");
+    sched_flags |= scheduler_flag_mpi_rma;
+    if (e->nodeID == 0)
+      message("Using one-sided MPI puts for the foreign hydro particles.");
+  }
+
+  /* Do we read the hydro particles of the ranks on the same node in place?
+   * Only the hydro loops know how to leave the foreign particles alone. */
+  if (parser_get_opt_param_int(params, "Scheduler:mpi_shared_memory", 0) &&
+      nr_nodes > 1) {
+#ifndef HAVE_SHM_OPEN
+    error("Scheduler:mpi_shared_memory requires POSIX shared memory.");
+#endif
+    if (sched_flags & scheduler_flag_compact_hydro)
+      error(
+          "Scheduler:mpi_shared_memory cannot be combined with "
+          "Scheduler:compact_hydro_exchange.");
+    if (e->policy & (engine_policy_limiter | engine_policy_star_formation |
+                     engine_policy_feedback | engine_policy_black_holes))
+      error(
+          "Scheduler:mpi_shared_memory is not supported with the time-step "
+          "limiter, star formation, feedback or black holes.");
+    sched_flags |= scheduler_flag_mpi_shm;
+    if (e->nodeID == 0)
+      message("Reading the hydro particles of same-node ranks in place.");
+  }
+
+  /* Do we only send the #gpart of the foreign gravity pairs that are not
+   * done with multipoles? */
+  if (parser_get_opt_param_int(params, "Scheduler:split_foreign_gravity", 0) &&
+      nr_nodes > 1) {
+    sched_flags |= scheduler_flag_split_foreign_grav;
+    if (e->nodeID == 0)
+      message("Splitting the foreign gravity pairs down to their M-M "
+              "interactions.");
+  }
+
+  /* Do we run the sends and the work leading to them first? */
+  if (parser_get_opt_param_int(params, "Scheduler:send_priority", 0) &&
+      nr_nodes > 1) {
+    sched_flags |= scheduler_flag_send_priority;
+    if (e->nodeID == 0)
+      message("Giving the sends and the tasks they depend on priority.");
+  }
+
+  /* Do we steal from the most loaded queues rather than at random? */
+  char steal_policy[PARSER_MAX_LINE_SIZE];
+  parser_get_opt_param_string(params, "Scheduler:steal_policy", steal_policy,
+                              "random");
+  if (strcmp(steal_policy, "heaviest") == 0) {
+    sched_flags |= scheduler_flag_steal_heaviest;
+    if (e->nodeID == 0) message("Stealing from the most loaded queues.");
+  } else if (strcmp(steal_policy, "random") != 0) {
+    error(
+        "Invalid value for Scheduler:steal_policy ('%s'), must be 'random' or "
+        "'heaviest'.",
+        steal_policy);
+  }
+
+  /* Do we do the two half kicks in the time-step tasks? Nothing may happen
+   * to the particles between them. */
+  if (parser_get_opt_param_int(params, "Scheduler:fuse_kicks", 0)) {
+    if (e->policy & (engine_policy_limiter | engine_policy_star_formation |
+                     engine_policy_feedback | engine_policy_black_holes))
+      error(
+          "Scheduler:fuse_kicks is not supported with the time-step "
+          "limiter, star formation, feedback or black holes.");
+    sched_flags |= scheduler_flag_fuse_kicks;
+    if (e->nodeID == 0) message("Doing the two half kicks in the time-steps.");
+  }
+
+  /* Do we correct the task weights with the measured run times? */
+  if (parser_get_opt_param_int(params, "Scheduler:adaptive_weights", 0)) {
+    sched_flags |= scheduler_flag_adaptive_weights;
+    if (e->nodeID == 0)
+      message("Weighting the tasks with their measured run times.");
+  }
+
+  /* Can we re-use the tasks across rebuilds? The construction of the tasks
+   * depends on the foreign cells and the multipoles otherwise. */
+  if (e->s->reuse_task_graph) {
+    if (nr_nodes > 1 || (e->policy & engine_policy_self_gravity)) {
+      if (e->nodeID == 0)
+        message(
+            "WARNING: Scheduler:reuse_task_graph is not supported with MPI or "
+            "self-gravity, ignoring it.");
+      e->s->reuse_task_graph = 0;
+    } else if (e->nodeID == 0) {
+      message("Re-using the tasks across rebuilds of unchanged cell trees.");
+    }
+  }
+
+  /* Can we keep the trees of the cells whose particles did not move much?
+   * This requires the particles to stay on their rank and in their cell. */
+  if (e->s->local_rebuild) {
+    if (nr_nodes > 1 || (e->policy & engine_policy_self_gravity) ||
+        (e->policy & engine_policy_star_formation)) {
+      if (e->nodeID == 0)
+        message(
+            "WARNING: Scheduler:local_rebuild is not supported with MPI, "
+            "self-gravity or star formation, ignoring it.");
+      e->s->local_rebuild = 0;
+    } else if (e->nodeID == 0) {
+      message("Only splitting again the cells that need it at rebuild time.");
+    }
+  }
+
+  /* Do we tune the split sizes from the measured task costs? The tuning
+   * changes the trees of all the cells, so we cannot only split again some
+   * of them. */
+  if (e->s->adaptive_split) {
+    if (e->nodeID == 0)
+      message("Tuning the split sizes of the top-level cells from the costs "
+              "of their tasks.");
+    if (e->s->local_rebuild) {
+      if (e->nodeID == 0)
+        message(
+            "WARNING: Scheduler:local_rebuild is not supported with "
+            "Scheduler:adaptive_split, ignoring it.");
+      e->s->local_rebuild = 0;
+    }
+  }
+
   /* Init the scheduler. */
-  scheduler_init(&e->sched, e->s, maxtasks, nr_queues,
-                 (e->policy & scheduler_flag_steal), e->nodeID, &e->threadpool);
+  scheduler_init(&e->sched, e->s, maxtasks, nr_queues, sched_flags, e->nodeID,
+                 &e->threadpool);
+
+#ifdef WITH_MPI
+  if (sched_flags & scheduler_flag_mpi_shm) engine_init_shm(e);
+#endif
 
   /* Maximum size of MPI task messages, in KB, that should not be buffered,
    * that is sent using MPI_Issend, not MPI_Isend. 4Mb by default. Can be
@@ -5619,6 +7328,37 @@ void engine_config(int restart, int fof, struct engine *e,
   e->sched.mpi_message_limit =
       parser_get_opt_param_int(params, "Scheduler:mpi_message_limit", 4) * 1024;
 
+  /* Maximum size of the messages, in KB, into which the end-of-step messages
+   * towards a given node get grouped. Not grouped by default. */
+  e->sched.mpi_aggregate_limit =
+      parser_get_opt_param_int(params, "Scheduler:mpi_aggregate_limit", 0) *
+      1024;
+
+  /* Model cost below which the small per-cell tasks are run straight away
+   * by the runner that unlocked them. Never by default. */
+  e->sched.tiny_task_cost =
+      parser_get_opt_param_float(params, "Scheduler:tiny_task_cost", 0.f);
+
+  /* Number of interactions above which a hydro sub-task is split over the
+   * progeny of its cells by the runner that picks it, and maximal number of
+   * tasks spawned that way per step. Never by default. */
+  scheduler_init_spawn(
+      &e->sched,
+      parser_get_opt_param_int(params, "Scheduler:dynamic_split_size", 0),
+      parser_get_opt_param_int(params, "Scheduler:dynamic_split_max_tasks",
+                               10000));
+
+#ifdef SWIFT_TASK_COUNTERS
+  /* Which performance counters do we sample around the tasks? */
+  char task_counters[PARSER_MAX_LINE_SIZE];
+  parser_get_opt_param_string(params, "Scheduler:task_counters", task_counters,
+                              "cycles,instructions,llc_misses,ref_cycles");
+  task_counters_init(task_counters, e->nodeID == 0);
+  if (e->nodeID == 0)
+    message("Sampling %d performance counters around the tasks.",
+            task_counters_count());
+#endif
+
   /* Allocate and init the threads. */
   if (swift_memalign("runners", (void **)&e->runners, SWIFT_CACHE_ALIGNMENT,
                      e->nr_threads * sizeof(struct runner)) != 0)
@@ -5640,9 +7380,12 @@ void engine_config(int restart, int fof, struct engine *e,
       int coreid = k % nr_affinity_cores;
       e->runners[k].cpuid = cpuid[coreid];
 
-      if (nr_queues < e->nr_threads)
-        e->runners[k].qid = cpuid[coreid] * nr_queues / nr_affinity_cores;
-      else
+      if (nr_queues < e->nr_threads) {
+        if (core_domain != NULL || core_group != NULL)
+          e->runners[k].qid = coreid * nr_queues / nr_affinity_cores;
+        else
+          e->runners[k].qid = cpuid[coreid] * nr_queues / nr_affinity_cores;
+      } else
         e->runners[k].qid = k;
 
       /* Set the cpu mask to zero | e->id. */
@@ -5662,11 +7405,43 @@ void engine_config(int restart, int fof, struct engine *e,
       e->runners[k].qid = k * nr_queues / e->nr_threads;
     }
 
-    /* Allocate particle caches. */
+    /* Allocate particle caches, large enough for the largest leaves. */
+    const int cache_count =
+        e->s->adaptive_split ? space_splitsize * space_split_tuning_max_factor
+                             : space_splitsize;
     e->runners[k].ci_gravity_cache.count = 0;
     e->runners[k].cj_gravity_cache.count = 0;
-    gravity_cache_init(&e->runners[k].ci_gravity_cache, space_splitsize);
-    gravity_cache_init(&e->runners[k].cj_gravity_cache, space_splitsize);
+    gravity_cache_init(&e->runners[k].ci_gravity_cache, cache_count);
+    gravity_cache_init(&e->runners[k].cj_gravity_cache, cache_count);
+
+    /* Allocate the FOF caches */
+    e->runners[k].ci_fof_cache.count = 0;
+    e->runners[k].cj_fof_cache.count = 0;
+    if (e->policy & engine_policy_fof) {
+      fof_cache_init(&e->runners[k].ci_fof_cache, space_splitsize);
+      fof_cache_init(&e->runners[k].cj_fof_cache, space_splitsize);
+    }
+
+    /* The sort arena only grows when the first sorts are needed */
+    e->runners[k].sort_arena.chunks = NULL;
+    e->runners[k].sort_arena.capacity = 0;
+    e->runners[k].sort_arena.used = 0;
+
+    /* The neighbour lists share the memory budget evenly (none without
+     * hydro, e.g. in the stand-alone FOF tool) */
+    const double neighbour_lists_max_MB =
+        e->hydro_properties != NULL
+            ? e->hydro_properties->neighbour_lists_max_MB
+            : 0.;
+    neighbour_list_arena_init(
+        &e->runners[k].neighbour_lists,
+        (size_t)(neighbour_lists_max_MB * 1024. * 1024. / e->nr_threads));
+
+    /* The histograms of the task timings */
+    if (e->task_histograms_steps > 0)
+      task_histograms_init(&e->runners[k].histograms);
+    else
+      e->runners[k].histograms.entries = NULL;
 #ifdef WITH_VECTORIZATION
     e->runners[k].ci_cache.count = 0;
     e->runners[k].cj_cache.count = 0;
@@ -5684,6 +7459,33 @@ void engine_config(int restart, int fof, struct engine *e,
     }
   }
 
+#if defined(HAVE_SETAFFINITY)
+  /* Record the NUMA domain of each queue. The queues without a runner take
+   * the domain of the cores they would have been given. */
+  if (core_domain != NULL) {
+    int *queue_domain = (int *)malloc(nr_queues * sizeof(int));
+    if (queue_domain == NULL) error("Failed to allocate queue domains.");
+    for (int q = 0; q < nr_queues; q++)
+      queue_domain[q] = core_domain[(size_t)q * nr_affinity_cores / nr_queues];
+    for (int k = 0; k < e->nr_threads; k++)
+      queue_domain[e->runners[k].qid] = core_domain[k % nr_affinity_cores];
+    e->sched.queue_domain = queue_domain;
+    free(core_domain);
+  }
+
+  /* Same for the last-level caches. */
+  if (core_group != NULL) {
+    int *queue_group = (int *)malloc(nr_queues * sizeof(int));
+    if (queue_group == NULL) error("Failed to allocate queue groups.");
+    for (int q = 0; q < nr_queues; q++)
+      queue_group[q] = core_group[(size_t)q * nr_affinity_cores / nr_queues];
+    for (int k = 0; k < e->nr_threads; k++)
+      queue_group[e->runners[k].qid] = core_group[k % nr_affinity_cores];
+    e->sched.queue_group = queue_group;
+    free(core_group);
+  }
+#endif
+
 #ifdef WITH_LOGGER
   /* Write the particle logger header */
   logger_write_file_header(e->logger, e);
@@ -5704,6 +7506,10 @@ void engine_config(int restart, int fof, struct engine *e,
 
   /* Wait for the runner threads to be in place. */
   swift_barrier_wait(&e->wait_barrier);
+
+  /* From now on the runners also do the work of the threadpool between the
+   * task launches, instead of a second set of threads. */
+  threadpool_share_threads(&e->threadpool, engine_launch_mappers, e);
 }
 
 /**
@@ -6174,6 +7980,12 @@ void engine_recompute_displacement_constraint(struct engine *e) {
  * @param fof Was this a stand-alone FOF run?
  */
 void engine_clean(struct engine *e, const int fof) {
+  /* Complete any snapshot, restart file or VELOCIraptor call still in
+   * flight. */
+  engine_wait_for_snapshot(e);
+  restart_write_wait(e);
+  velociraptor_wait(e);
+
   /* Start by telling the runners to stop. */
   e->step_props = engine_step_prop_done;
   swift_barrier_wait(&e->run_barrier);
@@ -6188,14 +8000,25 @@ void engine_clean(struct engine *e, const int fof) {
 #endif
     gravity_cache_clean(&e->runners[k].ci_gravity_cache);
     gravity_cache_clean(&e->runners[k].cj_gravity_cache);
+    fof_cache_clean(&e->runners[k].ci_fof_cache);
+    fof_cache_clean(&e->runners[k].cj_fof_cache);
+    sort_arena_clean(&e->runners[k].sort_arena);
+    neighbour_list_arena_clean(&e->runners[k].neighbour_lists);
+    task_histograms_clean(&e->runners[k].histograms);
   }
   swift_free("runners", e->runners);
+
+  /* The threadpool can no longer borrow the runners. */
+  threadpool_share_threads(&e->threadpool, NULL, NULL);
   free(e->snapshot_units);
 
   output_list_clean(&e->output_list_snapshots);
   output_list_clean(&e->output_list_stats);
   output_list_clean(&e->output_list_stf);
 
+  if (e->policy & engine_policy_fof) free(e->fof_properties->ti_cell_searched);
+  lightcone_clean(e->lightcone_properties);
+
   swift_free("links", e->links);
 #if defined(WITH_LOGGER)
   logger_clean(e->logger);
@@ -6205,10 +8028,14 @@ void engine_clean(struct engine *e, const int fof) {
   space_clean(e->s);
   threadpool_clean(&e->threadpool);
 
+  if (!fof) gravity_accuracy_monitor_clean(&e->gravity_accuracy);
+
   /* Close files */
   if (!fof && e->nodeID == 0) {
     fclose(e->file_timesteps);
     fclose(e->file_stats);
+    if (e->file_task_histograms != NULL) fclose(e->file_task_histograms);
+    if (e->file_memuse != NULL) fclose(e->file_memuse);
 
     if (e->policy & engine_policy_star_formation) {
       fclose(e->sfh_logger);
@@ -6255,6 +8082,7 @@ void engine_struct_dump(struct engine *e, FILE *stream) {
   black_holes_struct_dump(e->black_holes_properties, stream);
   chemistry_struct_dump(e->chemistry, stream);
   fof_struct_dump(e->fof_properties, stream);
+  lightcone_struct_dump(e->lightcone_properties, stream);
   parser_struct_dump(e->parameter_file, stream);
   if (e->output_list_snapshots)
     output_list_struct_dump(e->output_list_snapshots, stream);
@@ -6377,6 +8205,11 @@ void engine_struct_restore(struct engine *e, FILE *stream) {
   fof_struct_restore(fof_props, stream);
   e->fof_properties = fof_props;
 
+  struct lightcone_props *lightcone_props =
+      (struct lightcone_props *)malloc(sizeof(struct lightcone_props));
+  lightcone_struct_restore(lightcone_props, stream);
+  e->lightcone_properties = lightcone_props;
+
   struct swift_params *parameter_file =
       (struct swift_params *)malloc(sizeof(struct swift_params));
   parser_struct_restore(parameter_file, stream);
@@ -6407,6 +8240,12 @@ void engine_struct_restore(struct engine *e, FILE *stream) {
   eos_init(&eos, e->physical_constants, e->snapshot_units, e->parameter_file);
 #endif
 
+  /* No snapshot, restart file or VELOCIraptor call can be in flight in a
+   * freshly restored engine */
+  e->snapshot_async = NULL;
+  e->restart_async = NULL;
+  e->stf_async = NULL;
+
   /* Want to force a rebuild before using this engine. Wait to repartition.*/
   e->forcerebuild = 1;
   e->forcerepart = 0;
@@ -6466,13 +8305,27 @@ void engine_activate_fof_tasks(struct engine *e) {
   const int nr_tasks = s->nr_tasks;
   struct task *tasks = s->tasks;
 
+  /* In incremental mode, only some top-level cells need to be searched */
+  const char *cell_needs_search = e->fof_properties->cell_needs_search;
+  const struct cell *cells_top = e->s->cells_top;
+
   for (int k = 0; k < nr_tasks; k++) {
 
     struct task *t = &tasks[k];
 
-    if (t->type == task_type_fof_self || t->type == task_type_fof_pair)
+    if (t->type == task_type_fof_self || t->type == task_type_fof_pair) {
+
+      if (cell_needs_search != NULL) {
+        const int cid = t->ci->top - cells_top;
+        const int cjd = (t->cj != NULL) ? t->cj->top - cells_top : cid;
+        if (!cell_needs_search[cid] && !cell_needs_search[cjd]) {
+          t->skip = 1;
+          continue;
+        }
+      }
+
       scheduler_activate(s, t);
-    else
+    } else
       t->skip = 1;
   }
 
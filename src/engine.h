@@ -40,7 +40,9 @@
 #include "collectgroup.h"
 #include "cooling_struct.h"
 #include "dump.h"
+#include "gravity.h"
 #include "gravity_properties.h"
+#include "lightcone.h"
 #include "mesh_gravity.h"
 #include "parser.h"
 #include "partition.h"
@@ -49,6 +51,7 @@
 #include "scheduler.h"
 #include "space.h"
 #include "star_formation_logger.h"
+#include "statistics.h"
 #include "task.h"
 #include "units.h"
 #include "velociraptor_interface.h"
@@ -101,6 +104,18 @@ enum engine_step_properties {
   engine_step_prop_done = (1 << 9)
 };
 
+/**
+ * @brief The phases of the run whose time is accumulated by the engine.
+ */
+enum engine_phase {
+  engine_phase_rebuild = 0,
+  engine_phase_tasks,
+  engine_phase_comms,
+  engine_phase_io,
+  engine_phase_count
+};
+extern const char *engine_phase_names[engine_phase_count];
+
 /* Some constants */
 #define engine_maxproxies 64
 #define engine_tasksreweight 1
@@ -140,6 +155,10 @@ struct engine {
   /* The running policy. */
   int policy;
 
+  /* The variant of the kick and time-step kernels for this policy (see
+   * #runner_variant) */
+  int runner_variant;
+
   /* The task scheduler. */
   struct scheduler sched;
 
@@ -292,6 +311,27 @@ struct engine {
   struct unit_system *snapshot_units;
   int snapshot_output_count;
 
+  /* Are snapshots written by a separate thread while the run continues? */
+  int snapshot_asynchronous;
+
+  /* The snapshot currently being written asynchronously (if any) */
+  struct io_async_snapshot *snapshot_async;
+
+  /* Number of ranks per node writing the data of the parallel snapshots */
+  int snapshot_aggregators_per_node;
+
+  /* Write only every n-th snapshot in full, the others as snipshots */
+  int snapshot_full_every;
+
+  /* Fraction of the particles written in the snipshots (picked by ID) */
+  float snipshot_subsample_fraction;
+
+  /* Comoving density above which all the gas goes in the snipshots */
+  float snipshot_density_threshold;
+
+  /* Is the output currently being written a snipshot? */
+  int snapshot_is_snipshot;
+
   /* Structure finding information */
   double a_first_stf_output;
   double time_first_stf_output;
@@ -307,6 +347,12 @@ struct engine {
   char stf_base_name[PARSER_MAX_LINE_SIZE];
   int stf_output_count;
 
+  /* Does VELOCIraptor run in a separate thread while the run continues? */
+  int stf_asynchronous;
+
+  /* The VELOCIraptor call currently running asynchronously (if any) */
+  struct velociraptor_async *stf_async;
+
   /* FoF black holes seeding information */
   double a_first_fof_call;
   double time_first_fof_call;
@@ -335,16 +381,52 @@ struct engine {
   /* File handle for the timesteps information */
   FILE *file_timesteps;
 
+  /* Time spent in each phase since the start of the run */
+  ticks phase_ticks[engine_phase_count];
+
+  /* Do we analyse the task graph of each step? */
+  int step_analysis;
+
+  /* The analysis of the task graph of the last step */
+  struct task_step_analysis last_analysis;
+
+  /* Every how many steps are the histograms of the task timings written? */
+  int task_histograms_steps;
+
+  /* Are the task dumps written in the binary format? */
+  int task_dumps_binary;
+
+  /* Only one rank in this many writes its tasks to the binary dumps */
+  int task_dumps_rank_stride;
+
+  /* File handle for the histograms of the task timings */
+  FILE *file_task_histograms;
+
+  /* Periodic checks of the gravity accelerations against exact ones */
+  struct gravity_accuracy_monitor gravity_accuracy;
+
+  /* File handle for the memory use per category */
+  FILE *file_memuse;
+
   /* File handle for the SFH logger file */
   FILE *sfh_logger;
 
   /* The current step number. */
   int step;
 
+  /* Number of launches so far, used to spot the stale per-launch data. */
+  int launch_generation;
+
   /* Data for the threads' barrier. */
   swift_barrier_t wait_barrier;
   swift_barrier_t run_barrier;
 
+  /* Are the runners released to work on a threadpool map, not tasks? */
+  volatile int runners_mapping;
+
+  /* Are the runners working on the tasks? */
+  volatile int runners_tasking;
+
   /* ID of the node this engine lives on. */
   int nr_nodes, nodeID;
 
@@ -387,6 +469,9 @@ struct engine {
   struct link *links;
   size_t nr_links, size_links;
 
+  /* Number of links in the blocks of links reserved by the threads. */
+  size_t link_block_size;
+
   /* Average number of tasks per cell. Used to estimate the sizes
    * of the various task arrays. Also the maximum from all ranks. */
   float tasks_per_cell;
@@ -433,7 +518,7 @@ struct engine {
   const struct star_formation *star_formation;
 
   /* Properties of the sellar feedback model */
-  const struct feedback_props *feedback_props;
+  struct feedback_props *feedback_props;
 
   /* Properties of the chemistry model */
   const struct chemistry_global_data *chemistry;
@@ -441,6 +526,9 @@ struct engine {
   /*! The FOF properties data. */
   struct fof_props *fof_properties;
 
+  /* Properties of the lightcone built during the drifts */
+  struct lightcone_props *lightcone_properties;
+
   /* The (parsed) parameter file */
   struct swift_params *parameter_file;
 
@@ -457,6 +545,22 @@ struct engine {
   /* Whether to dump restart files after the last step. */
   int restart_onexit;
 
+  /* Are restart files written by a separate thread while the run continues? */
+  int restart_asynchronous;
+
+  /* The restart file currently being written asynchronously (if any) */
+  struct restart_async *restart_async;
+
+  /* Number of incremental restart dumps between two complete ones. */
+  int restart_incremental;
+
+  /* Are the large blocks of restart files written in parallel with direct
+   * i/o? */
+  int restart_direct_io;
+
+  /* Are the large blocks of restart files compressed? */
+  int restart_compress;
+
   /* Name of the restart file. */
   const char *restart_file;
 
@@ -483,12 +587,14 @@ void engine_compute_next_statistics_time(struct engine *e);
 void engine_recompute_displacement_constraint(struct engine *e);
 void engine_unskip(struct engine *e);
 void engine_drift_all(struct engine *e, const int drift_mpoles);
-void engine_drift_top_multipoles(struct engine *e);
+void engine_drift_all_and_collect_stats(struct engine *e,
+                                        struct statistics *stats);
 void engine_reconstruct_multipoles(struct engine *e);
 void engine_allocate_foreign_particles(struct engine *e);
 void engine_print_stats(struct engine *e);
 void engine_check_for_dumps(struct engine *e);
 void engine_dump_snapshot(struct engine *e);
+void engine_wait_for_snapshot(struct engine *e);
 void engine_init_output_lists(struct engine *e, struct swift_params *params);
 void engine_init(struct engine *e, struct space *s, struct swift_params *params,
                  long long Ngas, long long Ngparts, long long Nstars,
@@ -500,12 +606,13 @@ void engine_init(struct engine *e, struct space *s, struct swift_params *params,
                  const struct entropy_floor_properties *entropy_floor,
                  struct gravity_props *gravity, const struct stars_props *stars,
                  const struct black_holes_props *black_holes,
-                 const struct feedback_props *feedback, struct pm_mesh *mesh,
+                 struct feedback_props *feedback, struct pm_mesh *mesh,
                  const struct external_potential *potential,
                  struct cooling_function_data *cooling_func,
                  const struct star_formation *starform,
                  const struct chemistry_global_data *chemistry,
-                 struct fof_props *fof_properties);
+                 struct fof_props *fof_properties,
+                 struct lightcone_props *lightcone_properties);
 void engine_config(int restart, int fof, struct engine *e,
                    struct swift_params *params, int nr_nodes, int nodeID,
                    int nr_threads, int with_aff, int verbose,
@@ -514,9 +621,9 @@ void engine_dump_index(struct engine *e);
 void engine_launch(struct engine *e);
 void engine_prepare(struct engine *e);
 void engine_init_particles(struct engine *e, int flag_entropy_ICs,
-                           int clean_h_values);
+                           int clean_h_values, int fast_start);
 void engine_step(struct engine *e);
-void engine_split(struct engine *e, struct partition *initial_partition);
+int engine_split(struct engine *e, struct partition *initial_partition);
 void engine_exchange_strays(struct engine *e, const size_t offset_parts,
                             const int *ind_part, size_t *Npart,
                             const size_t offset_gparts, const int *ind_gpart,
@@ -525,6 +632,7 @@ void engine_exchange_strays(struct engine *e, const size_t offset_parts,
                             const size_t offset_bparts, const int *ind_bpart,
                             size_t *Nbpart);
 void engine_rebuild(struct engine *e, int redistributed, int clean_h_values);
+void engine_rebuild_fof(struct engine *e);
 void engine_repartition(struct engine *e);
 void engine_repartition_trigger(struct engine *e);
 void engine_makeproxies(struct engine *e);
@@ -536,11 +644,14 @@ void engine_unpin(void);
 void engine_clean(struct engine *e, const int fof);
 int engine_estimate_nr_tasks(const struct engine *e);
 void engine_print_task_counts(const struct engine *e);
+void engine_write_phase_summary(struct engine *e, const char *filename,
+                                int nr_steps);
 void engine_fof(struct engine *e, const int dump_results,
                 const int seed_black_holes);
 
 /* Function prototypes, engine_maketasks.c. */
 void engine_maketasks(struct engine *e);
+int engine_reuse_tasks(struct engine *e);
 
 /* Function prototypes, engine_maketasks.c. */
 void engine_make_fof_tasks(struct engine *e);
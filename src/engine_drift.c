@@ -28,6 +28,15 @@
 /* This object's header. */
 #include "engine.h"
 
+/**
+ * @brief Data of the mapper drifting the particles and collecting their
+ * statistics.
+ */
+struct drift_stats_data {
+  const struct engine *e;
+  struct statistics *stats;
+};
+
 /**
  * @brief Mapper function to drift *all* the #part to the current time.
  *
@@ -264,6 +273,50 @@ void engine_do_drift_all_multipole_mapper(void *map_data, int num_elements,
   }
 }
 
+/**
+ * @brief Cost of drifting the #part of a top-level cell.
+ *
+ * @param map_data Pointer to the index of the cell.
+ * @param extra_data Pointer to an #engine.
+ */
+static double engine_drift_all_part_cost(void *map_data, void *extra_data) {
+  const struct engine *e = (const struct engine *)extra_data;
+  return e->s->cells_top[*(int *)map_data].hydro.count;
+}
+
+/**
+ * @brief Cost of drifting the #gpart of a top-level cell.
+ *
+ * @param map_data Pointer to the index of the cell.
+ * @param extra_data Pointer to an #engine.
+ */
+static double engine_drift_all_gpart_cost(void *map_data, void *extra_data) {
+  const struct engine *e = (const struct engine *)extra_data;
+  return e->s->cells_top[*(int *)map_data].grav.count;
+}
+
+/**
+ * @brief Cost of drifting the #spart of a top-level cell.
+ *
+ * @param map_data Pointer to the index of the cell.
+ * @param extra_data Pointer to an #engine.
+ */
+static double engine_drift_all_spart_cost(void *map_data, void *extra_data) {
+  const struct engine *e = (const struct engine *)extra_data;
+  return e->s->cells_top[*(int *)map_data].stars.count;
+}
+
+/**
+ * @brief Cost of drifting the #bpart of a top-level cell.
+ *
+ * @param map_data Pointer to the index of the cell.
+ * @param extra_data Pointer to an #engine.
+ */
+static double engine_drift_all_bpart_cost(void *map_data, void *extra_data) {
+  const struct engine *e = (const struct engine *)extra_data;
+  return e->s->cells_top[*(int *)map_data].black_holes.count;
+}
+
 /**
  * @brief Drift *all* particles and multipoles at all levels
  * forward to the current time.
@@ -291,24 +344,28 @@ void engine_drift_all(struct engine *e, const int drift_mpoles) {
     /* Normal case: We have a list of local cells with tasks to play with */
 
     if (e->s->nr_parts > 0) {
-      threadpool_map(&e->threadpool, engine_do_drift_all_part_mapper,
-                     e->s->local_cells_top, e->s->nr_local_cells, sizeof(int),
-                     /* default chunk */ 0, e);
+      threadpool_map_weighted(&e->threadpool,
+                              engine_do_drift_all_part_mapper,
+                              e->s->local_cells_top, e->s->nr_local_cells,
+                              sizeof(int), engine_drift_all_part_cost, e);
     }
     if (e->s->nr_gparts > 0) {
-      threadpool_map(&e->threadpool, engine_do_drift_all_gpart_mapper,
-                     e->s->local_cells_top, e->s->nr_local_cells, sizeof(int),
-                     /* default chunk */ 0, e);
+      threadpool_map_weighted(&e->threadpool,
+                              engine_do_drift_all_gpart_mapper,
+                              e->s->local_cells_top, e->s->nr_local_cells,
+                              sizeof(int), engine_drift_all_gpart_cost, e);
     }
     if (e->s->nr_sparts > 0) {
-      threadpool_map(&e->threadpool, engine_do_drift_all_spart_mapper,
-                     e->s->local_cells_top, e->s->nr_local_cells, sizeof(int),
-                     /* default chunk */ 0, e);
+      threadpool_map_weighted(&e->threadpool,
+                              engine_do_drift_all_spart_mapper,
+                              e->s->local_cells_top, e->s->nr_local_cells,
+                              sizeof(int), engine_drift_all_spart_cost, e);
     }
     if (e->s->nr_bparts > 0) {
-      threadpool_map(&e->threadpool, engine_do_drift_all_bpart_mapper,
-                     e->s->local_cells_top, e->s->nr_local_cells, sizeof(int),
-                     /* default chunk */ 0, e);
+      threadpool_map_weighted(&e->threadpool,
+                              engine_do_drift_all_bpart_mapper,
+                              e->s->local_cells_top, e->s->nr_local_cells,
+                              sizeof(int), engine_drift_all_bpart_cost, e);
     }
     if (drift_mpoles && (e->policy & engine_policy_self_gravity)) {
       threadpool_map(&e->threadpool, engine_do_drift_all_multipole_mapper,
@@ -368,44 +425,99 @@ void engine_drift_all(struct engine *e, const int drift_mpoles) {
 }
 
 /**
- * @brief Mapper function to drift *all* top-level multipoles forward in
- * time.
+ * @brief Cost of drifting all the particles of a top-level cell.
  *
- * @param map_data An array of #cell%s.
+ * @param map_data Pointer to the index of the cell.
+ * @param extra_data Pointer to the #drift_stats_data.
+ */
+static double engine_drift_all_stats_cost(void *map_data, void *extra_data) {
+  const struct drift_stats_data *data =
+      (const struct drift_stats_data *)extra_data;
+  const struct cell *c = &data->e->s->cells_top[*(int *)map_data];
+  return c->hydro.count + c->grav.count + c->stars.count +
+         c->black_holes.count;
+}
+
+/**
+ * @brief Mapper function to drift *all* the particles of a set of top-level
+ * cells to the current time and collect their statistics.
+ *
+ * @param map_data An array of indices of #cell%s.
  * @param num_elements Chunk size.
- * @param extra_data Pointer to an #engine.
+ * @param extra_data Pointer to the #drift_stats_data.
  */
-void engine_do_drift_top_multipoles_mapper(void *map_data, int num_elements,
-                                           void *extra_data) {
+static void engine_do_drift_all_stats_mapper(void *map_data, int num_elements,
+                                             void *extra_data) {
+
+  struct drift_stats_data *data = (struct drift_stats_data *)extra_data;
+  const struct engine *e = data->e;
+  struct space *s = e->s;
+  const int *local_cells_top = (int *)map_data;
 
-  struct engine *e = (struct engine *)extra_data;
-  struct cell *cells = (struct cell *)map_data;
+  /* Local accumulator */
+  struct statistics stats;
+  stats_init(&stats);
 
   for (int ind = 0; ind < num_elements; ind++) {
-    struct cell *c = &cells[ind];
-    if (c != NULL) {
 
-      /* Drift the multipole at this level only */
-      if (c->grav.ti_old_multipole != e->ti_current) cell_drift_multipole(c, e);
-    }
+    struct cell *c = &s->cells_top[local_cells_top[ind]];
+
+    if (c->nodeID != e->nodeID) continue;
+
+    /* Drift all the particles */
+    cell_drift_part(c, e, /* force the drift=*/1);
+    cell_drift_gpart(c, e, /* force the drift=*/1);
+    cell_drift_spart(c, e, /* force the drift=*/1);
+    cell_drift_bpart(c, e, /* force the drift=*/1);
+
+    /* Synchronize the positions of this cell's particles (their counterparts
+     * live in the same top-level cell) */
+    space_synchronize_particle_positions_mapper(c->grav.parts, c->grav.count,
+                                                s);
+
+    /* Collect while the particles are still in cache */
+    stats_collect_cell(c, e, &stats);
   }
+
+  /* Now write back to memory */
+  if (lock_lock(&data->stats->lock) == 0) stats_add(data->stats, &stats);
+  if (lock_unlock(&data->stats->lock) != 0) error("Failed to unlock stats.");
 }
 
 /**
- * @brief Drift *all* top-level multipoles forward to the current time.
+ * @brief Drift *all* particles forward to the current time and collect the
+ * statistics of all of them.
+ *
+ * The statistics are gathered cell by cell in the same pass as the drift,
+ * rather than in a separate sweep over all the particle arrays. Particles
+ * that are already at the current time are only read.
  *
  * @param e The #engine.
+ * @param stats The #statistics aggregator to fill.
  */
-void engine_drift_top_multipoles(struct engine *e) {
+void engine_drift_all_and_collect_stats(struct engine *e,
+                                        struct statistics *stats) {
 
   const ticks tic = getticks();
 
-  threadpool_map(&e->threadpool, engine_do_drift_top_multipoles_mapper,
-                 e->s->cells_top, e->s->nr_cells, sizeof(struct cell), 0, e);
+  /* When restarting, the list of local cells does not exist yet */
+  if (e->restarting) {
+    engine_drift_all(e, /*drift_mpoles=*/0);
+    stats_collect(e->s, stats);
+    return;
+  }
+
+  struct drift_stats_data data = {e, stats};
+  threadpool_map_weighted(&e->threadpool, engine_do_drift_all_stats_mapper,
+                          e->s->local_cells_top, e->s->nr_local_cells,
+                          sizeof(int), engine_drift_all_stats_cost, &data);
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Check that all cells have been drifted to the current time. */
-  space_check_top_multipoles_drift_point(e->s, e->ti_current);
+  space_check_drift_point(e->s, e->ti_current, /*check_mpoles=*/0);
+  part_verify_links(e->s->parts, e->s->gparts, e->s->sparts, e->s->bparts,
+                    e->s->nr_parts, e->s->nr_gparts, e->s->nr_sparts,
+                    e->s->nr_bparts, e->verbose);
 #endif
 
   if (e->verbose)
@@ -689,6 +689,7 @@ void engine_make_hierarchical_tasks_common(struct engine *e, struct cell *c) {
   struct scheduler *s = &e->sched;
   const int with_limiter = (e->policy & engine_policy_limiter);
   const int with_star_formation = (e->policy & engine_policy_star_formation);
+  const int fuse_kicks = (s->flags & scheduler_flag_fuse_kicks);
 
   /* Are we at the top-level? */
   if (c->top == c && c->nodeID == e->nodeID) {
@@ -705,24 +706,33 @@ void engine_make_hierarchical_tasks_common(struct engine *e, struct cell *c) {
     /* Local tasks only... */
     if (c->nodeID == e->nodeID) {
 
-      /* Add the two half kicks */
-      c->kick1 = scheduler_addtask(s, task_type_kick1, task_subtype_none, 0, 0,
-                                   c, NULL);
+      /* Add the two half kicks, unless the time-step task does them */
+      if (!fuse_kicks)
+        c->kick1 = scheduler_addtask(s, task_type_kick1, task_subtype_none, 0,
+                                     0, c, NULL);
 
 #if defined(WITH_LOGGER)
       c->logger = scheduler_addtask(s, task_type_logger, task_subtype_none, 0,
                                     0, c, NULL);
 #endif
 
-      c->kick2 = scheduler_addtask(s, task_type_kick2, task_subtype_none, 0, 0,
-                                   c, NULL);
+      if (!fuse_kicks)
+        c->kick2 = scheduler_addtask(s, task_type_kick2, task_subtype_none, 0,
+                                     0, c, NULL);
 
       /* Add the time-step calculation task and its dependency */
       c->timestep = scheduler_addtask(s, task_type_timestep, task_subtype_none,
                                       0, 0, c, NULL);
 
-      scheduler_addunlock(s, c->kick2, c->timestep);
-      scheduler_addunlock(s, c->timestep, c->kick1);
+      if (fuse_kicks) {
+
+        /* The dependencies of the kicks are those of the time-step task */
+        c->kick1 = c->timestep;
+        c->kick2 = c->timestep;
+      } else {
+        scheduler_addunlock(s, c->kick2, c->timestep);
+        scheduler_addunlock(s, c->timestep, c->kick1);
+      }
 
       /* Subgrid tasks: star formation */
       if (with_star_formation && c->hydro.count > 0) {
@@ -1641,6 +1651,12 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
     struct cell *ci = t->ci;
     struct cell *cj = t->cj;
 
+    /* Black holes are rare: only interact them where there are some. */
+    const int with_bh_loops =
+        with_black_holes &&
+        ((ci != NULL && ci->black_holes.count > 0) ||
+         (cj != NULL && cj->black_holes.count > 0));
+
     /* Sort tasks depend on the drift of the cell (gas version). */
     if (t_type == task_type_sort && ci->nodeID == nodeID) {
       scheduler_addunlock(sched, ci->hydro.super->hydro.drift, t);
@@ -1678,7 +1694,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
       }
 
       /* The black hole feedback tasks */
-      if (with_black_holes) {
+      if (with_bh_loops) {
         t_bh_density = scheduler_addtask(
             sched, task_type_self, task_subtype_bh_density, flags, 0, ci, NULL);
         t_bh_feedback =
@@ -1695,7 +1711,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
         engine_addlink(e, &ci->stars.density, t_star_density);
         engine_addlink(e, &ci->stars.feedback, t_star_feedback);
       }
-      if (with_black_holes) {
+      if (with_bh_loops) {
         engine_addlink(e, &ci->black_holes.density, t_bh_density);
         engine_addlink(e, &ci->black_holes.feedback, t_bh_feedback);
       }
@@ -1739,7 +1755,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
                             ci->hydro.super->stars.stars_out);
       }
 
-      if (with_black_holes) {
+      if (with_bh_loops) {
 
         scheduler_addunlock(sched, ci->hydro.super->black_holes.drift,
                             t_bh_density);
@@ -1799,7 +1815,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
       }
 
       /* The black hole feedback tasks */
-      if (with_black_holes) {
+      if (with_bh_loops) {
         t_bh_density = scheduler_addtask(
             sched, task_type_pair, task_subtype_bh_density, flags, 0, ci, cj);
         t_bh_feedback = scheduler_addtask(
@@ -1818,7 +1834,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
         engine_addlink(e, &ci->stars.feedback, t_star_feedback);
         engine_addlink(e, &cj->stars.feedback, t_star_feedback);
       }
-      if (with_black_holes) {
+      if (with_bh_loops) {
         engine_addlink(e, &ci->black_holes.density, t_bh_density);
         engine_addlink(e, &cj->black_holes.density, t_bh_density);
         engine_addlink(e, &ci->black_holes.feedback, t_bh_feedback);
@@ -1892,7 +1908,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
                               ci->hydro.super->stars.stars_out);
         }
 
-        if (with_black_holes) {
+        if (with_bh_loops) {
 
           scheduler_addunlock(sched, ci->hydro.super->black_holes.drift,
                               t_bh_density);
@@ -1944,7 +1960,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
                                 cj->hydro.super->stars.stars_out);
           }
 
-          if (with_black_holes) {
+          if (with_bh_loops) {
 
             scheduler_addunlock(sched, cj->hydro.super->black_holes.drift,
                                 t_bh_density);
@@ -2004,7 +2020,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
       }
 
       /* The black hole feedback tasks */
-      if (with_black_holes) {
+      if (with_bh_loops) {
         t_bh_density =
             scheduler_addtask(sched, task_type_sub_self,
                               task_subtype_bh_density, flags, 0, ci, NULL);
@@ -2022,7 +2038,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
         engine_addlink(e, &ci->stars.density, t_star_density);
         engine_addlink(e, &ci->stars.feedback, t_star_feedback);
       }
-      if (with_black_holes) {
+      if (with_bh_loops) {
         engine_addlink(e, &ci->black_holes.density, t_bh_density);
         engine_addlink(e, &ci->black_holes.feedback, t_bh_feedback);
       }
@@ -2072,7 +2088,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
                             ci->hydro.super->stars.stars_out);
       }
 
-      if (with_black_holes) {
+      if (with_bh_loops) {
 
         scheduler_addunlock(sched, ci->hydro.super->black_holes.drift,
                             t_bh_density);
@@ -2134,7 +2150,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
       }
 
       /* The black hole feedback tasks */
-      if (with_black_holes) {
+      if (with_bh_loops) {
         t_bh_density =
             scheduler_addtask(sched, task_type_sub_pair,
                               task_subtype_bh_density, flags, 0, ci, cj);
@@ -2155,7 +2171,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
         engine_addlink(e, &ci->stars.feedback, t_star_feedback);
         engine_addlink(e, &cj->stars.feedback, t_star_feedback);
       }
-      if (with_black_holes) {
+      if (with_bh_loops) {
         engine_addlink(e, &ci->black_holes.density, t_bh_density);
         engine_addlink(e, &cj->black_holes.density, t_bh_density);
         engine_addlink(e, &ci->black_holes.feedback, t_bh_feedback);
@@ -2228,7 +2244,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
                               ci->hydro.super->stars.stars_out);
         }
 
-        if (with_black_holes) {
+        if (with_bh_loops) {
 
           scheduler_addunlock(sched, ci->hydro.super->black_holes.drift,
                               t_bh_density);
@@ -2282,7 +2298,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
                                 cj->hydro.super->stars.stars_out);
           }
 
-          if (with_black_holes) {
+          if (with_bh_loops) {
 
             scheduler_addunlock(sched, cj->hydro.super->black_holes.drift,
                                 t_bh_density);
@@ -2532,6 +2548,249 @@ void engine_addtasks_recv_mapper(void *map_data, int num_elements,
   }
 }
 
+#ifdef WITH_MPI
+
+/**
+ * @brief Collect the end-of-step send or recv tasks of a given sub-type
+ * exchanged with a node in a hierarchy of cells, depth-first.
+ *
+ * The cells of the proxies and their hierarchies are identical on both
+ * sides, so the sending and receiving nodes find the tasks in the same order.
+ *
+ * @param c The #cell.
+ * @param l The #proxy_tend_list to add the tasks to.
+ * @param type The type of the tasks (send or recv).
+ * @param subtype The end-of-step sub-type of the tasks.
+ * @param nodeID The node the tasks communicate with.
+ */
+static void engine_collect_tend_tasks(struct cell *c, struct proxy_tend_list *l,
+                                      const enum task_types type,
+                                      const enum task_subtypes subtype,
+                                      const int nodeID) {
+
+  /* Is the task attached to this cell? The sub-cells are then covered. */
+  struct link *links = (type == task_type_send) ? c->mpi.send : c->mpi.recv;
+  for (struct link *k = links; k != NULL; k = k->next) {
+    struct task *t = k->t;
+    if (t->ci == c && t->subtype == subtype &&
+        (type == task_type_recv || t->cj->nodeID == nodeID)) {
+      proxy_tend_add_task(l, t);
+      return;
+    }
+  }
+
+  /* Recurse? */
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL)
+        engine_collect_tend_tasks(c->progeny[k], l, type, subtype, nodeID);
+}
+
+/**
+ * @brief Group the consecutive end-of-step tasks of the same sub-type of a
+ * list into messages smaller than a given size.
+ *
+ * The first task of each group communicates the whole group, the others
+ * become implicit and unlock it. All of them carry the index of the group in
+ * their flags.
+ *
+ * @param s The #scheduler.
+ * @param l The #proxy_tend_list.
+ * @param limit The maximal size of a message in bytes.
+ */
+static void engine_group_tend_tasks(struct scheduler *s,
+                                    struct proxy_tend_list *l,
+                                    const size_t limit) {
+
+  int first = 0;
+  while (first < l->nr_tasks) {
+
+    struct task *t = l->tasks[first];
+    size_t size = proxy_tend_size(t);
+
+    /* Extend the group as far as the size allows. */
+    int last = first + 1;
+    for (; last < l->nr_tasks && l->tasks[last]->subtype == t->subtype;
+         last++) {
+      const size_t next = proxy_tend_size(l->tasks[last]);
+      if (size + next > limit) break;
+      size += next;
+    }
+
+    /* Nothing to gain for a single message. */
+    if (last - first > 1) {
+      const int gid = proxy_tend_add_group(l, first, last - first, size);
+      t->flags = -1 - gid;
+      for (int k = first + 1; k < last; k++) {
+        struct task *tk = l->tasks[k];
+        tk->implicit = 1;
+        tk->flags = -1 - gid;
+        scheduler_addunlock(s, tk, t);
+      }
+    }
+
+    first = last;
+  }
+}
+
+/**
+ * @brief Group the small end-of-step messages exchanged with each proxy.
+ *
+ * @param e The #engine.
+ */
+static void engine_make_tend_groups(struct engine *e) {
+
+  const size_t limit = e->sched.mpi_aggregate_limit;
+  const enum task_subtypes subtypes[4] = {
+      task_subtype_tend_part, task_subtype_tend_gpart, task_subtype_tend_spart,
+      task_subtype_tend_bpart};
+
+  int nr_groups = 0, nr_tasks = 0;
+  for (int pid = 0; pid < e->nr_proxies; pid++) {
+
+    /* Get a handle on the proxy. */
+    struct proxy *p = &e->proxies[pid];
+    proxy_tend_reset(&p->tend_out);
+    proxy_tend_reset(&p->tend_in);
+
+    /* Collect all the end-of-step tasks, one sub-type after the other. */
+    for (int k = 0; k < 4; k++) {
+      for (int j = 0; j < p->nr_cells_out; j++)
+        engine_collect_tend_tasks(p->cells_out[j], &p->tend_out,
+                                  task_type_send, subtypes[k], p->nodeID);
+      for (int j = 0; j < p->nr_cells_in; j++)
+        engine_collect_tend_tasks(p->cells_in[j], &p->tend_in, task_type_recv,
+                                  subtypes[k], p->nodeID);
+    }
+
+    engine_group_tend_tasks(&e->sched, &p->tend_out, limit);
+    engine_group_tend_tasks(&e->sched, &p->tend_in, limit);
+
+    nr_groups += p->tend_out.nr_groups + p->tend_in.nr_groups;
+    nr_tasks += p->tend_out.nr_tasks + p->tend_in.nr_tasks;
+  }
+
+  if (e->verbose)
+    message("Grouped %d end-of-step messages into %d groups.", nr_tasks,
+            nr_groups);
+}
+
+/**
+ * @brief Place the data of the compact hydro send or recv tasks of a given
+ * sub-type exchanged with a node in a hierarchy of cells in the window of the
+ * receiving node, depth-first.
+ *
+ * The cells of the proxies and their hierarchies are identical on both
+ * sides, so the sending and receiving nodes place the tasks in the same
+ * order.
+ *
+ * @param s The #scheduler.
+ * @param c The #cell.
+ * @param type The type of the tasks (send or recv).
+ * @param subtype The hydro sub-type of the tasks.
+ * @param nodeID The node the tasks communicate with.
+ * @param offset (in/out) The next free displacement in the window.
+ */
+static void engine_place_rma_tasks(struct scheduler *s, struct cell *c,
+                                   const enum task_types type,
+                                   const enum task_subtypes subtype,
+                                   const int nodeID, size_t *offset) {
+
+  /* Is the task attached to this cell? The sub-cells are then covered. */
+  struct link *links = (type == task_type_send) ? c->mpi.send : c->mpi.recv;
+  for (struct link *k = links; k != NULL; k = k->next) {
+    struct task *t = k->t;
+    if (t->ci == c && t->subtype == subtype &&
+        (type == task_type_recv || t->cj->nodeID == nodeID)) {
+      const size_t size = c->hydro.count * cell_pack_hydro_size(subtype);
+      s->rma_disp[t - s->tasks] = *offset;
+      *offset += ((size + SWIFT_CACHE_ALIGNMENT - 1) / SWIFT_CACHE_ALIGNMENT) *
+                 SWIFT_CACHE_ALIGNMENT;
+      return;
+    }
+  }
+
+  /* Recurse? */
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL)
+        engine_place_rma_tasks(s, c->progeny[k], type, subtype, nodeID,
+                               offset);
+}
+
+/**
+ * @brief Create the window into which the other nodes put the compact hydro
+ * particles of our foreign cells.
+ *
+ * Each node gets a region of the window of each of its proxies, in which the
+ * data of its tasks follow each other in the order of the cells. This is
+ * collective over all the nodes.
+ *
+ * @param e The #engine.
+ */
+static void engine_make_rma_window(struct engine *e) {
+
+  struct scheduler *s = &e->sched;
+  const int nr_nodes = e->nr_nodes;
+  const enum task_subtypes subtypes[3] = {
+      task_subtype_xv, task_subtype_rho, task_subtype_gradient};
+
+  /* Drop the window of the previous tasks. */
+  scheduler_free_rma(s);
+  if ((s->rma_disp = (size_t *)malloc(s->size * sizeof(size_t))) == NULL)
+    error("Failed to allocate the RMA displacements.");
+
+  /* Start and size of the region of each node in our window. */
+  long long *regions = (long long *)calloc(4 * nr_nodes, sizeof(long long));
+  if (regions == NULL) error("Failed to allocate the RMA regions.");
+  long long *remote = regions + 2 * nr_nodes;
+
+  size_t total = 0;
+  for (int pid = 0; pid < e->nr_proxies; pid++) {
+    struct proxy *p = &e->proxies[pid];
+    size_t offset = total;
+    for (int k = 0; k < 3; k++)
+      for (int j = 0; j < p->nr_cells_in; j++)
+        engine_place_rma_tasks(s, p->cells_in[j], task_type_recv, subtypes[k],
+                               p->nodeID, &offset);
+    regions[2 * p->nodeID] = total;
+    regions[2 * p->nodeID + 1] = offset - total;
+    total = offset;
+  }
+
+  /* Tell every node where its region starts in our window. */
+  if (MPI_Alltoall(regions, 2, MPI_LONG_LONG, remote, 2, MPI_LONG_LONG,
+                   MPI_COMM_WORLD) != MPI_SUCCESS)
+    error("Failed to exchange the RMA regions.");
+
+  /* Place the data we send in the regions we got. */
+  for (int pid = 0; pid < e->nr_proxies; pid++) {
+    struct proxy *p = &e->proxies[pid];
+    size_t offset = remote[2 * p->nodeID];
+    for (int k = 0; k < 3; k++)
+      for (int j = 0; j < p->nr_cells_out; j++)
+        engine_place_rma_tasks(s, p->cells_out[j], task_type_send, subtypes[k],
+                               p->nodeID, &offset);
+    if ((long long)offset - remote[2 * p->nodeID] != remote[2 * p->nodeID + 1])
+      error("Mismatched RMA region with node %d.", p->nodeID);
+  }
+  free(regions);
+
+  /* Expose the buffer, open for one-sided access until the next rebuild. */
+  if (swift_memalign("rma_buff", (void **)&s->rma_buff, SWIFT_CACHE_ALIGNMENT,
+                     total + SWIFT_CACHE_ALIGNMENT) != 0)
+    error("Failed to allocate the RMA window.");
+  if (MPI_Win_create(s->rma_buff, total, 1, MPI_INFO_NULL, MPI_COMM_WORLD,
+                     &s->rma_win) != MPI_SUCCESS ||
+      MPI_Win_lock_all(MPI_MODE_NOCHECK, s->rma_win) != MPI_SUCCESS)
+    error("Failed to create the RMA window.");
+
+  if (e->verbose)
+    message("Exposing %zd bytes of foreign hydro particles.", total);
+}
+
+#endif /* WITH_MPI */
+
 /**
  * @brief Constructs the top-level self + pair tasks for the FOF loop over
  * neighbours.
@@ -2703,6 +2962,9 @@ void engine_maketasks(struct engine *e) {
   if (e->policy & engine_policy_external_gravity)
     engine_make_external_gravity_tasks(e);
 
+  /* Add the tasks made so far to the task list. */
+  scheduler_release_blocks(sched);
+
   if (e->sched.nr_tasks == 0 && (s->nr_gparts > 0 || s->nr_parts > 0))
     error("We have particles but no hydro or gravity tasks were created.");
 
@@ -2731,6 +2993,16 @@ void engine_maketasks(struct engine *e) {
   if (e->size_links < e->nr_links * engine_rebuild_link_alloc_margin)
     e->size_links = e->nr_links * engine_rebuild_link_alloc_margin;
 
+  /* Size of the blocks of links reserved by the threads, with room for the
+   * unused links of the blocks. The blocks of the threads were emptied when
+   * the split tasks were released. */
+  const size_t nr_threads = max(e->threadpool.num_threads, 1);
+  e->link_block_size = e->size_links / (scheduler_block_ratio * nr_threads);
+  if (e->link_block_size > scheduler_max_block_size)
+    e->link_block_size = scheduler_max_block_size;
+  if (e->link_block_size < 1) e->link_block_size = 1;
+  e->size_links += nr_threads * e->link_block_size * scheduler_block_releases;
+
   /* Allocate the new link list */
   if ((e->links = (struct link *)swift_malloc(
            "links", sizeof(struct link) * e->size_links)) == NULL)
@@ -2769,6 +3041,7 @@ void engine_maketasks(struct engine *e) {
   /* Append hierarchical tasks to each cell. */
   threadpool_map(&e->threadpool, engine_make_hierarchical_tasks_mapper, cells,
                  nr_cells, sizeof(struct cell), 0, e);
+  scheduler_release_blocks(sched);
 
   tic2 = getticks();
 
@@ -2778,6 +3051,7 @@ void engine_maketasks(struct engine *e) {
   if (e->policy & engine_policy_hydro)
     threadpool_map(&e->threadpool, engine_make_extra_hydroloop_tasks_mapper,
                    sched->tasks, sched->nr_tasks, sizeof(struct task), 0, e);
+  scheduler_release_blocks(sched);
 
   if (e->verbose)
     message("Making extra hydroloop tasks took %.3f %s.",
@@ -2828,6 +3102,7 @@ void engine_maketasks(struct engine *e) {
                    send_cell_type_pairs, num_send_cells,
                    sizeof(struct cell_type_pair),
                    /*chunk=*/0, e);
+    scheduler_release_blocks(sched);
 
     free(send_cell_type_pairs);
 
@@ -2869,11 +3144,36 @@ void engine_maketasks(struct engine *e) {
                    recv_cell_type_pairs, num_recv_cells,
                    sizeof(struct cell_type_pair),
                    /*chunk=*/0, e);
+    scheduler_release_blocks(sched);
     free(recv_cell_type_pairs);
 
     if (e->verbose)
       message("Creating recv tasks took %.3f %s.",
               clocks_from_ticks(getticks() - tic2), clocks_getunit());
+
+    /* Group the small end-of-step messages towards each node? */
+    if (e->sched.mpi_aggregate_limit > 0) {
+
+      tic2 = getticks();
+
+      engine_make_tend_groups(e);
+
+      if (e->verbose)
+        message("Grouping end-of-step messages took %.3f %s.",
+                clocks_from_ticks(getticks() - tic2), clocks_getunit());
+    }
+
+    /* Put the compact hydro particles directly in the foreign buffers? */
+    if (e->sched.flags & scheduler_flag_mpi_rma) {
+
+      tic2 = getticks();
+
+      engine_make_rma_window(e);
+
+      if (e->verbose)
+        message("Creating the RMA window took %.3f %s.",
+                clocks_from_ticks(getticks() - tic2), clocks_getunit());
+    }
   }
 
   /* Allocate memory for foreign particles */
@@ -2881,6 +3181,9 @@ void engine_maketasks(struct engine *e) {
 
 #endif
 
+  /* Add the remaining tasks to the task list. */
+  scheduler_release_blocks(sched);
+
   /* Report the number of tasks we actually used */
   if (e->verbose)
     message(
@@ -2901,6 +3204,9 @@ void engine_maketasks(struct engine *e) {
   /* Set the unlocks per task. */
   scheduler_set_unlocks(sched);
 
+  /* Give the communication tasks their MPI state. */
+  scheduler_set_comms(sched);
+
   if (e->verbose)
     message("Setting unlocks took %.3f %s.",
             clocks_from_ticks(getticks() - tic2), clocks_getunit());
@@ -2920,7 +3226,106 @@ void engine_maketasks(struct engine *e) {
   /* Set the tasks age. */
   e->tasks_age = 0;
 
+  /* Record the tree these tasks were made for. */
+  if (s->reuse_task_graph) sched->tree_fingerprint = s->tree_fingerprint;
+
   if (e->verbose)
     message("took %.3f %s (including reweight).",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 }
+
+/**
+ * @brief Mapper function checking whether the pair tasks are still valid for
+ * the smoothing lengths of the cell tree we just built.
+ *
+ * @param map_data The tasks.
+ * @param num_elements The number of tasks.
+ * @param extra_data Pointer to an int set to 1 if a task is invalid.
+ */
+void engine_check_reuse_tasks_mapper(void *map_data, int num_elements,
+                                     void *extra_data) {
+
+  const struct task *tasks = (const struct task *)map_data;
+  int *invalid = (int *)extra_data;
+
+  for (int ind = 0; ind < num_elements && !*invalid; ind++) {
+    const struct task *t = &tasks[ind];
+
+    if (t->type != task_type_pair && t->type != task_type_sub_pair) continue;
+
+    const struct cell *ci = t->ci;
+    const struct cell *cj = t->cj;
+
+    /* Same criterion as in engine_marktasks() */
+    if (t->subtype == task_subtype_density) {
+      if (cell_need_rebuild_for_hydro_pair(ci, cj)) *invalid = 1;
+    } else if (t->subtype == task_subtype_stars_density) {
+      if (cell_need_rebuild_for_stars_pair(ci, cj)) *invalid = 1;
+      if (cell_need_rebuild_for_stars_pair(cj, ci)) *invalid = 1;
+    } else if (t->subtype == task_subtype_bh_density) {
+      if (cell_need_rebuild_for_black_holes_pair(ci, cj)) *invalid = 1;
+      if (cell_need_rebuild_for_black_holes_pair(cj, ci)) *invalid = 1;
+    }
+  }
+}
+
+/**
+ * @brief Re-use the tasks of the previous rebuild if they are still valid for
+ * the cell tree we just built.
+ *
+ * This is only possible if the tree was kept across the rebuild (see
+ * space_reset_cells()), has the same fingerprint as the one the tasks were
+ * made for and none of the pair tasks needs to be split differently for the
+ * new smoothing lengths. The dependencies and ranks are then left untouched
+ * and only the weights are re-computed. Otherwise, the tree is cleaned up
+ * such that engine_maketasks() can be called.
+ *
+ * @param e The #engine.
+ *
+ * @return 1 if the tasks were re-used, 0 if new ones need to be made.
+ */
+int engine_reuse_tasks(struct engine *e) {
+
+  struct space *s = e->s;
+  struct scheduler *sched = &e->sched;
+  const ticks tic = getticks();
+
+  if (!s->reuse_task_graph) return 0;
+
+  /* Same tree as the one the tasks were made for? */
+  int invalid = (sched->tree_fingerprint != s->tree_fingerprint);
+
+  /* Same pair tasks? */
+  if (!invalid)
+    threadpool_map(&e->threadpool, engine_check_reuse_tasks_mapper,
+                   sched->tasks, sched->nr_tasks, sizeof(struct task), 0,
+                   &invalid);
+
+  if (invalid) {
+
+    /* The cells still point to the old tasks. */
+    space_clean_task_pointers(s);
+
+    if (e->verbose)
+      message("Cell tree changed, making new tasks (took %.3f %s).",
+              clocks_from_ticks(getticks() - tic), clocks_getunit());
+    return 0;
+  }
+
+  /* The super-pointers of the sub-cells were reset when splitting. */
+  threadpool_map(&e->threadpool, cell_set_super_mapper, s->cells_top,
+                 s->nr_cells, sizeof(struct cell), 0, e);
+
+  /* Weight the tasks. */
+  scheduler_reweight(sched, e->verbose);
+
+  /* Set the tasks age. */
+  e->tasks_age = 0;
+
+  if (e->verbose)
+    message("Re-using %d tasks took %.3f %s (including reweight).",
+            sched->nr_tasks, clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+
+  return 1;
+}
@@ -94,7 +94,7 @@ void engine_marktasks_mapper(void *map_data, int num_elements,
       const int ci_active_hydro = cell_is_active_hydro(ci, e);
       const int ci_active_gravity = cell_is_active_gravity(ci, e);
       const int ci_active_black_holes = cell_is_active_black_holes(ci, e);
-      const int ci_active_stars = cell_is_active_stars(ci, e) ||
+      const int ci_active_stars = cell_is_active_stars_feedback(ci, e) ||
                                   (with_star_formation && ci_active_hydro);
 
       /* Activate the hydro drift */
@@ -252,10 +252,17 @@ void engine_marktasks_mapper(void *map_data, int num_elements,
       const int ci_active_black_holes = cell_is_active_black_holes(ci, e);
       const int cj_active_black_holes = cell_is_active_black_holes(cj, e);
 
-      const int ci_active_stars = cell_is_active_stars(ci, e) ||
-                                  (with_star_formation && ci_active_hydro);
-      const int cj_active_stars = cell_is_active_stars(cj, e) ||
-                                  (with_star_formation && cj_active_hydro);
+      /* The cells without stars able to do feedback are only skipped when
+       * the other node does not need to take the same decision */
+      const int all_local = (ci_nodeID == nodeID && cj_nodeID == nodeID);
+      const int ci_active_stars =
+          (all_local ? cell_is_active_stars_feedback(ci, e)
+                     : cell_is_active_stars(ci, e)) ||
+          (with_star_formation && ci_active_hydro);
+      const int cj_active_stars =
+          (all_local ? cell_is_active_stars_feedback(cj, e)
+                     : cell_is_active_stars(cj, e)) ||
+          (with_star_formation && cj_active_hydro);
 
       /* Only activate tasks that involve a local active cell. */
       if ((t_subtype == task_subtype_density ||
@@ -270,11 +277,16 @@ void engine_marktasks_mapper(void *map_data, int num_elements,
         /* Set the correct sorting flags */
         if (t_type == task_type_pair && t_subtype == task_subtype_density) {
 
+          /* Small pairs are interacted without sorting the cells. */
+          const int with_sorts = !cell_pair_skips_hydro_sorts(ci, cj);
+
           /* Store some values. */
-          atomic_or(&ci->hydro.requires_sorts, 1 << t->flags);
-          atomic_or(&cj->hydro.requires_sorts, 1 << t->flags);
-          ci->hydro.dx_max_sort_old = ci->hydro.dx_max_sort;
-          cj->hydro.dx_max_sort_old = cj->hydro.dx_max_sort;
+          if (with_sorts) {
+            atomic_or(&ci->hydro.requires_sorts, 1 << t->flags);
+            atomic_or(&cj->hydro.requires_sorts, 1 << t->flags);
+            ci->hydro.dx_max_sort_old = ci->hydro.dx_max_sort;
+            cj->hydro.dx_max_sort_old = cj->hydro.dx_max_sort;
+          }
 
           /* Activate the hydro drift tasks. */
           if (ci_nodeID == nodeID) cell_activate_drift_part(ci, s);
@@ -285,9 +297,10 @@ void engine_marktasks_mapper(void *map_data, int num_elements,
           if (cj_nodeID == nodeID && with_limiter) cell_activate_limiter(cj, s);
 
           /* Check the sorts and activate them if needed. */
-          cell_activate_hydro_sorts(ci, t->flags, s);
-          cell_activate_hydro_sorts(cj, t->flags, s);
-
+          if (with_sorts) {
+            cell_activate_hydro_sorts(ci, t->flags, s);
+            cell_activate_hydro_sorts(cj, t->flags, s);
+          }
         }
 
         /* Store current values of dx_max and h_max. */
@@ -871,14 +884,14 @@ void engine_marktasks_mapper(void *map_data, int num_elements,
 
     /* Star ghost tasks ? */
     else if (t_type == task_type_stars_ghost) {
-      if (cell_is_active_stars(t->ci, e) ||
+      if (cell_is_active_stars_feedback(t->ci, e) ||
           (with_star_formation && cell_is_active_hydro(t->ci, e)))
         scheduler_activate(s, t);
     }
 
     /* Feedback implicit tasks? */
     else if (t_type == task_type_stars_in || t_type == task_type_stars_out) {
-      if (cell_is_active_stars(t->ci, e) ||
+      if (cell_is_active_stars_feedback(t->ci, e) ||
           (with_star_formation && cell_is_active_hydro(t->ci, e)))
         scheduler_activate(s, t);
     }
@@ -138,6 +138,9 @@ static INLINE float entropy_floor(
     pressure = max(pressure, pressure_Cool);
   }
 
+  /* Far below both thresholds, as most particles are: no floor to convert */
+  if (pressure == 0.f) return 0.f;
+
   /* Convert to an entropy.
    * (Recall that the entropy is the same in co-moving and phycial frames) */
   return gas_entropy_from_pressure(rho_phys, pressure);
@@ -1113,6 +1113,13 @@ __attribute__((always_inline)) INLINE static void eos_init(
     convert_units_SESAME(&e->SESAME_basalt, us);
     convert_units_SESAME(&e->SESAME_water, us);
     convert_units_SESAME(&e->SS08_water, us);
+
+    const int SESAME_fast_table_factor = parser_get_opt_param_int(
+        params, "EoS:planetary_SESAME_fast_table_factor", 0);
+    resample_table_SESAME(&e->SESAME_iron, SESAME_fast_table_factor);
+    resample_table_SESAME(&e->SESAME_basalt, SESAME_fast_table_factor);
+    resample_table_SESAME(&e->SESAME_water, SESAME_fast_table_factor);
+    resample_table_SESAME(&e->SS08_water, SESAME_fast_table_factor);
   }
 }
 
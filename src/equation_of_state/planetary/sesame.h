@@ -31,6 +31,7 @@
  */
 
 /* Some standard headers. */
+#include <float.h>
 #include <math.h>
 
 /* Local headers. */
@@ -38,6 +39,7 @@
 #include "common_io.h"
 #include "equation_of_state.h"
 #include "inline.h"
+#include "minmax.h"
 #include "physical_constants.h"
 #include "units.h"
 #include "utilities.h"
@@ -52,8 +54,51 @@ struct SESAME_params {
   int num_rho, num_T;
   float P_tiny, c_tiny;
   enum eos_planetary_material_id mat_id;
+
+  // Optional re-sampling of log(P) and log(c) on a uniform grid in log(rho)
+  // and log(u), with -FLT_MAX marking non-positive pressures
+  float *table_log_P_rho_u;
+  float *table_log_c_rho_u;
+  int num_rho_fast, num_u_fast;
+  float log_rho_min_fast, inv_dlog_rho_fast;
+  float log_u_min_fast, inv_dlog_u_fast;
+  int use_fast_table;
 };
 
+// Bilinear interpolation in a uniformly re-sampled log table
+INLINE static float SESAME_interp_fast_table(const float *table,
+                                             const struct SESAME_params *mat,
+                                             const float log_rho,
+                                             const float log_u) {
+
+  // Indices, clamped to extrapolate from the edge and edge-but-one values
+  const float x = (log_rho - mat->log_rho_min_fast) * mat->inv_dlog_rho_fast;
+  const float y = (log_u - mat->log_u_min_fast) * mat->inv_dlog_u_fast;
+  int i = (int)floorf(x);
+  int j = (int)floorf(y);
+  if (i < 0) i = 0;
+  if (i > mat->num_rho_fast - 2) i = mat->num_rho_fast - 2;
+  if (j < 0) j = 0;
+  if (j > mat->num_u_fast - 2) j = mat->num_u_fast - 2;
+  const float intp_rho = x - i;
+  const float intp_u = y - j;
+
+  // Table values
+  const float *row = table + i * mat->num_u_fast + j;
+  const float f_1 = row[0];
+  const float f_2 = row[1];
+  const float f_3 = row[mat->num_u_fast];
+  const float f_4 = row[mat->num_u_fast + 1];
+
+  // Any non-positive value nearby
+  if ((f_1 == -FLT_MAX) || (f_2 == -FLT_MAX) || (f_3 == -FLT_MAX) ||
+      (f_4 == -FLT_MAX))
+    return -FLT_MAX;
+
+  return (1.f - intp_rho) * ((1.f - intp_u) * f_1 + intp_u * f_2) +
+         intp_rho * ((1.f - intp_u) * f_3 + intp_u * f_4);
+}
+
 // Parameter values for each material (cgs units)
 INLINE static void set_SESAME_iron(struct SESAME_params *mat,
                                    enum eos_planetary_material_id mat_id) {
@@ -305,6 +350,13 @@ INLINE static float SESAME_pressure_from_internal_energy(
     return 0.f;
   }
 
+  // O(1) lookup in the re-sampled table
+  if (mat->use_fast_table) {
+    const float log_P = SESAME_interp_fast_table(
+        mat->table_log_P_rho_u, mat, logf(density), logf(u));
+    return (log_P == -FLT_MAX) ? 0.f : expf(log_P);
+  }
+
   int idx_rho, idx_u_1, idx_u_2;
   float intp_rho, intp_u_1, intp_u_2;
   const float log_rho = logf(density);
@@ -409,6 +461,13 @@ INLINE static float SESAME_soundspeed_from_internal_energy(
     return 0.f;
   }
 
+  // O(1) lookup in the re-sampled table
+  if (mat->use_fast_table) {
+    const float log_c = SESAME_interp_fast_table(
+        mat->table_log_c_rho_u, mat, logf(density), logf(u));
+    return (log_c == -FLT_MAX) ? mat->c_tiny : expf(log_c);
+  }
+
   int idx_rho, idx_u_1, idx_u_2;
   float intp_rho, intp_u_1, intp_u_2;
   const float log_rho = logf(density);
@@ -503,4 +562,55 @@ INLINE static float SESAME_soundspeed_from_pressure(
   return 0.f;
 }
 
+// Re-sample the (internal units) tables on a uniform grid in log(rho) and
+// log(u), with factor times as many points as the original table in each
+// direction, to replace the searches with O(1) index computations
+INLINE static void resample_table_SESAME(struct SESAME_params *mat,
+                                         const int factor) {
+
+  mat->use_fast_table = 0;
+  if (factor <= 0) return;
+
+  // Range of the original table
+  float log_u_min = FLT_MAX, log_u_max = -FLT_MAX;
+  for (int i = 0; i < mat->num_rho * mat->num_T; i++) {
+    log_u_min = min(log_u_min, mat->table_log_u_rho_T[i]);
+    log_u_max = max(log_u_max, mat->table_log_u_rho_T[i]);
+  }
+  const float log_rho_min = mat->table_log_rho[0];
+  const float log_rho_max = mat->table_log_rho[mat->num_rho - 1];
+
+  mat->num_rho_fast = factor * (mat->num_rho - 1) + 1;
+  mat->num_u_fast = factor * (mat->num_T - 1) + 1;
+  const float dlog_rho = (log_rho_max - log_rho_min) / (mat->num_rho_fast - 1);
+  const float dlog_u = (log_u_max - log_u_min) / (mat->num_u_fast - 1);
+  mat->log_rho_min_fast = log_rho_min;
+  mat->inv_dlog_rho_fast = 1.f / dlog_rho;
+  mat->log_u_min_fast = log_u_min;
+  mat->inv_dlog_u_fast = 1.f / dlog_u;
+
+  // Allocate table memory
+  const size_t size = (size_t)mat->num_rho_fast * mat->num_u_fast;
+  mat->table_log_P_rho_u = (float *)malloc(size * sizeof(float));
+  mat->table_log_c_rho_u = (float *)malloc(size * sizeof(float));
+  if (mat->table_log_P_rho_u == NULL || mat->table_log_c_rho_u == NULL)
+    error("Failed to allocate the re-sampled SESAME EoS tables");
+
+  // Evaluate the standard interpolation at every node
+  for (int i_rho = 0; i_rho < mat->num_rho_fast; i_rho++) {
+    const float rho = expf(log_rho_min + i_rho * dlog_rho);
+    for (int i_u = 0; i_u < mat->num_u_fast; i_u++) {
+      const float u = expf(log_u_min + i_u * dlog_u);
+      const float P = SESAME_pressure_from_internal_energy(rho, u, mat);
+      const float c = SESAME_soundspeed_from_internal_energy(rho, u, mat);
+      mat->table_log_P_rho_u[i_rho * mat->num_u_fast + i_u] =
+          (P > 0.f) ? logf(P) : -FLT_MAX;
+      mat->table_log_c_rho_u[i_rho * mat->num_u_fast + i_u] =
+          (c > 0.f) ? logf(c) : -FLT_MAX;
+    }
+  }
+
+  mat->use_fast_table = 1;
+}
+
 #endif /* SWIFT_SESAME_EQUATION_OF_STATE_H */
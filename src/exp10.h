@@ -73,4 +73,59 @@ __attribute__((always_inline, const)) INLINE static float exp10f(
 #define exp10f(x) __exp10f(x)
 #endif
 
+#ifdef WITH_VECTORIZATION
+
+#include "vector.h"
+
+/**
+ * @brief Raises 10 to the power of the arguments (vector version).
+ *
+ * We write 10^x = 2^n * e^t with n the integer nearest to x * log2(10), so
+ * that |t| < ln(2) / 2, and evaluate e^t with a 7th order Taylor expansion.
+ * 2^n is built directly from its bits, which only needs a float to int
+ * conversion.
+ *
+ * The relative error is smaller than 2 * 10^-6 for |x| < 10 and smaller
+ * than 5 * 10^-6 over the whole range. Arguments are clamped to
+ * [-37.5, 38.2] to stay in the range of normal numbers.
+ *
+ * @param x The exponents.
+ */
+__attribute__((always_inline, const)) INLINE static vector exp10f_vec(
+    const vector x) {
+
+  vector y;
+  y.v = vec_fmin(vec_fmax(x.v, vec_set1(-37.5f)), vec_set1(38.2f));
+
+  /* n = round(x * log2(10)) */
+  vector n;
+  n.v = vec_floor(vec_fma(y.v, vec_set1(3.32192809488736f), vec_set1(0.5f)));
+
+  /* t = x * ln(10) - n * ln(2), with ln(2) split in two for accuracy. */
+  vector t;
+  t.v = vec_mul(y.v, vec_set1(2.30258509299405f));
+  t.v = vec_fnma(n.v, vec_set1(0.693145751953125f), t.v);
+  t.v = vec_fnma(n.v, vec_set1(1.42860682030941723212e-6f), t.v);
+
+  /* e^t */
+  vector res;
+  res.v = vec_fma(t.v, vec_set1(1.f / 5040.f), vec_set1(1.f / 720.f));
+  res.v = vec_fma(t.v, res.v, vec_set1(1.f / 120.f));
+  res.v = vec_fma(t.v, res.v, vec_set1(1.f / 24.f));
+  res.v = vec_fma(t.v, res.v, vec_set1(1.f / 6.f));
+  res.v = vec_fma(t.v, res.v, vec_set1(0.5f));
+  res.v = vec_fma(t.v, res.v, vec_set1(1.f));
+  res.v = vec_fma(t.v, res.v, vec_set1(1.f));
+
+  /* 2^n, whose bits are (n + 127) << 23. */
+  vector scale;
+  scale.m =
+      vec_ftoi(vec_mul(vec_add(n.v, vec_set1(127.f)), vec_set1(8388608.f)));
+
+  res.v = vec_mul(res.v, scale.v);
+  return res;
+}
+
+#endif /* WITH_VECTORIZATION */
+
 #endif /* SWIFT_EXP10_H */
@@ -20,6 +20,9 @@
 /* This file's header */
 #include "feedback.h"
 
+/* Some standard headers. */
+#include <float.h>
+
 /* Local includes. */
 #include "hydro_properties.h"
 #include "imf.h"
@@ -385,18 +388,13 @@ INLINE static void evolve_SNIa(const float log10_min_mass,
  *
  * @param log10_min_mass log10 mass at the end of step
  * @param log10_max_mass log10 mass at the beginning of step
- * @param stellar_yields array to store calculated yields for passing to
- * integrate_imf
  * @param props properties of the feedback model.
  * @param sp spart we are computing feedback from
  */
 INLINE static void evolve_SNII(float log10_min_mass, float log10_max_mass,
-                               float* stellar_yields,
                                const struct feedback_props* props,
                                struct spart* sp) {
 
-  int low_imf_mass_bin_index, high_imf_mass_bin_index, mass_bin_index;
-
   /* If mass at beginning of step is less than tabulated lower bound for IMF,
    * limit it.*/
   if (log10_min_mass < props->log10_SNII_min_mass_msun)
@@ -411,71 +409,63 @@ INLINE static void evolve_SNII(float log10_min_mass, float log10_max_mass,
    * step */
   if (log10_min_mass >= log10_max_mass) return;
 
-  /* determine which IMF mass bins contribute to the integral */
-  determine_imf_bins(log10_min_mass, log10_max_mass, &low_imf_mass_bin_index,
-                     &high_imf_mass_bin_index, props);
-
   /* determine which metallicity bin and offset this star belongs to */
-  int iz_low = 0, iz_high = 0, low_index_3d, high_index_3d, low_index_2d,
-      high_index_2d;
-  float dz = 0.;
+  int iz_low = 0, iz_high = 0;
+  float dz = 0.f;
   determine_bin_yield_SNII(&iz_low, &iz_high, &dz,
                            log10(sp->chemistry_data.metal_mass_fraction_total),
                            props);
 
+  /* The yields are linear in the metallicity offset and in the star's
+   * abundances, so we only need the IMF integrals of the tabulated yields at
+   * the two metallicities bracketing the star's */
+  const struct yield_table* table = &props->yield_SNII;
+  const int N_cum = eagle_feedback_N_imf_cumulative;
+
+  const float ejecta_low = integrate_imf_cumulative(
+      log10_min_mass, log10_max_mass,
+      &table->ejecta_IMF_cumulative[iz_low * N_cum], props);
+  const float ejecta_high = integrate_imf_cumulative(
+      log10_min_mass, log10_max_mass,
+      &table->ejecta_IMF_cumulative[iz_high * N_cum], props);
+
   /* compute metals produced */
   float metal_mass_released[chemistry_element_count], metal_mass_released_total;
   for (int elem = 0; elem < chemistry_element_count; elem++) {
-    for (mass_bin_index = low_imf_mass_bin_index;
-         mass_bin_index < high_imf_mass_bin_index + 1; mass_bin_index++) {
-      low_index_3d = row_major_index_3d(
-          iz_low, elem, mass_bin_index, eagle_feedback_SNII_N_metals,
-          chemistry_element_count, eagle_feedback_N_imf_bins);
-      high_index_3d = row_major_index_3d(
-          iz_high, elem, mass_bin_index, eagle_feedback_SNII_N_metals,
-          chemistry_element_count, eagle_feedback_N_imf_bins);
-      low_index_2d = row_major_index_2d(iz_low, mass_bin_index,
-                                        eagle_feedback_SNII_N_metals,
-                                        eagle_feedback_N_imf_bins);
-      high_index_2d = row_major_index_2d(iz_high, mass_bin_index,
-                                         eagle_feedback_SNII_N_metals,
-                                         eagle_feedback_N_imf_bins);
-      stellar_yields[mass_bin_index] =
-          (1 - dz) *
-              (props->yield_SNII.yield_IMF_resampled[low_index_3d] +
-               sp->chemistry_data.metal_mass_fraction[elem] *
-                   props->yield_SNII.ejecta_IMF_resampled[low_index_2d]) +
-          dz * (props->yield_SNII.yield_IMF_resampled[high_index_3d] +
-                sp->chemistry_data.metal_mass_fraction[elem] *
-                    props->yield_SNII.ejecta_IMF_resampled[high_index_2d]);
-    }
-
-    metal_mass_released[elem] = integrate_imf(
-        log10_min_mass, log10_max_mass, eagle_imf_integration_yield_weight,
-        stellar_yields, props);
+    const int low_index =
+        row_major_index_3d(iz_low, elem, 0, eagle_feedback_SNII_N_metals,
+                           chemistry_element_count, N_cum);
+    const int high_index =
+        row_major_index_3d(iz_high, elem, 0, eagle_feedback_SNII_N_metals,
+                           chemistry_element_count, N_cum);
+
+    const float yield_low = integrate_imf_cumulative(
+        log10_min_mass, log10_max_mass, &table->yield_IMF_cumulative[low_index],
+        props);
+    const float yield_high = integrate_imf_cumulative(
+        log10_min_mass, log10_max_mass,
+        &table->yield_IMF_cumulative[high_index], props);
+
+    metal_mass_released[elem] =
+        (1 - dz) * (yield_low +
+                    sp->chemistry_data.metal_mass_fraction[elem] * ejecta_low) +
+        dz * (yield_high +
+              sp->chemistry_data.metal_mass_fraction[elem] * ejecta_high);
   }
 
   /* Compute mass produced */
-  for (mass_bin_index = low_imf_mass_bin_index;
-       mass_bin_index < high_imf_mass_bin_index + 1; mass_bin_index++) {
-    low_index_2d =
-        row_major_index_2d(iz_low, mass_bin_index, eagle_feedback_SNII_N_metals,
-                           eagle_feedback_N_imf_bins);
-    high_index_2d = row_major_index_2d(iz_high, mass_bin_index,
-                                       eagle_feedback_SNII_N_metals,
-                                       eagle_feedback_N_imf_bins);
-    stellar_yields[mass_bin_index] =
-        (1 - dz) * (props->yield_SNII.total_metals_IMF_resampled[low_index_2d] +
-                    sp->chemistry_data.metal_mass_fraction_total *
-                        props->yield_SNII.ejecta_IMF_resampled[low_index_2d]) +
-        dz * (props->yield_SNII.total_metals_IMF_resampled[high_index_2d] +
-              sp->chemistry_data.metal_mass_fraction_total *
-                  props->yield_SNII.ejecta_IMF_resampled[high_index_2d]);
-  }
+  const float total_metals_low = integrate_imf_cumulative(
+      log10_min_mass, log10_max_mass,
+      &table->total_metals_IMF_cumulative[iz_low * N_cum], props);
+  const float total_metals_high = integrate_imf_cumulative(
+      log10_min_mass, log10_max_mass,
+      &table->total_metals_IMF_cumulative[iz_high * N_cum], props);
 
   metal_mass_released_total =
-      integrate_imf(log10_min_mass, log10_max_mass,
-                    eagle_imf_integration_yield_weight, stellar_yields, props);
+      (1 - dz) * (total_metals_low +
+                  sp->chemistry_data.metal_mass_fraction_total * ejecta_low) +
+      dz * (total_metals_high +
+            sp->chemistry_data.metal_mass_fraction_total * ejecta_high);
 
   /* yield normalization */
   float mass_ejected, mass_released;
@@ -486,23 +476,8 @@ INLINE static void evolve_SNII(float log10_min_mass, float log10_max_mass,
 
   metal_mass_released_total = max(metal_mass_released_total, 0.f);
 
-  /* compute the total metal mass ejected from the star*/
-  for (mass_bin_index = low_imf_mass_bin_index;
-       mass_bin_index < high_imf_mass_bin_index + 1; mass_bin_index++) {
-    low_index_2d =
-        row_major_index_2d(iz_low, mass_bin_index, eagle_feedback_SNII_N_metals,
-                           eagle_feedback_N_imf_bins);
-    high_index_2d = row_major_index_2d(iz_high, mass_bin_index,
-                                       eagle_feedback_SNII_N_metals,
-                                       eagle_feedback_N_imf_bins);
-    stellar_yields[mass_bin_index] =
-        (1 - dz) * props->yield_SNII.ejecta_IMF_resampled[low_index_2d] +
-        dz * props->yield_SNII.ejecta_IMF_resampled[high_index_2d];
-  }
-
-  mass_ejected =
-      integrate_imf(log10_min_mass, log10_max_mass,
-                    eagle_imf_integration_yield_weight, stellar_yields, props);
+  /* compute the total mass ejected from the star */
+  mass_ejected = (1 - dz) * ejecta_low + dz * ejecta_high;
 
   /* compute the total mass released */
   mass_released = metal_mass_released_total +
@@ -541,18 +516,13 @@ INLINE static void evolve_SNII(float log10_min_mass, float log10_max_mass,
  *
  * @param log10_min_mass log10 mass at the end of step
  * @param log10_max_mass log10 mass at the beginning of step
- * @param stellar_yields array to store calculated yields for passing to
- * integrate_imf
  * @param props Properties of the feedback model.
  * @param sp spart we are computing feedback for.
  */
 INLINE static void evolve_AGB(const float log10_min_mass, float log10_max_mass,
-                              float* stellar_yields,
                               const struct feedback_props* props,
                               struct spart* sp) {
 
-  int low_imf_mass_bin_index, high_imf_mass_bin_index, mass_bin_index;
-
   /* If mass at end of step is greater than tabulated lower bound for IMF, limit
    * it.*/
   if (log10_max_mass > props->log10_SNII_min_mass_msun)
@@ -562,70 +532,63 @@ INLINE static void evolve_AGB(const float log10_min_mass, float log10_max_mass,
    * step */
   if (log10_min_mass >= log10_max_mass) return;
 
-  /* determine which IMF mass bins contribute to the integral */
-  determine_imf_bins(log10_min_mass, log10_max_mass, &low_imf_mass_bin_index,
-                     &high_imf_mass_bin_index, props);
-
   /* determine which metallicity bin and offset this star belongs to */
-  int iz_low = 0, iz_high = 0, low_index_3d, high_index_3d, low_index_2d,
-      high_index_2d;
+  int iz_low = 0, iz_high = 0;
   float dz = 0.f;
   determine_bin_yield_AGB(&iz_low, &iz_high, &dz,
                           log10(sp->chemistry_data.metal_mass_fraction_total),
                           props);
 
+  /* The yields are linear in the metallicity offset and in the star's
+   * abundances, so we only need the IMF integrals of the tabulated yields at
+   * the two metallicities bracketing the star's */
+  const struct yield_table* table = &props->yield_AGB;
+  const int N_cum = eagle_feedback_N_imf_cumulative;
+
+  const float ejecta_low = integrate_imf_cumulative(
+      log10_min_mass, log10_max_mass,
+      &table->ejecta_IMF_cumulative[iz_low * N_cum], props);
+  const float ejecta_high = integrate_imf_cumulative(
+      log10_min_mass, log10_max_mass,
+      &table->ejecta_IMF_cumulative[iz_high * N_cum], props);
+
   /* compute metals produced */
   float metal_mass_released[chemistry_element_count], metal_mass_released_total;
   for (int elem = 0; elem < chemistry_element_count; elem++) {
-    for (mass_bin_index = low_imf_mass_bin_index;
-         mass_bin_index < high_imf_mass_bin_index + 1; mass_bin_index++) {
-      low_index_3d = row_major_index_3d(
-          iz_low, elem, mass_bin_index, eagle_feedback_AGB_N_metals,
-          chemistry_element_count, eagle_feedback_N_imf_bins);
-      high_index_3d = row_major_index_3d(
-          iz_high, elem, mass_bin_index, eagle_feedback_AGB_N_metals,
-          chemistry_element_count, eagle_feedback_N_imf_bins);
-      low_index_2d = row_major_index_2d(iz_low, mass_bin_index,
-                                        eagle_feedback_AGB_N_metals,
-                                        eagle_feedback_N_imf_bins);
-      high_index_2d = row_major_index_2d(iz_high, mass_bin_index,
-                                         eagle_feedback_AGB_N_metals,
-                                         eagle_feedback_N_imf_bins);
-      stellar_yields[mass_bin_index] =
-          (1 - dz) * (props->yield_AGB.yield_IMF_resampled[low_index_3d] +
-                      sp->chemistry_data.metal_mass_fraction[elem] *
-                          props->yield_AGB.ejecta_IMF_resampled[low_index_2d]) +
-          dz * (props->yield_AGB.yield_IMF_resampled[high_index_3d] +
-                sp->chemistry_data.metal_mass_fraction[elem] *
-                    props->yield_AGB.ejecta_IMF_resampled[high_index_2d]);
-    }
-
-    metal_mass_released[elem] = integrate_imf(
-        log10_min_mass, log10_max_mass, eagle_imf_integration_yield_weight,
-        stellar_yields, props);
+    const int low_index =
+        row_major_index_3d(iz_low, elem, 0, eagle_feedback_AGB_N_metals,
+                           chemistry_element_count, N_cum);
+    const int high_index =
+        row_major_index_3d(iz_high, elem, 0, eagle_feedback_AGB_N_metals,
+                           chemistry_element_count, N_cum);
+
+    const float yield_low = integrate_imf_cumulative(
+        log10_min_mass, log10_max_mass, &table->yield_IMF_cumulative[low_index],
+        props);
+    const float yield_high = integrate_imf_cumulative(
+        log10_min_mass, log10_max_mass,
+        &table->yield_IMF_cumulative[high_index], props);
+
+    metal_mass_released[elem] =
+        (1 - dz) * (yield_low +
+                    sp->chemistry_data.metal_mass_fraction[elem] * ejecta_low) +
+        dz * (yield_high +
+              sp->chemistry_data.metal_mass_fraction[elem] * ejecta_high);
   }
 
   /* Compute mass produced */
-  for (mass_bin_index = low_imf_mass_bin_index;
-       mass_bin_index < high_imf_mass_bin_index + 1; mass_bin_index++) {
-    low_index_2d =
-        row_major_index_2d(iz_low, mass_bin_index, eagle_feedback_AGB_N_metals,
-                           eagle_feedback_N_imf_bins);
-    high_index_2d =
-        row_major_index_2d(iz_high, mass_bin_index, eagle_feedback_AGB_N_metals,
-                           eagle_feedback_N_imf_bins);
-    stellar_yields[mass_bin_index] =
-        (1 - dz) * (props->yield_AGB.total_metals_IMF_resampled[low_index_2d] +
-                    sp->chemistry_data.metal_mass_fraction_total *
-                        props->yield_AGB.ejecta_IMF_resampled[low_index_2d]) +
-        dz * (props->yield_AGB.total_metals_IMF_resampled[high_index_2d] +
-              sp->chemistry_data.metal_mass_fraction_total *
-                  props->yield_AGB.ejecta_IMF_resampled[high_index_2d]);
-  }
+  const float total_metals_low = integrate_imf_cumulative(
+      log10_min_mass, log10_max_mass,
+      &table->total_metals_IMF_cumulative[iz_low * N_cum], props);
+  const float total_metals_high = integrate_imf_cumulative(
+      log10_min_mass, log10_max_mass,
+      &table->total_metals_IMF_cumulative[iz_high * N_cum], props);
 
   metal_mass_released_total =
-      integrate_imf(log10_min_mass, log10_max_mass,
-                    eagle_imf_integration_yield_weight, stellar_yields, props);
+      (1 - dz) * (total_metals_low +
+                  sp->chemistry_data.metal_mass_fraction_total * ejecta_low) +
+      dz * (total_metals_high +
+            sp->chemistry_data.metal_mass_fraction_total * ejecta_high);
 
   /* yield normalization */
   float mass_ejected, mass_released;
@@ -636,23 +599,8 @@ INLINE static void evolve_AGB(const float log10_min_mass, float log10_max_mass,
 
   metal_mass_released_total = max(metal_mass_released_total, 0.f);
 
-  /* compute the total metal mass ejected from the star */
-  for (mass_bin_index = low_imf_mass_bin_index;
-       mass_bin_index < high_imf_mass_bin_index + 1; mass_bin_index++) {
-    low_index_2d =
-        row_major_index_2d(iz_low, mass_bin_index, eagle_feedback_AGB_N_metals,
-                           eagle_feedback_N_imf_bins);
-    high_index_2d =
-        row_major_index_2d(iz_high, mass_bin_index, eagle_feedback_AGB_N_metals,
-                           eagle_feedback_N_imf_bins);
-    stellar_yields[mass_bin_index] =
-        (1 - dz) * props->yield_AGB.ejecta_IMF_resampled[low_index_2d] +
-        dz * props->yield_AGB.ejecta_IMF_resampled[high_index_2d];
-  }
-
-  mass_ejected =
-      integrate_imf(log10_min_mass, log10_max_mass,
-                    eagle_imf_integration_yield_weight, stellar_yields, props);
+  /* compute the total mass ejected from the star */
+  mass_ejected = (1 - dz) * ejecta_low + dz * ejecta_high;
 
   /* compute the total mass released */
   mass_released = metal_mass_released_total +
@@ -703,9 +651,6 @@ void compute_stellar_evolution(const struct feedback_props* feedback_props,
   if (age < 0.f) error("Negative age for a star.");
 #endif
 
-  /* Allocate temporary array for calculating imf weights */
-  float stellar_yields[eagle_feedback_N_imf_bins];
-
   /* Convert dt and stellar age from internal units to Gyr. */
   const double Gyr_in_cgs = 1e9 * 365. * 24. * 3600.;
   const double time_to_cgs = units_cgs_conversion_factor(us, UNIT_CONV_TIME);
@@ -768,11 +713,11 @@ void compute_stellar_evolution(const struct feedback_props* feedback_props,
   }
   if (feedback_props->with_SNII_enrichment) {
     evolve_SNII(log10_min_dying_mass_Msun, log10_max_dying_mass_Msun,
-                stellar_yields, feedback_props, sp);
+                feedback_props, sp);
   }
   if (feedback_props->with_AGB_enrichment) {
     evolve_AGB(log10_min_dying_mass_Msun, log10_max_dying_mass_Msun,
-               stellar_yields, feedback_props, sp);
+               feedback_props, sp);
   }
 
 #ifdef SWIFT_DEBUG_CHECKS
@@ -862,6 +807,19 @@ void feedback_props_init(struct feedback_props* fp,
       parser_get_param_double(params, "EAGLEFeedback:SNII_wind_delay_Gyr") *
       Gyr_in_cgs / units_cgs_conversion_factor(us, UNIT_CONV_TIME);
 
+  /* Age beyond which the stars' remaining mass loss is neglected */
+  fp->stellar_evolution_age_cut =
+      parser_get_opt_param_double(
+          params, "EAGLEFeedback:stellar_evolution_age_cut_Gyr", 0.) *
+      Gyr_in_cgs / units_cgs_conversion_factor(us, UNIT_CONV_TIME);
+  fp->exhausted_birth_limit = -FLT_MAX;
+
+  if (fp->stellar_evolution_age_cut < 0.)
+    error("The stellar evolution age cut must be positive.");
+  if (fp->stellar_evolution_age_cut > 0. &&
+      fp->stellar_evolution_age_cut <= fp->SNII_wind_delay)
+    error("The stellar evolution age cut must be larger than the SNII delay.");
+
   /* Read the temperature change to use in stochastic heating */
   fp->SNe_deltaT_desired =
       parser_get_param_float(params, "EAGLEFeedback:SNII_delta_T_K");
@@ -1015,9 +973,47 @@ void feedback_props_init(struct feedback_props* fp,
    * mass bins used in IMF  */
   compute_ejecta(fp);
 
+  /* Tabulate the cumulative IMF integrals of the resampled yields */
+  compute_cumulative_yields(fp);
+
+  if (fp->stellar_evolution_age_cut > 0.)
+    message("Stars older than %e (internal units) stop doing feedback.",
+            fp->stellar_evolution_age_cut);
+
   message("initialized stellar feedback");
 }
 
+/**
+ * @brief Update the properties of the feedback model to the current time.
+ *
+ * Computes the birth time (or scale-factor) before which the stars are
+ * older than the stellar evolution age cut.
+ *
+ * @param fp The #feedback_props.
+ * @param cosmo The current cosmological model.
+ * @param time The current time (non-cosmological runs).
+ * @param with_cosmology Are we running a cosmological simulation?
+ */
+void feedback_update(struct feedback_props* fp, const struct cosmology* cosmo,
+                     const double time, const int with_cosmology) {
+
+  if (fp->stellar_evolution_age_cut == 0.) return;
+
+  if (with_cosmology) {
+
+    /* Time since the big bang at which the oldest active stars were born */
+    const double t_birth = cosmo->time - fp->stellar_evolution_age_cut;
+
+    if (t_birth <= cosmo->time_begin)
+      fp->exhausted_birth_limit = -FLT_MAX;
+    else
+      fp->exhausted_birth_limit = cosmology_get_scale_factor(cosmo, t_birth);
+
+  } else {
+    fp->exhausted_birth_limit = time - fp->stellar_evolution_age_cut;
+  }
+}
+
 /**
  * @brief Zero pointers in yield_table structs
  *
@@ -1034,6 +1030,9 @@ void zero_yield_table_pointers(struct yield_table* table) {
   table->ejecta = NULL;
   table->total_metals_IMF_resampled = NULL;
   table->total_metals = NULL;
+  table->yield_IMF_cumulative = NULL;
+  table->ejecta_IMF_cumulative = NULL;
+  table->total_metals_IMF_cumulative = NULL;
 }
 
 /**
@@ -1067,6 +1066,9 @@ void feedback_restore_tables(struct feedback_props* fp) {
   /* Resample ejecta contribution to enrichment from mass bins used in tables to
    * mass bins used in IMF  */
   compute_ejecta(fp);
+
+  /* Tabulate the cumulative IMF integrals of the resampled yields */
+  compute_cumulative_yields(fp);
 }
 
 /**
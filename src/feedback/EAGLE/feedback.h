@@ -44,19 +44,44 @@ __attribute__((always_inline)) INLINE static int feedback_do_feedback(
   return (sp->birth_time != -1.);
 }
 
+/**
+ * @brief Will this star never do any feedback again?
+ *
+ * That is the case of the stars present in the ICs and of the ones older than
+ * the stellar evolution age cut, whose remaining mass loss is neglected.
+ *
+ * @param sp The #spart.
+ * @param feedback_props The properties of the feedback model.
+ * @param with_cosmology Are we doing a cosmological run?
+ */
+__attribute__((always_inline)) INLINE static int feedback_is_exhausted(
+    const struct spart* sp, const struct feedback_props* feedback_props,
+    const int with_cosmology) {
+
+  if (sp->birth_time == -1.) return 1;
+  if (feedback_props->stellar_evolution_age_cut == 0.) return 0;
+
+  if (with_cosmology) {
+    return sp->birth_scale_factor < feedback_props->exhausted_birth_limit;
+  } else {
+    return sp->birth_time < feedback_props->exhausted_birth_limit;
+  }
+}
+
 /**
  * @brief Should this particle be doing any feedback-related operation?
  *
  * @param sp The #spart.
+ * @param feedback_props The properties of the feedback model.
  * @param time The current simulation time (Non-cosmological runs).
  * @param cosmo The cosmological model (cosmological runs).
  * @param with_cosmology Are we doing a cosmological run?
  */
 __attribute__((always_inline)) INLINE static int feedback_is_active(
-    const struct spart* sp, const float time, const struct cosmology* cosmo,
-    const int with_cosmology) {
+    const struct spart* sp, const struct feedback_props* feedback_props,
+    const float time, const struct cosmology* cosmo, const int with_cosmology) {
 
-  if (sp->birth_time == -1.) return 0;
+  if (feedback_is_exhausted(sp, feedback_props, with_cosmology)) return 0;
 
   if (with_cosmology) {
     return ((float)cosmo->a) > sp->birth_scale_factor;
@@ -172,6 +197,9 @@ __attribute__((always_inline)) INLINE static void feedback_evolve_spart(
   sp->mass -= sp->feedback_data.to_distribute.mass;
 }
 
+void feedback_update(struct feedback_props* fp, const struct cosmology* cosmo,
+                     const double time, const int with_cosmology);
+
 void feedback_struct_dump(const struct feedback_props* feedback, FILE* stream);
 
 void feedback_struct_restore(struct feedback_props* feedback, FILE* stream);
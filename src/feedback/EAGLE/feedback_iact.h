@@ -166,64 +166,64 @@ runner_iact_nonsym_feedback_apply(const float r2, const float *dx,
 
   /* Update mass fraction from SNIa  */
   const double current_mass_from_SNIa =
-      pj->chemistry_data.mass_from_SNIa * current_mass;
+      xpj->chemistry_data.mass_from_SNIa * current_mass;
   const double delta_mass_from_SNIa =
       si->feedback_data.to_distribute.mass_from_SNIa * Omega_frac;
   const double new_mass_from_SNIa =
       current_mass_from_SNIa + delta_mass_from_SNIa;
 
-  pj->chemistry_data.mass_from_SNIa = new_mass_from_SNIa * new_mass_inv;
+  xpj->chemistry_data.mass_from_SNIa = new_mass_from_SNIa * new_mass_inv;
 
   /* Update metal mass fraction from SNIa */
   const double current_metal_mass_from_SNIa =
-      pj->chemistry_data.metal_mass_fraction_from_SNIa * current_mass;
+      xpj->chemistry_data.metal_mass_fraction_from_SNIa * current_mass;
   const double delta_metal_mass_from_SNIa =
       si->feedback_data.to_distribute.metal_mass_from_SNIa * Omega_frac;
   const double new_metal_mass_from_SNIa =
       current_metal_mass_from_SNIa + delta_metal_mass_from_SNIa;
 
-  pj->chemistry_data.metal_mass_fraction_from_SNIa =
+  xpj->chemistry_data.metal_mass_fraction_from_SNIa =
       new_metal_mass_from_SNIa * new_mass_inv;
 
   /* Update mass fraction from SNII  */
   const double current_mass_from_SNII =
-      pj->chemistry_data.mass_from_SNII * current_mass;
+      xpj->chemistry_data.mass_from_SNII * current_mass;
   const double delta_mass_from_SNII =
       si->feedback_data.to_distribute.mass_from_SNII * Omega_frac;
   const double new_mass_from_SNII =
       current_mass_from_SNII + delta_mass_from_SNII;
 
-  pj->chemistry_data.mass_from_SNII = new_mass_from_SNII * new_mass_inv;
+  xpj->chemistry_data.mass_from_SNII = new_mass_from_SNII * new_mass_inv;
 
   /* Update metal mass fraction from SNII */
   const double current_metal_mass_from_SNII =
-      pj->chemistry_data.metal_mass_fraction_from_SNII * current_mass;
+      xpj->chemistry_data.metal_mass_fraction_from_SNII * current_mass;
   const double delta_metal_mass_from_SNII =
       si->feedback_data.to_distribute.metal_mass_from_SNII * Omega_frac;
   const double new_metal_mass_from_SNII =
       current_metal_mass_from_SNII + delta_metal_mass_from_SNII;
 
-  pj->chemistry_data.metal_mass_fraction_from_SNII =
+  xpj->chemistry_data.metal_mass_fraction_from_SNII =
       new_metal_mass_from_SNII * new_mass_inv;
 
   /* Update mass fraction from AGB  */
   const double current_mass_from_AGB =
-      pj->chemistry_data.mass_from_AGB * current_mass;
+      xpj->chemistry_data.mass_from_AGB * current_mass;
   const double delta_mass_from_AGB =
       si->feedback_data.to_distribute.mass_from_AGB * Omega_frac;
   const double new_mass_from_AGB = current_mass_from_AGB + delta_mass_from_AGB;
 
-  pj->chemistry_data.mass_from_AGB = new_mass_from_AGB * new_mass_inv;
+  xpj->chemistry_data.mass_from_AGB = new_mass_from_AGB * new_mass_inv;
 
   /* Update metal mass fraction from AGB */
   const double current_metal_mass_from_AGB =
-      pj->chemistry_data.metal_mass_fraction_from_AGB * current_mass;
+      xpj->chemistry_data.metal_mass_fraction_from_AGB * current_mass;
   const double delta_metal_mass_from_AGB =
       si->feedback_data.to_distribute.metal_mass_from_AGB * Omega_frac;
   const double new_metal_mass_from_AGB =
       current_metal_mass_from_AGB + delta_metal_mass_from_AGB;
 
-  pj->chemistry_data.metal_mass_fraction_from_AGB =
+  xpj->chemistry_data.metal_mass_fraction_from_AGB =
       new_metal_mass_from_AGB * new_mass_inv;
 
   /* Compute the current kinetic energy */
@@ -50,6 +50,15 @@ struct yield_table {
 
   /* Array to store table of total mass released being read in */
   double *total_metals;
+
+  /* Cumulative IMF-weighted integrals of yield_IMF_resampled */
+  double *yield_IMF_cumulative;
+
+  /* Cumulative IMF-weighted integrals of ejecta_IMF_resampled */
+  double *ejecta_IMF_cumulative;
+
+  /* Cumulative IMF-weighted integrals of total_metals_IMF_resampled */
+  double *total_metals_IMF_cumulative;
 };
 
 /**
@@ -90,6 +99,14 @@ struct feedback_props {
   /*! Are we doing SNIa feedback? */
   int with_SNIa_feedback;
 
+  /*! Age beyond which stars stop doing feedback (internal units, 0 for never)
+   */
+  double stellar_evolution_age_cut;
+
+  /*! Birth time (or scale-factor) before which stars are currently older than
+   * stellar_evolution_age_cut */
+  double exhausted_birth_limit;
+
   /* ------------ Yield tables    ----------------- */
 
   /* Yield tables for AGB and SNII  */
@@ -190,6 +190,130 @@ INLINE static float integrate_imf(const float log10_min_mass,
   return result * imf_log10_mass_bin_size * ((float)M_LN10);
 }
 
+/**
+ * @brief Tabulate the cumulative integral of the IMF weighted by some yields
+ * from the lowest IMF mass bin.
+ *
+ * integrate_imf() weighs each half of a mass bin by the integrand at the
+ * nearest bin edge, so the integral from the start of the IMF is piecewise
+ * linear with kinks at the bin edges and centres. We store it at these nodes
+ * and integrate_imf(m_min, m_max) is then the difference between
+ * cumulative_imf_integral() at m_max and m_min.
+ *
+ * @param yields The yields on the IMF mass bins.
+ * @param cumulative (return) The #eagle_feedback_N_imf_cumulative values of
+ * the integral.
+ * @param feedback_props the #feedback_props data structure
+ */
+INLINE static void compute_cumulative_imf_integral(
+    const double *yields, double *cumulative,
+    const struct feedback_props *feedback_props) {
+
+  const float *imf = feedback_props->imf;
+  const float *imf_mass_bin = feedback_props->imf_mass_bin;
+
+  /* Width of half a bin in the units used by integrate_imf() */
+  const double half_bin =
+      0.5 *
+      (feedback_props->imf_mass_bin_log10[1] -
+       feedback_props->imf_mass_bin_log10[0]) *
+      M_LN10;
+
+  cumulative[0] = 0.;
+  for (int i = 0; i < eagle_feedback_N_imf_bins - 1; i++) {
+    const double left = yields[i] * imf[i] * imf_mass_bin[i];
+    const double right = yields[i + 1] * imf[i + 1] * imf_mass_bin[i + 1];
+    cumulative[2 * i + 1] = cumulative[2 * i] + half_bin * left;
+    cumulative[2 * i + 2] = cumulative[2 * i + 1] + half_bin * right;
+  }
+}
+
+/**
+ * @brief Evaluate a cumulative IMF integral tabulated by
+ * compute_cumulative_imf_integral().
+ *
+ * Masses outside the IMF range are extrapolated the same way as in
+ * integrate_imf().
+ *
+ * @param cumulative The tabulated integral.
+ * @param log10_mass log10 of the upper integration bound.
+ * @param feedback_props the #feedback_props data structure
+ */
+INLINE static double cumulative_imf_integral(
+    const double *cumulative, const float log10_mass,
+    const struct feedback_props *feedback_props) {
+
+  const float *imf_mass_bin_log10 = feedback_props->imf_mass_bin_log10;
+
+  /* Position in units of half a bin */
+  const double x = 2. * (log10_mass - imf_mass_bin_log10[0]) /
+                   (imf_mass_bin_log10[1] - imf_mass_bin_log10[0]);
+  int i = (int)floor(x);
+  i = max(i, 0);
+  i = min(i, eagle_feedback_N_imf_cumulative - 2);
+
+  return cumulative[i] + (x - i) * (cumulative[i + 1] - cumulative[i]);
+}
+
+/**
+ * @brief Integrate the IMF weighted by some yields between a minimum and
+ * maximum mass using their tabulated cumulative integral.
+ *
+ * Gives the same result as integrate_imf() with the yield weighting but
+ * without looping over the IMF mass bins.
+ *
+ * @param log10_min_mass log10 mass lower integration bound
+ * @param log10_max_mass log10 mass upper integration bound
+ * @param cumulative The integral tabulated by
+ * compute_cumulative_imf_integral().
+ * @param feedback_props the #feedback_props data structure
+ */
+INLINE static float integrate_imf_cumulative(
+    const float log10_min_mass, const float log10_max_mass,
+    const double *cumulative, const struct feedback_props *feedback_props) {
+
+  return cumulative_imf_integral(cumulative, log10_max_mass, feedback_props) -
+         cumulative_imf_integral(cumulative, log10_min_mass, feedback_props);
+}
+
+/**
+ * @brief Tabulate the cumulative IMF integrals of the SNII and AGB yields,
+ * ejecta and total metals for every metallicity bin of the tables.
+ *
+ * Has to be called after the yields have been resampled on the IMF bins.
+ *
+ * @param feedback_props #feedback_props data structure
+ */
+INLINE static void compute_cumulative_yields(
+    struct feedback_props *feedback_props) {
+
+  const int N_imf = eagle_feedback_N_imf_bins;
+  const int N_cum = eagle_feedback_N_imf_cumulative;
+
+  struct yield_table *tables[2] = {&feedback_props->yield_SNII,
+                                   &feedback_props->yield_AGB};
+  const int N_metals[2] = {eagle_feedback_SNII_N_metals,
+                           eagle_feedback_AGB_N_metals};
+
+  for (int t = 0; t < 2; t++) {
+    struct yield_table *table = tables[t];
+    for (int iz = 0; iz < N_metals[t]; iz++) {
+      for (int elem = 0; elem < chemistry_element_count; elem++) {
+        const int row = iz * chemistry_element_count + elem;
+        compute_cumulative_imf_integral(
+            &table->yield_IMF_resampled[row * N_imf],
+            &table->yield_IMF_cumulative[row * N_cum], feedback_props);
+      }
+      compute_cumulative_imf_integral(&table->ejecta_IMF_resampled[iz * N_imf],
+                                      &table->ejecta_IMF_cumulative[iz * N_cum],
+                                      feedback_props);
+      compute_cumulative_imf_integral(
+          &table->total_metals_IMF_resampled[iz * N_imf],
+          &table->total_metals_IMF_cumulative[iz * N_cum], feedback_props);
+    }
+  }
+}
+
 /**
  * @brief Allocate space for IMF table and compute values to populate this
  * table.
@@ -31,6 +31,9 @@ static const float log10_min_metallicity = -20;
 /*! Number of bins used to define the IMF */
 #define eagle_feedback_N_imf_bins 200
 
+/*! Number of nodes of the cumulative IMF integrals (bin edges and centres) */
+#define eagle_feedback_N_imf_cumulative (2 * eagle_feedback_N_imf_bins - 1)
+
 /*! Number of elements considered for the SNIa yields */
 #define eagle_feedback_SNIa_N_elements 42
 
@@ -549,6 +552,43 @@ INLINE static void allocate_yield_tables(
     error("Failed to allocate SNII total metals IMF resampled array");
   }
 
+  /* Allocate arrays to store the cumulative IMF integrals of the yields */
+  const size_t N_cum = eagle_feedback_N_imf_cumulative;
+  if (swift_memalign("feedback-tables",
+                     (void **)&feedback_props->yield_AGB.yield_IMF_cumulative,
+                     SWIFT_STRUCT_ALIGNMENT,
+                     eagle_feedback_AGB_N_metals * N_cum *
+                         chemistry_element_count * sizeof(double)) != 0 ||
+      swift_memalign("feedback-tables",
+                     (void **)&feedback_props->yield_AGB.ejecta_IMF_cumulative,
+                     SWIFT_STRUCT_ALIGNMENT,
+                     eagle_feedback_AGB_N_metals * N_cum * sizeof(double)) !=
+          0 ||
+      swift_memalign(
+          "feedback-tables",
+          (void **)&feedback_props->yield_AGB.total_metals_IMF_cumulative,
+          SWIFT_STRUCT_ALIGNMENT,
+          eagle_feedback_AGB_N_metals * N_cum * sizeof(double)) != 0) {
+    error("Failed to allocate AGB cumulative IMF integral arrays");
+  }
+  if (swift_memalign("feedback-tables",
+                     (void **)&feedback_props->yield_SNII.yield_IMF_cumulative,
+                     SWIFT_STRUCT_ALIGNMENT,
+                     eagle_feedback_SNII_N_metals * N_cum *
+                         chemistry_element_count * sizeof(double)) != 0 ||
+      swift_memalign("feedback-tables",
+                     (void **)&feedback_props->yield_SNII.ejecta_IMF_cumulative,
+                     SWIFT_STRUCT_ALIGNMENT,
+                     eagle_feedback_SNII_N_metals * N_cum * sizeof(double)) !=
+          0 ||
+      swift_memalign(
+          "feedback-tables",
+          (void **)&feedback_props->yield_SNII.total_metals_IMF_cumulative,
+          SWIFT_STRUCT_ALIGNMENT,
+          eagle_feedback_SNII_N_metals * N_cum * sizeof(double)) != 0) {
+    error("Failed to allocate SNII cumulative IMF integral arrays");
+  }
+
   /* Allocate array for lifetimes mass bins */
   if (swift_memalign("feedback-tables",
                      (void **)&feedback_props->lifetimes.mass,
@@ -45,6 +45,23 @@ __attribute__((always_inline)) INLINE static int feedback_do_feedback(
   return 0;
 }
 
+/**
+ * @brief Will this star never do any feedback again?
+ *
+ * Note: Since this 'none' feedback mode is used for testing the neighbour
+ * loops only, stars are never exhausted.
+ *
+ * @param sp The #spart.
+ * @param feedback_props The properties of the feedback model.
+ * @param with_cosmology Are we doing a cosmological run?
+ */
+__attribute__((always_inline)) INLINE static int feedback_is_exhausted(
+    const struct spart* sp, const struct feedback_props* feedback_props,
+    const int with_cosmology) {
+
+  return 0;
+}
+
 /**
  * @brief Should this particle be doing any feedback-related operation?
  *
@@ -53,13 +70,14 @@ __attribute__((always_inline)) INLINE static int feedback_do_feedback(
  * or of the system's state.
  *
  * @param sp The #spart.
+ * @param feedback_props The properties of the feedback model.
  * @param time The current simulation time (Non-cosmological runs).
  * @param cosmo The cosmological model (cosmological runs).
  * @param with_cosmology Are we doing a cosmological run?
  */
 __attribute__((always_inline)) INLINE static int feedback_is_active(
-    const struct spart* sp, const float time, const struct cosmology* cosmo,
-    const int with_cosmology) {
+    const struct spart* sp, const struct feedback_props* feedback_props,
+    const float time, const struct cosmology* cosmo, const int with_cosmology) {
 
   return 1;
 }
@@ -114,6 +132,21 @@ __attribute__((always_inline)) INLINE static void feedback_evolve_spart(
     const struct cosmology* cosmo, const struct unit_system* us,
     const double star_age_beg_step, const double dt) {}
 
+/**
+ * @brief Update the properties of the feedback model to the current time.
+ *
+ * Nothing to do here.
+ *
+ * @param fp The #feedback_props.
+ * @param cosmo The current cosmological model.
+ * @param time The current time (non-cosmological runs).
+ * @param with_cosmology Are we running a cosmological simulation?
+ */
+static INLINE void feedback_update(struct feedback_props* fp,
+                                   const struct cosmology* cosmo,
+                                   const double time,
+                                   const int with_cosmology) {}
+
 /**
  * @brief Write a feedback struct to the given FILE as a stream of bytes.
  *
@@ -22,6 +22,7 @@
 
 /* Some standard headers. */
 #include <errno.h>
+#include <float.h>
 #include <libgen.h>
 #include <unistd.h>
 
@@ -30,13 +31,20 @@
 #include <mpi.h>
 #endif
 
+/* HDF5 headers. */
+#if defined(HAVE_HDF5)
+#include <hdf5.h>
+#endif
+
 /* This object's header. */
 #include "fof.h"
 
 /* Local headers. */
 #include "black_holes.h"
 #include "common_io.h"
+#include "concurrent_hashmap.h"
 #include "engine.h"
+#include "fof_cache.h"
 #include "hashmap.h"
 #include "memuse.h"
 #include "proxy.h"
@@ -45,6 +53,7 @@
 #define fof_props_default_group_id 2147483647
 #define fof_props_default_group_id_offset 1
 #define fof_props_default_group_link_size 20000
+#define fof_props_default_incremental_drift_fraction 0.1
 
 /* Constants. */
 #define UNION_BY_SIZE_OVER_MPI (1)
@@ -66,6 +75,9 @@ MPI_Datatype fof_mpi_type;
 MPI_Datatype group_length_mpi_type;
 MPI_Datatype fof_final_index_type;
 MPI_Datatype fof_final_mass_type;
+MPI_Datatype fof_final_moments_type;
+MPI_Datatype fof_mpi_label_type;
+MPI_Datatype fof_mpi_label_update_type;
 
 /*! Offset between the first particle on this MPI rank and the first particle in
  * the global order */
@@ -132,6 +144,23 @@ void fof_init(struct fof_props *props, struct swift_params *params,
   /* Convert to internal units */
   props->seed_halo_mass *= phys_const->const_solar_mass;
 
+  /* Are we re-using the previous catalogue in the regions that did not move? */
+  props->incremental_search =
+      parser_get_opt_param_int(params, "FOF:incremental_search", 0);
+
+  /* Read the fraction of the linking length particles can move before their
+   * cell has to be searched again */
+  props->incremental_drift_fraction = parser_get_opt_param_double(
+      params, "FOF:incremental_drift_fraction",
+      fof_props_default_incremental_drift_fraction);
+
+  if (props->incremental_drift_fraction <= 0.)
+    error("The FOF incremental drift fraction must be positive!");
+
+  props->nr_cells_searched = 0;
+  props->ti_cell_searched = NULL;
+  props->cell_needs_search = NULL;
+
 #if defined(WITH_MPI) && defined(UNION_BY_SIZE_OVER_MPI)
   if (engine_rank == 0)
     message(
@@ -170,6 +199,23 @@ void fof_create_mpi_types() {
       MPI_Type_commit(&fof_final_mass_type) != MPI_SUCCESS) {
     error("Failed to create MPI type for fof_final_mass.");
   }
+  /* Define type for sending fof_final_moments struct */
+  if (MPI_Type_contiguous(sizeof(struct fof_final_moments), MPI_BYTE,
+                          &fof_final_moments_type) != MPI_SUCCESS ||
+      MPI_Type_commit(&fof_final_moments_type) != MPI_SUCCESS) {
+    error("Failed to create MPI type for fof_final_moments.");
+  }
+  /* Define types for the distributed union-find over MPI ranks */
+  if (MPI_Type_contiguous(sizeof(struct fof_mpi_label), MPI_BYTE,
+                          &fof_mpi_label_type) != MPI_SUCCESS ||
+      MPI_Type_commit(&fof_mpi_label_type) != MPI_SUCCESS) {
+    error("Failed to create MPI type for fof_mpi_label.");
+  }
+  if (MPI_Type_contiguous(sizeof(struct fof_mpi_label_update), MPI_BYTE,
+                          &fof_mpi_label_update_type) != MPI_SUCCESS ||
+      MPI_Type_commit(&fof_mpi_label_update_type) != MPI_SUCCESS) {
+    error("Failed to create MPI type for fof_mpi_label_update.");
+  }
 #else
   error("Calling an MPI function in non-MPI code.");
 #endif
@@ -233,12 +279,6 @@ void fof_allocate(const struct space *s, const long long total_nr_DM_particles,
                      nr_local_gparts * sizeof(size_t)) != 0)
     error("Failed to allocate list of group size for FOF search.");
 
-  /* Set initial group ID of the gparts */
-  const size_t group_id_default = props->group_id_default;
-  for (size_t i = 0; i < nr_local_gparts; i++) {
-    gparts[i].group_id = group_id_default;
-  }
-
   /* Set initial group index and group size */
   size_t *group_index = props->group_index;
   size_t *group_size = props->group_size;
@@ -247,6 +287,16 @@ void fof_allocate(const struct space *s, const long long total_nr_DM_particles,
     group_size[i] = 1;
   }
 
+  /* Seed the groups with the previous catalogue where nothing moved. This
+   * must happen before we reset the group IDs. */
+  if (props->incremental_search) fof_prepare_incremental_search(props, s);
+
+  /* Set initial group ID of the gparts */
+  const size_t group_id_default = props->group_id_default;
+  for (size_t i = 0; i < nr_local_gparts; i++) {
+    gparts[i].group_id = group_id_default;
+  }
+
 #ifdef SWIFT_DEBUG_CHECKS
   ti_current = s->e->ti_current;
 #endif
@@ -311,6 +361,27 @@ int compare_fof_final_mass_global_root(const void *a, const void *b) {
     return 0;
 }
 
+/**
+ * @brief Comparison function for qsort call comparing group global roots
+ *
+ * @param a The first #fof_final_moments object.
+ * @param b The second #fof_final_moments object.
+ * @return 1 if the global of the group b is *smaller* than the global group of
+ * group a, -1 if a is the smaller one and 0 if they are equal.
+ */
+int compare_fof_final_moments_global_root(const void *a, const void *b) {
+  const struct fof_final_moments *moments_a =
+      (const struct fof_final_moments *)a;
+  const struct fof_final_moments *moments_b =
+      (const struct fof_final_moments *)b;
+  if (moments_b->global_root < moments_a->global_root)
+    return 1;
+  else if (moments_b->global_root > moments_a->global_root)
+    return -1;
+  else
+    return 0;
+}
+
 /**
  * @brief Check whether a given group ID is on the local node.
  *
@@ -510,6 +581,265 @@ __attribute__((always_inline)) INLINE static void fof_union(
   } while (result != 1);
 }
 
+/* Data shared by the mappers preparing an incremental search */
+struct fof_incremental_data {
+
+  /*! The #space we are searching. */
+  const struct space *s;
+
+  /*! The properties of the FOF scheme. */
+  struct fof_props *props;
+
+  /*! Has each top-level cell moved since it was last searched? */
+  char *moved;
+
+  /*! First particle (index) found in each group of the previous catalogue. */
+  size_t *seed_root;
+
+  /*! Number of groups in the previous catalogue. */
+  size_t num_prev_groups;
+};
+
+/**
+ * @brief Mapper function flagging the top-level cells whose particles may have
+ * moved by more than a fraction of the linking length since they were last
+ * searched.
+ *
+ * The displacement is estimated from the current velocities, we do not keep
+ * track of the positions at the time of the last search.
+ *
+ * @param map_data The top-level cell indices (offsets from NULL).
+ * @param num_elements The number of cells to treat.
+ * @param extra_data Pointer to a #fof_incremental_data.
+ */
+void fof_flag_moved_cells_mapper(void *map_data, int num_elements,
+                                 void *extra_data) {
+
+  const struct fof_incremental_data *data =
+      (struct fof_incremental_data *)extra_data;
+  const struct space *s = data->s;
+  const struct engine *e = s->e;
+  const struct fof_props *props = data->props;
+  const int with_cosmology = (e->policy & engine_policy_cosmology);
+  const integertime_t ti_now = e->ti_current;
+  const double max_dx =
+      props->incremental_drift_fraction * sqrt(props->l_x2);
+
+  for (int ind = 0; ind < num_elements; ind++) {
+
+    const int cid = (size_t)(map_data) + ind;
+    const struct cell *c = &s->cells_top[cid];
+
+    /* We know nothing about the foreign cells */
+    if (c->nodeID != e->nodeID) {
+      data->moved[cid] = 1;
+      continue;
+    }
+
+    /* Find the largest velocity in the cell */
+    float v2_max = 0.f;
+    for (int k = 0; k < c->grav.count; k++) {
+      const struct gpart *gp = &c->grav.parts[k];
+      if (gp->time_bin >= time_bin_inhibited) continue;
+      const float v2 = gp->v_full[0] * gp->v_full[0] +
+                       gp->v_full[1] * gp->v_full[1] +
+                       gp->v_full[2] * gp->v_full[2];
+      v2_max = max(v2_max, v2);
+    }
+
+    /* Time since the last search of this cell */
+    const integertime_t ti_old = props->ti_cell_searched[cid];
+    double dt_drift;
+    if (with_cosmology)
+      dt_drift = cosmology_get_drift_factor(e->cosmology, ti_old, ti_now);
+    else
+      dt_drift = (ti_now - ti_old) * e->time_base;
+
+    data->moved[cid] = (sqrtf(v2_max) * dt_drift > max_dx);
+  }
+}
+
+/**
+ * @brief Mapper function deciding which top-level cells need to be searched.
+ *
+ * A cell is searched if it or any of its neighbours moved. The cells that are
+ * searched have their search time updated.
+ *
+ * @param map_data The top-level cell indices (offsets from NULL).
+ * @param num_elements The number of cells to treat.
+ * @param extra_data Pointer to a #fof_incremental_data.
+ */
+void fof_flag_search_cells_mapper(void *map_data, int num_elements,
+                                  void *extra_data) {
+
+  const struct fof_incremental_data *data =
+      (struct fof_incremental_data *)extra_data;
+  const struct space *s = data->s;
+  struct fof_props *props = data->props;
+  const int *cdim = s->cdim;
+  const int periodic = s->periodic;
+
+  for (int ind = 0; ind < num_elements; ind++) {
+
+    const int cid = (size_t)(map_data) + ind;
+    const int i = cid / (cdim[1] * cdim[2]);
+    const int j = (cid / cdim[2]) % cdim[1];
+    const int k = cid % cdim[2];
+
+    char needs_search = 0;
+
+    /* Loop over the cell and its neighbours */
+    for (int ii = -1; ii < 2 && !needs_search; ii++) {
+      int iii = i + ii;
+      if (!periodic && (iii < 0 || iii >= cdim[0])) continue;
+      iii = (iii + cdim[0]) % cdim[0];
+      for (int jj = -1; jj < 2 && !needs_search; jj++) {
+        int jjj = j + jj;
+        if (!periodic && (jjj < 0 || jjj >= cdim[1])) continue;
+        jjj = (jjj + cdim[1]) % cdim[1];
+        for (int kk = -1; kk < 2 && !needs_search; kk++) {
+          int kkk = k + kk;
+          if (!periodic && (kkk < 0 || kkk >= cdim[2])) continue;
+          kkk = (kkk + cdim[2]) % cdim[2];
+
+          needs_search = data->moved[cell_getid(cdim, iii, jjj, kkk)];
+        }
+      }
+    }
+
+    props->cell_needs_search[cid] = needs_search;
+    if (needs_search) props->ti_cell_searched[cid] = s->e->ti_current;
+  }
+}
+
+/**
+ * @brief Mapper function linking the particles of the cells that will not be
+ * searched to the other members of their group in the previous catalogue.
+ *
+ * @param map_data The top-level cell indices (offsets from NULL).
+ * @param num_elements The number of cells to treat.
+ * @param extra_data Pointer to a #fof_incremental_data.
+ */
+void fof_seed_from_catalogue_mapper(void *map_data, int num_elements,
+                                    void *extra_data) {
+
+  const struct fof_incremental_data *data =
+      (struct fof_incremental_data *)extra_data;
+  const struct space *s = data->s;
+  const struct fof_props *props = data->props;
+  const size_t group_id_offset = props->group_id_offset;
+  size_t *group_index = props->group_index;
+
+  for (int ind = 0; ind < num_elements; ind++) {
+
+    const int cid = (size_t)(map_data) + ind;
+    const struct cell *c = &s->cells_top[cid];
+
+    if (c->nodeID != s->e->nodeID || props->cell_needs_search[cid]) continue;
+
+    const size_t first = c->grav.parts - s->gparts;
+    for (int k = 0; k < c->grav.count; k++) {
+
+      const struct gpart *gp = &c->grav.parts[k];
+      if (gp->time_bin >= time_bin_inhibited) continue;
+
+      /* Particles that were not in a group are not seeded (this also skips
+       * the default group ID) */
+      if (gp->group_id < group_id_offset ||
+          gp->group_id - group_id_offset >= data->num_prev_groups)
+        continue;
+
+      /* Register as the first member of the group or link to it */
+      size_t root = first + k;
+      const size_t first_member =
+          atomic_cas(&data->seed_root[gp->group_id - group_id_offset],
+                     (size_t)-1, root);
+      if (first_member != (size_t)-1)
+        fof_union(&root, first_member, group_index);
+    }
+  }
+}
+
+/**
+ * @brief Prepare an incremental FOF search.
+ *
+ * We flag the top-level cells whose particles may have moved by more than
+ * #fof_props::incremental_drift_fraction times the linking length since they
+ * were last searched. Only these cells, their neighbours and the pairs they
+ * form are searched again. The particles of the other cells are linked to the
+ * members of their group in the previous catalogue before the search starts.
+ *
+ * This is an approximation: groups that only split in the regions that were
+ * searched again are not split in the rest of the volume.
+ *
+ * Everything is searched if there is no previous catalogue (first call,
+ * restart or change of the top-level grid).
+ *
+ * @param props The properties of the FOF scheme.
+ * @param s The #space to act on.
+ */
+void fof_prepare_incremental_search(struct fof_props *props,
+                                    const struct space *s) {
+
+  const struct engine *e = s->e;
+  const int nr_cells = s->nr_cells;
+  const ticks tic = getticks();
+
+  props->cell_needs_search = (char *)malloc(nr_cells * sizeof(char));
+  if (props->cell_needs_search == NULL)
+    error("Failed to allocate the FOF cell search flags.");
+
+  /* No usable catalogue? Search everything. */
+  if (props->ti_cell_searched == NULL || props->nr_cells_searched != nr_cells) {
+
+    free(props->ti_cell_searched);
+    props->ti_cell_searched =
+        (integertime_t *)malloc(nr_cells * sizeof(integertime_t));
+    if (props->ti_cell_searched == NULL)
+      error("Failed to allocate the FOF cell search times.");
+    props->nr_cells_searched = nr_cells;
+
+    for (int k = 0; k < nr_cells; k++) {
+      props->cell_needs_search[k] = 1;
+      props->ti_cell_searched[k] = e->ti_current;
+    }
+    return;
+  }
+
+  struct fof_incremental_data data;
+  data.s = s;
+  data.props = props;
+  data.num_prev_groups = props->num_groups;
+  data.moved = (char *)malloc(nr_cells * sizeof(char));
+  data.seed_root =
+      (size_t *)malloc(max(data.num_prev_groups, (size_t)1) * sizeof(size_t));
+  if (data.moved == NULL || data.seed_root == NULL)
+    error("Failed to allocate memory for the incremental FOF search.");
+  memset(data.seed_root, 0xff, data.num_prev_groups * sizeof(size_t));
+
+  /* Find the cells that need a new search */
+  threadpool_map(&s->e->threadpool, fof_flag_moved_cells_mapper, NULL,
+                 nr_cells, 1, 0, &data);
+  threadpool_map(&s->e->threadpool, fof_flag_search_cells_mapper, NULL,
+                 nr_cells, 1, 0, &data);
+
+  /* Link the particles of the others using the previous catalogue */
+  threadpool_map(&s->e->threadpool, fof_seed_from_catalogue_mapper, NULL,
+                 nr_cells, 1, 0, &data);
+
+  if (e->verbose) {
+    int nr_searched = 0;
+    for (int k = 0; k < nr_cells; k++)
+      nr_searched += props->cell_needs_search[k];
+    message("%d/%d top-level cells need a new search. Preparing took: %.3f %s.",
+            nr_searched, nr_cells, clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+  }
+
+  free(data.moved);
+  free(data.seed_root);
+}
+
 /**
  * @brief Compute th minimal distance between any two points in two cells.
  *
@@ -657,99 +987,348 @@ __attribute__((always_inline)) INLINE static void fof_compute_send_recv_offsets(
   for (int i = 0; i < nr_nodes; i++) (*nrecv) += (*recvcount)[i];
 }
 
-#endif /* WITH_MPI */
+/**
+ * @brief The send/recv pattern of one all-to-all exchange of the distributed
+ * union-find.
+ */
+struct fof_mpi_exchange {
+
+  /*! Number of elements sent to/received from each rank. */
+  int *sendcount, *recvcount;
+
+  /*! Offsets of each rank's elements in the send/recv buffers. */
+  int *sendoffset, *recvoffset;
+
+  /*! Position of each element in the send buffer. */
+  size_t *send_pos;
+
+  /*! Total number of elements received. */
+  size_t nrecv;
+};
 
 /**
- * @brief Perform a FOF search using union-find on a given leaf-cell
+ * @brief Build the send/recv pattern for a list of elements with known
+ * destination ranks.
  *
- * @param props The properties fof the FOF scheme.
- * @param l_x2 The square of the FOF linking length.
- * @param space_gparts The start of the #gpart array in the #space structure.
- * @param c The #cell in which to perform FOF.
+ * The same pattern can be used in reverse (swapping the send and recv
+ * arguments of MPI_Alltoallv) to return one answer per element received.
+ *
+ * @param ex The #fof_mpi_exchange to construct.
+ * @param dest The destination rank of each element.
+ * @param nr_elements The number of elements to send.
+ * @param nr_nodes The number of MPI ranks.
  */
-void fof_search_self_cell(const struct fof_props *props, const double l_x2,
-                          const struct gpart *const space_gparts,
-                          struct cell *c) {
+static void fof_mpi_exchange_init(struct fof_mpi_exchange *ex, const int *dest,
+                                  const size_t nr_elements,
+                                  const int nr_nodes) {
 
-#ifdef SWIFT_DEBUG_CHECKS
-  if (c->split) error("Performing the FOF search at a non-leaf level!");
-#endif
+  ex->sendcount = (int *)calloc(nr_nodes, sizeof(int));
+  ex->send_pos = (size_t *)malloc(nr_elements * sizeof(size_t));
+  int *fill = (int *)malloc(nr_nodes * sizeof(int));
+  if (ex->sendcount == NULL || ex->send_pos == NULL || fill == NULL)
+    error("Error while allocating memory for a FOF exchange");
 
-  const size_t count = c->grav.count;
-  struct gpart *gparts = c->grav.parts;
+  for (size_t k = 0; k < nr_elements; k++) ex->sendcount[dest[k]]++;
 
-  /* Index of particles in the global group list */
-  size_t *group_index = props->group_index;
+  fof_compute_send_recv_offsets(nr_nodes, ex->sendcount, &ex->recvcount,
+                                &ex->sendoffset, &ex->recvoffset, &ex->nrecv);
 
-  /* Make a list of particle offsets into the global gparts array. */
-  size_t *const offset = group_index + (ptrdiff_t)(gparts - space_gparts);
+  /* Place the elements rank by rank in the send buffer */
+  memcpy(fill, ex->sendoffset, nr_nodes * sizeof(int));
+  for (size_t k = 0; k < nr_elements; k++) ex->send_pos[k] = fill[dest[k]]++;
 
-  if (c->nodeID != engine_rank)
-    error("Performing self FOF search on foreign cell.");
+  free(fill);
+}
 
-  /* Loop over particles and find which particles belong in the same group. */
-  for (size_t i = 0; i < count; i++) {
+/**
+ * @brief Free the memory used by a #fof_mpi_exchange.
+ *
+ * @param ex The #fof_mpi_exchange to clean.
+ */
+static void fof_mpi_exchange_clean(struct fof_mpi_exchange *ex) {
 
-    struct gpart *pi = &gparts[i];
+  free(ex->sendcount);
+  free(ex->recvcount);
+  free(ex->sendoffset);
+  free(ex->recvoffset);
+  free(ex->send_pos);
+}
 
-    /* Ignore inhibited particles */
-    if (pi->time_bin >= time_bin_inhibited) continue;
+/**
+ * @brief Returns the rank owning the root of a given group.
+ *
+ * @param group_id The global ID of the group.
+ * @param first_on_node The global ID of the first particle on each rank.
+ * @param nr_nodes The number of MPI ranks.
+ */
+__attribute__((always_inline)) INLINE static int fof_group_owner(
+    const size_t group_id, const size_t *first_on_node, const int nr_nodes) {
+
+  /* Find the last rank starting at or before the group ID (ranks without
+   * particles share their offset with the following one). */
+  int low = 0, high = nr_nodes - 1;
+  while (low < high) {
+    const int mid = (low + high + 1) / 2;
+    if (first_on_node[mid] <= group_id)
+      low = mid;
+    else
+      high = mid - 1;
+  }
+  return low;
+}
 
-#ifdef SWIFT_DEBUG_CHECKS
-    if (pi->ti_drift != ti_current)
-      error("Running FOF on an un-drifted particle!");
+/**
+ * @brief Should the group labelled a become the root of the group labelled b
+ * when they are linked across MPI domains?
+ *
+ * With UNION_BY_SIZE_OVER_MPI the largest fragment wins and ties are broken
+ * by the lowest ID. Otherwise the lowest ID wins.
+ *
+ * @param a The first #fof_mpi_label.
+ * @param b The second #fof_mpi_label.
+ */
+__attribute__((always_inline)) INLINE static int fof_label_precedes(
+    const struct fof_mpi_label *a, const struct fof_mpi_label *b) {
+
+#ifdef UNION_BY_SIZE_OVER_MPI
+  if (a->group_size != b->group_size) return a->group_size > b->group_size;
 #endif
+  return a->group_id < b->group_id;
+}
+
+#endif /* WITH_MPI */
+
+/**
+ * @brief Fill a #fof_cache with the positions of the non-inhibited #gpart of a
+ * leaf cell.
+ *
+ * The positions are stored as floats relative to a reference point. If a box
+ * is given, only the particles closer than the linking length to that box are
+ * stored. We also return the bounding box of the particles in the cache.
+ *
+ * The cache is padded up to a multiple of the vector size with particles
+ * placed far out of range.
+ *
+ * @param cache The #fof_cache to fill.
+ * @param c The #cell to read the #gpart from.
+ * @param shift The periodic shift to apply to the #gpart positions.
+ * @param ref The reference point.
+ * @param pad The position of the padded particles along each axis.
+ * @param l_x2 The square of the FOF linking length.
+ * @param filter_min The lower corner of the box to filter with (or NULL).
+ * @param filter_max The upper corner of the box to filter with (or NULL).
+ * @param box_min (return) The lower corner of the particles' bounding box.
+ * @param box_max (return) The upper corner of the particles' bounding box.
+ *
+ * @return The number of particles in the cache.
+ */
+static INLINE int fof_cache_fill(struct fof_cache *cache,
+                                 const struct cell *c, const double shift[3],
+                                 const double ref[3], const float pad,
+                                 const float l_x2, const float *filter_min,
+                                 const float *filter_max, float box_min[3],
+                                 float box_max[3]) {
 
-    const double pix = pi->x[0];
-    const double piy = pi->x[1];
-    const double piz = pi->x[2];
+  const int count = c->grav.count;
+  const struct gpart *gparts = c->grav.parts;
 
-    /* Find the root of pi. */
-    size_t root_i = fof_find(offset[i], group_index);
+  /* Make sure the cache is large enough */
+  if (cache->count < count) fof_cache_init(cache, count);
+
+  float *restrict x = cache->x;
+  float *restrict y = cache->y;
+  float *restrict z = cache->z;
+  int *restrict index = cache->index;
+
+  for (int k = 0; k < 3; k++) {
+    box_min[k] = FLT_MAX;
+    box_max[k] = -FLT_MAX;
+  }
 
-    for (size_t j = i + 1; j < count; j++) {
+  int n = 0;
+  for (int k = 0; k < count; k++) {
 
-      struct gpart *pj = &gparts[j];
+    const struct gpart *gp = &gparts[k];
 
-      /* Ignore inhibited particles */
-      if (pj->time_bin >= time_bin_inhibited) continue;
+    /* Ignore inhibited particles */
+    if (gp->time_bin >= time_bin_inhibited) continue;
 
 #ifdef SWIFT_DEBUG_CHECKS
-      if (pj->ti_drift != ti_current)
-        error("Running FOF on an un-drifted particle!");
+    if (gp->ti_drift != ti_current)
+      error("Running FOF on an un-drifted particle!");
 #endif
 
-      const double pjx = pj->x[0];
-      const double pjy = pj->x[1];
-      const double pjz = pj->x[2];
+    const float p[3] = {gp->x[0] - shift[0] - ref[0],
+                        gp->x[1] - shift[1] - ref[1],
+                        gp->x[2] - shift[2] - ref[2]};
+
+    /* Skip the particles that can't be linked to anything in the box */
+    if (filter_min != NULL) {
+      float r2 = 0.f;
+      for (int l = 0; l < 3; l++) {
+        const float dx = max(filter_min[l] - p[l], 0.f) +
+                         max(p[l] - filter_max[l], 0.f);
+        r2 += dx * dx;
+      }
+      if (r2 >= l_x2) continue;
+    }
+
+    for (int l = 0; l < 3; l++) {
+      box_min[l] = min(box_min[l], p[l]);
+      box_max[l] = max(box_max[l], p[l]);
+    }
+
+    x[n] = p[0];
+    y[n] = p[1];
+    z[n] = p[2];
+    index[n] = k;
+    n++;
+  }
+
+  /* Pad the cache with particles that can't be linked to anything */
+  const int n_padded = n - (n % VEC_SIZE) + VEC_SIZE;
+  for (int k = n; k < n_padded && k < cache->count; k++) {
+    x[k] = pad;
+    y[k] = pad;
+    z[k] = pad;
+    index[k] = -1;
+  }
+
+  return n;
+}
 
-      /* Find the root of pj. */
-      const size_t root_j = fof_find(offset[j], group_index);
+/**
+ * @brief Link a particle to all the particles in a range of a #fof_cache that
+ * are within the linking length.
+ *
+ * The distances are evaluated in batches of VEC_SIZE particles. The union-find
+ * is only called for the particles that are in range.
+ *
+ * @param cache The #fof_cache containing the candidates.
+ * @param j_start The first candidate.
+ * @param j_end The last candidate (excluded).
+ * @param pix The x position of the particle relative to the cache reference.
+ * @param piy The y position of the particle relative to the cache reference.
+ * @param piz The z position of the particle relative to the cache reference.
+ * @param l_x2 The square of the FOF linking length.
+ * @param index_i The index of the particle in the group_index array.
+ * @param offset_j The group_index array shifted to the cell of the cache.
+ * @param group_index The group_index array.
+ */
+__attribute__((always_inline)) INLINE static void fof_link_candidates(
+    const struct fof_cache *restrict cache, const int j_start, const int j_end,
+    const float pix, const float piy, const float piz, const float l_x2,
+    const size_t index_i, const size_t *const offset_j, size_t *group_index) {
+
+  /* Find the root of pi. */
+  size_t root_i = fof_find(index_i, group_index);
+
+#ifdef WITH_VECTORIZATION
+
+  const vector v_pix = vector_set1(pix);
+  const vector v_piy = vector_set1(piy);
+  const vector v_piz = vector_set1(piz);
+  const vector v_l_x2 = vector_set1(l_x2);
+
+  /* Start on an aligned boundary. The particles before j_start have been
+   * tested already (or are pi itself), we just ignore them. */
+  const int j_first = j_start - (j_start % VEC_SIZE);
+  for (int j = j_first; j < j_end; j += VEC_SIZE) {
+
+    vector dx, dy, dz, r2;
+    dx.v = vec_sub(v_pix.v, vec_load(&cache->x[j]));
+    dy.v = vec_sub(v_piy.v, vec_load(&cache->y[j]));
+    dz.v = vec_sub(v_piz.v, vec_load(&cache->z[j]));
+    r2.v = vec_mul(dx.v, dx.v);
+    r2.v = vec_fma(dy.v, dy.v, r2.v);
+    r2.v = vec_fma(dz.v, dz.v, r2.v);
+
+    mask_t v_hit;
+    vec_create_mask(v_hit, vec_cmp_lt(r2.v, v_l_x2.v));
+    int hits = vec_is_mask_true(v_hit);
+    if (j < j_start) hits &= ~((1 << (j_start - j)) - 1);
+    if (!hits) continue;
+
+    /* Merge the groups of the particles in range */
+    for (int l = 0; l < VEC_SIZE; l++) {
+      if (!(hits & (1 << l))) continue;
 
       /* Skip particles in the same group. */
-      if (root_i == root_j) continue;
+      const size_t root_j =
+          fof_find(offset_j[cache->index[j + l]], group_index);
+      if (root_i != root_j) fof_union(&root_i, root_j, group_index);
+    }
+  }
 
-      /* Compute the pairwise distance */
-      float dx[3], r2 = 0.0f;
-      dx[0] = pix - pjx;
-      dx[1] = piy - pjy;
-      dx[2] = piz - pjz;
+#else
 
-      for (int k = 0; k < 3; k++) r2 += dx[k] * dx[k];
+  for (int j = j_start; j < j_end; j++) {
 
-      /* Hit or miss? */
-      if (r2 < l_x2) {
+    const float dx = pix - cache->x[j];
+    const float dy = piy - cache->y[j];
+    const float dz = piz - cache->z[j];
+    const float r2 = dx * dx + dy * dy + dz * dz;
 
-        /* Merge the groups */
-        fof_union(&root_i, root_j, group_index);
-      }
+    /* Hit or miss? */
+    if (r2 < l_x2) {
+
+      /* Skip particles in the same group. */
+      const size_t root_j = fof_find(offset_j[cache->index[j]], group_index);
+      if (root_i != root_j) fof_union(&root_i, root_j, group_index);
     }
   }
+
+#endif
+}
+
+/**
+ * @brief Perform a FOF search using union-find on a given leaf-cell
+ *
+ * @param props The properties fof the FOF scheme.
+ * @param l_x2 The square of the FOF linking length.
+ * @param space_gparts The start of the #gpart array in the #space structure.
+ * @param c The #cell in which to perform FOF.
+ * @param cache The #fof_cache to use.
+ */
+void fof_search_self_cell(const struct fof_props *props, const double l_x2,
+                          const struct gpart *const space_gparts,
+                          struct cell *c, struct fof_cache *cache) {
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (c->split) error("Performing the FOF search at a non-leaf level!");
+#endif
+
+  /* Index of particles in the global group list */
+  size_t *group_index = props->group_index;
+
+  /* Make a list of particle offsets into the global gparts array. */
+  size_t *const offset =
+      group_index + (ptrdiff_t)(c->grav.parts - space_gparts);
+
+  if (c->nodeID != engine_rank)
+    error("Performing self FOF search on foreign cell.");
+
+  /* Read the particles into the cache */
+  const double shift[3] = {0.0, 0.0, 0.0};
+  const float pad = -10.f * (max3(c->width[0], c->width[1], c->width[2]) +
+                             (float)sqrt(l_x2));
+  float box_min[3], box_max[3];
+  const int count = fof_cache_fill(cache, c, shift, c->loc, pad, l_x2, NULL,
+                                   NULL, box_min, box_max);
+
+  /* Loop over particles and find which particles belong in the same group. */
+  for (int i = 0; i < count - 1; i++)
+    fof_link_candidates(cache, i + 1, count, cache->x[i], cache->y[i],
+                        cache->z[i], l_x2, offset[cache->index[i]], offset,
+                        group_index);
 }
 
 /**
  * @brief Perform a FOF search using union-find between two cells
  *
+ * Only the particles of each cell that are within the linking length of the
+ * bounding box of the particles of the other cell are considered.
+ *
  * @param props The properties fof the FOF scheme.
  * @param dim The dimension of the simulation volume.
  * @param l_x2 The square of the FOF linking length.
@@ -757,14 +1336,16 @@ void fof_search_self_cell(const struct fof_props *props, const double l_x2,
  * @param space_gparts The start of the #gpart array in the #space structure.
  * @param ci The first #cell in which to perform FOF.
  * @param cj The second #cell in which to perform FOF.
+ * @param ci_cache The #fof_cache to use for ci.
+ * @param cj_cache The #fof_cache to use for cj.
  */
 void fof_search_pair_cells(const struct fof_props *props, const double dim[3],
                            const double l_x2, const int periodic,
                            const struct gpart *const space_gparts,
-                           struct cell *restrict ci, struct cell *restrict cj) {
+                           struct cell *restrict ci, struct cell *restrict cj,
+                           struct fof_cache *restrict ci_cache,
+                           struct fof_cache *restrict cj_cache) {
 
-  const size_t count_i = ci->grav.count;
-  const size_t count_j = cj->grav.count;
   struct gpart *gparts_i = ci->grav.parts;
   struct gpart *gparts_j = cj->grav.parts;
 
@@ -776,6 +1357,8 @@ void fof_search_pair_cells(const struct fof_props *props, const double dim[3],
   size_t *const offset_j = group_index + (ptrdiff_t)(gparts_j - space_gparts);
 
 #ifdef SWIFT_DEBUG_CHECKS
+  const size_t count_i = ci->grav.count;
+  const size_t count_j = cj->grav.count;
   if (offset_j > offset_i && (offset_j < offset_i + count_i))
     error("Overlapping cells");
   if (offset_i > offset_j && (offset_i < offset_j + count_j))
@@ -784,80 +1367,52 @@ void fof_search_pair_cells(const struct fof_props *props, const double dim[3],
 
   /* Account for boundary conditions.*/
   double shift[3] = {0.0, 0.0, 0.0};
+  const double no_shift[3] = {0.0, 0.0, 0.0};
 
   /* Get the relative distance between the pairs, wrapping. */
-  double diff[3];
   for (int k = 0; k < 3; k++) {
-    diff[k] = cj->loc[k] - ci->loc[k];
-    if (periodic && diff[k] < -dim[k] * 0.5)
+    const double diff = cj->loc[k] - ci->loc[k];
+    if (periodic && diff < -dim[k] * 0.5)
       shift[k] = dim[k];
-    else if (periodic && diff[k] > dim[k] * 0.5)
+    else if (periodic && diff > dim[k] * 0.5)
       shift[k] = -dim[k];
     else
       shift[k] = 0.0;
-    diff[k] += shift[k];
   }
 
-  /* Loop over particles and find which particles belong in the same group. */
-  for (size_t i = 0; i < count_i; i++) {
-
-    struct gpart *pi = &gparts_i[i];
+  /* Read the particles into the caches using positions relative to cj. Only
+   * keep the particles of cj that are in range of the ones of ci. */
+  const float width_i = max3(ci->width[0], ci->width[1], ci->width[2]);
+  const float width_j = max3(cj->width[0], cj->width[1], cj->width[2]);
+  const float pad = -10.f * (2.f * max(width_i, width_j) + (float)sqrt(l_x2));
+  float box_i_min[3], box_i_max[3], box_j_min[3], box_j_max[3];
+  const int ni = fof_cache_fill(ci_cache, ci, shift, cj->loc, pad, l_x2, NULL,
+                                NULL, box_i_min, box_i_max);
+  if (ni == 0) return;
+  const int nj = fof_cache_fill(cj_cache, cj, no_shift, cj->loc, pad, l_x2,
+                                box_i_min, box_i_max, box_j_min, box_j_max);
+  if (nj == 0) return;
 
-    /* Ignore inhibited particles */
-    if (pi->time_bin >= time_bin_inhibited) continue;
-
-#ifdef SWIFT_DEBUG_CHECKS
-    if (pi->ti_drift != ti_current)
-      error("Running FOF on an un-drifted particle!");
-#endif
-
-    const double pix = pi->x[0] - shift[0];
-    const double piy = pi->x[1] - shift[1];
-    const double piz = pi->x[2] - shift[2];
-
-    /* Find the root of pi. */
-    size_t root_i = fof_find(offset_i[i], group_index);
-
-    for (size_t j = 0; j < count_j; j++) {
-
-      struct gpart *pj = &gparts_j[j];
-
-      /* Ignore inhibited particles */
-      if (pj->time_bin >= time_bin_inhibited) continue;
-
-#ifdef SWIFT_DEBUG_CHECKS
-      if (pj->ti_drift != ti_current)
-        error("Running FOF on an un-drifted particle!");
-#endif
-
-      /* Find the root of pj. */
-      const size_t root_j = fof_find(offset_j[j], group_index);
-
-      /* Skip particles in the same group. */
-      if (root_i == root_j) continue;
-
-      const double pjx = pj->x[0];
-      const double pjy = pj->x[1];
-      const double pjz = pj->x[2];
-
-      /* Compute pairwise distance, remembering to account for boundary
-       * conditions. */
-      float dx[3], r2 = 0.0f;
-      dx[0] = pix - pjx;
-      dx[1] = piy - pjy;
-      dx[2] = piz - pjz;
-
-      for (int k = 0; k < 3; k++) r2 += dx[k] * dx[k];
-
-      /* Hit or miss? */
-      if (r2 < l_x2) {
-
-        /* Merge the groups */
-        fof_union(&root_i, root_j, group_index);
-      }
-    }
-  }
-}
+  /* Loop over particles and find which particles belong in the same group. */
+  for (int i = 0; i < ni; i++) {
+
+    const float pix = ci_cache->x[i];
+    const float piy = ci_cache->y[i];
+    const float piz = ci_cache->z[i];
+
+    /* Skip the particles out of range of all the remaining ones of cj */
+    const float dx =
+        max(box_j_min[0] - pix, 0.f) + max(pix - box_j_max[0], 0.f);
+    const float dy =
+        max(box_j_min[1] - piy, 0.f) + max(piy - box_j_max[1], 0.f);
+    const float dz =
+        max(box_j_min[2] - piz, 0.f) + max(piz - box_j_max[2], 0.f);
+    if (dx * dx + dy * dy + dz * dz >= l_x2) continue;
+
+    fof_link_candidates(cj_cache, 0, nj, pix, piy, piz, l_x2,
+                        offset_i[ci_cache->index[i]], offset_j, group_index);
+  }
+}
 
 /* Perform a FOF search between a local and foreign cell using the Union-Find
  * algorithm. Store any links found between particles.*/
@@ -1027,11 +1582,15 @@ void fof_search_pair_cells_foreign(
  * @param space_gparts The start of the #gpart array in the #space structure.
  * @param ci The first #cell in which to perform FOF.
  * @param cj The second #cell in which to perform FOF.
+ * @param ci_cache The #fof_cache to use for ci.
+ * @param cj_cache The #fof_cache to use for cj.
  */
 void rec_fof_search_pair(const struct fof_props *props, const double dim[3],
                          const double search_r2, const int periodic,
                          const struct gpart *const space_gparts,
-                         struct cell *restrict ci, struct cell *restrict cj) {
+                         struct cell *restrict ci, struct cell *restrict cj,
+                         struct fof_cache *restrict ci_cache,
+                         struct fof_cache *restrict cj_cache) {
 
   /* Find the shortest distance between cells, remembering to account for
    * boundary conditions. */
@@ -1052,26 +1611,27 @@ void rec_fof_search_pair(const struct fof_props *props, const double dim[3],
         for (int l = 0; l < 8; l++)
           if (cj->progeny[l] != NULL)
             rec_fof_search_pair(props, dim, search_r2, periodic, space_gparts,
-                                ci->progeny[k], cj->progeny[l]);
+                                ci->progeny[k], cj->progeny[l], ci_cache,
+                                cj_cache);
       }
     }
   } else if (ci->split) {
     for (int k = 0; k < 8; k++) {
       if (ci->progeny[k] != NULL)
         rec_fof_search_pair(props, dim, search_r2, periodic, space_gparts,
-                            ci->progeny[k], cj);
+                            ci->progeny[k], cj, ci_cache, cj_cache);
     }
   } else if (cj->split) {
     for (int k = 0; k < 8; k++) {
       if (cj->progeny[k] != NULL)
         rec_fof_search_pair(props, dim, search_r2, periodic, space_gparts, ci,
-                            cj->progeny[k]);
+                            cj->progeny[k], ci_cache, cj_cache);
     }
   } else {
     /* Perform FOF search between pairs of cells that are within the linking
      * length and not the same cell. */
     fof_search_pair_cells(props, dim, search_r2, periodic, space_gparts, ci,
-                          cj);
+                          cj, ci_cache, cj_cache);
   }
 }
 #ifdef WITH_MPI
@@ -1144,11 +1704,14 @@ void rec_fof_search_pair_foreign(
  * @param search_r2 the square of the FOF linking length.
  * @param periodic Are we using periodic BCs?
  * @param c The #cell in which to perform FOF.
+ * @param ci_cache The first #fof_cache to use.
+ * @param cj_cache The second #fof_cache to use.
  */
 void rec_fof_search_self(const struct fof_props *props, const double dim[3],
                          const double search_r2, const int periodic,
                          const struct gpart *const space_gparts,
-                         struct cell *c) {
+                         struct cell *c, struct fof_cache *restrict ci_cache,
+                         struct fof_cache *restrict cj_cache) {
 
   /* Recurse? */
   if (c->split) {
@@ -1158,33 +1721,29 @@ void rec_fof_search_self(const struct fof_props *props, const double dim[3],
       if (c->progeny[k] != NULL) {
 
         rec_fof_search_self(props, dim, search_r2, periodic, space_gparts,
-                            c->progeny[k]);
+                            c->progeny[k], ci_cache, cj_cache);
 
         for (int l = k + 1; l < 8; l++)
           if (c->progeny[l] != NULL)
             rec_fof_search_pair(props, dim, search_r2, periodic, space_gparts,
-                                c->progeny[k], c->progeny[l]);
+                                c->progeny[k], c->progeny[l], ci_cache,
+                                cj_cache);
       }
     }
   }
   /* Otherwise, compute self-interaction. */
   else
-    fof_search_self_cell(props, search_r2, space_gparts, c);
-}
-
-/* Mapper function to atomically update the group size array. */
-void fof_update_group_size_mapper(hashmap_key_t key, hashmap_value_t *value,
-                                  void *data) {
-
-  size_t *group_size = (size_t *)data;
-
-  /* Use key to index into group size array. */
-  atomic_add(&group_size[key], value->value_st);
+    fof_search_self_cell(props, search_r2, space_gparts, c, ci_cache);
 }
 
 /**
  * @brief Mapper function to calculate the group sizes.
  *
+ * The group_size array is indexed by the root and is shared by all the
+ * threads. Consecutive particles mostly belong to the same group, so we
+ * accumulate runs of particles with the same root locally and only update the
+ * array atomically when the root changes.
+ *
  * @param map_data An array of #gpart%s.
  * @param num_elements Chunk size.
  * @param extra_data Pointer to a #space.
@@ -1202,50 +1761,103 @@ void fof_calc_group_size_mapper(void *map_data, int num_elements,
   ptrdiff_t gparts_offset = (ptrdiff_t)(gparts - s->gparts);
   size_t *const group_index_offset = group_index + gparts_offset;
 
-  /* Create hash table. */
-  hashmap_t map;
-  hashmap_init(&map);
+  /* Current run of particles with the same root */
+  size_t current_root = (size_t)-1;
+  size_t current_size = 0;
 
   /* Loop over particles and find which cells are in range of each other to
    * perform the FOF search. */
   for (int ind = 0; ind < num_elements; ind++) {
 
-    hashmap_key_t root =
-        (hashmap_key_t)fof_find(group_index_offset[ind], group_index);
+    const size_t root = fof_find(group_index_offset[ind], group_index);
     const size_t gpart_index = gparts_offset + ind;
 
     /* Only add particles which aren't the root of a group. Stops groups of size
-     * 1 being added to the hash table. */
+     * 1 being counted twice. */
     if (root != gpart_index) {
-      hashmap_value_t *size = hashmap_get(&map, root);
 
-      if (size != NULL)
-        (*size).value_st++;
-      else
-        error("Couldn't find key (%zu) or create new one.", root);
+      if (root != current_root) {
+        if (current_size > 0)
+          atomic_add(&group_size[current_root], current_size);
+        current_root = root;
+        current_size = 0;
+      }
+      current_size++;
     }
   }
 
-  /* Update the group size array. */
-  if (map.size > 0)
-    hashmap_iterate(&map, fof_update_group_size_mapper, group_size);
+  /* Update the group size array with the last run. */
+  if (current_size > 0) atomic_add(&group_size[current_root], current_size);
+}
 
-  hashmap_free(&map);
+/**
+ * @brief Start accumulating the mass moments of a run of particles around the
+ * root of their group.
+ *
+ * @param run The moments of the run.
+ * @param root The root #gpart of the group.
+ */
+__attribute__((always_inline)) INLINE static void fof_moments_start(
+    struct fof_final_moments *run, const struct gpart *root) {
+
+  bzero(run, sizeof(struct fof_final_moments));
+  for (int k = 0; k < 3; k++) run->ref[k] = root->x[k];
 }
 
-/* Mapper function to atomically update the group mass array. */
-static INLINE void fof_update_group_mass_mapper(hashmap_key_t key,
-                                                hashmap_value_t *value,
-                                                void *data) {
+/**
+ * @brief Add a particle to the mass moments of a run of particles.
+ *
+ * @param run The moments of the run.
+ * @param gp The #gpart to add.
+ * @param s The #space (for the periodic wrapping).
+ */
+__attribute__((always_inline)) INLINE static void fof_moments_add_gpart(
+    struct fof_final_moments *run, const struct gpart *gp,
+    const struct space *s) {
+
+  const double m = gp->mass;
+  double r2 = 0.;
+  for (int k = 0; k < 3; k++) {
+    double dx = gp->x[k] - run->ref[k];
+    if (s->periodic) dx = nearest(dx, s->dim[k]);
+    run->first_moment[k] += m * dx;
+    run->momentum[k] += m * gp->v_full[k];
+    r2 += dx * dx;
+  }
+  run->mass += m;
+  run->second_moment += m * r2;
+}
 
-  double *group_mass = (double *)data;
+/**
+ * @brief Add the mass and mass moments of a run of particles to the
+ * properties of their group.
+ *
+ * The runs are accumulated concurrently by the threads.
+ *
+ * @param props The properties of the FOF.
+ * @param group_mass The mass of the groups.
+ * @param index The index of the group.
+ * @param run The moments of the run (taken around the root of the group).
+ */
+__attribute__((always_inline)) INLINE static void fof_moments_flush(
+    const struct fof_props *props, double *group_mass, const size_t index,
+    const struct fof_final_moments *run) {
 
-  /* Use key to index into group mass array. */
-  atomic_add_d(&group_mass[key], value->value_dbl);
+  atomic_add_d(&group_mass[index], run->mass);
+  atomic_add_d(&props->group_radius[index], run->second_moment);
+  for (int k = 0; k < 3; k++) {
+    atomic_add_d(&props->group_centre_of_mass[3 * index + k],
+                 run->first_moment[k]);
+    atomic_add_d(&props->group_velocity[3 * index + k], run->momentum[k]);
+  }
 }
 
 /**
- * @brief Mapper function to calculate the group masses.
+ * @brief Mapper function to calculate the group masses and the mass moments
+ * used for the centres of mass, velocities and radii of the groups.
+ *
+ * As for the sizes, runs of particles in the same group are accumulated
+ * locally before being added atomically to the shared group arrays.
  *
  * @param map_data An array of #gpart%s.
  * @param num_elements Chunk size.
@@ -1257,37 +1869,45 @@ void fof_calc_group_mass_mapper(void *map_data, int num_elements,
   /* Retrieve mapped data. */
   struct space *s = (struct space *)extra_data;
   struct gpart *gparts = (struct gpart *)map_data;
-  double *group_mass = s->e->fof_properties->group_mass;
-  const size_t group_id_default = s->e->fof_properties->group_id_default;
-  const size_t group_id_offset = s->e->fof_properties->group_id_offset;
+  const struct fof_props *props = s->e->fof_properties;
+  double *group_mass = props->group_mass;
+  const size_t *group_index = props->group_index;
+  const size_t group_id_default = props->group_id_default;
+  const size_t group_id_offset = props->group_id_offset;
+  const size_t nr_gparts = s->nr_gparts;
+  const size_t gparts_offset = (size_t)(gparts - s->gparts);
 
-  /* Create hash table. */
-  hashmap_t map;
-  hashmap_init(&map);
+  /* Current run of particles in the same group */
+  size_t current_group_id = group_id_default;
+  struct fof_final_moments run;
 
   /* Loop over particles and increment the group mass for groups above
    * min_group_size. */
   for (int ind = 0; ind < num_elements; ind++) {
 
     /* Only check groups above the minimum size. */
-    if (gparts[ind].group_id != group_id_default) {
+    const size_t group_id = gparts[ind].group_id;
+    if (group_id != group_id_default) {
 
-      hashmap_key_t index = gparts[ind].group_id - group_id_offset;
-      hashmap_value_t *data = hashmap_get(&map, index);
+      if (group_id != current_group_id) {
+        if (current_group_id != group_id_default)
+          fof_moments_flush(props, group_mass,
+                            current_group_id - group_id_offset, &run);
+        current_group_id = group_id;
 
-      /* Update group mass */
-      if (data != NULL)
-        (*data).value_dbl += gparts[ind].mass;
-      else
-        error("Couldn't find key (%zu) or create new one.", index);
+        /* The moments are taken around the root of the group */
+        const size_t root =
+            fof_find_local(gparts_offset + ind, nr_gparts, group_index);
+        fof_moments_start(&run, &s->gparts[root]);
+      }
+      fof_moments_add_gpart(&run, &gparts[ind], s);
     }
   }
 
-  /* Update the group mass array. */
-  if (map.size > 0)
-    hashmap_iterate(&map, fof_update_group_mass_mapper, group_mass);
-
-  hashmap_free(&map);
+  /* Update the group arrays with the last run. */
+  if (current_group_id != group_id_default)
+    fof_moments_flush(props, group_mass, current_group_id - group_id_offset,
+                      &run);
 }
 
 #ifdef WITH_MPI
@@ -1298,13 +1918,171 @@ void fof_unpack_group_mass_mapper(hashmap_key_t key, hashmap_value_t *value,
   struct fof_mass_send_hashmap *fof_mass_send =
       (struct fof_mass_send_hashmap *)data;
   struct fof_final_mass *mass_send = fof_mass_send->mass_send;
-  size_t *nsend = &fof_mass_send->nsend;
+
+  /* Get a slot in the array (this is called concurrently) */
+  const size_t ind = atomic_inc(&fof_mass_send->nsend);
 
   /* Store elements from hash table in array. */
-  mass_send[*nsend].global_root = key;
-  mass_send[(*nsend)].group_mass = value->value_dbl;
-  mass_send[(*nsend)].max_part_density_index = value->value_st;
-  mass_send[(*nsend)++].max_part_density = value->value_flt;
+  mass_send[ind].global_root = key;
+  mass_send[ind].group_mass = value->value_dbl;
+  mass_send[ind].max_part_density_index = value->value_st;
+  mass_send[ind].max_part_density = value->value_flt;
+}
+
+/**
+ * @brief Add the mass moments of a fragment of a group to the moments of the
+ * group taken around another position.
+ *
+ * @param ref The position the moments of the group are taken around.
+ * @param first_moment The first moment of the mass of the group.
+ * @param second_moment The second moment of the mass of the group.
+ * @param momentum The momentum of the group.
+ * @param frag The moments of the fragment.
+ * @param s The #space (for the periodic wrapping).
+ */
+static void fof_add_moments(const double ref[3], double first_moment[3],
+                            double *second_moment, double momentum[3],
+                            const struct fof_final_moments *frag,
+                            const struct space *s) {
+
+  /* Shift the moments of the fragment to the reference of the group */
+  double d[3], d2 = 0., d_dot_first = 0.;
+  for (int k = 0; k < 3; k++) {
+    d[k] = frag->ref[k] - ref[k];
+    if (s->periodic) d[k] = nearest(d[k], s->dim[k]);
+    d2 += d[k] * d[k];
+    d_dot_first += d[k] * frag->first_moment[k];
+  }
+
+  *second_moment += frag->second_moment + 2. * d_dot_first + frag->mass * d2;
+  for (int k = 0; k < 3; k++) {
+    first_moment[k] += frag->first_moment[k] + frag->mass * d[k];
+    momentum[k] += frag->momentum[k];
+  }
+}
+
+/* Data shared by the threads accumulating the group masses. */
+struct fof_calc_group_mass_data {
+  const struct space *s;
+  double *group_mass;
+  concurrent_hashmap_t *map;
+  size_t num_groups_prev;
+  size_t nr_foreign;
+
+  /* Mass moments of the particles whose root is foreign */
+  struct fof_final_moments *moments;
+  size_t nr_moments;
+};
+
+/**
+ * @brief Mapper function accumulating the mass and mass moments of the groups
+ * with a local root and counting the particles whose root is foreign.
+ *
+ * @param map_data An array of #gpart%s.
+ * @param num_elements Chunk size.
+ * @param extra_data Pointer to a #fof_calc_group_mass_data.
+ */
+static void fof_calc_group_mass_local_mapper(void *map_data, int num_elements,
+                                             void *extra_data) {
+
+  struct fof_calc_group_mass_data *data =
+      (struct fof_calc_group_mass_data *)extra_data;
+  const struct space *s = data->s;
+  const struct fof_props *props = s->e->fof_properties;
+  const size_t *group_index = props->group_index;
+  const size_t group_id_offset = props->group_id_offset;
+  const size_t group_id_default = props->group_id_default;
+  const size_t nr_gparts = s->nr_gparts;
+  double *group_mass = data->group_mass;
+  const struct gpart *gparts = (const struct gpart *)map_data;
+  const size_t gparts_offset = (size_t)(gparts - s->gparts);
+
+  /* Current run of particles in the same local group */
+  size_t current_index = (size_t)-1;
+  struct fof_final_moments run;
+
+  size_t nr_foreign = 0;
+  for (int ind = 0; ind < num_elements; ind++) {
+
+    /* Check if the particle is in a group above the threshold. */
+    if (gparts[ind].group_id != group_id_default) {
+
+      const size_t root =
+          fof_find_global(gparts_offset + ind, group_index, nr_gparts);
+
+      /* Increment the mass of groups that are local */
+      if (is_local(root, nr_gparts)) {
+
+        const size_t index =
+            gparts[ind].group_id - group_id_offset - data->num_groups_prev;
+
+        if (index != current_index) {
+          if (current_index != (size_t)-1)
+            fof_moments_flush(props, group_mass, current_index, &run);
+          current_index = index;
+          fof_moments_start(&run, &s->gparts[root - node_offset]);
+        }
+        fof_moments_add_gpart(&run, &gparts[ind], s);
+
+      } else {
+        nr_foreign++;
+      }
+    }
+  }
+
+  /* Update the group arrays with the last run. */
+  if (current_index != (size_t)-1)
+    fof_moments_flush(props, group_mass, current_index, &run);
+
+  if (nr_foreign > 0) atomic_add(&data->nr_foreign, nr_foreign);
+}
+
+/**
+ * @brief Mapper function accumulating the mass fragments of the groups with a
+ * foreign root in the shared #concurrent_hashmap_t and collecting the mass
+ * moments of their particles.
+ *
+ * @param map_data An array of #gpart%s.
+ * @param num_elements Chunk size.
+ * @param extra_data Pointer to a #fof_calc_group_mass_data.
+ */
+static void fof_calc_group_mass_foreign_mapper(void *map_data,
+                                               int num_elements,
+                                               void *extra_data) {
+
+  struct fof_calc_group_mass_data *data =
+      (struct fof_calc_group_mass_data *)extra_data;
+  const struct space *s = data->s;
+  const struct fof_props *props = s->e->fof_properties;
+  const size_t *group_index = props->group_index;
+  const size_t group_id_default = props->group_id_default;
+  const size_t nr_gparts = s->nr_gparts;
+  const struct gpart *gparts = (const struct gpart *)map_data;
+  const size_t gparts_offset = (size_t)(gparts - s->gparts);
+
+  for (int ind = 0; ind < num_elements; ind++) {
+
+    if (gparts[ind].group_id != group_id_default) {
+
+      const size_t root =
+          fof_find_global(gparts_offset + ind, group_index, nr_gparts);
+
+      /* Add mass fragments of groups that have a foreign root */
+      if (!is_local(root, nr_gparts)) {
+        if (!concurrent_hashmap_add(data->map, (hashmap_key_t)root, 0,
+                                    gparts[ind].mass))
+          error("Couldn't find key (%zu) or create new one.", root);
+
+        /* Each particle is its own reference until the fragments are
+         * combined */
+        struct fof_final_moments *moments =
+            &data->moments[atomic_inc(&data->nr_moments)];
+        fof_moments_start(moments, &gparts[ind]);
+        fof_moments_add_gpart(moments, &gparts[ind], s);
+        moments->global_root = root;
+      }
+    }
+  }
 }
 
 #endif /* WITH_MPI */
@@ -1353,17 +2131,56 @@ void fof_calc_group_mass(struct fof_props *props, const struct space *s,
     max_part_density_index[i] = fof_halo_has_no_gas;
   }
 
-  /* Start the hash map */
-  hashmap_t map;
-  hashmap_init(&map);
+  /* Increment the mass of the groups with a local root and count the
+   * particles belonging to groups with a foreign root. */
+  struct fof_calc_group_mass_data mass_data = {
+      s, group_mass, NULL, num_groups_prev, /*nr_foreign=*/0,
+      /*moments=*/NULL, /*nr_moments=*/0};
+  threadpool_map(&s->e->threadpool, fof_calc_group_mass_local_mapper, gparts,
+                 nr_gparts, sizeof(struct gpart), 0, &mass_data);
+
+  /* Add the mass fragments of the groups with a foreign root to a hash table
+   * shared by all the threads. There can't be more distinct roots than
+   * particles. */
+  concurrent_hashmap_t map;
+  concurrent_hashmap_init(&map, mass_data.nr_foreign);
+  mass_data.map = &map;
+  if (swift_memalign("fof_moments_send", (void **)&mass_data.moments, 32,
+                     mass_data.nr_foreign * sizeof(struct fof_final_moments)) !=
+      0)
+    error("Failed to allocate list of group moments for FOF search.");
+  if (mass_data.nr_foreign > 0)
+    threadpool_map(&s->e->threadpool, fof_calc_group_mass_foreign_mapper,
+                   gparts, nr_gparts, sizeof(struct gpart), 0, &mass_data);
+  if (mass_data.nr_moments != mass_data.nr_foreign)
+    error("No. of moments collected != no. of foreign particles.");
+
+  /* Combine the moments of the particles into one fragment per foreign root,
+   * taken around the first particle of the fragment. */
+  struct fof_final_moments *moments_send = mass_data.moments;
+  qsort(moments_send, mass_data.nr_moments, sizeof(struct fof_final_moments),
+        compare_fof_final_moments_global_root);
+  size_t nsend_moments = 0;
+  for (size_t i = 0; i < mass_data.nr_moments; i++) {
+    if (nsend_moments > 0 && moments_send[nsend_moments - 1].global_root ==
+                                 moments_send[i].global_root) {
+      struct fof_final_moments *frag = &moments_send[nsend_moments - 1];
+      fof_add_moments(frag->ref, frag->first_moment, &frag->second_moment,
+                      frag->momentum, &moments_send[i], s);
+      frag->mass += moments_send[i].mass;
+    } else {
+      moments_send[nsend_moments++] = moments_send[i];
+    }
+  }
 
+  /* Loop over particles and find the densest particle in each group. */
   /* JSW TODO: Parallelise with threadpool*/
   for (size_t i = 0; i < nr_gparts; i++) {
 
-    /* Check if the particle is in a group above the threshold. */
+    /* Only check groups above the minimum size and mass threshold. */
     if (gparts[i].group_id != group_id_default) {
 
-      const size_t root = fof_find_global(i, group_index, nr_gparts);
+      size_t root = fof_find_global(i, group_index, nr_gparts);
 
       /* Increment the mass of groups that are local */
       if (is_local(root, nr_gparts)) {
@@ -1371,95 +2188,73 @@ void fof_calc_group_mass(struct fof_props *props, const struct space *s,
         const size_t index =
             gparts[i].group_id - group_id_offset - num_groups_prev;
 
-        /* Update group mass */
-        group_mass[index] += gparts[i].mass;
-
-      }
-      /* Add mass fragments of groups that have a foreign root to a hash table.
-       */
-      else {
-
-        hashmap_value_t *data = hashmap_get(&map, (hashmap_key_t)root);
-
-        if (data != NULL) {
-          data->value_dbl += gparts[i].mass;
+        /* Only seed groups above the mass threshold. */
+        if (group_mass[index] > seed_halo_mass) {
 
           /* Find the densest gas particle.
            * Account for groups that already have a black hole and groups that
            * contain no gas. */
           if (gparts[i].type == swift_type_gas &&
-              data->value_st != fof_halo_has_black_hole) {
+              max_part_density_index[index] != fof_halo_has_black_hole) {
 
             const size_t gas_index = -gparts[i].id_or_neg_offset;
             const float rho_com = hydro_get_comoving_density(&parts[gas_index]);
 
             /* Update index if a denser gas particle is found. */
-            if (rho_com > data->value_flt) {
-              data->value_flt = rho_com;
-              data->value_st = gas_index;
+            if (rho_com > max_part_density[index]) {
+              max_part_density_index[index] = gas_index;
+              max_part_density[index] = rho_com;
             }
           }
           /* If there is already a black hole in the group we don't need to
              create a new one. */
           else if (gparts[i].type == swift_type_black_hole) {
-            data->value_st = fof_halo_has_black_hole;
-            data->value_flt = 0.f;
+            max_part_density_index[index] = fof_halo_has_black_hole;
           }
-        } else
-          error("Couldn't find key (%zu) or create new one.", root);
+        }
       }
-    }
-  }
-
-  /* Loop over particles and find the densest particle in each group. */
-  /* JSW TODO: Parallelise with threadpool*/
-  for (size_t i = 0; i < nr_gparts; i++) {
-
-    /* Only check groups above the minimum size and mass threshold. */
-    if (gparts[i].group_id != group_id_default) {
-
-      size_t root = fof_find_global(i, group_index, nr_gparts);
-
-      /* Increment the mass of groups that are local */
-      if (is_local(root, nr_gparts)) {
+      /* Find the densest particle of the fragments of groups that have a
+       * foreign root. */
+      else {
 
-        const size_t index =
-            gparts[i].group_id - group_id_offset - num_groups_prev;
+        hashmap_value_t *data =
+            concurrent_hashmap_lookup(&map, (hashmap_key_t)root);
 
-        /* Only seed groups above the mass threshold. */
-        if (group_mass[index] > seed_halo_mass) {
+        if (data != NULL) {
 
           /* Find the densest gas particle.
            * Account for groups that already have a black hole and groups that
            * contain no gas. */
           if (gparts[i].type == swift_type_gas &&
-              max_part_density_index[index] != fof_halo_has_black_hole) {
+              data->value_st != fof_halo_has_black_hole) {
 
             const size_t gas_index = -gparts[i].id_or_neg_offset;
             const float rho_com = hydro_get_comoving_density(&parts[gas_index]);
 
             /* Update index if a denser gas particle is found. */
-            if (rho_com > max_part_density[index]) {
-              max_part_density_index[index] = gas_index;
-              max_part_density[index] = rho_com;
+            if (rho_com > data->value_flt) {
+              data->value_flt = rho_com;
+              data->value_st = gas_index;
             }
           }
           /* If there is already a black hole in the group we don't need to
              create a new one. */
           else if (gparts[i].type == swift_type_black_hole) {
-            max_part_density_index[index] = fof_halo_has_black_hole;
+            data->value_st = fof_halo_has_black_hole;
+            data->value_flt = 0.f;
           }
-        }
+        } else
+          error("Couldn't find key (%zu) in the hash table.", root);
       }
     }
   }
 
-  size_t nsend = map.size;
+  size_t nsend = concurrent_hashmap_size(&map);
   struct fof_mass_send_hashmap hashmap_mass_send;
 
   /* Allocate and initialise a mass array. */
   if (posix_memalign((void **)&hashmap_mass_send.mass_send, 32,
-                     nsend * sizeof(struct fof_mass_send_hashmap)) != 0)
+                     nsend * sizeof(struct fof_final_mass)) != 0)
     error("Failed to allocate list of group masses for FOF search.");
 
   hashmap_mass_send.nsend = 0;
@@ -1467,15 +2262,15 @@ void fof_calc_group_mass(struct fof_props *props, const struct space *s,
   struct fof_final_mass *fof_mass_send = hashmap_mass_send.mass_send;
 
   /* Unpack mass fragments and roots from hash table. */
-  if (map.size > 0)
-    hashmap_iterate(&map, fof_unpack_group_mass_mapper, &hashmap_mass_send);
-
-  nsend = hashmap_mass_send.nsend;
+  if (nsend > 0)
+    concurrent_hashmap_iterate_parallel(&map, &s->e->threadpool,
+                                        fof_unpack_group_mass_mapper,
+                                        &hashmap_mass_send);
 
-  if (nsend != map.size)
+  if (hashmap_mass_send.nsend != nsend)
     error("No. of mass fragments to send != elements in hash table.");
 
-  hashmap_free(&map);
+  concurrent_hashmap_free(&map);
 
   /* Sort by global root - this puts the groups in order of which node they're
    * stored on */
@@ -1586,6 +2381,59 @@ void fof_calc_group_mass(struct fof_props *props, const struct space *s,
                 fof_mass_send, sendcount, sendoffset, fof_final_mass_type,
                 MPI_COMM_WORLD);
 
+  /* Determine how many moment fragments go to each node */
+  int *moments_sendcount = (int *)malloc(nr_nodes * sizeof(int));
+  for (int i = 0; i < nr_nodes; i += 1) moments_sendcount[i] = 0;
+  dest = 0;
+  for (size_t i = 0; i < nsend_moments; i += 1) {
+    while ((moments_send[i].global_root >=
+            first_on_node[dest] + num_on_node[dest]) ||
+           (num_on_node[dest] == 0))
+      dest += 1;
+    if (dest >= nr_nodes) error("Node index out of range!");
+    moments_sendcount[dest] += 1;
+  }
+
+  int *moments_recvcount = NULL, *moments_sendoffset = NULL,
+      *moments_recvoffset = NULL;
+  size_t nrecv_moments = 0;
+
+  fof_compute_send_recv_offsets(nr_nodes, moments_sendcount,
+                                &moments_recvcount, &moments_sendoffset,
+                                &moments_recvoffset, &nrecv_moments);
+
+  struct fof_final_moments *moments_recv = NULL;
+  if (swift_memalign("fof_moments_recv", (void **)&moments_recv, 32,
+                     nrecv_moments * sizeof(struct fof_final_moments)) != 0)
+    error("Failed to allocate list of group moments for FOF search.");
+
+  /* Exchange the moment fragments */
+  MPI_Alltoallv(moments_send, moments_sendcount, moments_sendoffset,
+                fof_final_moments_type, moments_recv, moments_recvcount,
+                moments_recvoffset, fof_final_moments_type, MPI_COMM_WORLD);
+
+  /* Add the fragments to the moments of the groups, taken around their root */
+  for (size_t i = 0; i < nrecv_moments; i++) {
+    if ((moments_recv[i].global_root < node_offset) ||
+        (moments_recv[i].global_root >= node_offset + nr_gparts)) {
+      error("Received global root index out of range!");
+    }
+    const struct gpart *root =
+        &gparts[moments_recv[i].global_root - node_offset];
+    const size_t index = root->group_id - group_id_offset - num_groups_prev;
+
+    fof_add_moments(root->x, &props->group_centre_of_mass[3 * index],
+                    &props->group_radius[index],
+                    &props->group_velocity[3 * index], &moments_recv[i], s);
+  }
+
+  free(moments_sendcount);
+  free(moments_recvcount);
+  free(moments_sendoffset);
+  free(moments_recvoffset);
+  swift_free("fof_moments_send", moments_send);
+  swift_free("fof_moments_recv", moments_recv);
+
   int extra_seed_count = 0;
   size_t density_index_size = num_groups_local;
 
@@ -1923,58 +2771,736 @@ void fof_seed_black_holes(const struct fof_props *props,
   s->nr_bparts = k;
 }
 
-/* Dump FOF group data. */
+/**
+ * @brief Turn the mass moments accumulated around the root of each group into
+ * its centre of mass, mean velocity and r.m.s. radius.
+ *
+ * @param props The properties of the FOF.
+ * @param s The #space.
+ * @param num_groups The number of groups with a root on this node.
+ * @param group_sizes The root and size of the groups on this node.
+ */
+static void fof_finalise_group_properties(
+    struct fof_props *props, const struct space *s, const size_t num_groups,
+    const struct group_length *group_sizes) {
+
+  const struct gpart *gparts = s->gparts;
+  const double *group_mass = props->group_mass;
+  double *group_centre_of_mass = props->group_centre_of_mass;
+  double *group_velocity = props->group_velocity;
+  double *group_radius = props->group_radius;
+
+  for (size_t i = 0; i < num_groups; i++) {
+
+#ifdef WITH_MPI
+    const struct gpart *root = &gparts[group_sizes[i].index - node_offset];
+#else
+    const struct gpart *root = &gparts[group_sizes[i].index];
+#endif
+
+    /* Massless groups keep their root as centre */
+    const double m_inv = group_mass[i] > 0. ? 1. / group_mass[i] : 0.;
+
+    double r2 = group_radius[i] * m_inv;
+    for (int k = 0; k < 3; k++) {
+      const double dx = group_centre_of_mass[3 * i + k] * m_inv;
+      double x = root->x[k] + dx;
+      if (s->periodic) x = box_wrap(x, 0., s->dim[k]);
+
+      group_centre_of_mass[3 * i + k] = x;
+      group_velocity[3 * i + k] *= m_inv;
+      r2 -= dx * dx;
+    }
+    group_radius[i] = sqrt(max(r2, 0.));
+  }
+}
+
+#if defined(HAVE_HDF5)
+
+/**
+ * @brief Create an empty field of the group catalogue.
+ *
+ * @param h_grp The HDF5 group to create the field in.
+ * @param name The name of the field.
+ * @param type The type of the field.
+ * @param dim The number of elements per group.
+ * @param num_groups The total number of groups in the catalogue.
+ * @param description The description of the field.
+ */
+static void fof_create_catalogue_field(hid_t h_grp, const char *name,
+                                       enum IO_DATA_TYPE type, const int dim,
+                                       const long long num_groups,
+                                       const char *description) {
+
+  const hsize_t shape[2] = {(hsize_t)num_groups, (hsize_t)dim};
+  const hid_t h_space = H5Screate_simple(dim > 1 ? 2 : 1, shape, NULL);
+  if (h_space < 0)
+    error("Error while creating data space for field '%s'.", name);
+
+  const hid_t h_data = H5Dcreate(h_grp, name, io_hdf5_type(type), h_space,
+                                 H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  if (h_data < 0) error("Error while creating dataset '%s'.", name);
+
+  io_write_attribute_s(h_data, "Description", description);
+
+  H5Dclose(h_data);
+  H5Sclose(h_space);
+}
+
+/**
+ * @brief Write the groups of this node to a field of the group catalogue.
+ *
+ * @param h_grp The HDF5 group containing the field.
+ * @param name The name of the field.
+ * @param type The type of the field.
+ * @param dim The number of elements per group.
+ * @param offset The position of the first group of this node in the field.
+ * @param num_groups The number of groups of this node.
+ * @param data The values to write.
+ * @param h_plist The data transfer property list.
+ */
+static void fof_write_catalogue_field(hid_t h_grp, const char *name,
+                                      enum IO_DATA_TYPE type, const int dim,
+                                      const long long offset,
+                                      const size_t num_groups, const void *data,
+                                      hid_t h_plist) {
+
+  const hid_t h_data = H5Dopen(h_grp, name, H5P_DEFAULT);
+  if (h_data < 0) error("Error while opening dataset '%s'.", name);
+
+  const int rank = dim > 1 ? 2 : 1;
+  const hsize_t start[2] = {(hsize_t)offset, 0};
+  const hsize_t count[2] = {(hsize_t)num_groups, (hsize_t)dim};
+
+  const hid_t h_memspace = H5Screate_simple(rank, count, NULL);
+  const hid_t h_filespace = H5Dget_space(h_data);
+  if (num_groups > 0) {
+    H5Sselect_hyperslab(h_filespace, H5S_SELECT_SET, start, NULL, count, NULL);
+  } else {
+    H5Sselect_none(h_memspace);
+    H5Sselect_none(h_filespace);
+  }
+
+  if (H5Dwrite(h_data, io_hdf5_type(type), h_memspace, h_filespace, h_plist,
+               data) < 0)
+    error("Error while writing dataset '%s'.", name);
+
+  H5Sclose(h_filespace);
+  H5Sclose(h_memspace);
+  H5Dclose(h_data);
+}
+
+/**
+ * @brief Create the group catalogue file with its header and empty fields.
+ *
+ * @param file_name The name of the file.
+ * @param props The properties of the FOF.
+ * @param e The #engine.
+ * @param num_groups The total number of groups.
+ * @param h_fapl The file access property list.
+ *
+ * @return The HDF5 handle of the file.
+ */
+static hid_t fof_create_catalogue(const char *file_name,
+                                  const struct fof_props *props,
+                                  const struct engine *e,
+                                  const long long num_groups, hid_t h_fapl) {
+
+  const hid_t h_file =
+      H5Fcreate(file_name, H5F_ACC_TRUNC, H5P_DEFAULT, h_fapl);
+  if (h_file < 0) error("Error while opening file '%s'.", file_name);
+
+  io_write_code_description(h_file);
+
+  const hid_t h_grp = H5Gcreate(h_file, "/Header", H5P_DEFAULT, H5P_DEFAULT,
+                                H5P_DEFAULT);
+  if (h_grp < 0) error("Error while creating file header\n");
+  io_write_attribute(h_grp, "BoxSize", DOUBLE, e->s->dim, 3);
+  io_write_attribute_d(h_grp, "Time", e->time);
+  if (e->policy & engine_policy_cosmology) {
+    io_write_attribute_d(h_grp, "Scale-factor", e->cosmology->a);
+    io_write_attribute_d(h_grp, "Redshift", e->cosmology->z);
+  }
+  io_write_attribute(h_grp, "NumGroups_Total", LONGLONG, &num_groups, 1);
+  io_write_attribute_d(h_grp, "LinkingLength", sqrt(props->l_x2));
+  const long long min_group_size = props->min_group_size;
+  io_write_attribute(h_grp, "MinGroupSize", LONGLONG, &min_group_size, 1);
+  H5Gclose(h_grp);
+
+  /* The catalogue is in internal units */
+  io_write_unit_system(h_file, e->internal_units, "Units");
+
+  const hid_t h_groups = H5Gcreate(h_file, "/Groups", H5P_DEFAULT,
+                                   H5P_DEFAULT, H5P_DEFAULT);
+  if (h_groups < 0) error("Error while creating the groups group.");
+  fof_create_catalogue_field(h_groups, "GroupIDs", LONGLONG, 1, num_groups,
+                             "ID of the groups (gpart group_id)");
+  fof_create_catalogue_field(h_groups, "Sizes", LONGLONG, 1, num_groups,
+                             "Number of particles in the groups");
+  fof_create_catalogue_field(h_groups, "Masses", DOUBLE, 1, num_groups,
+                             "Total mass of the groups");
+  fof_create_catalogue_field(h_groups, "CentresOfMass", DOUBLE, 3, num_groups,
+                             "Co-moving centre of mass of the groups");
+  fof_create_catalogue_field(
+      h_groups, "Velocities", DOUBLE, 3, num_groups,
+      "Mass-weighted mean velocity of the groups (internal velocity variable)");
+  fof_create_catalogue_field(
+      h_groups, "Radii", DOUBLE, 1, num_groups,
+      "Co-moving mass-weighted r.m.s. distance of the particles to the centre "
+      "of mass");
+  fof_create_catalogue_field(
+      h_groups, "MaxDensities", FLOAT, 1, num_groups,
+      "Co-moving density of the densest gas particle (0 if not searched)");
+  fof_create_catalogue_field(
+      h_groups, "MaxDensityParticleIDs", LONGLONG, 1, num_groups,
+      "ID of the densest gas particle (-1 if there is none)");
+  H5Gclose(h_groups);
+
+  return h_file;
+}
+
+/**
+ * @brief Write the groups of this node to the catalogue file.
+ */
+static void fof_write_catalogue_groups(
+    hid_t h_file, const long long offset, const size_t num_groups,
+    const long long *ids, const long long *sizes, const long long *part_ids,
+    const struct fof_props *props, hid_t h_plist) {
+
+  const hid_t h_groups = H5Gopen(h_file, "/Groups", H5P_DEFAULT);
+  if (h_groups < 0) error("Error while opening the groups group.");
+
+  fof_write_catalogue_field(h_groups, "GroupIDs", LONGLONG, 1, offset,
+                            num_groups, ids, h_plist);
+  fof_write_catalogue_field(h_groups, "Sizes", LONGLONG, 1, offset, num_groups,
+                            sizes, h_plist);
+  fof_write_catalogue_field(h_groups, "Masses", DOUBLE, 1, offset, num_groups,
+                            props->group_mass, h_plist);
+  fof_write_catalogue_field(h_groups, "CentresOfMass", DOUBLE, 3, offset,
+                            num_groups, props->group_centre_of_mass, h_plist);
+  fof_write_catalogue_field(h_groups, "Velocities", DOUBLE, 3, offset,
+                            num_groups, props->group_velocity, h_plist);
+  fof_write_catalogue_field(h_groups, "Radii", DOUBLE, 1, offset, num_groups,
+                            props->group_radius, h_plist);
+  fof_write_catalogue_field(h_groups, "MaxDensities", FLOAT, 1, offset,
+                            num_groups, props->max_part_density, h_plist);
+  fof_write_catalogue_field(h_groups, "MaxDensityParticleIDs", LONGLONG, 1,
+                            offset, num_groups, part_ids, h_plist);
+
+  H5Gclose(h_groups);
+}
+
+#endif /* HAVE_HDF5 */
+
+/**
+ * @brief Write the catalogue of the groups found by all the nodes to a single
+ * HDF5 file.
+ *
+ * With parallel HDF5, all the nodes write their groups collectively.
+ * Otherwise they take turns to write their slice of the fields.
+ *
+ * @param props The properties of the FOF.
+ * @param out_file_name The name of the catalogue file.
+ * @param s The #space.
+ * @param num_groups The number of groups with a root on this node.
+ * @param group_sizes The root and size of the groups on this node.
+ */
 void fof_dump_group_data(const struct fof_props *props,
                          const char *out_file_name, struct space *s,
                          int num_groups, struct group_length *group_sizes) {
 
-  FILE *file = fopen(out_file_name, "w");
+#if defined(HAVE_HDF5)
 
-  struct gpart *gparts = s->gparts;
-  struct part *parts = s->parts;
-  size_t *group_size = props->group_size;
-  double *group_mass = props->group_mass;
+  const struct engine *e = s->e;
+  const struct gpart *gparts = s->gparts;
+  const struct part *parts = s->parts;
+  const size_t *group_size = props->group_size;
   const long long *max_part_density_index = props->max_part_density_index;
-  const float *max_part_density = props->max_part_density;
 
-  fprintf(file, "# %8s %12s %12s %12s %18s %18s %12s\n", "Group ID",
-          "Group Size", "Group Mass", "Max Density", "Max Density Index",
-          "Particle ID", "Particle Density");
-  fprintf(file,
-          "#-------------------------------------------------------------------"
-          "-------------\n");
+  /* Collect the integer properties of the groups of this node */
+  long long *ids = (long long *)malloc(num_groups * sizeof(long long));
+  long long *sizes = (long long *)malloc(num_groups * sizeof(long long));
+  long long *part_ids = (long long *)malloc(num_groups * sizeof(long long));
+  if ((ids == NULL || sizes == NULL || part_ids == NULL) && num_groups > 0)
+    error("Failed to allocate the group catalogue buffers.");
 
   for (int i = 0; i < num_groups; i++) {
+#ifdef WITH_MPI
+    const size_t root = group_sizes[i].index - node_offset;
+#else
+    const size_t root = group_sizes[i].index;
+#endif
+    ids[i] = gparts[root].group_id;
+    sizes[i] = group_size[root];
+    part_ids[i] = max_part_density_index[i] >= 0
+                      ? parts[max_part_density_index[i]].id
+                      : -1;
+  }
+
+  const long long num_groups_total = props->num_groups;
 
-    const size_t group_offset = group_sizes[i].index;
-    const long long part_id = max_part_density_index[i] >= 0
-                                  ? parts[max_part_density_index[i]].id
-                                  : -1;
 #ifdef WITH_MPI
-    fprintf(file, "  %8zu %12zu %12e %12e %18lld %18lld\n",
-            gparts[group_offset - node_offset].group_id,
-            group_size[group_offset - node_offset], group_mass[i],
-            max_part_density[i], max_part_density_index[i], part_id);
+
+  /* Position of the groups of this node in the catalogue */
+  long long offset = 0;
+  const long long num_groups_local = num_groups;
+  MPI_Exscan(&num_groups_local, &offset, 1, MPI_LONG_LONG_INT, MPI_SUM,
+             MPI_COMM_WORLD);
+  if (e->nodeID == 0) offset = 0;
+
+#ifdef HAVE_PARALLEL_HDF5
+
+  /* All the nodes create and write the file together */
+  const hid_t h_fapl = H5Pcreate(H5P_FILE_ACCESS);
+  H5Pset_fapl_mpio(h_fapl, MPI_COMM_WORLD, MPI_INFO_NULL);
+  const hid_t h_file = fof_create_catalogue(out_file_name, props, e,
+                                            num_groups_total, h_fapl);
+  H5Pclose(h_fapl);
+
+  const hid_t h_plist = H5Pcreate(H5P_DATASET_XFER);
+  H5Pset_dxpl_mpio(h_plist, H5FD_MPIO_COLLECTIVE);
+  fof_write_catalogue_groups(h_file, offset, num_groups, ids, sizes, part_ids,
+                             props, h_plist);
+  H5Pclose(h_plist);
+  H5Fclose(h_file);
+
 #else
-    fprintf(file, "  %8zu %12zu %12e %12e %18lld %18lld\n",
-            gparts[group_offset].group_id, group_size[group_offset],
-            group_mass[i], max_part_density[i], max_part_density_index[i],
-            part_id);
+
+  /* The nodes take turns to write their groups */
+  for (int rank = 0; rank < e->nr_nodes; rank++) {
+    if (rank == e->nodeID) {
+      hid_t h_file;
+      if (rank == 0)
+        h_file = fof_create_catalogue(out_file_name, props, e,
+                                      num_groups_total, H5P_DEFAULT);
+      else
+        h_file = H5Fopen(out_file_name, H5F_ACC_RDWR, H5P_DEFAULT);
+      if (h_file < 0) error("Error while opening file '%s'.", out_file_name);
+
+      fof_write_catalogue_groups(h_file, offset, num_groups, ids, sizes,
+                                 part_ids, props, H5P_DEFAULT);
+      H5Fclose(h_file);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+  }
+
+#endif /* HAVE_PARALLEL_HDF5 */
+
+#else
+
+  const hid_t h_file = fof_create_catalogue(out_file_name, props, e,
+                                            num_groups_total, H5P_DEFAULT);
+  fof_write_catalogue_groups(h_file, /*offset=*/0, num_groups, ids, sizes,
+                             part_ids, props, H5P_DEFAULT);
+  H5Fclose(h_file);
+
+#endif /* WITH_MPI */
+
+  free(ids);
+  free(sizes);
+  free(part_ids);
+
+#else
+  error("Writing the FOF group catalogue requires HDF5.");
+#endif /* HAVE_HDF5 */
+}
+
+#ifdef WITH_MPI
+
+/**
+ * @brief Send label updates to the ranks owning the groups and apply them
+ * if they take precedence over the current labels.
+ *
+ * @param map The hash table of the linked groups owned by this rank.
+ * @param label The current labels of the linked groups owned by this rank.
+ * @param hooks The updates to send.
+ * @param dest The rank owning the group targeted by each update.
+ * @param nr_hooks The number of updates to send.
+ * @param nr_nodes The number of MPI ranks.
+ */
+static void fof_mpi_exchange_apply_hooks(
+    hashmap_t *map, struct fof_mpi_label *label,
+    const struct fof_mpi_label_update *hooks, const int *dest,
+    const size_t nr_hooks, const int nr_nodes) {
+
+  struct fof_mpi_exchange ex;
+  fof_mpi_exchange_init(&ex, dest, nr_hooks, nr_nodes);
+
+  struct fof_mpi_label_update *hooks_send =
+      (struct fof_mpi_label_update *)swift_malloc(
+          "fof_hooks_send", nr_hooks * sizeof(struct fof_mpi_label_update));
+  struct fof_mpi_label_update *hooks_recv =
+      (struct fof_mpi_label_update *)swift_malloc(
+          "fof_hooks_recv", ex.nrecv * sizeof(struct fof_mpi_label_update));
+  if (hooks_send == NULL || hooks_recv == NULL)
+    error("Error while allocating memory for FOF hooks");
+
+  for (size_t k = 0; k < nr_hooks; k++) hooks_send[ex.send_pos[k]] = hooks[k];
+
+  MPI_Alltoallv(hooks_send, ex.sendcount, ex.sendoffset,
+                fof_mpi_label_update_type, hooks_recv, ex.recvcount,
+                ex.recvoffset, fof_mpi_label_update_type, MPI_COMM_WORLD);
+
+  for (size_t k = 0; k < ex.nrecv; k++) {
+    const size_t offset =
+        hashmap_find_group_offset(hooks_recv[k].group_id, map);
+    if (fof_label_precedes(&hooks_recv[k].label, &label[offset]))
+      label[offset] = hooks_recv[k].label;
+  }
+
+  fof_mpi_exchange_clean(&ex);
+  swift_free("fof_hooks_send", hooks_send);
+  swift_free("fof_hooks_recv", hooks_recv);
+}
+
+/**
+ * @brief Replace the labels of the linked groups by the labels of their
+ * labels until every label is a root.
+ *
+ * @param map The hash table of the linked groups owned by this rank.
+ * @param linked_group The linked groups owned by this rank.
+ * @param label The current labels of the linked groups owned by this rank.
+ * @param nr_linked_groups The number of linked groups owned by this rank.
+ * @param first_on_node The global ID of the first particle on each rank.
+ * @param nr_nodes The number of MPI ranks.
+ */
+static void fof_mpi_pointer_jumping(hashmap_t *map,
+                                    const struct fof_mpi_label *linked_group,
+                                    struct fof_mpi_label *label,
+                                    const size_t nr_linked_groups,
+                                    const size_t *first_on_node,
+                                    const int nr_nodes) {
+
+  int *dest = (int *)malloc(nr_linked_groups * sizeof(int));
+  size_t *which = (size_t *)malloc(nr_linked_groups * sizeof(size_t));
+  struct fof_mpi_label *query = (struct fof_mpi_label *)swift_malloc(
+      "fof_jump_query", nr_linked_groups * sizeof(struct fof_mpi_label));
+  if (dest == NULL || which == NULL || query == NULL)
+    error("Error while allocating memory for the FOF pointer-jumping");
+
+  long long global_nr_changed = 0;
+  do {
+
+    /* Ask the owner of every non-root label for its own label. */
+    size_t nr_queries = 0;
+    for (size_t k = 0; k < nr_linked_groups; k++) {
+      if (label[k].group_id == linked_group[k].group_id) continue;
+      which[nr_queries] = k;
+      dest[nr_queries] =
+          fof_group_owner(label[k].group_id, first_on_node, nr_nodes);
+      nr_queries++;
+    }
+
+    struct fof_mpi_exchange ex;
+    fof_mpi_exchange_init(&ex, dest, nr_queries, nr_nodes);
+
+    struct fof_mpi_label *answers = (struct fof_mpi_label *)swift_malloc(
+        "fof_jump_answers", ex.nrecv * sizeof(struct fof_mpi_label));
+    if (answers == NULL)
+      error("Error while allocating memory for the FOF pointer-jumping");
+
+    for (size_t q = 0; q < nr_queries; q++)
+      query[ex.send_pos[q]] = label[which[q]];
+
+    MPI_Alltoallv(query, ex.sendcount, ex.sendoffset, fof_mpi_label_type,
+                  answers, ex.recvcount, ex.recvoffset, fof_mpi_label_type,
+                  MPI_COMM_WORLD);
+
+    /* Answer with the current label of the groups we own. */
+    for (size_t k = 0; k < ex.nrecv; k++)
+      answers[k] = label[hashmap_find_group_offset(answers[k].group_id, map)];
+
+    MPI_Alltoallv(answers, ex.recvcount, ex.recvoffset, fof_mpi_label_type,
+                  query, ex.sendcount, ex.sendoffset, fof_mpi_label_type,
+                  MPI_COMM_WORLD);
+
+    /* Jump. */
+    long long nr_changed = 0;
+    for (size_t q = 0; q < nr_queries; q++) {
+      const struct fof_mpi_label *new_label = &query[ex.send_pos[q]];
+      if (new_label->group_id != label[which[q]].group_id) {
+        label[which[q]] = *new_label;
+        nr_changed++;
+      }
+    }
+
+    MPI_Allreduce(&nr_changed, &global_nr_changed, 1, MPI_LONG_LONG_INT,
+                  MPI_SUM, MPI_COMM_WORLD);
+
+    fof_mpi_exchange_clean(&ex);
+    swift_free("fof_jump_answers", answers);
+
+  } while (global_nr_changed > 0);
+
+  free(dest);
+  free(which);
+  swift_free("fof_jump_query", query);
+}
+
+/**
+ * @brief Merge the groups linked across MPI domains using a distributed
+ * union-find.
+ *
+ * Every group is owned by the rank holding its root. The owner of each group
+ * involved in a link keeps its label, i.e. the group it is currently attached
+ * to. We then iterate over two steps until the labels at the two ends of all
+ * the links agree:
+ *  - Hooking: each rank fetches the labels of both ends of its own links and
+ *    attaches the label of lower precedence to the other one.
+ *  - Pointer-jumping: owners replace the labels of their groups by the label
+ *    of their label until all the trees are stars.
+ *
+ * All the exchanges are point-to-point via MPI_Alltoallv such that the memory
+ * used by each rank only scales with its own number of links.
+ *
+ * Finally, the owners update the root and size of their groups.
+ *
+ * @param props The properties of the FOF scheme.
+ * @param s The #space containing the particles.
+ * @param group_links The links found by this rank.
+ * @param group_link_count The number of links found by this rank.
+ */
+static void fof_merge_foreign_links(struct fof_props *props,
+                                    const struct space *s,
+                                    const struct fof_mpi *group_links,
+                                    const int group_link_count) {
+
+  const struct engine *e = s->e;
+  const int nr_nodes = e->nr_nodes;
+  const int verbose = e->verbose;
+  size_t *group_index = props->group_index;
+  size_t *group_size = props->group_size;
+
+  ticks tic = getticks();
+
+  /* Determine the range of global group IDs owned by each rank */
+  size_t *first_on_node = (size_t *)malloc(nr_nodes * sizeof(size_t));
+  if (first_on_node == NULL)
+    error("Error while allocating memory for the FOF rank offsets");
+  MPI_Allgather(&node_offset, sizeof(size_t), MPI_BYTE, first_on_node,
+                sizeof(size_t), MPI_BYTE, MPI_COMM_WORLD);
+
+  /* Both ends of every link are registered with the rank owning them. The
+   * same pattern is then used to fetch their labels at every iteration. */
+  const size_t nr_ends = 2 * (size_t)group_link_count;
+  int *dest = (int *)malloc(nr_ends * sizeof(int));
+  struct fof_mpi_label *ends = (struct fof_mpi_label *)swift_malloc(
+      "fof_link_ends", nr_ends * sizeof(struct fof_mpi_label));
+  if (dest == NULL || ends == NULL)
+    error("Error while allocating memory for the FOF link ends");
+
+  for (int i = 0; i < group_link_count; i++) {
+    dest[2 * i] =
+        fof_group_owner(group_links[i].group_i, first_on_node, nr_nodes);
+    dest[2 * i + 1] =
+        fof_group_owner(group_links[i].group_j, first_on_node, nr_nodes);
+  }
+
+  struct fof_mpi_exchange ex_ends;
+  fof_mpi_exchange_init(&ex_ends, dest, nr_ends, nr_nodes);
+
+  for (int i = 0; i < group_link_count; i++) {
+    ends[ex_ends.send_pos[2 * i]].group_id = group_links[i].group_i;
+    ends[ex_ends.send_pos[2 * i]].group_size = group_links[i].group_i_size;
+    ends[ex_ends.send_pos[2 * i + 1]].group_id = group_links[i].group_j;
+    ends[ex_ends.send_pos[2 * i + 1]].group_size = group_links[i].group_j_size;
+  }
+
+  struct fof_mpi_label *ends_recv = (struct fof_mpi_label *)swift_malloc(
+      "fof_link_ends_recv", ex_ends.nrecv * sizeof(struct fof_mpi_label));
+  size_t *ends_recv_group = (size_t *)malloc(ex_ends.nrecv * sizeof(size_t));
+  if (ends_recv == NULL || ends_recv_group == NULL)
+    error("Error while allocating memory for the FOF link ends");
+
+  MPI_Alltoallv(ends, ex_ends.sendcount, ex_ends.sendoffset, fof_mpi_label_type,
+                ends_recv, ex_ends.recvcount, ex_ends.recvoffset,
+                fof_mpi_label_type, MPI_COMM_WORLD);
+
+  /* Build the list of linked groups owned by this rank. */
+  struct fof_mpi_label *linked_group = (struct fof_mpi_label *)swift_malloc(
+      "fof_linked_group", ex_ends.nrecv * sizeof(struct fof_mpi_label));
+  struct fof_mpi_label *label = (struct fof_mpi_label *)swift_malloc(
+      "fof_linked_group_label", ex_ends.nrecv * sizeof(struct fof_mpi_label));
+  if (linked_group == NULL || label == NULL)
+    error("Error while allocating memory for the FOF linked groups");
+
+  hashmap_t map;
+  hashmap_init(&map);
+  size_t nr_linked_groups = 0;
+
+  for (size_t k = 0; k < ex_ends.nrecv; k++) {
+
+    const size_t group_id = ends_recv[k].group_id;
+
+#ifdef SWIFT_DEBUG_CHECKS
+    if (!is_local(group_id, s->nr_gparts))
+      error("Received a link end for a group not owned by this rank.");
 #endif
+
+    int created_new_element = 0;
+    hashmap_value_t *offset =
+        hashmap_get_new(&map, group_id, &created_new_element);
+    if (offset == NULL)
+      error("Couldn't find key (%zu) or create new one.", group_id);
+
+    if (created_new_element) {
+      offset->value_st = nr_linked_groups;
+
+      /* Use our own (authoritative) size for the group. */
+      linked_group[nr_linked_groups].group_id = group_id;
+      linked_group[nr_linked_groups].group_size =
+          group_size[group_id - node_offset];
+      label[nr_linked_groups] = linked_group[nr_linked_groups];
+      nr_linked_groups++;
+    }
+
+    ends_recv_group[k] = (size_t)offset->value_st;
+  }
+
+  if (verbose)
+    message("Registering %zu linked groups took: %.3f %s.", nr_linked_groups,
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  tic = getticks();
+
+  int nr_iterations = 0;
+  while (1) {
+
+    nr_iterations++;
+
+    /* Fetch the labels of both ends of our links. */
+    for (size_t k = 0; k < ex_ends.nrecv; k++)
+      ends_recv[k] = label[ends_recv_group[k]];
+
+    MPI_Alltoallv(ends_recv, ex_ends.recvcount, ex_ends.recvoffset,
+                  fof_mpi_label_type, ends, ex_ends.sendcount,
+                  ex_ends.sendoffset, fof_mpi_label_type, MPI_COMM_WORLD);
+
+    /* Count the links whose ends are not in the same group yet. */
+    long long nr_hooks = 0;
+    for (int i = 0; i < group_link_count; i++)
+      if (ends[ex_ends.send_pos[2 * i]].group_id !=
+          ends[ex_ends.send_pos[2 * i + 1]].group_id)
+        nr_hooks++;
+
+    long long global_nr_hooks = 0;
+    MPI_Allreduce(&nr_hooks, &global_nr_hooks, 1, MPI_LONG_LONG_INT, MPI_SUM,
+                  MPI_COMM_WORLD);
+    if (global_nr_hooks == 0) break;
+
+    /* Hook the label of lower precedence onto the other one. */
+    struct fof_mpi_label_update *hooks =
+        (struct fof_mpi_label_update *)swift_malloc(
+            "fof_hooks", nr_hooks * sizeof(struct fof_mpi_label_update));
+    if (hooks == NULL) error("Error while allocating memory for FOF hooks");
+
+    nr_hooks = 0;
+    for (int i = 0; i < group_link_count; i++) {
+      const struct fof_mpi_label *a = &ends[ex_ends.send_pos[2 * i]];
+      const struct fof_mpi_label *b = &ends[ex_ends.send_pos[2 * i + 1]];
+      if (a->group_id == b->group_id) continue;
+
+      const int a_wins = fof_label_precedes(a, b);
+      hooks[nr_hooks].group_id = a_wins ? b->group_id : a->group_id;
+      hooks[nr_hooks].label = a_wins ? *a : *b;
+      dest[nr_hooks] =
+          fof_group_owner(hooks[nr_hooks].group_id, first_on_node, nr_nodes);
+      nr_hooks++;
+    }
+
+    fof_mpi_exchange_apply_hooks(&map, label, hooks, dest, nr_hooks, nr_nodes);
+    swift_free("fof_hooks", hooks);
+
+    /* Pointer-jumping until all the trees are stars. */
+    fof_mpi_pointer_jumping(&map, linked_group, label, nr_linked_groups,
+                            first_on_node, nr_nodes);
   }
 
-  /* Dump the extra black hole seeds. */
-  for (int i = num_groups; i < num_groups + props->extra_bh_seed_count; i++) {
-    const long long part_id = max_part_density_index[i] >= 0
-                                  ? parts[max_part_density_index[i]].id
-                                  : -1;
-    fprintf(file, "  %8zu %12zu %12e %12e %18lld %18lld\n", 0UL, 0UL, 0., 0.,
-            0LL, part_id);
+  if (verbose)
+    message("Distributed union-find took: %.3f %s (%d iterations).",
+            clocks_from_ticks(getticks() - tic), clocks_getunit(),
+            nr_iterations);
+
+  tic = getticks();
+
+  /* Update the groups we own with their new root and send their size to the
+   * rank owning that root. */
+  size_t nr_merged = 0;
+  for (size_t k = 0; k < nr_linked_groups; k++)
+    if (label[k].group_id != linked_group[k].group_id) nr_merged++;
+
+  struct fof_mpi_label_update *merged =
+      (struct fof_mpi_label_update *)swift_malloc(
+          "fof_merged", nr_merged * sizeof(struct fof_mpi_label_update));
+  int *merged_dest = (int *)malloc(nr_merged * sizeof(int));
+  if (merged == NULL || merged_dest == NULL)
+    error("Error while allocating memory for the FOF merged groups");
+
+  nr_merged = 0;
+  for (size_t k = 0; k < nr_linked_groups; k++) {
+
+    const size_t group_id = linked_group[k].group_id;
+    const size_t new_root = label[k].group_id;
+    if (new_root == group_id) continue;
+
+    group_index[group_id - node_offset] = new_root;
+    group_size[group_id - node_offset] -= linked_group[k].group_size;
+
+    merged[nr_merged].group_id = new_root;
+    merged[nr_merged].label = linked_group[k];
+    merged_dest[nr_merged] = fof_group_owner(new_root, first_on_node, nr_nodes);
+    nr_merged++;
   }
 
-  fclose(file);
+  struct fof_mpi_exchange ex_merged;
+  fof_mpi_exchange_init(&ex_merged, merged_dest, nr_merged, nr_nodes);
+
+  struct fof_mpi_label_update *merged_send =
+      (struct fof_mpi_label_update *)swift_malloc(
+          "fof_merged_send", nr_merged * sizeof(struct fof_mpi_label_update));
+  struct fof_mpi_label_update *merged_recv =
+      (struct fof_mpi_label_update *)swift_malloc(
+          "fof_merged_recv",
+          ex_merged.nrecv * sizeof(struct fof_mpi_label_update));
+  if (merged_send == NULL || merged_recv == NULL)
+    error("Error while allocating memory for the FOF merged groups");
+
+  for (size_t k = 0; k < nr_merged; k++)
+    merged_send[ex_merged.send_pos[k]] = merged[k];
+
+  MPI_Alltoallv(merged_send, ex_merged.sendcount, ex_merged.sendoffset,
+                fof_mpi_label_update_type, merged_recv, ex_merged.recvcount,
+                ex_merged.recvoffset, fof_mpi_label_update_type,
+                MPI_COMM_WORLD);
+
+  /* Add the size of the fragments to the roots we own. */
+  for (size_t k = 0; k < ex_merged.nrecv; k++)
+    group_size[merged_recv[k].group_id - node_offset] +=
+        merged_recv[k].label.group_size;
+
+  if (verbose)
+    message("Updating groups locally took: %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  /* Clean up memory. */
+  fof_mpi_exchange_clean(&ex_merged);
+  fof_mpi_exchange_clean(&ex_ends);
+  hashmap_free(&map);
+  free(dest);
+  free(merged_dest);
+  free(first_on_node);
+  free(ends_recv_group);
+  swift_free("fof_link_ends", ends);
+  swift_free("fof_link_ends_recv", ends_recv);
+  swift_free("fof_linked_group", linked_group);
+  swift_free("fof_linked_group_label", label);
+  swift_free("fof_merged", merged);
+  swift_free("fof_merged_send", merged_send);
+  swift_free("fof_merged_recv", merged_recv);
 }
 
+#endif /* WITH_MPI */
+
 /**
  * @brief Search foreign cells for links and communicate any found to the
  * appropriate node.
@@ -2166,10 +3692,6 @@ void fof_search_foreign_cells(struct fof_props *props, const struct space *s) {
 
   tic = getticks();
 
-  struct fof_mpi *global_group_links = NULL;
-  int *displ = NULL, *group_link_counts = NULL;
-  int global_group_link_count = 0;
-
   ticks comms_tic = getticks();
 
   MPI_Barrier(MPI_COMM_WORLD);
@@ -2178,216 +3700,17 @@ void fof_search_foreign_cells(struct fof_props *props, const struct space *s) {
     message("Imbalance took: %.3f %s.",
             clocks_from_ticks(getticks() - comms_tic), clocks_getunit());
 
-  comms_tic = getticks();
-
-  /* Sum the total number of links across MPI domains over each MPI rank. */
-  MPI_Allreduce(&group_link_count, &global_group_link_count, 1, MPI_INT,
-                MPI_SUM, MPI_COMM_WORLD);
-
-  /* Unique set of links is half of all group links as each link is found twice
-   * by opposing MPI ranks. */
-  if (swift_memalign("fof_global_group_links", (void **)&global_group_links,
-                     SWIFT_STRUCT_ALIGNMENT,
-                     global_group_link_count * sizeof(struct fof_mpi)) != 0)
-    error("Error while allocating memory for the global list of group links");
-
-  if (posix_memalign((void **)&group_link_counts, SWIFT_STRUCT_ALIGNMENT,
-                     e->nr_nodes * sizeof(int)) != 0)
-    error(
-        "Error while allocating memory for the number of group links on each "
-        "MPI rank");
-
-  if (posix_memalign((void **)&displ, SWIFT_STRUCT_ALIGNMENT,
-                     e->nr_nodes * sizeof(int)) != 0)
-    error(
-        "Error while allocating memory for the displacement in memory for the "
-        "global group link list");
-
-  /* Gather the total number of links on each rank. */
-  MPI_Allgather(&group_link_count, 1, MPI_INT, group_link_counts, 1, MPI_INT,
-                MPI_COMM_WORLD);
-
-  /* Set the displacements into the global link list using the link counts from
-   * each rank */
-  displ[0] = 0;
-  for (int i = 1; i < e->nr_nodes; i++)
-    displ[i] = displ[i - 1] + group_link_counts[i - 1];
-
-  /* Gather the global link list on all ranks. */
-  MPI_Allgatherv(props->group_links, group_link_count, fof_mpi_type,
-                 global_group_links, group_link_counts, displ, fof_mpi_type,
-                 MPI_COMM_WORLD);
+  /* Merge the groups linked across MPI domains. */
+  fof_merge_foreign_links(props, s, props->group_links, group_link_count);
 
   /* Clean up memory. */
-  free(displ);
   swift_free("fof_group_links", props->group_links);
   props->group_links = NULL;
 
-  if (verbose) {
-    message("Communication took: %.3f %s.",
-            clocks_from_ticks(getticks() - comms_tic), clocks_getunit());
-
-    message("Global comms took: %.3f %s.", clocks_from_ticks(getticks() - tic),
-            clocks_getunit());
-  }
-
-  tic = getticks();
-
-  /* Transform the group IDs to a local list going from 0-group_count so a
-   * union-find can be performed. */
-  size_t *global_group_index = NULL, *global_group_id = NULL,
-         *global_group_size = NULL;
-  const int global_group_list_size = 2 * global_group_link_count;
-  int group_count = 0;
-
-  if (swift_memalign("fof_global_group_index", (void **)&global_group_index,
-                     SWIFT_STRUCT_ALIGNMENT,
-                     global_group_list_size * sizeof(size_t)) != 0)
-    error(
-        "Error while allocating memory for the displacement in memory for the "
-        "global group link list");
-
-  if (swift_memalign("fof_global_group_id", (void **)&global_group_id,
-                     SWIFT_STRUCT_ALIGNMENT,
-                     global_group_list_size * sizeof(size_t)) != 0)
-    error(
-        "Error while allocating memory for the displacement in memory for the "
-        "global group link list");
-
-  if (swift_memalign("fof_global_group_size", (void **)&global_group_size,
-                     SWIFT_STRUCT_ALIGNMENT,
-                     global_group_list_size * sizeof(size_t)) != 0)
-    error(
-        "Error while allocating memory for the displacement in memory for the "
-        "global group link list");
-
-  bzero(global_group_size, global_group_list_size * sizeof(size_t));
-
-  /* Create hash table. */
-  hashmap_t map;
-  hashmap_init(&map);
-
-  /* Store each group ID and its properties. */
-  for (int i = 0; i < global_group_link_count; i++) {
-
-    size_t group_i = global_group_links[i].group_i;
-    size_t group_j = global_group_links[i].group_j;
-
-    global_group_size[group_count] += global_group_links[i].group_i_size;
-    global_group_id[group_count] = group_i;
-    hashmap_add_group(group_i, group_count++, &map);
-
-    global_group_size[group_count] += global_group_links[i].group_j_size;
-    global_group_id[group_count] = group_j;
-    hashmap_add_group(group_j, group_count++, &map);
-  }
-
-  if (verbose)
-    message("Global list compression took: %.3f %s.",
-            clocks_from_ticks(getticks() - tic), clocks_getunit());
-
-  tic = getticks();
-
-  /* Create a global_group_index list of groups across MPI domains so that you
-   * can perform a union-find locally on each node. */
-  /* The value of which is an offset into global_group_id, which is the actual
-   * root. */
-  for (int i = 0; i < group_count; i++) global_group_index[i] = i;
-
-  /* Store the original group size before incrementing in the Union-Find. */
-  size_t *orig_global_group_size = NULL;
-
-  if (swift_memalign("fof_orig_global_group_size",
-                     (void **)&orig_global_group_size, SWIFT_STRUCT_ALIGNMENT,
-                     group_count * sizeof(size_t)) != 0)
-    error(
-        "Error while allocating memory for the displacement in memory for the "
-        "global group link list");
-
-  for (int i = 0; i < group_count; i++)
-    orig_global_group_size[i] = global_group_size[i];
-
-  /* Perform a union-find on the group links. */
-  for (int i = 0; i < global_group_link_count; i++) {
-
-    /* Use the hash table to find the group offsets in the index array. */
-    size_t find_i =
-        hashmap_find_group_offset(global_group_links[i].group_i, &map);
-    size_t find_j =
-        hashmap_find_group_offset(global_group_links[i].group_j, &map);
-
-    /* Use the offset to find the group's root. */
-    size_t root_i = fof_find(find_i, global_group_index);
-    size_t root_j = fof_find(find_j, global_group_index);
-
-    size_t group_i = global_group_id[root_i];
-    size_t group_j = global_group_id[root_j];
-
-    if (group_i == group_j) continue;
-
-    /* Update roots accordingly. */
-    size_t size_i = global_group_size[root_i];
-    size_t size_j = global_group_size[root_j];
-#ifdef UNION_BY_SIZE_OVER_MPI
-    if (size_i < size_j) {
-      global_group_index[root_i] = root_j;
-      global_group_size[root_j] += size_i;
-    } else {
-      global_group_index[root_j] = root_i;
-      global_group_size[root_i] += size_j;
-    }
-#else
-    if (group_j < group_i) {
-      global_group_index[root_i] = root_j;
-      global_group_size[root_j] += size_i;
-    } else {
-      global_group_index[root_j] = root_i;
-      global_group_size[root_i] += size_j;
-    }
-#endif
-  }
-
-  hashmap_free(&map);
-
   if (verbose)
-    message("global_group_index construction took: %.3f %s.",
+    message("Merging the foreign links took: %.3f %s.",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 
-  tic = getticks();
-
-  /* Update each group locally with new root information. */
-  for (int i = 0; i < group_count; i++) {
-
-    size_t group_id = global_group_id[i];
-    size_t offset = fof_find(global_group_index[i], global_group_index);
-    size_t new_root = global_group_id[offset];
-
-    /* If the group is local update its root and size. */
-    if (is_local(group_id, nr_gparts) && new_root != group_id) {
-      group_index[group_id - node_offset] = new_root;
-
-      group_size[group_id - node_offset] -= orig_global_group_size[i];
-    }
-
-    /* If the group linked to a local root update its size. */
-    if (is_local(new_root, nr_gparts) && new_root != group_id) {
-
-      /* Use group sizes before Union-Find */
-      group_size[new_root - node_offset] += orig_global_group_size[i];
-    }
-  }
-
-  if (verbose)
-    message("Updating groups locally took: %.3f %s.",
-            clocks_from_ticks(getticks() - tic), clocks_getunit());
-
-  /* Clean up memory. */
-  swift_free("fof_global_group_links", global_group_links);
-  swift_free("fof_global_group_index", global_group_index);
-  swift_free("fof_global_group_size", global_group_size);
-  swift_free("fof_global_group_id", global_group_id);
-  swift_free("fof_orig_global_group_size", orig_global_group_size);
-
 #endif /* WITH_MPI */
 }
 
@@ -2445,13 +3768,11 @@ void fof_search_tree(struct fof_props *props,
            MPI_COMM_WORLD);
   node_offset = nr_gparts_cumulative - nr_gparts_local;
 
-  snprintf(output_file_name + strlen(output_file_name), FILENAME_BUFFER_SIZE,
-           "_mpi_rank_%d.dat", engine_rank);
-#else
-  snprintf(output_file_name + strlen(output_file_name), FILENAME_BUFFER_SIZE,
-           ".dat");
 #endif
 
+  snprintf(output_file_name + strlen(output_file_name), FILENAME_BUFFER_SIZE,
+           ".hdf5");
+
   /* Local copy of the arrays */
   group_index = props->group_index;
   group_size = props->group_size;
@@ -2708,6 +4029,20 @@ void fof_search_tree(struct fof_props *props,
 
   bzero(props->group_mass, num_groups_local * sizeof(double));
 
+  /* Allocate and initialise the arrays of the group moments. */
+  if (swift_memalign("fof_group_centre_of_mass",
+                     (void **)&props->group_centre_of_mass, 32,
+                     3 * num_groups_local * sizeof(double)) != 0 ||
+      swift_memalign("fof_group_velocity", (void **)&props->group_velocity, 32,
+                     3 * num_groups_local * sizeof(double)) != 0 ||
+      swift_memalign("fof_group_radius", (void **)&props->group_radius, 32,
+                     num_groups_local * sizeof(double)) != 0)
+    error("Failed to allocate list of group moments for FOF search.");
+
+  bzero(props->group_centre_of_mass, 3 * num_groups_local * sizeof(double));
+  bzero(props->group_velocity, 3 * num_groups_local * sizeof(double));
+  bzero(props->group_radius, num_groups_local * sizeof(double));
+
   ticks tic_seeding = getticks();
 
   double *group_mass = props->group_mass;
@@ -2720,6 +4055,8 @@ void fof_search_tree(struct fof_props *props,
   fof_calc_group_mass(props, s, num_groups_local, 0, NULL, NULL, group_mass);
 #endif
 
+  fof_finalise_group_properties(props, s, num_groups_local, high_group_sizes);
+
   if (verbose)
     message("Black hole seeding took: %.3f %s.",
             clocks_from_ticks(getticks() - tic_seeding), clocks_getunit());
@@ -2743,11 +4080,19 @@ void fof_search_tree(struct fof_props *props,
   swift_free("fof_group_mass", props->group_mass);
   swift_free("fof_max_part_density_index", props->max_part_density_index);
   swift_free("fof_max_part_density", props->max_part_density);
+  swift_free("fof_group_centre_of_mass", props->group_centre_of_mass);
+  swift_free("fof_group_velocity", props->group_velocity);
+  swift_free("fof_group_radius", props->group_radius);
+  free(props->cell_needs_search);
   props->group_index = NULL;
   props->group_size = NULL;
   props->group_mass = NULL;
   props->max_part_density_index = NULL;
   props->max_part_density = NULL;
+  props->group_centre_of_mass = NULL;
+  props->group_velocity = NULL;
+  props->group_radius = NULL;
+  props->cell_needs_search = NULL;
 
   if (engine_rank == 0) {
     message(
@@ -2778,7 +4123,13 @@ void fof_struct_dump(const struct fof_props *props, FILE *stream) {
   temp.group_mass = NULL;
   temp.max_part_density_index = NULL;
   temp.max_part_density = NULL;
+  temp.group_centre_of_mass = NULL;
+  temp.group_velocity = NULL;
+  temp.group_radius = NULL;
   temp.group_links = NULL;
+  temp.nr_cells_searched = 0;
+  temp.ti_cell_searched = NULL;
+  temp.cell_needs_search = NULL;
 
   restart_write_blocks((void *)&temp, sizeof(struct fof_props), 1, stream,
                        "fof_props", "fof_props");
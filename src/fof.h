@@ -25,6 +25,7 @@
 /* Local headers */
 #include "align.h"
 #include "parser.h"
+#include "timeline.h"
 
 /* Avoid cyclic inclusions */
 struct gpart;
@@ -34,6 +35,7 @@ struct unit_system;
 struct phys_const;
 struct black_holes_props;
 struct cosmology;
+struct fof_cache;
 
 /* MPI message required for FOF. */
 struct fof_mpi {
@@ -78,6 +80,13 @@ struct fof_props {
   /*! ID of the first (largest) group. */
   size_t group_id_offset;
 
+  /*! Are we re-using the previous group catalogue where nothing moved? */
+  int incremental_search;
+
+  /*! Fraction of the linking length by which the particles of a cell can move
+   * before the cell has to be searched again in incremental mode. */
+  double incremental_drift_fraction;
+
   /*! The base name of the output file */
   char base_name[PARSER_MAX_LINE_SIZE];
 
@@ -105,6 +114,32 @@ struct fof_props {
   /*! Maximal density of all parts of each group. */
   float *max_part_density;
 
+  /*! Centre of mass of each group (3 per group). Holds the first moment of the
+   * mass around the root particle until the groups are complete. */
+  double *group_centre_of_mass;
+
+  /*! Mass-weighted mean velocity of each group (3 per group). Holds the
+   * momentum of the group until the groups are complete. */
+  double *group_velocity;
+
+  /*! Mass-weighted r.m.s. distance of the particles of each group to its
+   * centre of mass. Holds the second moment of the mass around the root
+   * particle until the groups are complete. */
+  double *group_radius;
+
+  /* ------------ Incremental search --------------- */
+
+  /*! Number of top-level cells in the #ti_cell_searched array */
+  int nr_cells_searched;
+
+  /*! Last time each top-level cell was searched (NULL before the first search)
+   */
+  integertime_t *ti_cell_searched;
+
+  /*! Does each top-level cell need to be searched in the current call? (NULL
+   * when searching everything) */
+  char *cell_needs_search;
+
   /* ------------ MPI-related arrays --------------- */
 
   /*! The number of links between pairs of particles on this node and
@@ -127,6 +162,20 @@ struct group_length {
 
 } SWIFT_STRUCT_ALIGN;
 
+/* Mass moments of a set of particles (a run of particles of a group or the
+ * fragment of a group whose root is on another node) */
+struct fof_final_moments {
+  size_t global_root;
+
+  /* Position the moments are taken around */
+  double ref[3];
+
+  double mass;
+  double first_moment[3];
+  double second_moment;
+  double momentum[3];
+} SWIFT_STRUCT_ALIGN;
+
 #ifdef WITH_MPI
 /* Struct used to find final group ID when using MPI */
 struct fof_final_index {
@@ -142,6 +191,27 @@ struct fof_final_mass {
   float max_part_density;
 } SWIFT_STRUCT_ALIGN;
 
+/* Struct used to label the groups linked across MPI domains in the distributed
+ * union-find */
+struct fof_mpi_label {
+
+  /* The global root ID of the group. */
+  size_t group_id;
+
+  /* The size of the group on the rank owning its root. */
+  size_t group_size;
+};
+
+/* Struct used to send a label to the rank owning a given group */
+struct fof_mpi_label_update {
+
+  /* The global root ID of the group to update. */
+  size_t group_id;
+
+  /* The new label (or size increment) for this group. */
+  struct fof_mpi_label label;
+};
+
 /* Struct used to iterate over the hash table and unpack the mass fragments of a
  * group when using MPI */
 struct fof_mass_send_hashmap {
@@ -164,6 +234,8 @@ void fof_init(struct fof_props *props, struct swift_params *params,
 void fof_create_mpi_types(void);
 void fof_allocate(const struct space *s, const long long total_nr_DM_particles,
                   struct fof_props *props);
+void fof_prepare_incremental_search(struct fof_props *props,
+                                    const struct space *s);
 void fof_search_tree(struct fof_props *props,
                      const struct black_holes_props *bh_props,
                      const struct phys_const *constants,
@@ -172,11 +244,14 @@ void fof_search_tree(struct fof_props *props,
 void rec_fof_search_self(const struct fof_props *props, const double dim[3],
                          const double search_r2, const int periodic,
                          const struct gpart *const space_gparts,
-                         struct cell *c);
+                         struct cell *c, struct fof_cache *restrict ci_cache,
+                         struct fof_cache *restrict cj_cache);
 void rec_fof_search_pair(const struct fof_props *props, const double dim[3],
                          const double search_r2, const int periodic,
                          const struct gpart *const space_gparts,
-                         struct cell *restrict ci, struct cell *restrict cj);
+                         struct cell *restrict ci, struct cell *restrict cj,
+                         struct fof_cache *restrict ci_cache,
+                         struct fof_cache *restrict cj_cache);
 void fof_struct_dump(const struct fof_props *props, FILE *stream);
 void fof_struct_restore(struct fof_props *props, FILE *stream);
 #ifdef WITH_MPI
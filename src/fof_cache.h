@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_FOF_CACHE_H
+#define SWIFT_FOF_CACHE_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Local headers */
+#include "align.h"
+#include "error.h"
+#include "memuse.h"
+#include "vector.h"
+
+/**
+ * @brief A SoA object for the #gpart of a cell.
+ *
+ * This is used to vectorize the leaf-leaf FOF searches.
+ */
+struct fof_cache {
+
+  /*! #gpart x position relative to the reference point. */
+  float *restrict x SWIFT_CACHE_ALIGN;
+
+  /*! #gpart y position relative to the reference point. */
+  float *restrict y SWIFT_CACHE_ALIGN;
+
+  /*! #gpart z position relative to the reference point. */
+  float *restrict z SWIFT_CACHE_ALIGN;
+
+  /*! Index of the #gpart in its cell. */
+  int *restrict index SWIFT_CACHE_ALIGN;
+
+  /*! Cache size */
+  int count;
+};
+
+/**
+ * @brief Frees the memory allocated in a #fof_cache
+ *
+ * @param c The #fof_cache to free.
+ */
+static INLINE void fof_cache_clean(struct fof_cache *c) {
+
+  if (c->count > 0) {
+    swift_free("fof_cache", c->x);
+    swift_free("fof_cache", c->y);
+    swift_free("fof_cache", c->z);
+    swift_free("fof_cache", c->index);
+  }
+  c->count = 0;
+}
+
+/**
+ * @brief Allocates memory for the #gpart caches used in the leaf-leaf FOF
+ * searches.
+ *
+ * The cache is padded for the vector size and aligned properly
+ *
+ * @param c The #fof_cache to allocate.
+ * @param count The number of #gpart to allocated for (space_splitsize is a good
+ * choice).
+ */
+static INLINE void fof_cache_init(struct fof_cache *c, const int count) {
+
+  /* Size of the FOF cache */
+  const int padded_count = count - (count % VEC_SIZE) + VEC_SIZE;
+  const size_t sizeBytesF = padded_count * sizeof(float);
+  const size_t sizeBytesI = padded_count * sizeof(int);
+
+  /* Delete old stuff if any */
+  fof_cache_clean(c);
+
+  int e = 0;
+  e += swift_memalign("fof_cache", (void **)&c->x, SWIFT_CACHE_ALIGNMENT,
+                      sizeBytesF);
+  e += swift_memalign("fof_cache", (void **)&c->y, SWIFT_CACHE_ALIGNMENT,
+                      sizeBytesF);
+  e += swift_memalign("fof_cache", (void **)&c->z, SWIFT_CACHE_ALIGNMENT,
+                      sizeBytesF);
+  e += swift_memalign("fof_cache", (void **)&c->index, SWIFT_CACHE_ALIGNMENT,
+                      sizeBytesI);
+
+  if (e != 0) error("Couldn't allocate FOF cache, size: %d", padded_count);
+
+  c->count = padded_count;
+}
+
+#endif /* SWIFT_FOF_CACHE_H */
@@ -30,12 +30,21 @@
 #include <hdf5.h>
 #endif
 
+/* MPI headers. */
+#ifdef WITH_MPI
+#include <mpi.h>
+#endif
+
 /* This object's header. */
 #include "gravity.h"
 
 /* Local headers. */
 #include "active.h"
+#include "clocks.h"
+#include "engine.h"
 #include "error.h"
+#include "parser.h"
+#include "threadpool.h"
 #include "version.h"
 
 struct exact_force_data {
@@ -45,8 +54,6 @@ struct exact_force_data {
   double const_G;
 };
 
-#ifdef SWIFT_GRAVITY_FORCE_CHECKS
-
 /* Size of the Ewald table */
 #define Newald 64
 
@@ -56,9 +63,119 @@ static float fewald_y[Newald + 1][Newald + 1][Newald + 1];
 static float fewald_z[Newald + 1][Newald + 1][Newald + 1];
 static float potewald[Newald + 1][Newald + 1][Newald + 1];
 
-/* Factor used to normalize the access to the Ewald table */
+/* Factor used to normalize the access to the Ewald table, zero until the
+ * table is computed */
 float ewald_fac;
-#endif
+
+/**
+ * @brief Mapper function computing planes of constant x of one octant of the
+ * Ewald correction table.
+ */
+static void gravity_exact_force_ewald_mapper(void *map_data, int num_elements,
+                                             void *extra_data) {
+
+  /* The planes of this chunk. */
+  const int i_start = (size_t)map_data;
+
+  /* Level of correction  (Hernquist et al. 1991)*/
+  const float alpha = 2.f;
+
+  /* some useful constants */
+  const float alpha2 = alpha * alpha;
+  const float factor_exp1 = 2.f * alpha / sqrt(M_PI);
+  const float factor_exp2 = -M_PI * M_PI / alpha2;
+  const float factor_sin = 2.f * M_PI;
+  const float factor_cos = 2.f * M_PI;
+  const float factor_pot = M_PI / alpha2;
+
+  for (int i = i_start; i < i_start + num_elements; ++i) {
+    for (int j = 0; j <= Newald; ++j) {
+      for (int k = 0; k <= Newald; ++k) {
+
+        if (i == 0 && j == 0 && k == 0) continue;
+
+        /* Distance vector */
+        const float r_x = 0.5f * ((float)i) / Newald;
+        const float r_y = 0.5f * ((float)j) / Newald;
+        const float r_z = 0.5f * ((float)k) / Newald;
+
+        /* Norm of distance vector */
+        const float r2 = r_x * r_x + r_y * r_y + r_z * r_z;
+        const float r_inv = 1.f / sqrtf(r2);
+        const float r_inv3 = r_inv * r_inv * r_inv;
+
+        /* Normal gravity potential term */
+        float f_x = r_x * r_inv3;
+        float f_y = r_y * r_inv3;
+        float f_z = r_z * r_inv3;
+        float pot = r_inv + factor_pot;
+
+        for (int n_i = -4; n_i <= 4; ++n_i) {
+          for (int n_j = -4; n_j <= 4; ++n_j) {
+            for (int n_k = -4; n_k <= 4; ++n_k) {
+
+              const float d_x = r_x - n_i;
+              const float d_y = r_y - n_j;
+              const float d_z = r_z - n_k;
+
+              /* Discretised distance */
+              const float r_tilde2 = d_x * d_x + d_y * d_y + d_z * d_z;
+              const float r_tilde_inv = 1.f / sqrtf(r_tilde2);
+              const float r_tilde = r_tilde_inv * r_tilde2;
+              const float r_tilde_inv3 =
+                  r_tilde_inv * r_tilde_inv * r_tilde_inv;
+
+              const float val_pot = erfcf(alpha * r_tilde);
+
+              const float val_f =
+                  val_pot + factor_exp1 * r_tilde * expf(-alpha2 * r_tilde2);
+
+              /* First correction term */
+              const float f = val_f * r_tilde_inv3;
+              f_x -= f * d_x;
+              f_y -= f * d_y;
+              f_z -= f * d_z;
+              pot -= val_pot * r_tilde_inv;
+            }
+          }
+        }
+
+        for (int h_i = -4; h_i <= 4; ++h_i) {
+          for (int h_j = -4; h_j <= 4; ++h_j) {
+            for (int h_k = -4; h_k <= 4; ++h_k) {
+
+              const float h2 = h_i * h_i + h_j * h_j + h_k * h_k;
+
+              if (h2 == 0.f) continue;
+
+              const float h2_inv = 1.f / (h2 + FLT_MIN);
+              const float h_dot_x = h_i * r_x + h_j * r_y + h_k * r_z;
+
+              const float common = h2_inv * expf(h2 * factor_exp2);
+
+              const float val_pot =
+                  (float)M_1_PI * common * cosf(factor_cos * h_dot_x);
+
+              const float val_f = 2.f * common * sinf(factor_sin * h_dot_x);
+
+              /* Second correction term */
+              f_x -= val_f * h_i;
+              f_y -= val_f * h_j;
+              f_z -= val_f * h_k;
+              pot -= val_pot;
+            }
+          }
+        }
+
+        /* Save back to memory */
+        fewald_x[i][j][k] = f_x;
+        fewald_y[i][j][k] = f_y;
+        fewald_z[i][j][k] = f_z;
+        potewald[i][j][k] = pot;
+      }
+    }
+  }
+}
 
 /**
  * @brief Allocates the memory and computes one octant of the
@@ -69,22 +186,24 @@ float ewald_fac;
  * |x - nL| < 4L and |h|^2 < 16.
  *
  * @param boxSize The side-length (L) of the volume.
+ * @param tp The #threadpool to compute the table with.
+ * @param use_file Read the table from the file 'Ewald.hdf5' if it exists and
+ * write it there otherwise?
  */
-void gravity_exact_force_ewald_init(double boxSize) {
-
-#ifdef SWIFT_GRAVITY_FORCE_CHECKS
+void gravity_exact_force_ewald_init(double boxSize, struct threadpool *tp,
+                                    int use_file) {
 
   const float boxSize_inv = 1.f / boxSize;
   const float boxSize_inv2 = 1.f / (boxSize * boxSize);
 
-  int use_file = 0;
+  int read_file = 0;
 
 #ifdef HAVE_HDF5
-  if (access("Ewald.hdf5", R_OK) != -1) use_file = 1;
+  if (use_file && access("Ewald.hdf5", R_OK) != -1) read_file = 1;
 #endif
 
   /* Can we use the stored HDF5 file? */
-  if (use_file) {
+  if (read_file) {
 
     const ticks tic = getticks();
     message("Reading Ewald correction table from file...");
@@ -135,17 +254,6 @@ void gravity_exact_force_ewald_init(double boxSize) {
     const ticks tic = getticks();
     message("Computing Ewald correction table...");
 
-    /* Level of correction  (Hernquist et al. 1991)*/
-    const float alpha = 2.f;
-
-    /* some useful constants */
-    const float alpha2 = alpha * alpha;
-    const float factor_exp1 = 2.f * alpha / sqrt(M_PI);
-    const float factor_exp2 = -M_PI * M_PI / alpha2;
-    const float factor_sin = 2.f * M_PI;
-    const float factor_cos = 2.f * M_PI;
-    const float factor_pot = M_PI / alpha2;
-
     /* Zero everything */
     bzero(fewald_x, (Newald + 1) * (Newald + 1) * (Newald + 1) * sizeof(float));
     bzero(fewald_y, (Newald + 1) * (Newald + 1) * (Newald + 1) * sizeof(float));
@@ -155,138 +263,55 @@ void gravity_exact_force_ewald_init(double boxSize) {
     /* Hernquist, Bouchet & Suto, 1991, Eq. 2.10 and just below Eq. 2.15 */
     potewald[0][0][0] = 2.8372975f;
 
-    /* Compute the values in one of the octants */
-    for (int i = 0; i <= Newald; ++i) {
-      for (int j = 0; j <= Newald; ++j) {
-        for (int k = 0; k <= Newald; ++k) {
-
-          if (i == 0 && j == 0 && k == 0) continue;
-
-          /* Distance vector */
-          const float r_x = 0.5f * ((float)i) / Newald;
-          const float r_y = 0.5f * ((float)j) / Newald;
-          const float r_z = 0.5f * ((float)k) / Newald;
-
-          /* Norm of distance vector */
-          const float r2 = r_x * r_x + r_y * r_y + r_z * r_z;
-          const float r_inv = 1.f / sqrtf(r2);
-          const float r_inv3 = r_inv * r_inv * r_inv;
-
-          /* Normal gravity potential term */
-          float f_x = r_x * r_inv3;
-          float f_y = r_y * r_inv3;
-          float f_z = r_z * r_inv3;
-          float pot = r_inv + factor_pot;
-
-          for (int n_i = -4; n_i <= 4; ++n_i) {
-            for (int n_j = -4; n_j <= 4; ++n_j) {
-              for (int n_k = -4; n_k <= 4; ++n_k) {
-
-                const float d_x = r_x - n_i;
-                const float d_y = r_y - n_j;
-                const float d_z = r_z - n_k;
-
-                /* Discretised distance */
-                const float r_tilde2 = d_x * d_x + d_y * d_y + d_z * d_z;
-                const float r_tilde_inv = 1.f / sqrtf(r_tilde2);
-                const float r_tilde = r_tilde_inv * r_tilde2;
-                const float r_tilde_inv3 =
-                    r_tilde_inv * r_tilde_inv * r_tilde_inv;
-
-                const float val_pot = erfcf(alpha * r_tilde);
-
-                const float val_f =
-                    val_pot + factor_exp1 * r_tilde * expf(-alpha2 * r_tilde2);
-
-                /* First correction term */
-                const float f = val_f * r_tilde_inv3;
-                f_x -= f * d_x;
-                f_y -= f * d_y;
-                f_z -= f * d_z;
-                pot -= val_pot * r_tilde_inv;
-              }
-            }
-          }
-
-          for (int h_i = -4; h_i <= 4; ++h_i) {
-            for (int h_j = -4; h_j <= 4; ++h_j) {
-              for (int h_k = -4; h_k <= 4; ++h_k) {
-
-                const float h2 = h_i * h_i + h_j * h_j + h_k * h_k;
-
-                if (h2 == 0.f) continue;
-
-                const float h2_inv = 1.f / (h2 + FLT_MIN);
-                const float h_dot_x = h_i * r_x + h_j * r_y + h_k * r_z;
-
-                const float common = h2_inv * expf(h2 * factor_exp2);
-
-                const float val_pot =
-                    (float)M_1_PI * common * cosf(factor_cos * h_dot_x);
-
-                const float val_f = 2.f * common * sinf(factor_sin * h_dot_x);
-
-                /* Second correction term */
-                f_x -= val_f * h_i;
-                f_y -= val_f * h_j;
-                f_z -= val_f * h_k;
-                pot -= val_pot;
-              }
-            }
-          }
-
-          /* Save back to memory */
-          fewald_x[i][j][k] = f_x;
-          fewald_y[i][j][k] = f_y;
-          fewald_z[i][j][k] = f_z;
-          potewald[i][j][k] = pot;
-        }
-      }
-    }
+    /* Compute the values in one of the octants, a few planes at a time */
+    threadpool_map(tp, gravity_exact_force_ewald_mapper, NULL, Newald + 1, 1,
+                   0, NULL);
 
-/* Dump the Ewald table to a file */
+    /* Dump the Ewald table to a file */
 #ifdef HAVE_HDF5
-    hid_t h_file =
-        H5Fcreate("Ewald.hdf5", H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-    if (h_file < 0) error("Error while opening file for Ewald dump.");
-
-    /* Write the Ewald table size */
-    const int size = Newald;
-    const hid_t h_grp = H5Gcreate1(h_file, "Info", 0);
-    const hid_t h_aspace = H5Screate(H5S_SCALAR);
-    hid_t h_att =
-        H5Acreate1(h_grp, "Ewald_size", H5T_NATIVE_INT, h_aspace, H5P_DEFAULT);
-    H5Awrite(h_att, H5T_NATIVE_INT, &size);
-    H5Aclose(h_att);
-    H5Gclose(h_grp);
-    H5Sclose(h_aspace);
-
-    /* Create dataspace and write arrays */
-    hsize_t dim[3] = {Newald + 1, Newald + 1, Newald + 1};
-    hid_t h_space = H5Screate_simple(3, dim, NULL);
-    hid_t h_data;
-    h_data = H5Dcreate(h_file, "Ewald_x", H5T_NATIVE_FLOAT, h_space,
-                       H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-    H5Dwrite(h_data, H5T_NATIVE_FLOAT, h_space, H5S_ALL, H5P_DEFAULT,
-             &(fewald_x[0][0][0]));
-    H5Dclose(h_data);
-    h_data = H5Dcreate(h_file, "Ewald_y", H5T_NATIVE_FLOAT, h_space,
-                       H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-    H5Dwrite(h_data, H5T_NATIVE_FLOAT, h_space, H5S_ALL, H5P_DEFAULT,
-             &(fewald_y[0][0][0]));
-    H5Dclose(h_data);
-    h_data = H5Dcreate(h_file, "Ewald_z", H5T_NATIVE_FLOAT, h_space,
-                       H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-    H5Dwrite(h_data, H5T_NATIVE_FLOAT, h_space, H5S_ALL, H5P_DEFAULT,
-             &(fewald_z[0][0][0]));
-    H5Dclose(h_data);
-    h_data = H5Dcreate(h_file, "Ewald_pot", H5T_NATIVE_FLOAT, h_space,
-                       H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-    H5Dwrite(h_data, H5T_NATIVE_FLOAT, h_space, H5S_ALL, H5P_DEFAULT,
-             &(potewald[0][0][0]));
-    H5Dclose(h_data);
-    H5Sclose(h_space);
-    H5Fclose(h_file);
+    if (use_file) {
+      hid_t h_file =
+          H5Fcreate("Ewald.hdf5", H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+      if (h_file < 0) error("Error while opening file for Ewald dump.");
+
+      /* Write the Ewald table size */
+      const int size = Newald;
+      const hid_t h_grp = H5Gcreate1(h_file, "Info", 0);
+      const hid_t h_aspace = H5Screate(H5S_SCALAR);
+      hid_t h_att = H5Acreate1(h_grp, "Ewald_size", H5T_NATIVE_INT, h_aspace,
+                               H5P_DEFAULT);
+      H5Awrite(h_att, H5T_NATIVE_INT, &size);
+      H5Aclose(h_att);
+      H5Gclose(h_grp);
+      H5Sclose(h_aspace);
+
+      /* Create dataspace and write arrays */
+      hsize_t dim[3] = {Newald + 1, Newald + 1, Newald + 1};
+      hid_t h_space = H5Screate_simple(3, dim, NULL);
+      hid_t h_data;
+      h_data = H5Dcreate(h_file, "Ewald_x", H5T_NATIVE_FLOAT, h_space,
+                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+      H5Dwrite(h_data, H5T_NATIVE_FLOAT, h_space, H5S_ALL, H5P_DEFAULT,
+               &(fewald_x[0][0][0]));
+      H5Dclose(h_data);
+      h_data = H5Dcreate(h_file, "Ewald_y", H5T_NATIVE_FLOAT, h_space,
+                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+      H5Dwrite(h_data, H5T_NATIVE_FLOAT, h_space, H5S_ALL, H5P_DEFAULT,
+               &(fewald_y[0][0][0]));
+      H5Dclose(h_data);
+      h_data = H5Dcreate(h_file, "Ewald_z", H5T_NATIVE_FLOAT, h_space,
+                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+      H5Dwrite(h_data, H5T_NATIVE_FLOAT, h_space, H5S_ALL, H5P_DEFAULT,
+               &(fewald_z[0][0][0]));
+      H5Dclose(h_data);
+      h_data = H5Dcreate(h_file, "Ewald_pot", H5T_NATIVE_FLOAT, h_space,
+                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+      H5Dwrite(h_data, H5T_NATIVE_FLOAT, h_space, H5S_ALL, H5P_DEFAULT,
+               &(potewald[0][0][0]));
+      H5Dclose(h_data);
+      H5Sclose(h_space);
+      H5Fclose(h_file);
+    }
 #endif
 
     /* Report time this took */
@@ -308,9 +333,6 @@ void gravity_exact_force_ewald_init(double boxSize) {
       }
     }
   }
-#else
-  error("Gravity checking function called without the corresponding flag.");
-#endif
 }
 
 /**
@@ -328,8 +350,6 @@ void gravity_exact_force_ewald_init(double boxSize) {
 void gravity_exact_force_ewald_evaluate(double rx, double ry, double rz,
                                         double corr_f[3], double *corr_p) {
 
-#ifdef SWIFT_GRAVITY_FORCE_CHECKS
-
   const double s_x = (rx < 0.) ? 1. : -1.;
   const double s_y = (ry < 0.) ? 1. : -1.;
   const double s_z = (rz < 0.) ? 1. : -1.;
@@ -399,9 +419,6 @@ void gravity_exact_force_ewald_evaluate(double rx, double ry, double rz,
   *corr_p += potewald[i + 1][j + 1][k + 0] * dx * dy * tz;
   *corr_p += potewald[i + 1][j + 1][k + 1] * dx * dy * dz;
 
-#else
-  error("Gravity checking function called without the corresponding flag.");
-#endif
 }
 
 /**
@@ -649,7 +666,7 @@ void gravity_exact_force_check(struct space *s, const struct engine *e,
   /* File name */
   char file_name_swift[100];
   sprintf(file_name_swift, "gravity_checks_swift_step%.4d_order%d.dat", e->step,
-          SELF_GRAVITY_MULTIPOLE_ORDER);
+          e->gravity_properties->multipole_order);
 
   /* Creare files and write header */
   const double epsilon = gravity_get_softening(0, e->gravity_properties);
@@ -757,3 +774,351 @@ void gravity_exact_force_check(struct space *s, const struct engine *e,
   error("Gravity checking function called without the corresponding flag.");
 #endif
 }
+
+/**
+ * @brief One of the gparts whose forces are checked by the
+ * #gravity_accuracy_monitor, as sent to all the nodes.
+ */
+struct gravity_accuracy_sample {
+
+  /*! Position */
+  double x[3];
+
+  /*! Acceleration obtained by the tree and the mesh */
+  float a_grav[3];
+
+  /*! Softening length */
+  float h;
+};
+
+/**
+ * @brief Data of the direct summation of the #gravity_accuracy_monitor.
+ */
+struct gravity_accuracy_data {
+
+  /*! The #engine */
+  const struct engine *e;
+
+  /*! All the checked gparts */
+  const struct gravity_accuracy_sample *samples;
+
+  /*! Their accelerations from the local gparts, without G */
+  double *a_exact;
+};
+
+/**
+ * @brief Read the parameters of the #gravity_accuracy_monitor and open its
+ * output file.
+ *
+ * The checks are only done with self-gravity alone, as the accelerations
+ * would otherwise include other contributions.
+ *
+ * @param m The #gravity_accuracy_monitor.
+ * @param params The parsed parameters.
+ * @param e The #engine.
+ * @param restart Are we restarting?
+ */
+void gravity_accuracy_monitor_init(struct gravity_accuracy_monitor *m,
+                                   struct swift_params *params,
+                                   const struct engine *e, int restart) {
+
+  m->every =
+      parser_get_opt_param_int(params, "Gravity:accuracy_check_every", 0);
+  m->count =
+      parser_get_opt_param_int(params, "Gravity:accuracy_check_count", 1000);
+  m->ind = NULL;
+  m->nr_ind = 0;
+  m->file = NULL;
+
+  if (m->every <= 0 || m->count <= 0 ||
+      !(e->policy & engine_policy_self_gravity)) {
+    m->every = 0;
+    return;
+  }
+  if (e->policy & engine_policy_external_gravity)
+    error("Can't check the gravity accuracy with an external potential.");
+
+  if (e->nodeID == 0) {
+    m->file = fopen("gravity_accuracy.txt", restart ? "a" : "w");
+    if (m->file == NULL)
+      error("Failed to open the file 'gravity_accuracy.txt'.");
+    if (!restart) {
+      fprintf(m->file,
+              "# Relative errors of the gravity accelerations of %d random "
+              "active gparts\n",
+              m->count);
+      fprintf(m->file, "# theta= %16.8e\n", e->gravity_properties->theta_crit);
+      fprintf(m->file, "# %6s %14s %8s %14s %14s %14s %14s\n", "Step", "Time",
+              "Count", "Median", "90%", "99%", "Max");
+      fflush(m->file);
+    }
+  }
+}
+
+/**
+ * @brief Pick the gparts whose forces are checked in this step.
+ *
+ * The active gparts of all the nodes are equally likely to be picked, the
+ * local ones by reservoir sampling.
+ *
+ * @param m The #gravity_accuracy_monitor.
+ * @param e The #engine, after the preparation of the step.
+ */
+void gravity_accuracy_monitor_sample(struct gravity_accuracy_monitor *m,
+                                     const struct engine *e) {
+
+  const struct space *s = e->s;
+  const struct gpart *gparts = s->gparts;
+
+  /* How many active gparts do we have here and overall? */
+  long long nr_active = 0;
+  for (size_t k = 0; k < s->nr_gparts; k++)
+    if (!gpart_is_inhibited(&gparts[k], e) && gpart_is_active(&gparts[k], e))
+      nr_active++;
+  long long nr_active_total = nr_active;
+#ifdef WITH_MPI
+  MPI_Allreduce(&nr_active, &nr_active_total, 1, MPI_LONG_LONG_INT, MPI_SUM,
+                MPI_COMM_WORLD);
+#endif
+
+  /* Our share of the checked gparts. */
+  long long count = nr_active;
+  if (nr_active_total > m->count)
+    count = (long long)((double)m->count * nr_active / nr_active_total + 0.5);
+
+  free(m->ind);
+  m->ind = NULL;
+  m->nr_ind = count;
+  if (count == 0) return;
+  if ((m->ind = (size_t *)malloc(sizeof(size_t) * count)) == NULL)
+    error("Failed to allocate the indices of the checked gparts.");
+
+  unsigned int seed = e->step * e->nr_nodes + e->nodeID;
+  long long n = 0;
+  for (size_t k = 0; k < s->nr_gparts; k++) {
+    if (gpart_is_inhibited(&gparts[k], e) || !gpart_is_active(&gparts[k], e))
+      continue;
+    if (n < count) {
+      m->ind[n] = k;
+    } else {
+      const long long r =
+          ((((long long)rand_r(&seed)) << 31) + rand_r(&seed)) % (n + 1);
+      if (r < count) m->ind[r] = k;
+    }
+    n++;
+  }
+}
+
+/**
+ * @brief Mapper function of the direct summation of the
+ * #gravity_accuracy_monitor.
+ *
+ * Computes the accelerations of a chunk of the checked gparts from all the
+ * local gparts.
+ */
+static void gravity_accuracy_monitor_mapper(void *map_data, int num_elements,
+                                            void *extra_data) {
+
+  const struct gravity_accuracy_sample *samples =
+      (struct gravity_accuracy_sample *)map_data;
+  struct gravity_accuracy_data *data =
+      (struct gravity_accuracy_data *)extra_data;
+  const struct engine *e = data->e;
+  const struct space *s = e->s;
+  const struct gpart *gparts = s->gparts;
+  const size_t nr_gparts = s->nr_gparts;
+  const int periodic = s->periodic;
+  const double dim[3] = {s->dim[0], s->dim[1], s->dim[2]};
+  double *a_exact = data->a_exact + 3 * (samples - data->samples);
+
+  for (int i = 0; i < num_elements; i++) {
+
+    const double pix[3] = {samples[i].x[0], samples[i].x[1], samples[i].x[2]};
+    const double hi = samples[i].h;
+    const double hi_inv = 1. / hi;
+    const double hi_inv3 = hi_inv * hi_inv * hi_inv;
+    double a_grav[3] = {0., 0., 0.};
+
+    for (size_t j = 0; j < nr_gparts; j++) {
+
+      const struct gpart *gpj = &gparts[j];
+      if (gpart_is_inhibited(gpj, e)) continue;
+
+      /* Compute the pairwise distance. */
+      double dx = gpj->x[0] - pix[0];
+      double dy = gpj->x[1] - pix[1];
+      double dz = gpj->x[2] - pix[2];
+      if (periodic) {
+        dx = nearest(dx, dim[0]);
+        dy = nearest(dy, dim[1]);
+        dz = nearest(dz, dim[2]);
+      }
+      const double r2 = dx * dx + dy * dy + dz * dz;
+
+      /* No self interaction */
+      if (r2 == 0.) continue;
+
+      const double r_inv = 1. / sqrt(r2);
+      const double r = r2 * r_inv;
+      const double mj = gpj->mass;
+
+      double f;
+      if (r >= hi) {
+        f = mj * r_inv * r_inv * r_inv;
+      } else {
+        double Wf;
+        kernel_grav_eval_force_double(r * hi_inv, &Wf);
+        f = mj * hi_inv3 * Wf;
+      }
+      a_grav[0] += f * dx;
+      a_grav[1] += f * dy;
+      a_grav[2] += f * dz;
+
+      /* Apply Ewald correction for periodic BC */
+      if (periodic && r > 1e-5 * hi) {
+        double corr_f[3], corr_pot;
+        gravity_exact_force_ewald_evaluate(dx, dy, dz, corr_f, &corr_pot);
+        a_grav[0] += mj * corr_f[0];
+        a_grav[1] += mj * corr_f[1];
+        a_grav[2] += mj * corr_f[2];
+      }
+    }
+
+    a_exact[3 * i + 0] = a_grav[0];
+    a_exact[3 * i + 1] = a_grav[1];
+    a_exact[3 * i + 2] = a_grav[2];
+  }
+}
+
+/**
+ * @brief Sort comparison function for doubles.
+ */
+static int gravity_accuracy_cmp(const void *a, const void *b) {
+  const double da = *(const double *)a;
+  const double db = *(const double *)b;
+  return (da > db) - (da < db);
+}
+
+/**
+ * @brief Compare the forces of the gparts picked by
+ * gravity_accuracy_monitor_sample() to the exact ones and report the
+ * distribution of the relative errors.
+ *
+ * The checked gparts are sent to all the nodes, which sum the forces from
+ * their own gparts using all their threads. The sums are then added up on
+ * node 0. This costs the number of checked gparts times the total number of
+ * gparts, spread over all the threads.
+ *
+ * @param m The #gravity_accuracy_monitor.
+ * @param e The #engine, after the step's tasks have run.
+ */
+void gravity_accuracy_monitor_check(struct gravity_accuracy_monitor *m,
+                                    const struct engine *e) {
+
+  const ticks tic = getticks();
+  const struct space *s = e->s;
+
+  /* The Ewald corrections are only computed when first needed. */
+  if (s->periodic && ewald_fac == 0.f)
+    gravity_exact_force_ewald_init(
+        s->dim[0], (struct threadpool *)&e->threadpool, /*use_file=*/0);
+
+  /* Our checked gparts. */
+  struct gravity_accuracy_sample *local = (struct gravity_accuracy_sample *)
+      malloc(sizeof(struct gravity_accuracy_sample) * (m->nr_ind + 1));
+  if (local == NULL) error("Failed to allocate the checked gparts.");
+  for (int k = 0; k < m->nr_ind; k++) {
+    const struct gpart *gp = &s->gparts[m->ind[k]];
+    for (int i = 0; i < 3; i++) {
+      local[k].x[i] = gp->x[i];
+      local[k].a_grav[i] = gp->a_grav[i];
+    }
+    local[k].h = gravity_get_softening(gp, e->gravity_properties);
+  }
+
+  /* Everybody gets all of them. */
+  int count = m->nr_ind;
+  struct gravity_accuracy_sample *samples = local;
+#ifdef WITH_MPI
+  int *counts = (int *)malloc(sizeof(int) * e->nr_nodes);
+  int *displs = (int *)malloc(sizeof(int) * e->nr_nodes);
+  if (counts == NULL || displs == NULL)
+    error("Failed to allocate the counts of checked gparts.");
+  const int size = m->nr_ind * sizeof(struct gravity_accuracy_sample);
+  MPI_Allgather(&size, 1, MPI_INT, counts, 1, MPI_INT, MPI_COMM_WORLD);
+  int total = 0;
+  for (int k = 0; k < e->nr_nodes; k++) {
+    displs[k] = total;
+    total += counts[k];
+  }
+  count = total / sizeof(struct gravity_accuracy_sample);
+  if ((samples = (struct gravity_accuracy_sample *)malloc(total + 1)) == NULL)
+    error("Failed to allocate the checked gparts.");
+  MPI_Allgatherv(local, size, MPI_BYTE, samples, counts, displs, MPI_BYTE,
+                 MPI_COMM_WORLD);
+  free(counts);
+  free(displs);
+#endif
+
+  /* Sum the forces from our gparts. */
+  double *a_exact = (double *)calloc(3 * count + 1, sizeof(double));
+  if (a_exact == NULL) error("Failed to allocate the exact accelerations.");
+  struct gravity_accuracy_data data = {e, samples, a_exact};
+  threadpool_map((struct threadpool *)&e->threadpool,
+                 gravity_accuracy_monitor_mapper, samples, count,
+                 sizeof(struct gravity_accuracy_sample), 0, &data);
+#ifdef WITH_MPI
+  MPI_Reduce(e->nodeID == 0 ? MPI_IN_PLACE : a_exact, a_exact, 3 * count,
+             MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+#endif
+
+  /* Report the distribution of the relative errors. */
+  if (e->nodeID == 0 && count > 0) {
+    const double const_G = e->physical_constants->const_newton_G;
+    double *errors = (double *)malloc(sizeof(double) * count);
+    if (errors == NULL) error("Failed to allocate the errors.");
+    for (int k = 0; k < count; k++) {
+      double diff2 = 0., norm2 = 0.;
+      for (int i = 0; i < 3; i++) {
+        const double a = const_G * a_exact[3 * k + i];
+        diff2 += (samples[k].a_grav[i] - a) * (samples[k].a_grav[i] - a);
+        norm2 += a * a;
+      }
+      errors[k] = (norm2 > 0.) ? sqrt(diff2 / norm2) : 0.;
+    }
+    qsort(errors, count, sizeof(double), gravity_accuracy_cmp);
+
+    const double median = errors[(count - 1) / 2];
+    const double p90 = errors[(int)(0.9 * (count - 1))];
+    const double p99 = errors[(int)(0.99 * (count - 1))];
+    const double max = errors[count - 1];
+    fprintf(m->file, "  %6d %14e %8d %14e %14e %14e %14e\n", e->step, e->time,
+            count, median, p90, p99, max);
+    fflush(m->file);
+    message(
+        "Gravity errors of %d gparts: median=%.3e 90%%=%.3e 99%%=%.3e "
+        "max=%.3e (took %.3f %s).",
+        count, median, p90, p99, max, clocks_from_ticks(getticks() - tic),
+        clocks_getunit());
+    free(errors);
+  }
+
+  free(a_exact);
+  if (samples != local) free(samples);
+  free(local);
+  free(m->ind);
+  m->ind = NULL;
+  m->nr_ind = 0;
+}
+
+/**
+ * @brief Free the memory and close the file of a #gravity_accuracy_monitor.
+ *
+ * @param m The #gravity_accuracy_monitor.
+ */
+void gravity_accuracy_monitor_clean(struct gravity_accuracy_monitor *m) {
+  free(m->ind);
+  m->ind = NULL;
+  if (m->file != NULL) fclose(m->file);
+  m->file = NULL;
+}
@@ -22,6 +22,10 @@
 /* Config parameters. */
 #include "../config.h"
 
+/* Some standard headers. */
+#include <stddef.h>
+#include <stdio.h>
+
 /* Local headers. */
 #include "const.h"
 #include "inline.h"
@@ -40,13 +44,48 @@
 
 struct engine;
 struct space;
+struct swift_params;
+struct threadpool;
+
+/**
+ * @brief Sampled check of the accuracy of the gravity forces.
+ *
+ * Every few steps, the forces on a random subset of the active gparts are
+ * compared to the ones obtained by direct summation over all the gparts.
+ */
+struct gravity_accuracy_monitor {
+
+  /*! Every how many steps are the forces checked? 0 for never. */
+  int every;
+
+  /*! Number of gparts checked, over all the nodes */
+  int count;
+
+  /*! Indices of the local gparts checked in this step */
+  size_t *ind;
+
+  /*! Number of local gparts checked in this step */
+  int nr_ind;
+
+  /*! File the percentiles of the errors are written to, on node 0 only */
+  FILE *file;
+};
 
-void gravity_exact_force_ewald_init(double boxSize);
+void gravity_exact_force_ewald_init(double boxSize, struct threadpool *tp,
+                                    int use_file);
 void gravity_exact_force_ewald_free(void);
 void gravity_exact_force_ewald_evaluate(double rx, double ry, double rz,
                                         double corr_f[3], double *corr_p);
 void gravity_exact_force_compute(struct space *s, const struct engine *e);
 void gravity_exact_force_check(struct space *s, const struct engine *e,
                                float rel_tol);
+void gravity_accuracy_monitor_init(struct gravity_accuracy_monitor *m,
+                                   struct swift_params *params,
+                                   const struct engine *e, int restart);
+void gravity_accuracy_monitor_sample(struct gravity_accuracy_monitor *m,
+                                     const struct engine *e);
+void gravity_accuracy_monitor_check(struct gravity_accuracy_monitor *m,
+                                    const struct engine *e);
+void gravity_accuracy_monitor_clean(struct gravity_accuracy_monitor *m);
 
 #endif
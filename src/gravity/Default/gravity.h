@@ -62,6 +62,43 @@ __attribute__((always_inline)) INLINE static float gravity_get_softening(
 __attribute__((always_inline)) INLINE static void
 gravity_add_comoving_potential(struct gpart* restrict gp, float pot) {}
 
+/**
+ * @brief Stores the mesh acceleration and potential of a particle so that they
+ * can be re-used until the next mesh step.
+ *
+ * @param gp The particle.
+ * @param pot The mesh potential.
+ * @param a The mesh acceleration.
+ */
+__attribute__((always_inline)) INLINE static void
+gravity_store_comoving_mesh_force(struct gpart* restrict gp, float pot,
+                                  const float a[3]) {
+
+  gp->a_grav_mesh[0] = a[0];
+  gp->a_grav_mesh[1] = a[1];
+  gp->a_grav_mesh[2] = a[2];
+}
+
+/**
+ * @brief Adds the mesh acceleration and potential stored at the last mesh
+ * step to the particle.
+ *
+ * @param gp The particle.
+ */
+__attribute__((always_inline)) INLINE static void
+gravity_add_stored_mesh_force(struct gpart* restrict gp) {
+
+  gp->a_grav[0] += gp->a_grav_mesh[0];
+  gp->a_grav[1] += gp->a_grav_mesh[1];
+  gp->a_grav[2] += gp->a_grav_mesh[2];
+
+#ifdef SWIFT_GRAVITY_FORCE_CHECKS
+  gp->a_grav_PM[0] = gp->a_grav_mesh[0];
+  gp->a_grav_PM[1] = gp->a_grav_mesh[1];
+  gp->a_grav_PM[2] = gp->a_grav_mesh[2];
+#endif
+}
+
 /**
  * @brief Returns the comoving potential of a particle.
  *
@@ -178,6 +215,11 @@ __attribute__((always_inline)) INLINE static void gravity_end_force(
     struct gpart* gp, float const_G, const float potential_normalisation,
     const int periodic) {
 
+  /* Record the norm of the acceleration for the adaptive MAC */
+  gp->old_a_grav_norm =
+      sqrtf(gp->a_grav[0] * gp->a_grav[0] + gp->a_grav[1] * gp->a_grav[1] +
+            gp->a_grav[2] * gp->a_grav[2]);
+
   /* Let's get physical... */
   gp->a_grav[0] *= const_G;
   gp->a_grav[1] *= const_G;
@@ -226,6 +268,10 @@ __attribute__((always_inline)) INLINE static void gravity_first_init_gpart(
     struct gpart* gp, const struct gravity_props* grav_props) {
 
   gp->time_bin = 0;
+  gp->old_a_grav_norm = 0.f;
+  gp->a_grav_mesh[0] = 0.f;
+  gp->a_grav_mesh[1] = 0.f;
+  gp->a_grav_mesh[2] = 0.f;
 
   gravity_init_gpart(gp);
 }
@@ -35,6 +35,13 @@ struct gpart {
   /*! Particle acceleration. */
   float a_grav[3];
 
+  /*! Norm of the acceleration at the previous step (without G). */
+  float old_a_grav_norm;
+
+  /*! Mesh acceleration stored at the last mesh step (multiple time-stepping,
+   * without G). */
+  float a_grav_mesh[3];
+
   /*! Particle mass. */
   float mass;
 
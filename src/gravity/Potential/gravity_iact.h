@@ -125,6 +125,128 @@ __attribute__((always_inline)) INLINE static void runner_iact_grav_pp_truncated(
   *pot_ij *= corr_pot_lr;
 }
 
+#ifdef WITH_VECTORIZATION
+
+/**
+ * @brief Computes the intensity of the force at a point generated by a
+ * vector of point-masses.
+ *
+ * Vector version of runner_iact_grav_pp_full(). Both branches of the
+ * softening test are evaluated and blended.
+ *
+ * @param r2 Square of the distance to the point-masses.
+ * @param h2 Square of the softening length.
+ * @param h_inv Inverse of the softening length.
+ * @param h_inv3 Cube of the inverse of the softening length.
+ * @param mass Mass of the point-masses.
+ * @param f_ij (return) The force intensity.
+ * @param pot_ij (return) The potential.
+ */
+__attribute__((always_inline)) INLINE static void runner_iact_grav_pp_full_vec(
+    const vector *r2, const vector *h2, const vector *h_inv,
+    const vector *h_inv3, const vector *mass, vector *f_ij, vector *pot_ij) {
+
+  /* Get the inverse distance */
+  vector r2_eps, r;
+  r2_eps.v = vec_add(r2->v, vec_set1(FLT_MIN));
+  const vector r_inv = vec_reciprocal_sqrt(r2_eps);
+  r.v = vec_mul(r2->v, r_inv.v);
+
+  /* Get Newtonian gravity (r_inv is capped at h_inv to avoid overflows in
+   * the lanes that are softened) */
+  vector r_inv_n, f_newton;
+  r_inv_n.v = vec_fmin(r_inv.v, h_inv->v);
+  f_newton.v =
+      vec_mul(mass->v, vec_mul(r_inv_n.v, vec_mul(r_inv_n.v, r_inv_n.v)));
+  vector pot_newton;
+  pot_newton.v = vec_mul(vec_set1(-1.f), vec_mul(mass->v, r_inv_n.v));
+
+  /* Get softened gravity (the kernel is only evaluated for u < 1 lanes) */
+  vector ui, W_f_ij;
+  ui.v = vec_fmin(vec_mul(r.v, h_inv->v), vec_set1(1.f));
+  kernel_grav_force_eval_vec(&ui, &W_f_ij);
+
+  vector f_soft;
+  f_soft.v = vec_mul(mass->v, vec_mul(h_inv3->v, W_f_ij.v));
+
+  vector W_pot_ij, pot_soft;
+  kernel_grav_pot_eval_vec(&ui, &W_pot_ij);
+  pot_soft.v = vec_mul(mass->v, vec_mul(h_inv->v, W_pot_ij.v));
+
+  /* Should we soften ? */
+  mask_t mask_newton;
+  vec_create_mask(mask_newton, vec_cmp_gte(r2->v, h2->v));
+  f_ij->v = vec_blend(mask_newton, f_soft.v, f_newton.v);
+  pot_ij->v = vec_blend(mask_newton, pot_soft.v, pot_newton.v);
+}
+
+/**
+ * @brief Computes the intensity of the force at a point generated by a
+ * vector of point-masses truncated for long-distance periodicity.
+ *
+ * Vector version of runner_iact_grav_pp_truncated().
+ *
+ * @param r2 Square of the distance to the point-masses.
+ * @param h2 Square of the softening length.
+ * @param h_inv Inverse of the softening length.
+ * @param h_inv3 Cube of the inverse of the softening length.
+ * @param mass Mass of the point-masses.
+ * @param r_s_inv Inverse of the mesh smoothing scale.
+ * @param f_ij (return) The force intensity.
+ * @param pot_ij (return) The potential.
+ */
+__attribute__((always_inline)) INLINE static void
+runner_iact_grav_pp_truncated_vec(const vector *r2, const vector *h2,
+                                  const vector *h_inv, const vector *h_inv3,
+                                  const vector *mass, const vector *r_s_inv,
+                                  vector *f_ij, vector *pot_ij) {
+
+  /* Get the inverse distance */
+  vector r2_eps, r;
+  r2_eps.v = vec_add(r2->v, vec_set1(FLT_MIN));
+  const vector r_inv = vec_reciprocal_sqrt(r2_eps);
+  r.v = vec_mul(r2->v, r_inv.v);
+
+  /* Get Newtonian gravity (r_inv is capped at h_inv to avoid overflows in
+   * the lanes that are softened) */
+  vector r_inv_n, f_newton;
+  r_inv_n.v = vec_fmin(r_inv.v, h_inv->v);
+  f_newton.v =
+      vec_mul(mass->v, vec_mul(r_inv_n.v, vec_mul(r_inv_n.v, r_inv_n.v)));
+  vector pot_newton;
+  pot_newton.v = vec_mul(vec_set1(-1.f), vec_mul(mass->v, r_inv_n.v));
+
+  /* Get softened gravity (the kernel is only evaluated for u < 1 lanes) */
+  vector ui, W_f_ij;
+  ui.v = vec_fmin(vec_mul(r.v, h_inv->v), vec_set1(1.f));
+  kernel_grav_force_eval_vec(&ui, &W_f_ij);
+
+  vector f_soft;
+  f_soft.v = vec_mul(mass->v, vec_mul(h_inv3->v, W_f_ij.v));
+
+  vector W_pot_ij, pot_soft;
+  kernel_grav_pot_eval_vec(&ui, &W_pot_ij);
+  pot_soft.v = vec_mul(mass->v, vec_mul(h_inv->v, W_pot_ij.v));
+
+  /* Should we soften ? */
+  mask_t mask_newton;
+  vec_create_mask(mask_newton, vec_cmp_gte(r2->v, h2->v));
+  f_ij->v = vec_blend(mask_newton, f_soft.v, f_newton.v);
+  pot_ij->v = vec_blend(mask_newton, pot_soft.v, pot_newton.v);
+
+  /* Get long-range correction */
+  vector u_lr, corr_f_lr;
+  u_lr.v = vec_mul(r.v, r_s_inv->v);
+  kernel_long_grav_force_eval_vec(&u_lr, &corr_f_lr);
+  f_ij->v = vec_mul(f_ij->v, corr_f_lr.v);
+
+  vector corr_pot_lr;
+  kernel_long_grav_pot_eval_vec(&u_lr, &corr_pot_lr);
+  pot_ij->v = vec_mul(pot_ij->v, corr_pot_lr.v);
+}
+
+#endif /* WITH_VECTORIZATION */
+
 /**
  * @brief Computes the forces at a point generated by a multipole.
  *
@@ -70,6 +70,13 @@ struct gravity_cache {
 
   /*! Cache size */
   int count;
+
+  /*! The #cell whose #gpart are currently held in the cache (only set when
+   * the cache is kept resident across consecutive pair interactions). */
+  struct cell *cell;
+
+  /*! Does the cache hold accelerations that still need writing back? */
+  int write_back;
 };
 
 /**
@@ -143,6 +150,8 @@ static INLINE void gravity_cache_init(struct gravity_cache *c,
   if (e != 0) error("Couldn't allocate gravity cache, size: %d", padded_count);
 
   c->count = padded_count;
+  c->cell = NULL;
+  c->write_back = 0;
 }
 
 /**
@@ -467,6 +476,57 @@ gravity_cache_populate_all_mpole(const timebin_t max_active_bin,
   gravity_cache_zero_output(c, gcount_padded);
 }
 
+/**
+ * @brief Re-computes which #gpart of an already filled #gravity_cache can
+ * use a M2P interaction with a new multipole.
+ *
+ * The positions, masses and outputs of the cache are left untouched. This
+ * is used when the cache of a cell is kept across consecutive pair
+ * interactions.
+ *
+ * @param allow_mpole Are we allowing the use of multipoles?
+ * @param periodic Are we using periodic BCs ?
+ * @param dim The size of the simulation volume along each dimension.
+ * @param c The #gravity_cache to update.
+ * @param gcount The number of particles in the cache (without padding).
+ * @param CoM The position of the multipole.
+ * @param r_max2 The square of the multipole radius.
+ * @param grav_props The global gravity properties.
+ */
+__attribute__((always_inline)) INLINE static void gravity_cache_refresh_mpole(
+    const int allow_mpole, const int periodic, const float dim[3],
+    struct gravity_cache *c, const int gcount, const float CoM[3],
+    const float r_max2, const struct gravity_props *grav_props) {
+
+  const float theta_crit2 = grav_props->theta_crit2;
+
+  /* Make the compiler understand we are in happy vectorization land */
+  swift_declare_aligned_ptr(float, x, c->x, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, y, c->y, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, z, c->z, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(int, use_mpole, c->use_mpole,
+                            SWIFT_CACHE_ALIGNMENT);
+
+  for (int i = 0; i < gcount; ++i) {
+
+    /* Distance to the CoM of the other cell. */
+    float dx = x[i] - CoM[0];
+    float dy = y[i] - CoM[1];
+    float dz = z[i] - CoM[2];
+
+    /* Apply periodic BC */
+    if (periodic) {
+      dx = nearestf(dx, dim[0]);
+      dy = nearestf(dy, dim[1]);
+      dz = nearestf(dz, dim[2]);
+    }
+    const float r2 = dx * dx + dy * dy + dz * dz;
+
+    /* Check whether we can use the multipole instead of P-P */
+    use_mpole[i] = allow_mpole && gravity_M2P_accept(r_max2, theta_crit2, r2);
+  }
+}
+
 /**
  * @brief Write the output cache values back to the active #gpart.
  *
@@ -498,4 +558,22 @@ __attribute__((always_inline)) INLINE static void gravity_cache_write_back(
   }
 }
 
+/**
+ * @brief Writes back the accelerations held by a resident #gravity_cache to
+ * the #gpart of its #cell and releases the cache.
+ *
+ * Does nothing if the cache does not currently hold any cell.
+ *
+ * @param c The #gravity_cache to flush.
+ */
+__attribute__((always_inline)) INLINE static void gravity_cache_flush(
+    struct gravity_cache *c) {
+
+  if (c->cell != NULL && c->write_back)
+    gravity_cache_write_back(c, c->cell->grav.parts, c->cell->grav.count);
+
+  c->cell = NULL;
+  c->write_back = 0;
+}
+
 #endif /* SWIFT_GRAVITY_CACHE_H */
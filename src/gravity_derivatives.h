@@ -90,6 +90,30 @@ struct potential_derivatives_M2L {
 #endif
 };
 
+/**
+ * @brief Structure containing the radial terms of the derivatives of the
+ * potential field required for the M2L kernel
+ */
+struct potential_derivatives_M2L_radial {
+
+  float Dt_1;
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 0
+  float Dt_3;
+#endif
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 1
+  float Dt_5;
+#endif
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 2
+  float Dt_7;
+#endif
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 3
+  float Dt_9;
+#endif
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 4
+  float Dt_11;
+#endif
+};
+
 /**
  * @brief Structure containing all the derivatives of the potential field
  * required for the M2P kernel
@@ -133,79 +157,84 @@ struct potential_derivatives_M2P {
  * derivative terms.
  *
  * @param pot The derivatives of the potential.
+ * @param order The run-time multipole order.
  */
 __attribute__((always_inline)) INLINE static void
-potential_derivatives_flip_signs(struct potential_derivatives_M2L *pot) {
+potential_derivatives_flip_signs(struct potential_derivatives_M2L *pot,
+                                 const int order) {
 
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 0
-  /* 1st order terms */
-  pot->D_100 = -pot->D_100;
-  pot->D_010 = -pot->D_010;
-  pot->D_001 = -pot->D_001;
+  if (order > 0) {
+    /* 1st order terms */
+    pot->D_100 = -pot->D_100;
+    pot->D_010 = -pot->D_010;
+    pot->D_001 = -pot->D_001;
+  }
 #endif
 
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 2
-  /* 3rd order terms */
-  pot->D_300 = -pot->D_300;
-  pot->D_030 = -pot->D_030;
-  pot->D_003 = -pot->D_003;
-  pot->D_210 = -pot->D_210;
-  pot->D_201 = -pot->D_201;
-  pot->D_021 = -pot->D_021;
-  pot->D_120 = -pot->D_120;
-  pot->D_012 = -pot->D_012;
-  pot->D_102 = -pot->D_102;
-  pot->D_111 = -pot->D_111;
+  if (order > 2) {
+    /* 3rd order terms */
+    pot->D_300 = -pot->D_300;
+    pot->D_030 = -pot->D_030;
+    pot->D_003 = -pot->D_003;
+    pot->D_210 = -pot->D_210;
+    pot->D_201 = -pot->D_201;
+    pot->D_021 = -pot->D_021;
+    pot->D_120 = -pot->D_120;
+    pot->D_012 = -pot->D_012;
+    pot->D_102 = -pot->D_102;
+    pot->D_111 = -pot->D_111;
+  }
 #endif
 
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 4
-  /* 5th order terms */
-  pot->D_500 = -pot->D_500;
-  pot->D_050 = -pot->D_050;
-  pot->D_005 = -pot->D_005;
-  pot->D_410 = -pot->D_410;
-  pot->D_401 = -pot->D_401;
-  pot->D_041 = -pot->D_041;
-  pot->D_140 = -pot->D_140;
-  pot->D_014 = -pot->D_014;
-  pot->D_104 = -pot->D_104;
-  pot->D_320 = -pot->D_320;
-  pot->D_302 = -pot->D_302;
-  pot->D_032 = -pot->D_032;
-  pot->D_230 = -pot->D_230;
-  pot->D_023 = -pot->D_023;
-  pot->D_203 = -pot->D_203;
-  pot->D_311 = -pot->D_311;
-  pot->D_131 = -pot->D_131;
-  pot->D_113 = -pot->D_113;
-  pot->D_122 = -pot->D_122;
-  pot->D_212 = -pot->D_212;
-  pot->D_221 = -pot->D_221;
+  if (order > 4) {
+    /* 5th order terms */
+    pot->D_500 = -pot->D_500;
+    pot->D_050 = -pot->D_050;
+    pot->D_005 = -pot->D_005;
+    pot->D_410 = -pot->D_410;
+    pot->D_401 = -pot->D_401;
+    pot->D_041 = -pot->D_041;
+    pot->D_140 = -pot->D_140;
+    pot->D_014 = -pot->D_014;
+    pot->D_104 = -pot->D_104;
+    pot->D_320 = -pot->D_320;
+    pot->D_302 = -pot->D_302;
+    pot->D_032 = -pot->D_032;
+    pot->D_230 = -pot->D_230;
+    pot->D_023 = -pot->D_023;
+    pot->D_203 = -pot->D_203;
+    pot->D_311 = -pot->D_311;
+    pot->D_131 = -pot->D_131;
+    pot->D_113 = -pot->D_113;
+    pot->D_122 = -pot->D_122;
+    pot->D_212 = -pot->D_212;
+    pot->D_221 = -pot->D_221;
+  }
 #endif
 }
 
 /**
- * @brief Compute all the relevent derivatives of the softened and truncated
- * gravitational potential for the M2L kernel.
+ * @brief Compute the radial terms of the derivatives of the softened and
+ * truncated gravitational potential for the M2L kernel.
+ *
+ * These only depend on the norm of the distance vector.
  *
- * @param r_x x-component of distance vector
- * @param r_y y-component of distance vector
- * @param r_z z-component of distance vector
  * @param r2 Square norm of distance vector
  * @param r_inv Inverse norm of distance vector
  * @param eps Softening length.
  * @param eps_inv Inverse of softening length.
  * @param periodic Is the calculation periodic ?
  * @param r_s_inv Inverse of the long-range gravity mesh smoothing length.
- * @param pot (return) The structure containing all the derivatives.
+ * @param rad (return) The structure containing the radial terms.
  */
 __attribute__((always_inline)) INLINE static void
-potential_derivatives_compute_M2L(const float r_x, const float r_y,
-                                  const float r_z, const float r2,
-                                  const float r_inv, const float eps,
-                                  const float eps_inv, const int periodic,
-                                  const float r_s_inv,
-                                  struct potential_derivatives_M2L *pot) {
+potential_derivatives_compute_M2L_radial(
+    const float r2, const float r_inv, const float eps, const float eps_inv,
+    const int periodic, const float r_s_inv,
+    struct potential_derivatives_M2L_radial *rad) {
 
   float Dt_1;
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 0
@@ -326,7 +355,58 @@ potential_derivatives_compute_M2L(const float r_x, const float r_y,
 #endif
   }
 
-/* Alright, let's get the full terms */
+  /* Store the terms */
+  rad->Dt_1 = Dt_1;
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 0
+  rad->Dt_3 = Dt_3;
+#endif
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 1
+  rad->Dt_5 = Dt_5;
+#endif
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 2
+  rad->Dt_7 = Dt_7;
+#endif
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 3
+  rad->Dt_9 = Dt_9;
+#endif
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 4
+  rad->Dt_11 = Dt_11;
+#endif
+}
+
+/**
+ * @brief Compute all the derivatives of the potential for the M2L kernel from
+ * their radial terms.
+ *
+ * @param r_x x-component of distance vector
+ * @param r_y y-component of distance vector
+ * @param r_z z-component of distance vector
+ * @param rad The radial terms from potential_derivatives_compute_M2L_radial().
+ * @param pot (return) The structure containing all the derivatives.
+ * @param order The run-time multipole order (higher terms are left unset).
+ */
+__attribute__((always_inline)) INLINE static void
+potential_derivatives_M2L_from_radial(
+    const float r_x, const float r_y, const float r_z,
+    const struct potential_derivatives_M2L_radial *rad,
+    struct potential_derivatives_M2L *pot, const int order) {
+
+  const float Dt_1 = rad->Dt_1;
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 0
+  const float Dt_3 = rad->Dt_3;
+#endif
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 1
+  const float Dt_5 = rad->Dt_5;
+#endif
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 2
+  const float Dt_7 = rad->Dt_7;
+#endif
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 3
+  const float Dt_9 = rad->Dt_9;
+#endif
+#if SELF_GRAVITY_MULTIPOLE_ORDER > 4
+  const float Dt_11 = rad->Dt_11;
+#endif
 
 /* Compute some powers of r_x, r_y and r_z */
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 1
@@ -357,12 +437,17 @@ potential_derivatives_compute_M2L(const float r_x, const float r_y,
   pot->D_000 = Dt_1;
 
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 0
+  /* Stop at the run-time order */
+  if (order <= 0) return;
+
   /* 1st order derivatives */
   pot->D_100 = r_x * Dt_3;
   pot->D_010 = r_y * Dt_3;
   pot->D_001 = r_z * Dt_3;
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 1
+  if (order <= 1) return;
+
   /* 2nd order derivatives */
   pot->D_200 = r_x2 * Dt_5 + Dt_3;
   pot->D_020 = r_y2 * Dt_5 + Dt_3;
@@ -372,6 +457,8 @@ potential_derivatives_compute_M2L(const float r_x, const float r_y,
   pot->D_011 = r_y * r_z * Dt_5;
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 2
+  if (order <= 2) return;
+
   /* 3rd order derivatives */
   pot->D_300 = r_x3 * Dt_7 + 3.f * r_x * Dt_5;
   pot->D_030 = r_y3 * Dt_7 + 3.f * r_y * Dt_5;
@@ -385,6 +472,8 @@ potential_derivatives_compute_M2L(const float r_x, const float r_y,
   pot->D_111 = r_x * r_y * r_z * Dt_7;
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 3
+  if (order <= 3) return;
+
   /* 4th order derivatives */
   pot->D_400 = r_x4 * Dt_9 + 6.f * r_x2 * Dt_7 + 3.f * Dt_5;
   pot->D_040 = r_y4 * Dt_9 + 6.f * r_y2 * Dt_7 + 3.f * Dt_5;
@@ -403,6 +492,8 @@ potential_derivatives_compute_M2L(const float r_x, const float r_y,
   pot->D_112 = r_z2 * r_x * r_y * Dt_9 + r_x * r_y * Dt_7;
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 4
+  if (order <= 4) return;
+
   /* 5th order derivatives */
   pot->D_500 = r_x5 * Dt_11 + 10.f * r_x3 * Dt_9 + 15.f * r_x * Dt_7;
   pot->D_050 = r_y5 * Dt_11 + 10.f * r_y3 * Dt_9 + 15.f * r_y * Dt_7;
@@ -440,6 +531,37 @@ potential_derivatives_compute_M2L(const float r_x, const float r_y,
 #endif
 }
 
+/**
+ * @brief Compute all the relevent derivatives of the softened and truncated
+ * gravitational potential for the M2L kernel.
+ *
+ * @param r_x x-component of distance vector
+ * @param r_y y-component of distance vector
+ * @param r_z z-component of distance vector
+ * @param r2 Square norm of distance vector
+ * @param r_inv Inverse norm of distance vector
+ * @param eps Softening length.
+ * @param eps_inv Inverse of softening length.
+ * @param periodic Is the calculation periodic ?
+ * @param r_s_inv Inverse of the long-range gravity mesh smoothing length.
+ * @param pot (return) The structure containing all the derivatives.
+ * @param order The run-time multipole order.
+ */
+__attribute__((always_inline)) INLINE static void
+potential_derivatives_compute_M2L(const float r_x, const float r_y,
+                                  const float r_z, const float r2,
+                                  const float r_inv, const float eps,
+                                  const float eps_inv, const int periodic,
+                                  const float r_s_inv,
+                                  struct potential_derivatives_M2L *pot,
+                                  const int order) {
+
+  struct potential_derivatives_M2L_radial rad;
+  potential_derivatives_compute_M2L_radial(r2, r_inv, eps, eps_inv, periodic,
+                                           r_s_inv, &rad);
+  potential_derivatives_M2L_from_radial(r_x, r_y, r_z, &rad, pot, order);
+}
+
 /**
  * @brief Compute all the relevent derivatives of the softened and truncated
  * gravitational potential for the M2P kernel.
@@ -23,6 +23,7 @@
 /* Standard headers */
 #include <float.h>
 #include <math.h>
+#include <string.h>
 
 /* Local headers. */
 #include "adiabatic_index.h"
@@ -37,6 +38,7 @@
 #define gravity_props_default_r_cut_max 4.5f
 #define gravity_props_default_r_cut_min 0.1f
 #define gravity_props_default_rebuild_frequency 0.01f
+#define gravity_props_default_adaptive_tolerance 1e-3f
 
 void gravity_props_init(struct gravity_props *p, struct swift_params *params,
                         const struct cosmology *cosmo, int with_cosmology,
@@ -59,6 +61,91 @@ void gravity_props_init(struct gravity_props *p, struct swift_params *params,
         params, "Gravity:r_cut_max", gravity_props_default_r_cut_max);
     p->r_cut_min_ratio = parser_get_opt_param_float(
         params, "Gravity:r_cut_min", gravity_props_default_r_cut_min);
+    p->distributed_mesh =
+        parser_get_opt_param_int(params, "Gravity:distributed_mesh", 0);
+    p->mesh_tiled_assignment =
+        parser_get_opt_param_int(params, "Gravity:mesh_tiled_assignment", 0);
+    p->mesh_interlacing =
+        parser_get_opt_param_int(params, "Gravity:mesh_interlacing", 0);
+
+    /* Multiple time-stepping of the mesh forces */
+    p->mesh_multiple_time_stepping = parser_get_opt_param_int(
+        params, "Gravity:mesh_multiple_time_stepping", 0);
+
+    /* FFTW planning, the wisdom lives next to the restart files */
+    char planning[PARSER_MAX_LINE_SIZE];
+    parser_get_opt_param_string(params, "Gravity:mesh_fftw_planning",
+                                planning, "estimate");
+    if (strcmp(planning, "estimate") == 0) {
+      p->mesh_fftw_planning = 0;
+    } else if (strcmp(planning, "measure") == 0) {
+      p->mesh_fftw_planning = 1;
+    } else if (strcmp(planning, "patient") == 0) {
+      p->mesh_fftw_planning = 2;
+    } else {
+      error(
+          "Invalid value for Gravity:mesh_fftw_planning ('%s'), must be "
+          "'estimate', 'measure' or 'patient'.",
+          planning);
+    }
+    char restart_dir[PARSER_MAX_LINE_SIZE];
+    parser_get_opt_param_string(params, "Restarts:subdir", restart_dir,
+                                "restart");
+    if (snprintf(p->mesh_fftw_wisdom_file, PARSER_MAX_LINE_SIZE,
+                 "%s/fftw_mesh_%d.wisdom", restart_dir,
+                 p->mesh_size) >= PARSER_MAX_LINE_SIZE)
+      error("Name of the FFTW wisdom file is too long.");
+
+    /* Mass assignment scheme */
+    char assignment[PARSER_MAX_LINE_SIZE];
+    parser_get_opt_param_string(params, "Gravity:mesh_assignment", assignment,
+                                "CIC");
+    if (strcmp(assignment, "CIC") == 0) {
+      p->mesh_assignment_order = 2;
+    } else if (strcmp(assignment, "TSC") == 0) {
+      p->mesh_assignment_order = 3;
+    } else if (strcmp(assignment, "PCS") == 0) {
+      p->mesh_assignment_order = 4;
+    } else {
+      error(
+          "Invalid value for Gravity:mesh_assignment ('%s'), must be 'CIC', "
+          "'TSC' or 'PCS'.",
+          assignment);
+    }
+
+    /* Power spectrum measured on the mesh */
+    p->power_spectrum =
+        parser_get_opt_param_int(params, "Gravity:power_spectrum", 0);
+    if (p->power_spectrum) {
+      p->power_spectrum_species = parser_get_opt_param_int(
+          params, "Gravity:power_spectrum_species", 0);
+      p->power_spectrum_delta =
+          parser_get_param_double(params, "Gravity:power_spectrum_delta");
+      if (with_cosmology) {
+        p->power_spectrum_first = parser_get_opt_param_double(
+            params, "Gravity:power_spectrum_first", cosmo->a_begin);
+        if (p->power_spectrum_delta <= 1.)
+          error(
+              "The ratio of scale-factors between power spectra must be > 1.");
+      } else {
+        p->power_spectrum_first = parser_get_opt_param_double(
+            params, "Gravity:power_spectrum_first", 0.);
+        if (p->power_spectrum_delta <= 0.)
+          error("The time between power spectra must be > 0.");
+      }
+      parser_get_opt_param_string(params, "Gravity:power_spectrum_basename",
+                                  p->power_spectrum_basename, "power_spectrum");
+
+      if (p->distributed_mesh)
+        error(
+            "The power spectrum can only be measured on the replicated "
+            "mesh.");
+    } else {
+      p->power_spectrum_species = 0;
+      p->power_spectrum_first = 0.;
+      p->power_spectrum_delta = 0.;
+      p->power_spectrum_basename[0] = '\0';
+    }
 
     /* Some basic checks of what we read */
     if (p->mesh_size % 2 != 0)
@@ -70,8 +157,27 @@ void gravity_props_init(struct gravity_props *p, struct swift_params *params,
     if (2. * p->a_smooth * p->r_cut_max_ratio > p->mesh_size)
       error("Mesh too small given r_cut_max. Should be at least %d cells wide.",
             (int)(2. * p->a_smooth * p->r_cut_max_ratio) + 1);
+
+#if !defined(WITH_MPI) || !defined(HAVE_MPI_FFTW)
+    if (p->distributed_mesh)
+      error(
+          "Distributed mesh requested but the code was not compiled with MPI "
+          "and the MPI version of the FFTW library.");
+#endif
   } else {
     p->mesh_size = 0;
+    p->distributed_mesh = 0;
+    p->mesh_tiled_assignment = 0;
+    p->mesh_assignment_order = 2;
+    p->mesh_interlacing = 0;
+    p->mesh_multiple_time_stepping = 0;
+    p->mesh_fftw_planning = 0;
+    p->mesh_fftw_wisdom_file[0] = '\0';
+    p->power_spectrum = 0;
+    p->power_spectrum_species = 0;
+    p->power_spectrum_first = 0.;
+    p->power_spectrum_delta = 0.;
+    p->power_spectrum_basename[0] = '\0';
     p->a_smooth = 0.f;
     p->r_cut_min_ratio = 0.f;
     p->r_cut_max_ratio = 0.f;
@@ -81,11 +187,44 @@ void gravity_props_init(struct gravity_props *p, struct swift_params *params,
   p->eta = parser_get_param_float(params, "Gravity:eta");
 
   /* Opening angle */
+  /* Order of the expansion, up to what the code was compiled with */
+  p->multipole_order = parser_get_opt_param_int(
+      params, "Gravity:multipole_order", SELF_GRAVITY_MULTIPOLE_ORDER);
+  if (p->multipole_order < 0 ||
+      p->multipole_order > SELF_GRAVITY_MULTIPOLE_ORDER)
+    error(
+        "Invalid Gravity:multipole_order (%d), must be between 0 and the "
+        "order the code was compiled with (%d).",
+        p->multipole_order, SELF_GRAVITY_MULTIPOLE_ORDER);
+
   p->theta_crit = parser_get_param_double(params, "Gravity:theta");
   if (p->theta_crit >= 1.) error("Theta too large. FMM won't converge.");
   p->theta_crit2 = p->theta_crit * p->theta_crit;
   p->theta_crit_inv = 1. / p->theta_crit;
 
+  /* Multipole acceptance criterion */
+  char mac[PARSER_MAX_LINE_SIZE];
+  parser_get_opt_param_string(params, "Gravity:MAC", mac, "geometric");
+  if (strcmp(mac, "adaptive") == 0) {
+    p->use_adaptive_tolerance = 1;
+  } else if (strcmp(mac, "geometric") == 0) {
+    p->use_adaptive_tolerance = 0;
+  } else {
+    error(
+        "Invalid value for Gravity:MAC ('%s'), must be 'geometric' or "
+        "'adaptive'.",
+        mac);
+  }
+  p->adaptive_tolerance =
+      parser_get_opt_param_float(params, "Gravity:epsilon_fmm",
+                                 gravity_props_default_adaptive_tolerance);
+  if (p->adaptive_tolerance <= 0.f)
+    error("The FMM force error tolerance 'epsilon_fmm' must be > 0.");
+
+  /* Re-use of the P-P caches across the pairs of a task */
+  p->use_resident_caches =
+      parser_get_opt_param_int(params, "Gravity:resident_caches", 0);
+
   /* Softening parameters */
   if (with_cosmology) {
     p->epsilon_comoving =
@@ -128,13 +267,24 @@ void gravity_props_print(const struct gravity_props *p) {
 
   message("Self-gravity scheme: %s", GRAVITY_IMPLEMENTATION);
 
-  message("Self-gravity scheme: FMM-MM with m-poles of order %d",
-          SELF_GRAVITY_MULTIPOLE_ORDER);
+  message(
+      "Self-gravity scheme: FMM-MM with m-poles of order %d (compiled up to "
+      "order %d)",
+      p->multipole_order, SELF_GRAVITY_MULTIPOLE_ORDER);
 
   message("Self-gravity time integration: eta=%.4f", p->eta);
 
   message("Self-gravity opening angle:  theta=%.4f", p->theta_crit);
 
+  if (p->use_adaptive_tolerance)
+    message(
+        "Self-gravity adaptive acceptance criterion: epsilon_fmm=%.2e (theta "
+        "is the maximal opening angle)",
+        p->adaptive_tolerance);
+
+  if (p->use_resident_caches)
+    message("Self-gravity P-P caches kept resident across pair interactions");
+
   message("Self-gravity softening functional form: %s",
           kernel_gravity_softening_name);
 
@@ -151,6 +301,26 @@ void gravity_props_print(const struct gravity_props *p) {
       p->epsilon_max_physical);
 
   message("Self-gravity mesh side-length: N=%d", p->mesh_size);
+  if (p->distributed_mesh)
+    message("Self-gravity mesh is distributed over the MPI ranks");
+  if (p->mesh_tiled_assignment)
+    message("Self-gravity mesh assignment uses private per-cell tiles");
+  if (p->mesh_size > 0)
+    message("Self-gravity mesh assignment scheme: %s%s",
+            p->mesh_assignment_order == 2
+                ? "CIC"
+                : (p->mesh_assignment_order == 3 ? "TSC" : "PCS"),
+            p->mesh_interlacing ? " (interlaced)" : "");
+  if (p->mesh_multiple_time_stepping)
+    message("Self-gravity mesh forces are only updated at rebuild time");
+  if (p->mesh_fftw_planning > 0)
+    message("Self-gravity mesh FFTW planning: %s (wisdom in '%s')",
+            p->mesh_fftw_planning == 1 ? "measure" : "patient",
+            p->mesh_fftw_wisdom_file);
+  if (p->power_spectrum)
+    message("Self-gravity mesh measures the power spectrum%s ('%s')",
+            p->power_spectrum_species ? " of each particle type" : "",
+            p->power_spectrum_basename);
   message("Self-gravity mesh smoothing-scale: a_smooth=%f", p->a_smooth);
 
   message("Self-gravity tree cut-off ratio: r_cut_max=%f", p->r_cut_max_ratio);
@@ -185,8 +355,13 @@ void gravity_props_print_snapshot(hid_t h_grpgrav,
                        " [internal units]",
                        p->epsilon_max_physical);
   io_write_attribute_f(h_grpgrav, "Opening angle", p->theta_crit);
+  io_write_attribute_s(h_grpgrav, "MAC",
+                       p->use_adaptive_tolerance ? "adaptive" : "geometric");
+  if (p->use_adaptive_tolerance)
+    io_write_attribute_f(h_grpgrav, "Adaptive MAC tolerance",
+                         p->adaptive_tolerance);
   io_write_attribute_s(h_grpgrav, "Scheme", GRAVITY_IMPLEMENTATION);
-  io_write_attribute_i(h_grpgrav, "MM order", SELF_GRAVITY_MULTIPOLE_ORDER);
+  io_write_attribute_i(h_grpgrav, "MM order", p->multipole_order);
   io_write_attribute_f(h_grpgrav, "Mesh a_smooth", p->a_smooth);
   io_write_attribute_f(h_grpgrav, "Mesh r_cut_max ratio", p->r_cut_max_ratio);
   io_write_attribute_f(h_grpgrav, "Mesh r_cut_min ratio", p->r_cut_min_ratio);
@@ -27,6 +27,7 @@
 #endif
 
 /* Local includes. */
+#include "parser.h"
 #include "restart.h"
 
 /* Forward declarations */
@@ -44,6 +45,42 @@ struct gravity_props {
   /*! Periodic long-range mesh side-length */
   int mesh_size;
 
+  /*! Are we distributing the mesh over the MPI ranks? */
+  int distributed_mesh;
+
+  /*! Are we using private tiles for the mesh mass assignment? */
+  int mesh_tiled_assignment;
+
+  /*! Order of the mesh mass assignment scheme (2: CIC, 3: TSC, 4: PCS) */
+  int mesh_assignment_order;
+
+  /*! Are we interlacing the mesh density with a shifted mesh? */
+  int mesh_interlacing;
+
+  /*! Are the mesh forces frozen between rebuilds (multiple time-stepping)? */
+  int mesh_multiple_time_stepping;
+
+  /*! FFTW planning level of the mesh (0: estimate, 1: measure, 2: patient) */
+  int mesh_fftw_planning;
+
+  /*! File where the FFTW wisdom of the mesh is stored */
+  char mesh_fftw_wisdom_file[PARSER_MAX_LINE_SIZE];
+
+  /*! Are we measuring the power spectrum on the mesh? */
+  int power_spectrum;
+
+  /*! Are we also measuring the power spectrum of each particle type? */
+  int power_spectrum_species;
+
+  /*! Scale-factor (or time) of the first power spectrum measurement */
+  double power_spectrum_first;
+
+  /*! Ratio of scale-factors (or time interval) between measurements */
+  double power_spectrum_delta;
+
+  /*! Base name of the power spectrum files */
+  char power_spectrum_basename[PARSER_MAX_LINE_SIZE];
+
   /*! Mesh smoothing scale in units of top-level cell size */
   float a_smooth;
 
@@ -58,6 +95,10 @@ struct gravity_props {
   /*! Time integration dimensionless multiplier */
   float eta;
 
+  /*! Order of the multipole expansion used at run-time (at most
+   * SELF_GRAVITY_MULTIPOLE_ORDER) */
+  int multipole_order;
+
   /*! Tree opening angle (Multipole acceptance criterion) */
   double theta_crit;
 
@@ -67,6 +108,15 @@ struct gravity_props {
   /*! Inverse of opening angle */
   double theta_crit_inv;
 
+  /*! Are we using the adaptive (error-based) multipole acceptance criterion? */
+  int use_adaptive_tolerance;
+
+  /*! Relative force error tolerance of the adaptive acceptance criterion */
+  float adaptive_tolerance;
+
+  /*! Are we keeping the P-P caches of a cell across consecutive pairs? */
+  int use_resident_caches;
+
   /*! Comoving softening */
   double epsilon_comoving;
 
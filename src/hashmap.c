@@ -26,308 +26,297 @@
  * Modified by Pete Warden to fix a serious performance problem, support strings
  * as keys and removed thread synchronization - http://petewarden.typepad.com
  */
+/* Config parameters. */
+#include "../config.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_IMMINTRIN_H
+/* Include the header file with the intrinsics for Intel architecture. */
+#include <immintrin.h>
+#endif
+
 #include "error.h"
 #include "hashmap.h"
+#include "inline.h"
 #include "memuse.h"
 
-#define INITIAL_NUM_CHUNKS (1)
+#define HASHMAP_INITIAL_NR_GROUPS (4)
 #define HASHMAP_GROWTH_FACTOR (2)
-#define HASHMAP_MAX_FILL_RATIO (1.0)
-#define HASHMAP_MAX_CHUNK_FILL_RATIO (0.5)
+#define HASHMAP_MAX_FILL_RATIO (0.875)
+#define HASHMAP_MOVED_GROUPS_PER_INSERT (2)
 
 /**
- * @brief Pre-allocate a number of chunks for the graveyard.
+ * @brief Hash function for the keys (the 64-bit finaliser of MurmurHash3).
+ *
+ * The high bits select the first group to probe and the 7 low bits are the
+ * tag stored in the control byte of the slot.
  */
-void hashmap_allocate_chunks(hashmap_t *m, int num_chunks) {
-  /* Allocate a fresh set of chunks. */
-  hashmap_chunk_t *alloc;
-  if ((alloc = (hashmap_chunk_t *)swift_calloc(
-           "hashmap", num_chunks, sizeof(hashmap_chunk_t))) == NULL) {
-    error("Unable to allocate chunks.");
-  }
-
-  /* Hook up the alloc, so that we can clean it up later. */
-  if (m->allocs_count == m->allocs_size) {
-    m->allocs_size *= 2;
-    void **new_allocs =
-        (void **)swift_malloc("hashmap", sizeof(void *) * m->allocs_size);
-    memcpy(new_allocs, m->allocs, sizeof(void *) * m->allocs_count);
-    swift_free("hashmap", m->allocs);
-    m->allocs = new_allocs;
-  }
-  m->allocs[m->allocs_count++] = alloc;
-
-  /* Link the chunks together. */
-  for (int k = 0; k < num_chunks - 1; k++) {
-    alloc[k].next = &alloc[k + 1];
-  }
-
-  /* Last chunk points to current graveyard. */
-  alloc[num_chunks - 1].next = m->graveyard;
-
-  /* Graveyard points to first new chunk. */
-  m->graveyard = alloc;
+__attribute__((always_inline)) INLINE static size_t hashmap_hash(
+    hashmap_key_t key) {
+
+  unsigned long long h = (unsigned long long)key;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (size_t)h;
 }
 
-void hashmap_init(hashmap_t *m) {
-  /* Allocate the first (empty) list of chunks. */
-  m->nr_chunks = INITIAL_NUM_CHUNKS;
-  if ((m->chunks = (hashmap_chunk_t **)swift_calloc(
-           "hashmap", m->nr_chunks, sizeof(hashmap_chunk_t *))) == NULL) {
-    error("Unable to allocate hashmap chunks.");
-  }
-
-  /* The graveyard is currently empty. */
-  m->graveyard = NULL;
-  m->allocs = NULL;
-
-  /* Init the array of allocations. */
-  m->allocs_size = HASHMAP_ALLOCS_INITIAL_SIZE;
-  if ((m->allocs = (void **)swift_malloc(
-           "hashmap", sizeof(void *) * m->allocs_size)) == NULL) {
-    error("Unable to allocate allocs pointer array.");
-  }
-  m->allocs_count = 0;
-
-  /* Set initial sizes. */
-  m->table_size = m->nr_chunks * HASHMAP_ELEMENTS_PER_CHUNK;
-  m->size = 0;
-
-  /* Inform the men. */
-  if (HASHMAP_DEBUG_OUTPUT) {
-    message(
-        "Created hash table of size: %zu each element is %zu bytes. Allocated "
-        "%zu empty chunks.",
-        m->table_size * sizeof(hashmap_element_t), sizeof(hashmap_element_t),
-        m->nr_chunks);
-  }
+/**
+ * @brief Bit-mask of the slots of a group whose control byte is ctrl.
+ */
+__attribute__((always_inline)) INLINE static unsigned int hashmap_group_match(
+    const hashmap_ctrl_t *group, const hashmap_ctrl_t ctrl) {
+
+#ifdef __SSE2__
+  const __m128i g = _mm_loadu_si128((const __m128i *)group);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)ctrl)));
+#else
+  unsigned int mask = 0;
+  for (int k = 0; k < HASHMAP_GROUP_SIZE; k++)
+    if (group[k] == ctrl) mask |= 1u << k;
+  return mask;
+#endif
 }
 
 /**
- * @brief Put a used chunk back into the recycling bin.
+ * @brief Allocate an empty table of nr_groups groups.
  */
-void hashmap_release_chunk(hashmap_t *m, hashmap_chunk_t *chunk) {
-  /* Clear all the chunk's data. */
-  memset(chunk, 0, sizeof(hashmap_chunk_t));
-
-  /* Hook it up with the other stiffs in the graveyard. */
-  chunk->next = m->graveyard;
-  m->graveyard = chunk;
+static void hashmap_table_init(hashmap_table_t *t, size_t nr_groups) {
+
+  const size_t nr_slots = nr_groups * HASHMAP_GROUP_SIZE;
+  if ((t->ctrl = (hashmap_ctrl_t *)swift_malloc(
+           "hashmap", nr_slots * sizeof(hashmap_ctrl_t))) == NULL ||
+      (t->data = (hashmap_element_t *)swift_malloc(
+           "hashmap", nr_slots * sizeof(hashmap_element_t))) == NULL) {
+    error("Unable to allocate hashmap table of %zu slots.", nr_slots);
+  }
+  memset(t->ctrl, HASHMAP_CTRL_EMPTY, nr_slots * sizeof(hashmap_ctrl_t));
+  t->nr_groups = nr_groups;
+  t->size = 0;
 }
 
 /**
- * @brief Return a new chunk, either recycled or freshly allocated.
+ * @brief Free the memory of a table.
  */
-hashmap_chunk_t *hashmap_get_chunk(hashmap_t *m) {
-  int num_chunks = m->nr_chunks * HASHMAP_ALLOC_SIZE_FRACTION;
-  if (!num_chunks) num_chunks = 1;
-  if (m->graveyard == NULL) {
-    hashmap_allocate_chunks(m, num_chunks);
+static void hashmap_table_free(hashmap_table_t *t) {
+  if (t->ctrl != NULL) {
+    swift_free("hashmap", t->ctrl);
+    swift_free("hashmap", t->data);
   }
-
-  hashmap_chunk_t *res = (hashmap_chunk_t *)m->graveyard;
-  m->graveyard = (hashmap_chunk_t *)res->next;
-  res->next = NULL;
-
-  return res;
+  t->ctrl = NULL;
+  t->data = NULL;
+  t->nr_groups = 0;
+  t->size = 0;
 }
 
 /**
- * @brief Looks for the given key and retuns a pointer to the corresponding
- * element.
- *
- * The returned element is either the one that already existed in the hashmap,
- * or a newly-reseverd element initialized to zero.
+ * @brief Look for a key in a table.
  *
- * If the hashmap is full, NULL is returned.
+ * The groups are visited along a triangular sequence, which covers the whole
+ * table as the number of groups is a power of two. Each group is matched
+ * against the tag of the key at once and the search stops at the first group
+ * with an empty slot.
  *
- * We use `rand_r` as a hashing function. The key is first hashed to obtain an
- * initial global position. If there is a collision, the hashing function is
- * re-applied to the key to obtain a new offset *within the same bucket*. This
- * is repeated for at most HASHMAP_MAX_CHAIN_LENGTH steps, at which point
- * insertion fails.
+ * @param t The #hashmap_table_t.
+ * @param key The key.
+ * @param hash The hash of the key.
+ * @param probe_length (return) The number of extra groups visited, if not
+ *        NULL.
+ * @return The element holding the key, or NULL if it is not in the table.
  */
-hashmap_element_t *hashmap_find(hashmap_t *m, hashmap_key_t key, int create_new,
-                                int *chain_length, int *created_new_element) {
-  /* If full, return immediately */
-  if (create_new && m->size > m->table_size * HASHMAP_MAX_FILL_RATIO) {
-    if (HASHMAP_DEBUG_OUTPUT) {
-      message("hashmap is too full (%zu of %zu elements used), re-hashing.",
-              m->size, m->table_size);
-    }
-    return NULL;
-  }
+static hashmap_element_t *hashmap_table_find(const hashmap_table_t *t,
+                                             hashmap_key_t key, size_t hash,
+                                             int *probe_length) {
 
-  /* We will use rand_r as our hash function. */
-  unsigned int curr = (unsigned int)key;
+  const size_t group_mask = t->nr_groups - 1;
+  const hashmap_ctrl_t tag = hash & 0x7f;
+  size_t group = (hash >> 7) & group_mask;
 
-  /* Get offsets to the entry, its chunk, it's mask, etc. */
-  const size_t offset = rand_r(&curr) % m->table_size;
-  const size_t chunk_offset = offset / HASHMAP_ELEMENTS_PER_CHUNK;
-  size_t offset_in_chunk = offset - chunk_offset * HASHMAP_ELEMENTS_PER_CHUNK;
+  for (size_t i = 0;; i++) {
+    if (probe_length) *probe_length = i;
 
-  /* Allocate the chunk if needed. */
-  if (m->chunks[chunk_offset] == NULL) {
-    /* Quit here if we don't want to create a new entry. */
-    if (!create_new) return NULL;
+    const hashmap_ctrl_t *ctrl = &t->ctrl[group * HASHMAP_GROUP_SIZE];
+    hashmap_element_t *data = &t->data[group * HASHMAP_GROUP_SIZE];
 
-    /* Get a new chunk for this offset. */
-    m->chunks[chunk_offset] = hashmap_get_chunk(m);
+    /* Check the slots carrying the right tag. */
+    for (unsigned int match = hashmap_group_match(ctrl, tag); match;
+         match &= match - 1) {
+      const int k = __builtin_ctz(match);
+      if (data[k].key == key) return &data[k];
+    }
+
+    /* An empty slot ends the search. */
+    if (hashmap_group_match(ctrl, HASHMAP_CTRL_EMPTY)) return NULL;
+
+    group = (group + i + 1) & group_mask;
   }
-  hashmap_chunk_t *chunk = m->chunks[chunk_offset];
+}
 
-  /* Count the number of free elements in this chunk and bail if it is too low.
-   */
-  int chunk_count = 0;
-  for (int k = 0; k < HASHMAP_MASKS_PER_CHUNK; k++) {
-    chunk_count += __builtin_popcountll(chunk->masks[k]);
+/**
+ * @brief Store a key, which is not yet in the table, in its first free slot.
+ *
+ * @return The (uninitialised) element for the key.
+ */
+static hashmap_element_t *hashmap_table_insert(hashmap_table_t *t,
+                                               hashmap_key_t key,
+                                               size_t hash) {
+
+  const size_t group_mask = t->nr_groups - 1;
+  size_t group = (hash >> 7) & group_mask;
+
+  for (size_t i = 0;; i++) {
+    hashmap_ctrl_t *ctrl = &t->ctrl[group * HASHMAP_GROUP_SIZE];
+    const unsigned int empty = hashmap_group_match(ctrl, HASHMAP_CTRL_EMPTY);
+    if (empty) {
+      const int k = __builtin_ctz(empty);
+      ctrl[k] = hash & 0x7f;
+      t->size += 1;
+      hashmap_element_t *element = &t->data[group * HASHMAP_GROUP_SIZE + k];
+      element->key = key;
+      return element;
+    }
+    group = (group + i + 1) & group_mask;
   }
-  if (create_new &&
-      chunk_count > HASHMAP_ELEMENTS_PER_CHUNK * HASHMAP_MAX_CHUNK_FILL_RATIO) {
-    if (HASHMAP_DEBUG_OUTPUT) {
-      message(
-          "chunk %zu is too full (%i of %i elements used, fill ratio is "
-          "%.2f%%), re-hashing.",
-          chunk_offset, chunk_count, HASHMAP_ELEMENTS_PER_CHUNK,
-          (100.0 * m->size) / m->table_size);
+}
+
+/**
+ * @brief Move the elements of the next few groups of the old table to the
+ * current one. The old table is released once it is empty.
+ *
+ * The moved slots are marked as such rather than empty, so that the searches
+ * for the keys remaining in the old table still probe past them.
+ *
+ * @param m The #hashmap_t.
+ * @param nr_groups The maximal number of old groups to process.
+ */
+static void hashmap_move_old_groups(hashmap_t *m, size_t nr_groups) {
+
+  hashmap_table_t *old = &m->old_table;
+
+  for (size_t n = 0; n < nr_groups && old->size > 0; n++) {
+    const size_t group = m->old_next_group++;
+    hashmap_ctrl_t *ctrl = &old->ctrl[group * HASHMAP_GROUP_SIZE];
+    hashmap_element_t *data = &old->data[group * HASHMAP_GROUP_SIZE];
+
+    for (int k = 0; k < HASHMAP_GROUP_SIZE; k++) {
+      if (ctrl[k] & 0x80) continue;
+      const size_t hash = hashmap_hash(data[k].key);
+      hashmap_element_t *element =
+          hashmap_table_insert(&m->table, data[k].key, hash);
+      element->value = data[k].value;
+      ctrl[k] = HASHMAP_CTRL_MOVED;
+      old->size -= 1;
     }
-    return NULL;
   }
 
-  /* Linear probing (well, not really, but whatever). */
-  for (int i = 0; i < HASHMAP_MAX_CHAIN_LENGTH; i++) {
-    /* Record the chain_length, if not NULL. */
-    if (chain_length) *chain_length = i;
+  if (old->size == 0) hashmap_table_free(old);
+}
 
-    /* Compute the offsets within the masks of this chunk. */
-    const int mask_offset = offset_in_chunk / HASHMAP_BITS_PER_MASK;
-    const int offset_in_mask =
-        offset_in_chunk - mask_offset * HASHMAP_BITS_PER_MASK;
+/**
+ * @brief Grows the hashmap.
+ *
+ * The current table becomes the old one and its elements are moved to the
+ * new, larger, table incrementally by the next insertions instead of being
+ * re-hashed all at once.
+ */
+static void hashmap_grow(hashmap_t *m) {
 
-    /* Is the offset empty? */
-    hashmap_mask_t search_mask = ((hashmap_mask_t)1) << offset_in_mask;
-    if (!(chunk->masks[mask_offset] & search_mask)) {
-      /* Quit here if we don't want to create a new element. */
-      if (!create_new) return NULL;
+  /* Finish emptying the previous old table, if still needed. */
+  if (m->old_table.ctrl != NULL)
+    hashmap_move_old_groups(m, m->old_table.nr_groups);
 
-      /* Mark this element as taken and increase the size counter. */
-      chunk->masks[mask_offset] |= search_mask;
-      m->size += 1;
-      if (created_new_element) *created_new_element = 1;
+  if (HASHMAP_DEBUG_OUTPUT) {
+    message("Increasing hash table size from %zu (%zu kb) to %zu (%zu kb).",
+            m->table_size, m->table_size * sizeof(hashmap_element_t) / 1024,
+            m->table_size * HASHMAP_GROWTH_FACTOR,
+            m->table_size * HASHMAP_GROWTH_FACTOR *
+                sizeof(hashmap_element_t) / 1024);
+  }
 
-      /* Set the key. */
-      chunk->data[offset_in_chunk].key = key;
+  m->old_table = m->table;
+  m->old_next_group = 0;
+  hashmap_table_init(&m->table, m->table.nr_groups * HASHMAP_GROWTH_FACTOR);
+  m->table_size = m->table.nr_groups * HASHMAP_GROUP_SIZE;
+}
 
-      /* Return a pointer to the new element. */
-      return &chunk->data[offset_in_chunk];
-    }
+void hashmap_init(hashmap_t *m) {
 
-    /* Does the offset by chance contain the key we are looking for? */
-    else if (chunk->data[offset_in_chunk].key == key) {
-      return &chunk->data[offset_in_chunk];
-    }
+  hashmap_table_init(&m->table, HASHMAP_INITIAL_NR_GROUPS);
+  m->old_table.ctrl = NULL;
+  m->old_table.data = NULL;
+  m->old_table.nr_groups = 0;
+  m->old_table.size = 0;
+  m->old_next_group = 0;
 
-    /* None of the above, so this is a collision. Re-hash, but within the same
-       chunk. I guess this is Hopscotch Hashing? */
-    else {
-      offset_in_chunk = rand_r(&curr) % HASHMAP_ELEMENTS_PER_CHUNK;
-    }
-  }
+  /* Set initial sizes. */
+  m->table_size = m->table.nr_groups * HASHMAP_GROUP_SIZE;
+  m->size = 0;
 
-  /* We lucked out, so return nothing. */
+  /* Inform the men. */
   if (HASHMAP_DEBUG_OUTPUT) {
-    message("maximum chain length exceeded, re-hashing.");
+    message(
+        "Created hash table of size: %zu each element is %zu bytes. Allocated "
+        "%zu groups.",
+        m->table_size * sizeof(hashmap_element_t), sizeof(hashmap_element_t),
+        m->table.nr_groups);
   }
-  return NULL;
 }
 
 /**
- * @brief Grows the hashmap and rehashes all the elements
+ * @brief Looks for the given key and retuns a pointer to the corresponding
+ * element.
+ *
+ * The returned element is either the one that already existed in the hashmap,
+ * or, if create_new is set, a newly-reserved element initialized to zero.
+ *
+ * Elements that have not been moved yet after a growth are looked for in the
+ * old table. Every call creating elements moves a few more groups over.
  */
-void hashmap_grow(hashmap_t *m) {
-  /* Hold on to the old data. */
-  const size_t old_table_size = m->table_size;
-  hashmap_chunk_t **old_chunks = m->chunks;
+static hashmap_element_t *hashmap_find(hashmap_t *m, hashmap_key_t key,
+                                       int create_new, int *probe_length,
+                                       int *created_new_element) {
 
-  /* Re-allocate the chunk array. */
-  m->table_size *= HASHMAP_GROWTH_FACTOR;
-  m->nr_chunks = (m->table_size + HASHMAP_ELEMENTS_PER_CHUNK - 1) /
-                 HASHMAP_ELEMENTS_PER_CHUNK;
-  m->table_size = m->nr_chunks * HASHMAP_ELEMENTS_PER_CHUNK;
+  if (created_new_element) *created_new_element = 0;
 
-  if (HASHMAP_DEBUG_OUTPUT) {
-    message("Increasing hash table size from %zu (%zu kb) to %zu (%zu kb).",
-            old_table_size, old_table_size * sizeof(hashmap_element_t) / 1024,
-            m->table_size, m->table_size * sizeof(hashmap_element_t) / 1024);
-  }
+  /* Keep moving the old elements to the current table. */
+  if (create_new && m->old_table.ctrl != NULL)
+    hashmap_move_old_groups(m, HASHMAP_MOVED_GROUPS_PER_INSERT);
 
-  if ((m->chunks = (hashmap_chunk_t **)swift_calloc(
-           "hashmap", m->nr_chunks, sizeof(hashmap_chunk_t *))) == NULL) {
-    error("Unable to allocate hashmap chunks.");
+  const size_t hash = hashmap_hash(key);
+
+  hashmap_element_t *element =
+      hashmap_table_find(&m->table, key, hash, probe_length);
+  if (element != NULL) return element;
+
+  if (m->old_table.ctrl != NULL) {
+    element = hashmap_table_find(&m->old_table, key, hash, probe_length);
+    if (element != NULL) return element;
   }
 
-  /* Reset size. */
-  m->size = 0;
+  if (!create_new) return NULL;
 
-  /* Iterate over the chunks and add their entries to the new table. */
-  for (size_t cid = 0; cid < old_table_size / HASHMAP_ELEMENTS_PER_CHUNK;
-       cid++) {
-    /* Skip empty chunks. */
-    hashmap_chunk_t *chunk = old_chunks[cid];
-    if (!chunk) continue;
-
-    /* Loop over the masks in this chunk. */
-    for (int mid = 0; mid < HASHMAP_MASKS_PER_CHUNK; mid++) {
-      /* Skip empty masks. */
-      if (chunk->masks[mid] == 0) continue;
-
-      /* Loop over the mask entries. */
-      for (int eid = 0; eid < HASHMAP_BITS_PER_MASK; eid++) {
-        hashmap_mask_t element_mask = ((hashmap_mask_t)1) << eid;
-        if (chunk->masks[mid] & element_mask) {
-          hashmap_element_t *element =
-              &chunk->data[mid * HASHMAP_BITS_PER_MASK + eid];
-
-          /* Copy the element over to the new hashmap. */
-          hashmap_element_t *new_element =
-              hashmap_find(m, element->key, /*create_new=*/1,
-                           /*chain_length=*/NULL, /*created_new_element=*/NULL);
-          if (!new_element) {
-            /* TODO(pedro): Deal with this type of failure more elegantly. */
-            error("Failed to re-hash element.");
-          }
-          new_element->value = element->value;
-        }
-      }
-    }
+  /* Make room if needed; the key is in neither table, so this is safe. */
+  if (m->size + 1 > m->table_size * HASHMAP_MAX_FILL_RATIO) hashmap_grow(m);
 
-    /* We're through with this chunk, recycle it. */
-    hashmap_release_chunk(m, chunk);
-  }
+  element = hashmap_table_insert(&m->table, key, hash);
+  memset(&element->value, 0, sizeof(hashmap_value_t));
+  m->size += 1;
+  if (created_new_element) *created_new_element = 1;
 
-  /* Free the old list of chunks. */
-  swift_free("hashmap", old_chunks);
+  return element;
 }
 
 void hashmap_put(hashmap_t *m, hashmap_key_t key, hashmap_value_t value) {
 
-  /* Try to find an element for the given key. */
+  /* Find or create the element for the given key and set its value. */
   hashmap_element_t *element =
-      hashmap_find(m, key, /*create_new=*/1, /*chain_length=*/NULL,
+      hashmap_find(m, key, /*create_new=*/1, /*probe_length=*/NULL,
                    /*created_new_element=*/NULL);
-
-  /* Loop around, trying to find our place in the world. */
-  while (!element) {
-    hashmap_grow(m);
-    element = hashmap_find(m, key, /*create_new=*/1, /*chain_length=*/NULL,
-                           /*created_new_element=*/NULL);
-  }
-
-  /* Set the value. */
   element->value = value;
 }
 
@@ -335,13 +324,8 @@ hashmap_value_t *hashmap_get(hashmap_t *m, hashmap_key_t key) {
 
   /* Look for the given key. */
   hashmap_element_t *element =
-      hashmap_find(m, key, /*create_new=*/1, /*chain_length=*/NULL,
+      hashmap_find(m, key, /*create_new=*/1, /*probe_length=*/NULL,
                    /*created_new_element=*/NULL);
-  while (!element) {
-    hashmap_grow(m);
-    element = hashmap_find(m, key, /*create_new=*/1, /*chain_length=*/NULL,
-                           /*created_new_element=*/NULL);
-  }
   return &element->value;
 }
 
@@ -349,66 +333,43 @@ hashmap_value_t *hashmap_get_new(hashmap_t *m, hashmap_key_t key,
                                  int *created_new_element) {
   /* Look for the given key. */
   hashmap_element_t *element = hashmap_find(
-      m, key, /*create_new=*/1, /*chain_length=*/NULL, created_new_element);
-  while (!element) {
-    hashmap_grow(m);
-    element = hashmap_find(m, key, /*create_new=*/1, /*chain_length=*/NULL,
-                           created_new_element);
-  }
+      m, key, /*create_new=*/1, /*probe_length=*/NULL, created_new_element);
   return &element->value;
 }
 
 hashmap_value_t *hashmap_lookup(hashmap_t *m, hashmap_key_t key) {
   hashmap_element_t *element =
-      hashmap_find(m, key, /*create_new=*/0, /*chain_length=*/NULL,
+      hashmap_find(m, key, /*create_new=*/0, /*probe_length=*/NULL,
                    /*created_new_element=*/NULL);
   return element ? &element->value : NULL;
 }
 
-void hashmap_iterate(hashmap_t *m, hashmap_mapper_t f, void *data) {
-  /* Loop over the chunks. */
-  for (size_t cid = 0; cid < m->nr_chunks; cid++) {
-    hashmap_chunk_t *chunk = m->chunks[cid];
-    if (!chunk) continue;
-
-    /* Loop over the masks. */
-    for (int mid = 0; mid < HASHMAP_MASKS_PER_CHUNK; mid++) {
-      hashmap_mask_t mask = chunk->masks[mid];
-      if (!mask) continue;
-
-      /* Loop over each element in the mask. */
-      for (int eid = 0;
-           eid < HASHMAP_BITS_PER_MASK &&
-           mid * HASHMAP_BITS_PER_MASK + eid < HASHMAP_ELEMENTS_PER_CHUNK;
-           eid++) {
-        /* If the element exists, call the function on it. */
-        if (mask & (((hashmap_mask_t)1) << eid)) {
-          hashmap_element_t *element =
-              &chunk->data[mid * HASHMAP_BITS_PER_MASK + eid];
-          f(element->key, &element->value, data);
-        }
-      }
-    }
+/**
+ * @brief Call the function on every element of a table.
+ */
+static void hashmap_table_iterate(hashmap_table_t *t, hashmap_mapper_t f,
+                                  void *data) {
+  if (t->ctrl == NULL) return;
+  const size_t nr_slots = t->nr_groups * HASHMAP_GROUP_SIZE;
+  for (size_t k = 0; k < nr_slots; k++) {
+    if (!(t->ctrl[k] & 0x80)) f(t->data[k].key, &t->data[k].value, data);
   }
 }
 
+void hashmap_iterate(hashmap_t *m, hashmap_mapper_t f, void *data) {
+  /* Each element lives in exactly one of the two tables. */
+  hashmap_table_iterate(&m->table, f, data);
+  hashmap_table_iterate(&m->old_table, f, data);
+}
+
 void hashmap_free(hashmap_t *m) {
-  /* Free the list of active chunks. Note that the actual chunks will be freed
-     as part of the allocs below. */
-  swift_free("hashmap", m->chunks);
+  hashmap_table_free(&m->table);
+  hashmap_table_free(&m->old_table);
 
-  /* Re-set some pointers and values, just in case. */
-  m->chunks = NULL;
-  m->graveyard = NULL;
+  /* Re-set some values, just in case. */
   m->size = 0;
   m->table_size = 0;
-  m->nr_chunks = 0;
-
-  /* Free the chunk allocs. */
-  for (size_t k = 0; k < m->allocs_count; k++) {
-    swift_free("hashmap", m->allocs[k]);
-  }
-  swift_free("hashmap", m->allocs);
+  m->old_next_group = 0;
 }
 
 size_t hashmap_size(hashmap_t *m) {
@@ -419,89 +380,68 @@ size_t hashmap_size(hashmap_t *m) {
 }
 
 #if HASHMAP_DEBUG_OUTPUT
-void hashmap_count_chain_lengths(hashmap_key_t key, hashmap_value_t *value,
+void hashmap_count_probe_lengths(hashmap_key_t key, hashmap_value_t *value,
                                  void *data) {
   hashmap_t *m = (hashmap_t *)data;
   int count = 0;
-  hashmap_find(m, key, /*create_entry=*/0, &count,
+  hashmap_find(m, key, /*create_new=*/0, &count,
                /*created_new_element=*/NULL);
-  m->chain_length_counts[count] += 1;
+  if (count >= HASHMAP_MAX_PROBE_LENGTH) count = HASHMAP_MAX_PROBE_LENGTH - 1;
+  m->probe_length_counts[count] += 1;
 }
 #endif
 
 void hashmap_print_stats(hashmap_t *m) {
   /* Basic stats. */
-  message("size: %zu, table_size: %zu, nr_chunks: %zu.", m->size, m->table_size,
-          m->nr_chunks);
-
-  /* Count the number of populated chunks, graveyard chunks, and allocs. */
-  int chunk_counter = 0;
-  for (size_t k = 0; k < m->nr_chunks; k++) {
-    if (m->chunks[k]) chunk_counter += 1;
-  }
-  int graveyard_counter = 0;
-  for (hashmap_chunk_t *finger = m->graveyard; finger != NULL;
-       finger = (hashmap_chunk_t *)finger->next) {
-    graveyard_counter += 1;
-  }
-  message(
-      "populated chunks: %i (%zu kb), graveyard chunks: %i (%zu kb), allocs: "
-      "%zu",
-      chunk_counter, sizeof(hashmap_chunk_t) * chunk_counter / 1024,
-      graveyard_counter, sizeof(hashmap_chunk_t) * graveyard_counter / 1024,
-      m->allocs_count);
+  message("size: %zu, table_size: %zu, nr_groups: %zu.", m->size,
+          m->table_size, m->table.nr_groups);
+  if (m->old_table.ctrl != NULL)
+    message("old table: %zu elements left in %zu groups, %zu moved.",
+            m->old_table.size, m->old_table.nr_groups, m->old_next_group);
+
+  /* Memory used by the tables. */
+  const size_t bytes_per_slot =
+      sizeof(hashmap_element_t) + sizeof(hashmap_ctrl_t);
+  message("memory: %zu kb (current table) + %zu kb (old table)",
+          m->table_size * bytes_per_slot / 1024,
+          m->old_table.nr_groups * HASHMAP_GROUP_SIZE * bytes_per_slot / 1024);
 
   /* Print fill ratios. */
-  message("element-wise fill ratio: %.2f%%, chunk-wise fill ratio: %.2f%%",
-          (100.0 * m->size) / m->table_size,
-          (100.0 * chunk_counter) / m->nr_chunks);
+  message("element-wise fill ratio: %.2f%%",
+          (100.0 * m->table.size) / m->table_size);
 
 #if HASHMAP_DEBUG_OUTPUT
-  /* Compute the chain lengths. */
-  for (int k = 0; k < HASHMAP_MAX_CHAIN_LENGTH; k++) {
-    m->chain_length_counts[k] = 0;
+  /* Compute the probe lengths. */
+  for (int k = 0; k < HASHMAP_MAX_PROBE_LENGTH; k++) {
+    m->probe_length_counts[k] = 0;
   }
-  hashmap_iterate(m, hashmap_count_chain_lengths, m);
-  message("chain lengths:");
-  for (int k = 0; k < HASHMAP_MAX_CHAIN_LENGTH; k++) {
-    message("  chain_length_counts[%i]: %zu (%.2f%%)", k,
-            m->chain_length_counts[k],
-            (100.0 * m->chain_length_counts[k]) / m->size);
+  hashmap_iterate(m, hashmap_count_probe_lengths, m);
+  message("probe lengths (extra groups visited):");
+  for (int k = 0; k < HASHMAP_MAX_PROBE_LENGTH; k++) {
+    message("  probe_length_counts[%i]: %zu (%.2f%%)", k,
+            m->probe_length_counts[k],
+            (100.0 * m->probe_length_counts[k]) / m->size);
   }
 #endif
 
-  /* Compute chunk fill ratios. */
-  size_t chunk_fill_ratio_counts[11];
-  for (int k = 0; k < 11; k++) {
-    chunk_fill_ratio_counts[k] = 0;
+  /* Compute group fill ratios. */
+  size_t group_fill_counts[HASHMAP_GROUP_SIZE + 1];
+  for (int k = 0; k <= HASHMAP_GROUP_SIZE; k++) {
+    group_fill_counts[k] = 0;
   }
-  for (size_t k = 0; k < m->nr_chunks; k++) {
-    hashmap_chunk_t *chunk = m->chunks[k];
-    if (!chunk) {
-      chunk_fill_ratio_counts[0] += 1;
-    } else {
-      int count = 0;
-      for (int j = 0; j < HASHMAP_MASKS_PER_CHUNK; j++) {
-        count += __builtin_popcountll(chunk->masks[j]);
-      }
-      chunk_fill_ratio_counts[(int)(10 * count / HASHMAP_MAX_CHUNK_FILL_RATIO /
-                                    HASHMAP_ELEMENTS_PER_CHUNK)] += 1;
-    }
+  for (size_t k = 0; k < m->table.nr_groups; k++) {
+    const unsigned int empty = hashmap_group_match(
+        &m->table.ctrl[k * HASHMAP_GROUP_SIZE], HASHMAP_CTRL_EMPTY);
+    group_fill_counts[HASHMAP_GROUP_SIZE - __builtin_popcount(empty)] += 1;
   }
-  message("chunk fill ratios:");
-  for (int k = 0; k < 11; k++) {
-    message("  %3i%% - %3i%%: %zu (%.2f%%)",
-            (int)(k * 10 * HASHMAP_MAX_CHUNK_FILL_RATIO),
-            (int)((k + 1) * 10 * HASHMAP_MAX_CHUNK_FILL_RATIO),
-            chunk_fill_ratio_counts[k],
-            (100.0 * chunk_fill_ratio_counts[k]) / m->nr_chunks);
+  message("group fill counts:");
+  for (int k = 0; k <= HASHMAP_GROUP_SIZE; k++) {
+    message("  %2i/%i: %zu (%.2f%%)", k, HASHMAP_GROUP_SIZE,
+            group_fill_counts[k],
+            (100.0 * group_fill_counts[k]) / m->table.nr_groups);
   }
 
   /* Print struct sizes. */
   message("sizeof(hashmap_element_t): %zu", sizeof(hashmap_element_t));
-  message("sizeof(hashmap_chunk_t): %zu", sizeof(hashmap_chunk_t));
-  message("HASHMAP_TARGET_CHUNK_BYTES: %i", HASHMAP_TARGET_CHUNK_BYTES);
-  message("HASHMAP_BITS_PER_ELEMENT: %i", HASHMAP_BITS_PER_ELEMENT);
-  message("HASHMAP_ELEMENTS_PER_CHUNK: %i", HASHMAP_ELEMENTS_PER_CHUNK);
-  message("HASHMAP_MASKS_PER_CHUNK: %i", HASHMAP_MASKS_PER_CHUNK);
+  message("HASHMAP_GROUP_SIZE: %i", HASHMAP_GROUP_SIZE);
 }
@@ -25,6 +25,10 @@
  *
  * Modified by Pete Warden to fix a serious performance problem, support strings
  * as keys and removed thread synchronization - http://petewarden.typepad.com
+ *
+ * The table is now an open-addressing one in the style of Google's SwissTable:
+ * a control byte per slot holds a 7-bit tag of the hash of its key and the
+ * tags of a group of slots are compared to the one searched for at once.
  */
 #ifndef SWIFT_HASHMAP_H
 #define SWIFT_HASHMAP_H
@@ -32,11 +36,19 @@
 /* Some standard headers. */
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+// Type used for the control bytes of the slots.
+typedef uint8_t hashmap_ctrl_t;
 
-// Type used for chunk bitmasks.
-typedef size_t hashmap_mask_t;
+// Number of slots in a group, i.e. whose control bytes are probed at once.
+#define HASHMAP_GROUP_SIZE (16)
 
-#define HASHMAP_BITS_PER_MASK ((int)sizeof(hashmap_mask_t) * 8)
+// Control bytes with the high bit set mark empty slots and slots whose
+// element was moved to a new table. Full slots store the 7 lowest bits of
+// the hash of their key.
+#define HASHMAP_CTRL_EMPTY ((hashmap_ctrl_t)0x80)
+#define HASHMAP_CTRL_MOVED ((hashmap_ctrl_t)0xFE)
 
 // Type used for the hashmap keys (must have a valid '==' operation).
 #ifndef hashmap_key_t
@@ -59,50 +71,36 @@ typedef struct _hashmap_element {
   hashmap_value_t value;
 } hashmap_element_t;
 
-/* Make sure a chunk fits in a given size. */
-#define HASHMAP_TARGET_CHUNK_BYTES (4 * 1024)
-#define HASHMAP_BITS_PER_ELEMENT ((int)sizeof(hashmap_element_t) * 8 + 1)
-#define HASHMAP_ELEMENTS_PER_CHUNK \
-  ((HASHMAP_TARGET_CHUNK_BYTES * 8) / HASHMAP_BITS_PER_ELEMENT)
-#define HASHMAP_MASKS_PER_CHUNK                               \
-  ((HASHMAP_ELEMENTS_PER_CHUNK + HASHMAP_BITS_PER_MASK - 1) / \
-   HASHMAP_BITS_PER_MASK)
-
-#define HASHMAP_ALLOCS_INITIAL_SIZE (8)
-#define HASHMAP_ALLOC_SIZE_FRACTION (0.1)
-
-#define HASHMAP_MAX_CHAIN_LENGTH (HASHMAP_ELEMENTS_PER_CHUNK / 8)
+#define HASHMAP_MAX_PROBE_LENGTH (16)
 #ifndef HASHMAP_DEBUG_OUTPUT
 #define HASHMAP_DEBUG_OUTPUT (0)
 #endif  // HASHMAP_DEBUG_OUTPUT
 
-/* A chunk of hashmap_element, with the corresponding bitmask. */
-typedef struct _hashmap_chunk {
-  union {
-    hashmap_mask_t masks[HASHMAP_MASKS_PER_CHUNK];
-    void *next;
-  };
-  hashmap_element_t data[HASHMAP_ELEMENTS_PER_CHUNK];
-} hashmap_chunk_t;
+/* An open-addressing table: one control byte per slot, stored separately
+ * from the slots so that a whole group can be probed with one compare. */
+typedef struct _hashmap_table {
+  size_t nr_groups;          // Number of groups, a power of two.
+  size_t size;               // Number of elements in this table.
+  hashmap_ctrl_t *ctrl;      // Control bytes of the slots.
+  hashmap_element_t *data;   // The slots.
+} hashmap_table_t;
 
 /* A hashmap has some maximum size and current size,
  * as well as the data to hold. */
 typedef struct _hashmap {
-  size_t table_size;
-  size_t size;
-  size_t nr_chunks;
-  hashmap_chunk_t *
-      *chunks;  // Pointer to chunks in use, but not densely populated.
-  hashmap_chunk_t
-      *graveyard;  // Pointer to allocated, but currently unused chunks.
-
-  void **allocs;        // Pointers to allocated blocks of chunks.
-  size_t allocs_size;   // Size of the allocs array.
-  size_t allocs_count;  // Number of elements in the allocs array.
+  size_t table_size;  // Number of slots of the current table.
+  size_t size;        // Number of elements in the hashmap.
+
+  hashmap_table_t table;  // Table receiving the new elements.
+
+  // Previous table, whose elements are moved to the current one a few groups
+  // at a time after a growth. Its control bytes are NULL once it is empty.
+  hashmap_table_t old_table;
+  size_t old_next_group;  // Next group of the old table to move.
 
 #if HASHMAP_DEBUG_OUTPUT
-  /* Chain lengths, used for debugging only. */
-  size_t chain_length_counts[HASHMAP_MAX_CHAIN_LENGTH];
+  /* Probe lengths, used for debugging only. */
+  size_t probe_length_counts[HASHMAP_MAX_PROBE_LENGTH];
 #endif
 } hashmap_t;
 
@@ -261,6 +261,17 @@ __attribute__((always_inline)) INLINE static float hydro_get_mass(
   return p->mass;
 }
 
+/**
+ * @brief Returns the signal velocity compared by the time-step limiter
+ *
+ * @param p The particle of interest
+ */
+__attribute__((always_inline)) INLINE static float hydro_get_signal_velocity(
+    const struct part *restrict p) {
+
+  return p->viscosity.v_sig;
+}
+
 /**
  * @brief Sets the mass of a particle
  *
@@ -503,6 +514,11 @@ __attribute__((always_inline)) INLINE static void hydro_init_part(
 
   p->viscosity.div_v = 0.f;
   p->diffusion.laplace_u = 0.f;
+
+#ifdef HYDRO_FUSED_GRADIENT_LOOP
+  /* The density loop also collects the signal velocity */
+  p->viscosity.v_sig = 0.f;
+#endif
 }
 
 /**
@@ -623,6 +639,9 @@ __attribute__((always_inline)) INLINE static void hydro_reset_gradient(
  *
  * This method also initializes the force loop variables.
  *
+ * With the fused gradient loop, the gradient quantities were collected by the
+ * density loop and this is called by the ghost after hydro_prepare_gradient().
+ *
  * @param p The particle to act upon.
  */
 __attribute__((always_inline)) INLINE static void hydro_end_gradient(
@@ -634,9 +653,17 @@ __attribute__((always_inline)) INLINE static void hydro_end_gradient(
   const float h_inv_dim = pow_dimension(h_inv);       /* 1/h^d */
   const float h_inv_dim_plus_one = h_inv_dim * h_inv; /* 1/h^(d+1) */
 
+#ifdef HYDRO_FUSED_GRADIENT_LOOP
+  /* The density loop did not know the neighbours' densities: use ours */
+  p->diffusion.laplace_u *= 2.f * h_inv_dim_plus_one / p->rho;
+
+  /* Include the self-term of the signal velocity */
+  p->viscosity.v_sig = max(p->viscosity.v_sig, 2.f * p->force.soundspeed);
+#else
   /* Include the extra factors in the del^2 u */
 
   p->diffusion.laplace_u *= 2.f * h_inv_dim_plus_one;
+#endif
 }
 
 /**
@@ -1047,4 +1074,72 @@ hydro_set_init_internal_energy(struct part *p, float u_init) {
   p->u = u_init;
 }
 
+/**
+ * @brief Copies the fields of a #part read by the foreign gradient loop into
+ * a compact communication buffer.
+ *
+ * @param p The particle to pack.
+ * @param pack (output) The packed data.
+ */
+__attribute__((always_inline)) INLINE static void hydro_pack_rho(
+    const struct part *restrict p, struct rho_part_pack *restrict pack) {
+
+  pack->h = p->h;
+  pack->rho = p->rho;
+  pack->u = p->u;
+  pack->soundspeed = p->force.soundspeed;
+}
+
+/**
+ * @brief Copies the fields received in a compact rho buffer into a foreign
+ * #part.
+ *
+ * @param p The particle to update.
+ * @param pack The packed data.
+ */
+__attribute__((always_inline)) INLINE static void hydro_unpack_rho(
+    struct part *restrict p, const struct rho_part_pack *restrict pack) {
+
+  p->h = pack->h;
+  p->rho = pack->rho;
+  p->u = pack->u;
+  p->force.soundspeed = pack->soundspeed;
+}
+
+/**
+ * @brief Copies the fields of a #part read by the foreign force loop into a
+ * compact communication buffer.
+ *
+ * @param p The particle to pack.
+ * @param pack (output) The packed data.
+ */
+__attribute__((always_inline)) INLINE static void hydro_pack_gradient(
+    const struct part *restrict p, struct gradient_part_pack *restrict pack) {
+
+  pack->f = p->force.f;
+  pack->pressure = p->force.pressure;
+  pack->soundspeed = p->force.soundspeed;
+  pack->balsara = p->force.balsara;
+  pack->viscosity_alpha = p->viscosity.alpha;
+  pack->diffusion_alpha = p->diffusion.alpha;
+}
+
+/**
+ * @brief Copies the fields received in a compact gradient buffer into a
+ * foreign #part.
+ *
+ * @param p The particle to update.
+ * @param pack The packed data.
+ */
+__attribute__((always_inline)) INLINE static void hydro_unpack_gradient(
+    struct part *restrict p, const struct gradient_part_pack *restrict pack) {
+
+  p->force.f = pack->f;
+  p->force.pressure = pack->pressure;
+  p->force.soundspeed = pack->soundspeed;
+  p->force.balsara = pack->balsara;
+  p->viscosity.alpha = pack->viscosity_alpha;
+  p->diffusion.alpha = pack->diffusion_alpha;
+}
+
 #endif /* SWIFT_ANARCHY_DU_HYDRO_H */
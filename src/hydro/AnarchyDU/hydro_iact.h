@@ -28,10 +28,105 @@
  */
 
 #include "adiabatic_index.h"
+#include "equation_of_state.h"
 #include "minmax.h"
 
 #include "./hydro_parameters.h"
 
+#ifdef HYDRO_FUSED_GRADIENT_LOOP
+
+/**
+ * @brief Gradient quantities collected by the density interaction between
+ * two particles when the gradient loop is fused into the density loop.
+ *
+ * Same as #runner_iact_gradient, except that the sound speeds are obtained
+ * from the internal energies, as the force sub-structure is not available
+ * during the density loop, and that the Laplacian of u is divided by the
+ * density of the receiving particle in hydro_end_gradient() rather than by
+ * the density of its neighbours, which are not known yet.
+ *
+ * @param r2 Comoving square distance between the two particles.
+ * @param r_inv Inverse of the comoving distance between the two particles.
+ * @param dvdr Dot product of the velocity and position differences.
+ * @param wi_dx Kernel derivative for particle i.
+ * @param wj_dx Kernel derivative for particle j.
+ * @param pi First particle.
+ * @param pj Second particle.
+ * @param a Current scale factor.
+ * @param H Current Hubble parameter.
+ */
+__attribute__((always_inline)) INLINE static void runner_iact_fused_gradient(
+    const float r2, const float r_inv, const float dvdr, const float wi_dx,
+    const float wj_dx, struct part* restrict pi, struct part* restrict pj,
+    const float a, const float H) {
+
+  /* Cosmology terms for the signal velocity */
+  const float fac_mu = pow_three_gamma_minus_five_over_two(a);
+  const float a2_Hubble = a * a * H;
+
+  /* Are the particles moving towards each others ? */
+  const float dvdr_Hubble = dvdr + a2_Hubble * r2;
+  const float omega_ij = min(dvdr_Hubble, 0.f);
+  const float mu_ij = fac_mu * r_inv * omega_ij; /* This is 0 or negative */
+
+  /* Signal velocity */
+  const float ci = gas_soundspeed_from_internal_energy(pi->rho, pi->u);
+  const float cj = gas_soundspeed_from_internal_energy(pj->rho, pj->u);
+  const float new_v_sig = ci + cj - const_viscosity_beta * mu_ij;
+
+  pi->viscosity.v_sig = max(pi->viscosity.v_sig, new_v_sig);
+  pj->viscosity.v_sig = max(pj->viscosity.v_sig, new_v_sig);
+
+  /* Del^2 u for the thermal diffusion coefficient (without the 1 / rho) */
+  const float delta_u_factor = (pi->u - pj->u) * r_inv;
+  pi->diffusion.laplace_u += pj->mass * delta_u_factor * wi_dx;
+  pj->diffusion.laplace_u -= pi->mass * delta_u_factor * wj_dx;
+}
+
+/**
+ * @brief Gradient quantities collected by the density interaction between
+ * two particles when the gradient loop is fused into the density loop
+ * (non-symmetric version).
+ *
+ * @param r2 Comoving square distance between the two particles.
+ * @param r_inv Inverse of the comoving distance between the two particles.
+ * @param dvdr Dot product of the velocity and position differences.
+ * @param wi_dx Kernel derivative for particle i.
+ * @param pi First particle.
+ * @param pj Second particle (not updated).
+ * @param a Current scale factor.
+ * @param H Current Hubble parameter.
+ */
+__attribute__((always_inline)) INLINE static void
+runner_iact_nonsym_fused_gradient(const float r2, const float r_inv,
+                                  const float dvdr, const float wi_dx,
+                                  struct part* restrict pi,
+                                  const struct part* restrict pj,
+                                  const float a, const float H) {
+
+  /* Cosmology terms for the signal velocity */
+  const float fac_mu = pow_three_gamma_minus_five_over_two(a);
+  const float a2_Hubble = a * a * H;
+
+  /* Are the particles moving towards each others ? */
+  const float dvdr_Hubble = dvdr + a2_Hubble * r2;
+  const float omega_ij = min(dvdr_Hubble, 0.f);
+  const float mu_ij = fac_mu * r_inv * omega_ij; /* This is 0 or negative */
+
+  /* Signal velocity */
+  const float ci = gas_soundspeed_from_internal_energy(pi->rho, pi->u);
+  const float cj = gas_soundspeed_from_internal_energy(pj->rho, pj->u);
+  const float new_v_sig = ci + cj - const_viscosity_beta * mu_ij;
+
+  pi->viscosity.v_sig = max(pi->viscosity.v_sig, new_v_sig);
+
+  /* Del^2 u for the thermal diffusion coefficient (without the 1 / rho) */
+  const float delta_u_factor = (pi->u - pj->u) * r_inv;
+  pi->diffusion.laplace_u += pj->mass * delta_u_factor * wi_dx;
+}
+
+#endif /* HYDRO_FUSED_GRADIENT_LOOP */
+
 /**
  * @brief Density interaction between two part*icles.
  *
@@ -106,6 +201,10 @@ __attribute__((always_inline)) INLINE static void runner_iact_density(
   pj->density.rot_v[0] += facj * curlvr[0];
   pj->density.rot_v[1] += facj * curlvr[1];
   pj->density.rot_v[2] += facj * curlvr[2];
+
+#ifdef HYDRO_FUSED_GRADIENT_LOOP
+  runner_iact_fused_gradient(r2, r_inv, dvdr, wi_dx, wj_dx, pi, pj, a, H);
+#endif
 }
 
 /**
@@ -162,6 +261,10 @@ __attribute__((always_inline)) INLINE static void runner_iact_nonsym_density(
   pi->density.rot_v[0] += faci * curlvr[0];
   pi->density.rot_v[1] += faci * curlvr[1];
   pi->density.rot_v[2] += faci * curlvr[2];
+
+#ifdef HYDRO_FUSED_GRADIENT_LOOP
+  runner_iact_nonsym_fused_gradient(r2, r_inv, dvdr, wi_dx, pi, pj, a, H);
+#endif
 }
 
 /**
@@ -62,6 +62,9 @@ struct xpart {
   /* Additional data used by the tracers */
   struct tracers_xpart_data tracers_data;
 
+  /* Enrichment history (only used by the feedback) */
+  struct chemistry_xpart_data chemistry_data;
+
   /* Additional data used by the tracers */
   struct star_formation_xpart_data sf_data;
 
@@ -208,4 +211,52 @@ struct part {
 
 } SWIFT_STRUCT_ALIGN;
 
+/**
+ * @brief The fields of a #part sent by the compact rho communications.
+ *
+ * These are the quantities computed by the density ghost that the gradient
+ * loop reads from its foreign neighbours.
+ */
+struct rho_part_pack {
+
+  /*! Particle smoothing length, as converged by the ghost. */
+  float h;
+
+  /*! Particle density. */
+  float rho;
+
+  /*! Particle internal energy. */
+  float u;
+
+  /*! Particle soundspeed. */
+  float soundspeed;
+};
+
+/**
+ * @brief The fields of a #part sent by the compact gradient communications.
+ *
+ * These are the quantities computed by the extra ghost that the force loop
+ * reads from its foreign neighbours.
+ */
+struct gradient_part_pack {
+
+  /*! "Grad h" term */
+  float f;
+
+  /*! Particle pressure. */
+  float pressure;
+
+  /*! Particle soundspeed. */
+  float soundspeed;
+
+  /*! Balsara switch */
+  float balsara;
+
+  /*! Artificial viscosity parameter */
+  float viscosity_alpha;
+
+  /*! Artificial diffusion parameter */
+  float diffusion_alpha;
+};
+
 #endif /* SWIFT_ANARCHY_DU_HYDRO_PART_H */
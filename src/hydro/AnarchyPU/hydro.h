@@ -271,6 +271,17 @@ __attribute__((always_inline)) INLINE static float hydro_get_mass(
   return p->mass;
 }
 
+/**
+ * @brief Returns the signal velocity compared by the time-step limiter
+ *
+ * @param p The particle of interest
+ */
+__attribute__((always_inline)) INLINE static float hydro_get_signal_velocity(
+    const struct part *restrict p) {
+
+  return p->viscosity.v_sig;
+}
+
 /**
  * @brief Sets the mass of a particle
  *
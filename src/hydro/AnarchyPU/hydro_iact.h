@@ -31,6 +31,7 @@
 
 #include "adiabatic_index.h"
 #include "minmax.h"
+#include "vector.h"
 
 #include "./hydro_parameters.h"
 
@@ -554,6 +555,282 @@ __attribute__((always_inline)) INLINE static void runner_iact_nonsym_force(
   pi->force.h_dt -= mj * dvdr * r_inv / rhoj * wi_dr;
 }
 
+#ifdef WITH_VECTORIZATION
+
+/**
+ * @brief Density interaction computed using 1 vector
+ * (non-symmetric vectorized version).
+ */
+__attribute__((always_inline)) INLINE static void
+runner_iact_nonsym_1_vec_density(
+    vector *r2, vector *dx, vector *dy, vector *dz, vector hi_inv, vector vix,
+    vector viy, vector viz, float *Vjx, float *Vjy, float *Vjz, float *Mj,
+    float *Uj, vector *rhoSum, vector *rho_dhSum, vector *pressure_barSum,
+    vector *pressure_bar_dhSum, vector *wcountSum, vector *wcount_dhSum,
+    vector *div_vSum, vector *curlvxSum, vector *curlvySum, vector *curlvzSum,
+    mask_t mask) {
+
+  vector r, ri, xi, wi, wi_dx;
+  vector dvx, dvy, dvz;
+  vector dvdr, faci;
+  vector curlvrx, curlvry, curlvrz;
+
+  /* Fill the vectors. */
+  const vector mj = vector_load(Mj);
+  const vector uj = vector_load(Uj);
+  const vector vjx = vector_load(Vjx);
+  const vector vjy = vector_load(Vjy);
+  const vector vjz = vector_load(Vjz);
+
+  /* Get the radius and inverse radius. */
+  ri = vec_reciprocal_sqrt(*r2);
+  r.v = vec_mul(r2->v, ri.v);
+
+  xi.v = vec_mul(r.v, hi_inv.v);
+
+  /* Calculate the kernel for two particles. */
+  kernel_deval_1_vec(&xi, &wi, &wi_dx);
+
+  /* Compute dv. */
+  dvx.v = vec_sub(vix.v, vjx.v);
+  dvy.v = vec_sub(viy.v, vjy.v);
+  dvz.v = vec_sub(viz.v, vjz.v);
+
+  /* Compute dv dot r */
+  dvdr.v = vec_fma(dvx.v, dx->v, vec_fma(dvy.v, dy->v, vec_mul(dvz.v, dz->v)));
+
+  /* Compute dv cross r */
+  curlvrx.v = vec_fnma(dvz.v, dy->v, vec_mul(dvy.v, dz->v));
+  curlvry.v = vec_fnma(dvx.v, dz->v, vec_mul(dvz.v, dx->v));
+  curlvrz.v = vec_fnma(dvy.v, dx->v, vec_mul(dvx.v, dy->v));
+
+  /* Common factors of the updates */
+  vector wcount_dh_update, mjui;
+  wcount_dh_update.v =
+      vec_fma(vec_set1(hydro_dimension), wi.v, vec_mul(xi.v, wi_dx.v));
+  mjui.v = vec_mul(mj.v, uj.v);
+  faci.v = vec_mul(mj.v, vec_mul(wi_dx.v, ri.v));
+
+  /* Mask updates to intermediate vector sums for particle pi. */
+  rhoSum->v = vec_mask_add(rhoSum->v, vec_mul(mj.v, wi.v), mask);
+  rho_dhSum->v =
+      vec_mask_sub(rho_dhSum->v, vec_mul(mj.v, wcount_dh_update.v), mask);
+  pressure_barSum->v =
+      vec_mask_add(pressure_barSum->v, vec_mul(mjui.v, wi.v), mask);
+  pressure_bar_dhSum->v = vec_mask_sub(
+      pressure_bar_dhSum->v, vec_mul(mjui.v, wcount_dh_update.v), mask);
+  wcountSum->v = vec_mask_add(wcountSum->v, wi.v, mask);
+  wcount_dhSum->v = vec_mask_sub(wcount_dhSum->v, wcount_dh_update.v, mask);
+  div_vSum->v = vec_mask_sub(div_vSum->v, vec_mul(faci.v, dvdr.v), mask);
+  curlvxSum->v = vec_mask_add(curlvxSum->v, vec_mul(faci.v, curlvrx.v), mask);
+  curlvySum->v = vec_mask_add(curlvySum->v, vec_mul(faci.v, curlvry.v), mask);
+  curlvzSum->v = vec_mask_add(curlvzSum->v, vec_mul(faci.v, curlvrz.v), mask);
+}
+
+/**
+ * @brief Gradient interaction computed using 1 vector
+ * (non-symmetric vectorized version).
+ */
+__attribute__((always_inline)) INLINE static void
+runner_iact_nonsym_1_vec_gradient(
+    vector *r2, vector *dx, vector *dy, vector *dz, vector hi_inv, vector vix,
+    vector viy, vector viz, vector ui, vector ci, float *Vjx, float *Vjy,
+    float *Vjz, float *Mj, float *Uj, float *Rhoj, float *Cj, const float a,
+    const float H, vector *v_sigSum, vector *laplace_uSum, mask_t mask) {
+
+  vector r, ri, xi, wi, wi_dx;
+  vector dvx, dvy, dvz;
+  vector dvdr_Hubble, omega_ij, mu_ij, new_v_sig, delta_u;
+
+  /* Fill the vectors. */
+  const vector vjx = vector_load(Vjx);
+  const vector vjy = vector_load(Vjy);
+  const vector vjz = vector_load(Vjz);
+  const vector mj = vector_load(Mj);
+  const vector uj = vector_load(Uj);
+  const vector rhoj = vector_load(Rhoj);
+  const vector cj = vector_load(Cj);
+
+  /* Cosmology terms for the signal velocity */
+  const vector v_fac_mu = vector_set1(pow_three_gamma_minus_five_over_two(a));
+  const vector v_a2_Hubble = vector_set1(a * a * H);
+
+  /* Get the radius and inverse radius. */
+  ri = vec_reciprocal_sqrt(*r2);
+  r.v = vec_mul(r2->v, ri.v);
+
+  /* Compute dv. */
+  dvx.v = vec_sub(vix.v, vjx.v);
+  dvy.v = vec_sub(viy.v, vjy.v);
+  dvz.v = vec_sub(viz.v, vjz.v);
+
+  /* Compute dv dot r and add the Hubble flow. */
+  dvdr_Hubble.v = vec_fma(
+      dvx.v, dx->v,
+      vec_fma(dvy.v, dy->v,
+              vec_fma(dvz.v, dz->v, vec_mul(v_a2_Hubble.v, r2->v))));
+
+  /* Are the particles moving towards each others ? */
+  omega_ij.v = vec_fmin(dvdr_Hubble.v, vec_setzero());
+  mu_ij.v = vec_mul(v_fac_mu.v, vec_mul(ri.v, omega_ij.v));
+
+  /* Signal velocity */
+  new_v_sig.v =
+      vec_fnma(vec_set1(const_viscosity_beta), mu_ij.v, vec_add(ci.v, cj.v));
+
+  /* Calculate Del^2 u for the thermal diffusion coefficient. */
+  xi.v = vec_mul(r.v, hi_inv.v);
+  kernel_deval_1_vec(&xi, &wi, &wi_dx);
+  delta_u.v = vec_mul(vec_sub(ui.v, uj.v), ri.v);
+
+  /* Mask updates to intermediate vector sums for particle pi. */
+  v_sigSum->v = vec_fmax(v_sigSum->v, vec_and_mask(new_v_sig.v, mask));
+  laplace_uSum->v = vec_mask_add(
+      laplace_uSum->v,
+      vec_div(vec_mul(mj.v, vec_mul(delta_u.v, wi_dx.v)), rhoj.v), mask);
+}
+
+/**
+ * @brief Force interaction computed using 1 vector
+ * (non-symmetric vectorized version).
+ */
+__attribute__((always_inline)) INLINE static void
+runner_iact_nonsym_1_vec_force(
+    vector *r2, vector *dx, vector *dy, vector *dz, vector vix, vector viy,
+    vector viz, vector mi, vector ui, vector rhoi, vector fi,
+    vector pressure_bar_i, vector v_sig_i, vector alpha_visc_i,
+    vector alpha_diff_i, vector balsara_i, vector ci, float *Vjx, float *Vjy,
+    float *Vjz, float *Mj, float *Uj, float *Rhoj, float *Fj,
+    float *Pressure_bar_j, float *V_sig_j, float *Alpha_visc_j,
+    float *Alpha_diff_j, float *Balsara_j, float *Cj, vector hi_inv,
+    vector hj_inv, const float a, const float H, vector *a_hydro_xSum,
+    vector *a_hydro_ySum, vector *a_hydro_zSum, vector *u_dtSum,
+    vector *h_dtSum, mask_t mask) {
+
+  vector r, ri, xi, xj, hid_inv, hjd_inv, wi_dx, wj_dx, wi_dr, wj_dr;
+  vector dvx, dvy, dvz, dvdr, dvdr_Hubble, omega_ij, mu_ij;
+  vector f_ij, f_ji, uiuj, rho_ij, v_sig, alpha, balsara, visc;
+  vector kernel_sum, visc_acc_term, sph_term_i, sph_acc_term, acc;
+  vector v_diff, alpha_diff, du_dt;
+
+  /* Fill vectors. */
+  const vector vjx = vector_load(Vjx);
+  const vector vjy = vector_load(Vjy);
+  const vector vjz = vector_load(Vjz);
+  const vector mj = vector_load(Mj);
+  const vector uj = vector_load(Uj);
+  const vector rhoj = vector_load(Rhoj);
+  const vector fj = vector_load(Fj);
+  const vector pressure_bar_j = vector_load(Pressure_bar_j);
+  const vector v_sig_j = vector_load(V_sig_j);
+  const vector alpha_visc_j = vector_load(Alpha_visc_j);
+  const vector alpha_diff_j = vector_load(Alpha_diff_j);
+  const vector balsara_j = vector_load(Balsara_j);
+  const vector cj = vector_load(Cj);
+
+  /* Cosmological terms */
+  const float fac_mu = pow_three_gamma_minus_five_over_two(a);
+  const vector v_fac_mu = vector_set1(fac_mu);
+  const vector v_a2_Hubble = vector_set1(a * a * H);
+  const vector v_gamma_minus_one2 =
+      vector_set1(hydro_gamma_minus_one * hydro_gamma_minus_one);
+
+  /* Get the radius and inverse radius. */
+  ri = vec_reciprocal_sqrt(*r2);
+  r.v = vec_mul(r2->v, ri.v);
+
+  /* Compute gradient terms */
+  f_ij.v = vec_sub(vec_set1(1.f), vec_div(fi.v, vec_mul(mj.v, uj.v)));
+  f_ji.v = vec_sub(vec_set1(1.f), vec_div(fj.v, vec_mul(mi.v, ui.v)));
+
+  /* Get the kernel for hi. */
+  hid_inv = pow_dimension_plus_one_vec(hi_inv);
+  xi.v = vec_mul(r.v, hi_inv.v);
+  kernel_eval_dWdx_force_vec(&xi, &wi_dx);
+  wi_dr.v = vec_mul(hid_inv.v, wi_dx.v);
+
+  /* Get the kernel for hj. */
+  hjd_inv = pow_dimension_plus_one_vec(hj_inv);
+  xj.v = vec_mul(r.v, hj_inv.v);
+  kernel_eval_dWdx_force_vec(&xj, &wj_dx);
+  wj_dr.v = vec_mul(hjd_inv.v, wj_dx.v);
+
+  /* Compute dv. */
+  dvx.v = vec_sub(vix.v, vjx.v);
+  dvy.v = vec_sub(viy.v, vjy.v);
+  dvz.v = vec_sub(viz.v, vjz.v);
+
+  /* Compute dv dot r. */
+  dvdr.v = vec_fma(dvx.v, dx->v, vec_fma(dvy.v, dy->v, vec_mul(dvz.v, dz->v)));
+
+  /* Includes the hubble flow term; not used for du/dt */
+  dvdr_Hubble.v = vec_fma(v_a2_Hubble.v, r2->v, dvdr.v);
+
+  /* Are the particles moving towards each others ? */
+  omega_ij.v = vec_fmin(dvdr_Hubble.v, vec_setzero());
+  mu_ij.v = vec_mul(v_fac_mu.v, vec_mul(ri.v, omega_ij.v));
+
+  /* Signal velocity, viscosity and Balsara terms */
+  v_sig.v = vec_mul(vec_set1(0.5f), vec_add(v_sig_i.v, v_sig_j.v));
+  alpha.v = vec_add(alpha_visc_i.v, alpha_visc_j.v);
+  balsara.v = vec_add(balsara_i.v, balsara_j.v);
+  rho_ij.v = vec_add(rhoi.v, rhoj.v);
+
+  /* Construct the full viscosity term */
+  visc.v = vec_div(
+      vec_mul(vec_set1(-0.25f),
+              vec_mul(alpha.v, vec_mul(v_sig.v, vec_mul(mu_ij.v, balsara.v)))),
+      rho_ij.v);
+
+  /* Convolve with the kernel */
+  kernel_sum.v = vec_add(wi_dr.v, wj_dr.v);
+  visc_acc_term.v =
+      vec_mul(vec_set1(0.5f), vec_mul(visc.v, vec_mul(kernel_sum.v, ri.v)));
+
+  /* SPH acceleration term */
+  uiuj.v = vec_mul(v_gamma_minus_one2.v, vec_mul(ui.v, uj.v));
+  sph_term_i.v = vec_mul(vec_div(f_ij.v, pressure_bar_i.v), wi_dr.v);
+  sph_acc_term.v = vec_mul(
+      uiuj.v,
+      vec_mul(vec_fma(vec_div(f_ji.v, pressure_bar_j.v), wj_dr.v, sph_term_i.v),
+              ri.v));
+
+  /* Assemble the acceleration */
+  acc.v = vec_add(sph_acc_term.v, visc_acc_term.v);
+
+  /* Diffusion term */
+  v_diff.v =
+      vec_fmax(vec_add(vec_add(ci.v, cj.v), dvdr_Hubble.v), vec_setzero());
+  alpha_diff.v =
+      vec_mul(vec_set1(0.5f), vec_add(alpha_diff_i.v, alpha_diff_j.v));
+
+  /* Assemble the energy equation term: SPH, viscosity and diffusion terms */
+  du_dt.v = vec_mul(uiuj.v, vec_mul(sph_term_i.v, vec_mul(dvdr.v, ri.v)));
+  du_dt.v = vec_fma(vec_set1(0.5f), vec_mul(visc_acc_term.v, dvdr_Hubble.v),
+                    du_dt.v);
+  du_dt.v = vec_add(
+      du_dt.v,
+      vec_div(vec_mul(vec_mul(alpha_diff.v, v_fac_mu.v),
+                      vec_mul(v_diff.v, vec_mul(vec_sub(ui.v, uj.v),
+                                                kernel_sum.v))),
+              rho_ij.v));
+
+  /* Store the forces back on the particles. */
+  a_hydro_xSum->v =
+      vec_mask_sub(a_hydro_xSum->v, vec_mul(mj.v, vec_mul(acc.v, dx->v)), mask);
+  a_hydro_ySum->v =
+      vec_mask_sub(a_hydro_ySum->v, vec_mul(mj.v, vec_mul(acc.v, dy->v)), mask);
+  a_hydro_zSum->v =
+      vec_mask_sub(a_hydro_zSum->v, vec_mul(mj.v, vec_mul(acc.v, dz->v)), mask);
+  u_dtSum->v = vec_mask_add(u_dtSum->v, vec_mul(mj.v, du_dt.v), mask);
+  h_dtSum->v = vec_mask_sub(
+      h_dtSum->v,
+      vec_div(vec_mul(mj.v, vec_mul(dvdr.v, vec_mul(ri.v, wi_dr.v))), rhoj.v),
+      mask);
+}
+
+#endif /* WITH_VECTORIZATION */
+
 /**
  * @brief Timestep limiter loop
  *
@@ -240,6 +240,17 @@ __attribute__((always_inline)) INLINE static float hydro_get_mass(
   return p->mass;
 }
 
+/**
+ * @brief Returns the signal velocity compared by the time-step limiter
+ *
+ * @param p The particle of interest
+ */
+__attribute__((always_inline)) INLINE static float hydro_get_signal_velocity(
+    const struct part *restrict p) {
+
+  return p->force.v_sig;
+}
+
 /**
  * @brief Sets the mass of a particle
  *
@@ -906,4 +917,40 @@ hydro_set_init_internal_energy(struct part *p, float u_init) {
 __attribute__((always_inline)) INLINE static void hydro_remove_part(
     const struct part *p, const struct xpart *xp) {}
 
+/**
+ * @brief Copies the fields of a #part read by the foreign force loop into a
+ * compact communication buffer.
+ *
+ * @param p The particle to pack.
+ * @param pack (output) The packed data.
+ */
+__attribute__((always_inline)) INLINE static void hydro_pack_rho(
+    const struct part *restrict p, struct rho_part_pack *restrict pack) {
+
+  pack->h = p->h;
+  pack->rho = p->rho;
+  pack->balsara = p->force.balsara;
+  pack->f = p->force.f;
+  pack->P_over_rho2 = p->force.P_over_rho2;
+  pack->soundspeed = p->force.soundspeed;
+}
+
+/**
+ * @brief Copies the fields received in a compact rho buffer into a foreign
+ * #part.
+ *
+ * @param p The particle to update.
+ * @param pack The packed data.
+ */
+__attribute__((always_inline)) INLINE static void hydro_unpack_rho(
+    struct part *restrict p, const struct rho_part_pack *restrict pack) {
+
+  p->h = pack->h;
+  p->rho = pack->rho;
+  p->force.balsara = pack->balsara;
+  p->force.f = pack->f;
+  p->force.P_over_rho2 = pack->P_over_rho2;
+  p->force.soundspeed = pack->soundspeed;
+}
+
 #endif /* SWIFT_GADGET2_HYDRO_H */
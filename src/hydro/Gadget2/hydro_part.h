@@ -61,6 +61,9 @@ struct xpart {
   /* Additional data used by the tracers */
   struct tracers_xpart_data tracers_data;
 
+  /* Enrichment history (only used by the feedback) */
+  struct chemistry_xpart_data chemistry_data;
+
   /* Additional data used by the star formation */
   struct star_formation_xpart_data sf_data;
 
@@ -183,4 +186,31 @@ struct part {
 
 } SWIFT_STRUCT_ALIGN;
 
+/**
+ * @brief The fields of a #part sent by the compact rho communications.
+ *
+ * These are the quantities computed by the density ghost that the force loop
+ * reads from its foreign neighbours.
+ */
+struct rho_part_pack {
+
+  /*! Particle smoothing length, as converged by the ghost. */
+  float h;
+
+  /*! Particle density. */
+  float rho;
+
+  /*! Balsara switch */
+  float balsara;
+
+  /*! "Grad h" term */
+  float f;
+
+  /*! Pressure over density squared (including drho/dh term) */
+  float P_over_rho2;
+
+  /*! Particle sound speed. */
+  float soundspeed;
+};
+
 #endif /* SWIFT_GADGET2_HYDRO_PART_H */
@@ -67,6 +67,9 @@ struct xpart {
   /* Additional data used by the tracers */
   struct tracers_xpart_data tracers_data;
 
+  /* Enrichment history (only used by the feedback) */
+  struct chemistry_xpart_data chemistry_data;
+
   /* Additional data used by the tracers */
   struct star_formation_xpart_data sf_data;
 
@@ -191,4 +194,31 @@ struct part {
 
 } SWIFT_STRUCT_ALIGN;
 
+/**
+ * @brief The fields of a #part sent by the compact rho communications.
+ *
+ * These are the quantities computed by the density ghost that the force loop
+ * reads from its foreign neighbours.
+ */
+struct rho_part_pack {
+
+  /*! Particle smoothing length, as converged by the ghost. */
+  float h;
+
+  /*! Particle density. */
+  float rho;
+
+  /*! "Grad h" term */
+  float f;
+
+  /*! Particle pressure. */
+  float pressure;
+
+  /*! Particle soundspeed. */
+  float soundspeed;
+
+  /*! Balsara switch */
+  float balsara;
+};
+
 #endif /* SWIFT_MINIMAL_HYDRO_PART_H */
@@ -67,6 +67,9 @@ struct xpart {
   /*! Additional data used by the tracers */
   struct tracers_xpart_data tracers_data;
 
+  /*! Enrichment history (only used by the feedback) */
+  struct chemistry_xpart_data chemistry_data;
+
   /*! Additional data used by the star formation */
   struct star_formation_xpart_data sf_data;
 
@@ -164,7 +164,9 @@ __attribute__((always_inline)) INLINE static void hydro_init_part(
   p->density.wcount = 1.0f;
   p->density.wcount_dh = 0.0f;
 
-  voronoi_cell_init(&p->cell, p->x, hs->anchor, hs->side);
+  double anchor[3], side[3];
+  hydro_space_get_cell_box(hs, p->x, anchor, side);
+  voronoi_cell_init(&p->cell, p->x, anchor, side);
 
   /* Set the active flag to active. */
   p->force.active = 1;
@@ -603,6 +605,17 @@ __attribute__((always_inline)) INLINE static float hydro_get_mass(
   return p->conserved.mass;
 }
 
+/**
+ * @brief Returns the signal velocity compared by the time-step limiter
+ *
+ * @param p The particle of interest
+ */
+__attribute__((always_inline)) INLINE static float hydro_get_signal_velocity(
+    const struct part * restrict p) {
+
+  return p->timestepvars.vmax;
+}
+
 /**
  * @brief Returns the velocities drifted to the current time of a particle.
  *
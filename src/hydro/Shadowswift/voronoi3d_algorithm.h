@@ -410,6 +410,15 @@ __attribute__((always_inline)) INLINE void voronoi_initialize(
   cell->vertices[22] = anchor[1] + side[1] - cell->x[1];
   cell->vertices[23] = anchor[2] + side[2] - cell->x[2];
 
+  /* Radius of the sphere around the generator containing the box */
+  cell->max_radius2 = 0.0f;
+  for (int i = 0; i < 8; ++i) {
+    const float r2 = cell->vertices[3 * i] * cell->vertices[3 * i] +
+                     cell->vertices[3 * i + 1] * cell->vertices[3 * i + 1] +
+                     cell->vertices[3 * i + 2] * cell->vertices[3 * i + 2];
+    cell->max_radius2 = fmaxf(cell->max_radius2, r2);
+  }
+
   cell->orders[0] = 3;
   cell->orders[1] = 3;
   cell->orders[2] = 3;
@@ -818,6 +827,14 @@ __attribute__((always_inline)) INLINE void voronoi_intersect(
   dx[2] = -0.5f * odx[2];
   r2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
 
+  /* the projection of any vertex along dx is at most sqrt(max_radius2 * r2),
+     so a midplane further away than that cannot cut the cell: every vertex
+     is clearly below it and we do not need to walk the cell to know */
+  const float rtest = r2 - VORONOI3D_TOLERANCE;
+  if (rtest > 0.0f && c->max_radius2 * r2 < rtest * rtest) {
+    return;
+  }
+
   /* find an intersected edge of the cell */
   int result = voronoi_intersect_find_closest_vertex(
       c, dx, r2, &u, &up, &us, &uw, &l, &lp, &ls, &lw, &q, &qp, &qs, &qw);
@@ -860,8 +877,9 @@ __attribute__((always_inline)) INLINE void voronoi_intersect(
   int double_edge = 0;
   int i = -1, j = -1, k = -1;
 
-  /* initialize visitflags */
-  for (i = 0; i < VORONOI3D_MAXNUMVERT; ++i) {
+  /* initialize visitflags (new vertices set their own flag when they are
+     created) */
+  for (i = 0; i < c->nvert; ++i) {
     visitflags[i] = 0;
   }
 
@@ -1761,11 +1779,11 @@ __attribute__((always_inline)) INLINE void voronoi_intersect(
     }
   }
 
-  /* remove deleted vertices from all arrays */
+  /* remove deleted vertices from all arrays. All the fields of the new cell
+     we use are set below, so there is no need to initialise it */
   struct voronoi_cell new_cell;
-  /* make sure the contents of the new cell are the same as for the old cell */
-  memcpy(&new_cell, c, sizeof(struct voronoi_cell));
   int m, n;
+  float max_radius2 = 0.0f;
   for (vindex = 0; vindex < c->nvert; ++vindex) {
     j = vindex;
     /* find next edge that is not deleted */
@@ -1780,6 +1798,9 @@ __attribute__((always_inline)) INLINE void voronoi_intersect(
     new_cell.vertices[3 * vindex + 0] = c->vertices[3 * j + 0];
     new_cell.vertices[3 * vindex + 1] = c->vertices[3 * j + 1];
     new_cell.vertices[3 * vindex + 2] = c->vertices[3 * j + 2];
+    const float *vert = &new_cell.vertices[3 * vindex];
+    max_radius2 = fmaxf(max_radius2, vert[0] * vert[0] + vert[1] * vert[1] +
+                                         vert[2] * vert[2]);
 
     /* copy order */
     new_cell.orders[vindex] = c->orders[j];
@@ -1815,6 +1836,7 @@ __attribute__((always_inline)) INLINE void voronoi_intersect(
     voronoi_set_edge(c, j, 0, -1);
   }
   new_cell.nvert = vindex;
+  new_cell.max_radius2 = max_radius2;
 
   new_cell.x[0] = c->x[0];
   new_cell.x[1] = c->x[1];
@@ -41,6 +41,10 @@ struct voronoi_cell {
   /* The centroid of the cell. */
   float centroid[3];
 
+  /* Squared radius of a sphere around the generator that contains all the
+     vertices. Only an upper bound during the construction of the cell. */
+  float max_radius2;
+
   /* Number of cell vertices. */
   int nvert;
 
@@ -83,6 +87,10 @@ struct voronoi_cell {
  * @brief Copy the contents of the 3D Voronoi cell pointed to by source into the
  * 3D Voronoi cell pointed to by destination
  *
+ * The edges of the source cell must be stored contiguously, in vertex order
+ * (as they are after voronoi_intersect()), as only the edges of its vertices
+ * are copied.
+ *
  * @param source Pointer to a 3D Voronoi cell to read from.
  * @param destination Pointer to a 3D Voronoi cell to write to.
  */
@@ -102,6 +110,9 @@ __attribute__((always_inline)) INLINE void voronoi3d_cell_copy(
   destination->centroid[1] = source->centroid[1];
   destination->centroid[2] = source->centroid[2];
 
+  /* Copy the bounding radius. */
+  destination->max_radius2 = source->max_radius2;
+
   /* Copy the number of cell vertices. */
   destination->nvert = source->nvert;
 
@@ -121,21 +132,25 @@ __attribute__((always_inline)) INLINE void voronoi3d_cell_copy(
     destination->offsets[i] = source->offsets[i];
   }
 
-  /* Copy the edge information. No idea how many edges we have, so we copy
-     everything. */
-  for (int i = 0; i < VORONOI3D_MAXNUMEDGE; ++i) {
+  /* The edges are stored contiguously, so the last vertex tells us how many
+     there are. */
+  const int last = source->nvert - 1;
+  const int nedge =
+      (last >= 0) ? source->offsets[last] + source->orders[last] : 0;
+
+  /* Copy the edge information. */
+  for (int i = 0; i < nedge; ++i) {
     destination->edges[i] = source->edges[i];
   }
 
   /* Copy all additional edge information. */
-  for (int i = 0; i < VORONOI3D_MAXNUMEDGE; ++i) {
+  for (int i = 0; i < nedge; ++i) {
     destination->edgeindices[i] = source->edgeindices[i];
   }
 
   /* Copy neighbour information. Since neighbours are stored per edge, the total
-     number of neighbours in this list is larger than numngb and we copy
-     everything. */
-  for (int i = 0; i < VORONOI3D_MAXNUMEDGE; ++i) {
+     number of neighbours in this list is the number of edges. */
+  for (int i = 0; i < nedge; ++i) {
     destination->ngbs[i] = source->ngbs[i];
   }
 }
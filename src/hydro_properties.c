@@ -34,6 +34,7 @@
 #include "hydro.h"
 #include "kernel_hydro.h"
 #include "parser.h"
+#include "part.h"
 #include "units.h"
 
 #define hydro_props_default_max_iterations 30
@@ -41,6 +42,7 @@
 #define hydro_props_default_h_max FLT_MAX
 #define hydro_props_default_h_min_ratio 0.f
 #define hydro_props_default_h_tolerance 1e-4
+#define hydro_props_default_lists_max_MB 1024.f
 #define hydro_props_default_init_temp 0.f
 #define hydro_props_default_min_temp 0.f
 #define hydro_props_default_H_ionization_temperature 1e4
@@ -97,6 +99,31 @@ void hydro_props_init(struct hydro_props *p,
   if (p->max_smoothing_iterations <= 10)
     error("The number of smoothing length iterations should be > 10");
 
+  /* Do we record the candidate neighbours for the ghost iterations? */
+  p->ghost_neighbour_lists =
+      parser_get_opt_param_int(params, "SPH:ghost_neighbour_lists", 0);
+
+  /* Do we record the interacting pairs of the gradient loop? */
+  p->neighbour_lists =
+      parser_get_opt_param_int(params, "SPH:neighbour_lists", 0);
+  p->neighbour_lists_max_MB = parser_get_opt_param_float(
+      params, "SPH:neighbour_lists_max_MB", hydro_props_default_lists_max_MB);
+#ifndef EXTRA_HYDRO_LOOP
+  /* Only the schemes with a gradient loop can use them */
+  p->neighbour_lists = 0;
+#endif
+
+  /* Do we keep structure-of-arrays copies of the hot particle fields? */
+  p->soa_hot_fields = parser_get_opt_param_int(params, "SPH:soa_hot_fields", 0);
+#if !defined(WITH_VECTORIZATION) || \
+    !(defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH))
+  /* Only the vectorized loops read them */
+  p->soa_hot_fields = 0;
+#endif
+
+  /* Does the time-step limiter skip the cells nobody can wake up? */
+  p->sparse_limiter = parser_get_opt_param_int(params, "SPH:sparse_limiter", 0);
+
   /* Time integration properties */
   p->CFL_condition = parser_get_param_float(params, "SPH:CFL_condition");
   const float max_volume_change = parser_get_opt_param_float(
@@ -217,6 +244,20 @@ void hydro_props_print(const struct hydro_props *p) {
     message("Maximal iterations in ghost task set to %d (default is %d)",
             p->max_smoothing_iterations, hydro_props_default_max_iterations);
 
+  if (p->ghost_neighbour_lists)
+    message("Ghost iterations use lists of candidate neighbours.");
+
+  if (p->neighbour_lists)
+    message(
+        "Force loop re-uses the pairs of the gradient loop (max. %.1f MB).",
+        p->neighbour_lists_max_MB);
+
+  if (p->soa_hot_fields)
+    message("Vectorized loops read the particles from per-cell SoA copies.");
+
+  if (p->sparse_limiter)
+    message("Time-step limiter only visits the cells that can be woken up.");
+
   if (p->initial_temperature != hydro_props_default_init_temp)
     message("Initial gas temperature set to %f", p->initial_temperature);
 
@@ -299,6 +340,11 @@ void hydro_props_init_no_hydro(struct hydro_props *p) {
   p->h_min = 0.f;
   p->h_min_ratio = hydro_props_default_h_min_ratio;
   p->max_smoothing_iterations = hydro_props_default_max_iterations;
+  p->ghost_neighbour_lists = 0;
+  p->neighbour_lists = 0;
+  p->neighbour_lists_max_MB = hydro_props_default_lists_max_MB;
+  p->soa_hot_fields = 0;
+  p->sparse_limiter = 0;
   p->CFL_condition = 0.1;
   p->log_max_h_change = logf(powf(1.4, hydro_dimension_inv));
 
@@ -71,6 +71,21 @@ struct hydro_props {
   /*! Maximal number of iterations to converge h */
   int max_smoothing_iterations;
 
+  /*! Do the ghost iterations use lists of candidate neighbours? */
+  int ghost_neighbour_lists;
+
+  /*! Does the gradient loop record the interacting pairs for the force loop? */
+  int neighbour_lists;
+
+  /*! Maximal memory (in MB) used by these lists over all the threads */
+  float neighbour_lists_max_MB;
+
+  /*! Do the vectorized loops read the hot fields from per-cell SoA copies? */
+  int soa_hot_fields;
+
+  /*! Does the time-step limiter only visit the cells that can be woken up? */
+  int sparse_limiter;
+
   /*! Time integration properties */
   float CFL_condition;
 
@@ -0,0 +1,138 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_HYDRO_SOA_H
+#define SWIFT_HYDRO_SOA_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Local headers */
+#include "align.h"
+#include "error.h"
+#include "inline.h"
+#include "memuse.h"
+#include "part.h"
+
+/*! Number of float arrays in a #hydro_soa */
+#define hydro_soa_num_fields 8
+
+/**
+ * @brief Structure-of-arrays copy of the fields of the #part of a cell that are
+ * read by every vectorized hydro interaction.
+ *
+ * The positions are stored in single precision relative to the cell's corner,
+ * i.e. exactly as the caches of the self-interactions need them. Inhibited
+ * particles have a negative smoothing length.
+ *
+ * The copy is built when a vectorized loop first reads the cell and is then
+ * valid for all the tasks of the same loop during the same launch of the
+ * tasks, as the particles only move, get kicked or change their smoothing
+ * length in between the loops.
+ */
+struct hydro_soa {
+
+  /*! The arrays, all carved out of a single allocation */
+  float *x, *y, *z, *h, *m, *vx, *vy, *vz;
+
+  /*! Number of particles in the arrays */
+  int count;
+
+  /*! Allocated length of each array */
+  int size;
+
+  /*! Launch in which the arrays were filled */
+  int generation;
+
+  /*! Loop (#task_subtypes) for which the arrays were filled */
+  int loop;
+};
+
+/**
+ * @brief Frees the memory of a #hydro_soa.
+ *
+ * @param soa The #hydro_soa.
+ */
+__attribute__((always_inline)) INLINE static void hydro_soa_free(
+    struct hydro_soa *soa) {
+
+  if (soa->x != NULL) swift_free("hydro.soa", soa->x);
+  soa->x = soa->y = soa->z = soa->h = NULL;
+  soa->m = soa->vx = soa->vy = soa->vz = NULL;
+  soa->count = 0;
+  soa->size = 0;
+  soa->generation = -1;
+}
+
+/**
+ * @brief Fills a #hydro_soa with the current state of some particles.
+ *
+ * @param soa The #hydro_soa.
+ * @param parts The #part.
+ * @param count The number of #part.
+ * @param loc The position the positions are relative to.
+ * @param generation The current launch of the tasks.
+ * @param loop The loop the arrays are for.
+ */
+__attribute__((always_inline)) INLINE static void hydro_soa_fill(
+    struct hydro_soa *soa, const struct part *restrict parts, const int count,
+    const double loc[3], const int generation, const int loop) {
+
+  /* Make sure we have enough space, keeping every array aligned. */
+  if (soa->size < count) {
+    hydro_soa_free(soa);
+    const int align = SWIFT_CACHE_ALIGNMENT / sizeof(float);
+    const int size = ((count + align - 1) / align) * align;
+    void *mem = NULL;
+    if (swift_memalign("hydro.soa", &mem, SWIFT_CACHE_ALIGNMENT,
+                       hydro_soa_num_fields * size * sizeof(float)) != 0)
+      error("Failed to allocate the hydro SoA arrays.");
+    float *arrays = (float *)mem;
+    soa->x = arrays;
+    soa->y = arrays + size;
+    soa->z = arrays + 2 * size;
+    soa->h = arrays + 3 * size;
+    soa->m = arrays + 4 * size;
+    soa->vx = arrays + 5 * size;
+    soa->vy = arrays + 6 * size;
+    soa->vz = arrays + 7 * size;
+    soa->size = size;
+  }
+
+#if defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH)
+  for (int i = 0; i < count; i++) {
+    const struct part *p = &parts[i];
+    soa->x[i] = (float)(p->x[0] - loc[0]);
+    soa->y[i] = (float)(p->x[1] - loc[1]);
+    soa->z[i] = (float)(p->x[2] - loc[2]);
+    soa->h[i] = (p->time_bin >= time_bin_inhibited) ? -1.f : p->h;
+    soa->m[i] = p->mass;
+    soa->vx[i] = p->v[0];
+    soa->vy[i] = p->v[1];
+    soa->vz[i] = p->v[2];
+  }
+#else
+  error("The hydro SoA arrays are only used by the vectorized schemes.");
+#endif
+
+  soa->count = count;
+  soa->generation = generation;
+  soa->loop = loop;
+}
+
+#endif /* SWIFT_HYDRO_SOA_H */
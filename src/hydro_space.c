@@ -18,6 +18,9 @@
  ******************************************************************************/
 
 #include "hydro_space.h"
+#include "cell.h"
+#include "error.h"
+#include "memuse.h"
 #include "space.h"
 
 /**
@@ -45,7 +48,62 @@ __attribute__((always_inline)) INLINE void hydro_space_init(
     hs->side[1] = s->dim[1];
     hs->side[2] = s->dim[2];
   }
+  hs->walls = NULL;
+}
+
+/**
+ * @brief Build the boundary descriptors of the top-level cells.
+ *
+ * Flags the walls of the box that each top-level cell touches, so that only
+ * these cells need to take the boundaries into account when building their
+ * Voronoi cells. Called whenever the top-level grid is (re)built.
+ *
+ * @param hs #hydro_space to update.
+ * @param s #space containing the hydro space, with its new top-level grid.
+ */
+void hydro_space_init_cells(struct hydro_space *hs, const struct space *s) {
+
+  hydro_space_clean(hs);
+
+  for (int k = 0; k < 3; k++) {
+    hs->cdim[k] = s->cdim[k];
+    hs->width[k] = s->width[k];
+    hs->iwidth[k] = s->iwidth[k];
+  }
+
+  const int nr_cells = s->cdim[0] * s->cdim[1] * s->cdim[2];
+  if ((hs->walls = (char *)swift_malloc("hydro_space_walls",
+                                        nr_cells * sizeof(char))) == NULL)
+    error("Failed to allocate the walls of the top-level cells.");
+
+  for (int i = 0; i < s->cdim[0]; i++) {
+    for (int j = 0; j < s->cdim[1]; j++) {
+      for (int k = 0; k < s->cdim[2]; k++) {
+        const int ind[3] = {i, j, k};
+        char walls = 0;
+        if (!s->periodic) {
+          for (int d = 0; d < 3; d++) {
+            if (ind[d] == 0) walls |= hydro_space_wall_lower(d);
+            if (ind[d] == s->cdim[d] - 1) walls |= hydro_space_wall_upper(d);
+          }
+        }
+        hs->walls[cell_getid(s->cdim, i, j, k)] = walls;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Free the boundary descriptors of the top-level cells.
+ *
+ * @param hs #hydro_space to clean.
+ */
+void hydro_space_clean(struct hydro_space *hs) {
+  if (hs->walls != NULL) swift_free("hydro_space_walls", hs->walls);
+  hs->walls = NULL;
 }
 #else
 void hydro_space_init(struct hydro_space *hs, const struct space *s) {}
+void hydro_space_init_cells(struct hydro_space *hs, const struct space *s) {}
+void hydro_space_clean(struct hydro_space *hs) {}
 #endif
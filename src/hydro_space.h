@@ -21,8 +21,19 @@
 
 #include "../config.h"
 
+/* Some standard headers. */
+#include <stddef.h>
+
+/* Local headers. */
+#include "inline.h"
+
 struct space;
 
+/* Flags of the walls of the simulation box touched by a top-level cell, the
+ * lower and upper wall along each axis. */
+#define hydro_space_wall_lower(k) (1 << (2 * (k)))
+#define hydro_space_wall_upper(k) (1 << (2 * (k) + 1))
+
 /**
  * @brief Extra space information that is needed for some hydro schemes.
  */
@@ -33,11 +44,75 @@ struct hydro_space {
 
   /*! Side lengths of the simulation space. */
   double side[3];
+
+  /*! Number of top-level cells along each axis. */
+  int cdim[3];
+
+  /*! Width and inverse width of the top-level cells. */
+  double width[3];
+  double iwidth[3];
+
+  /*! Walls of the box touched by each top-level cell, 0 for the cells of the
+   *  interior and for all the cells of a periodic box. */
+  char *walls;
 };
+
+/**
+ * @brief Get the box used to start the Voronoi cell of a particle.
+ *
+ * The neighbours of a particle lie within one top-level cell width of it, so
+ * a complete Voronoi cell always fits within that distance and we start from
+ * it rather than from the whole simulation box. Only the cells touching a
+ * wall of a non-periodic box have their box clipped to the walls.
+ *
+ * @param hs The #hydro_space.
+ * @param x The position of the particle.
+ * @param anchor (return) The anchor of the box.
+ * @param side (return) The side lengths of the box.
+ */
+__attribute__((always_inline)) INLINE static void hydro_space_get_cell_box(
+    const struct hydro_space *hs, const double *x, double *anchor,
+    double *side) {
+
+  /* No top-level cells yet, use the whole space. */
+  if (hs->walls == NULL) {
+    for (int k = 0; k < 3; k++) {
+      anchor[k] = hs->anchor[k];
+      side[k] = hs->side[k];
+    }
+    return;
+  }
+
+  int ind[3];
+  for (int k = 0; k < 3; k++) {
+    ind[k] = (int)(x[k] * hs->iwidth[k]);
+    if (ind[k] < 0) ind[k] = 0;
+    if (ind[k] >= hs->cdim[k]) ind[k] = hs->cdim[k] - 1;
+    anchor[k] = x[k] - hs->width[k];
+    side[k] = 2. * hs->width[k];
+  }
+
+  const int walls =
+      hs->walls[(ind[0] * hs->cdim[1] + ind[1]) * hs->cdim[2] + ind[2]];
+  if (walls == 0) return;
+
+  /* Clip the box to the walls of the cell. */
+  for (int k = 0; k < 3; k++) {
+    if ((walls & hydro_space_wall_lower(k)) && anchor[k] < hs->anchor[k]) {
+      side[k] -= hs->anchor[k] - anchor[k];
+      anchor[k] = hs->anchor[k];
+    }
+    if ((walls & hydro_space_wall_upper(k)) &&
+        anchor[k] + side[k] > hs->anchor[k] + hs->side[k])
+      side[k] = hs->anchor[k] + hs->side[k] - anchor[k];
+  }
+}
 #else
 struct hydro_space {};
 #endif
 
 void hydro_space_init(struct hydro_space *hs, const struct space *s);
+void hydro_space_init_cells(struct hydro_space *hs, const struct space *s);
+void hydro_space_clean(struct hydro_space *hs);
 
 #endif /* SWIFT_HYDRO_SPACE_H */
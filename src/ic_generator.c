@@ -0,0 +1,666 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_FFTW
+#include <fftw3.h>
+#endif
+
+#ifdef WITH_MPI
+#include <mpi.h>
+#endif
+
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+#include <fftw3-mpi.h>
+#endif
+
+/* This object's header. */
+#include "ic_generator.h"
+
+/* Local includes. */
+#include "clocks.h"
+#include "cosmology.h"
+#include "error.h"
+#include "inline.h"
+#include "memuse.h"
+#include "mesh_gravity.h"
+#include "part.h"
+#include "periodic.h"
+#include "physical_constants.h"
+#include "random.h"
+
+#ifdef HAVE_FFTW
+
+/* The FFTW functions matching the precision of the library we link against */
+#ifdef MESH_SINGLE_PRECISION
+#define ic_fftw(name) fftwf_##name
+#else
+#define ic_fftw(name) fftw_##name
+#endif
+
+/**
+ * @brief The Fourier mesh used to build the displacement fields.
+ *
+ * With the MPI version of FFTW, each rank holds a slab of x-planes of an
+ * in-place transform. Otherwise, each rank holds (and transforms) the whole
+ * mesh and only uses its share of the planes.
+ */
+struct ic_mesh {
+
+  /*! Number of cells along each side */
+  int N;
+
+  /*! Number of x-planes held by this rank */
+  int local_n0;
+
+  /*! Index of the first x-plane held by this rank */
+  int local_0_start;
+
+  /*! Stride of the real array along z (includes the in-place padding) */
+  int nz_real;
+
+  /*! Real space array */
+  mesh_real *real;
+
+  /*! Fourier space array (aliases #real for in-place transforms) */
+  mesh_complex *cplx;
+
+  /*! The Fourier modes of the field the displacements derive from */
+  mesh_complex *modes;
+
+  /*! Real to complex transform */
+  mesh_plan forward_plan;
+
+  /*! Complex to real transform */
+  mesh_plan inverse_plan;
+};
+
+/**
+ * @brief Allocates the memory and the FFTW plans of an #ic_mesh.
+ *
+ * @param mesh The #ic_mesh to allocate.
+ * @param N The number of cells along each side.
+ * @param nr_threads The number of threads the transforms can use.
+ */
+static void ic_mesh_allocate(struct ic_mesh *mesh, const int N,
+                             const int nr_threads) {
+
+  const int N_half = N / 2;
+  mesh->N = N;
+
+#ifdef HAVE_THREADED_FFTW
+  /* Initialise the thread-parallel FFTW version */
+  if (N >= 64) {
+    ic_fftw(init_threads)();
+    ic_fftw(plan_with_nthreads)(nr_threads);
+  }
+#endif
+
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+
+  /* Initialise the MPI version of FFTW (after the threads) */
+  ic_fftw(mpi_init)();
+
+  /* Get the slab of x-planes this rank is responsible for */
+  ptrdiff_t local_n0, local_0_start;
+  const ptrdiff_t alloc_local = ic_fftw(mpi_local_size_3d)(
+      N, N, N_half + 1, MPI_COMM_WORLD, &local_n0, &local_0_start);
+  mesh->local_n0 = local_n0;
+  mesh->local_0_start = local_0_start;
+  mesh->nz_real = 2 * (N_half + 1);
+
+  mesh->real = ic_fftw(alloc_real)(2 * alloc_local);
+  mesh->cplx = (mesh_complex *)mesh->real;
+  mesh->modes =
+      (mesh_complex *)ic_fftw(malloc)(sizeof(mesh_complex) * alloc_local);
+  if (mesh->real == NULL || mesh->modes == NULL)
+    error("Error allocating memory for the IC generator mesh.");
+
+  mesh->forward_plan = ic_fftw(mpi_plan_dft_r2c_3d)(
+      N, N, N, mesh->real, mesh->cplx, MPI_COMM_WORLD, FFTW_ESTIMATE);
+  mesh->inverse_plan = ic_fftw(mpi_plan_dft_c2r_3d)(
+      N, N, N, mesh->cplx, mesh->real, MPI_COMM_WORLD, FFTW_ESTIMATE);
+
+#else
+
+  const size_t nr_complex = (size_t)N * N * (N_half + 1);
+  mesh->local_n0 = N;
+  mesh->local_0_start = 0;
+  mesh->nz_real = N;
+
+  mesh->real = ic_fftw(alloc_real)((size_t)N * N * N);
+  mesh->cplx =
+      (mesh_complex *)ic_fftw(malloc)(sizeof(mesh_complex) * nr_complex);
+  mesh->modes =
+      (mesh_complex *)ic_fftw(malloc)(sizeof(mesh_complex) * nr_complex);
+  if (mesh->real == NULL || mesh->cplx == NULL || mesh->modes == NULL)
+    error("Error allocating memory for the IC generator mesh.");
+
+  mesh->forward_plan = ic_fftw(plan_dft_r2c_3d)(N, N, N, mesh->real,
+                                                mesh->cplx, FFTW_ESTIMATE);
+  mesh->inverse_plan = ic_fftw(plan_dft_c2r_3d)(N, N, N, mesh->cplx,
+                                                mesh->real, FFTW_ESTIMATE);
+#endif
+}
+
+/**
+ * @brief Frees the memory and the FFTW plans of an #ic_mesh.
+ *
+ * @param mesh The #ic_mesh to free.
+ */
+static void ic_mesh_free(struct ic_mesh *mesh) {
+
+  ic_fftw(destroy_plan)(mesh->forward_plan);
+  ic_fftw(destroy_plan)(mesh->inverse_plan);
+  if ((void *)mesh->cplx != (void *)mesh->real) ic_fftw(free)(mesh->cplx);
+  ic_fftw(free)(mesh->real);
+  ic_fftw(free)(mesh->modes);
+}
+
+/**
+ * @brief Returns the signed wave number of a mesh index.
+ *
+ * @param i The index along one axis.
+ * @param N The number of cells along each side.
+ */
+__attribute__((always_inline)) INLINE static int ic_wave_number(const int i,
+                                                                const int N) {
+  return (i > N / 2) ? i - N : i;
+}
+
+/**
+ * @brief The BBKS transfer function with the Sugiyama (1995) shape parameter.
+ *
+ * @param k The wave number (in Mpc^-1).
+ * @param cosmo The current #cosmology.
+ */
+static double ic_transfer_function(const double k,
+                                   const struct cosmology *cosmo) {
+
+  const double h = cosmo->h;
+  const double Gamma =
+      cosmo->Omega_m * h *
+      exp(-cosmo->Omega_b - sqrt(2. * h) * cosmo->Omega_b / cosmo->Omega_m);
+  const double q = k / (Gamma * h);
+
+  if (q < 1e-10) return 1.;
+
+  const double a = 3.89 * q;
+  const double b = 16.1 * q;
+  const double c = 5.46 * q;
+  const double d = 6.71 * q;
+  return log(1. + 2.34 * q) / (2.34 * q) *
+         pow(1. + a + b * b + c * c * c + d * d * d * d, -0.25);
+}
+
+/**
+ * @brief The linear power spectrum at z=0, up to its normalisation.
+ *
+ * @param k The wave number (in Mpc^-1).
+ * @param gen The #ic_generator.
+ * @param cosmo The current #cosmology.
+ */
+static double ic_shape_power_spectrum(const double k,
+                                      const struct ic_generator *gen,
+                                      const struct cosmology *cosmo) {
+
+  const double T = ic_transfer_function(k, cosmo);
+  return pow(k, gen->n_s) * T * T;
+}
+
+/**
+ * @brief Computes the normalisation of the power spectrum giving the
+ * requested sigma_8.
+ *
+ * @param gen The #ic_generator.
+ * @param cosmo The current #cosmology.
+ */
+static double ic_power_spectrum_norm(const struct ic_generator *gen,
+                                     const struct cosmology *cosmo) {
+
+  const double R = 8. / cosmo->h;
+  const int n = 8192;
+  const double log_k_min = log(1e-6);
+  const double log_k_max = log(1e3);
+  const double dlog_k = (log_k_max - log_k_min) / n;
+
+  /* Trapezoidal integral of P(k) W^2(kR) k^3 / (2 pi^2) dln(k) */
+  double sigma2 = 0.;
+  for (int i = 0; i <= n; ++i) {
+    const double k = exp(log_k_min + i * dlog_k);
+    const double x = k * R;
+    const double W = 3. * (sin(x) - x * cos(x)) / (x * x * x);
+    const double w = (i == 0 || i == n) ? 0.5 : 1.;
+    sigma2 += w * ic_shape_power_spectrum(k, gen, cosmo) * W * W * k * k * k;
+  }
+  sigma2 *= dlog_k / (2. * M_PI * M_PI);
+
+  return gen->sigma_8 * gen->sigma_8 / sigma2;
+}
+
+/**
+ * @brief Draws the Fourier modes of the linear density field at z=0.
+ *
+ * Each mode is drawn from the counter-based generator keyed on its wave
+ * vector, with the conjugate modes of the kz=0 plane drawn from the same
+ * key. The field hence does not depend on the decomposition of the mesh.
+ * The Nyquist modes are set to zero.
+ *
+ * @param mesh The #ic_mesh whose modes to fill.
+ * @param gen The #ic_generator.
+ * @param cosmo The current #cosmology.
+ */
+static void ic_mesh_draw_modes(struct ic_mesh *mesh,
+                               const struct ic_generator *gen,
+                               const struct cosmology *cosmo) {
+
+  const int N = mesh->N;
+  const int N_half = N / 2;
+  const double box_size_Mpc = gen->box_size / gen->Mpc;
+  const double volume_Mpc = box_size_Mpc * box_size_Mpc * box_size_Mpc;
+  const double k_fac = 2. * M_PI / box_size_Mpc;
+  const double norm = ic_power_spectrum_norm(gen, cosmo) / volume_Mpc;
+
+  for (int i = 0; i < mesh->local_n0; ++i) {
+    const int kx = ic_wave_number(mesh->local_0_start + i, N);
+    for (int j = 0; j < N; ++j) {
+      const int ky = ic_wave_number(j, N);
+      for (int kz = 0; kz <= N_half; ++kz) {
+
+        const size_t index = ((size_t)i * N + j) * (N_half + 1) + kz;
+        mesh->modes[index][0] = 0.;
+        mesh->modes[index][1] = 0.;
+
+        if (kx == 0 && ky == 0 && kz == 0) continue;
+        if (kx == N_half || ky == N_half || kz == N_half) continue;
+
+        /* Conjugate modes of the kz=0 plane use the key of their partner */
+        int cx = kx, cy = ky;
+        double sign = 1.;
+        if (kz == 0 && (kx < 0 || (kx == 0 && ky < 0))) {
+          cx = -kx;
+          cy = -ky;
+          sign = -1.;
+        }
+        const long long key =
+            (((long long)(cx + N) % N) * N + (cy + N) % N) * (N_half + 1) +
+            kz;
+        const enum random_number_type type = random_number_initial_conditions;
+        const double u1 = random_unit_interval(2 * key, gen->seed, type);
+        const double u2 = random_unit_interval(2 * key + 1, gen->seed, type);
+
+        /* Rayleigh-distributed amplitude and uniform phase */
+        const double k = k_fac * sqrt((double)(kx * kx + ky * ky + kz * kz));
+        const double amplitude =
+            sqrt(norm * ic_shape_power_spectrum(k, gen, cosmo) * -log(1. - u1));
+        mesh->modes[index][0] = amplitude * cos(2. * M_PI * u2);
+        mesh->modes[index][1] = sign * amplitude * sin(2. * M_PI * u2);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Transforms a derivative of the potential of the modes to real space.
+ *
+ * With the modes \f$m(k)\f$ of a field, the potential is \f$-m(k)/k^2\f$.
+ * If b < 0, computes the component a of minus its gradient, otherwise
+ * computes the second derivative along a and b. The result is left in the
+ * real array of the mesh.
+ *
+ * @param mesh The #ic_mesh.
+ * @param a The first direction.
+ * @param b The second direction (or -1 for a first derivative).
+ * @param box_size The size of the box.
+ */
+static void ic_mesh_derivative(struct ic_mesh *mesh, const int a, const int b,
+                               const double box_size) {
+
+  const int N = mesh->N;
+  const int N_half = N / 2;
+  const double grad_fac = box_size / (2. * M_PI);
+
+  for (int i = 0; i < mesh->local_n0; ++i) {
+    int k[3];
+    k[0] = ic_wave_number(mesh->local_0_start + i, N);
+    for (int j = 0; j < N; ++j) {
+      k[1] = ic_wave_number(j, N);
+      for (k[2] = 0; k[2] <= N_half; ++k[2]) {
+
+        const size_t index = ((size_t)i * N + j) * (N_half + 1) + k[2];
+        const int k2 = k[0] * k[0] + k[1] * k[1] + k[2] * k[2];
+        const double re = mesh->modes[index][0];
+        const double im = mesh->modes[index][1];
+
+        if (k2 == 0) {
+          mesh->cplx[index][0] = 0.;
+          mesh->cplx[index][1] = 0.;
+        } else if (b < 0) {
+          /* i k_a m(k) / k^2 */
+          const double fac = grad_fac * k[a] / k2;
+          mesh->cplx[index][0] = -fac * im;
+          mesh->cplx[index][1] = fac * re;
+        } else {
+          /* k_a k_b m(k) / k^2 */
+          const double fac = (double)(k[a] * k[b]) / k2;
+          mesh->cplx[index][0] = fac * re;
+          mesh->cplx[index][1] = fac * im;
+        }
+      }
+    }
+  }
+
+  ic_fftw(execute)(mesh->inverse_plan);
+}
+
+/**
+ * @brief Adds the field held in the real array of the mesh to the positions
+ * and velocities of the particles.
+ *
+ * @param mesh The #ic_mesh.
+ * @param gparts The particles, one per mesh cell of the planes we own.
+ * @param first_plane The first x-plane of our particles.
+ * @param nr_planes The number of x-planes of our particles.
+ * @param c The component to update.
+ * @param fac_x The factor converting the field to a displacement.
+ * @param fac_v The factor converting the field to a velocity.
+ */
+static void ic_mesh_displace(const struct ic_mesh *mesh,
+                             struct gpart *gparts, const int first_plane,
+                             const int nr_planes, const int c,
+                             const double fac_x, const double fac_v) {
+
+  const int N = mesh->N;
+
+  for (int i = 0; i < nr_planes; ++i) {
+    const int i_mesh = first_plane + i - mesh->local_0_start;
+    for (int j = 0; j < N; ++j) {
+      for (int k = 0; k < N; ++k) {
+
+        const double field =
+            mesh->real[((size_t)i_mesh * N + j) * mesh->nz_real + k];
+        struct gpart *gp = &gparts[((size_t)i * N + j) * N + k];
+        gp->x[c] += fac_x * field;
+        gp->v_full[c] += fac_v * field;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Replaces the modes of the mesh by those of the source term of the
+ * second-order displacement field.
+ *
+ * The source is \f$ \sum_{i>j} \phi_{,ii} \phi_{,jj} - \phi_{,ij}^2 \f$ where
+ * \f$\phi\f$ is the potential of the current modes. Its modes are stored with
+ * a minus sign such that ic_mesh_derivative() returns the gradient of the
+ * second-order potential.
+ *
+ * @param mesh The #ic_mesh.
+ * @param box_size The size of the box.
+ */
+static void ic_mesh_second_order_modes(struct ic_mesh *mesh,
+                                       const double box_size) {
+
+  const int N = mesh->N;
+  const int N_half = N / 2;
+  const size_t nr_cells = (size_t)mesh->local_n0 * N * N;
+
+  double *source = (double *)malloc(nr_cells * sizeof(double));
+  double *sum = (double *)malloc(nr_cells * sizeof(double));
+  if (source == NULL || sum == NULL)
+    error("Error allocating memory for the second-order source term.");
+
+  /* Diagonal terms: xx yy + (xx + yy) zz */
+  for (int d = 0; d < 3; ++d) {
+    ic_mesh_derivative(mesh, d, d, box_size);
+    for (int i = 0; i < mesh->local_n0; ++i) {
+      for (int j = 0; j < N; ++j) {
+        for (int k = 0; k < N; ++k) {
+          const size_t index = ((size_t)i * N + j) * N + k;
+          const double phi =
+              mesh->real[((size_t)i * N + j) * mesh->nz_real + k];
+          if (d == 0) {
+            sum[index] = phi;
+            source[index] = 0.;
+          } else {
+            source[index] += sum[index] * phi;
+            sum[index] += phi;
+          }
+        }
+      }
+    }
+  }
+
+  /* Off-diagonal terms */
+  for (int d = 0; d < 3; ++d) {
+    ic_mesh_derivative(mesh, d == 2 ? 1 : 0, d == 0 ? 1 : 2, box_size);
+    for (int i = 0; i < mesh->local_n0; ++i) {
+      for (int j = 0; j < N; ++j) {
+        for (int k = 0; k < N; ++k) {
+          const size_t index = ((size_t)i * N + j) * N + k;
+          const double phi =
+              mesh->real[((size_t)i * N + j) * mesh->nz_real + k];
+          source[index] -= phi * phi;
+        }
+      }
+    }
+  }
+
+  /* Back to Fourier space */
+  for (int i = 0; i < mesh->local_n0; ++i)
+    for (int j = 0; j < N; ++j)
+      for (int k = 0; k < N; ++k)
+        mesh->real[((size_t)i * N + j) * mesh->nz_real + k] =
+            source[((size_t)i * N + j) * N + k];
+  ic_fftw(execute)(mesh->forward_plan);
+  free(source);
+  free(sum);
+
+  const double norm = -1. / ((double)N * N * N);
+  for (int i = 0; i < mesh->local_n0; ++i) {
+    const int kx = ic_wave_number(mesh->local_0_start + i, N);
+    for (int j = 0; j < N; ++j) {
+      const int ky = ic_wave_number(j, N);
+      for (int kz = 0; kz <= N_half; ++kz) {
+        const size_t index = ((size_t)i * N + j) * (N_half + 1) + kz;
+        const int nyquist = (kx == N_half || ky == N_half || kz == N_half);
+        mesh->modes[index][0] = nyquist ? 0. : norm * mesh->cplx[index][0];
+        mesh->modes[index][1] = nyquist ? 0. : norm * mesh->cplx[index][1];
+      }
+    }
+  }
+}
+
+#endif /* HAVE_FFTW */
+
+/**
+ * @brief Reads the parameters of the initial conditions generator.
+ *
+ * @param gen The #ic_generator to initialise.
+ * @param params The parsed parameter file.
+ * @param phys_const The physical constants in internal units.
+ */
+void ic_generator_init(struct ic_generator *gen, struct swift_params *params,
+                       const struct phys_const *phys_const) {
+
+  gen->N = parser_get_param_int(params, "ICGenerator:n_side");
+  gen->box_size = parser_get_param_double(params, "ICGenerator:box_size");
+  gen->seed = parser_get_opt_param_int(params, "ICGenerator:seed", 1);
+  gen->lpt_order = parser_get_opt_param_int(params, "ICGenerator:lpt_order", 2);
+  gen->sigma_8 = parser_get_param_double(params, "ICGenerator:sigma_8");
+  gen->n_s = parser_get_param_double(params, "ICGenerator:n_s");
+  gen->Mpc = 1e6 * phys_const->const_parsec;
+
+  if (gen->N < 2 || gen->N % 2 != 0)
+    error("ICGenerator:n_side must be an even number (got %d).", gen->N);
+  if (gen->lpt_order != 1 && gen->lpt_order != 2)
+    error("ICGenerator:lpt_order must be 1 or 2 (got %d).", gen->lpt_order);
+}
+
+/**
+ * @brief Prints the parameters of the initial conditions generator.
+ *
+ * @param gen The #ic_generator.
+ */
+void ic_generator_print(const struct ic_generator *gen) {
+
+  message("Generating %d^3 particles in a box of side %e with %s.", gen->N,
+          gen->box_size, gen->lpt_order == 2 ? "2LPT" : "Zel'dovich");
+  message("Power spectrum: BBKS with sigma_8=%f, n_s=%f; seed: %d.",
+          gen->sigma_8, gen->n_s, gen->seed);
+}
+
+/**
+ * @brief Generates the dark matter particles of cosmological initial
+ * conditions on this rank.
+ *
+ * Each rank creates the particles of a regular lattice lying in a slab of
+ * x-planes (the slab of the distributed FFT when it is available) and
+ * displaces them with the first- (and second-) order Lagrangian perturbation
+ * theory fields of a Gaussian random field. The velocities are the peculiar
+ * ones, i.e. in the same convention as those read from an IC file.
+ *
+ * @param gen The #ic_generator.
+ * @param cosmo The #cosmology at the start of the run.
+ * @param dim (return) The dimensions of the box.
+ * @param gparts (return) The #gpart created on this rank.
+ * @param Ngparts (return) The number of #gpart created on this rank.
+ * @param nr_threads The number of threads the transforms can use.
+ * @param verbose Are we talkative?
+ * @param dry_run If 1, only set the box size and create no particle.
+ */
+void ic_generator_generate(const struct ic_generator *gen,
+                           const struct cosmology *cosmo, double dim[3],
+                           struct gpart **gparts, size_t *Ngparts,
+                           int nr_threads, int verbose, int dry_run) {
+
+  dim[0] = dim[1] = dim[2] = gen->box_size;
+  *gparts = NULL;
+  *Ngparts = 0;
+  if (dry_run) return;
+
+#ifdef HAVE_FFTW
+
+  const int N = gen->N;
+  const double box_size = gen->box_size;
+  const double cell_size = box_size / N;
+  ticks tic = getticks();
+
+  int myrank = 0, nr_nodes = 1;
+#ifdef WITH_MPI
+  MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nr_nodes);
+#endif
+
+  struct ic_mesh mesh;
+  ic_mesh_allocate(&mesh, N, nr_threads);
+
+  /* The planes of the lattice this rank creates particles for */
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+  const int first_plane = mesh.local_0_start;
+  const int nr_planes = mesh.local_n0;
+#else
+  const int first_plane = (int)((long long)myrank * N / nr_nodes);
+  const int nr_planes =
+      (int)((long long)(myrank + 1) * N / nr_nodes) - first_plane;
+#endif
+
+  /* Growth factors and rates at the start of the run */
+  const double a = cosmo->a;
+  const double E_a = cosmo->H / cosmo->H0;
+  const double Omega_m_a = cosmo->Omega_m / (a * a * a * E_a * E_a);
+  const double eps = 1e-4;
+  const double D1 = cosmology_get_growth_factor(cosmo, a);
+  const double f1 = log(cosmology_get_growth_factor(cosmo, a * (1. + eps)) /
+                        cosmology_get_growth_factor(cosmo, a * (1. - eps))) /
+                    log((1. + eps) / (1. - eps));
+  const double D2 = -3. / 7. * D1 * D1 * pow(Omega_m_a, -1. / 143.);
+  const double f2 = 2. * pow(Omega_m_a, 6. / 11.);
+  const double aH = a * cosmo->H;
+
+  /* Create the lattice */
+  *Ngparts = (size_t)nr_planes * N * N;
+  if (swift_memalign("gparts", (void **)gparts, gpart_align,
+                     *Ngparts * sizeof(struct gpart)) != 0)
+    error("Error while allocating memory for gravity particles");
+  bzero(*gparts, *Ngparts * sizeof(struct gpart));
+
+  const float mass =
+      cosmo->Omega_m * cosmo->critical_density_0 * cell_size * cell_size *
+      cell_size;
+  for (int i = 0; i < nr_planes; ++i) {
+    for (int j = 0; j < N; ++j) {
+      for (int k = 0; k < N; ++k) {
+        const size_t index = ((size_t)i * N + j) * N + k;
+        struct gpart *gp = &(*gparts)[index];
+        gp->x[0] = (first_plane + i) * cell_size;
+        gp->x[1] = j * cell_size;
+        gp->x[2] = k * cell_size;
+        gp->mass = mass;
+        gp->type = swift_type_dark_matter;
+        gp->id_or_neg_offset =
+            (((long long)(first_plane + i) * N + j) * N + k) + 1;
+      }
+    }
+  }
+
+  /* First order */
+  ic_mesh_draw_modes(&mesh, gen, cosmo);
+  for (int c = 0; c < 3; ++c) {
+    ic_mesh_derivative(&mesh, c, -1, box_size);
+    ic_mesh_displace(&mesh, *gparts, first_plane, nr_planes, c, D1,
+                     aH * f1 * D1);
+  }
+
+  /* Second order */
+  if (gen->lpt_order == 2) {
+    ic_mesh_second_order_modes(&mesh, box_size);
+    for (int c = 0; c < 3; ++c) {
+      ic_mesh_derivative(&mesh, c, -1, box_size);
+      ic_mesh_displace(&mesh, *gparts, first_plane, nr_planes, c, D2,
+                       aH * f2 * D2);
+    }
+  }
+
+  ic_mesh_free(&mesh);
+
+  /* Bring the particles back into the box */
+  for (size_t k = 0; k < *Ngparts; ++k) {
+    struct gpart *gp = &(*gparts)[k];
+    gp->x[0] = box_wrap(gp->x[0], 0., box_size);
+    gp->x[1] = box_wrap(gp->x[1], 0., box_size);
+    gp->x[2] = box_wrap(gp->x[2], 0., box_size);
+  }
+
+  if (verbose)
+    message("Generating the initial conditions took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+#else
+  error("No FFTW library found. Cannot generate the initial conditions.");
+#endif
+}
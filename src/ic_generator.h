@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_IC_GENERATOR_H
+#define SWIFT_IC_GENERATOR_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Local headers */
+#include "parser.h"
+
+/* Avoid cyclic inclusions */
+struct gpart;
+struct phys_const;
+struct cosmology;
+
+/**
+ * @brief Parameters of the cosmological initial conditions generated at
+ * start-up in place of reading them from a file.
+ */
+struct ic_generator {
+
+  /*! Number of particles (and mesh cells) along each side of the box */
+  int N;
+
+  /*! Comoving side-length of the box (internal units) */
+  double box_size;
+
+  /*! Seed of the Gaussian random field */
+  int seed;
+
+  /*! Order of the Lagrangian perturbation theory (1 or 2) */
+  int lpt_order;
+
+  /*! Amplitude of the linear power spectrum at z=0 */
+  double sigma_8;
+
+  /*! Spectral index of the primordial power spectrum */
+  double n_s;
+
+  /*! One Mega-parsec in internal units */
+  double Mpc;
+};
+
+void ic_generator_init(struct ic_generator *gen, struct swift_params *params,
+                       const struct phys_const *phys_const);
+void ic_generator_print(const struct ic_generator *gen);
+void ic_generator_generate(const struct ic_generator *gen,
+                           const struct cosmology *cosmo, double dim[3],
+                           struct gpart **gparts, size_t *Ngparts,
+                           int nr_threads, int verbose, int dry_run);
+
+#endif /* SWIFT_IC_GENERATOR_H */
@@ -0,0 +1,227 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* This object's header. */
+#include "io_compression.h"
+
+/* Standard headers. */
+#include <stdio.h>
+#include <string.h>
+
+/* Local includes. */
+#include "error.h"
+
+/**
+ * @brief Names of the compression levels, used in the select_output.yml
+ *        parameter file.
+ **/
+const char* lossy_compression_schemes_names[compression_level_count] = {
+    "off",     "on",      "DScale1",    "DScale2",     "DScale3",
+    "DScale4", "DScale5", "DScale6",    "FMantissa9", "FMantissa13",
+    "DMantissa21"};
+
+/**
+ * @brief Returns the lossy compression scheme given its name
+ *
+ * Calls error if the name is not found in the list of filters.
+ * For backwards compatibility, "0" and "1" are synonyms of "off" and "on".
+ *
+ * @param name The name of the filter
+ *
+ * @return The #lossy_compression_schemes
+ */
+enum lossy_compression_schemes compression_scheme_from_name(const char* name) {
+
+  if (strcmp(name, "0") == 0) return compression_do_not_write;
+  if (strcmp(name, "1") == 0) return compression_write_lossless;
+
+  for (int i = 0; i < compression_level_count; ++i) {
+    if (strcmp(name, lossy_compression_schemes_names[i]) == 0)
+      return (enum lossy_compression_schemes)i;
+  }
+
+  error("Invalid lossy compression scheme name: '%s'", name);
+  return (enum lossy_compression_schemes)0;
+}
+
+/**
+ * @brief Reads how a field should be written from the output selection.
+ *
+ * The entry SelectOutput:<field>_<type> can be 0/off (field not written),
+ * 1/on or any other integer (field written with the default filter of the
+ * field) or the name of one of the lossy filters.
+ *
+ * When writing a snipshot, an entry SelectOutputSnipshot:<field>_<type>
+ * takes precedence over the one of the full snapshots.
+ *
+ * @param params The output selection parameters.
+ * @param field_name The name of the field.
+ * @param part_type_name The name of the particle type.
+ * @param default_compression The default filter of the field.
+ * @param snipshot Are we writing a snipshot?
+ */
+enum lossy_compression_schemes io_get_field_compression(
+    struct swift_params* params, const char* field_name,
+    const char* part_type_name,
+    enum lossy_compression_schemes default_compression, const int snipshot) {
+
+  char field[PARSER_MAX_LINE_SIZE];
+  char value[PARSER_MAX_LINE_SIZE];
+  sprintf(field, "SelectOutput:%s_%s", field_name, part_type_name);
+  parser_get_opt_param_string(params, field, value, "1");
+
+  /* Look for an override of the snipshots without storing a default value
+   * back in the parameters for every field */
+  if (snipshot) {
+    sprintf(field, "SelectOutputSnipshot:%s_%s", field_name, part_type_name);
+    for (int i = 0; i < params->paramCount; i++) {
+      if (strcmp(field, params->data[i].name) == 0) {
+        strcpy(value, params->data[i].value);
+        params->data[i].used = 1;
+        break;
+      }
+    }
+  }
+
+  /* Integers keep their old meaning: 0 to skip the field, anything else
+   * to write it (io_check_output_fields() warned about odd values). */
+  int flag = 0;
+  char extra[PARSER_MAX_LINE_SIZE];
+  if (sscanf(value, "%d%s", &flag, extra) == 1)
+    return (flag == 0) ? compression_do_not_write : default_compression;
+
+  /* Default values stored back in the parameters keep a leading space */
+  const char* name = value;
+  while (*name == ' ') name++;
+
+  const enum lossy_compression_schemes comp =
+      compression_scheme_from_name(name);
+  if (comp == compression_write_lossless) return default_compression;
+  return comp;
+}
+
+#if defined(HAVE_HDF5)
+
+/**
+ * @brief Build a floating-point type with a truncated mantissa for the n-bit
+ * filter.
+ *
+ * @param size The size in bytes of the stored type (4 or 8).
+ * @param e_size The number of bits of the exponent.
+ * @param m_size The number of bits of the mantissa.
+ * @param field_name The name of the field (for error messages).
+ */
+static hid_t io_compression_truncated_float(const int size, const int e_size,
+                                            const int m_size,
+                                            const char* field_name) {
+
+  const int offset = 0;
+  const int precision = m_size + e_size + 1;
+  const int m_pos = offset;
+  const int e_pos = offset + m_size;
+  const int s_pos = e_pos + e_size;
+  const int bias = (1 << (e_size - 1)) - 1;
+
+  const hid_t h_type = H5Tcopy(size == 4 ? H5T_IEEE_F32LE : H5T_IEEE_F64LE);
+  hid_t h_err = H5Tset_fields(h_type, s_pos, e_pos, e_size, m_pos, m_size);
+  if (h_err < 0) error("Error while setting type fields for '%s'.", field_name);
+  h_err = H5Tset_offset(h_type, offset);
+  if (h_err < 0) error("Error while setting type offset for '%s'.", field_name);
+  h_err = H5Tset_precision(h_type, precision);
+  if (h_err < 0)
+    error("Error while setting type precision for '%s'.", field_name);
+  h_err = H5Tset_size(h_type, size);
+  if (h_err < 0) error("Error while setting type size for '%s'.", field_name);
+  h_err = H5Tset_ebias(h_type, bias);
+  if (h_err < 0) error("Error while setting type bias for '%s'.", field_name);
+
+  return h_type;
+}
+
+/**
+ * @brief Apply the HDF5 filter corresponding to a lossy compression scheme.
+ *
+ * The D-scale filters use the HDF5 scale-offset filter: values are stored as
+ * integers with the requested number of decimal digits, relative to the
+ * minimum of each chunk. As the particles are written in cell order, this is
+ * an offset relative to the local region of the chunk. The mantissa filters
+ * store the values in a floating-point type with fewer mantissa bits and
+ * pack them with the n-bit filter.
+ *
+ * These filters must be applied before the shuffle and deflate ones.
+ *
+ * @param h_prop The properties of the dataset.
+ * @param h_type The type of the data as stored. Replaced by a new type for the
+ * mantissa filters; the caller must H5Tclose() it in all cases.
+ * @param comp The lossy compression scheme to use.
+ * @param type The #IO_DATA_TYPE of the field in memory.
+ * @param field_name The name of the field (for error messages).
+ */
+void set_hdf5_lossy_compression(hid_t* h_prop, hid_t* h_type,
+                                const enum lossy_compression_schemes comp,
+                                enum IO_DATA_TYPE type,
+                                const char* field_name) {
+
+  if (comp == compression_do_not_write || comp == compression_write_lossless)
+    return;
+
+  if (type != FLOAT && type != DOUBLE)
+    error(
+        "Lossy compression scheme '%s' can only be applied to floating-point "
+        "fields, not to '%s'.",
+        lossy_compression_schemes_names[comp], field_name);
+
+  hid_t h_err = 0;
+
+  if (comp >= compression_write_d_scale_1 &&
+      comp <= compression_write_d_scale_6) {
+
+    const int digits = comp - compression_write_d_scale_1 + 1;
+    h_err = H5Pset_scaleoffset(*h_prop, H5Z_SO_FLOAT_DSCALE, digits);
+
+  } else if (comp == compression_write_f_mantissa_9 ||
+             comp == compression_write_f_mantissa_13) {
+
+    const int m_size = (comp == compression_write_f_mantissa_9) ? 9 : 13;
+    H5Tclose(*h_type);
+    *h_type = io_compression_truncated_float(4, 8, m_size, field_name);
+    h_err = H5Pset_nbit(*h_prop);
+
+  } else if (comp == compression_write_d_mantissa_21) {
+
+    if (type != DOUBLE)
+      error("Lossy compression scheme 'DMantissa21' requires a double field.");
+
+    H5Tclose(*h_type);
+    *h_type = io_compression_truncated_float(8, 11, 21, field_name);
+    h_err = H5Pset_nbit(*h_prop);
+
+  } else {
+    error("Unknown lossy compression scheme (%d).", comp);
+  }
+
+  if (h_err < 0)
+    error("Error while setting lossy compression options for field '%s'.",
+          field_name);
+}
+
+#endif /* HAVE_HDF5 */
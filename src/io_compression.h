@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_IO_COMPRESSION_H
+#define SWIFT_IO_COMPRESSION_H
+
+/* Config parameters. */
+#include "../config.h"
+
+#if defined(HAVE_HDF5)
+#include <hdf5.h>
+#endif
+
+/* Local includes. */
+#include "common_io.h"
+#include "parser.h"
+
+/**
+ * @brief Compression levels for snapshot fields
+ */
+enum lossy_compression_schemes {
+  compression_do_not_write = 0,    /*!< Do not write that field */
+  compression_write_lossless,      /*!< Do not apply any lossy compression */
+  compression_write_d_scale_1,     /*!< D-scale compression with 1 digit */
+  compression_write_d_scale_2,     /*!< D-scale compression with 2 digits */
+  compression_write_d_scale_3,     /*!< D-scale compression with 3 digits */
+  compression_write_d_scale_4,     /*!< D-scale compression with 4 digits */
+  compression_write_d_scale_5,     /*!< D-scale compression with 5 digits */
+  compression_write_d_scale_6,     /*!< D-scale compression with 6 digits */
+  compression_write_f_mantissa_9,  /*!< Float with 9-bit mantissa */
+  compression_write_f_mantissa_13, /*!< Float with 13-bit mantissa */
+  compression_write_d_mantissa_21, /*!< Double with 21-bit mantissa */
+  /* Counter, always leave last */
+  compression_level_count,
+};
+
+/**
+ * @brief Names of the compression levels, used in the select_output.yml
+ *        parameter file.
+ **/
+extern const char* lossy_compression_schemes_names[];
+
+enum lossy_compression_schemes compression_scheme_from_name(const char* name);
+
+enum lossy_compression_schemes io_get_field_compression(
+    struct swift_params* params, const char* field_name,
+    const char* part_type_name,
+    enum lossy_compression_schemes default_compression, const int snipshot);
+
+#if defined(HAVE_HDF5)
+
+void set_hdf5_lossy_compression(hid_t* h_prop, hid_t* h_type,
+                                const enum lossy_compression_schemes comp,
+                                enum IO_DATA_TYPE type,
+                                const char* field_name);
+
+#endif /* HAVE_HDF5 */
+
+#endif /* SWIFT_IO_COMPRESSION_H */
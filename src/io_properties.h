@@ -25,6 +25,7 @@
 /* Local includes. */
 #include "common_io.h"
 #include "inline.h"
+#include "io_compression.h"
 #include "part.h"
 
 /* Standard includes. */
@@ -91,6 +92,9 @@ struct io_props {
   /* Units of the quantity */
   enum unit_conversion_factor units;
 
+  /* Lossy compression filter applied by default to the field (output only) */
+  enum lossy_compression_schemes lossy_compression;
+
   /* Pointer to the field of the first particle in the array */
   char* field;
 
@@ -165,6 +169,7 @@ INLINE static struct io_props io_make_input_field_(
     char* field, size_t partSize) {
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = importance;
@@ -217,6 +222,7 @@ INLINE static struct io_props io_make_output_field_(
     enum unit_conversion_factor units, char* field, size_t partSize) {
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -274,6 +280,7 @@ INLINE static struct io_props io_make_output_field_convert_part_INT(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -320,6 +327,7 @@ INLINE static struct io_props io_make_output_field_convert_part_FLOAT(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -371,6 +379,7 @@ INLINE static struct io_props io_make_output_field_convert_part_DOUBLE(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -422,6 +431,7 @@ INLINE static struct io_props io_make_output_field_convert_part_LONGLONG(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -479,6 +489,7 @@ INLINE static struct io_props io_make_output_field_convert_gpart_FLOAT(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -528,6 +539,7 @@ INLINE static struct io_props io_make_output_field_convert_gpart_DOUBLE(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -577,6 +589,7 @@ INLINE static struct io_props io_make_output_field_convert_gpart_LONGLONG(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -634,6 +647,7 @@ INLINE static struct io_props io_make_output_field_convert_spart_FLOAT(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -683,6 +697,7 @@ INLINE static struct io_props io_make_output_field_convert_spart_DOUBLE(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -732,6 +747,7 @@ INLINE static struct io_props io_make_output_field_convert_spart_LONGLONG(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -789,6 +805,7 @@ INLINE static struct io_props io_make_output_field_convert_bpart_FLOAT(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -837,6 +854,7 @@ INLINE static struct io_props io_make_output_field_convert_bpart_DOUBLE(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -885,6 +903,7 @@ INLINE static struct io_props io_make_output_field_convert_bpart_LONGLONG(
 
   struct io_props r;
   strcpy(r.name, name);
+  r.lossy_compression = compression_write_lossless;
   r.type = type;
   r.dimension = dimension;
   r.importance = UNUSED;
@@ -25,6 +25,7 @@
 /* Includes. */
 #include "inline.h"
 #include "minmax.h"
+#include "vector.h"
 
 #ifdef GADGET2_SOFTENING_CORRECTION
 /*! Conversion factor between Plummer softening and internal softening */
@@ -98,7 +99,104 @@ __attribute__((always_inline)) INLINE static void kernel_grav_force_eval(
 #endif
 }
 
-#ifdef SWIFT_GRAVITY_FORCE_CHECKS
+#ifdef WITH_VECTORIZATION
+
+/**
+ * @brief Computes the gravity softening function for potential (vector
+ * version).
+ *
+ * This functions assumes 0 <= u < 1.
+ *
+ * @param u The ratio of the distance to the softening length $u = x/h$.
+ * @param W (return) The value of the kernel function $W(x,h)$.
+ */
+__attribute__((always_inline)) INLINE static void kernel_grav_pot_eval_vec(
+    const vector *u, vector *W) {
+
+#ifdef GADGET2_SOFTENING_CORRECTION
+
+  const vector u2 = (vector)(vec_mul(u->v, u->v));
+
+  /* Avoid dividing by zero in the lanes using the inner branch */
+  const vector u_out = (vector)(vec_fmax(u->v, vec_set1(0.5f)));
+
+  /* u < 0.5 */
+  vector w_in;
+  w_in.v = vec_fma(u->v, vec_set1(6.4f), vec_set1(-9.6f));
+  w_in.v = vec_fma(u2.v, w_in.v, vec_set1(5.333333333333f));
+  w_in.v = vec_fma(u2.v, w_in.v, vec_set1(-2.8f));
+
+  /* u >= 0.5 */
+  vector w_out;
+  w_out.v = vec_fma(u->v, vec_set1(-2.133333333333f), vec_set1(9.6f));
+  w_out.v = vec_fma(u->v, w_out.v, vec_set1(-16.f));
+  w_out.v = vec_fma(u->v, w_out.v, vec_set1(10.666666666667f));
+  w_out.v = vec_fma(u2.v, w_out.v, vec_set1(-3.2f));
+  w_out.v = vec_fma(vec_set1(0.066666666667f), vec_reciprocal(u_out).v,
+                    w_out.v);
+
+  mask_t mask_out;
+  vec_create_mask(mask_out, vec_cmp_gte(u->v, vec_set1(0.5f)));
+  W->v = vec_blend(mask_out, w_in.v, w_out.v);
+#else
+
+  /* W(u) = 3u^7 - 15u^6 + 28u^5 - 21u^4 + 7u^2 - 3 */
+  W->v = vec_fma(vec_set1(3.f), u->v, vec_set1(-15.f));
+  W->v = vec_fma(W->v, u->v, vec_set1(28.f));
+  W->v = vec_fma(W->v, u->v, vec_set1(-21.f));
+  W->v = vec_mul(W->v, u->v);
+  W->v = vec_fma(W->v, u->v, vec_set1(7.f));
+  W->v = vec_mul(W->v, u->v);
+  W->v = vec_fma(W->v, u->v, vec_set1(-3.f));
+#endif
+}
+
+/**
+ * @brief Computes the gravity softening function for forces (vector version).
+ *
+ * This functions assumes 0 <= u < 1.
+ *
+ * @param u The ratio of the distance to the softening length $u = x/h$.
+ * @param W (return) The value of the kernel function $W(x,h)$.
+ */
+__attribute__((always_inline)) INLINE static void kernel_grav_force_eval_vec(
+    const vector *u, vector *W) {
+
+#ifdef GADGET2_SOFTENING_CORRECTION
+
+  const vector u2 = (vector)(vec_mul(u->v, u->v));
+
+  /* Avoid dividing by zero in the lanes using the inner branch */
+  const vector u_out = (vector)(vec_fmax(u->v, vec_set1(0.5f)));
+  const vector u_out3 = (vector)(vec_mul(u_out.v, vec_mul(u_out.v, u_out.v)));
+
+  /* u < 0.5 */
+  vector w_in;
+  w_in.v = vec_fma(u->v, vec_set1(32.f), vec_set1(-38.4f));
+  w_in.v = vec_fma(u2.v, w_in.v, vec_set1(10.6666667f));
+
+  /* u >= 0.5 */
+  vector w_out;
+  w_out.v = vec_fma(u->v, vec_set1(-10.6666667f), vec_set1(38.4f));
+  w_out.v = vec_fma(u->v, w_out.v, vec_set1(-48.f));
+  w_out.v = vec_fma(u->v, w_out.v, vec_set1(21.3333333f));
+  w_out.v = vec_fnma(vec_set1(0.06666667f), vec_reciprocal(u_out3).v, w_out.v);
+
+  mask_t mask_out;
+  vec_create_mask(mask_out, vec_cmp_gte(u->v, vec_set1(0.5f)));
+  W->v = vec_blend(mask_out, w_in.v, w_out.v);
+#else
+
+  /* W(u) = 21u^5 - 90u^4 + 140u^3 - 84u^2 + 14 */
+  W->v = vec_fma(vec_set1(21.f), u->v, vec_set1(-90.f));
+  W->v = vec_fma(W->v, u->v, vec_set1(140.f));
+  W->v = vec_fma(W->v, u->v, vec_set1(-84.f));
+  W->v = vec_mul(W->v, u->v);
+  W->v = vec_fma(W->v, u->v, vec_set1(14.f));
+#endif
+}
+
+#endif /* WITH_VECTORIZATION */
 
 /**
  * @brief Computes the gravity softening function for potential in double
@@ -160,7 +258,6 @@ __attribute__((always_inline)) INLINE static void kernel_grav_eval_force_double(
   *W = *W * u + 14.;
 #endif
 }
-#endif /* SWIFT_GRAVITY_FORCE_CHECKS */
 
 #undef GADGET2_SOFTENING_CORRECTION
 
@@ -23,6 +23,50 @@
 
 #include "kernel_hydro.h"
 
+#ifdef KERNEL_TABULATED
+
+/* The kernel table, see kernel_deval(). */
+float kernel_table[2 * (kernel_table_size + 2)];
+
+/**
+ * @brief Fills the kernel table from the polynomial.
+ *
+ * The polynomial is evaluated in double precision as the high-degree kernels
+ * lose several digits to cancellations near the edge of their support in
+ * single precision.
+ *
+ * Runs when the program is loaded so that the kernel functions can be used
+ * straight away, including by the unit tests.
+ */
+__attribute__((constructor)) static void hydro_kernel_table_init(void) {
+
+  for (int i = 0; i < kernel_table_size; i++) {
+    const double x = (double)i / (double)kernel_table_size;
+    const int ind = (int)(x * kernel_ivals);
+    const float *const coeffs = &kernel_coeffs[ind * (kernel_degree + 1)];
+
+    /* Horner's scheme for the kernel and its derivative */
+    double w = coeffs[0], dw_dx = 0.;
+    for (int k = 1; k <= kernel_degree; k++) {
+      dw_dx = dw_dx * x + w;
+      w = w * x + coeffs[k];
+    }
+
+    kernel_table[2 * i] =
+        (float)(max(w, 0.) * kernel_constant * kernel_gamma_inv_dim);
+    kernel_table[2 * i + 1] = (float)(min(dw_dx, 0.) * kernel_constant *
+                                      kernel_gamma_inv_dim_plus_one);
+  }
+
+  /* The kernel vanishes at and beyond the edge of its support */
+  for (int i = kernel_table_size; i < kernel_table_size + 2; i++) {
+    kernel_table[2 * i] = 0.f;
+    kernel_table[2 * i + 1] = 0.f;
+  }
+}
+
+#endif
+
 /**
  * @brief Test the SPH kernel function by dumping it in the interval [0,1].
  *
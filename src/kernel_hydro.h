@@ -240,10 +240,22 @@ static const float kernel_coeffs[(kernel_degree + 1) * (kernel_ivals + 1)]
 /* Kernel normalisation constant (volume term) */
 #define kernel_norm ((float)(hydro_dimension_unit_sphere * kernel_gamma_dim))
 
+#ifdef KERNEL_TABULATED
+
+/* Number of intervals of the kernel table. A multiple of kernel_ivals so that
+ * the joins of the piecewise kernels fall on nodes of the table. */
+#define kernel_table_size (kernel_ivals * 1024)
+
+/* Interleaved W and dW/dx tabulated on [0, H], with an extra zero node past
+ * the end. */
+extern float kernel_table[2 * (kernel_table_size + 2)];
+
+#endif
+
 /* ------------------------------------------------------------------------- */
 
 /**
- * @brief Computes the kernel function and its derivative.
+ * @brief Computes the kernel function and its derivative from the polynomial.
  *
  * The kernel function needs to be mutliplied by \f$h^{-d}\f$ and the gradient
  * by \f$h^{-(d+1)}\f$, where \f$d\f$ is the dimensionality of the problem.
@@ -254,7 +266,7 @@ static const float kernel_coeffs[(kernel_degree + 1) * (kernel_ivals + 1)]
  * @param W (return) The value of the kernel function \f$W(x,h)\f$.
  * @param dW_dx (return) The norm of the gradient of \f$|\nabla W(x,h)|\f$.
  */
-__attribute__((always_inline)) INLINE static void kernel_deval(
+__attribute__((always_inline)) INLINE static void kernel_deval_poly(
     float u, float *restrict W, float *restrict dW_dx) {
 
   /* Go to the range [0,1[ from [0,H[ */
@@ -283,6 +295,55 @@ __attribute__((always_inline)) INLINE static void kernel_deval(
   *dW_dx = dw_dx * kernel_constant * kernel_gamma_inv_dim_plus_one;
 }
 
+#ifdef KERNEL_TABULATED
+/**
+ * @brief Finds the node of the kernel table to the left of a given distance.
+ *
+ * Distances beyond the kernel support land on the last (zero) interval.
+ *
+ * @param u The ratio of the distance to the smoothing length \f$u = x/h\f$.
+ * @param t (return) The position of u between the node and the next one.
+ * @return The index of the node.
+ */
+__attribute__((always_inline)) INLINE static int kernel_table_node(
+    float u, float *restrict t) {
+
+  const float x = min(u * kernel_gamma_inv, 1.f);
+  const float f = x * (float)kernel_table_size;
+  const int i = (int)f;
+  *t = f - (float)i;
+  return i;
+}
+#endif
+
+/**
+ * @brief Computes the kernel function and its derivative.
+ *
+ * The kernel function needs to be mutliplied by \f$h^{-d}\f$ and the gradient
+ * by \f$h^{-(d+1)}\f$, where \f$d\f$ is the dimensionality of the problem.
+ *
+ * Interpolates in the kernel table if the code was configured with
+ * --enable-tabulated-kernel and evaluates the polynomial otherwise.
+ *
+ * @param u The ratio of the distance to the smoothing length \f$u = x/h\f$.
+ * @param W (return) The value of the kernel function \f$W(x,h)\f$.
+ * @param dW_dx (return) The norm of the gradient of \f$|\nabla W(x,h)|\f$.
+ */
+__attribute__((always_inline)) INLINE static void kernel_deval(
+    float u, float *restrict W, float *restrict dW_dx) {
+
+#ifdef KERNEL_TABULATED
+  float t;
+  const int i = kernel_table_node(u, &t);
+  const float *const node = &kernel_table[2 * i];
+
+  *W = node[0] + t * (node[2] - node[0]);
+  *dW_dx = node[1] + t * (node[3] - node[1]);
+#else
+  kernel_deval_poly(u, W, dW_dx);
+#endif
+}
+
 /**
  * @brief Computes the kernel function.
  *
@@ -297,6 +358,14 @@ __attribute__((always_inline)) INLINE static void kernel_deval(
 __attribute__((always_inline)) INLINE static void kernel_eval(
     float u, float *restrict W) {
 
+#ifdef KERNEL_TABULATED
+  float t;
+  const int i = kernel_table_node(u, &t);
+  const float *const node = &kernel_table[2 * i];
+
+  *W = node[0] + t * (node[2] - node[0]);
+#else
+
   /* Go to the range [0,1[ from [0,H[ */
   const float x = u * kernel_gamma_inv;
 
@@ -315,6 +384,7 @@ __attribute__((always_inline)) INLINE static void kernel_eval(
 
   /* Return everything */
   *W = w * kernel_constant * kernel_gamma_inv_dim;
+#endif
 }
 
 /**
@@ -331,6 +401,14 @@ __attribute__((always_inline)) INLINE static void kernel_eval(
 __attribute__((always_inline)) INLINE static void kernel_eval_dWdx(
     float u, float *restrict dW_dx) {
 
+#ifdef KERNEL_TABULATED
+  float t;
+  const int i = kernel_table_node(u, &t);
+  const float *const node = &kernel_table[2 * i];
+
+  *dW_dx = node[1] + t * (node[3] - node[1]);
+#else
+
   /* Go to the range [0,1[ from [0,H[ */
   const float x = u * kernel_gamma_inv;
 
@@ -351,6 +429,7 @@ __attribute__((always_inline)) INLINE static void kernel_eval_dWdx(
 
   /* Return everything */
   *dW_dx = dw_dx * kernel_constant * kernel_gamma_inv_dim_plus_one;
+#endif
 }
 
   /* -------------------------------------------------------------------------
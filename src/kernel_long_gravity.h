@@ -26,6 +26,7 @@
 #include "approx_math.h"
 #include "const.h"
 #include "inline.h"
+#include "vector.h"
 
 /* Standard headers */
 #include <float.h>
@@ -208,6 +209,89 @@ __attribute__((always_inline)) INLINE static void kernel_long_grav_force_eval(
 #endif
 }
 
+#ifdef WITH_VECTORIZATION
+
+/**
+ * @brief Computes the long-range correction term for the potential
+ * calculation coming from FFT (vector version).
+ *
+ * @param u The ratio of the distance to the FFT cell scale \f$u = r/r_s\f$.
+ * @param W (return) The value of the kernel function.
+ */
+__attribute__((always_inline)) INLINE static void
+kernel_long_grav_pot_eval_vec(const vector *u, vector *W) {
+
+#ifdef GADGET2_LONG_RANGE_CORRECTION
+
+  vector arg1;
+  arg1.v = vec_mul(u->v, vec_set1(0.5f));
+
+  *W = approx_erfcf_vec(arg1);
+#else
+
+  /* With y = exp(-2u), we want 2 - 2 exp(x) * alpha = 2y / (1 + y) */
+  vector x;
+  x.v = vec_mul(u->v, vec_set1(-2.f));
+  const vector y = approx_expf_neg_vec(x);
+
+  vector one_plus_y;
+  one_plus_y.v = vec_add(y.v, vec_set1(1.f));
+  const vector alpha = vec_reciprocal(one_plus_y);
+
+  W->v = vec_mul(vec_set1(2.f), vec_mul(y.v, alpha.v));
+#endif
+}
+
+/**
+ * @brief Computes the long-range correction term for the force calculation
+ * coming from FFT (vector version).
+ *
+ * The exponential is evaluated with approx_expf_neg_vec(), which is accurate
+ * to better than the erfc() approximation over the range of distances
+ * reached by the truncated P-P interactions.
+ *
+ * @param u The ratio of the distance to the FFT cell scale \f$u = r/r_s\f$.
+ * @param W (return) The value of the kernel function.
+ */
+__attribute__((always_inline)) INLINE static void
+kernel_long_grav_force_eval_vec(const vector *u, vector *W) {
+
+#ifdef GADGET2_LONG_RANGE_CORRECTION
+
+  const float one_over_sqrt_pi = ((float)(M_2_SQRTPI * 0.5));
+
+  vector arg1, arg2;
+  arg1.v = vec_mul(u->v, vec_set1(0.5f));
+  arg2.v = vec_mul(vec_set1(-1.f), vec_mul(arg1.v, arg1.v));
+
+  const vector term1 = approx_erfcf_vec(arg1);
+  const vector exp_arg2 = approx_expf_neg_vec(arg2);
+
+  W->v = vec_fma(vec_mul(u->v, vec_set1(one_over_sqrt_pi)), exp_arg2.v,
+                 term1.v);
+#else
+
+  /* With y = exp(-x) and x = 2u, we want
+   * 2*(x*alpha - x*alpha^2 - exp(x)*alpha + 1) = 2*(x*y/(1+y)^2 + y/(1+y)) */
+  vector x, minus_x;
+  x.v = vec_mul(u->v, vec_set1(2.f));
+  minus_x.v = vec_mul(u->v, vec_set1(-2.f));
+  const vector y = approx_expf_neg_vec(minus_x);
+
+  vector one_plus_y;
+  one_plus_y.v = vec_add(y.v, vec_set1(1.f));
+  const vector alpha = vec_reciprocal(one_plus_y);
+
+  vector y_alpha;
+  y_alpha.v = vec_mul(y.v, alpha.v);
+
+  W->v = vec_fma(vec_mul(x.v, y_alpha.v), alpha.v, y_alpha.v);
+  W->v = vec_mul(W->v, vec_set1(2.f));
+#endif
+}
+
+#endif /* WITH_VECTORIZATION */
+
 /**
  * @brief Returns the long-range truncation of the Poisson potential in Fourier
  * space.
@@ -0,0 +1,635 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* This object's header. */
+#include "lightcone.h"
+
+/* Local headers. */
+#include "active.h"
+#include "cosmology.h"
+#include "engine.h"
+#include "error.h"
+#include "hydro.h"
+#include "memuse.h"
+#include "part.h"
+#include "physical_constants.h"
+#include "restart.h"
+
+/*! Number of records collected on the stack before being added to the
+ * buffer of the rank */
+#define lightcone_batch_size 256
+
+/**
+ * @brief Builds the name of the lightcone file of this rank.
+ *
+ * @param props The #lightcone_props.
+ * @param fileName (return) The name of the file.
+ * @param len The size of fileName.
+ */
+static void lightcone_file_name(const struct lightcone_props *props,
+                                char *fileName, size_t len) {
+  snprintf(fileName, len, "%s_%04d.dat", props->basename, props->rank);
+}
+
+/**
+ * @brief Lists the periodic replications of the box that intersect the
+ * sphere of radius max_distance around the observer.
+ *
+ * @param props The #lightcone_props.
+ * @param dim The size of the box.
+ * @param periodic Is the box periodic? If not, only the box itself is used.
+ */
+static void lightcone_make_replications(struct lightcone_props *props,
+                                        const double dim[3],
+                                        const int periodic) {
+
+  const double r2_max = props->max_distance * props->max_distance;
+
+  int n[3] = {0, 0, 0};
+  for (int k = 0; k < 3 && periodic; k++) {
+    if (props->max_distance > 100. * dim[k])
+      error("Lightcone:max_distance spans more than 100 copies of the box.");
+    n[k] = (int)ceil(props->max_distance / dim[k]) + 1;
+  }
+
+  const size_t max_count =
+      (size_t)(2 * n[0] + 1) * (2 * n[1] + 1) * (2 * n[2] + 1);
+  props->replications = (double(*)[3])malloc(max_count * sizeof(double[3]));
+  if (props->replications == NULL)
+    error("Failed to allocate the lightcone replications.");
+
+  props->nr_replications = 0;
+  for (int i = -n[0]; i <= n[0]; i++) {
+    for (int j = -n[1]; j <= n[1]; j++) {
+      for (int k = -n[2]; k <= n[2]; k++) {
+
+        const double shift[3] = {i * dim[0], j * dim[1], k * dim[2]};
+
+        /* Distance from the observer to this copy of the box, allowing for
+         * the particles that drifted out of it since the last rebuild */
+        double r2 = 0.;
+        for (int l = 0; l < 3; l++) {
+          const double margin = 0.1 * dim[l];
+          const double lo = shift[l] - margin - props->observer[l];
+          const double hi = shift[l] + dim[l] + margin - props->observer[l];
+          if (lo > 0.)
+            r2 += lo * lo;
+          else if (hi < 0.)
+            r2 += hi * hi;
+        }
+
+        if (r2 <= r2_max) {
+          for (int l = 0; l < 3; l++)
+            props->replications[props->nr_replications][l] = shift[l];
+          props->nr_replications++;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Initialises the lightcone from the parameter file.
+ *
+ * @param props The #lightcone_props to initialise.
+ * @param params The parsed parameter file.
+ * @param phys_const The physical constants in internal units.
+ * @param dim The size of the simulation box.
+ * @param periodic Is the simulation box periodic?
+ * @param rank The rank of this node.
+ */
+void lightcone_init(struct lightcone_props *props, struct swift_params *params,
+                    const struct phys_const *phys_const, const double dim[3],
+                    int periodic, int rank) {
+
+  bzero(props, sizeof(struct lightcone_props));
+
+  props->enabled = parser_get_opt_param_int(params, "Lightcone:enabled", 0);
+  if (!props->enabled) return;
+
+  parser_get_param_double_array(params, "Lightcone:observer_position", 3,
+                                props->observer);
+  props->max_distance =
+      parser_get_param_double(params, "Lightcone:max_distance");
+  parser_get_opt_param_string(params, "Lightcone:basename", props->basename,
+                              "lightcone");
+  const int buffer_size =
+      parser_get_opt_param_int(params, "Lightcone:buffer_size", 1000000);
+  if (buffer_size <= 0) error("Lightcone:buffer_size must be positive.");
+  if (props->max_distance <= 0.)
+    error("Lightcone:max_distance must be positive.");
+
+  props->speed_light_c = phys_const->const_speed_light_c;
+  props->rank = rank;
+  props->buffer_size = buffer_size;
+  props->buffer_count = 0;
+  props->nr_written = 0;
+  props->file = NULL;
+
+  lightcone_make_replications(props, dim, periodic);
+
+  props->buffer = (struct lightcone_particle *)swift_malloc(
+      "lightcone", props->buffer_size * sizeof(struct lightcone_particle));
+  if (props->buffer == NULL) error("Failed to allocate the lightcone buffer.");
+
+  if (lock_init(&props->lock) != 0) error("Failed to init lightcone lock.");
+
+  if (rank == 0)
+    message(
+        "Lightcone of radius %e around [%e, %e, %e] using %d replications of "
+        "the box.",
+        props->max_distance, props->observer[0], props->observer[1],
+        props->observer[2], props->nr_replications);
+}
+
+/**
+ * @brief Comoving distance from the observer of the light cone at a given
+ * time.
+ *
+ * The observer sits at the end of the run. In cosmological runs this is
+ * \f$ c \int dt / a \f$ from the time of interest to the end.
+ *
+ * @param props The #lightcone_props.
+ * @param e The #engine.
+ * @param ti The integer time of interest.
+ */
+static double lightcone_radius(const struct lightcone_props *props,
+                               const struct engine *e, integertime_t ti) {
+
+  if (e->policy & engine_policy_cosmology)
+    return props->speed_light_c *
+           cosmology_get_grav_kick_factor(e->cosmology, ti, max_nr_timesteps);
+  else
+    return props->speed_light_c * (max_nr_timesteps - ti) * e->time_base;
+}
+
+/**
+ * @brief Scale-factor (or time in non-cosmological runs) corresponding to a
+ * position on the time-line.
+ *
+ * @param e The #engine.
+ * @param ti The (interpolated) integer time.
+ */
+static double lightcone_time(const struct engine *e, double ti) {
+
+  if (e->policy & engine_policy_cosmology)
+    return e->cosmology->a_begin * exp(ti * e->cosmology->time_base);
+  else
+    return e->time_begin + ti * e->time_base;
+}
+
+/**
+ * @brief Writes the buffer to the file of this rank. The lock must be held.
+ *
+ * @param props The #lightcone_props.
+ */
+static void lightcone_write_buffer(struct lightcone_props *props) {
+
+  if (props->buffer_count == 0) return;
+
+  /* Create the file on the first write */
+  if (props->file == NULL) {
+    char fileName[PARSER_MAX_LINE_SIZE + 16];
+    lightcone_file_name(props, fileName, sizeof(fileName));
+    props->file = fopen(fileName, "w");
+    if (props->file == NULL)
+      error("Failed to open lightcone file '%s'.", fileName);
+
+    struct lightcone_file_header header;
+    bzero(&header, sizeof(struct lightcone_file_header));
+    strcpy(header.magic, "SWIFTLC");
+    header.record_size = sizeof(struct lightcone_particle);
+    header.rank = props->rank;
+    for (int k = 0; k < 3; k++) header.observer[k] = props->observer[k];
+    header.max_distance = props->max_distance;
+    if (fwrite(&header, sizeof(struct lightcone_file_header), 1,
+               props->file) != 1)
+      error("Failed to write the header of lightcone file '%s'.", fileName);
+  }
+
+  if (fwrite(props->buffer, sizeof(struct lightcone_particle),
+             props->buffer_count, props->file) != props->buffer_count)
+    error("Failed to write %zu records to the lightcone file.",
+          props->buffer_count);
+
+  props->nr_written += props->buffer_count;
+  props->buffer_count = 0;
+}
+
+/**
+ * @brief Adds a batch of records to the buffer, writing the buffer out
+ * whenever it is full.
+ *
+ * @param props The #lightcone_props.
+ * @param batch The records.
+ * @param count The number of records.
+ */
+static void lightcone_append(struct lightcone_props *props,
+                             const struct lightcone_particle *batch,
+                             size_t count) {
+
+  if (count == 0) return;
+
+  if (lock_lock(&props->lock) != 0) error("Failed to lock the lightcone.");
+
+  while (count > 0) {
+    const size_t room = props->buffer_size - props->buffer_count;
+    const size_t n = count < room ? count : room;
+    memcpy(props->buffer + props->buffer_count, batch,
+           n * sizeof(struct lightcone_particle));
+    props->buffer_count += n;
+    batch += n;
+    count -= n;
+
+    if (props->buffer_count == props->buffer_size)
+      lightcone_write_buffer(props);
+  }
+
+  if (lock_unlock(&props->lock) != 0) error("Failed to unlock the lightcone.");
+}
+
+/**
+ * @brief Can any particle of a box cross the light cone in a given copy of
+ * the simulation volume?
+ *
+ * A crossing requires a particle inside the sphere of radius r_old at the
+ * start of the drift and outside the sphere of radius r_new at its end.
+ *
+ * @param props The #lightcone_props.
+ * @param shift The shift of the copy of the volume.
+ * @param box_min The lower corner of the box containing the particles.
+ * @param box_max The upper corner of the box containing the particles.
+ * @param r_old The radius of the light cone at the start of the drift.
+ * @param r_new The radius of the light cone at the end of the drift.
+ */
+static int lightcone_box_may_cross(const struct lightcone_props *props,
+                                   const double shift[3],
+                                   const double box_min[3],
+                                   const double box_max[3], double r_old,
+                                   double r_new) {
+
+  double d2_min = 0., d2_max = 0.;
+  for (int k = 0; k < 3; k++) {
+    const double lo = box_min[k] + shift[k] - props->observer[k];
+    const double hi = box_max[k] + shift[k] - props->observer[k];
+    if (lo > 0.)
+      d2_min += lo * lo;
+    else if (hi < 0.)
+      d2_min += hi * hi;
+    const double far = fabs(lo) > fabs(hi) ? fabs(lo) : fabs(hi);
+    d2_max += far * far;
+  }
+
+  return d2_min <= r_old * r_old && d2_max >= r_new * r_new;
+}
+
+/**
+ * @brief Checks whether a particle crossed the light cone during its drift
+ * and fills a record if so.
+ *
+ * @param props The #lightcone_props.
+ * @param x_old The position at the start of the drift.
+ * @param x_new The position at the end of the drift.
+ * @param shift The shift of the copy of the volume.
+ * @param r_old The radius of the light cone at the start of the drift.
+ * @param r_new The radius of the light cone at the end of the drift.
+ * @param rec (return) The record to fill.
+ * @param frac (return) The fraction of the drift at which it crossed.
+ *
+ * @return 1 if the particle crossed within the maximal distance, 0 otherwise.
+ */
+static int lightcone_particle_crossed(const struct lightcone_props *props,
+                                      const double x_old[3],
+                                      const double x_new[3],
+                                      const double shift[3], double r_old,
+                                      double r_new,
+                                      struct lightcone_particle *rec,
+                                      double *frac) {
+
+  double d2_old = 0., d2_new = 0.;
+  for (int k = 0; k < 3; k++) {
+    const double dx_old = x_old[k] + shift[k] - props->observer[k];
+    const double dx_new = x_new[k] + shift[k] - props->observer[k];
+    d2_old += dx_old * dx_old;
+    d2_new += dx_new * dx_new;
+  }
+
+  /* Inside the sphere at the start and outside at the end? */
+  const double f_old = sqrt(d2_old) - r_old;
+  const double f_new = sqrt(d2_new) - r_new;
+  if (!(f_old < 0. && f_new >= 0.)) return 0;
+
+  /* Interpolate to the crossing */
+  *frac = f_old / (f_old - f_new);
+  const double r_cross = r_old + *frac * (r_new - r_old);
+  if (r_cross > props->max_distance) return 0;
+
+  for (int k = 0; k < 3; k++)
+    rec->x[k] = x_old[k] + *frac * (x_new[k] - x_old[k]) + shift[k];
+  return 1;
+}
+
+/**
+ * @brief Records the #gpart of a cell that crossed the light cone while
+ * being drifted from ti_old to ti_current.
+ *
+ * Called on the leaf cells once their particles have been drifted. The
+ * position at the start of the drift is recovered from the velocity.
+ *
+ * @param props The #lightcone_props.
+ * @param e The #engine.
+ * @param gparts The drifted particles.
+ * @param count The number of particles.
+ * @param dt_drift The drift factor used for the positions.
+ * @param ti_old The integer time at the start of the drift.
+ * @param ti_current The integer time at the end of the drift.
+ */
+void lightcone_check_gparts(struct lightcone_props *props,
+                            const struct engine *e, const struct gpart *gparts,
+                            size_t count, double dt_drift,
+                            integertime_t ti_old, integertime_t ti_current) {
+
+  const double r_old = lightcone_radius(props, e, ti_old);
+  const double r_new = lightcone_radius(props, e, ti_current);
+
+  /* Is the light cone still beyond the region we record? */
+  if (r_new > props->max_distance) return;
+
+  /* Box containing the particles at both ends of the drift */
+  double box_min[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL};
+  double box_max[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+  for (size_t i = 0; i < count; i++) {
+    const struct gpart *gp = &gparts[i];
+    if (gpart_is_inhibited(gp, e)) continue;
+    for (int k = 0; k < 3; k++) {
+      const double x_old = gp->x[k] - gp->v_full[k] * dt_drift;
+      box_min[k] = fmin(box_min[k], fmin(x_old, gp->x[k]));
+      box_max[k] = fmax(box_max[k], fmax(x_old, gp->x[k]));
+    }
+  }
+
+  struct lightcone_particle batch[lightcone_batch_size];
+  size_t nr_batch = 0;
+
+  for (int r = 0; r < props->nr_replications; r++) {
+
+    const double *shift = props->replications[r];
+    if (!lightcone_box_may_cross(props, shift, box_min, box_max, r_old, r_new))
+      continue;
+
+    for (size_t i = 0; i < count; i++) {
+      const struct gpart *gp = &gparts[i];
+      if (gpart_is_inhibited(gp, e)) continue;
+
+      double x_old[3];
+      for (int k = 0; k < 3; k++)
+        x_old[k] = gp->x[k] - gp->v_full[k] * dt_drift;
+
+      struct lightcone_particle *rec = &batch[nr_batch];
+      double frac;
+      if (!lightcone_particle_crossed(props, x_old, gp->x, shift, r_old, r_new,
+                                      rec, &frac))
+        continue;
+
+      /* Get the ID from the baryonic counterpart if any */
+      const long long offset = gp->id_or_neg_offset;
+      switch (gp->type) {
+        case swift_type_gas:
+          rec->id = e->s->parts[-offset].id;
+          break;
+        case swift_type_stars:
+          rec->id = e->s->sparts[-offset].id;
+          break;
+        case swift_type_black_hole:
+          rec->id = e->s->bparts[-offset].id;
+          break;
+        default:
+          rec->id = offset;
+      }
+      rec->a = lightcone_time(e, ti_old + frac * (ti_current - ti_old));
+      for (int k = 0; k < 3; k++) rec->v[k] = gp->v_full[k];
+      rec->mass = gp->mass;
+      rec->type = gp->type;
+      rec->padding = 0;
+
+      if (++nr_batch == lightcone_batch_size) {
+        lightcone_append(props, batch, nr_batch);
+        nr_batch = 0;
+      }
+    }
+  }
+
+  lightcone_append(props, batch, nr_batch);
+}
+
+/**
+ * @brief Records the #part of a cell that crossed the light cone while being
+ * drifted from ti_old to ti_current.
+ *
+ * Only the particles without a #gpart are considered; the others are
+ * recorded with their #gpart.
+ *
+ * @param props The #lightcone_props.
+ * @param e The #engine.
+ * @param parts The drifted particles.
+ * @param xparts The extended data of the drifted particles.
+ * @param count The number of particles.
+ * @param dt_drift The drift factor used for the positions.
+ * @param ti_old The integer time at the start of the drift.
+ * @param ti_current The integer time at the end of the drift.
+ */
+void lightcone_check_parts(struct lightcone_props *props,
+                           const struct engine *e, const struct part *parts,
+                           const struct xpart *xparts, size_t count,
+                           double dt_drift, integertime_t ti_old,
+                           integertime_t ti_current) {
+
+  const double r_old = lightcone_radius(props, e, ti_old);
+  const double r_new = lightcone_radius(props, e, ti_current);
+
+  /* Is the light cone still beyond the region we record? */
+  if (r_new > props->max_distance) return;
+
+  /* Box containing the particles at both ends of the drift */
+  double box_min[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL};
+  double box_max[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+  for (size_t i = 0; i < count; i++) {
+    const struct part *p = &parts[i];
+    if (p->gpart != NULL || part_is_inhibited(p, e)) continue;
+    for (int k = 0; k < 3; k++) {
+      const double x_old = p->x[k] - xparts[i].v_full[k] * dt_drift;
+      box_min[k] = fmin(box_min[k], fmin(x_old, p->x[k]));
+      box_max[k] = fmax(box_max[k], fmax(x_old, p->x[k]));
+    }
+  }
+
+  struct lightcone_particle batch[lightcone_batch_size];
+  size_t nr_batch = 0;
+
+  for (int r = 0; r < props->nr_replications; r++) {
+
+    const double *shift = props->replications[r];
+    if (!lightcone_box_may_cross(props, shift, box_min, box_max, r_old, r_new))
+      continue;
+
+    for (size_t i = 0; i < count; i++) {
+      const struct part *p = &parts[i];
+      const struct xpart *xp = &xparts[i];
+      if (p->gpart != NULL || part_is_inhibited(p, e)) continue;
+
+      double x_old[3];
+      for (int k = 0; k < 3; k++) x_old[k] = p->x[k] - xp->v_full[k] * dt_drift;
+
+      struct lightcone_particle *rec = &batch[nr_batch];
+      double frac;
+      if (!lightcone_particle_crossed(props, x_old, p->x, shift, r_old, r_new,
+                                      rec, &frac))
+        continue;
+
+      rec->id = p->id;
+      rec->a = lightcone_time(e, ti_old + frac * (ti_current - ti_old));
+      for (int k = 0; k < 3; k++) rec->v[k] = xp->v_full[k];
+      rec->mass = hydro_get_mass(p);
+      rec->type = swift_type_gas;
+      rec->padding = 0;
+
+      if (++nr_batch == lightcone_batch_size) {
+        lightcone_append(props, batch, nr_batch);
+        nr_batch = 0;
+      }
+    }
+  }
+
+  lightcone_append(props, batch, nr_batch);
+}
+
+/**
+ * @brief Writes the records still in the buffer to the file.
+ *
+ * @param props The #lightcone_props.
+ */
+void lightcone_flush(struct lightcone_props *props) {
+
+  if (!props->enabled) return;
+
+  if (lock_lock(&props->lock) != 0) error("Failed to lock the lightcone.");
+  lightcone_write_buffer(props);
+  if (props->file != NULL) fflush(props->file);
+  if (lock_unlock(&props->lock) != 0) error("Failed to unlock the lightcone.");
+}
+
+/**
+ * @brief Flushes the lightcone and releases its resources.
+ *
+ * @param props The #lightcone_props.
+ */
+void lightcone_clean(struct lightcone_props *props) {
+
+  if (!props->enabled) return;
+
+  lightcone_flush(props);
+  if (props->file != NULL) fclose(props->file);
+  props->file = NULL;
+  swift_free("lightcone", props->buffer);
+  free(props->replications);
+  if (lock_destroy(&props->lock) != 0)
+    error("Failed to destroy lightcone lock");
+}
+
+/**
+ * @brief Write a lightcone struct to the given FILE as a stream of bytes.
+ *
+ * The buffer is flushed first such that the file matches the restart.
+ *
+ * @param props The #lightcone_props.
+ * @param stream The stream.
+ */
+void lightcone_struct_dump(struct lightcone_props *props, FILE *stream) {
+
+  lightcone_flush(props);
+
+  struct lightcone_props temp = *props;
+  temp.replications = NULL;
+  temp.buffer = NULL;
+  temp.buffer_count = 0;
+  temp.file = NULL;
+  restart_write_blocks((void *)&temp, sizeof(struct lightcone_props), 1,
+                       stream, "lightcone_props", "lightcone_props");
+
+  if (props->enabled)
+    restart_write_blocks((void *)props->replications, sizeof(double[3]),
+                         props->nr_replications, stream,
+                         "lightcone_replications", "lightcone_replications");
+}
+
+/**
+ * @brief Restore a lightcone struct from the given FILE as a stream of bytes.
+ *
+ * The file of this rank is truncated to the records written before the
+ * restart was dumped.
+ *
+ * @param props The #lightcone_props.
+ * @param stream The stream.
+ */
+void lightcone_struct_restore(struct lightcone_props *props, FILE *stream) {
+
+  restart_read_blocks((void *)props, sizeof(struct lightcone_props), 1, stream,
+                      NULL, "lightcone_props");
+  if (!props->enabled) return;
+
+  props->replications =
+      (double(*)[3])malloc(props->nr_replications * sizeof(double[3]));
+  if (props->replications == NULL)
+    error("Failed to allocate the lightcone replications.");
+  restart_read_blocks((void *)props->replications, sizeof(double[3]),
+                      props->nr_replications, stream, NULL,
+                      "lightcone_replications");
+
+  props->buffer = (struct lightcone_particle *)swift_malloc(
+      "lightcone", props->buffer_size * sizeof(struct lightcone_particle));
+  if (props->buffer == NULL) error("Failed to allocate the lightcone buffer.");
+  props->buffer_count = 0;
+  if (lock_init(&props->lock) != 0) error("Failed to init lightcone lock.");
+
+  /* Re-open the file and drop what was written after the restart dump */
+  props->file = NULL;
+  if (props->nr_written > 0) {
+    char fileName[PARSER_MAX_LINE_SIZE + 16];
+    lightcone_file_name(props, fileName, sizeof(fileName));
+    props->file = fopen(fileName, "r+");
+    if (props->file == NULL)
+      error("Failed to re-open lightcone file '%s'.", fileName);
+
+    const off_t size = sizeof(struct lightcone_file_header) +
+                       props->nr_written * sizeof(struct lightcone_particle);
+    if (ftruncate(fileno(props->file), size) != 0)
+      error("Failed to truncate lightcone file '%s'.", fileName);
+    if (fseeko(props->file, size, SEEK_SET) != 0)
+      error("Failed to seek in lightcone file '%s'.", fileName);
+  }
+}
@@ -0,0 +1,157 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_LIGHTCONE_H
+#define SWIFT_LIGHTCONE_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Standard headers */
+#include <stdio.h>
+
+/* Local headers */
+#include "lock.h"
+#include "parser.h"
+#include "timeline.h"
+
+/* Avoid cyclic inclusions */
+struct engine;
+struct gpart;
+struct part;
+struct xpart;
+struct phys_const;
+
+/**
+ * @brief Record of a particle crossing the past light cone of the observer.
+ *
+ * This is the layout of the records of the lightcone files.
+ */
+struct lightcone_particle {
+
+  /*! ID of the particle */
+  long long id;
+
+  /*! Position at the crossing, in the frame of the periodic replications */
+  double x[3];
+
+  /*! Scale-factor (or time in non-cosmological runs) of the crossing */
+  double a;
+
+  /*! Velocity (internal velocity variable of the code) */
+  float v[3];
+
+  /*! Mass */
+  float mass;
+
+  /*! Type of the particle (#part_type) */
+  int type;
+
+  /*! Unused, keeps the records 8-byte aligned */
+  int padding;
+};
+
+/**
+ * @brief Header at the start of every lightcone file.
+ */
+struct lightcone_file_header {
+
+  /*! Always "SWIFTLC" */
+  char magic[8];
+
+  /*! Size in bytes of the #lightcone_particle records that follow */
+  int record_size;
+
+  /*! Rank that wrote this file */
+  int rank;
+
+  /*! Position of the observer */
+  double observer[3];
+
+  /*! Maximal comoving distance of the records from the observer */
+  double max_distance;
+};
+
+/**
+ * @brief Properties of the lightcone built on the fly during the drifts.
+ */
+struct lightcone_props {
+
+  /*! Are we building a lightcone? */
+  int enabled;
+
+  /*! Position of the observer (internal units) */
+  double observer[3];
+
+  /*! Maximal comoving distance of the lightcone from the observer */
+  double max_distance;
+
+  /*! Speed of light (internal units) */
+  double speed_light_c;
+
+  /*! Base name of the per-rank lightcone files */
+  char basename[PARSER_MAX_LINE_SIZE];
+
+  /*! Rank writing the particles of this lightcone */
+  int rank;
+
+  /*! Shifts of the periodic replications of the box intersecting the cone */
+  double (*replications)[3];
+
+  /*! Number of replications */
+  int nr_replications;
+
+  /*! Buffer of records waiting to be written */
+  struct lightcone_particle *buffer;
+
+  /*! Number of records the buffer can hold */
+  size_t buffer_size;
+
+  /*! Number of records currently in the buffer */
+  size_t buffer_count;
+
+  /*! Number of records written to the file so far */
+  long long nr_written;
+
+  /*! The file of this rank (opened on the first write) */
+  FILE *file;
+
+  /*! Lock protecting the buffer and the file */
+  swift_lock_type lock;
+};
+
+void lightcone_init(struct lightcone_props *props, struct swift_params *params,
+                    const struct phys_const *phys_const, const double dim[3],
+                    int periodic, int rank);
+void lightcone_check_gparts(struct lightcone_props *props,
+                            const struct engine *e, const struct gpart *gparts,
+                            size_t count, double dt_drift,
+                            integertime_t ti_old, integertime_t ti_current);
+void lightcone_check_parts(struct lightcone_props *props,
+                           const struct engine *e, const struct part *parts,
+                           const struct xpart *xparts, size_t count,
+                           double dt_drift, integertime_t ti_old,
+                           integertime_t ti_current);
+void lightcone_flush(struct lightcone_props *props);
+void lightcone_clean(struct lightcone_props *props);
+
+/* Dump/restore. */
+void lightcone_struct_dump(struct lightcone_props *props, FILE *stream);
+void lightcone_struct_restore(struct lightcone_props *props, FILE *stream);
+
+#endif /* SWIFT_LIGHTCONE_H */
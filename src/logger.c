@@ -41,28 +41,6 @@
 #include "part.h"
 #include "units.h"
 
-/*
- * Thoses are definitions from the format and therefore should not be changed!
- */
-/* number of bytes for a mask */
-// TODO change this to number of bits
-#define logger_mask_size 1
-
-/* number of bits for chunk header */
-#define logger_header_bytes 8
-
-/* number bytes for an offset */
-#define logger_offset_size logger_header_bytes - logger_mask_size
-
-/* number of bytes for the version information */
-#define logger_version_size 20
-
-/* number of bytes for the labels in the header */
-#define logger_label_size 20
-
-/* number of bytes for the number in the header */
-#define logger_number_size 4
-
 char logger_version[logger_version_size] = "0.1";
 
 const struct mask_data logger_mask_data[logger_count_mask] = {
@@ -188,11 +166,16 @@ void logger_log_all(struct logger *log, const struct engine *e) {
       logger_mask_data[logger_consts].mask;
 
   /* loop over all parts */
+  int *ind = (int *)malloc(e->total_nr_parts * sizeof(int));
+  if (ind == NULL && e->total_nr_parts > 0)
+    error("Failed to allocate the list of particles to log.");
   for (long long i = 0; i < e->total_nr_parts; i++) {
-    logger_log_part(log, &s->parts[i], mask,
-                    &s->xparts[i].logger_data.last_offset);
+    ind[i] = i;
     s->xparts[i].logger_data.steps_since_last_output = 0;
   }
+  logger_log_parts(log, s->parts, s->xparts, ind, e->total_nr_parts, mask,
+                   e->time);
+  free(ind);
 
   /* loop over all gparts */
   if (e->total_nr_gparts > 0) error("Not implemented");
@@ -202,30 +185,42 @@ void logger_log_all(struct logger *log, const struct engine *e) {
 }
 
 /**
- * @brief Dump a #part to the log.
+ * @brief Reserve the space for a batch of chunks in the dump.
+ *
+ * All the chunks of the batch use the same mask and are contiguous in the
+ * dump. The chunk number i starts at offset + i * logger_compute_chunk_size().
+ * Reserving many chunks at once avoids contention on the counter of the
+ * #dump when many threads are logging particles at the same time.
  *
  * @param log The #logger
- * @param p The #part to dump.
- * @param mask The mask of the data to dump.
- * @param offset Pointer to the offset of the previous log of this particle;
- * (return) offset of this log.
+ * @param mask The mask of the data to dump in each chunk.
+ * @param count The number of chunks to reserve.
+ * @param offset (return) The offset of the first chunk in the dump.
+ *
+ * @return A pointer to the reserved memory.
  */
-void logger_log_part(struct logger *log, const struct part *p,
-                     unsigned int mask, size_t *offset) {
+char *logger_reserve_chunks(struct logger *log, unsigned int mask,
+                            size_t count, size_t *offset) {
 
   /* Make sure we're not writing a timestamp. */
   if (mask & logger_mask_data[logger_timestamp].mask)
     error("You should not log particles as timestamps.");
 
-  /* Start by computing the size of the message. */
   const int size = logger_compute_chunk_size(mask);
+  return (char *)dump_get(&log->dump, count * size, offset);
+}
 
-  /* Allocate a chunk of memory in the dump of the right size. */
-  size_t offset_new;
-  char *buff = (char *)dump_get(&log->dump, size, &offset_new);
-
-  /* Write the header. */
-  buff = logger_write_chunk_header(buff, &mask, offset, offset_new);
+/**
+ * @brief Write the fields of a #part selected by a mask.
+ *
+ * @param p The #part to dump.
+ * @param mask The mask of the data to dump.
+ * @param buff The writing buffer.
+ *
+ * @return updated buff
+ */
+static char *logger_copy_part_fields(const struct part *p, unsigned int mask,
+                                     char *buff) {
 
   /* Particle position as three doubles. */
   if (mask & logger_mask_data[logger_x].mask) {
@@ -276,37 +271,238 @@ void logger_log_part(struct logger *log, const struct part *p,
 
 #endif
 
+  return buff;
+}
+
+/**
+ * @brief Write the chunk of a #part in memory already reserved in the dump.
+ *
+ * @param p The #part to dump.
+ * @param mask The mask of the data to dump.
+ * @param offset Pointer to the offset of the previous log of this particle;
+ * (return) offset of this log.
+ * @param offset_new The offset of this chunk in the dump.
+ * @param buff The memory reserved for this chunk.
+ *
+ * @return The end of the chunk in the buffer.
+ */
+char *logger_copy_part(const struct part *p, unsigned int mask, size_t *offset,
+                       const size_t offset_new, char *buff) {
+
+  /* Write the header. */
+  buff = logger_write_chunk_header(buff, &mask, offset, offset_new);
+
+  /* And the data. */
+  buff = logger_copy_part_fields(p, mask, buff);
+
   /* Update the log message offset. */
   *offset = offset_new;
+
+  return buff;
 }
 
 /**
- * @brief Dump a #gpart to the log.
+ * @brief Write the data of a #part in a delta-encoded chunk.
+ *
+ * The data starts with the type of the record. Full records then store the
+ * fields as in the raw format. Delta records store the positions and
+ * velocities as quantised differences with the previous record of the
+ * particle, drifted to the current time, written as variable-length
+ * integers; the other fields are kept raw. A full record is written every
+ * keyframe_interval records so that the readers never have to decode more
+ * than that many records to reconstruct one.
+ *
+ * @param log The #logger.
+ * @param p The #part to dump.
+ * @param data The #logger_part_data of the particle.
+ * @param mask The mask of the data to dump.
+ * @param time The current time (or scale-factor).
+ * @param buff The writing buffer, after the chunk header.
+ *
+ * @return The end of the chunk in the buffer.
+ */
+static char *logger_encode_part(const struct logger *log,
+                                const struct part *p,
+                                struct logger_part_data *data,
+                                unsigned int mask, double time, char *buff) {
+
+  const unsigned int mask_xv =
+      logger_mask_data[logger_x].mask | logger_mask_data[logger_v].mask;
+  const int with_xv = (mask & mask_xv) == mask_xv;
+
+  /* Can we write a delta? */
+  int delta = with_xv && data->records_since_full >= 0 &&
+              data->records_since_full < log->keyframe_interval;
+
+  long long qx[3] = {0}, qv[3] = {0};
+  double x_new[3];
+  float v_new[3];
+  if (delta) {
+    const double dt = time - data->time_ref;
+    for (int k = 0; k < 3; k++) {
+      const double pred =
+          logger_predict_position(data->x_ref[k], data->v_ref[k], dt);
+      const double dx = (p->x[k] - pred) / log->position_tolerance;
+      const double dv = (p->v[k] - data->v_ref[k]) / log->velocity_tolerance;
+
+      /* Too far from the prediction, start again from a full record */
+      if (fabs(dx) > 1e18 || fabs(dv) > 1e18) {
+        delta = 0;
+        break;
+      }
+
+      qx[k] = llround(dx);
+      qv[k] = llround(dv);
+      x_new[k] = pred + qx[k] * log->position_tolerance;
+      v_new[k] = (float)(data->v_ref[k] + qv[k] * log->velocity_tolerance);
+    }
+  }
+
+  if (delta) {
+    *buff++ = logger_record_delta;
+    for (int k = 0; k < 3; k++) buff = logger_write_varint(buff, qx[k]);
+    for (int k = 0; k < 3; k++) buff = logger_write_varint(buff, qv[k]);
+    buff = logger_copy_part_fields(p, mask & ~mask_xv, buff);
+
+    /* The next delta is relative to what the readers will decode */
+    for (int k = 0; k < 3; k++) {
+      data->x_ref[k] = x_new[k];
+      data->v_ref[k] = v_new[k];
+    }
+    data->records_since_full++;
+  } else {
+    *buff++ = logger_record_full;
+    buff = logger_copy_part_fields(p, mask, buff);
+
+    if (with_xv) {
+      for (int k = 0; k < 3; k++) {
+        data->x_ref[k] = p->x[k];
+        data->v_ref[k] = p->v[k];
+      }
+      data->records_since_full = 0;
+    } else {
+      data->records_since_full = -1;
+    }
+  }
+  data->time_ref = time;
+
+  return buff;
+}
+
+/**
+ * @brief Dump a set of #part to the log.
+ *
+ * All the chunks are reserved at once in the dump. When the log is
+ * delta-encoded, the size of the chunks is only known once they are encoded,
+ * so they are first written to a temporary buffer.
  *
  * @param log The #logger
- * @param p The #gpart to dump.
+ * @param parts The #part array.
+ * @param xparts The #xpart array.
+ * @param ind The indices of the particles to dump.
+ * @param count The number of particles to dump.
  * @param mask The mask of the data to dump.
- * @param offset Pointer to the offset of the previous log of this particle;
- * (return) offset of this log.
+ * @param time The current time (or scale-factor).
  */
-void logger_log_gpart(struct logger *log, const struct gpart *p,
-                      unsigned int mask, size_t *offset) {
+void logger_log_parts(struct logger *log, const struct part *parts,
+                      struct xpart *xparts, const int *ind, size_t count,
+                      unsigned int mask, double time) {
+
+  if (count == 0) return;
+
+  if (!log->delta_encoding) {
+
+    /* Reserve the space for all of them at once */
+    size_t offset_new;
+    char *buff = logger_reserve_chunks(log, mask, count, &offset_new);
+    const int size = logger_compute_chunk_size(mask);
+
+    for (size_t i = 0; i < count; i++) {
+      buff = logger_copy_part(&parts[ind[i]], mask,
+                              &xparts[ind[i]].logger_data.last_offset,
+                              offset_new, buff);
+      offset_new += size;
+    }
+    return;
+  }
 
   /* Make sure we're not writing a timestamp. */
   if (mask & logger_mask_data[logger_timestamp].mask)
     error("You should not log particles as timestamps.");
 
-  /* Make sure we're not looging fields not supported by gparts. */
-  if (mask &
-      (logger_mask_data[logger_u].mask | logger_mask_data[logger_rho].mask))
-    error("Can't log SPH quantities for gparts.");
+  /* Encode the chunks, leaving room for their headers */
+  char *temp = (char *)malloc(count * log->max_chunk_size);
+  size_t *starts = (size_t *)malloc(count * sizeof(size_t));
+  if (temp == NULL || starts == NULL)
+    error("Failed to allocate the logger encoding buffer.");
+  char *buff = temp;
+  for (size_t i = 0; i < count; i++) {
+    starts[i] = buff - temp;
+    buff = logger_encode_part(log, &parts[ind[i]],
+                              &xparts[ind[i]].logger_data, mask, time,
+                              buff + logger_header_bytes);
+  }
 
-  /* Start by computing the size of the message. */
-  const int size = logger_compute_chunk_size(mask);
+  /* Copy them to the dump */
+  const size_t total = buff - temp;
+  size_t offset_new;
+  char *data = (char *)dump_get(&log->dump, total, &offset_new);
+  memcpy(data, temp, total);
+
+  /* Now that we know where they are, write the headers */
+  for (size_t i = 0; i < count; i++) {
+    size_t *offset = &xparts[ind[i]].logger_data.last_offset;
+    logger_write_chunk_header(data + starts[i], &mask, offset,
+                              offset_new + starts[i]);
+    *offset = offset_new + starts[i];
+  }
+
+  free(temp);
+  free(starts);
+}
+
+/**
+ * @brief Dump a #part to the log.
+ *
+ * @param log The #logger
+ * @param p The #part to dump.
+ * @param mask The mask of the data to dump.
+ * @param offset Pointer to the offset of the previous log of this particle;
+ * (return) offset of this log.
+ */
+void logger_log_part(struct logger *log, const struct part *p,
+                     unsigned int mask, size_t *offset) {
+
+  if (log->delta_encoding)
+    error("Delta-encoded logs must be written with logger_log_parts().");
 
   /* Allocate a chunk of memory in the dump of the right size. */
   size_t offset_new;
-  char *buff = (char *)dump_get(&log->dump, size, &offset_new);
+  char *buff = logger_reserve_chunks(log, mask, 1, &offset_new);
+
+  /* And fill it */
+  logger_copy_part(p, mask, offset, offset_new, buff);
+}
+
+/**
+ * @brief Write the chunk of a #gpart in memory already reserved in the dump.
+ *
+ * @param p The #gpart to dump.
+ * @param mask The mask of the data to dump.
+ * @param offset Pointer to the offset of the previous log of this particle;
+ * (return) offset of this log.
+ * @param offset_new The offset of this chunk in the dump.
+ * @param buff The memory reserved for this chunk.
+ *
+ * @return The end of the chunk in the buffer.
+ */
+char *logger_copy_gpart(const struct gpart *p, unsigned int mask,
+                        size_t *offset, const size_t offset_new, char *buff) {
+
+  /* Make sure we're not looging fields not supported by gparts. */
+  if (mask &
+      (logger_mask_data[logger_u].mask | logger_mask_data[logger_rho].mask))
+    error("Can't log SPH quantities for gparts.");
 
   /* Write the header. */
   buff = logger_write_chunk_header(buff, &mask, offset, offset_new);
@@ -340,6 +536,28 @@ void logger_log_gpart(struct logger *log, const struct gpart *p,
 
   /* Update the log message offset. */
   *offset = offset_new;
+
+  return buff;
+}
+
+/**
+ * @brief Dump a #gpart to the log.
+ *
+ * @param log The #logger
+ * @param p The #gpart to dump.
+ * @param mask The mask of the data to dump.
+ * @param offset Pointer to the offset of the previous log of this particle;
+ * (return) offset of this log.
+ */
+void logger_log_gpart(struct logger *log, const struct gpart *p,
+                      unsigned int mask, size_t *offset) {
+
+  /* Allocate a chunk of memory in the dump of the right size. */
+  size_t offset_new;
+  char *buff = logger_reserve_chunks(log, mask, 1, &offset_new);
+
+  /* And fill it */
+  logger_copy_gpart(p, mask, offset, offset_new, buff);
 }
 
 /**
@@ -423,6 +641,22 @@ void logger_init(struct logger *log, struct swift_params *params) {
   log->buffer_scale =
       parser_get_opt_param_float(params, "Logger:buffer_scale", 10);
   parser_get_param_string(params, "Logger:basename", log->base_name);
+  const double sync_interval =
+      parser_get_opt_param_double(params, "Logger:sync_interval", 1.);
+
+  /* Quantised deltas of the positions and velocities? */
+  log->delta_encoding =
+      parser_get_opt_param_int(params, "Logger:delta_encoding", 0);
+  if (log->delta_encoding) {
+    log->position_tolerance =
+        parser_get_param_double(params, "Logger:position_tolerance");
+    log->velocity_tolerance =
+        parser_get_param_double(params, "Logger:velocity_tolerance");
+    log->keyframe_interval =
+        parser_get_opt_param_int(params, "Logger:keyframe_interval", 16);
+    if (log->position_tolerance <= 0. || log->velocity_tolerance <= 0.)
+      error("The tolerances of the delta-encoded logger must be positive.");
+  }
 
   /* set initial value of parameters */
   log->timestamp_offset = 0;
@@ -439,10 +673,16 @@ void logger_init(struct logger *log, struct swift_params *params) {
   for (int i = 0; i < logger_count_mask - 1; i++) {
     max_size += logger_mask_data[i].size;
   }
+
+  /* The record type and the deltas can be larger than the raw fields */
+  if (log->delta_encoding)
+    max_size += 1 + 6 * logger_max_varint_size -
+                logger_mask_data[logger_x].size -
+                logger_mask_data[logger_v].size;
   log->max_chunk_size = max_size;
 
   /* init dump */
-  dump_init(&log->dump, logger_name_file, buffer_size);
+  dump_init(&log->dump, logger_name_file, buffer_size, sync_interval);
 }
 
 /**
@@ -501,6 +741,14 @@ void logger_write_file_header(struct logger *log, const struct engine *e) {
                       &logger_mask_data[i].size);
   }
 
+  /* write the encoding of the records and its tolerances */
+  logger_write_data(dump, &file_offset, logger_number_size,
+                    &log->delta_encoding);
+  logger_write_data(dump, &file_offset, sizeof(double),
+                    &log->position_tolerance);
+  logger_write_data(dump, &file_offset, sizeof(double),
+                    &log->velocity_tolerance);
+
   /* last step: write first offset */
   memcpy(skip_header, &file_offset, logger_offset_size);
 }
@@ -22,6 +22,7 @@
 #ifdef WITH_LOGGER
 
 /* Includes. */
+#include "align.h"
 #include "common_io.h"
 #include "dump.h"
 #include "inline.h"
@@ -100,6 +101,35 @@ extern const struct mask_data logger_mask_data[logger_count_mask];
 /* Size of the strings. */
 #define logger_string_length 200
 
+/*
+ * Thoses are definitions from the format and therefore should not be changed!
+ */
+/* number of bytes for a mask */
+// TODO change this to number of bits
+#define logger_mask_size 1
+
+/* number of bits for chunk header */
+#define logger_header_bytes 8
+
+/* number bytes for an offset */
+#define logger_offset_size (logger_header_bytes - logger_mask_size)
+
+/* number of bytes for the version information */
+#define logger_version_size 20
+
+/* number of bytes for the labels in the header */
+#define logger_label_size 20
+
+/* number of bytes for the number in the header */
+#define logger_number_size 4
+
+/* Type of a record, stored after its header in delta-encoded logs */
+#define logger_record_full 0
+#define logger_record_delta 1
+
+/* Maximal number of bytes of a variable-length integer */
+#define logger_max_varint_size 10
+
 /* structure containing global data */
 struct logger {
   /* Number of particle steps between dumping a chunk of data */
@@ -120,6 +150,18 @@ struct logger {
   /* Size of a chunk if every mask are activated */
   int max_chunk_size;
 
+  /* Are the positions and velocities stored as quantised deltas? */
+  int delta_encoding;
+
+  /* Maximal error on the positions of the delta-encoded records */
+  double position_tolerance;
+
+  /* Maximal error on the velocities of the delta-encoded records */
+  double velocity_tolerance;
+
+  /* Number of delta-encoded records of a particle between two full ones */
+  int keyframe_interval;
+
 } SWIFT_STRUCT_ALIGN;
 
 /* required structure for each particle type */
@@ -129,6 +171,19 @@ struct logger_part_data {
 
   /* offset of last particle log entry */
   size_t last_offset;
+
+  /* Position of the last log entry, as decoded by the readers */
+  double x_ref[3];
+
+  /* Velocity of the last log entry, as decoded by the readers */
+  float v_ref[3];
+
+  /* Time of the last log entry */
+  double time_ref;
+
+  /* Number of delta-encoded entries since the last full one (-1 if the next
+   * one must be full) */
+  int records_since_full;
 };
 
 /* Function prototypes. */
@@ -138,6 +193,15 @@ void logger_log_part(struct logger *log, const struct part *p,
                      unsigned int mask, size_t *offset);
 void logger_log_gpart(struct logger *log, const struct gpart *p,
                       unsigned int mask, size_t *offset);
+char *logger_reserve_chunks(struct logger *log, unsigned int mask,
+                            size_t count, size_t *offset);
+char *logger_copy_part(const struct part *p, unsigned int mask, size_t *offset,
+                       const size_t offset_new, char *buff);
+void logger_log_parts(struct logger *log, const struct part *parts,
+                      struct xpart *xparts, const int *ind, size_t count,
+                      unsigned int mask, double time);
+char *logger_copy_gpart(const struct gpart *p, unsigned int mask,
+                        size_t *offset, const size_t offset_new, char *buff);
 void logger_init(struct logger *log, struct swift_params *params);
 void logger_clean(struct logger *log);
 void logger_log_timestamp(struct logger *log, integertime_t t, double time,
@@ -159,6 +223,67 @@ int logger_read_timestamp(unsigned long long int *t, double *time,
 INLINE static void logger_part_data_init(struct logger_part_data *logger) {
   logger->last_offset = 0;
   logger->steps_since_last_output = INT_MAX;
+  logger->records_since_full = -1;
+}
+
+/**
+ * @brief Write a signed integer with a variable number of bytes.
+ *
+ * The integer is zig-zag encoded and written 7 bits per byte, the high bit
+ * of each byte flagging that more bytes follow, so that small deltas take a
+ * single byte.
+ *
+ * @param buff The writing buffer.
+ * @param q The integer.
+ *
+ * @return updated buff
+ */
+INLINE static char *logger_write_varint(char *buff, long long q) {
+
+  unsigned long long z = ((unsigned long long)q << 1) ^ (q >> 63);
+  while (z >= 0x80) {
+    *buff++ = (char)((z & 0x7f) | 0x80);
+    z >>= 7;
+  }
+  *buff++ = (char)z;
+  return buff;
+}
+
+/**
+ * @brief Read a signed integer written by logger_write_varint().
+ *
+ * @param buff The reading buffer.
+ * @param q (return) The integer.
+ *
+ * @return updated buff
+ */
+INLINE static const char *logger_read_varint(const char *buff, long long *q) {
+
+  unsigned long long z = 0;
+  int shift = 0;
+  unsigned char c;
+  do {
+    c = (unsigned char)*buff++;
+    z |= (unsigned long long)(c & 0x7f) << shift;
+    shift += 7;
+  } while (c & 0x80);
+  *q = (long long)(z >> 1) ^ -(long long)(z & 1);
+  return buff;
+}
+
+/**
+ * @brief Position predicted for a delta-encoded record.
+ *
+ * The previous record is drifted with its velocity. The writer and the
+ * readers must use the exact same expression.
+ *
+ * @param x_ref The position of the previous record.
+ * @param v_ref The velocity of the previous record.
+ * @param dt The time elapsed since the previous record.
+ */
+INLINE static double logger_predict_position(double x_ref, float v_ref,
+                                             double dt) {
+  return x_ref + v_ref * dt;
 }
 
 /**
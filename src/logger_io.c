@@ -127,7 +127,8 @@ void write_index_single(struct engine* e, const char* baseName,
   io_write_attribute(h_grp, "BoxSize", DOUBLE, e->s->dim, 3);
   double dblTime = e->time;
   io_write_attribute(h_grp, "Time", DOUBLE, &dblTime, 1);
-  io_write_attribute(h_grp, "Time Offset", UINT, &log->timestamp_offset, 1);
+  io_write_attribute(h_grp, "Time Offset", ULONGLONG, &log->timestamp_offset,
+                     1);
   int dimension = (int)hydro_dimension;
   io_write_attribute(h_grp, "Dimension", INT, &dimension, 1);
 
@@ -27,8 +27,14 @@
 #include "../config.h"
 
 /* Standard includes. */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -192,6 +198,406 @@ void memuse_log_dump_error(int rank) {
 
 #endif /* SWIFT_MEMUSE_REPORTS */
 
+/* Names of the categories of accounted memory. */
+const char *memuse_category_names[memuse_category_count] = {
+    "particles", "foreign", "sort", "tasks", "multipoles",
+    "mesh",      "fof",     "io",   "other"};
+
+/* Current and peak bytes in use per category. */
+static volatile long long memuse_current[memuse_category_count] = {0};
+static volatile long long memuse_peak[memuse_category_count] = {0};
+
+/**
+ * @brief Does the string start with the given prefix?
+ */
+static int memuse_has_prefix(const char *label, const char *prefix) {
+  return strncmp(label, prefix, strlen(prefix)) == 0;
+}
+
+/**
+ * @brief Does the string end with the given suffix?
+ */
+static int memuse_has_suffix(const char *label, const char *suffix) {
+  const size_t len = strlen(label);
+  const size_t slen = strlen(suffix);
+  return len >= slen && strcmp(label + len - slen, suffix) == 0;
+}
+
+/**
+ * @brief Does the label name one of the particle arrays?
+ */
+static int memuse_is_particles(const char *label, size_t len) {
+  static const char *names[5] = {"parts", "xparts", "gparts", "sparts",
+                                 "bparts"};
+  for (int k = 0; k < 5; k++)
+    if (strlen(names[k]) == len && strncmp(label, names[k], len) == 0)
+      return 1;
+  return 0;
+}
+
+/**
+ * @brief Return the category of memory associated with a label.
+ *
+ * @param label the label used when allocating the memory.
+ */
+enum memuse_category memuse_category_of(const char *label) {
+
+  const size_t len = strlen(label);
+
+  /* The local particles and the ones imported from the other ranks. */
+  if (memuse_is_particles(label, len)) return memuse_category_particles;
+  if (memuse_has_suffix(label, "_foreign")) return memuse_category_foreign;
+  if (memuse_has_suffix(label, "_in") &&
+      memuse_is_particles(label, len - strlen("_in")))
+    return memuse_category_foreign;
+  if (memuse_has_suffix(label, "_out") &&
+      memuse_is_particles(label, len - strlen("_out")))
+    return memuse_category_foreign;
+
+  if (memuse_has_prefix(label, "sort")) return memuse_category_sort;
+
+  if (strcmp(label, "tasks") == 0 || strcmp(label, "tasks_ind") == 0 ||
+      strcmp(label, "unlocks") == 0 || strcmp(label, "unlock_ind") == 0 ||
+      strcmp(label, "tid_active") == 0 || strcmp(label, "task_costs") == 0)
+    return memuse_category_tasks;
+
+  if (memuse_has_prefix(label, "multipoles") ||
+      memuse_has_suffix(label, "gravity_tensors"))
+    return memuse_category_multipoles;
+
+  if (memuse_has_prefix(label, "fftw")) return memuse_category_mesh;
+
+  if (memuse_has_prefix(label, "fof") || memuse_has_prefix(label, "group_") ||
+      memuse_has_prefix(label, "gpart_group_data"))
+    return memuse_category_fof;
+
+  if (strcmp(label, "writebuff") == 0 || memuse_has_prefix(label, "temp") ||
+      memuse_has_suffix(label, "_written"))
+    return memuse_category_io;
+
+  return memuse_category_other;
+}
+
+/**
+ * @brief Account for some memory allocated or freed in a category.
+ *
+ * @param category the category of the memory.
+ * @param bytes the number of bytes allocated, negative when freeing.
+ */
+void memuse_account_category(enum memuse_category category, long long bytes) {
+
+  if (bytes == 0) return;
+  const long long current =
+      atomic_add(&memuse_current[category], bytes) + bytes;
+
+  /* Raise the high-water mark if needed. */
+  long long peak = memuse_peak[category];
+  while (current > peak) {
+    const long long old = atomic_cas(&memuse_peak[category], peak, current);
+    if (old == peak) break;
+    peak = old;
+  }
+}
+
+/**
+ * @brief Account for some memory allocated or freed using one of the swift_*
+ *        functions. Always active, so cheap enough for production runs.
+ *
+ * @param label the label of the memory.
+ * @param bytes the number of bytes allocated, negative when freeing.
+ */
+void memuse_account(const char *label, long long bytes) {
+  if (bytes == 0) return;
+  memuse_account_category(memuse_category_of(label), bytes);
+}
+
+/**
+ * @brief Get the current and peak number of bytes in use per category.
+ *
+ * @param current the bytes in use, array of size memuse_category_count.
+ * @param peak the high-water marks, array of size memuse_category_count.
+ */
+void memuse_categories(long long *current, long long *peak) {
+  for (int k = 0; k < memuse_category_count; k++) {
+    current[k] = memuse_current[k];
+    peak[k] = memuse_peak[k];
+  }
+}
+
+/*! Do we back the large long-lived arrays with transparent huge pages? */
+int memuse_huge_pages = 0;
+
+/**
+ * @brief Should an allocation be backed by huge pages?
+ *
+ * Only the particle arrays and the buffers of sub-cells and multipoles, which
+ * are large, live until the next regrid and are accessed all over by the
+ * tasks, are worth it.
+ *
+ * @param label the label of the memory.
+ * @param size the number of bytes to allocate.
+ */
+int memuse_wants_huge_pages(const char *label, size_t size) {
+
+  if (size < memuse_huge_page_size) return 0;
+  if (strcmp(label, "cells_sub") == 0 || strcmp(label, "multipoles_sub") == 0)
+    return 1;
+  return memuse_is_particles(label, strlen(label));
+}
+
+/**
+ * @brief Ask the kernel to back some memory with transparent huge pages.
+ *
+ * @param ptr the start of the memory, aligned on a huge page.
+ * @param size the size of the memory, a multiple of the huge page size.
+ */
+void memuse_advise_huge_pages(void *ptr, size_t size) {
+#ifdef MADV_HUGEPAGE
+  /* Only a hint, the memory is still usable if this fails. */
+  madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+}
+
+/**
+ * @brief Get the amount of memory of the process backed by transparent huge
+ *        pages, from the AnonHugePages fields of /proc/self/smaps.
+ *
+ * @result the memory in bytes, -1 if not known.
+ */
+long long memuse_huge_pages_in_use(void) {
+
+  /* The rollup is much cheaper to read, when the kernel provides it. */
+  FILE *file = fopen("/proc/self/smaps_rollup", "r");
+  if (file == NULL) file = fopen("/proc/self/smaps", "r");
+  if (file == NULL) return -1;
+
+  long long total = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    long long kb;
+    if (sscanf(line, "AnonHugePages: %lld kB", &kb) == 1) total += kb;
+  }
+  fclose(file);
+
+  return total * 1024;
+}
+
+/*! Do we place the particle arrays in memory shared with the other processes
+ *  of the node? */
+int memuse_node_shared = 0;
+
+/**
+ * @brief A block of memory shared with the other processes of the node.
+ */
+struct memuse_shared_block {
+
+  /*! Start of the block in our memory */
+  void *ptr;
+
+  /*! Size of the block in bytes */
+  size_t size;
+
+  /*! Name of the shared memory object backing the block */
+  char name[memuse_node_shared_name_length];
+};
+
+/* The shared blocks we allocated. There are only ever a few of them. */
+static struct memuse_shared_block *memuse_shared_blocks = NULL;
+static int memuse_shared_count = 0;
+static int memuse_shared_next = 0;
+static pthread_mutex_t memuse_shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Should an allocation be shared with the other processes of the
+ *        node?
+ *
+ * Only the local gas particles are, as these are what the other processes
+ * read in place rather than receiving copies of them.
+ *
+ * @param label the label of the memory.
+ */
+int memuse_wants_node_shared(const char *label) {
+  return strcmp(label, "parts") == 0;
+}
+
+/**
+ * @brief Allocate memory that the other processes of the node can map into
+ *        theirs, see #memuse_node_shared_map.
+ *
+ * The memory is a named POSIX shared memory object, reserved up-front so
+ * that running out of space shows here rather than as a bus error later. It
+ * is aligned on a page.
+ *
+ * @param label a symbolic label for the memory, i.e. "parts".
+ * @param memptr pointer to the allocated memory.
+ * @param size the quantity of bytes to allocate.
+ * @result zero on success, otherwise an error code.
+ */
+int memuse_node_shared_memalign(const char *label, void **memptr,
+                                size_t size) {
+#ifdef HAVE_SHM_OPEN
+  struct memuse_shared_block block;
+  block.size = (size > 0) ? size : 1;
+
+  pthread_mutex_lock(&memuse_shared_mutex);
+  snprintf(block.name, memuse_node_shared_name_length, "/swift_%d_%d",
+           (int)getpid(), memuse_shared_next++);
+  pthread_mutex_unlock(&memuse_shared_mutex);
+
+  const int fd =
+      shm_open(block.name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+  if (fd < 0) return errno;
+  int result = 0;
+  if (ftruncate(fd, block.size) != 0) result = errno;
+#ifdef HAVE_POSIX_FALLOCATE
+  if (result == 0) result = posix_fallocate(fd, 0, block.size);
+#endif
+  block.ptr = MAP_FAILED;
+  if (result == 0) {
+    block.ptr = mmap(NULL, block.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd, 0);
+    if (block.ptr == MAP_FAILED) result = errno;
+  }
+  close(fd);
+  if (result != 0) {
+    shm_unlink(block.name);
+#ifdef SWIFT_MEMUSE_REPORTS
+    memuse_log_allocation(label, NULL, -1, size);
+#endif
+    return result;
+  }
+
+  /* Remember the block. */
+  pthread_mutex_lock(&memuse_shared_mutex);
+  struct memuse_shared_block *blocks = (struct memuse_shared_block *)realloc(
+      memuse_shared_blocks,
+      sizeof(struct memuse_shared_block) * (memuse_shared_count + 1));
+  if (blocks == NULL) error("Failed to record a shared memory block.");
+  memuse_shared_blocks = blocks;
+  memuse_shared_blocks[memuse_shared_count++] = block;
+  pthread_mutex_unlock(&memuse_shared_mutex);
+
+  memuse_account(label, block.size);
+#ifdef SWIFT_MEMUSE_REPORTS
+  memuse_log_allocation(label, block.ptr, 1, size);
+#endif
+  *memptr = block.ptr;
+  return 0;
+#else
+  return ENOSYS;
+#endif
+}
+
+/**
+ * @brief Free memory allocated by #memuse_node_shared_memalign.
+ *
+ * The other processes that mapped it keep their view of it until they unmap
+ * it.
+ *
+ * @param label a symbolic label for the memory, i.e. "parts".
+ * @param ptr pointer to the memory.
+ * @result 1 if the memory was shared and is now freed, 0 if it was not
+ *         shared, in which case nothing was done.
+ */
+int memuse_node_shared_free(const char *label, void *ptr) {
+
+  if (ptr == NULL) return 0;
+
+  pthread_mutex_lock(&memuse_shared_mutex);
+  int k = 0;
+  while (k < memuse_shared_count && memuse_shared_blocks[k].ptr != ptr) k++;
+  if (k == memuse_shared_count) {
+    pthread_mutex_unlock(&memuse_shared_mutex);
+    return 0;
+  }
+  const struct memuse_shared_block block = memuse_shared_blocks[k];
+  memuse_shared_blocks[k] = memuse_shared_blocks[--memuse_shared_count];
+  pthread_mutex_unlock(&memuse_shared_mutex);
+
+#ifdef HAVE_SHM_OPEN
+  /* Usually unlinked already, see #memuse_node_shared_unlink. */
+  shm_unlink(block.name);
+#endif
+  munmap(block.ptr, block.size);
+  memuse_account(label, -(long long)block.size);
+#ifdef SWIFT_MEMUSE_REPORTS
+  memuse_log_allocation(label, ptr, 0, 0);
+#endif
+  return 1;
+}
+
+/**
+ * @brief Get the name and size of a block of memory allocated by
+ *        #memuse_node_shared_memalign.
+ *
+ * @param ptr pointer to the memory.
+ * @param name (return) the name of the block, of length
+ *        #memuse_node_shared_name_length.
+ * @param size (return) the size of the block in bytes.
+ * @result 1 if the memory is shared, 0 otherwise.
+ */
+int memuse_node_shared_name(const void *ptr, char *name, size_t *size) {
+
+  int found = 0;
+  pthread_mutex_lock(&memuse_shared_mutex);
+  for (int k = 0; k < memuse_shared_count && !found; k++) {
+    if (memuse_shared_blocks[k].ptr == ptr) {
+      strcpy(name, memuse_shared_blocks[k].name);
+      *size = memuse_shared_blocks[k].size;
+      found = 1;
+    }
+  }
+  pthread_mutex_unlock(&memuse_shared_mutex);
+  return found;
+}
+
+/**
+ * @brief Remove the name of a block of shared memory once all the processes
+ *        that need it have mapped it.
+ *
+ * The memory stays valid, but is now released when the last process unmaps
+ * it, including when they crash.
+ *
+ * @param ptr pointer to the memory.
+ */
+void memuse_node_shared_unlink(const void *ptr) {
+#ifdef HAVE_SHM_OPEN
+  char name[memuse_node_shared_name_length];
+  size_t size;
+  if (memuse_node_shared_name(ptr, name, &size)) shm_unlink(name);
+#endif
+}
+
+/**
+ * @brief Map a block of memory allocated by another process of the node,
+ *        read-only.
+ *
+ * @param name the name of the block, see #memuse_node_shared_name.
+ * @param size the size of the block in bytes.
+ * @result the start of the block in our memory, NULL on failure.
+ */
+void *memuse_node_shared_map(const char *name, size_t size) {
+#ifdef HAVE_SHM_OPEN
+  const int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) return NULL;
+  void *ptr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  return (ptr == MAP_FAILED) ? NULL : ptr;
+#else
+  return NULL;
+#endif
+}
+
+/**
+ * @brief Unmap a block of memory mapped by #memuse_node_shared_map.
+ *
+ * @param ptr the start of the block in our memory.
+ * @param size the size of the block in bytes.
+ */
+void memuse_node_shared_unmap(void *ptr, size_t size) {
+  if (ptr != NULL) munmap(ptr, size);
+}
+
 /**
  * @brief parse the process /proc/self/statm file to get the process
  *        memory use (in KB). Top field in ().
@@ -24,6 +24,9 @@
 
 /* Includes. */
 #include <stdlib.h>
+#ifdef HAVE_MALLOC_H
+#include <malloc.h>
+#endif
 
 /* API. */
 void memuse_use(long *size, long *resident, long *shared, long *text,
@@ -41,6 +44,69 @@ void memuse_log_allocation(const char *label, void *ptr, int allocated,
 #define memuse_log_allocation(label, ptr, allocated, size)
 #endif
 
+/**
+ * @brief The categories used to account for the memory allocated using the
+ *        swift_* functions. The category is derived from the label.
+ */
+enum memuse_category {
+  memuse_category_particles = 0,
+  memuse_category_foreign,
+  memuse_category_sort,
+  memuse_category_tasks,
+  memuse_category_multipoles,
+  memuse_category_mesh,
+  memuse_category_fof,
+  memuse_category_io,
+  memuse_category_other,
+  memuse_category_count
+};
+
+extern const char *memuse_category_names[memuse_category_count];
+
+/*! Size of the huge pages used for the large long-lived arrays */
+#define memuse_huge_page_size (2 * 1024 * 1024)
+
+/*! Do we back the large long-lived arrays with transparent huge pages? */
+extern int memuse_huge_pages;
+
+int memuse_wants_huge_pages(const char *label, size_t size);
+void memuse_advise_huge_pages(void *ptr, size_t size);
+long long memuse_huge_pages_in_use(void);
+
+/*! Maximal length of the name of a block of memory shared within the node */
+#define memuse_node_shared_name_length 64
+
+/*! Do we place the particle arrays in memory shared with the other processes
+ *  of the node? */
+extern int memuse_node_shared;
+
+int memuse_wants_node_shared(const char *label);
+int memuse_node_shared_memalign(const char *label, void **memptr,
+                                size_t size);
+int memuse_node_shared_free(const char *label, void *ptr);
+int memuse_node_shared_name(const void *ptr, char *name, size_t *size);
+void memuse_node_shared_unlink(const void *ptr);
+void *memuse_node_shared_map(const char *name, size_t size);
+void memuse_node_shared_unmap(void *ptr, size_t size);
+
+enum memuse_category memuse_category_of(const char *label);
+void memuse_account(const char *label, long long bytes);
+void memuse_account_category(enum memuse_category category, long long bytes);
+void memuse_categories(long long *current, long long *peak);
+
+/**
+ * @brief the number of bytes usable in an allocated block of memory, as
+ *        reported by the allocator. Zero if not known.
+ *
+ * @param ptr pointer to the allocated memory, can be NULL.
+ */
+__attribute__((always_inline)) inline size_t memuse_usable_size(void *ptr) {
+#ifdef HAVE_MALLOC_USABLE_SIZE
+  if (ptr != NULL) return malloc_usable_size(ptr);
+#endif
+  return 0;
+}
+
 /**
  * @brief allocate aligned memory. The use and results are the same as the
  *        posix_memalign function. This function should be used for any
@@ -56,7 +122,24 @@ __attribute__((always_inline)) inline int swift_memalign(const char *label,
                                                          void **memptr,
                                                          size_t alignment,
                                                          size_t size) {
+
+  /* The particle arrays read in place by the other processes of the node
+   * live in named shared memory. */
+  if (memuse_node_shared && memuse_wants_node_shared(label))
+    return memuse_node_shared_memalign(label, memptr, size);
+
+  /* Large long-lived arrays can be backed by huge pages, in which case they
+   * are aligned on and padded to whole huge pages. */
+  const int huge = memuse_huge_pages && memuse_wants_huge_pages(label, size);
+  if (huge) {
+    if (alignment < memuse_huge_page_size) alignment = memuse_huge_page_size;
+    size = (size + memuse_huge_page_size - 1) / memuse_huge_page_size *
+           memuse_huge_page_size;
+  }
+
   int result = posix_memalign(memptr, alignment, size);
+  if (result == 0 && huge) memuse_advise_huge_pages(*memptr, size);
+  if (result == 0) memuse_account(label, memuse_usable_size(*memptr));
 #ifdef SWIFT_MEMUSE_REPORTS
   if (result == 0) {
     memuse_log_allocation(label, *memptr, 1, size);
@@ -82,6 +165,7 @@ __attribute__((always_inline)) inline int swift_memalign(const char *label,
 __attribute__((always_inline)) inline void *swift_malloc(const char *label,
                                                          size_t size) {
   void *memptr = malloc(size);
+  memuse_account(label, memuse_usable_size(memptr));
 #ifdef SWIFT_MEMUSE_REPORTS
   if (memptr != NULL) {
     memuse_log_allocation(label, memptr, 1, size);
@@ -109,6 +193,7 @@ __attribute__((always_inline)) inline void *swift_calloc(const char *label,
                                                          size_t nmemb,
                                                          size_t size) {
   void *memptr = calloc(nmemb, size);
+  memuse_account(label, memuse_usable_size(memptr));
 #ifdef SWIFT_MEMUSE_REPORTS
   if (memptr != NULL) {
     memuse_log_allocation(label, memptr, 1, size * nmemb);
@@ -135,7 +220,13 @@ __attribute__((always_inline)) inline void *swift_calloc(const char *label,
 __attribute__((always_inline)) inline void *swift_realloc(const char *label,
                                                           void *ptr,
                                                           size_t size) {
+  const size_t old_size = memuse_usable_size(ptr);
   void *memptr = realloc(ptr, size);
+
+  /* On failure the old memory is still in use. */
+  if (memptr != NULL || size == 0)
+    memuse_account(label, (long long)memuse_usable_size(memptr) -
+                              (long long)old_size);
 #ifdef SWIFT_MEMUSE_REPORTS
   if (memptr != NULL) {
 
@@ -168,6 +259,8 @@ __attribute__((always_inline)) inline void *swift_realloc(const char *label,
  */
 __attribute__((always_inline)) inline void swift_free(const char *label,
                                                       void *ptr) {
+  if (memuse_node_shared && memuse_node_shared_free(label, ptr)) return;
+  memuse_account(label, -(long long)memuse_usable_size(ptr));
   free(ptr);
 #ifdef SWIFT_MEMUSE_REPORTS
   memuse_log_allocation(label, ptr, 0, 0);
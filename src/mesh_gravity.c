@@ -20,10 +20,17 @@
 /* Config parameters. */
 #include "../config.h"
 
+/* Some standard headers. */
+#include <unistd.h>
+
 #ifdef HAVE_FFTW
 #include <fftw3.h>
 #endif
 
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+#include <fftw3-mpi.h>
+#endif
+
 /* This object's header. */
 #include "mesh_gravity.h"
 
@@ -34,12 +41,25 @@
 #include "error.h"
 #include "gravity_properties.h"
 #include "kernel_long_gravity.h"
+#include "memuse.h"
 #include "part.h"
 #include "runner.h"
 #include "space.h"
 
 #ifdef HAVE_FFTW
 
+/* The FFTW functions, atomics and MPI type matching the precision of the
+ * mesh */
+#ifdef MESH_SINGLE_PRECISION
+#define mesh_fftw(name) fftwf_##name
+#define mesh_atomic_add atomic_add_f
+#define mesh_mpi_real MPI_FLOAT
+#else
+#define mesh_fftw(name) fftw_##name
+#define mesh_atomic_add atomic_add_d
+#define mesh_mpi_real MPI_DOUBLE
+#endif
+
 /**
  * @brief Returns 1D index of a 3D NxNxN array using row-major style.
  *
@@ -106,25 +126,25 @@ __attribute__((always_inline)) INLINE static double CIC_get(
  * @param value The value to interpolate.
  */
 __attribute__((always_inline)) INLINE static void CIC_set(
-    double* mesh, int N, int i, int j, int k, double tx, double ty, double tz,
-    double dx, double dy, double dz, double value) {
+    mesh_real* mesh, int N, int i, int j, int k, double tx, double ty,
+    double tz, double dx, double dy, double dz, double value) {
 
   /* Classic CIC interpolation */
-  atomic_add_d(&mesh[row_major_id_periodic(i + 0, j + 0, k + 0, N)],
+  mesh_atomic_add(&mesh[row_major_id_periodic(i + 0, j + 0, k + 0, N)],
                value * tx * ty * tz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 0, j + 0, k + 1, N)],
+  mesh_atomic_add(&mesh[row_major_id_periodic(i + 0, j + 0, k + 1, N)],
                value * tx * ty * dz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 0, j + 1, k + 0, N)],
+  mesh_atomic_add(&mesh[row_major_id_periodic(i + 0, j + 1, k + 0, N)],
                value * tx * dy * tz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 0, j + 1, k + 1, N)],
+  mesh_atomic_add(&mesh[row_major_id_periodic(i + 0, j + 1, k + 1, N)],
                value * tx * dy * dz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 1, j + 0, k + 0, N)],
+  mesh_atomic_add(&mesh[row_major_id_periodic(i + 1, j + 0, k + 0, N)],
                value * dx * ty * tz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 1, j + 0, k + 1, N)],
+  mesh_atomic_add(&mesh[row_major_id_periodic(i + 1, j + 0, k + 1, N)],
                value * dx * ty * dz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 1, j + 1, k + 0, N)],
+  mesh_atomic_add(&mesh[row_major_id_periodic(i + 1, j + 1, k + 0, N)],
                value * dx * dy * tz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 1, j + 1, k + 1, N)],
+  mesh_atomic_add(&mesh[row_major_id_periodic(i + 1, j + 1, k + 1, N)],
                value * dx * dy * dz);
 }
 
@@ -137,8 +157,8 @@ __attribute__((always_inline)) INLINE static void CIC_set(
  * @param fac The width of a mesh cell.
  * @param dim The dimensions of the simulation box.
  */
-INLINE static void gpart_to_mesh_CIC(const struct gpart* gp, double* rho, int N,
-                                     double fac, const double dim[3]) {
+INLINE static void gpart_to_mesh_CIC(const struct gpart* gp, mesh_real* rho,
+                                     int N, double fac, const double dim[3]) {
 
   /* Box wrap the multipole's position */
   const double pos_x = box_wrap(gp->x[0], 0., dim[0]);
@@ -183,7 +203,7 @@ INLINE static void gpart_to_mesh_CIC(const struct gpart* gp, double* rho, int N,
  * @param fac The width of a mesh cell.
  * @param dim The dimensions of the simulation box.
  */
-void cell_gpart_to_mesh_CIC(const struct cell* c, double* rho, int N,
+void cell_gpart_to_mesh_CIC(const struct cell* c, mesh_real* rho, int N,
                             double fac, const double dim[3]) {
   const int gcount = c->grav.count;
   const struct gpart* gparts = c->grav.parts;
@@ -193,16 +213,120 @@ void cell_gpart_to_mesh_CIC(const struct cell* c, double* rho, int N,
     gpart_to_mesh_CIC(&gparts[i], rho, N, fac, dim);
 }
 
+/**
+ * @brief Computes the 1D mass assignment weights of a position for an
+ * assignment scheme of a given order.
+ *
+ * Order 2 is CIC, order 3 is TSC and order 4 is PCS. The weights apply to
+ * the mesh cells [*start, *start + order[ (not box-wrapped).
+ *
+ * @param order The order of the assignment scheme (2, 3 or 4).
+ * @param u The position in units of the mesh cell size (in [0, N[).
+ * @param start (return) The index of the first mesh cell with a weight.
+ * @param w (return) The weights of the order mesh cells.
+ */
+__attribute__((always_inline)) INLINE static void mesh_assignment_weights(
+    const int order, const double u, int* start, double w[4]) {
+
+  switch (order) {
+    case 2: {
+      const int i = (int)floor(u);
+      const double d = u - i;
+      *start = i;
+      w[0] = 1. - d;
+      w[1] = d;
+      break;
+    }
+    case 3: {
+      const int i = (int)floor(u + 0.5);
+      const double d = u - i;
+      *start = i - 1;
+      w[0] = 0.5 * (0.5 - d) * (0.5 - d);
+      w[1] = 0.75 - d * d;
+      w[2] = 0.5 * (0.5 + d) * (0.5 + d);
+      break;
+    }
+    case 4: {
+      const int i = (int)floor(u);
+      const double d = u - i;
+      const double t = 1. - d;
+      *start = i - 1;
+      w[0] = t * t * t / 6.;
+      w[1] = (4. - 6. * d * d + 3. * d * d * d) / 6.;
+      w[2] = (4. - 6. * t * t + 3. * t * t * t) / 6.;
+      w[3] = d * d * d / 6.;
+      break;
+    }
+    default:
+      error("Invalid mesh assignment order %d", order);
+  }
+}
+
+/**
+ * @brief Assigns a given #gpart to a density mesh using a scheme of
+ * arbitrary order, optionally shifting all the particles.
+ *
+ * @param gp The #gpart.
+ * @param rho The density mesh.
+ * @param N the size of the mesh along one axis.
+ * @param fac The width of a mesh cell.
+ * @param dim The dimensions of the simulation box.
+ * @param order The order of the assignment scheme.
+ * @param shift Shift to apply to the particles in units of mesh cells.
+ */
+INLINE static void gpart_to_mesh_generic(const struct gpart* gp, mesh_real* rho,
+                                         int N, double fac,
+                                         const double dim[3], int order,
+                                         double shift) {
+
+  /* Box wrap the (shifted) particle's position */
+  const double dx = shift / fac;
+  const double pos[3] = {box_wrap(gp->x[0] + dx, 0., dim[0]),
+                         box_wrap(gp->x[1] + dx, 0., dim[1]),
+                         box_wrap(gp->x[2] + dx, 0., dim[2])};
+
+  /* Workout the weights along each axis */
+  int start[3];
+  double w[3][4];
+  for (int d = 0; d < 3; ++d)
+    mesh_assignment_weights(order, fac * pos[d], &start[d], w[d]);
+
+  const double mass = gp->mass;
+
+  for (int a = 0; a < order; ++a) {
+    for (int b = 0; b < order; ++b) {
+      const double wab = mass * w[0][a] * w[1][b];
+      for (int c = 0; c < order; ++c) {
+        mesh_atomic_add(&rho[row_major_id_periodic(start[0] + a, start[1] + b,
+                                                start[2] + c, N)],
+                     wab * w[2][c]);
+      }
+    }
+  }
+}
+
 /**
  * @brief Shared information about the mesh to be used by all the threads in the
  * pool.
  */
 struct cic_mapper_data {
   const struct cell* cells;
-  double* rho;
+  mesh_real* rho;
   int N;
   double fac;
   double dim[3];
+
+  /*! Order of the assignment scheme (2 is CIC) */
+  int order;
+
+  /*! Shift of the particles in units of mesh cells (interlacing) */
+  double shift;
+
+  /*! Only assign the #gpart of this type (-1 for all of them) */
+  int type;
+#ifdef SWIFT_DEBUG_CHECKS
+  integertime_t ti_current;
+#endif
 };
 
 /**
@@ -217,7 +341,7 @@ void cell_gpart_to_mesh_CIC_mapper(void* map_data, int num, void* extra) {
   /* Unpack the shared information */
   const struct cic_mapper_data* data = (struct cic_mapper_data*)extra;
   const struct cell* cells = data->cells;
-  double* rho = data->rho;
+  mesh_real* rho = data->rho;
   const int N = data->N;
   const double fac = data->fac;
   const double dim[3] = {data->dim[0], data->dim[1], data->dim[2]};
@@ -225,10 +349,7 @@ void cell_gpart_to_mesh_CIC_mapper(void* map_data, int num, void* extra) {
   /* Pointer to the chunk to be processed */
   int* local_cells = (int*)map_data;
 
-  // MATTHIEU: This could in principle be improved by creating a local mesh
-  //           with just the extent required for the cell. Assignment can
-  //           then be done without atomics. That local mesh is then added
-  //           atomically to the global one.
+  /* Note: See mesh_assign_CIC_tiled() for a version without atomics */
 
   /* Loop over the elements assigned to this thread */
   for (int i = 0; i < num; ++i) {
@@ -236,69 +357,368 @@ void cell_gpart_to_mesh_CIC_mapper(void* map_data, int num, void* extra) {
     /* Pointer to local cell */
     const struct cell* c = &cells[local_cells[i]];
 
+#ifdef SWIFT_DEBUG_CHECKS
+    /* The mesh is only built after the full drift of a rebuild */
+    for (int k = 0; k < c->grav.count; ++k)
+      if (c->grav.parts[k].time_bin != time_bin_not_created &&
+          c->grav.parts[k].ti_drift != data->ti_current)
+        error("gpart not drifted to current time");
+#endif
+
     /* Assign this cell's content to the mesh */
-    cell_gpart_to_mesh_CIC(c, rho, N, fac, dim);
+    if (data->type >= 0) {
+      for (int k = 0; k < c->grav.count; ++k)
+        if (c->grav.parts[k].type == data->type)
+          gpart_to_mesh_generic(&c->grav.parts[k], rho, N, fac, dim,
+                                data->order, data->shift);
+    } else if (data->order == 2 && data->shift == 0.) {
+      cell_gpart_to_mesh_CIC(c, rho, N, fac, dim);
+    } else {
+      for (int k = 0; k < c->grav.count; ++k)
+        gpart_to_mesh_generic(&c->grav.parts[k], rho, N, fac, dim,
+                              data->order, data->shift);
+    }
   }
 }
 
 /**
- * @brief Computes the potential on a gpart from a given mesh using the CIC
- * method.
+ * @brief Returns 1D index of a point of a local tile of the mesh.
  *
- * Debugging routine.
+ * The global indices are wrapped around the box before being made relative
+ * to the corner of the tile.
  *
- * @param gp The #gpart.
- * @param pot The potential mesh.
+ * @param i Global index along x.
+ * @param j Global index along y.
+ * @param k Global index along z.
+ * @param lo The global indices of the corner of the tile.
+ * @param n The number of mesh cells of the tile along each axis.
+ * @param N Size of the global mesh along one axis.
+ */
+__attribute__((always_inline)) INLINE static int tile_id_periodic(
+    int i, int j, int k, const int lo[3], const int n[3], int N) {
+
+  const int ii = (i - lo[0] + 2 * N) % N;
+  const int jj = (j - lo[1] + 2 * N) % N;
+  const int kk = (k - lo[2] + 2 * N) % N;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (ii >= n[0] || jj >= n[1] || kk >= n[2])
+    error("Mesh point (%d %d %d) outside the tile", i, j, k);
+#endif
+
+  return ii * n[1] * n[2] + jj * n[2] + kk;
+}
+
+/**
+ * @brief Assigns all the #gpart of a #cell to a local tile of the density
+ * mesh using the CIC method.
+ *
+ * The tile only covers the mesh cells the #gpart of this #cell can reach so
+ * no atomics are needed.
+ *
+ * @param c The #cell.
+ * @param tile The density tile.
+ * @param lo The global indices of the corner of the tile.
+ * @param n The number of mesh cells of the tile along each axis.
  * @param N the size of the mesh along one axis.
- * @param fac width of a mesh cell.
+ * @param fac The width of a mesh cell.
  * @param dim The dimensions of the simulation box.
  */
-void mesh_to_gparts_CIC(struct gpart* gp, const double* pot, int N, double fac,
-                        const double dim[3]) {
+static void cell_gpart_to_tile_CIC(const struct cell* c, double* tile,
+                                   const int lo[3], const int n[3], int N,
+                                   double fac, const double dim[3]) {
 
-  /* Box wrap the gpart's position */
-  const double pos_x = box_wrap(gp->x[0], 0., dim[0]);
-  const double pos_y = box_wrap(gp->x[1], 0., dim[1]);
-  const double pos_z = box_wrap(gp->x[2], 0., dim[2]);
+  const int gcount = c->grav.count;
+  const struct gpart* gparts = c->grav.parts;
 
-  int i = (int)(fac * pos_x);
-  if (i >= N) i = N - 1;
-  const double dx = fac * pos_x - i;
-  const double tx = 1. - dx;
+  for (int p = 0; p < gcount; ++p) {
+
+    const struct gpart* gp = &gparts[p];
+
+    /* Box wrap the particle's position */
+    const double pos_x = box_wrap(gp->x[0], 0., dim[0]);
+    const double pos_y = box_wrap(gp->x[1], 0., dim[1]);
+    const double pos_z = box_wrap(gp->x[2], 0., dim[2]);
+
+    /* Workout the CIC coefficients */
+    int i = (int)(fac * pos_x);
+    if (i >= N) i = N - 1;
+    const double dx = fac * pos_x - i;
+    const double tx = 1. - dx;
+
+    int j = (int)(fac * pos_y);
+    if (j >= N) j = N - 1;
+    const double dy = fac * pos_y - j;
+    const double ty = 1. - dy;
+
+    int k = (int)(fac * pos_z);
+    if (k >= N) k = N - 1;
+    const double dz = fac * pos_z - k;
+    const double tz = 1. - dz;
+
+    const double m = gp->mass;
+
+    /* CIC ! (no atomics needed: the tile is private) */
+    tile[tile_id_periodic(i + 0, j + 0, k + 0, lo, n, N)] += m * tx * ty * tz;
+    tile[tile_id_periodic(i + 0, j + 0, k + 1, lo, n, N)] += m * tx * ty * dz;
+    tile[tile_id_periodic(i + 0, j + 1, k + 0, lo, n, N)] += m * tx * dy * tz;
+    tile[tile_id_periodic(i + 0, j + 1, k + 1, lo, n, N)] += m * tx * dy * dz;
+    tile[tile_id_periodic(i + 1, j + 0, k + 0, lo, n, N)] += m * dx * ty * tz;
+    tile[tile_id_periodic(i + 1, j + 0, k + 1, lo, n, N)] += m * dx * ty * dz;
+    tile[tile_id_periodic(i + 1, j + 1, k + 0, lo, n, N)] += m * dx * dy * tz;
+    tile[tile_id_periodic(i + 1, j + 1, k + 1, lo, n, N)] += m * dx * dy * dz;
+  }
+}
 
-  int j = (int)(fac * pos_y);
-  if (j >= N) j = N - 1;
-  const double dy = fac * pos_y - j;
-  const double ty = 1. - dy;
+/**
+ * @brief Shared information about the mesh to be used by all the threads
+ * doing a tiled CIC assignment.
+ */
+struct cic_tile_mapper_data {
+  const struct cell* cells;
+  mesh_real* rho;
+  int N;
+  double fac;
+  double dim[3];
 
-  int k = (int)(fac * pos_z);
-  if (k >= N) k = N - 1;
-  const double dz = fac * pos_z - k;
-  const double tz = 1. - dz;
+  /*! Maximal number of mesh cells of a tile along one axis */
+  int tile_size;
+#ifdef SWIFT_DEBUG_CHECKS
+  integertime_t ti_current;
+#endif
+};
+
+/**
+ * @brief Threadpool mapper function for the tiled mesh CIC assignment of a
+ * set of cells of the same colour.
+ *
+ * Each cell is assigned to a private tile covering the part of the mesh it
+ * can reach. The tile is then added to the global mesh without atomics as
+ * the tiles of two cells of the same colour never overlap.
+ *
+ * @param map_data A chunk of the list of local cells of one colour.
+ * @param num The number of cells in the chunk.
+ * @param extra The information about the mesh and cells.
+ */
+static void cell_gpart_to_mesh_tile_CIC_mapper(void* map_data, int num,
+                                               void* extra) {
+
+  /* Unpack the shared information */
+  const struct cic_tile_mapper_data* data =
+      (struct cic_tile_mapper_data*)extra;
+  const struct cell* cells = data->cells;
+  mesh_real* rho = data->rho;
+  const int N = data->N;
+  const double fac = data->fac;
+  const double dim[3] = {data->dim[0], data->dim[1], data->dim[2]};
+  const int tile_size = data->tile_size;
+
+  /* Pointer to the chunk to be processed */
+  int* local_cells = (int*)map_data;
+
+  /* Allocate the tile used by this thread */
+  double* tile = (double*)malloc(sizeof(double) * tile_size * tile_size *
+                                 tile_size);
+  if (tile == NULL) error("Error allocating memory for the mesh tile");
+
+  /* Loop over the elements assigned to this thread */
+  for (int c_id = 0; c_id < num; ++c_id) {
+
+    /* Pointer to local cell */
+    const struct cell* c = &cells[local_cells[c_id]];
+
+    if (c->grav.count == 0) continue;
 
 #ifdef SWIFT_DEBUG_CHECKS
-  if (i < 0 || i >= N) error("Invalid gpart position in x");
-  if (j < 0 || j >= N) error("Invalid gpart position in y");
-  if (k < 0 || k >= N) error("Invalid gpart position in z");
+    /* The mesh is only built after the full drift of a rebuild */
+    for (int k = 0; k < c->grav.count; ++k)
+      if (c->grav.parts[k].time_bin != time_bin_not_created &&
+          c->grav.parts[k].ti_drift != data->ti_current)
+        error("gpart not drifted to current time");
 #endif
 
-#ifdef SWIFT_GRAVITY_FORCE_CHECKS
-  if (gp->a_grav_PM[0] != 0. || gp->potential_PM != 0.)
-    error("Particle with non-initalised stuff");
+    /* Extent of the tile: the cell plus one mesh cell on either side and
+     * the extra CIC neighbour at the top */
+    int lo[3], n[3];
+    for (int d = 0; d < 3; ++d) {
+      lo[d] = (int)floor(c->loc[d] * fac) - 1;
+      const int hi = (int)floor((c->loc[d] + c->width[d]) * fac) + 2;
+      n[d] = hi - lo[d] + 1;
+#ifdef SWIFT_DEBUG_CHECKS
+      if (n[d] > tile_size) error("Mesh tile too small for cell");
 #endif
+    }
 
-  /* First, copy the necessary part of the mesh for stencil operations */
-  /* This includes box-wrapping in all 3 dimensions. */
-  double phi[6][6][6];
-  for (int iii = -2; iii <= 3; ++iii) {
-    for (int jjj = -2; jjj <= 3; ++jjj) {
-      for (int kkk = -2; kkk <= 3; ++kkk) {
-        phi[iii + 2][jjj + 2][kkk + 2] =
-            pot[row_major_id_periodic(i + iii, j + jjj, k + kkk, N)];
+    /* Assign the cell's content to the tile */
+    bzero(tile, sizeof(double) * n[0] * n[1] * n[2]);
+    cell_gpart_to_tile_CIC(c, tile, lo, n, N, fac, dim);
+
+    /* Add the tile to the global mesh */
+    for (int i = 0; i < n[0]; ++i) {
+      for (int j = 0; j < n[1]; ++j) {
+        for (int k = 0; k < n[2]; ++k) {
+          rho[row_major_id_periodic(lo[0] + i, lo[1] + j, lo[2] + k, N)] +=
+              tile[i * n[1] * n[2] + j * n[2] + k];
+        }
       }
     }
   }
 
+  free(tile);
+}
+
+/**
+ * @brief Can we use the tiled CIC assignment for a given top-level grid?
+ *
+ * The cells are coloured by the parity of their integer coordinates. Two
+ * cells of the same colour are then at least two cells apart (also across
+ * the periodic boundary if the number of cells is even). Their tiles do not
+ * overlap as long as a top-level cell spans at least 4 mesh cells.
+ *
+ * @param cdim The number of top-level cells along each axis.
+ * @param N The side-length of the mesh.
+ */
+static int mesh_can_use_tiles(const int cdim[3], int N) {
+
+  for (int d = 0; d < 3; ++d) {
+    if (cdim[d] % 2 != 0) return 0;
+    if (N < 4 * cdim[d]) return 0;
+    if (N / cdim[d] + 5 >= N) return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief Assigns the #gpart of the local top-level cells to the density mesh
+ * using the CIC method and private tiles.
+ *
+ * The cells are processed in 8 colour-ordered passes such that no two
+ * threads ever write to the same mesh cell.
+ *
+ * @param s The #space containing the particles.
+ * @param tp The #threadpool object used for parallelisation.
+ * @param rho The density mesh.
+ * @param N the size of the mesh along one axis.
+ * @param fac The width of a mesh cell.
+ */
+static void mesh_assign_CIC_tiled(const struct space* s, struct threadpool* tp,
+                                  mesh_real* rho, int N, double fac) {
+
+  const int* local_cells = s->local_cells_top;
+  const int nr_local_cells = s->nr_local_cells;
+
+  /* Sort the local cells by colour */
+  int* coloured_cells = (int*)malloc(sizeof(int) * nr_local_cells);
+  if (coloured_cells == NULL)
+    error("Error allocating memory for the cell colours");
+  int colour_count[8] = {0};
+  int colour_offset[9] = {0};
+  for (int n = 0; n < nr_local_cells; ++n) {
+    const struct cell* c = &s->cells_top[local_cells[n]];
+    const int i = (int)(c->loc[0] * s->iwidth[0] + 0.5);
+    const int j = (int)(c->loc[1] * s->iwidth[1] + 0.5);
+    const int k = (int)(c->loc[2] * s->iwidth[2] + 0.5);
+    colour_count[(i % 2) * 4 + (j % 2) * 2 + (k % 2)]++;
+  }
+  for (int col = 0; col < 8; ++col)
+    colour_offset[col + 1] = colour_offset[col] + colour_count[col];
+  bzero(colour_count, sizeof(colour_count));
+  for (int n = 0; n < nr_local_cells; ++n) {
+    const struct cell* c = &s->cells_top[local_cells[n]];
+    const int i = (int)(c->loc[0] * s->iwidth[0] + 0.5);
+    const int j = (int)(c->loc[1] * s->iwidth[1] + 0.5);
+    const int k = (int)(c->loc[2] * s->iwidth[2] + 0.5);
+    const int col = (i % 2) * 4 + (j % 2) * 2 + (k % 2);
+    coloured_cells[colour_offset[col] + colour_count[col]++] = local_cells[n];
+  }
+
+  /* Gather the mesh shared information to be used by the threads */
+  struct cic_tile_mapper_data data;
+  data.cells = s->cells_top;
+  data.rho = rho;
+  data.N = N;
+  data.fac = fac;
+  data.dim[0] = s->dim[0];
+  data.dim[1] = s->dim[1];
+  data.dim[2] = s->dim[2];
+  data.tile_size = 0;
+  for (int d = 0; d < 3; ++d)
+    data.tile_size = max(data.tile_size, (int)ceil(s->width[d] * fac) + 5);
+#ifdef SWIFT_DEBUG_CHECKS
+  data.ti_current = s->e->ti_current;
+#endif
+
+  /* One pass per colour */
+  for (int col = 0; col < 8; ++col) {
+    const int count = colour_offset[col + 1] - colour_offset[col];
+    if (count == 0) continue;
+    threadpool_map(tp, cell_gpart_to_mesh_tile_CIC_mapper,
+                   (void*)&coloured_cells[colour_offset[col]], count,
+                   sizeof(int), 0, (void*)&data);
+  }
+
+  free(coloured_cells);
+}
+
+/**
+ * @brief Writes the potential and accelerations interpolated from the mesh
+ * to a gpart.
+ *
+ * @param gp The #gpart.
+ * @param p The interpolated potential.
+ * @param a The interpolated finite-difference (unscaled) accelerations.
+ * @param fac width of a mesh cell.
+ * @param store Store the result in the gpart's mesh fields (multiple
+ * time-stepping) instead of adding it to its acceleration?
+ */
+INLINE static void mesh_write_to_gpart(struct gpart* gp, const double p,
+                                       const double a[3], const double fac,
+                                       const int store) {
+
+  if (store) {
+    const float a_mesh[3] = {fac * a[0], fac * a[1], fac * a[2]};
+    gravity_store_comoving_mesh_force(gp, p, a_mesh);
+    return;
+  }
+
+  gravity_add_comoving_potential(gp, p);
+  gp->a_grav[0] += fac * a[0];
+  gp->a_grav[1] += fac * a[1];
+  gp->a_grav[2] += fac * a[2];
+#ifdef SWIFT_GRAVITY_FORCE_CHECKS
+  gp->potential_PM = p;
+  gp->a_grav_PM[0] = fac * a[0];
+  gp->a_grav_PM[1] = fac * a[1];
+  gp->a_grav_PM[2] = fac * a[2];
+#endif
+}
+
+/**
+ * @brief Computes the potential and accelerations on a gpart from a local
+ * 6x6x6 copy of the potential mesh around it using the CIC method.
+ *
+ * @param gp The #gpart.
+ * @param phi The local copy of the potential mesh centred on (2,2,2).
+ * @param tx First CIC coefficient along x
+ * @param ty First CIC coefficient along y
+ * @param tz First CIC coefficient along z
+ * @param dx Second CIC coefficient along x
+ * @param dy Second CIC coefficient along y
+ * @param dz Second CIC coefficient along z
+ * @param fac width of a mesh cell.
+ * @param store Store the result in the gpart's mesh fields instead of adding
+ * it to its acceleration?
+ */
+INLINE static void CIC_stencil_to_gpart(struct gpart* gp, double phi[6][6][6],
+                                        double tx, double ty, double tz,
+                                        double dx, double dy, double dz,
+                                        double fac, int store) {
+
+#ifdef SWIFT_GRAVITY_FORCE_CHECKS
+  if (!store && (gp->a_grav_PM[0] != 0. || gp->potential_PM != 0.))
+    error("Particle with non-initalised stuff");
+#endif
+
   /* Some local accumulators */
   double p = 0.;
   double a[3] = {0.};
@@ -330,189 +750,1351 @@ void mesh_to_gparts_CIC(struct gpart* gp, const double* pot, int N, double fac,
   /* ---- */
 
   /* Store things back */
-  gravity_add_comoving_potential(gp, p);
-  gp->a_grav[0] += fac * a[0];
-  gp->a_grav[1] += fac * a[1];
-  gp->a_grav[2] += fac * a[2];
-#ifdef SWIFT_GRAVITY_FORCE_CHECKS
-  gp->potential_PM = p;
-  gp->a_grav_PM[0] = fac * a[0];
-  gp->a_grav_PM[1] = fac * a[1];
-  gp->a_grav_PM[2] = fac * a[2];
-#endif
+  mesh_write_to_gpart(gp, p, a, fac, store);
 }
 
-#endif
-
 /**
- * @brief Compute the potential, including periodic correction on the mesh.
- *
- * Interpolates the top-level multipoles on-to a mesh, move to Fourier space,
- * compute the potential including short-range correction and move back
- * to real space. We use CIC for the interpolation.
- *
- * Note that there is no multiplication by G_newton at this stage.
+ * @brief Computes the potential on a gpart from a given mesh using the CIC
+ * method.
  *
- * @param mesh The #pm_mesh used to store the potential.
- * @param s The #space containing the particles.
- * @param tp The #threadpool object used for parallelisation.
- * @param verbose Are we talkative?
+ * @param gp The #gpart.
+ * @param pot The potential mesh.
+ * @param N the size of the mesh along one axis.
+ * @param fac width of a mesh cell.
+ * @param dim The dimensions of the simulation box.
+ * @param store Store the result in the gpart's mesh fields?
  */
-void pm_mesh_compute_potential(struct pm_mesh* mesh, const struct space* s,
-                               struct threadpool* tp, int verbose) {
-
-#ifdef HAVE_FFTW
+void mesh_to_gparts_CIC(struct gpart* gp, const mesh_real* pot, int N,
+                        double fac, const double dim[3], int store) {
 
-  const double r_s = mesh->r_s;
-  const double box_size = s->dim[0];
-  const double dim[3] = {s->dim[0], s->dim[1], s->dim[2]};
-  const int* local_cells = s->local_cells_top;
-  const int nr_local_cells = s->nr_local_cells;
+  /* Box wrap the gpart's position */
+  const double pos_x = box_wrap(gp->x[0], 0., dim[0]);
+  const double pos_y = box_wrap(gp->x[1], 0., dim[1]);
+  const double pos_z = box_wrap(gp->x[2], 0., dim[2]);
 
-  if (r_s <= 0.) error("Invalid value of a_smooth");
-  if (mesh->dim[0] != dim[0] || mesh->dim[1] != dim[1] ||
-      mesh->dim[2] != dim[2])
-    error("Domain size does not match the value stored in the space.");
+  int i = (int)(fac * pos_x);
+  if (i >= N) i = N - 1;
+  const double dx = fac * pos_x - i;
+  const double tx = 1. - dx;
 
-  /* Some useful constants */
-  const int N = mesh->N;
-  const int N_half = N / 2;
-  const double cell_fac = N / box_size;
+  int j = (int)(fac * pos_y);
+  if (j >= N) j = N - 1;
+  const double dy = fac * pos_y - j;
+  const double ty = 1. - dy;
 
-  /* Use the memory allocated for the potential to temporarily store rho */
-  double* restrict rho = mesh->potential;
-  if (rho == NULL) error("Error allocating memory for density mesh");
-  bzero(rho, N * N * N * sizeof(double));
+  int k = (int)(fac * pos_z);
+  if (k >= N) k = N - 1;
+  const double dz = fac * pos_z - k;
+  const double tz = 1. - dz;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (i < 0 || i >= N) error("Invalid gpart position in x");
+  if (j < 0 || j >= N) error("Invalid gpart position in y");
+  if (k < 0 || k >= N) error("Invalid gpart position in z");
+#endif
+
+  /* First, copy the necessary part of the mesh for stencil operations */
+  /* This includes box-wrapping in all 3 dimensions. */
+  double phi[6][6][6];
+  for (int iii = -2; iii <= 3; ++iii) {
+    for (int jjj = -2; jjj <= 3; ++jjj) {
+      for (int kkk = -2; kkk <= 3; ++kkk) {
+        phi[iii + 2][jjj + 2][kkk + 2] =
+            pot[row_major_id_periodic(i + iii, j + jjj, k + kkk, N)];
+      }
+    }
+  }
+
+  /* Apply the CIC and the finite-difference stencil */
+  CIC_stencil_to_gpart(gp, phi, tx, ty, tz, dx, dy, dz, fac, store);
+}
+
+/**
+ * @brief Computes the potential and accelerations on a gpart from a given
+ * mesh using an assignment scheme of arbitrary order.
+ *
+ * As for CIC, the accelerations are obtained from a 5-point finite-difference
+ * stencil on the mesh that is then interpolated to the particle.
+ *
+ * @param gp The #gpart.
+ * @param pot The potential mesh.
+ * @param N the size of the mesh along one axis.
+ * @param fac width of a mesh cell.
+ * @param dim The dimensions of the simulation box.
+ * @param order The order of the assignment scheme.
+ * @param store Store the result in the gpart's mesh fields?
+ */
+static void mesh_to_gparts_generic(struct gpart* gp, const mesh_real* pot,
+                                   int N, double fac, const double dim[3],
+                                   int order, int store) {
+
+#ifdef SWIFT_GRAVITY_FORCE_CHECKS
+  if (!store && (gp->a_grav_PM[0] != 0. || gp->potential_PM != 0.))
+    error("Particle with non-initalised stuff");
+#endif
+
+  /* Box wrap the gpart's position */
+  const double pos[3] = {box_wrap(gp->x[0], 0., dim[0]),
+                         box_wrap(gp->x[1], 0., dim[1]),
+                         box_wrap(gp->x[2], 0., dim[2])};
+
+  /* Workout the weights along each axis */
+  int start[3];
+  double w[3][4];
+  for (int d = 0; d < 3; ++d)
+    mesh_assignment_weights(order, fac * pos[d], &start[d], w[d]);
+
+  /* Some local accumulators */
+  double p = 0.;
+  double a[3] = {0.};
+
+  for (int ii = 0; ii < order; ++ii) {
+    for (int jj = 0; jj < order; ++jj) {
+      for (int kk = 0; kk < order; ++kk) {
+
+        const double wijk = w[0][ii] * w[1][jj] * w[2][kk];
+        const int i = start[0] + ii;
+        const int j = start[1] + jj;
+        const int k = start[2] + kk;
+
+        /* The potential itself */
+        p += wijk * pot[row_major_id_periodic(i, j, k, N)];
+
+        /* 5-point stencil along each axis for the accelerations */
+        a[0] += wijk *
+                ((1. / 12.) * pot[row_major_id_periodic(i + 2, j, k, N)] -
+                 (2. / 3.) * pot[row_major_id_periodic(i + 1, j, k, N)] +
+                 (2. / 3.) * pot[row_major_id_periodic(i - 1, j, k, N)] -
+                 (1. / 12.) * pot[row_major_id_periodic(i - 2, j, k, N)]);
+        a[1] += wijk *
+                ((1. / 12.) * pot[row_major_id_periodic(i, j + 2, k, N)] -
+                 (2. / 3.) * pot[row_major_id_periodic(i, j + 1, k, N)] +
+                 (2. / 3.) * pot[row_major_id_periodic(i, j - 1, k, N)] -
+                 (1. / 12.) * pot[row_major_id_periodic(i, j - 2, k, N)]);
+        a[2] += wijk *
+                ((1. / 12.) * pot[row_major_id_periodic(i, j, k + 2, N)] -
+                 (2. / 3.) * pot[row_major_id_periodic(i, j, k + 1, N)] +
+                 (2. / 3.) * pot[row_major_id_periodic(i, j, k - 1, N)] -
+                 (1. / 12.) * pot[row_major_id_periodic(i, j, k - 2, N)]);
+      }
+    }
+  }
+
+  /* Store things back */
+  mesh_write_to_gpart(gp, p, a, fac, store);
+}
+
+/**
+ * @brief Combines the Fourier transforms of the density on the mesh and on
+ * the mesh shifted by half a cell along each axis (interlacing).
+ *
+ * The shifted transform is brought back to the phase of the main mesh and
+ * the two are averaged, which cancels the leading aliasing contributions.
+ * The result is stored in frho.
+ *
+ * @param frho The Fourier transform of the density field.
+ * @param frho_shift The Fourier transform of the shifted density field.
+ * @param N The side-length of the mesh.
+ */
+static void mesh_interlace(mesh_complex* frho, const mesh_complex* frho_shift,
+                           int N) {
+
+  const int N_half = N / 2;
+  const double k_fac = M_PI / (double)N;
+
+  for (int i = 0; i < N; ++i) {
+    const int kx = (i > N_half ? i - N : i);
+    for (int j = 0; j < N; ++j) {
+      const int ky = (j > N_half ? j - N : j);
+      for (int k = 0; k < N_half + 1; ++k) {
+        const int kz = k;
+
+        /* Phase shift of half a cell along each axis */
+        const double phase = k_fac * (double)(kx + ky + kz);
+        const double c = cos(phase);
+        const double s = sin(phase);
+
+        const int index = N * (N_half + 1) * i + (N_half + 1) * j + k;
+        const double re = frho_shift[index][0] * c - frho_shift[index][1] * s;
+        const double im = frho_shift[index][0] * s + frho_shift[index][1] * c;
+
+        frho[index][0] = 0.5 * (frho[index][0] + re);
+        frho[index][1] = 0.5 * (frho[index][1] + im);
+      }
+    }
+  }
+}
+
+/**
+ * @brief De-convolve the assignment kernel and apply the Green function to a
+ * (possibly partial) set of x-planes of the mesh in Fourier space.
+ *
+ * The planes [local_0_start, local_0_start + local_n0[ are stored in frho
+ * in row-major order with (N/2 + 1) complex numbers along z.
+ *
+ * The kernel of an assignment scheme of order p is sinc^p along each axis.
+ * It is applied twice (assignment and interpolation).
+ *
+ * @param frho The Fourier transform of the density field.
+ * @param N The side-length of the mesh.
+ * @param local_n0 The number of x-planes stored in frho.
+ * @param local_0_start The index of the first x-plane stored in frho.
+ * @param box_size The side-length of the simulation volume.
+ * @param r_s The scale over which the forces are smoothed.
+ * @param order The order of the assignment scheme (2 is CIC).
+ */
+static void mesh_apply_Green_function(mesh_complex* frho, int N, int local_n0,
+                                      int local_0_start, double box_size,
+                                      double r_s, int order) {
+
+  const int N_half = N / 2;
+
+  /* Some common factors */
+  const double green_fac = -1. / (M_PI * box_size);
+  const double a_smooth2 = 4. * M_PI * M_PI * r_s * r_s / (box_size * box_size);
+  const double k_fac = M_PI / (double)N;
+
+  /* Now de-convolve the assignment kernel and apply the Green function */
+  for (int i = 0; i < local_n0; ++i) {
+
+    /* kx component of vector in Fourier space and 1/sinc(kx) */
+    const int i_global = i + local_0_start;
+    const int kx = (i_global > N_half ? i_global - N : i_global);
+    const double kx_d = (double)kx;
+    const double fx = k_fac * kx_d;
+    const double sinc_kx_inv = (kx != 0) ? fx / sin(fx) : 1.;
+
+    for (int j = 0; j < N; ++j) {
+
+      /* ky component of vector in Fourier space and 1/sinc(ky) */
+      const int ky = (j > N_half ? j - N : j);
+      const double ky_d = (double)ky;
+      const double fy = k_fac * ky_d;
+      const double sinc_ky_inv = (ky != 0) ? fy / sin(fy) : 1.;
+
+      for (int k = 0; k < N_half + 1; ++k) {
+
+        /* kz component of vector in Fourier space and 1/sinc(kz) */
+        const int kz = (k > N_half ? k - N : k);
+        const double kz_d = (double)kz;
+        const double fz = k_fac * kz_d;
+        const double sinc_kz_inv = (kz != 0) ? fz / (sin(fz) + FLT_MIN) : 1.;
+
+        /* Norm of vector in Fourier space */
+        const double k2 = (kx_d * kx_d + ky_d * ky_d + kz_d * kz_d);
+
+        /* Avoid FPEs... */
+        if (k2 == 0.) continue;
+
+        /* Green function */
+        double W = 1.;
+        fourier_kernel_long_grav_eval(k2 * a_smooth2, &W);
+        const double green_cor = green_fac * W / (k2 + FLT_MIN);
+
+        /* Deconvolution of CIC */
+        const double CIC_cor = sinc_kx_inv * sinc_ky_inv * sinc_kz_inv;
+        const double CIC_cor2 = CIC_cor * CIC_cor;
+        double assign_cor = CIC_cor2 * CIC_cor2;
+        for (int n = 2; n < order; ++n) assign_cor *= CIC_cor2;
+
+        /* Combined correction */
+        const double total_cor = green_cor * assign_cor;
+
+        /* Apply to the mesh */
+        const int index = N * (N_half + 1) * i + (N_half + 1) * j + k;
+        frho[index][0] *= total_cor;
+        frho[index][1] *= total_cor;
+      }
+    }
+  }
+
+  /* Correct singularity at (0,0,0) */
+  if (local_0_start == 0 && local_n0 > 0) {
+    frho[0][0] = 0.;
+    frho[0][1] = 0.;
+  }
+}
+
+/**
+ * @brief Assigns the mass of the local #gpart to the density mesh (and to the
+ * shifted mesh if interlacing) and combines the contributions of all the
+ * ranks.
+ *
+ * The density is written to mesh->potential (and mesh->rho_shift).
+ *
+ * @param mesh The #pm_mesh.
+ * @param s The #space containing the particles.
+ * @param tp The #threadpool object used for parallelisation.
+ * @param type Only assign the #gpart of this type (-1 for all of them).
+ * @param verbose Are we talkative?
+ */
+static void mesh_deposit(struct pm_mesh* mesh, const struct space* s,
+                         struct threadpool* tp, const int type,
+                         const int verbose) {
+
+  const int N = mesh->N;
+  const double cell_fac = N / s->dim[0];
+  const int* local_cells = s->local_cells_top;
+  const int nr_local_cells = s->nr_local_cells;
+  mesh_real* restrict rho = mesh->potential;
+
+  ticks tic = getticks();
+
+  /* Zero everything */
+  bzero(rho, N * N * N * sizeof(mesh_real));
+
+  /* Gather the mesh shared information to be used by the threads */
+  struct cic_mapper_data data;
+  data.cells = s->cells_top;
+  data.rho = rho;
+  data.N = N;
+  data.fac = cell_fac;
+  data.dim[0] = s->dim[0];
+  data.dim[1] = s->dim[1];
+  data.dim[2] = s->dim[2];
+  data.order = mesh->assignment_order;
+  data.shift = 0.;
+  data.type = type;
+#ifdef SWIFT_DEBUG_CHECKS
+  data.ti_current = s->e->ti_current;
+#endif
+
+  /* Do a parallel mesh assignment of the gparts but only using
+     the local top-level cells */
+  if (type < 0 && mesh->assignment_order == 2 && mesh->tiled_assignment &&
+      mesh_can_use_tiles(s->cdim, N))
+    mesh_assign_CIC_tiled(s, tp, rho, N, cell_fac);
+  else
+    threadpool_map(tp, cell_gpart_to_mesh_CIC_mapper, (void*)local_cells,
+                   nr_local_cells, sizeof(int), 0, (void*)&data);
+
+  /* Same on a mesh shifted by half a cell if we interlace */
+  mesh_real* restrict rho_shift = mesh->rho_shift;
+  if (mesh->interlacing) {
+
+    bzero(rho_shift, N * N * N * sizeof(mesh_real));
+
+    data.rho = rho_shift;
+    data.shift = 0.5;
+    threadpool_map(tp, cell_gpart_to_mesh_CIC_mapper, (void*)local_cells,
+                   nr_local_cells, sizeof(int), 0, (void*)&data);
+  }
+
+  if (verbose)
+    message("Gpart assignment took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+#ifdef WITH_MPI
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  tic = getticks();
+
+  /* Merge everybody's share of the density mesh */
+  MPI_Allreduce(MPI_IN_PLACE, rho, N * N * N, mesh_mpi_real, MPI_SUM,
+                MPI_COMM_WORLD);
+  if (mesh->interlacing)
+    MPI_Allreduce(MPI_IN_PLACE, rho_shift, N * N * N, mesh_mpi_real, MPI_SUM,
+                  MPI_COMM_WORLD);
+
+  if (verbose)
+    message("Mesh comunication took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+#endif
+}
+
+/**
+ * @brief Fourier transforms the density mesh (and combines it with the
+ * shifted mesh if interlacing) into mesh->frho.
+ *
+ * @param mesh The #pm_mesh.
+ * @param verbose Are we talkative?
+ */
+static void mesh_forward_transform(struct pm_mesh* mesh, const int verbose) {
+
+  ticks tic = getticks();
+
+  mesh_fftw(execute)(mesh->forward_plan);
+
+  if (verbose)
+    message("Forward Fourier transform took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  /* Combine with the shifted mesh */
+  if (mesh->interlacing) {
+
+    tic = getticks();
+
+    mesh_fftw(execute)(mesh->forward_plan_shift);
+    mesh_interlace(mesh->frho, mesh->frho_shift, mesh->N);
+
+    if (verbose)
+      message("Interlacing took %.3f %s.", clocks_from_ticks(getticks() - tic),
+              clocks_getunit());
+  }
+}
+
+/**
+ * @brief A power spectrum being measured on the mesh.
+ *
+ * Column 0 is the total matter, column 1 + t the #gpart of type t.
+ */
+struct mesh_power_spectrum {
+
+  /*! Number of bins in |k| (width: the fundamental mode) */
+  int nr_bins;
+
+  /*! Sum of the |k| of the modes in each bin (units of the fundamental) */
+  double* k_sum;
+
+  /*! Number of modes in each bin */
+  long long* nr_modes;
+
+  /*! Shot-noise subtracted power in each bin */
+  double* power[swift_type_count + 1];
+
+  /*! Total mass and sum of the squared masses of each type */
+  double mass[swift_type_count];
+  double mass2[swift_type_count];
+};
+
+/**
+ * @brief Shared information of the mapper summing the #gpart masses.
+ */
+struct mesh_mass_sums_data {
+  const struct cell* cells;
+  double mass[swift_type_count];
+  double mass2[swift_type_count];
+};
+
+/**
+ * @brief Threadpool mapper function summing the masses and squared masses of
+ * the #gpart of the local top-level cells by type.
+ *
+ * @param map_data A chunk of the list of local cells.
+ * @param num The number of cells in the chunk.
+ * @param extra The #mesh_mass_sums_data.
+ */
+static void mesh_mass_sums_mapper(void* map_data, int num, void* extra) {
+
+  struct mesh_mass_sums_data* data = (struct mesh_mass_sums_data*)extra;
+  const int* local_cells = (int*)map_data;
+
+  double mass[swift_type_count] = {0.};
+  double mass2[swift_type_count] = {0.};
+
+  for (int i = 0; i < num; ++i) {
+    const struct cell* c = &data->cells[local_cells[i]];
+    for (int k = 0; k < c->grav.count; ++k) {
+      const struct gpart* gp = &c->grav.parts[k];
+      mass[gp->type] += gp->mass;
+      mass2[gp->type] += gp->mass * gp->mass;
+    }
+  }
+
+  for (int t = 0; t < swift_type_count; ++t) {
+    if (mass[t] == 0.) continue;
+    atomic_add_d(&data->mass[t], mass[t]);
+    atomic_add_d(&data->mass2[t], mass2[t]);
+  }
+}
+
+/**
+ * @brief Adds up the power of the density field in Fourier space in bins of
+ * |k|.
+ *
+ * The assignment window is de-convolved and the shot noise of a set of
+ * particles of total mass M and sum of the squared masses M2 is subtracted.
+ * With frho the transform of the mass on the mesh, the power of a mode is
+ * P(k) = L^3 |frho(k)|^2 / (M^2 W(k)^2) - L^3 M2 / M^2.
+ *
+ * @param frho The Fourier transform of the density field.
+ * @param N The side-length of the mesh.
+ * @param box_size The side-length of the simulation volume.
+ * @param order The order of the assignment scheme (2 is CIC).
+ * @param mass2 The sum of the squared masses of the particles.
+ * @param pk The #mesh_power_spectrum with the bins.
+ * @param power The array of pk->nr_bins power sums to add to.
+ * @param count_modes Also count the modes and their |k| in each bin?
+ */
+static void mesh_bin_power_spectrum(const mesh_complex* frho, const int N,
+                                    const double box_size, const int order,
+                                    const double mass2,
+                                    struct mesh_power_spectrum* pk,
+                                    double* power, const int count_modes) {
+
+  const int N_half = N / 2;
+  const int nr_bins = pk->nr_bins;
+  const double k_fac = M_PI / (double)N;
+
+  /* The total mass is the zero mode */
+  const double mass = frho[0][0];
+  const double volume = box_size * box_size * box_size;
+  const double norm = volume / (mass * mass);
+  const double shot_noise = volume * mass2 / (mass * mass);
+
+  for (int i = 0; i < N; ++i) {
+    const int kx = (i > N_half ? i - N : i);
+    const double fx = k_fac * kx;
+    const double sinc_kx = (kx != 0) ? sin(fx) / fx : 1.;
+
+    for (int j = 0; j < N; ++j) {
+      const int ky = (j > N_half ? j - N : j);
+      const double fy = k_fac * ky;
+      const double sinc_ky = (ky != 0) ? sin(fy) / fy : 1.;
+
+      for (int k = 0; k < N_half + 1; ++k) {
+        const int kz = k;
+        const double fz = k_fac * kz;
+        const double sinc_kz = (kz != 0) ? sin(fz) / fz : 1.;
+
+        const int k2 = kx * kx + ky * ky + kz * kz;
+        if (k2 == 0) continue;
+
+        /* Bins of width the fundamental mode, centred on its multiples */
+        const double k_norm = sqrt((double)k2);
+        const int bin = (int)(k_norm + 0.5) - 1;
+        if (bin >= nr_bins) continue;
+
+        /* The modes with 0 < kz < N/2 stand for their conjugates as well */
+        const int weight = (k == 0 || k == N_half) ? 1 : 2;
+
+        /* Assignment window */
+        const double W = sinc_kx * sinc_ky * sinc_kz;
+        double W2 = W * W;
+        for (int n = 1; n < order; ++n) W2 *= W * W;
+
+        const int index = N * (N_half + 1) * i + (N_half + 1) * j + k;
+        const double mod2 =
+            frho[index][0] * frho[index][0] + frho[index][1] * frho[index][1];
+
+        power[bin] += weight * (norm * mod2 / W2 - shot_noise);
+        if (count_modes) {
+          pk->k_sum[bin] += weight * k_norm;
+          pk->nr_modes[bin] += weight;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Starts the measurement of the power spectrum if an output time has
+ * been reached.
+ *
+ * The spectra of the individual particle types are measured here by
+ * assigning only the particles of each type to the mesh in turn. The total
+ * is measured by mesh_power_spectrum_finish() on the mesh also used for the
+ * forces.
+ *
+ * @param mesh The #pm_mesh.
+ * @param s The #space containing the particles.
+ * @param tp The #threadpool object used for parallelisation.
+ * @return The #mesh_power_spectrum being measured or NULL if it is not time
+ * to measure one.
+ */
+static struct mesh_power_spectrum* mesh_power_spectrum_start(
+    struct pm_mesh* mesh, const struct space* s, struct threadpool* tp) {
+
+  const struct engine* e = s->e;
+  const int with_cosmology = (e->policy & engine_policy_cosmology);
+  const double now = with_cosmology ? e->cosmology->a : e->time;
+  if (now < mesh->power_spectrum_next) return NULL;
+
+  const ticks tic = getticks();
+
+  const int N = mesh->N;
+  const int nr_bins = N / 2;
+
+  struct mesh_power_spectrum* pk = (struct mesh_power_spectrum*)calloc(
+      1, sizeof(struct mesh_power_spectrum));
+  if (pk == NULL) error("Error allocating the power spectrum");
+  pk->nr_bins = nr_bins;
+  pk->k_sum = (double*)calloc(nr_bins, sizeof(double));
+  pk->nr_modes = (long long*)calloc(nr_bins, sizeof(long long));
+  if (pk->k_sum == NULL || pk->nr_modes == NULL)
+    error("Error allocating the power spectrum bins");
+
+  /* Masses of each type, for the shot noise and to skip the absent ones */
+  struct mesh_mass_sums_data sums;
+  bzero(&sums, sizeof(sums));
+  sums.cells = s->cells_top;
+  threadpool_map(tp, mesh_mass_sums_mapper, (void*)s->local_cells_top,
+                 s->nr_local_cells, sizeof(int), 0, &sums);
+#ifdef WITH_MPI
+  MPI_Allreduce(MPI_IN_PLACE, sums.mass, swift_type_count, MPI_DOUBLE, MPI_SUM,
+                MPI_COMM_WORLD);
+  MPI_Allreduce(MPI_IN_PLACE, sums.mass2, swift_type_count, MPI_DOUBLE,
+                MPI_SUM, MPI_COMM_WORLD);
+#endif
+  memcpy(pk->mass, sums.mass, sizeof(sums.mass));
+  memcpy(pk->mass2, sums.mass2, sizeof(sums.mass2));
+
+  pk->power[0] = (double*)calloc(nr_bins, sizeof(double));
+  if (pk->power[0] == NULL) error("Error allocating the power spectrum bins");
+
+  /* Each type in turn. With a single type, its spectrum is the total. */
+  int nr_types = 0;
+  for (int t = 0; t < swift_type_count; ++t)
+    if (pk->mass[t] > 0.) nr_types++;
+
+  if (mesh->power_spectrum_species && nr_types > 1) {
+    for (int t = 0; t < swift_type_count; ++t) {
+      if (pk->mass[t] == 0.) continue;
+
+      pk->power[1 + t] = (double*)calloc(nr_bins, sizeof(double));
+      if (pk->power[1 + t] == NULL)
+        error("Error allocating the power spectrum bins");
+
+      mesh_deposit(mesh, s, tp, t, /*verbose=*/0);
+      mesh_forward_transform(mesh, /*verbose=*/0);
+      mesh_bin_power_spectrum(mesh->frho, N, s->dim[0], mesh->assignment_order,
+                              pk->mass2[t], pk, pk->power[1 + t],
+                              /*count_modes=*/0);
+    }
+  }
+
+  if (e->verbose)
+    message("Measuring the power spectrum of the particle types took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  return pk;
+}
+
+/**
+ * @brief Completes the measurement of the power spectrum with the total
+ * matter, writes it to a file and schedules the next one.
+ *
+ * @param mesh The #pm_mesh containing the transform of the total density.
+ * @param s The #space containing the particles.
+ * @param pk The #mesh_power_spectrum started by mesh_power_spectrum_start().
+ */
+static void mesh_power_spectrum_finish(struct pm_mesh* mesh,
+                                       const struct space* s,
+                                       struct mesh_power_spectrum* pk) {
+
+  const struct engine* e = s->e;
+  const int with_cosmology = (e->policy & engine_policy_cosmology);
+  const int nr_bins = pk->nr_bins;
+  const double box_size = s->dim[0];
+  const double k_fundamental = 2. * M_PI / box_size;
+
+  /* Only one rank needs to bin the (replicated) mesh and write the file */
+  if (e->nodeID == 0) {
+
+    const ticks tic = getticks();
+
+    double mass2 = 0.;
+    for (int t = 0; t < swift_type_count; ++t) mass2 += pk->mass2[t];
+
+    mesh_bin_power_spectrum(mesh->frho, mesh->N, box_size,
+                            mesh->assignment_order, mass2, pk, pk->power[0],
+                            /*count_modes=*/1);
+
+    char filename[PARSER_MAX_LINE_SIZE + 16];
+    snprintf(filename, sizeof(filename), "%s_%04d.txt",
+             mesh->power_spectrum_basename, mesh->power_spectrum_count);
+    FILE* file = fopen(filename, "w");
+    if (file == NULL)
+      error("Could not open the power spectrum file '%s'", filename);
+
+    fprintf(file, "# Power spectrum measured on the gravity mesh\n");
+    fprintf(file, "# Mesh side-length: %d (assignment order %d%s)\n", mesh->N,
+            mesh->assignment_order, mesh->interlacing ? ", interlaced" : "");
+    fprintf(file, "# Box size: %e [internal units]\n", box_size);
+    if (with_cosmology)
+      fprintf(file, "# Scale-factor: %e Redshift: %e\n", e->cosmology->a,
+              e->cosmology->z);
+    fprintf(file, "# Time: %e [internal units]\n", e->time);
+    fprintf(file,
+            "# Assignment window de-convolved and shot noise subtracted.\n");
+    fprintf(file, "# (0) k [internal units^-1] (1) number of modes");
+    fprintf(file, " (2) P(k) total [internal units^3]");
+    int column = 3;
+    for (int t = 0; t < swift_type_count; ++t)
+      if (pk->power[1 + t] != NULL)
+        fprintf(file, " (%d) P(k) %s", column++, part_type_names[t]);
+    fprintf(file, "\n");
+
+    for (int b = 0; b < nr_bins; ++b) {
+      if (pk->nr_modes[b] == 0) continue;
+      const double nr_modes = (double)pk->nr_modes[b];
+      fprintf(file, "%e %lld", k_fundamental * pk->k_sum[b] / nr_modes,
+              pk->nr_modes[b]);
+      for (int c = 0; c < swift_type_count + 1; ++c)
+        if (pk->power[c] != NULL)
+          fprintf(file, " %e", pk->power[c][b] / nr_modes);
+      fprintf(file, "\n");
+    }
+    fclose(file);
+
+    if (e->verbose)
+      message("Writing the power spectrum '%s' took %.3f %s.", filename,
+              clocks_from_ticks(getticks() - tic), clocks_getunit());
+  }
+
+  for (int c = 0; c < swift_type_count + 1; ++c) free(pk->power[c]);
+  free(pk->k_sum);
+  free(pk->nr_modes);
+  free(pk);
+
+  /* Schedule the next measurement */
+  const double now = with_cosmology ? e->cosmology->a : e->time;
+  while (mesh->power_spectrum_next <= now) {
+    if (with_cosmology)
+      mesh->power_spectrum_next *= mesh->power_spectrum_delta;
+    else
+      mesh->power_spectrum_next += mesh->power_spectrum_delta;
+  }
+  mesh->power_spectrum_count++;
+}
+
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+
+/**
+ * @brief A (mesh cell index, value) pair exchanged between ranks when using
+ * the distributed mesh.
+ */
+struct mesh_key_value {
+
+  /*! Row-major index of the mesh cell */
+  size_t key;
+
+  /*! The value (mass or potential) in that cell */
+  double value;
+};
+
+/**
+ * @brief Add a value to a mesh cell stored in a #hashmap_t.
+ *
+ * @param map The #hashmap_t representing the (sparse) mesh.
+ * @param key The row-major index of the mesh cell.
+ * @param value The value to add.
+ */
+INLINE static void mesh_map_add(hashmap_t* map, size_t key, double value) {
+
+  int created = 0;
+  hashmap_value_t* v = hashmap_get_new(map, key, &created);
+  if (created) v->value_dbl = 0.;
+  v->value_dbl += value;
+}
+
+/**
+ * @brief Assigns all the #gpart of a #cell to a sparse density mesh stored in
+ * a #hashmap_t using the CIC method.
+ *
+ * @param c The #cell.
+ * @param map The #hashmap_t representing the density mesh.
+ * @param N the size of the mesh along one axis.
+ * @param fac The width of a mesh cell.
+ * @param dim The dimensions of the simulation box.
+ */
+static void cell_gpart_to_mesh_map_CIC(const struct cell* c, hashmap_t* map,
+                                       int N, double fac,
+                                       const double dim[3]) {
+
+  const int gcount = c->grav.count;
+  const struct gpart* gparts = c->grav.parts;
+
+  for (int p = 0; p < gcount; ++p) {
+
+    const struct gpart* gp = &gparts[p];
+
+    /* Box wrap the particle's position */
+    const double pos_x = box_wrap(gp->x[0], 0., dim[0]);
+    const double pos_y = box_wrap(gp->x[1], 0., dim[1]);
+    const double pos_z = box_wrap(gp->x[2], 0., dim[2]);
+
+    /* Workout the CIC coefficients */
+    int i = (int)(fac * pos_x);
+    if (i >= N) i = N - 1;
+    const double dx = fac * pos_x - i;
+    const double tx = 1. - dx;
+
+    int j = (int)(fac * pos_y);
+    if (j >= N) j = N - 1;
+    const double dy = fac * pos_y - j;
+    const double ty = 1. - dy;
+
+    int k = (int)(fac * pos_z);
+    if (k >= N) k = N - 1;
+    const double dz = fac * pos_z - k;
+    const double tz = 1. - dz;
+
+    const double m = gp->mass;
+
+    /* CIC ! */
+    mesh_map_add(map, row_major_id_periodic(i + 0, j + 0, k + 0, N),
+                 m * tx * ty * tz);
+    mesh_map_add(map, row_major_id_periodic(i + 0, j + 0, k + 1, N),
+                 m * tx * ty * dz);
+    mesh_map_add(map, row_major_id_periodic(i + 0, j + 1, k + 0, N),
+                 m * tx * dy * tz);
+    mesh_map_add(map, row_major_id_periodic(i + 0, j + 1, k + 1, N),
+                 m * tx * dy * dz);
+    mesh_map_add(map, row_major_id_periodic(i + 1, j + 0, k + 0, N),
+                 m * dx * ty * tz);
+    mesh_map_add(map, row_major_id_periodic(i + 1, j + 0, k + 1, N),
+                 m * dx * ty * dz);
+    mesh_map_add(map, row_major_id_periodic(i + 1, j + 1, k + 0, N),
+                 m * dx * dy * tz);
+    mesh_map_add(map, row_major_id_periodic(i + 1, j + 1, k + 1, N),
+                 m * dx * dy * dz);
+  }
+}
+
+/**
+ * @brief Shared information used by the threads assigning the #gpart to the
+ * sparse distributed density mesh.
+ */
+struct cic_map_mapper_data {
+  const struct cell* cells;
+  hashmap_t* map;
+  swift_lock_type lock;
+  int N;
+  double fac;
+  double dim[3];
+};
+
+/**
+ * @brief Hashmap mapper adding one element to another #hashmap_t.
+ */
+static void mesh_map_merge_mapper(hashmap_key_t key, hashmap_value_t* value,
+                                  void* data) {
+  mesh_map_add((hashmap_t*)data, key, value->value_dbl);
+}
+
+/**
+ * @brief Threadpool mapper function for the sparse mesh CIC assignment of a
+ * set of cells.
+ *
+ * Each chunk is assigned to a private #hashmap_t without any atomics. The
+ * result is then merged into the global one under a lock.
+ *
+ * @param map_data A chunk of the list of local cells.
+ * @param num The number of cells in the chunk.
+ * @param extra The information about the mesh and cells.
+ */
+static void cell_gpart_to_mesh_map_CIC_mapper(void* map_data, int num,
+                                              void* extra) {
+
+  struct cic_map_mapper_data* data = (struct cic_map_mapper_data*)extra;
+  const int* local_cells = (int*)map_data;
+
+  hashmap_t local_map;
+  hashmap_init(&local_map);
+
+  for (int i = 0; i < num; ++i) {
+    const struct cell* c = &data->cells[local_cells[i]];
+    cell_gpart_to_mesh_map_CIC(c, &local_map, data->N, data->fac, data->dim);
+  }
+
+  /* Add our share to the global map */
+  if (lock_lock(&data->lock) != 0) error("Impossible to lock the mesh map");
+  hashmap_iterate(&local_map, mesh_map_merge_mapper, data->map);
+  if (lock_unlock(&data->lock) != 0) error("Impossible to unlock the mesh map");
+
+  hashmap_free(&local_map);
+}
+
+/**
+ * @brief Data used to split the elements of a #hashmap_t by owner rank.
+ */
+struct mesh_map_split_data {
+  const int* plane_owner;
+  size_t N2;
+  int* counts;
+  int* cursor;
+  struct mesh_key_value* buffer;
+};
+
+/**
+ * @brief Hashmap mapper counting the number of elements owned by each rank.
+ */
+static void mesh_map_count_mapper(hashmap_key_t key, hashmap_value_t* value,
+                                  void* extra) {
+  struct mesh_map_split_data* data = (struct mesh_map_split_data*)extra;
+  data->counts[data->plane_owner[key / data->N2]]++;
+}
+
+/**
+ * @brief Hashmap mapper copying the elements to a buffer sorted by owner.
+ */
+static void mesh_map_fill_mapper(hashmap_key_t key, hashmap_value_t* value,
+                                 void* extra) {
+  struct mesh_map_split_data* data = (struct mesh_map_split_data*)extra;
+  const int owner = data->plane_owner[key / data->N2];
+  struct mesh_key_value* kv = &data->buffer[data->cursor[owner]++];
+  kv->key = key;
+  kv->value = value->value_dbl;
+}
+
+/**
+ * @brief Sends the content of a sparse mesh to the ranks owning the
+ * corresponding planes.
+ *
+ * @param mesh The #pm_mesh (for the slab decomposition).
+ * @param map The sparse mesh to send.
+ * @param recv (return) The elements received by this rank.
+ * @param nr_recv (return) The number of elements received.
+ * @param send (return) The elements sent by this rank, sorted by rank.
+ * @param send_counts (return) The number of elements sent to each rank.
+ * @param recv_counts (return) The number of elements received from each rank.
+ */
+static void mesh_map_exchange(const struct pm_mesh* mesh, hashmap_t* map,
+                              struct mesh_key_value** recv, size_t* nr_recv,
+                              struct mesh_key_value** send, int* send_counts,
+                              int* recv_counts) {
+
+  int nr_nodes;
+  MPI_Comm_size(MPI_COMM_WORLD, &nr_nodes);
+
+  /* MPI type for the exchanged elements */
+  MPI_Datatype kv_type;
+  if (MPI_Type_contiguous(sizeof(struct mesh_key_value), MPI_BYTE, &kv_type) !=
+          MPI_SUCCESS ||
+      MPI_Type_commit(&kv_type) != MPI_SUCCESS)
+    error("Failed to create MPI type for mesh elements.");
+
+  /* Count how much goes to each rank */
+  int* cursor = (int*)calloc(nr_nodes, sizeof(int));
+  if (cursor == NULL) error("Failed to allocate mesh exchange counters.");
+  bzero(send_counts, nr_nodes * sizeof(int));
+  struct mesh_map_split_data data;
+  data.plane_owner = mesh->plane_owner;
+  data.N2 = (size_t)mesh->N * (size_t)mesh->N;
+  data.counts = send_counts;
+  data.cursor = cursor;
+  data.buffer = NULL;
+  hashmap_iterate(map, mesh_map_count_mapper, &data);
+
+  /* Sort the elements by destination */
+  int* send_offsets = (int*)malloc(nr_nodes * sizeof(int));
+  int* recv_offsets = (int*)malloc(nr_nodes * sizeof(int));
+  if (send_offsets == NULL || recv_offsets == NULL)
+    error("Failed to allocate mesh exchange offsets.");
+  size_t nr_send = 0;
+  for (int k = 0; k < nr_nodes; ++k) {
+    send_offsets[k] = nr_send;
+    cursor[k] = nr_send;
+    nr_send += send_counts[k];
+  }
+  *send = (struct mesh_key_value*)malloc(
+      (nr_send > 0 ? nr_send : 1) * sizeof(struct mesh_key_value));
+  if (*send == NULL) error("Failed to allocate mesh send buffer.");
+  data.buffer = *send;
+  hashmap_iterate(map, mesh_map_fill_mapper, &data);
+
+  /* Tell everybody how much they are getting */
+  MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT,
+               MPI_COMM_WORLD);
+  *nr_recv = 0;
+  for (int k = 0; k < nr_nodes; ++k) {
+    recv_offsets[k] = *nr_recv;
+    *nr_recv += recv_counts[k];
+  }
+  *recv = (struct mesh_key_value*)malloc(
+      (*nr_recv > 0 ? *nr_recv : 1) * sizeof(struct mesh_key_value));
+  if (*recv == NULL) error("Failed to allocate mesh receive buffer.");
+
+  /* And ship everything in one go */
+  MPI_Alltoallv(*send, send_counts, send_offsets, kv_type, *recv, recv_counts,
+                recv_offsets, kv_type, MPI_COMM_WORLD);
+
+  MPI_Type_free(&kv_type);
+  free(send_offsets);
+  free(recv_offsets);
+  free(cursor);
+}
+
+/**
+ * @brief Returns the index of a mesh cell in the local (padded) slab.
+ */
+INLINE static size_t mesh_slab_index(const struct pm_mesh* mesh, size_t key) {
+
+  const size_t N = mesh->N;
+  const size_t i = key / (N * N) - mesh->local_0_start;
+  const size_t j = (key / N) % N;
+  const size_t k = key % N;
+  return (i * N + j) * (2 * (N / 2 + 1)) + k;
+}
+
+/**
+ * @brief Fetch the values of the potential needed by the local #gpart from
+ * the ranks owning the corresponding slabs.
+ *
+ * The region fetched for each local top-level cell covers the cell extended
+ * by half its width on each side plus the CIC and stencil extent, such that
+ * particles can drift until the next rebuild.
+ *
+ * @param mesh The #pm_mesh.
+ * @param s The #space containing the particles.
+ * @param slab The local slab of the potential.
+ */
+static void mesh_fetch_potential(struct pm_mesh* mesh, const struct space* s,
+                                 const mesh_real* slab) {
+
+  int nr_nodes;
+  MPI_Comm_size(MPI_COMM_WORLD, &nr_nodes);
+
+  const int N = mesh->N;
+  const double fac = mesh->cell_fac;
+
+  /* Collect the list of mesh cells we need */
+  hashmap_t* needed = (hashmap_t*)malloc(sizeof(hashmap_t));
+  if (needed == NULL) error("Failed to allocate the local potential map.");
+  hashmap_init(needed);
+
+  for (int n = 0; n < s->nr_local_cells; ++n) {
+    const struct cell* c = &s->cells_top[s->local_cells_top[n]];
+    if (c->grav.count == 0) continue;
+
+    int lo[3], hi[3];
+    for (int d = 0; d < 3; ++d) {
+      const double margin = 0.5 * c->width[d];
+      lo[d] = (int)floor(fac * (c->loc[d] - margin)) - 3;
+      hi[d] = (int)floor(fac * (c->loc[d] + c->width[d] + margin)) + 4;
+      if (hi[d] - lo[d] >= N) {
+        lo[d] = 0;
+        hi[d] = N - 1;
+      }
+    }
+
+    for (int i = lo[0]; i <= hi[0]; ++i)
+      for (int j = lo[1]; j <= hi[1]; ++j)
+        for (int k = lo[2]; k <= hi[2]; ++k)
+          mesh_map_add(needed, row_major_id_periodic(i, j, k, N), 0.);
+  }
+
+  /* Send the requests to the owners */
+  int* send_counts = (int*)malloc(nr_nodes * sizeof(int));
+  int* recv_counts = (int*)malloc(nr_nodes * sizeof(int));
+  if (send_counts == NULL || recv_counts == NULL)
+    error("Failed to allocate mesh exchange counts.");
+  struct mesh_key_value *requests, *replies;
+  size_t nr_requests;
+  mesh_map_exchange(mesh, needed, &requests, &nr_requests, &replies,
+                    send_counts, recv_counts);
+
+  /* Answer the requests from our slab */
+  for (size_t n = 0; n < nr_requests; ++n)
+    requests[n].value = slab[mesh_slab_index(mesh, requests[n].key)];
+
+  /* Send the answers back (the counts are now swapped) */
+  int* send_offsets = (int*)malloc(nr_nodes * sizeof(int));
+  int* recv_offsets = (int*)malloc(nr_nodes * sizeof(int));
+  if (send_offsets == NULL || recv_offsets == NULL)
+    error("Failed to allocate mesh exchange offsets.");
+  size_t nr_replies = 0;
+  size_t count = 0;
+  for (int k = 0; k < nr_nodes; ++k) {
+    send_offsets[k] = count;
+    count += recv_counts[k];
+    recv_offsets[k] = nr_replies;
+    nr_replies += send_counts[k];
+  }
+
+  MPI_Datatype kv_type;
+  if (MPI_Type_contiguous(sizeof(struct mesh_key_value), MPI_BYTE, &kv_type) !=
+          MPI_SUCCESS ||
+      MPI_Type_commit(&kv_type) != MPI_SUCCESS)
+    error("Failed to create MPI type for mesh elements.");
+  MPI_Alltoallv(requests, recv_counts, send_offsets, kv_type, replies,
+                send_counts, recv_offsets, kv_type, MPI_COMM_WORLD);
+  MPI_Type_free(&kv_type);
+
+  /* Store the potential values we got back */
+  for (size_t n = 0; n < nr_replies; ++n)
+    hashmap_lookup(needed, replies[n].key)->value_dbl = replies[n].value;
+
+  mesh->potential_local = needed;
+
+  free(requests);
+  free(replies);
+  free(send_counts);
+  free(recv_counts);
+  free(send_offsets);
+  free(recv_offsets);
+}
+
+/**
+ * @brief Computes the potential on a gpart from the potential values fetched
+ * from the distributed mesh using the CIC method.
+ *
+ * @param gp The #gpart.
+ * @param pot The sparse potential mesh.
+ * @param N the size of the mesh along one axis.
+ * @param fac width of a mesh cell.
+ * @param dim The dimensions of the simulation box.
+ * @param store Store the result in the gpart's mesh fields?
+ */
+static void mesh_map_to_gparts_CIC(struct gpart* gp, hashmap_t* pot, int N,
+                                   double fac, const double dim[3], int store) {
+
+  /* Box wrap the gpart's position */
+  const double pos_x = box_wrap(gp->x[0], 0., dim[0]);
+  const double pos_y = box_wrap(gp->x[1], 0., dim[1]);
+  const double pos_z = box_wrap(gp->x[2], 0., dim[2]);
+
+  int i = (int)(fac * pos_x);
+  if (i >= N) i = N - 1;
+  const double dx = fac * pos_x - i;
+  const double tx = 1. - dx;
+
+  int j = (int)(fac * pos_y);
+  if (j >= N) j = N - 1;
+  const double dy = fac * pos_y - j;
+  const double ty = 1. - dy;
+
+  int k = (int)(fac * pos_z);
+  if (k >= N) k = N - 1;
+  const double dz = fac * pos_z - k;
+  const double tz = 1. - dz;
+
+  /* Copy the necessary part of the mesh for stencil operations */
+  double phi[6][6][6];
+  for (int iii = -2; iii <= 3; ++iii) {
+    for (int jjj = -2; jjj <= 3; ++jjj) {
+      for (int kkk = -2; kkk <= 3; ++kkk) {
+        const hashmap_value_t* v = hashmap_lookup(
+            pot, row_major_id_periodic(i + iii, j + jjj, k + kkk, N));
+        if (v == NULL)
+          error(
+              "gpart moved outside of the region of the distributed mesh "
+              "fetched at the last rebuild.");
+        phi[iii + 2][jjj + 2][kkk + 2] = v->value_dbl;
+      }
+    }
+  }
+
+  /* Apply the CIC and the finite-difference stencil */
+  CIC_stencil_to_gpart(gp, phi, tx, ty, tz, dx, dy, dz, fac, store);
+}
+
+/**
+ * @brief Compute the potential using the mesh distributed over the ranks as
+ * slabs of x-planes.
+ *
+ * Every rank assigns its #gpart to a sparse mesh that is then shipped to the
+ * slab owners in a single all-to-all exchange. The FFTs are done with the
+ * MPI version of FFTW and every rank finally fetches the values of the
+ * potential around its own cells.
+ *
+ * @param mesh The #pm_mesh used to store the potential.
+ * @param s The #space containing the particles.
+ * @param tp The #threadpool object used for parallelisation.
+ * @param verbose Are we talkative?
+ */
+static void pm_mesh_compute_potential_distributed(struct pm_mesh* mesh,
+                                                  const struct space* s,
+                                                  struct threadpool* tp,
+                                                  int verbose) {
+
+  const int N = mesh->N;
+  const int N_half = N / 2;
+  const double box_size = s->dim[0];
+  const int local_n0 = mesh->local_n0;
+  const int local_0_start = mesh->local_0_start;
 
-  /* Allocates some memory for the mesh in Fourier space */
-  fftw_complex* restrict frho =
-      (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * N * N * (N_half + 1));
-  if (frho == NULL)
-    error("Error allocating memory for transform of density mesh");
-  memuse_log_allocation("fftw_frho", frho, 1,
-                        sizeof(fftw_complex) * N * N * (N_half + 1));
+  int nr_nodes;
+  MPI_Comm_size(MPI_COMM_WORLD, &nr_nodes);
+
+  /* Get rid of the potential of the previous rebuild */
+  if (mesh->potential_local != NULL) {
+    hashmap_free(mesh->potential_local);
+    free(mesh->potential_local);
+    mesh->potential_local = NULL;
+  }
+
+  /* Allocate the local (padded) slab used for the in-place transforms */
+  ptrdiff_t local_n0_fftw, local_0_start_fftw;
+  const ptrdiff_t alloc_local =
+      mesh_fftw(mpi_local_size_3d)(N, N, N_half + 1, MPI_COMM_WORLD,
+                                   &local_n0_fftw, &local_0_start_fftw);
+  mesh_real* restrict slab = mesh_fftw(alloc_real)(2 * alloc_local);
+  if (slab == NULL) error("Error allocating memory for the mesh slab");
+  memuse_log_allocation("fftw_mesh.slab", slab, 1,
+                        sizeof(mesh_real) * 2 * alloc_local);
+  memuse_account_category(memuse_category_mesh,
+                          sizeof(mesh_real) * 2 * alloc_local);
+  bzero(slab, sizeof(mesh_real) * 2 * alloc_local);
+  mesh_complex* restrict frho = (mesh_complex*)slab;
 
   /* Prepare the FFT library */
-  fftw_plan forward_plan = fftw_plan_dft_r2c_3d(
-      N, N, N, rho, frho, FFTW_ESTIMATE | FFTW_DESTROY_INPUT);
-  fftw_plan inverse_plan = fftw_plan_dft_c2r_3d(
-      N, N, N, frho, rho, FFTW_ESTIMATE | FFTW_DESTROY_INPUT);
+  mesh_plan forward_plan = mesh_fftw(mpi_plan_dft_r2c_3d)(
+      N, N, N, slab, frho, MPI_COMM_WORLD, FFTW_ESTIMATE);
+  mesh_plan inverse_plan = mesh_fftw(mpi_plan_dft_c2r_3d)(
+      N, N, N, frho, slab, MPI_COMM_WORLD, FFTW_ESTIMATE);
 
   ticks tic = getticks();
 
-  /* Zero everything */
-  bzero(rho, N * N * N * sizeof(double));
-
-  /* Gather the mesh shared information to be used by the threads */
-  struct cic_mapper_data data;
+  /* Do a parallel CIC assignment of the local gparts to a sparse mesh */
+  hashmap_t rho_map;
+  hashmap_init(&rho_map);
+  struct cic_map_mapper_data data;
   data.cells = s->cells_top;
-  data.rho = rho;
+  data.map = &rho_map;
+  if (lock_init(&data.lock) != 0) error("Impossible to init the mesh lock");
   data.N = N;
-  data.fac = cell_fac;
-  data.dim[0] = dim[0];
-  data.dim[1] = dim[1];
-  data.dim[2] = dim[2];
-
-  /* Do a parallel CIC mesh assignment of the gparts but only using
-     the local top-level cells */
-  threadpool_map(tp, cell_gpart_to_mesh_CIC_mapper, (void*)local_cells,
-                 nr_local_cells, sizeof(int), 0, (void*)&data);
+  data.fac = mesh->cell_fac;
+  data.dim[0] = s->dim[0];
+  data.dim[1] = s->dim[1];
+  data.dim[2] = s->dim[2];
+  threadpool_map(tp, cell_gpart_to_mesh_map_CIC_mapper,
+                 (void*)s->local_cells_top, s->nr_local_cells, sizeof(int), 0,
+                 (void*)&data);
+  if (lock_destroy(&data.lock) != 0) error("Impossible to destroy the lock");
 
   if (verbose)
     message("Gpart assignment took %.3f %s.",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 
-#ifdef WITH_MPI
-
-  MPI_Barrier(MPI_COMM_WORLD);
   tic = getticks();
 
-  /* Merge everybody's share of the density mesh */
-  MPI_Allreduce(MPI_IN_PLACE, rho, N * N * N, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+  /* Ship the mass to the slab owners */
+  int* send_counts = (int*)malloc(nr_nodes * sizeof(int));
+  int* recv_counts = (int*)malloc(nr_nodes * sizeof(int));
+  if (send_counts == NULL || recv_counts == NULL)
+    error("Failed to allocate mesh exchange counts.");
+  struct mesh_key_value *recv, *send;
+  size_t nr_recv;
+  mesh_map_exchange(mesh, &rho_map, &recv, &nr_recv, &send, send_counts,
+                    recv_counts);
+  hashmap_free(&rho_map);
+  free(send);
+  free(send_counts);
+  free(recv_counts);
+
+  /* Accumulate what we received in our slab */
+  for (size_t n = 0; n < nr_recv; ++n)
+    slab[mesh_slab_index(mesh, recv[n].key)] += recv[n].value;
+  free(recv);
 
   if (verbose)
     message("Mesh comunication took %.3f %s.",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
-#endif
-
-  /* message("\n\n\n DENSITY"); */
-  /* print_array(rho, N); */
 
   tic = getticks();
 
   /* Fourier transform to go to magic-land */
-  fftw_execute(forward_plan);
+  mesh_fftw(execute)(forward_plan);
 
   if (verbose)
     message("Forward Fourier transform took %.3f %s.",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 
-  /* frho now contains the Fourier transform of the density field */
-  /* frho contains NxNx(N/2+1) complex numbers */
+  tic = getticks();
+
+  /* Apply the Green function to our planes */
+  mesh_apply_Green_function(frho, N, local_n0, local_0_start, box_size,
+                            mesh->r_s, /*order=*/2);
+
+  if (verbose)
+    message("Applying Green function took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
 
   tic = getticks();
 
-  /* Some common factors */
-  const double green_fac = -1. / (M_PI * box_size);
-  const double a_smooth2 = 4. * M_PI * M_PI * r_s * r_s / (box_size * box_size);
-  const double k_fac = M_PI / (double)N;
+  /* Fourier transform to come back from magic-land */
+  mesh_fftw(execute)(inverse_plan);
 
-  /* Now de-convolve the CIC kernel and apply the Green function */
-  for (int i = 0; i < N; ++i) {
+  if (verbose)
+    message("Backwards Fourier transform took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
 
-    /* kx component of vector in Fourier space and 1/sinc(kx) */
-    const int kx = (i > N_half ? i - N : i);
-    const double kx_d = (double)kx;
-    const double fx = k_fac * kx_d;
-    const double sinc_kx_inv = (kx != 0) ? fx / sin(fx) : 1.;
+  tic = getticks();
 
-    for (int j = 0; j < N; ++j) {
+  /* Get the bits of potential we need */
+  mesh_fetch_potential(mesh, s, slab);
 
-      /* ky component of vector in Fourier space and 1/sinc(ky) */
-      const int ky = (j > N_half ? j - N : j);
-      const double ky_d = (double)ky;
-      const double fy = k_fac * ky_d;
-      const double sinc_ky_inv = (ky != 0) ? fy / sin(fy) : 1.;
+  if (verbose)
+    message("Fetching the local potential (%zu cells) took %.3f %s.",
+            hashmap_size(mesh->potential_local),
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
 
-      for (int k = 0; k < N_half + 1; ++k) {
+  /* Clean-up the mess */
+  mesh_fftw(destroy_plan)(forward_plan);
+  mesh_fftw(destroy_plan)(inverse_plan);
+  memuse_log_allocation("fftw_mesh.slab", slab, 0, 0);
+  memuse_account_category(memuse_category_mesh,
+                          -(long long)(sizeof(mesh_real) * 2 * alloc_local));
+  mesh_fftw(free)(slab);
+}
 
-        /* kz component of vector in Fourier space and 1/sinc(kz) */
-        const int kz = (k > N_half ? k - N : k);
-        const double kz_d = (double)kz;
-        const double fz = k_fac * kz_d;
-        const double sinc_kz_inv = (kz != 0) ? fz / (sin(fz) + FLT_MIN) : 1.;
+#endif /* WITH_MPI && HAVE_MPI_FFTW */
 
-        /* Norm of vector in Fourier space */
-        const double k2 = (kx_d * kx_d + ky_d * ky_d + kz_d * kz_d);
+#endif
 
-        /* Avoid FPEs... */
-        if (k2 == 0.) continue;
+/**
+ * @brief Compute the potential, including periodic correction on the mesh.
+ *
+ * Interpolates the top-level multipoles on-to a mesh, move to Fourier space,
+ * compute the potential including short-range correction and move back
+ * to real space. We use CIC, TSC or PCS for the interpolation, optionally
+ * interlaced with a mesh shifted by half a cell.
+ *
+ * Note that there is no multiplication by G_newton at this stage.
+ *
+ * @param mesh The #pm_mesh used to store the potential.
+ * @param s The #space containing the particles.
+ * @param tp The #threadpool object used for parallelisation.
+ * @param verbose Are we talkative?
+ */
+void pm_mesh_compute_potential(struct pm_mesh* mesh, const struct space* s,
+                               struct threadpool* tp, int verbose) {
 
-        /* Green function */
-        double W = 1.;
-        fourier_kernel_long_grav_eval(k2 * a_smooth2, &W);
-        const double green_cor = green_fac * W / (k2 + FLT_MIN);
+#ifdef HAVE_FFTW
 
-        /* Deconvolution of CIC */
-        const double CIC_cor = sinc_kx_inv * sinc_ky_inv * sinc_kz_inv;
-        const double CIC_cor2 = CIC_cor * CIC_cor;
-        const double CIC_cor4 = CIC_cor2 * CIC_cor2;
+  const double r_s = mesh->r_s;
+  const double box_size = s->dim[0];
+  const double dim[3] = {s->dim[0], s->dim[1], s->dim[2]};
 
-        /* Combined correction */
-        const double total_cor = green_cor * CIC_cor4;
+  if (r_s <= 0.) error("Invalid value of a_smooth");
+  if (mesh->dim[0] != dim[0] || mesh->dim[1] != dim[1] ||
+      mesh->dim[2] != dim[2])
+    error("Domain size does not match the value stored in the space.");
 
-        /* Apply to the mesh */
-        const int index = N * (N_half + 1) * i + (N_half + 1) * j + k;
-        frho[index][0] *= total_cor;
-        frho[index][1] *= total_cor;
-      }
-    }
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+  if (mesh->distributed_mesh) {
+    pm_mesh_compute_potential_distributed(mesh, s, tp, verbose);
+    return;
   }
+#endif
 
-  /* Correct singularity at (0,0,0) */
-  frho[0][0] = 0.;
-  frho[0][1] = 0.;
+  /* Some useful constants */
+  const int N = mesh->N;
+
+  /* Measure the power spectrum of each particle type before the mesh is
+   * used for the total density */
+  struct mesh_power_spectrum* pk = NULL;
+  if (mesh->power_spectrum) pk = mesh_power_spectrum_start(mesh, s, tp);
+
+  /* Use the memory allocated for the potential to temporarily store rho */
+  mesh_real* restrict rho = mesh->potential;
+  if (rho == NULL) error("Error allocating memory for density mesh");
+
+  /* Assign the mass of all the particles to the mesh */
+  mesh_deposit(mesh, s, tp, /*type=*/-1, verbose);
+
+  /* message("\n\n\n DENSITY"); */
+  /* print_array(rho, N); */
+
+  /* The mesh in Fourier space and the FFT plans are kept in the structure */
+  mesh_complex* restrict frho = mesh->frho;
+
+  /* Fourier transform to go to magic-land */
+  mesh_forward_transform(mesh, verbose);
+
+  /* frho now contains the Fourier transform of the density field */
+  /* frho contains NxNx(N/2+1) complex numbers */
+
+  /* Complete and write the power spectrum */
+  if (pk != NULL) mesh_power_spectrum_finish(mesh, s, pk);
+
+  ticks tic = getticks();
+
+  /* Now de-convolve the assignment kernel and apply the Green function */
+  mesh_apply_Green_function(frho, N, /*local_n0=*/N, /*local_0_start=*/0,
+                            box_size, r_s, mesh->assignment_order);
 
   if (verbose)
     message("Applying Green function took %.3f %s.",
@@ -521,7 +2103,7 @@ void pm_mesh_compute_potential(struct pm_mesh* mesh, const struct space* s,
   tic = getticks();
 
   /* Fourier transform to come back from magic-land */
-  fftw_execute(inverse_plan);
+  mesh_fftw(execute)(mesh->inverse_plan);
 
   if (verbose)
     message("Backwards Fourier transform took %.3f %s.",
@@ -536,12 +2118,6 @@ void pm_mesh_compute_potential(struct pm_mesh* mesh, const struct space* s,
   /* message("\n\n\n POTENTIAL"); */
   /* print_array(potential, N); */
 
-  /* Clean-up the mess */
-  fftw_destroy_plan(forward_plan);
-  fftw_destroy_plan(inverse_plan);
-  memuse_log_allocation("fftw_frho", frho, 0, 0);
-  fftw_free(frho);
-
 #else
   error("No FFTW library found. Cannot compute periodic long-range forces.");
 #endif
@@ -566,15 +2142,26 @@ void pm_mesh_interpolate_forces(const struct pm_mesh* mesh,
 
   const int N = mesh->N;
   const double cell_fac = mesh->cell_fac;
-  const double* potential = mesh->potential;
+  const mesh_real* potential = mesh->potential;
   const double dim[3] = {e->s->dim[0], e->s->dim[1], e->s->dim[2]};
 
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+  if (mesh->distributed_mesh && mesh->potential_local == NULL)
+    error("Distributed mesh potential has not been fetched.");
+#endif
+
   /* Get the potential from the mesh to the active gparts using CIC */
   for (int i = 0; i < gcount; ++i) {
     struct gpart* gp = &gparts[i];
 
     if (gpart_is_active(gp, e)) {
 
+      /* Re-use the forces of the last mesh step? */
+      if (mesh->multiple_time_stepping) {
+        gravity_add_stored_mesh_force(gp);
+        continue;
+      }
+
 #ifdef SWIFT_DEBUG_CHECKS
       /* Check that particles have been drifted to the current time */
       if (gp->ti_drift != e->ti_current)
@@ -585,14 +2172,291 @@ void pm_mesh_interpolate_forces(const struct pm_mesh* mesh,
         error("Adding forces to an un-initialised gpart.");
 #endif
 
-      mesh_to_gparts_CIC(gp, potential, N, cell_fac, dim);
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+      if (mesh->distributed_mesh) {
+        mesh_map_to_gparts_CIC(gp, mesh->potential_local, N, cell_fac, dim,
+                               /*store=*/0);
+        continue;
+      }
+#endif
+
+      if (mesh->assignment_order == 2)
+        mesh_to_gparts_CIC(gp, potential, N, cell_fac, dim, /*store=*/0);
+      else
+        mesh_to_gparts_generic(gp, potential, N, cell_fac, dim,
+                               mesh->assignment_order, /*store=*/0);
+    }
+  }
+#else
+  error("No FFTW library found. Cannot compute periodic long-range forces.");
+#endif
+}
+
+#ifdef HAVE_FFTW
+/**
+ * @brief Shared information about the mesh used by the threadpool when
+ * storing the mesh forces in the #gpart.
+ */
+struct store_mapper_data {
+  const struct pm_mesh* mesh;
+  const struct space* s;
+};
+
+/**
+ * @brief Threadpool mapper interpolating the mesh forces to a chunk of #gpart
+ * and storing them in the particles.
+ *
+ * @param map_data A chunk of the #gpart array.
+ * @param num The number of #gpart in the chunk.
+ * @param extra The #store_mapper_data.
+ */
+static void pm_mesh_store_forces_mapper(void* map_data, int num,
+                                        void* extra) {
+
+  struct gpart* gparts = (struct gpart*)map_data;
+  const struct store_mapper_data* data = (struct store_mapper_data*)extra;
+  const struct pm_mesh* mesh = data->mesh;
+  const int N = mesh->N;
+  const double cell_fac = mesh->cell_fac;
+  const double dim[3] = {data->s->dim[0], data->s->dim[1], data->s->dim[2]};
+
+  for (int i = 0; i < num; ++i) {
+    struct gpart* gp = &gparts[i];
+
+    /* Skip the holes in the array */
+    if (gp->time_bin == time_bin_inhibited ||
+        gp->time_bin == time_bin_not_created)
+      continue;
+
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+    if (mesh->distributed_mesh) {
+      mesh_map_to_gparts_CIC(gp, mesh->potential_local, N, cell_fac, dim,
+                             /*store=*/1);
+      continue;
     }
+#endif
+
+    if (mesh->assignment_order == 2)
+      mesh_to_gparts_CIC(gp, mesh->potential, N, cell_fac, dim, /*store=*/1);
+    else
+      mesh_to_gparts_generic(gp, mesh->potential, N, cell_fac, dim,
+                             mesh->assignment_order, /*store=*/1);
   }
+}
+#endif
+
+/**
+ * @brief Interpolates the mesh forces to all the local #gpart and stores
+ * them in the particles (multiple time-stepping).
+ *
+ * The mesh is only re-computed at rebuild time. With multiple time-stepping,
+ * the forces are frozen at that point and simply added to the active
+ * particles at every step until the next rebuild, which removes the mesh
+ * interpolation from the fine steps.
+ *
+ * @param mesh The #pm_mesh (with the potential computed).
+ * @param s The #space containing the particles (drifted to the current time).
+ * @param tp The #threadpool object used for parallelisation.
+ * @param verbose Are we talkative?
+ */
+void pm_mesh_store_forces(const struct pm_mesh* mesh, const struct space* s,
+                          struct threadpool* tp, int verbose) {
+
+#ifdef HAVE_FFTW
+
+  const ticks tic = getticks();
+
+  struct store_mapper_data data;
+  data.mesh = mesh;
+  data.s = s;
+
+  threadpool_map(tp, pm_mesh_store_forces_mapper, s->gparts, s->nr_gparts,
+                 sizeof(struct gpart), 0, &data);
+
+  if (verbose)
+    message("Storing the mesh forces took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
 #else
   error("No FFTW library found. Cannot compute periodic long-range forces.");
 #endif
 }
 
+#ifdef HAVE_FFTW
+
+/**
+ * @brief Allocates the arrays in Fourier space of a replicated #pm_mesh and
+ * makes the FFTW plans that are then used for the whole run.
+ *
+ * Unless we only estimate the plans, the FFTW wisdom is read from (and then
+ * written back to) a file next to the restart files so that restarts and
+ * subsequent runs do not need to measure the plans again.
+ *
+ * @param mesh The #pm_mesh (with its potential array allocated).
+ */
+static void pm_mesh_make_plans(struct pm_mesh* mesh) {
+
+  const int N = mesh->N;
+  const int N_half = N / 2;
+  const size_t nr_complex = (size_t)N * N * (N_half + 1);
+
+  int rank = 0;
+#ifdef WITH_MPI
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#endif
+
+  unsigned flags = FFTW_DESTROY_INPUT;
+  switch (mesh->fftw_planning) {
+    case 0:
+      flags |= FFTW_ESTIMATE;
+      break;
+    case 1:
+      flags |= FFTW_MEASURE;
+      break;
+    case 2:
+      flags |= FFTW_PATIENT;
+      break;
+    default:
+      error("Invalid FFTW planning level %d", mesh->fftw_planning);
+  }
+
+  /* Start from what we learned in previous runs */
+  if (mesh->fftw_planning > 0 && access(mesh->fftw_wisdom_file, R_OK) == 0) {
+    if (mesh_fftw(import_wisdom_from_filename)(mesh->fftw_wisdom_file) == 0)
+      message("WARNING: Could not read the FFTW wisdom file '%s'.",
+              mesh->fftw_wisdom_file);
+  }
+
+  const ticks tic = getticks();
+
+  /* The mesh in Fourier space */
+  mesh->frho =
+      (mesh_complex*)mesh_fftw(malloc)(sizeof(mesh_complex) * nr_complex);
+  if (mesh->frho == NULL)
+    error("Error allocating memory for transform of density mesh");
+  memuse_log_allocation("fftw_frho", mesh->frho, 1,
+                        sizeof(mesh_complex) * nr_complex);
+  memuse_account_category(memuse_category_mesh,
+                          sizeof(mesh_complex) * nr_complex);
+
+  /* Note that measuring would overwrite the arrays, which are not in use
+   * yet. */
+  mesh->forward_plan =
+      mesh_fftw(plan_dft_r2c_3d)(N, N, N, mesh->potential, mesh->frho, flags);
+  mesh->inverse_plan =
+      mesh_fftw(plan_dft_c2r_3d)(N, N, N, mesh->frho, mesh->potential, flags);
+  if (mesh->forward_plan == NULL || mesh->inverse_plan == NULL)
+    error("Failed to create the FFTW plans for the gravity mesh.");
+
+  /* The shifted mesh used for interlacing */
+  if (mesh->interlacing) {
+    mesh->rho_shift =
+        (mesh_real*)mesh_fftw(malloc)(sizeof(mesh_real) * N * N * N);
+    mesh->frho_shift =
+        (mesh_complex*)mesh_fftw(malloc)(sizeof(mesh_complex) * nr_complex);
+    if (mesh->rho_shift == NULL || mesh->frho_shift == NULL)
+      error("Error allocating memory for the interlaced density mesh");
+    memuse_log_allocation("fftw_rho_shift", mesh->rho_shift, 1,
+                          sizeof(mesh_real) * N * N * N);
+    memuse_log_allocation("fftw_frho_shift", mesh->frho_shift, 1,
+                          sizeof(mesh_complex) * nr_complex);
+    memuse_account_category(
+        memuse_category_mesh,
+        sizeof(mesh_real) * N * N * N + sizeof(mesh_complex) * nr_complex);
+
+    mesh->forward_plan_shift = mesh_fftw(plan_dft_r2c_3d)(
+        N, N, N, mesh->rho_shift, mesh->frho_shift, flags);
+    if (mesh->forward_plan_shift == NULL)
+      error("Failed to create the FFTW plan for the interlaced mesh.");
+  }
+
+  if (mesh->fftw_planning > 0) {
+    if (rank == 0)
+      message("Planning the mesh FFTs took %.3f %s.",
+              clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+    /* Save the wisdom for next time */
+    if (rank == 0 &&
+        mesh_fftw(export_wisdom_to_filename)(mesh->fftw_wisdom_file) == 0)
+      message("WARNING: Could not write the FFTW wisdom file '%s'.",
+              mesh->fftw_wisdom_file);
+  }
+}
+
+/**
+ * @brief Prepares the FFTW library and allocates the memory of a #pm_mesh.
+ *
+ * For a replicated mesh this is the full N^3 array. For a distributed mesh we
+ * only record the slab decomposition; the slab itself is allocated whenever
+ * the potential is computed.
+ *
+ * @param mesh The #pm_mesh to prepare.
+ */
+static void pm_mesh_allocate(struct pm_mesh* mesh) {
+
+  const int N = mesh->N;
+
+#ifdef HAVE_THREADED_FFTW
+  /* Initialise the thread-parallel FFTW version */
+  if (N >= 64) {
+    mesh_fftw(init_threads)();
+    mesh_fftw(plan_with_nthreads)(mesh->nr_threads);
+  }
+#endif
+
+  if (mesh->distributed_mesh) {
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+
+    /* Initialise the MPI version of FFTW (after the threads) */
+    mesh_fftw(mpi_init)();
+
+    /* Get the slab of x-planes this rank is responsible for */
+    ptrdiff_t local_n0, local_0_start;
+    mesh_fftw(mpi_local_size_3d)(N, N, N / 2 + 1, MPI_COMM_WORLD, &local_n0,
+                           &local_0_start);
+    mesh->local_n0 = local_n0;
+    mesh->local_0_start = local_0_start;
+
+    /* Tell everybody about it */
+    int nr_nodes;
+    MPI_Comm_size(MPI_COMM_WORLD, &nr_nodes);
+    int* n0 = (int*)malloc(nr_nodes * sizeof(int));
+    int* start = (int*)malloc(nr_nodes * sizeof(int));
+    mesh->plane_owner = (int*)malloc(N * sizeof(int));
+    if (n0 == NULL || start == NULL || mesh->plane_owner == NULL)
+      error("Error allocating memory for the mesh slab decomposition.");
+    MPI_Allgather(&mesh->local_n0, 1, MPI_INT, n0, 1, MPI_INT,
+                  MPI_COMM_WORLD);
+    MPI_Allgather(&mesh->local_0_start, 1, MPI_INT, start, 1, MPI_INT,
+                  MPI_COMM_WORLD);
+
+    /* Record who owns which plane */
+    for (int k = 0; k < nr_nodes; ++k)
+      for (int i = start[k]; i < start[k] + n0[k]; ++i)
+        mesh->plane_owner[i] = k;
+
+    free(n0);
+    free(start);
+#else
+    error("Distributed mesh requires MPI and the MPI version of FFTW.");
+#endif
+  } else {
+
+    /* Allocate the memory for the combined density and potential array */
+    mesh->potential =
+        (mesh_real*)mesh_fftw(malloc)(sizeof(mesh_real) * N * N * N);
+    if (mesh->potential == NULL)
+      error("Error allocating memory for the long-range gravity mesh.");
+    memuse_log_allocation("fftw_mesh.potential", mesh->potential, 1,
+                          sizeof(mesh_real) * N * N * N);
+    memuse_account_category(memuse_category_mesh,
+                            sizeof(mesh_real) * N * N * N);
+
+    pm_mesh_make_plans(mesh);
+  }
+}
+
+#endif
+
 /**
  * @brief Initialisses the mesh used for the long-range periodic forces
  *
@@ -632,20 +2496,35 @@ void pm_mesh_init(struct pm_mesh* mesh, const struct gravity_props* props,
   if (2. * mesh->r_cut_max > box_size)
     error("Mesh too small or r_cut_max too big for this box size");
 
-#ifdef HAVE_THREADED_FFTW
-  /* Initialise the thread-parallel FFTW version */
-  if (N >= 64) {
-    fftw_init_threads();
-    fftw_plan_with_nthreads(nr_threads);
-  }
-#endif
-
-  /* Allocate the memory for the combined density and potential array */
-  mesh->potential = (double*)fftw_malloc(sizeof(double) * N * N * N);
-  if (mesh->potential == NULL)
-    error("Error allocating memory for the long-range gravity mesh.");
-  memuse_log_allocation("fftw_mesh.potential", mesh->potential, 1,
-                        sizeof(double) * N * N * N);
+  mesh->distributed_mesh = props->distributed_mesh;
+  mesh->tiled_assignment = props->mesh_tiled_assignment;
+  mesh->assignment_order = props->mesh_assignment_order;
+  mesh->interlacing = props->mesh_interlacing;
+  mesh->fftw_planning = props->mesh_fftw_planning;
+  mesh->multiple_time_stepping = props->mesh_multiple_time_stepping;
+  strcpy(mesh->fftw_wisdom_file, props->mesh_fftw_wisdom_file);
+  mesh->power_spectrum = props->power_spectrum;
+  mesh->power_spectrum_species = props->power_spectrum_species;
+  mesh->power_spectrum_next = props->power_spectrum_first;
+  mesh->power_spectrum_delta = props->power_spectrum_delta;
+  mesh->power_spectrum_count = 0;
+  strcpy(mesh->power_spectrum_basename, props->power_spectrum_basename);
+  mesh->frho = NULL;
+  mesh->forward_plan = NULL;
+  mesh->inverse_plan = NULL;
+  mesh->rho_shift = NULL;
+  mesh->frho_shift = NULL;
+  mesh->forward_plan_shift = NULL;
+
+  if (mesh->distributed_mesh &&
+      (mesh->assignment_order != 2 || mesh->interlacing))
+    error("The distributed mesh only supports CIC without interlacing.");
+  mesh->potential = NULL;
+  mesh->plane_owner = NULL;
+  mesh->potential_local = NULL;
+
+  /* Prepare the FFT library and memory */
+  pm_mesh_allocate(mesh);
 
 #else
   error("No FFTW library found. Cannot compute periodic long-range forces.");
@@ -681,15 +2560,68 @@ void pm_mesh_init_no_mesh(struct pm_mesh* mesh, double dim[3]) {
  */
 void pm_mesh_clean(struct pm_mesh* mesh) {
 
+  const size_t nr_real = (size_t)mesh->N * mesh->N * mesh->N;
+
+#ifdef HAVE_FFTW
+  const size_t nr_complex = (size_t)mesh->N * mesh->N * (mesh->N / 2 + 1);
+
+  if (mesh->forward_plan) mesh_fftw(destroy_plan)(mesh->forward_plan);
+  if (mesh->inverse_plan) mesh_fftw(destroy_plan)(mesh->inverse_plan);
+  if (mesh->forward_plan_shift)
+    mesh_fftw(destroy_plan)(mesh->forward_plan_shift);
+  mesh->forward_plan = NULL;
+  mesh->inverse_plan = NULL;
+  mesh->forward_plan_shift = NULL;
+
+  if (mesh->frho) {
+    memuse_log_allocation("fftw_frho", mesh->frho, 0, 0);
+    memuse_account_category(memuse_category_mesh,
+                            -(long long)(sizeof(mesh_complex) * nr_complex));
+    mesh_fftw(free)(mesh->frho);
+  }
+  mesh->frho = NULL;
+
+  if (mesh->rho_shift) {
+    memuse_log_allocation("fftw_rho_shift", mesh->rho_shift, 0, 0);
+    memuse_account_category(memuse_category_mesh,
+                            -(long long)(sizeof(mesh_real) * nr_real));
+    mesh_fftw(free)(mesh->rho_shift);
+  }
+  mesh->rho_shift = NULL;
+
+  if (mesh->frho_shift) {
+    memuse_log_allocation("fftw_frho_shift", mesh->frho_shift, 0, 0);
+    memuse_account_category(memuse_category_mesh,
+                            -(long long)(sizeof(mesh_complex) * nr_complex));
+    mesh_fftw(free)(mesh->frho_shift);
+  }
+  mesh->frho_shift = NULL;
+#endif
+
 #ifdef HAVE_THREADED_FFTW
-  fftw_cleanup_threads();
+  mesh_fftw(cleanup_threads)();
 #endif
 
   if (mesh->potential) {
     memuse_log_allocation("fftw_mesh.potential", mesh->potential, 0, 0);
+    memuse_account_category(memuse_category_mesh,
+                            -(long long)(sizeof(mesh_real) * nr_real));
     free(mesh->potential);
   }
   mesh->potential = 0;
+
+  if (mesh->potential_local) {
+    hashmap_free(mesh->potential_local);
+    free(mesh->potential_local);
+  }
+  mesh->potential_local = NULL;
+
+  if (mesh->plane_owner) free(mesh->plane_owner);
+  mesh->plane_owner = NULL;
+
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+  if (mesh->distributed_mesh) mesh_fftw(mpi_cleanup)();
+#endif
 }
 
 /**
@@ -718,22 +2650,19 @@ void pm_mesh_struct_restore(struct pm_mesh* mesh, FILE* stream) {
   if (mesh->periodic) {
 
 #ifdef HAVE_FFTW
-    const int N = mesh->N;
-
-#ifdef HAVE_THREADED_FFTW
-    /* Initialise the thread-parallel FFTW version */
-    if (N >= 64) {
-      fftw_init_threads();
-      fftw_plan_with_nthreads(mesh->nr_threads);
-    }
-#endif
-
-    /* Allocate the memory for the combined density and potential array */
-    mesh->potential = (double*)fftw_malloc(sizeof(double) * N * N * N);
-    if (mesh->potential == NULL)
-      error("Error allocating memory for the long-range gravity mesh.");
-    memuse_log_allocation("fftw_mesh.potential", mesh->potential, 1,
-                          sizeof(double) * N * N * N);
+    /* The pointers are stale, start afresh */
+    mesh->potential = NULL;
+    mesh->plane_owner = NULL;
+    mesh->potential_local = NULL;
+    mesh->frho = NULL;
+    mesh->forward_plan = NULL;
+    mesh->inverse_plan = NULL;
+    mesh->rho_shift = NULL;
+    mesh->frho_shift = NULL;
+    mesh->forward_plan_shift = NULL;
+
+    /* Prepare the FFT library and memory */
+    pm_mesh_allocate(mesh);
 #else
     error("No FFTW library found. Cannot compute periodic long-range forces.");
 #endif
@@ -22,10 +22,30 @@
 /* Config parameters. */
 #include "../config.h"
 
+#ifdef HAVE_FFTW
+#include <fftw3.h>
+#endif
+
 /* Local headers */
 #include "gravity_properties.h"
+#include "hashmap.h"
 #include "restart.h"
 
+/* Precision of the mesh arrays and of their Fourier transforms */
+#ifdef MESH_SINGLE_PRECISION
+typedef float mesh_real;
+#ifdef HAVE_FFTW
+typedef fftwf_complex mesh_complex;
+typedef fftwf_plan mesh_plan;
+#endif
+#else
+typedef double mesh_real;
+#ifdef HAVE_FFTW
+typedef fftw_complex mesh_complex;
+typedef fftw_plan mesh_plan;
+#endif
+#endif
+
 /* Forward declarations */
 struct space;
 struct gpart;
@@ -64,7 +84,71 @@ struct pm_mesh {
   double r_cut_min;
 
   /*! Potential field */
-  double *potential;
+  mesh_real *potential;
+
+  /*! Is the mesh distributed over the MPI ranks as slabs? */
+  int distributed_mesh;
+
+  /*! Are we assigning the mass to the mesh using private per-cell tiles? */
+  int tiled_assignment;
+
+  /*! Order of the mass assignment scheme (2: CIC, 3: TSC, 4: PCS) */
+  int assignment_order;
+
+  /*! Are we interlacing the density with a mesh shifted by half a cell? */
+  int interlacing;
+
+  /*! Are the mesh forces frozen between rebuilds (multiple time-stepping)? */
+  int multiple_time_stepping;
+
+  /*! FFTW planning level (0: estimate, 1: measure, 2: patient) */
+  int fftw_planning;
+
+  /*! File in which the FFTW wisdom is kept across runs */
+  char fftw_wisdom_file[PARSER_MAX_LINE_SIZE];
+
+  /*! Are we measuring the power spectrum (and that of each type)? */
+  int power_spectrum;
+  int power_spectrum_species;
+
+  /*! Scale-factor (or time) of the next power spectrum measurement */
+  double power_spectrum_next;
+
+  /*! Ratio of scale-factors (or time interval) between measurements */
+  double power_spectrum_delta;
+
+  /*! Number of power spectra written so far */
+  int power_spectrum_count;
+
+  /*! Base name of the power spectrum files */
+  char power_spectrum_basename[PARSER_MAX_LINE_SIZE];
+
+#ifdef HAVE_FFTW
+  /*! Mesh in Fourier space (replicated mesh) */
+  mesh_complex *frho;
+
+  /*! Plans for the forward and inverse transforms (replicated mesh) */
+  mesh_plan forward_plan, inverse_plan;
+
+  /*! Shifted density mesh, its transform and the corresponding plan
+   * (interlacing) */
+  mesh_real *rho_shift;
+  mesh_complex *frho_shift;
+  mesh_plan forward_plan_shift;
+#endif
+
+  /*! Number of x-planes of the mesh owned by this rank (distributed mesh) */
+  int local_n0;
+
+  /*! First x-plane of the mesh owned by this rank (distributed mesh) */
+  int local_0_start;
+
+  /*! Rank owning each of the N x-planes of the mesh (distributed mesh) */
+  int *plane_owner;
+
+  /*! Potential values on the mesh cells needed by the local #gpart
+   * (distributed mesh) */
+  hashmap_t *potential_local;
 };
 
 void pm_mesh_init(struct pm_mesh *mesh, const struct gravity_props *props,
@@ -75,6 +159,8 @@ void pm_mesh_compute_potential(struct pm_mesh *mesh, const struct space *s,
 void pm_mesh_interpolate_forces(const struct pm_mesh *mesh,
                                 const struct engine *e, struct gpart *gparts,
                                 int gcount);
+void pm_mesh_store_forces(const struct pm_mesh *mesh, const struct space *s,
+                          struct threadpool *tp, int verbose);
 void pm_mesh_clean(struct pm_mesh *mesh);
 
 /* Dump/restore. */
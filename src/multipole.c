@@ -21,6 +21,9 @@
 /* Config parameters. */
 #include "../config.h"
 
+/* Some standard headers. */
+#include <stddef.h>
+
 /* This object's header. */
 #include "multipole.h"
 
@@ -35,10 +38,20 @@
 MPI_Datatype multipole_mpi_type;
 MPI_Op multipole_mpi_reduce_op;
 
+/* Range of bytes of a #gravity_tensors that is exchanged between nodes:
+ * the multipole, the centres of mass and the radii, which follow each other
+ * after the field tensor. The field tensor itself is only ever used on the
+ * node owning the cell. */
+#define multipole_mpi_begin offsetof(struct gravity_tensors, m_pole)
+#define multipole_mpi_end \
+  (offsetof(struct gravity_tensors, r_max_rebuild) + sizeof(double))
+
 /**
  * @brief Apply a bit-by-bit XOR operattion on #gravity_tensors (i.e. does
  * a^=b).
  *
+ * Only the bytes that are part of #multipole_mpi_type are touched.
+ *
  * @param a The #gravity_tensors to add to.
  * @param b The #gravity_tensors to add.
  */
@@ -48,7 +61,7 @@ void gravity_binary_xor(struct gravity_tensors *a,
   char *aa = (char *)a;
   const char *bb = (const char *)b;
 
-  for (size_t i = 0; i < sizeof(struct gravity_tensors); ++i) {
+  for (size_t i = multipole_mpi_begin; i < multipole_mpi_end; ++i) {
     aa[i] ^= bb[i];
   }
 }
@@ -73,12 +86,21 @@ void gravity_tensors_mpi_reduce(void *invec, void *inoutvec, int *len,
 void multipole_create_mpi_types(void) {
 
   /* Create the datatype for multipoles */
-  /* We just consider each structure to be a byte field disregarding their */
-  /* detailed content */
-  if (MPI_Type_contiguous(
-          sizeof(struct gravity_tensors) / sizeof(unsigned char), MPI_BYTE,
-          &multipole_mpi_type) != MPI_SUCCESS ||
-      MPI_Type_commit(&multipole_mpi_type) != MPI_SUCCESS) {
+  /* We consider the exchanged part of each structure to be a byte field
+   * disregarding its detailed content and skip the field tensor, which
+   * would otherwise make up almost half of every message. The extent is
+   * that of the full structure so arrays of #gravity_tensors can be sent
+   * directly. */
+  int blocklength = multipole_mpi_end - multipole_mpi_begin;
+  MPI_Aint displacement = multipole_mpi_begin;
+  MPI_Datatype type = MPI_BYTE;
+  MPI_Datatype block_type;
+  if (MPI_Type_create_struct(1, &blocklength, &displacement, &type,
+                             &block_type) != MPI_SUCCESS ||
+      MPI_Type_create_resized(block_type, 0, sizeof(struct gravity_tensors),
+                              &multipole_mpi_type) != MPI_SUCCESS ||
+      MPI_Type_commit(&multipole_mpi_type) != MPI_SUCCESS ||
+      MPI_Type_free(&block_type) != MPI_SUCCESS) {
     error("Failed to create MPI type for multipole.");
   }
 
@@ -24,6 +24,7 @@
 #include "../config.h"
 
 /* Some standard headers. */
+#include <float.h>
 #include <math.h>
 #include <string.h>
 
@@ -43,6 +44,9 @@
 
 #define multipole_align 128
 
+/*! Maximal number of multipoles interacted at once in a batched M2L */
+#define gravity_M2L_batch_size 32
+
 struct grav_tensor {
 
   /* 0th order terms */
@@ -117,6 +121,9 @@ struct multipole {
   /*! Minimal velocity along each axis of all #gpart */
   float min_delta_vel[3];
 
+  /*! Minimal norm of the acceleration of all #gpart at the previous step */
+  float min_old_a_grav_norm;
+
   /* 0th order term */
   float M_000;
 
@@ -214,6 +221,46 @@ extern MPI_Op multipole_mpi_reduce_op;
 void multipole_create_mpi_types(void);
 #endif
 
+/**
+ * @brief Calls the version of a kernel specialised for a given run-time
+ * multipole order.
+ *
+ * The kernel takes the order as its last argument and is always inlined, so
+ * every case below is a separate copy of it in which the terms beyond that
+ * order are removed by the compiler. Orders above the one the code was
+ * compiled with are never generated. Dispatching then only costs one
+ * well-predicted branch.
+ *
+ * @param order The run-time multipole order.
+ * @param kernel The kernel to call.
+ * @param ... The arguments of the kernel (without the order).
+ */
+#define gravity_dispatch_order(order, kernel, ...)                            \
+  do {                                                                        \
+    switch (order) {                                                          \
+      case 0:                                                                 \
+        kernel(__VA_ARGS__, 0);                                               \
+        break;                                                                \
+      case 1:                                                                 \
+        if (SELF_GRAVITY_MULTIPOLE_ORDER >= 1) kernel(__VA_ARGS__, 1);        \
+        break;                                                                \
+      case 2:                                                                 \
+        if (SELF_GRAVITY_MULTIPOLE_ORDER >= 2) kernel(__VA_ARGS__, 2);        \
+        break;                                                                \
+      case 3:                                                                 \
+        if (SELF_GRAVITY_MULTIPOLE_ORDER >= 3) kernel(__VA_ARGS__, 3);        \
+        break;                                                                \
+      case 4:                                                                 \
+        if (SELF_GRAVITY_MULTIPOLE_ORDER >= 4) kernel(__VA_ARGS__, 4);        \
+        break;                                                                \
+      case 5:                                                                 \
+        if (SELF_GRAVITY_MULTIPOLE_ORDER >= 5) kernel(__VA_ARGS__, 5);        \
+        break;                                                                \
+      default:                                                                \
+        error("Invalid run-time multipole order %d", order);                  \
+    }                                                                         \
+  } while (0)
+
 /**
  * @brief Reset the data of a #multipole.
  *
@@ -225,6 +272,30 @@ INLINE static void gravity_reset(struct gravity_tensors *m) {
   bzero(m, sizeof(struct gravity_tensors));
 }
 
+/**
+ * @brief Copies the part of a #gravity_tensors that is exchanged between
+ * nodes.
+ *
+ * Only the multipole and its position are sent (see #multipole_mpi_type);
+ * the field tensor of a foreign cell is never used, so the one of the
+ * destination is left untouched.
+ *
+ * @param to The #gravity_tensors to copy to.
+ * @param from The #gravity_tensors to copy from.
+ */
+INLINE static void gravity_tensors_mpi_copy(
+    struct gravity_tensors *restrict to,
+    const struct gravity_tensors *restrict from) {
+
+  to->m_pole = from->m_pole;
+  for (int k = 0; k < 3; ++k) {
+    to->CoM[k] = from->CoM[k];
+    to->CoM_rebuild[k] = from->CoM_rebuild[k];
+  }
+  to->r_max = from->r_max;
+  to->r_max_rebuild = from->r_max_rebuild;
+}
+
 /**
  * @brief Drifts a #multipole forward in time.
  *
@@ -1030,6 +1101,7 @@ INLINE static void gravity_P2M(struct gravity_tensors *multi,
   double mass = 0.0;
   double com[3] = {0.0, 0.0, 0.0};
   double vel[3] = {0.f, 0.f, 0.f};
+  float min_old_a_grav_norm = FLT_MAX;
 
   /* Collect the particle data for CoM. */
   for (int k = 0; k < gcount; k++) {
@@ -1047,6 +1119,7 @@ INLINE static void gravity_P2M(struct gravity_tensors *multi,
     vel[0] += gparts[k].v_full[0] * m;
     vel[1] += gparts[k].v_full[1] * m;
     vel[2] += gparts[k].v_full[2] * m;
+    min_old_a_grav_norm = min(min_old_a_grav_norm, gparts[k].old_a_grav_norm);
   }
 
   /* Final operation on CoM */
@@ -1217,6 +1290,7 @@ INLINE static void gravity_P2M(struct gravity_tensors *multi,
   multi->m_pole.min_delta_vel[0] = min_delta_vel[0];
   multi->m_pole.min_delta_vel[1] = min_delta_vel[1];
   multi->m_pole.min_delta_vel[2] = min_delta_vel[2];
+  multi->m_pole.min_old_a_grav_norm = min_old_a_grav_norm;
 
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 0
 
@@ -1561,13 +1635,17 @@ INLINE static void gravity_M2M(struct multipole *restrict m_a,
  *
  * Corresponds to equation (28b).
  *
+ * Only the terms up to the (run-time) order are computed. The function is
+ * always inlined such that a constant order removes the unused terms.
+ *
  * @param l_b The field tensor to compute.
  * @param m_a The multipole creating the field.
  * @param pot The derivatives of the potential.
+ * @param order The run-time multipole order.
  */
-INLINE static void gravity_M2L_apply(
+__attribute__((always_inline)) INLINE static void gravity_M2L_apply(
     struct grav_tensor *restrict l_b, const struct multipole *restrict m_a,
-    const struct potential_derivatives_M2L *pot) {
+    const struct potential_derivatives_M2L *pot, const int order) {
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Count interactions */
@@ -1585,6 +1663,9 @@ INLINE static void gravity_M2L_apply(
 
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 0
 
+  /* Stop at the run-time order */
+  if (order <= 0) return;
+
   /* The dipole term is zero when using the CoM */
   /* The compiler will optimize out the terms in the equations */
   /* below. We keep them written to maintain the logical structure. */
@@ -1606,6 +1687,8 @@ INLINE static void gravity_M2L_apply(
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 1
 
+  if (order <= 1) return;
+
   const float M_200 = m_a->M_200;
   const float M_020 = m_a->M_020;
   const float M_002 = m_a->M_002;
@@ -1639,6 +1722,8 @@ INLINE static void gravity_M2L_apply(
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 2
 
+  if (order <= 2) return;
+
   const float M_300 = m_a->M_300;
   const float M_030 = m_a->M_030;
   const float M_003 = m_a->M_003;
@@ -1697,6 +1782,8 @@ INLINE static void gravity_M2L_apply(
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 3
 
+  if (order <= 3) return;
+
   const float M_400 = m_a->M_400;
   const float M_040 = m_a->M_040;
   const float M_004 = m_a->M_004;
@@ -1792,6 +1879,8 @@ INLINE static void gravity_M2L_apply(
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 4
 
+  if (order <= 4) return;
+
   const float M_500 = m_a->M_500;
   const float M_050 = m_a->M_050;
   const float M_005 = m_a->M_005;
@@ -1957,11 +2046,13 @@ INLINE static void gravity_M2L_apply(
  * @param periodic Is the calculation periodic ?
  * @param dim The size of the simulation box.
  * @param rs_inv The inverse of the gravity mesh-smoothing scale.
+ * @param order The run-time multipole order.
  */
-INLINE static void gravity_M2L_nonsym(
+__attribute__((always_inline)) INLINE static void gravity_M2L_nonsym_order(
     struct grav_tensor *l_b, const struct multipole *m_a, const double pos_b[3],
     const double pos_a[3], const struct gravity_props *props,
-    const int periodic, const double dim[3], const float rs_inv) {
+    const int periodic, const double dim[3], const float rs_inv,
+    const int order) {
 
   /* Recover some constants */
   const float eps = props->epsilon_cur;
@@ -1986,10 +2077,132 @@ INLINE static void gravity_M2L_nonsym(
   /* Compute all derivatives */
   struct potential_derivatives_M2L pot;
   potential_derivatives_compute_M2L(dx, dy, dz, r2, r_inv, eps, eps_inv,
-                                    periodic, rs_inv, &pot);
+                                    periodic, rs_inv, &pot, order);
 
   /* Do the M2L tensor multiplication */
-  gravity_M2L_apply(l_b, m_a, &pot);
+  gravity_M2L_apply(l_b, m_a, &pot, order);
+}
+
+/**
+ * @brief Compute the field tensor due to a multipole.
+ *
+ * Dispatches to the version of the kernel specialised for the run-time
+ * multipole order.
+ *
+ * @param l_b The field tensor to compute.
+ * @param m_a The multipole.
+ * @param pos_b The position of the field tensor.
+ * @param pos_a The position of the multipole.
+ * @param props The #gravity_props of this calculation.
+ * @param periodic Is the calculation periodic ?
+ * @param dim The size of the simulation box.
+ * @param rs_inv The inverse of the gravity mesh-smoothing scale.
+ */
+INLINE static void gravity_M2L_nonsym(
+    struct grav_tensor *l_b, const struct multipole *m_a, const double pos_b[3],
+    const double pos_a[3], const struct gravity_props *props,
+    const int periodic, const double dim[3], const float rs_inv) {
+
+  gravity_dispatch_order(props->multipole_order, gravity_M2L_nonsym_order, l_b,
+                         m_a, pos_b, pos_a, props, periodic, dim, rs_inv);
+}
+
+/**
+ * @brief Compute the field tensor due to a list of multipoles.
+ *
+ * The distances and the radial terms of the derivatives are first computed
+ * for all the multipoles in loops without dependencies (which the compiler
+ * can vectorize), the tensor multiplications are then done one by one. The
+ * result is identical to calling gravity_M2L_nonsym() on each multipole in
+ * turn.
+ *
+ * @param l_b The field tensor to compute.
+ * @param m_a The list of #gravity_tensors creating the field.
+ * @param count The number of multipoles (at most gravity_M2L_batch_size).
+ * @param pos_b The position of the field tensor.
+ * @param props The #gravity_props of this calculation.
+ * @param periodic Is the calculation periodic ?
+ * @param dim The size of the simulation box.
+ * @param rs_inv The inverse of the gravity mesh-smoothing scale.
+ * @param order The run-time multipole order.
+ */
+__attribute__((always_inline)) INLINE static void
+gravity_M2L_nonsym_batch_order(struct grav_tensor *l_b,
+                               const struct gravity_tensors *const *m_a,
+                               const int count, const double pos_b[3],
+                               const struct gravity_props *props,
+                               const int periodic, const double dim[3],
+                               const float rs_inv, const int order) {
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (count > gravity_M2L_batch_size)
+    error("Too many multipoles in a batched M2L (%d)", count);
+#endif
+
+  /* Recover some constants */
+  const float eps = props->epsilon_cur;
+  const float eps_inv = props->epsilon_cur_inv;
+
+  float dx[gravity_M2L_batch_size], dy[gravity_M2L_batch_size],
+      dz[gravity_M2L_batch_size];
+  struct potential_derivatives_M2L_radial rad[gravity_M2L_batch_size];
+
+  /* Compute the distance vectors */
+  for (int k = 0; k < count; ++k) {
+    dx[k] = (float)(pos_b[0] - m_a[k]->CoM[0]);
+    dy[k] = (float)(pos_b[1] - m_a[k]->CoM[1]);
+    dz[k] = (float)(pos_b[2] - m_a[k]->CoM[2]);
+  }
+
+  /* Apply BC */
+  if (periodic) {
+    for (int k = 0; k < count; ++k) {
+      dx[k] = nearest(dx[k], dim[0]);
+      dy[k] = nearest(dy[k], dim[1]);
+      dz[k] = nearest(dz[k], dim[2]);
+    }
+  }
+
+  /* Compute the radial terms of all the derivatives */
+  for (int k = 0; k < count; ++k) {
+    const float r2 = dx[k] * dx[k] + dy[k] * dy[k] + dz[k] * dz[k];
+    const float r_inv = 1. / sqrtf(r2);
+    potential_derivatives_compute_M2L_radial(r2, r_inv, eps, eps_inv, periodic,
+                                             rs_inv, &rad[k]);
+  }
+
+  /* Do the M2L tensor multiplications */
+  for (int k = 0; k < count; ++k) {
+    struct potential_derivatives_M2L pot;
+    potential_derivatives_M2L_from_radial(dx[k], dy[k], dz[k], &rad[k], &pot,
+                                          order);
+    gravity_M2L_apply(l_b, &m_a[k]->m_pole, &pot, order);
+  }
+}
+
+/**
+ * @brief Compute the field tensor due to a list of multipoles.
+ *
+ * Dispatches to the version of the kernel specialised for the run-time
+ * multipole order.
+ *
+ * @param l_b The field tensor to compute.
+ * @param m_a The list of #gravity_tensors creating the field.
+ * @param count The number of multipoles (at most gravity_M2L_batch_size).
+ * @param pos_b The position of the field tensor.
+ * @param props The #gravity_props of this calculation.
+ * @param periodic Is the calculation periodic ?
+ * @param dim The size of the simulation box.
+ * @param rs_inv The inverse of the gravity mesh-smoothing scale.
+ */
+INLINE static void gravity_M2L_nonsym_batch(
+    struct grav_tensor *l_b, const struct gravity_tensors *const *m_a,
+    const int count, const double pos_b[3], const struct gravity_props *props,
+    const int periodic, const double dim[3], const float rs_inv) {
+
+  gravity_dispatch_order(props->multipole_order,
+                         gravity_M2L_nonsym_batch_order, l_b, m_a, count, pos_b,
+                         props, periodic, dim, rs_inv);
 }
 
 /**
@@ -2006,13 +2219,14 @@ INLINE static void gravity_M2L_nonsym(
  * @param periodic Is the calculation periodic ?
  * @param dim The size of the simulation box.
  * @param rs_inv The inverse of the gravity mesh-smoothing scale.
+ * @param order The run-time multipole order.
  */
-INLINE static void gravity_M2L_symmetric(
+__attribute__((always_inline)) INLINE static void gravity_M2L_symmetric_order(
     struct grav_tensor *restrict l_a, struct grav_tensor *restrict l_b,
     const struct multipole *restrict m_a, const struct multipole *restrict m_b,
     const double pos_a[3], const double pos_b[3],
     const struct gravity_props *props, const int periodic, const double dim[3],
-    const float rs_inv) {
+    const float rs_inv, const int order) {
 
   /* Recover some constants */
   const float eps = props->epsilon_cur;
@@ -2037,16 +2251,46 @@ INLINE static void gravity_M2L_symmetric(
   /* Compute all derivatives */
   struct potential_derivatives_M2L pot;
   potential_derivatives_compute_M2L(dx, dy, dz, r2, r_inv, eps, eps_inv,
-                                    periodic, rs_inv, &pot);
+                                    periodic, rs_inv, &pot, order);
 
   /* Do the first M2L tensor multiplication */
-  gravity_M2L_apply(l_b, m_a, &pot);
+  gravity_M2L_apply(l_b, m_a, &pot, order);
 
   /* Flip the signs of odd derivatives */
-  potential_derivatives_flip_signs(&pot);
+  potential_derivatives_flip_signs(&pot, order);
 
   /* Do the second M2L tensor multiplication */
-  gravity_M2L_apply(l_a, m_b, &pot);
+  gravity_M2L_apply(l_a, m_b, &pot, order);
+}
+
+/**
+ * @brief Compute the field tensor due to a multipole and the symmetric
+ * equivalent.
+ *
+ * Dispatches to the version of the kernel specialised for the run-time
+ * multipole order.
+ *
+ * @param l_a The first field tensor to compute.
+ * @param l_b The second field tensor to compute.
+ * @param m_a The first multipole.
+ * @param m_b The second multipole.
+ * @param pos_a The position of the first m-pole and field tensor.
+ * @param pos_b The position of the second m-pole and field tensor.
+ * @param props The #gravity_props of this calculation.
+ * @param periodic Is the calculation periodic ?
+ * @param dim The size of the simulation box.
+ * @param rs_inv The inverse of the gravity mesh-smoothing scale.
+ */
+INLINE static void gravity_M2L_symmetric(
+    struct grav_tensor *restrict l_a, struct grav_tensor *restrict l_b,
+    const struct multipole *restrict m_a, const struct multipole *restrict m_b,
+    const double pos_a[3], const double pos_b[3],
+    const struct gravity_props *props, const int periodic, const double dim[3],
+    const float rs_inv) {
+
+  gravity_dispatch_order(props->multipole_order, gravity_M2L_symmetric_order,
+                         l_a, l_b, m_a, m_b, pos_a, pos_b, props, periodic, dim,
+                         rs_inv);
 }
 
 /**
@@ -2412,12 +2656,17 @@ INLINE static void gravity_L2L(struct grav_tensor *restrict la,
  *
  * Corresponds to equation (28a).
  *
+ * Only the terms up to the (run-time) order are used. The function is always
+ * inlined such that a constant order removes the unused terms.
+ *
  * @param lb The gravity field tensor to apply.
  * @param loc The position of the gravity field tensor.
  * @param gp The #gpart to update.
+ * @param order The run-time multipole order.
  */
-INLINE static void gravity_L2P(const struct grav_tensor *lb,
-                               const double loc[3], struct gpart *gp) {
+__attribute__((always_inline)) INLINE static void gravity_L2P_order(
+    const struct grav_tensor *lb, const double loc[3], struct gpart *gp,
+    const int order) {
 
 #ifdef SWIFT_DEBUG_CHECKS
   if (lb->num_interacted == 0) error("Interacting with empty field tensor");
@@ -2435,103 +2684,117 @@ INLINE static void gravity_L2P(const struct grav_tensor *lb,
   pot -= X_000(dx) * lb->F_000;
 
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 0
-  /* 1st order contributions */
-  a_grav[0] += X_000(dx) * lb->F_100;
-  a_grav[1] += X_000(dx) * lb->F_010;
-  a_grav[2] += X_000(dx) * lb->F_001;
+  if (order > 0) {
+    /* 1st order contributions */
+    a_grav[0] += X_000(dx) * lb->F_100;
+    a_grav[1] += X_000(dx) * lb->F_010;
+    a_grav[2] += X_000(dx) * lb->F_001;
 
-  pot -= X_001(dx) * lb->F_001 + X_010(dx) * lb->F_010 + X_100(dx) * lb->F_100;
+    pot -= X_001(dx) * lb->F_001 + X_010(dx) * lb->F_010 +
+           X_100(dx) * lb->F_100;
+  }
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 1
+  if (order > 1) {
+    /* 2nd order contributions */
+    a_grav[0] +=
+        X_100(dx) * lb->F_200 + X_010(dx) * lb->F_110 + X_001(dx) * lb->F_101;
+    a_grav[1] +=
+        X_100(dx) * lb->F_110 + X_010(dx) * lb->F_020 + X_001(dx) * lb->F_011;
+    a_grav[2] +=
+        X_100(dx) * lb->F_101 + X_010(dx) * lb->F_011 + X_001(dx) * lb->F_002;
 
-  /* 2nd order contributions */
-  a_grav[0] +=
-      X_100(dx) * lb->F_200 + X_010(dx) * lb->F_110 + X_001(dx) * lb->F_101;
-  a_grav[1] +=
-      X_100(dx) * lb->F_110 + X_010(dx) * lb->F_020 + X_001(dx) * lb->F_011;
-  a_grav[2] +=
-      X_100(dx) * lb->F_101 + X_010(dx) * lb->F_011 + X_001(dx) * lb->F_002;
-
-  pot -= X_002(dx) * lb->F_002 + X_011(dx) * lb->F_011 + X_020(dx) * lb->F_020 +
-         X_101(dx) * lb->F_101 + X_110(dx) * lb->F_110 + X_200(dx) * lb->F_200;
+    pot -= X_002(dx) * lb->F_002 + X_011(dx) * lb->F_011 +
+           X_020(dx) * lb->F_020 + X_101(dx) * lb->F_101 +
+           X_110(dx) * lb->F_110 + X_200(dx) * lb->F_200;
+  }
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 2
-
-  /* 3rd order contributions */
-  a_grav[0] +=
-      X_200(dx) * lb->F_300 + X_020(dx) * lb->F_120 + X_002(dx) * lb->F_102;
-  a_grav[0] +=
-      X_110(dx) * lb->F_210 + X_101(dx) * lb->F_201 + X_011(dx) * lb->F_111;
-  a_grav[1] +=
-      X_200(dx) * lb->F_210 + X_020(dx) * lb->F_030 + X_002(dx) * lb->F_012;
-  a_grav[1] +=
-      X_110(dx) * lb->F_120 + X_101(dx) * lb->F_111 + X_011(dx) * lb->F_021;
-  a_grav[2] +=
-      X_200(dx) * lb->F_201 + X_020(dx) * lb->F_021 + X_002(dx) * lb->F_003;
-  a_grav[2] +=
-      X_110(dx) * lb->F_111 + X_101(dx) * lb->F_102 + X_011(dx) * lb->F_012;
-
-  pot -= X_003(dx) * lb->F_003 + X_012(dx) * lb->F_012 + X_021(dx) * lb->F_021 +
-         X_030(dx) * lb->F_030 + X_102(dx) * lb->F_102 + X_111(dx) * lb->F_111 +
-         X_120(dx) * lb->F_120 + X_201(dx) * lb->F_201 + X_210(dx) * lb->F_210 +
-         X_300(dx) * lb->F_300;
+  if (order > 2) {
+    /* 3rd order contributions */
+    a_grav[0] +=
+        X_200(dx) * lb->F_300 + X_020(dx) * lb->F_120 + X_002(dx) * lb->F_102;
+    a_grav[0] +=
+        X_110(dx) * lb->F_210 + X_101(dx) * lb->F_201 + X_011(dx) * lb->F_111;
+    a_grav[1] +=
+        X_200(dx) * lb->F_210 + X_020(dx) * lb->F_030 + X_002(dx) * lb->F_012;
+    a_grav[1] +=
+        X_110(dx) * lb->F_120 + X_101(dx) * lb->F_111 + X_011(dx) * lb->F_021;
+    a_grav[2] +=
+        X_200(dx) * lb->F_201 + X_020(dx) * lb->F_021 + X_002(dx) * lb->F_003;
+    a_grav[2] +=
+        X_110(dx) * lb->F_111 + X_101(dx) * lb->F_102 + X_011(dx) * lb->F_012;
+
+    pot -= X_003(dx) * lb->F_003 + X_012(dx) * lb->F_012 +
+           X_021(dx) * lb->F_021 + X_030(dx) * lb->F_030 +
+           X_102(dx) * lb->F_102 + X_111(dx) * lb->F_111 +
+           X_120(dx) * lb->F_120 + X_201(dx) * lb->F_201 +
+           X_210(dx) * lb->F_210 + X_300(dx) * lb->F_300;
+  }
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 3
-
-  /* 4th order contributions */
-  a_grav[0] += X_003(dx) * lb->F_103 + X_012(dx) * lb->F_112 +
-               X_021(dx) * lb->F_121 + X_030(dx) * lb->F_130 +
-               X_102(dx) * lb->F_202 + X_111(dx) * lb->F_211 +
-               X_120(dx) * lb->F_220 + X_201(dx) * lb->F_301 +
-               X_210(dx) * lb->F_310 + X_300(dx) * lb->F_400;
-  a_grav[1] += X_003(dx) * lb->F_013 + X_012(dx) * lb->F_022 +
-               X_021(dx) * lb->F_031 + X_030(dx) * lb->F_040 +
-               X_102(dx) * lb->F_112 + X_111(dx) * lb->F_121 +
-               X_120(dx) * lb->F_130 + X_201(dx) * lb->F_211 +
-               X_210(dx) * lb->F_220 + X_300(dx) * lb->F_310;
-  a_grav[2] += X_003(dx) * lb->F_004 + X_012(dx) * lb->F_013 +
-               X_021(dx) * lb->F_022 + X_030(dx) * lb->F_031 +
-               X_102(dx) * lb->F_103 + X_111(dx) * lb->F_112 +
-               X_120(dx) * lb->F_121 + X_201(dx) * lb->F_202 +
-               X_210(dx) * lb->F_211 + X_300(dx) * lb->F_301;
-
-  pot -= X_004(dx) * lb->F_004 + X_013(dx) * lb->F_013 + X_022(dx) * lb->F_022 +
-         X_031(dx) * lb->F_031 + X_040(dx) * lb->F_040 + X_103(dx) * lb->F_103 +
-         X_112(dx) * lb->F_112 + X_121(dx) * lb->F_121 + X_130(dx) * lb->F_130 +
-         X_202(dx) * lb->F_202 + X_211(dx) * lb->F_211 + X_220(dx) * lb->F_220 +
-         X_301(dx) * lb->F_301 + X_310(dx) * lb->F_310 + X_400(dx) * lb->F_400;
-
+  if (order > 3) {
+    /* 4th order contributions */
+    a_grav[0] += X_003(dx) * lb->F_103 + X_012(dx) * lb->F_112 +
+                 X_021(dx) * lb->F_121 + X_030(dx) * lb->F_130 +
+                 X_102(dx) * lb->F_202 + X_111(dx) * lb->F_211 +
+                 X_120(dx) * lb->F_220 + X_201(dx) * lb->F_301 +
+                 X_210(dx) * lb->F_310 + X_300(dx) * lb->F_400;
+    a_grav[1] += X_003(dx) * lb->F_013 + X_012(dx) * lb->F_022 +
+                 X_021(dx) * lb->F_031 + X_030(dx) * lb->F_040 +
+                 X_102(dx) * lb->F_112 + X_111(dx) * lb->F_121 +
+                 X_120(dx) * lb->F_130 + X_201(dx) * lb->F_211 +
+                 X_210(dx) * lb->F_220 + X_300(dx) * lb->F_310;
+    a_grav[2] += X_003(dx) * lb->F_004 + X_012(dx) * lb->F_013 +
+                 X_021(dx) * lb->F_022 + X_030(dx) * lb->F_031 +
+                 X_102(dx) * lb->F_103 + X_111(dx) * lb->F_112 +
+                 X_120(dx) * lb->F_121 + X_201(dx) * lb->F_202 +
+                 X_210(dx) * lb->F_211 + X_300(dx) * lb->F_301;
+
+    pot -= X_004(dx) * lb->F_004 + X_013(dx) * lb->F_013 +
+           X_022(dx) * lb->F_022 + X_031(dx) * lb->F_031 +
+           X_040(dx) * lb->F_040 + X_103(dx) * lb->F_103 +
+           X_112(dx) * lb->F_112 + X_121(dx) * lb->F_121 +
+           X_130(dx) * lb->F_130 + X_202(dx) * lb->F_202 +
+           X_211(dx) * lb->F_211 + X_220(dx) * lb->F_220 +
+           X_301(dx) * lb->F_301 + X_310(dx) * lb->F_310 +
+           X_400(dx) * lb->F_400;
+  }
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 4
-
-  /* 5th order contributions */
-  a_grav[0] +=
-      X_004(dx) * lb->F_104 + X_013(dx) * lb->F_113 + X_022(dx) * lb->F_122 +
-      X_031(dx) * lb->F_131 + X_040(dx) * lb->F_140 + X_103(dx) * lb->F_203 +
-      X_112(dx) * lb->F_212 + X_121(dx) * lb->F_221 + X_130(dx) * lb->F_230 +
-      X_202(dx) * lb->F_302 + X_211(dx) * lb->F_311 + X_220(dx) * lb->F_320 +
-      X_301(dx) * lb->F_401 + X_310(dx) * lb->F_410 + X_400(dx) * lb->F_500;
-  a_grav[1] +=
-      X_004(dx) * lb->F_014 + X_013(dx) * lb->F_023 + X_022(dx) * lb->F_032 +
-      X_031(dx) * lb->F_041 + X_040(dx) * lb->F_050 + X_103(dx) * lb->F_113 +
-      X_112(dx) * lb->F_122 + X_121(dx) * lb->F_131 + X_130(dx) * lb->F_140 +
-      X_202(dx) * lb->F_212 + X_211(dx) * lb->F_221 + X_220(dx) * lb->F_230 +
-      X_301(dx) * lb->F_311 + X_310(dx) * lb->F_320 + X_400(dx) * lb->F_410;
-  a_grav[2] +=
-      X_004(dx) * lb->F_005 + X_013(dx) * lb->F_014 + X_022(dx) * lb->F_023 +
-      X_031(dx) * lb->F_032 + X_040(dx) * lb->F_041 + X_103(dx) * lb->F_104 +
-      X_112(dx) * lb->F_113 + X_121(dx) * lb->F_122 + X_130(dx) * lb->F_131 +
-      X_202(dx) * lb->F_203 + X_211(dx) * lb->F_212 + X_220(dx) * lb->F_221 +
-      X_301(dx) * lb->F_302 + X_310(dx) * lb->F_311 + X_400(dx) * lb->F_401;
-
-  pot -= X_005(dx) * lb->F_005 + X_014(dx) * lb->F_014 + X_023(dx) * lb->F_023 +
-         X_032(dx) * lb->F_032 + X_041(dx) * lb->F_041 + X_050(dx) * lb->F_050 +
-         X_104(dx) * lb->F_104 + X_113(dx) * lb->F_113 + X_122(dx) * lb->F_122 +
-         X_131(dx) * lb->F_131 + X_140(dx) * lb->F_140 + X_203(dx) * lb->F_203 +
-         X_212(dx) * lb->F_212 + X_221(dx) * lb->F_221 + X_230(dx) * lb->F_230 +
-         X_302(dx) * lb->F_302 + X_311(dx) * lb->F_311 + X_320(dx) * lb->F_320 +
-         X_401(dx) * lb->F_401 + X_410(dx) * lb->F_410 + X_500(dx) * lb->F_500;
-
+  if (order > 4) {
+    /* 5th order contributions */
+    a_grav[0] +=
+        X_004(dx) * lb->F_104 + X_013(dx) * lb->F_113 + X_022(dx) * lb->F_122 +
+        X_031(dx) * lb->F_131 + X_040(dx) * lb->F_140 + X_103(dx) * lb->F_203 +
+        X_112(dx) * lb->F_212 + X_121(dx) * lb->F_221 + X_130(dx) * lb->F_230 +
+        X_202(dx) * lb->F_302 + X_211(dx) * lb->F_311 + X_220(dx) * lb->F_320 +
+        X_301(dx) * lb->F_401 + X_310(dx) * lb->F_410 + X_400(dx) * lb->F_500;
+    a_grav[1] +=
+        X_004(dx) * lb->F_014 + X_013(dx) * lb->F_023 + X_022(dx) * lb->F_032 +
+        X_031(dx) * lb->F_041 + X_040(dx) * lb->F_050 + X_103(dx) * lb->F_113 +
+        X_112(dx) * lb->F_122 + X_121(dx) * lb->F_131 + X_130(dx) * lb->F_140 +
+        X_202(dx) * lb->F_212 + X_211(dx) * lb->F_221 + X_220(dx) * lb->F_230 +
+        X_301(dx) * lb->F_311 + X_310(dx) * lb->F_320 + X_400(dx) * lb->F_410;
+    a_grav[2] +=
+        X_004(dx) * lb->F_005 + X_013(dx) * lb->F_014 + X_022(dx) * lb->F_023 +
+        X_031(dx) * lb->F_032 + X_040(dx) * lb->F_041 + X_103(dx) * lb->F_104 +
+        X_112(dx) * lb->F_113 + X_121(dx) * lb->F_122 + X_130(dx) * lb->F_131 +
+        X_202(dx) * lb->F_203 + X_211(dx) * lb->F_212 + X_220(dx) * lb->F_221 +
+        X_301(dx) * lb->F_302 + X_310(dx) * lb->F_311 + X_400(dx) * lb->F_401;
+
+    pot -= X_005(dx) * lb->F_005 + X_014(dx) * lb->F_014 +
+           X_023(dx) * lb->F_023 + X_032(dx) * lb->F_032 +
+           X_041(dx) * lb->F_041 + X_050(dx) * lb->F_050 +
+           X_104(dx) * lb->F_104 + X_113(dx) * lb->F_113 +
+           X_122(dx) * lb->F_122 + X_131(dx) * lb->F_131 +
+           X_140(dx) * lb->F_140 + X_203(dx) * lb->F_203 +
+           X_212(dx) * lb->F_212 + X_221(dx) * lb->F_221 +
+           X_230(dx) * lb->F_230 + X_302(dx) * lb->F_302 +
+           X_311(dx) * lb->F_311 + X_320(dx) * lb->F_320 +
+           X_401(dx) * lb->F_401 + X_410(dx) * lb->F_410 +
+           X_500(dx) * lb->F_500;
+  }
 #endif
 #if SELF_GRAVITY_MULTIPOLE_ORDER > 5
 #error "Missing implementation for order >5"
@@ -2544,6 +2807,25 @@ INLINE static void gravity_L2P(const struct grav_tensor *lb,
   gravity_add_comoving_potential(gp, pot);
 }
 
+/**
+ * @brief Applies the  #grav_tensor to a  #gpart.
+ *
+ * Dispatches to the version of the kernel specialised for the run-time
+ * multipole order.
+ *
+ * @param lb The gravity field tensor to apply.
+ * @param loc The position of the gravity field tensor.
+ * @param gp The #gpart to update.
+ * @param props The #gravity_props of this calculation.
+ */
+INLINE static void gravity_L2P(const struct grav_tensor *lb,
+                               const double loc[3], struct gpart *gp,
+                               const struct gravity_props *props) {
+
+  gravity_dispatch_order(props->multipole_order, gravity_L2P_order, lb, loc,
+                         gp);
+}
+
 /**
  * @brief Checks whether a cell-cell interaction can be appromixated by a M-M
  * interaction using the distance and cell radius.
@@ -2570,6 +2852,65 @@ __attribute__((always_inline, const)) INLINE static int gravity_M2L_accept(
   return (r2 * theta_crit2 > size2);
 }
 
+/**
+ * @brief Checks whether a cell-cell interaction can be appromixated by a M-M
+ * interaction using the multipoles and the run-time acceptance criterion.
+ *
+ * We always apply the geometric criterion (#gravity_M2L_accept). With the
+ * adaptive criterion, the opening angle is only a maximal value and we
+ * additionally demand that the estimated error on the M2L interaction,
+ * M_B * (r_max_A + r_max_B)^p / r^(p+2) with p the multipole order, is below a
+ * fraction epsilon of the smallest acceleration (from the previous step)
+ * in the multipole receiving the field. This is done for both directions.
+ * Multipoles without acceleration information (e.g. in the first step) only
+ * use the geometric criterion.
+ *
+ * Note that the accelerations are stored without the factor G so the
+ * errors are compared in the same units.
+ *
+ * @param props The #gravity_props of this calculation.
+ * @param A The first #gravity_tensors.
+ * @param B The second #gravity_tensors.
+ * @param r_crit_a The size of the multipole A.
+ * @param r_crit_b The size of the multipole B.
+ * @param r2 Square of the distance (periodically wrapped) between the
+ * multipoles.
+ */
+__attribute__((always_inline)) INLINE static int gravity_M2L_accept_adaptive(
+    const struct gravity_props *props, const struct gravity_tensors *A,
+    const struct gravity_tensors *B, const double r_crit_a,
+    const double r_crit_b, const double r2) {
+
+  /* Start with the geometric criterion */
+  if (!gravity_M2L_accept(r_crit_a, r_crit_b, props->theta_crit2, r2))
+    return 0;
+
+  if (!props->use_adaptive_tolerance) return 1;
+
+  const double size = r_crit_a + r_crit_b;
+  const double r_inv = 1. / sqrt(r2);
+
+  /* (size / r)^p / r^2 */
+  double E = r_inv * r_inv;
+  for (int i = 0; i < props->multipole_order; ++i) E *= size * r_inv;
+
+  const double eps = props->adaptive_tolerance;
+  const float min_a_A = A->m_pole.min_old_a_grav_norm;
+  const float min_a_B = B->m_pole.min_old_a_grav_norm;
+
+  /* Error made on A by using the multipole of B */
+  if (min_a_A > 0.f && min_a_A < FLT_MAX &&
+      B->m_pole.M_000 * E >= eps * min_a_A)
+    return 0;
+
+  /* Error made on B by using the multipole of A */
+  if (min_a_B > 0.f && min_a_B < FLT_MAX &&
+      A->m_pole.M_000 * E >= eps * min_a_B)
+    return 0;
+
+  return 1;
+}
+
 /**
  * @brief Checks whether a particle-cell interaction can be appromixated by a
  * M2P interaction using the distance and cell radius.
@@ -0,0 +1,325 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_NEIGHBOUR_LIST_H
+#define SWIFT_NEIGHBOUR_LIST_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local headers */
+#include "error.h"
+#include "inline.h"
+#include "memuse.h"
+
+/*! Minimal number of bytes in a chunk of a #neighbour_list_arena */
+#define neighbour_list_arena_min_chunk_size (1 << 20)
+
+/*! Index of the list of a cell with itself (the pairs use their sid) */
+#define neighbour_list_self 13
+
+/*! Number of lists per cell: the 13 sids as the first cell of the pair, the
+ * cell itself and the 13 sids as the second cell (slot 26 - sid) */
+#define neighbour_list_count 27
+
+/*! Margin on h with which the stars density loop records its neighbours */
+#define neighbour_list_stars_h_ratio 1.25f
+
+/**
+ * @brief A pair of interacting particles, given by their indices in the
+ * particle arrays of the two cells.
+ */
+struct neighbour_pair {
+
+  /*! Index of the particle in the first cell */
+  int i;
+
+  /*! Index of the particle in the second cell */
+  int j;
+};
+
+/**
+ * @brief The interaction lists of a cell, one per direction and one with
+ * itself.
+ */
+struct cell_neighbour_lists {
+
+  /*! The cell the pairs of each list were found with */
+  const struct cell *cj[neighbour_list_count];
+
+  /*! The pairs of each list (NULL if no list was recorded) */
+  const struct neighbour_pair *pairs[neighbour_list_count];
+
+  /*! The number of pairs in each list */
+  int count[neighbour_list_count];
+
+  /*! The smoothing length up to which each list is complete (stars only) */
+  float h[neighbour_list_count];
+};
+
+/**
+ * @brief A chunk of memory from which the lists are carved.
+ */
+struct neighbour_list_chunk {
+
+  /*! The previous chunk of the arena */
+  struct neighbour_list_chunk *next;
+
+  /*! Number of bytes in this chunk */
+  size_t size;
+
+  /*! Number of bytes already handed out */
+  size_t used;
+
+  /*! The data itself */
+  char data[];
+};
+
+/**
+ * @brief A bump allocator for the neighbour lists recorded by a #runner.
+ *
+ * Works like the #sort_arena, except that it is emptied before every launch of
+ * the tasks and that it never grows beyond a fixed size. When it is full, the
+ * lists are simply not recorded and the loops using them fall back to the
+ * search in the sorted cells.
+ */
+struct neighbour_list_arena {
+
+  /*! The chunk we are currently allocating from (NULL if none) */
+  struct neighbour_list_chunk *chunks;
+
+  /*! Total number of bytes in all the chunks */
+  size_t capacity;
+
+  /*! Total number of bytes handed out since the last reset */
+  size_t used;
+
+  /*! Maximal number of bytes we are allowed to hand out */
+  size_t max_size;
+
+  /*! List being built */
+  struct neighbour_pair *scratch;
+
+  /*! Number of pairs in the list being built */
+  int scratch_count;
+
+  /*! Allocated size of the list being built */
+  int scratch_size;
+};
+
+/**
+ * @brief Initialises an (empty) #neighbour_list_arena.
+ *
+ * @param a The #neighbour_list_arena.
+ * @param max_size The maximal number of bytes it can hand out.
+ */
+static INLINE void neighbour_list_arena_init(struct neighbour_list_arena *a,
+                                             const size_t max_size) {
+  a->chunks = NULL;
+  a->capacity = 0;
+  a->used = 0;
+  a->max_size = max_size;
+  a->scratch = NULL;
+  a->scratch_count = 0;
+  a->scratch_size = 0;
+}
+
+/**
+ * @brief Gets some memory from a #neighbour_list_arena.
+ *
+ * @param a The #neighbour_list_arena.
+ * @param size The number of bytes required.
+ *
+ * @return The memory or NULL if the arena is full.
+ */
+static INLINE void *neighbour_list_arena_alloc(struct neighbour_list_arena *a,
+                                               size_t size) {
+
+  /* Keep everything aligned for the pointers in the headers */
+  size = (size + 7) & ~((size_t)7);
+  if (a->used + size > a->max_size) return NULL;
+
+  if (a->chunks == NULL || a->chunks->used + size > a->chunks->size) {
+
+    /* Grow geometrically to keep the number of chunks small */
+    size_t chunk_size = a->capacity;
+    if (chunk_size < size) chunk_size = size;
+    if (chunk_size < neighbour_list_arena_min_chunk_size)
+      chunk_size = neighbour_list_arena_min_chunk_size;
+
+    struct neighbour_list_chunk *chunk =
+        (struct neighbour_list_chunk *)swift_malloc(
+            "neighbour_lists",
+            sizeof(struct neighbour_list_chunk) + chunk_size);
+    if (chunk == NULL) error("Failed to allocate neighbour list memory.");
+
+    chunk->next = a->chunks;
+    chunk->size = chunk_size;
+    chunk->used = 0;
+    a->chunks = chunk;
+    a->capacity += chunk_size;
+  }
+
+  void *ptr = &a->chunks->data[a->chunks->used];
+  a->chunks->used += size;
+  a->used += size;
+  return ptr;
+}
+
+/**
+ * @brief Empties a #neighbour_list_arena.
+ *
+ * If the arena had to grow since the last reset, the chunks are merged into a
+ * single one large enough for all of them.
+ *
+ * @param a The #neighbour_list_arena.
+ */
+static INLINE void neighbour_list_arena_reset(struct neighbour_list_arena *a) {
+
+  if (a->chunks != NULL && a->chunks->next != NULL) {
+    const size_t capacity = a->capacity;
+    while (a->chunks != NULL) {
+      struct neighbour_list_chunk *next = a->chunks->next;
+      swift_free("neighbour_lists", a->chunks);
+      a->chunks = next;
+    }
+    a->chunks = (struct neighbour_list_chunk *)swift_malloc(
+        "neighbour_lists", sizeof(struct neighbour_list_chunk) + capacity);
+    if (a->chunks == NULL) error("Failed to allocate neighbour list memory.");
+    a->chunks->next = NULL;
+    a->chunks->size = capacity;
+  }
+  if (a->chunks != NULL) a->chunks->used = 0;
+  a->used = 0;
+}
+
+/**
+ * @brief Frees all the memory of a #neighbour_list_arena.
+ *
+ * @param a The #neighbour_list_arena.
+ */
+static INLINE void neighbour_list_arena_clean(struct neighbour_list_arena *a) {
+
+  while (a->chunks != NULL) {
+    struct neighbour_list_chunk *next = a->chunks->next;
+    swift_free("neighbour_lists", a->chunks);
+    a->chunks = next;
+  }
+  a->capacity = 0;
+  a->used = 0;
+  free(a->scratch);
+  a->scratch = NULL;
+  a->scratch_count = 0;
+  a->scratch_size = 0;
+}
+
+/**
+ * @brief Appends a pair to the list being built in a #neighbour_list_arena.
+ *
+ * @param a The #neighbour_list_arena.
+ * @param i The index of the particle in the first cell.
+ * @param j The index of the particle in the second cell.
+ */
+__attribute__((always_inline)) INLINE static void neighbour_list_push(
+    struct neighbour_list_arena *a, const int i, const int j) {
+
+  if (a->scratch_count == a->scratch_size) {
+    a->scratch_size = a->scratch_size > 0 ? 2 * a->scratch_size : 1024;
+    a->scratch = (struct neighbour_pair *)realloc(
+        a->scratch, a->scratch_size * sizeof(struct neighbour_pair));
+    if (a->scratch == NULL) error("Failed to allocate neighbour list.");
+  }
+  a->scratch[a->scratch_count].i = i;
+  a->scratch[a->scratch_count].j = j;
+  a->scratch_count++;
+}
+
+/**
+ * @brief Hands the list built in a #neighbour_list_arena over to a cell.
+ *
+ * If the arena is full, the list is dropped. In all cases, the arena is ready
+ * to build the next list.
+ *
+ * @param a The #neighbour_list_arena.
+ * @param lists The lists of the cell (updated).
+ * @param generation The generation of the lists of the cell (updated).
+ * @param current_generation The current generation of the lists.
+ * @param cj The other cell of the pairs.
+ * @param slot The direction of the pair or #neighbour_list_self.
+ * @param h The smoothing length up to which the list is complete.
+ */
+static INLINE void neighbour_list_store(
+    struct neighbour_list_arena *a, struct cell_neighbour_lists **lists,
+    int *generation, const int current_generation, const struct cell *cj,
+    const int slot, const float h) {
+
+  const int count = a->scratch_count;
+  a->scratch_count = 0;
+
+  /* Lists left over from a previous launch are meaningless */
+  if (*generation != current_generation) {
+    struct cell_neighbour_lists *l = (struct cell_neighbour_lists *)
+        neighbour_list_arena_alloc(a, sizeof(struct cell_neighbour_lists));
+    if (l == NULL) return;
+    memset(l, 0, sizeof(struct cell_neighbour_lists));
+    *lists = l;
+    *generation = current_generation;
+  }
+
+  struct neighbour_pair *pairs = (struct neighbour_pair *)
+      neighbour_list_arena_alloc(a, count * sizeof(struct neighbour_pair));
+  if (pairs == NULL) return;
+  memcpy(pairs, a->scratch, count * sizeof(struct neighbour_pair));
+
+  (*lists)->cj[slot] = cj;
+  (*lists)->pairs[slot] = pairs;
+  (*lists)->count[slot] = count;
+  (*lists)->h[slot] = h;
+}
+
+/**
+ * @brief Retrieves a list recorded earlier during the same launch.
+ *
+ * @param lists The lists of the cell.
+ * @param generation The generation of the lists of the cell.
+ * @param current_generation The current generation of the lists.
+ * @param cj The other cell of the pairs.
+ * @param slot The direction of the pair or #neighbour_list_self.
+ * @param count (return) The number of pairs in the list.
+ *
+ * @return The pairs or NULL if there is no valid list.
+ */
+__attribute__((always_inline)) INLINE static const struct neighbour_pair *
+neighbour_list_get(const struct cell_neighbour_lists *lists,
+                   const int generation, const int current_generation,
+                   const struct cell *cj, const int slot, int *count) {
+
+  if (generation != current_generation || lists->pairs[slot] == NULL ||
+      lists->cj[slot] != cj)
+    return NULL;
+
+  *count = lists->count[slot];
+  return lists->pairs[slot];
+}
+
+#endif /* SWIFT_NEIGHBOUR_LIST_H */
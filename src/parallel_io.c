@@ -24,9 +24,12 @@
 #if defined(HAVE_HDF5) && defined(WITH_MPI) && defined(HAVE_PARALLEL_HDF5)
 
 /* Some standard headers. */
+#include <float.h>
 #include <hdf5.h>
+#include <limits.h>
 #include <math.h>
 #include <mpi.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -64,6 +67,10 @@
 /* The current limit of ROMIO (the underlying MPI-IO layer) is 2GB */
 #define HDF5_PARALLEL_IO_MAX_BYTES 2147000000LL
 
+/* Size of the chunks read from the ICs, each converted while the next one is
+ * read */
+#define HDF5_PARALLEL_IO_READ_CHUNK_BYTES (256LL * 1024LL * 1024LL)
+
 /* Are we timing the i/o? */
 //#define IO_SPEED_MEASUREMENT
 
@@ -73,57 +80,31 @@
  * @param h_data The HDF5 dataset to write to.
  * @param h_plist_id the parallel HDF5 properties.
  * @param props The #io_props of the field to read.
- * @param N The number of particles to write.
- * @param offset Offset in the array where this mpi task starts writing.
- * @param internal_units The #unit_system used internally.
- * @param ic_units The #unit_system used in the snapshots.
- * @param cleanup_h Are we removing h-factors from the ICs?
- * @param cleanup_sqrt_a Are we cleaning-up the sqrt(a) factors in the Gadget
- * IC velocities?
- * @param h The value of the reduced Hubble constant to use for cleaning.
- * @param a The current value of the scale-factor.
+ * @param N The number of particles to read.
+ * @param ranges The ranges of particles read by this rank, as pairs of
+ * offset and count sorted by offset.
+ * @param nr_ranges The number of ranges.
+ * @param first The index in the ranges of the first particle to read.
+ * @param temp The buffer to read the data into.
  */
 void readArray_chunk(hid_t h_data, hid_t h_plist_id,
-                     const struct io_props props, size_t N, long long offset,
-                     const struct unit_system* internal_units,
-                     const struct unit_system* ic_units, int cleanup_h,
-                     int cleanup_sqrt_a, double h, double a) {
+                     const struct io_props props, size_t N,
+                     const long long* ranges, int nr_ranges, long long first,
+                     void* temp) {
 
   const size_t typeSize = io_sizeof_type(props.type);
-  const size_t copySize = typeSize * props.dimension;
-  const size_t num_elements = N * props.dimension;
 
   /* Can't handle writes of more than 2GB */
   if (N * props.dimension * typeSize > HDF5_PARALLEL_IO_MAX_BYTES)
     error("Dataset too large to be read in one pass!");
 
-  /* Allocate temporary buffer */
-  void* temp = malloc(num_elements * typeSize);
-  if (temp == NULL) error("Unable to allocate memory for temporary buffer");
-
-  /* Prepare information for hyper-slab */
-  hsize_t shape[2], offsets[2];
-  int rank;
-  if (props.dimension > 1) {
-    rank = 2;
-    shape[0] = N;
-    shape[1] = props.dimension;
-    offsets[0] = offset;
-    offsets[1] = 0;
-  } else {
-    rank = 2;
-    shape[0] = N;
-    shape[1] = 1;
-    offsets[0] = offset;
-    offsets[1] = 0;
-  }
-
   /* Create data space in memory */
-  const hid_t h_memspace = H5Screate_simple(rank, shape, NULL);
+  const hsize_t shape[2] = {N, props.dimension};
+  const hid_t h_memspace = H5Screate_simple(2, shape, NULL);
 
-  /* Select hyper-slab in file */
+  /* Select the hyper-slabs of these particles in the file */
   const hid_t h_filespace = H5Dget_space(h_data);
-  H5Sselect_hyperslab(h_filespace, H5S_SELECT_SET, offsets, NULL, shape, NULL);
+  io_select_ranges(h_filespace, ranges, nr_ranges, first, N, props.dimension);
 
   /* Read HDF5 dataspace in temporary buffer */
   /* Dirty version that happens to work for vectors but should be improved */
@@ -132,104 +113,67 @@ void readArray_chunk(hid_t h_data, hid_t h_plist_id,
                               h_filespace, h_plist_id, temp);
   if (h_err < 0) error("Error while reading data array '%s'.", props.name);
 
-  /* Unit conversion if necessary */
-  const double factor =
-      units_conversion_factor(ic_units, internal_units, props.units);
-  if (factor != 1.) {
-
-    /* message("Converting ! factor=%e", factor); */
-
-    if (io_is_double_precision(props.type)) {
-      double* temp_d = (double*)temp;
-      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= factor;
-    } else {
-      float* temp_f = (float*)temp;
-
-#ifdef SWIFT_DEBUG_CHECKS
-      float maximum = 0.;
-      float minimum = FLT_MAX;
-#endif
-
-      /* Loop that converts the Units */
-      for (size_t i = 0; i < num_elements; ++i) {
+  /* Close everything */
+  H5Sclose(h_filespace);
+  H5Sclose(h_memspace);
+}
 
-#ifdef SWIFT_DEBUG_CHECKS
-        /* Find the absolute minimum and maximum values */
-        const float abstemp_f = fabsf(temp_f[i]);
-        if (abstemp_f != 0.f) {
-          maximum = max(maximum, abstemp_f);
-          minimum = min(minimum, abstemp_f);
-        }
-#endif
+/**
+ * @brief A chunk of an array read from the ICs being converted while the
+ * next chunk is read.
+ */
+struct read_conversion_job {
 
-        /* Convert the float units */
-        temp_f[i] *= factor;
-      }
-
-#ifdef SWIFT_DEBUG_CHECKS
-      /* The two possible errors: larger than float or smaller
-       * than float precission. */
-      if (factor * maximum > FLT_MAX) {
-        error("Unit conversion results in numbers larger than floats");
-      } else if (factor * minimum < FLT_MIN) {
-        error("Numbers smaller than float precision");
-      }
-#endif
-    }
-  }
+  /*! The thread handing the conversion to the threadpool */
+  pthread_t thread;
 
-  /* Clean-up h if necessary */
-  const float h_factor_exp = units_h_factor(internal_units, props.units);
-  if (cleanup_h && h_factor_exp != 0.f) {
+  /*! The threadpool doing the conversion */
+  struct threadpool* tp;
 
-    /* message("Multipltying '%s' by h^%f=%f", props.name, h_factor_exp,
-     * h_factor); */
+  /*! The field and particles of the chunk */
+  struct io_props props;
+  size_t N;
 
-    if (io_is_double_precision(props.type)) {
-      double* temp_d = (double*)temp;
-      const double h_factor = pow(h, h_factor_exp);
-      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= h_factor;
-    } else {
-      float* temp_f = (float*)temp;
-      const float h_factor = pow(h, h_factor_exp);
-      for (size_t i = 0; i < num_elements; ++i) temp_f[i] *= h_factor;
-    }
-  }
+  /*! The buffer holding the chunk */
+  void* temp;
 
-  /* Clean-up a if necessary */
-  if (cleanup_sqrt_a && a != 1. && (strcmp(props.name, "Velocities") == 0)) {
+  /*! The conversion parameters, see io_convert_read_buffer() */
+  const struct unit_system* internal_units;
+  const struct unit_system* ic_units;
+  int cleanup_h, cleanup_sqrt_a;
+  double h, a;
+};
 
-    if (io_is_double_precision(props.type)) {
-      double* temp_d = (double*)temp;
-      const double vel_factor = sqrt(a);
-      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= vel_factor;
-    } else {
-      float* temp_f = (float*)temp;
-      const float vel_factor = sqrt(a);
-      for (size_t i = 0; i < num_elements; ++i) temp_f[i] *= vel_factor;
-    }
-  }
-
-  /* Copy temporary buffer to particle data */
-  char* temp_c = (char*)temp;
-  for (size_t i = 0; i < N; ++i)
-    memcpy(props.field + i * props.partSize, &temp_c[i * copySize], copySize);
+/**
+ * @brief Body of the thread converting a chunk read from the ICs.
+ *
+ * @param arg The #read_conversion_job.
+ */
+static void* readArray_convert_thread(void* arg) {
 
-  /* Free and close everything */
-  free(temp);
-  H5Sclose(h_filespace);
-  H5Sclose(h_memspace);
+  struct read_conversion_job* job = (struct read_conversion_job*)arg;
+  io_convert_read_buffer(job->tp, job->props, job->N, job->temp,
+                         job->internal_units, job->ic_units, job->cleanup_h,
+                         job->cleanup_sqrt_a, job->h, job->a);
+  return NULL;
 }
 
 /**
  * @brief Reads a data array from a given HDF5 group.
  *
+ * The data is read in chunks of at most HDF5_PARALLEL_IO_READ_CHUNK_BYTES.
+ * Each chunk is converted to the internal units and copied into the particles
+ * by the threads of the #threadpool while the next chunk is being read.
+ *
+ * @param tp The #threadpool converting the data.
  * @param grp The group from which to read.
  * @param props The #io_props of the field to read.
  * @param N The number of particles on that rank.
  * @param N_total The total number of particles.
  * @param mpi_rank The MPI rank of this node.
- * @param offset The offset in the array on disk for this rank.
+ * @param ranges The ranges of particles read by this rank, as pairs of
+ * offset and count sorted by offset.
+ * @param nr_ranges The number of ranges.
  * @param internal_units The #unit_system used internally.
  * @param ic_units The #unit_system used in the ICs.
  * @param cleanup_h Are we removing h-factors from the ICs?
@@ -238,8 +182,9 @@ void readArray_chunk(hid_t h_data, hid_t h_plist_id,
  * @param h The value of the reduced Hubble constant to use for cleaning.
  * @param a The current value of the scale-factor.
  */
-void readArray(hid_t grp, struct io_props props, size_t N, long long N_total,
-               int mpi_rank, long long offset,
+void readArray(struct threadpool* tp, hid_t grp, struct io_props props,
+               size_t N, long long N_total, int mpi_rank,
+               const long long* ranges, int nr_ranges,
                const struct unit_system* internal_units,
                const struct unit_system* ic_units, int cleanup_h,
                int cleanup_sqrt_a, double h, double a) {
@@ -321,18 +266,55 @@ void readArray(hid_t grp, struct io_props props, size_t N, long long N_total,
   H5Pset_dxpl_mpio(h_plist_id, H5FD_MPIO_COLLECTIVE);
 
   /* Given the limitations of ROM-IO we will need to read the data in chunk of
-     HDF5_PARALLEL_IO_MAX_BYTES bytes per node until all the nodes are done. */
-  char redo = 1;
-  while (redo) {
+     HDF5_PARALLEL_IO_MAX_BYTES bytes per node until all the nodes are done.
+     We use smaller chunks to overlap their conversion with the reading. */
+  const size_t max_chunk_size =
+      HDF5_PARALLEL_IO_READ_CHUNK_BYTES / (props.dimension * typeSize);
+
+  /* Two buffers: one being read, one being converted */
+  void* temp[2];
+  const size_t buffer_size =
+      (N > max_chunk_size ? max_chunk_size : N) * copySize;
+  for (int k = 0; k < 2; k++) {
+    temp[k] = malloc(buffer_size);
+    if (temp[k] == NULL && buffer_size > 0)
+      error("Unable to allocate memory for temporary buffer");
+  }
+  struct read_conversion_job jobs[2];
+  int converting = -1;
 
-    /* Maximal number of elements */
-    const size_t max_chunk_size =
-        HDF5_PARALLEL_IO_MAX_BYTES / (props.dimension * typeSize);
+  long long first = 0;
+  char redo = 1;
+  for (int k = 0; redo; k = 1 - k) {
 
-    /* Write the first chunk */
+    /* Read the next chunk */
     const size_t this_chunk = (N > max_chunk_size) ? max_chunk_size : N;
-    readArray_chunk(h_data, h_plist_id, props, this_chunk, offset,
-                    internal_units, ic_units, cleanup_h, cleanup_sqrt_a, h, a);
+    readArray_chunk(h_data, h_plist_id, props, this_chunk, ranges, nr_ranges,
+                    first, temp[k]);
+
+    /* Wait for the conversion of the previous chunk... */
+    if (converting >= 0 && pthread_join(jobs[converting].thread, NULL) != 0)
+      error("Failed to join the conversion thread.");
+    converting = -1;
+
+    /* ...and start converting this one while reading the next */
+    if (this_chunk > 0) {
+      jobs[k] = (struct read_conversion_job){
+          .tp = tp,
+          .props = props,
+          .N = this_chunk,
+          .temp = temp[k],
+          .internal_units = internal_units,
+          .ic_units = ic_units,
+          .cleanup_h = cleanup_h,
+          .cleanup_sqrt_a = cleanup_sqrt_a,
+          .h = h,
+          .a = a};
+      if (pthread_create(&jobs[k].thread, NULL, readArray_convert_thread,
+                         &jobs[k]) != 0)
+        error("Failed to create the conversion thread.");
+      converting = k;
+    }
 
     /* Compute how many items are left */
     if (N > max_chunk_size) {
@@ -341,22 +323,24 @@ void readArray(hid_t grp, struct io_props props, size_t N, long long N_total,
       props.parts += max_chunk_size;                  /* part* on the part */
       props.xparts += max_chunk_size;                 /* xpart* on the xpart */
       props.gparts += max_chunk_size;                 /* gpart* on the gpart */
-      offset += max_chunk_size;
+      first += max_chunk_size;
       redo = 1;
     } else {
       N = 0;
-      offset += 0;
       redo = 0;
     }
 
     /* Do we need to run again ? */
     MPI_Allreduce(MPI_IN_PLACE, &redo, 1, MPI_SIGNED_CHAR, MPI_MAX,
                   MPI_COMM_WORLD);
-
-    if (redo && mpi_rank == 0)
-      message("Need to redo one iteration for array '%s'", props.name);
   }
 
+  /* Wait for the last conversion */
+  if (converting >= 0 && pthread_join(jobs[converting].thread, NULL) != 0)
+    error("Failed to join the conversion thread.");
+  free(temp[0]);
+  free(temp[1]);
+
   /* Close everything */
   H5Pclose(h_plist_id);
   H5Dclose(h_data);
@@ -408,6 +392,14 @@ void prepareArray(struct engine* e, hid_t grp, char* fileName, FILE* xmfFile,
   if (h_err < 0)
     error("Error while changing data space shape for field '%s'.", props.name);
 
+  /* The parallel writes do not use chunking, hence cannot use filters */
+  if (props.lossy_compression != compression_write_lossless &&
+      e->nodeID == 0)
+    message(
+        "WARNING: Lossy compression '%s' of field '%s' ignored by the "
+        "parallel writes.",
+        lossy_compression_schemes_names[props.lossy_compression], props.name);
+
   /* Create property list for collective dataset write.    */
   const hid_t h_plist_id = H5Pcreate(H5P_DATASET_XFER);
   H5Pset_dxpl_mpio(h_plist_id, H5FD_MPIO_COLLECTIVE);
@@ -464,57 +456,28 @@ void prepareArray(struct engine* e, hid_t grp, char* fileName, FILE* xmfFile,
 }
 
 /**
- * @brief Writes a chunk of data in an open HDF5 dataset
+ * @brief Writes a chunk of data already converted to the snapshot units in an
+ * open HDF5 dataset
  *
- * @param e The #engine we are writing from.
  * @param h_data The HDF5 dataset to write to.
  * @param props The #io_props of the field to write.
  * @param N The number of particles to write.
  * @param offset Offset in the array where this mpi task starts writing.
- * @param internal_units The #unit_system used internally.
- * @param snapshot_units The #unit_system used in the snapshots.
+ * @param temp The buffer containing the converted data.
+ * @param in_place Is temp the field of the particles themselves (see
+ * io_make_in_place_memspace()) rather than a contiguous buffer?
+ * @param comm The communicator of the ranks writing to the file.
  */
-void writeArray_chunk(struct engine* e, hid_t h_data,
-                      const struct io_props props, size_t N, long long offset,
-                      const struct unit_system* internal_units,
-                      const struct unit_system* snapshot_units) {
-
-  const size_t typeSize = io_sizeof_type(props.type);
-  const size_t num_elements = N * props.dimension;
-
-  /* Can't handle writes of more than 2GB */
-  if (N * props.dimension * typeSize > HDF5_PARALLEL_IO_MAX_BYTES)
-    error("Dataset too large to be written in one pass!");
-
-  /* message("Writing '%s' array...", props.name); */
-
-  /* Allocate temporary buffer */
-  void* temp = NULL;
-  if (swift_memalign("writebuff", (void**)&temp, IO_BUFFER_ALIGNMENT,
-                     num_elements * typeSize) != 0)
-    error("Unable to allocate temporary i/o buffer");
+static void writeArray_buffer_chunk(hid_t h_data, const struct io_props props,
+                                    size_t N, long long offset,
+                                    const void* temp, const int in_place,
+                                    MPI_Comm comm) {
 
 #ifdef IO_SPEED_MEASUREMENT
-  MPI_Barrier(MPI_COMM_WORLD);
-  ticks tic = getticks();
-#endif
-
-  /* Copy the particle data to the temporary buffer */
-  io_copy_temp_buffer(temp, e, props, N, internal_units, snapshot_units);
-
-#ifdef IO_SPEED_MEASUREMENT
-  MPI_Barrier(MPI_COMM_WORLD);
-  if (engine_rank == 0)
-    message("Copying for '%s' took %.3f %s.", props.name,
-            clocks_from_ticks(getticks() - tic), clocks_getunit());
+  const size_t typeSize = io_sizeof_type(props.type);
+  ticks tic;
 #endif
 
-  /* Create data space */
-  const hid_t h_memspace = H5Screate(H5S_SIMPLE);
-  if (h_memspace < 0)
-    error("Error while creating data space (memory) for field '%s'.",
-          props.name);
-
   int rank;
   hsize_t shape[2];
   hsize_t offsets[2];
@@ -532,11 +495,22 @@ void writeArray_chunk(struct engine* e, hid_t h_data,
     offsets[1] = 0;
   }
 
-  /* Change shape of memory data space */
-  hid_t h_err = H5Sset_extent_simple(h_memspace, rank, shape, NULL);
-  if (h_err < 0)
-    error("Error while changing data space (memory) shape for field '%s'.",
-          props.name);
+  /* Create data space */
+  hid_t h_memspace, h_err;
+  if (in_place) {
+    h_memspace = io_make_in_place_memspace(props, N);
+  } else {
+    h_memspace = H5Screate(H5S_SIMPLE);
+    if (h_memspace < 0)
+      error("Error while creating data space (memory) for field '%s'.",
+            props.name);
+
+    /* Change shape of memory data space */
+    h_err = H5Sset_extent_simple(h_memspace, rank, shape, NULL);
+    if (h_err < 0)
+      error("Error while changing data space (memory) shape for field '%s'.",
+            props.name);
+  }
 
   /* Select the hyper-salb corresponding to this rank */
   hid_t h_filespace = H5Dget_space(h_data);
@@ -552,7 +526,7 @@ void writeArray_chunk(struct engine* e, hid_t h_data,
     /* 	  (int)(N * props.dimension * typeSize), offset); */
 
 #ifdef IO_SPEED_MEASUREMENT
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
   tic = getticks();
 #endif
 
@@ -562,23 +536,85 @@ void writeArray_chunk(struct engine* e, hid_t h_data,
   if (h_err < 0) error("Error while writing data array '%s'.", props.name);
 
 #ifdef IO_SPEED_MEASUREMENT
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
   ticks toc = getticks();
   float ms = clocks_from_ticks(toc - tic);
   int megaBytes = N * props.dimension * typeSize / (1024 * 1024);
   int total = 0;
-  MPI_Reduce(&megaBytes, &total, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&megaBytes, &total, 1, MPI_INT, MPI_SUM, 0, comm);
   if (engine_rank == 0)
     message("H5Dwrite for '%s' (%d MB) took %.3f %s (speed = %f MB/s).",
             props.name, total, ms, clocks_getunit(), total / (ms / 1000.));
 #endif
 
-  /* Free and close everything */
-  swift_free("writebuff", temp);
+  /* Close everything */
   H5Sclose(h_memspace);
   H5Sclose(h_filespace);
 }
 
+/**
+ * @brief Writes a chunk of data in an open HDF5 dataset
+ *
+ * @param e The #engine we are writing from.
+ * @param h_data The HDF5 dataset to write to.
+ * @param props The #io_props of the field to write.
+ * @param N The number of particles to write.
+ * @param offset Offset in the array where this mpi task starts writing.
+ * @param internal_units The #unit_system used internally.
+ * @param snapshot_units The #unit_system used in the snapshots.
+ * @param comm The communicator of the ranks writing to the file.
+ */
+void writeArray_chunk(struct engine* e, hid_t h_data,
+                      const struct io_props props, size_t N, long long offset,
+                      const struct unit_system* internal_units,
+                      const struct unit_system* snapshot_units,
+                      MPI_Comm comm) {
+
+  const size_t typeSize = io_sizeof_type(props.type);
+  const size_t num_elements = N * props.dimension;
+
+  /* Can't handle writes of more than 2GB */
+  if (N * props.dimension * typeSize > HDF5_PARALLEL_IO_MAX_BYTES)
+    error("Dataset too large to be written in one pass!");
+
+  /* message("Writing '%s' array...", props.name); */
+
+  /* Fields needing no conversion are written straight from the particles */
+  if (io_can_write_in_place(props, internal_units, snapshot_units)) {
+    writeArray_buffer_chunk(h_data, props, N, offset, props.field,
+                            /*in_place=*/1, comm);
+    return;
+  }
+
+  /* Allocate temporary buffer */
+  void* temp = NULL;
+  if (swift_memalign("writebuff", (void**)&temp, IO_BUFFER_ALIGNMENT,
+                     num_elements * typeSize) != 0)
+    error("Unable to allocate temporary i/o buffer");
+
+#ifdef IO_SPEED_MEASUREMENT
+  MPI_Barrier(comm);
+  ticks tic = getticks();
+#endif
+
+  /* Copy the particle data to the temporary buffer */
+  io_copy_temp_buffer(temp, e, props, N, internal_units, snapshot_units);
+
+#ifdef IO_SPEED_MEASUREMENT
+  MPI_Barrier(comm);
+  if (engine_rank == 0)
+    message("Copying for '%s' took %.3f %s.", props.name,
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+#endif
+
+  /* Write it to the file */
+  writeArray_buffer_chunk(h_data, props, N, offset, temp, /*in_place=*/0,
+                          comm);
+
+  /* Free the temporary buffer */
+  swift_free("writebuff", temp);
+}
+
 /**
  * @brief Writes a data array in given HDF5 group.
  *
@@ -594,12 +630,13 @@ void writeArray_chunk(struct engine* e, hid_t h_data,
  * @param offset Offset in the array where this mpi task starts writing.
  * @param internal_units The #unit_system used internally.
  * @param snapshot_units The #unit_system used in the snapshots.
+ * @param comm The communicator of the ranks writing to the file.
  */
 void writeArray(struct engine* e, hid_t grp, char* fileName,
                 char* partTypeGroupName, struct io_props props, size_t N,
                 long long N_total, int mpi_rank, long long offset,
                 const struct unit_system* internal_units,
-                const struct unit_system* snapshot_units) {
+                const struct unit_system* snapshot_units, MPI_Comm comm) {
 
   const size_t typeSize = io_sizeof_type(props.type);
 
@@ -623,7 +660,7 @@ void writeArray(struct engine* e, hid_t grp, char* fileName,
     /* Write the first chunk */
     const size_t this_chunk = (N > max_chunk_size) ? max_chunk_size : N;
     writeArray_chunk(e, h_data, props, this_chunk, offset, internal_units,
-                     snapshot_units);
+                     snapshot_units, comm);
 
     /* Compute how many items are left */
     if (N > max_chunk_size) {
@@ -641,8 +678,7 @@ void writeArray(struct engine* e, hid_t grp, char* fileName,
     }
 
     /* Do we need to run again ? */
-    MPI_Allreduce(MPI_IN_PLACE, &redo, 1, MPI_SIGNED_CHAR, MPI_MAX,
-                  MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &redo, 1, MPI_SIGNED_CHAR, MPI_MAX, comm);
 
     if (redo && e->verbose && mpi_rank == 0)
       message("Need to redo one iteration for array '%s'", props.name);
@@ -652,13 +688,159 @@ void writeArray(struct engine* e, hid_t grp, char* fileName,
   H5Dclose(h_data);
 
 #ifdef IO_SPEED_MEASUREMENT
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
   if (engine_rank == 0)
     message("'%s' took %.3f %s.", props.name,
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 #endif
 }
 
+/**
+ * @brief Writes a data array in given HDF5 group via the aggregator ranks.
+ *
+ * Every rank converts its particles to the snapshot units and sends them to
+ * the aggregator of its group. Only the aggregators then take part in the
+ * collective HDF5 writes, each writing the data of its whole group at once.
+ *
+ * @param e The #engine we are writing from.
+ * @param grp The group in which to write (only valid on the aggregators).
+ * @param props The #io_props of the field to write.
+ * @param N The number of particles to write from this rank.
+ * @param N_group The number of particles to write from this group.
+ * @param group_offset Offset in the array where this group starts writing.
+ * @param internal_units The #unit_system used internally.
+ * @param snapshot_units The #unit_system used in the snapshots.
+ * @param group_comm The communicator of the ranks sharing an aggregator.
+ * @param writer_comm The communicator of the aggregators
+ * (MPI_COMM_NULL on the other ranks).
+ */
+void writeArray_aggregated(struct engine* e, hid_t grp, struct io_props props,
+                           size_t N, long long N_group, long long group_offset,
+                           const struct unit_system* internal_units,
+                           const struct unit_system* snapshot_units,
+                           MPI_Comm group_comm, MPI_Comm writer_comm) {
+
+  const size_t typeSize = io_sizeof_type(props.type);
+  const size_t element_size = props.dimension * typeSize;
+
+  int group_rank, group_size;
+  MPI_Comm_rank(group_comm, &group_rank);
+  MPI_Comm_size(group_comm, &group_size);
+
+  /* Convert our own particles */
+  void* temp = NULL;
+  if (swift_memalign("writebuff", (void**)&temp, IO_BUFFER_ALIGNMENT,
+                     N * element_size) != 0)
+    error("Unable to allocate temporary i/o buffer");
+  io_copy_temp_buffer(temp, e, props, N, internal_units, snapshot_units);
+
+  /* Gather everything on the aggregator in units of whole particles */
+  if (N_group > INT_MAX)
+    error("Too many particles (%lld) to gather on one aggregator.", N_group);
+  MPI_Datatype particle_type;
+  MPI_Type_contiguous(element_size, MPI_BYTE, &particle_type);
+  MPI_Type_commit(&particle_type);
+
+  const int count = N;
+  int* counts = NULL;
+  int* displs = NULL;
+  void* group_temp = NULL;
+  if (group_rank == 0) {
+    counts = (int*)malloc(group_size * sizeof(int));
+    displs = (int*)malloc(group_size * sizeof(int));
+    if (counts == NULL || displs == NULL)
+      error("Unable to allocate aggregation counts");
+    if (swift_memalign("writebuff", (void**)&group_temp, IO_BUFFER_ALIGNMENT,
+                       N_group * element_size) != 0)
+      error("Unable to allocate aggregated i/o buffer");
+  }
+  MPI_Gather(&count, 1, MPI_INT, counts, 1, MPI_INT, 0, group_comm);
+  if (group_rank == 0) {
+    displs[0] = 0;
+    for (int i = 1; i < group_size; ++i)
+      displs[i] = displs[i - 1] + counts[i - 1];
+  }
+  MPI_Gatherv(temp, count, particle_type, group_temp, counts, displs,
+              particle_type, 0, group_comm);
+  MPI_Type_free(&particle_type);
+  swift_free("writebuff", temp);
+
+  /* The aggregators now write the data of their group */
+  if (group_rank == 0) {
+
+    const hid_t h_data = H5Dopen(grp, props.name, H5P_DEFAULT);
+    if (h_data < 0) error("Error while opening dataset '%s'.", props.name);
+
+    /* Same ROM-IO limitation as in writeArray() */
+    const size_t max_chunk_size = HDF5_PARALLEL_IO_MAX_BYTES / element_size;
+    size_t left = N_group;
+    long long offset = group_offset;
+    const char* data = (const char*)group_temp;
+    char redo = 1;
+    while (redo) {
+
+      const size_t this_chunk = (left > max_chunk_size) ? max_chunk_size : left;
+      writeArray_buffer_chunk(h_data, props, this_chunk, offset, data,
+                              /*in_place=*/0, writer_comm);
+
+      left -= this_chunk;
+      offset += this_chunk;
+      data += this_chunk * element_size;
+      redo = (left > 0);
+
+      /* Do we need to run again ? */
+      MPI_Allreduce(MPI_IN_PLACE, &redo, 1, MPI_SIGNED_CHAR, MPI_MAX,
+                    writer_comm);
+    }
+
+    H5Dclose(h_data);
+    swift_free("writebuff", group_temp);
+    free(counts);
+    free(displs);
+  }
+}
+
+/**
+ * @brief Creates the communicators used to funnel the snapshot data through
+ * a subset of aggregator ranks.
+ *
+ * The ranks of each node are split into (at most) aggregators_per_node groups
+ * of consecutive ranks. The first rank of each group is its aggregator.
+ *
+ * @param comm The communicator of all the ranks.
+ * @param aggregators_per_node The number of aggregators on each node.
+ * @param group_comm (return) The communicator of the ranks of our group.
+ * @param writer_comm (return) The communicator of the aggregators
+ * (MPI_COMM_NULL on the other ranks).
+ */
+static void io_make_aggregator_comms(MPI_Comm comm,
+                                     const int aggregators_per_node,
+                                     MPI_Comm* group_comm,
+                                     MPI_Comm* writer_comm) {
+
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  /* Start with the ranks sharing our node */
+  MPI_Comm node_comm;
+  MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL,
+                      &node_comm);
+  int node_rank, node_size;
+  MPI_Comm_rank(node_comm, &node_rank);
+  MPI_Comm_size(node_comm, &node_size);
+
+  /* Split them in groups */
+  const int num_groups = min(aggregators_per_node, node_size);
+  const int group = node_rank * num_groups / node_size;
+  MPI_Comm_split(node_comm, group, node_rank, group_comm);
+  MPI_Comm_free(&node_comm);
+
+  /* And gather the aggregators */
+  int group_rank;
+  MPI_Comm_rank(*group_comm, &group_rank);
+  MPI_Comm_split(comm, group_rank == 0 ? 0 : MPI_UNDEFINED, rank, writer_comm);
+}
+
 /**
  * @brief Reads an HDF5 initial condition file (GADGET-3 type) in parallel
  *
@@ -684,6 +866,8 @@ void writeArray(struct engine* e, hid_t grp, char* fileName,
  * IC velocities?
  * @param h The value of the reduced Hubble constant to use for correction.
  * @param a The current value of the scale-factor.
+ * @param initial_partition The #partition in which to decide the partition
+ * of ICs with cell meta-data, read cell by cell, or NULL to read slices.
  * @param mpi_rank The MPI rank of this node
  * @param mpi_size The number of MPI ranks
  * @param comm The MPI communicator
@@ -699,7 +883,8 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
                       size_t* Nblackholes, int* flag_entropy, int with_hydro,
                       int with_gravity, int with_stars, int with_black_holes,
                       int cleanup_h, int cleanup_sqrt_a, double h, double a,
-                      int mpi_rank, int mpi_size, MPI_Comm comm, MPI_Info info,
+                      struct partition* initial_partition, int mpi_rank,
+                      int mpi_size, MPI_Comm comm, MPI_Info info,
                       int n_threads, int dry_run) {
 
   hid_t h_file = 0, h_grp = 0;
@@ -709,7 +894,8 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
   long long numParticles_highWord[swift_type_count] = {0};
   size_t N[swift_type_count] = {0};
   long long N_total[swift_type_count] = {0};
-  long long offset[swift_type_count] = {0};
+  long long* ranges[swift_type_count];
+  int nr_ranges[swift_type_count];
   int dimension = 3; /* Assume 3D if nothing is specified */
   size_t Ndm = 0;
 
@@ -786,12 +972,6 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
   /* message("Found %lld particles in a %speriodic box of size [%f %f %f].", */
   /* 	  N_total[0], (periodic ? "": "non-"), dim[0], dim[1], dim[2]); */
 
-  /* Divide the particles among the tasks. */
-  for (int ptype = 0; ptype < swift_type_count; ++ptype) {
-    offset[ptype] = mpi_rank * N_total[ptype] / mpi_size;
-    N[ptype] = (mpi_rank + 1) * N_total[ptype] / mpi_size - offset[ptype];
-  }
-
   /* Close header */
   H5Gclose(h_grp);
 
@@ -837,6 +1017,13 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
     dim[j] *=
         units_conversion_factor(ic_units, internal_units, UNIT_CONV_LENGTH);
 
+  /* Divide the particles among the tasks. */
+  const double length_factor =
+      units_conversion_factor(ic_units, internal_units, UNIT_CONV_LENGTH) /
+      (cleanup_h ? h : 1.);
+  io_get_ic_ranges(h_file, dry_run ? NULL : initial_partition, length_factor,
+                   N_total, mpi_rank, mpi_size, comm, N, ranges, nr_ranges);
+
   /* Allocate memory to store SPH particles */
   if (with_hydro) {
     *Ngas = N[0];
@@ -883,6 +1070,10 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
   /* message("BoxSize = %lf", dim[0]); */
   /* message("NumPart = [%zd, %zd] Total = %zd", *Ngas, Ndm, *Ngparts); */
 
+  /* Let's initialise a bit of thread parallelism here */
+  struct threadpool tp;
+  threadpool_init(&tp, n_threads);
+
   /* Loop over all particle types */
   for (int ptype = 0; ptype < swift_type_count; ptype++) {
 
@@ -942,9 +1133,9 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
     /* Read everything */
     if (!dry_run)
       for (int i = 0; i < num_fields; ++i)
-        readArray(h_grp, list[i], Nparticles, N_total[ptype], mpi_rank,
-                  offset[ptype], internal_units, ic_units, cleanup_h,
-                  cleanup_sqrt_a, h, a);
+        readArray(&tp, h_grp, list[i], Nparticles, N_total[ptype], mpi_rank,
+                  ranges[ptype], nr_ranges[ptype], internal_units, ic_units,
+                  cleanup_h, cleanup_sqrt_a, h, a);
 
     /* Close particle group */
     H5Gclose(h_grp);
@@ -952,10 +1143,6 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
 
   if (!dry_run && with_gravity) {
 
-    /* Let's initialise a bit of thread parallelism here */
-    struct threadpool tp;
-    threadpool_init(&tp, n_threads);
-
     /* Prepare the DM particles */
     io_prepare_dm_gparts(&tp, *gparts, Ndm);
 
@@ -970,13 +1157,14 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
     if (with_black_holes)
       io_duplicate_black_holes_gparts(&tp, *bparts, *gparts, *Nblackholes,
                                       Ndm + *Ngas + *Nstars);
-
-    threadpool_clean(&tp);
   }
 
+  threadpool_clean(&tp);
+
   /* message("Done Reading particles..."); */
 
   /* Clean up */
+  for (int ptype = 0; ptype < swift_type_count; ptype++) free(ranges[ptype]);
   free(ic_units);
 
   /* Close property handler */
@@ -1090,6 +1278,11 @@ void prepare_file(struct engine* e, const char* baseName, long long N_total[6],
   io_write_attribute(h_grp, "Flag_Entropy_ICs", UINT, flagEntropy,
                      swift_type_count);
   io_write_attribute(h_grp, "NumFilesPerSnapshot", INT, &numFiles, 1);
+  if (e->snapshot_is_snipshot) {
+    io_write_attribute_i(h_grp, "Snipshot", 1);
+    io_write_attribute_f(h_grp, "SnipshotSubsampleFraction",
+                         e->snipshot_subsample_fraction);
+  }
 
   /* Close header */
   H5Gclose(h_grp);
@@ -1197,7 +1390,8 @@ void prepare_file(struct engine* e, const char* baseName, long long N_total[6],
 
       case swift_type_gas:
         hydro_write_particles(parts, xparts, list, &num_fields);
-        num_fields += chemistry_write_particles(parts, list + num_fields);
+        num_fields +=
+            chemistry_write_particles(parts, xparts, list + num_fields);
         if (with_cooling || with_temperature) {
           num_fields += cooling_write_particles(
               parts, xparts, list + num_fields, e->cooling_func);
@@ -1244,13 +1438,12 @@ void prepare_file(struct engine* e, const char* baseName, long long N_total[6],
     /* Prepare everything that is not cancelled */
     for (int i = 0; i < num_fields; ++i) {
 
-      /* Did the user cancel this field? */
-      char field[PARSER_MAX_LINE_SIZE];
-      sprintf(field, "SelectOutput:%s_%s", list[i].name,
-              part_type_names[ptype]);
-      int should_write = parser_get_opt_param_int(params, field, 1);
+      /* Did the user cancel this field or ask for a lossy filter? */
+      list[i].lossy_compression = io_get_field_compression(
+          params, list[i].name, part_type_names[ptype],
+          list[i].lossy_compression, e->snapshot_is_snipshot);
 
-      if (should_write)
+      if (list[i].lossy_compression != compression_do_not_write)
         prepareArray(e, h_grp, fileName, xmfFile, partTypeGroupName, list[i],
                      N_total[ptype], snapshot_units);
     }
@@ -1320,32 +1513,100 @@ void write_output_parallel(struct engine* e, const char* baseName,
   // const size_t Nbaryons = Ngas + Nstars;
   // const size_t Ndm = Ntot > 0 ? Ntot - Nbaryons : 0;
 
+  /* Snipshots only keep a subsample of the particles */
+  const int snipshot = e->snapshot_is_snipshot;
+  const float fraction = snipshot ? e->snipshot_subsample_fraction : 1.f;
+  const float threshold = snipshot ? e->snipshot_density_threshold : FLT_MAX;
+
   /* Number of particles that we will write */
   const size_t Ntot_written =
       e->s->nr_gparts - e->s->nr_inhibited_gparts - e->s->nr_extra_gparts;
-  const size_t Ngas_written =
+  size_t Ngas_written =
       e->s->nr_parts - e->s->nr_inhibited_parts - e->s->nr_extra_parts;
-  const size_t Nstars_written =
+  size_t Nstars_written =
       e->s->nr_sparts - e->s->nr_inhibited_sparts - e->s->nr_extra_sparts;
-  const size_t Nblackholes_written =
+  size_t Nblackholes_written =
       e->s->nr_bparts - e->s->nr_inhibited_bparts - e->s->nr_extra_bparts;
   const size_t Nbaryons_written =
       Ngas_written + Nstars_written + Nblackholes_written;
-  const size_t Ndm_written =
-      Ntot_written > 0 ? Ntot_written - Nbaryons_written : 0;
+  size_t Ndm_written = Ntot_written > 0 ? Ntot_written - Nbaryons_written : 0;
+  if (snipshot)
+    io_count_snipshot_particles(e->s, fraction, threshold, &Ngas_written,
+                                &Ndm_written, &Nstars_written,
+                                &Nblackholes_written);
 
   /* Compute offset in the file and total number of particles */
   size_t N[swift_type_count] = {Ngas_written,   Ndm_written,        0, 0,
                                 Nstars_written, Nblackholes_written};
   long long N_total[swift_type_count] = {0};
   long long offset[swift_type_count] = {0};
-  MPI_Exscan(&N, &offset, swift_type_count, MPI_LONG_LONG_INT, MPI_SUM, comm);
-  for (int ptype = 0; ptype < swift_type_count; ++ptype)
-    N_total[ptype] = offset[ptype] + N[ptype];
 
-  /* The last rank now has the correct N_total. Let's
-   * broadcast from there */
-  MPI_Bcast(&N_total, 6, MPI_LONG_LONG_INT, mpi_size - 1, comm);
+  /* Are we funnelling the data through a subset of aggregator ranks? */
+  const int with_aggregators = e->snapshot_aggregators_per_node > 0;
+  MPI_Comm group_comm = MPI_COMM_NULL;
+  MPI_Comm writer_comm = comm;
+  int is_writer = 1;
+  long long N_group[swift_type_count] = {0};
+  long long group_offset[swift_type_count] = {0};
+
+  if (!with_aggregators) {
+
+    MPI_Exscan(&N, &offset, swift_type_count, MPI_LONG_LONG_INT, MPI_SUM,
+               comm);
+    for (int ptype = 0; ptype < swift_type_count; ++ptype)
+      N_total[ptype] = offset[ptype] + N[ptype];
+
+    /* The last rank now has the correct N_total. Let's
+     * broadcast from there */
+    MPI_Bcast(&N_total, 6, MPI_LONG_LONG_INT, mpi_size - 1, comm);
+
+  } else {
+
+    io_make_aggregator_comms(comm, e->snapshot_aggregators_per_node,
+                             &group_comm, &writer_comm);
+    int group_rank;
+    MPI_Comm_rank(group_comm, &group_rank);
+    is_writer = (group_rank == 0);
+
+    /* Offsets of the ranks within their group... */
+    long long N_ll[swift_type_count];
+    long long local_offset[swift_type_count] = {0};
+    for (int ptype = 0; ptype < swift_type_count; ++ptype)
+      N_ll[ptype] = N[ptype];
+    MPI_Exscan(N_ll, local_offset, swift_type_count, MPI_LONG_LONG_INT,
+               MPI_SUM, group_comm);
+    if (group_rank == 0)
+      for (int ptype = 0; ptype < swift_type_count; ++ptype)
+        local_offset[ptype] = 0;
+    MPI_Allreduce(N_ll, N_group, swift_type_count, MPI_LONG_LONG_INT, MPI_SUM,
+                  group_comm);
+
+    /* ... of the groups within the file... */
+    if (is_writer) {
+      MPI_Exscan(N_group, group_offset, swift_type_count, MPI_LONG_LONG_INT,
+                 MPI_SUM, writer_comm);
+      int writer_rank;
+      MPI_Comm_rank(writer_comm, &writer_rank);
+      if (writer_rank == 0)
+        for (int ptype = 0; ptype < swift_type_count; ++ptype)
+          group_offset[ptype] = 0;
+    }
+    MPI_Bcast(group_offset, swift_type_count, MPI_LONG_LONG_INT, 0,
+              group_comm);
+
+    /* ... and hence of the ranks within the file */
+    for (int ptype = 0; ptype < swift_type_count; ++ptype)
+      offset[ptype] = group_offset[ptype] + local_offset[ptype];
+    MPI_Allreduce(N_ll, N_total, swift_type_count, MPI_LONG_LONG_INT, MPI_SUM,
+                  comm);
+
+    if (e->verbose && mpi_rank == 0) {
+      int num_writers;
+      MPI_Comm_size(writer_comm, &num_writers);
+      message("Writing the snapshot through %d aggregator ranks.",
+              num_writers);
+    }
+  }
 
   /* Now everybody konws its offset and the total number of
    * particles of each type */
@@ -1377,9 +1638,10 @@ void write_output_parallel(struct engine* e, const char* baseName,
     snprintf(fileName, FILENAME_BUFFER_SIZE, "%s_%04i.hdf5", baseName,
              e->snapshot_output_count);
 
-  /* Now write the top-level cell structure */
+  /* Now write the top-level cell structure (snipshots have only a subset
+   * of the particles of each cell and are not indexed) */
   hid_t h_file_cells = 0, h_grp_cells = 0;
-  if (mpi_rank == 0) {
+  if (!snipshot && mpi_rank == 0) {
 
     /* Open the snapshot on rank 0 */
     h_file_cells = H5Fopen(fileName, H5F_ACC_RDWR, H5P_DEFAULT);
@@ -1393,74 +1655,81 @@ void write_output_parallel(struct engine* e, const char* baseName,
   }
 
   /* Write the location of the particles in the arrays */
-  io_write_cell_offsets(h_grp_cells, e->s->cdim, e->s->cells_top,
-                        e->s->nr_cells, e->s->width, mpi_rank, N_total, offset,
-                        internal_units, snapshot_units);
+  if (!snipshot)
+    io_write_cell_offsets(h_grp_cells, e->s->cdim, e->s->cells_top,
+                          e->s->nr_cells, e->s->cells_top_order, e->s->width,
+                          mpi_rank, N_total, offset, internal_units,
+                          snapshot_units);
 
   /* Close everything */
-  if (mpi_rank == 0) {
+  if (!snipshot && mpi_rank == 0) {
     H5Gclose(h_grp_cells);
     H5Fclose(h_file_cells);
   }
 
-  /* Prepare some file-access properties */
-  hid_t plist_id = H5Pcreate(H5P_FILE_ACCESS);
+  /* Only the ranks writing to the file open it */
+  hid_t plist_id = 0, h_file = 0;
+  if (is_writer) {
+
+    /* Prepare some file-access properties */
+    plist_id = H5Pcreate(H5P_FILE_ACCESS);
 
-  /* Set some MPI-IO parameters */
-  // MPI_Info_set(info, "IBM_largeblock_io", "true");
-  MPI_Info_set(info, "romio_cb_write", "enable");
-  MPI_Info_set(info, "romio_ds_write", "disable");
+    /* Set some MPI-IO parameters */
+    // MPI_Info_set(info, "IBM_largeblock_io", "true");
+    MPI_Info_set(info, "romio_cb_write", "enable");
+    MPI_Info_set(info, "romio_ds_write", "disable");
 
-  /* Activate parallel i/o */
-  hid_t h_err = H5Pset_fapl_mpio(plist_id, comm, info);
-  if (h_err < 0) error("Error setting parallel i/o");
+    /* Activate parallel i/o */
+    hid_t h_err = H5Pset_fapl_mpio(plist_id, writer_comm, info);
+    if (h_err < 0) error("Error setting parallel i/o");
 
-  /* Align on 4k pages. */
-  h_err = H5Pset_alignment(plist_id, 1024, 4096);
-  if (h_err < 0) error("Error setting Hdf5 alignment");
+    /* Align on 4k pages. */
+    h_err = H5Pset_alignment(plist_id, 1024, 4096);
+    if (h_err < 0) error("Error setting Hdf5 alignment");
 
-  /* Disable meta-data cache eviction */
-  H5AC_cache_config_t mdc_config;
-  mdc_config.version = H5AC__CURR_CACHE_CONFIG_VERSION;
-  h_err = H5Pget_mdc_config(plist_id, &mdc_config);
-  if (h_err < 0) error("Error getting the MDC config");
+    /* Disable meta-data cache eviction */
+    H5AC_cache_config_t mdc_config;
+    mdc_config.version = H5AC__CURR_CACHE_CONFIG_VERSION;
+    h_err = H5Pget_mdc_config(plist_id, &mdc_config);
+    if (h_err < 0) error("Error getting the MDC config");
 
-  mdc_config.evictions_enabled = 0; /* false */
-  mdc_config.incr_mode = H5C_incr__off;
-  mdc_config.decr_mode = H5C_decr__off;
-  mdc_config.flash_incr_mode = H5C_flash_incr__off;
-  h_err = H5Pset_mdc_config(plist_id, &mdc_config);
-  if (h_err < 0) error("Error setting the MDC config");
+    mdc_config.evictions_enabled = 0; /* false */
+    mdc_config.incr_mode = H5C_incr__off;
+    mdc_config.decr_mode = H5C_decr__off;
+    mdc_config.flash_incr_mode = H5C_flash_incr__off;
+    h_err = H5Pset_mdc_config(plist_id, &mdc_config);
+    if (h_err < 0) error("Error setting the MDC config");
 
 /* Use parallel meta-data writes */
 #if H5_VERSION_GE(1, 10, 0)
-  h_err = H5Pset_all_coll_metadata_ops(plist_id, 1);
-  if (h_err < 0) error("Error setting collective meta-data on all ops");
-    // h_err = H5Pset_coll_metadata_write(plist_id, 1);
-    // if (h_err < 0) error("Error setting collective meta-data writes");
+    h_err = H5Pset_all_coll_metadata_ops(plist_id, 1);
+    if (h_err < 0) error("Error setting collective meta-data on all ops");
+      // h_err = H5Pset_coll_metadata_write(plist_id, 1);
+      // if (h_err < 0) error("Error setting collective meta-data writes");
 #endif
 
 #ifdef IO_SPEED_MEASUREMENT
-  MPI_Barrier(MPI_COMM_WORLD);
-  if (engine_rank == 0)
-    message("Setting parallel HDF5 access properties took %.3f %s.",
-            clocks_from_ticks(getticks() - tic), clocks_getunit());
+    MPI_Barrier(writer_comm);
+    if (engine_rank == 0)
+      message("Setting parallel HDF5 access properties took %.3f %s.",
+              clocks_from_ticks(getticks() - tic), clocks_getunit());
 
-  tic = getticks();
+    tic = getticks();
 #endif
 
-  /* Open HDF5 file with the chosen parameters */
-  hid_t h_file = H5Fopen(fileName, H5F_ACC_RDWR, plist_id);
-  if (h_file < 0) error("Error while opening file '%s'.", fileName);
+    /* Open HDF5 file with the chosen parameters */
+    h_file = H5Fopen(fileName, H5F_ACC_RDWR, plist_id);
+    if (h_file < 0) error("Error while opening file '%s'.", fileName);
 
 #ifdef IO_SPEED_MEASUREMENT
-  MPI_Barrier(MPI_COMM_WORLD);
-  if (engine_rank == 0)
-    message("Opening HDF5 file  took %.3f %s.",
-            clocks_from_ticks(getticks() - tic), clocks_getunit());
+    MPI_Barrier(writer_comm);
+    if (engine_rank == 0)
+      message("Opening HDF5 file  took %.3f %s.",
+              clocks_from_ticks(getticks() - tic), clocks_getunit());
 
-  tic = getticks();
+    tic = getticks();
 #endif
+  }
 
   /* Tell the user if a conversion will be needed */
   if (e->verbose && mpi_rank == 0) {
@@ -1505,9 +1774,12 @@ void write_output_parallel(struct engine* e, const char* baseName,
     char partTypeGroupName[PARTICLE_GROUP_BUFFER_SIZE];
     snprintf(partTypeGroupName, PARTICLE_GROUP_BUFFER_SIZE, "/PartType%d",
              ptype);
-    hid_t h_grp = H5Gopen(h_file, partTypeGroupName, H5P_DEFAULT);
-    if (h_grp < 0)
-      error("Error while opening particle group %s.", partTypeGroupName);
+    hid_t h_grp = 0;
+    if (is_writer) {
+      h_grp = H5Gopen(h_file, partTypeGroupName, H5P_DEFAULT);
+      if (h_grp < 0)
+        error("Error while opening particle group %s.", partTypeGroupName);
+    }
 
     int num_fields = 0;
     struct io_props list[100];
@@ -1529,7 +1801,8 @@ void write_output_parallel(struct engine* e, const char* baseName,
           /* No inhibted particles: easy case */
           Nparticles = Ngas;
           hydro_write_particles(parts, xparts, list, &num_fields);
-          num_fields += chemistry_write_particles(parts, list + num_fields);
+          num_fields +=
+              chemistry_write_particles(parts, xparts, list + num_fields);
           if (with_cooling || with_temperature) {
             num_fields += cooling_write_particles(
                 parts, xparts, list + num_fields, e->cooling_func);
@@ -1560,13 +1833,15 @@ void write_output_parallel(struct engine* e, const char* baseName,
 
           /* Collect the particles we want to write */
           io_collect_parts_to_write(parts, xparts, parts_written,
-                                    xparts_written, Ngas, Ngas_written);
+                                    xparts_written, Ngas, Ngas_written,
+                                    fraction, threshold);
 
           /* Select the fields to write */
           hydro_write_particles(parts_written, xparts_written, list,
                                 &num_fields);
           num_fields +=
-              chemistry_write_particles(parts_written, list + num_fields);
+              chemistry_write_particles(parts_written, xparts_written,
+                                        list + num_fields);
           if (with_cooling || with_temperature) {
             num_fields +=
                 cooling_write_particles(parts_written, xparts_written,
@@ -1617,7 +1892,7 @@ void write_output_parallel(struct engine* e, const char* baseName,
           /* Collect the non-inhibited DM particles from gpart */
           io_collect_gparts_to_write(gparts, e->s->gpart_group_data,
                                      gparts_written, gpart_group_data_written,
-                                     Ntot, Ndm_written, with_stf);
+                                     Ntot, Ndm_written, with_stf, fraction);
 
           /* Select the fields to write */
           darkmatter_write_particles(gparts_written, list, &num_fields);
@@ -1655,7 +1930,7 @@ void write_output_parallel(struct engine* e, const char* baseName,
 
           /* Collect the particles we want to write */
           io_collect_sparts_to_write(sparts, sparts_written, Nstars,
-                                     Nstars_written);
+                                     Nstars_written, fraction);
 
           /* Select the fields to write */
           stars_write_particles(sparts_written, list, &num_fields);
@@ -1691,7 +1966,7 @@ void write_output_parallel(struct engine* e, const char* baseName,
 
           /* Collect the particles we want to write */
           io_collect_bparts_to_write(bparts, bparts_written, Nblackholes,
-                                     Nblackholes_written);
+                                     Nblackholes_written, fraction);
 
           /* Select the fields to write */
           black_holes_write_particles(bparts_written, list, &num_fields);
@@ -1709,16 +1984,21 @@ void write_output_parallel(struct engine* e, const char* baseName,
     /* Write everything that is not cancelled */
     for (int i = 0; i < num_fields; ++i) {
 
-      /* Did the user cancel this field? */
-      char field[PARSER_MAX_LINE_SIZE];
-      sprintf(field, "SelectOutput:%s_%s", list[i].name,
-              part_type_names[ptype]);
-      int should_write = parser_get_opt_param_int(params, field, 1);
+      /* Did the user cancel this field or ask for a lossy filter? */
+      list[i].lossy_compression = io_get_field_compression(
+          params, list[i].name, part_type_names[ptype],
+          list[i].lossy_compression, snipshot);
+
+      if (list[i].lossy_compression == compression_do_not_write) continue;
 
-      if (should_write)
+      if (with_aggregators)
+        writeArray_aggregated(e, h_grp, list[i], Nparticles, N_group[ptype],
+                              group_offset[ptype], internal_units,
+                              snapshot_units, group_comm, writer_comm);
+      else
         writeArray(e, h_grp, fileName, partTypeGroupName, list[i], Nparticles,
                    N_total[ptype], mpi_rank, offset[ptype], internal_units,
-                   snapshot_units);
+                   snapshot_units, comm);
     }
 
     /* Free temporary array */
@@ -1736,7 +2016,7 @@ void write_output_parallel(struct engine* e, const char* baseName,
 #endif
 
     /* Close particle group */
-    H5Gclose(h_grp);
+    if (is_writer) H5Gclose(h_grp);
 
 #ifdef IO_SPEED_MEASUREMENT
     MPI_Barrier(MPI_COMM_WORLD);
@@ -1756,7 +2036,7 @@ void write_output_parallel(struct engine* e, const char* baseName,
   /* message("Done writing particles..."); */
 
   /* Close property descriptor */
-  H5Pclose(plist_id);
+  if (is_writer) H5Pclose(plist_id);
 
 #ifdef IO_SPEED_MEASUREMENT
   MPI_Barrier(MPI_COMM_WORLD);
@@ -1768,7 +2048,7 @@ void write_output_parallel(struct engine* e, const char* baseName,
 #endif
 
   /* Close file */
-  H5Fclose(h_file);
+  if (is_writer) H5Fclose(h_file);
 
 #ifdef IO_SPEED_MEASUREMENT
   MPI_Barrier(MPI_COMM_WORLD);
@@ -1777,6 +2057,12 @@ void write_output_parallel(struct engine* e, const char* baseName,
             clocks_getunit());
 #endif
 
+  /* Free the aggregation communicators */
+  if (with_aggregators) {
+    MPI_Comm_free(&group_comm);
+    if (writer_comm != MPI_COMM_NULL) MPI_Comm_free(&writer_comm);
+  }
+
   e->snapshot_output_count++;
 }
 
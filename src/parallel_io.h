@@ -40,7 +40,8 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
                       size_t* Nbparts, int* flag_entropy, int with_hydro,
                       int with_gravity, int with_stars, int with_black_holes,
                       int cleanup_h, int cleanup_sqrt_a, double h, double a,
-                      int mpi_rank, int mpi_size, MPI_Comm comm, MPI_Info info,
+                      struct partition* initial_partition, int mpi_rank,
+                      int mpi_size, MPI_Comm comm, MPI_Info info,
                       int nr_threads, int dry_run);
 
 void write_output_parallel(struct engine* e, const char* baseName,
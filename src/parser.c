@@ -57,6 +57,8 @@ static void find_duplicate_params(const struct swift_params *params,
                                   const char *param_name);
 static void find_duplicate_section(const struct swift_params *params,
                                    const char *section_name);
+static int find_param(const struct swift_params *params, const char *name);
+static void index_param(struct swift_params *params, int index);
 static int lineNumber = 0;
 
 /**
@@ -149,6 +151,7 @@ void parser_init(const char *file_name, struct swift_params *params) {
   params->paramCount = 0;
   params->sectionCount = 0;
   strcpy(params->fileName, file_name);
+  memset(params->hash_table, 0, sizeof(params->hash_table));
 }
 
 /**
@@ -230,16 +233,12 @@ void parser_set_param(struct swift_params *params, const char *namevalue) {
         namevalue);
 
   /* And update or set. */
-  int updated = 0;
-  for (int i = 0; i < params->paramCount; i++) {
-    if (strcmp(name, params->data[i].name) == 0) {
-      message("Value of '%s' changed from '%s' to '%s'", params->data[i].name,
-              params->data[i].value, value);
-      strcpy(params->data[i].value, trim_both(value));
-      updated = 1;
-    }
-  }
-  if (!updated) {
+  const int idx = find_param(params, name);
+  if (idx >= 0) {
+    message("Value of '%s' changed from '%s' to '%s'", params->data[idx].name,
+            params->data[idx].value, value);
+    strcpy(params->data[idx].value, trim_both(value));
+  } else {
     /* Is this a new section? */
     int newsection = 1;
     for (int i = 0; i < params->sectionCount; i++) {
@@ -260,6 +259,7 @@ void parser_set_param(struct swift_params *params, const char *namevalue) {
     strcpy(params->data[params->paramCount].value, value);
     params->data[params->paramCount].used = 0;
     params->data[params->paramCount].is_default = 0;
+    index_param(params, params->paramCount);
     params->paramCount++;
     if (params->paramCount == PARSER_MAX_NO_OF_PARAMS)
       error("Too many parameters, current maximum is %d.", params->paramCount);
@@ -314,12 +314,52 @@ static int is_empty(const char *str) {
 
 static void find_duplicate_params(const struct swift_params *params,
                                   const char *param_name) {
-  for (int i = 0; i < params->paramCount; i++) {
-    if (!strcmp(param_name, params->data[i].name)) {
-      error("Invalid line:%d '%s', parameter is a duplicate.", lineNumber,
-            param_name);
-    }
+  if (find_param(params, param_name) >= 0)
+    error("Invalid line:%d '%s', parameter is a duplicate.", lineNumber,
+          param_name);
+}
+
+/**
+ * @brief Hash of a parameter name (FNV-1a).
+ *
+ * @param name The full name (section:parameter) of the parameter.
+ */
+static unsigned int hash_param_name(const char *name) {
+  unsigned int hash = 2166136261u;
+  for (const char *c = name; *c != '\0'; c++) {
+    hash ^= (unsigned char)*c;
+    hash *= 16777619u;
   }
+  return hash;
+}
+
+/**
+ * @brief Find a parameter by name using the hash index.
+ *
+ * @param params Structure that holds the parameters
+ * @param name Full name (section:parameter) of the parameter
+ * @return The index of the parameter in params->data or -1 if not found.
+ */
+static int find_param(const struct swift_params *params, const char *name) {
+  const unsigned int mask = PARSER_HASH_TABLE_SIZE - 1;
+  for (unsigned int k = hash_param_name(name) & mask;; k = (k + 1) & mask) {
+    const int index = params->hash_table[k] - 1;
+    if (index < 0) return -1;
+    if (strcmp(name, params->data[index].name) == 0) return index;
+  }
+}
+
+/**
+ * @brief Add a freshly stored parameter to the hash index.
+ *
+ * @param params Structure that holds the parameters
+ * @param index The index of the parameter in params->data
+ */
+static void index_param(struct swift_params *params, int index) {
+  const unsigned int mask = PARSER_HASH_TABLE_SIZE - 1;
+  unsigned int k = hash_param_name(params->data[index].name) & mask;
+  while (params->hash_table[k] != 0) k = (k + 1) & mask;
+  params->hash_table[k] = index + 1;
 }
 
 /**
@@ -459,6 +499,7 @@ static void parse_value(char *line, struct swift_params *params) {
       strcpy(params->data[params->paramCount].value, token);
       params->data[params->paramCount].used = 0;
       params->data[params->paramCount].is_default = 0;
+      index_param(params, params->paramCount);
       if (params->paramCount == PARSER_MAX_NO_OF_PARAMS - 1) {
         error(
             "Maximal number of parameters in parameter file reached. Aborting "
@@ -520,6 +561,7 @@ static void parse_section_param(char *line, int *isFirstParam,
   strcpy(params->data[params->paramCount].value, token);
   params->data[params->paramCount].used = 0;
   params->data[params->paramCount].is_default = 0;
+  index_param(params, params->paramCount);
   if (params->paramCount == PARSER_MAX_NO_OF_PARAMS - 1) {
     error("Maximal number of parameters in parameter file reached. Aborting !");
   } else {
@@ -534,30 +576,29 @@ static void parse_section_param(char *line, int *isFirstParam,
   static int get_param_##TYPE(struct swift_params *params, const char *name,   \
                               TYPE *def, TYPE *result) {                       \
     char str[PARSER_MAX_LINE_SIZE];                                            \
-    for (int i = 0; i < params->paramCount; i++) {                             \
-      if (strcmp(name, params->data[i].name) == 0) {                           \
-        /* Check that exactly one number is parsed, capture junk. */           \
-        if (sscanf(params->data[i].value, " " FMT "%s ", result, str) != 1) {  \
-          error("Tried parsing " DESC                                          \
-                " '%s' but found '%s' with "                                   \
-                "illegal trailing characters '%s'.",                           \
-                params->data[i].name, params->data[i].value, str);             \
-        }                                                                      \
-        /* Ensure same behavior if called multiple times for same parameter */ \
-        if (params->data[i].is_default && def == NULL)                         \
-          error(                                                               \
-              "Tried parsing %s again but cannot parse a default "             \
-              "parameter as mandatory",                                        \
-              name);                                                           \
-        if (params->data[i].is_default && *def != *result)                     \
-          error(                                                               \
-              "Tried parsing %s again but cannot parse a parameter with "      \
-              "two different default value (" FMT "!=" FMT ")",                \
-              name, *def, *result);                                            \
-        /* This parameter has been used */                                     \
-        params->data[i].used = 1;                                              \
-        return 1;                                                              \
+    const int i = find_param(params, name);                                    \
+    if (i >= 0) {                                                              \
+      /* Check that exactly one number is parsed, capture junk. */             \
+      if (sscanf(params->data[i].value, " " FMT "%s ", result, str) != 1) {    \
+        error("Tried parsing " DESC                                            \
+              " '%s' but found '%s' with "                                     \
+              "illegal trailing characters '%s'.",                             \
+              params->data[i].name, params->data[i].value, str);               \
       }                                                                        \
+      /* Ensure same behavior if called multiple times for same parameter */   \
+      if (params->data[i].is_default && def == NULL)                           \
+        error(                                                                 \
+            "Tried parsing %s again but cannot parse a default "               \
+            "parameter as mandatory",                                          \
+            name);                                                             \
+      if (params->data[i].is_default && *def != *result)                       \
+        error(                                                                 \
+            "Tried parsing %s again but cannot parse a parameter with "        \
+            "two different default value (" FMT "!=" FMT ")",                  \
+            name, *def, *result);                                              \
+      /* This parameter has been used */                                       \
+      params->data[i].used = 1;                                                \
+      return 1;                                                                \
     }                                                                          \
     if (def == NULL)                                                           \
       error("Cannot find '%s' in the structure, in file '%s'.", name,          \
@@ -649,18 +690,17 @@ double parser_get_param_double(struct swift_params *params, const char *name) {
 void parser_get_param_string(struct swift_params *params, const char *name,
                              char *retParam) {
 
-  for (int i = 0; i < params->paramCount; i++) {
-    if (!strcmp(name, params->data[i].name)) {
-      if (params->data[i].is_default)
-        error(
-            "Tried parsing %s again but cannot parse a "
-            "default parameter as mandatory",
-            name);
-      strcpy(retParam, params->data[i].value);
-      /* this parameter has been used */
-      params->data[i].used = 1;
-      return;
-    }
+  const int i = find_param(params, name);
+  if (i >= 0) {
+    if (params->data[i].is_default)
+      error(
+          "Tried parsing %s again but cannot parse a "
+          "default parameter as mandatory",
+          name);
+    strcpy(retParam, params->data[i].value);
+    /* this parameter has been used */
+    params->data[i].used = 1;
+    return;
   }
 
   error("Cannot find '%s' in the structure.", name);
@@ -745,20 +785,19 @@ double parser_get_opt_param_double(struct swift_params *params,
 void parser_get_opt_param_string(struct swift_params *params, const char *name,
                                  char *retParam, const char *def) {
 
-  for (int i = 0; i < params->paramCount; i++) {
-    if (!strcmp(name, params->data[i].name)) {
-      strcpy(retParam, params->data[i].value);
-
-      /* Ensure same behavior if called multiple times for same parameter */
-      if (params->data[i].is_default && !strcmp(def, retParam))
-        error(
-            "Tried parsing %s again but cannot parse a parameter with "
-            "two different default value ('%s' != '%s')",
-            name, def, retParam);
-      /* this parameter has been used */
-      params->data[i].used = 1;
-      return;
-    }
+  const int i = find_param(params, name);
+  if (i >= 0) {
+    strcpy(retParam, params->data[i].value);
+
+    /* Ensure same behavior if called multiple times for same parameter */
+    if (params->data[i].is_default && !strcmp(def, retParam))
+      error(
+          "Tried parsing %s again but cannot parse a parameter with "
+          "two different default value ('%s' != '%s')",
+          name, def, retParam);
+    /* this parameter has been used */
+    params->data[i].used = 1;
+    return;
   }
   save_param_string(params, name, def);
   params->data[params->paramCount - 1].is_default = 1;
@@ -778,57 +817,56 @@ void parser_get_opt_param_string(struct swift_params *params, const char *name,
     char str[PARSER_MAX_LINE_SIZE];                                   \
     char cpy[PARSER_MAX_LINE_SIZE];                                   \
                                                                       \
-    for (int i = 0; i < params->paramCount; i++) {                    \
-      if (!strcmp(name, params->data[i].name)) {                      \
-        if (params->data[i].is_default && required)                   \
-          error(                                                      \
-              "Tried parsing %s again but cannot parse a default "    \
-              "parameter as mandatory",                               \
-              name);                                                  \
-        char *cp = cpy;                                               \
-        strcpy(cp, params->data[i].value);                            \
-        cp = trim_both(cp);                                           \
+    const int i = find_param(params, name);                           \
+    if (i >= 0) {                                                     \
+      if (params->data[i].is_default && required)                     \
+        error(                                                        \
+            "Tried parsing %s again but cannot parse a default "      \
+            "parameter as mandatory",                                 \
+            name);                                                    \
+      char *cp = cpy;                                                 \
+      strcpy(cp, params->data[i].value);                              \
+      cp = trim_both(cp);                                             \
                                                                       \
-        /* Strip off [], if present. */                               \
-        if (cp[0] == '[') cp++;                                       \
-        int l = strlen(cp);                                           \
-        if (cp[l - 1] == ']') cp[l - 1] = '\0';                       \
-        cp = trim_both(cp);                                           \
+      /* Strip off [], if present. */                                 \
+      if (cp[0] == '[') cp++;                                         \
+      int l = strlen(cp);                                             \
+      if (cp[l - 1] == ']') cp[l - 1] = '\0';                         \
+      cp = trim_both(cp);                                             \
                                                                       \
-        /* Format that captures spaces and trailing junk. */          \
-        char fmt[20];                                                 \
-        sprintf(fmt, " %s%%s ", FMT);                                 \
+      /* Format that captures spaces and trailing junk. */            \
+      char fmt[20];                                                   \
+      sprintf(fmt, " %s%%s ", FMT);                                   \
                                                                       \
-        /* Parse out values which should now be "v, v, v" with        \
-         * internal     whitespace variations. */                     \
-        char *p = strtok(cp, ",");                                    \
-        for (int k = 0; k < nval; k++) {                              \
-          if (p != NULL) {                                            \
-            TYPE tmp_value;                                           \
-            if (sscanf(p, fmt, &tmp_value, str) != 1) {               \
-              error("Tried parsing " DESC                             \
-                    " '%s' but found '%s' with "                      \
-                    "illegal " DESC " characters '%s'.",              \
-                    name, p, str);                                    \
-            }                                                         \
-            if (params->data[i].is_default && tmp_value != values[k]) \
-              error(                                                  \
-                  "Tried parsing %s again but cannot parse a "        \
-                  "parameter with two different default value "       \
-                  "(" FMT "!=" FMT ")",                               \
-                  name, tmp_value, values[k]);                        \
-            values[k] = tmp_value;                                    \
-          } else {                                                    \
-            error(                                                    \
-                "Array '%s' with value '%s' has too few values, "     \
-                "expected %d",                                        \
-                name, params->data[i].value, nval);                   \
+      /* Parse out values which should now be "v, v, v" with          \
+       * internal     whitespace variations. */                       \
+      char *p = strtok(cp, ",");                                      \
+      for (int k = 0; k < nval; k++) {                                \
+        if (p != NULL) {                                              \
+          TYPE tmp_value;                                             \
+          if (sscanf(p, fmt, &tmp_value, str) != 1) {                 \
+            error("Tried parsing " DESC                               \
+                  " '%s' but found '%s' with "                        \
+                  "illegal " DESC " characters '%s'.",                \
+                  name, p, str);                                      \
           }                                                           \
-          if (k < nval - 1) p = strtok(NULL, ",");                    \
+          if (params->data[i].is_default && tmp_value != values[k])   \
+            error(                                                    \
+                "Tried parsing %s again but cannot parse a "          \
+                "parameter with two different default value "         \
+                "(" FMT "!=" FMT ")",                                 \
+                name, tmp_value, values[k]);                          \
+          values[k] = tmp_value;                                      \
+        } else {                                                      \
+          error(                                                      \
+              "Array '%s' with value '%s' has too few values, "       \
+              "expected %d",                                          \
+              name, params->data[i].value, nval);                     \
         }                                                             \
-        params->data[i].used = 1;                                     \
-        return 1;                                                     \
+        if (k < nval - 1) p = strtok(NULL, ",");                      \
       }                                                               \
+      params->data[i].used = 1;                                       \
+      return 1;                                                       \
     }                                                                 \
     if (required)                                                     \
       error("Cannot find '%s' in the structure, in file '%s'.", name, \
@@ -1019,23 +1057,22 @@ static int get_string_array(struct swift_params *params, const char *name,
   char cpy[PARSER_MAX_LINE_SIZE];
   *nval = 0;
 
-  for (int i = 0; i < params->paramCount; i++) {
-    if (!strcmp(name, params->data[i].name)) {
-      char *cp = cpy;
-      strcpy(cp, params->data[i].value);
-      cp = trim_both(cp);
+  const int i = find_param(params, name);
+  if (i >= 0) {
+    char *cp = cpy;
+    strcpy(cp, params->data[i].value);
+    cp = trim_both(cp);
 
-      /* Strip off [], if present. */
-      if (cp[0] == '[') cp++;
-      int l = strlen(cp);
-      if (cp[l - 1] == ']') cp[l - 1] = '\0';
-      cp = trim_both(cp);
+    /* Strip off [], if present. */
+    if (cp[0] == '[') cp++;
+    int l = strlen(cp);
+    if (cp[l - 1] == ']') cp[l - 1] = '\0';
+    cp = trim_both(cp);
 
-      *nval = parse_quoted_strings(cp, values);
+    *nval = parse_quoted_strings(cp, values);
 
-      params->data[i].used = 1;
-      return 1;
-    }
+    params->data[i].used = 1;
+    return 1;
   }
   if (required)
     error("Cannot find '%s' in the structure, in file '%s'.", name,
@@ -35,6 +35,10 @@
 #define PARSER_MAX_NO_OF_PARAMS 512
 #define PARSER_MAX_NO_OF_SECTIONS 64
 
+/* Size of the hash index of the parameters. A power of two larger than
+ * PARSER_MAX_NO_OF_PARAMS so that the open addressing always finds a hole. */
+#define PARSER_HASH_TABLE_SIZE 1024
+
 /* A parameter in the input file */
 struct parameter {
   char name[PARSER_MAX_LINE_SIZE];
@@ -54,6 +58,11 @@ struct swift_params {
   int sectionCount;
   int paramCount;
   char fileName[PARSER_MAX_LINE_SIZE];
+
+  /* Hash index of data: position in the array plus one, 0 for empty slots.
+   * Plain integers so that the struct can still be broadcast and dumped as
+   * bytes. */
+  int hash_table[PARSER_HASH_TABLE_SIZE];
 };
 
 /* Public API. */
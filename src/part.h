@@ -47,9 +47,11 @@
 #if defined(MINIMAL_SPH)
 #include "./hydro/Minimal/hydro_part.h"
 #define hydro_need_extra_init_loop 0
+#define hydro_has_compact_mpi 1
 #elif defined(GADGET2_SPH)
 #include "./hydro/Gadget2/hydro_part.h"
 #define hydro_need_extra_init_loop 0
+#define hydro_has_compact_mpi 1
 #elif defined(HOPKINS_PE_SPH)
 #include "./hydro/PressureEntropy/hydro_part.h"
 #define hydro_need_extra_init_loop 1
@@ -80,7 +82,10 @@
 #elif defined(ANARCHY_DU_SPH)
 #include "./hydro/AnarchyDU/hydro_part.h"
 #define hydro_need_extra_init_loop 0
+#ifndef HYDRO_FUSED_GRADIENT_LOOP
+#define hydro_has_compact_mpi 1
 #define EXTRA_HYDRO_LOOP
+#endif
 #elif defined(ANARCHY_PU_SPH)
 #include "./hydro/AnarchyPU/hydro_part.h"
 #define hydro_need_extra_init_loop 0
@@ -89,6 +94,11 @@
 #error "Invalid choice of SPH variant"
 #endif
 
+/* Schemes that do not exchange compact foreign particles. */
+#ifndef hydro_has_compact_mpi
+#define hydro_has_compact_mpi 0
+#endif
+
 /* Import the right gravity particle definition */
 #if defined(DEFAULT_GRAVITY)
 #include "./gravity/Default/gravity_part.h"
@@ -120,6 +130,43 @@
 #error "Invalid choice of black hole particle"
 #endif
 
+/**
+ * @brief The fields of a #part sent by the compact xv communications.
+ *
+ * These are all the fields read from foreign particles by the density loops
+ * (including the chemistry and the stars/black holes neighbour loops) and
+ * when unpacking a received cell. The scheme-specific fields needed by the
+ * later loops travel in its own #rho_part_pack and #gradient_part_pack.
+ */
+struct xv_part_pack {
+
+  /*! Particle position. */
+  double x[3];
+
+  /*! Particle ID. */
+  long long id;
+
+  /*! Particle predicted velocity. */
+  float v[3];
+
+  /*! Particle smoothing length. */
+  float h;
+
+  /*! Particle mass. */
+  float mass;
+
+  /*! Chemistry information, used by the smoothed metallicities. */
+  struct chemistry_part_data chemistry_data;
+
+  /*! Time-step bin. */
+  timebin_t time_bin;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  /*! Time of the last drift. */
+  integertime_t ti_drift;
+#endif
+};
+
 void part_relink_gparts_to_parts(struct part *parts, size_t N,
                                  ptrdiff_t offset);
 void part_relink_gparts_to_sparts(struct spart *sparts, size_t N,
@@ -66,13 +66,15 @@
 const char *initial_partition_name[] = {
     "axis aligned grids of cells", "vectorized point associated cells",
     "memory balanced, using particle weighted cells",
-    "similar sized regions, using unweighted cells"};
+    "similar sized regions, using unweighted cells",
+    "memory balanced, using a Peano-Hilbert ordering of the cells"};
 
 /* Simple descriptions of repartition types for reports. */
 const char *repartition_name[] = {
     "none", "edge and vertex task cost weights", "task cost edge weights",
     "memory balanced, using particle vertex weights",
-    "vertex task costs and edge delta timebin weights"};
+    "vertex task costs and edge delta timebin weights",
+    "memory balanced, using a Peano-Hilbert ordering of the cells"};
 
 /* Local functions, if needed. */
 static int check_complete(struct space *s, int verbose, int nregions);
@@ -324,7 +326,7 @@ static void graph_init(struct space *s, int periodic, idx_t *weights_e,
 }
 #endif
 
-#if defined(WITH_MPI) && (defined(HAVE_METIS) || defined(HAVE_PARMETIS))
+#if defined(WITH_MPI)
 struct counts_mapper_data {
   double *counts;
   size_t size;
@@ -438,6 +440,7 @@ static void accumulate_sizes(struct space *s, double *counts) {
                    &mapper_data);
   }
 
+#if defined(HAVE_METIS) || defined(HAVE_PARMETIS)
   /* Keep the sum of particles across all ranks in the range of IDX_MAX. */
   if ((s->e->total_nr_parts * hsize + s->e->total_nr_gparts * gsize +
        s->e->total_nr_sparts * ssize) > (double)IDX_MAX) {
@@ -447,6 +450,192 @@ static void accumulate_sizes(struct space *s, double *counts) {
                  s->e->total_nr_sparts * ssize);
     for (int k = 0; k < s->nr_cells; k++) counts[k] *= vscale;
   }
+#endif
+}
+#endif
+
+  /* Peano-Hilbert support
+   * =====================
+   *
+   * The top-level cells are ordered along a Peano-Hilbert curve, which is
+   * then cut into contiguous segments of equal weight. This is O(N log N) in
+   * the number of cells and all the ranks can do it independently.
+   */
+
+#if defined(WITH_MPI)
+/**
+ * @brief Position of a cell along a 3D Peano-Hilbert curve.
+ *
+ * Uses the algorithm of Skilling (2004, AIP Conf. Proc. 707, 381).
+ *
+ * @param ix the x index of the cell.
+ * @param iy the y index of the cell.
+ * @param iz the z index of the cell.
+ * @param bits the number of bits per dimension (at most 21).
+ */
+static unsigned long long hilbert_key(const int ix, const int iy, const int iz,
+                                      const int bits) {
+
+  unsigned int X[3] = {(unsigned int)ix, (unsigned int)iy, (unsigned int)iz};
+  const unsigned int M = 1u << (bits - 1);
+
+  /* Inverse undo. */
+  for (unsigned int Q = M; Q > 1; Q >>= 1) {
+    const unsigned int P = Q - 1;
+    for (int i = 0; i < 3; i++) {
+      if (X[i] & Q) {
+        X[0] ^= P;
+      } else {
+        const unsigned int t = (X[0] ^ X[i]) & P;
+        X[0] ^= t;
+        X[i] ^= t;
+      }
+    }
+  }
+
+  /* Gray encode. */
+  for (int i = 1; i < 3; i++) X[i] ^= X[i - 1];
+  unsigned int t = 0;
+  for (unsigned int Q = M; Q > 1; Q >>= 1)
+    if (X[2] & Q) t ^= Q - 1;
+  for (int i = 0; i < 3; i++) X[i] ^= t;
+
+  /* Interleave the transposed form into a single key. */
+  unsigned long long key = 0;
+  for (int b = bits - 1; b >= 0; b--)
+    for (int i = 0; i < 3; i++) key = (key << 1) | ((X[i] >> b) & 1);
+  return key;
+}
+
+/* qsort support. */
+struct hilbert_cell {
+  unsigned long long key;
+  int index;
+};
+static int hilbertcellcmp(const void *p1, const void *p2) {
+  const struct hilbert_cell *c1 = (const struct hilbert_cell *)p1;
+  const struct hilbert_cell *c2 = (const struct hilbert_cell *)p2;
+  return (c1->key > c2->key) - (c1->key < c2->key);
+}
+
+/**
+ * @brief Partition a grid of cells into contiguous segments of a
+ * Peano-Hilbert curve.
+ *
+ * @param cdim the number of cells per dimension of the grid to partition.
+ * @param nregions the number of regions required in the partition.
+ * @param weights weights for the cells, sizeof number of cells, NULL for unit
+ *        weights. Must be the same on all the ranks.
+ * @param celllist on exit this contains the ids of the selected regions,
+ *        sizeof number of cells.
+ */
+static void pick_hilbert(const int cdim[3], int nregions,
+                         const double *weights, int *celllist) {
+
+  const int ncells = cdim[0] * cdim[1] * cdim[2];
+
+  /* Number of bits needed to cover the largest dimension. */
+  int bits = 1;
+  while ((1 << bits) < max3(cdim[0], cdim[1], cdim[2])) bits++;
+
+  /* Sort the cells along the curve. */
+  struct hilbert_cell *order =
+      (struct hilbert_cell *)malloc(sizeof(struct hilbert_cell) * ncells);
+  if (order == NULL) error("Failed to allocate the Peano-Hilbert keys.");
+  for (int i = 0; i < cdim[0]; i++) {
+    for (int j = 0; j < cdim[1]; j++) {
+      for (int k = 0; k < cdim[2]; k++) {
+        const int cid = cell_getid(cdim, i, j, k);
+        order[cid].key = hilbert_key(i, j, k, bits);
+        order[cid].index = cid;
+      }
+    }
+  }
+  qsort(order, ncells, sizeof(struct hilbert_cell), hilbertcellcmp);
+
+  /* Fall back to unit weights if there is nothing to balance. */
+  double total = 0.0;
+  if (weights != NULL)
+    for (int k = 0; k < ncells; k++) total += weights[k];
+  if (total <= 0.0) {
+    weights = NULL;
+    total = ncells;
+  }
+
+  /* And cut the curve where the cumulative weight crosses the multiples of
+   * the mean weight per region. */
+  double sum = 0.0;
+  for (int k = 0; k < ncells; k++) {
+    const int cid = order[k].index;
+    const double w = (weights != NULL) ? weights[cid] : 1.0;
+    const int region = (int)((sum + 0.5 * w) * nregions / total);
+    celllist[cid] = min(region, nregions - 1);
+    sum += w;
+  }
+
+  free(order);
+}
+
+/**
+ * @brief Repartition the cells amongst the nodes using a Peano-Hilbert
+ *        ordering weighted by the memory use of the particles.
+ *
+ * @param repartition the partition struct of the local engine.
+ * @param nodeID our nodeID.
+ * @param nr_nodes the number of nodes.
+ * @param s the space of cells holding our local particles.
+ */
+static void repart_hilbert(struct repartition *repartition, int nodeID,
+                           int nr_nodes, struct space *s) {
+
+  /* Space for counts of particle memory use per cell. */
+  double *weights = NULL;
+  if ((weights = (double *)malloc(sizeof(double) * s->nr_cells)) == NULL)
+    error("Failed to allocate cell weights buffer.");
+
+  /* Check each particle and accumulate the sizes per cell. */
+  accumulate_sizes(s, weights);
+
+  /* Get all the counts from all the nodes. */
+  if (MPI_Allreduce(MPI_IN_PLACE, weights, s->nr_cells, MPI_DOUBLE, MPI_SUM,
+                    MPI_COMM_WORLD) != MPI_SUCCESS)
+    error("Failed to allreduce particle cell weights.");
+
+  /* Allocate cell list for the partition. If not already done. */
+  if (repartition->ncelllist != s->nr_cells) {
+    free(repartition->celllist);
+    repartition->ncelllist = 0;
+    if ((repartition->celllist = (int *)malloc(sizeof(int) * s->nr_cells)) ==
+        NULL)
+      error("Failed to allocate celllist");
+    repartition->ncelllist = s->nr_cells;
+  }
+
+  /* And repartition. */
+  pick_hilbert(s->cdim, nr_nodes, weights, repartition->celllist);
+
+  /* Check that all nodes have some work. */
+  int present[nr_nodes];
+  for (int i = 0; i < nr_nodes; i++) present[i] = 0;
+  for (int i = 0; i < s->nr_cells; i++) present[repartition->celllist[i]]++;
+  int failed = 0;
+  for (int i = 0; i < nr_nodes; i++) failed |= !present[i];
+
+  /* If partition failed continue with the current one, but make this clear. */
+  if (failed) {
+    if (nodeID == 0)
+      message(
+          "WARNING: repartition has failed, continuing with the current"
+          " partition, load balance will not be optimal");
+    for (int k = 0; k < s->nr_cells; k++)
+      repartition->celllist[k] = s->cells_top[k].nodeID;
+  }
+
+  /* And apply to our cells. */
+  for (int k = 0; k < s->nr_cells; k++)
+    s->cells_top[k].nodeID = repartition->celllist[k];
+
+  free(weights);
 }
 #endif
 
@@ -1245,6 +1434,142 @@ static void pick_metis(int nodeID, struct space *s, int nregions,
 
 #if defined(WITH_MPI) && (defined(HAVE_METIS) || defined(HAVE_PARMETIS))
 
+/* qsort support. */
+struct regionload {
+  int region;
+  double load;
+};
+static int regionloadcmp(const void *p1, const void *p2) {
+  const struct regionload *r1 = (const struct regionload *)p1;
+  const struct regionload *r2 = (const struct regionload *)p2;
+  return (r1->load < r2->load) - (r1->load > r2->load);
+}
+
+/**
+ * @brief Incrementally rebalance the current partition of the space.
+ *
+ * Rather than computing a new partition from scratch, the cells on the
+ * boundary of the overloaded regions are shifted to their least loaded
+ * neighbouring region, as long as that reduces the imbalance between the two
+ * regions. The most loaded regions are dealt with first. The passes over the
+ * cells stop when no cell can be moved or when the given fraction of the
+ * cells has changed region, which bounds the number of particles the
+ * following redistribution has to move.
+ *
+ * @param nodeID the rank of our node.
+ * @param s the space of cells to partition.
+ * @param nregions the number of regions required in the partition.
+ * @param vertexw weights for the cells, sizeof number of cells.
+ * @param inds the neighbours of each cell, sizeof number of cells * 26.
+ * @param budget the maximal fraction of the cells that can change region.
+ * @param celllist on exit this contains the ids of the selected regions,
+ *        sizeof number of cells.
+ */
+static void pick_diffusive(int nodeID, struct space *s, int nregions,
+                           const double *vertexw, const idx_t *inds,
+                           float budget, int *celllist) {
+
+  /* Total number of cells. */
+  const int ncells = s->cdim[0] * s->cdim[1] * s->cdim[2];
+
+  /* Only one node needs to calculate this. */
+  if (nodeID == 0) {
+
+    double *load = (double *)calloc(nregions, sizeof(double));
+    int *count = (int *)calloc(nregions, sizeof(int));
+    int *offset = (int *)malloc(sizeof(int) * (nregions + 1));
+    int *cellids = (int *)malloc(sizeof(int) * ncells);
+    struct regionload *order =
+        (struct regionload *)malloc(sizeof(struct regionload) * nregions);
+    if (load == NULL || count == NULL || offset == NULL || cellids == NULL ||
+        order == NULL)
+      error("Failed to allocate the diffusion buffers.");
+
+    /* Start from the current partition. */
+    double total = 0.0;
+    for (int k = 0; k < ncells; k++) {
+      celllist[k] = s->cells_top[k].nodeID;
+      load[celllist[k]] += vertexw[k];
+      count[celllist[k]]++;
+      total += vertexw[k];
+    }
+    const double target = total / nregions;
+    const int max_moves = max((int)(budget * ncells), 1);
+
+    int moves = 0;
+    int moved = 1;
+    while (moved && moves < max_moves) {
+      moved = 0;
+
+      /* Sort the regions by decreasing load... */
+      for (int i = 0; i < nregions; i++) {
+        order[i].region = i;
+        order[i].load = load[i];
+      }
+      qsort(order, nregions, sizeof(struct regionload), regionloadcmp);
+
+      /* ...and list the cells of each region. */
+      offset[0] = 0;
+      for (int i = 0; i < nregions; i++) offset[i + 1] = offset[i] + count[i];
+      for (int k = 0; k < ncells; k++) cellids[offset[celllist[k]]++] = k;
+      for (int i = nregions; i > 0; i--) offset[i] = offset[i - 1];
+      offset[0] = 0;
+
+      for (int i = 0; i < nregions && moves < max_moves; i++) {
+        const int a = order[i].region;
+        if (load[a] <= target) break;
+
+        for (int l = offset[a]; l < offset[a + 1] && moves < max_moves; l++) {
+
+          /* Only cells with some work can go, and regions cannot empty. */
+          const int k = cellids[l];
+          const double w = vertexw[k];
+          if (load[a] <= target) break;
+          if (w <= 0.0 || count[a] == 1) continue;
+
+          /* Find the least loaded region on the other side of the boundary. */
+          int b = -1;
+          for (int j = 26 * k; j < 26 * k + 26; j++) {
+            const int n = celllist[inds[j]];
+            if (n != a && (b == -1 || load[n] < load[b])) b = n;
+          }
+
+          /* Move the cell if this makes the two regions more even. */
+          if (b != -1 && load[b] + w < load[a]) {
+            celllist[k] = b;
+            load[a] -= w;
+            load[b] += w;
+            count[a]--;
+            count[b]++;
+            moves++;
+            moved = 1;
+          }
+        }
+      }
+    }
+
+    if (s->e->verbose) {
+      double max_load = 0.0;
+      for (int i = 0; i < nregions; i++) max_load = max(max_load, load[i]);
+      message("moved %d cells, imbalance is now %.3f.", moves,
+              target > 0.0 ? max_load / target : 1.0);
+    }
+
+    free(load);
+    free(count);
+    free(offset);
+    free(cellids);
+    free(order);
+  }
+
+  /* Calculations all done, now everyone gets a copy. */
+  int res = MPI_Bcast(celllist, ncells, MPI_INT, 0, MPI_COMM_WORLD);
+  if (res != MPI_SUCCESS) mpi_error(res, "Failed to broadcast new celllist");
+}
+#endif
+
+#if defined(WITH_MPI) && (defined(HAVE_METIS) || defined(HAVE_PARMETIS))
+
 /* Helper struct for partition_gather weights. */
 struct weights_mapper_data {
   double *weights_e;
@@ -1256,9 +1581,81 @@ struct weights_mapper_data {
   int vweights;
   int nr_cells;
   int use_ticks;
+  int compact_hydro;
+  double comm_edge_cost;
   struct cell *cells;
 };
 
+/**
+ * @brief Number of bytes sent over MPI by a send task during the last step.
+ *
+ * @param t The send #task.
+ * @param compact_hydro Are the hydro particles sent in compact form?
+ */
+static double partition_send_bytes(const struct task *t,
+                                   const int compact_hydro) {
+
+  const struct cell *c = t->ci;
+  switch (t->subtype) {
+    case task_subtype_xv:
+    case task_subtype_rho:
+    case task_subtype_gradient:
+      if (compact_hydro)
+        return (double)c->hydro.count * cell_pack_hydro_size(t->subtype);
+      return (double)c->hydro.count * sizeof(struct part);
+    case task_subtype_gpart:
+      return (double)c->grav.count * sizeof(struct gpart);
+    case task_subtype_spart:
+      return (double)c->stars.count * sizeof(struct spart);
+    case task_subtype_bpart:
+      return (double)c->black_holes.count * sizeof(struct bpart);
+    case task_subtype_tend_part:
+      return (double)c->mpi.pcell_size * sizeof(struct pcell_step_hydro);
+    case task_subtype_tend_gpart:
+      return (double)c->mpi.pcell_size * sizeof(struct pcell_step_grav);
+    case task_subtype_tend_spart:
+      return (double)c->mpi.pcell_size * sizeof(struct pcell_step_stars);
+    case task_subtype_tend_bpart:
+      return (double)c->mpi.pcell_size *
+             sizeof(struct pcell_step_black_holes);
+    case task_subtype_multipole:
+      return (double)c->mpi.pcell_size * sizeof(struct gravity_tensors);
+    case task_subtype_sf_counts:
+      return (double)c->mpi.pcell_size * sizeof(struct pcell_sf);
+    default:
+      return 0.;
+  }
+}
+
+/**
+ * @brief Finds the edges of the graph between two top-level cells.
+ *
+ * @param inds The adjacency array of the graph.
+ * @param nr_cells The number of top-level cells.
+ * @param cid The index of the first cell.
+ * @param cjd The index of the second cell.
+ * @param ik (return) The edge from the first cell, -1 if none.
+ * @param jk (return) The edge from the second cell, -1 if none.
+ */
+static void partition_find_edges(const idx_t *inds, const int nr_cells,
+                                 const int cid, const int cjd, int *ik,
+                                 int *jk) {
+  *ik = -1;
+  for (int k = 26 * cid; k < 26 * nr_cells; k++) {
+    if (inds[k] == cjd) {
+      *ik = k;
+      break;
+    }
+  }
+  *jk = -1;
+  for (int k = 26 * cjd; k < 26 * nr_cells; k++) {
+    if (inds[k] == cid) {
+      *jk = k;
+      break;
+    }
+  }
+}
+
 #ifdef SWIFT_DEBUG_CHECKS
 static void check_weights(struct task *tasks, int nr_tasks,
                           struct weights_mapper_data *weights_data,
@@ -1288,6 +1685,8 @@ static void partition_gather_weights(void *map_data, int num_elements,
   int timebins = mydata->timebins;
   int vweights = mydata->vweights;
   int use_ticks = mydata->use_ticks;
+  int compact_hydro = mydata->compact_hydro;
+  double comm_edge_cost = mydata->comm_edge_cost;
 
   struct cell *cells = mydata->cells;
 
@@ -1295,6 +1694,25 @@ static void partition_gather_weights(void *map_data, int num_elements,
   for (int i = 0; i < num_elements; i++) {
     struct task *t = &tasks[i];
 
+    /* Send tasks that ran add the volume of data they sent to the edge
+     * between the two top-level cells, if requested. */
+    if (t->type == task_type_send && eweights && !timebins &&
+        comm_edge_cost > 0. && t->toc > 0) {
+      struct cell *ci, *cj;
+      for (ci = t->ci; ci->parent != NULL; ci = ci->parent)
+        ;
+      for (cj = t->cj; cj->parent != NULL; cj = cj->parent)
+        ;
+      int ik, jk;
+      partition_find_edges(inds, nr_cells, ci - cells, cj - cells, &ik, &jk);
+      if (ik != -1 && jk != -1) {
+        const double w =
+            comm_edge_cost * partition_send_bytes(t, compact_hydro);
+        atomic_add_d(&weights_e[ik], w);
+        atomic_add_d(&weights_e[jk], w);
+      }
+    }
+
     /* Skip un-interesting tasks. */
     if (t->type == task_type_send || t->type == task_type_recv ||
         t->type == task_type_logger || t->implicit || t->ci == NULL)
@@ -1478,6 +1896,9 @@ static void repart_edge_metis(int vweights, int eweights, int timebins,
   weights_data.weights_e = weights_e;
   weights_data.weights_v = weights_v;
   weights_data.use_ticks = repartition->use_ticks;
+  weights_data.compact_hydro =
+      (s->e->sched.flags & scheduler_flag_compact_hydro) != 0;
+  weights_data.comm_edge_cost = repartition->comm_edge_cost;
 
   ticks tic = getticks();
 
@@ -1587,18 +2008,24 @@ static void repart_edge_metis(int vweights, int eweights, int timebins,
   }
 
     /* And repartition/ partition, using both weights or not as requested. */
+  if (vweights && repartition->diffusion_budget > 0.f) {
+    pick_diffusive(nodeID, s, nr_nodes, weights_v, inds,
+                   repartition->diffusion_budget, repartition->celllist);
+  } else {
 #ifdef HAVE_PARMETIS
-  if (repartition->usemetis) {
+    if (repartition->usemetis) {
+      pick_metis(nodeID, s, nr_nodes, weights_v, weights_e,
+                 repartition->celllist);
+    } else {
+      pick_parmetis(nodeID, s, nr_nodes, weights_v, weights_e, refine,
+                    repartition->adaptive, repartition->itr,
+                    repartition->celllist);
+    }
+#else
     pick_metis(nodeID, s, nr_nodes, weights_v, weights_e,
                repartition->celllist);
-  } else {
-    pick_parmetis(nodeID, s, nr_nodes, weights_v, weights_e, refine,
-                  repartition->adaptive, repartition->itr,
-                  repartition->celllist);
-  }
-#else
-  pick_metis(nodeID, s, nr_nodes, weights_v, weights_e, repartition->celllist);
 #endif
+  }
 
   /* Check that all cells have good values. All nodes have same copy, so just
    * check on one. */
@@ -1755,11 +2182,15 @@ void partition_repartition(struct repartition *reparttype, int nodeID,
                            int nr_nodes, struct space *s, struct task *tasks,
                            int nr_tasks) {
 
-#if defined(WITH_MPI) && (defined(HAVE_METIS) || defined(HAVE_PARMETIS))
+#if defined(WITH_MPI)
 
   ticks tic = getticks();
 
-  if (reparttype->type == REPART_METIS_VERTEX_EDGE_COSTS) {
+  if (reparttype->type == REPART_HILBERT_COUNTS) {
+    repart_hilbert(reparttype, nodeID, nr_nodes, s);
+
+#if defined(HAVE_METIS) || defined(HAVE_PARMETIS)
+  } else if (reparttype->type == REPART_METIS_VERTEX_EDGE_COSTS) {
     repart_edge_metis(1, 1, 0, reparttype, nodeID, nr_nodes, s, tasks,
                       nr_tasks);
 
@@ -1773,6 +2204,7 @@ void partition_repartition(struct repartition *reparttype, int nodeID,
 
   } else if (reparttype->type == REPART_METIS_VERTEX_COUNTS) {
     repart_memory_metis(reparttype, nodeID, nr_nodes, s);
+#endif
 
   } else if (reparttype->type == REPART_NONE) {
     /* Doing nothing. */
@@ -1785,10 +2217,100 @@ void partition_repartition(struct repartition *reparttype, int nodeID,
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
 #else
-  error("SWIFT was not compiled with METIS or ParMETIS support.");
+  error("SWIFT was not compiled with MPI support.");
+#endif
+}
+
+/**
+ * @brief Partition the cells of ICs that carry cell meta-data, before the
+ * particles are read.
+ *
+ * The cells are cut into segments of a Peano-Hilbert curve of equal weight,
+ * each rank then reads only the particles of its own cells. The partition is
+ * kept in the #partition and applied to the top-level cells of the space by
+ * partition_initial_partition().
+ *
+ * @param initial_partition the #partition to update.
+ * @param nr_nodes the number of nodes.
+ * @param cdim the number of cells per dimension in the ICs.
+ * @param width the width of the cells of the ICs (internal units).
+ * @param weights weights for the cells of the ICs, sizeof number of cells.
+ *        Must be the same on all the ranks.
+ *
+ * @return the list of the regions of the cells, sizeof number of cells, or
+ *         NULL if some regions are empty.
+ */
+const int *partition_ic_cells(struct partition *initial_partition,
+                              int nr_nodes, const int cdim[3],
+                              const double width[3], const double *weights) {
+#if defined(WITH_MPI)
+  const int ncells = cdim[0] * cdim[1] * cdim[2];
+
+  free(initial_partition->ic_celllist);
+  initial_partition->ic_celllist = NULL;
+
+  int *celllist = NULL;
+  if ((celllist = (int *)malloc(sizeof(int) * ncells)) == NULL)
+    error("Failed to allocate the ICs celllist");
+  pick_hilbert(cdim, nr_nodes, weights, celllist);
+
+  /* Regions can be empty with very clustered weights, so check. */
+  int *present = NULL;
+  if ((present = (int *)calloc(nr_nodes, sizeof(int))) == NULL)
+    error("Failed to allocate present array");
+  for (int k = 0; k < ncells; k++) present[celllist[k]]++;
+  int failed = 0;
+  for (int k = 0; k < nr_nodes; k++) failed |= !present[k];
+  free(present);
+  if (failed) {
+    free(celllist);
+    return NULL;
+  }
+
+  for (int k = 0; k < 3; k++) {
+    initial_partition->ic_cdim[k] = cdim[k];
+    initial_partition->ic_width[k] = width[k];
+  }
+  initial_partition->ic_celllist = celllist;
+  return celllist;
+#else
+  error("SWIFT was not compiled with MPI support");
+  return NULL;
 #endif
 }
 
+/**
+ * @brief Apply the partition of the cells of the ICs to the top-level cells
+ * of a space, which can have a different size.
+ *
+ * Each cell gets the node of the cell of the ICs containing its centre.
+ *
+ * @param initial_partition the #partition holding the partition of the ICs.
+ * @param s the space to partition.
+ */
+static void partition_ic_cells_to_space(
+    const struct partition *initial_partition, struct space *s) {
+
+  const int *ic_cdim = initial_partition->ic_cdim;
+  const double *ic_width = initial_partition->ic_width;
+  int ind[3];
+  for (int i = 0; i < s->cdim[0]; i++) {
+    for (int j = 0; j < s->cdim[1]; j++) {
+      for (int k = 0; k < s->cdim[2]; k++) {
+        const int loc[3] = {i, j, k};
+        for (int d = 0; d < 3; d++) {
+          ind[d] = (loc[d] + 0.5) * s->width[d] / ic_width[d];
+          if (ind[d] < 0) ind[d] = 0;
+          if (ind[d] > ic_cdim[d] - 1) ind[d] = ic_cdim[d] - 1;
+        }
+        const int cid = cell_getid(s->cdim, i, j, k);
+        const int ic_cid = cell_getid(ic_cdim, ind[0], ind[1], ind[2]);
+        s->cells_top[cid].nodeID = initial_partition->ic_celllist[ic_cid];
+      }
+    }
+  }
+}
+
 /**
  * @brief Initial partition of space cells.
  *
@@ -1809,6 +2331,25 @@ void partition_initial_partition(struct partition *initial_partition,
                                  int nodeID, int nr_nodes, struct space *s) {
   ticks tic = getticks();
 
+  /* Partition decided when reading the ICs cell by cell. Resample it onto
+   * our cells, the particles are then already on their nodes. */
+  if (initial_partition->ic_celllist != NULL) {
+    partition_ic_cells_to_space(initial_partition, s);
+    if (check_complete(s, (nodeID == 0), nr_nodes)) {
+      if (s->e->verbose)
+        message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+                clocks_getunit());
+      return;
+    }
+
+    /* Should not happen unless the cells are much larger than in the ICs. */
+    if (nodeID == 0)
+      message("Partition of the ICs cells failed, using a %s partition",
+              initial_partition_name[initial_partition->type]);
+    free(initial_partition->ic_celllist);
+    initial_partition->ic_celllist = NULL;
+  }
+
   /* Geometric grid partitioning. */
   if (initial_partition->type == INITPART_GRID) {
     int j, k;
@@ -1894,6 +2435,47 @@ void partition_initial_partition(struct partition *initial_partition,
     error("SWIFT was not compiled with METIS or ParMETIS support");
 #endif
 
+  } else if (initial_partition->type == INITPART_HILBERT) {
+#if defined(WITH_MPI)
+    /* Equal memory segments along a Peano-Hilbert curve. */
+    double *weights = NULL;
+    if ((weights = (double *)malloc(sizeof(double) * s->nr_cells)) == NULL)
+      error("Failed to allocate weights buffer.");
+
+    /* Check each particle and accumulate the sizes per cell. */
+    accumulate_sizes(s, weights);
+
+    /* Get all the counts from all the nodes. */
+    if (MPI_Allreduce(MPI_IN_PLACE, weights, s->nr_cells, MPI_DOUBLE, MPI_SUM,
+                      MPI_COMM_WORLD) != MPI_SUCCESS)
+      error("Failed to allreduce particle cell weights.");
+
+    /* Do the calculation, every node gets the same answer. */
+    int *celllist = NULL;
+    if ((celllist = (int *)malloc(sizeof(int) * s->nr_cells)) == NULL)
+      error("Failed to allocate celllist");
+    pick_hilbert(s->cdim, nr_nodes, weights, celllist);
+
+    /* And apply to our cells */
+    for (int k = 0; k < s->nr_cells; k++)
+      s->cells_top[k].nodeID = celllist[k];
+    free(celllist);
+    free(weights);
+
+    /* Regions can be empty with very clustered weights, so check. */
+    if (!check_complete(s, (nodeID == 0), nr_nodes)) {
+      if (nodeID == 0)
+        message(
+            "Peano-Hilbert initial partition failed, using a vectorised "
+            "partition");
+      initial_partition->type = INITPART_VECTORIZE;
+      partition_initial_partition(initial_partition, nodeID, nr_nodes, s);
+      return;
+    }
+#else
+    error("SWIFT was not compiled with MPI support");
+#endif
+
   } else if (initial_partition->type == INITPART_VECTORIZE) {
 
 #if defined(WITH_MPI)
@@ -1967,6 +2549,9 @@ void partition_init(struct partition *partition,
     case 'v':
       partition->type = INITPART_VECTORIZE;
       break;
+    case 'h':
+      partition->type = INITPART_HILBERT;
+      break;
 #if defined(HAVE_METIS) || defined(HAVE_PARMETIS)
     case 'r':
       partition->type = INITPART_METIS_NOWEIGHT;
@@ -1977,14 +2562,14 @@ void partition_init(struct partition *partition,
     default:
       message("Invalid choice of initial partition type '%s'.", part_type);
       error(
-          "Permitted values are: 'grid', 'region', 'memory' or "
+          "Permitted values are: 'grid', 'region', 'memory', 'hilbert' or "
           "'vectorized'");
 #else
     default:
       message("Invalid choice of initial partition type '%s'.", part_type);
       error(
-          "Permitted values are: 'grid' or 'vectorized' when compiled "
-          "without METIS or ParMETIS.");
+          "Permitted values are: 'grid', 'hilbert' or 'vectorized' when "
+          "compiled without METIS or ParMETIS.");
 #endif
   }
 
@@ -2001,6 +2586,9 @@ void partition_init(struct partition *partition,
   if (strcmp("none", part_type) == 0) {
     repartition->type = REPART_NONE;
 
+  } else if (strcmp("hilbert", part_type) == 0) {
+    repartition->type = REPART_HILBERT_COUNTS;
+
 #if defined(HAVE_METIS) || defined(HAVE_PARMETIS)
   } else if (strcmp("fullcosts", part_type) == 0) {
     repartition->type = REPART_METIS_VERTEX_EDGE_COSTS;
@@ -2018,12 +2606,12 @@ void partition_init(struct partition *partition,
     message("Invalid choice of re-partition type '%s'.", part_type);
     error(
         "Permitted values are: 'none', 'fullcosts', 'edgecosts' "
-        "'memory' or 'timecosts'");
+        "'memory', 'timecosts' or 'hilbert'");
 #else
   } else {
     message("Invalid choice of re-partition type '%s'.", part_type);
     error(
-        "Permitted values are: 'none' when compiled without "
+        "Permitted values are: 'none' or 'hilbert' when compiled without "
         "METIS or ParMETIS.");
 #endif
   }
@@ -2048,6 +2636,11 @@ void partition_init(struct partition *partition,
         "Invalid DomainDecomposition:minfrac, must be greater than 0.5 "
         "and less than equal to 1");
 
+  /* Partition along the cell meta-data of the ICs, when they have some? */
+  partition->use_ic_cells = parser_get_opt_param_int(
+      params, "DomainDecomposition:initial_ic_cells", 1);
+  partition->ic_celllist = NULL;
+
   /* Use METIS or ParMETIS when ParMETIS is also available. */
   repartition->usemetis =
       parser_get_opt_param_int(params, "DomainDecomposition:usemetis", 0);
@@ -2061,6 +2654,28 @@ void partition_init(struct partition *partition,
   repartition->itr =
       parser_get_opt_param_float(params, "DomainDecomposition:itr", 100.0f);
 
+  /* Cost per byte sent over MPI added to the edge weights. */
+  repartition->comm_edge_cost = parser_get_opt_param_double(
+      params, "DomainDecomposition:comm_edge_cost", 0.);
+  if (repartition->comm_edge_cost < 0.)
+    error("Invalid DomainDecomposition:comm_edge_cost, cannot be negative");
+
+  /* Maximal fraction of the cells moved by an incremental repartition, 0 for
+   * a full one. */
+  repartition->diffusion_budget = parser_get_opt_param_float(
+      params, "DomainDecomposition:diffusion_budget", 0.f);
+  if (repartition->diffusion_budget < 0.f ||
+      repartition->diffusion_budget > 1.f)
+    error("Invalid DomainDecomposition:diffusion_budget, must be in [0, 1]");
+
+  /* Exchange all the particle types at once when redistributing? */
+  repartition->concurrent_redistribute = parser_get_opt_param_int(
+      params, "DomainDecomposition:concurrent_redistribute", 0);
+
+  /* Compress the cell trees exchanged with the proxies? */
+  repartition->compress_cells = parser_get_opt_param_int(
+      params, "DomainDecomposition:compress_cells", 0);
+
   /* Clear the celllist for use. */
   repartition->ncelllist = 0;
   repartition->celllist = NULL;
@@ -2069,10 +2684,14 @@ void partition_init(struct partition *partition,
    * repartitioning at any time. Not required if not repartitioning.*/
   repartition->use_fixed_costs = parser_get_opt_param_int(
       params, "DomainDecomposition:use_fixed_costs", 0);
-  if (repartition->type == REPART_NONE) repartition->use_fixed_costs = 0;
+  if (repartition->type == REPART_NONE ||
+      repartition->type == REPART_HILBERT_COUNTS)
+    repartition->use_fixed_costs = 0;
 
   /* Check if this is true or required and initialise them. */
-  if (repartition->use_fixed_costs || repartition->trigger > 1) {
+  if (repartition->use_fixed_costs ||
+      (repartition->trigger > 1 &&
+       repartition->type != REPART_HILBERT_COUNTS)) {
     if (!repart_init_fixed_costs()) {
       if (repartition->trigger <= 1) {
         if (engine_rank == 0)
@@ -2181,6 +2800,8 @@ static void check_weights(struct task *tasks, int nr_tasks,
   int timebins = mydata->timebins;
   int vweights = mydata->vweights;
   int use_ticks = mydata->use_ticks;
+  int compact_hydro = mydata->compact_hydro;
+  double comm_edge_cost = mydata->comm_edge_cost;
 
   struct cell *cells = mydata->cells;
 
@@ -2204,6 +2825,25 @@ static void check_weights(struct task *tasks, int nr_tasks,
     /* Get a pointer to the kth task. */
     struct task *t = &tasks[j];
 
+    /* Send tasks that ran add the volume of data they sent to the edge
+     * between the two top-level cells, if requested. */
+    if (t->type == task_type_send && eweights && !timebins &&
+        comm_edge_cost > 0. && t->toc > 0) {
+      struct cell *ci, *cj;
+      for (ci = t->ci; ci->parent != NULL; ci = ci->parent)
+        ;
+      for (cj = t->cj; cj->parent != NULL; cj = cj->parent)
+        ;
+      int ik, jk;
+      partition_find_edges(inds, nr_cells, ci - cells, cj - cells, &ik, &jk);
+      if (ik != -1 && jk != -1) {
+        const double w =
+            comm_edge_cost * partition_send_bytes(t, compact_hydro);
+        weights_e[ik] += w;
+        weights_e[jk] += w;
+      }
+    }
+
     /* Skip un-interesting tasks. */
     if (t->type == task_type_send || t->type == task_type_recv ||
         t->type == task_type_logger || t->implicit || t->ci == NULL)
@@ -2347,6 +2987,59 @@ static void check_weights(struct task *tasks, int nr_tasks,
 #endif
 #endif
 
+/* Data needed by partition_space_to_space_mapper(). */
+struct space_to_space_data {
+  struct space *s;
+  const double *oldh;
+  const double *oldcdim;
+  const int *oldnodeIDs;
+  int nr_nodes;
+};
+
+/**
+ * @brief #threadpool mapper function assigning some new top-level cells to
+ * the node of the closest old cell.
+ *
+ * @param map_data Pointer towards the new top-level cells.
+ * @param num_cells The number of cells to treat.
+ * @param extra_data Pointer to the #space_to_space_data.
+ */
+static void partition_space_to_space_mapper(void *map_data, int num_cells,
+                                            void *extra_data) {
+
+  struct space_to_space_data *data = (struct space_to_space_data *)extra_data;
+  struct space *s = data->s;
+  struct cell *cells = (struct cell *)map_data;
+  const int first = cells - s->cells_top;
+  int nr_nodes = 0;
+
+  for (int ind = 0; ind < num_cells; ind++) {
+    const int cid = first + ind;
+    const int i = cid / (s->cdim[1] * s->cdim[2]);
+    const int j = (cid / s->cdim[2]) % s->cdim[1];
+    const int k = cid % s->cdim[2];
+
+    /* Scale indices to old cell space. */
+    const int ii = rint(i * s->iwidth[0] * data->oldh[0]);
+    const int jj = rint(j * s->iwidth[1] * data->oldh[1]);
+    const int kk = rint(k * s->iwidth[2] * data->oldh[2]);
+
+    const int oldcid = cell_getid(data->oldcdim, ii, jj, kk);
+    cells[ind].nodeID = data->oldnodeIDs[oldcid];
+
+    if (data->oldnodeIDs[oldcid] > nr_nodes)
+      nr_nodes = data->oldnodeIDs[oldcid];
+  }
+
+  /* Raise the largest node ID seen so far. */
+  int old = data->nr_nodes;
+  while (nr_nodes > old) {
+    const int prev = atomic_cas(&data->nr_nodes, old, nr_nodes);
+    if (prev == old) break;
+    old = prev;
+  }
+}
+
 /**
  * @brief Partition a space of cells based on another space of cells.
  *
@@ -2374,27 +3067,12 @@ int partition_space_to_space(double *oldh, double *oldcdim, int *oldnodeIDs,
                              struct space *s) {
 
   /* Loop over all the new cells. */
-  int nr_nodes = 0;
-  for (int i = 0; i < s->cdim[0]; i++) {
-    for (int j = 0; j < s->cdim[1]; j++) {
-      for (int k = 0; k < s->cdim[2]; k++) {
-
-        /* Scale indices to old cell space. */
-        const int ii = rint(i * s->iwidth[0] * oldh[0]);
-        const int jj = rint(j * s->iwidth[1] * oldh[1]);
-        const int kk = rint(k * s->iwidth[2] * oldh[2]);
-
-        const int cid = cell_getid(s->cdim, i, j, k);
-        const int oldcid = cell_getid(oldcdim, ii, jj, kk);
-        s->cells_top[cid].nodeID = oldnodeIDs[oldcid];
-
-        if (oldnodeIDs[oldcid] > nr_nodes) nr_nodes = oldnodeIDs[oldcid];
-      }
-    }
-  }
+  struct space_to_space_data data = {s, oldh, oldcdim, oldnodeIDs, 0};
+  threadpool_map(&s->e->threadpool, partition_space_to_space_mapper,
+                 s->cells_top, s->nr_cells, sizeof(struct cell), 0, &data);
 
   /* Check we have all nodeIDs present in the resample. */
-  return check_complete(s, 1, nr_nodes + 1);
+  return check_complete(s, 1, data.nr_nodes + 1);
 }
 
 /**
@@ -28,7 +28,8 @@ enum partition_type {
   INITPART_GRID = 0,
   INITPART_VECTORIZE,
   INITPART_METIS_WEIGHT,
-  INITPART_METIS_NOWEIGHT
+  INITPART_METIS_NOWEIGHT,
+  INITPART_HILBERT
 };
 
 /* Simple descriptions of types for reports. */
@@ -39,6 +40,12 @@ struct partition {
   enum partition_type type;
   int grid[3];
   int usemetis;
+
+  /* Partition of the cells of the ICs, when they carry cell meta-data. */
+  int use_ic_cells;
+  int ic_cdim[3];
+  double ic_width[3];
+  int *ic_celllist;
 };
 
 /* Repartition type to use. */
@@ -47,7 +54,8 @@ enum repartition_type {
   REPART_METIS_VERTEX_EDGE_COSTS,
   REPART_METIS_EDGE_COSTS,
   REPART_METIS_VERTEX_COUNTS,
-  REPART_METIS_VERTEX_COSTS_TIMEBINS
+  REPART_METIS_VERTEX_COSTS_TIMEBINS,
+  REPART_HILBERT_COUNTS
 };
 
 /* Repartition preferences. */
@@ -61,6 +69,10 @@ struct repartition {
 
   int use_fixed_costs;
   int use_ticks;
+  double comm_edge_cost;
+  float diffusion_budget;
+  int concurrent_redistribute;
+  int compress_cells;
 
   /* The partition as a cell-list. */
   int ncelllist;
@@ -76,6 +88,10 @@ void partition_repartition(struct repartition *reparttype, int nodeID,
 void partition_initial_partition(struct partition *initial_partition,
                                  int nodeID, int nr_nodes, struct space *s);
 
+const int *partition_ic_cells(struct partition *initial_partition,
+                              int nr_nodes, const int cdim[3],
+                              const double width[3], const double *weights);
+
 int partition_space_to_space(double *oldh, double *oldcdim, int *oldnodeID,
                              struct space *s);
 void partition_init(struct partition *partition,
@@ -24,6 +24,7 @@
 
 /* Includes. */
 #include "inline.h"
+#include "vector.h"
 
 /**
  * @brief Limits the value of x to be between a and b
@@ -75,4 +76,33 @@ __attribute__((always_inline, const)) INLINE static float nearestf(
               : ((dx < -0.5f * box_size) ? (dx + box_size) : dx));
 }
 
+#ifdef WITH_VECTORIZATION
+
+/**
+ * @brief Find the smallest distance dx along one axis within a box of size
+ * box_size (vector version of nearestf()).
+ *
+ * Only wraps once. If dx > 2b, the returned value will be larger than b.
+ * Similarly for dx < -b.
+ *
+ * @param dx The distances along the axis.
+ * @param box_size The size of the box along the axis.
+ */
+__attribute__((always_inline)) INLINE static vector nearestf_vec(
+    const vector dx, const float box_size) {
+
+  vector dx_wrapped;
+  mask_t mask_high, mask_low;
+
+  vec_create_mask(mask_high, vec_cmp_gt(dx.v, vec_set1(0.5f * box_size)));
+  vec_create_mask(mask_low, vec_cmp_lt(dx.v, vec_set1(-0.5f * box_size)));
+
+  dx_wrapped.v = vec_blend(mask_high, dx.v, vec_sub(dx.v, vec_set1(box_size)));
+  dx_wrapped.v = vec_blend(mask_low, dx_wrapped.v,
+                           vec_add(dx.v, vec_set1(box_size)));
+  return dx_wrapped;
+}
+
+#endif /* WITH_VECTORIZATION */
+
 #endif /* SWIFT_PERIODIC_H */
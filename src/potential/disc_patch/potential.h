@@ -37,6 +37,9 @@
 #include "space.h"
 #include "units.h"
 
+/*! Maximal number of intervals of the acceleration table */
+#define disc_patch_potential_table_max_size 8192
+
 /**
  * @brief External Potential Properties - Disc patch case
  *
@@ -88,6 +91,19 @@ struct external_potential {
 
   /*! Constant pre-factor (2 pi sigma)*/
   float norm_over_G;
+
+  /*! Number of intervals of the acceleration table (0 for no table) */
+  int table_size;
+
+  /*! Distance from the disc up to which the acceleration is tabulated */
+  float table_x_max;
+
+  /*! Inverse of the spacing of the table */
+  float table_dx_inv;
+
+  /*! Acceleration (over G) of the fully grown disc tabulated linearly in
+   * distance from the disc from 0 to table_x_max */
+  float accel_table[disc_patch_potential_table_max_size + 1];
 };
 
 /**
@@ -184,7 +200,16 @@ __attribute__((always_inline)) INLINE static void external_gravity_acceleration(
 
   /* Truncated or not ? */
   float a_x;
-  if (abs_dx < x_trunc) {
+  if (abs_dx < potential->table_x_max) {
+
+    /* Interpolate the tabulated acceleration */
+    const float x = abs_dx * potential->table_dx_inv;
+    const int i = (int)x;
+    const float w = x - i;
+    a_x = reduction_factor *
+          (potential->accel_table[i] +
+           w * (potential->accel_table[i + 1] - potential->accel_table[i]));
+  } else if (abs_dx < x_trunc) {
 
     /* Acc. 2 pi sigma tanh(x/b) */
     a_x = reduction_factor * norm_over_G * tanhf(abs_dx * b_inv);
@@ -320,6 +345,39 @@ static INLINE void potential_init_backend(
     potential->growth_time_inv = 1. / potential->growth_time;
   else
     potential->growth_time_inv = FLT_MAX;
+
+  /* Tabulate the acceleration to avoid the transcendental functions? */
+  potential->table_size = parser_get_opt_param_int(
+      parameter_file, "DiscPatchPotential:table_size", 0);
+  if (potential->table_size < 0 ||
+      potential->table_size > disc_patch_potential_table_max_size)
+    error("DiscPatchPotential:table_size must be between 0 and %d",
+          disc_patch_potential_table_max_size);
+
+  if (potential->table_size > 0) {
+
+    potential->table_x_max = parser_get_opt_param_float(
+        parameter_file, "DiscPatchPotential:table_max_distance",
+        min(potential->x_max, 20.f * potential->scale_height));
+    potential->table_dx_inv = potential->table_size / potential->table_x_max;
+
+    for (int i = 0; i <= potential->table_size; ++i) {
+      const double x =
+          i * (double)potential->table_x_max / potential->table_size;
+      double a_x = potential->norm_over_G * tanh(x / potential->scale_height);
+      if (x >= potential->x_max)
+        a_x = 0.;
+      else if (x >= potential->x_trunc)
+        a_x *= 0.5 + 0.5 * cos(M_PI * (x - potential->x_trunc) *
+                               potential->x_trans_inv);
+      potential->accel_table[i] = a_x;
+    }
+  } else {
+
+    /* Always evaluate the exact expressions */
+    potential->table_x_max = 0.f;
+    potential->table_dx_inv = 0.f;
+  }
 }
 
 /**
@@ -344,6 +402,10 @@ static INLINE void potential_print_backend(
     message("Disc will grow for %f [time_units]. (%f dynamical time)",
             potential->growth_time,
             potential->growth_time / potential->dynamical_time);
+
+  if (potential->table_size > 0)
+    message("Acceleration tabulated with %d intervals up to x=%f",
+            potential->table_size, potential->table_x_max);
 }
 
 #endif /* SWIFT_DISC_PATCH_H */
@@ -35,6 +35,9 @@
 #include "space.h"
 #include "units.h"
 
+/*! Maximal number of intervals of the acceleration table */
+#define nfw_potential_table_max_size 8192
+
 /**
  * @brief External Potential Properties - NFW Potential
                 rho(r) = rho_0 / ( (r/R_s)*(1+r/R_s)^2 )
@@ -75,8 +78,45 @@ struct external_potential {
 
   /*! Softening length */
   double eps;
+
+  /*! Number of intervals of the acceleration table (0 for no table) */
+  int table_size;
+
+  /*! Radius up to which the acceleration is tabulated */
+  float table_r_max;
+
+  /*! Inverse of the radial spacing of the table */
+  float table_dr_inv;
+
+  /*! Magnitude of the radial acceleration (over G), M(<r) / r^2, tabulated
+   * linearly in radius from 0 to table_r_max */
+  float accel_table[nfw_potential_table_max_size + 1];
 };
 
+/**
+ * @brief Returns the tabulated magnitude of the radial acceleration (over G)
+ * at a given radius.
+ *
+ * M(<r) / r^2 is smooth down to r = 0, unlike M(<r) / r^3, so it
+ * interpolates accurately at all radii.
+ *
+ * Only valid for 0 <= r < potential->table_r_max with a table in use.
+ *
+ * @param potential The #external_potential used in the run.
+ * @param r The radius.
+ */
+__attribute__((always_inline)) INLINE static float
+potential_nfw_tabulated_accel(
+    const struct external_potential* restrict potential, const float r) {
+
+  const float x = r * potential->table_dr_inv;
+  const int i = (int)x;
+  const float w = x - i;
+
+  return potential->accel_table[i] +
+         w * (potential->accel_table[i + 1] - potential->accel_table[i]);
+}
+
 /**
  * @brief Computes the time-step due to the acceleration from the NFW potential
  *        as a fraction (timestep_mult) of the circular orbital time of that
@@ -99,9 +139,12 @@ __attribute__((always_inline)) INLINE static float external_gravity_timestep(
   const float r =
       sqrtf(dx * dx + dy * dy + dz * dz + potential->eps * potential->eps);
 
-  const float mr = potential->M_200 *
-                   (logf(1.f + r / potential->r_s) - r / (r + potential->r_s)) /
-                   potential->log_c200_term;
+  const float mr =
+      (r < potential->table_r_max)
+          ? potential_nfw_tabulated_accel(potential, r) * r * r
+          : potential->M_200 *
+                (logf(1.f + r / potential->r_s) - r / (r + potential->r_s)) /
+                potential->log_c200_term;
 
   const float period =
       2 * M_PI * r * sqrtf(r / (phys_const->const_newton_G * mr));
@@ -137,6 +180,17 @@ __attribute__((always_inline)) INLINE static void external_gravity_acceleration(
 
   const float r =
       sqrtf(dx * dx + dy * dy + dz * dz + potential->eps * potential->eps);
+
+  /* Within the table, the acceleration is -M(<r) / r^3 * dx */
+  if (r < potential->table_r_max) {
+    const float term = -potential_nfw_tabulated_accel(potential, r) / r;
+
+    g->a_grav[0] += term * dx;
+    g->a_grav[1] += term * dy;
+    g->a_grav[2] += term * dz;
+    return;
+  }
+
   const float term1 = potential->pre_factor;
   const float term2 = (1.0f / ((r + potential->r_s) * r * r) -
                        logf(1.0f + r / potential->r_s) / (r * r * r));
@@ -239,6 +293,38 @@ static INLINE void potential_init_backend(
   potential->mintime = 2. * M_PI * potential->eps * sqrtf(potential->eps) *
                        sqrtf(potential->log_c200_term / epslnthing) / sqrtgm *
                        potential->timestep_mult;
+
+  /* Tabulate the acceleration to avoid the logarithms in the accelerations
+   * and time-steps? */
+  potential->table_size =
+      parser_get_opt_param_int(parameter_file, "NFWPotential:table_size", 0);
+  if (potential->table_size < 0 ||
+      potential->table_size > nfw_potential_table_max_size)
+    error("NFWPotential:table_size must be between 0 and %d",
+          nfw_potential_table_max_size);
+
+  if (potential->table_size > 0) {
+
+    potential->table_r_max = parser_get_opt_param_double(
+        parameter_file, "NFWPotential:table_max_radius", 10. * R_200);
+    potential->table_dr_inv = potential->table_size / potential->table_r_max;
+
+    /* M(<r) / r^2 tends to pre_factor / (2 r_s^2) at the centre */
+    potential->accel_table[0] =
+        0.5 * potential->pre_factor / (potential->r_s * potential->r_s);
+
+    for (int i = 1; i <= potential->table_size; ++i) {
+      const double r = i * potential->table_r_max / potential->table_size;
+      potential->accel_table[i] =
+          potential->pre_factor *
+          (log(1. + r / potential->r_s) - r / (r + potential->r_s)) / (r * r);
+    }
+  } else {
+
+    /* Always evaluate the exact expressions */
+    potential->table_r_max = 0.f;
+    potential->table_dr_inv = 0.f;
+  }
 }
 
 /**
@@ -255,6 +341,10 @@ static INLINE void potential_print_backend(
       "timestep multiplier = %e, mintime = %e",
       potential->x[0], potential->x[1], potential->x[2], potential->r_s,
       potential->timestep_mult, potential->mintime);
+
+  if (potential->table_size > 0)
+    message("Acceleration tabulated with %d intervals up to r = %e",
+            potential->table_size, potential->table_r_max);
 }
 
 #endif /* SWIFT_POTENTIAL_NFW_H */
@@ -184,3 +184,36 @@ void profiler_close_files(struct profiler *profiler) {
   /* Iterate over files array and close files. */
   for (int i = 0; i < profiler_length; i++) fclose(profiler->files[i]);
 }
+
+/**
+ * @brief Writes the names of the columns of a #task_step_analysis, to be
+ * appended to the header of a per-step output file.
+ *
+ * @param file pointer used to open output file.
+ */
+void profiler_write_step_analysis_header(FILE *file) {
+
+  fprintf(file, " %16s [%s] %16s [%s] %16s [%s]", "Critical path",
+          clocks_getunit(), "Idle time", clocks_getunit(), "Mean recv wait",
+          clocks_getunit());
+}
+
+/**
+ * @brief Writes a #task_step_analysis at the end of a per-step output line,
+ * followed by its slowest tasks on a comment line.
+ *
+ * @param a The #task_step_analysis of the step.
+ * @param file pointer used to open output file.
+ */
+void profiler_write_step_analysis(const struct task_step_analysis *a,
+                                  FILE *file) {
+
+  fprintf(file, " %21.3f %21.3f %21.3f\n#   Slowest:",
+          clocks_from_ticks(a->critical_path), clocks_from_ticks(a->idle),
+          clocks_from_ticks(a->recv_wait));
+  for (int k = 0; k < a->nr_slowest; k++)
+    fprintf(file, "%s %s/%s (depth %d, rank %d) %.3f", (k > 0) ? "," : "",
+            taskID_names[a->slowest[k].type],
+            subtaskID_names[a->slowest[k].subtype], a->slowest[k].depth,
+            a->slowest[k].nodeID, clocks_from_ticks(a->slowest[k].ticks));
+}
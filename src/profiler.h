@@ -61,5 +61,8 @@ void profiler_write_all_timing_info_headers(const struct engine *e,
 void profiler_write_all_timing_info(const struct engine *e,
                                     struct profiler *profiler);
 void profiler_close_files(struct profiler *profiler);
+void profiler_write_step_analysis_header(FILE *file);
+void profiler_write_step_analysis(const struct task_step_analysis *a,
+                                  FILE *file);
 
 #endif /* SWIFT_PROFILER_H */
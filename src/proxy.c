@@ -178,16 +178,295 @@ void proxy_tags_exchange(struct proxy *proxies, int num_proxies,
 #endif
 }
 
+#ifdef WITH_MPI
+
+/*! Number of times in a compressed #pcell */
+#define proxy_pcell_nr_times 13
+
+/*! Upper limit on the size of a compressed #pcell, in bytes */
+#define proxy_pcell_comp_max                                          \
+  (1 + 10 * proxy_pcell_nr_times + 5 * 6 + 3 * sizeof(double) +      \
+   sizeof(struct multipole) + 8 * sizeof(double))
+
+/**
+ * @brief Write an unsigned integer using as many bytes as it needs, seven
+ * bits at a time.
+ *
+ * @param buff The buffer to write to.
+ * @param v The value.
+ *
+ * @return The buffer after the value.
+ */
+static char *proxy_write_varint(char *buff, unsigned long long v) {
+  while (v >= 0x80) {
+    *buff++ = (char)(v | 0x80);
+    v >>= 7;
+  }
+  *buff++ = (char)v;
+  return buff;
+}
+
+/**
+ * @brief Read an unsigned integer written by #proxy_write_varint.
+ *
+ * @param buff The buffer to read from.
+ * @param v (output) The value.
+ *
+ * @return The buffer after the value.
+ */
+static const char *proxy_read_varint(const char *buff, unsigned long long *v) {
+  unsigned long long res = 0;
+  int shift = 0;
+  unsigned char b;
+  do {
+    b = (unsigned char)*buff++;
+    res |= (unsigned long long)(b & 0x7f) << shift;
+    shift += 7;
+  } while (b & 0x80);
+  *v = res;
+  return buff;
+}
+
+/**
+ * @brief Collect the times read from a #pcell when unpacking it.
+ *
+ * @param pc The #pcell.
+ * @param ti (output) The times.
+ */
+static void proxy_pcell_get_times(const struct pcell *pc,
+                                  integertime_t ti[proxy_pcell_nr_times]) {
+  ti[0] = pc->hydro.ti_end_min;
+  ti[1] = pc->hydro.ti_end_max;
+  ti[2] = pc->hydro.ti_old_part;
+  ti[3] = pc->grav.ti_end_min;
+  ti[4] = pc->grav.ti_end_max;
+  ti[5] = pc->grav.ti_old_part;
+  ti[6] = pc->grav.ti_old_multipole;
+  ti[7] = pc->stars.ti_end_min;
+  ti[8] = pc->stars.ti_end_max;
+  ti[9] = pc->stars.ti_old_part;
+  ti[10] = pc->black_holes.ti_end_min;
+  ti[11] = pc->black_holes.ti_end_max;
+  ti[12] = pc->black_holes.ti_old_part;
+}
+
+/**
+ * @brief Set the times collected by #proxy_pcell_get_times in a #pcell.
+ *
+ * @param pc The #pcell.
+ * @param ti The times.
+ */
+static void proxy_pcell_set_times(
+    struct pcell *pc, const integertime_t ti[proxy_pcell_nr_times]) {
+  pc->hydro.ti_end_min = ti[0];
+  pc->hydro.ti_end_max = ti[1];
+  pc->hydro.ti_old_part = ti[2];
+  pc->grav.ti_end_min = ti[3];
+  pc->grav.ti_end_max = ti[4];
+  pc->grav.ti_old_part = ti[5];
+  pc->grav.ti_old_multipole = ti[6];
+  pc->stars.ti_end_min = ti[7];
+  pc->stars.ti_end_max = ti[8];
+  pc->stars.ti_old_part = ti[9];
+  pc->black_holes.ti_end_min = ti[10];
+  pc->black_holes.ti_end_max = ti[11];
+  pc->black_holes.ti_old_part = ti[12];
+}
+
+/**
+ * @brief Compress a tree of #pcell, depth-first.
+ *
+ * The progeny are stored as a bit mask, as their indices follow from the
+ * order of the tree, the counts as variable-length integers and the times as
+ * variable-length differences to the times of the parent, which they mostly
+ * match. Only the fields read by #cell_unpack are kept.
+ *
+ * @param pc The #pcell at the root of the tree.
+ * @param ti_parent The times of the parent, zero for the root.
+ * @param buff The buffer to write to.
+ * @param with_gravity Are we running with gravity and hence need
+ *      to exchange multipoles?
+ *
+ * @return The buffer after the tree.
+ */
+static char *proxy_pcell_compress(const struct pcell *pc,
+                                  const integertime_t *ti_parent, char *buff,
+                                  const int with_gravity) {
+
+  /* Which progeny are there? */
+  unsigned char mask = 0;
+  for (int k = 0; k < 8; k++)
+    if (pc->progeny[k] >= 0) mask |= (1 << k);
+  *buff++ = (char)mask;
+
+  /* The times, as zig-zag encoded differences to the parent's. */
+  integertime_t ti[proxy_pcell_nr_times];
+  proxy_pcell_get_times(pc, ti);
+  for (int k = 0; k < proxy_pcell_nr_times; k++) {
+    const long long d = (long long)((unsigned long long)ti[k] -
+                                    (unsigned long long)ti_parent[k]);
+    buff = proxy_write_varint(
+        buff, ((unsigned long long)d << 1) ^ (unsigned long long)(d >> 63));
+  }
+
+  /* The counts. */
+  buff = proxy_write_varint(buff, (unsigned int)pc->hydro.count);
+  buff = proxy_write_varint(buff, (unsigned int)pc->grav.count);
+  buff = proxy_write_varint(buff, (unsigned int)pc->stars.count);
+  buff = proxy_write_varint(buff, (unsigned int)pc->black_holes.count);
+  buff = proxy_write_varint(buff, (unsigned int)pc->maxdepth);
+#ifdef SWIFT_DEBUG_CHECKS
+  buff = proxy_write_varint(buff, (unsigned int)pc->cellID);
+#endif
+
+  /* The smoothing lengths and multipoles, as they are. */
+  memcpy(buff, &pc->hydro.h_max, sizeof(double));
+  memcpy(buff + sizeof(double), &pc->stars.h_max, sizeof(double));
+  memcpy(buff + 2 * sizeof(double), &pc->black_holes.h_max, sizeof(double));
+  buff += 3 * sizeof(double);
+  if (with_gravity) {
+    memcpy(buff, &pc->grav.m_pole, sizeof(struct multipole));
+    buff += sizeof(struct multipole);
+    memcpy(buff, pc->grav.CoM, 3 * sizeof(double));
+    memcpy(buff + 3 * sizeof(double), pc->grav.CoM_rebuild,
+           3 * sizeof(double));
+    memcpy(buff + 6 * sizeof(double), &pc->grav.r_max, sizeof(double));
+    memcpy(buff + 7 * sizeof(double), &pc->grav.r_max_rebuild,
+           sizeof(double));
+    buff += 8 * sizeof(double);
+  }
+
+  /* Recurse. */
+  for (int k = 0; k < 8; k++)
+    if (mask & (1 << k))
+      buff = proxy_pcell_compress(&pc[pc->progeny[k]], ti, buff, with_gravity);
+
+  return buff;
+}
+
+/**
+ * @brief Uncompress a tree of #pcell written by #proxy_pcell_compress.
+ *
+ * @param buff The buffer to read from.
+ * @param pc (output) The #pcell at the root of the tree.
+ * @param ti_parent The times of the parent, zero for the root.
+ * @param with_gravity Are we running with gravity and hence need
+ *      to exchange multipoles?
+ * @param count (output) The number of #pcell in the tree.
+ *
+ * @return The buffer after the tree.
+ */
+static const char *proxy_pcell_uncompress(const char *buff, struct pcell *pc,
+                                          const integertime_t *ti_parent,
+                                          const int with_gravity, int *count) {
+
+  const unsigned char mask = (unsigned char)*buff++;
+  unsigned long long v;
+
+  integertime_t ti[proxy_pcell_nr_times];
+  for (int k = 0; k < proxy_pcell_nr_times; k++) {
+    buff = proxy_read_varint(buff, &v);
+    const unsigned long long d = (v >> 1) ^ (~(v & 1) + 1);
+    ti[k] = (integertime_t)((unsigned long long)ti_parent[k] + d);
+  }
+  proxy_pcell_set_times(pc, ti);
+
+  buff = proxy_read_varint(buff, &v);
+  pc->hydro.count = (int)v;
+  buff = proxy_read_varint(buff, &v);
+  pc->grav.count = (int)v;
+  buff = proxy_read_varint(buff, &v);
+  pc->stars.count = (int)v;
+  buff = proxy_read_varint(buff, &v);
+  pc->black_holes.count = (int)v;
+  buff = proxy_read_varint(buff, &v);
+  pc->maxdepth = (int)v;
+#ifdef SWIFT_DEBUG_CHECKS
+  buff = proxy_read_varint(buff, &v);
+  pc->cellID = (int)v;
+#endif
+
+  memcpy(&pc->hydro.h_max, buff, sizeof(double));
+  memcpy(&pc->stars.h_max, buff + sizeof(double), sizeof(double));
+  memcpy(&pc->black_holes.h_max, buff + 2 * sizeof(double), sizeof(double));
+  buff += 3 * sizeof(double);
+  if (with_gravity) {
+    memcpy(&pc->grav.m_pole, buff, sizeof(struct multipole));
+    buff += sizeof(struct multipole);
+    memcpy(pc->grav.CoM, buff, 3 * sizeof(double));
+    memcpy(pc->grav.CoM_rebuild, buff + 3 * sizeof(double),
+           3 * sizeof(double));
+    memcpy(&pc->grav.r_max, buff + 6 * sizeof(double), sizeof(double));
+    memcpy(&pc->grav.r_max_rebuild, buff + 7 * sizeof(double),
+           sizeof(double));
+    buff += 8 * sizeof(double);
+  }
+
+  /* The progeny follow, depth-first. */
+  int total = 1;
+  for (int k = 0; k < 8; k++)
+    if (mask & (1 << k)) {
+      int sub = 0;
+      pc->progeny[k] = total;
+      buff = proxy_pcell_uncompress(buff, &pc[total], ti, with_gravity, &sub);
+      total += sub;
+    } else {
+      pc->progeny[k] = -1;
+    }
+
+  *count = total;
+  return buff;
+}
+
+/**
+ * @brief Uncompress the #pcell received from a proxy.
+ *
+ * @param p The #proxy.
+ * @param with_gravity Are we running with gravity and hence need
+ *      to exchange multipoles?
+ */
+static void proxy_cells_uncompress(struct proxy *p, const int with_gravity) {
+
+  /* The number of pcells comes first. */
+  unsigned long long v;
+  const char *buff = proxy_read_varint(p->pcells_comp_in, &v);
+  p->size_pcells_in = (int)v;
+
+  if (p->pcells_in != NULL) swift_free("pcells_in", p->pcells_in);
+  if (swift_memalign("pcells_in", (void **)&p->pcells_in,
+                     SWIFT_STRUCT_ALIGNMENT,
+                     sizeof(struct pcell) * p->size_pcells_in) != 0)
+    error("Failed to allocate pcell_in buffer.");
+
+  const integertime_t ti_zero[proxy_pcell_nr_times] = {0};
+  for (int ind = 0; ind < p->size_pcells_in;) {
+    int count = 0;
+    buff = proxy_pcell_uncompress(buff, &p->pcells_in[ind], ti_zero,
+                                  with_gravity, &count);
+    ind += count;
+  }
+
+  if (buff != p->pcells_comp_in + p->size_comp_in)
+    error("Inconsistent compressed pcells from node %d.", p->nodeID);
+}
+
+#endif  // WITH_MPI
+
 /**
  * @brief Exchange cells with a remote node, first part.
  *
  * The first part of the transaction sends the local cell count and the packed
  * #pcell array to the destination node, and enqueues an @c MPI_Irecv for
- * the foreign cell counts.
+ * the foreign cell counts. When compressing, the size in bytes of the
+ * compressed #pcell replaces the cell count.
  *
  * @param p The #proxy.
+ * @param compress Do we compress the #pcell?
+ * @param with_gravity Are we running with gravity and hence need
+ *      to exchange multipoles?
  */
-void proxy_cells_exchange_first(struct proxy *p) {
+void proxy_cells_exchange_first(struct proxy *p, const int compress,
+                                const int with_gravity) {
 
 #ifdef WITH_MPI
 
@@ -196,40 +475,65 @@ void proxy_cells_exchange_first(struct proxy *p) {
   for (int k = 0; k < p->nr_cells_out; k++)
     p->size_pcells_out += p->cells_out[k]->mpi.pcell_size;
 
+  /* Compress the pcells, their number first. */
+  if (compress) {
+    if (p->pcells_comp_out != NULL) free(p->pcells_comp_out);
+    if ((p->pcells_comp_out = (char *)malloc(
+             10 + proxy_pcell_comp_max * (size_t)p->size_pcells_out)) == NULL)
+      error("Failed to allocate compressed pcell_out buffer.");
+    char *buff = proxy_write_varint(p->pcells_comp_out, p->size_pcells_out);
+    const integertime_t ti_zero[proxy_pcell_nr_times] = {0};
+    for (int k = 0; k < p->nr_cells_out; k++)
+      buff = proxy_pcell_compress(p->cells_out[k]->mpi.pcell, ti_zero, buff,
+                                  with_gravity);
+    p->size_comp_out = buff - p->pcells_comp_out;
+  }
+
   /* Send the number of pcells. */
-  int err = MPI_Isend(&p->size_pcells_out, 1, MPI_INT, p->nodeID,
+  int err = MPI_Isend(compress ? &p->size_comp_out : &p->size_pcells_out, 1,
+                      MPI_INT, p->nodeID,
                       p->mynodeID * proxy_tag_shift + proxy_tag_count,
                       MPI_COMM_WORLD, &p->req_cells_count_out);
   if (err != MPI_SUCCESS) mpi_error(err, "Failed to isend nr of pcells.");
   // message( "isent pcell count (%i) from node %i to node %i." ,
   // p->size_pcells_out , p->mynodeID , p->nodeID ); fflush(stdout);
 
-  /* Allocate and fill the pcell buffer. */
-  if (p->pcells_out != NULL) swift_free("pcells_out", p->pcells_out);
-  if (swift_memalign("pcells_out", (void **)&p->pcells_out,
-                     SWIFT_STRUCT_ALIGNMENT,
-                     sizeof(struct pcell) * p->size_pcells_out) != 0)
-    error("Failed to allocate pcell_out buffer.");
+  if (compress) {
 
-  for (int ind = 0, k = 0; k < p->nr_cells_out; k++) {
-    memcpy(&p->pcells_out[ind], p->cells_out[k]->mpi.pcell,
-           sizeof(struct pcell) * p->cells_out[k]->mpi.pcell_size);
-    ind += p->cells_out[k]->mpi.pcell_size;
-  }
+    /* Send the compressed pcells. */
+    err = MPI_Isend(p->pcells_comp_out, p->size_comp_out, MPI_BYTE, p->nodeID,
+                    p->mynodeID * proxy_tag_shift + proxy_tag_cells,
+                    MPI_COMM_WORLD, &p->req_cells_out);
+
+  } else {
+
+    /* Allocate and fill the pcell buffer. */
+    if (p->pcells_out != NULL) swift_free("pcells_out", p->pcells_out);
+    if (swift_memalign("pcells_out", (void **)&p->pcells_out,
+                       SWIFT_STRUCT_ALIGNMENT,
+                       sizeof(struct pcell) * p->size_pcells_out) != 0)
+      error("Failed to allocate pcell_out buffer.");
+
+    for (int ind = 0, k = 0; k < p->nr_cells_out; k++) {
+      memcpy(&p->pcells_out[ind], p->cells_out[k]->mpi.pcell,
+             sizeof(struct pcell) * p->cells_out[k]->mpi.pcell_size);
+      ind += p->cells_out[k]->mpi.pcell_size;
+    }
 
-  /* Send the pcell buffer. */
-  err = MPI_Isend(p->pcells_out, p->size_pcells_out, pcell_mpi_type, p->nodeID,
-                  p->mynodeID * proxy_tag_shift + proxy_tag_cells,
-                  MPI_COMM_WORLD, &p->req_cells_out);
+    /* Send the pcell buffer. */
+    err = MPI_Isend(p->pcells_out, p->size_pcells_out, pcell_mpi_type,
+                    p->nodeID, p->mynodeID * proxy_tag_shift + proxy_tag_cells,
+                    MPI_COMM_WORLD, &p->req_cells_out);
+  }
 
   if (err != MPI_SUCCESS) mpi_error(err, "Failed to pcell_out buffer.");
   // message( "isent pcells (%i) from node %i to node %i." , p->size_pcells_out
   // , p->mynodeID , p->nodeID ); fflush(stdout);
 
   /* Receive the number of pcells. */
-  err = MPI_Irecv(&p->size_pcells_in, 1, MPI_INT, p->nodeID,
-                  p->nodeID * proxy_tag_shift + proxy_tag_count, MPI_COMM_WORLD,
-                  &p->req_cells_count_in);
+  err = MPI_Irecv(compress ? &p->size_comp_in : &p->size_pcells_in, 1, MPI_INT,
+                  p->nodeID, p->nodeID * proxy_tag_shift + proxy_tag_count,
+                  MPI_COMM_WORLD, &p->req_cells_count_in);
   if (err != MPI_SUCCESS) mpi_error(err, "Failed to irecv nr of pcells.");
     // message( "irecv pcells count on node %i from node %i." , p->mynodeID ,
     // p->nodeID ); fflush(stdout);
@@ -247,11 +551,26 @@ void proxy_cells_exchange_first(struct proxy *p) {
  * it.
  *
  * @param p The #proxy.
+ * @param compress Do we compress the #pcell?
  */
-void proxy_cells_exchange_second(struct proxy *p) {
+void proxy_cells_exchange_second(struct proxy *p, const int compress) {
 
 #ifdef WITH_MPI
 
+  /* Receive the compressed pcells? These get uncompressed on arrival. */
+  if (compress) {
+    if (p->pcells_comp_in != NULL) free(p->pcells_comp_in);
+    if ((p->pcells_comp_in = (char *)malloc(p->size_comp_in)) == NULL)
+      error("Failed to allocate compressed pcell_in buffer.");
+    int err = MPI_Irecv(p->pcells_comp_in, p->size_comp_in, MPI_BYTE,
+                        p->nodeID,
+                        p->nodeID * proxy_tag_shift + proxy_tag_cells,
+                        MPI_COMM_WORLD, &p->req_cells_in);
+    if (err != MPI_SUCCESS)
+      mpi_error(err, "Failed to irecv compressed pcells.");
+    return;
+  }
+
   /* Re-allocate the pcell_in buffer. */
   if (p->pcells_in != NULL) swift_free("pcells_in", p->pcells_in);
   if (swift_memalign("pcells_in", (void **)&p->pcells_in,
@@ -305,12 +624,20 @@ void proxy_cells_pack_mapper(void *map_data, int num_elements,
   }
 }
 
+struct exchange_first_mapper_data {
+  int compress;
+  int with_gravity;
+};
+
 void proxy_cells_exchange_first_mapper(void *map_data, int num_elements,
                                        void *extra_data) {
   struct proxy *proxies = (struct proxy *)map_data;
+  const struct exchange_first_mapper_data *data =
+      (const struct exchange_first_mapper_data *)extra_data;
 
   for (int k = 0; k < num_elements; k++) {
-    proxy_cells_exchange_first(&proxies[k]);
+    proxy_cells_exchange_first(&proxies[k], data->compress,
+                               data->with_gravity);
   }
 }
 
@@ -368,9 +695,11 @@ void proxy_cells_wait_and_unpack_mapper(void *unused_map_data, int num_elements,
  * @param s The space into which the particles will be unpacked.
  * @param with_gravity Are we running with gravity and hence need
  *      to exchange multipoles?
+ * @param compress Do we compress the #pcell before sending them?
  */
 void proxy_cells_exchange(struct proxy *proxies, int num_proxies,
-                          struct space *s, const int with_gravity) {
+                          struct space *s, const int with_gravity,
+                          const int compress) {
 
 #ifdef WITH_MPI
 
@@ -417,9 +746,19 @@ void proxy_cells_exchange(struct proxy *proxies, int num_proxies,
             clocks_getunit());
 
   /* Launch the first part of the exchange. */
+  struct exchange_first_mapper_data first_data = {compress, with_gravity};
   threadpool_map(&s->e->threadpool, proxy_cells_exchange_first_mapper, proxies,
-                 num_proxies, sizeof(struct proxy), /*chunk=*/0,
-                 /*extra_data=*/NULL);
+                 num_proxies, sizeof(struct proxy), /*chunk=*/0, &first_data);
+
+  if (s->e->verbose && compress) {
+    size_t raw = 0, comp = 0;
+    for (int k = 0; k < num_proxies; k++) {
+      raw += proxies[k].size_pcells_out * sizeof(struct pcell);
+      comp += proxies[k].size_comp_out;
+    }
+    message("Compressed %zd bytes of pcells into %zd bytes.", raw, comp);
+  }
+
   for (int k = 0; k < num_proxies; k++) {
     reqs_in[k] = proxies[k].req_cells_count_in;
     reqs_out[k] = proxies[k].req_cells_count_out;
@@ -433,7 +772,7 @@ void proxy_cells_exchange(struct proxy *proxies, int num_proxies,
         pid == MPI_UNDEFINED)
       error("MPI_Waitany failed.");
     // message( "request from proxy %i has arrived." , pid );
-    proxy_cells_exchange_second(&proxies[pid]);
+    proxy_cells_exchange_second(&proxies[pid], compress);
   }
 
   /* Wait for all the sends to have finished too. */
@@ -456,6 +795,7 @@ void proxy_cells_exchange(struct proxy *proxies, int num_proxies,
         pid == MPI_UNDEFINED)
       error("MPI_Waitany failed.");
     // message( "cell data from proxy %i has arrived." , pid );
+    if (compress) proxy_cells_uncompress(&proxies[pid], with_gravity);
     for (int count = 0, j = 0; j < proxies[pid].nr_cells_in; j++)
       count += cell_unpack(&proxies[pid].pcells_in[count],
                            proxies[pid].cells_in[j], s, with_gravity);
@@ -571,6 +911,205 @@ void proxy_addcell_out(struct proxy *p, struct cell *c, int type) {
   p->nr_cells_out += 1;
 }
 
+/**
+ * @brief Size in bytes of the message of an end-of-step send or recv task.
+ *
+ * @param t The #task.
+ */
+size_t proxy_tend_size(const struct task *t) {
+
+#ifdef WITH_MPI
+  const size_t count = t->ci->mpi.pcell_size;
+  switch (t->subtype) {
+    case task_subtype_tend_part:
+      return count * sizeof(struct pcell_step_hydro);
+    case task_subtype_tend_gpart:
+      return count * sizeof(struct pcell_step_grav);
+    case task_subtype_tend_spart:
+      return count * sizeof(struct pcell_step_stars);
+    case task_subtype_tend_bpart:
+      return count * sizeof(struct pcell_step_black_holes);
+    default:
+      error("Invalid end-of-step task subtype (%d).", t->subtype);
+  }
+#else
+  error("SWIFT was not compiled with MPI support.");
+#endif
+  return 0;
+}
+
+/**
+ * @brief Empty a list of end-of-step messages, keeping its buffers.
+ *
+ * @param l The #proxy_tend_list.
+ */
+void proxy_tend_reset(struct proxy_tend_list *l) {
+
+  l->nr_tasks = 0;
+  l->nr_groups = 0;
+}
+
+/**
+ * @brief Add an end-of-step send or recv task to a list.
+ *
+ * @param l The #proxy_tend_list.
+ * @param t The #task.
+ */
+void proxy_tend_add_task(struct proxy_tend_list *l, struct task *t) {
+
+  /* Do we need to grow the list? */
+  if (l->nr_tasks == l->size_tasks) {
+    l->size_tasks =
+        (l->size_tasks == 0) ? proxy_buffinit : l->size_tasks * proxy_buffgrow;
+
+    struct task **temp;
+    if ((temp = (struct task **)malloc(sizeof(struct task *) *
+                                       l->size_tasks)) == NULL)
+      error("Failed to allocate end-of-step task list.");
+    if (l->tasks != NULL) {
+      memcpy(temp, l->tasks, sizeof(struct task *) * l->nr_tasks);
+      free(l->tasks);
+    }
+    l->tasks = temp;
+  }
+
+  l->tasks[l->nr_tasks] = t;
+  l->nr_tasks += 1;
+}
+
+/**
+ * @brief Group a range of the tasks of a list into a single message.
+ *
+ * The groups point into the list of tasks and must hence only be made once
+ * all the tasks have been added.
+ *
+ * @param l The #proxy_tend_list.
+ * @param first The index of the first task of the group.
+ * @param count The number of tasks in the group.
+ * @param size The size of the message of the group in bytes.
+ *
+ * @return The index of the new group.
+ */
+int proxy_tend_add_group(struct proxy_tend_list *l, int first, int count,
+                         size_t size) {
+
+  /* Do we need to grow the list? */
+  if (l->nr_groups == l->size_groups) {
+    l->size_groups = (l->size_groups == 0) ? proxy_buffinit
+                                           : l->size_groups * proxy_buffgrow;
+
+    struct proxy_tend *temp;
+    if ((temp = (struct proxy_tend *)malloc(sizeof(struct proxy_tend) *
+                                            l->size_groups)) == NULL)
+      error("Failed to allocate end-of-step group list.");
+    if (l->groups != NULL) {
+      memcpy(temp, l->groups, sizeof(struct proxy_tend) * l->nr_groups);
+      free(l->groups);
+    }
+    l->groups = temp;
+  }
+
+  struct proxy_tend *g = &l->groups[l->nr_groups];
+  g->tasks = &l->tasks[first];
+  g->count = count;
+  g->size = size;
+  return l->nr_groups++;
+}
+
+/**
+ * @brief Get the group of end-of-step messages communicated by a task.
+ *
+ * The tasks of a group carry the index of the group, encoded as a negative
+ * number, in their flags.
+ *
+ * @param proxies The #proxy of the #engine.
+ * @param proxy_ind The index of the #proxy of each node.
+ * @param t The send or recv #task.
+ */
+const struct proxy_tend *proxy_tend_get_group(const struct proxy *proxies,
+                                              const int *proxy_ind,
+                                              const struct task *t) {
+
+  const int send = (t->type == task_type_send);
+  const int nodeID = send ? t->cj->nodeID : t->ci->nodeID;
+  const struct proxy *p = &proxies[proxy_ind[nodeID]];
+  const struct proxy_tend_list *l = send ? &p->tend_out : &p->tend_in;
+  const int gid = -t->flags - 1;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (gid < 0 || gid >= l->nr_groups || l->groups[gid].tasks[0] != t)
+    error("Task is not the first of a group of end-of-step messages.");
+#endif
+
+  return &l->groups[gid];
+}
+
+/**
+ * @brief Pack the end-of-step information of all the cells of a group.
+ *
+ * @param g The #proxy_tend.
+ * @param buff (output) The buffer of size g->size to pack into.
+ */
+void proxy_tend_pack(const struct proxy_tend *g, char *buff) {
+
+  size_t offset = 0;
+  for (int k = 0; k < g->count; k++) {
+    struct task *t = g->tasks[k];
+    void *pcells = buff + offset;
+    switch (t->subtype) {
+      case task_subtype_tend_part:
+        cell_pack_end_step_hydro(t->ci, (struct pcell_step_hydro *)pcells);
+        break;
+      case task_subtype_tend_gpart:
+        cell_pack_end_step_grav(t->ci, (struct pcell_step_grav *)pcells);
+        break;
+      case task_subtype_tend_spart:
+        cell_pack_end_step_stars(t->ci, (struct pcell_step_stars *)pcells);
+        break;
+      case task_subtype_tend_bpart:
+        cell_pack_end_step_black_holes(
+            t->ci, (struct pcell_step_black_holes *)pcells);
+        break;
+      default:
+        error("Invalid end-of-step task subtype (%d).", t->subtype);
+    }
+    offset += proxy_tend_size(t);
+  }
+}
+
+/**
+ * @brief Unpack the end-of-step information of all the cells of a group.
+ *
+ * @param g The #proxy_tend.
+ * @param buff The buffer of size g->size to unpack from.
+ */
+void proxy_tend_unpack(const struct proxy_tend *g, char *buff) {
+
+  size_t offset = 0;
+  for (int k = 0; k < g->count; k++) {
+    struct task *t = g->tasks[k];
+    void *pcells = buff + offset;
+    switch (t->subtype) {
+      case task_subtype_tend_part:
+        cell_unpack_end_step_hydro(t->ci, (struct pcell_step_hydro *)pcells);
+        break;
+      case task_subtype_tend_gpart:
+        cell_unpack_end_step_grav(t->ci, (struct pcell_step_grav *)pcells);
+        break;
+      case task_subtype_tend_spart:
+        cell_unpack_end_step_stars(t->ci, (struct pcell_step_stars *)pcells);
+        break;
+      case task_subtype_tend_bpart:
+        cell_unpack_end_step_black_holes(
+            t->ci, (struct pcell_step_black_holes *)pcells);
+        break;
+      default:
+        error("Invalid end-of-step task subtype (%d).", t->subtype);
+    }
+    offset += proxy_tend_size(t);
+  }
+}
+
 /**
  * @brief Exchange particles with a remote node.
  *
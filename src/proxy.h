@@ -47,6 +47,38 @@ enum proxy_cell_type {
   proxy_cell_type_gravity = (1 << 1),
 };
 
+/**
+ * @brief A group of end-of-step messages exchanged with a proxy as one.
+ *
+ * The first task of the group does the communication of the whole group and
+ * the others are implicit and unlock it.
+ */
+struct proxy_tend {
+
+  /* The tasks of the group, in message order. */
+  struct task **tasks;
+
+  /* Number of tasks in the group. */
+  int count;
+
+  /* Size of the message in bytes. */
+  size_t size;
+};
+
+/**
+ * @brief The end-of-step messages exchanged with a proxy in one direction.
+ */
+struct proxy_tend_list {
+
+  /* The tasks, grouped or not. */
+  struct task **tasks;
+  int nr_tasks, size_tasks;
+
+  /* The groups of tasks sent as a single message. */
+  struct proxy_tend *groups;
+  int nr_groups, size_groups;
+};
+
 /* Data structure for the proxy. */
 struct proxy {
 
@@ -59,12 +91,20 @@ struct proxy {
   struct pcell *pcells_in;
   int nr_cells_in, size_cells_in, size_pcells_in;
 
+  /* Incoming compressed cells and their size in bytes. */
+  char *pcells_comp_in;
+  int size_comp_in;
+
   /* Outgoing cells. */
   struct cell **cells_out;
   int *cells_out_type;
   struct pcell *pcells_out;
   int nr_cells_out, size_cells_out, size_pcells_out;
 
+  /* Outgoing compressed cells and their size in bytes. */
+  char *pcells_comp_out;
+  int size_comp_out;
+
   /* The parts and xparts buffers for input and output. */
   struct part *parts_in, *parts_out;
   struct xpart *xparts_in, *xparts_out;
@@ -83,6 +123,9 @@ struct proxy {
   /* Buffer to hold the incomming/outgoing particle counts. */
   int buff_out[4], buff_in[4];
 
+  /* The outgoing and incoming end-of-step messages. */
+  struct proxy_tend_list tend_out, tend_in;
+
 /* MPI request handles. */
 #ifdef WITH_MPI
   MPI_Request req_parts_count_out, req_parts_count_in;
@@ -108,9 +151,19 @@ void proxy_parts_exchange_second(struct proxy *p);
 void proxy_addcell_in(struct proxy *p, struct cell *c, int type);
 void proxy_addcell_out(struct proxy *p, struct cell *c, int type);
 void proxy_cells_exchange(struct proxy *proxies, int num_proxies,
-                          struct space *s, int with_gravity);
+                          struct space *s, int with_gravity, int compress);
 void proxy_tags_exchange(struct proxy *proxies, int num_proxies,
                          struct space *s);
 void proxy_create_mpi_type(void);
+size_t proxy_tend_size(const struct task *t);
+void proxy_tend_reset(struct proxy_tend_list *l);
+void proxy_tend_add_task(struct proxy_tend_list *l, struct task *t);
+int proxy_tend_add_group(struct proxy_tend_list *l, int first, int count,
+                         size_t size);
+const struct proxy_tend *proxy_tend_get_group(const struct proxy *proxies,
+                                              const int *proxy_ind,
+                                              const struct task *t);
+void proxy_tend_pack(const struct proxy_tend *g, char *buff);
+void proxy_tend_unpack(const struct proxy_tend *g, char *buff);
 
 #endif /* SWIFT_PROXY_H */
@@ -37,6 +37,174 @@
 #include "atomic.h"
 #include "error.h"
 
+/* Return values of the deque operations when no task was obtained. */
+#define queue_deque_empty -1
+#define queue_deque_abort -2
+
+/**
+ * @brief Allocate a new circular buffer for a work-stealing deque.
+ *
+ * @param size The number of elements (must be a power of two).
+ */
+static struct queue_deque_buffer *queue_deque_buffer_new(long long size) {
+
+  struct queue_deque_buffer *buf = (struct queue_deque_buffer *)malloc(
+      sizeof(struct queue_deque_buffer) + sizeof(int) * size);
+  if (buf == NULL) error("Failed to allocate deque buffer.");
+  buf->size = size;
+  return buf;
+}
+
+/**
+ * @brief Double the size of the buffer of a work-stealing deque.
+ *
+ * The old buffer is kept alive as thieves may still be reading from it.
+ *
+ * @param q The #queue, assumed to be locked.
+ * @param top The current top of the deque.
+ * @param bottom The current bottom of the deque.
+ */
+static void queue_deque_grow(struct queue *q, long long top, long long bottom) {
+
+  struct queue_deque_buffer *old = q->deque;
+  struct queue_deque_buffer *buf = queue_deque_buffer_new(2 * old->size);
+
+  for (long long k = top; k < bottom; k++)
+    buf->tid[k & (buf->size - 1)] = old->tid[k & (old->size - 1)];
+
+  /* Retire the old buffer. */
+  struct queue_deque_buffer **temp = (struct queue_deque_buffer **)realloc(
+      q->deque_retired, sizeof(struct queue_deque_buffer *) *
+                            (q->nr_deque_retired + 1));
+  if (temp == NULL) error("Failed to allocate retired deque buffers.");
+  q->deque_retired = temp;
+  q->deque_retired[q->nr_deque_retired++] = old;
+
+  /* Make the copy visible before publishing the new buffer. */
+  __sync_synchronize();
+  q->deque = buf;
+}
+
+/**
+ * @brief Push a task index at the bottom of the work-stealing deque.
+ *
+ * @param q The #queue, assumed to be locked.
+ * @param tid The index of the task.
+ */
+static void queue_deque_push(struct queue *q, int tid) {
+
+  const long long bottom = q->deque_bottom;
+  const long long top = q->deque_top;
+  if (bottom - top >= q->deque->size - 1) queue_deque_grow(q, top, bottom);
+
+  struct queue_deque_buffer *buf = q->deque;
+  buf->tid[bottom & (buf->size - 1)] = tid;
+
+  /* Make the task visible before moving the bottom. */
+  __sync_synchronize();
+  q->deque_bottom = bottom + 1;
+}
+
+/**
+ * @brief Pop a task index from the bottom of the work-stealing deque.
+ *
+ * @param q The #queue, assumed to be locked.
+ *
+ * @return The index of the task or #queue_deque_empty.
+ */
+static int queue_deque_pop(struct queue *q) {
+
+  const long long bottom = q->deque_bottom - 1;
+  struct queue_deque_buffer *buf = q->deque;
+  q->deque_bottom = bottom;
+
+  /* The store to bottom must be visible before we read top. */
+  __sync_synchronize();
+  const long long top = q->deque_top;
+
+  /* Empty deque? */
+  if (top > bottom) {
+    q->deque_bottom = bottom + 1;
+    return queue_deque_empty;
+  }
+
+  int tid = buf->tid[bottom & (buf->size - 1)];
+
+  /* Last element: race against the thieves for it. */
+  if (top == bottom) {
+    if (atomic_cas(&q->deque_top, top, top + 1) != top)
+      tid = queue_deque_empty;
+    q->deque_bottom = bottom + 1;
+  }
+
+  return tid;
+}
+
+/**
+ * @brief Steal a task index from the top of the work-stealing deque.
+ *
+ * Can be called concurrently by any thread, without locking.
+ *
+ * @param q The #queue.
+ *
+ * @return The index of the task, #queue_deque_empty or #queue_deque_abort if
+ * we lost a race with another thread.
+ */
+static int queue_deque_steal(struct queue *q) {
+
+  const long long top = q->deque_top;
+
+  /* Read top before bottom. */
+  __sync_synchronize();
+  const long long bottom = q->deque_bottom;
+
+  if (top >= bottom) return queue_deque_empty;
+
+  struct queue_deque_buffer *buf = q->deque;
+  const int tid = buf->tid[top & (buf->size - 1)];
+
+  if (atomic_cas(&q->deque_top, top, top + 1) != top) return queue_deque_abort;
+  return tid;
+}
+
+/**
+ * @brief Move the tasks collected from the incoming DEQ to the work-stealing
+ * deque.
+ *
+ * The tasks are ordered as a max-heap of weights. We sort them by increasing
+ * weight before pushing them such that the owner pops the heaviest first.
+ *
+ * @param q The #queue, assumed to be locked.
+ */
+static void queue_deque_push_incoming(struct queue *q) {
+
+  int *tid = q->tid;
+  const struct task *tasks = q->tasks;
+
+  /* Heap-sort the entries in-place (ascending weights). */
+  for (int end = q->count - 1; end > 0; end--) {
+    int temp = tid[0];
+    tid[0] = tid[end];
+    tid[end] = temp;
+
+    int k = 0, i;
+    while ((i = 2 * k + 1) < end) {
+      if (i + 1 < end && tasks[tid[i + 1]].weight > tasks[tid[i]].weight)
+        i += 1;
+      if (tasks[tid[i]].weight > tasks[tid[k]].weight) {
+        temp = tid[i];
+        tid[i] = tid[k];
+        tid[k] = temp;
+        k = i;
+      } else
+        break;
+    }
+  }
+
+  for (int k = 0; k < q->count; k++) queue_deque_push(q, tid[k]);
+  q->count = 0;
+}
+
 /**
  * @brief Enqueue all tasks in the incoming DEQ.
  *
@@ -88,6 +256,9 @@ void queue_get_incoming(struct queue *q) {
         if ( tasks[ tid[(k-1)/2] ].weight < tasks[ tid[k] ].weight )
             error( "Queue heap is disordered." ); */
   }
+
+  /* Deques only use the heap as a staging area. */
+  if (q->type == queue_type_deque && q->count > 0) queue_deque_push_incoming(q);
 }
 
 /**
@@ -119,6 +290,7 @@ void queue_insert(struct queue *q, struct task *t) {
 
   /* Increase the incoming count. */
   atomic_inc(&q->count_incoming);
+  atomic_add_d(&q->weight, t->weight);
 }
 
 /**
@@ -126,8 +298,9 @@ void queue_insert(struct queue *q, struct task *t) {
  *
  * @param q The #queue.
  * @param tasks List of tasks to which the queue indices refer to.
+ * @param type The type of queue (see #queue_types).
  */
-void queue_init(struct queue *q, struct task *tasks) {
+void queue_init(struct queue *q, struct task *tasks, int type) {
 
   /* Allocate the task list if needed. */
   q->size = queue_sizeinit;
@@ -139,6 +312,7 @@ void queue_init(struct queue *q, struct task *tasks) {
 
   /* Init counters. */
   q->count = 0;
+  q->weight = 0.;
 
   /* Init the queue lock. */
   if (lock_init(&q->lock) != 0) error("Failed to init queue lock.");
@@ -153,6 +327,76 @@ void queue_init(struct queue *q, struct task *tasks) {
   q->first_incoming = 0;
   q->last_incoming = 0;
   q->count_incoming = 0;
+
+  /* Init the work-stealing deque. */
+  q->type = type;
+  q->deque_top = 0;
+  q->deque_bottom = 0;
+  q->deque = NULL;
+  q->deque_retired = NULL;
+  q->nr_deque_retired = 0;
+  if (type == queue_type_deque)
+    q->deque = queue_deque_buffer_new(queue_deque_sizeinit);
+}
+
+/**
+ * @brief Get a task free of conflicts from the bottom of the work-stealing
+ * deque.
+ *
+ * Tasks that cannot be locked are pushed back in their original order.
+ *
+ * @param q The task #queue, assumed to be locked.
+ */
+static struct task *queue_gettask_deque(struct queue *q) {
+
+  int stash[queue_search_window];
+  int count = 0;
+  struct task *res = NULL;
+
+  while (count < queue_search_window) {
+    const int tid = queue_deque_pop(q);
+    if (tid < 0) break;
+    if (task_lock(&q->tasks[tid])) {
+      res = &q->tasks[tid];
+      break;
+    }
+    stash[count++] = tid;
+  }
+
+  /* Put back what we could not use. */
+  for (int k = count - 1; k >= 0; k--) queue_deque_push(q, stash[k]);
+
+  if (res != NULL) atomic_add_d(&q->weight, -res->weight);
+  return res;
+}
+
+/**
+ * @brief Steal a task free of conflicts from another #queue.
+ *
+ * For work-stealing deques this does not take the queue lock. Tasks that
+ * cannot be locked are handed back to the owner via the incoming DEQ.
+ *
+ * @param q The task #queue to steal from.
+ * @param prev The previous #task extracted by the thief.
+ */
+struct task *queue_steal(struct queue *q, const struct task *prev) {
+
+  if (q->type != queue_type_deque) return queue_gettask(q, prev, 0);
+
+  for (int tries = 0; tries < queue_search_window; tries++) {
+    const int tid = queue_deque_steal(q);
+    if (tid == queue_deque_empty) return NULL;
+    if (tid == queue_deque_abort) continue;
+
+    struct task *t = &q->tasks[tid];
+    atomic_add_d(&q->weight, -t->weight);
+    if (task_lock(t)) return t;
+
+    /* Give it back. */
+    queue_insert(q, t);
+  }
+
+  return NULL;
 }
 
 /**
@@ -178,6 +422,13 @@ struct task *queue_gettask(struct queue *q, const struct task *prev,
   /* Fill any tasks from the incoming DEQ. */
   queue_get_incoming(q);
 
+  /* Work-stealing deques have their own logic. */
+  if (q->type == queue_type_deque) {
+    res = queue_gettask_deque(q);
+    if (lock_unlock(qlock) != 0) error("Unlocking the qlock failed.\n");
+    return res;
+  }
+
   /* If there are no tasks, leave immediately. */
   if (q->count == 0) {
     lock_unlock_blind(qlock);
@@ -254,6 +505,7 @@ struct task *queue_gettask(struct queue *q, const struct task *prev,
 
     /* Get a pointer on the task that we want to return. */
     res = &qtasks[tid];
+    atomic_add_d(&q->weight, -res->weight);
 
     /* Swap this task with the last task and re-heap. */
     int k = ind;
@@ -300,4 +552,7 @@ void queue_clean(struct queue *q) {
 
   free(q->tid);
   free(q->tid_incoming);
+  free(q->deque);
+  for (int k = 0; k < q->nr_deque_retired; k++) free(q->deque_retired[k]);
+  free(q->deque_retired);
 }
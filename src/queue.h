@@ -21,6 +21,7 @@
 
 /* Includes. */
 #include "cell.h"
+#include "inline.h"
 #include "lock.h"
 #include "task.h"
 
@@ -31,6 +32,13 @@
 #define queue_search_window 8
 #define queue_incoming_size 10240
 #define queue_struct_align 64
+#define queue_deque_sizeinit 1024
+
+/* The different types of queue. */
+enum queue_types {
+  queue_type_heap = 0, /* Locked max-heap of task weights. */
+  queue_type_deque     /* Lock-free work-stealing deque. */
+};
 
 /* Counters. */
 enum {
@@ -39,6 +47,16 @@ enum {
 };
 extern int queue_counter[queue_counter_count];
 
+/** The circular buffer of a work-stealing deque. */
+struct queue_deque_buffer {
+
+  /* Number of elements in the buffer (a power of two). */
+  long long size;
+
+  /* The task indices. */
+  int tid[];
+};
+
 /** The queue struct. */
 struct queue {
 
@@ -58,12 +76,47 @@ struct queue {
   int *tid_incoming;
   volatile unsigned int first_incoming, last_incoming, count_incoming;
 
+  /* Sum of the weights of the tasks in the queue, incoming ones included.
+   * Updated atomically outside of the lock, so only a hint. */
+  volatile double weight;
+
+  /* The type of queue (see #queue_types). */
+  int type;
+
+  /* Chase-Lev deque: the owner pushes and pops at the bottom while thieves
+   * steal from the top. */
+  volatile long long deque_top, deque_bottom;
+
+  /* The circular buffer of the deque. */
+  struct queue_deque_buffer *volatile deque;
+
+  /* Buffers replaced when growing, freed once no thief can be using them. */
+  struct queue_deque_buffer **deque_retired;
+  int nr_deque_retired;
+
 } __attribute__((aligned(queue_struct_align)));
 
+/**
+ * @brief Approximate number of tasks in a #queue, not counting the incoming
+ * ones.
+ *
+ * @param q The #queue.
+ */
+__attribute__((always_inline)) INLINE static int queue_count(
+    const struct queue *q) {
+
+  if (q->type == queue_type_deque) {
+    const long long count = q->deque_bottom - q->deque_top;
+    return count > 0 ? count : 0;
+  }
+  return q->count;
+}
+
 /* Function prototypes. */
 struct task *queue_gettask(struct queue *q, const struct task *prev,
                            int blocking);
-void queue_init(struct queue *q, struct task *tasks);
+struct task *queue_steal(struct queue *q, const struct task *prev);
+void queue_init(struct queue *q, struct task *tasks, int type);
 void queue_insert(struct queue *q, struct task *t);
 void queue_clean(struct queue *q);
 
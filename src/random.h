@@ -29,25 +29,82 @@
 /**
  * @brief The categories of random number generated.
  *
- * The values of the fields are carefully chose numbers
- * the numbers are very large primes such that the IDs
- * will not have a prime factorization with this coefficient
- * this results in a very high period for the random number
- * generator.
- * Only change when you know what you are doing, changing
- * the numbers to bad values will break the random number
- * generator.
- * In case new numbers need to be added other possible
- * numbers could be:
- * 4947009007, 5947309451, 6977309513
+ * The values of the fields are used as the key of the generator. Any set of
+ * distinct values gives uncorrelated streams, but changing an existing value
+ * changes the numbers drawn for that process and hence breaks the
+ * reproducibility of runs made with earlier versions.
  */
 enum random_number_type {
   random_number_star_formation = 0LL,
   random_number_stellar_feedback = 3947008991LL,
   random_number_stellar_enrichment = 2936881973LL,
-  random_number_BH_feedback = 1640531371LL
+  random_number_BH_feedback = 1640531371LL,
+  random_number_initial_conditions = 2718759611LL
 };
 
+/*! Number of rounds of the Threefry-2x64 generator */
+#define random_threefry_rounds 20
+
+/*! Key-schedule parity constant of the Threefry generators */
+#define random_threefry_parity 0x1BD11BDAA9FC1A22ULL
+
+/**
+ * @brief Rotate a 64-bit integer to the left.
+ *
+ * @param x The number to rotate.
+ * @param n The number of bits to rotate by (0 < n < 64).
+ */
+__attribute__((always_inline)) INLINE static unsigned long long random_rotl64(
+    const unsigned long long x, const int n) {
+  return (x << n) | (x >> (64 - n));
+}
+
+/**
+ * @brief The Threefry-2x64 counter-based pseudo-random generator.
+ *
+ * Follows Salmon et al., SC'11, "Parallel random numbers: as easy as 1, 2, 3"
+ * with 20 rounds. The output is a pure function of the counter and key: there
+ * is no state to carry around, which makes the generator trivially
+ * reproducible and lets the compiler vectorise loops over many counters.
+ *
+ * @param c0 First word of the counter.
+ * @param c1 Second word of the counter.
+ * @param k0 First word of the key.
+ * @param k1 Second word of the key.
+ * @return The first word of the encrypted counter.
+ */
+__attribute__((always_inline)) INLINE static unsigned long long
+random_threefry2x64(const unsigned long long c0, const unsigned long long c1,
+                    const unsigned long long k0, const unsigned long long k1) {
+
+  const unsigned long long ks[3] = {k0, k1, random_threefry_parity ^ k0 ^ k1};
+
+  unsigned long long x0 = c0 + ks[0];
+  unsigned long long x1 = c1 + ks[1];
+
+  /* Rounds are applied in groups of 4, each followed by a key injection.
+   * The groups alternate between the two sets of rotation constants. */
+  for (int s = 1; s <= random_threefry_rounds / 4; ++s) {
+
+    if (s % 2) {
+      x0 += x1, x1 = random_rotl64(x1, 16), x1 ^= x0;
+      x0 += x1, x1 = random_rotl64(x1, 42), x1 ^= x0;
+      x0 += x1, x1 = random_rotl64(x1, 12), x1 ^= x0;
+      x0 += x1, x1 = random_rotl64(x1, 31), x1 ^= x0;
+    } else {
+      x0 += x1, x1 = random_rotl64(x1, 16), x1 ^= x0;
+      x0 += x1, x1 = random_rotl64(x1, 32), x1 ^= x0;
+      x0 += x1, x1 = random_rotl64(x1, 24), x1 ^= x0;
+      x0 += x1, x1 = random_rotl64(x1, 21), x1 ^= x0;
+    }
+
+    x0 += ks[s % 3];
+    x1 += ks[(s + 1) % 3] + s;
+  }
+
+  return x0;
+}
+
 /**
  * @brief Returns a pseudo-random number in the range [0, 1[.
  *
@@ -56,6 +113,10 @@ enum random_number_type {
  * time-step per particle is needed, additional randomness can be obtained by
  * using the type argument.
  *
+ * The number is the Threefry-2x64 encryption of the counter (id, ti_current)
+ * with the type as the key. The 53 most significant bits are used to build
+ * the double.
+ *
  * @param id The ID of the particle for which to generate a number.
  * @param ti_current The time (on the time-line) for which to generate a number.
  * @param type The #random_number_type to generate.
@@ -65,51 +126,36 @@ INLINE static double random_unit_interval(const long long int id,
                                           const integertime_t ti_current,
                                           const enum random_number_type type) {
 
-  /* Range used for the seeds. Best if prime */
-  static const long long seed_range = RAND_MAX;
-  static const double RAND_MAX_inv = 1. / ((double)RAND_MAX);
-  static const long long mwc_number = (1LL << 32) - 1LL;
-
-  /* Calculate the seed */
-  /* WARNING: Only change the math if you really know what you are doing!
-   * The numbers are carefully chosen prime numbers that prevent correlation
-   * with either the current integer time or the particle IDs. The current
-   * method also prevents any correlation between different random number
-   * types.
-   * The calculation overflows on purpose.
-   * 1. The first step is calculating the seed by using a multiply with carry
-   * (MWC) method, this method depends on the type of random number and
-   * this therefore also prevents that there is any correlation between
-   * the different types of random numbers.
-   * 2. After this we use the 64 bit Xorshift method to randomize the seeds
-   * even more.
-   * 3. We calculate a prime multiplication for the id with a quadratic
-   * term.
-   * 4. We calculate the seed by using a Quadratic congruential generator,
-   * in which we use the id part and the current time step bin.
-   */
-  unsigned long long number = ti_current;
-
-  /* Multiply with carry (MWC), (adviced variables by NR) */
-  number = 4294957665LL * (number & (mwc_number)) + (number >> 32);
-
-  /* 64-bit Xorshift (adviced variables by NR) */
-  number ^= number << 21;
-  number ^= number >> 35;
-  number ^= number << 4;
-
-  /* Add constant to ID */
-  const unsigned long long idt = id + type;
-
-  /* Nonlinear congruential generator */
-  const unsigned long long idpart =
-      3457LL * idt + 593LL * idt * ti_current + 5417LL * idt * idt;
-  unsigned int seed =
-      (937LL * number + 5171LL * number * number + idpart + 1109LL) %
-      9996361LL % seed_range;
-
-  /* Generate a random number between 0 and 1. */
-  return rand_r(&seed) * RAND_MAX_inv;
+  const unsigned long long bits = random_threefry2x64(
+      (unsigned long long)id, (unsigned long long)ti_current,
+      (unsigned long long)type, 0ULL);
+
+  /* 2^-53 */
+  return (bits >> 11) * 0x1.0p-53;
+}
+
+/**
+ * @brief Fills an array with pseudo-random numbers in the range [0, 1[, one
+ * per particle ID.
+ *
+ * Each number is identical to the one random_unit_interval() returns for the
+ * same ID. The loop carries no dependency between elements and only uses
+ * integer additions, shifts and xors, so it vectorises.
+ *
+ * @param ids The IDs of the particles for which to generate a number.
+ * @param count The number of IDs.
+ * @param ti_current The time (on the time-line) for which to generate the
+ * numbers.
+ * @param type The #random_number_type to generate.
+ * @param r (return) The random numbers.
+ */
+INLINE static void random_unit_interval_batch(
+    const long long int *restrict ids, const int count,
+    const integertime_t ti_current, const enum random_number_type type,
+    double *restrict r) {
+
+  for (int i = 0; i < count; ++i)
+    r[i] = random_unit_interval(ids[i], ti_current, type);
 }
 
 #endif /* SWIFT_RANDOM_H */
@@ -27,15 +27,22 @@
 
 /* Standard headers. */
 #include <errno.h>
+#include <fcntl.h>
 #include <glob.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/types.h>
 #include <unistd.h>
 
+#include "clocks.h"
 #include "engine.h"
 #include "error.h"
+#include "memuse.h"
 #include "restart.h"
 #include "version.h"
 
@@ -43,13 +50,159 @@
 #define SWIFT_RESTART_SIGNATURE "SWIFT-restart-file"
 #define SWIFT_RESTART_END_SIGNATURE "SWIFT-restart-file:end"
 
+/* Version of the layout of the restart files, to be bumped whenever it
+ * changes. Version 1 added the incremental files, the padding blocks and
+ * the compressed blocks. */
+#define SWIFT_RESTART_FORMAT_VERSION 1
+
+/* Label of the block holding the format version. */
+#define SWIFT_RESTART_FORMAT "format"
+
+/* Label of the block naming the complete file of an incremental file. */
+#define SWIFT_RESTART_INCREMENTAL "incremental"
+
+/* Label of the blocks padding the data of large blocks to aligned offsets. */
+#define SWIFT_RESTART_PADDING "padding"
+
 #define FNAMELEN 200
 #define LABLEN 20
 
+/* Size of the chunks of data compared with the last complete restart file
+ * when writing an incremental one. */
+#define RESTART_CHUNK_SIZE (1 << 20)
+
+/* Blocks from this size on start on a page of the file. */
+#define RESTART_ALIGNED_MIN_SIZE (16 * restart_align)
+
+/* Size of the pieces of the large blocks written in parallel. */
+#define RESTART_PIECE_SIZE (8 << 20)
+
+/* Blocks from this size on are written in parallel pieces. */
+#define RESTART_DIRECT_MIN_SIZE (4 * RESTART_PIECE_SIZE)
+
+/* Blocks from this size on are compressed, when requested. */
+#define RESTART_COMPRESS_MIN_SIZE RESTART_ALIGNED_MIN_SIZE
+
+/* Size of the hash table of the compressor. */
+#define RESTART_COMPRESS_HASH_BITS 14
+
 /* Structure for a dumped header. */
 struct header {
   size_t len;             /* Total length of data in bytes. */
   char label[LABLEN + 1]; /* A label for data */
+  char compressed;        /* Is the data stored in compressed pieces? */
+};
+
+/* Hashes of the chunks of a block of the last complete restart file. */
+struct restart_block_hashes {
+  size_t len;             /* Total length of data in bytes. */
+  char label[LABLEN + 1]; /* A label for data */
+  uint64_t *hashes;       /* One hash per chunk of RESTART_CHUNK_SIZE bytes */
+};
+
+/* What restart_write_blocks() does with the blocks. */
+enum restart_write_mode {
+  restart_write_plain,      /* Just write them. */
+  restart_write_record,     /* Write them and keep the hashes of the chunks. */
+  restart_write_incremental /* Only write the chunks that changed. */
+};
+
+/* State of the incremental restart files of this rank. Restart files are
+ * only ever written or read by one thread at a time. */
+static struct {
+
+  /* What to do with the blocks being written. */
+  enum restart_write_mode mode;
+
+  /* Hashes of the blocks of the last complete file. */
+  struct restart_block_hashes *blocks;
+  int nr_blocks, size_blocks;
+
+  /* Index of the next block of an incremental file. */
+  int next_block;
+
+  /* Number of incremental files written since the last complete one. */
+  int nr_incremental;
+
+  /* Does the last complete file still need to be moved to its .base name? */
+  int base_pending;
+
+  /* Bytes written and bytes found unchanged in the current file. */
+  size_t bytes_written, bytes_unchanged;
+
+  /* The complete file referred to by the incremental file being read. */
+  FILE *base_stream;
+
+} restart_increments;
+
+/* State of the restart file being written with direct i/o. */
+static struct {
+
+  /* The threads writing the pieces of large blocks, NULL when not in use. */
+  struct threadpool *threadpool;
+
+  /* Descriptor of the file opened for direct i/o, -1 if not supported. */
+  int fd_direct;
+
+  /* Descriptor of the file for the unaligned pieces. */
+  int fd;
+
+} restart_direct = {NULL, -1, -1};
+
+/* State of the compression of the restart file being written. */
+static struct {
+
+  /* The threads compressing the pieces of large blocks, NULL when the file
+   * is not compressed. */
+  struct threadpool *threadpool;
+
+  /* Bytes of compressed blocks before and after compression. */
+  size_t bytes_in, bytes_out;
+
+} restart_compression = {NULL, 0, 0};
+
+/* Whether the large blocks of the file being read are mapped into memory. */
+static int restart_mapping = 0;
+
+/* Whether the format of the file being read is known, so that the
+ * compression flags of its headers can be trusted. */
+static int restart_format_checked = 0;
+
+/* A piece of a large block to be written at a given offset. */
+struct restart_piece {
+  const char *data;
+  size_t len;
+  off_t offset;
+};
+
+/* A piece of a large block to be compressed. */
+struct restart_comp_piece {
+  const char *data;
+  size_t len;
+
+  /* The compressed data and its size, equal to len if stored as is. */
+  char *buff;
+  size_t size;
+};
+
+/* A restart file staged in memory and written by a separate thread. */
+struct restart_async {
+
+  /* The thread writing the file. */
+  pthread_t thread;
+
+  /* Name of the file. */
+  char filename[FNAMELEN];
+
+  /* The content of the file. */
+  char *buffer;
+  size_t size;
+
+  /* Keep a .prev copy of the file being replaced? */
+  int save;
+
+  /* Move the file being replaced to its .base name? */
+  int move_base;
 };
 
 /**
@@ -120,20 +273,824 @@ void restart_locate_free(int nfiles, char **files) {
   free(files);
 }
 
+/**
+ * @brief Hash a chunk of data.
+ *
+ * @param data the data.
+ * @param len the number of bytes.
+ *
+ * @result a 64-bit hash of the content.
+ */
+static uint64_t restart_hash(const char *data, size_t len) {
+
+  uint64_t hash = 14695981039346656037ULL;
+  size_t k = 0;
+  for (; k + sizeof(uint64_t) <= len; k += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, &data[k], sizeof(uint64_t));
+    hash = (hash ^ word) * 1099511628211ULL;
+    hash ^= hash >> 29;
+  }
+  for (; k < len; k++)
+    hash = (hash ^ (unsigned char)data[k]) * 1099511628211ULL;
+  return hash;
+}
+
+/**
+ * @brief Length of a given chunk of a block.
+ *
+ * @param len the length of the block in bytes.
+ * @param chunk the index of the chunk.
+ */
+static size_t restart_chunk_len(size_t len, size_t chunk) {
+  const size_t offset = chunk * RESTART_CHUNK_SIZE;
+  return (len - offset < RESTART_CHUNK_SIZE) ? len - offset
+                                             : RESTART_CHUNK_SIZE;
+}
+
+/**
+ * @brief Read the next header of a restart file, skipping any padding.
+ *
+ * @param head the header to fill.
+ * @param stream the file stream.
+ *
+ * @result 1 if a header was read.
+ */
+static int restart_read_header(struct header *head, FILE *stream) {
+  while (fread(head, sizeof(struct header), 1, stream) == 1) {
+    if (strncmp(head->label, SWIFT_RESTART_PADDING, LABLEN) != 0) return 1;
+    if (fseeko(stream, head->len, SEEK_CUR) != 0) return 0;
+  }
+  return 0;
+}
+
+/**
+ * @brief Forget the hashes of the last complete restart file.
+ */
+static void restart_clear_hashes(void) {
+  for (int k = 0; k < restart_increments.nr_blocks; k++)
+    free(restart_increments.blocks[k].hashes);
+  restart_increments.nr_blocks = 0;
+}
+
+/**
+ * @brief Keep the hashes of the chunks of a block written to a complete
+ *        restart file.
+ *
+ * @param data the data of the block.
+ * @param len the length of the block in bytes.
+ * @param label the label of the block.
+ */
+static void restart_record_block(const char *data, size_t len,
+                                 const char *label) {
+
+  if (restart_increments.nr_blocks == restart_increments.size_blocks) {
+    restart_increments.size_blocks = 2 * restart_increments.size_blocks + 32;
+    restart_increments.blocks = (struct restart_block_hashes *)realloc(
+        restart_increments.blocks,
+        restart_increments.size_blocks * sizeof(struct restart_block_hashes));
+    if (restart_increments.blocks == NULL)
+      error("Failed to allocate the restart block hashes");
+  }
+
+  struct restart_block_hashes *block =
+      &restart_increments.blocks[restart_increments.nr_blocks++];
+  block->len = len;
+  strncpy(block->label, label, LABLEN);
+  block->label[LABLEN] = '\0';
+
+  const size_t nchunks = (len + RESTART_CHUNK_SIZE - 1) / RESTART_CHUNK_SIZE;
+  block->hashes = (uint64_t *)malloc(nchunks * sizeof(uint64_t));
+  if (block->hashes == NULL) error("Failed to allocate the restart hashes");
+  for (size_t i = 0; i < nchunks; i++)
+    block->hashes[i] = restart_hash(&data[i * RESTART_CHUNK_SIZE],
+                                    restart_chunk_len(len, i));
+}
+
+/**
+ * @brief Write the chunks of a block of an incremental restart file.
+ *
+ * A flag per chunk tells whether the chunk follows or is identical to the
+ * same chunk of the same block of the last complete file. Only the data of
+ * the chunks that differ is then written.
+ *
+ * @param data the data of the block.
+ * @param len the length of the block in bytes.
+ * @param stream the file stream.
+ * @param label the label of the block.
+ * @param errstr a context string to qualify any errors.
+ */
+static void restart_write_chunks(const char *data, size_t len, FILE *stream,
+                                 const char *label, const char *errstr) {
+
+  /* The blocks are matched by their position in the files. */
+  const struct restart_block_hashes *base = NULL;
+  const int k = restart_increments.next_block++;
+  if (k < restart_increments.nr_blocks &&
+      strncmp(restart_increments.blocks[k].label, label, LABLEN) == 0)
+    base = &restart_increments.blocks[k];
+
+  const size_t nchunks = (len + RESTART_CHUNK_SIZE - 1) / RESTART_CHUNK_SIZE;
+  const size_t nchunks_base =
+      (base != NULL)
+          ? (base->len + RESTART_CHUNK_SIZE - 1) / RESTART_CHUNK_SIZE
+          : 0;
+  char *unchanged = (char *)malloc(nchunks);
+  if (unchanged == NULL) error("Failed to allocate the restart chunk flags");
+
+  for (size_t i = 0; i < nchunks; i++) {
+    const size_t chunk_len = restart_chunk_len(len, i);
+    unchanged[i] =
+        i < nchunks_base && restart_chunk_len(base->len, i) == chunk_len &&
+        base->hashes[i] ==
+            restart_hash(&data[i * RESTART_CHUNK_SIZE], chunk_len);
+  }
+
+  if (fwrite(unchanged, 1, nchunks, stream) != nchunks)
+    error("Failed to save %s chunk flags to restart file (%s)", errstr,
+          strerror(errno));
+
+  for (size_t i = 0; i < nchunks; i++) {
+    const size_t chunk_len = restart_chunk_len(len, i);
+    if (unchanged[i]) {
+      restart_increments.bytes_unchanged += chunk_len;
+    } else if (fwrite(&data[i * RESTART_CHUNK_SIZE], 1, chunk_len, stream) !=
+               chunk_len) {
+      error("Failed to save %s to restart file (%s)", errstr,
+            strerror(errno));
+    }
+  }
+  free(unchanged);
+}
+
+/**
+ * @brief Read the chunks of a block of an incremental restart file, taking
+ *        the unchanged ones from the last complete file.
+ *
+ * @param data the memory to fill.
+ * @param len the length of the block in bytes.
+ * @param stream the file stream.
+ * @param errstr a context string to qualify any errors.
+ */
+static void restart_read_chunks(char *data, size_t len, FILE *stream,
+                                const char *errstr) {
+
+  const size_t nchunks = (len + RESTART_CHUNK_SIZE - 1) / RESTART_CHUNK_SIZE;
+  char *unchanged = (char *)malloc(nchunks);
+  if (unchanged == NULL) error("Failed to allocate the restart chunk flags");
+  if (fread(unchanged, 1, nchunks, stream) != nchunks)
+    error("Failed to read the %s chunk flags from restart file (%s)", errstr,
+          strerror(errno));
+
+  /* Locate the block at the same position in the complete file. */
+  FILE *base = restart_increments.base_stream;
+  struct header head;
+  off_t offset = -1;
+  if (restart_read_header(&head, base)) {
+    offset = ftello(base);
+    if (fseeko(base, offset + head.len, SEEK_SET) != 0) offset = -1;
+  }
+
+  for (size_t i = 0; i < nchunks; i++) {
+    const size_t chunk_offset = i * RESTART_CHUNK_SIZE;
+    const size_t chunk_len = restart_chunk_len(len, i);
+    FILE *from = stream;
+    if (unchanged[i]) {
+      if (offset < 0 || chunk_offset + chunk_len > head.len)
+        error("Complete restart file lacks the %s data", errstr);
+      if (fseeko(base, offset + chunk_offset, SEEK_SET) != 0)
+        error("Failed to seek %s in complete restart file (%s)", errstr,
+              strerror(errno));
+      from = base;
+    }
+    if (fread(&data[chunk_offset], 1, chunk_len, from) != chunk_len)
+      error("Failed to restore %s from restart file (%s)", errstr,
+            ferror(from) ? strerror(errno) : "unexpected end of file");
+  }
+
+  /* Leave the complete file at its next block. */
+  if (offset >= 0 && fseeko(base, offset + head.len, SEEK_SET) != 0)
+    error("Failed to seek in complete restart file (%s)", strerror(errno));
+  free(unchanged);
+}
+
+/**
+ * @brief Write a piece of a large block at its offset in the file.
+ *
+ * Pieces of whole pages go through direct i/o, when available, via a bounce
+ * buffer if the memory is not aligned. The others go through the page cache.
+ *
+ * @param piece the #restart_piece.
+ */
+static void restart_write_piece(const struct restart_piece *piece) {
+
+  int fd = restart_direct.fd_direct;
+  if (fd < 0 || piece->len % restart_align != 0 ||
+      piece->offset % restart_align != 0)
+    fd = restart_direct.fd;
+
+  const char *data = piece->data;
+  char *bounce = NULL;
+  if (fd != restart_direct.fd && (uintptr_t)data % restart_align != 0) {
+    if (posix_memalign((void **)&bounce, restart_align, piece->len) != 0)
+      error("Failed to allocate restart bounce buffer");
+    memcpy(bounce, data, piece->len);
+    data = bounce;
+  }
+
+  size_t done = 0;
+  while (done < piece->len) {
+    const ssize_t n =
+        pwrite(fd, &data[done], piece->len - done, piece->offset + done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+
+      /* Not all file systems accept direct i/o, fall back. */
+      if (errno == EINVAL && fd != restart_direct.fd) {
+        fd = restart_direct.fd;
+        continue;
+      }
+      error("Failed to write to restart file (%s)", strerror(errno));
+    }
+    done += n;
+  }
+  free(bounce);
+}
+
+/**
+ * @brief Mapper function writing pieces of a large block.
+ *
+ * @param map_data the #restart_piece to write.
+ * @param num_elements the number of pieces.
+ * @param extra_data unused.
+ */
+static void restart_write_pieces_mapper(void *map_data, int num_elements,
+                                        void *extra_data) {
+  const struct restart_piece *pieces = (const struct restart_piece *)map_data;
+  for (int k = 0; k < num_elements; k++) restart_write_piece(&pieces[k]);
+}
+
+/**
+ * @brief Write a large block at a page-aligned offset of the file.
+ *
+ * A padding block first moves the data to an offset that is a multiple of
+ * restart_align, so that it can be mapped back into memory when restarting
+ * and written with direct i/o. With direct i/o, the pieces of the block are
+ * then written by the threads of the threadpool at their known offsets and
+ * the stream is moved past the end of the block.
+ *
+ * @param data the data of the block.
+ * @param head the header of the block.
+ * @param stream the file stream.
+ * @param errstr a context string to qualify any errors.
+ */
+static void restart_write_aligned(const char *data, const struct header *head,
+                                  FILE *stream, const char *errstr) {
+
+  const off_t pos = ftello(stream);
+  if (pos < 0)
+    error("Failed to locate %s in restart file (%s)", errstr,
+          strerror(errno));
+
+  /* Pad so that the data starts on a page. */
+  struct header padding;
+  padding.len =
+      (restart_align - (pos + 2 * sizeof(struct header)) % restart_align) %
+      restart_align;
+  strncpy(padding.label, SWIFT_RESTART_PADDING, LABLEN);
+  padding.label[LABLEN] = '\0';
+  padding.compressed = 0;
+  static const char zeros[restart_align] = {0};
+  if (fwrite(&padding, sizeof(struct header), 1, stream) != 1 ||
+      fwrite(zeros, 1, padding.len, stream) != padding.len ||
+      fwrite(head, sizeof(struct header), 1, stream) != 1)
+    error("Failed to save %s header to restart file (%s)", errstr,
+          strerror(errno));
+
+  /* Smaller blocks are just written through the stream. */
+  if (restart_direct.threadpool == NULL ||
+      head->len < RESTART_DIRECT_MIN_SIZE) {
+    if (fwrite(data, 1, head->len, stream) != head->len)
+      error("Failed to save %s to restart file (%s)", errstr,
+            strerror(errno));
+    return;
+  }
+
+  if (fflush(stream) != 0)
+    error("Failed to save %s header to restart file (%s)", errstr,
+          strerror(errno));
+  const off_t offset = ftello(stream);
+
+  /* Pieces of whole pages, bar the last one. */
+  const int npieces = (head->len + RESTART_PIECE_SIZE - 1) / RESTART_PIECE_SIZE;
+  struct restart_piece *pieces =
+      (struct restart_piece *)malloc(npieces * sizeof(struct restart_piece));
+  if (pieces == NULL) error("Failed to allocate the restart pieces");
+  for (int k = 0; k < npieces; k++) {
+    const size_t start = (size_t)k * RESTART_PIECE_SIZE;
+    const size_t len = (head->len - start < RESTART_PIECE_SIZE)
+                           ? head->len - start
+                           : RESTART_PIECE_SIZE;
+    pieces[k] =
+        (struct restart_piece){&data[start], len, offset + (off_t)start};
+  }
+
+  /* The unaligned end of the last piece goes through the page cache. */
+  struct restart_piece tail = pieces[npieces - 1];
+  const size_t tail_len = tail.len % restart_align;
+  pieces[npieces - 1].len -= tail_len;
+  tail.data += tail.len - tail_len;
+  tail.offset += tail.len - tail_len;
+  tail.len = tail_len;
+
+  threadpool_map(restart_direct.threadpool, restart_write_pieces_mapper,
+                 pieces, npieces, sizeof(struct restart_piece),
+                 /*chunk=*/1, /*extra_data=*/NULL);
+  restart_write_piece(&tail);
+  free(pieces);
+
+  if (fseeko(stream, offset + head->len, SEEK_SET) != 0)
+    error("Failed to seek past %s in restart file (%s)", errstr,
+          strerror(errno));
+}
+
+/**
+ * @brief Compress a piece of a block with a fast LZ77 codec.
+ *
+ * The data is coded as a sequence of literal runs, each followed by a copy
+ * of earlier data. A token byte holds the number of literals and the length
+ * of the copy minus 4 in its two halves, with further bytes for lengths from
+ * 15 on, then come the literals and the 16-bit distance of the copy. The
+ * last run has no copy. Repeated 4-byte sequences are found with a hash
+ * table, which suits the zero-padded fields and the repeated values of
+ * arrays of structs.
+ *
+ * @param in the data to compress.
+ * @param len the number of bytes.
+ * @param out the buffer receiving the compressed data.
+ * @param max the size of the buffer.
+ *
+ * @result the size of the compressed data, 0 if it does not fit in the
+ *         buffer.
+ */
+size_t restart_compress(const char *in, size_t len, char *out, size_t max) {
+
+  uint32_t table[1 << RESTART_COMPRESS_HASH_BITS];
+  memset(table, 0xff, sizeof(table));
+
+  size_t ip = 0, op = 0, anchor = 0;
+  while (ip + 4 <= len) {
+
+    uint32_t seq;
+    memcpy(&seq, &in[ip], sizeof(uint32_t));
+    const uint32_t hash =
+        (seq * 2654435761U) >> (32 - RESTART_COMPRESS_HASH_BITS);
+    const size_t ref = table[hash];
+    table[hash] = ip;
+
+    uint32_t seq_ref;
+    if (ref == UINT32_MAX || ip - ref > UINT16_MAX ||
+        (memcpy(&seq_ref, &in[ref], sizeof(uint32_t)), seq_ref != seq)) {
+
+      /* Skip faster through data that does not compress. */
+      ip += 1 + ((ip - anchor) >> 6);
+      continue;
+    }
+
+    /* Extend the copy as far as it goes. */
+    size_t match = 4;
+    while (ip + match < len && in[ref + match] == in[ip + match]) match++;
+
+    const size_t lit = ip - anchor;
+    if (op + 1 + lit / 255 + 1 + lit + 2 + match / 255 + 1 > max) return 0;
+
+    /* Token and number of literals. */
+    char *token = &out[op++];
+    *token = (lit < 15 ? lit : 15) << 4;
+    if (lit >= 15) {
+      size_t l = lit - 15;
+      for (; l >= 255; l -= 255) out[op++] = (char)255;
+      out[op++] = l;
+    }
+    memcpy(&out[op], &in[anchor], lit);
+    op += lit;
+
+    /* Distance and length of the copy. */
+    const size_t dist = ip - ref;
+    out[op++] = dist & 0xff;
+    out[op++] = dist >> 8;
+    *token |= (match - 4 < 15) ? match - 4 : 15;
+    if (match - 4 >= 15) {
+      size_t l = match - 4 - 15;
+      for (; l >= 255; l -= 255) out[op++] = (char)255;
+      out[op++] = l;
+    }
+
+    ip += match;
+    anchor = ip;
+  }
+
+  /* The remaining literals. */
+  const size_t lit = len - anchor;
+  if (op + 1 + lit / 255 + 1 + lit > max) return 0;
+  out[op++] = (lit < 15 ? lit : 15) << 4;
+  if (lit >= 15) {
+    size_t l = lit - 15;
+    for (; l >= 255; l -= 255) out[op++] = (char)255;
+    out[op++] = l;
+  }
+  memcpy(&out[op], &in[anchor], lit);
+  return op + lit;
+}
+
+/**
+ * @brief Read a length of the compressed format, continued from 15 on.
+ *
+ * @param in the compressed data.
+ * @param ip the position in the data, updated.
+ * @param size the size of the compressed data.
+ * @param len the length held in the token.
+ */
+static size_t restart_uncompress_len(const unsigned char *in, size_t *ip,
+                                     size_t size, size_t len) {
+  if (len < 15) return len;
+  unsigned char b;
+  do {
+    if (*ip >= size) error("Corrupted compressed restart data");
+    b = in[(*ip)++];
+    len += b;
+  } while (b == 255);
+  return len;
+}
+
+/**
+ * @brief Uncompress a piece of a block compressed by restart_compress().
+ *
+ * @param data the compressed data.
+ * @param size the size of the compressed data.
+ * @param out the memory receiving the data.
+ * @param len the number of bytes of the data.
+ */
+void restart_uncompress(const char *data, size_t size, char *out,
+                        size_t len) {
+
+  const unsigned char *in = (const unsigned char *)data;
+  size_t ip = 0, op = 0;
+  while (ip < size) {
+    const unsigned char token = in[ip++];
+
+    /* Literals. */
+    const size_t lit = restart_uncompress_len(in, &ip, size, token >> 4);
+    if (ip + lit > size || op + lit > len)
+      error("Corrupted compressed restart data");
+    memcpy(&out[op], &in[ip], lit);
+    ip += lit;
+    op += lit;
+    if (ip == size) break;
+
+    /* Copy, possibly overlapping. */
+    if (ip + 2 > size) error("Corrupted compressed restart data");
+    const size_t dist = in[ip] | ((size_t)in[ip + 1] << 8);
+    ip += 2;
+    const size_t match =
+        restart_uncompress_len(in, &ip, size, token & 15) + 4;
+    if (dist == 0 || dist > op || op + match > len)
+      error("Corrupted compressed restart data");
+    if (dist >= match) {
+      memcpy(&out[op], &out[op - dist], match);
+    } else {
+      for (size_t k = 0; k < match; k++) out[op + k] = out[op + k - dist];
+    }
+    op += match;
+  }
+  if (op != len) error("Corrupted compressed restart data");
+}
+
+/**
+ * @brief Mapper function compressing pieces of a large block.
+ *
+ * Pieces that do not compress are stored as they are.
+ *
+ * @param map_data the #restart_comp_piece to compress.
+ * @param num_elements the number of pieces.
+ * @param extra_data unused.
+ */
+static void restart_compress_mapper(void *map_data, int num_elements,
+                                    void *extra_data) {
+  struct restart_comp_piece *pieces = (struct restart_comp_piece *)map_data;
+  for (int k = 0; k < num_elements; k++) {
+    struct restart_comp_piece *piece = &pieces[k];
+    piece->size =
+        restart_compress(piece->data, piece->len, piece->buff, piece->len - 1);
+    if (piece->size == 0) piece->size = piece->len;
+  }
+}
+
+/**
+ * @brief Write a large block in compressed pieces.
+ *
+ * The block is cut in pieces of RESTART_PIECE_SIZE bytes that are compressed
+ * in parallel by the threads of the threadpool, a batch at a time. Each
+ * piece is written after its compressed size, the size of the piece itself
+ * meaning that it did not compress and is stored as is.
+ *
+ * @param data the data of the block.
+ * @param head the header of the block.
+ * @param stream the file stream.
+ * @param errstr a context string to qualify any errors.
+ */
+static void restart_write_compressed(const char *data,
+                                     const struct header *head, FILE *stream,
+                                     const char *errstr) {
+
+  if (fwrite(head, sizeof(struct header), 1, stream) != 1)
+    error("Failed to save %s header to restart file (%s)", errstr,
+          strerror(errno));
+
+  const size_t npieces =
+      (head->len + RESTART_PIECE_SIZE - 1) / RESTART_PIECE_SIZE;
+  const int batch = restart_compression.threadpool->num_threads;
+  struct restart_comp_piece *pieces = (struct restart_comp_piece *)malloc(
+      batch * sizeof(struct restart_comp_piece));
+  char *buff = (char *)malloc((size_t)batch * RESTART_PIECE_SIZE);
+  if (pieces == NULL || buff == NULL)
+    error("Failed to allocate the restart compression buffers");
+
+  for (size_t first = 0; first < npieces; first += batch) {
+    const size_t left = npieces - first;
+    const int n = (int)(left < (size_t)batch ? left : (size_t)batch);
+    for (int k = 0; k < n; k++) {
+      const size_t start = (first + k) * RESTART_PIECE_SIZE;
+      pieces[k].data = &data[start];
+      pieces[k].len = (head->len - start < RESTART_PIECE_SIZE)
+                          ? head->len - start
+                          : RESTART_PIECE_SIZE;
+      pieces[k].buff = &buff[(size_t)k * RESTART_PIECE_SIZE];
+    }
+    threadpool_map(restart_compression.threadpool, restart_compress_mapper,
+                   pieces, n, sizeof(struct restart_comp_piece), /*chunk=*/1,
+                   /*extra_data=*/NULL);
+
+    for (int k = 0; k < n; k++) {
+      const uint64_t size = pieces[k].size;
+      const char *out =
+          (size < pieces[k].len) ? pieces[k].buff : pieces[k].data;
+      if (fwrite(&size, sizeof(uint64_t), 1, stream) != 1 ||
+          fwrite(out, 1, size, stream) != size)
+        error("Failed to save %s to restart file (%s)", errstr,
+              strerror(errno));
+      restart_compression.bytes_out += sizeof(uint64_t) + size;
+    }
+  }
+  restart_compression.bytes_in += head->len;
+
+  free(buff);
+  free(pieces);
+}
+
+/**
+ * @brief Read a block written by restart_write_compressed().
+ *
+ * @param ptr the memory receiving the data.
+ * @param len the length of the block in bytes.
+ * @param stream the file stream.
+ * @param errstr a context string to qualify any errors.
+ */
+static void restart_read_compressed(char *ptr, size_t len, FILE *stream,
+                                    const char *errstr) {
+
+  char *buff = (char *)malloc(RESTART_PIECE_SIZE);
+  if (buff == NULL) error("Failed to allocate the restart compression buffer");
+
+  for (size_t start = 0; start < len; start += RESTART_PIECE_SIZE) {
+    const size_t piece_len =
+        (len - start < RESTART_PIECE_SIZE) ? len - start : RESTART_PIECE_SIZE;
+    uint64_t size;
+    if (fread(&size, sizeof(uint64_t), 1, stream) != 1 || size > piece_len)
+      error("Failed to restore %s from restart file (%s)", errstr,
+            ferror(stream) ? strerror(errno) : "corrupted compressed data");
+
+    char *in = (size < piece_len) ? buff : &ptr[start];
+    if (fread(in, 1, size, stream) != size)
+      error("Failed to restore %s from restart file (%s)", errstr,
+            ferror(stream) ? strerror(errno) : "unexpected end of file");
+    if (size < piece_len) restart_uncompress(in, size, &ptr[start], piece_len);
+  }
+  free(buff);
+}
+
+/**
+ * @brief Map the pages of a block of a restart file into memory.
+ *
+ * The pages are mapped privately over the given memory and only read from
+ * the file when first accessed, copied when first written.
+ *
+ * @param ptr the memory receiving the data.
+ * @param len the length of the block in bytes.
+ * @param stream the file stream, positioned at the data of the block.
+ *
+ * @result the number of bytes mapped, 0 if the block or memory is not
+ *         aligned.
+ */
+static size_t restart_read_mapped(char *ptr, size_t len, FILE *stream) {
+
+  const size_t page = sysconf(_SC_PAGESIZE);
+  const off_t offset = ftello(stream);
+  if (offset < 0 || offset % page != 0 || (uintptr_t)ptr % page != 0 ||
+      len < page)
+    return 0;
+
+  const size_t maplen = len / page * page;
+  if (mmap(ptr, maplen, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+           fileno(stream), offset) == MAP_FAILED)
+    error("Failed to map restart file (%s)", strerror(errno));
+
+  if (fseeko(stream, offset + maplen, SEEK_SET) != 0)
+    error("Failed to seek in restart file (%s)", strerror(errno));
+  return maplen;
+}
+
+/**
+ * @brief Move the restart file about to be replaced out of the way.
+ *
+ * @param filename name of the restart file.
+ * @param save whether to keep a .prev copy of the file.
+ * @param move_base whether the file is the complete file that the following
+ *                  incremental files will refer to.
+ */
+static void restart_write_prepare(const char *filename, int save,
+                                  int move_base) {
+
+  if (move_base) {
+    struct stat buf;
+    if (stat(filename, &buf) != 0) return;
+
+    /* The complete file also serves as the previous one. */
+    char newname[FNAMELEN];
+    if (save) {
+      snprintf(newname, FNAMELEN, "%s.prev", filename);
+      if (link(filename, newname) != 0)
+        message("Failed to link file '%s' to '%s' (%s)", filename, newname,
+                strerror(errno));
+    }
+    snprintf(newname, FNAMELEN, "%s.base", filename);
+    if (rename(filename, newname) != 0)
+      error("Failed to rename file '%s' to '%s' (%s)", filename, newname,
+            strerror(errno));
+
+  } else if (save) {
+    restart_save_previous(filename);
+  }
+
+  /* Replace rather than truncate the file, a restarted run may still have
+   * it mapped. */
+  if (unlink(filename) != 0 && errno != ENOENT)
+    message("Failed to unlink file '%s' (%s)", filename, strerror(errno));
+}
+
+/**
+ * @brief Body of the thread writing a restart file staged in memory.
+ *
+ * @param arg The #restart_async to write.
+ */
+static void *restart_write_async_thread(void *arg) {
+
+  struct restart_async *async = (struct restart_async *)arg;
+
+  restart_write_prepare(async->filename, async->save, async->move_base);
+
+  FILE *stream = fopen(async->filename, "w");
+  if (stream == NULL)
+    error("Failed to open restart file: %s (%s)", async->filename,
+          strerror(errno));
+  if (fwrite(async->buffer, 1, async->size, stream) != async->size)
+    error("Failed to write restart file: %s (%s)", async->filename,
+          strerror(errno));
+  if (fclose(stream) != 0)
+    error("Failed to close restart file: %s (%s)", async->filename,
+          strerror(errno));
+
+  memuse_account("writebuff", -(long long)async->size);
+  free(async->buffer);
+  async->buffer = NULL;
+
+  return NULL;
+}
+
+/**
+ * @brief Waits for the restart file being written asynchronously, if any,
+ *        to be completed.
+ *
+ * @param e the engine.
+ */
+void restart_write_wait(struct engine *e) {
+
+  if (e->restart_async == NULL) return;
+
+  const ticks tic = getticks();
+
+  struct restart_async *async = e->restart_async;
+  if (pthread_join(async->thread, /*retval=*/NULL) != 0)
+    error("Failed to join the restart i/o thread.");
+
+  if (e->verbose)
+    message("Waited %.3f %s for restart file '%s' to be completed.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit(),
+            async->filename);
+
+  free(async);
+  e->restart_async = NULL;
+}
+
 /**
  * @brief Write a restart file for the state of the given engine struct.
  *
+ * When e->restart_incremental is positive, only that many files are written
+ * in full after each complete one, keeping the complete one under the name
+ * {filename}.base. The blocks of the files in between only contain the
+ * chunks of data that changed since the complete file and refer to it for
+ * the others.
+ *
+ * When e->restart_asynchronous is set, the file is staged in memory and
+ * written by a separate thread, so the function returns before the file is
+ * complete. restart_write_wait() must be called before the file is used.
+ * Otherwise, when e->restart_direct_io is set, the large blocks are written
+ * in parallel by the threads of the threadpool, using direct i/o for their
+ * aligned parts.
+ *
+ * When e->restart_compress is set, the large blocks are instead compressed
+ * in pieces by the threads of the threadpool, which is flagged in their
+ * header, and can then no longer be mapped when restarting.
+ *
  * @param e the engine with our state information.
  * @param filename name of the file to write the restart data to.
+ * @param async whether the file may be written asynchronously.
  */
-void restart_write(struct engine *e, const char *filename) {
+void restart_write(struct engine *e, const char *filename, int async) {
 
-  /* Save a backup the existing restart file, if requested. */
-  if (e->restart_save) restart_save_previous(filename);
+  /* Make sure the previous file is complete. */
+  restart_write_wait(e);
 
-  FILE *stream = fopen(filename, "w");
-  if (stream == NULL)
-    error("Failed to open restart file: %s (%s)", filename, strerror(errno));
+  /* A complete file or only the changes since the last one? */
+  const int incremental =
+      e->restart_incremental > 0 && restart_increments.nr_blocks > 0 &&
+      restart_increments.nr_incremental < e->restart_incremental;
+  const int move_base = incremental && restart_increments.base_pending;
+  if (incremental) {
+    restart_increments.nr_incremental++;
+    restart_increments.base_pending = 0;
+  } else {
+    restart_clear_hashes();
+    restart_increments.nr_incremental = 0;
+    restart_increments.base_pending = (e->restart_incremental > 0);
+    if (e->restart_incremental > 0)
+      restart_increments.mode = restart_write_record;
+  }
+  restart_increments.bytes_written = 0;
+  restart_increments.bytes_unchanged = 0;
+
+  /* Stage the file in memory or write it directly. */
+  FILE *stream = NULL;
+  struct restart_async *staged = NULL;
+  if (async && e->restart_asynchronous) {
+    staged = (struct restart_async *)calloc(1, sizeof(struct restart_async));
+    if (staged == NULL) error("Error allocating asynchronous restart data");
+    if (strlen(filename) >= FNAMELEN)
+      error("Restart file name too long: %s", filename);
+    strcpy(staged->filename, filename);
+    staged->save = e->restart_save;
+    staged->move_base = move_base;
+    stream = open_memstream(&staged->buffer, &staged->size);
+    if (stream == NULL)
+      error("Failed to open memory stream for restart file: %s (%s)",
+            filename, strerror(errno));
+  } else {
+    restart_write_prepare(filename, e->restart_save, move_base);
+    stream = fopen(filename, "w");
+    if (stream == NULL)
+      error("Failed to open restart file: %s (%s)", filename,
+            strerror(errno));
+
+    /* Large blocks are written by all the threads at known offsets. */
+    if (e->restart_direct_io) {
+      restart_direct.threadpool = &e->threadpool;
+      restart_direct.fd = fileno(stream);
+      restart_direct.fd_direct = -1;
+#ifdef O_DIRECT
+      restart_direct.fd_direct = open(filename, O_WRONLY | O_DIRECT);
+      if (restart_direct.fd_direct < 0 && e->verbose)
+        message("Direct i/o not available for %s (%s)", filename,
+                strerror(errno));
+#endif
+    }
+  }
+
+  /* Large blocks are compressed by all the threads. */
+  if (e->restart_compress && !incremental) {
+    restart_compression.threadpool = &e->threadpool;
+    restart_compression.bytes_in = 0;
+    restart_compression.bytes_out = 0;
+  }
 
   /* Dump our signature and version. */
   restart_write_blocks((void *)SWIFT_RESTART_SIGNATURE,
@@ -141,6 +1098,19 @@ void restart_write(struct engine *e, const char *filename) {
                        "SWIFT signature");
   restart_write_blocks((void *)package_version(), strlen(package_version()), 1,
                        stream, "version", "SWIFT version");
+  int format = SWIFT_RESTART_FORMAT_VERSION;
+  restart_write_blocks(&format, sizeof(int), 1, stream, SWIFT_RESTART_FORMAT,
+                       "restart format version");
+
+  /* Name the complete file the chunks that did not change are taken from. */
+  if (incremental) {
+    char basename[FNAMELEN];
+    snprintf(basename, FNAMELEN, "%s.base", filename);
+    restart_write_blocks(basename, strlen(basename), 1, stream,
+                         SWIFT_RESTART_INCREMENTAL, "complete restart file");
+    restart_increments.mode = restart_write_incremental;
+    restart_increments.next_block = 3;
+  }
 
   engine_struct_dump(e, stream);
 
@@ -149,16 +1119,68 @@ void restart_write(struct engine *e, const char *filename) {
                        strlen(SWIFT_RESTART_END_SIGNATURE), 1, stream,
                        "endsignature", "SWIFT end signature");
 
-  fclose(stream);
+  restart_increments.mode = restart_write_plain;
+  restart_compression.threadpool = NULL;
+
+  if (restart_direct.fd_direct >= 0 && close(restart_direct.fd_direct) != 0)
+    error("Failed to close restart file: %s (%s)", filename, strerror(errno));
+  restart_direct.threadpool = NULL;
+  restart_direct.fd_direct = -1;
+  restart_direct.fd = -1;
+
+  if (fclose(stream) != 0)
+    error("Failed to close restart file: %s (%s)", filename, strerror(errno));
+
+  if (e->verbose && incremental)
+    message("Incremental restart file: %zu of %zu bytes unchanged",
+            restart_increments.bytes_unchanged,
+            restart_increments.bytes_written);
+  if (e->verbose && e->restart_compress && !incremental)
+    message("Compressed restart file: %zu bytes written for %zu bytes",
+            restart_compression.bytes_out, restart_compression.bytes_in);
+
+  /* Hand the staged file to its thread. */
+  if (staged != NULL) {
+    memuse_account("writebuff", (long long)staged->size);
+    if (pthread_create(&staged->thread, /*attr=*/NULL,
+                       restart_write_async_thread, staged) != 0)
+      error("Failed to create the restart i/o thread.");
+    e->restart_async = staged;
+  }
 }
 
 /**
- * @brief Read a restart file to construct a saved engine struct state.
+ * @brief Check the format version of a restart file.
  *
- * @param e the engine to recover from the saved state.
- * @param filename name of the file containing the staved state.
+ * Files written before the format was versioned have no such block, their
+ * headers would otherwise be misread.
+ *
+ * @param stream the file stream, positioned after the SWIFT version.
+ * @param filename name of the file, for the error messages.
+ */
+static void restart_check_format(FILE *stream, const char *filename) {
+  struct header head;
+  int format;
+  if (!restart_read_header(&head, stream) ||
+      strncmp(head.label, SWIFT_RESTART_FORMAT, LABLEN) != 0 ||
+      head.len != sizeof(int) || fread(&format, sizeof(int), 1, stream) != 1)
+    format = 0;
+  if (format != SWIFT_RESTART_FORMAT_VERSION)
+    error("Restart file %s has format version %d, expected %d", filename,
+          format, SWIFT_RESTART_FORMAT_VERSION);
+  restart_format_checked = 1;
+}
+
+/**
+ * @brief Open a restart file and check its signature and version.
+ *
+ * For an incremental file, the complete file it refers to is opened as well.
+ * The stream is left positioned at the start of the engine blocks.
+ *
+ * @param filename name of the file containing the saved state.
+ * @return The open stream, to be closed with restart_close().
  */
-void restart_read(struct engine *e, const char *filename) {
+static FILE *restart_open(const char *filename) {
 
   FILE *stream = fopen(filename, "r");
   if (stream == NULL)
@@ -188,8 +1210,121 @@ void restart_read(struct engine *e, const char *filename) {
         " badly.",
         package_version(), version);
 
-  engine_struct_restore(e, stream);
+  /* Unlike the version, the format has to match. */
+  restart_check_format(stream, filename);
+
+  /* An incremental file names the complete file it refers to. */
+  struct header head;
+  const off_t pos = ftello(stream);
+  if (fread(&head, sizeof(struct header), 1, stream) == 1 &&
+      strncmp(head.label, SWIFT_RESTART_INCREMENTAL, LABLEN) == 0) {
+    if (head.len >= FNAMELEN)
+      error("Complete restart file name too long in %s", filename);
+    char basename[FNAMELEN];
+    if (fread(basename, 1, head.len, stream) != head.len)
+      error("Failed to read the complete restart file name from %s",
+            filename);
+    basename[head.len] = '\0';
+
+    FILE *base = fopen(basename, "r");
+    if (base == NULL)
+      error("Failed to open complete restart file: %s (%s)", basename,
+            strerror(errno));
+
+    /* Skip its signature, version and format, the blocks then match. */
+    restart_read_blocks(signature, strlen(SWIFT_RESTART_SIGNATURE), 1, base,
+                        NULL, "SWIFT signature");
+    restart_read_blocks(version, strlen(package_version()), 1, base, NULL,
+                        "SWIFT version");
+    if (strncmp(version, package_version(), len) != 0)
+      error("Complete restart file %s is from a different version of SWIFT",
+            basename);
+    restart_check_format(base, basename);
+    restart_increments.base_stream = base;
+
+  } else if (fseeko(stream, pos, SEEK_SET) != 0) {
+    error("Failed to seek in restart file: %s (%s)", filename,
+          strerror(errno));
+  }
+
+  return stream;
+}
+
+/**
+ * @brief Close a restart file opened with restart_open().
+ *
+ * @param stream the stream.
+ */
+static void restart_close(FILE *stream) {
+
   fclose(stream);
+  restart_format_checked = 0;
+
+  if (restart_increments.base_stream != NULL) {
+    fclose(restart_increments.base_stream);
+    restart_increments.base_stream = NULL;
+  }
+}
+
+/**
+ * @brief Read a restart file to construct a saved engine struct state.
+ *
+ * With map set, the page-aligned blocks of the file (the particle arrays)
+ * are mapped privately into the memory allocated for them instead of being
+ * read, so that their pages are only loaded when first accessed.
+ *
+ * @param e the engine to recover from the saved state.
+ * @param filename name of the file containing the staved state.
+ * @param map whether to map the large blocks of the file.
+ */
+void restart_read(struct engine *e, const char *filename, int map) {
+
+  FILE *stream = restart_open(filename);
+
+  restart_mapping = map;
+  engine_struct_restore(e, stream);
+  restart_mapping = 0;
+  restart_close(stream);
+}
+
+/**
+ * @brief Adapt an engine restored with restart_read() to a run on a
+ * different number of ranks than the one that wrote the restart files.
+ *
+ * The particles of the file already read are kept or dropped and those of
+ * the other files given are appended to them. The stored partition of the
+ * top-level cells is forgotten, so that a new one is made for the current
+ * ranks when the cells are first built. The particles then get to their new
+ * ranks through the usual redistribution.
+ *
+ * @param e the engine restored with restart_read().
+ * @param keep whether to keep the particles of the file already read.
+ * @param filenames the other restart files whose particles we take over.
+ * @param nfiles the number of such files.
+ */
+void restart_remap(struct engine *e, int keep, char **filenames, int nfiles) {
+
+  if (!keep) space_struct_drop_particles(e->s);
+
+  struct engine *other = (struct engine *)malloc(sizeof(struct engine));
+  if (other == NULL) error("Failed to allocate scratch engine");
+
+  for (int k = 0; k < nfiles; k++) {
+    FILE *stream = restart_open(filenames[k]);
+
+    /* Skip the engine itself, only the particles of the space matter. */
+    restart_read_blocks(other, sizeof(struct engine), 1, stream, NULL,
+                        "engine struct");
+    space_struct_append(e->s, stream);
+    restart_close(stream);
+  }
+  free(other);
+
+#ifdef WITH_MPI
+  free(e->reparttype->celllist);
+  e->reparttype->celllist = NULL;
+  e->reparttype->ncelllist = 0;
+#endif
 }
 
 /**
@@ -209,8 +1344,7 @@ void restart_read_blocks(void *ptr, size_t size, size_t nblocks, FILE *stream,
                          char *label, const char *errstr) {
   if (size > 0) {
     struct header head;
-    size_t nread = fread(&head, sizeof(struct header), 1, stream);
-    if (nread != 1)
+    if (!restart_read_header(&head, stream))
       error("Failed to read the %s header from restart file (%s)", errstr,
             strerror(errno));
 
@@ -225,8 +1359,24 @@ void restart_read_blocks(void *ptr, size_t size, size_t nblocks, FILE *stream,
       strncpy(label, head.label, LABLEN + 1);
     }
 
-    nread = fread(ptr, size, nblocks, stream);
-    if (nread != nblocks)
+    if (restart_increments.base_stream != NULL) {
+      restart_read_chunks((char *)ptr, head.len, stream, errstr);
+      return;
+    }
+
+    if (head.compressed && restart_format_checked) {
+      restart_read_compressed((char *)ptr, head.len, stream, errstr);
+      return;
+    }
+
+    /* Map what we can of the large blocks, read the rest. */
+    size_t mapped = 0;
+    if (restart_mapping && head.len >= RESTART_ALIGNED_MIN_SIZE)
+      mapped = restart_read_mapped((char *)ptr, head.len, stream);
+
+    const size_t nread =
+        fread((char *)ptr + mapped, 1, head.len - mapped, stream);
+    if (nread != head.len - mapped)
       error("Failed to restore %s from restart file (%s)", errstr,
             ferror(stream) ? strerror(errno) : "unexpected end of file");
   }
@@ -253,6 +1403,26 @@ void restart_write_blocks(void *ptr, size_t size, size_t nblocks, FILE *stream,
     head.len = nblocks * size;
     strncpy(head.label, label, LABLEN);
     head.label[LABLEN] = '\0';
+    head.compressed = 0;
+
+    restart_increments.bytes_written += head.len;
+    if (restart_increments.mode == restart_write_record)
+      restart_record_block((const char *)ptr, head.len, head.label);
+
+    /* Large blocks of compressed files are written in compressed pieces. */
+    if (restart_compression.threadpool != NULL &&
+        head.len >= RESTART_COMPRESS_MIN_SIZE) {
+      head.compressed = 1;
+      restart_write_compressed((const char *)ptr, &head, stream, errstr);
+      return;
+    }
+
+    /* Large blocks of complete files start on a page. */
+    if (restart_increments.mode != restart_write_incremental &&
+        head.len >= RESTART_ALIGNED_MIN_SIZE) {
+      restart_write_aligned((const char *)ptr, &head, stream, errstr);
+      return;
+    }
 
     /* Now dump it and the data. */
     size_t nwrite = fwrite(&head, sizeof(struct header), 1, stream);
@@ -260,6 +1430,12 @@ void restart_write_blocks(void *ptr, size_t size, size_t nblocks, FILE *stream,
       error("Failed to save %s header to restart file (%s)", errstr,
             strerror(errno));
 
+    if (restart_increments.mode == restart_write_incremental) {
+      restart_write_chunks((const char *)ptr, head.len, stream, head.label,
+                           errstr);
+      return;
+    }
+
     nwrite = fwrite(ptr, size, nblocks, stream);
     if (nwrite != nblocks)
       error("Failed to save %s to restart file (%s)", errstr, strerror(errno));
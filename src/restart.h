@@ -23,8 +23,13 @@
 
 struct engine;
 
-void restart_write(struct engine *e, const char *filename);
-void restart_read(struct engine *e, const char *filename);
+/* Alignment of the large blocks in the restart files. */
+#define restart_align 4096
+
+void restart_write(struct engine *e, const char *filename, int async);
+void restart_write_wait(struct engine *e);
+void restart_read(struct engine *e, const char *filename, int map);
+void restart_remap(struct engine *e, int keep, char **filenames, int nfiles);
 
 char **restart_locate(const char *dir, const char *basename, int *nfiles);
 void restart_locate_free(int nfiles, char **files);
@@ -36,6 +41,10 @@ void restart_read_blocks(void *ptr, size_t size, size_t nblocks, FILE *stream,
 void restart_write_blocks(void *ptr, size_t size, size_t nblocks, FILE *stream,
                           const char *label, const char *errstr);
 
+size_t restart_compress(const char *in, size_t len, char *out, size_t max);
+void restart_uncompress(const char *data, size_t size, char *out,
+                        size_t len);
+
 int restart_stop_now(const char *dir, int cleanup);
 
 void restart_save_previous(const char *filename);
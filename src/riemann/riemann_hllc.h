@@ -28,10 +28,12 @@
 
 /* Local headers. */
 #include "adiabatic_index.h"
+#include "align.h"
 #include "error.h"
 #include "minmax.h"
 #include "riemann_checks.h"
 #include "riemann_vacuum.h"
+#include "vector.h"
 
 __attribute__((always_inline)) INLINE static void riemann_solve_for_flux(
     const float *WL, const float *WR, const float *n, const float *vij,
@@ -244,4 +246,318 @@ riemann_solve_for_middle_state_flux(const float *WL, const float *WR,
 #endif
 }
 
+/*! Maximal number of interfaces in a #riemann_batch */
+#define riemann_batch_size 64
+
+/**
+ * @brief A set of interfaces to be solved together by
+ * riemann_solve_batch_for_flux().
+ *
+ * The states are stored component by component so that consecutive interfaces
+ * can be loaded into the lanes of a vector.
+ */
+struct riemann_batch {
+
+  /*! Left state of the interfaces (rho, vx, vy, vz, P) */
+  float WL[5][riemann_batch_size] SWIFT_CACHE_ALIGN;
+
+  /*! Right state of the interfaces (rho, vx, vy, vz, P) */
+  float WR[5][riemann_batch_size] SWIFT_CACHE_ALIGN;
+
+  /*! Unit vector normal to the interfaces */
+  float n[3][riemann_batch_size] SWIFT_CACHE_ALIGN;
+
+  /*! Velocity of the interfaces */
+  float vij[3][riemann_batch_size] SWIFT_CACHE_ALIGN;
+
+  /*! Fluxes through the interfaces (output) */
+  float flux[5][riemann_batch_size] SWIFT_CACHE_ALIGN;
+
+  /*! Number of interfaces in the batch */
+  int count;
+};
+
+/**
+ * @brief Adds an interface to a #riemann_batch.
+ *
+ * The caller is responsible for solving the batch once it is full.
+ *
+ * @param b The #riemann_batch.
+ * @param WL Left state.
+ * @param WR Right state.
+ * @param n Unit vector normal to the interface.
+ * @param vij Velocity of the interface.
+ *
+ * @return The index of the interface in the batch.
+ */
+__attribute__((always_inline)) INLINE static int riemann_batch_add(
+    struct riemann_batch *b, const float *WL, const float *WR, const float *n,
+    const float *vij) {
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (b->count >= riemann_batch_size) error("Riemann batch overflow.");
+#endif
+
+  const int k = b->count++;
+  for (int i = 0; i < 5; i++) {
+    b->WL[i][k] = WL[i];
+    b->WR[i][k] = WR[i];
+  }
+  for (int i = 0; i < 3; i++) {
+    b->n[i][k] = n[i];
+    b->vij[i][k] = vij[i];
+  }
+  return k;
+}
+
+/**
+ * @brief Solves the Riemann problem of one interface of a #riemann_batch with
+ * the scalar solver.
+ *
+ * @param b The #riemann_batch.
+ * @param k The index of the interface.
+ */
+__attribute__((always_inline)) INLINE static void riemann_batch_solve_one(
+    struct riemann_batch *b, const int k) {
+
+  float WL[5], WR[5], n[3], vij[3], totflux[5];
+  for (int i = 0; i < 5; i++) {
+    WL[i] = b->WL[i][k];
+    WR[i] = b->WR[i][k];
+  }
+  for (int i = 0; i < 3; i++) {
+    n[i] = b->n[i][k];
+    vij[i] = b->vij[i][k];
+  }
+  riemann_solve_for_flux(WL, WR, n, vij, totflux);
+  for (int i = 0; i < 5; i++) b->flux[i][k] = totflux[i];
+}
+
+#ifdef WITH_VECTORIZATION
+
+/**
+ * @brief Solves the HLLC Riemann problem of #VEC_SIZE consecutive interfaces
+ * of a #riemann_batch.
+ *
+ * This is riemann_solve_for_flux() with the branches replaced by blends. The
+ * interfaces with a vacuum state or generating vacuum are left to the scalar
+ * solver.
+ *
+ * @param b The #riemann_batch.
+ * @param k The index of the first interface.
+ */
+__attribute__((always_inline)) INLINE static void riemann_batch_solve_vec(
+    struct riemann_batch *b, const int k) {
+
+  const vector zero = vector_set1(0.f);
+  const vector one = vector_set1(1.f);
+
+  vector rhoL = vector_load(&b->WL[0][k]);
+  vector vxL = vector_load(&b->WL[1][k]);
+  vector vyL = vector_load(&b->WL[2][k]);
+  vector vzL = vector_load(&b->WL[3][k]);
+  vector PL = vector_load(&b->WL[4][k]);
+  vector rhoR = vector_load(&b->WR[0][k]);
+  vector vxR = vector_load(&b->WR[1][k]);
+  vector vyR = vector_load(&b->WR[2][k]);
+  vector vzR = vector_load(&b->WR[3][k]);
+  vector PR = vector_load(&b->WR[4][k]);
+  const vector nx = vector_load(&b->n[0][k]);
+  const vector ny = vector_load(&b->n[1][k]);
+  const vector nz = vector_load(&b->n[2][k]);
+
+  /* Lanes with a vacuum state get a harmless density */
+  mask_t non_vacuum, non_vacuum_R;
+  vec_create_mask(non_vacuum, vec_cmp_gt(rhoL.v, zero.v));
+  vec_create_mask(non_vacuum_R, vec_cmp_gt(rhoR.v, zero.v));
+  vec_combine_masks(non_vacuum, non_vacuum_R);
+  rhoL.v = vec_blend(non_vacuum, one.v, rhoL.v);
+  rhoR.v = vec_blend(non_vacuum, one.v, rhoR.v);
+
+  /* STEP 0: obtain velocity in interface frame */
+  vector uL, uR, rhoLinv, rhoRinv, aL, aR;
+  uL.v = vec_fma(vxL.v, nx.v, vec_fma(vyL.v, ny.v, vec_mul(vzL.v, nz.v)));
+  uR.v = vec_fma(vxR.v, nx.v, vec_fma(vyR.v, ny.v, vec_mul(vzR.v, nz.v)));
+  rhoLinv.v = vec_div(one.v, rhoL.v);
+  rhoRinv.v = vec_div(one.v, rhoR.v);
+  aL.v = vec_sqrt(vec_mul(vec_set1(hydro_gamma), vec_mul(PL.v, rhoLinv.v)));
+  aR.v = vec_sqrt(vec_mul(vec_set1(hydro_gamma), vec_mul(PR.v, rhoRinv.v)));
+
+  /* Flag the lanes generating vacuum */
+  mask_t no_vacuum_generation;
+  vec_create_mask(
+      no_vacuum_generation,
+      vec_cmp_gt(vec_mul(vec_set1(hydro_two_over_gamma_minus_one),
+                         vec_add(aL.v, aR.v)),
+                 vec_sub(uR.v, uL.v)));
+  vec_combine_masks(non_vacuum, no_vacuum_generation);
+
+  /* STEP 1: pressure estimate */
+  vector pstar;
+  pstar.v = vec_mul(
+      vec_set1(0.5f),
+      vec_sub(vec_add(PL.v, PR.v),
+              vec_mul(vec_mul(vec_set1(0.25f), vec_sub(uR.v, uL.v)),
+                      vec_mul(vec_add(rhoL.v, rhoR.v), vec_add(aL.v, aR.v)))));
+  pstar.v = vec_fmax(zero.v, pstar.v);
+
+  /* STEP 2: wave speed estimates */
+  const vector q_fac =
+      vector_set1(0.5f * hydro_gamma_plus_one * hydro_one_over_gamma);
+  mask_t shock_L, shock_R, positive_L, positive_R;
+  vec_create_mask(shock_L, vec_cmp_gt(pstar.v, PL.v));
+  vec_create_mask(positive_L, vec_cmp_gt(PL.v, zero.v));
+  vec_combine_masks(shock_L, positive_L);
+  vec_create_mask(shock_R, vec_cmp_gt(pstar.v, PR.v));
+  vec_create_mask(positive_R, vec_cmp_gt(PR.v, zero.v));
+  vec_combine_masks(shock_R, positive_R);
+  vector PL_safe, PR_safe, qL, qR;
+  PL_safe.v = vec_blend(positive_L, one.v, PL.v);
+  PR_safe.v = vec_blend(positive_R, one.v, PR.v);
+  qL.v = vec_sqrt(vec_fma(
+      q_fac.v, vec_sub(vec_div(pstar.v, PL_safe.v), one.v), one.v));
+  qR.v = vec_sqrt(vec_fma(
+      q_fac.v, vec_sub(vec_div(pstar.v, PR_safe.v), one.v), one.v));
+  qL.v = vec_blend(shock_L, one.v, qL.v);
+  qR.v = vec_blend(shock_R, one.v, qR.v);
+
+  vector SLmuL, SRmuR, denom, Sstar;
+  SLmuL.v = vec_mul(vec_sub(zero.v, aL.v), qL.v);
+  SRmuR.v = vec_mul(aR.v, qR.v);
+  denom.v = vec_sub(vec_mul(rhoL.v, SLmuL.v), vec_mul(rhoR.v, SRmuR.v));
+  denom.v = vec_blend(non_vacuum, vec_set1(-1.f), denom.v);
+  Sstar.v =
+      vec_div(vec_add(vec_sub(PR.v, PL.v),
+                      vec_sub(vec_mul(vec_mul(rhoL.v, uL.v), SLmuL.v),
+                              vec_mul(vec_mul(rhoR.v, uR.v), SRmuR.v))),
+              denom.v);
+
+  /* STEP 3: HLLC flux in a frame moving with the interface velocity.
+     The left and right fluxes have the same form: pick the upwind state */
+  mask_t right;
+  vec_create_mask(right, vec_cmp_lt(Sstar.v, zero.v));
+  vector rhoX, vxX, vyX, vzX, PX, uX, rhoXinv, SXmuX;
+  rhoX.v = vec_blend(right, rhoL.v, rhoR.v);
+  vxX.v = vec_blend(right, vxL.v, vxR.v);
+  vyX.v = vec_blend(right, vyL.v, vyR.v);
+  vzX.v = vec_blend(right, vzL.v, vzR.v);
+  PX.v = vec_blend(right, PL.v, PR.v);
+  uX.v = vec_blend(right, uL.v, uR.v);
+  rhoXinv.v = vec_blend(right, rhoLinv.v, rhoRinv.v);
+  SXmuX.v = vec_blend(right, SLmuL.v, SRmuR.v);
+
+  vector rhoXuX, v2, eX, SX;
+  rhoXuX.v = vec_mul(rhoX.v, uX.v);
+  v2.v = vec_fma(vxX.v, vxX.v, vec_fma(vyX.v, vyX.v, vec_mul(vzX.v, vzX.v)));
+  eX.v = vec_fma(vec_mul(PX.v, rhoXinv.v),
+                 vec_set1(hydro_one_over_gamma_minus_one),
+                 vec_mul(vec_set1(0.5f), v2.v));
+  SX.v = vec_add(SXmuX.v, uX.v);
+
+  vector f0, f1, f2, f3, f4;
+  f0.v = rhoXuX.v;
+  f1.v = vec_fma(rhoXuX.v, vxX.v, vec_mul(PX.v, nx.v));
+  f2.v = vec_fma(rhoXuX.v, vyX.v, vec_mul(PX.v, ny.v));
+  f3.v = vec_fma(rhoXuX.v, vzX.v, vec_mul(PX.v, nz.v));
+  f4.v = vec_fma(rhoXuX.v, eX.v, vec_mul(PX.v, uX.v));
+
+  /* Star state correction: SL < 0 on the left, SR > 0 on the right */
+  vector sign;
+  sign.v = vec_blend(right, vec_set1(-1.f), one.v);
+  mask_t star;
+  vec_create_mask(star, vec_cmp_gt(vec_mul(sign.v, SX.v), zero.v));
+  vector star_denom, starfac, rhoXSX, SstarmuX, rhoXSXstarfac, rhoXSXSstarmuX;
+  star_denom.v = vec_blend(star, one.v, vec_sub(SX.v, Sstar.v));
+  starfac.v = vec_sub(vec_div(SXmuX.v, star_denom.v), one.v);
+  rhoXSX.v = vec_mul(rhoX.v, SX.v);
+  SstarmuX.v = vec_sub(Sstar.v, uX.v);
+  rhoXSXstarfac.v = vec_mul(rhoXSX.v, starfac.v);
+  rhoXSXSstarmuX.v = vec_mul(rhoXSX.v, SstarmuX.v);
+  rhoXSXstarfac.v = vec_and_mask(rhoXSXstarfac.v, star);
+  rhoXSXSstarmuX.v = vec_and_mask(rhoXSXSstarmuX.v, star);
+
+  f0.v = vec_add(f0.v, rhoXSXstarfac.v);
+  f1.v = vec_fma(rhoXSXstarfac.v, vxX.v,
+                 vec_fma(rhoXSXSstarmuX.v, nx.v, f1.v));
+  f2.v = vec_fma(rhoXSXstarfac.v, vyX.v,
+                 vec_fma(rhoXSXSstarmuX.v, ny.v, f2.v));
+  f3.v = vec_fma(rhoXSXstarfac.v, vzX.v,
+                 vec_fma(rhoXSXSstarmuX.v, nz.v, f3.v));
+  vector SXmuX_safe;
+  SXmuX_safe.v = vec_blend(non_vacuum, vec_set1(-1.f), SXmuX.v);
+  f4.v = vec_fma(
+      rhoXSXstarfac.v, eX.v,
+      vec_fma(rhoXSXSstarmuX.v,
+              vec_add(Sstar.v,
+                      vec_div(PX.v, vec_mul(rhoX.v, SXmuX_safe.v))),
+              f4.v));
+
+  /* deboost to lab frame */
+  const vector vijx = vector_load(&b->vij[0][k]);
+  const vector vijy = vector_load(&b->vij[1][k]);
+  const vector vijz = vector_load(&b->vij[2][k]);
+  vector vij2;
+  vij2.v = vec_fma(vijx.v, vijx.v,
+                   vec_fma(vijy.v, vijy.v, vec_mul(vijz.v, vijz.v)));
+  f4.v = vec_fma(
+      vijx.v, f1.v,
+      vec_fma(vijy.v, f2.v,
+              vec_fma(vijz.v, f3.v,
+                      vec_fma(vec_mul(vec_set1(0.5f), vij2.v), f0.v, f4.v))));
+  f1.v = vec_fma(vijx.v, f0.v, f1.v);
+  f2.v = vec_fma(vijy.v, f0.v, f2.v);
+  f3.v = vec_fma(vijz.v, f0.v, f3.v);
+
+  vec_store(f0.v, &b->flux[0][k]);
+  vec_store(f1.v, &b->flux[1][k]);
+  vec_store(f2.v, &b->flux[2][k]);
+  vec_store(f3.v, &b->flux[3][k]);
+  vec_store(f4.v, &b->flux[4][k]);
+
+  /* Redo the vacuum lanes with the scalar solver */
+  const int vacuum = ~vec_is_mask_true(non_vacuum) & ((1 << VEC_SIZE) - 1);
+  if (vacuum)
+    for (int i = 0; i < VEC_SIZE; i++)
+      if (vacuum & (1 << i)) riemann_batch_solve_one(b, k + i);
+}
+
+#endif /* WITH_VECTORIZATION */
+
+/**
+ * @brief Solves the Riemann problems of all the interfaces of a
+ * #riemann_batch and empties it.
+ *
+ * The fluxes are the ones riemann_solve_for_flux() would return, up to
+ * rounding, and are stored in b->flux.
+ *
+ * @param b The #riemann_batch.
+ */
+__attribute__((always_inline)) INLINE static void riemann_solve_batch_for_flux(
+    struct riemann_batch *b) {
+
+  const int count = b->count;
+  int k = 0;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  for (int i = 0; i < count; i++) {
+    const float WL[5] = {b->WL[0][i], b->WL[1][i], b->WL[2][i], b->WL[3][i],
+                         b->WL[4][i]};
+    const float WR[5] = {b->WR[0][i], b->WR[1][i], b->WR[2][i], b->WR[3][i],
+                         b->WR[4][i]};
+    const float n[3] = {b->n[0][i], b->n[1][i], b->n[2][i]};
+    const float vij[3] = {b->vij[0][i], b->vij[1][i], b->vij[2][i]};
+    riemann_check_input(WL, WR, n, vij);
+  }
+#endif
+
+#ifdef WITH_VECTORIZATION
+  for (; k + VEC_SIZE <= count; k += VEC_SIZE) riemann_batch_solve_vec(b, k);
+#endif
+
+  /* Remainder */
+  for (; k < count; k++) riemann_batch_solve_one(b, k);
+
+  b->count = 0;
+}
+
 #endif /* SWIFT_RIEMANN_HLLC_H */
@@ -60,6 +60,7 @@
 #include "logger.h"
 #include "memuse.h"
 #include "minmax.h"
+#include "proxy.h"
 #include "runner_doiact_vec.h"
 #include "scheduler.h"
 #include "sort_part.h"
@@ -142,6 +143,213 @@
 #undef FUNCTION_TASK_LOOP
 #undef FUNCTION
 
+/*! Ratio of the search radius of the ghost neighbour lists to the current
+ * smoothing length. Lists are re-built if h grows beyond it. */
+#define ghost_neighbour_list_h_ratio 1.25f
+
+/**
+ * @brief A candidate neighbour of a particle recorded by the ghost.
+ */
+struct ghost_neighbour {
+
+  /*! The neighbour */
+  struct part *pj;
+
+  /*! Its extended data (NULL in foreign cells) */
+  struct xpart *xpj;
+
+  /*! Separation vector pi - pj (or si - pj) */
+  float dx[3];
+
+  /*! Square of the separation */
+  float r2;
+};
+
+/**
+ * @brief The candidate neighbours of all the particles of a ghost leaf cell.
+ */
+struct ghost_neighbour_list {
+
+  /*! The candidates of all the particles, one after the other */
+  struct ghost_neighbour *neighbours;
+
+  /*! Number of candidates in use */
+  int count;
+
+  /*! Number of candidates allocated */
+  int size;
+};
+
+/**
+ * @brief Records the gas particles of a cell that lie within a given distance
+ * of a particle.
+ *
+ * The progeny that are entirely out of reach are skipped.
+ *
+ * @param e The #engine.
+ * @param xi The position of the particle we are collecting candidates for.
+ * @param cj The #cell to scan.
+ * @param is_self Is the particle a #part of @c cj (i.e. a self interaction)?
+ * @param r_max2 The square of the search radius.
+ * @param list The #ghost_neighbour_list to append to.
+ */
+static void runner_ghost_scan_cell(const struct engine *e, const double xi[3],
+                                   struct cell *cj, const int is_self,
+                                   const double r_max2,
+                                   struct ghost_neighbour_list *list) {
+
+  const int periodic = e->s->periodic;
+  const double *dim = e->s->dim;
+
+  if (cj->hydro.count == 0) return;
+
+  /* Distance between pi and the closest point of the cell */
+  double d2 = 0.;
+  for (int k = 0; k < 3; k++) {
+    double d = xi[k] - (cj->loc[k] + 0.5 * cj->width[k]);
+    if (periodic) d = nearest(d, dim[k]);
+    d = fabs(d) - 0.5 * cj->width[k];
+    if (d > 0.) d2 += d * d;
+  }
+  if (d2 >= r_max2) return;
+
+  /* Recurse? */
+  if (cj->split) {
+    for (int k = 0; k < 8; k++)
+      if (cj->progeny[k] != NULL)
+        runner_ghost_scan_cell(e, xi, cj->progeny[k], is_self, r_max2, list);
+    return;
+  }
+
+  struct part *restrict parts_j = cj->hydro.parts;
+  struct xpart *restrict xparts_j = cj->hydro.xparts;
+
+  for (int k = 0; k < cj->hydro.count; k++) {
+
+    struct part *pj = &parts_j[k];
+
+    /* Skip inhibited particles. */
+    if (part_is_inhibited(pj, e)) continue;
+
+    double dx[3] = {xi[0] - pj->x[0], xi[1] - pj->x[1], xi[2] - pj->x[2]};
+    if (periodic) {
+      dx[0] = nearest(dx[0], dim[0]);
+      dx[1] = nearest(dx[1], dim[1]);
+      dx[2] = nearest(dx[2], dim[2]);
+    }
+    const double r2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+
+    /* Too far (or the particle itself)? */
+    if (r2 >= r_max2 || (is_self && r2 == 0.)) continue;
+
+    /* Grow the list if needed */
+    if (list->count == list->size) {
+      list->size = max(2 * list->size, 1024);
+      list->neighbours = (struct ghost_neighbour *)realloc(
+          list->neighbours, list->size * sizeof(struct ghost_neighbour));
+      if (list->neighbours == NULL)
+        error("Can't allocate memory for the ghost neighbour list.");
+    }
+
+    struct ghost_neighbour *n = &list->neighbours[list->count++];
+    n->pj = pj;
+    n->xpj = (xparts_j != NULL) ? &xparts_j[k] : NULL;
+    n->dx[0] = dx[0];
+    n->dx[1] = dx[1];
+    n->dx[2] = dx[2];
+    n->r2 = r2;
+  }
+}
+
+/**
+ * @brief Records all the gas particles that could be neighbours of a #spart as
+ * long as its smoothing length does not exceed h_list.
+ *
+ * Same as runner_ghost_build_neighbour_list() but walking the stars density
+ * interactions.
+ *
+ * @param e The #engine.
+ * @param c The leaf #cell containing si.
+ * @param si The #spart.
+ * @param h_list The largest smoothing length the list must be valid for.
+ * @param list The #ghost_neighbour_list to append to.
+ */
+static void runner_stars_ghost_build_neighbour_list(
+    const struct engine *e, struct cell *c, const struct spart *si,
+    const float h_list, struct ghost_neighbour_list *list) {
+
+  const double r_max = kernel_gamma * h_list;
+  const double r_max2 = r_max * r_max;
+
+  /* Climb up the cell hierarchy. */
+  for (struct cell *finger = c; finger != NULL; finger = finger->parent) {
+
+    /* Run through this cell's stars density interactions. */
+    for (struct link *l = finger->stars.density; l != NULL; l = l->next) {
+
+      const enum task_types type = l->t->type;
+
+      if (type == task_type_self || type == task_type_sub_self)
+        runner_ghost_scan_cell(e, si->x, finger, /*is_self=*/0, r_max2, list);
+
+      else if (type == task_type_pair || type == task_type_sub_pair)
+        runner_ghost_scan_cell(e, si->x,
+                               (l->t->ci == finger) ? l->t->cj : l->t->ci,
+                               /*is_self=*/0, r_max2, list);
+    }
+  }
+}
+
+/**
+ * @brief Computes the density of a #spart from its recorded candidate
+ * neighbours.
+ *
+ * Same as runner_ghost_iact_neighbour_list() for the stars density loop.
+ *
+ * @param e The #engine.
+ * @param si The #spart.
+ * @param neighbours The candidates.
+ * @param count The number of candidates.
+ * @param r_keep The distance beyond which candidates can be dropped.
+ *
+ * @return The number of candidates left in the list.
+ */
+static int runner_stars_ghost_iact_neighbour_list(
+    const struct engine *e, struct spart *si,
+    struct ghost_neighbour *neighbours, const int count, const float r_keep) {
+
+  const struct cosmology *cosmo = e->cosmology;
+  const integertime_t ti_current = e->ti_current;
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+  const float hi = si->h;
+  const float hig2 = hi * hi * kernel_gamma2;
+  const float r_keep2 = r_keep * r_keep;
+
+  int kept = 0;
+  for (int k = 0; k < count; k++) {
+
+    const struct ghost_neighbour n = neighbours[k];
+
+    /* Still a candidate? */
+    if (n.r2 >= r_keep2) continue;
+    neighbours[kept++] = n;
+
+    /* Hit or miss? */
+    if (n.r2 < hig2) {
+
+      struct part *pj = n.pj;
+      const float hj = pj->h;
+
+      runner_iact_nonsym_stars_density(n.r2, n.dx, hi, hj, si, pj, a, H);
+      runner_iact_nonsym_feedback_density(n.r2, n.dx, hi, hj, si, pj, n.xpj,
+                                          cosmo, ti_current);
+    }
+  }
+
+  return kept;
+}
+
 /**
  * @brief Intermediate task after the density to check that the smoothing
  * lengths are correct.
@@ -164,6 +372,7 @@ void runner_do_stars_ghost(struct runner *r, struct cell *c, int timer) {
   const float stars_eta_dim =
       pow_dimension(e->stars_properties->eta_neighbours);
   const int max_smoothing_iter = e->stars_properties->max_smoothing_iterations;
+  const int use_neighbour_lists = e->stars_properties->ghost_neighbour_lists;
   int redo = 0, scount = 0;
 
   /* Running value of the maximal smoothing length */
@@ -197,6 +406,8 @@ void runner_do_stars_ghost(struct runner *r, struct cell *c, int timer) {
     float *h_0 = NULL;
     float *left = NULL;
     float *right = NULL;
+    float *f_left = NULL;
+    float *f_right = NULL;
     if ((sid = (int *)malloc(sizeof(int) * c->stars.count)) == NULL)
       error("Can't allocate memory for sid.");
     if ((h_0 = (float *)malloc(sizeof(float) * c->stars.count)) == NULL)
@@ -205,16 +416,39 @@ void runner_do_stars_ghost(struct runner *r, struct cell *c, int timer) {
       error("Can't allocate memory for left.");
     if ((right = (float *)malloc(sizeof(float) * c->stars.count)) == NULL)
       error("Can't allocate memory for right.");
+    if ((f_left = (float *)malloc(sizeof(float) * c->stars.count)) == NULL)
+      error("Can't allocate memory for f_left.");
+    if ((f_right = (float *)malloc(sizeof(float) * c->stars.count)) == NULL)
+      error("Can't allocate memory for f_right.");
     for (int k = 0; k < c->stars.count; k++)
       if (spart_is_active(&sparts[k], e) &&
-          feedback_is_active(&sparts[k], e->time, cosmo, with_cosmology)) {
+          feedback_is_active(&sparts[k], e->feedback_props, e->time, cosmo,
+                             with_cosmology)) {
         sid[scount] = k;
         h_0[scount] = sparts[k].h;
         left[scount] = 0.f;
         right[scount] = stars_h_max;
+        f_left[scount] = -stars_eta_dim;
+        f_right[scount] = 0.f;
         ++scount;
       }
 
+    /* Candidate neighbours of the particles, valid while their smoothing
+     * length stays below list_h. */
+    struct ghost_neighbour_list list = {NULL, 0, 0};
+    int *list_offset = NULL;
+    int *list_count = NULL;
+    float *list_h = NULL;
+    if (use_neighbour_lists) {
+      if ((list_offset = (int *)malloc(sizeof(int) * c->stars.count)) == NULL)
+        error("Can't allocate memory for list_offset.");
+      if ((list_count = (int *)malloc(sizeof(int) * c->stars.count)) == NULL)
+        error("Can't allocate memory for list_count.");
+      if ((list_h = (float *)malloc(sizeof(float) * c->stars.count)) == NULL)
+        error("Can't allocate memory for list_h.");
+      for (int i = 0; i < scount; i++) list_h[i] = 0.f;
+    }
+
     /* While there are particles that need to be updated... */
     for (int num_reruns = 0; scount > 0 && num_reruns < max_smoothing_iter;
          num_reruns++) {
@@ -264,11 +498,14 @@ void runner_do_stars_ghost(struct runner *r, struct cell *c, int timer) {
               sp->density.wcount_dh * h_old_dim +
               hydro_dimension * sp->density.wcount * h_old_dim_minus_one;
 
-          /* Improve the bisection bounds */
-          if (n_sum < n_target)
-            left[i] = max(left[i], h_old);
-          else if (n_sum > n_target)
-            right[i] = min(right[i], h_old);
+          /* Improve the bisection bounds, remembering the residuals there */
+          if (n_sum < n_target && h_old > left[i]) {
+            left[i] = h_old;
+            f_left[i] = f;
+          } else if (n_sum > n_target && h_old < right[i]) {
+            right[i] = h_old;
+            f_right[i] = f;
+          }
 
 #ifdef SWIFT_DEBUG_CHECKS
           /* Check the validity of the left and right bounds */
@@ -367,9 +604,18 @@ void runner_do_stars_ghost(struct runner *r, struct cell *c, int timer) {
           if ((h_new == left[i] && h_old == right[i]) ||
               (h_old == left[i] && h_new == right[i])) {
 
-            /* Bissect the remaining interval */
-            sp->h = pow_inv_dimension(
-                0.5f * (pow_dimension(left[i]) + pow_dimension(right[i])));
+            /* Secant step in volume between the two bounds if we know the
+             * residual at both ends, bisection otherwise. The secant point is
+             * kept away from the bounds so that the bracket keeps shrinking. */
+            float t = 0.5f;
+            if (f_right[i] > 0.f) {
+              t = -f_left[i] / (f_right[i] - f_left[i]);
+              t = max(t, 0.1f);
+              t = min(t, 0.9f);
+            }
+            sp->h = pow_inv_dimension(pow_dimension(left[i]) +
+                                      t * (pow_dimension(right[i]) -
+                                           pow_dimension(left[i])));
 
           } else {
 
@@ -385,6 +631,13 @@ void runner_do_stars_ghost(struct runner *r, struct cell *c, int timer) {
             h_0[redo] = h_0[i];
             left[redo] = left[i];
             right[redo] = right[i];
+            f_left[redo] = f_left[i];
+            f_right[redo] = f_right[i];
+            if (use_neighbour_lists) {
+              list_offset[redo] = list_offset[i];
+              list_count[redo] = list_count[i];
+              list_h[redo] = list_h[i];
+            }
             redo += 1;
 
             /* Re-initialise everything */
@@ -475,7 +728,39 @@ void runner_do_stars_ghost(struct runner *r, struct cell *c, int timer) {
 
       /* Re-set the counter for the next loop (potentially). */
       scount = redo;
-      if (scount > 0) {
+
+      TIMER_TIC2;
+
+      if (scount > 0 && use_neighbour_lists) {
+
+        /* Only revisit the recorded candidates, collecting new ones for the
+         * particles whose h grew beyond what their list covers. */
+        for (int i = 0; i < scount; i++) {
+
+          struct spart *sp = &sparts[sid[i]];
+
+          if (sp->h > list_h[i]) {
+
+            /* The list does not cover the kernel any more, start a new one */
+            const float h_cap = max(right[i], sp->h);
+            list_h[i] = min(ghost_neighbour_list_h_ratio * sp->h, h_cap);
+            list_offset[i] = list.count;
+            runner_stars_ghost_build_neighbour_list(e, c, sp, list_h[i],
+                                                    &list);
+            list_count[i] = list.count - list_offset[i];
+
+          } else {
+
+            /* Shrink the list along with h */
+            list_h[i] = min(list_h[i], ghost_neighbour_list_h_ratio * sp->h);
+          }
+
+          list_count[i] = runner_stars_ghost_iact_neighbour_list(
+              e, sp, &list.neighbours[list_offset[i]], list_count[i],
+              kernel_gamma * list_h[i]);
+        }
+
+      } else if (scount > 0) {
 
         /* Climb up the cell hierarchy. */
         for (struct cell *finger = c; finger != NULL; finger = finger->parent) {
@@ -524,6 +809,8 @@ void runner_do_stars_ghost(struct runner *r, struct cell *c, int timer) {
           }
         }
       }
+
+      if (scount > 0) TIMER_TOC2(timer_do_stars_ghost_redo);
     }
 
     if (scount) {
@@ -533,8 +820,14 @@ void runner_do_stars_ghost(struct runner *r, struct cell *c, int timer) {
     /* Be clean */
     free(left);
     free(right);
+    free(f_left);
+    free(f_right);
     free(sid);
     free(h_0);
+    free(list_offset);
+    free(list_count);
+    free(list_h);
+    free(list.neighbours);
   }
 
   /* Update h_max */
@@ -1010,6 +1303,18 @@ void runner_do_cooling(struct runner *r, struct cell *c, int timer) {
       if (c->progeny[k] != NULL) runner_do_cooling(r, c->progeny[k], 0);
   } else {
 
+#ifdef cooling_batch_size
+    /* Particles waiting to be cooled together */
+    struct part *batch_p[cooling_batch_size];
+    struct xpart *batch_xp[cooling_batch_size];
+    double batch_dt_cool[cooling_batch_size];
+    double batch_dt_therm[cooling_batch_size];
+    int batch_count = 0;
+#endif
+
+    /* Number of particles handed over to the cooling */
+    int cooled_count = 0;
+
     /* Loop over the parts in this cell. */
     for (int i = 0; i < count; i++) {
 
@@ -1019,6 +1324,8 @@ void runner_do_cooling(struct runner *r, struct cell *c, int timer) {
 
       if (part_is_active(p, e)) {
 
+        cooled_count++;
+
         double dt_cool, dt_therm;
         if (with_cosmology) {
           const integertime_t ti_step = get_integer_timestep(p->time_bin);
@@ -1035,17 +1342,93 @@ void runner_do_cooling(struct runner *r, struct cell *c, int timer) {
           dt_therm = get_timestep(p->time_bin, time_base);
         }
 
+#ifdef cooling_batch_size
+        /* Queue the particle and cool the batch once it is full */
+        batch_p[batch_count] = p;
+        batch_xp[batch_count] = xp;
+        batch_dt_cool[batch_count] = dt_cool;
+        batch_dt_therm[batch_count] = dt_therm;
+        if (++batch_count == cooling_batch_size) {
+          cooling_cool_part_batch(constants, us, cosmo, hydro_props,
+                                  entropy_floor_props, cooling_func, batch_p,
+                                  batch_xp, batch_dt_cool, batch_dt_therm,
+                                  batch_count);
+          batch_count = 0;
+        }
+#else
         /* Let's cool ! */
         cooling_cool_part(constants, us, cosmo, hydro_props,
                           entropy_floor_props, cooling_func, p, xp, dt_cool,
                           dt_therm);
+#endif
       }
     }
+
+#ifdef cooling_batch_size
+    /* Cool the particles left in the last batch */
+    if (batch_count > 0)
+      cooling_cool_part_batch(constants, us, cosmo, hydro_props,
+                              entropy_floor_props, cooling_func, batch_p,
+                              batch_xp, batch_dt_cool, batch_dt_therm,
+                              batch_count);
+#endif
+
+    COUNTER_ADD(counter_cooling_parts, cooled_count);
   }
 
   if (timer) TIMER_TOC(timer_do_cooling);
 }
 
+/* Number of gas particles of a leaf cell turned into stars at once. */
+#define runner_star_formation_batch_size 64
+
+/**
+ * @brief Turn a batch of gas particles of a leaf cell into stars.
+ *
+ * The slots of all the new stars are taken from the top-level cell at once.
+ * If it runs out of them, the particles left over stay gas until a rebuild
+ * has made room for them.
+ *
+ * @param r The #runner.
+ * @param c The leaf #cell.
+ * @param to_convert The indices of the #part to convert in the cell.
+ * @param nr_to_convert The number of #part to convert.
+ */
+static void runner_do_star_formation_convert(struct runner *r, struct cell *c,
+                                             const int *to_convert,
+                                             const int nr_to_convert) {
+
+  struct engine *e = r->e;
+  const struct cosmology *cosmo = e->cosmology;
+  const struct star_formation *sf_props = e->star_formation;
+  const struct phys_const *phys_const = e->physical_constants;
+  const int with_cosmology = (e->policy & engine_policy_cosmology);
+  const struct hydro_props *restrict hydro_props = e->hydro_properties;
+  const struct unit_system *restrict us = e->internal_units;
+  struct cooling_function_data *restrict cooling = e->cooling_func;
+
+  /* Get the new stars, the last ones of the cell. */
+  const int nr_added = cell_add_sparts(e, c, nr_to_convert);
+  struct spart *sparts = &c->stars.parts[c->stars.count - nr_added];
+
+  for (int k = 0; k < nr_added; k++) {
+    struct part *restrict p = &c->hydro.parts[to_convert[k]];
+    struct xpart *restrict xp = &c->hydro.xparts[to_convert[k]];
+    struct spart *sp = &sparts[k];
+
+    /* Convert the gas particle to a star particle */
+    cell_convert_part_to_added_spart(e, c, p, xp, sp);
+
+    /* Copy the properties of the gas particle to the star particle */
+    star_formation_copy_properties(p, xp, sp, e, sf_props, cosmo,
+                                   with_cosmology, phys_const, hydro_props, us,
+                                   cooling);
+
+    /* Update the Star formation history */
+    star_formation_logger_log_new_spart(sp, &c->stars.sfh, e->time_step);
+  }
+}
+
 /**
  *
  */
@@ -1099,6 +1482,10 @@ void runner_do_star_formation(struct runner *r, struct cell *c, int timer) {
       }
   } else {
 
+    /* The gas particles waiting to be turned into stars. */
+    int to_convert[runner_star_formation_batch_size];
+    int nr_to_convert = 0;
+
     /* Loop over the gas particles in this cell. */
     for (int k = 0; k < count; k++) {
 
@@ -1135,26 +1522,16 @@ void runner_do_star_formation(struct runner *r, struct cell *c, int timer) {
           /* Add the SFR and SFR*dt to the SFH struct of this cell */
           star_formation_logger_log_active_part(p, xp, &c->stars.sfh, dt_star);
 
-          /* Are we forming a star particle from this SF rate? */
+          /* Are we forming a star particle from this SF rate? Convert the
+           * gas particles in batches, taking the slots of all the new stars
+           * of a batch at once. */
           if (star_formation_should_convert_to_star(p, xp, sf_props, e,
                                                     dt_star)) {
-
-            /* Convert the gas particle to a star particle */
-            struct spart *sp = cell_convert_part_to_spart(e, c, p, xp);
-
-            /* Did we get a star? (Or did we run out of spare ones?) */
-            if (sp != NULL) {
-
-              /* message("We formed a star id=%lld cellID=%d", sp->id,
-               * c->cellID); */
-
-              /* Copy the properties of the gas particle to the star particle */
-              star_formation_copy_properties(p, xp, sp, e, sf_props, cosmo,
-                                             with_cosmology, phys_const,
-                                             hydro_props, us, cooling);
-
-              /* Update the Star formation history */
-              star_formation_logger_log_new_spart(sp, &c->stars.sfh,e->time_step);
+            to_convert[nr_to_convert++] = k;
+            if (nr_to_convert == runner_star_formation_batch_size) {
+              runner_do_star_formation_convert(r, c, to_convert,
+                                               nr_to_convert);
+              nr_to_convert = 0;
             }
           }
 
@@ -1174,6 +1551,10 @@ void runner_do_star_formation(struct runner *r, struct cell *c, int timer) {
         }
       }
     } /* Loop over particles */
+
+    /* Convert the last batch. */
+    if (nr_to_convert > 0)
+      runner_do_star_formation_convert(r, c, to_convert, nr_to_convert);
   }
 
   /* If we formed any stars, the star sorts are now invalid. We need to
@@ -1188,84 +1569,6 @@ void runner_do_star_formation(struct runner *r, struct cell *c, int timer) {
   if (timer) TIMER_TOC(timer_do_star_formation);
 }
 
-/**
- * @brief Sort the entries in ascending order using QuickSort.
- *
- * @param sort The entries
- * @param N The number of entries.
- */
-void runner_do_sort_ascending(struct entry *sort, int N) {
-
-  struct {
-    short int lo, hi;
-  } qstack[10];
-  int qpos, i, j, lo, hi, imin;
-  struct entry temp;
-  float pivot;
-
-  /* Sort parts in cell_i in decreasing order with quicksort */
-  qstack[0].lo = 0;
-  qstack[0].hi = N - 1;
-  qpos = 0;
-  while (qpos >= 0) {
-    lo = qstack[qpos].lo;
-    hi = qstack[qpos].hi;
-    qpos -= 1;
-    if (hi - lo < 15) {
-      for (i = lo; i < hi; i++) {
-        imin = i;
-        for (j = i + 1; j <= hi; j++)
-          if (sort[j].d < sort[imin].d) imin = j;
-        if (imin != i) {
-          temp = sort[imin];
-          sort[imin] = sort[i];
-          sort[i] = temp;
-        }
-      }
-    } else {
-      pivot = sort[(lo + hi) / 2].d;
-      i = lo;
-      j = hi;
-      while (i <= j) {
-        while (sort[i].d < pivot) i++;
-        while (sort[j].d > pivot) j--;
-        if (i <= j) {
-          if (i < j) {
-            temp = sort[i];
-            sort[i] = sort[j];
-            sort[j] = temp;
-          }
-          i += 1;
-          j -= 1;
-        }
-      }
-      if (j > (lo + hi) / 2) {
-        if (lo < j) {
-          qpos += 1;
-          qstack[qpos].lo = lo;
-          qstack[qpos].hi = j;
-        }
-        if (i < hi) {
-          qpos += 1;
-          qstack[qpos].lo = i;
-          qstack[qpos].hi = hi;
-        }
-      } else {
-        if (i < hi) {
-          qpos += 1;
-          qstack[qpos].lo = i;
-          qstack[qpos].hi = hi;
-        }
-        if (lo < j) {
-          qpos += 1;
-          qstack[qpos].lo = lo;
-          qstack[qpos].hi = j;
-        }
-      }
-    }
-  }
-}
-
 #ifdef SWIFT_DEBUG_CHECKS
 /**
  * @brief Recursively checks that the flags are consistent in a cell hierarchy.
@@ -1347,7 +1650,7 @@ void runner_do_hydro_sort(struct runner *r, struct cell *c, int flags,
 #endif
 
   /* Allocate memory for sorting. */
-  cell_malloc_hydro_sorts(c, flags);
+  cell_malloc_hydro_sorts(c, flags, &r->sort_arena);
 
   /* Does this cell have any progeny? */
   if (c->split) {
@@ -1482,14 +1785,21 @@ void runner_do_hydro_sort(struct runner *r, struct cell *c, int flags,
         }
     }
 
+    /* Scratch space for the radix sort, given back to the arena after use */
+    struct entry *sort_buff = NULL;
+    if (count >= sort_radix_threshold)
+      sort_buff = sort_arena_alloc(&r->sort_arena, count);
+
     /* Add the sentinel and sort. */
     for (int j = 0; j < 13; j++)
       if (flags & (1 << j)) {
         c->hydro.sort[j][count].d = FLT_MAX;
         c->hydro.sort[j][count].i = 0;
-        runner_do_sort_ascending(c->hydro.sort[j], count);
+        sort_entries_ascending(c->hydro.sort[j], sort_buff, count);
         atomic_or(&c->hydro.sorted, 1 << j);
       }
+
+    if (sort_buff != NULL) sort_arena_pop(&r->sort_arena, sort_buff, count);
   }
 
 #ifdef SWIFT_DEBUG_CHECKS
@@ -1580,7 +1890,7 @@ void runner_do_stars_sort(struct runner *r, struct cell *c, int flags,
 #endif
 
   /* start by allocating the entry arrays in the requested dimensions. */
-  cell_malloc_stars_sorts(c, flags);
+  cell_malloc_stars_sorts(c, flags, &r->sort_arena);
 
   /* Does this cell have any progeny? */
   if (c->split) {
@@ -1708,14 +2018,21 @@ void runner_do_stars_sort(struct runner *r, struct cell *c, int flags,
         }
     }
 
+    /* Scratch space for the radix sort, given back to the arena after use */
+    struct entry *sort_buff = NULL;
+    if (count >= sort_radix_threshold)
+      sort_buff = sort_arena_alloc(&r->sort_arena, count);
+
     /* Add the sentinel and sort. */
     for (int j = 0; j < 13; j++)
       if (flags & (1 << j)) {
         c->stars.sort[j][count].d = FLT_MAX;
         c->stars.sort[j][count].i = 0;
-        runner_do_sort_ascending(c->stars.sort[j], count);
+        sort_entries_ascending(c->stars.sort[j], sort_buff, count);
         atomic_or(&c->stars.sorted, 1 << j);
       }
+
+    if (sort_buff != NULL) sort_arena_pop(&r->sort_arena, sort_buff, count);
   }
 
 #ifdef SWIFT_DEBUG_CHECKS
@@ -1953,6 +2270,99 @@ void runner_do_extra_ghost(struct runner *r, struct cell *c, int timer) {
 #endif
 }
 
+/**
+ * @brief Records all the particles that could be neighbours of a #part as
+ * long as its smoothing length does not exceed h_list.
+ *
+ * We look at all the cells the density tasks of the leaf cell and of its
+ * parents interacted with, like the subset functions do.
+ *
+ * @param e The #engine.
+ * @param c The leaf #cell containing pi.
+ * @param pi The #part.
+ * @param h_list The largest smoothing length the list must be valid for.
+ * @param list The #ghost_neighbour_list to append to.
+ */
+static void runner_ghost_build_neighbour_list(
+    const struct engine *e, struct cell *c, const struct part *pi,
+    const float h_list, struct ghost_neighbour_list *list) {
+
+  const double r_max = kernel_gamma * h_list;
+  const double r_max2 = r_max * r_max;
+
+  /* Climb up the cell hierarchy. */
+  for (struct cell *finger = c; finger != NULL; finger = finger->parent) {
+
+    /* Run through this cell's density interactions. */
+    for (struct link *l = finger->hydro.density; l != NULL; l = l->next) {
+
+      const enum task_types type = l->t->type;
+
+      if (type == task_type_self || type == task_type_sub_self)
+        runner_ghost_scan_cell(e, pi->x, finger, /*is_self=*/1, r_max2, list);
+
+      else if (type == task_type_pair || type == task_type_sub_pair)
+        runner_ghost_scan_cell(e, pi->x,
+                               (l->t->ci == finger) ? l->t->cj : l->t->ci,
+                               /*is_self=*/0, r_max2, list);
+    }
+  }
+}
+
+/**
+ * @brief Computes the density of a #part from its recorded candidate
+ * neighbours.
+ *
+ * The candidates further away than r_keep are removed from the list on the
+ * way, so that the list follows the particle's smoothing length when it
+ * decreases.
+ *
+ * @param e The #engine.
+ * @param pi The #part.
+ * @param xpi The #xpart of pi.
+ * @param neighbours The candidates.
+ * @param count The number of candidates.
+ * @param r_keep The distance beyond which candidates can be dropped.
+ *
+ * @return The number of candidates left in the list.
+ */
+static int runner_ghost_iact_neighbour_list(const struct engine *e,
+                                            struct part *pi, struct xpart *xpi,
+                                            struct ghost_neighbour *neighbours,
+                                            const int count,
+                                            const float r_keep) {
+
+  const float a = e->cosmology->a;
+  const float H = e->cosmology->H;
+  const float hi = pi->h;
+  const float hig2 = hi * hi * kernel_gamma2;
+  const float r_keep2 = r_keep * r_keep;
+
+  int kept = 0;
+  for (int k = 0; k < count; k++) {
+
+    const struct ghost_neighbour n = neighbours[k];
+
+    /* Still a candidate? */
+    if (n.r2 >= r_keep2) continue;
+    neighbours[kept++] = n;
+
+    /* Hit or miss? */
+    if (n.r2 < hig2) {
+
+      struct part *pj = n.pj;
+      const float hj = pj->h;
+
+      runner_iact_nonsym_density(n.r2, n.dx, hi, hj, pi, pj, a, H);
+      runner_iact_nonsym_chemistry(n.r2, n.dx, hi, hj, pi, pj, a, H);
+      runner_iact_nonsym_star_formation(n.r2, n.dx, hi, hj, pi, pj, xpi,
+                                        n.xpj, a, H);
+    }
+  }
+
+  return kept;
+}
+
 /**
  * @brief Intermediate task after the density to check that the smoothing
  * lengths are correct.
@@ -1980,6 +2390,7 @@ void runner_do_ghost(struct runner *r, struct cell *c, int timer) {
   const float hydro_eta_dim =
       pow_dimension(e->hydro_properties->eta_neighbours);
   const int max_smoothing_iter = e->hydro_properties->max_smoothing_iterations;
+  const int use_neighbour_lists = e->hydro_properties->ghost_neighbour_lists;
   int redo = 0, count = 0;
 
   /* Running value of the maximal smoothing length */
@@ -2026,6 +2437,22 @@ void runner_do_ghost(struct runner *r, struct cell *c, int timer) {
         ++count;
       }
 
+    /* Candidate neighbours of the particles, valid while their smoothing
+     * length stays below list_h. */
+    struct ghost_neighbour_list list = {NULL, 0, 0};
+    int *list_offset = NULL;
+    int *list_count = NULL;
+    float *list_h = NULL;
+    if (use_neighbour_lists) {
+      if ((list_offset = (int *)malloc(sizeof(int) * c->hydro.count)) == NULL)
+        error("Can't allocate memory for list_offset.");
+      if ((list_count = (int *)malloc(sizeof(int) * c->hydro.count)) == NULL)
+        error("Can't allocate memory for list_count.");
+      if ((list_h = (float *)malloc(sizeof(float) * c->hydro.count)) == NULL)
+        error("Can't allocate memory for list_h.");
+      for (int i = 0; i < count; i++) list_h[i] = 0.f;
+    }
+
     /* While there are particles that need to be updated... */
     for (int num_reruns = 0; count > 0 && num_reruns < max_smoothing_iter;
          num_reruns++) {
@@ -2114,6 +2541,13 @@ void runner_do_ghost(struct runner *r, struct cell *c, int timer) {
             hydro_reset_gradient(p);
 
 #else
+#ifdef HYDRO_FUSED_GRADIENT_LOOP
+            /* The density loop collected the gradient quantities: finish
+             * them as the extra ghost would */
+            hydro_prepare_gradient(p, xp, cosmo);
+            hydro_end_gradient(p);
+#endif
+
             const struct hydro_props *hydro_props = e->hydro_properties;
 
             /* Calculate the time-step for passing to hydro_prepare_force, used
@@ -2209,6 +2643,11 @@ void runner_do_ghost(struct runner *r, struct cell *c, int timer) {
             h_0[redo] = h_0[i];
             left[redo] = left[i];
             right[redo] = right[i];
+            if (use_neighbour_lists) {
+              list_offset[redo] = list_offset[i];
+              list_count[redo] = list_count[i];
+              list_h[redo] = list_h[i];
+            }
             redo += 1;
 
             /* Re-initialise everything */
@@ -2267,6 +2706,13 @@ void runner_do_ghost(struct runner *r, struct cell *c, int timer) {
         hydro_reset_gradient(p);
 
 #else
+#ifdef HYDRO_FUSED_GRADIENT_LOOP
+        /* The density loop collected the gradient quantities: finish them as
+         * the extra ghost would */
+        hydro_prepare_gradient(p, xp, cosmo);
+        hydro_end_gradient(p);
+#endif
+
         const struct hydro_props *hydro_props = e->hydro_properties;
 
         /* Calculate the time-step for passing to hydro_prepare_force, used for
@@ -2306,7 +2752,36 @@ void runner_do_ghost(struct runner *r, struct cell *c, int timer) {
 
       /* Re-set the counter for the next loop (potentially). */
       count = redo;
-      if (count > 0) {
+      if (count > 0 && use_neighbour_lists) {
+
+        /* Only revisit the recorded candidates, collecting new ones for the
+         * particles whose h grew beyond what their list covers. */
+        for (int i = 0; i < count; i++) {
+
+          struct part *p = &parts[pid[i]];
+          struct xpart *xp = &xparts[pid[i]];
+
+          if (p->h > list_h[i]) {
+
+            /* The list does not cover the kernel any more, start a new one */
+            const float h_cap = max(right[i], p->h);
+            list_h[i] = min(ghost_neighbour_list_h_ratio * p->h, h_cap);
+            list_offset[i] = list.count;
+            runner_ghost_build_neighbour_list(e, c, p, list_h[i], &list);
+            list_count[i] = list.count - list_offset[i];
+
+          } else {
+
+            /* Shrink the list along with h */
+            list_h[i] = min(list_h[i], ghost_neighbour_list_h_ratio * p->h);
+          }
+
+          list_count[i] = runner_ghost_iact_neighbour_list(
+              e, p, xp, &list.neighbours[list_offset[i]], list_count[i],
+              kernel_gamma * list_h[i]);
+        }
+
+      } else if (count > 0) {
 
         /* Climb up the cell hierarchy. */
         for (struct cell *finger = c; finger != NULL; finger = finger->parent) {
@@ -2365,6 +2840,10 @@ void runner_do_ghost(struct runner *r, struct cell *c, int timer) {
     free(right);
     free(pid);
     free(h_0);
+    free(list_offset);
+    free(list_count);
+    free(list_h);
+    free(list.neighbours);
   }
 
   /* Update h_max */
@@ -2609,145 +3088,250 @@ void runner_do_drift_bpart(struct runner *r, struct cell *c, int timer) {
 }
 
 /**
- * @brief Perform the first half-kick on all the active particles in a cell.
+ * @brief Perform the first half-kick of a #part that starts its time-step.
  *
- * @param r The runner thread.
- * @param c The cell.
- * @param timer Are we timing this ?
+ * @param e The #engine.
+ * @param p The #part.
+ * @param xp The #xpart of the particle.
  */
-void runner_do_kick1(struct runner *r, struct cell *c, int timer) {
+__attribute__((always_inline)) INLINE static void runner_kick1_part(
+    const struct engine *e, struct part *restrict p, struct xpart *restrict xp,
+    const int with_cosmology) {
 
-  const struct engine *e = r->e;
   const struct cosmology *cosmo = e->cosmology;
-  const struct hydro_props *hydro_props = e->hydro_properties;
-  const struct entropy_floor_properties *entropy_floor = e->entropy_floor;
-  const int with_cosmology = (e->policy & engine_policy_cosmology);
-  struct part *restrict parts = c->hydro.parts;
-  struct xpart *restrict xparts = c->hydro.xparts;
-  struct gpart *restrict gparts = c->grav.parts;
-  struct spart *restrict sparts = c->stars.parts;
-  const int count = c->hydro.count;
-  const int gcount = c->grav.count;
-  const int scount = c->stars.count;
   const integertime_t ti_current = e->ti_current;
   const double time_base = e->time_base;
 
-  TIMER_TIC;
+  const integertime_t ti_step = get_integer_timestep(p->time_bin);
+  const integertime_t ti_begin =
+      get_integer_time_begin(ti_current + 1, p->time_bin);
 
-  /* Anything to do here? */
-  if (!cell_is_starting_hydro(c, e) && !cell_is_starting_gravity(c, e) &&
-      !cell_is_starting_stars(c, e) && !cell_is_starting_black_holes(c, e))
-    return;
+#ifdef SWIFT_DEBUG_CHECKS
+  const integertime_t ti_end = ti_begin + ti_step;
 
-  /* Recurse? */
-  if (c->split) {
-    for (int k = 0; k < 8; k++)
-      if (c->progeny[k] != NULL) runner_do_kick1(r, c->progeny[k], 0);
+  if (ti_begin != ti_current)
+    error(
+        "Particle in wrong time-bin, ti_end=%lld, ti_begin=%lld, "
+        "ti_step=%lld time_bin=%d wakeup=%d ti_current=%lld",
+        ti_end, ti_begin, ti_step, p->time_bin, p->wakeup, ti_current);
+#endif
+
+  /* Time interval for this half-kick */
+  double dt_kick_grav, dt_kick_hydro, dt_kick_therm, dt_kick_corr;
+  if (with_cosmology) {
+    dt_kick_hydro = cosmology_get_hydro_kick_factor(cosmo, ti_begin,
+                                                    ti_begin + ti_step / 2);
+    dt_kick_grav = cosmology_get_grav_kick_factor(cosmo, ti_begin,
+                                                  ti_begin + ti_step / 2);
+    dt_kick_therm = cosmology_get_therm_kick_factor(cosmo, ti_begin,
+                                                    ti_begin + ti_step / 2);
+    dt_kick_corr = cosmology_get_corr_kick_factor(cosmo, ti_begin,
+                                                  ti_begin + ti_step / 2);
   } else {
+    dt_kick_hydro = (ti_step / 2) * time_base;
+    dt_kick_grav = (ti_step / 2) * time_base;
+    dt_kick_therm = (ti_step / 2) * time_base;
+    dt_kick_corr = (ti_step / 2) * time_base;
+  }
 
-    /* Loop over the parts in this cell. */
-    for (int k = 0; k < count; k++) {
+  /* do the kick */
+  kick_part(p, xp, dt_kick_hydro, dt_kick_grav, dt_kick_therm, dt_kick_corr,
+            cosmo, e->hydro_properties, e->entropy_floor, ti_begin,
+            ti_begin + ti_step / 2);
 
-      /* Get a handle on the part. */
-      struct part *restrict p = &parts[k];
-      struct xpart *restrict xp = &xparts[k];
+  /* Update the accelerations to be used in the drift for hydro */
+  if (p->gpart != NULL) {
 
-      /* If particle needs to be kicked */
-      if (part_is_starting(p, e)) {
+    xp->a_grav[0] = p->gpart->a_grav[0];
+    xp->a_grav[1] = p->gpart->a_grav[1];
+    xp->a_grav[2] = p->gpart->a_grav[2];
+  }
+}
 
-#ifdef SWIFT_DEBUG_CHECKS
-        if (p->wakeup == time_bin_awake)
-          error("Woken-up particle that has not been processed in kick1");
-#endif
+/**
+ * @brief Perform the first half-kick of a #gpart that starts its time-step.
+ *
+ * @param e The #engine.
+ * @param gp The #gpart.
+ */
+__attribute__((always_inline)) INLINE static void runner_kick1_gpart(
+    const struct engine *e, struct gpart *restrict gp,
+    const int with_cosmology) {
 
-        /* Skip particles that have been woken up and treated by the limiter. */
-        if (p->wakeup != time_bin_not_awake) continue;
+  const integertime_t ti_current = e->ti_current;
+  const integertime_t ti_step = get_integer_timestep(gp->time_bin);
+  const integertime_t ti_begin =
+      get_integer_time_begin(ti_current + 1, gp->time_bin);
 
-        const integertime_t ti_step = get_integer_timestep(p->time_bin);
-        const integertime_t ti_begin =
-            get_integer_time_begin(ti_current + 1, p->time_bin);
+#ifdef SWIFT_DEBUG_CHECKS
+  const integertime_t ti_end =
+      get_integer_time_end(ti_current + 1, gp->time_bin);
+
+  if (ti_begin != ti_current)
+    error(
+        "Particle in wrong time-bin, ti_end=%lld, ti_begin=%lld, "
+        "ti_step=%lld time_bin=%d ti_current=%lld",
+        ti_end, ti_begin, ti_step, gp->time_bin, ti_current);
+#endif
+
+  /* Time interval for this half-kick */
+  double dt_kick_grav;
+  if (with_cosmology) {
+    dt_kick_grav = cosmology_get_grav_kick_factor(e->cosmology, ti_begin,
+                                                  ti_begin + ti_step / 2);
+  } else {
+    dt_kick_grav = (ti_step / 2) * e->time_base;
+  }
+
+  /* do the kick */
+  kick_gpart(gp, dt_kick_grav, ti_begin, ti_begin + ti_step / 2);
+}
+
+/**
+ * @brief Perform the first half-kick of a #spart that starts its time-step.
+ *
+ * @param e The #engine.
+ * @param sp The #spart.
+ */
+__attribute__((always_inline)) INLINE static void runner_kick1_spart(
+    const struct engine *e, struct spart *restrict sp,
+    const int with_cosmology) {
+
+  const integertime_t ti_current = e->ti_current;
+  const integertime_t ti_step = get_integer_timestep(sp->time_bin);
+  const integertime_t ti_begin =
+      get_integer_time_begin(ti_current + 1, sp->time_bin);
 
 #ifdef SWIFT_DEBUG_CHECKS
-        const integertime_t ti_end = ti_begin + ti_step;
+  const integertime_t ti_end =
+      get_integer_time_end(ti_current + 1, sp->time_bin);
 
-        if (ti_begin != ti_current)
-          error(
-              "Particle in wrong time-bin, ti_end=%lld, ti_begin=%lld, "
-              "ti_step=%lld time_bin=%d wakeup=%d ti_current=%lld",
-              ti_end, ti_begin, ti_step, p->time_bin, p->wakeup, ti_current);
+  if (ti_begin != ti_current)
+    error(
+        "Particle in wrong time-bin, ti_end=%lld, ti_begin=%lld, "
+        "ti_step=%lld time_bin=%d ti_current=%lld",
+        ti_end, ti_begin, ti_step, sp->time_bin, ti_current);
 #endif
 
-        /* Time interval for this half-kick */
-        double dt_kick_grav, dt_kick_hydro, dt_kick_therm, dt_kick_corr;
-        if (with_cosmology) {
-          dt_kick_hydro = cosmology_get_hydro_kick_factor(
-              cosmo, ti_begin, ti_begin + ti_step / 2);
-          dt_kick_grav = cosmology_get_grav_kick_factor(cosmo, ti_begin,
-                                                        ti_begin + ti_step / 2);
-          dt_kick_therm = cosmology_get_therm_kick_factor(
-              cosmo, ti_begin, ti_begin + ti_step / 2);
-          dt_kick_corr = cosmology_get_corr_kick_factor(cosmo, ti_begin,
-                                                        ti_begin + ti_step / 2);
-        } else {
-          dt_kick_hydro = (ti_step / 2) * time_base;
-          dt_kick_grav = (ti_step / 2) * time_base;
-          dt_kick_therm = (ti_step / 2) * time_base;
-          dt_kick_corr = (ti_step / 2) * time_base;
-        }
+  /* Time interval for this half-kick */
+  double dt_kick_grav;
+  if (with_cosmology) {
+    dt_kick_grav = cosmology_get_grav_kick_factor(e->cosmology, ti_begin,
+                                                  ti_begin + ti_step / 2);
+  } else {
+    dt_kick_grav = (ti_step / 2) * e->time_base;
+  }
 
-        /* do the kick */
-        kick_part(p, xp, dt_kick_hydro, dt_kick_grav, dt_kick_therm,
-                  dt_kick_corr, cosmo, hydro_props, entropy_floor, ti_begin,
-                  ti_begin + ti_step / 2);
+  /* do the kick */
+  kick_spart(sp, dt_kick_grav, ti_begin, ti_begin + ti_step / 2);
+}
 
-        /* Update the accelerations to be used in the drift for hydro */
-        if (p->gpart != NULL) {
+/**
+ * @brief Generates the variants of a kick or time-step kernel, one for each
+ * combination of the policies in #runner_variant, and the table of them.
+ *
+ * The kernel FUNC##_body() takes the policies as its last three arguments.
+ * As it is always inlined, each variant is compiled with its policies as
+ * constants, which removes their tests from the loops over the particles.
+ */
+#define RUNNER_VARIANT(FUNC, V)                                            \
+  static void FUNC##_##V(struct runner *r, struct cell *c, int timer) {    \
+    FUNC##_body(r, c, timer, ((V)&runner_variant_cosmology) != 0,          \
+                ((V)&runner_variant_cooling) != 0,                         \
+                ((V)&runner_variant_limiter) != 0);                        \
+  }
+#define RUNNER_VARIANTS(FUNC)                                              \
+  RUNNER_VARIANT(FUNC, 0)                                                  \
+  RUNNER_VARIANT(FUNC, 1)                                                  \
+  RUNNER_VARIANT(FUNC, 2)                                                  \
+  RUNNER_VARIANT(FUNC, 3)                                                  \
+  RUNNER_VARIANT(FUNC, 4)                                                  \
+  RUNNER_VARIANT(FUNC, 5)                                                  \
+  RUNNER_VARIANT(FUNC, 6)                                                  \
+  RUNNER_VARIANT(FUNC, 7)                                                  \
+  static void (*const FUNC##_variants[runner_variant_count])(              \
+      struct runner *, struct cell *, int) = {                             \
+      FUNC##_0, FUNC##_1, FUNC##_2, FUNC##_3,                              \
+      FUNC##_4, FUNC##_5, FUNC##_6, FUNC##_7};
 
-          xp->a_grav[0] = p->gpart->a_grav[0];
-          xp->a_grav[1] = p->gpart->a_grav[1];
-          xp->a_grav[2] = p->gpart->a_grav[2];
-        }
-      }
-    }
+/**
+ * @brief Perform the first half-kick on all the active particles in a cell.
+ *
+ * Compiled once for each #runner_variant, see runner_do_kick1().
+ *
+ * @param r The runner thread.
+ * @param c The cell.
+ * @param timer Are we timing this ?
+ * @param with_cosmology Are we running with cosmology?
+ * @param with_cooling Are we running with cooling? (unused)
+ * @param with_limiter Are we running with the time-step limiter?
+ */
+__attribute__((always_inline)) INLINE static void runner_do_kick1_body(
+    struct runner *r, struct cell *c, int timer, const int with_cosmology,
+    const int with_cooling, const int with_limiter) {
 
-    /* Loop over the gparts in this cell. */
-    for (int k = 0; k < gcount; k++) {
+  const struct engine *e = r->e;
+  struct part *restrict parts = c->hydro.parts;
+  struct xpart *restrict xparts = c->hydro.xparts;
+  struct gpart *restrict gparts = c->grav.parts;
+  struct spart *restrict sparts = c->stars.parts;
+  const int count = c->hydro.count;
+  const int gcount = c->grav.count;
+  const int scount = c->stars.count;
 
-      /* Get a handle on the part. */
-      struct gpart *restrict gp = &gparts[k];
+  TIMER_TIC;
 
-      /* If the g-particle has no counterpart and needs to be kicked */
-      if (gp->type == swift_type_dark_matter && gpart_is_starting(gp, e)) {
+  /* Anything to do here? */
+  if (!cell_is_starting_hydro(c, e) && !cell_is_starting_gravity(c, e) &&
+      !cell_is_starting_stars(c, e) && !cell_is_starting_black_holes(c, e))
+    return;
+
+  /* Recurse? */
+  if (c->split) {
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL) runner_do_kick1(r, c->progeny[k], 0);
+  } else {
 
-        const integertime_t ti_step = get_integer_timestep(gp->time_bin);
-        const integertime_t ti_begin =
-            get_integer_time_begin(ti_current + 1, gp->time_bin);
+    /* Only loop over the parts in the active time-bins if we can. */
+    const int *bins_ind = NULL;
+    const int nr_bins = cell_get_hydro_bins(c, e->max_active_bin, &bins_ind);
+    const int nr_loop = (nr_bins >= 0) ? nr_bins : count;
 
-#ifdef SWIFT_DEBUG_CHECKS
-        const integertime_t ti_end =
-            get_integer_time_end(ti_current + 1, gp->time_bin);
+    /* Loop over the parts in this cell. */
+    for (int n = 0; n < nr_loop; n++) {
+
+      const int k = (nr_bins >= 0) ? cell_hydro_bins_index(bins_ind[n]) : n;
+
+      /* Get a handle on the part. */
+      struct part *restrict p = &parts[k];
+      struct xpart *restrict xp = &xparts[k];
+
+      /* If particle needs to be kicked */
+      if (part_is_starting(p, e)) {
 
-        if (ti_begin != ti_current)
-          error(
-              "Particle in wrong time-bin, ti_end=%lld, ti_begin=%lld, "
-              "ti_step=%lld time_bin=%d ti_current=%lld",
-              ti_end, ti_begin, ti_step, gp->time_bin, ti_current);
+#ifdef SWIFT_DEBUG_CHECKS
+        if (p->wakeup == time_bin_awake)
+          error("Woken-up particle that has not been processed in kick1");
 #endif
 
-        /* Time interval for this half-kick */
-        double dt_kick_grav;
-        if (with_cosmology) {
-          dt_kick_grav = cosmology_get_grav_kick_factor(cosmo, ti_begin,
-                                                        ti_begin + ti_step / 2);
-        } else {
-          dt_kick_grav = (ti_step / 2) * time_base;
-        }
+        /* Skip particles that have been woken up and treated by the limiter. */
+        if (with_limiter && p->wakeup != time_bin_not_awake) continue;
 
-        /* do the kick */
-        kick_gpart(gp, dt_kick_grav, ti_begin, ti_begin + ti_step / 2);
+        runner_kick1_part(e, p, xp, with_cosmology);
       }
     }
 
+    /* Loop over the gparts in this cell. */
+    for (int k = 0; k < gcount; k++) {
+
+      /* Get a handle on the part. */
+      struct gpart *restrict gp = &gparts[k];
+
+      /* If the g-particle has no counterpart and needs to be kicked */
+      if (gp->type == swift_type_dark_matter && gpart_is_starting(gp, e))
+        runner_kick1_gpart(e, gp, with_cosmology);
+    }
+
     /* Loop over the stars particles in this cell. */
     for (int k = 0; k < scount; k++) {
 
@@ -2755,57 +3339,211 @@ void runner_do_kick1(struct runner *r, struct cell *c, int timer) {
       struct spart *restrict sp = &sparts[k];
 
       /* If particle needs to be kicked */
-      if (spart_is_starting(sp, e)) {
+      if (spart_is_starting(sp, e)) runner_kick1_spart(e, sp, with_cosmology);
+    }
+  }
+
+  if (timer) TIMER_TOC(timer_kick1);
+}
+
+RUNNER_VARIANTS(runner_do_kick1)
+
+/**
+ * @brief Perform the first half-kick on all the active particles in a cell.
+ *
+ * Calls the variant of the kernel compiled for the #engine's policies.
+ *
+ * @param r The runner thread.
+ * @param c The cell.
+ * @param timer Are we timing this ?
+ */
+void runner_do_kick1(struct runner *r, struct cell *c, int timer) {
+  runner_do_kick1_variants[r->e->runner_variant](r, c, timer);
+}
 
-        const integertime_t ti_step = get_integer_timestep(sp->time_bin);
-        const integertime_t ti_begin =
-            get_integer_time_begin(ti_current + 1, sp->time_bin);
+/**
+ * @brief Perform the second half-kick of a #part that ends its time-step.
+ *
+ * Also prepares the particle to be drifted.
+ *
+ * @param e The #engine.
+ * @param p The #part.
+ * @param xp The #xpart of the particle.
+ */
+__attribute__((always_inline)) INLINE static void runner_kick2_part(
+    const struct engine *e, struct part *restrict p, struct xpart *restrict xp,
+    const int with_cosmology, const int with_limiter) {
+
+  const struct cosmology *cosmo = e->cosmology;
+  const integertime_t ti_current = e->ti_current;
+  const double time_base = e->time_base;
+
+  integertime_t ti_begin, ti_end, ti_step;
 
 #ifdef SWIFT_DEBUG_CHECKS
-        const integertime_t ti_end =
-            get_integer_time_end(ti_current + 1, sp->time_bin);
+  if (p->wakeup == time_bin_awake)
+    error("Woken-up particle that has not been processed in kick1");
+#endif
+
+  if (!with_limiter || p->wakeup == time_bin_not_awake) {
+
+    /* Time-step from a regular kick */
+    ti_step = get_integer_timestep(p->time_bin);
+    ti_begin = get_integer_time_begin(ti_current, p->time_bin);
+    ti_end = ti_begin + ti_step;
+
+  } else {
 
-        if (ti_begin != ti_current)
-          error(
-              "Particle in wrong time-bin, ti_end=%lld, ti_begin=%lld, "
-              "ti_step=%lld time_bin=%d ti_current=%lld",
-              ti_end, ti_begin, ti_step, sp->time_bin, ti_current);
+    /* Time-step that follows a wake-up call */
+    ti_begin = get_integer_time_begin(ti_current, p->wakeup);
+    ti_end = get_integer_time_end(ti_current, p->time_bin);
+    ti_step = ti_end - ti_begin;
+
+    /* Reset the flag. Everything is back to normal from now on. */
+    p->wakeup = time_bin_awake;
+  }
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (ti_begin + ti_step != ti_current)
+    error(
+        "Particle in wrong time-bin, ti_begin=%lld, ti_step=%lld "
+        "time_bin=%d wakeup=%d ti_current=%lld",
+        ti_begin, ti_step, p->time_bin, p->wakeup, ti_current);
 #endif
+  /* Time interval for this half-kick */
+  double dt_kick_grav, dt_kick_hydro, dt_kick_therm, dt_kick_corr;
+  if (with_cosmology) {
+    dt_kick_hydro = cosmology_get_hydro_kick_factor(
+        cosmo, ti_begin + ti_step / 2, ti_end);
+    dt_kick_grav = cosmology_get_grav_kick_factor(
+        cosmo, ti_begin + ti_step / 2, ti_end);
+    dt_kick_therm = cosmology_get_therm_kick_factor(
+        cosmo, ti_begin + ti_step / 2, ti_end);
+    dt_kick_corr = cosmology_get_corr_kick_factor(
+        cosmo, ti_begin + ti_step / 2, ti_end);
+  } else {
+    dt_kick_hydro = (ti_end - (ti_begin + ti_step / 2)) * time_base;
+    dt_kick_grav = (ti_end - (ti_begin + ti_step / 2)) * time_base;
+    dt_kick_therm = (ti_end - (ti_begin + ti_step / 2)) * time_base;
+    dt_kick_corr = (ti_end - (ti_begin + ti_step / 2)) * time_base;
+  }
 
-        /* Time interval for this half-kick */
-        double dt_kick_grav;
-        if (with_cosmology) {
-          dt_kick_grav = cosmology_get_grav_kick_factor(cosmo, ti_begin,
-                                                        ti_begin + ti_step / 2);
-        } else {
-          dt_kick_grav = (ti_step / 2) * time_base;
-        }
+  /* Finish the time-step with a second half-kick */
+  kick_part(p, xp, dt_kick_hydro, dt_kick_grav, dt_kick_therm, dt_kick_corr,
+            cosmo, e->hydro_properties, e->entropy_floor,
+            ti_begin + ti_step / 2, ti_end);
 
-        /* do the kick */
-        kick_spart(sp, dt_kick_grav, ti_begin, ti_begin + ti_step / 2);
-      }
-    }
+#ifdef SWIFT_DEBUG_CHECKS
+  /* Check that kick and the drift are synchronized */
+  if (p->ti_drift != p->ti_kick) error("Error integrating part in time.");
+#endif
+
+  /* Prepare the values to be drifted */
+  hydro_reset_predicted_values(p, xp);
+}
+
+/**
+ * @brief Perform the second half-kick of a #gpart that ends its time-step.
+ *
+ * Also prepares the particle to be drifted.
+ *
+ * @param e The #engine.
+ * @param gp The #gpart.
+ */
+__attribute__((always_inline)) INLINE static void runner_kick2_gpart(
+    const struct engine *e, struct gpart *restrict gp,
+    const int with_cosmology) {
+
+  const integertime_t ti_step = get_integer_timestep(gp->time_bin);
+  const integertime_t ti_begin =
+      get_integer_time_begin(e->ti_current, gp->time_bin);
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (ti_begin + ti_step != e->ti_current)
+    error("Particle in wrong time-bin");
+#endif
+
+  /* Time interval for this half-kick */
+  double dt_kick_grav;
+  if (with_cosmology) {
+    dt_kick_grav = cosmology_get_grav_kick_factor(
+        e->cosmology, ti_begin + ti_step / 2, ti_begin + ti_step);
+  } else {
+    dt_kick_grav = (ti_step / 2) * e->time_base;
   }
 
-  if (timer) TIMER_TOC(timer_kick1);
+  /* Finish the time-step with a second half-kick */
+  kick_gpart(gp, dt_kick_grav, ti_begin + ti_step / 2, ti_begin + ti_step);
+
+#ifdef SWIFT_DEBUG_CHECKS
+  /* Check that kick and the drift are synchronized */
+  if (gp->ti_drift != gp->ti_kick) error("Error integrating g-part in time.");
+#endif
+
+  /* Prepare the values to be drifted */
+  gravity_reset_predicted_values(gp);
+}
+
+/**
+ * @brief Perform the second half-kick of a #spart that ends its time-step.
+ *
+ * Also prepares the particle to be drifted.
+ *
+ * @param e The #engine.
+ * @param sp The #spart.
+ */
+__attribute__((always_inline)) INLINE static void runner_kick2_spart(
+    const struct engine *e, struct spart *restrict sp,
+    const int with_cosmology) {
+
+  const integertime_t ti_step = get_integer_timestep(sp->time_bin);
+  const integertime_t ti_begin =
+      get_integer_time_begin(e->ti_current, sp->time_bin);
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (ti_begin + ti_step != e->ti_current)
+    error("Particle in wrong time-bin");
+#endif
+
+  /* Time interval for this half-kick */
+  double dt_kick_grav;
+  if (with_cosmology) {
+    dt_kick_grav = cosmology_get_grav_kick_factor(
+        e->cosmology, ti_begin + ti_step / 2, ti_begin + ti_step);
+  } else {
+    dt_kick_grav = (ti_step / 2) * e->time_base;
+  }
+
+  /* Finish the time-step with a second half-kick */
+  kick_spart(sp, dt_kick_grav, ti_begin + ti_step / 2, ti_begin + ti_step);
+
+#ifdef SWIFT_DEBUG_CHECKS
+  /* Check that kick and the drift are synchronized */
+  if (sp->ti_drift != sp->ti_kick) error("Error integrating s-part in time.");
+#endif
+
+  /* Prepare the values to be drifted */
+  stars_reset_predicted_values(sp);
 }
 
 /**
  * @brief Perform the second half-kick on all the active particles in a cell.
  *
- * Also prepares particles to be drifted.
+ * Also prepares particles to be drifted. Compiled once for each
+ * #runner_variant, see runner_do_kick2().
  *
  * @param r The runner thread.
  * @param c The cell.
  * @param timer Are we timing this ?
+ * @param with_cosmology Are we running with cosmology?
+ * @param with_cooling Are we running with cooling? (unused)
+ * @param with_limiter Are we running with the time-step limiter?
  */
-void runner_do_kick2(struct runner *r, struct cell *c, int timer) {
+__attribute__((always_inline)) INLINE static void runner_do_kick2_body(
+    struct runner *r, struct cell *c, int timer, const int with_cosmology,
+    const int with_cooling, const int with_limiter) {
 
   const struct engine *e = r->e;
-  const struct cosmology *cosmo = e->cosmology;
-  const struct hydro_props *hydro_props = e->hydro_properties;
-  const struct entropy_floor_properties *entropy_floor = e->entropy_floor;
-  const int with_cosmology = (e->policy & engine_policy_cosmology);
   const int count = c->hydro.count;
   const int gcount = c->grav.count;
   const int scount = c->stars.count;
@@ -2813,8 +3551,6 @@ void runner_do_kick2(struct runner *r, struct cell *c, int timer) {
   struct xpart *restrict xparts = c->hydro.xparts;
   struct gpart *restrict gparts = c->grav.parts;
   struct spart *restrict sparts = c->stars.parts;
-  const integertime_t ti_current = e->ti_current;
-  const double time_base = e->time_base;
 
   TIMER_TIC;
 
@@ -2829,79 +3565,23 @@ void runner_do_kick2(struct runner *r, struct cell *c, int timer) {
       if (c->progeny[k] != NULL) runner_do_kick2(r, c->progeny[k], 0);
   } else {
 
+    /* Only loop over the parts in the active time-bins if we can. */
+    const int *bins_ind = NULL;
+    const int nr_bins = cell_get_hydro_bins(c, e->max_active_bin, &bins_ind);
+    const int nr_loop = (nr_bins >= 0) ? nr_bins : count;
+
     /* Loop over the particles in this cell. */
-    for (int k = 0; k < count; k++) {
+    for (int n = 0; n < nr_loop; n++) {
+
+      const int k = (nr_bins >= 0) ? cell_hydro_bins_index(bins_ind[n]) : n;
 
       /* Get a handle on the part. */
       struct part *restrict p = &parts[k];
       struct xpart *restrict xp = &xparts[k];
 
       /* If particle needs to be kicked */
-      if (part_is_active(p, e)) {
-
-        integertime_t ti_begin, ti_end, ti_step;
-
-#ifdef SWIFT_DEBUG_CHECKS
-        if (p->wakeup == time_bin_awake)
-          error("Woken-up particle that has not been processed in kick1");
-#endif
-
-        if (p->wakeup == time_bin_not_awake) {
-
-          /* Time-step from a regular kick */
-          ti_step = get_integer_timestep(p->time_bin);
-          ti_begin = get_integer_time_begin(ti_current, p->time_bin);
-          ti_end = ti_begin + ti_step;
-
-        } else {
-
-          /* Time-step that follows a wake-up call */
-          ti_begin = get_integer_time_begin(ti_current, p->wakeup);
-          ti_end = get_integer_time_end(ti_current, p->time_bin);
-          ti_step = ti_end - ti_begin;
-
-          /* Reset the flag. Everything is back to normal from now on. */
-          p->wakeup = time_bin_awake;
-        }
-
-#ifdef SWIFT_DEBUG_CHECKS
-        if (ti_begin + ti_step != ti_current)
-          error(
-              "Particle in wrong time-bin, ti_begin=%lld, ti_step=%lld "
-              "time_bin=%d wakeup=%d ti_current=%lld",
-              ti_begin, ti_step, p->time_bin, p->wakeup, ti_current);
-#endif
-        /* Time interval for this half-kick */
-        double dt_kick_grav, dt_kick_hydro, dt_kick_therm, dt_kick_corr;
-        if (with_cosmology) {
-          dt_kick_hydro = cosmology_get_hydro_kick_factor(
-              cosmo, ti_begin + ti_step / 2, ti_end);
-          dt_kick_grav = cosmology_get_grav_kick_factor(
-              cosmo, ti_begin + ti_step / 2, ti_end);
-          dt_kick_therm = cosmology_get_therm_kick_factor(
-              cosmo, ti_begin + ti_step / 2, ti_end);
-          dt_kick_corr = cosmology_get_corr_kick_factor(
-              cosmo, ti_begin + ti_step / 2, ti_end);
-        } else {
-          dt_kick_hydro = (ti_end - (ti_begin + ti_step / 2)) * time_base;
-          dt_kick_grav = (ti_end - (ti_begin + ti_step / 2)) * time_base;
-          dt_kick_therm = (ti_end - (ti_begin + ti_step / 2)) * time_base;
-          dt_kick_corr = (ti_end - (ti_begin + ti_step / 2)) * time_base;
-        }
-
-        /* Finish the time-step with a second half-kick */
-        kick_part(p, xp, dt_kick_hydro, dt_kick_grav, dt_kick_therm,
-                  dt_kick_corr, cosmo, hydro_props, entropy_floor,
-                  ti_begin + ti_step / 2, ti_end);
-
-#ifdef SWIFT_DEBUG_CHECKS
-        /* Check that kick and the drift are synchronized */
-        if (p->ti_drift != p->ti_kick) error("Error integrating part in time.");
-#endif
-
-        /* Prepare the values to be drifted */
-        hydro_reset_predicted_values(p, xp);
-      }
+      if (part_is_active(p, e))
+        runner_kick2_part(e, p, xp, with_cosmology, with_limiter);
     }
 
     /* Loop over the g-particles in this cell. */
@@ -2911,39 +3591,8 @@ void runner_do_kick2(struct runner *r, struct cell *c, int timer) {
       struct gpart *restrict gp = &gparts[k];
 
       /* If the g-particle has no counterpart and needs to be kicked */
-      if (gp->type == swift_type_dark_matter && gpart_is_active(gp, e)) {
-
-        const integertime_t ti_step = get_integer_timestep(gp->time_bin);
-        const integertime_t ti_begin =
-            get_integer_time_begin(ti_current, gp->time_bin);
-
-#ifdef SWIFT_DEBUG_CHECKS
-        if (ti_begin + ti_step != ti_current)
-          error("Particle in wrong time-bin");
-#endif
-
-        /* Time interval for this half-kick */
-        double dt_kick_grav;
-        if (with_cosmology) {
-          dt_kick_grav = cosmology_get_grav_kick_factor(
-              cosmo, ti_begin + ti_step / 2, ti_begin + ti_step);
-        } else {
-          dt_kick_grav = (ti_step / 2) * time_base;
-        }
-
-        /* Finish the time-step with a second half-kick */
-        kick_gpart(gp, dt_kick_grav, ti_begin + ti_step / 2,
-                   ti_begin + ti_step);
-
-#ifdef SWIFT_DEBUG_CHECKS
-        /* Check that kick and the drift are synchronized */
-        if (gp->ti_drift != gp->ti_kick)
-          error("Error integrating g-part in time.");
-#endif
-
-        /* Prepare the values to be drifted */
-        gravity_reset_predicted_values(gp);
-      }
+      if (gp->type == swift_type_dark_matter && gpart_is_active(gp, e))
+        runner_kick2_gpart(e, gp, with_cosmology);
     }
 
     /* Loop over the particles in this cell. */
@@ -2953,57 +3602,82 @@ void runner_do_kick2(struct runner *r, struct cell *c, int timer) {
       struct spart *restrict sp = &sparts[k];
 
       /* If particle needs to be kicked */
-      if (spart_is_active(sp, e)) {
-
-        const integertime_t ti_step = get_integer_timestep(sp->time_bin);
-        const integertime_t ti_begin =
-            get_integer_time_begin(ti_current, sp->time_bin);
-
-#ifdef SWIFT_DEBUG_CHECKS
-        if (ti_begin + ti_step != ti_current)
-          error("Particle in wrong time-bin");
-#endif
-
-        /* Time interval for this half-kick */
-        double dt_kick_grav;
-        if (with_cosmology) {
-          dt_kick_grav = cosmology_get_grav_kick_factor(
-              cosmo, ti_begin + ti_step / 2, ti_begin + ti_step);
-        } else {
-          dt_kick_grav = (ti_step / 2) * time_base;
-        }
+      if (spart_is_active(sp, e)) runner_kick2_spart(e, sp, with_cosmology);
+    }
+  }
+  if (timer) TIMER_TOC(timer_kick2);
+}
 
-        /* Finish the time-step with a second half-kick */
-        kick_spart(sp, dt_kick_grav, ti_begin + ti_step / 2,
-                   ti_begin + ti_step);
+RUNNER_VARIANTS(runner_do_kick2)
 
-#ifdef SWIFT_DEBUG_CHECKS
-        /* Check that kick and the drift are synchronized */
-        if (sp->ti_drift != sp->ti_kick)
-          error("Error integrating s-part in time.");
-#endif
+/**
+ * @brief Perform the second half-kick on all the active particles in a cell.
+ *
+ * Calls the variant of the kernel compiled for the #engine's policies.
+ *
+ * @param r The runner thread.
+ * @param c The cell.
+ * @param timer Are we timing this ?
+ */
+void runner_do_kick2(struct runner *r, struct cell *c, int timer) {
+  runner_do_kick2_variants[r->e->runner_variant](r, c, timer);
+}
 
-        /* Prepare the values to be drifted */
-        stars_reset_predicted_values(sp);
-      }
-    }
+/**
+ * @brief Folds the sync- and starting points of a set of time-bins into the
+ * time-step bounds of a #cell.
+ *
+ * @param bins Bit-mask of the time-bins to fold in.
+ * @param ti_current The current point on the integer time-line.
+ * @param ti_end_min (in/out) The earliest end of step.
+ * @param ti_end_max (in/out) The latest end of step.
+ * @param ti_beg_max (in/out) The latest start of step.
+ */
+static INLINE void runner_fold_time_bins(unsigned long long bins,
+                                         const integertime_t ti_current,
+                                         integertime_t *ti_end_min,
+                                         integertime_t *ti_end_max,
+                                         integertime_t *ti_beg_max) {
+
+  while (bins != 0ULL) {
+    const timebin_t bin = __builtin_ctzll(bins);
+    bins &= bins - 1ULL;
+
+    const integertime_t ti_end = get_integer_time_end(ti_current, bin);
+    const integertime_t ti_beg = get_integer_time_begin(ti_current + 1, bin);
+
+    *ti_end_min = min(ti_end, *ti_end_min);
+    *ti_end_max = max(ti_end, *ti_end_max);
+    *ti_beg_max = max(ti_beg, *ti_beg_max);
   }
-  if (timer) TIMER_TOC(timer_kick2);
 }
 
 /**
  * @brief Computes the next time-step of all active particles in this cell
  * and update the cell's statistics.
  *
+ * When the #scheduler fuses the kicks, the particles also receive their
+ * second half-kick before and the first half-kick of their next step after
+ * their new time-step is computed, all in the same pass over memory.
+ *
+ * Compiled once for each #runner_variant, see runner_do_timestep().
+ *
  * @param r The runner thread.
  * @param c The cell.
  * @param timer Are we timing this ?
+ * @param with_cosmology Are we running with cosmology?
+ * @param with_cooling Are we running with cooling?
+ * @param with_limiter Are we running with the time-step limiter?
  */
-void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
+__attribute__((always_inline)) INLINE static void runner_do_timestep_body(
+    struct runner *r, struct cell *c, int timer, const int with_cosmology,
+    const int with_cooling, const int with_limiter) {
 
   const struct engine *e = r->e;
   const integertime_t ti_current = e->ti_current;
-  const int with_cosmology = (e->policy & engine_policy_cosmology);
+  const int with_sparse_limiter =
+      with_limiter && e->hydro_properties->sparse_limiter;
+  const int with_kicks = (e->sched.flags & scheduler_flag_fuse_kicks);
   const int count = c->hydro.count;
   const int gcount = c->grav.count;
   const int scount = c->stars.count;
@@ -3026,6 +3700,10 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
     return;
   }
 
+  /* The end-of-step values of this branch of the tree will need
+   * collecting. */
+  if (c->timestep != NULL) cell_set_collect_flag_up(c);
+
   int updated = 0, g_updated = 0, s_updated = 0, b_updated = 0;
   int inhibited = 0, g_inhibited = 0, s_inhibited = 0, b_inhibited = 0;
   integertime_t ti_hydro_end_min = max_nr_timesteps, ti_hydro_end_max = 0,
@@ -3037,6 +3715,12 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
   integertime_t ti_black_holes_end_min = max_nr_timesteps,
                 ti_black_holes_end_max = 0, ti_black_holes_beg_max = 0;
 
+  /* Time-bins of the inactive particles of each type. Their contribution to
+   * the cell's time-step bounds only depends on the bin, so it is computed
+   * once per bin rather than once per particle. */
+  unsigned long long hydro_bins = 0ULL, gravity_bins = 0ULL, stars_bins = 0ULL,
+                     black_holes_bins = 0ULL;
+
   /* No children? */
   if (!c->split) {
 
@@ -3050,6 +3734,10 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
       /* If particle needs updating */
       if (part_is_active(p, e)) {
 
+        /* Finish the current time-step */
+        if (with_kicks)
+          runner_kick2_part(e, p, xp, with_cosmology, with_limiter);
+
 #ifdef SWIFT_DEBUG_CHECKS
         /* Current end of time-step */
         const integertime_t ti_end =
@@ -3060,17 +3748,26 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
 #endif
 
         /* Get new time-step */
-        const integertime_t ti_new_step = get_part_timestep(p, xp, e);
+        const integertime_t ti_new_step =
+            get_part_timestep(p, xp, e, with_cooling);
 
         /* Update particle */
         p->time_bin = get_time_bin(ti_new_step);
         if (p->gpart != NULL) p->gpart->time_bin = p->time_bin;
 
+        /* The sparse limiter may not visit this particle, so forget here that
+         * it may have been limited in a previous step. */
+        if (with_sparse_limiter) p->wakeup = time_bin_not_awake;
+
         /* Update the tracers properties */
         tracers_after_timestep(p, xp, e->internal_units, e->physical_constants,
                                with_cosmology, e->cosmology,
                                e->hydro_properties, e->cooling_func, e->time);
 
+        /* Start the next one */
+        if (with_kicks && part_is_starting(p, e))
+          runner_kick1_part(e, p, xp, with_cosmology);
+
         /* Number of updated particles */
         updated++;
         if (p->gpart != NULL) g_updated++;
@@ -3100,31 +3797,15 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
         /* Count the number of inhibited particles */
         if (part_is_inhibited(p, e)) inhibited++;
 
-        const integertime_t ti_end =
-            get_integer_time_end(ti_current, p->time_bin);
-
-        const integertime_t ti_beg =
-            get_integer_time_begin(ti_current + 1, p->time_bin);
-
-        /* What is the next sync-point ? */
-        ti_hydro_end_min = min(ti_end, ti_hydro_end_min);
-        ti_hydro_end_max = max(ti_end, ti_hydro_end_max);
-
-        /* What is the next starting point for this cell ? */
-        ti_hydro_beg_max = max(ti_beg, ti_hydro_beg_max);
-
-        if (p->gpart != NULL) {
-
-          /* What is the next sync-point ? */
-          ti_gravity_end_min = min(ti_end, ti_gravity_end_min);
-          ti_gravity_end_max = max(ti_end, ti_gravity_end_max);
-
-          /* What is the next starting point for this cell ? */
-          ti_gravity_beg_max = max(ti_beg, ti_gravity_beg_max);
-        }
+        /* Record the bin for the next sync- and starting points */
+        hydro_bins |= 1ULL << p->time_bin;
+        if (p->gpart != NULL) gravity_bins |= 1ULL << p->time_bin;
       }
     }
 
+    /* Sort the particles by their new time-bin for the next kicks. */
+    if (count > 0) cell_build_hydro_bins(c);
+
     /* Loop over the g-particles in this cell. */
     for (int k = 0; k < gcount; k++) {
 
@@ -3137,6 +3818,9 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
         /* need to be updated ? */
         if (gpart_is_active(gp, e)) {
 
+          /* Finish the current time-step */
+          if (with_kicks) runner_kick2_gpart(e, gp, with_cosmology);
+
 #ifdef SWIFT_DEBUG_CHECKS
           /* Current end of time-step */
           const integertime_t ti_end =
@@ -3152,6 +3836,10 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
           /* Update particle */
           gp->time_bin = get_time_bin(ti_new_step);
 
+          /* Start the next one */
+          if (with_kicks && gpart_is_starting(gp, e))
+            runner_kick1_gpart(e, gp, with_cosmology);
+
           /* Number of updated g-particles */
           g_updated++;
 
@@ -3169,18 +3857,8 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
           /* Count the number of inhibited particles */
           if (gpart_is_inhibited(gp, e)) g_inhibited++;
 
-          const integertime_t ti_end =
-              get_integer_time_end(ti_current, gp->time_bin);
-
-          /* What is the next sync-point ? */
-          ti_gravity_end_min = min(ti_end, ti_gravity_end_min);
-          ti_gravity_end_max = max(ti_end, ti_gravity_end_max);
-
-          const integertime_t ti_beg =
-              get_integer_time_begin(ti_current + 1, gp->time_bin);
-
-          /* What is the next starting point for this cell ? */
-          ti_gravity_beg_max = max(ti_beg, ti_gravity_beg_max);
+          /* Record the bin for the next sync- and starting points */
+          gravity_bins |= 1ULL << gp->time_bin;
         }
       }
     }
@@ -3194,6 +3872,9 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
       /* need to be updated ? */
       if (spart_is_active(sp, e)) {
 
+        /* Finish the current time-step */
+        if (with_kicks) runner_kick2_spart(e, sp, with_cosmology);
+
 #ifdef SWIFT_DEBUG_CHECKS
         /* Current end of time-step */
         const integertime_t ti_end =
@@ -3209,6 +3890,10 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
         sp->time_bin = get_time_bin(ti_new_step);
         sp->gpart->time_bin = get_time_bin(ti_new_step);
 
+        /* Start the next one */
+        if (with_kicks && spart_is_starting(sp, e))
+          runner_kick1_spart(e, sp, with_cosmology);
+
         /* Number of updated s-particles */
         s_updated++;
         g_updated++;
@@ -3228,20 +3913,9 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
         /* Count the number of inhibited particles */
         if (spart_is_inhibited(sp, e)) ++s_inhibited;
 
-        const integertime_t ti_end =
-            get_integer_time_end(ti_current, sp->time_bin);
-
-        const integertime_t ti_beg =
-            get_integer_time_begin(ti_current + 1, sp->time_bin);
-
-        ti_stars_end_min = min(ti_end, ti_stars_end_min);
-        ti_stars_end_max = max(ti_end, ti_stars_end_max);
-        ti_gravity_end_min = min(ti_end, ti_gravity_end_min);
-        ti_gravity_end_max = max(ti_end, ti_gravity_end_max);
-
-        /* What is the next starting point for this cell ? */
-        ti_stars_beg_max = max(ti_beg, ti_stars_beg_max);
-        ti_gravity_beg_max = max(ti_beg, ti_gravity_beg_max);
+        /* Record the bin for the next sync- and starting points */
+        stars_bins |= 1ULL << sp->time_bin;
+        gravity_bins |= 1ULL << sp->time_bin;
       }
     }
 
@@ -3290,23 +3964,23 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
         /* Count the number of inhibited particles */
         if (bpart_is_inhibited(bp, e)) ++b_inhibited;
 
-        const integertime_t ti_end =
-            get_integer_time_end(ti_current, bp->time_bin);
-
-        const integertime_t ti_beg =
-            get_integer_time_begin(ti_current + 1, bp->time_bin);
-
-        ti_black_holes_end_min = min(ti_end, ti_black_holes_end_min);
-        ti_black_holes_end_max = max(ti_end, ti_black_holes_end_max);
-        ti_gravity_end_min = min(ti_end, ti_gravity_end_min);
-        ti_gravity_end_max = max(ti_end, ti_gravity_end_max);
-
-        /* What is the next starting point for this cell ? */
-        ti_black_holes_beg_max = max(ti_beg, ti_black_holes_beg_max);
-        ti_gravity_beg_max = max(ti_beg, ti_gravity_beg_max);
+        /* Record the bin for the next sync- and starting points */
+        black_holes_bins |= 1ULL << bp->time_bin;
+        gravity_bins |= 1ULL << bp->time_bin;
       }
     }
 
+    /* Fold in the sync- and starting points of the inactive particles */
+    runner_fold_time_bins(hydro_bins, ti_current, &ti_hydro_end_min,
+                          &ti_hydro_end_max, &ti_hydro_beg_max);
+    runner_fold_time_bins(gravity_bins, ti_current, &ti_gravity_end_min,
+                          &ti_gravity_end_max, &ti_gravity_beg_max);
+    runner_fold_time_bins(stars_bins, ti_current, &ti_stars_end_min,
+                          &ti_stars_end_max, &ti_stars_beg_max);
+    runner_fold_time_bins(black_holes_bins, ti_current,
+                          &ti_black_holes_end_min, &ti_black_holes_end_max,
+                          &ti_black_holes_beg_max);
+
   } else {
 
     /* Loop over the progeny. */
@@ -3392,6 +4066,22 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
   if (timer) TIMER_TOC(timer_timestep);
 }
 
+RUNNER_VARIANTS(runner_do_timestep)
+
+/**
+ * @brief Computes the next time-step of all active particles in this cell
+ * and update the cell's statistics.
+ *
+ * Calls the variant of the kernel compiled for the #engine's policies.
+ *
+ * @param r The runner thread.
+ * @param c The cell.
+ * @param timer Are we timing this ?
+ */
+void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
+  runner_do_timestep_variants[r->e->runner_variant](r, c, timer);
+}
+
 /**
  * @brief Apply the time-step limiter to all awaken particles in a cell
  * hierarchy.
@@ -3416,6 +4106,10 @@ void runner_do_limiter(struct runner *r, struct cell *c, int force, int timer) {
   if (c->nodeID != engine_rank) error("Limiting dt of a foreign cell is nope.");
 #endif
 
+  /* The end-of-step values of this branch of the tree will need
+   * collecting. */
+  if (c->timestep_limiter != NULL) cell_set_collect_flag_up(c);
+
   integertime_t ti_hydro_end_min = max_nr_timesteps, ti_hydro_end_max = 0,
                 ti_hydro_beg_max = 0;
   integertime_t ti_gravity_end_min = max_nr_timesteps, ti_gravity_end_max = 0,
@@ -3489,6 +4183,9 @@ void runner_do_limiter(struct runner *r, struct cell *c, int force, int timer) {
         /* Apply the limiter and get the new time-step size */
         const integertime_t ti_new_step = timestep_limit_part(p, xp, e);
 
+        /* The time-bin list of the cell is now out of date */
+        c->hydro.bins_count = -1;
+
         /* What is the next sync-point ? */
         ti_hydro_end_min = min(ti_current + ti_new_step, ti_hydro_end_min);
         ti_hydro_end_max = max(ti_current + ti_new_step, ti_hydro_end_max);
@@ -3547,10 +4244,21 @@ void runner_do_end_hydro_force(struct runner *r, struct cell *c, int timer) {
   /* Anything to do here? */
   if (!cell_is_active_hydro(c, e)) return;
 
+  /* Largest signal velocity of the active particles (for the limiter) */
+  float v_sig_max = 0.f;
+
   /* Recurse? */
   if (c->split) {
-    for (int k = 0; k < 8; k++)
-      if (c->progeny[k] != NULL) runner_do_end_hydro_force(r, c->progeny[k], 0);
+    for (int k = 0; k < 8; k++) {
+      if (c->progeny[k] != NULL) {
+        struct cell *restrict cp = c->progeny[k];
+
+        runner_do_end_hydro_force(r, cp, 0);
+
+        if (cp->hydro.ti_v_sig_max_active == e->ti_current)
+          v_sig_max = max(v_sig_max, cp->hydro.v_sig_max_active);
+      }
+    }
   } else {
 
     const struct cosmology *cosmo = e->cosmology;
@@ -3567,10 +4275,16 @@ void runner_do_end_hydro_force(struct runner *r, struct cell *c, int timer) {
 
         /* Finish the force loop */
         hydro_end_force(p, cosmo);
+
+        v_sig_max = max(v_sig_max, hydro_get_signal_velocity(p));
       }
     }
   }
 
+  /* Record who can wake up their neighbours in the limiter loop */
+  c->hydro.v_sig_max_active = v_sig_max;
+  c->hydro.ti_v_sig_max_active = e->ti_current;
+
   if (timer) TIMER_TOC(timer_end_hydro_force);
 }
 
@@ -4021,6 +4735,91 @@ void runner_do_recv_bpart(struct runner *r, struct cell *c, int clear_sorts,
 #endif
 }
 
+/**
+ * @brief Run a self-gravity task and flush the gravity caches.
+ */
+static void runner_doself_grav_task(struct runner *r, struct cell *c) {
+  runner_doself_recursive_grav(r, c, 1);
+  runner_flush_grav_caches(r);
+}
+
+/**
+ * @brief Run a pair-gravity task and flush the gravity caches.
+ */
+static void runner_dopair_grav_task(struct runner *r, struct cell *ci,
+                                    struct cell *cj) {
+  runner_dopair_recursive_grav(r, ci, cj, 1);
+  runner_flush_grav_caches(r);
+}
+
+/**
+ * @brief Run an external-gravity task.
+ */
+static void runner_do_grav_external_task(struct runner *r, struct cell *c) {
+  runner_do_grav_external(r, c, 1);
+}
+
+/* Functions running the interaction tasks of each sub-type. A task of a
+ * sub-type that does not appear here is an error. */
+typedef void (*runner_self_func)(struct runner *r, struct cell *c);
+typedef void (*runner_pair_func)(struct runner *r, struct cell *ci,
+                                 struct cell *cj);
+typedef void (*runner_sub_self_func)(struct runner *r, struct cell *c,
+                                     int gettimer);
+typedef void (*runner_sub_pair_func)(struct runner *r, struct cell *ci,
+                                     struct cell *cj, int gettimer);
+
+static const runner_self_func runner_self_funcs[task_subtype_count] = {
+    [task_subtype_density] = runner_doself1_branch_density,
+#ifdef EXTRA_HYDRO_LOOP
+    [task_subtype_gradient] = runner_doself1_branch_gradient,
+#endif
+    [task_subtype_force] = runner_doself2_branch_force,
+    [task_subtype_limiter] = runner_doself2_branch_limiter,
+    [task_subtype_grav] = runner_doself_grav_task,
+    [task_subtype_external_grav] = runner_do_grav_external_task,
+    [task_subtype_stars_density] = runner_doself_branch_stars_density,
+    [task_subtype_stars_feedback] = runner_doself_branch_stars_feedback,
+    [task_subtype_bh_density] = runner_doself_branch_bh_density,
+    [task_subtype_bh_feedback] = runner_doself_branch_bh_feedback};
+
+static const runner_pair_func runner_pair_funcs[task_subtype_count] = {
+    [task_subtype_density] = runner_dopair1_branch_density,
+#ifdef EXTRA_HYDRO_LOOP
+    [task_subtype_gradient] = runner_dopair1_branch_gradient,
+#endif
+    [task_subtype_force] = runner_dopair2_branch_force,
+    [task_subtype_limiter] = runner_dopair2_branch_limiter,
+    [task_subtype_grav] = runner_dopair_grav_task,
+    [task_subtype_stars_density] = runner_dopair_branch_stars_density,
+    [task_subtype_stars_feedback] = runner_dopair_branch_stars_feedback,
+    [task_subtype_bh_density] = runner_dopair_branch_bh_density,
+    [task_subtype_bh_feedback] = runner_dopair_branch_bh_feedback};
+
+static const runner_sub_self_func runner_sub_self_funcs[task_subtype_count] = {
+    [task_subtype_density] = runner_dosub_self1_density,
+#ifdef EXTRA_HYDRO_LOOP
+    [task_subtype_gradient] = runner_dosub_self1_gradient,
+#endif
+    [task_subtype_force] = runner_dosub_self2_force,
+    [task_subtype_limiter] = runner_dosub_self2_limiter,
+    [task_subtype_stars_density] = runner_dosub_self_stars_density,
+    [task_subtype_stars_feedback] = runner_dosub_self_stars_feedback,
+    [task_subtype_bh_density] = runner_dosub_self_bh_density,
+    [task_subtype_bh_feedback] = runner_dosub_self_bh_feedback};
+
+static const runner_sub_pair_func runner_sub_pair_funcs[task_subtype_count] = {
+    [task_subtype_density] = runner_dosub_pair1_density,
+#ifdef EXTRA_HYDRO_LOOP
+    [task_subtype_gradient] = runner_dosub_pair1_gradient,
+#endif
+    [task_subtype_force] = runner_dosub_pair2_force,
+    [task_subtype_limiter] = runner_dosub_pair2_limiter,
+    [task_subtype_stars_density] = runner_dosub_pair_stars_density,
+    [task_subtype_stars_feedback] = runner_dosub_pair_stars_feedback,
+    [task_subtype_bh_density] = runner_dosub_pair_bh_density,
+    [task_subtype_bh_feedback] = runner_dosub_pair_bh_feedback};
+
 /**
  * @brief The #runner main thread routine.
  *
@@ -4033,6 +4832,13 @@ void *runner_main(void *data) {
   struct scheduler *sched = &e->sched;
   unsigned int seed = r->id;
   pthread_setspecific(sched->local_seed_pointer, &seed);
+
+#ifdef SWIFT_TASK_COUNTERS
+  /* Count the events of this thread. */
+  task_counters_open(&r->counters);
+  const int nr_counters = task_counters_count();
+#endif
+
   /* Main loop. */
   while (1) {
 
@@ -4042,6 +4848,15 @@ void *runner_main(void *data) {
     /* Can we go home yet? */
     if (e->step_props & engine_step_prop_done) break;
 
+    /* Work on a threadpool map instead of tasks? Only as many runners as
+     * the threadpool has threads, the calling one aside, take part. */
+    if (e->runners_mapping) {
+      struct threadpool *tp = &e->threadpool;
+      const int tid = atomic_inc(&tp->num_threads_running);
+      if (tid < tp->num_threads - 1) threadpool_chomp(tp, tid);
+      continue;
+    }
+
     /* Re-set the pointer to the previous task, as there is none. */
     struct task *t = NULL;
     struct task *prev = NULL;
@@ -4061,6 +4876,14 @@ void *runner_main(void *data) {
         if (t == NULL) break;
       }
 
+      /* Hand the oversized sub-tasks out to the other runners in pieces.
+       * They are then done once all their pieces are. */
+      if (sched->spawn_size > 0 && scheduler_spawn(sched, t)) {
+        prev = t;
+        t = NULL;
+        continue;
+      }
+
       /* Get the cells. */
       struct cell *ci = t->ci;
       struct cell *cj = t->cj;
@@ -4080,109 +4903,48 @@ void *runner_main(void *data) {
       }
 #endif
 
+#ifdef SWIFT_TASK_COUNTERS
+      long long counters_start[task_counters_max];
+      task_counters_read(&r->counters, counters_start);
+#endif
+
 /* Check that we haven't scheduled an inactive task */
 #ifdef SWIFT_DEBUG_CHECKS
       t->ti_run = e->ti_current;
 #endif
 
+#ifdef WITH_MPI
+      /* The MPI state of the communication tasks. */
+      struct task_comm *comm =
+          (t->type == task_type_send || t->type == task_type_recv)
+              ? task_get_comm(t)
+              : NULL;
+#endif
+
       /* Different types of tasks... */
       switch (t->type) {
         case task_type_self:
-          if (t->subtype == task_subtype_density)
-            runner_doself1_branch_density(r, ci);
-#ifdef EXTRA_HYDRO_LOOP
-          else if (t->subtype == task_subtype_gradient)
-            runner_doself1_branch_gradient(r, ci);
-#endif
-          else if (t->subtype == task_subtype_force)
-            runner_doself2_branch_force(r, ci);
-          else if (t->subtype == task_subtype_limiter)
-            runner_doself2_branch_limiter(r, ci);
-          else if (t->subtype == task_subtype_grav)
-            runner_doself_recursive_grav(r, ci, 1);
-          else if (t->subtype == task_subtype_external_grav)
-            runner_do_grav_external(r, ci, 1);
-          else if (t->subtype == task_subtype_stars_density)
-            runner_doself_branch_stars_density(r, ci);
-          else if (t->subtype == task_subtype_stars_feedback)
-            runner_doself_branch_stars_feedback(r, ci);
-          else if (t->subtype == task_subtype_bh_density)
-            runner_doself_branch_bh_density(r, ci);
-          else if (t->subtype == task_subtype_bh_feedback)
-            runner_doself_branch_bh_feedback(r, ci);
-          else
+          if (runner_self_funcs[t->subtype] == NULL)
             error("Unknown/invalid task subtype (%d).", t->subtype);
+          runner_self_funcs[t->subtype](r, ci);
           break;
 
         case task_type_pair:
-          if (t->subtype == task_subtype_density)
-            runner_dopair1_branch_density(r, ci, cj);
-#ifdef EXTRA_HYDRO_LOOP
-          else if (t->subtype == task_subtype_gradient)
-            runner_dopair1_branch_gradient(r, ci, cj);
-#endif
-          else if (t->subtype == task_subtype_force)
-            runner_dopair2_branch_force(r, ci, cj);
-          else if (t->subtype == task_subtype_limiter)
-            runner_dopair2_branch_limiter(r, ci, cj);
-          else if (t->subtype == task_subtype_grav)
-            runner_dopair_recursive_grav(r, ci, cj, 1);
-          else if (t->subtype == task_subtype_stars_density)
-            runner_dopair_branch_stars_density(r, ci, cj);
-          else if (t->subtype == task_subtype_stars_feedback)
-            runner_dopair_branch_stars_feedback(r, ci, cj);
-          else if (t->subtype == task_subtype_bh_density)
-            runner_dopair_branch_bh_density(r, ci, cj);
-          else if (t->subtype == task_subtype_bh_feedback)
-            runner_dopair_branch_bh_feedback(r, ci, cj);
-          else
+          if (runner_pair_funcs[t->subtype] == NULL)
             error("Unknown/invalid task subtype (%d).", t->subtype);
+          runner_pair_funcs[t->subtype](r, ci, cj);
           break;
 
         case task_type_sub_self:
-          if (t->subtype == task_subtype_density)
-            runner_dosub_self1_density(r, ci, 1);
-#ifdef EXTRA_HYDRO_LOOP
-          else if (t->subtype == task_subtype_gradient)
-            runner_dosub_self1_gradient(r, ci, 1);
-#endif
-          else if (t->subtype == task_subtype_force)
-            runner_dosub_self2_force(r, ci, 1);
-          else if (t->subtype == task_subtype_limiter)
-            runner_dosub_self2_limiter(r, ci, 1);
-          else if (t->subtype == task_subtype_stars_density)
-            runner_dosub_self_stars_density(r, ci, 1);
-          else if (t->subtype == task_subtype_stars_feedback)
-            runner_dosub_self_stars_feedback(r, ci, 1);
-          else if (t->subtype == task_subtype_bh_density)
-            runner_dosub_self_bh_density(r, ci, 1);
-          else if (t->subtype == task_subtype_bh_feedback)
-            runner_dosub_self_bh_feedback(r, ci, 1);
-          else
+          if (runner_sub_self_funcs[t->subtype] == NULL)
             error("Unknown/invalid task subtype (%d).", t->subtype);
+          runner_sub_self_funcs[t->subtype](r, ci, 1);
           break;
 
         case task_type_sub_pair:
-          if (t->subtype == task_subtype_density)
-            runner_dosub_pair1_density(r, ci, cj, 1);
-#ifdef EXTRA_HYDRO_LOOP
-          else if (t->subtype == task_subtype_gradient)
-            runner_dosub_pair1_gradient(r, ci, cj, 1);
-#endif
-          else if (t->subtype == task_subtype_force)
-            runner_dosub_pair2_force(r, ci, cj, 1);
-          else if (t->subtype == task_subtype_limiter)
-            runner_dosub_pair2_limiter(r, ci, cj, 1);
-          else if (t->subtype == task_subtype_stars_density)
-            runner_dosub_pair_stars_density(r, ci, cj, 1);
-          else if (t->subtype == task_subtype_stars_feedback)
-            runner_dosub_pair_stars_feedback(r, ci, cj, 1);
-          else if (t->subtype == task_subtype_bh_density)
-            runner_dosub_pair_bh_density(r, ci, cj, 1);
-          else if (t->subtype == task_subtype_bh_feedback)
-            runner_dosub_pair_bh_feedback(r, ci, cj, 1);
-          else
+          if (runner_sub_pair_funcs[t->subtype] == NULL)
             error("Unknown/invalid task subtype (%d).", t->subtype);
+          runner_sub_pair_funcs[t->subtype](r, ci, cj, 1);
           break;
 
         case task_type_sort:
@@ -4253,36 +5015,46 @@ void *runner_main(void *data) {
           break;
 #ifdef WITH_MPI
         case task_type_send:
-          if (t->subtype == task_subtype_tend_part) {
-            free(t->buff);
-          } else if (t->subtype == task_subtype_tend_gpart) {
-            free(t->buff);
-          } else if (t->subtype == task_subtype_tend_spart) {
-            free(t->buff);
-          } else if (t->subtype == task_subtype_tend_bpart) {
-            free(t->buff);
-          } else if (t->subtype == task_subtype_sf_counts) {
-            free(t->buff);
-          }
+          scheduler_free_send_buffer(sched, t);
           break;
         case task_type_recv:
-          if (t->subtype == task_subtype_tend_part) {
-            cell_unpack_end_step_hydro(ci, (struct pcell_step_hydro *)t->buff);
-            free(t->buff);
+          if (t->flags < 0) {
+            proxy_tend_unpack(
+                proxy_tend_get_group(e->proxies, e->proxy_ind, t),
+                (char *)comm->buff);
+            free(comm->buff);
+          } else if (t->subtype == task_subtype_tend_part) {
+            cell_unpack_end_step_hydro(
+                ci, (struct pcell_step_hydro *)comm->buff);
+            free(comm->buff);
           } else if (t->subtype == task_subtype_tend_gpart) {
-            cell_unpack_end_step_grav(ci, (struct pcell_step_grav *)t->buff);
-            free(t->buff);
+            cell_unpack_end_step_grav(ci, (struct pcell_step_grav *)comm->buff);
+            free(comm->buff);
           } else if (t->subtype == task_subtype_tend_spart) {
-            cell_unpack_end_step_stars(ci, (struct pcell_step_stars *)t->buff);
-            free(t->buff);
+            cell_unpack_end_step_stars(
+                ci, (struct pcell_step_stars *)comm->buff);
+            free(comm->buff);
           } else if (t->subtype == task_subtype_tend_bpart) {
             cell_unpack_end_step_black_holes(
-                ci, (struct pcell_step_black_holes *)t->buff);
-            free(t->buff);
+                ci, (struct pcell_step_black_holes *)comm->buff);
+            free(comm->buff);
           } else if (t->subtype == task_subtype_sf_counts) {
-            cell_unpack_sf_counts(ci, (struct pcell_sf *)t->buff);
+            cell_unpack_sf_counts(ci, (struct pcell_sf *)comm->buff);
             cell_clear_stars_sort_flags(ci, /*clear_unused_flags=*/0);
-            free(t->buff);
+            free(comm->buff);
+          } else if ((t->subtype == task_subtype_xv ||
+                      t->subtype == task_subtype_rho ||
+                      t->subtype == task_subtype_gradient) &&
+                     (e->sched.flags & scheduler_flag_compact_hydro)) {
+            if (e->sched.flags & scheduler_flag_mpi_rma) {
+              /* The buffer is part of our window, sync our view of it. */
+              MPI_Win_sync(e->sched.rma_win);
+              cell_unpack_hydro(ci, comm->buff, t->subtype);
+            } else {
+              cell_unpack_hydro(ci, comm->buff, t->subtype);
+              free(comm->buff);
+            }
+            runner_do_recv_part(r, ci, t->subtype == task_subtype_xv, 1);
           } else if (t->subtype == task_subtype_xv) {
             runner_do_recv_part(r, ci, 1, 1);
           } else if (t->subtype == task_subtype_rho) {
@@ -4298,8 +5070,8 @@ void *runner_main(void *data) {
           } else if (t->subtype == task_subtype_bpart) {
             runner_do_recv_bpart(r, ci, 1, 1);
           } else if (t->subtype == task_subtype_multipole) {
-            cell_unpack_multipoles(ci, (struct gravity_tensors *)t->buff);
-            free(t->buff);
+            cell_unpack_multipoles(ci, (struct gravity_tensors *)comm->buff);
+            free(comm->buff);
           } else {
             error("Unknown/invalid task subtype (%d).", t->subtype);
           }
@@ -4345,6 +5117,16 @@ void *runner_main(void *data) {
       }
 #endif
 
+#ifdef SWIFT_TASK_COUNTERS
+      task_counters_read(&r->counters, t->counters);
+      for (int k = 0; k < nr_counters; k++)
+        t->counters[k] -= counters_start[k];
+#endif
+
+      /* Account for the time this task took. */
+      if (e->task_histograms_steps > 0)
+        task_histograms_add(&r->histograms, t, getticks() - t->tic);
+
       /* We're done with this task, see if we get a next one. */
       prev = t;
       t = scheduler_done(sched, t);
@@ -4352,6 +5134,10 @@ void *runner_main(void *data) {
     } /* main loop. */
   }
 
+#ifdef SWIFT_TASK_COUNTERS
+  task_counters_close(&r->counters);
+#endif
+
   /* Be kind, rewind. */
   return NULL;
 }
@@ -4382,38 +5168,38 @@ void runner_do_logger(struct runner *r, struct cell *c, int timer) {
       if (c->progeny[k] != NULL) runner_do_logger(r, c->progeny[k], 0);
   } else {
 
-    /* Loop over the parts in this cell. */
+    /* Currently writing everything, should adapt it through time */
+    const unsigned int mask =
+        logger_mask_data[logger_x].mask | logger_mask_data[logger_v].mask |
+        logger_mask_data[logger_a].mask | logger_mask_data[logger_u].mask |
+        logger_mask_data[logger_h].mask | logger_mask_data[logger_rho].mask |
+        logger_mask_data[logger_consts].mask;
+
+    /* List the particles to log in this cell */
+    int *ind = (int *)malloc(count * sizeof(int));
+    if (ind == NULL && count > 0)
+      error("Failed to allocate the list of particles to log.");
+    size_t to_log = 0;
     for (int k = 0; k < count; k++) {
 
-      /* Get a handle on the part. */
-      struct part *restrict p = &parts[k];
-      struct xpart *restrict xp = &xparts[k];
-
-      /* If particle needs to be log */
       /* This is the same function than part_is_active, except for
        * debugging checks */
-      if (part_is_starting(p, e)) {
+      if (part_is_starting(&parts[k], e)) {
 
-        if (logger_should_write(&xp->logger_data, e->logger)) {
-          /* Write particle */
-          /* Currently writing everything, should adapt it through time */
-          logger_log_part(e->logger, p,
-                          logger_mask_data[logger_x].mask |
-                              logger_mask_data[logger_v].mask |
-                              logger_mask_data[logger_a].mask |
-                              logger_mask_data[logger_u].mask |
-                              logger_mask_data[logger_h].mask |
-                              logger_mask_data[logger_rho].mask |
-                              logger_mask_data[logger_consts].mask,
-                          &xp->logger_data.last_offset);
+        if (logger_should_write(&xparts[k].logger_data, e->logger)) {
+          ind[to_log++] = k;
 
           /* Set counter back to zero */
-          xp->logger_data.steps_since_last_output = 0;
+          xparts[k].logger_data.steps_since_last_output = 0;
         } else
           /* Update counter */
-          xp->logger_data.steps_since_last_output += 1;
+          xparts[k].logger_data.steps_since_last_output += 1;
       }
     }
+
+    /* And write them all at once */
+    logger_log_parts(e->logger, parts, xparts, ind, to_log, mask, e->time);
+    free(ind);
   }
 
   if (c->grav.count > 0) error("gparts not implemented");
@@ -4445,7 +5231,8 @@ void runner_do_fof_self(struct runner *r, struct cell *c, int timer) {
   const struct gpart *const gparts = s->gparts;
   const double search_r2 = e->fof_properties->l_x2;
 
-  rec_fof_search_self(e->fof_properties, dim, search_r2, periodic, gparts, c);
+  rec_fof_search_self(e->fof_properties, dim, search_r2, periodic, gparts, c,
+                      &r->ci_fof_cache, &r->cj_fof_cache);
 
   if (timer) TIMER_TOC(timer_fof_self);
 }
@@ -4471,7 +5258,7 @@ void runner_do_fof_pair(struct runner *r, struct cell *ci, struct cell *cj,
   const double search_r2 = e->fof_properties->l_x2;
 
   rec_fof_search_pair(e->fof_properties, dim, search_r2, periodic, gparts, ci,
-                      cj);
+                      cj, &r->ci_fof_cache, &r->cj_fof_cache);
 
   if (timer) TIMER_TOC(timer_fof_pair);
 }
@@ -28,11 +28,29 @@
 
 /* Includes. */
 #include "cache.h"
+#include "fof_cache.h"
 #include "gravity_cache.h"
+#include "neighbour_list.h"
+#include "task_counters.h"
+#include "task_histograms.h"
 
 struct cell;
 struct engine;
 
+/**
+ * @brief The policies for which the kick and time-step kernels are compiled
+ * separately.
+ *
+ * The #engine picks the variant matching its policies once in
+ * engine_config() and stores it as a combination of these bits.
+ */
+enum runner_variant {
+  runner_variant_cosmology = (1 << 0),
+  runner_variant_cooling = (1 << 1),
+  runner_variant_limiter = (1 << 2),
+  runner_variant_count = (1 << 3)
+};
+
 /**
  * @brief A struct representing a runner's thread and its data.
  */
@@ -56,6 +74,26 @@ struct runner {
   /*! The particle gravity_cache of cell cj. */
   struct gravity_cache cj_gravity_cache;
 
+  /*! The particle fof_cache of cell ci. */
+  struct fof_cache ci_fof_cache;
+
+  /*! The particle fof_cache of cell cj. */
+  struct fof_cache cj_fof_cache;
+
+  /*! The arena from which the sort arrays are allocated. */
+  struct sort_arena sort_arena;
+
+  /*! The arena in which the neighbour lists of the hydro loops are stored. */
+  struct neighbour_list_arena neighbour_lists;
+
+  /*! The histograms of the timings of the tasks run by this thread. */
+  struct task_histograms histograms;
+
+#ifdef SWIFT_TASK_COUNTERS
+  /*! The performance counters sampled around the tasks. */
+  struct task_counters counters;
+#endif
+
 #ifdef WITH_VECTORIZATION
 
   /*! The particle cache of cell ci. */
@@ -80,6 +118,7 @@ void runner_do_drift_gpart(struct runner *r, struct cell *c, int timer);
 void runner_do_drift_spart(struct runner *r, struct cell *c, int timer);
 void runner_do_kick1(struct runner *r, struct cell *c, int timer);
 void runner_do_kick2(struct runner *r, struct cell *c, int timer);
+void runner_do_timestep(struct runner *r, struct cell *c, int timer);
 void runner_do_end_hydro_force(struct runner *r, struct cell *c, int timer);
 void runner_do_init(struct runner *r, struct cell *c, int timer);
 void runner_do_cooling(struct runner *r, struct cell *c, int timer);
@@ -32,6 +32,15 @@
 #define _DOPAIR1(f) PASTE(runner_dopair1, f)
 #define DOPAIR1 _DOPAIR1(FUNCTION)
 
+#define _DOPAIR1_LIST(f) PASTE(runner_dopair1_list, f)
+#define DOPAIR1_LIST _DOPAIR1_LIST(FUNCTION)
+
+#define _DOPAIR2_LIST(f) PASTE(runner_dopair2_list, f)
+#define DOPAIR2_LIST _DOPAIR2_LIST(FUNCTION)
+
+#define _DOSELF1_LIST(f) PASTE(runner_doself1_list, f)
+#define DOSELF1_LIST _DOSELF1_LIST(FUNCTION)
+
 #define _DOPAIR2_BRANCH(f) PASTE(runner_dopair2_branch, f)
 #define DOPAIR2_BRANCH _DOPAIR2_BRANCH(FUNCTION)
 
@@ -145,6 +154,10 @@ void DOPAIR1_NAIVE(struct runner *r, struct cell *restrict ci,
   /* Anything to do here? */
   if (!cell_is_active_hydro(ci, e) && !cell_is_active_hydro(cj, e)) return;
 
+  /* The foreign particles are copies we do not need to update. */
+  const int ci_local = (ci->nodeID == e->nodeID);
+  const int cj_local = (cj->nodeID == e->nodeID);
+
   const int count_i = ci->hydro.count;
   const int count_j = cj->hydro.count;
   struct part *restrict parts_i = ci->hydro.parts;
@@ -181,7 +194,7 @@ struct part *restrict pi = &parts_i[pid];
     /* Skip inhibited particles. */
     if (part_is_inhibited(pi, e)) continue;
 
-    const int pi_active = part_is_active(pi, e);
+    const int pi_active = ci_local && part_is_active(pi, e);
     const float hi = pi->h;
     const float hig2 = hi * hi * kernel_gamma2;
     const float pix[3] = {(float)(pi->x[0] - (cj->loc[0] + shift[0])),
@@ -202,7 +215,7 @@ struct part *restrict pi = &parts_i[pid];
 
       const float hj = pj->h;
       const float hjg2 = hj * hj * kernel_gamma2;
-      const int pj_active = part_is_active(pj, e);
+      const int pj_active = cj_local && part_is_active(pj, e);
 
       /* Compute the pairwise distance. */
       const float pjx[3] = {(float)(pj->x[0] - cj->loc[0]),
@@ -267,6 +280,10 @@ void DOPAIR2_NAIVE(struct runner *r, struct cell *restrict ci,
   /* Anything to do here? */
   if (!cell_is_active_hydro(ci, e) && !cell_is_active_hydro(cj, e)) return;
 
+  /* The foreign particles are copies we do not need to update. */
+  const int ci_local = (ci->nodeID == e->nodeID);
+  const int cj_local = (cj->nodeID == e->nodeID);
+
   const int count_i = ci->hydro.count;
   const int count_j = cj->hydro.count;
   struct part *restrict parts_i = ci->hydro.parts;
@@ -303,7 +320,7 @@ struct part *restrict pi = &parts_i[pid];
     /* Skip inhibited particles. */
     if (part_is_inhibited(pi, e)) continue;
 
-    const int pi_active = part_is_active(pi, e);
+    const int pi_active = ci_local && part_is_active(pi, e);
     const float hi = pi->h;
     const float hig2 = hi * hi * kernel_gamma2;
     const float pix[3] = {(float)(pi->x[0] - (cj->loc[0] + shift[0])),
@@ -322,7 +339,7 @@ struct part *restrict pi = &parts_i[pid];
       /* Skip inhibited particles. */
       if (part_is_inhibited(pj, e)) continue;
 
-      const int pj_active = part_is_active(pj, e);
+      const int pj_active = cj_local && part_is_active(pj, e);
       const float hj = pj->h;
       const float hjg2 = hj * hj * kernel_gamma2;
 
@@ -895,6 +912,12 @@ void DOPAIR_SUBSET_BRANCH(struct runner *r, struct cell *restrict ci,
       shift[k] = -e->s->dim[k];
   }
 
+  /* Small pairs are done by brute force, without sorting the cells. */
+  if (cell_pair_skips_hydro_sorts(ci, cj)) {
+    DOPAIR_SUBSET_NAIVE(r, ci, parts_i, xparts_i, ind, count, cj, shift);
+    return;
+  }
+
 #if !defined(SWIFT_USE_NAIVE_INTERACTIONS)
   /* Get the sorting index. */
   int sid = 0;
@@ -1095,7 +1118,11 @@ void DOPAIR1(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
   const float a = cosmo->a;
   const float H = cosmo->H;
 
-  if (cell_is_active_hydro(ci, e)) {
+  /* The foreign particles are copies we do not need to update. */
+  const int do_ci = cell_is_active_hydro(ci, e) && (ci->nodeID == e->nodeID);
+  const int do_cj = cell_is_active_hydro(cj, e) && (cj->nodeID == e->nodeID);
+
+  if (do_ci) {
 
     /* Loop over the parts in ci. */
     for (int pid = count_i - 1;
@@ -1189,7 +1216,7 @@ void DOPAIR1(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
     }   /* loop over the parts in ci. */
   }     /* Cell ci is active */
 
-  if (cell_is_active_hydro(cj, e)) {
+  if (do_cj) {
 
     /* Loop over the parts in cj. */
     for (int pjd = 0; pjd < count_j && sort_j[pjd].d - hj_max - dx_max < di_max;
@@ -1286,6 +1313,317 @@ void DOPAIR1(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
   TIMER_TOC(TIMER_DOPAIR);
 }
 
+#if defined(EXTRA_HYDRO_LOOP) && (FUNCTION_TASK_LOOP == TASK_LOOP_GRADIENT)
+
+/**
+ * @brief Compute the interactions between a cell pair (non-symmetric) and
+ * record the pairs the force loop will need.
+ *
+ * The recorded pairs are the ones with at least one active particle and
+ * r < kernel_gamma * max(hi, hj). This is the force loop criterion, which is
+ * a superset of the pairs needed here. The smoothing lengths and positions do
+ * not change between the two loops, so the force loop can then use the list
+ * verbatim. The list is attached to ci.
+ *
+ * @param r The #runner.
+ * @param ci The first #cell.
+ * @param cj The second #cell.
+ * @param sid The direction of the pair.
+ * @param shift The shift vector to apply to the particles in ci.
+ */
+void DOPAIR1_LIST(struct runner *r, struct cell *ci, struct cell *cj,
+                  const int sid, const double *shift) {
+
+  const struct engine *restrict e = r->e;
+  const struct cosmology *restrict cosmo = e->cosmology;
+  struct neighbour_list_arena *restrict lists = &r->neighbour_lists;
+
+  TIMER_TIC;
+
+  /* Get the cutoff shift. */
+  double rshift = 0.0;
+  for (int k = 0; k < 3; k++) rshift += shift[k] * runner_shift[sid][k];
+
+  /* Pick-out the sorted lists. */
+  const struct entry *restrict sort_i = ci->hydro.sort[sid];
+  const struct entry *restrict sort_j = cj->hydro.sort[sid];
+
+  /* Get some other useful values. */
+  const float hj_max = cj->hydro.h_max;
+  const double h_max = max(ci->hydro.h_max, hj_max) * kernel_gamma - rshift;
+  const int count_i = ci->hydro.count;
+  const int count_j = cj->hydro.count;
+  struct part *restrict parts_i = ci->hydro.parts;
+  struct part *restrict parts_j = cj->hydro.parts;
+  const double dj_min = sort_j[0].d;
+  const float dx_max = (ci->hydro.dx_max_sort + cj->hydro.dx_max_sort);
+
+  /* The foreign particles are copies we do not need to update. */
+  const int ci_local = (ci->nodeID == e->nodeID);
+  const int cj_local = (cj->nodeID == e->nodeID);
+
+  /* Cosmological terms */
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+
+  /* Loop over the parts in ci. */
+  for (int pid = count_i - 1;
+       pid >= 0 && sort_i[pid].d + h_max + dx_max > dj_min; pid--) {
+
+    /* Get a hold of the ith part in ci. */
+    const int i = sort_i[pid].i;
+    struct part *restrict pi = &parts_i[i];
+
+    /* Skip inhibited particles. */
+    if (part_is_inhibited(pi, e)) continue;
+
+    const int pi_active = ci_local && part_is_active(pi, e);
+    const float hi = pi->h;
+    const float hig2 = hi * hi * kernel_gamma2;
+
+    /* Is there anything we need to interact with ? */
+    const double di =
+        sort_i[pid].d + max(hi, hj_max) * kernel_gamma + dx_max - rshift;
+    if (di < dj_min) continue;
+
+    /* Get some additional information about pi */
+    const float pix[3] = {(float)(pi->x[0] - (cj->loc[0] + shift[0])),
+                          (float)(pi->x[1] - (cj->loc[1] + shift[1])),
+                          (float)(pi->x[2] - (cj->loc[2] + shift[2]))};
+
+    /* Loop over the parts in cj. */
+    for (int pjd = 0; pjd < count_j && sort_j[pjd].d < di; pjd++) {
+
+      /* Recover pj */
+      const int j = sort_j[pjd].i;
+      struct part *restrict pj = &parts_j[j];
+
+      /* Skip inhibited particles. */
+      if (part_is_inhibited(pj, e)) continue;
+
+      const int pj_active = cj_local && part_is_active(pj, e);
+      if (!pi_active && !pj_active) continue;
+
+      const float hj = pj->h;
+      const float hjg2 = hj * hj * kernel_gamma2;
+
+      /* Compute the pairwise distance. */
+      const float pjx[3] = {(float)(pj->x[0] - cj->loc[0]),
+                            (float)(pj->x[1] - cj->loc[1]),
+                            (float)(pj->x[2] - cj->loc[2])};
+      float dx[3] = {pix[0] - pjx[0], pix[1] - pjx[1], pix[2] - pjx[2]};
+      const float r2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+
+#ifdef SWIFT_DEBUG_CHECKS
+      /* Check that particles have been drifted to the current time */
+      if (pi->ti_drift != e->ti_current)
+        error("Particle pi not drifted to current time");
+      if (pj->ti_drift != e->ti_current)
+        error("Particle pj not drifted to current time");
+#endif
+
+      /* Hit or miss? */
+      if (r2 < hig2 || r2 < hjg2) {
+
+        /* The force loop will need this one */
+        neighbour_list_push(lists, i, j);
+
+        if (pi_active && r2 < hig2) IACT_NONSYM(r2, dx, hi, hj, pi, pj, a, H);
+
+        if (pj_active && r2 < hjg2) {
+          dx[0] = -dx[0];
+          dx[1] = -dx[1];
+          dx[2] = -dx[2];
+          IACT_NONSYM(r2, dx, hj, hi, pj, pi, a, H);
+        }
+      }
+    } /* loop over the parts in cj. */
+  }   /* loop over the parts in ci. */
+
+  neighbour_list_store(lists, &ci->hydro.neighbour_lists,
+                       &ci->hydro.neighbour_lists_generation,
+                       e->launch_generation, cj, sid, 0.f);
+
+  TIMER_TOC(TIMER_DOPAIR);
+}
+
+/**
+ * @brief Compute the cell self-interaction (non-symmetric) and record the
+ * pairs the force loop will need.
+ *
+ * See DOPAIR1_LIST() for the pairs that are recorded.
+ *
+ * @param r The #runner.
+ * @param c The #cell.
+ */
+void DOSELF1_LIST(struct runner *r, struct cell *restrict c) {
+
+  const struct engine *e = r->e;
+  const struct cosmology *cosmo = e->cosmology;
+  struct neighbour_list_arena *restrict lists = &r->neighbour_lists;
+
+  TIMER_TIC;
+
+  const int count = c->hydro.count;
+  struct part *restrict parts = c->hydro.parts;
+
+  /* Cosmological terms */
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+
+  /* Loop over the parts in c. */
+  for (int pid = 0; pid < count; pid++) {
+
+    /* Get a hold of the ith part in c. */
+    struct part *restrict pi = &parts[pid];
+
+    /* Skip inhibited particles. */
+    if (part_is_inhibited(pi, e)) continue;
+
+    const int pi_active = part_is_active(pi, e);
+    const float hi = pi->h;
+    const float hig2 = hi * hi * kernel_gamma2;
+    const float pix[3] = {(float)(pi->x[0] - c->loc[0]),
+                          (float)(pi->x[1] - c->loc[1]),
+                          (float)(pi->x[2] - c->loc[2])};
+
+    /* Loop over the other parts in c. */
+    for (int pjd = pid + 1; pjd < count; pjd++) {
+
+      /* Get a pointer to the jth particle. */
+      struct part *restrict pj = &parts[pjd];
+
+      /* Skip inhibited particles. */
+      if (part_is_inhibited(pj, e)) continue;
+
+      const int pj_active = part_is_active(pj, e);
+      if (!pi_active && !pj_active) continue;
+
+      const float hj = pj->h;
+      const float hjg2 = hj * hj * kernel_gamma2;
+
+      /* Compute the pairwise distance. */
+      const float pjx[3] = {(float)(pj->x[0] - c->loc[0]),
+                            (float)(pj->x[1] - c->loc[1]),
+                            (float)(pj->x[2] - c->loc[2])};
+      float dx[3] = {pix[0] - pjx[0], pix[1] - pjx[1], pix[2] - pjx[2]};
+      const float r2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+
+#ifdef SWIFT_DEBUG_CHECKS
+      /* Check that particles have been drifted to the current time */
+      if (pi->ti_drift != e->ti_current)
+        error("Particle pi not drifted to current time");
+      if (pj->ti_drift != e->ti_current)
+        error("Particle pj not drifted to current time");
+#endif
+
+      /* Hit or miss? */
+      if (r2 < hig2 || r2 < hjg2) {
+
+        /* The force loop will need this one */
+        neighbour_list_push(lists, pid, pjd);
+
+        const int doi = pi_active && (r2 < hig2);
+        const int doj = pj_active && (r2 < hjg2);
+
+        if (doi && doj) {
+          IACT(r2, dx, hi, hj, pi, pj, a, H);
+        } else if (doi) {
+          IACT_NONSYM(r2, dx, hi, hj, pi, pj, a, H);
+        } else if (doj) {
+          dx[0] = -dx[0];
+          dx[1] = -dx[1];
+          dx[2] = -dx[2];
+          IACT_NONSYM(r2, dx, hj, hi, pj, pi, a, H);
+        }
+      }
+    } /* loop over the other parts in c. */
+  }   /* loop over the parts in c. */
+
+  neighbour_list_store(lists, &c->hydro.neighbour_lists,
+                       &c->hydro.neighbour_lists_generation,
+                       e->launch_generation, c, neighbour_list_self,
+                       0.f);
+
+  TIMER_TOC(TIMER_DOSELF);
+}
+
+#endif /* EXTRA_HYDRO_LOOP && TASK_LOOP_GRADIENT */
+
+#if defined(EXTRA_HYDRO_LOOP) && (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
+
+/**
+ * @brief Compute the interactions of a list of pairs recorded by the
+ * gradient loop (symmetric).
+ *
+ * @param r The #runner.
+ * @param ci The first #cell.
+ * @param cj The second #cell (can be ci for the self-interactions).
+ * @param pairs The pairs of particles to interact.
+ * @param count The number of pairs.
+ * @param shift The shift vector to apply to the particles in ci.
+ */
+void DOPAIR2_LIST(struct runner *r, struct cell *ci, struct cell *cj,
+                  const struct neighbour_pair *restrict pairs, const int count,
+                  const double *shift) {
+
+  const struct engine *restrict e = r->e;
+  const struct cosmology *restrict cosmo = e->cosmology;
+
+  /* Not restrict: ci and cj are the same cell for the self-interactions */
+  struct part *parts_i = ci->hydro.parts;
+  struct part *parts_j = cj->hydro.parts;
+
+  /* The foreign particles are copies we do not need to update. */
+  const int ci_local = (ci->nodeID == e->nodeID);
+  const int cj_local = (cj->nodeID == e->nodeID);
+
+  /* Cosmological terms */
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+
+  /* Position of ci in the frame of cj */
+  const double loc_i[3] = {cj->loc[0] + shift[0], cj->loc[1] + shift[1],
+                           cj->loc[2] + shift[2]};
+
+  for (int k = 0; k < count; k++) {
+
+    struct part *pi = &parts_i[pairs[k].i];
+    struct part *pj = &parts_j[pairs[k].j];
+
+    /* Particles may have been removed since the list was built */
+    if (part_is_inhibited(pi, e) || part_is_inhibited(pj, e)) continue;
+
+    const int pi_active = ci_local && part_is_active(pi, e);
+    const int pj_active = cj_local && part_is_active(pj, e);
+    const float hi = pi->h;
+    const float hj = pj->h;
+
+    /* Compute the pairwise distance. */
+    const float pix[3] = {(float)(pi->x[0] - loc_i[0]),
+                          (float)(pi->x[1] - loc_i[1]),
+                          (float)(pi->x[2] - loc_i[2])};
+    const float pjx[3] = {(float)(pj->x[0] - cj->loc[0]),
+                          (float)(pj->x[1] - cj->loc[1]),
+                          (float)(pj->x[2] - cj->loc[2])};
+    float dx[3] = {pix[0] - pjx[0], pix[1] - pjx[1], pix[2] - pjx[2]};
+    const float r2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+
+    if (pi_active && pj_active) {
+      IACT(r2, dx, hi, hj, pi, pj, a, H);
+    } else if (pi_active) {
+      IACT_NONSYM(r2, dx, hi, hj, pi, pj, a, H);
+    } else if (pj_active) {
+      dx[0] = -dx[0];
+      dx[1] = -dx[1];
+      dx[2] = -dx[2];
+      IACT_NONSYM(r2, dx, hj, hi, pj, pi, a, H);
+    }
+  }
+}
+
+#endif /* EXTRA_HYDRO_LOOP && TASK_LOOP_FORCE */
+
 /**
  * @brief Determine which version of DOPAIR1 needs to be called depending on the
  * orientation of the cells or whether DOPAIR1 needs to be called at all.
@@ -1309,6 +1647,12 @@ void DOPAIR1_BRANCH(struct runner *r, struct cell *ci, struct cell *cj) {
   if (!cell_are_part_drifted(ci, e) || !cell_are_part_drifted(cj, e))
     error("Interacting undrifted cells.");
 
+  /* Small pairs are done by brute force, without sorting the cells. */
+  if (cell_pair_skips_hydro_sorts(ci, cj)) {
+    DOPAIR1_NAIVE(r, ci, cj);
+    return;
+  }
+
   /* Get the sort ID. */
   double shift[3] = {0.0, 0.0, 0.0};
   const int sid = space_getsid(e->s, &ci, &cj, shift);
@@ -1366,14 +1710,29 @@ void DOPAIR1_BRANCH(struct runner *r, struct cell *ci, struct cell *cj) {
   }
 #endif /* SWIFT_DEBUG_CHECKS */
 
+#if defined(EXTRA_HYDRO_LOOP) && (FUNCTION_TASK_LOOP == TASK_LOOP_GRADIENT)
+  /* Record the pairs for the force loop while we are at it? */
+  if (e->hydro_properties->neighbour_lists) {
+    DOPAIR1_LIST(r, ci, cj, sid, shift);
+    return;
+  }
+#endif
+
 #if defined(SWIFT_USE_NAIVE_INTERACTIONS)
   DOPAIR1_NAIVE(r, ci, cj);
-#elif defined(WITH_VECTORIZATION) && defined(GADGET2_SPH) && \
+#elif defined(WITH_VECTORIZATION) &&                    \
+    (defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH)) && \
     (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY)
   if (!sort_is_corner(sid))
     runner_dopair1_density_vec(r, ci, cj, sid, shift);
   else
     DOPAIR1(r, ci, cj, sid, shift);
+#elif defined(WITH_VECTORIZATION) && defined(ANARCHY_PU_SPH) && \
+    (FUNCTION_TASK_LOOP == TASK_LOOP_GRADIENT)
+  if (!sort_is_corner(sid))
+    runner_dopair1_gradient_vec(r, ci, cj, sid, shift);
+  else
+    DOPAIR1(r, ci, cj, sid, shift);
 #else
   DOPAIR1(r, ci, cj, sid, shift);
 #endif
@@ -1447,10 +1806,16 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
                              cj->loc[2] + shift[2]};
   const double shift_j[3] = {cj->loc[0], cj->loc[1], cj->loc[2]};
 
+  /* The foreign particles are copies we do not need to update. */
+  const int ci_local = (ci->nodeID == e->nodeID);
+  const int cj_local = (cj->nodeID == e->nodeID);
+
   int count_active_i = 0, count_active_j = 0;
   struct entry *restrict sort_active_i = NULL, *restrict sort_active_j = NULL;
 
-  if (cell_is_all_active_hydro(ci, e)) {
+  if (!ci_local) {
+    /* Nothing to update */
+  } else if (cell_is_all_active_hydro(ci, e)) {
     /* If everybody is active don't bother copying */
     sort_active_i = sort_i;
     count_active_i = count_i;
@@ -1468,7 +1833,9 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
     }
   }
 
-  if (cell_is_all_active_hydro(cj, e)) {
+  if (!cj_local) {
+    /* Nothing to update */
+  } else if (cell_is_all_active_hydro(cj, e)) {
     /* If everybody is active don't bother copying */
     sort_active_j = sort_j;
     count_active_j = count_j;
@@ -1516,7 +1883,7 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
 
     /* Do we need to only check active parts in cj
        (i.e. pi does not need updating) ? */
-    if (!part_is_active(pi, e)) {
+    if (!ci_local || !part_is_active(pi, e)) {
 
       /* Loop over the *active* parts in cj within range of pi */
       for (int pjd = 0; pjd < count_active_j && sort_active_j[pjd].d < di;
@@ -1647,7 +2014,7 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
         if (r2 < hig2) {
 
           /* Does pj need to be updated too? */
-          if (part_is_active(pj, e)) {
+          if (cj_local && part_is_active(pj, e)) {
             IACT(r2, dx, hi, hj, pi, pj, a, H);
 #if (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY)
             runner_iact_chemistry(r2, dx, hi, hj, pi, pj, a, H);
@@ -1695,7 +2062,7 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
 
     /* Do we need to only check active parts in ci
        (i.e. pj does not need updating) ? */
-    if (!part_is_active(pj, e)) {
+    if (!cj_local || !part_is_active(pj, e)) {
 
       /* Loop over the *active* parts in ci. */
       for (int pid = count_active_i - 1;
@@ -1830,7 +2197,7 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
         if (r2 < hjg2 && r2 >= hig2) {
 
           /* Does pi need to be updated too? */
-          if (part_is_active(pi, e)) {
+          if (ci_local && part_is_active(pi, e)) {
             IACT(r2, dx, hj, hi, pj, pi, a, H);
 #if (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY)
             runner_iact_chemistry(r2, dx, hj, hi, pj, pi, a, H);
@@ -1849,14 +2216,52 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
   }     /* Loop over all cj */
 
   /* Clean-up if necessary */
-  if (cell_is_active_hydro(ci, e) && !cell_is_all_active_hydro(ci, e))
+  if (ci_local && cell_is_active_hydro(ci, e) &&
+      !cell_is_all_active_hydro(ci, e))
     free(sort_active_i);
-  if (cell_is_active_hydro(cj, e) && !cell_is_all_active_hydro(cj, e))
+  if (cj_local && cell_is_active_hydro(cj, e) &&
+      !cell_is_all_active_hydro(cj, e))
     free(sort_active_j);
 
   TIMER_TOC(TIMER_DOPAIR);
 }
 
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_LIMITER)
+/**
+ * @brief Can an active #part of a cell wake up a #part of another cell?
+ *
+ * Used by the sparse limiter. The limiter loop only wakes up the inactive
+ * particles whose signal velocity is much smaller than the one of an active
+ * neighbour, so comparing with the largest signal velocity of the active
+ * particles recorded by the end of the force loop is exact.
+ *
+ * @param e The #engine.
+ * @param ci The #cell containing the active particles.
+ * @param cj The #cell containing the particles to wake up.
+ */
+INLINE static int runner_limiter_can_wake(const struct engine *e,
+                                          const struct cell *ci,
+                                          const struct cell *cj) {
+
+  /* Only the local cells have their signal velocities recorded */
+  if (ci->nodeID != e->nodeID || cj->nodeID != e->nodeID) return 1;
+
+  /* No active particle, nobody to wake up */
+  if (ci->hydro.ti_v_sig_max_active != e->ti_current) return 0;
+  const float v_sig_max = ci->hydro.v_sig_max_active;
+
+  const struct part *restrict parts = cj->hydro.parts;
+  for (int k = 0; k < cj->hydro.count; k++) {
+    const struct part *p = &parts[k];
+    if (part_is_inhibited(p, e) || part_is_active(p, e)) continue;
+    if (v_sig_max >
+        const_limiter_max_v_sig_ratio * hydro_get_signal_velocity(p))
+      return 1;
+  }
+  return 0;
+}
+#endif
+
 /**
  * @brief Determine which version of DOPAIR2 needs to be called depending on the
  * orientation of the cells or whether DOPAIR2 needs to be called at all.
@@ -1876,10 +2281,29 @@ void DOPAIR2_BRANCH(struct runner *r, struct cell *ci, struct cell *cj) {
   /* Anything to do here? */
   if (!cell_is_active_hydro(ci, e) && !cell_is_active_hydro(cj, e)) return;
 
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_LIMITER)
+  /* Skip the pairs in which nobody can be woken up */
+  if (e->hydro_properties->sparse_limiter) {
+    const int wake_i = runner_limiter_can_wake(e, cj, ci);
+    const int wake_j = runner_limiter_can_wake(e, ci, cj);
+    if (!wake_i && !wake_j) return;
+
+    /* Let the time-step limiter visit the cells that can be woken up */
+    if (wake_i && ci->nodeID == e->nodeID) cell_mark_for_limiter(ci);
+    if (wake_j && cj->nodeID == e->nodeID) cell_mark_for_limiter(cj);
+  }
+#endif
+
   /* Check that cells are drifted. */
   if (!cell_are_part_drifted(ci, e) || !cell_are_part_drifted(cj, e))
     error("Interacting undrifted cells.");
 
+  /* Small pairs are done by brute force, without sorting the cells. */
+  if (cell_pair_skips_hydro_sorts(ci, cj)) {
+    DOPAIR2_NAIVE(r, ci, cj);
+    return;
+  }
+
   /* Get the sort ID. */
   double shift[3] = {0.0, 0.0, 0.0};
   const int sid = space_getsid(e->s, &ci, &cj, shift);
@@ -1937,9 +2361,26 @@ void DOPAIR2_BRANCH(struct runner *r, struct cell *ci, struct cell *cj) {
   }
 #endif /* SWIFT_DEBUG_CHECKS */
 
+#if defined(EXTRA_HYDRO_LOOP) && (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
+  /* Can we re-use the pairs found by the gradient loop? */
+  if (e->hydro_properties->neighbour_lists) {
+    int count = 0;
+    const struct neighbour_pair *pairs = neighbour_list_get(
+        ci->hydro.neighbour_lists, ci->hydro.neighbour_lists_generation,
+        e->launch_generation, cj, sid, &count);
+    if (pairs != NULL) {
+      TIMER_TIC;
+      DOPAIR2_LIST(r, ci, cj, pairs, count, shift);
+      TIMER_TOC(TIMER_DOPAIR);
+      return;
+    }
+  }
+#endif
+
 #ifdef SWIFT_USE_NAIVE_INTERACTIONS
   DOPAIR2_NAIVE(r, ci, cj);
-#elif defined(WITH_VECTORIZATION) && defined(GADGET2_SPH) && \
+#elif defined(WITH_VECTORIZATION) &&                    \
+    (defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH)) && \
     (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
   if (!sort_is_corner(sid))
     runner_dopair2_force_vec(r, ci, cj, sid, shift);
@@ -2148,11 +2589,23 @@ void DOSELF1_BRANCH(struct runner *r, struct cell *c) {
   /* Check that cells are drifted. */
   if (!cell_are_part_drifted(c, e)) error("Interacting undrifted cell.");
 
+#if defined(EXTRA_HYDRO_LOOP) && (FUNCTION_TASK_LOOP == TASK_LOOP_GRADIENT)
+  /* Record the pairs for the force loop while we are at it? */
+  if (e->hydro_properties->neighbour_lists) {
+    DOSELF1_LIST(r, c);
+    return;
+  }
+#endif
+
 #if defined(SWIFT_USE_NAIVE_INTERACTIONS)
   DOSELF1_NAIVE(r, c);
-#elif defined(WITH_VECTORIZATION) && defined(GADGET2_SPH) && \
+#elif defined(WITH_VECTORIZATION) &&                    \
+    (defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH)) && \
     (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY)
   runner_doself1_density_vec(r, c);
+#elif defined(WITH_VECTORIZATION) && defined(ANARCHY_PU_SPH) && \
+    (FUNCTION_TASK_LOOP == TASK_LOOP_GRADIENT)
+  runner_doself1_gradient_vec(r, c);
 #else
   DOSELF1(r, c);
 #endif
@@ -2333,6 +2786,14 @@ void DOSELF2_BRANCH(struct runner *r, struct cell *c) {
   /* Anything to do here? */
   if (!cell_is_active_hydro(c, e)) return;
 
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_LIMITER)
+  /* Skip the cells in which nobody can be woken up */
+  if (e->hydro_properties->sparse_limiter) {
+    if (!runner_limiter_can_wake(e, c, c)) return;
+    cell_mark_for_limiter(c);
+  }
+#endif
+
   /* Did we mess up the recursion? */
   if (c->hydro.h_max_old * kernel_gamma > c->dmin)
     error("Cell smaller than smoothing length");
@@ -2340,9 +2801,27 @@ void DOSELF2_BRANCH(struct runner *r, struct cell *c) {
   /* Check that cells are drifted. */
   if (!cell_are_part_drifted(c, e)) error("Interacting undrifted cell.");
 
+#if defined(EXTRA_HYDRO_LOOP) && (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
+  /* Can we re-use the pairs found by the gradient loop? */
+  if (e->hydro_properties->neighbour_lists) {
+    int count = 0;
+    const struct neighbour_pair *pairs = neighbour_list_get(
+        c->hydro.neighbour_lists, c->hydro.neighbour_lists_generation,
+        e->launch_generation, c, neighbour_list_self, &count);
+    if (pairs != NULL) {
+      const double shift[3] = {0.0, 0.0, 0.0};
+      TIMER_TIC;
+      DOPAIR2_LIST(r, c, c, pairs, count, shift);
+      TIMER_TOC(TIMER_DOSELF);
+      return;
+    }
+  }
+#endif
+
 #if defined(SWIFT_USE_NAIVE_INTERACTIONS)
   DOSELF2_NAIVE(r, c);
-#elif defined(WITH_VECTORIZATION) && defined(GADGET2_SPH) && \
+#elif defined(WITH_VECTORIZATION) &&                    \
+    (defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH)) && \
     (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
   runner_doself2_force_vec(r, c);
 #else
@@ -2397,18 +2876,20 @@ void DOSUB_PAIR1(struct runner *r, struct cell *ci, struct cell *cj,
       error("Interacting undrifted cells.");
 
     /* Do any of the cells need to be sorted first? */
-    if (!(ci->hydro.sorted & (1 << sid)) ||
-        ci->hydro.dx_max_sort_old > ci->dmin * space_maxreldx)
-      error(
-          "Interacting unsorted cell. ci->hydro.dx_max_sort_old=%e ci->dmin=%e "
-          "ci->sorted=%d sid=%d",
-          ci->hydro.dx_max_sort_old, ci->dmin, ci->hydro.sorted, sid);
-    if (!(cj->hydro.sorted & (1 << sid)) ||
-        cj->hydro.dx_max_sort_old > cj->dmin * space_maxreldx)
-      error(
-          "Interacting unsorted cell. cj->hydro.dx_max_sort_old=%e cj->dmin=%e "
-          "cj->sorted=%d sid=%d",
-          cj->hydro.dx_max_sort_old, cj->dmin, cj->hydro.sorted, sid);
+    if (!cell_pair_skips_hydro_sorts(ci, cj)) {
+      if (!(ci->hydro.sorted & (1 << sid)) ||
+          ci->hydro.dx_max_sort_old > ci->dmin * space_maxreldx)
+        error(
+            "Interacting unsorted cell. ci->hydro.dx_max_sort_old=%e "
+            "ci->dmin=%e ci->sorted=%d sid=%d",
+            ci->hydro.dx_max_sort_old, ci->dmin, ci->hydro.sorted, sid);
+      if (!(cj->hydro.sorted & (1 << sid)) ||
+          cj->hydro.dx_max_sort_old > cj->dmin * space_maxreldx)
+        error(
+            "Interacting unsorted cell. cj->hydro.dx_max_sort_old=%e "
+            "cj->dmin=%e cj->sorted=%d sid=%d",
+            cj->hydro.dx_max_sort_old, cj->dmin, cj->hydro.sorted, sid);
+    }
 
     /* Compute the interactions. */
     DOPAIR1_BRANCH(r, ci, cj);
@@ -2503,18 +2984,20 @@ void DOSUB_PAIR2(struct runner *r, struct cell *ci, struct cell *cj,
       error("Interacting undrifted cells.");
 
     /* Do any of the cells need to be sorted first? */
-    if (!(ci->hydro.sorted & (1 << sid)) ||
-        ci->hydro.dx_max_sort_old > ci->dmin * space_maxreldx)
-      error(
-          "Interacting unsorted cell. ci->hydro.dx_max_sort_old=%e ci->dmin=%e "
-          "ci->sorted=%d sid=%d",
-          ci->hydro.dx_max_sort_old, ci->dmin, ci->hydro.sorted, sid);
-    if (!(cj->hydro.sorted & (1 << sid)) ||
-        cj->hydro.dx_max_sort_old > cj->dmin * space_maxreldx)
-      error(
-          "Interacting unsorted cell. cj->hydro.dx_max_sort_old=%e cj->dmin=%e "
-          "cj->sorted=%d sid=%d",
-          cj->hydro.dx_max_sort_old, cj->dmin, cj->hydro.sorted, sid);
+    if (!cell_pair_skips_hydro_sorts(ci, cj)) {
+      if (!(ci->hydro.sorted & (1 << sid)) ||
+          ci->hydro.dx_max_sort_old > ci->dmin * space_maxreldx)
+        error(
+            "Interacting unsorted cell. ci->hydro.dx_max_sort_old=%e "
+            "ci->dmin=%e ci->sorted=%d sid=%d",
+            ci->hydro.dx_max_sort_old, ci->dmin, ci->hydro.sorted, sid);
+      if (!(cj->hydro.sorted & (1 << sid)) ||
+          cj->hydro.dx_max_sort_old > cj->dmin * space_maxreldx)
+        error(
+            "Interacting unsorted cell. cj->hydro.dx_max_sort_old=%e "
+            "cj->dmin=%e cj->sorted=%d sid=%d",
+            cj->hydro.dx_max_sort_old, cj->dmin, cj->hydro.sorted, sid);
+    }
 
     /* Compute the interactions. */
     DOPAIR2_BRANCH(r, ci, cj);
@@ -129,7 +129,7 @@ static INLINE void runner_do_grav_down(struct runner *r, struct cell *c,
           error("Adding forces to an un-initialised gpart.");
 #endif
         /* Apply the kernel */
-        gravity_L2P(pot, CoM, gp);
+        gravity_L2P(pot, CoM, gp, e->gravity_properties);
       }
     }
   }
@@ -137,12 +137,116 @@ static INLINE void runner_do_grav_down(struct runner *r, struct cell *c,
   if (timer) TIMER_TOC(timer_dograv_down);
 }
 
+#ifdef WITH_VECTORIZATION
+
+/**
+ * @brief Compute the gravity interactions of one particle with all the
+ * particles of a #gravity_cache using explicit vector instructions.
+ *
+ * This is the hand-vectorized counterpart of the inner loops over the j cache
+ * of the runner_dopair_grav_pp_*() and runner_doself_grav_pp_*() functions.
+ * Padded entries of the cache have zero mass and hence do not contribute.
+ *
+ * @param cj_cache #gravity_cache contaning the source particles.
+ * @param gcount_padded_j The number of particles in the cache padded to the
+ * vector length.
+ * @param pid_self Index of the particle i in the cache for self-interactions,
+ * -1 otherwise.
+ * @param x_i The x-coordinate of the particle i.
+ * @param y_i The y-coordinate of the particle i.
+ * @param z_i The z-coordinate of the particle i.
+ * @param h2_i Square of the softening length of the particle i.
+ * @param h_inv_i Inverse of the softening length of the particle i.
+ * @param h_inv3_i Cube of the inverse of the softening length of particle i.
+ * @param truncated Are we using the truncated (long-range corrected) force?
+ * @param periodic Do we need to apply periodic wrapping?
+ * @param dim The size of the simulation volume (only used if periodic).
+ * @param r_s_inv The inverse of the gravity-mesh smoothing-scale (only used if
+ * truncated).
+ * @param a_x (return) The x-component of the acceleration to update.
+ * @param a_y (return) The y-component of the acceleration to update.
+ * @param a_z (return) The z-component of the acceleration to update.
+ * @param pot (return) The potential to update.
+ */
+__attribute__((always_inline)) INLINE static void runner_grav_pp_vec(
+    const struct gravity_cache *restrict cj_cache, const int gcount_padded_j,
+    const int pid_self, const float x_i, const float y_i, const float z_i,
+    const float h2_i, const float h_inv_i, const float h_inv3_i,
+    const int truncated, const int periodic, const float *dim,
+    const float r_s_inv, float *a_x, float *a_y, float *a_z, float *pot) {
+
+  const vector v_x_i = vector_set1(x_i);
+  const vector v_y_i = vector_set1(y_i);
+  const vector v_z_i = vector_set1(z_i);
+  const vector v_h2_i = vector_set1(h2_i);
+  const vector v_h_inv_i = vector_set1(h_inv_i);
+  const vector v_h_inv3_i = vector_set1(h_inv3_i);
+  const vector v_r_s_inv = vector_set1(r_s_inv);
+
+  /* Local accumulators for the acceleration and potential */
+  vector v_a_x = vector_setzero();
+  vector v_a_y = vector_setzero();
+  vector v_a_z = vector_setzero();
+  vector v_pot = vector_setzero();
+
+  /* Loop over every particle in the other cell one vector at a time. */
+  for (int pjd = 0; pjd < gcount_padded_j; pjd += VEC_SIZE) {
+
+    /* Get info about j */
+    vector dx, dy, dz, mass_j;
+    dx.v = vec_sub(vec_load(&cj_cache->x[pjd]), v_x_i.v);
+    dy.v = vec_sub(vec_load(&cj_cache->y[pjd]), v_y_i.v);
+    dz.v = vec_sub(vec_load(&cj_cache->z[pjd]), v_z_i.v);
+    mass_j.v = vec_load(&cj_cache->m[pjd]);
+
+    /* No self interaction */
+    if (pid_self >= pjd && pid_self < pjd + VEC_SIZE)
+      mass_j.f[pid_self - pjd] = 0.f;
+
+    /* Correct for periodic BCs */
+    if (periodic) {
+      dx = nearestf_vec(dx, dim[0]);
+      dy = nearestf_vec(dy, dim[1]);
+      dz = nearestf_vec(dz, dim[2]);
+    }
+
+    vector r2;
+    r2.v = vec_mul(dx.v, dx.v);
+    r2.v = vec_fma(dy.v, dy.v, r2.v);
+    r2.v = vec_fma(dz.v, dz.v, r2.v);
+
+    /* Interact! */
+    vector f_ij, pot_ij;
+    if (truncated)
+      runner_iact_grav_pp_truncated_vec(&r2, &v_h2_i, &v_h_inv_i, &v_h_inv3_i,
+                                        &mass_j, &v_r_s_inv, &f_ij, &pot_ij);
+    else
+      runner_iact_grav_pp_full_vec(&r2, &v_h2_i, &v_h_inv_i, &v_h_inv3_i,
+                                   &mass_j, &f_ij, &pot_ij);
+
+    /* Store it back */
+    v_a_x.v = vec_fma(f_ij.v, dx.v, v_a_x.v);
+    v_a_y.v = vec_fma(f_ij.v, dy.v, v_a_y.v);
+    v_a_z.v = vec_fma(f_ij.v, dz.v, v_a_z.v);
+    v_pot.v = vec_add(pot_ij.v, v_pot.v);
+  }
+
+  /* Reduce the accumulators */
+  VEC_HADD(v_a_x, *a_x);
+  VEC_HADD(v_a_y, *a_y);
+  VEC_HADD(v_a_z, *a_z);
+  VEC_HADD(v_pot, *pot);
+}
+
+#endif /* WITH_VECTORIZATION */
+
 /**
  * @brief Compute the non-truncated gravity interactions between all particles
  * of a cell and the particles of the other cell.
  *
  * The calculation is performed non-symmetrically using the pre-filled
- * #gravity_cache structures. The loop over the j cache should auto-vectorize.
+ * #gravity_cache structures. The loop over the j cache uses explicit vector
+ * instructions when available and should otherwise auto-vectorize.
  *
  * @param ci_cache #gravity_cache contaning the particles to be updated.
  * @param cj_cache #gravity_cache contaning the source particles.
@@ -192,6 +296,15 @@ static INLINE void runner_dopair_grav_pp_full(
     /* Local accumulators for the acceleration and potential */
     float a_x = 0.f, a_y = 0.f, a_z = 0.f, pot = 0.f;
 
+#if defined(WITH_VECTORIZATION) && !defined(SWIFT_DEBUG_CHECKS)
+
+    /* Use the explicitly vectorized loop */
+    runner_grav_pp_vec(cj_cache, gcount_padded_j, -1, x_i, y_i, z_i, h2_i,
+                       h_inv_i, h_inv3_i, 0, periodic, dim, 0.f, &a_x,
+                       &a_y, &a_z, &pot);
+
+#else
+
     /* Make the compiler understand we are in happy vectorization land */
     swift_align_information(float, cj_cache->x, SWIFT_CACHE_ALIGNMENT);
     swift_align_information(float, cj_cache->y, SWIFT_CACHE_ALIGNMENT);
@@ -264,6 +377,7 @@ static INLINE void runner_dopair_grav_pp_full(
         gparts_i[pid].num_interacted++;
 #endif
     }
+#endif /* WITH_VECTORIZATION && !SWIFT_DEBUG_CHECKS */
 
     /* Store everything back in cache */
     ci_cache->a_x[pid] += a_x;
@@ -278,7 +392,8 @@ static INLINE void runner_dopair_grav_pp_full(
  * of a cell and the particles of the other cell.
  *
  * The calculation is performed non-symmetrically using the pre-filled
- * #gravity_cache structures. The loop over the j cache should auto-vectorize.
+ * #gravity_cache structures. The loop over the j cache uses explicit vector
+ * instructions when available and should otherwise auto-vectorize.
  *
  * This function only makes sense in periodic BCs.
  *
@@ -335,6 +450,15 @@ static INLINE void runner_dopair_grav_pp_truncated(
     /* Local accumulators for the acceleration and potential */
     float a_x = 0.f, a_y = 0.f, a_z = 0.f, pot = 0.f;
 
+#if defined(WITH_VECTORIZATION) && !defined(SWIFT_DEBUG_CHECKS)
+
+    /* Use the explicitly vectorized loop */
+    runner_grav_pp_vec(cj_cache, gcount_padded_j, -1, x_i, y_i, z_i, h2_i,
+                       h_inv_i, h_inv3_i, 1, 1, dim, r_s_inv, &a_x,
+                       &a_y, &a_z, &pot);
+
+#else
+
     /* Make the compiler understand we are in happy vectorization land */
     swift_align_information(float, cj_cache->x, SWIFT_CACHE_ALIGNMENT);
     swift_align_information(float, cj_cache->y, SWIFT_CACHE_ALIGNMENT);
@@ -405,6 +529,7 @@ static INLINE void runner_dopair_grav_pp_truncated(
         gparts_i[pid].num_interacted++;
 #endif
     }
+#endif /* WITH_VECTORIZATION && !SWIFT_DEBUG_CHECKS */
 
     /* Store everything back in cache */
     ci_cache->a_x[pid] += a_x;
@@ -684,15 +809,24 @@ static INLINE void runner_dopair_grav_pm_truncated(
  * cells and then call the specialised functions doing the actual work on
  * the caches. It then write the data back to the particles.
  *
+ * If the caches are kept resident, a cache already holding ci (or cj) from
+ * the previous pair is re-used as-is and only its M2P flags are updated.
+ * The accelerations then keep accumulating in the cache and are only written
+ * back when the cache is flushed (see gravity_cache_flush()).
+ *
  * @param r The #runner.
  * @param ci The first #cell.
  * @param cj The other #cell.
  * @param symmetric Are we updating both cells (1) or just ci (0) ?
  * @param allow_mpole Are we allowing the use of P2M interactions ?
+ * @param resident Are we keeping the caches resident across pairs ?
  */
-static INLINE void runner_dopair_grav_pp(struct runner *r, struct cell *ci,
-                                         struct cell *cj, const int symmetric,
-                                         const int allow_mpole) {
+static INLINE void runner_dopair_grav_pp_caches(struct runner *r,
+                                                struct cell *ci,
+                                                struct cell *cj,
+                                                const int symmetric,
+                                                const int allow_mpole,
+                                                const int resident) {
 
   /* Recover some useful constants */
   const struct engine *e = r->e;
@@ -762,13 +896,33 @@ static INLINE void runner_dopair_grav_pp(struct runner *r, struct cell *ci,
           gcount_j);
 #endif
 
-  /* Fill the caches */
-  gravity_cache_populate(e->max_active_bin, allow_mpole, periodic, dim,
-                         ci_cache, ci->grav.parts, gcount_i, gcount_padded_i,
-                         shift_i, CoM_j, rmax2_j, ci, e->gravity_properties);
-  gravity_cache_populate(e->max_active_bin, allow_mpole, periodic, dim,
-                         cj_cache, cj->grav.parts, gcount_j, gcount_padded_j,
-                         shift_j, CoM_i, rmax2_i, cj, e->gravity_properties);
+  /* Fill the caches (or re-use the ones of the previous pair) */
+  if (!resident) {
+    gravity_cache_flush(ci_cache);
+    gravity_cache_flush(cj_cache);
+  }
+
+  if (resident && ci_cache->cell == ci) {
+    gravity_cache_refresh_mpole(allow_mpole, periodic, dim, ci_cache, gcount_i,
+                                CoM_j, rmax2_j, e->gravity_properties);
+  } else {
+    gravity_cache_flush(ci_cache);
+    gravity_cache_populate(e->max_active_bin, allow_mpole, periodic, dim,
+                           ci_cache, ci->grav.parts, gcount_i, gcount_padded_i,
+                           shift_i, CoM_j, rmax2_j, ci, e->gravity_properties);
+    if (resident) ci_cache->cell = ci;
+  }
+
+  if (resident && cj_cache->cell == cj) {
+    gravity_cache_refresh_mpole(allow_mpole, periodic, dim, cj_cache, gcount_j,
+                                CoM_i, rmax2_i, e->gravity_properties);
+  } else {
+    gravity_cache_flush(cj_cache);
+    gravity_cache_populate(e->max_active_bin, allow_mpole, periodic, dim,
+                           cj_cache, cj->grav.parts, gcount_j, gcount_padded_j,
+                           shift_j, CoM_i, rmax2_i, cj, e->gravity_properties);
+    if (resident) cj_cache->cell = cj;
+  }
 
   /* Can we use the Newtonian version or do we need the truncated one ? */
   if (!periodic) {
@@ -880,20 +1034,62 @@ static INLINE void runner_dopair_grav_pp(struct runner *r, struct cell *ci,
     }
   }
 
-  /* Write back to the particles */
-  if (ci_active) gravity_cache_write_back(ci_cache, ci->grav.parts, gcount_i);
-  if (cj_active && symmetric)
-    gravity_cache_write_back(cj_cache, cj->grav.parts, gcount_j);
+  /* Write back to the particles (or defer it to the flush of the cache) */
+  if (resident) {
+    if (ci_active) ci_cache->write_back = 1;
+    if (cj_active && symmetric) cj_cache->write_back = 1;
+  } else {
+    if (ci_active)
+      gravity_cache_write_back(ci_cache, ci->grav.parts, gcount_i);
+    if (cj_active && symmetric)
+      gravity_cache_write_back(cj_cache, cj->grav.parts, gcount_j);
+  }
 
   TIMER_TOC(timer_dopair_grav_pp);
 }
 
+/**
+ * @brief Computes the interaction of all the particles in a cell with all the
+ * particles of another cell and writes the result back to the particles.
+ *
+ * See runner_dopair_grav_pp_caches().
+ *
+ * @param r The #runner.
+ * @param ci The first #cell.
+ * @param cj The other #cell.
+ * @param symmetric Are we updating both cells (1) or just ci (0) ?
+ * @param allow_mpole Are we allowing the use of P2M interactions ?
+ */
+static INLINE void runner_dopair_grav_pp(struct runner *r, struct cell *ci,
+                                         struct cell *cj, const int symmetric,
+                                         const int allow_mpole) {
+
+  runner_dopair_grav_pp_caches(r, ci, cj, symmetric, allow_mpole,
+                               /*resident=*/0);
+}
+
+/**
+ * @brief Writes back the content of the resident gravity caches of a
+ * #runner to the particles.
+ *
+ * Must be called at the end of any task that may have kept the caches
+ * resident.
+ *
+ * @param r The #runner.
+ */
+static INLINE void runner_flush_grav_caches(struct runner *r) {
+
+  gravity_cache_flush(&r->ci_gravity_cache);
+  gravity_cache_flush(&r->cj_gravity_cache);
+}
+
 /**
  * @brief Compute the non-truncated gravity interactions between all particles
  * of a cell and the particles of the other cell.
  *
  * The calculation is performed non-symmetrically using the pre-filled
- * #gravity_cache structures. The loop over the j cache should auto-vectorize.
+ * #gravity_cache structures. The loop over the j cache uses explicit vector
+ * instructions when available and should otherwise auto-vectorize.
  *
  * @param ci_cache #gravity_cache contaning the particles to be updated.
  * @param gcount The number of particles in the cell.
@@ -926,6 +1122,15 @@ static INLINE void runner_doself_grav_pp_full(
     /* Local accumulators for the acceleration */
     float a_x = 0.f, a_y = 0.f, a_z = 0.f, pot = 0.f;
 
+#if defined(WITH_VECTORIZATION) && !defined(SWIFT_DEBUG_CHECKS)
+
+    /* Use the explicitly vectorized loop */
+    runner_grav_pp_vec(ci_cache, gcount_padded, pid, x_i, y_i, z_i, h2_i,
+                       h_inv_i, h_inv3_i, 0, 0, NULL, 0.f, &a_x,
+                       &a_y, &a_z, &pot);
+
+#else
+
     /* Make the compiler understand we are in happy vectorization land */
     swift_align_information(float, ci_cache->x, SWIFT_CACHE_ALIGNMENT);
     swift_align_information(float, ci_cache->y, SWIFT_CACHE_ALIGNMENT);
@@ -993,6 +1198,7 @@ static INLINE void runner_doself_grav_pp_full(
         gparts[pid].num_interacted++;
 #endif
     }
+#endif /* WITH_VECTORIZATION && !SWIFT_DEBUG_CHECKS */
 
     /* Store everything back in cache */
     ci_cache->a_x[pid] += a_x;
@@ -1007,7 +1213,8 @@ static INLINE void runner_doself_grav_pp_full(
  * of a cell and the particles of the other cell.
  *
  * The calculation is performed non-symmetrically using the pre-filled
- * #gravity_cache structures. The loop over the j cache should auto-vectorize.
+ * #gravity_cache structures. The loop over the j cache uses explicit vector
+ * instructions when available and should otherwise auto-vectorize.
  *
  * This function only makes sense in periodic BCs.
  *
@@ -1049,6 +1256,15 @@ static INLINE void runner_doself_grav_pp_truncated(
     /* Local accumulators for the acceleration and potential */
     float a_x = 0.f, a_y = 0.f, a_z = 0.f, pot = 0.f;
 
+#if defined(WITH_VECTORIZATION) && !defined(SWIFT_DEBUG_CHECKS)
+
+    /* Use the explicitly vectorized loop */
+    runner_grav_pp_vec(ci_cache, gcount_padded, pid, x_i, y_i, z_i, h2_i,
+                       h_inv_i, h_inv3_i, 1, 0, NULL, r_s_inv, &a_x,
+                       &a_y, &a_z, &pot);
+
+#else
+
     /* Make the compiler understand we are in happy vectorization land */
     swift_align_information(float, ci_cache->x, SWIFT_CACHE_ALIGNMENT);
     swift_align_information(float, ci_cache->y, SWIFT_CACHE_ALIGNMENT);
@@ -1117,6 +1333,7 @@ static INLINE void runner_doself_grav_pp_truncated(
         gparts[pid].num_interacted++;
 #endif
     }
+#endif /* WITH_VECTORIZATION && !SWIFT_DEBUG_CHECKS */
 
     /* Store everything back in cache */
     ci_cache->a_x[pid] += a_x;
@@ -1166,6 +1383,9 @@ static INLINE void runner_doself_grav_pp(struct runner *r, struct cell *c) {
   /* Start by constructing a cache for the particles */
   struct gravity_cache *const ci_cache = &r->ci_gravity_cache;
 
+  /* Release the cache if it was kept by a previous pair */
+  gravity_cache_flush(ci_cache);
+
   /* Shift to apply to the particles in the cell */
   const double loc[3] = {c->loc[0] + 0.5 * c->width[0],
                          c->loc[1] + 0.5 * c->width[1],
@@ -1335,6 +1555,52 @@ static INLINE void runner_dopair_grav_mm_nonsym(
   TIMER_TOC(timer_dopair_grav_mm);
 }
 
+/**
+ * @brief Computes the interaction of the field tensor in a cell with the
+ * multipoles of a list of other cells.
+ *
+ * @param r The #runner.
+ * @param ci The #cell with field tensor to interact.
+ * @param multi_j The list of multipoles (at most gravity_M2L_batch_size).
+ * @param count The number of multipoles in the list.
+ */
+static INLINE void runner_dopair_grav_mm_batch(
+    struct runner *r, struct cell *restrict ci,
+    const struct gravity_tensors *const *multi_j, const int count) {
+
+  /* Some constants */
+  const struct engine *e = r->e;
+  const struct gravity_props *props = e->gravity_properties;
+  const int periodic = e->mesh->periodic;
+  const double dim[3] = {e->mesh->dim[0], e->mesh->dim[1], e->mesh->dim[2]};
+  const float r_s_inv = e->mesh->r_s_inv;
+
+  TIMER_TIC;
+
+  /* Anything to do here? */
+  if (!cell_is_active_gravity_mm(ci, e) || ci->nodeID != engine_rank) return;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (ci->grav.multipole->pot.ti_init != e->ti_current)
+    error("ci->grav tensor not initialised.");
+
+  for (int k = 0; k < count; ++k) {
+    if (multi_j[k] == ci->grav.multipole)
+      error("Interacting a cell with itself using M2L");
+
+    if (multi_j[k]->m_pole.num_gpart == 0)
+      error("Multipole does not seem to have been set.");
+  }
+#endif
+
+  /* Let's interact at this level */
+  gravity_M2L_nonsym_batch(&ci->grav.multipole->pot, multi_j, count,
+                           ci->grav.multipole->CoM, props, periodic, dim,
+                           r_s_inv);
+
+  TIMER_TOC(timer_dopair_grav_mm);
+}
+
 /**
  * @brief Call the M-M calculation on two cells if active.
  *
@@ -1355,8 +1621,8 @@ static INLINE void runner_dopair_grav_mm(struct runner *r,
       cell_is_active_gravity_mm(cj, e) && (cj->nodeID == e->nodeID);
 
   /* Do we need drifting first? */
-  if (ci->grav.ti_old_multipole < e->ti_current) cell_drift_multipole(ci, e);
-  if (cj->grav.ti_old_multipole < e->ti_current) cell_drift_multipole(cj, e);
+  cell_drift_multipole_on_use(ci, e);
+  cell_drift_multipole_on_use(cj, e);
 
   /* Interact! */
   if (do_i && do_j)
@@ -1443,6 +1709,9 @@ static INLINE void runner_dopair_recursive_grav_pm(struct runner *r,
     /* Cache to play with */
     struct gravity_cache *const ci_cache = &r->ci_gravity_cache;
 
+    /* Release the cache if it was kept by a previous pair */
+    gravity_cache_flush(ci_cache);
+
     /* Computed the padded counts */
     const int gcount_i = ci->grav.count;
     const int gcount_padded_i = gcount_i - (gcount_i % VEC_SIZE) + VEC_SIZE;
@@ -1508,7 +1777,6 @@ static INLINE void runner_dopair_recursive_grav(struct runner *r,
   const int nodeID = e->nodeID;
   const int periodic = e->mesh->periodic;
   const double dim[3] = {e->mesh->dim[0], e->mesh->dim[1], e->mesh->dim[2]};
-  const double theta_crit2 = e->gravity_properties->theta_crit2;
   const double max_distance = e->mesh->r_cut_max;
 
   /* Anything to do here? */
@@ -1575,7 +1843,8 @@ static INLINE void runner_dopair_recursive_grav(struct runner *r,
    * option... */
 
   /* Can we use M-M interactions ? */
-  if (gravity_M2L_accept(multi_i->r_max, multi_j->r_max, theta_crit2, r2)) {
+  if (gravity_M2L_accept_adaptive(e->gravity_properties, multi_i, multi_j,
+                                  multi_i->r_max, multi_j->r_max, r2)) {
 
     /* Go M-M */
     runner_dopair_grav_mm(r, ci, cj);
@@ -1583,7 +1852,8 @@ static INLINE void runner_dopair_recursive_grav(struct runner *r,
   } else if (!ci->split && !cj->split) {
 
     /* We have two leaves. Go P-P. */
-    runner_dopair_grav_pp(r, ci, cj, /*symmetric*/ 1, /*allow_mpoles*/ 1);
+    runner_dopair_grav_pp_caches(r, ci, cj, /*symmetric*/ 1, /*allow_mpoles*/ 1,
+                                 e->gravity_properties->use_resident_caches);
 
   } else {
 
@@ -1698,10 +1968,114 @@ static INLINE void runner_doself_recursive_grav(struct runner *r,
   if (gettimer) TIMER_TOC(timer_dosub_self_grav);
 }
 
+/**
+ * @brief Performs the M-M interaction between a cell and another top-level
+ * cell if they are far enough, adding it to the current batch of M-M
+ * interactions of the cell.
+ *
+ * @param r The thread #runner.
+ * @param ci The #cell of interest.
+ * @param top The top-level (great-)parent of ci.
+ * @param cj The other top-level #cell.
+ * @param batch The list of multipoles to interact with ci.
+ * @param nr_batch (return) The number of multipoles in the list.
+ */
+__attribute__((always_inline)) INLINE static void
+runner_do_grav_long_range_pair(struct runner *r, struct cell *ci,
+                               const struct cell *top, struct cell *cj,
+                               const struct gravity_tensors **batch,
+                               int *nr_batch) {
+
+  /* Some constants */
+  const struct engine *e = r->e;
+  const int periodic = e->mesh->periodic;
+  const double dim[3] = {e->mesh->dim[0], e->mesh->dim[1], e->mesh->dim[2]};
+  const double theta_crit2 = e->gravity_properties->theta_crit2;
+  const double max_distance2 = e->mesh->r_cut_max * e->mesh->r_cut_max;
+
+  struct gravity_tensors *const multi_i = ci->grav.multipole;
+  const struct gravity_tensors *const multi_top = top->grav.multipole;
+  const struct gravity_tensors *const multi_j = cj->grav.multipole;
+
+  /* Avoid self contributions */
+  if (top == cj) return;
+
+  /* Skip empty cells */
+  if (multi_j->m_pole.M_000 == 0.f) return;
+
+  /* Can we escape early in the periodic BC case? */
+  if (periodic) {
+
+    /* Minimal distance between any pair of particles */
+    const double min_radius2 = cell_min_dist2_same_size(top, cj, periodic, dim);
+
+    /* Are we beyond the distance where the truncated forces are 0 ?*/
+    if (min_radius2 > max_distance2) {
+
+#ifdef SWIFT_DEBUG_CHECKS
+      /* Need to account for the interactions we missed */
+      multi_i->pot.num_interacted += multi_j->m_pole.num_gpart;
+#endif
+
+      /* Record that this multipole received a contribution */
+      multi_i->pot.interacted = 1;
+
+      /* We are done here. */
+      return;
+    }
+  }
+
+  /* Get the distance between the CoMs at the last rebuild*/
+  double dx_r = multi_top->CoM_rebuild[0] - multi_j->CoM_rebuild[0];
+  double dy_r = multi_top->CoM_rebuild[1] - multi_j->CoM_rebuild[1];
+  double dz_r = multi_top->CoM_rebuild[2] - multi_j->CoM_rebuild[2];
+
+  /* Apply BC */
+  if (periodic) {
+    dx_r = nearest(dx_r, dim[0]);
+    dy_r = nearest(dy_r, dim[1]);
+    dz_r = nearest(dz_r, dim[2]);
+  }
+  const double r2_rebuild = dx_r * dx_r + dy_r * dy_r + dz_r * dz_r;
+
+  /* Are we in charge of this cell pair? */
+  if (gravity_M2L_accept(multi_top->r_max_rebuild, multi_j->r_max_rebuild,
+                         theta_crit2, r2_rebuild)) {
+
+    /* The top-level multipoles are only drifted when they are used */
+    cell_drift_multipole_on_use(cj, e);
+
+    /* Add it to the list of M-M interactions of ci */
+    batch[(*nr_batch)++] = multi_j;
+    if (*nr_batch == gravity_M2L_batch_size) {
+      runner_dopair_grav_mm_batch(r, ci, batch, *nr_batch);
+      *nr_batch = 0;
+    }
+
+    /* Record that this multipole received a contribution */
+    multi_i->pot.interacted = 1;
+
+  } /* We are in charge of this pair */
+}
+
+/**
+ * @brief Distance between two indices on a periodic grid.
+ */
+__attribute__((always_inline, const)) INLINE static int
+runner_grav_periodic_index_dist(const int i, const int j, const int n) {
+  const int d = abs(i - j);
+  return min(d, n - d);
+}
+
 /**
  * @brief Performs all M-M interactions between a given top-level cell and all
  * the other top-levels that are far enough.
  *
+ * In the periodic case, the top-level cells beyond the truncation radius of
+ * the long-range forces only need to be counted, so we only visit the cells
+ * that are close enough along each axis. They are visited in the same order
+ * as in the list of top-level cells with particles.
+ *
  * @param r The thread #runner.
  * @param ci The #cell of interest.
  * @param timer Are we timing this ?
@@ -1711,17 +2085,15 @@ static INLINE void runner_do_grav_long_range(struct runner *r, struct cell *ci,
 
   /* Some constants */
   const struct engine *e = r->e;
+  const struct space *s = e->s;
   const int periodic = e->mesh->periodic;
-  const double dim[3] = {e->mesh->dim[0], e->mesh->dim[1], e->mesh->dim[2]};
-  const double theta_crit2 = e->gravity_properties->theta_crit2;
-  const double max_distance2 = e->mesh->r_cut_max * e->mesh->r_cut_max;
 
   TIMER_TIC;
 
   /* Recover the list of top-level cells */
-  struct cell *cells = e->s->cells_top;
-  int *cells_with_particles = e->s->cells_with_particles_top;
-  const int nr_cells_with_particles = e->s->nr_cells_with_particles;
+  struct cell *cells = s->cells_top;
+  int *cells_with_particles = s->cells_with_particles_top;
+  const int nr_cells_with_particles = s->nr_cells_with_particles;
 
   /* Anything to do here? */
   if (!cell_is_active_gravity(ci, e)) return;
@@ -1729,85 +2101,87 @@ static INLINE void runner_do_grav_long_range(struct runner *r, struct cell *ci,
   if (ci->nodeID != engine_rank)
     error("Non-local cell in long-range gravity task!");
 
-  /* Check multipole has been drifted */
-  if (ci->grav.ti_old_multipole < e->ti_current) cell_drift_multipole(ci, e);
-
-  /* Get this cell's multipole information */
-  struct gravity_tensors *const multi_i = ci->grav.multipole;
+  /* Drift the multipole if not done yet */
+  cell_drift_multipole_on_use(ci, e);
 
   /* Find this cell's top-level (great-)parent */
   struct cell *top = ci;
   while (top->parent != NULL) top = top->parent;
 
-  /* Recover the top-level multipole (for distance checks) */
-  struct gravity_tensors *const multi_top = top->grav.multipole;
-  const double CoM_rebuild_top[3] = {multi_top->CoM_rebuild[0],
-                                     multi_top->CoM_rebuild[1],
-                                     multi_top->CoM_rebuild[2]};
-
-  /* Loop over all the top-level cells and go for a M-M interaction if
-   * well-separated */
-  for (int n = 0; n < nr_cells_with_particles; ++n) {
+  /* The multipoles to interact with, processed in batches */
+  const struct gravity_tensors *batch[gravity_M2L_batch_size];
+  int nr_batch = 0;
 
-    /* Handle on the top-level cell and it's gravity business*/
-    const struct cell *cj = &cells[cells_with_particles[n]];
-    const struct gravity_tensors *const multi_j = cj->grav.multipole;
-
-    /* Avoid self contributions */
-    if (top == cj) continue;
-
-    /* Skip empty cells */
-    if (multi_j->m_pole.M_000 == 0.f) continue;
+  if (periodic) {
 
-    /* Can we escape early in the periodic BC case? */
-    if (periodic) {
+    /* Get the position of the top-level cell on the grid */
+    const int *cdim = s->cdim;
+    const int top_cid = top - cells;
+    const int top_ind[3] = {top_cid / (cdim[1] * cdim[2]),
+                            (top_cid / cdim[2]) % cdim[1], top_cid % cdim[2]};
+
+    /* Maximal distance (in number of cells) along each axis of the cells
+     * within the truncation radius (safe side) */
+    int range[3];
+    for (int k = 0; k < 3; ++k)
+      range[k] = (int)(e->mesh->r_cut_max * s->iwidth[k]) + 2;
+
+    /* Loop over the top-level cells close enough and go for a M-M interaction
+     * if well-separated */
+    for (int i = 0; i < cdim[0]; ++i) {
+      if (runner_grav_periodic_index_dist(i, top_ind[0], cdim[0]) > range[0])
+        continue;
+      for (int j = 0; j < cdim[1]; ++j) {
+        if (runner_grav_periodic_index_dist(j, top_ind[1], cdim[1]) > range[1])
+          continue;
+        for (int k = 0; k < cdim[2]; ++k) {
+          if (runner_grav_periodic_index_dist(k, top_ind[2], cdim[2]) >
+              range[2])
+            continue;
+
+          struct cell *cj = &cells[cell_getid(cdim, i, j, k)];
+          runner_do_grav_long_range_pair(r, ci, top, cj, batch, &nr_batch);
+        }
+      }
+    }
 
-      /* Minimal distance between any pair of particles */
-      const double min_radius2 =
-          cell_min_dist2_same_size(top, cj, periodic, dim);
+    /* Are there cells beyond the truncation radius? */
+    if (2 * range[0] + 1 < cdim[0] || 2 * range[1] + 1 < cdim[1] ||
+        2 * range[2] + 1 < cdim[2]) {
 
-      /* Are we beyond the distance where the truncated forces are 0 ?*/
-      if (min_radius2 > max_distance2) {
+      /* Record that this multipole received a contribution */
+      ci->grav.multipole->pot.interacted = 1;
 
 #ifdef SWIFT_DEBUG_CHECKS
-        /* Need to account for the interactions we missed */
-        multi_i->pot.num_interacted += multi_j->m_pole.num_gpart;
-#endif
-
-        /* Record that this multipole received a contribution */
-        multi_i->pot.interacted = 1;
-
-        /* We are done here. */
-        continue;
+      /* Need to account for the interactions we missed */
+      for (int n = 0; n < nr_cells_with_particles; ++n) {
+        const int cid = cells_with_particles[n];
+        const struct cell *cj = &cells[cid];
+        if (cj == top || cj->grav.multipole->m_pole.M_000 == 0.f) continue;
+        if (runner_grav_periodic_index_dist(cid / (cdim[1] * cdim[2]),
+                                            top_ind[0], cdim[0]) > range[0] ||
+            runner_grav_periodic_index_dist((cid / cdim[2]) % cdim[1],
+                                            top_ind[1], cdim[1]) > range[1] ||
+            runner_grav_periodic_index_dist(cid % cdim[2], top_ind[2],
+                                            cdim[2]) > range[2])
+          ci->grav.multipole->pot.num_interacted +=
+              cj->grav.multipole->m_pole.num_gpart;
       }
+#endif
     }
 
-    /* Get the distance between the CoMs at the last rebuild*/
-    double dx_r = CoM_rebuild_top[0] - multi_j->CoM_rebuild[0];
-    double dy_r = CoM_rebuild_top[1] - multi_j->CoM_rebuild[1];
-    double dz_r = CoM_rebuild_top[2] - multi_j->CoM_rebuild[2];
+  } else {
 
-    /* Apply BC */
-    if (periodic) {
-      dx_r = nearest(dx_r, dim[0]);
-      dy_r = nearest(dy_r, dim[1]);
-      dz_r = nearest(dz_r, dim[2]);
+    /* Loop over all the top-level cells and go for a M-M interaction if
+     * well-separated */
+    for (int n = 0; n < nr_cells_with_particles; ++n) {
+      struct cell *cj = &cells[cells_with_particles[n]];
+      runner_do_grav_long_range_pair(r, ci, top, cj, batch, &nr_batch);
     }
-    const double r2_rebuild = dx_r * dx_r + dy_r * dy_r + dz_r * dz_r;
-
-    /* Are we in charge of this cell pair? */
-    if (gravity_M2L_accept(multi_top->r_max_rebuild, multi_j->r_max_rebuild,
-                           theta_crit2, r2_rebuild)) {
-
-      /* Call the PM interaction fucntion on the active sub-cells of ci */
-      runner_dopair_grav_mm_nonsym(r, ci, cj);
-      // runner_dopair_recursive_grav_pm(r, ci, cj);
-
-      /* Record that this multipole received a contribution */
-      multi_i->pot.interacted = 1;
+  }
 
-    } /* We are in charge of this pair */
-  }   /* Loop over top-level cells */
+  /* Interact with what is left in the list */
+  if (nr_batch > 0) runner_dopair_grav_mm_batch(r, ci, batch, nr_batch);
 
   if (timer) TIMER_TOC(timer_dograv_long_range);
 }
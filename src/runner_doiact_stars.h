@@ -71,6 +71,21 @@
 #define _DOSUB_SELF1_STARS(f) PASTE(runner_dosub_self_stars, f)
 #define DOSUB_SELF1_STARS _DOSUB_SELF1_STARS(FUNCTION)
 
+#define _STARS_LIST_H_MAX(f) PASTE(runner_stars_list_h_max, f)
+#define STARS_LIST_H_MAX _STARS_LIST_H_MAX(FUNCTION)
+
+#define _DOSELF1_STARS_LIST(f) PASTE(runner_doself_stars_list, f)
+#define DOSELF1_STARS_LIST _DOSELF1_STARS_LIST(FUNCTION)
+
+#define _DOPAIR1_STARS_LIST(f) PASTE(runner_dopair_stars_list, f)
+#define DOPAIR1_STARS_LIST _DOPAIR1_STARS_LIST(FUNCTION)
+
+#define _STARS_LIST_GET(f) PASTE(runner_stars_list_get, f)
+#define STARS_LIST_GET _STARS_LIST_GET(FUNCTION)
+
+#define _DO_STARS_LIST(f) PASTE(runner_do_stars_list, f)
+#define DO_STARS_LIST _DO_STARS_LIST(FUNCTION)
+
 #define _TIMER_DOSELF_STARS(f) PASTE(timer_doself_stars, f)
 #define TIMER_DOSELF_STARS _TIMER_DOSELF_STARS(FUNCTION)
 
@@ -130,7 +145,9 @@ void DOSELF1_STARS(struct runner *r, struct cell *c, int timer) {
     if (!spart_is_active(si, e)) continue;
 
     /* Skip inactive particles */
-    if (!feedback_is_active(si, e->time, cosmo, with_cosmology)) continue;
+    if (!feedback_is_active(si, e->feedback_props, e->time, cosmo,
+                            with_cosmology))
+      continue;
 
     const float hi = si->h;
     const float hig2 = hi * hi * kernel_gamma2;
@@ -234,7 +251,9 @@ void DO_NONSYM_PAIR1_STARS_NAIVE(struct runner *r, struct cell *restrict ci,
     if (!spart_is_active(si, e)) continue;
 
     /* Skip inactive particles */
-    if (!feedback_is_active(si, e->time, cosmo, with_cosmology)) continue;
+    if (!feedback_is_active(si, e->feedback_props, e->time, cosmo,
+                            with_cosmology))
+      continue;
 
     const float hi = si->h;
     const float hig2 = hi * hi * kernel_gamma2;
@@ -364,7 +383,9 @@ void DO_SYM_PAIR1_STARS(struct runner *r, struct cell *ci, struct cell *cj,
       if (!spart_is_active(spi, e)) continue;
 
       /* Skip inactive particles */
-      if (!feedback_is_active(spi, e->time, cosmo, with_cosmology)) continue;
+      if (!feedback_is_active(spi, e->feedback_props, e->time, cosmo,
+                              with_cosmology))
+        continue;
 
       /* Compute distance from the other cell. */
       const double px[3] = {spi->x[0], spi->x[1], spi->x[2]};
@@ -469,7 +490,7 @@ void DO_SYM_PAIR1_STARS(struct runner *r, struct cell *ci, struct cell *cj,
 #endif /* SWIFT_DEBUG_CHECKS */
 
     /* Get some other useful values. */
-    const double hj_max = cj->hydro.h_max * kernel_gamma;
+    const double hj_max = cj->stars.h_max * kernel_gamma;
     const int count_i = ci->hydro.count;
     const int count_j = cj->stars.count;
     struct part *restrict parts_i = ci->hydro.parts;
@@ -492,7 +513,9 @@ void DO_SYM_PAIR1_STARS(struct runner *r, struct cell *ci, struct cell *cj,
       if (!spart_is_active(spj, e)) continue;
 
       /* Skip inactive particles */
-      if (!feedback_is_active(spj, e->time, cosmo, with_cosmology)) continue;
+      if (!feedback_is_active(spj, e->feedback_props, e->time, cosmo,
+                              with_cosmology))
+        continue;
 
       /* Compute distance from the other cell. */
       const double px[3] = {spj->x[0], spj->x[1], spj->x[2]};
@@ -1102,6 +1125,450 @@ void DOSUB_SUBSET_STARS(struct runner *r, struct cell *ci, struct spart *sparts,
   } /* otherwise, pair interaction. */
 }
 
+/**
+ * @brief Largest smoothing length of the #spart of a cell doing feedback in
+ * this step.
+ *
+ * @param e The #engine.
+ * @param c The #cell.
+ */
+float STARS_LIST_H_MAX(const struct engine *e, const struct cell *c) {
+
+  const int with_cosmology = e->policy & engine_policy_cosmology;
+
+  float h_max = 0.f;
+  for (int k = 0; k < c->stars.count; k++) {
+    const struct spart *sp = &c->stars.parts[k];
+    if (spart_is_active(sp, e) &&
+        feedback_is_active(sp, e->feedback_props, e->time, e->cosmology,
+                           with_cosmology))
+      h_max = max(h_max, sp->h);
+  }
+  return h_max;
+}
+
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY)
+
+/**
+ * @brief Same as DOSELF1_STARS but also records the (#spart, #part) pairs
+ * closer than the largest h of the active #spart (times a margin) for the
+ * feedback loop.
+ *
+ * @param r runner task
+ * @param c cell
+ */
+void DOSELF1_STARS_LIST(struct runner *r, struct cell *c) {
+
+  TIMER_TIC;
+
+  const struct engine *e = r->e;
+  const int with_cosmology = e->policy & engine_policy_cosmology;
+  const integertime_t ti_current = e->ti_current;
+  const struct cosmology *cosmo = e->cosmology;
+  struct neighbour_list_arena *restrict lists = &r->neighbour_lists;
+
+  /* Anything to do here? */
+  if (c->hydro.count == 0 || c->stars.count == 0) return;
+  if (!cell_is_active_stars(c, e)) return;
+
+  /* Cosmological terms */
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+
+  const int scount = c->stars.count;
+  const int count = c->hydro.count;
+  struct spart *restrict sparts = c->stars.parts;
+  struct part *restrict parts = c->hydro.parts;
+  struct xpart *restrict xparts = c->hydro.xparts;
+
+  /* Radius up to which we record the neighbours */
+  const float h_list = neighbour_list_stars_h_ratio * STARS_LIST_H_MAX(e, c);
+  const float hlg2 = h_list * h_list * kernel_gamma2;
+
+  /* Loop over the sparts in ci. */
+  for (int sid = 0; sid < scount; sid++) {
+
+    /* Get a hold of the ith spart in ci. */
+    struct spart *restrict si = &sparts[sid];
+
+    /* Skip inactive particles */
+    if (!spart_is_active(si, e)) continue;
+
+    /* Skip inactive particles */
+    if (!feedback_is_active(si, e->feedback_props, e->time, cosmo,
+                            with_cosmology))
+      continue;
+
+    const float hi = si->h;
+    const float hig2 = hi * hi * kernel_gamma2;
+    const float six[3] = {(float)(si->x[0] - c->loc[0]),
+                          (float)(si->x[1] - c->loc[1]),
+                          (float)(si->x[2] - c->loc[2])};
+
+    /* Loop over the parts in cj. */
+    for (int pjd = 0; pjd < count; pjd++) {
+
+      /* Get a pointer to the jth particle. */
+      struct part *restrict pj = &parts[pjd];
+      struct xpart *restrict xpj = &xparts[pjd];
+      const float hj = pj->h;
+
+      /* Early abort? */
+      if (part_is_inhibited(pj, e)) continue;
+
+      /* Compute the pairwise distance. */
+      const float pjx[3] = {(float)(pj->x[0] - c->loc[0]),
+                            (float)(pj->x[1] - c->loc[1]),
+                            (float)(pj->x[2] - c->loc[2])};
+      float dx[3] = {six[0] - pjx[0], six[1] - pjx[1], six[2] - pjx[2]};
+      const float r2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+
+      if (r2 < hlg2) neighbour_list_push(lists, sid, pjd);
+
+      if (r2 < hig2) {
+        IACT_STARS(r2, dx, hi, hj, si, pj, a, H);
+        runner_iact_nonsym_feedback_density(r2, dx, hi, hj, si, pj, xpj, cosmo,
+                                            ti_current);
+      }
+    } /* loop over the parts in ci. */
+  }   /* loop over the sparts in ci. */
+
+  neighbour_list_store(lists, &c->stars.neighbour_lists,
+                       &c->stars.neighbour_lists_generation,
+                       e->launch_generation, c, neighbour_list_self, h_list);
+
+  TIMER_TOC(TIMER_DOSELF_STARS);
+}
+
+/**
+ * @brief Same as DO_SYM_PAIR1_STARS but also records the (#spart, #part)
+ * pairs closer than the largest h of the active #spart (times a margin) for
+ * the feedback loop.
+ *
+ * The list of the #spart of ci is stored in slot sid of ci, the one of the
+ * #spart of cj in slot 26 - sid of cj.
+ *
+ * @param r The #runner.
+ * @param ci The first #cell.
+ * @param cj The second #cell.
+ * @param sid The direction of the pair.
+ * @param shift The shift vector to apply to the particles in ci.
+ */
+void DOPAIR1_STARS_LIST(struct runner *r, struct cell *ci, struct cell *cj,
+                        const int sid, const double *shift) {
+
+  TIMER_TIC;
+
+  const struct engine *e = r->e;
+  const int with_cosmology = e->policy & engine_policy_cosmology;
+  const integertime_t ti_current = e->ti_current;
+  const struct cosmology *cosmo = e->cosmology;
+  struct neighbour_list_arena *restrict lists = &r->neighbour_lists;
+
+  /* Cosmological terms */
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+
+  /* Get the cutoff shift. */
+  double rshift = 0.0;
+  for (int k = 0; k < 3; k++) rshift += shift[k] * runner_shift[sid][k];
+
+  const int do_ci_stars = (ci->nodeID == e->nodeID) && (ci->stars.count != 0) &&
+                          (cj->hydro.count != 0) && cell_is_active_stars(ci, e);
+  const int do_cj_stars = (cj->nodeID == e->nodeID) && (cj->stars.count != 0) &&
+                          (ci->hydro.count != 0) && cell_is_active_stars(cj, e);
+
+  if (do_ci_stars) {
+
+    /* Pick-out the sorted lists. */
+    const struct entry *restrict sort_j = cj->hydro.sort[sid];
+    const struct entry *restrict sort_i = ci->stars.sort[sid];
+
+    /* Radius up to which we record the neighbours */
+    const float h_list =
+        neighbour_list_stars_h_ratio * STARS_LIST_H_MAX(e, ci);
+    const float hlg2 = h_list * h_list * kernel_gamma2;
+
+    /* Get some other useful values. */
+    const double hi_max = h_list * kernel_gamma - rshift;
+    const int count_i = ci->stars.count;
+    const int count_j = cj->hydro.count;
+    struct spart *restrict sparts_i = ci->stars.parts;
+    struct part *restrict parts_j = cj->hydro.parts;
+    struct xpart *restrict xparts_j = cj->hydro.xparts;
+    const double dj_min = sort_j[0].d;
+    const float dx_max_rshift =
+        (ci->stars.dx_max_sort + cj->hydro.dx_max_sort) - rshift;
+    const float dx_max = (ci->stars.dx_max_sort + cj->hydro.dx_max_sort);
+
+    /* Loop over the sparts in ci. */
+    for (int pid = count_i - 1;
+         pid >= 0 && sort_i[pid].d + hi_max + dx_max > dj_min; pid--) {
+
+      /* Get a hold of the ith part in ci. */
+      struct spart *restrict spi = &sparts_i[sort_i[pid].i];
+      const float hi = spi->h;
+
+      /* Skip inactive particles */
+      if (!spart_is_active(spi, e)) continue;
+
+      /* Skip inactive particles */
+      if (!feedback_is_active(spi, e->feedback_props, e->time, cosmo,
+                              with_cosmology))
+        continue;
+
+      /* Compute distance from the other cell. */
+      const double px[3] = {spi->x[0], spi->x[1], spi->x[2]};
+      float dist = px[0] * runner_shift[sid][0] + px[1] * runner_shift[sid][1] +
+                   px[2] * runner_shift[sid][2];
+
+      /* Is there anything we need to record ? */
+      const double di = dist + h_list * kernel_gamma + dx_max_rshift;
+      if (di < dj_min) continue;
+
+      /* Get some additional information about pi */
+      const float hig2 = hi * hi * kernel_gamma2;
+      const float pix = spi->x[0] - (cj->loc[0] + shift[0]);
+      const float piy = spi->x[1] - (cj->loc[1] + shift[1]);
+      const float piz = spi->x[2] - (cj->loc[2] + shift[2]);
+
+      /* Loop over the parts in cj. */
+      for (int pjd = 0; pjd < count_j && sort_j[pjd].d < di; pjd++) {
+
+        /* Recover pj */
+        struct part *pj = &parts_j[sort_j[pjd].i];
+        struct xpart *xpj = &xparts_j[sort_j[pjd].i];
+
+        /* Skip inhibited particles. */
+        if (part_is_inhibited(pj, e)) continue;
+
+        const float hj = pj->h;
+        const float pjx = pj->x[0] - cj->loc[0];
+        const float pjy = pj->x[1] - cj->loc[1];
+        const float pjz = pj->x[2] - cj->loc[2];
+
+        /* Compute the pairwise distance. */
+        float dx[3] = {pix - pjx, piy - pjy, piz - pjz};
+        const float r2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+
+        if (r2 < hlg2)
+          neighbour_list_push(lists, sort_i[pid].i, sort_j[pjd].i);
+
+        /* Hit or miss? */
+        if (r2 < hig2) {
+          IACT_STARS(r2, dx, hi, hj, spi, pj, a, H);
+          runner_iact_nonsym_feedback_density(r2, dx, hi, hj, spi, pj, xpj,
+                                              cosmo, ti_current);
+        }
+      } /* loop over the parts in cj. */
+    }   /* loop over the parts in ci. */
+
+    neighbour_list_store(lists, &ci->stars.neighbour_lists,
+                         &ci->stars.neighbour_lists_generation,
+                         e->launch_generation, cj, sid, h_list);
+  } /* do_ci_stars */
+
+  if (do_cj_stars) {
+    /* Pick-out the sorted lists. */
+    const struct entry *restrict sort_i = ci->hydro.sort[sid];
+    const struct entry *restrict sort_j = cj->stars.sort[sid];
+
+    /* Radius up to which we record the neighbours */
+    const float h_list =
+        neighbour_list_stars_h_ratio * STARS_LIST_H_MAX(e, cj);
+    const float hlg2 = h_list * h_list * kernel_gamma2;
+
+    /* Get some other useful values. */
+    const double hj_max = h_list * kernel_gamma;
+    const int count_i = ci->hydro.count;
+    const int count_j = cj->stars.count;
+    struct part *restrict parts_i = ci->hydro.parts;
+    struct xpart *restrict xparts_i = ci->hydro.xparts;
+    struct spart *restrict sparts_j = cj->stars.parts;
+    const double di_max = sort_i[count_i - 1].d - rshift;
+    const float dx_max_rshift =
+        (ci->hydro.dx_max_sort + cj->stars.dx_max_sort) + rshift;
+    const float dx_max = (ci->hydro.dx_max_sort + cj->stars.dx_max_sort);
+
+    /* Loop over the parts in cj. */
+    for (int pjd = 0; pjd < count_j && sort_j[pjd].d - hj_max - dx_max < di_max;
+         pjd++) {
+
+      /* Get a hold of the jth part in cj. */
+      struct spart *spj = &sparts_j[sort_j[pjd].i];
+      const float hj = spj->h;
+
+      /* Skip inactive particles */
+      if (!spart_is_active(spj, e)) continue;
+
+      /* Skip inactive particles */
+      if (!feedback_is_active(spj, e->feedback_props, e->time, cosmo,
+                              with_cosmology))
+        continue;
+
+      /* Compute distance from the other cell. */
+      const double px[3] = {spj->x[0], spj->x[1], spj->x[2]};
+      float dist = px[0] * runner_shift[sid][0] + px[1] * runner_shift[sid][1] +
+                   px[2] * runner_shift[sid][2];
+
+      /* Is there anything we need to record ? */
+      const double dj = dist - h_list * kernel_gamma - dx_max_rshift;
+      if (dj - rshift > di_max) continue;
+
+      /* Get some additional information about pj */
+      const float hjg2 = hj * hj * kernel_gamma2;
+      const float pjx = spj->x[0] - cj->loc[0];
+      const float pjy = spj->x[1] - cj->loc[1];
+      const float pjz = spj->x[2] - cj->loc[2];
+
+      /* Loop over the parts in ci. */
+      for (int pid = count_i - 1; pid >= 0 && sort_i[pid].d > dj; pid--) {
+
+        /* Recover pi */
+        struct part *pi = &parts_i[sort_i[pid].i];
+        struct xpart *xpi = &xparts_i[sort_i[pid].i];
+
+        /* Skip inhibited particles. */
+        if (part_is_inhibited(pi, e)) continue;
+
+        const float hi = pi->h;
+        const float pix = pi->x[0] - (cj->loc[0] + shift[0]);
+        const float piy = pi->x[1] - (cj->loc[1] + shift[1]);
+        const float piz = pi->x[2] - (cj->loc[2] + shift[2]);
+
+        /* Compute the pairwise distance. */
+        float dx[3] = {pjx - pix, pjy - piy, pjz - piz};
+        const float r2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+
+        if (r2 < hlg2)
+          neighbour_list_push(lists, sort_j[pjd].i, sort_i[pid].i);
+
+        /* Hit or miss? */
+        if (r2 < hjg2) {
+          IACT_STARS(r2, dx, hj, hi, spj, pi, a, H);
+          runner_iact_nonsym_feedback_density(r2, dx, hj, hi, spj, pi, xpi,
+                                              cosmo, ti_current);
+        }
+      } /* loop over the parts in ci. */
+    }   /* loop over the parts in cj. */
+
+    neighbour_list_store(lists, &cj->stars.neighbour_lists,
+                         &cj->stars.neighbour_lists_generation,
+                         e->launch_generation, ci, 26 - sid, h_list);
+  } /* Cell cj is active */
+
+  TIMER_TOC(TIMER_DOPAIR_STARS);
+}
+
+#endif /* TASK_LOOP_DENSITY */
+
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_FEEDBACK)
+
+/**
+ * @brief Retrieves the neighbours of the #spart of a cell recorded by the
+ * density loop, provided they still cover the final smoothing lengths.
+ *
+ * @param e The #engine.
+ * @param cs The #cell containing the #spart.
+ * @param cp The #cell containing the #part.
+ * @param slot The slot of the list in cs.
+ * @param count (return) The number of pairs in the list.
+ *
+ * @return The pairs or NULL if there is no valid list.
+ */
+const struct neighbour_pair *STARS_LIST_GET(const struct engine *e,
+                                            const struct cell *cs,
+                                            const struct cell *cp,
+                                            const int slot, int *count) {
+
+  const struct neighbour_pair *pairs = neighbour_list_get(
+      cs->stars.neighbour_lists, cs->stars.neighbour_lists_generation,
+      e->launch_generation, cp, slot, count);
+
+  /* Did the ghost grow h beyond what we recorded? */
+  if (pairs != NULL &&
+      STARS_LIST_H_MAX(e, cs) > cs->stars.neighbour_lists->h[slot])
+    return NULL;
+
+  return pairs;
+}
+
+/**
+ * @brief Applies the feedback of the #spart of a cell to the #part of
+ * another (or the same) cell using the pairs recorded by the density loop.
+ *
+ * @param r The #runner.
+ * @param cs The #cell containing the #spart.
+ * @param cp The #cell containing the #part.
+ * @param pairs The recorded pairs.
+ * @param count The number of pairs.
+ * @param loc_s The origin of the frame of the #spart.
+ * @param loc_p The origin of the frame of the #part.
+ */
+void DO_STARS_LIST(struct runner *r, struct cell *cs, struct cell *cp,
+                   const struct neighbour_pair *pairs, const int count,
+                   const double *loc_s, const double *loc_p) {
+
+  const struct engine *e = r->e;
+  const int with_cosmology = e->policy & engine_policy_cosmology;
+  const integertime_t ti_current = e->ti_current;
+  const struct cosmology *cosmo = e->cosmology;
+
+  /* Cosmological terms */
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+
+  struct spart *restrict sparts = cs->stars.parts;
+  struct part *restrict parts = cp->hydro.parts;
+  struct xpart *restrict xparts = cp->hydro.xparts;
+
+  for (int k = 0; k < count; k++) {
+
+    struct spart *restrict si = &sparts[pairs[k].i];
+    struct part *restrict pj = &parts[pairs[k].j];
+    struct xpart *restrict xpj = &xparts[pairs[k].j];
+
+    /* Skip inhibited particles. */
+    if (part_is_inhibited(pj, e)) continue;
+
+    /* Skip the stars that are done with their feedback */
+    if (!feedback_is_active(si, e->feedback_props, e->time, cosmo,
+                            with_cosmology))
+      continue;
+
+    const float hi = si->h;
+    const float hj = pj->h;
+    const float hig2 = hi * hi * kernel_gamma2;
+
+    /* Compute the pairwise distance. */
+    const float six = si->x[0] - loc_s[0];
+    const float siy = si->x[1] - loc_s[1];
+    const float siz = si->x[2] - loc_s[2];
+    const float pjx = pj->x[0] - loc_p[0];
+    const float pjy = pj->x[1] - loc_p[1];
+    const float pjz = pj->x[2] - loc_p[2];
+    float dx[3] = {six - pjx, siy - pjy, siz - pjz};
+    const float r2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+
+#ifdef SWIFT_DEBUG_CHECKS
+    /* Check that particles have been drifted to the current time */
+    if (si->ti_drift != e->ti_current)
+      error("Particle si not drifted to current time");
+    if (pj->ti_drift != e->ti_current)
+      error("Particle pj not drifted to current time");
+#endif
+
+    /* Hit or miss? */
+    if (r2 < hig2) {
+      IACT_STARS(r2, dx, hi, hj, si, pj, a, H);
+      runner_iact_nonsym_feedback_apply(r2, dx, hi, hj, si, pj, xpj, cosmo,
+                                        ti_current);
+    }
+  }
+}
+
+#endif /* TASK_LOOP_FEEDBACK */
+
 /**
  * @brief Determine which version of DOSELF1_STARS needs to be called depending
  * on the optimisation level.
@@ -1124,6 +1591,24 @@ void DOSELF1_BRANCH_STARS(struct runner *r, struct cell *c) {
   if (c->stars.h_max_old * kernel_gamma > c->dmin)
     error("Cell smaller than smoothing length");
 
+  /* Record the neighbours for the feedback loop or re-use them? */
+  if (e->stars_properties->feedback_neighbour_lists) {
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY)
+    DOSELF1_STARS_LIST(r, c);
+    return;
+#elif (FUNCTION_TASK_LOOP == TASK_LOOP_FEEDBACK)
+    int count = 0;
+    const struct neighbour_pair *pairs =
+        STARS_LIST_GET(e, c, c, neighbour_list_self, &count);
+    if (pairs != NULL) {
+      TIMER_TIC;
+      DO_STARS_LIST(r, c, c, pairs, count, c->loc, c->loc);
+      TIMER_TOC(TIMER_DOSELF_STARS);
+      return;
+    }
+#endif
+  }
+
   DOSELF1_STARS(r, c, 1);
 }
 
@@ -1231,6 +1716,32 @@ void DOPAIR1_BRANCH_STARS(struct runner *r, struct cell *ci, struct cell *cj) {
   }
 #endif /* SWIFT_DEBUG_CHECKS */
 
+  /* Record the neighbours for the feedback loop or re-use them? */
+  if (e->stars_properties->feedback_neighbour_lists) {
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY)
+    DOPAIR1_STARS_LIST(r, ci, cj, sid, shift);
+    return;
+#elif (FUNCTION_TASK_LOOP == TASK_LOOP_FEEDBACK)
+    int count_i = 0, count_j = 0;
+    const struct neighbour_pair *pairs_i =
+        do_ci ? STARS_LIST_GET(e, ci, cj, sid, &count_i) : NULL;
+    const struct neighbour_pair *pairs_j =
+        do_cj ? STARS_LIST_GET(e, cj, ci, 26 - sid, &count_j) : NULL;
+
+    /* Only use the lists if all the sides we need have one */
+    if ((!do_ci || pairs_i != NULL) && (!do_cj || pairs_j != NULL)) {
+      TIMER_TIC;
+      const double loc_shift[3] = {cj->loc[0] + shift[0],
+                                   cj->loc[1] + shift[1],
+                                   cj->loc[2] + shift[2]};
+      if (do_ci) DO_STARS_LIST(r, ci, cj, pairs_i, count_i, loc_shift, cj->loc);
+      if (do_cj) DO_STARS_LIST(r, cj, ci, pairs_j, count_j, cj->loc, loc_shift);
+      TIMER_TOC(TIMER_DOPAIR_STARS);
+      return;
+    }
+#endif
+  }
+
 #ifdef SWIFT_USE_NAIVE_INTERACTIONS_STARS
   DOPAIR1_STARS_NAIVE(r, ci, cj, 1);
 #else
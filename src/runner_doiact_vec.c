@@ -23,10 +23,27 @@
 /* This object's header. */
 #include "runner_doiact_vec.h"
 
-#if defined(WITH_VECTORIZATION) && defined(GADGET2_SPH)
+#if defined(WITH_VECTORIZATION) && \
+    (defined(GADGET2_SPH) || defined(ANARCHY_PU_SPH))
 
 static const vector kernel_gamma2_vec = FILL_VEC(kernel_gamma2);
 
+/**
+ * @brief Get the #hydro_soa copy of a cell to fill the density caches from.
+ *
+ * @param e The #engine.
+ * @param c The #cell (locked by the current task).
+ * @return The copy or NULL if the caches are filled from the particles.
+ */
+__attribute__((always_inline)) INLINE static const struct hydro_soa *
+runner_vec_density_soa(const struct engine *e, struct cell *c) {
+
+  if (!e->hydro_properties->soa_hot_fields) return NULL;
+  return cell_get_hydro_soa(c, e->launch_generation, task_subtype_density);
+}
+
+#if defined(GADGET2_SPH)
+
 /**
  * @brief Compute the vector remainder interactions from the secondary cache.
  *
@@ -231,6 +248,8 @@ __attribute__((always_inline)) INLINE static void storeInteractions(
   }
 }
 
+#endif /* GADGET2_SPH */
+
 /**
  * @brief Populates the arrays max_index_i and max_index_j with the maximum
  * indices of
@@ -553,6 +572,8 @@ __attribute__((always_inline)) INLINE static void populate_max_index_force(
   *init_pj = last_pj;
 }
 
+#if defined(GADGET2_SPH)
+
 /**
  * @brief Populates the array max_index_i with the maximum
  * index of
@@ -635,7 +656,606 @@ __attribute__((always_inline)) INLINE static int populate_max_index_subset(
   }
 }
 
-#endif /* WITH_VECTORIZATION && GADGET2_SPH */
+#endif /* GADGET2_SPH */
+
+#if defined(ANARCHY_PU_SPH)
+
+/*! The loops over neighbours provided by the vectorised pressure-energy
+ * interactions. */
+enum pu_vec_loop {
+  pu_vec_loop_density,
+  pu_vec_loop_gradient,
+  pu_vec_loop_force
+};
+
+/**
+ * @brief Computes the pairwise distances between one particle and a vector of
+ * neighbours read from a #cache.
+ *
+ * @param v_pix #vector of the x position of pi.
+ * @param v_piy #vector of the y position of pi.
+ * @param v_piz #vector of the z position of pi.
+ * @param cj_cache The #cache holding the neighbours.
+ * @param pjd The index of the first neighbour in the #cache.
+ * @param v_dx (return) The x separations.
+ * @param v_dy (return) The y separations.
+ * @param v_dz (return) The z separations.
+ * @param v_r2 (return) The squared separations.
+ */
+__attribute__((always_inline)) INLINE static void pu_vec_separation(
+    const vector v_pix, const vector v_piy, const vector v_piz,
+    const struct cache *cj_cache, const int pjd, vector *v_dx, vector *v_dy,
+    vector *v_dz, vector *v_r2) {
+
+  const vector v_pjx = vector_load(&cj_cache->x[pjd]);
+  const vector v_pjy = vector_load(&cj_cache->y[pjd]);
+  const vector v_pjz = vector_load(&cj_cache->z[pjd]);
+
+  v_dx->v = vec_sub(v_pix.v, v_pjx.v);
+  v_dy->v = vec_sub(v_piy.v, v_pjy.v);
+  v_dz->v = vec_sub(v_piz.v, v_pjz.v);
+
+  v_r2->v = vec_mul(v_dx->v, v_dx->v);
+  v_r2->v = vec_fma(v_dy->v, v_dy->v, v_r2->v);
+  v_r2->v = vec_fma(v_dz->v, v_dz->v, v_r2->v);
+}
+
+/**
+ * @brief Density loop of one particle pi over a range of neighbours stored in
+ * a #cache (pressure-energy SPH).
+ *
+ * The neighbour range must start on a multiple of the vector length.
+ * Separations of zero are masked out so that pi can also be part of the
+ * neighbour cache.
+ *
+ * @param pi The #part to update.
+ * @param ci_cache The #cache holding pi.
+ * @param ci_cache_idx The index of pi in @c ci_cache.
+ * @param cj_cache The #cache holding the neighbours.
+ * @param first The index of the first neighbour to interact with.
+ * @param last The index past the last neighbour to interact with.
+ */
+__attribute__((always_inline)) INLINE static void pu_vec_density_loop(
+    struct part *restrict pi, const struct cache *ci_cache,
+    const int ci_cache_idx, const struct cache *cj_cache, const int first,
+    const int last) {
+
+  /* Fill particle pi vectors. */
+  const vector v_pix = vector_set1(ci_cache->x[ci_cache_idx]);
+  const vector v_piy = vector_set1(ci_cache->y[ci_cache_idx]);
+  const vector v_piz = vector_set1(ci_cache->z[ci_cache_idx]);
+  const vector v_vix = vector_set1(ci_cache->vx[ci_cache_idx]);
+  const vector v_viy = vector_set1(ci_cache->vy[ci_cache_idx]);
+  const vector v_viz = vector_set1(ci_cache->vz[ci_cache_idx]);
+
+  /* Some useful mulitples of h */
+  const float hi = ci_cache->h[ci_cache_idx];
+  const vector v_hig2 = vector_set1(hi * hi * kernel_gamma2);
+  const vector v_hi_inv = vec_reciprocal(vector_set1(hi));
+
+  /* Reset cumulative sums of update vectors. */
+  vector v_rhoSum = vector_setzero();
+  vector v_rho_dhSum = vector_setzero();
+  vector v_pressure_barSum = vector_setzero();
+  vector v_pressure_bar_dhSum = vector_setzero();
+  vector v_wcountSum = vector_setzero();
+  vector v_wcount_dhSum = vector_setzero();
+  vector v_div_vSum = vector_setzero();
+  vector v_curlvxSum = vector_setzero();
+  vector v_curlvySum = vector_setzero();
+  vector v_curlvzSum = vector_setzero();
+
+  for (int pjd = first; pjd < last; pjd += VEC_SIZE) {
+
+    vector v_dx, v_dy, v_dz, v_r2;
+    pu_vec_separation(v_pix, v_piy, v_piz, cj_cache, pjd, &v_dx, &v_dy, &v_dz,
+                      &v_r2);
+
+    /* Form r2 > 0 mask and r2 < hig2 mask and combine them. */
+    mask_t v_doi_mask, v_doi_mask_self_check;
+    vec_create_mask(v_doi_mask_self_check, vec_cmp_gt(v_r2.v, vec_setzero()));
+    vec_create_mask(v_doi_mask, vec_cmp_lt(v_r2.v, v_hig2.v));
+    vec_combine_masks(v_doi_mask, v_doi_mask_self_check);
+
+    /* If there are any interactions perform them. */
+    if (vec_is_mask_true(v_doi_mask)) {
+
+      /* Avoid FPEs on the masked-out zero separations. */
+      v_r2.v = vec_add(v_r2.v, vec_set1(FLT_MIN));
+
+      runner_iact_nonsym_1_vec_density(
+          &v_r2, &v_dx, &v_dy, &v_dz, v_hi_inv, v_vix, v_viy, v_viz,
+          &cj_cache->vx[pjd], &cj_cache->vy[pjd], &cj_cache->vz[pjd],
+          &cj_cache->m[pjd], &cj_cache->u[pjd], &v_rhoSum, &v_rho_dhSum,
+          &v_pressure_barSum, &v_pressure_bar_dhSum, &v_wcountSum,
+          &v_wcount_dhSum, &v_div_vSum, &v_curlvxSum, &v_curlvySum,
+          &v_curlvzSum, v_doi_mask);
+    }
+  }
+
+  /* Perform horizontal adds on vector sums and store result in pi. */
+  VEC_HADD(v_rhoSum, pi->rho);
+  VEC_HADD(v_rho_dhSum, pi->density.rho_dh);
+  VEC_HADD(v_pressure_barSum, pi->pressure_bar);
+  VEC_HADD(v_pressure_bar_dhSum, pi->density.pressure_bar_dh);
+  VEC_HADD(v_wcountSum, pi->density.wcount);
+  VEC_HADD(v_wcount_dhSum, pi->density.wcount_dh);
+  VEC_HADD(v_div_vSum, pi->viscosity.div_v);
+  VEC_HADD(v_curlvxSum, pi->density.rot_v[0]);
+  VEC_HADD(v_curlvySum, pi->density.rot_v[1]);
+  VEC_HADD(v_curlvzSum, pi->density.rot_v[2]);
+}
+
+/**
+ * @brief Gradient loop of one particle pi over a range of neighbours stored in
+ * a #cache (pressure-energy SPH).
+ *
+ * @param pi The #part to update.
+ * @param ci_cache The #cache holding pi.
+ * @param ci_cache_idx The index of pi in @c ci_cache.
+ * @param cj_cache The #cache holding the neighbours.
+ * @param first The index of the first neighbour to interact with.
+ * @param last The index past the last neighbour to interact with.
+ * @param a Current scale factor.
+ * @param H Current Hubble parameter.
+ */
+__attribute__((always_inline)) INLINE static void pu_vec_gradient_loop(
+    struct part *restrict pi, const struct cache *ci_cache,
+    const int ci_cache_idx, const struct cache *cj_cache, const int first,
+    const int last, const float a, const float H) {
+
+  /* Fill particle pi vectors. */
+  const vector v_pix = vector_set1(ci_cache->x[ci_cache_idx]);
+  const vector v_piy = vector_set1(ci_cache->y[ci_cache_idx]);
+  const vector v_piz = vector_set1(ci_cache->z[ci_cache_idx]);
+  const vector v_vix = vector_set1(ci_cache->vx[ci_cache_idx]);
+  const vector v_viy = vector_set1(ci_cache->vy[ci_cache_idx]);
+  const vector v_viz = vector_set1(ci_cache->vz[ci_cache_idx]);
+  const vector v_ui = vector_set1(ci_cache->u[ci_cache_idx]);
+  const vector v_ci = vector_set1(ci_cache->soundspeed[ci_cache_idx]);
+
+  /* Some useful mulitples of h */
+  const float hi = ci_cache->h[ci_cache_idx];
+  const vector v_hig2 = vector_set1(hi * hi * kernel_gamma2);
+  const vector v_hi_inv = vec_reciprocal(vector_set1(hi));
+
+  /* Reset cumulative sums of update vectors. */
+  vector v_sigSum = vector_set1(pi->viscosity.v_sig);
+  vector v_laplace_uSum = vector_setzero();
+
+  for (int pjd = first; pjd < last; pjd += VEC_SIZE) {
+
+    vector v_dx, v_dy, v_dz, v_r2;
+    pu_vec_separation(v_pix, v_piy, v_piz, cj_cache, pjd, &v_dx, &v_dy, &v_dz,
+                      &v_r2);
+
+    /* Form r2 > 0 mask and r2 < hig2 mask and combine them. */
+    mask_t v_doi_mask, v_doi_mask_self_check;
+    vec_create_mask(v_doi_mask_self_check, vec_cmp_gt(v_r2.v, vec_setzero()));
+    vec_create_mask(v_doi_mask, vec_cmp_lt(v_r2.v, v_hig2.v));
+    vec_combine_masks(v_doi_mask, v_doi_mask_self_check);
+
+    /* If there are any interactions perform them. */
+    if (vec_is_mask_true(v_doi_mask)) {
+
+      /* Avoid FPEs on the masked-out zero separations. */
+      v_r2.v = vec_add(v_r2.v, vec_set1(FLT_MIN));
+
+      runner_iact_nonsym_1_vec_gradient(
+          &v_r2, &v_dx, &v_dy, &v_dz, v_hi_inv, v_vix, v_viy, v_viz, v_ui,
+          v_ci, &cj_cache->vx[pjd], &cj_cache->vy[pjd], &cj_cache->vz[pjd],
+          &cj_cache->m[pjd], &cj_cache->u[pjd], &cj_cache->rho[pjd],
+          &cj_cache->soundspeed[pjd], a, H, &v_sigSum, &v_laplace_uSum,
+          v_doi_mask);
+    }
+  }
+
+  /* Perform horizontal operations on vector sums and store result in pi. */
+  VEC_HMAX(v_sigSum, pi->viscosity.v_sig);
+  VEC_HADD(v_laplace_uSum, pi->diffusion.laplace_u);
+}
+
+/**
+ * @brief Force loop of one particle pi over a range of neighbours stored in
+ * a #cache (pressure-energy SPH).
+ *
+ * @param pi The #part to update.
+ * @param ci_cache The #cache holding pi.
+ * @param ci_cache_idx The index of pi in @c ci_cache.
+ * @param cj_cache The #cache holding the neighbours.
+ * @param first The index of the first neighbour to interact with.
+ * @param last The index past the last neighbour to interact with.
+ * @param a Current scale factor.
+ * @param H Current Hubble parameter.
+ */
+__attribute__((always_inline)) INLINE static void pu_vec_force_loop(
+    struct part *restrict pi, const struct cache *ci_cache,
+    const int ci_cache_idx, const struct cache *cj_cache, const int first,
+    const int last, const float a, const float H) {
+
+  /* Fill particle pi vectors. */
+  const vector v_pix = vector_set1(ci_cache->x[ci_cache_idx]);
+  const vector v_piy = vector_set1(ci_cache->y[ci_cache_idx]);
+  const vector v_piz = vector_set1(ci_cache->z[ci_cache_idx]);
+  const vector v_vix = vector_set1(ci_cache->vx[ci_cache_idx]);
+  const vector v_viy = vector_set1(ci_cache->vy[ci_cache_idx]);
+  const vector v_viz = vector_set1(ci_cache->vz[ci_cache_idx]);
+  const vector v_mi = vector_set1(ci_cache->m[ci_cache_idx]);
+  const vector v_ui = vector_set1(ci_cache->u[ci_cache_idx]);
+  const vector v_rhoi = vector_set1(ci_cache->rho[ci_cache_idx]);
+  const vector v_fi = vector_set1(ci_cache->grad_h[ci_cache_idx]);
+  const vector v_pressure_bar_i =
+      vector_set1(ci_cache->pressure_bar[ci_cache_idx]);
+  const vector v_sig_i = vector_set1(ci_cache->v_sig[ci_cache_idx]);
+  const vector v_alpha_visc_i = vector_set1(ci_cache->alpha_visc[ci_cache_idx]);
+  const vector v_alpha_diff_i = vector_set1(ci_cache->alpha_diff[ci_cache_idx]);
+  const vector v_balsara_i = vector_set1(ci_cache->balsara[ci_cache_idx]);
+  const vector v_ci = vector_set1(ci_cache->soundspeed[ci_cache_idx]);
+
+  /* Some useful mulitples of h */
+  const float hi = ci_cache->h[ci_cache_idx];
+  const vector v_hig2 = vector_set1(hi * hi * kernel_gamma2);
+  const vector v_hi_inv = vec_reciprocal(vector_set1(hi));
+
+  /* Reset cumulative sums of update vectors. */
+  vector v_a_hydro_xSum = vector_setzero();
+  vector v_a_hydro_ySum = vector_setzero();
+  vector v_a_hydro_zSum = vector_setzero();
+  vector v_u_dtSum = vector_setzero();
+  vector v_h_dtSum = vector_setzero();
+
+  for (int pjd = first; pjd < last; pjd += VEC_SIZE) {
+
+    vector v_dx, v_dy, v_dz, v_r2;
+    pu_vec_separation(v_pix, v_piy, v_piz, cj_cache, pjd, &v_dx, &v_dy, &v_dz,
+                      &v_r2);
+
+    /* (hj * gamma)^2 */
+    const vector v_hj = vector_load(&cj_cache->h[pjd]);
+    vector v_hjg2;
+    v_hjg2.v = vec_mul(vec_mul(v_hj.v, v_hj.v), kernel_gamma2_vec.v);
+
+    /* Form r2 > 0 mask and r2 < max(hig2, hjg2) mask and combine them. */
+    mask_t v_doi_mask, v_doi_mask_self_check;
+    vec_create_mask(v_doi_mask_self_check, vec_cmp_gt(v_r2.v, vec_setzero()));
+    vec_create_mask(v_doi_mask,
+                    vec_cmp_lt(v_r2.v, vec_fmax(v_hig2.v, v_hjg2.v)));
+    vec_combine_masks(v_doi_mask, v_doi_mask_self_check);
+
+    /* If there are any interactions perform them. */
+    if (vec_is_mask_true(v_doi_mask)) {
+
+      const vector v_hj_inv = vec_reciprocal(v_hj);
+
+      /* Avoid FPEs on the masked-out zero separations. */
+      v_r2.v = vec_add(v_r2.v, vec_set1(FLT_MIN));
+
+      runner_iact_nonsym_1_vec_force(
+          &v_r2, &v_dx, &v_dy, &v_dz, v_vix, v_viy, v_viz, v_mi, v_ui, v_rhoi,
+          v_fi, v_pressure_bar_i, v_sig_i, v_alpha_visc_i, v_alpha_diff_i,
+          v_balsara_i, v_ci, &cj_cache->vx[pjd], &cj_cache->vy[pjd],
+          &cj_cache->vz[pjd], &cj_cache->m[pjd], &cj_cache->u[pjd],
+          &cj_cache->rho[pjd], &cj_cache->grad_h[pjd],
+          &cj_cache->pressure_bar[pjd], &cj_cache->v_sig[pjd],
+          &cj_cache->alpha_visc[pjd], &cj_cache->alpha_diff[pjd],
+          &cj_cache->balsara[pjd], &cj_cache->soundspeed[pjd], v_hi_inv,
+          v_hj_inv, a, H, &v_a_hydro_xSum, &v_a_hydro_ySum, &v_a_hydro_zSum,
+          &v_u_dtSum, &v_h_dtSum, v_doi_mask);
+    }
+  }
+
+  /* Perform horizontal adds on vector sums and store result in pi. */
+  VEC_HADD(v_a_hydro_xSum, pi->a_hydro[0]);
+  VEC_HADD(v_a_hydro_ySum, pi->a_hydro[1]);
+  VEC_HADD(v_a_hydro_zSum, pi->a_hydro[2]);
+  VEC_HADD(v_u_dtSum, pi->u_dt);
+  VEC_HADD(v_h_dtSum, pi->force.h_dt);
+}
+
+/**
+ * @brief Compute the cell self-interaction of one of the pressure-energy
+ * loops using vector intrinsics with one particle pi at a time.
+ *
+ * @param r The #runner.
+ * @param c The #cell.
+ * @param loop The #pu_vec_loop to run.
+ */
+static void pu_vec_doself(struct runner *r, struct cell *restrict c,
+                          const enum pu_vec_loop loop) {
+
+  const struct engine *e = r->e;
+  const struct cosmology *restrict cosmo = e->cosmology;
+  struct part *restrict parts = c->hydro.parts;
+  const int count = c->hydro.count;
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+
+  /* Anything to do here? */
+  if (!cell_is_active_hydro(c, e)) return;
+
+  if (!cell_are_part_drifted(c, e)) error("Interacting undrifted cell.");
+
+#ifdef SWIFT_DEBUG_CHECKS
+  for (int i = 0; i < count; i++) {
+    /* Check that particles have been drifted to the current time */
+    if (parts[i].ti_drift != e->ti_current && !part_is_inhibited(&parts[i], e))
+      error("Particle pi not drifted to current time");
+  }
+#endif
+
+  /* Get the particle cache from the runner and re-allocate
+   * the cache if it is not big enough for the cell. */
+  struct cache *restrict cell_cache = &r->ci_cache;
+  if (cell_cache->count < count) cache_init(cell_cache, count);
+
+  /* Read the particles from the cell and store them locally in the cache. */
+  const int count_align =
+      (loop == pu_vec_loop_density)
+          ? cache_read_particles(c, runner_vec_density_soa(e, c), cell_cache)
+          : cache_read_force_particles(c, cell_cache);
+
+  /* Loop over the particles in the cell. */
+  for (int pid = 0; pid < count; pid++) {
+
+    /* Get a pointer to the ith particle. */
+    struct part *restrict pi = &parts[pid];
+
+    /* Is the i^th particle active? */
+    if (!part_is_active(pi, e)) continue;
+
+    switch (loop) {
+      case pu_vec_loop_density:
+        pu_vec_density_loop(pi, cell_cache, pid, cell_cache, 0, count_align);
+        break;
+      case pu_vec_loop_gradient:
+        pu_vec_gradient_loop(pi, cell_cache, pid, cell_cache, 0, count_align,
+                             a, H);
+        break;
+      case pu_vec_loop_force:
+        pu_vec_force_loop(pi, cell_cache, pid, cell_cache, 0, count_align, a,
+                          H);
+        break;
+    }
+  }
+}
+
+/**
+ * @brief Compute the interactions between a cell pair for one of the
+ * pressure-energy loops using vector intrinsics with one particle pi at a
+ * time.
+ *
+ * The particles are read into the caches in sorted order and only the range
+ * of neighbours that can be within reach of each particle is visited, using
+ * the same pruning as the Gadget-2 vectorised pair interactions.
+ *
+ * @param r The #runner.
+ * @param ci The first #cell.
+ * @param cj The second #cell.
+ * @param sid The direction of the pair.
+ * @param shift The shift vector to apply to the particles in ci.
+ * @param loop The #pu_vec_loop to run.
+ */
+static void pu_vec_dopair(struct runner *r, struct cell *ci, struct cell *cj,
+                          const int sid, const double *shift,
+                          const enum pu_vec_loop loop) {
+
+  const struct engine *restrict e = r->e;
+  const struct cosmology *restrict cosmo = e->cosmology;
+  const timebin_t max_active_bin = e->max_active_bin;
+  const int is_force = (loop == pu_vec_loop_force);
+
+  /* Check whether cells are local to the node. */
+  const int ci_local = (ci->nodeID == e->nodeID);
+  const int cj_local = (cj->nodeID == e->nodeID);
+
+  /* Get the cutoff shift. */
+  double rshift = 0.0;
+  for (int k = 0; k < 3; k++) rshift += shift[k] * runner_shift[sid][k];
+
+  /* Pick-out the sorted lists. */
+  const struct entry *restrict sort_i = ci->hydro.sort[sid];
+  const struct entry *restrict sort_j = cj->hydro.sort[sid];
+
+  /* Get some other useful values. The force loop has to include the
+   * neighbours' smoothing lengths in the search for interactions. */
+  const int count_i = ci->hydro.count;
+  const int count_j = cj->hydro.count;
+  const double hi_max_raw = ci->hydro.h_max;
+  const double hj_max_raw = cj->hydro.h_max;
+  const double hi_max = is_force ? hi_max_raw * kernel_gamma
+                                 : hi_max_raw * kernel_gamma - rshift;
+  const double hj_max = hj_max_raw * kernel_gamma;
+  const double h_max = is_force ? max(hi_max, hj_max) : 0.;
+  struct part *restrict parts_i = ci->hydro.parts;
+  struct part *restrict parts_j = cj->hydro.parts;
+  const double di_max = sort_i[count_i - 1].d - rshift;
+  const double dj_min = sort_j[0].d;
+  const float dx_max = (ci->hydro.dx_max_sort + cj->hydro.dx_max_sort);
+  const int active_ci = cell_is_active_hydro(ci, e) && ci_local;
+  const int active_cj = cell_is_active_hydro(cj, e) && cj_local;
+
+  /* Cosmological terms */
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  /* Check that particles have been drifted to the current time */
+  for (int pid = 0; pid < count_i; pid++)
+    if (parts_i[pid].ti_drift != e->ti_current &&
+        !part_is_inhibited(&parts_i[pid], e))
+      error("Particle pi not drifted to current time");
+  for (int pjd = 0; pjd < count_j; pjd++)
+    if (parts_j[pjd].ti_drift != e->ti_current &&
+        !part_is_inhibited(&parts_j[pjd], e))
+      error("Particle pj not drifted to current time");
+#endif
+
+  /* Count number of particles that are in range and active */
+  const double hi_reach = is_force ? h_max : hi_max;
+  const double hj_reach = is_force ? h_max : hj_max;
+  int numActive = 0;
+
+  if (active_ci) {
+    for (int pid = count_i - 1;
+         pid >= 0 && sort_i[pid].d + hi_reach + dx_max > dj_min; pid--) {
+      const struct part *restrict pi = &parts_i[sort_i[pid].i];
+      if (part_is_active_no_debug(pi, max_active_bin)) {
+        numActive++;
+        break;
+      }
+    }
+  }
+
+  if (!numActive && active_cj) {
+    for (int pjd = 0;
+         pjd < count_j && sort_j[pjd].d - hj_reach - dx_max < di_max; pjd++) {
+      const struct part *restrict pj = &parts_j[sort_j[pjd].i];
+      if (part_is_active_no_debug(pj, max_active_bin)) {
+        numActive++;
+        break;
+      }
+    }
+  }
+
+  /* Return if there are no active particles within range */
+  if (numActive == 0) return;
+
+  /* Get both particle caches from the runner and re-allocate
+   * them if they are not big enough for the cells. */
+  struct cache *restrict ci_cache = &r->ci_cache;
+  struct cache *restrict cj_cache = &r->cj_cache;
+  if (ci_cache->count < count_i) cache_init(ci_cache, count_i);
+  if (cj_cache->count < count_j) cache_init(cj_cache, count_j);
+
+  /* Get a direct pointer to the index arrays */
+  int first_pi, last_pj;
+  swift_declare_aligned_ptr(int, max_index_i, r->ci_cache.max_index,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(int, max_index_j, r->cj_cache.max_index,
+                            SWIFT_CACHE_ALIGNMENT);
+
+  /* Find particles maximum index into cj, max_index_i[] and ci, max_index_j[].
+   * Also find the first pi that interacts with any particle in cj and the last
+   * pj that interacts with any particle in ci. */
+  if (is_force)
+    populate_max_index_force(ci, cj, sort_i, sort_j, dx_max, rshift,
+                             hi_max_raw, hj_max_raw, h_max, di_max, dj_min,
+                             max_index_i, max_index_j, &first_pi, &last_pj,
+                             max_active_bin, active_ci, active_cj);
+  else
+    populate_max_index_density(ci, cj, sort_i, sort_j, dx_max, rshift, hi_max,
+                               hj_max, di_max, dj_min, max_index_i,
+                               max_index_j, &first_pi, &last_pj,
+                               max_active_bin, active_ci, active_cj);
+
+  /* Limits of the outer loops. */
+  const int first_pi_loop = first_pi;
+  const int last_pj_loop_end = last_pj + 1;
+
+  /* Take the max/min of both values calculated to work out how many particles
+   * to read into the cache. */
+  last_pj = max(last_pj, max_index_i[count_i - 1]);
+  first_pi = min(first_pi, max_index_j[0]);
+
+  /* Read the required particles into the two caches. */
+  if (loop == pu_vec_loop_density)
+    cache_read_two_partial_cells_sorted(
+        ci, cj, runner_vec_density_soa(e, ci), runner_vec_density_soa(e, cj),
+        ci_cache, cj_cache, sort_i, sort_j, shift, &first_pi, &last_pj);
+  else
+    cache_read_two_partial_cells_sorted_force(ci, cj, ci_cache, cj_cache,
+                                              sort_i, sort_j, shift, &first_pi,
+                                              &last_pj);
+
+  /* Get the number of particles read into the ci cache. */
+  const int ci_cache_count = count_i - first_pi;
+
+  if (active_ci) {
+
+    /* Loop over the parts in ci until nothing is within range in cj. */
+    for (int pid = count_i - 1; pid >= first_pi_loop; pid--) {
+
+      /* Get a hold of the ith part in ci. */
+      struct part *restrict pi = &parts_i[sort_i[pid].i];
+      if (!part_is_active(pi, e)) continue;
+
+      /* Set the cache index. */
+      const int ci_cache_idx = pid - first_pi;
+
+      /* Skip this particle if no particle in cj is within range of it. */
+      const float hi = ci_cache->h[ci_cache_idx];
+      const double hi_test = is_force ? max(hi, hj_max_raw) : hi;
+      const double di_test =
+          sort_i[pid].d + hi_test * kernel_gamma + dx_max - rshift;
+      if (di_test < dj_min) continue;
+
+      /* Determine the exit iteration of the interaction loop. */
+      const int exit_iteration_end = max_index_i[pid] + 1;
+
+      switch (loop) {
+        case pu_vec_loop_density:
+          pu_vec_density_loop(pi, ci_cache, ci_cache_idx, cj_cache, 0,
+                              exit_iteration_end);
+          break;
+        case pu_vec_loop_gradient:
+          pu_vec_gradient_loop(pi, ci_cache, ci_cache_idx, cj_cache, 0,
+                               exit_iteration_end, a, H);
+          break;
+        case pu_vec_loop_force:
+          pu_vec_force_loop(pi, ci_cache, ci_cache_idx, cj_cache, 0,
+                            exit_iteration_end, a, H);
+          break;
+      }
+    }
+  }
+
+  if (active_cj) {
+
+    /* Loop over the parts in cj until nothing is within range in ci. */
+    for (int pjd = 0; pjd < last_pj_loop_end; pjd++) {
+
+      /* Get a hold of the jth part in cj. */
+      struct part *restrict pj = &parts_j[sort_j[pjd].i];
+      if (!part_is_active(pj, e)) continue;
+
+      /* Set the cache index. */
+      const int cj_cache_idx = pjd;
+
+      /* Skip this particle if no particle in ci is within range of it. */
+      const float hj = cj_cache->h[cj_cache_idx];
+      const double hj_test = is_force ? max(hj, hi_max_raw) : hj;
+      const double dj_test = sort_j[pjd].d - hj_test * kernel_gamma - dx_max;
+      if (dj_test > di_max) continue;
+
+      /* Convert exit iteration to cache indices and pad it so that cache
+       * reads are aligned. */
+      int exit_iteration_align = max_index_j[pjd] - first_pi;
+      if (exit_iteration_align < VEC_SIZE)
+        exit_iteration_align = 0;
+      else
+        exit_iteration_align -= exit_iteration_align % VEC_SIZE;
+
+      switch (loop) {
+        case pu_vec_loop_density:
+          pu_vec_density_loop(pj, cj_cache, cj_cache_idx, ci_cache,
+                              exit_iteration_align, ci_cache_count);
+          break;
+        case pu_vec_loop_gradient:
+          pu_vec_gradient_loop(pj, cj_cache, cj_cache_idx, ci_cache,
+                               exit_iteration_align, ci_cache_count, a, H);
+          break;
+        case pu_vec_loop_force:
+          pu_vec_force_loop(pj, cj_cache, cj_cache_idx, ci_cache,
+                            exit_iteration_align, ci_cache_count, a, H);
+          break;
+      }
+    }
+  }
+}
+
+#endif /* ANARCHY_PU_SPH */
+
+#endif /* WITH_VECTORIZATION && (GADGET2_SPH || ANARCHY_PU_SPH) */
 
 /**
  * @brief Compute the cell self-interaction (non-symmetric) using vector
@@ -675,7 +1295,8 @@ void runner_doself1_density_vec(struct runner *r, struct cell *restrict c) {
   if (cell_cache->count < count) cache_init(cell_cache, count);
 
   /* Read the particles from the cell and store them locally in the cache. */
-  const int count_align = cache_read_particles(c, cell_cache);
+  const int count_align =
+      cache_read_particles(c, runner_vec_density_soa(e, c), cell_cache);
 
   /* Create secondary cache to store particle interactions. */
   struct c2_cache int_cache;
@@ -862,6 +1483,14 @@ void runner_doself1_density_vec(struct runner *r, struct cell *restrict c) {
 
   TIMER_TOC(timer_doself_density);
 
+#elif defined(WITH_VECTORIZATION) && defined(ANARCHY_PU_SPH)
+
+  TIMER_TIC;
+
+  pu_vec_doself(r, c, pu_vec_loop_density);
+
+  TIMER_TOC(timer_doself_density);
+
 #else
 
   error("Incorrectly calling vectorized Gadget-2 functions!");
@@ -1283,6 +1912,14 @@ void runner_doself2_force_vec(struct runner *r, struct cell *restrict c) {
 
   TIMER_TOC(timer_doself_force);
 
+#elif defined(WITH_VECTORIZATION) && defined(ANARCHY_PU_SPH)
+
+  TIMER_TIC;
+
+  pu_vec_doself(r, c, pu_vec_loop_force);
+
+  TIMER_TOC(timer_doself_force);
+
 #else
 
   error("Incorrectly calling vectorized Gadget-2 functions!");
@@ -1290,6 +1927,30 @@ void runner_doself2_force_vec(struct runner *r, struct cell *restrict c) {
 #endif /* WITH_VECTORIZATION */
 }
 
+/**
+ * @brief Compute the cell self-interaction for the gradient loop
+ * (non-symmetric) using vector intrinsics with one particle pi at a time.
+ *
+ * @param r The #runner.
+ * @param c The #cell.
+ */
+void runner_doself1_gradient_vec(struct runner *r, struct cell *restrict c) {
+
+#if defined(WITH_VECTORIZATION) && defined(ANARCHY_PU_SPH)
+
+  TIMER_TIC;
+
+  pu_vec_doself(r, c, pu_vec_loop_gradient);
+
+  TIMER_TOC(timer_doself_gradient);
+
+#else
+
+  error("Incorrectly calling vectorized gradient functions!");
+
+#endif /* WITH_VECTORIZATION */
+}
+
 /**
  * @brief Compute the density interactions between a cell pair (non-symmetric)
  * using vector intrinsics.
@@ -1408,8 +2069,9 @@ void runner_dopair1_density_vec(struct runner *r, struct cell *ci,
   first_pi = min(first_pi, max_index_j[0]);
 
   /* Read the required particles into the two caches. */
-  cache_read_two_partial_cells_sorted(ci, cj, ci_cache, cj_cache, sort_i,
-                                      sort_j, shift, &first_pi, &last_pj);
+  cache_read_two_partial_cells_sorted(
+      ci, cj, runner_vec_density_soa(e, ci), runner_vec_density_soa(e, cj),
+      ci_cache, cj_cache, sort_i, sort_j, shift, &first_pi, &last_pj);
 
   /* Get the number of particles read into the ci cache. */
   const int ci_cache_count = count_i - first_pi;
@@ -1691,6 +2353,14 @@ void runner_dopair1_density_vec(struct runner *r, struct cell *ci,
 
   TIMER_TOC(timer_dopair_density);
 
+#elif defined(WITH_VECTORIZATION) && defined(ANARCHY_PU_SPH)
+
+  TIMER_TIC;
+
+  pu_vec_dopair(r, ci, cj, sid, shift, pu_vec_loop_density);
+
+  TIMER_TOC(timer_dopair_density);
+
 #else
 
   error("Incorrectly calling vectorized Gadget-2 functions!");
@@ -2478,9 +3148,46 @@ void runner_dopair2_force_vec(struct runner *r, struct cell *ci,
     TIMER_TOC(timer_dopair_density);
   }
 
+#elif defined(WITH_VECTORIZATION) && defined(ANARCHY_PU_SPH)
+
+  TIMER_TIC;
+
+  pu_vec_dopair(r, ci, cj, sid, shift, pu_vec_loop_force);
+
+  TIMER_TOC(timer_dopair_force);
+
 #else
 
   error("Incorrectly calling vectorized Gadget-2 functions!");
 
 #endif /* WITH_VECTORIZATION */
 }
+
+/**
+ * @brief Compute the interactions between a cell pair for the gradient loop
+ * (non-symmetric) using vector intrinsics with one particle pi at a time.
+ *
+ * @param r The #runner.
+ * @param ci The first #cell.
+ * @param cj The second #cell.
+ * @param sid The direction of the pair
+ * @param shift The shift vector to apply to the particles in ci.
+ */
+void runner_dopair1_gradient_vec(struct runner *r, struct cell *ci,
+                                 struct cell *cj, const int sid,
+                                 const double *shift) {
+
+#if defined(WITH_VECTORIZATION) && defined(ANARCHY_PU_SPH)
+
+  TIMER_TIC;
+
+  pu_vec_dopair(r, ci, cj, sid, shift, pu_vec_loop_gradient);
+
+  TIMER_TOC(timer_dopair_gradient);
+
+#else
+
+  error("Incorrectly calling vectorized gradient functions!");
+
+#endif /* WITH_VECTORIZATION */
+}
@@ -39,6 +39,7 @@ void runner_doself_subset_density_vec(struct runner *r,
                                       struct part *restrict parts,
                                       int *restrict ind, int count);
 void runner_doself1_density_vec(struct runner *r, struct cell *restrict c);
+void runner_doself1_gradient_vec(struct runner *r, struct cell *restrict c);
 void runner_doself2_force_vec(struct runner *r, struct cell *restrict c);
 void runner_dopair_subset_density_vec(struct runner *r,
                                       struct cell *restrict ci,
@@ -49,6 +50,9 @@ void runner_dopair_subset_density_vec(struct runner *r,
 void runner_dopair1_density_vec(struct runner *r, struct cell *restrict ci,
                                 struct cell *restrict cj, const int sid,
                                 const double *shift);
+void runner_dopair1_gradient_vec(struct runner *r, struct cell *restrict ci,
+                                 struct cell *restrict cj, const int sid,
+                                 const double *shift);
 void runner_dopair2_force_vec(struct runner *r, struct cell *restrict ci,
                               struct cell *restrict cj, const int sid,
                               const double *shift);
@@ -40,6 +40,7 @@
 #include "scheduler.h"
 
 /* Local headers. */
+#include "active.h"
 #include "atomic.h"
 #include "cycle.h"
 #include "engine.h"
@@ -47,6 +48,7 @@
 #include "intrinsics.h"
 #include "kernel_hydro.h"
 #include "memuse.h"
+#include "proxy.h"
 #include "queue.h"
 #include "sort_part.h"
 #include "space.h"
@@ -587,7 +589,9 @@ static void scheduler_splittask_hydro(struct task *t, struct scheduler *s) {
       /* Is this cell even split and the task does not violate h ? */
       if (cell_can_split_self_hydro_task(ci)) {
         /* Make a sub? */
-        if (scheduler_dosub && ci->hydro.count < space_subsize_self_hydro) {
+        if (scheduler_dosub &&
+            ci->hydro.count < space_cell_split_size(
+                                  s->space, ci, space_subsize_self_hydro, 1)) {
           /* convert to a self-subtask. */
           t->type = task_type_sub_self;
 
@@ -667,7 +671,9 @@ static void scheduler_splittask_hydro(struct task *t, struct scheduler *s) {
         /* Replace by a single sub-task? */
         if (scheduler_dosub && /* Use division to avoid integer overflow. */
             ci->hydro.count * sid_scale[sid] <
-                space_subsize_pair_hydro / cj->hydro.count &&
+                space_cell_split_size(s->space, ci, space_subsize_pair_hydro,
+                                      2) /
+                    cj->hydro.count &&
             !sort_is_corner(sid)) {
           /* Make this task a sub task. */
           t->type = task_type_sub_pair;
@@ -717,6 +723,38 @@ static void scheduler_splittask_hydro(struct task *t, struct scheduler *s) {
   }   /* iterate over the current task. */
 }
 
+/**
+ * @brief Should a gravity pair task small enough to be done in one go be
+ * split anyway?
+ *
+ * We split the pairs with a foreign cell for which some of the pairs of
+ * progeny can interact via their multipoles only. The multipoles of the
+ * foreign cells come with them at rebuild time, so the #gpart of the
+ * progeny involved in these interactions then need not be sent at all.
+ *
+ * @param s The #scheduler.
+ * @param ci The first #cell of the pair.
+ * @param cj The second #cell of the pair.
+ */
+static int scheduler_split_foreign_gravity(const struct scheduler *s,
+                                           const struct cell *ci,
+                                           const struct cell *cj) {
+
+  if (!(s->flags & scheduler_flag_split_foreign_grav)) return 0;
+  if (ci->nodeID == s->nodeID && cj->nodeID == s->nodeID) return 0;
+
+  const struct space *sp = s->space;
+  for (int i = 0; i < 8; i++) {
+    if (ci->progeny[i] == NULL) continue;
+    for (int j = 0; j < 8; j++)
+      if (cj->progeny[j] != NULL &&
+          cell_can_use_pair_mm_rebuild(ci->progeny[i], cj->progeny[j], sp->e,
+                                       sp))
+        return 1;
+  }
+  return 0;
+}
+
 /**
  * @brief Split a gravity task if too large.
  *
@@ -755,7 +793,9 @@ static void scheduler_splittask_gravity(struct task *t, struct scheduler *s) {
 
       /* Should we split this task? */
       if (cell_can_split_self_gravity_task(ci)) {
-        if (scheduler_dosub && ci->grav.count < space_subsize_self_grav) {
+        if (scheduler_dosub &&
+            ci->grav.count < space_cell_split_size(
+                                 s->space, ci, space_subsize_self_grav, 1)) {
           /* Otherwise, split it. */
         } else {
           /* Take a step back (we're going to recycle the current task)... */
@@ -810,7 +850,10 @@ static void scheduler_splittask_gravity(struct task *t, struct scheduler *s) {
 
         /* Replace by a single sub-task? */
         if (scheduler_dosub &&
-            gcount_i * gcount_j < ((long long)space_subsize_pair_grav)) {
+            gcount_i * gcount_j <
+                space_cell_split_size(s->space, ci, space_subsize_pair_grav,
+                                      2) &&
+            !scheduler_split_foreign_gravity(s, ci, cj)) {
           /* Otherwise, split it. */
         } else {
           /* Turn the task into a M-M task that will take care of all the
@@ -971,6 +1014,9 @@ void scheduler_splittasks_mapper(void *map_data, int num_elements,
   for (int ind = 0; ind < num_elements; ind++) {
     struct task *t = &tasks[ind];
 
+    /* Skip the unused tasks of the blocks of tasks. */
+    if (t->type == task_type_none) continue;
+
     /* Invoke the correct splitting strategy */
     if (t->subtype == task_subtype_density) {
       scheduler_splittask_hydro(t, s);
@@ -998,6 +1044,9 @@ void scheduler_splittasks_mapper(void *map_data, int num_elements,
  */
 void scheduler_splittasks(struct scheduler *s, const int fof_tasks) {
 
+  /* Split all the tasks made so far. */
+  scheduler_release_blocks(s);
+
   if (fof_tasks) {
     /* Call the mapper on each current task. */
     threadpool_map(s->threadpool, scheduler_splittasks_fof_mapper, s->tasks,
@@ -1008,11 +1057,106 @@ void scheduler_splittasks(struct scheduler *s, const int fof_tasks) {
     threadpool_map(s->threadpool, scheduler_splittasks_mapper, s->tasks,
                    s->nr_tasks, sizeof(struct task), 0, s);
   }
+
+  /* Add the tasks made by the splitting. */
+  scheduler_release_blocks(s);
+}
+
+/**
+ * @brief Get the block of tasks and links of the calling thread.
+ *
+ * The block is (re-)registered with the #scheduler, empty, the first time
+ * the thread uses it after the blocks were released.
+ *
+ * @param s The #scheduler we are working in.
+ */
+struct scheduler_thread_block *scheduler_get_thread_block(
+    struct scheduler *s) {
+
+  struct scheduler_thread_block *b =
+      (struct scheduler_thread_block *)pthread_getspecific(
+          s->thread_block_key);
+
+  /* First time this thread makes tasks? */
+  if (b == NULL) {
+    if ((b = (struct scheduler_thread_block *)malloc(
+             sizeof(struct scheduler_thread_block))) == NULL)
+      error("Failed to allocate the block of tasks of a thread.");
+    b->generation = s->thread_blocks_generation - 1;
+    if (pthread_setspecific(s->thread_block_key, b) != 0)
+      error("Failed to set the block of tasks of a thread.");
+  }
+
+  /* Blocks released since the thread last used its own? */
+  if (b->generation != s->thread_blocks_generation) {
+    b->generation = s->thread_blocks_generation;
+    b->next = b->end = 0;
+    b->link_next = b->link_end = 0;
+    const int ind = atomic_inc(&s->nr_thread_blocks);
+    b->unblocked = (ind >= scheduler_max_thread_blocks);
+    if (!b->unblocked) s->thread_blocks[ind] = b;
+  }
+
+  return b;
+}
+
+/**
+ * @brief Release the blocks of tasks reserved by the threads and add the
+ * tasks made since the last release to the task list.
+ *
+ * The unused tasks at the end of the blocks become implicit tasks of type
+ * #task_type_none which are never enqueued. Must be called by a single
+ * thread once the others are done making tasks.
+ *
+ * @param s The #scheduler.
+ */
+void scheduler_release_blocks(struct scheduler *s) {
+
+  const int nr_tasks = min(s->tasks_next, s->size);
+  const int nr_blocks = min(s->nr_thread_blocks, scheduler_max_thread_blocks);
+
+  for (int k = 0; k < nr_blocks; k++) {
+    const struct scheduler_thread_block *b = s->thread_blocks[k];
+    for (int ind = b->next; ind < min(b->end, nr_tasks); ind++) {
+      struct task *t = &s->tasks[ind];
+      t->type = task_type_none;
+      t->subtype = task_subtype_none;
+      t->flags = 0;
+      t->wait = 0;
+      t->ci = NULL;
+      t->cj = NULL;
+      t->skip = 1;
+      t->implicit = 1;
+      t->weight = 0;
+#ifdef SWIFT_DEBUG_CHECKS
+      t->rank = 0;
+#endif
+      t->nr_unlock_tasks = 0;
+#ifdef SWIFT_DEBUG_TASKS
+      t->rid = -1;
+#endif
+      t->tic = 0;
+      t->toc = 0;
+    }
+  }
+
+  /* Add the indices of the new tasks. */
+  for (int ind = s->nr_tasks; ind < nr_tasks; ind++) s->tasks_ind[ind] = ind;
+  s->nr_tasks = nr_tasks;
+
+  /* Make the threads register new blocks. */
+  s->nr_thread_blocks = 0;
+  s->thread_blocks_generation++;
 }
 
 /**
  * @brief Add a #task to the #scheduler.
  *
+ * The task is taken from the block of tasks of the calling thread, which
+ * only reserves a new block from the shared counter once that one is used
+ * up. The task only appears in the task list after the next call to
+ * scheduler_release_blocks().
+ *
  * @param s The #scheduler we are working in.
  * @param type The type of the task.
  * @param subtype The sub-type of the task.
@@ -1025,8 +1169,19 @@ void scheduler_splittasks(struct scheduler *s, const int fof_tasks) {
 struct task *scheduler_addtask(struct scheduler *s, enum task_types type,
                                enum task_subtypes subtype, int flags,
                                int implicit, struct cell *ci, struct cell *cj) {
-  /* Get the next free task. */
-  const int ind = atomic_inc(&s->tasks_next);
+
+  /* Get the next free task, reserving a new block if needed. */
+  struct scheduler_thread_block *b = scheduler_get_thread_block(s);
+  int ind;
+  if (b->unblocked) {
+    ind = atomic_inc(&s->tasks_next);
+  } else {
+    if (b->next == b->end) {
+      b->next = atomic_add(&s->tasks_next, s->block_size);
+      b->end = b->next + s->block_size;
+    }
+    ind = b->next++;
+  }
 
   /* Overflow? */
   if (ind >= s->size)
@@ -1048,7 +1203,9 @@ struct task *scheduler_addtask(struct scheduler *s, enum task_types type,
   t->skip = 1; /* Mark tasks as skip by default. */
   t->implicit = implicit;
   t->weight = 0;
+#ifdef SWIFT_DEBUG_CHECKS
   t->rank = 0;
+#endif
   t->nr_unlock_tasks = 0;
 #ifdef SWIFT_DEBUG_TASKS
   t->rid = -1;
@@ -1056,21 +1213,282 @@ struct task *scheduler_addtask(struct scheduler *s, enum task_types type,
   t->tic = 0;
   t->toc = 0;
 
-  /* Add an index for it. */
-  // lock_lock( &s->lock );
-  s->tasks_ind[atomic_inc(&s->nr_tasks)] = ind;
-  // lock_unlock_blind( &s->lock );
-
   /* Return a pointer to the new task. */
   return t;
 }
 
+#ifdef WITH_MPI
 /**
- * @brief Set the unlock pointers in each task.
+ * @brief Free the table of MPI states of the send and recv tasks and the
+ * persistent requests they hold.
  *
  * @param s The #scheduler.
  */
-void scheduler_set_unlocks(struct scheduler *s) {
+static void scheduler_free_comms(struct scheduler *s) {
+
+  /* The requests are gone with MPI when we clean up at the very end. */
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+
+  for (int k = 0; k < s->nr_comms && !finalized; k++) {
+    if (s->comms[k].persistent == MPI_REQUEST_NULL) continue;
+    const int err = MPI_Request_free(&s->comms[k].persistent);
+    if (err != MPI_SUCCESS)
+      mpi_error(err, "Failed to free a persistent request.");
+  }
+  if (s->comms != NULL) swift_free("task_comms", s->comms);
+  s->comms = NULL;
+  s->nr_comms = 0;
+  task_comms = NULL;
+}
+
+/**
+ * @brief Start the communication of a send or recv task with the persistent
+ * request of the task.
+ *
+ * The request is made the first time the task runs after a rebuild, or
+ * again if its buffer or size changed since, and re-used in the following
+ * steps such that the messages are not set up from scratch every time.
+ *
+ * @param t The send or recv #task.
+ * @param buff The buffer of the message.
+ * @param count The number of elements in the buffer.
+ * @param type The MPI type of the elements.
+ * @param sync Do we send in synchronous mode?
+ *
+ * @return The MPI error code.
+ */
+static int scheduler_start_persistent(struct task *t, void *buff,
+                                      const int count, MPI_Datatype type,
+                                      const int sync) {
+
+  struct task_comm *comm = task_get_comm(t);
+  const MPI_Comm mpi_comm = subtaskMPI_comms[t->subtype];
+  int err = MPI_SUCCESS;
+
+  /* Drop the request if the message changed. */
+  if (comm->persistent != MPI_REQUEST_NULL &&
+      (comm->persistent_buff != buff || comm->persistent_count != count))
+    err = MPI_Request_free(&comm->persistent);
+
+  /* Make the request if needed. */
+  if (err == MPI_SUCCESS && comm->persistent == MPI_REQUEST_NULL) {
+    if (t->type == task_type_recv)
+      err = MPI_Recv_init(buff, count, type, t->ci->nodeID, t->flags,
+                          mpi_comm, &comm->persistent);
+    else if (sync)
+      err = MPI_Ssend_init(buff, count, type, t->cj->nodeID, t->flags,
+                           mpi_comm, &comm->persistent);
+    else
+      err = MPI_Send_init(buff, count, type, t->cj->nodeID, t->flags,
+                          mpi_comm, &comm->persistent);
+    comm->persistent_buff = buff;
+    comm->persistent_count = count;
+  }
+
+  /* Start the communication, the request stays valid once it completed. */
+  if (err == MPI_SUCCESS) err = MPI_Start(&comm->persistent);
+  comm->req = comm->persistent;
+  return err;
+}
+#endif
+
+/**
+ * @brief Give the send and recv tasks their slot in the table of MPI
+ * states.
+ *
+ * Only the communication tasks carry a buffer and a request, so these live
+ * in a separate table rather than in every #task. This needs to be called
+ * once all the tasks have been created.
+ *
+ * @param s The #scheduler.
+ */
+void scheduler_set_comms(struct scheduler *s) {
+
+#ifdef WITH_MPI
+  /* Count the communication tasks. */
+  int count = 0;
+  for (int k = 0; k < s->nr_tasks; k++)
+    if (s->tasks[k].type == task_type_send ||
+        s->tasks[k].type == task_type_recv)
+      count++;
+
+  /* (Re)allocate the table. */
+  scheduler_free_comms(s);
+  if (count > 0 &&
+      (s->comms = (struct task_comm *)swift_calloc(
+           "task_comms", count, sizeof(struct task_comm))) == NULL)
+    error("Failed to allocate the MPI states of the tasks.");
+  s->nr_comms = count;
+  task_comms = s->comms;
+
+  /* Hand out the slots. */
+  count = 0;
+  for (int k = 0; k < s->nr_tasks; k++) {
+    struct task *t = &s->tasks[k];
+    if (t->type == task_type_send || t->type == task_type_recv) {
+      t->comm = count;
+      s->comms[count].buff = NULL;
+      s->comms[count].req = MPI_REQUEST_NULL;
+      s->comms[count].persistent = MPI_REQUEST_NULL;
+      count++;
+    } else {
+      t->comm = -1;
+    }
+  }
+#endif
+}
+
+/**
+ * @brief Data used by the #threadpool_map functions of
+ * scheduler_set_unlocks().
+ */
+struct scheduler_set_unlocks_data {
+
+  /* The #scheduler. */
+  struct scheduler *s;
+
+  /* Number of unlocks per chunk of unlocks. */
+  int chunk_size;
+
+  /* Number of blocks of tasks and log2 of the number of tasks per block. */
+  int nr_blocks, block_shift;
+
+  /* Number of unlocks of each chunk going to each block, then their
+   * offsets. */
+  int *histogram;
+
+  /* Offset of the unlocks of each block. */
+  int *block_offsets;
+
+  /* The unlocks, sorted by block. */
+  int *temp_ind;
+  struct task **temp_unlocks;
+
+  /* Per-task counter. */
+  int *offsets;
+};
+
+/**
+ * @brief #threadpool_map function counting the unlocks of a chunk going to
+ * each block of tasks.
+ */
+void scheduler_count_unlocks_mapper(void *map_data, int num_elements,
+                                    void *extra_data) {
+
+  struct scheduler_set_unlocks_data *data =
+      (struct scheduler_set_unlocks_data *)extra_data;
+  const struct scheduler *s = data->s;
+  int *histogram = (int *)map_data;
+
+  for (int c = 0; c < num_elements; c++) {
+    int *hist = &histogram[c * data->nr_blocks];
+    const int chunk = (hist - data->histogram) / data->nr_blocks;
+    const int k_begin = chunk * data->chunk_size;
+    const int k_end = min(k_begin + data->chunk_size, s->nr_unlocks);
+
+    bzero(hist, sizeof(int) * data->nr_blocks);
+    for (int k = k_begin; k < k_end; k++)
+      hist[s->unlock_ind[k] >> data->block_shift]++;
+  }
+}
+
+/**
+ * @brief #threadpool_map function moving the unlocks of a chunk to the
+ * bucket of their block of tasks.
+ */
+void scheduler_bucket_unlocks_mapper(void *map_data, int num_elements,
+                                     void *extra_data) {
+
+  struct scheduler_set_unlocks_data *data =
+      (struct scheduler_set_unlocks_data *)extra_data;
+  const struct scheduler *s = data->s;
+  int *histogram = (int *)map_data;
+
+  for (int c = 0; c < num_elements; c++) {
+    int *offsets = &histogram[c * data->nr_blocks];
+    const int chunk = (offsets - data->histogram) / data->nr_blocks;
+    const int k_begin = chunk * data->chunk_size;
+    const int k_end = min(k_begin + data->chunk_size, s->nr_unlocks);
+
+    for (int k = k_begin; k < k_end; k++) {
+      const int ind = offsets[s->unlock_ind[k] >> data->block_shift]++;
+      data->temp_ind[ind] = s->unlock_ind[k];
+      data->temp_unlocks[ind] = s->unlocks[k];
+    }
+  }
+}
+
+/**
+ * @brief #threadpool_map function sorting the unlocks of a block of tasks
+ * and setting the unlock pointers of these tasks.
+ */
+void scheduler_link_unlocks_mapper(void *map_data, int num_elements,
+                                   void *extra_data) {
+
+  struct scheduler_set_unlocks_data *data =
+      (struct scheduler_set_unlocks_data *)extra_data;
+  struct scheduler *s = data->s;
+  int *block_offsets = (int *)map_data;
+  int *offsets = data->offsets;
+
+  for (int b = 0; b < num_elements; b++) {
+    const int block = &block_offsets[b] - data->block_offsets;
+    const int t_begin = block << data->block_shift;
+    const int t_end = min((block + 1) << data->block_shift, s->nr_tasks);
+    const int u_begin = block_offsets[b];
+    const int u_end = block_offsets[b + 1];
+
+    /* Count the unlocks of each task. */
+    for (int k = t_begin; k < t_end; k++) offsets[k] = 0;
+    for (int k = u_begin; k < u_end; k++) offsets[data->temp_ind[k]]++;
+
+    /* Set the unlocks in the tasks. */
+    for (int k = t_begin, offset = u_begin; k < t_end; k++) {
+      struct task *t = &s->tasks[k];
+
+#ifdef SWIFT_DEBUG_CHECKS
+      /* Check that we are not overflowing */
+      if (offsets[k] > (1LL << (8 * sizeof(short int) - 1)) - 1)
+        error("Task (type=%s/%s) unlocking more than %lld other tasks!",
+              taskID_names[t->type], subtaskID_names[t->subtype],
+              (1LL << (8 * sizeof(short int) - 1)) - 1);
+#endif
+
+      t->nr_unlock_tasks = offsets[k];
+      t->unlock_tasks = &s->unlocks[offset];
+      offsets[k] = offset;
+      offset += t->nr_unlock_tasks;
+    }
+
+    /* Fill the sorted unlocks. */
+    for (int k = u_begin; k < u_end; k++)
+      s->unlocks[offsets[data->temp_ind[k]]++] = data->temp_unlocks[k];
+
+#ifdef SWIFT_DEBUG_CHECKS
+    /* Verify that there are no duplicate unlocks. */
+    for (int k = t_begin; k < t_end; k++) {
+      struct task *t = &s->tasks[k];
+      for (int i = 0; i < t->nr_unlock_tasks; i++) {
+        for (int j = i + 1; j < t->nr_unlock_tasks; j++) {
+          if (t->unlock_tasks[i] == t->unlock_tasks[j])
+            error("duplicate unlock! t->type=%s/%s unlocking type=%s/%s",
+                  taskID_names[t->type], subtaskID_names[t->subtype],
+                  taskID_names[t->unlock_tasks[i]->type],
+                  subtaskID_names[t->unlock_tasks[i]->subtype]);
+        }
+      }
+    }
+#endif
+  }
+}
+
+/**
+ * @brief Set the unlock pointers in each task with a serial counting sort.
+ *
+ * @param s The #scheduler.
+ */
+static void scheduler_set_unlocks_serial(struct scheduler *s) {
   /* Store the counts for each task. */
   short int *counts;
   if ((counts = (short int *)swift_malloc(
@@ -1154,11 +1572,195 @@ void scheduler_set_unlocks(struct scheduler *s) {
 }
 
 /**
- * @brief Sort the tasks in topological order over all queues.
+ * @brief Set the unlock pointers in each task.
+ *
+ * With several threads and enough tasks, the unlocks are sorted by task with
+ * a parallel two-pass bucket sort: the chunks of unlocks are first moved to
+ * the buckets of contiguous blocks of tasks and each block then sorts its own
+ * bucket. Both passes are stable, so the unlocks of each task stay in the
+ * order in which they were added.
  *
  * @param s The #scheduler.
  */
-void scheduler_ranktasks(struct scheduler *s) {
+void scheduler_set_unlocks(struct scheduler *s) {
+
+  if (s->threadpool->num_threads == 1 ||
+      s->nr_tasks < scheduler_parallel_min_tasks) {
+    scheduler_set_unlocks_serial(s);
+    return;
+  }
+
+  struct scheduler_set_unlocks_data data;
+  data.s = s;
+
+  /* Cut the unlocks in chunks and the tasks in blocks, all of them larger
+   * than the work per thread of a threadpool_map. */
+  const int nr_chunks = 4 * s->threadpool->num_threads;
+  data.chunk_size = s->nr_unlocks / nr_chunks + 1;
+  data.block_shift = 0;
+  while ((1 << data.block_shift) * nr_chunks < s->nr_tasks) data.block_shift++;
+  data.nr_blocks = (s->nr_tasks >> data.block_shift) + 1;
+
+  if ((data.histogram = (int *)swift_malloc(
+           "offsets", sizeof(int) * nr_chunks * data.nr_blocks)) == NULL ||
+      (data.block_offsets = (int *)swift_malloc(
+           "offsets", sizeof(int) * (data.nr_blocks + 1))) == NULL ||
+      (data.offsets = (int *)swift_malloc("offsets",
+                                          sizeof(int) * s->nr_tasks)) == NULL)
+    error("Failed to allocate temporary offsets array.");
+  if ((data.temp_ind = (int *)swift_malloc(
+           "unlock_ind", sizeof(int) * s->nr_unlocks)) == NULL ||
+      (data.temp_unlocks = (struct task **)swift_malloc(
+           "unlocks", sizeof(struct task *) * s->nr_unlocks)) == NULL)
+    error("Failed to allocate temporary unlocks array.");
+
+  /* Count the unlocks of each chunk going to each block. */
+  threadpool_map(s->threadpool, scheduler_count_unlocks_mapper, data.histogram,
+                 nr_chunks, sizeof(int) * data.nr_blocks, 1, &data);
+
+  /* Compute the offset of each block and of each chunk within them. */
+  for (int b = 0, offset = 0; b < data.nr_blocks; b++) {
+    data.block_offsets[b] = offset;
+    for (int c = 0; c < nr_chunks; c++) {
+      const int count = data.histogram[c * data.nr_blocks + b];
+      data.histogram[c * data.nr_blocks + b] = offset;
+      offset += count;
+
+#ifdef SWIFT_DEBUG_CHECKS
+      /* Check that we are not overflowing */
+      if (offset < 0) error("Task unlock offset array overflowing");
+#endif
+    }
+  }
+  data.block_offsets[data.nr_blocks] = s->nr_unlocks;
+
+  /* Move the unlocks to the bucket of their block. */
+  threadpool_map(s->threadpool, scheduler_bucket_unlocks_mapper,
+                 data.histogram, nr_chunks, sizeof(int) * data.nr_blocks, 1,
+                 &data);
+
+  /* Sort the blocks and set the unlocks in the tasks. */
+  threadpool_map(s->threadpool, scheduler_link_unlocks_mapper,
+                 data.block_offsets, data.nr_blocks, sizeof(int), 1, &data);
+
+  /* Clean up. */
+  swift_free("offsets", data.histogram);
+  swift_free("offsets", data.block_offsets);
+  swift_free("offsets", data.offsets);
+  swift_free("unlock_ind", data.temp_ind);
+  swift_free("unlocks", data.temp_unlocks);
+}
+
+/**
+ * @brief Data used by the #threadpool_map functions of scheduler_ranktasks().
+ */
+struct scheduler_ranktasks_data {
+
+  /* The tasks. */
+  struct task *tasks;
+
+  /* The task indices, sorted by rank. */
+  int *tid;
+
+  /* Number of tasks in tid. */
+  volatile int left;
+
+  /* The rank we are currently setting. */
+  int rank;
+};
+
+/* Number of task indices collected by a thread before adding them to the
+ * list in one go. */
+#define scheduler_ranktasks_buffer_size 256
+
+/**
+ * @brief #threadpool_map function incrementing the waits of the tasks
+ * unlocked by some tasks.
+ */
+void scheduler_wait_tasks_mapper(void *map_data, int num_elements,
+                                 void *extra_data) {
+
+  struct task *tasks = (struct task *)map_data;
+
+  for (int i = 0; i < num_elements; i++) {
+    struct task *t = &tasks[i];
+    for (int k = 0; k < t->nr_unlock_tasks; k++)
+      atomic_inc(&t->unlock_tasks[k]->wait);
+  }
+}
+
+/**
+ * @brief #threadpool_map function collecting the tasks without waits.
+ */
+void scheduler_first_rank_mapper(void *map_data, int num_elements,
+                                 void *extra_data) {
+
+  struct scheduler_ranktasks_data *data =
+      (struct scheduler_ranktasks_data *)extra_data;
+  struct task *tasks = (struct task *)map_data;
+  const int k_begin = tasks - data->tasks;
+
+  int buff[scheduler_ranktasks_buffer_size];
+  int count = 0;
+
+  for (int k = 0; k < num_elements; k++) {
+    if (tasks[k].wait == 0) buff[count++] = k_begin + k;
+
+    if (count == scheduler_ranktasks_buffer_size || k == num_elements - 1) {
+      const int ind = atomic_add(&data->left, count);
+      memcpy(&data->tid[ind], buff, sizeof(int) * count);
+      count = 0;
+    }
+  }
+}
+
+/**
+ * @brief #threadpool_map function setting the rank of some tasks of the
+ * current layer and collecting the tasks of the next one.
+ */
+void scheduler_rank_layer_mapper(void *map_data, int num_elements,
+                                 void *extra_data) {
+
+  struct scheduler_ranktasks_data *data =
+      (struct scheduler_ranktasks_data *)extra_data;
+  struct task *tasks = data->tasks;
+  const int *tid = (const int *)map_data;
+
+  int buff[scheduler_ranktasks_buffer_size];
+  int count = 0;
+
+  for (int j = 0; j < num_elements; j++) {
+    struct task *t = &tasks[tid[j]];
+#ifdef SWIFT_DEBUG_CHECKS
+    t->rank = data->rank;
+#endif
+    for (int k = 0; k < t->nr_unlock_tasks; k++) {
+      struct task *u = t->unlock_tasks[k];
+      if (atomic_dec(&u->wait) == 1) {
+        buff[count++] = u - tasks;
+
+        if (count == scheduler_ranktasks_buffer_size) {
+          const int ind = atomic_add(&data->left, count);
+          memcpy(&data->tid[ind], buff, sizeof(int) * count);
+          count = 0;
+        }
+      }
+    }
+  }
+
+  if (count > 0) {
+    const int ind = atomic_add(&data->left, count);
+    memcpy(&data->tid[ind], buff, sizeof(int) * count);
+  }
+}
+
+/**
+ * @brief Sort the tasks in topological order over all queues, one task at a
+ * time.
+ *
+ * @param s The #scheduler.
+ */
+static void scheduler_ranktasks_serial(struct scheduler *s) {
   struct task *tasks = s->tasks;
   int *tid = s->tasks_ind;
   const int nr_tasks = s->nr_tasks;
@@ -1190,10 +1792,9 @@ void scheduler_ranktasks(struct scheduler *s) {
     const int left_old = left;
     for (; j < left_old; j++) {
       struct task *t = &tasks[tid[j]];
+#ifdef SWIFT_DEBUG_CHECKS
       t->rank = rank;
-      /* message( "task %i of type %s has rank %i." , i ,
-          (t->type == task_type_self) ? "self" : (t->type == task_type_pair) ?
-         "pair" : "sort" , rank ); */
+#endif
       for (int k = 0; k < t->nr_unlock_tasks; k++) {
         struct task *u = t->unlock_tasks[k];
         if (--u->wait == 0) {
@@ -1215,6 +1816,70 @@ void scheduler_ranktasks(struct scheduler *s) {
 #endif
 }
 
+/**
+ * @brief Sort the tasks in topological order over all queues.
+ *
+ * With several threads and enough tasks, the tasks are processed layer by
+ * layer, i.e. a parallel breadth-first traversal of the task graph. The order
+ * of the tasks of a given rank is then arbitrary.
+ *
+ * @param s The #scheduler.
+ */
+void scheduler_ranktasks(struct scheduler *s) {
+  struct task *tasks = s->tasks;
+  int *tid = s->tasks_ind;
+  const int nr_tasks = s->nr_tasks;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (s->nr_thread_blocks > 0)
+    error("Tasks were made since the blocks of tasks were last released.");
+#endif
+
+  if (s->threadpool->num_threads == 1 ||
+      nr_tasks < scheduler_parallel_min_tasks) {
+    scheduler_ranktasks_serial(s);
+    return;
+  }
+
+  struct scheduler_ranktasks_data data;
+  data.tasks = tasks;
+  data.tid = tid;
+  data.left = 0;
+  data.rank = 0;
+
+  /* Run through the tasks and get all the waits right. */
+  threadpool_map(s->threadpool, scheduler_wait_tasks_mapper, tasks, nr_tasks,
+                 sizeof(struct task), 0, NULL);
+
+  /* Load the tids of tasks with no waits. */
+  threadpool_map(s->threadpool, scheduler_first_rank_mapper, tasks, nr_tasks,
+                 sizeof(struct task), 0, &data);
+
+  /* Main loop. */
+  for (int j = 0; j < nr_tasks; data.rank++) {
+    /* Did we get anything? */
+    if (j == data.left) error("Unsatisfiable task dependencies detected.");
+
+    /* Unlock the next layer of tasks. */
+    const int left_old = data.left;
+    if (left_old - j > 1000)
+      threadpool_map(s->threadpool, scheduler_rank_layer_mapper, &tid[j],
+                     left_old - j, sizeof(int), 0, &data);
+    else
+      scheduler_rank_layer_mapper(&tid[j], left_old - j, &data);
+
+    /* Move back to the old left (like Sanders!). */
+    j = left_old;
+  }
+
+#ifdef SWIFT_DEBUG_CHECKS
+  /* Verify that the tasks were ranked correctly. */
+  for (int k = 1; k < s->nr_tasks; k++)
+    if (tasks[tid[k - 1]].rank > tasks[tid[k]].rank)
+      error("Task ranking failed.");
+#endif
+}
+
 /**
  * @brief (Re)allocate the task arrays.
  *
@@ -1223,14 +1888,27 @@ void scheduler_ranktasks(struct scheduler *s) {
  */
 void scheduler_reset(struct scheduler *s, int size) {
 
+  /* Size of the blocks of tasks reserved by the threads, small enough for
+   * their unused tasks to only take a small room at the end of the array. */
+  const int nr_threads =
+      (s->threadpool != NULL) ? max(s->threadpool->num_threads, 1) : 1;
+  s->block_size = min(size / (scheduler_block_ratio * nr_threads),
+                      scheduler_max_block_size);
+  if (s->block_size < 1) s->block_size = 1;
+  s->blocks_room = (s->block_size > 1)
+                       ? nr_threads * s->block_size * scheduler_block_releases
+                       : 0;
+  size += s->blocks_room;
+
   /* Do we need to re-allocate? */
   if (size > s->size) {
     /* Free existing task lists if necessary. */
     scheduler_free_tasks(s);
 
-    /* Allocate the new lists. */
+    /* Allocate the new lists, with the pool of spawned tasks at the end of
+     * the task array so that they can go through the queues. */
     if (swift_memalign("tasks", (void **)&s->tasks, task_align,
-                       size * sizeof(struct task)) != 0)
+                       (size + s->size_spawned) * sizeof(struct task)) != 0)
       error("Failed to allocate task array.");
 
     if ((s->tasks_ind = (int *)swift_malloc("tasks_ind", sizeof(int) * size)) ==
@@ -1246,18 +1924,381 @@ void scheduler_reset(struct scheduler *s, int size) {
   s->size = size;
   s->nr_tasks = 0;
   s->tasks_next = 0;
+  s->nr_thread_blocks = 0;
+  s->thread_blocks_generation++;
   s->waiting = 0;
   s->nr_unlocks = 0;
   s->completed_unlock_writes = 0;
   s->active_count = 0;
+  s->tree_fingerprint = 0;
+  s->spawned = (s->size_spawned > 0) ? s->tasks + size : NULL;
+  s->nr_spawned = 0;
 
   /* Set the task pointers in the queues. */
   for (int k = 0; k < s->nr_queues; k++) s->queues[k].tasks = s->tasks;
 }
 
+/**
+ * @brief Estimate the cost of a task from the number of particles it acts on.
+ *
+ * @param t The #task.
+ * @param nodeID The MPI rank we are on.
+ */
+static float scheduler_task_model_cost(const struct task *t,
+                                       const int nodeID) {
+  const float wscale = 0.001f;
+  float cost = 0.f;
+
+  const float count_i = (t->ci != NULL) ? t->ci->hydro.count : 0.f;
+  const float count_j = (t->cj != NULL) ? t->cj->hydro.count : 0.f;
+  const float gcount_i = (t->ci != NULL) ? t->ci->grav.count : 0.f;
+  const float gcount_j = (t->cj != NULL) ? t->cj->grav.count : 0.f;
+  const float scount_i = (t->ci != NULL) ? t->ci->stars.count : 0.f;
+  const float scount_j = (t->cj != NULL) ? t->cj->stars.count : 0.f;
+  const float bcount_i = (t->ci != NULL) ? t->ci->black_holes.count : 0.f;
+  const float bcount_j = (t->cj != NULL) ? t->cj->black_holes.count : 0.f;
+
+  switch (t->type) {
+    case task_type_sort:
+      cost = wscale * intrinsics_popcount(t->flags) * count_i *
+             (sizeof(int) * 8 - intrinsics_clz(t->ci->hydro.count));
+      break;
+
+    case task_type_stars_sort:
+      cost = wscale * intrinsics_popcount(t->flags) * scount_i *
+             (sizeof(int) * 8 - intrinsics_clz(t->ci->stars.count));
+      break;
+
+    case task_type_self:
+      if (t->subtype == task_subtype_grav) {
+        cost = 1.f * (wscale * gcount_i) * gcount_i;
+      } else if (t->subtype == task_subtype_external_grav)
+        cost = 1.f * wscale * gcount_i;
+      else if (t->subtype == task_subtype_stars_density)
+        cost = 1.f * wscale * scount_i * count_i;
+      else if (t->subtype == task_subtype_stars_feedback)
+        cost = 1.f * wscale * scount_i * count_i;
+      else if (t->subtype == task_subtype_bh_density)
+        cost = 1.f * wscale * bcount_i * count_i;
+      else if (t->subtype == task_subtype_bh_feedback)
+        cost = 1.f * wscale * bcount_i * count_i;
+      else  // hydro loops
+        cost = 1.f * (wscale * count_i) * count_i;
+      break;
+
+    case task_type_pair:
+      if (t->subtype == task_subtype_grav) {
+        if (t->ci->nodeID != nodeID || t->cj->nodeID != nodeID)
+          cost = 3.f * (wscale * gcount_i) * gcount_j;
+        else
+          cost = 2.f * (wscale * gcount_i) * gcount_j;
+
+      } else if (t->subtype == task_subtype_stars_density ||
+                 t->subtype == task_subtype_stars_feedback) {
+        if (t->ci->nodeID != nodeID)
+          cost = 3.f * wscale * count_i * scount_j * sid_scale[t->flags];
+        else if (t->cj->nodeID != nodeID)
+          cost = 3.f * wscale * scount_i * count_j * sid_scale[t->flags];
+        else
+          cost = 2.f * wscale * (scount_i * count_j + scount_j * count_i) *
+                 sid_scale[t->flags];
+
+      } else if (t->subtype == task_subtype_bh_density ||
+                 t->subtype == task_subtype_bh_feedback) {
+        if (t->ci->nodeID != nodeID)
+          cost = 3.f * wscale * count_i * bcount_j * sid_scale[t->flags];
+        else if (t->cj->nodeID != nodeID)
+          cost = 3.f * wscale * bcount_i * count_j * sid_scale[t->flags];
+        else
+          cost = 2.f * wscale * (bcount_i * count_j + bcount_j * count_i) *
+                 sid_scale[t->flags];
+
+      } else {  // hydro loops
+        if (t->ci->nodeID != nodeID || t->cj->nodeID != nodeID)
+          cost = 3.f * (wscale * count_i) * count_j * sid_scale[t->flags];
+        else
+          cost = 2.f * (wscale * count_i) * count_j * sid_scale[t->flags];
+      }
+      break;
+
+    case task_type_sub_pair:
+#ifdef SWIFT_DEBUG_CHECKS
+      if (t->flags < 0) error("Negative flag value!");
+#endif
+      if (t->subtype == task_subtype_stars_density ||
+          t->subtype == task_subtype_stars_feedback) {
+        if (t->ci->nodeID != nodeID) {
+          cost = 3.f * (wscale * count_i) * scount_j * sid_scale[t->flags];
+        } else if (t->cj->nodeID != nodeID) {
+          cost = 3.f * (wscale * scount_i) * count_j * sid_scale[t->flags];
+        } else {
+          cost = 2.f * wscale * (scount_i * count_j + scount_j * count_i) *
+                 sid_scale[t->flags];
+        }
+
+      } else if (t->subtype == task_subtype_bh_density ||
+                 t->subtype == task_subtype_bh_feedback) {
+        if (t->ci->nodeID != nodeID) {
+          cost = 3.f * (wscale * count_i) * bcount_j * sid_scale[t->flags];
+        } else if (t->cj->nodeID != nodeID) {
+          cost = 3.f * (wscale * bcount_i) * count_j * sid_scale[t->flags];
+        } else {
+          cost = 2.f * wscale * (bcount_i * count_j + bcount_j * count_i) *
+                 sid_scale[t->flags];
+        }
+
+      } else {  // hydro loops
+        if (t->ci->nodeID != nodeID || t->cj->nodeID != nodeID) {
+          cost = 3.f * (wscale * count_i) * count_j * sid_scale[t->flags];
+        } else {
+          cost = 2.f * (wscale * count_i) * count_j * sid_scale[t->flags];
+        }
+      }
+      break;
+
+    case task_type_sub_self:
+      if (t->subtype == task_subtype_stars_density) {
+        cost = 1.f * (wscale * scount_i) * count_i;
+      } else if (t->subtype == task_subtype_stars_feedback) {
+        cost = 1.f * (wscale * scount_i) * count_i;
+      } else if (t->subtype == task_subtype_bh_density) {
+        cost = 1.f * (wscale * bcount_i) * count_i;
+      } else if (t->subtype == task_subtype_bh_feedback) {
+        cost = 1.f * (wscale * bcount_i) * count_i;
+      } else {
+        cost = 1.f * (wscale * count_i) * count_i;
+      }
+      break;
+    case task_type_ghost:
+      if (t->ci == t->ci->hydro.super) cost = wscale * count_i;
+      break;
+    case task_type_extra_ghost:
+      if (t->ci == t->ci->hydro.super) cost = wscale * count_i;
+      break;
+    case task_type_stars_ghost:
+      if (t->ci == t->ci->hydro.super) cost = wscale * scount_i;
+      break;
+    case task_type_bh_ghost:
+      if (t->ci == t->ci->hydro.super) cost = wscale * bcount_i;
+      break;
+    case task_type_drift_part:
+      cost = wscale * count_i;
+      break;
+    case task_type_drift_gpart:
+      cost = wscale * gcount_i;
+      break;
+    case task_type_drift_spart:
+      cost = wscale * scount_i;
+      break;
+    case task_type_drift_bpart:
+      cost = wscale * bcount_i;
+      break;
+    case task_type_init_grav:
+      cost = wscale * gcount_i;
+      break;
+    case task_type_grav_down:
+      cost = wscale * gcount_i;
+      break;
+    case task_type_grav_long_range:
+      cost = wscale * gcount_i;
+      break;
+    case task_type_grav_mm:
+      cost = wscale * (gcount_i + gcount_j);
+      break;
+    case task_type_end_hydro_force:
+      cost = wscale * count_i;
+      break;
+    case task_type_end_grav_force:
+      cost = wscale * gcount_i;
+      break;
+    case task_type_cooling:
+      cost = wscale * count_i;
+      break;
+    case task_type_star_formation:
+      cost = wscale * (count_i + scount_i);
+      break;
+    case task_type_kick1:
+      cost = wscale * (count_i + gcount_i + scount_i + bcount_i);
+      break;
+    case task_type_kick2:
+      cost = wscale * (count_i + gcount_i + scount_i + bcount_i);
+      break;
+    case task_type_timestep:
+      cost = wscale * (count_i + gcount_i + scount_i + bcount_i);
+
+      /* Also doing the two half kicks? */
+      if (t->ci->kick2 == t) cost *= 3.f;
+      break;
+    case task_type_send:
+      if (count_i < 1e5)
+        cost = 10.f * (wscale * count_i) * count_i;
+      else
+        cost = 2e9;
+      break;
+    case task_type_recv:
+      if (count_i < 1e5)
+        cost = 5.f * (wscale * count_i) * count_i;
+      else
+        cost = 1e9;
+      break;
+    default:
+      cost = 0;
+      break;
+  }
+
+  return cost;
+}
+
+/**
+ * @brief Index of a task in the table of measured costs.
+ *
+ * Tasks are binned by type, subtype and by the logarithm of their model cost,
+ * so that a mis-estimated scaling with the number of particles also gets
+ * corrected.
+ *
+ * @param t The #task.
+ * @param cost The model cost of the task.
+ */
+__attribute__((always_inline)) INLINE static int scheduler_cost_index(
+    const struct task *t, const float cost) {
+  int exponent;
+  frexpf(cost, &exponent);
+  int bin = (exponent + 12) / 3;
+  if (bin < 0) bin = 0;
+  if (bin >= scheduler_cost_nr_bins) bin = scheduler_cost_nr_bins - 1;
+  return (t->type * task_subtype_count + t->subtype) * scheduler_cost_nr_bins +
+         bin;
+}
+
+/**
+ * @brief Feed the run times of the tasks of the previous step back into the
+ * cost model and compute the correction to apply to the model cost of each
+ * bin.
+ *
+ * The model costs of all the tasks must have been stored in their weights.
+ * Older measurements are decayed at every calibration, and bins with too few
+ * samples fall back onto the correction of their type and subtype. The
+ * corrections are relative to the mean ratio of measured to model costs, such
+ * that the weights stay in the units of the model.
+ *
+ * @param s The #scheduler.
+ * @param verbose Are we talkative?
+ */
+static void scheduler_calibrate_costs(struct scheduler *s, int verbose) {
+  const int nr_tasks = s->nr_tasks;
+  const struct task *tasks = s->tasks;
+  double *cost_ticks = s->cost_ticks;
+  double *cost_model = s->cost_model;
+  double *cost_samples = s->cost_samples;
+  float *cost_scale = s->cost_scale;
+
+  /* Collect the timings of the tasks that ran. */
+  int nr_measured = 0;
+  for (int k = 0; k < nr_tasks; k++) {
+    const struct task *t = &tasks[k];
+    if (t->implicit || t->tic == 0 || t->toc <= t->tic || t->weight <= 0.f)
+      continue;
+
+    /* Decay the older measurements. */
+    if (nr_measured == 0) {
+      for (int i = 0; i < scheduler_cost_table_size; i++) {
+        cost_ticks[i] *= scheduler_cost_decay;
+        cost_model[i] *= scheduler_cost_decay;
+        cost_samples[i] *= scheduler_cost_decay;
+      }
+    }
+    nr_measured++;
+
+    const int ind = scheduler_cost_index(t, t->weight);
+    cost_ticks[ind] += (double)(t->toc - t->tic);
+    cost_model[ind] += t->weight;
+    cost_samples[ind] += 1.;
+  }
+
+  /* Nothing new, keep the current corrections. */
+  if (nr_measured == 0) return;
+
+  /* Mean ratio of measured to model cost. */
+  double sum_ticks = 0., sum_model = 0.;
+  for (int i = 0; i < scheduler_cost_table_size; i++) {
+    sum_ticks += cost_ticks[i];
+    sum_model += cost_model[i];
+  }
+  if (sum_ticks <= 0. || sum_model <= 0.) return;
+  const double mean_ratio = sum_ticks / sum_model;
+
+  /* Corrections per bin, or per type and subtype if poorly sampled. */
+  for (int i = 0; i < scheduler_cost_table_size; i += scheduler_cost_nr_bins) {
+    double type_ticks = 0., type_model = 0., type_samples = 0.;
+    for (int b = 0; b < scheduler_cost_nr_bins; b++) {
+      type_ticks += cost_ticks[i + b];
+      type_model += cost_model[i + b];
+      type_samples += cost_samples[i + b];
+    }
+    const float type_scale =
+        (type_samples >= scheduler_cost_min_samples && type_model > 0.)
+            ? type_ticks / type_model / mean_ratio
+            : 1.f;
+
+    for (int b = 0; b < scheduler_cost_nr_bins; b++) {
+      const int ind = i + b;
+      if (cost_samples[ind] >= scheduler_cost_min_samples &&
+          cost_model[ind] > 0.)
+        cost_scale[ind] = cost_ticks[ind] / cost_model[ind] / mean_ratio;
+      else
+        cost_scale[ind] = type_scale;
+    }
+  }
+
+  if (verbose)
+    message("Calibrated the task costs using %d measured tasks.", nr_measured);
+}
+
+/**
+ * @brief Raise the weights of the send tasks and of all the tasks they
+ * depend on above those of any other task.
+ *
+ * All these tasks get the same boost, larger than the heaviest weight, so
+ * that they keep their relative order (to float precision) but are picked
+ * from the queues before any task that does not lead to a send.
+ *
+ * @param s The #scheduler, with the weights already set.
+ */
+static void scheduler_boost_sends(struct scheduler *s) {
+  const int nr_tasks = s->nr_tasks;
+  const int *tid = s->tasks_ind;
+  struct task *tasks = s->tasks;
+
+  float max_weight = 0.f;
+  for (int k = 0; k < nr_tasks; k++)
+    if (tasks[k].weight > max_weight) max_weight = tasks[k].weight;
+
+  char *to_send = (char *)calloc(nr_tasks, sizeof(char));
+  if (to_send == NULL) error("Failed to allocate the send flags.");
+
+  /* Run through the tasks backwards, i.e. after everything they unlock. */
+  for (int k = nr_tasks - 1; k >= 0; k--) {
+    struct task *t = &tasks[tid[k]];
+    int flag = (t->type == task_type_send);
+    for (int j = 0; j < t->nr_unlock_tasks && !flag; j++)
+      flag = to_send[t->unlock_tasks[j] - tasks];
+    if (flag) {
+      to_send[tid[k]] = 1;
+      t->weight += max_weight;
+    }
+  }
+
+  free(to_send);
+}
+
 /**
  * @brief Compute the task weights
  *
+ * The weight of a task is its cost plus the largest weight of the tasks it
+ * unlocks, i.e. the length of the critical path starting at that task. With
+ * #scheduler_flag_adaptive_weights, the model costs are corrected using the
+ * run times measured in the previous step.
+ *
  * @param s The #scheduler.
  * @param verbose Are we talkative?
  */
@@ -1266,215 +2307,41 @@ void scheduler_reweight(struct scheduler *s, int verbose) {
   int *tid = s->tasks_ind;
   struct task *tasks = s->tasks;
   const int nodeID = s->nodeID;
-  const float wscale = 0.001f;
+  const int adaptive = (s->flags & scheduler_flag_adaptive_weights);
   const ticks tic = getticks();
 
+  /* Get the model costs and the corrections from the last run times. */
+  if (adaptive) {
+    for (int k = 0; k < nr_tasks; k++)
+      tasks[k].weight = scheduler_task_model_cost(&tasks[k], nodeID);
+    scheduler_calibrate_costs(s, verbose);
+  }
+
   /* Run through the tasks backwards and set their weights. */
   for (int k = nr_tasks - 1; k >= 0; k--) {
     struct task *t = &tasks[tid[k]];
-    float cost = 0.f;
+    float cost;
+    if (adaptive) {
+      cost = t->weight;
+      if (cost > 0.f) cost *= s->cost_scale[scheduler_cost_index(t, cost)];
+    } else {
+      cost = scheduler_task_model_cost(t, nodeID);
+    }
     t->weight = 0.f;
 
     for (int j = 0; j < t->nr_unlock_tasks; j++)
       if (t->unlock_tasks[j]->weight > t->weight)
         t->weight = t->unlock_tasks[j]->weight;
 
-    const float count_i = (t->ci != NULL) ? t->ci->hydro.count : 0.f;
-    const float count_j = (t->cj != NULL) ? t->cj->hydro.count : 0.f;
-    const float gcount_i = (t->ci != NULL) ? t->ci->grav.count : 0.f;
-    const float gcount_j = (t->cj != NULL) ? t->cj->grav.count : 0.f;
-    const float scount_i = (t->ci != NULL) ? t->ci->stars.count : 0.f;
-    const float scount_j = (t->cj != NULL) ? t->cj->stars.count : 0.f;
-    const float bcount_i = (t->ci != NULL) ? t->ci->black_holes.count : 0.f;
-    const float bcount_j = (t->cj != NULL) ? t->cj->black_holes.count : 0.f;
-
-    switch (t->type) {
-      case task_type_sort:
-        cost = wscale * intrinsics_popcount(t->flags) * count_i *
-               (sizeof(int) * 8 - intrinsics_clz(t->ci->hydro.count));
-        break;
-
-      case task_type_stars_sort:
-        cost = wscale * intrinsics_popcount(t->flags) * scount_i *
-               (sizeof(int) * 8 - intrinsics_clz(t->ci->stars.count));
-        break;
-
-      case task_type_self:
-        if (t->subtype == task_subtype_grav) {
-          cost = 1.f * (wscale * gcount_i) * gcount_i;
-        } else if (t->subtype == task_subtype_external_grav)
-          cost = 1.f * wscale * gcount_i;
-        else if (t->subtype == task_subtype_stars_density)
-          cost = 1.f * wscale * scount_i * count_i;
-        else if (t->subtype == task_subtype_stars_feedback)
-          cost = 1.f * wscale * scount_i * count_i;
-        else if (t->subtype == task_subtype_bh_density)
-          cost = 1.f * wscale * bcount_i * count_i;
-        else if (t->subtype == task_subtype_bh_feedback)
-          cost = 1.f * wscale * bcount_i * count_i;
-        else  // hydro loops
-          cost = 1.f * (wscale * count_i) * count_i;
-        break;
-
-      case task_type_pair:
-        if (t->subtype == task_subtype_grav) {
-          if (t->ci->nodeID != nodeID || t->cj->nodeID != nodeID)
-            cost = 3.f * (wscale * gcount_i) * gcount_j;
-          else
-            cost = 2.f * (wscale * gcount_i) * gcount_j;
-
-        } else if (t->subtype == task_subtype_stars_density ||
-                   t->subtype == task_subtype_stars_feedback) {
-          if (t->ci->nodeID != nodeID)
-            cost = 3.f * wscale * count_i * scount_j * sid_scale[t->flags];
-          else if (t->cj->nodeID != nodeID)
-            cost = 3.f * wscale * scount_i * count_j * sid_scale[t->flags];
-          else
-            cost = 2.f * wscale * (scount_i * count_j + scount_j * count_i) *
-                   sid_scale[t->flags];
-
-        } else if (t->subtype == task_subtype_bh_density ||
-                   t->subtype == task_subtype_bh_feedback) {
-          if (t->ci->nodeID != nodeID)
-            cost = 3.f * wscale * count_i * bcount_j * sid_scale[t->flags];
-          else if (t->cj->nodeID != nodeID)
-            cost = 3.f * wscale * bcount_i * count_j * sid_scale[t->flags];
-          else
-            cost = 2.f * wscale * (bcount_i * count_j + bcount_j * count_i) *
-                   sid_scale[t->flags];
-
-        } else {  // hydro loops
-          if (t->ci->nodeID != nodeID || t->cj->nodeID != nodeID)
-            cost = 3.f * (wscale * count_i) * count_j * sid_scale[t->flags];
-          else
-            cost = 2.f * (wscale * count_i) * count_j * sid_scale[t->flags];
-        }
-        break;
-
-      case task_type_sub_pair:
-#ifdef SWIFT_DEBUG_CHECKS
-        if (t->flags < 0) error("Negative flag value!");
-#endif
-        if (t->subtype == task_subtype_stars_density ||
-            t->subtype == task_subtype_stars_feedback) {
-          if (t->ci->nodeID != nodeID) {
-            cost = 3.f * (wscale * count_i) * scount_j * sid_scale[t->flags];
-          } else if (t->cj->nodeID != nodeID) {
-            cost = 3.f * (wscale * scount_i) * count_j * sid_scale[t->flags];
-          } else {
-            cost = 2.f * wscale * (scount_i * count_j + scount_j * count_i) *
-                   sid_scale[t->flags];
-          }
-
-        } else if (t->subtype == task_subtype_bh_density ||
-                   t->subtype == task_subtype_bh_feedback) {
-          if (t->ci->nodeID != nodeID) {
-            cost = 3.f * (wscale * count_i) * bcount_j * sid_scale[t->flags];
-          } else if (t->cj->nodeID != nodeID) {
-            cost = 3.f * (wscale * bcount_i) * count_j * sid_scale[t->flags];
-          } else {
-            cost = 2.f * wscale * (bcount_i * count_j + bcount_j * count_i) *
-                   sid_scale[t->flags];
-          }
-
-        } else {  // hydro loops
-          if (t->ci->nodeID != nodeID || t->cj->nodeID != nodeID) {
-            cost = 3.f * (wscale * count_i) * count_j * sid_scale[t->flags];
-          } else {
-            cost = 2.f * (wscale * count_i) * count_j * sid_scale[t->flags];
-          }
-        }
-        break;
-
-      case task_type_sub_self:
-        if (t->subtype == task_subtype_stars_density) {
-          cost = 1.f * (wscale * scount_i) * count_i;
-        } else if (t->subtype == task_subtype_stars_feedback) {
-          cost = 1.f * (wscale * scount_i) * count_i;
-        } else if (t->subtype == task_subtype_bh_density) {
-          cost = 1.f * (wscale * bcount_i) * count_i;
-        } else if (t->subtype == task_subtype_bh_feedback) {
-          cost = 1.f * (wscale * bcount_i) * count_i;
-        } else {
-          cost = 1.f * (wscale * count_i) * count_i;
-        }
-        break;
-      case task_type_ghost:
-        if (t->ci == t->ci->hydro.super) cost = wscale * count_i;
-        break;
-      case task_type_extra_ghost:
-        if (t->ci == t->ci->hydro.super) cost = wscale * count_i;
-        break;
-      case task_type_stars_ghost:
-        if (t->ci == t->ci->hydro.super) cost = wscale * scount_i;
-        break;
-      case task_type_bh_ghost:
-        if (t->ci == t->ci->hydro.super) cost = wscale * bcount_i;
-        break;
-      case task_type_drift_part:
-        cost = wscale * count_i;
-        break;
-      case task_type_drift_gpart:
-        cost = wscale * gcount_i;
-        break;
-      case task_type_drift_spart:
-        cost = wscale * scount_i;
-        break;
-      case task_type_drift_bpart:
-        cost = wscale * bcount_i;
-        break;
-      case task_type_init_grav:
-        cost = wscale * gcount_i;
-        break;
-      case task_type_grav_down:
-        cost = wscale * gcount_i;
-        break;
-      case task_type_grav_long_range:
-        cost = wscale * gcount_i;
-        break;
-      case task_type_grav_mm:
-        cost = wscale * (gcount_i + gcount_j);
-        break;
-      case task_type_end_hydro_force:
-        cost = wscale * count_i;
-        break;
-      case task_type_end_grav_force:
-        cost = wscale * gcount_i;
-        break;
-      case task_type_cooling:
-        cost = wscale * count_i;
-        break;
-      case task_type_star_formation:
-        cost = wscale * (count_i + scount_i);
-        break;
-      case task_type_kick1:
-        cost = wscale * (count_i + gcount_i + scount_i + bcount_i);
-        break;
-      case task_type_kick2:
-        cost = wscale * (count_i + gcount_i + scount_i + bcount_i);
-        break;
-      case task_type_timestep:
-        cost = wscale * (count_i + gcount_i + scount_i + bcount_i);
-        break;
-      case task_type_send:
-        if (count_i < 1e5)
-          cost = 10.f * (wscale * count_i) * count_i;
-        else
-          cost = 2e9;
-        break;
-      case task_type_recv:
-        if (count_i < 1e5)
-          cost = 5.f * (wscale * count_i) * count_i;
-        else
-          cost = 1e9;
-        break;
-      default:
-        cost = 0;
-        break;
-    }
     t->weight += cost;
   }
 
+  /* Put the sends and all the tasks leading to them in a class of their
+   * own, ahead of the local work, so that the boundary data goes out as
+   * early as possible. */
+  if (s->flags & scheduler_flag_send_priority)
+    scheduler_boost_sends(s);
+
   if (verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
@@ -1533,7 +2400,6 @@ void scheduler_enqueue_mapper(void *map_data, int num_elements,
       scheduler_enqueue(s, t);
     }
   }
-  pthread_cond_broadcast(&s->sleep_cond);
 }
 
 /**
@@ -1559,6 +2425,9 @@ void scheduler_start(struct scheduler *s) {
     scheduler_rewait_mapper(s->tid_active, s->active_count, s);
   }
 
+  /* The queues are empty, clear the rounding errors of their weights. */
+  for (int k = 0; k < s->nr_queues; k++) s->queues[k].weight = 0.;
+
   /* Loop over the tasks and enqueue whoever is ready. */
   if (s->active_count > 1000) {
     threadpool_map(s->threadpool, scheduler_enqueue_mapper, s->tid_active,
@@ -1567,15 +2436,289 @@ void scheduler_start(struct scheduler *s) {
     scheduler_enqueue_mapper(s->tid_active, s->active_count, s);
   }
 
-  /* Clear the list of active tasks. */
+  /* Clear the list of active tasks and empty the pool of spawned tasks. */
   s->active_count = 0;
+  s->nr_spawned = 0;
+
+  /* To be safe, wake up everybody. */
+  scheduler_wake_all(s);
+}
+
+#ifdef WITH_MPI
+
+/**
+ * @brief Release the buffer of a completed send task, if it has one.
+ *
+ * @param s The #scheduler.
+ * @param t The send #task.
+ */
+void scheduler_free_send_buffer(const struct scheduler *s, struct task *t) {
+
+  if (t->flags < 0 || t->subtype == task_subtype_tend_part ||
+      t->subtype == task_subtype_tend_gpart ||
+      t->subtype == task_subtype_tend_spart ||
+      t->subtype == task_subtype_tend_bpart ||
+      t->subtype == task_subtype_sf_counts) {
+    free(task_get_comm(t)->buff);
+  } else if ((t->subtype == task_subtype_xv ||
+              t->subtype == task_subtype_rho ||
+              t->subtype == task_subtype_gradient) &&
+             (s->flags & scheduler_flag_compact_hydro)) {
+    free(task_get_comm(t)->buff);
+  }
+}
+
+/**
+ * @brief Unmap the particle arrays of the nodes sharing our memory and drop
+ * the communicators of the in-place exchanges, if any.
+ *
+ * @param s The #scheduler.
+ */
+void scheduler_free_shm(struct scheduler *s) {
+
+  if (s->shm_rank == NULL) return;
+
+  const int nr_nodes = s->space->e->nr_nodes;
+  for (int k = 0; k < nr_nodes; k++)
+    memuse_node_shared_unmap(s->shm_parts[k], s->shm_size[k]);
+  free(s->shm_parts);
+  free(s->shm_size);
+  free(s->shm_name);
+  free(s->shm_rank);
+  s->shm_parts = NULL;
+  s->shm_size = NULL;
+  s->shm_name = NULL;
+  s->shm_rank = NULL;
+
+  /* The communicators go with MPI if we are cleaning up after it. */
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+  if (!finalized) {
+    MPI_Comm_free(&s->shm_comm);
+    MPI_Comm_free(&s->shm_release_comm);
+  }
+}
+
+/**
+ * @brief Are the densities of the cell of a hydro send or recv task exchanged
+ * in this step too?
+ *
+ * They are not when the cell is inactive, in which case its particles do not
+ * change until the end of the step.
+ *
+ * @param t The send or recv #task.
+ */
+static int scheduler_exchanges_rho(const struct task *t) {
+
+  const struct link *l =
+      (t->type == task_type_send) ? t->ci->mpi.send : t->ci->mpi.recv;
+  for (; l != NULL; l = l->next) {
+    const struct task *r = l->t;
+    if (r->ci == t->ci && r->subtype == task_subtype_rho &&
+        (t->type == task_type_recv || r->cj->nodeID == t->cj->nodeID))
+      return !r->skip;
+  }
+  return 0;
+}
+
+/**
+ * @brief Let the node we read some particles in place from know that we are
+ * done with them.
+ *
+ * The particles of each hydro stage are read by the tasks that unlock the
+ * recv task of the next stage, so we release the previous stage of the cell
+ * of a recv task when the latter gets enqueued. This is also the case for
+ * the implicit members of a group of end-of-step messages.
+ *
+ * @param s The #scheduler.
+ * @param t The recv #task.
+ */
+static void scheduler_release_in_place(struct scheduler *s,
+                                       const struct task *t) {
+
+  enum task_subtypes previous;
+  if (t->subtype == task_subtype_tend_part) {
+#ifdef EXTRA_HYDRO_LOOP
+    previous = task_subtype_gradient;
+  } else if (t->subtype == task_subtype_gradient) {
+#endif
+    previous = task_subtype_rho;
+  } else if (t->subtype == task_subtype_rho) {
+    previous = task_subtype_xv;
+  } else {
+    return;
+  }
+
+  for (struct link *l = t->ci->mpi.recv; l != NULL; l = l->next) {
+    const struct task *r = l->t;
+    if (r->ci != t->ci || r->subtype != previous) continue;
+    struct task_comm *comm = task_get_comm(r);
+    if (comm->release) {
+      comm->release = 0;
+      const int err = MPI_Send(NULL, 0, MPI_BYTE, t->ci->nodeID, r->flags,
+                               s->shm_release_comm);
+      if (err != MPI_SUCCESS)
+        mpi_error(err, "Failed to release particles read in place.");
+    }
+  }
+}
+
+/**
+ * @brief Release the window of the one-sided hydro exchanges, if any.
+ *
+ * This is collective over all the nodes while MPI is running.
+ *
+ * @param s The #scheduler.
+ */
+void scheduler_free_rma(struct scheduler *s) {
+
+  /* The window goes with MPI if we are cleaning up after it. */
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+  if (s->rma_win != MPI_WIN_NULL && !finalized) {
+    MPI_Win_unlock_all(s->rma_win);
+    MPI_Win_free(&s->rma_win);
+  }
+  s->rma_win = MPI_WIN_NULL;
+  if (s->rma_buff != NULL) swift_free("rma_buff", s->rma_buff);
+  free(s->rma_disp);
+  s->rma_buff = NULL;
+  s->rma_disp = NULL;
+}
+
+/**
+ * @brief Hand a send or recv task whose request has been posted to the MPI
+ * progress thread.
+ *
+ * @param s The #scheduler.
+ * @param t The #task.
+ */
+static void scheduler_progress_add(struct scheduler *s, struct task *t) {
+
+  pthread_mutex_lock(&s->progress_mutex);
+
+  /* Do we need to grow the list? */
+  if (s->progress_count == s->progress_size) {
+    s->progress_size = (s->progress_size == 0) ? 256 : 2 * s->progress_size;
+    struct task **temp = (struct task **)realloc(
+        s->progress_tasks, sizeof(struct task *) * s->progress_size);
+    if (temp == NULL) error("Failed to grow the list of MPI tasks.");
+    s->progress_tasks = temp;
+  }
+  s->progress_tasks[s->progress_count++] = t;
+
+  pthread_cond_signal(&s->progress_cond);
+  pthread_mutex_unlock(&s->progress_mutex);
+}
+
+/**
+ * @brief Deal with a send or recv task whose request has completed.
+ *
+ * The sends have nothing left to do and are marked as done right away,
+ * which enqueues their dependencies. The recvs still have to unpack their
+ * data and are put in their queue for a runner to pick up.
+ *
+ * @param s The #scheduler.
+ * @param t The #task.
+ */
+static void scheduler_progress_complete(struct scheduler *s, struct task *t) {
+
+  /* Let the runners' MPI_Test on the request succeed right away. */
+  task_get_comm(t)->req = MPI_REQUEST_NULL;
+
+  if (t->type == task_type_send) {
+    t->tic = getticks();
+#ifdef SWIFT_DEBUG_CHECKS
+    t->ti_run = s->space->e->ti_current;
+#endif
+    scheduler_free_send_buffer(s, t);
+    scheduler_done(s, t);
+  } else {
+    queue_insert(&s->queues[1 % s->nr_queues], t);
+    scheduler_wake(s, 1 % s->nr_queues);
+  }
+}
+
+/**
+ * @brief Main loop of the MPI progress thread.
+ *
+ * Collects the requests posted by the send and recv tasks, tests all of
+ * them at once with MPI_Testsome and completes the tasks whose messages
+ * have arrived, such that the runners never have to poll for them.
+ *
+ * @param data The #scheduler.
+ */
+static void *scheduler_progress_main(void *data) {
+
+  struct scheduler *s = (struct scheduler *)data;
+
+  /* The requests owned by this thread and their tasks. */
+  struct task **tasks = NULL;
+  MPI_Request *reqs = NULL;
+  int *done = NULL;
+  int count = 0, size = 0;
+
+  while (1) {
+
+    /* Collect the new requests, waiting for some if we have none. */
+    pthread_mutex_lock(&s->progress_mutex);
+    while (count == 0 && s->progress_count == 0 && !s->progress_stop)
+      pthread_cond_wait(&s->progress_cond, &s->progress_mutex);
+    if (count == 0 && s->progress_count == 0) {
+      pthread_mutex_unlock(&s->progress_mutex);
+      break;
+    }
+    if (count + s->progress_count > size) {
+      size = 2 * (count + s->progress_count);
+      if ((tasks = (struct task **)realloc(tasks, sizeof(struct task *) *
+                                                      size)) == NULL ||
+          (reqs = (MPI_Request *)realloc(reqs, sizeof(MPI_Request) * size)) ==
+              NULL ||
+          (done = (int *)realloc(done, sizeof(int) * size)) == NULL)
+        error("Failed to grow the MPI progress buffers.");
+    }
+    for (int k = 0; k < s->progress_count; k++) {
+      tasks[count] = s->progress_tasks[k];
+      reqs[count] = task_get_comm(s->progress_tasks[k])->req;
+      count++;
+    }
+    s->progress_count = 0;
+    pthread_mutex_unlock(&s->progress_mutex);
+
+    /* Test all the requests at once. */
+    int nr_done = 0;
+    const int err =
+        MPI_Testsome(count, reqs, &nr_done, done, MPI_STATUSES_IGNORE);
+    if (err != MPI_SUCCESS)
+      mpi_error(err, "Failed to test the requests of the MPI tasks.");
+    if (nr_done == MPI_UNDEFINED) nr_done = 0;
+
+    /* Complete the tasks and drop their requests, which MPI_Testsome does
+     * not reset for the persistent ones. */
+    for (int k = 0; k < nr_done; k++) {
+      scheduler_progress_complete(s, tasks[done[k]]);
+      reqs[done[k]] = MPI_REQUEST_NULL;
+    }
+    if (nr_done > 0) {
+      int j = 0;
+      for (int k = 0; k < count; k++)
+        if (reqs[k] != MPI_REQUEST_NULL) {
+          tasks[j] = tasks[k];
+          reqs[j] = reqs[k];
+          j++;
+        }
+      count = j;
+    }
+  }
 
-  /* To be safe, fire of one last sleep_cond in a safe way. */
-  pthread_mutex_lock(&s->sleep_mutex);
-  pthread_cond_broadcast(&s->sleep_cond);
-  pthread_mutex_unlock(&s->sleep_mutex);
+  free(tasks);
+  free(reqs);
+  free(done);
+  return NULL;
 }
 
+#endif /* WITH_MPI */
+
 /**
  * @brief Put a task on one of the queues.
  *
@@ -1589,11 +2732,18 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
   /* Ignore skipped tasks */
   if (t->skip) return;
 
+#ifdef WITH_MPI
+  /* Are we done with some particles read in place? */
+  if (t->type == task_type_recv && (s->flags & scheduler_flag_mpi_shm))
+    scheduler_release_in_place(s, t);
+#endif
+
   /* If this is an implicit task, just pretend it's done. */
   if (t->implicit) {
 #ifdef SWIFT_DEBUG_CHECKS
     t->ti_run = s->space->e->ti_current;
 #endif
+    t->tic = t->toc = getticks();
     t->skip = 1;
     for (int j = 0; j < t->nr_unlock_tasks; j++) {
       struct task *t2 = t->unlock_tasks[j];
@@ -1605,6 +2755,10 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
   else {
 #ifdef WITH_MPI
     int err = MPI_SUCCESS;
+    struct task_comm *comm =
+        (t->type == task_type_send || t->type == task_type_recv)
+            ? task_get_comm(t)
+            : NULL;
 #endif
 
     /* Find the previous owner for each task type, and do
@@ -1638,71 +2792,128 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
       case task_type_sub_pair:
         qid = t->ci->super->owner;
         if (qid < 0 ||
-            s->queues[qid].count > s->queues[t->cj->super->owner].count)
+            queue_count(&s->queues[qid]) >
+                queue_count(&s->queues[t->cj->super->owner]))
           qid = t->cj->super->owner;
         break;
       case task_type_recv:
 #ifdef WITH_MPI
-        if (t->subtype == task_subtype_tend_part) {
-          t->buff = (struct pcell_step_hydro *)malloc(
+        if (t->flags < 0) {
+          /* The end-of-step messages of a whole group of cells. */
+          const struct engine *e = s->space->e;
+          const struct proxy_tend *g =
+              proxy_tend_get_group(e->proxies, e->proxy_ind, t);
+          comm->buff = malloc(g->size);
+          err = MPI_Irecv(comm->buff, g->size, MPI_BYTE, t->ci->nodeID,
+                          t->ci->mpi.tag, subtaskMPI_comms[t->subtype],
+                          &comm->req);
+        } else if (t->subtype == task_subtype_tend_part) {
+          comm->buff = (struct pcell_step_hydro *)malloc(
               sizeof(struct pcell_step_hydro) * t->ci->mpi.pcell_size);
           err = MPI_Irecv(
-              t->buff, t->ci->mpi.pcell_size * sizeof(struct pcell_step_hydro),
+              comm->buff,
+              t->ci->mpi.pcell_size * sizeof(struct pcell_step_hydro),
               MPI_BYTE, t->ci->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-              &t->req);
+              &comm->req);
         } else if (t->subtype == task_subtype_tend_gpart) {
-          t->buff = (struct pcell_step_grav *)malloc(
+          comm->buff = (struct pcell_step_grav *)malloc(
               sizeof(struct pcell_step_grav) * t->ci->mpi.pcell_size);
           err = MPI_Irecv(
-              t->buff, t->ci->mpi.pcell_size * sizeof(struct pcell_step_grav),
+              comm->buff,
+              t->ci->mpi.pcell_size * sizeof(struct pcell_step_grav),
               MPI_BYTE, t->ci->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-              &t->req);
+              &comm->req);
         } else if (t->subtype == task_subtype_tend_spart) {
-          t->buff = (struct pcell_step_stars *)malloc(
+          comm->buff = (struct pcell_step_stars *)malloc(
               sizeof(struct pcell_step_stars) * t->ci->mpi.pcell_size);
           err = MPI_Irecv(
-              t->buff, t->ci->mpi.pcell_size * sizeof(struct pcell_step_stars),
+              comm->buff,
+              t->ci->mpi.pcell_size * sizeof(struct pcell_step_stars),
               MPI_BYTE, t->ci->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-              &t->req);
+              &comm->req);
         } else if (t->subtype == task_subtype_tend_bpart) {
-          t->buff = (struct pcell_step_black_holes *)malloc(
+          comm->buff = (struct pcell_step_black_holes *)malloc(
               sizeof(struct pcell_step_black_holes) * t->ci->mpi.pcell_size);
           err = MPI_Irecv(
-              t->buff,
+              comm->buff,
               t->ci->mpi.pcell_size * sizeof(struct pcell_step_black_holes),
               MPI_BYTE, t->ci->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-              &t->req);
+              &comm->req);
+        } else if ((t->subtype == task_subtype_xv ||
+                    t->subtype == task_subtype_rho ||
+                    t->subtype == task_subtype_gradient) &&
+                   scheduler_reads_in_place(s, t->ci->nodeID)) {
+          /* The particles are read in place from the memory of the sending
+           * node, we only wait for the notification that they are ready. It
+           * then waits for us to release them, unless they do not change
+           * until the end of the step. */
+          comm->release = (t->subtype != task_subtype_xv) ||
+                          scheduler_exchanges_rho(t);
+          err = MPI_Irecv(NULL, 0, MPI_BYTE, t->ci->nodeID, t->flags,
+                          subtaskMPI_comms[t->subtype], &comm->req);
+        } else if ((t->subtype == task_subtype_xv ||
+                    t->subtype == task_subtype_rho ||
+                    t->subtype == task_subtype_gradient) &&
+                   (s->flags & scheduler_flag_mpi_rma)) {
+          /* The particles get put in our window, we only wait for the
+           * notification that they arrived. */
+          comm->buff = s->rma_buff + s->rma_disp[t - s->tasks];
+          err = MPI_Irecv(NULL, 0, MPI_BYTE, t->ci->nodeID, t->flags,
+                          subtaskMPI_comms[t->subtype], &comm->req);
+        } else if ((t->subtype == task_subtype_xv ||
+                    t->subtype == task_subtype_rho ||
+                    t->subtype == task_subtype_gradient) &&
+                   (s->flags & scheduler_flag_compact_hydro)) {
+          const size_t size =
+              t->ci->hydro.count * cell_pack_hydro_size(t->subtype);
+          comm->buff = malloc(size);
+          if (comm->buff == NULL)
+            error("Failed to allocate compact recv buffer.");
+          err = MPI_Irecv(comm->buff, size, MPI_BYTE, t->ci->nodeID, t->flags,
+                          subtaskMPI_comms[t->subtype], &comm->req);
+        } else if ((t->subtype == task_subtype_xv ||
+                    t->subtype == task_subtype_rho ||
+                    t->subtype == task_subtype_gradient) &&
+                   (s->flags & scheduler_flag_mpi_persistent)) {
+          err = scheduler_start_persistent(t, t->ci->hydro.parts,
+                                           t->ci->hydro.count, part_mpi_type,
+                                           /*sync=*/0);
         } else if (t->subtype == task_subtype_xv ||
                    t->subtype == task_subtype_rho ||
                    t->subtype == task_subtype_gradient) {
           err = MPI_Irecv(t->ci->hydro.parts, t->ci->hydro.count, part_mpi_type,
                           t->ci->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-                          &t->req);
+                          &comm->req);
+        } else if (t->subtype == task_subtype_gpart &&
+                   (s->flags & scheduler_flag_mpi_persistent)) {
+          err = scheduler_start_persistent(t, t->ci->grav.parts,
+                                           t->ci->grav.count, gpart_mpi_type,
+                                           /*sync=*/0);
         } else if (t->subtype == task_subtype_gpart) {
           err = MPI_Irecv(t->ci->grav.parts, t->ci->grav.count, gpart_mpi_type,
                           t->ci->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-                          &t->req);
+                          &comm->req);
         } else if (t->subtype == task_subtype_spart) {
           err = MPI_Irecv(t->ci->stars.parts, t->ci->stars.count,
                           spart_mpi_type, t->ci->nodeID, t->flags,
-                          subtaskMPI_comms[t->subtype], &t->req);
+                          subtaskMPI_comms[t->subtype], &comm->req);
         } else if (t->subtype == task_subtype_bpart) {
           err = MPI_Irecv(t->ci->black_holes.parts, t->ci->black_holes.count,
                           bpart_mpi_type, t->ci->nodeID, t->flags,
-                          subtaskMPI_comms[t->subtype], &t->req);
+                          subtaskMPI_comms[t->subtype], &comm->req);
         } else if (t->subtype == task_subtype_multipole) {
-          t->buff = (struct gravity_tensors *)malloc(
+          comm->buff = (struct gravity_tensors *)malloc(
               sizeof(struct gravity_tensors) * t->ci->mpi.pcell_size);
-          err = MPI_Irecv(t->buff, t->ci->mpi.pcell_size, multipole_mpi_type,
+          err = MPI_Irecv(comm->buff, t->ci->mpi.pcell_size, multipole_mpi_type,
                           t->ci->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-                          &t->req);
+                          &comm->req);
         } else if (t->subtype == task_subtype_sf_counts) {
-          t->buff = (struct pcell_sf *)malloc(sizeof(struct pcell_sf) *
+          comm->buff = (struct pcell_sf *)malloc(sizeof(struct pcell_sf) *
                                               t->ci->mpi.pcell_size);
-          err = MPI_Irecv(t->buff,
+          err = MPI_Irecv(comm->buff,
                           t->ci->mpi.pcell_size * sizeof(struct pcell_sf),
                           MPI_BYTE, t->ci->nodeID, t->flags,
-                          subtaskMPI_comms[t->subtype], &t->req);
+                          subtaskMPI_comms[t->subtype], &comm->req);
         } else {
           error("Unknown communication sub-type");
         }
@@ -1716,136 +2927,220 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
         break;
       case task_type_send:
 #ifdef WITH_MPI
-        if (t->subtype == task_subtype_tend_part) {
-          t->buff = (struct pcell_step_hydro *)malloc(
+        if (t->flags < 0) {
+          /* The end-of-step messages of a whole group of cells. */
+          const struct engine *e = s->space->e;
+          const struct proxy_tend *g =
+              proxy_tend_get_group(e->proxies, e->proxy_ind, t);
+          comm->buff = malloc(g->size);
+          proxy_tend_pack(g, (char *)comm->buff);
+
+          if (g->size > s->mpi_message_limit) {
+            err = MPI_Isend(comm->buff, g->size, MPI_BYTE, t->cj->nodeID,
+                            t->ci->mpi.tag, subtaskMPI_comms[t->subtype],
+                            &comm->req);
+          } else {
+            err = MPI_Issend(comm->buff, g->size, MPI_BYTE, t->cj->nodeID,
+                             t->ci->mpi.tag, subtaskMPI_comms[t->subtype],
+                             &comm->req);
+          }
+        } else if (t->subtype == task_subtype_tend_part) {
+          comm->buff = (struct pcell_step_hydro *)malloc(
               sizeof(struct pcell_step_hydro) * t->ci->mpi.pcell_size);
-          cell_pack_end_step_hydro(t->ci, (struct pcell_step_hydro *)t->buff);
+          cell_pack_end_step_hydro(
+              t->ci, (struct pcell_step_hydro *)comm->buff);
 
           if ((t->ci->mpi.pcell_size * sizeof(struct pcell_step_hydro)) >
               s->mpi_message_limit) {
             err = MPI_Isend(
-                t->buff,
+                comm->buff,
                 t->ci->mpi.pcell_size * sizeof(struct pcell_step_hydro),
                 MPI_BYTE, t->cj->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-                &t->req);
+                &comm->req);
           } else {
             err = MPI_Issend(
-                t->buff,
+                comm->buff,
                 t->ci->mpi.pcell_size * sizeof(struct pcell_step_hydro),
                 MPI_BYTE, t->cj->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-                &t->req);
+                &comm->req);
           }
         } else if (t->subtype == task_subtype_tend_gpart) {
-          t->buff = (struct pcell_step_grav *)malloc(
+          comm->buff = (struct pcell_step_grav *)malloc(
               sizeof(struct pcell_step_grav) * t->ci->mpi.pcell_size);
-          cell_pack_end_step_grav(t->ci, (struct pcell_step_grav *)t->buff);
+          cell_pack_end_step_grav(t->ci, (struct pcell_step_grav *)comm->buff);
 
           if ((t->ci->mpi.pcell_size * sizeof(struct pcell_step_grav)) >
               s->mpi_message_limit) {
             err = MPI_Isend(
-                t->buff, t->ci->mpi.pcell_size * sizeof(struct pcell_step_grav),
+                comm->buff,
+                t->ci->mpi.pcell_size * sizeof(struct pcell_step_grav),
                 MPI_BYTE, t->cj->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-                &t->req);
+                &comm->req);
           } else {
             err = MPI_Issend(
-                t->buff, t->ci->mpi.pcell_size * sizeof(struct pcell_step_grav),
+                comm->buff,
+                t->ci->mpi.pcell_size * sizeof(struct pcell_step_grav),
                 MPI_BYTE, t->cj->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-                &t->req);
+                &comm->req);
           }
         } else if (t->subtype == task_subtype_tend_spart) {
-          t->buff = (struct pcell_step_stars *)malloc(
+          comm->buff = (struct pcell_step_stars *)malloc(
               sizeof(struct pcell_step_stars) * t->ci->mpi.pcell_size);
-          cell_pack_end_step_stars(t->ci, (struct pcell_step_stars *)t->buff);
+          cell_pack_end_step_stars(
+              t->ci, (struct pcell_step_stars *)comm->buff);
 
           if ((t->ci->mpi.pcell_size * sizeof(struct pcell_step_stars)) >
               s->mpi_message_limit) {
             err = MPI_Isend(
-                t->buff,
+                comm->buff,
                 t->ci->mpi.pcell_size * sizeof(struct pcell_step_stars),
                 MPI_BYTE, t->cj->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-                &t->req);
+                &comm->req);
           } else {
             err = MPI_Issend(
-                t->buff,
+                comm->buff,
                 t->ci->mpi.pcell_size * sizeof(struct pcell_step_stars),
                 MPI_BYTE, t->cj->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-                &t->req);
+                &comm->req);
           }
         } else if (t->subtype == task_subtype_tend_bpart) {
-          t->buff = (struct pcell_step_black_holes *)malloc(
+          comm->buff = (struct pcell_step_black_holes *)malloc(
               sizeof(struct pcell_step_black_holes) * t->ci->mpi.pcell_size);
           cell_pack_end_step_black_holes(
-              t->ci, (struct pcell_step_black_holes *)t->buff);
+              t->ci, (struct pcell_step_black_holes *)comm->buff);
 
           if ((t->ci->mpi.pcell_size * sizeof(struct pcell_step_black_holes)) >
               s->mpi_message_limit) {
             err = MPI_Isend(
-                t->buff,
+                comm->buff,
                 t->ci->mpi.pcell_size * sizeof(struct pcell_step_black_holes),
                 MPI_BYTE, t->cj->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-                &t->req);
+                &comm->req);
           } else {
             err = MPI_Issend(
-                t->buff,
+                comm->buff,
                 t->ci->mpi.pcell_size * sizeof(struct pcell_step_black_holes),
                 MPI_BYTE, t->cj->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-                &t->req);
+                &comm->req);
           }
+        } else if ((t->subtype == task_subtype_xv ||
+                    t->subtype == task_subtype_rho ||
+                    t->subtype == task_subtype_gradient) &&
+                   scheduler_reads_in_place(s, t->cj->nodeID)) {
+          /* The receiving node reads the particles in place from our
+           * memory: tell it that they are ready and wait for it to release
+           * them before they get updated, if they do. */
+          const int dest = t->cj->nodeID;
+          if (t->subtype == task_subtype_xv && !scheduler_exchanges_rho(t)) {
+            err = MPI_Isend(NULL, 0, MPI_BYTE, dest, t->flags,
+                            subtaskMPI_comms[t->subtype], &comm->req);
+          } else {
+            MPI_Request ready;
+            err = MPI_Isend(NULL, 0, MPI_BYTE, dest, t->flags,
+                            subtaskMPI_comms[t->subtype], &ready);
+            if (err == MPI_SUCCESS) err = MPI_Request_free(&ready);
+            if (err == MPI_SUCCESS)
+              err = MPI_Irecv(NULL, 0, MPI_BYTE, dest, t->flags,
+                              s->shm_release_comm, &comm->req);
+          }
+        } else if ((t->subtype == task_subtype_xv ||
+                    t->subtype == task_subtype_rho ||
+                    t->subtype == task_subtype_gradient) &&
+                   (s->flags & scheduler_flag_compact_hydro)) {
+          const size_t size =
+              t->ci->hydro.count * cell_pack_hydro_size(t->subtype);
+          comm->buff = malloc(size);
+          if (comm->buff == NULL)
+            error("Failed to allocate compact send buffer.");
+          cell_pack_hydro(t->ci, comm->buff, t->subtype);
+
+          if (s->flags & scheduler_flag_mpi_rma) {
+            /* Put the particles in the window of the receiving node and
+             * notify it once they have arrived there. */
+            const int dest = t->cj->nodeID;
+            err = MPI_Put(comm->buff, size, MPI_BYTE, dest,
+                          s->rma_disp[t - s->tasks], size, MPI_BYTE,
+                          s->rma_win);
+            if (err == MPI_SUCCESS) err = MPI_Win_flush(dest, s->rma_win);
+            if (err == MPI_SUCCESS)
+              err = MPI_Isend(NULL, 0, MPI_BYTE, dest, t->flags,
+                              subtaskMPI_comms[t->subtype], &comm->req);
+          } else if (size > s->mpi_message_limit)
+            err = MPI_Isend(comm->buff, size, MPI_BYTE, t->cj->nodeID, t->flags,
+                            subtaskMPI_comms[t->subtype], &comm->req);
+          else
+            err = MPI_Issend(comm->buff, size, MPI_BYTE, t->cj->nodeID,
+                             t->flags, subtaskMPI_comms[t->subtype],
+                             &comm->req);
+        } else if ((t->subtype == task_subtype_xv ||
+                    t->subtype == task_subtype_rho ||
+                    t->subtype == task_subtype_gradient) &&
+                   (s->flags & scheduler_flag_mpi_persistent)) {
+          err = scheduler_start_persistent(
+              t, t->ci->hydro.parts, t->ci->hydro.count, part_mpi_type,
+              (t->ci->hydro.count * sizeof(struct part)) <=
+                  s->mpi_message_limit);
+        } else if (t->subtype == task_subtype_gpart &&
+                   (s->flags & scheduler_flag_mpi_persistent)) {
+          err = scheduler_start_persistent(
+              t, t->ci->grav.parts, t->ci->grav.count, gpart_mpi_type,
+              (t->ci->grav.count * sizeof(struct gpart)) <=
+                  s->mpi_message_limit);
         } else if (t->subtype == task_subtype_xv ||
                    t->subtype == task_subtype_rho ||
                    t->subtype == task_subtype_gradient) {
           if ((t->ci->hydro.count * sizeof(struct part)) > s->mpi_message_limit)
             err = MPI_Isend(t->ci->hydro.parts, t->ci->hydro.count,
                             part_mpi_type, t->cj->nodeID, t->flags,
-                            subtaskMPI_comms[t->subtype], &t->req);
+                            subtaskMPI_comms[t->subtype], &comm->req);
           else
             err = MPI_Issend(t->ci->hydro.parts, t->ci->hydro.count,
                              part_mpi_type, t->cj->nodeID, t->flags,
-                             subtaskMPI_comms[t->subtype], &t->req);
+                             subtaskMPI_comms[t->subtype], &comm->req);
         } else if (t->subtype == task_subtype_gpart) {
           if ((t->ci->grav.count * sizeof(struct gpart)) > s->mpi_message_limit)
             err = MPI_Isend(t->ci->grav.parts, t->ci->grav.count,
                             gpart_mpi_type, t->cj->nodeID, t->flags,
-                            subtaskMPI_comms[t->subtype], &t->req);
+                            subtaskMPI_comms[t->subtype], &comm->req);
           else
             err = MPI_Issend(t->ci->grav.parts, t->ci->grav.count,
                              gpart_mpi_type, t->cj->nodeID, t->flags,
-                             subtaskMPI_comms[t->subtype], &t->req);
+                             subtaskMPI_comms[t->subtype], &comm->req);
         } else if (t->subtype == task_subtype_spart) {
           if ((t->ci->stars.count * sizeof(struct spart)) >
               s->mpi_message_limit)
             err = MPI_Isend(t->ci->stars.parts, t->ci->stars.count,
                             spart_mpi_type, t->cj->nodeID, t->flags,
-                            subtaskMPI_comms[t->subtype], &t->req);
+                            subtaskMPI_comms[t->subtype], &comm->req);
           else
             err = MPI_Issend(t->ci->stars.parts, t->ci->stars.count,
                              spart_mpi_type, t->cj->nodeID, t->flags,
-                             subtaskMPI_comms[t->subtype], &t->req);
+                             subtaskMPI_comms[t->subtype], &comm->req);
         } else if (t->subtype == task_subtype_bpart) {
           if ((t->ci->black_holes.count * sizeof(struct bpart)) >
               s->mpi_message_limit)
             err = MPI_Isend(t->ci->black_holes.parts, t->ci->black_holes.count,
                             bpart_mpi_type, t->cj->nodeID, t->flags,
-                            subtaskMPI_comms[t->subtype], &t->req);
+                            subtaskMPI_comms[t->subtype], &comm->req);
           else
             err = MPI_Issend(t->ci->black_holes.parts, t->ci->black_holes.count,
                              bpart_mpi_type, t->cj->nodeID, t->flags,
-                             subtaskMPI_comms[t->subtype], &t->req);
+                             subtaskMPI_comms[t->subtype], &comm->req);
         } else if (t->subtype == task_subtype_multipole) {
-          t->buff = (struct gravity_tensors *)malloc(
+          comm->buff = (struct gravity_tensors *)malloc(
               sizeof(struct gravity_tensors) * t->ci->mpi.pcell_size);
-          cell_pack_multipoles(t->ci, (struct gravity_tensors *)t->buff);
-          err = MPI_Isend(t->buff, t->ci->mpi.pcell_size, multipole_mpi_type,
+          cell_pack_multipoles(t->ci, (struct gravity_tensors *)comm->buff);
+          err = MPI_Isend(comm->buff, t->ci->mpi.pcell_size, multipole_mpi_type,
                           t->cj->nodeID, t->flags, subtaskMPI_comms[t->subtype],
-                          &t->req);
+                          &comm->req);
         } else if (t->subtype == task_subtype_sf_counts) {
-          t->buff = (struct pcell_sf *)malloc(sizeof(struct pcell_sf) *
+          comm->buff = (struct pcell_sf *)malloc(sizeof(struct pcell_sf) *
                                               t->ci->mpi.pcell_size);
-          cell_pack_sf_counts(t->ci, (struct pcell_sf *)t->buff);
-          err = MPI_Isend(t->buff,
+          cell_pack_sf_counts(t->ci, (struct pcell_sf *)comm->buff);
+          err = MPI_Isend(comm->buff,
                           t->ci->mpi.pcell_size * sizeof(struct pcell_sf),
                           MPI_BYTE, t->cj->nodeID, t->flags,
-                          subtaskMPI_comms[t->subtype], &t->req);
+                          subtaskMPI_comms[t->subtype], &comm->req);
         } else {
           error("Unknown communication sub-type");
         }
@@ -1870,8 +3165,159 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
     /* Increase the waiting counter. */
     atomic_inc(&s->waiting);
 
+#ifdef WITH_MPI
+    /* Let the progress thread watch over the communications. */
+    if ((s->flags & scheduler_flag_mpi_progress) &&
+        (t->type == task_type_send || t->type == task_type_recv)) {
+      scheduler_progress_add(s, t);
+      return;
+    }
+#endif
+
     /* Insert the task into that queue. */
     queue_insert(&s->queues[qid], t);
+    scheduler_wake(s, qid);
+  }
+}
+
+/**
+ * @brief Wake up one runner sleeping on a #queue that just received a task.
+ *
+ * If none of the runners of that queue is asleep they are busy and will get
+ * to the task soon, so we wake up a runner of another queue instead, which
+ * may steal it.
+ *
+ * @param s The #scheduler.
+ * @param qid The ID of the #queue.
+ */
+void scheduler_wake(struct scheduler *s, int qid) {
+
+  /* Make sure the sleepers see the new task or we see them. */
+  __sync_synchronize();
+  if (s->nr_sleeping == 0) return;
+
+  /* Look for a queue with sleeping runners, ours first. */
+  const int nr_queues = s->nr_queues;
+  for (int k = 0; k < nr_queues; k++) {
+    struct scheduler_sleeper *sleeper = &s->sleepers[(qid + k) % nr_queues];
+    if (sleeper->nr_sleeping > 0) {
+      pthread_mutex_lock(&sleeper->mutex);
+      pthread_cond_signal(&sleeper->cond);
+      pthread_mutex_unlock(&sleeper->mutex);
+      return;
+    }
+
+    /* Only steal when allowed to. */
+    if (!(s->flags & scheduler_flag_steal)) return;
+  }
+}
+
+/**
+ * @brief Wake up all the sleeping runners, e.g. when there are no tasks left
+ * to wait for.
+ *
+ * @param s The #scheduler.
+ */
+void scheduler_wake_all(struct scheduler *s) {
+
+  __sync_synchronize();
+  for (int k = 0; k < s->nr_queues; k++) {
+    struct scheduler_sleeper *sleeper = &s->sleepers[k];
+    pthread_mutex_lock(&sleeper->mutex);
+    pthread_cond_broadcast(&sleeper->cond);
+    pthread_mutex_unlock(&sleeper->mutex);
+  }
+}
+
+/**
+ * @brief Is this a task cheap enough to be run by the runner that released
+ * it rather than going through the queues?
+ *
+ * Only the tasks acting on the particles of a single super-cell, which are
+ * the bulk of the tasks on the deep time-bins, are considered.
+ *
+ * @param s The #scheduler.
+ * @param t The #task, ready to run.
+ */
+static int scheduler_task_is_tiny(const struct scheduler *s,
+                                  const struct task *t) {
+  if (t->implicit) return 0;
+  switch (t->type) {
+    case task_type_kick1:
+    case task_type_kick2:
+    case task_type_timestep:
+    case task_type_drift_part:
+    case task_type_ghost:
+      return scheduler_task_model_cost(t, s->nodeID) < s->tiny_task_cost;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Count a task as done, waking up everybody once none are left.
+ *
+ * Otherwise, the tasks left in the queues may have been waiting for the
+ * locks the task released, so we wake up a runner for each queue that is
+ * not empty.
+ *
+ * @param s The #scheduler.
+ */
+static void scheduler_task_done(struct scheduler *s) {
+
+  if (atomic_dec(&s->waiting) == 1) {
+    scheduler_wake_all(s);
+    return;
+  }
+
+  __sync_synchronize();
+  if (s->nr_sleeping == 0) return;
+  for (int k = 0; k < s->nr_queues; k++)
+    if (queue_count(&s->queues[k]) > 0 || s->queues[k].count_incoming > 0)
+      scheduler_wake(s, k);
+}
+
+/**
+ * @brief Is a task one of the tasks spawned by the runners in this step?
+ *
+ * @param s The #scheduler.
+ * @param t The #task.
+ */
+__attribute__((always_inline)) INLINE static int scheduler_is_spawned(
+    const struct scheduler *s, const struct task *t) {
+  return s->spawned != NULL && t >= s->spawned &&
+         t < s->spawned + s->size_spawned;
+}
+
+/**
+ * @brief Count a finished spawned task towards the task that spawned it.
+ *
+ * The latter is done once all the tasks it spawned are, at which point its
+ * dependencies are resolved and, if it was spawned too, it is counted
+ * towards its own parent.
+ *
+ * @param s The #scheduler.
+ * @param t The finished spawned #task.
+ */
+static void scheduler_spawned_done(struct scheduler *s, struct task *t) {
+
+  while (scheduler_is_spawned(s, t)) {
+    struct task *parent = s->spawned_parents[t - s->spawned];
+    if (atomic_dec(&parent->wait) != 1) return;
+
+    parent->toc = getticks();
+    for (int k = 0; k < parent->nr_unlock_tasks; k++) {
+      struct task *t2 = parent->unlock_tasks[k];
+      if (t2->skip) continue;
+      const int res = atomic_dec(&t2->wait);
+      if (res < 1) {
+        error("Negative wait!");
+      } else if (res == 1) {
+        scheduler_enqueue(s, t2);
+      }
+    }
+    parent->skip = 1;
+    t = parent;
   }
 }
 
@@ -1888,6 +3334,11 @@ struct task *scheduler_done(struct scheduler *s, struct task *t) {
   /* Release whatever locks this task held. */
   if (!t->implicit) task_unlock(t);
 
+  /* The sends may be completed by the MPI progress thread, which does not
+   * run tasks, so their dependencies always go to the queues. */
+  const int chain = (s->tiny_task_cost > 0.f && t->type != task_type_send);
+  struct task *next = NULL;
+
   /* Loop through the dependencies and add them to a queue if
      they are ready. */
   for (int k = 0; k < t->nr_unlock_tasks; k++) {
@@ -1898,26 +3349,36 @@ struct task *scheduler_done(struct scheduler *s, struct task *t) {
     if (res < 1) {
       error("Negative wait!");
     } else if (res == 1) {
-      scheduler_enqueue(s, t2);
+      /* Keep the first tiny task we can lock for ourselves. */
+      if (chain && next == NULL && scheduler_task_is_tiny(s, t2) &&
+          task_lock(t2)) {
+        atomic_inc(&s->waiting);
+        next = t2;
+      } else {
+        scheduler_enqueue(s, t2);
+      }
     }
   }
 
+  /* A spawned task counts towards the task that spawned it. */
+  if (scheduler_is_spawned(s, t)) scheduler_spawned_done(s, t);
+
+  /* Mark the task as skip. This has to happen before the task is counted
+   * as done, as it can be activated again as soon as all tasks are done when
+   * we are not a runner, e.g. the MPI progress thread. */
+  t->skip = 1;
+
   /* Task definitely done, signal any sleeping runners. */
   if (!t->implicit) {
     t->toc = getticks();
-    pthread_mutex_lock(&s->sleep_mutex);
-    atomic_dec(&s->waiting);
-    pthread_cond_broadcast(&s->sleep_cond);
-    pthread_mutex_unlock(&s->sleep_mutex);
+    scheduler_task_done(s);
   }
 
-  /* Mark the task as skip. */
-  t->skip = 1;
-
-  /* Return the next best task. Note that we currently do not
-     implement anything that does this, as getting it to respect
-     priorities is too tricky and currently unnecessary. */
-  return NULL;
+  /* Return the tiny task we kept, if any, to be run right away. Only those
+   * are handed back, as they would sit at the bottom of the weight-ordered
+   * queues and cost more to queue and fetch than to run. */
+  if (next != NULL) next->tic = getticks();
+  return next;
 }
 
 /**
@@ -1945,10 +3406,7 @@ struct task *scheduler_unlock(struct scheduler *s, struct task *t) {
   /* Task definitely done. */
   if (!t->implicit) {
     t->toc = getticks();
-    pthread_mutex_lock(&s->sleep_mutex);
-    atomic_dec(&s->waiting);
-    pthread_cond_broadcast(&s->sleep_cond);
-    pthread_mutex_unlock(&s->sleep_mutex);
+    scheduler_task_done(s);
   }
 
   /* Return the next best task. Note that we currently do not
@@ -1957,6 +3415,177 @@ struct task *scheduler_unlock(struct scheduler *s, struct task *t) {
   return NULL;
 }
 
+/**
+ * @brief Let the runners split the oversized hydro sub-tasks at run time.
+ *
+ * @param s The #scheduler.
+ * @param spawn_size Number of interactions above which a sub-task is split.
+ * @param max_tasks Maximal number of tasks spawned per step.
+ */
+void scheduler_init_spawn(struct scheduler *s, int spawn_size, int max_tasks) {
+
+  if (spawn_size <= 0 || max_tasks <= 0) return;
+
+  s->spawn_size = spawn_size;
+  s->size_spawned = max_tasks;
+  if ((s->spawned_parents = (struct task **)swift_malloc(
+           "spawned_parents", sizeof(struct task *) * max_tasks)) == NULL)
+    error("Failed to allocate the parents of the spawned tasks.");
+
+  /* Make room for the pool at the end of the task array. */
+  const int size = s->size - s->blocks_room;
+  s->size = 0;
+  scheduler_reset(s, size);
+}
+
+/**
+ * @brief Does a pair of cells have any hydro interactions to compute?
+ *
+ * @param ci The first #cell, may be NULL.
+ * @param cj The second #cell, may be NULL.
+ * @param e The #engine.
+ */
+__attribute__((always_inline)) INLINE static int scheduler_pair_has_work(
+    const struct cell *ci, const struct cell *cj, const struct engine *e) {
+  return ci != NULL && cj != NULL && ci->hydro.count > 0 &&
+         cj->hydro.count > 0 &&
+         (cell_is_active_hydro(ci, e) || cell_is_active_hydro(cj, e));
+}
+
+/**
+ * @brief Split an oversized hydro sub-task over the progeny of its cells.
+ *
+ * The sub-tasks are split once and for all when the tasks are made, so when
+ * the particles cluster between rebuilds some of them can get large enough
+ * to hold up the end of the step. Such a task is replaced by the tasks its
+ * recursion goes through one level down, taken from a pool emptied every
+ * step and queued for any runner to pick up. The task releases the locks on
+ * its cells and is done once all of them are, at which point its
+ * dependencies are resolved.
+ *
+ * @param s The #scheduler.
+ * @param t The #task, locked by the runner about to run it.
+ *
+ * @return 1 if the task was split, in which case it must not be run, 0
+ * otherwise.
+ */
+int scheduler_spawn(struct scheduler *s, struct task *t) {
+
+  if (s->spawn_size <= 0) return 0;
+  if (t->type != task_type_sub_self && t->type != task_type_sub_pair) return 0;
+  if (t->subtype != task_subtype_density &&
+      t->subtype != task_subtype_gradient && t->subtype != task_subtype_force &&
+      t->subtype != task_subtype_limiter)
+    return 0;
+
+  const struct engine *e = s->space->e;
+  struct cell *ci = t->ci, *cj = t->cj;
+
+  /* Collect the cells of the tasks the recursion would go through, leaving
+   * out those that would return straight away. */
+  struct cell *cells_i[36], *cells_j[36];
+  int count = 0;
+  if (t->type == task_type_sub_self) {
+    if ((long long)ci->hydro.count * ci->hydro.count <= s->spawn_size ||
+        !cell_is_active_hydro(ci, e) ||
+        !cell_can_recurse_in_self_hydro_task(ci))
+      return 0;
+
+    for (int k = 0; k < 8; k++) {
+      struct cell *cp = ci->progeny[k];
+      if (cp == NULL) continue;
+      if (cp->hydro.count > 0 && cell_is_active_hydro(cp, e)) {
+        cells_i[count] = cp;
+        cells_j[count++] = NULL;
+      }
+      for (int j = k + 1; j < 8; j++)
+        if (scheduler_pair_has_work(cp, ci->progeny[j], e)) {
+          cells_i[count] = cp;
+          cells_j[count++] = ci->progeny[j];
+        }
+    }
+  } else {
+    if ((long long)ci->hydro.count * cj->hydro.count <= s->spawn_size ||
+        !scheduler_pair_has_work(ci, cj, e))
+      return 0;
+
+    double shift[3];
+    const int sid = space_getsid(s->space, &ci, &cj, shift);
+    if (!cell_can_recurse_in_pair_hydro_task(ci) ||
+        !cell_can_recurse_in_pair_hydro_task(cj))
+      return 0;
+
+    const struct cell_split_pair *csp = &cell_split_pairs[sid];
+    for (int k = 0; k < csp->count; k++) {
+      struct cell *cpi = ci->progeny[csp->pairs[k].pid];
+      struct cell *cpj = cj->progeny[csp->pairs[k].pjd];
+      if (scheduler_pair_has_work(cpi, cpj, e)) {
+        cells_i[count] = cpi;
+        cells_j[count++] = cpj;
+      }
+    }
+  }
+  if (count == 0) return 0;
+
+  /* Get the tasks from the pool, if there are enough left. */
+  const int first = atomic_add(&s->nr_spawned, count);
+  if (first + count > s->size_spawned) return 0;
+
+  /* The task is done once all the tasks it spawned are. */
+  t->wait = count;
+#ifdef SWIFT_DEBUG_CHECKS
+  t->ti_run = e->ti_current;
+#endif
+  for (int k = 0; k < count; k++) {
+    struct task *tp = &s->spawned[first + k];
+    tp->type = (cells_j[k] == NULL) ? task_type_sub_self : task_type_sub_pair;
+    tp->subtype = t->subtype;
+    tp->ci = cells_i[k];
+    tp->cj = cells_j[k];
+    tp->flags = 0;
+    tp->weight = t->weight;
+    tp->unlock_tasks = NULL;
+    tp->nr_unlock_tasks = 0;
+    tp->wait = 0;
+    tp->skip = 0;
+    tp->implicit = 0;
+    tp->tic = 0;
+    tp->toc = 0;
+#ifdef SWIFT_DEBUG_TASKS
+    tp->rid = -1;
+#endif
+    s->spawned_parents[first + k] = t;
+  }
+
+  /* Let the spawned tasks lock the cells they need. They take over from the
+   * task in the count of tasks left to run. */
+  task_unlock(t);
+  for (int k = 0; k < count; k++) scheduler_enqueue(s, &s->spawned[first + k]);
+  scheduler_task_done(s);
+
+  return 1;
+}
+
+/**
+ * @brief How far apart are the cores of two queues?
+ *
+ * @param s The #scheduler.
+ * @param qa The first queue.
+ * @param qb The second queue.
+ *
+ * @return 0 if they share a last-level cache, 1 if they are on the same NUMA
+ * domain and 2 otherwise, or if we do not know.
+ */
+__attribute__((always_inline)) INLINE static int scheduler_queue_distance(
+    const struct scheduler *s, const int qa, const int qb) {
+  if (s->queue_group != NULL && s->queue_group[qa] == s->queue_group[qb] &&
+      (s->queue_domain == NULL || s->queue_domain[qa] == s->queue_domain[qb]))
+    return 0;
+  if (s->queue_domain != NULL && s->queue_domain[qa] == s->queue_domain[qb])
+    return 1;
+  return 2;
+}
+
 /**
  * @brief Get a task, preferably from the given queue.
  *
@@ -1981,7 +3610,8 @@ struct task *scheduler_gettask(struct scheduler *s, int qid,
     for (int tries = 0; res == NULL && s->waiting && tries < scheduler_maxtries;
          tries++) {
       /* Try to get a task from the suggested queue. */
-      if (s->queues[qid].count > 0 || s->queues[qid].count_incoming > 0) {
+      if (queue_count(&s->queues[qid]) > 0 ||
+          s->queues[qid].count_incoming > 0) {
         TIMER_TIC
         res = queue_gettask(&s->queues[qid], prev, 0);
         TIMER_TOC(timer_qget);
@@ -1990,38 +3620,65 @@ struct task *scheduler_gettask(struct scheduler *s, int qid,
 
       /* If unsuccessful, try stealing from the other queues. */
       if (s->flags & scheduler_flag_steal) {
-        int count = 0, qids[nr_queues];
-        for (int k = 0; k < nr_queues; k++)
-          if (s->queues[k].count > 0 || s->queues[k].count_incoming > 0) {
-            qids[count++] = k;
+
+        /* With cache- or NUMA-aware queues, look on the queues sharing our
+         * last-level cache first, then on our own domain and only then
+         * cross over to the other ones. */
+        const int first_pass =
+            (s->queue_group != NULL) ? 0 : (s->queue_domain != NULL) ? 1 : 2;
+        for (int pass = first_pass; pass < 3 && res == NULL; pass++) {
+          int count = 0, qids[nr_queues];
+          for (int k = 0; k < nr_queues; k++)
+            if ((queue_count(&s->queues[k]) > 0 ||
+                 s->queues[k].count_incoming > 0) &&
+                scheduler_queue_distance(s, qid, k) == pass) {
+              qids[count++] = k;
+            }
+          for (int k = 0; k < scheduler_maxsteal && count > 0; k++) {
+            int ind;
+            if (s->flags & scheduler_flag_steal_heaviest) {
+              /* Go for the queue with the most work left in it. */
+              ind = 0;
+              for (int i = 1; i < count; i++)
+                if (s->queues[qids[i]].weight > s->queues[qids[ind]].weight)
+                  ind = i;
+            } else {
+              ind = rand_r(&seed) % count;
+            }
+            TIMER_TIC
+            res = queue_steal(&s->queues[qids[ind]], prev);
+            TIMER_TOC(timer_qsteal);
+            if (res != NULL)
+              break;
+            else
+              qids[ind] = qids[--count];
           }
-        for (int k = 0; k < scheduler_maxsteal && count > 0; k++) {
-          const int ind = rand_r(&seed) % count;
-          TIMER_TIC
-          res = queue_gettask(&s->queues[qids[ind]], prev, 0);
-          TIMER_TOC(timer_qsteal);
-          if (res != NULL)
-            break;
-          else
-            qids[ind] = qids[--count];
         }
         if (res != NULL) break;
       }
     }
 
-/* If we failed, take a short nap. */
+/* If we failed, take a short nap. Without a progress thread, the runners
+ * of the communication queues keep on testing their requests. */
 #ifdef WITH_MPI
-    if (res == NULL && qid > 1)
+    if (res == NULL && (qid > 1 || (s->flags & scheduler_flag_mpi_progress)))
 #else
     if (res == NULL)
 #endif
     {
-      pthread_mutex_lock(&s->sleep_mutex);
+      /* Sleep until a task lands in our queue, or one we can steal from,
+       * or there is nothing left to wait for. */
+      struct scheduler_sleeper *sleeper = &s->sleepers[qid];
+      pthread_mutex_lock(&sleeper->mutex);
+      atomic_inc(&sleeper->nr_sleeping);
+      atomic_inc(&s->nr_sleeping);
       res = queue_gettask(&s->queues[qid], prev, 1);
       if (res == NULL && s->waiting > 0) {
-        pthread_cond_wait(&s->sleep_cond, &s->sleep_mutex);
+        pthread_cond_wait(&sleeper->cond, &sleeper->mutex);
       }
-      pthread_mutex_unlock(&s->sleep_mutex);
+      atomic_dec(&s->nr_sleeping);
+      atomic_dec(&sleeper->nr_sleeping);
+      pthread_mutex_unlock(&sleeper->mutex);
     }
   }
 
@@ -2060,12 +3717,22 @@ void scheduler_init(struct scheduler *s, struct space *space, int nr_tasks,
     error("Failed to allocate queues.");
 
   /* Initialize each queue. */
-  for (int k = 0; k < nr_queues; k++) queue_init(&s->queues[k], NULL);
-
-  /* Init the sleep mutex and cond. */
-  if (pthread_cond_init(&s->sleep_cond, NULL) != 0 ||
-      pthread_mutex_init(&s->sleep_mutex, NULL) != 0)
-    error("Failed to initialize sleep barrier.");
+  const int queue_type =
+      (flags & scheduler_flag_deques) ? queue_type_deque : queue_type_heap;
+  for (int k = 0; k < nr_queues; k++)
+    queue_init(&s->queues[k], NULL, queue_type);
+
+  /* Init the places where the runners of each queue sleep. */
+  if (swift_memalign("sleepers", (void **)&s->sleepers, SWIFT_CACHE_ALIGNMENT,
+                     sizeof(struct scheduler_sleeper) * nr_queues) != 0)
+    error("Failed to allocate sleepers.");
+  for (int k = 0; k < nr_queues; k++) {
+    if (pthread_cond_init(&s->sleepers[k].cond, NULL) != 0 ||
+        pthread_mutex_init(&s->sleepers[k].mutex, NULL) != 0)
+      error("Failed to initialize sleep barrier.");
+    s->sleepers[k].nr_sleeping = 0;
+  }
+  s->nr_sleeping = 0;
 
   /* Init the unlocks. */
   if ((s->unlocks = (struct task **)swift_malloc(
@@ -2083,13 +3750,80 @@ void scheduler_init(struct scheduler *s, struct space *space, int nr_tasks,
   s->space = space;
   s->nodeID = nodeID;
   s->threadpool = tp;
+  s->queue_domain = NULL;
+  s->queue_group = NULL;
+
+  /* Init the table of measured task costs. */
+  s->cost_ticks = NULL;
+  s->cost_model = NULL;
+  s->cost_samples = NULL;
+  s->cost_scale = NULL;
+  if (flags & scheduler_flag_adaptive_weights) {
+    if ((s->cost_ticks = (double *)swift_malloc(
+             "task_costs", sizeof(double) * scheduler_cost_table_size)) ==
+            NULL ||
+        (s->cost_model = (double *)swift_malloc(
+             "task_costs", sizeof(double) * scheduler_cost_table_size)) ==
+            NULL ||
+        (s->cost_samples = (double *)swift_malloc(
+             "task_costs", sizeof(double) * scheduler_cost_table_size)) ==
+            NULL ||
+        (s->cost_scale = (float *)swift_malloc(
+             "task_costs", sizeof(float) * scheduler_cost_table_size)) == NULL)
+      error("Failed to allocate the table of task costs.");
+    for (int k = 0; k < scheduler_cost_table_size; k++) {
+      s->cost_ticks[k] = 0.;
+      s->cost_model[k] = 0.;
+      s->cost_samples[k] = 0.;
+      s->cost_scale[k] = 1.f;
+    }
+  }
 
   /* Init the tasks array. */
   s->size = 0;
   s->tasks = NULL;
   s->tasks_ind = NULL;
+#ifdef WITH_MPI
+  s->comms = NULL;
+  s->nr_comms = 0;
+#endif
+  s->spawn_size = 0;
+  s->spawned = NULL;
+  s->spawned_parents = NULL;
+  s->nr_spawned = 0;
+  s->size_spawned = 0;
   pthread_key_create(&s->local_seed_pointer, NULL);
+  if (pthread_key_create(&s->thread_block_key, free) != 0)
+    error("Failed to create the key of the blocks of tasks.");
+  s->nr_thread_blocks = 0;
+  s->thread_blocks_generation = 0;
   scheduler_reset(s, nr_tasks);
+  s->tiny_task_cost = 0.f;
+
+#ifdef WITH_MPI
+  /* Start the MPI progress thread? */
+  s->progress_tasks = NULL;
+  s->progress_count = 0;
+  s->progress_size = 0;
+  s->progress_stop = 0;
+  s->rma_win = MPI_WIN_NULL;
+  s->rma_buff = NULL;
+  s->rma_disp = NULL;
+  s->shm_rank = NULL;
+  s->shm_comm = MPI_COMM_NULL;
+  s->shm_release_comm = MPI_COMM_NULL;
+  s->shm_parts = NULL;
+  s->shm_size = NULL;
+  s->shm_name = NULL;
+  if (flags & scheduler_flag_mpi_progress) {
+    if (pthread_mutex_init(&s->progress_mutex, NULL) != 0 ||
+        pthread_cond_init(&s->progress_cond, NULL) != 0)
+      error("Failed to initialize the MPI progress mutex.");
+    if (pthread_create(&s->progress_thread, NULL, &scheduler_progress_main,
+                       s) != 0)
+      error("Failed to create the MPI progress thread.");
+  }
+#endif
 }
 
 /**
@@ -2120,11 +3854,48 @@ void scheduler_print_tasks(const struct scheduler *s, const char *fileName) {
  * @brief Frees up the memory allocated for this #scheduler
  */
 void scheduler_clean(struct scheduler *s) {
+
+#ifdef WITH_MPI
+  /* Stop the MPI progress thread. */
+  if (s->flags & scheduler_flag_mpi_progress) {
+    pthread_mutex_lock(&s->progress_mutex);
+    s->progress_stop = 1;
+    pthread_cond_signal(&s->progress_cond);
+    pthread_mutex_unlock(&s->progress_mutex);
+    if (pthread_join(s->progress_thread, NULL) != 0)
+      error("Failed to join the MPI progress thread.");
+    free(s->progress_tasks);
+    s->progress_tasks = NULL;
+  }
+  scheduler_free_rma(s);
+  scheduler_free_shm(s);
+#endif
+
   scheduler_free_tasks(s);
   swift_free("unlocks", s->unlocks);
   swift_free("unlock_ind", s->unlock_ind);
   for (int i = 0; i < s->nr_queues; ++i) queue_clean(&s->queues[i]);
   swift_free("queues", s->queues);
+  for (int i = 0; i < s->nr_queues; ++i) {
+    pthread_mutex_destroy(&s->sleepers[i].mutex);
+    pthread_cond_destroy(&s->sleepers[i].cond);
+  }
+  swift_free("sleepers", s->sleepers);
+  if (s->queue_domain != NULL) free(s->queue_domain);
+  s->queue_domain = NULL;
+  if (s->queue_group != NULL) free(s->queue_group);
+  s->queue_group = NULL;
+  if (s->cost_ticks != NULL) {
+    swift_free("task_costs", s->cost_ticks);
+    swift_free("task_costs", s->cost_model);
+    swift_free("task_costs", s->cost_samples);
+    swift_free("task_costs", s->cost_scale);
+    s->cost_ticks = NULL;
+  }
+  if (s->spawned_parents != NULL) {
+    swift_free("spawned_parents", s->spawned_parents);
+    s->spawned_parents = NULL;
+  }
 }
 
 /**
@@ -2143,7 +3914,11 @@ void scheduler_free_tasks(struct scheduler *s) {
     swift_free("tid_active", s->tid_active);
     s->tid_active = NULL;
   }
+#ifdef WITH_MPI
+  scheduler_free_comms(s);
+#endif
   s->size = 0;
+  s->tree_fingerprint = 0;
 }
 
 /**
@@ -35,6 +35,7 @@
 #include "cell.h"
 #include "inline.h"
 #include "lock.h"
+#include "memuse.h"
 #include "queue.h"
 #include "task.h"
 #include "threadpool.h"
@@ -53,6 +54,65 @@
 /* Flags . */
 #define scheduler_flag_none 0
 #define scheduler_flag_steal (1 << 1)
+#define scheduler_flag_deques (1 << 2)
+#define scheduler_flag_compact_hydro (1 << 3)
+#define scheduler_flag_adaptive_weights (1 << 4)
+#define scheduler_flag_gather_multipoles (1 << 5)
+#define scheduler_flag_mpi_progress (1 << 6)
+#define scheduler_flag_mpi_rma (1 << 7)
+#define scheduler_flag_send_priority (1 << 8)
+#define scheduler_flag_steal_heaviest (1 << 9)
+#define scheduler_flag_mpi_shm (1 << 10)
+#define scheduler_flag_split_foreign_grav (1 << 11)
+#define scheduler_flag_fuse_kicks (1 << 12)
+#define scheduler_flag_mpi_persistent (1 << 13)
+
+/* Table of measured task costs used by the adaptive weights. */
+#define scheduler_cost_nr_bins 16
+#define scheduler_cost_table_size \
+  (task_type_count * task_subtype_count * scheduler_cost_nr_bins)
+#define scheduler_cost_decay 0.5
+#define scheduler_cost_min_samples 4.
+
+/* Blocks of tasks and links reserved at once by the threads making tasks:
+ * maximal size, fraction of the tasks per thread they may span, and number
+ * of releases of the blocks the room for their unused tasks allows for. */
+#define scheduler_max_block_size 64
+#define scheduler_block_ratio 256
+#define scheduler_block_releases 16
+#define scheduler_max_thread_blocks 1024
+
+/* Fewer tasks than this are unlocked and ranked serially, the threadpool
+ * only pays off on large task graphs. */
+#define scheduler_parallel_min_tasks 100000
+
+/* Where the runners of a queue sleep when there is nothing to do. */
+struct scheduler_sleeper {
+
+  /* Mutex and condition the runners wait on. */
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  /* Number of runners asleep, or about to be. */
+  volatile int nr_sleeping;
+
+} __attribute__((aligned(SWIFT_CACHE_ALIGNMENT)));
+
+/* The tasks and cell-task links reserved by a thread making tasks. */
+struct scheduler_thread_block {
+
+  /* Next free task of the block of tasks and end of that block. */
+  int next, end;
+
+  /* Next free link of the block of links and end of that block. */
+  size_t link_next, link_end;
+
+  /* Generation of the blocks of the scheduler this block belongs to. */
+  int generation;
+
+  /* Can the thread not reserve blocks, as there are too many threads? */
+  int unblocked;
+};
 
 /* Data of a scheduler. */
 struct scheduler {
@@ -65,6 +125,13 @@ struct scheduler {
   /* Array of queues. */
   struct queue *queues;
 
+  /* NUMA node of each queue, NULL if the queues are not NUMA-aware. */
+  int *queue_domain;
+
+  /* Last-level cache shared by the cores of each queue, NULL if the queues
+   * are not cache-aware. */
+  int *queue_group;
+
   /* Total number of tasks. */
   int nr_tasks, size, tasks_next;
 
@@ -77,6 +144,15 @@ struct scheduler {
   /* The task indices. */
   int *tasks_ind;
 
+  /* Measured run times, model costs and number of samples of the tasks per
+   * type, subtype and cost bin, and the resulting corrections of the model
+   * costs. Only allocated with adaptive weights. */
+  double *cost_ticks, *cost_model, *cost_samples;
+  float *cost_scale;
+
+  /* Fingerprint of the cell tree the tasks were made for, 0 if unknown. */
+  unsigned long long tree_fingerprint;
+
   /* List of initial tasks. */
   int *tid_active;
   int active_count;
@@ -89,9 +165,10 @@ struct scheduler {
   /* Lock for this scheduler. */
   swift_lock_type lock;
 
-  /* Waiting queue. */
-  pthread_mutex_t sleep_mutex;
-  pthread_cond_t sleep_cond;
+  /* Where the runners of each queue sleep, and the total number of runners
+   * asleep. */
+  struct scheduler_sleeper *sleepers;
+  volatile int nr_sleeping;
 
   /* The space associated with this scheduler. */
   struct space *space;
@@ -106,8 +183,83 @@ struct scheduler {
    * MPI. */
   size_t mpi_message_limit;
 
+  /* Model cost below which a ready kick, time-step, drift or ghost task is
+   * run by the runner that released it rather than queued. Zero to always
+   * queue them. */
+  float tiny_task_cost;
+
+  /* Number of interactions above which a hydro sub-task is split by the
+   * runner that picks it into tasks over the progeny of its cells. Zero to
+   * never split them at run time. */
+  int spawn_size;
+
+  /* The pool of tasks spawned that way, the task that spawned each of them
+   * and the number of them used so far in this step. */
+  struct task *spawned;
+  struct task **spawned_parents;
+  volatile int nr_spawned;
+  int size_spawned;
+
+  /* Maximum size, in bytes, of the messages into which the end-of-step
+   * messages towards one node are grouped. Zero to not group them. */
+  size_t mpi_aggregate_limit;
+
   /* 'Pointer' to the seed for the random number generator */
   pthread_key_t local_seed_pointer;
+
+  /* Blocks of tasks and links of the threads making tasks, the key to the
+   * block of each thread, the number of blocks in use and their generation,
+   * bumped whenever they are released. */
+  struct scheduler_thread_block *thread_blocks[scheduler_max_thread_blocks];
+  pthread_key_t thread_block_key;
+  int nr_thread_blocks, thread_blocks_generation;
+
+  /* Number of tasks in a block and room left at the end of the task array
+   * for the unused tasks of the blocks. */
+  int block_size, blocks_room;
+
+#ifdef WITH_MPI
+  /* Thread progressing the MPI requests of the send and recv tasks, if any. */
+  pthread_t progress_thread;
+
+  /* Send and recv tasks posted but not yet handed to the progress thread,
+   * protected by the progress mutex. */
+  struct task **progress_tasks;
+  int progress_count, progress_size;
+  pthread_mutex_t progress_mutex;
+  pthread_cond_t progress_cond;
+
+  /* Should the progress thread stop? */
+  int progress_stop;
+
+  /* Window exposing the buffers into which the other nodes put the compact
+   * hydro particles, if any. */
+  MPI_Win rma_win;
+  char *rma_buff;
+
+  /* Displacement in the window of the receiving node of the data of each
+   * compact hydro send or recv task, indexed like the tasks. */
+  size_t *rma_disp;
+
+  /* MPI state of the send and recv tasks, see #task::comm. */
+  struct task_comm *comms;
+  int nr_comms;
+
+  /* Rank of each node in the communicator of the nodes sharing our memory,
+   * -1 for the nodes elsewhere, if we read the hydro particles of the former
+   * in place. */
+  int *shm_rank;
+  MPI_Comm shm_comm;
+
+  /* Communicator of the releases of the particles read in place. */
+  MPI_Comm shm_release_comm;
+
+  /* Particle arrays of the nodes sharing our memory mapped into ours, with
+   * their size and name, indexed by node. */
+  struct part **shm_parts;
+  size_t *shm_size;
+  char (*shm_name)[memuse_node_shared_name_length];
+#endif
 };
 
 /* Inlined functions (for speed). */
@@ -149,6 +301,10 @@ scheduler_activate_send(struct scheduler *s, struct link *link,
     error("Missing link to send task.");
   }
   scheduler_activate(s, l->t);
+
+  /* Grouped messages are sent by the first task of their group. */
+  if (l->t->implicit && l->t->flags < 0)
+    scheduler_activate(s, l->t->unlock_tasks[0]);
   return l;
 }
 
@@ -172,9 +328,27 @@ scheduler_activate_recv(struct scheduler *s, struct link *link,
     error("Missing link to recv task.");
   }
   scheduler_activate(s, l->t);
+
+  /* Grouped messages are received by the first task of their group. */
+  if (l->t->implicit && l->t->flags < 0)
+    scheduler_activate(s, l->t->unlock_tasks[0]);
   return l;
 }
 
+#ifdef WITH_MPI
+/**
+ * @brief Do we read the hydro particles of a node in place from its memory
+ * rather than receiving copies of them?
+ *
+ * @param s The #scheduler.
+ * @param nodeID The other node.
+ */
+__attribute__((always_inline)) INLINE static int scheduler_reads_in_place(
+    const struct scheduler *s, const int nodeID) {
+  return (s->flags & scheduler_flag_mpi_shm) && s->shm_rank[nodeID] >= 0;
+}
+#endif
+
 /* Function prototypes. */
 void scheduler_clear_active(struct scheduler *s);
 void scheduler_init(struct scheduler *s, struct space *space, int nr_tasks,
@@ -183,6 +357,13 @@ void scheduler_init(struct scheduler *s, struct space *space, int nr_tasks,
 struct task *scheduler_gettask(struct scheduler *s, int qid,
                                const struct task *prev);
 void scheduler_enqueue(struct scheduler *s, struct task *t);
+void scheduler_wake(struct scheduler *s, int qid);
+void scheduler_wake_all(struct scheduler *s);
+#ifdef WITH_MPI
+void scheduler_free_send_buffer(const struct scheduler *s, struct task *t);
+void scheduler_free_rma(struct scheduler *s);
+void scheduler_free_shm(struct scheduler *s);
+#endif
 void scheduler_start(struct scheduler *s);
 void scheduler_reset(struct scheduler *s, int nr_tasks);
 void scheduler_ranktasks(struct scheduler *s);
@@ -191,10 +372,16 @@ struct task *scheduler_addtask(struct scheduler *s, enum task_types type,
                                enum task_subtypes subtype, int flags,
                                int implicit, struct cell *ci, struct cell *cj);
 void scheduler_splittasks(struct scheduler *s, const int fof_tasks);
+struct scheduler_thread_block *scheduler_get_thread_block(
+    struct scheduler *s);
+void scheduler_release_blocks(struct scheduler *s);
 struct task *scheduler_done(struct scheduler *s, struct task *t);
+void scheduler_init_spawn(struct scheduler *s, int spawn_size, int max_tasks);
+int scheduler_spawn(struct scheduler *s, struct task *t);
 struct task *scheduler_unlock(struct scheduler *s, struct task *t);
 void scheduler_addunlock(struct scheduler *s, struct task *ta, struct task *tb);
 void scheduler_set_unlocks(struct scheduler *s);
+void scheduler_set_comms(struct scheduler *s);
 void scheduler_dump_queue(struct scheduler *s);
 void scheduler_print_tasks(const struct scheduler *s, const char *fileName);
 void scheduler_clean(struct scheduler *s);
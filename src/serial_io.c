@@ -24,6 +24,7 @@
 #if defined(HAVE_HDF5) && defined(WITH_MPI) && !defined(HAVE_PARALLEL_HDF5)
 
 /* Some standard headers. */
+#include <float.h>
 #include <hdf5.h>
 #include <math.h>
 #include <mpi.h>
@@ -64,11 +65,13 @@
 /**
  * @brief Reads a data array from a given HDF5 group.
  *
+ * @param tp The #threadpool converting the data.
  * @param grp The group from which to read.
  * @param props The #io_props of the field to read
  * @param N The number of particles to read on this rank.
- * @param N_total The total number of particles on all ranks.
- * @param offset The offset position where this rank starts reading.
+ * @param ranges The ranges of particles read by this rank, as pairs of
+ * offset and count sorted by offset.
+ * @param nr_ranges The number of ranges.
  * @param internal_units The #unit_system used internally
  * @param ic_units The #unit_system used in the ICs
  * @param cleanup_h Are we removing h-factors from the ICs?
@@ -80,8 +83,8 @@
  * @todo A better version using HDF5 hyper-slabs to read the file directly into
  * the part array will be written once the structures have been stabilized.
  */
-void readArray(hid_t grp, const struct io_props props, size_t N,
-               long long N_total, long long offset,
+void readArray(struct threadpool* tp, hid_t grp, const struct io_props props,
+               size_t N, const long long* ranges, int nr_ranges,
                const struct unit_system* internal_units,
                const struct unit_system* ic_units, int cleanup_h,
                int cleanup_sqrt_a, double h, double a) {
@@ -116,29 +119,13 @@ void readArray(hid_t grp, const struct io_props props, size_t N,
   void* temp = malloc(num_elements * typeSize);
   if (temp == NULL) error("Unable to allocate memory for temporary buffer");
 
-  /* Prepare information for hyper-slab */
-  hsize_t shape[2], offsets[2];
-  int rank;
-  if (props.dimension > 1) {
-    rank = 2;
-    shape[0] = N;
-    shape[1] = props.dimension;
-    offsets[0] = offset;
-    offsets[1] = 0;
-  } else {
-    rank = 2;
-    shape[0] = N;
-    shape[1] = 1;
-    offsets[0] = offset;
-    offsets[1] = 0;
-  }
-
   /* Create data space in memory */
-  const hid_t h_memspace = H5Screate_simple(rank, shape, NULL);
+  const hsize_t shape[2] = {N, props.dimension};
+  const hid_t h_memspace = H5Screate_simple(2, shape, NULL);
 
-  /* Select hyper-slab in file */
+  /* Select the hyper-slabs of our particles in the file */
   const hid_t h_filespace = H5Dget_space(h_data);
-  H5Sselect_hyperslab(h_filespace, H5S_SELECT_SET, offsets, NULL, shape, NULL);
+  io_select_ranges(h_filespace, ranges, nr_ranges, 0, N, props.dimension);
 
   /* Read HDF5 dataspace in temporary buffer */
   /* Dirty version that happens to work for vectors but should be improved */
@@ -147,88 +134,9 @@ void readArray(hid_t grp, const struct io_props props, size_t N,
                               h_filespace, H5P_DEFAULT, temp);
   if (h_err < 0) error("Error while reading data array '%s'.", props.name);
 
-  /* Unit conversion if necessary */
-  const double factor =
-      units_conversion_factor(ic_units, internal_units, props.units);
-  if (factor != 1. && exist != 0) {
-
-    /* message("Converting ! factor=%e", factor); */
-
-    if (io_is_double_precision(props.type)) {
-      double* temp_d = (double*)temp;
-      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= factor;
-    } else {
-      float* temp_f = (float*)temp;
-
-#ifdef SWIFT_DEBUG_CHECKS
-      float maximum = 0.f;
-      float minimum = FLT_MAX;
-#endif
-
-      /* Loop that converts the Units */
-      for (size_t i = 0; i < num_elements; ++i) {
-
-#ifdef SWIFT_DEBUG_CHECKS
-        /* Find the absolute minimum and maximum values */
-        const float abstemp_f = fabsf(temp_f[i]);
-        if (abstemp_f != 0.f) {
-          maximum = max(maximum, abstemp_f);
-          minimum = min(minimum, abstemp_f);
-        }
-#endif
-
-        /* Convert the float units */
-        temp_f[i] *= factor;
-      }
-
-#ifdef SWIFT_DEBUG_CHECKS
-      /* The two possible errors: larger than float or smaller
-       * than float precision. */
-      if (factor * maximum > FLT_MAX) {
-        error("Unit conversion results in numbers larger than floats");
-      } else if (factor * minimum < FLT_MIN) {
-        error("Numbers smaller than float precision");
-      }
-#endif
-    }
-  }
-
-  /* Clean-up h if necessary */
-  const float h_factor_exp = units_h_factor(internal_units, props.units);
-  if (cleanup_h && h_factor_exp != 0.f && exist != 0) {
-
-    /* message("Multipltying '%s' by h^%f=%f", props.name, h_factor_exp,
-     * h_factor); */
-
-    if (io_is_double_precision(props.type)) {
-      double* temp_d = (double*)temp;
-      const double h_factor = pow(h, h_factor_exp);
-      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= h_factor;
-    } else {
-      float* temp_f = (float*)temp;
-      const float h_factor = pow(h, h_factor_exp);
-      for (size_t i = 0; i < num_elements; ++i) temp_f[i] *= h_factor;
-    }
-  }
-
-  /* Clean-up a if necessary */
-  if (cleanup_sqrt_a && a != 1. && (strcmp(props.name, "Velocities") == 0)) {
-
-    if (io_is_double_precision(props.type)) {
-      double* temp_d = (double*)temp;
-      const double vel_factor = sqrt(a);
-      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= vel_factor;
-    } else {
-      float* temp_f = (float*)temp;
-      const float vel_factor = sqrt(a);
-      for (size_t i = 0; i < num_elements; ++i) temp_f[i] *= vel_factor;
-    }
-  }
-
-  /* Copy temporary buffer to particle data */
-  char* temp_c = (char*)temp;
-  for (size_t i = 0; i < N; ++i)
-    memcpy(props.field + i * props.partSize, &temp_c[i * copySize], copySize);
+  /* Convert and copy the data to the particles using all the threads */
+  io_convert_read_buffer(tp, props, N, temp, internal_units, ic_units,
+                         cleanup_h, cleanup_sqrt_a, h, a);
 
   /* Free and close everything */
   free(temp);
@@ -273,8 +181,11 @@ void prepareArray(const struct engine* e, hid_t grp, char* fileName,
   if (h_err < 0)
     error("Error while changing data space shape for field '%s'.", props.name);
 
+  /* Dataset type */
+  hid_t h_type = H5Tcopy(io_hdf5_type(props.type));
+
   /* Dataset properties */
-  const hid_t h_prop = H5Pcreate(H5P_DATASET_CREATE);
+  hid_t h_prop = H5Pcreate(H5P_DATASET_CREATE);
 
   /* Set chunk size */
   h_err = H5Pset_chunk(h_prop, rank, chunk_shape);
@@ -282,6 +193,10 @@ void prepareArray(const struct engine* e, hid_t grp, char* fileName,
     error("Error while setting chunk size (%llu, %llu) for field '%s'.",
           chunk_shape[0], chunk_shape[1], props.name);
 
+  /* Are we imposing some form of lossy compression filter? */
+  set_hdf5_lossy_compression(&h_prop, &h_type, props.lossy_compression,
+                             props.type, props.name);
+
   /* Impose check-sum to verify data corruption */
   h_err = H5Pset_fletcher32(h_prop);
   if (h_err < 0)
@@ -301,8 +216,8 @@ void prepareArray(const struct engine* e, hid_t grp, char* fileName,
   }
 
   /* Create dataset */
-  const hid_t h_data = H5Dcreate(grp, props.name, io_hdf5_type(props.type),
-                                 h_space, H5P_DEFAULT, h_prop, H5P_DEFAULT);
+  const hid_t h_data = H5Dcreate(grp, props.name, h_type, h_space,
+                                 H5P_DEFAULT, h_prop, H5P_DEFAULT);
   if (h_data < 0) error("Error while creating dataspace '%s'.", props.name);
 
   /* Write XMF description for this data set */
@@ -338,56 +253,26 @@ void prepareArray(const struct engine* e, hid_t grp, char* fileName,
       factor * pow(e->cosmology->a, a_factor_exp));
 
   /* Close everything */
+  H5Tclose(h_type);
   H5Pclose(h_prop);
   H5Dclose(h_data);
   H5Sclose(h_space);
 }
 
 /**
- * @brief Writes a data array in given HDF5 group.
+ * @brief Writes a contiguous chunk of data in an open HDF5 dataset.
  *
- * @param e The #engine we are writing from.
- * @param grp The group in which to write.
- * @param fileName The name of the file in which the data is written
- * @param xmfFile The FILE used to write the XMF description
- * @param partTypeGroupName The name of the group containing the particles in
- * the HDF5 file.
- * @param props The #io_props of the field to read
+ * @param h_data The HDF5 dataset to write to.
+ * @param props The #io_props of the field to write.
  * @param N The number of particles to write.
- * @param N_total The total number of particles on all ranks.
- * @param offset The offset position where this rank starts writing.
- * @param mpi_rank The MPI rank of this node
- * @param internal_units The #unit_system used internally
- * @param snapshot_units The #unit_system used in the snapshots
- *
- * @todo A better version using HDF5 hyper-slabs to write the file directly from
- * the part array will be written once the structures have been stabilized.
+ * @param offset The offset in the array on disk for this chunk.
+ * @param temp The buffer containing the data already in snapshot units.
+ * @param in_place Is temp the field of the particles themselves (see
+ * io_make_in_place_memspace()) rather than a contiguous buffer?
  */
-void writeArray(const struct engine* e, hid_t grp, char* fileName,
-                FILE* xmfFile, char* partTypeGroupName,
-                const struct io_props props, size_t N, long long N_total,
-                int mpi_rank, long long offset,
-                const struct unit_system* internal_units,
-                const struct unit_system* snapshot_units) {
-
-  const size_t typeSize = io_sizeof_type(props.type);
-  const size_t num_elements = N * props.dimension;
-
-  /* message("Writing '%s' array...", props.name); */
-
-  /* Prepare the arrays in the file */
-  if (mpi_rank == 0)
-    prepareArray(e, grp, fileName, xmfFile, partTypeGroupName, props, N_total,
-                 internal_units, snapshot_units);
-
-  /* Allocate temporary buffer */
-  void* temp = NULL;
-  if (swift_memalign("writebuff", (void**)&temp, IO_BUFFER_ALIGNMENT,
-                     num_elements * typeSize) != 0)
-    error("Unable to allocate temporary i/o buffer");
-
-  /* Copy the particle data to the temporary buffer */
-  io_copy_temp_buffer(temp, e, props, N, internal_units, snapshot_units);
+static void writeArray_chunk(hid_t h_data, const struct io_props props,
+                             size_t N, long long offset, const void* temp,
+                             const int in_place) {
 
   /* Construct information for the hyper-slab */
   int rank;
@@ -408,20 +293,21 @@ void writeArray(const struct engine* e, hid_t grp, char* fileName,
   }
 
   /* Create data space in memory */
-  const hid_t h_memspace = H5Screate(H5S_SIMPLE);
-  if (h_memspace < 0)
-    error("Error while creating data space (memory) for field '%s'.",
-          props.name);
-
-  /* Change shape of memory data space */
-  hid_t h_err = H5Sset_extent_simple(h_memspace, rank, shape, NULL);
-  if (h_err < 0)
-    error("Error while changing data space (memory) shape for field '%s'.",
-          props.name);
+  hid_t h_memspace, h_err;
+  if (in_place) {
+    h_memspace = io_make_in_place_memspace(props, N);
+  } else {
+    h_memspace = H5Screate(H5S_SIMPLE);
+    if (h_memspace < 0)
+      error("Error while creating data space (memory) for field '%s'.",
+            props.name);
 
-  /* Open pre-existing data set */
-  const hid_t h_data = H5Dopen(grp, props.name, H5P_DEFAULT);
-  if (h_data < 0) error("Error while opening dataset '%s'.", props.name);
+    /* Change shape of memory data space */
+    h_err = H5Sset_extent_simple(h_memspace, rank, shape, NULL);
+    if (h_err < 0)
+      error("Error while changing data space (memory) shape for field '%s'.",
+            props.name);
+  }
 
   /* Select data space in that data set */
   const hid_t h_filespace = H5Dget_space(h_data);
@@ -432,13 +318,125 @@ void writeArray(const struct engine* e, hid_t grp, char* fileName,
                    H5P_DEFAULT, temp);
   if (h_err < 0) error("Error while writing data array '%s'.", props.name);
 
-  /* Free and close everything */
-  swift_free("writebuff", temp);
-  H5Dclose(h_data);
   H5Sclose(h_memspace);
   H5Sclose(h_filespace);
 }
 
+/**
+ * @brief Writes a data array in given HDF5 group for all the ranks of a node.
+ *
+ * All the ranks of the node convert their particles to the snapshot units
+ * directly into a window of node-shared memory. The writer of the node then
+ * writes the data of all of them, merging the slices that follow each other
+ * both in memory and in the file into a single write. The writer's own
+ * particles are written straight from the particle arrays when the field
+ * needs no conversion.
+ *
+ * @param e The #engine we are writing from.
+ * @param grp The group in which to write (only valid on the node's writer).
+ * @param fileName The name of the file in which the data is written
+ * @param xmfFile The FILE used to write the XMF description
+ * @param partTypeGroupName The name of the group containing the particles in
+ * the HDF5 file.
+ * @param props The #io_props of the field to read
+ * @param N The number of particles to write from this rank.
+ * @param N_total The total number of particles on all ranks.
+ * @param mpi_rank The MPI rank of this node
+ * @param node_offsets The offset position where each rank of the node starts
+ * writing (only valid on the node's writer).
+ * @param node_comm The communicator of the ranks sharing this node.
+ * @param internal_units The #unit_system used internally
+ * @param snapshot_units The #unit_system used in the snapshots
+ */
+void writeArray(const struct engine* e, hid_t grp, char* fileName,
+                FILE* xmfFile, char* partTypeGroupName,
+                const struct io_props props, size_t N, long long N_total,
+                int mpi_rank, const long long* node_offsets,
+                MPI_Comm node_comm, const struct unit_system* internal_units,
+                const struct unit_system* snapshot_units) {
+
+  const size_t element_size = io_sizeof_type(props.type) * props.dimension;
+
+  int node_rank, node_size;
+  MPI_Comm_rank(node_comm, &node_rank);
+  MPI_Comm_size(node_comm, &node_size);
+
+  /* message("Writing '%s' array...", props.name); */
+
+  /* Prepare the arrays in the file */
+  if (mpi_rank == 0)
+    prepareArray(e, grp, fileName, xmfFile, partTypeGroupName, props, N_total,
+                 internal_units, snapshot_units);
+
+  /* Can the writer skip the copy of its own particles? */
+  const int in_place =
+      node_rank == 0 &&
+      io_can_write_in_place(props, internal_units, snapshot_units);
+
+  /* Allocate our slice of the node's buffer */
+  void* temp = NULL;
+  MPI_Win win;
+  if (MPI_Win_allocate_shared(in_place ? 0 : N * element_size, 1,
+                              MPI_INFO_NULL, node_comm, &temp,
+                              &win) != MPI_SUCCESS)
+    error("Unable to allocate shared i/o buffer");
+
+  /* Copy the particle data to our slice */
+  if (!in_place)
+    io_copy_temp_buffer(temp, e, props, N, internal_units, snapshot_units);
+  MPI_Win_fence(0, win);
+
+  /* The writer of the node now writes everything */
+  if (node_rank == 0) {
+
+    /* Open pre-existing data set */
+    const hid_t h_data = H5Dopen(grp, props.name, H5P_DEFAULT);
+    if (h_data < 0) error("Error while opening dataset '%s'.", props.name);
+
+    /* Our own particles first if they are not in the shared buffer */
+    if (in_place && N > 0)
+      writeArray_chunk(h_data, props, N, node_offsets[0], props.field,
+                       /*in_place=*/1);
+
+    const char* run_data = NULL;
+    size_t run_count = 0;
+    long long run_offset = 0;
+    for (int i = 0; i < node_size; ++i) {
+
+      /* Where is the slice of that rank? */
+      MPI_Aint size;
+      int disp_unit;
+      char* data = NULL;
+      MPI_Win_shared_query(win, i, &size, &disp_unit, &data);
+      const size_t count = size / element_size;
+      if (count == 0) continue;
+
+      /* Extend the current run if we can, otherwise flush it */
+      if (run_count > 0 &&
+          node_offsets[i] == run_offset + (long long)run_count &&
+          data == run_data + run_count * element_size) {
+        run_count += count;
+        continue;
+      }
+      if (run_count > 0)
+        writeArray_chunk(h_data, props, run_count, run_offset, run_data,
+                         /*in_place=*/0);
+      run_data = data;
+      run_count = count;
+      run_offset = node_offsets[i];
+    }
+    if (run_count > 0)
+      writeArray_chunk(h_data, props, run_count, run_offset, run_data,
+                       /*in_place=*/0);
+
+    H5Dclose(h_data);
+  }
+
+  /* Free everything */
+  MPI_Win_fence(0, win);
+  MPI_Win_free(&win);
+}
+
 /**
  * @brief Reads an HDF5 initial condition file (GADGET-3 type)
  *
@@ -465,6 +463,8 @@ void writeArray(const struct engine* e, hid_t grp, char* fileName,
  * IC velocities?
  * @param h The value of the reduced Hubble constant to use for correction.
  * @param a The current value of the scale-factor.
+ * @param initial_partition The #partition in which to decide the partition
+ * of ICs with cell meta-data, read cell by cell, or NULL to read slices.
  * @param mpi_rank The MPI rank of this node
  * @param mpi_size The number of MPI ranks
  * @param comm The MPI communicator
@@ -486,7 +486,8 @@ void read_ic_serial(char* fileName, const struct unit_system* internal_units,
                     size_t* Ngparts, size_t* Nstars, size_t* Nblackholes,
                     int* flag_entropy, int with_hydro, int with_gravity,
                     int with_stars, int with_black_holes, int cleanup_h,
-                    int cleanup_sqrt_a, double h, double a, int mpi_rank,
+                    int cleanup_sqrt_a, double h, double a,
+                    struct partition* initial_partition, int mpi_rank,
                     int mpi_size, MPI_Comm comm, MPI_Info info, int n_threads,
                     int dry_run) {
 
@@ -498,7 +499,8 @@ void read_ic_serial(char* fileName, const struct unit_system* internal_units,
   long long numParticles_highWord[swift_type_count] = {0};
   size_t N[swift_type_count] = {0};
   long long N_total[swift_type_count] = {0};
-  long long offset[swift_type_count] = {0};
+  long long* ranges[swift_type_count];
+  int nr_ranges[swift_type_count];
   int dimension = 3; /* Assume 3D if nothing is specified */
   size_t Ndm = 0;
   struct unit_system* ic_units =
@@ -615,9 +617,6 @@ void read_ic_serial(char* fileName, const struct unit_system* internal_units,
       message("(internal) Unit system: U_T = %e K.",
               internal_units->UnitTemperature_in_cgs);
     }
-
-    /* Close file */
-    H5Fclose(h_file);
   }
 
   /* Convert the dimensions of the box */
@@ -632,10 +631,14 @@ void read_ic_serial(char* fileName, const struct unit_system* internal_units,
   MPI_Bcast(ic_units, sizeof(struct unit_system), MPI_BYTE, 0, comm);
 
   /* Divide the particles among the tasks. */
-  for (int ptype = 0; ptype < swift_type_count; ++ptype) {
-    offset[ptype] = mpi_rank * N_total[ptype] / mpi_size;
-    N[ptype] = (mpi_rank + 1) * N_total[ptype] / mpi_size - offset[ptype];
-  }
+  const double length_factor =
+      units_conversion_factor(ic_units, internal_units, UNIT_CONV_LENGTH) /
+      (cleanup_h ? h : 1.);
+  io_get_ic_ranges(h_file, dry_run ? NULL : initial_partition, length_factor,
+                   N_total, mpi_rank, mpi_size, comm, N, ranges, nr_ranges);
+
+  /* Close file */
+  if (mpi_rank == 0) H5Fclose(h_file);
 
   /* Allocate memory to store SPH particles */
   if (with_hydro) {
@@ -685,6 +688,10 @@ void read_ic_serial(char* fileName, const struct unit_system* internal_units,
   /* For dry runs, only need to do this on rank 0 */
   if (dry_run) mpi_size = 1;
 
+  /* Let's initialise a bit of thread parallelism here */
+  struct threadpool tp;
+  threadpool_init(&tp, n_threads);
+
   /* Now loop over ranks and read the data */
   for (int rank = 0; rank < mpi_size; ++rank) {
 
@@ -754,9 +761,9 @@ void read_ic_serial(char* fileName, const struct unit_system* internal_units,
         /* Read everything */
         if (!dry_run)
           for (int i = 0; i < num_fields; ++i)
-            readArray(h_grp, list[i], Nparticles, N_total[ptype], offset[ptype],
-                      internal_units, ic_units, cleanup_h, cleanup_sqrt_a, h,
-                      a);
+            readArray(&tp, h_grp, list[i], Nparticles, ranges[ptype],
+                      nr_ranges[ptype], internal_units, ic_units, cleanup_h,
+                      cleanup_sqrt_a, h, a);
 
         /* Close particle group */
         H5Gclose(h_grp);
@@ -773,10 +780,6 @@ void read_ic_serial(char* fileName, const struct unit_system* internal_units,
   /* Duplicate the parts for gravity */
   if (!dry_run && with_gravity) {
 
-    /* Let's initialise a bit of thread parallelism here */
-    struct threadpool tp;
-    threadpool_init(&tp, n_threads);
-
     /* Prepare the DM particles */
     io_prepare_dm_gparts(&tp, *gparts, Ndm);
 
@@ -791,13 +794,14 @@ void read_ic_serial(char* fileName, const struct unit_system* internal_units,
     if (with_black_holes)
       io_duplicate_black_holes_gparts(&tp, *bparts, *gparts, *Nblackholes,
                                       Ndm + *Ngas + *Nstars);
-
-    threadpool_clean(&tp);
   }
 
+  threadpool_clean(&tp);
+
   /* message("Done Reading particles..."); */
 
   /* Clean up */
+  for (int ptype = 0; ptype < swift_type_count; ptype++) free(ranges[ptype]);
   free(ic_units);
 }
 
@@ -854,19 +858,27 @@ void write_output_serial(struct engine* e, const char* baseName,
   // const size_t Nbaryons = Ngas + Nstars;
   // const size_t Ndm = Ntot > 0 ? Ntot - Nbaryons : 0;
 
+  /* Snipshots only keep a subsample of the particles */
+  const int snipshot = e->snapshot_is_snipshot;
+  const float fraction = snipshot ? e->snipshot_subsample_fraction : 1.f;
+  const float threshold = snipshot ? e->snipshot_density_threshold : FLT_MAX;
+
   /* Number of particles that we will write */
   const size_t Ntot_written =
       e->s->nr_gparts - e->s->nr_inhibited_gparts - e->s->nr_extra_gparts;
-  const size_t Ngas_written =
+  size_t Ngas_written =
       e->s->nr_parts - e->s->nr_inhibited_parts - e->s->nr_extra_parts;
-  const size_t Nstars_written =
+  size_t Nstars_written =
       e->s->nr_sparts - e->s->nr_inhibited_sparts - e->s->nr_extra_sparts;
-  const size_t Nblackholes_written =
+  size_t Nblackholes_written =
       e->s->nr_bparts - e->s->nr_inhibited_bparts - e->s->nr_extra_bparts;
   const size_t Nbaryons_written =
       Ngas_written + Nstars_written + Nblackholes_written;
-  const size_t Ndm_written =
-      Ntot_written > 0 ? Ntot_written - Nbaryons_written : 0;
+  size_t Ndm_written = Ntot_written > 0 ? Ntot_written - Nbaryons_written : 0;
+  if (snipshot)
+    io_count_snipshot_particles(e->s, fraction, threshold, &Ngas_written,
+                                &Ndm_written, &Nstars_written,
+                                &Nblackholes_written);
 
   /* File name */
   char fileName[FILENAME_BUFFER_SIZE];
@@ -957,6 +969,10 @@ void write_output_serial(struct engine* e, const char* baseName,
     io_write_attribute(h_grp, "Flag_Entropy_ICs", UINT, flagEntropy,
                        swift_type_count);
     io_write_attribute(h_grp, "NumFilesPerSnapshot", INT, &numFiles, 1);
+    if (snipshot) {
+      io_write_attribute_i(h_grp, "Snipshot", 1);
+      io_write_attribute_f(h_grp, "SnipshotSubsampleFraction", fraction);
+    }
 
     /* Close header */
     H5Gclose(h_grp);
@@ -1091,9 +1107,10 @@ void write_output_serial(struct engine* e, const char* baseName,
     H5Fclose(h_file);
   }
 
-  /* Now write the top-level cell structure */
+  /* Now write the top-level cell structure (snipshots have only a subset
+   * of the particles of each cell and are not indexed) */
   hid_t h_file_cells = 0, h_grp_cells = 0;
-  if (mpi_rank == 0) {
+  if (!snipshot && mpi_rank == 0) {
 
     /* Open the snapshot on rank 0 */
     h_file_cells = H5Fopen(fileName, H5F_ACC_RDWR, H5P_DEFAULT);
@@ -1107,25 +1124,69 @@ void write_output_serial(struct engine* e, const char* baseName,
   }
 
   /* Write the location of the particles in the arrays */
-  io_write_cell_offsets(h_grp_cells, e->s->cdim, e->s->cells_top,
-                        e->s->nr_cells, e->s->width, mpi_rank, N_total, offset,
-                        internal_units, snapshot_units);
+  if (!snipshot)
+    io_write_cell_offsets(h_grp_cells, e->s->cdim, e->s->cells_top,
+                          e->s->nr_cells, e->s->cells_top_order, e->s->width,
+                          mpi_rank, N_total, offset, internal_units,
+                          snapshot_units);
 
   /* Close everything */
-  if (mpi_rank == 0) {
+  if (!snipshot && mpi_rank == 0) {
     H5Gclose(h_grp_cells);
     H5Fclose(h_file_cells);
   }
 
-  /* Now loop over ranks and write the data */
-  for (int rank = 0; rank < mpi_size; ++rank) {
+  /* Group the ranks sharing a node. The first rank of each node writes the
+   * data of all of them, so it is the nodes and not the ranks that take
+   * turns to write. */
+  MPI_Comm node_comm;
+  MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, mpi_rank, MPI_INFO_NULL,
+                      &node_comm);
+  int node_rank, node_size;
+  MPI_Comm_rank(node_comm, &node_rank);
+  MPI_Comm_size(node_comm, &node_size);
+
+  /* Number the nodes in the order of their first rank */
+  int is_writer = (node_rank == 0);
+  int node_index = 0, nr_nodes = 0;
+  MPI_Exscan(&is_writer, &node_index, 1, MPI_INT, MPI_SUM, comm);
+  if (mpi_rank == 0) node_index = 0;
+  MPI_Bcast(&node_index, 1, MPI_INT, 0, node_comm);
+  MPI_Allreduce(&is_writer, &nr_nodes, 1, MPI_INT, MPI_SUM, comm);
+
+  /* The writers need the offsets of all the ranks of their node */
+  long long* node_offsets = NULL;
+  long long* rank_offsets = NULL;
+  if (node_rank == 0) {
+    node_offsets = (long long*)malloc(swift_type_count * node_size *
+                                      sizeof(long long));
+    rank_offsets = (long long*)malloc(swift_type_count * node_size *
+                                      sizeof(long long));
+    if (node_offsets == NULL || rank_offsets == NULL)
+      error("Unable to allocate the node offsets");
+  }
+  MPI_Gather(offset, swift_type_count, MPI_LONG_LONG_INT, rank_offsets,
+             swift_type_count, MPI_LONG_LONG_INT, 0, node_comm);
+  if (node_rank == 0) {
+    for (int i = 0; i < node_size; ++i)
+      for (int ptype = 0; ptype < swift_type_count; ++ptype)
+        node_offsets[ptype * node_size + i] =
+            rank_offsets[i * swift_type_count + ptype];
+    free(rank_offsets);
+  }
 
-    /* Is it this rank's turn to write ? */
-    if (rank == mpi_rank) {
+  /* Now loop over nodes and write the data */
+  for (int node = 0; node < nr_nodes; ++node) {
 
-      h_file = H5Fopen(fileName, H5F_ACC_RDWR, H5P_DEFAULT);
-      if (h_file < 0)
-        error("Error while opening file '%s' on rank %d.", fileName, mpi_rank);
+    /* Is it this node's turn to write ? */
+    if (node == node_index) {
+
+      if (node_rank == 0) {
+        h_file = H5Fopen(fileName, H5F_ACC_RDWR, H5P_DEFAULT);
+        if (h_file < 0)
+          error("Error while opening file '%s' on rank %d.", fileName,
+                mpi_rank);
+      }
 
       /* Loop over all particle types */
       for (int ptype = 0; ptype < swift_type_count; ptype++) {
@@ -1143,9 +1204,12 @@ void write_output_serial(struct engine* e, const char* baseName,
         char partTypeGroupName[PARTICLE_GROUP_BUFFER_SIZE];
         snprintf(partTypeGroupName, PARTICLE_GROUP_BUFFER_SIZE, "/PartType%d",
                  ptype);
-        h_grp = H5Gopen(h_file, partTypeGroupName, H5P_DEFAULT);
-        if (h_grp < 0)
-          error("Error while opening particle group %s.", partTypeGroupName);
+        if (node_rank == 0) {
+          h_grp = H5Gopen(h_file, partTypeGroupName, H5P_DEFAULT);
+          if (h_grp < 0)
+            error("Error while opening particle group %s.",
+                  partTypeGroupName);
+        }
 
         int num_fields = 0;
         struct io_props list[100];
@@ -1167,7 +1231,8 @@ void write_output_serial(struct engine* e, const char* baseName,
               /* No inhibted particles: easy case */
               Nparticles = Ngas;
               hydro_write_particles(parts, xparts, list, &num_fields);
-              num_fields += chemistry_write_particles(parts, list + num_fields);
+              num_fields +=
+                  chemistry_write_particles(parts, xparts, list + num_fields);
               if (with_cooling || with_temperature) {
                 num_fields += cooling_write_particles(
                     parts, xparts, list + num_fields, e->cooling_func);
@@ -1198,13 +1263,15 @@ void write_output_serial(struct engine* e, const char* baseName,
 
               /* Collect the particles we want to write */
               io_collect_parts_to_write(parts, xparts, parts_written,
-                                        xparts_written, Ngas, Ngas_written);
+                                        xparts_written, Ngas, Ngas_written,
+                                        fraction, threshold);
 
               /* Select the fields to write */
               hydro_write_particles(parts_written, xparts_written, list,
                                     &num_fields);
               num_fields +=
-                  chemistry_write_particles(parts_written, list + num_fields);
+                  chemistry_write_particles(parts_written, xparts_written,
+                                            list + num_fields);
               if (with_cooling || with_temperature) {
                 num_fields +=
                     cooling_write_particles(parts_written, xparts_written,
@@ -1257,7 +1324,8 @@ void write_output_serial(struct engine* e, const char* baseName,
               /* Collect the non-inhibited DM particles from gpart */
               io_collect_gparts_to_write(
                   gparts, e->s->gpart_group_data, gparts_written,
-                  gpart_group_data_written, Ntot, Ndm_written, with_stf);
+                  gpart_group_data_written, Ntot, Ndm_written, with_stf,
+                  fraction);
 
               /* Select the fields to write */
               darkmatter_write_particles(gparts_written, list, &num_fields);
@@ -1295,7 +1363,7 @@ void write_output_serial(struct engine* e, const char* baseName,
 
               /* Collect the particles we want to write */
               io_collect_sparts_to_write(sparts, sparts_written, Nstars,
-                                         Nstars_written);
+                                         Nstars_written, fraction);
 
               /* Select the fields to write */
               stars_write_particles(sparts_written, list, &num_fields);
@@ -1333,7 +1401,7 @@ void write_output_serial(struct engine* e, const char* baseName,
 
               /* Collect the particles we want to write */
               io_collect_bparts_to_write(bparts, bparts_written, Nblackholes,
-                                         Nblackholes_written);
+                                         Nblackholes_written, fraction);
 
               /* Select the fields to write */
               black_holes_write_particles(bparts_written, list, &num_fields);
@@ -1351,15 +1419,15 @@ void write_output_serial(struct engine* e, const char* baseName,
         /* Write everything that is not cancelled */
         for (int i = 0; i < num_fields; ++i) {
 
-          /* Did the user cancel this field? */
-          char field[PARSER_MAX_LINE_SIZE];
-          sprintf(field, "SelectOutput:%s_%s", list[i].name,
-                  part_type_names[ptype]);
-          int should_write = parser_get_opt_param_int(params, field, 1);
+          /* Did the user cancel this field or ask for a lossy filter? */
+          list[i].lossy_compression = io_get_field_compression(
+              params, list[i].name, part_type_names[ptype],
+              list[i].lossy_compression, snipshot);
 
-          if (should_write)
+          if (list[i].lossy_compression != compression_do_not_write)
             writeArray(e, h_grp, fileName, xmfFile, partTypeGroupName, list[i],
-                       Nparticles, N_total[ptype], mpi_rank, offset[ptype],
+                       Nparticles, N_total[ptype], mpi_rank,
+                       node_offsets + ptype * node_size, node_comm,
                        internal_units, snapshot_units);
         }
 
@@ -1373,7 +1441,7 @@ void write_output_serial(struct engine* e, const char* baseName,
         if (bparts_written) swift_free("bparts_written", sparts_written);
 
         /* Close particle group */
-        H5Gclose(h_grp);
+        if (node_rank == 0) H5Gclose(h_grp);
 
         /* Close this particle group in the XMF file as well */
         if (mpi_rank == 0)
@@ -1381,13 +1449,17 @@ void write_output_serial(struct engine* e, const char* baseName,
       }
 
       /* Close file */
-      H5Fclose(h_file);
+      if (node_rank == 0) H5Fclose(h_file);
     }
 
     /* Wait for the read of the reading to complete */
     MPI_Barrier(comm);
   }
 
+  /* Free the node information */
+  if (node_rank == 0) free(node_offsets);
+  MPI_Comm_free(&node_comm);
+
   /* Write footer of LXMF file descriptor */
   if (mpi_rank == 0)
     xmf_write_outputfooter(xmfFile, e->snapshot_output_count, e->time);
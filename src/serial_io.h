@@ -41,7 +41,8 @@ void read_ic_serial(char* fileName, const struct unit_system* internal_units,
                     size_t* Ngparts, size_t* Nstars, size_t* Nblackholes,
                     int* flag_entropy, int with_hydro, int with_gravity,
                     int with_stars, int with_black_holes, int cleanup_h,
-                    int cleanup_sqrt_a, double h, double a, int mpi_rank,
+                    int cleanup_sqrt_a, double h, double a,
+                    struct partition* initial_partition, int mpi_rank,
                     int mpi_size, MPI_Comm comm, MPI_Info info, int n_threads,
                     int dry_run);
 
@@ -53,8 +54,8 @@ void write_output_serial(struct engine* e, const char* baseName,
 void writeArray(const struct engine* e, hid_t grp, char* fileName,
                 FILE* xmfFile, char* partTypeGroupName,
                 const struct io_props props, size_t N, long long N_total,
-                int mpi_rank, long long offset,
-                const struct unit_system* internal_units,
+                int mpi_rank, const long long* node_offsets,
+                MPI_Comm node_comm, const struct unit_system* internal_units,
                 const struct unit_system* snapshot_units);
 #endif
 
@@ -24,8 +24,10 @@
 #if defined(HAVE_HDF5) && !defined(WITH_MPI)
 
 /* Some standard headers. */
+#include <float.h>
 #include <hdf5.h>
 #include <math.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,6 +40,7 @@
 /* Local includes. */
 #include "black_holes_io.h"
 #include "chemistry_io.h"
+#include "clocks.h"
 #include "common_io.h"
 #include "cooling_io.h"
 #include "dimension.h"
@@ -63,6 +66,7 @@
 /**
  * @brief Reads a data array from a given HDF5 group.
  *
+ * @param tp The #threadpool converting the data.
  * @param h_grp The group from which to read.
  * @param prop The #io_props of the field to read
  * @param N The number of particles.
@@ -77,8 +81,8 @@
  * @todo A better version using HDF5 hyper-slabs to read the file directly into
  * the part array will be written once the structures have been stabilized.
  */
-void readArray(hid_t h_grp, const struct io_props props, size_t N,
-               const struct unit_system* internal_units,
+void readArray(struct threadpool* tp, hid_t h_grp, const struct io_props props,
+               size_t N, const struct unit_system* internal_units,
                const struct unit_system* ic_units, int cleanup_h,
                int cleanup_sqrt_a, double h, double a) {
 
@@ -123,89 +127,9 @@ void readArray(hid_t h_grp, const struct io_props props, size_t N,
                               H5S_ALL, H5P_DEFAULT, temp);
   if (h_err < 0) error("Error while reading data array '%s'.", props.name);
 
-  /* Unit conversion if necessary */
-  const double unit_factor =
-      units_conversion_factor(ic_units, internal_units, props.units);
-  if (unit_factor != 1. && exist != 0) {
-
-    /* message("Converting ! factor=%e", factor); */
-
-    if (io_is_double_precision(props.type)) {
-      double* temp_d = (double*)temp;
-      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= unit_factor;
-
-    } else {
-      float* temp_f = (float*)temp;
-
-#ifdef SWIFT_DEBUG_CHECKS
-      float maximum = 0.f;
-      float minimum = FLT_MAX;
-#endif
-
-      /* Loop that converts the Units */
-      for (size_t i = 0; i < num_elements; ++i) {
-
-#ifdef SWIFT_DEBUG_CHECKS
-        /* Find the absolute minimum and maximum values */
-        const float abstemp_f = fabsf(temp_f[i]);
-        if (abstemp_f != 0.f) {
-          maximum = max(maximum, abstemp_f);
-          minimum = min(minimum, abstemp_f);
-        }
-#endif
-
-        /* Convert the float units */
-        temp_f[i] *= unit_factor;
-      }
-
-#ifdef SWIFT_DEBUG_CHECKS
-      /* The two possible errors: larger than float or smaller
-       * than float precision. */
-      if (unit_factor * maximum > FLT_MAX) {
-        error("Unit conversion results in numbers larger than floats");
-      } else if (unit_factor * minimum < FLT_MIN) {
-        error("Numbers smaller than float precision");
-      }
-#endif
-    }
-  }
-
-  /* Clean-up h if necessary */
-  const float h_factor_exp = units_h_factor(internal_units, props.units);
-  if (cleanup_h && h_factor_exp != 0.f && exist != 0) {
-
-    /* message("Multipltying '%s' by h^%f=%f", props.name, h_factor_exp,
-     * h_factor); */
-
-    if (io_is_double_precision(props.type)) {
-      double* temp_d = (double*)temp;
-      const double h_factor = pow(h, h_factor_exp);
-      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= h_factor;
-    } else {
-      float* temp_f = (float*)temp;
-      const float h_factor = pow(h, h_factor_exp);
-      for (size_t i = 0; i < num_elements; ++i) temp_f[i] *= h_factor;
-    }
-  }
-
-  /* Clean-up a if necessary */
-  if (cleanup_sqrt_a && a != 1. && (strcmp(props.name, "Velocities") == 0)) {
-
-    if (io_is_double_precision(props.type)) {
-      double* temp_d = (double*)temp;
-      const double vel_factor = sqrt(a);
-      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= vel_factor;
-    } else {
-      float* temp_f = (float*)temp;
-      const float vel_factor = sqrt(a);
-      for (size_t i = 0; i < num_elements; ++i) temp_f[i] *= vel_factor;
-    }
-  }
-
-  /* Copy temporary buffer to particle data */
-  char* temp_c = (char*)temp;
-  for (size_t i = 0; i < N; ++i)
-    memcpy(props.field + i * props.partSize, &temp_c[i * copySize], copySize);
+  /* Convert and copy the data to the particles using all the threads */
+  io_convert_read_buffer(tp, props, N, temp, internal_units, ic_units,
+                         cleanup_h, cleanup_sqrt_a, h, a);
 
   /* Free and close everything */
   free(temp);
@@ -213,41 +137,30 @@ void readArray(hid_t h_grp, const struct io_props props, size_t N,
 }
 
 /**
- * @brief Writes a data array in given HDF5 group.
+ * @brief Writes a data array that has already been converted to the snapshot
+ * units in a given HDF5 group.
  *
- * @param e The #engine we are writing from.
  * @param grp The group in which to write.
  * @param fileName The name of the file in which the data is written
  * @param xmfFile The FILE used to write the XMF description
  * @param partTypeGroupName The name of the group containing the particles in
  * the HDF5 file.
- * @param props The #io_props of the field to read
+ * @param props The #io_props of the field to write
  * @param N The number of particles to write.
- * @param internal_units The #unit_system used internally
+ * @param h_memspace The HDF5 dataspace of the data in memory (H5S_ALL for a
+ * contiguous buffer).
+ * @param temp The buffer containing the converted data.
+ * @param compression The level of lossless compression to apply.
+ * @param a The scale-factor at which the data is written.
  * @param snapshot_units The #unit_system used in the snapshots
- *
- * @todo A better version using HDF5 hyper-slabs to write the file directly from
- * the part array will be written once the structures have been stabilized.
  */
-void writeArray(const struct engine* e, hid_t grp, char* fileName,
-                FILE* xmfFile, char* partTypeGroupName,
-                const struct io_props props, size_t N,
-                const struct unit_system* internal_units,
-                const struct unit_system* snapshot_units) {
-
-  const size_t typeSize = io_sizeof_type(props.type);
-  const size_t num_elements = N * props.dimension;
-
-  /* message("Writing '%s' array...", props.name); */
-
-  /* Allocate temporary buffer */
-  void* temp = NULL;
-  if (swift_memalign("writebuff", (void**)&temp, IO_BUFFER_ALIGNMENT,
-                     num_elements * typeSize) != 0)
-    error("Unable to allocate temporary i/o buffer");
-
-  /* Copy the particle data to the temporary buffer */
-  io_copy_temp_buffer(temp, e, props, N, internal_units, snapshot_units);
+static void write_array_buffer(hid_t grp, char* fileName, FILE* xmfFile,
+                               char* partTypeGroupName,
+                               const struct io_props props, size_t N,
+                               hid_t h_memspace, const void* temp,
+                               const int compression,
+                               const double a,
+                               const struct unit_system* snapshot_units) {
 
   /* Create data space */
   const hid_t h_space = H5Screate(H5S_SIMPLE);
@@ -280,8 +193,11 @@ void writeArray(const struct engine* e, hid_t grp, char* fileName,
   if (h_err < 0)
     error("Error while changing data space shape for field '%s'.", props.name);
 
+  /* Dataset type */
+  hid_t h_type = H5Tcopy(io_hdf5_type(props.type));
+
   /* Dataset properties */
-  const hid_t h_prop = H5Pcreate(H5P_DATASET_CREATE);
+  hid_t h_prop = H5Pcreate(H5P_DATASET_CREATE);
 
   /* Set chunk size */
   h_err = H5Pset_chunk(h_prop, rank, chunk_shape);
@@ -289,31 +205,35 @@ void writeArray(const struct engine* e, hid_t grp, char* fileName,
     error("Error while setting chunk size (%llu, %llu) for field '%s'.",
           chunk_shape[0], chunk_shape[1], props.name);
 
+  /* Are we imposing some form of lossy compression filter? */
+  set_hdf5_lossy_compression(&h_prop, &h_type, props.lossy_compression,
+                             props.type, props.name);
+
   /* Impose check-sum to verify data corruption */
   h_err = H5Pset_fletcher32(h_prop);
   if (h_err < 0)
     error("Error while setting checksum options for field '%s'.", props.name);
 
   /* Impose data compression */
-  if (e->snapshot_compression > 0) {
+  if (compression > 0) {
     h_err = H5Pset_shuffle(h_prop);
     if (h_err < 0)
       error("Error while setting shuffling options for field '%s'.",
             props.name);
 
-    h_err = H5Pset_deflate(h_prop, e->snapshot_compression);
+    h_err = H5Pset_deflate(h_prop, compression);
     if (h_err < 0)
       error("Error while setting compression options for field '%s'.",
             props.name);
   }
 
   /* Create dataset */
-  const hid_t h_data = H5Dcreate(grp, props.name, io_hdf5_type(props.type),
-                                 h_space, H5P_DEFAULT, h_prop, H5P_DEFAULT);
+  const hid_t h_data = H5Dcreate(grp, props.name, h_type, h_space,
+                                 H5P_DEFAULT, h_prop, H5P_DEFAULT);
   if (h_data < 0) error("Error while creating dataspace '%s'.", props.name);
 
   /* Write temporary buffer to HDF5 dataspace */
-  h_err = H5Dwrite(h_data, io_hdf5_type(props.type), h_space, H5S_ALL,
+  h_err = H5Dwrite(h_data, io_hdf5_type(props.type), h_memspace, H5S_ALL,
                    H5P_DEFAULT, temp);
   if (h_err < 0) error("Error while writing data array '%s'.", props.name);
 
@@ -347,15 +267,71 @@ void writeArray(const struct engine* e, hid_t grp, char* fileName,
   io_write_attribute_d(
       h_data,
       "Conversion factor to phyical CGS (including cosmological corrections)",
-      factor * pow(e->cosmology->a, a_factor_exp));
+      factor * pow(a, a_factor_exp));
 
-  /* Free and close everything */
-  swift_free("writebuff", temp);
+  /* Close everything */
+  H5Tclose(h_type);
   H5Pclose(h_prop);
   H5Dclose(h_data);
   H5Sclose(h_space);
 }
 
+/**
+ * @brief Writes a data array in given HDF5 group.
+ *
+ * @param e The #engine we are writing from.
+ * @param grp The group in which to write.
+ * @param fileName The name of the file in which the data is written
+ * @param xmfFile The FILE used to write the XMF description
+ * @param partTypeGroupName The name of the group containing the particles in
+ * the HDF5 file.
+ * @param props The #io_props of the field to read
+ * @param N The number of particles to write.
+ * @param internal_units The #unit_system used internally
+ * @param snapshot_units The #unit_system used in the snapshots
+ *
+ * Fields that need no conversion are written directly from the particle
+ * arrays. The others are first converted in a temporary buffer.
+ */
+void writeArray(const struct engine* e, hid_t grp, char* fileName,
+                FILE* xmfFile, char* partTypeGroupName,
+                const struct io_props props, size_t N,
+                const struct unit_system* internal_units,
+                const struct unit_system* snapshot_units) {
+
+  const size_t typeSize = io_sizeof_type(props.type);
+  const size_t num_elements = N * props.dimension;
+
+  /* message("Writing '%s' array...", props.name); */
+
+  /* Can we write straight from the particles? */
+  if (io_can_write_in_place(props, internal_units, snapshot_units)) {
+    const hid_t h_memspace = io_make_in_place_memspace(props, N);
+    write_array_buffer(grp, fileName, xmfFile, partTypeGroupName, props, N,
+                       h_memspace, props.field, e->snapshot_compression,
+                       e->cosmology->a, snapshot_units);
+    H5Sclose(h_memspace);
+    return;
+  }
+
+  /* Allocate temporary buffer */
+  void* temp = NULL;
+  if (swift_memalign("writebuff", (void**)&temp, IO_BUFFER_ALIGNMENT,
+                     num_elements * typeSize) != 0)
+    error("Unable to allocate temporary i/o buffer");
+
+  /* Copy the particle data to the temporary buffer */
+  io_copy_temp_buffer(temp, e, props, N, internal_units, snapshot_units);
+
+  /* Write it to the file */
+  write_array_buffer(grp, fileName, xmfFile, partTypeGroupName, props, N,
+                     H5S_ALL, temp, e->snapshot_compression, e->cosmology->a,
+                     snapshot_units);
+
+  /* Free the temporary buffer */
+  swift_free("writebuff", temp);
+}
+
 /**
  * @brief Reads an HDF5 initial condition file (GADGET-3 type)
  *
@@ -570,6 +546,10 @@ void read_ic_single(const char* fileName,
   /* message("BoxSize = %lf", dim[0]); */
   /* message("NumPart = [%zd, %zd] Total = %zd", *Ngas, Ndm, *Ngparts); */
 
+  /* Let's initialise a bit of thread parallelism here */
+  struct threadpool tp;
+  threadpool_init(&tp, n_threads);
+
   /* Loop over all particle types */
   for (int ptype = 0; ptype < swift_type_count; ptype++) {
 
@@ -627,7 +607,7 @@ void read_ic_single(const char* fileName,
     /* Read everything */
     if (!dry_run)
       for (int i = 0; i < num_fields; ++i)
-        readArray(h_grp, list[i], Nparticles, internal_units, ic_units,
+        readArray(&tp, h_grp, list[i], Nparticles, internal_units, ic_units,
                   cleanup_h, cleanup_sqrt_a, h, a);
 
     /* Close particle group */
@@ -637,10 +617,6 @@ void read_ic_single(const char* fileName,
   /* Duplicate the parts for gravity */
   if (!dry_run && with_gravity) {
 
-    /* Let's initialise a bit of thread parallelism here */
-    struct threadpool tp;
-    threadpool_init(&tp, n_threads);
-
     /* Prepare the DM particles */
     io_prepare_dm_gparts(&tp, *gparts, Ndm);
 
@@ -655,10 +631,10 @@ void read_ic_single(const char* fileName,
     if (with_black_holes)
       io_duplicate_black_holes_gparts(&tp, *bparts, *gparts, *Nblackholes,
                                       Ndm + *Ngas + *Nstars);
-
-    threadpool_clean(&tp);
   }
 
+  threadpool_clean(&tp);
+
   /* message("Done Reading particles..."); */
 
   /* Clean up */
@@ -668,6 +644,200 @@ void read_ic_single(const char* fileName,
   H5Fclose(h_file);
 }
 
+/**
+ * @brief A field converted to snapshot units and waiting in a staging buffer
+ * to be written by the asynchronous i/o thread.
+ */
+struct io_staged_field {
+
+  /*! The properties of the field */
+  struct io_props props;
+
+  /*! The converted data */
+  void* buffer;
+};
+
+/**
+ * @brief A particle group waiting to be written by the asynchronous i/o
+ * thread.
+ */
+struct io_staged_group {
+
+  /*! The HDF5 group (created and closed by the i/o thread) */
+  hid_t h_grp;
+
+  /*! The name of the group in the file */
+  char name[PARTICLE_GROUP_BUFFER_SIZE];
+
+  /*! The type of particles in this group */
+  enum part_type ptype;
+
+  /*! The number of particles written */
+  size_t N;
+
+  /*! The fields to write. Only the first num_fields ones have been staged;
+   * protected by the lock of the #io_async_snapshot. */
+  int num_fields;
+  struct io_staged_field fields[100];
+
+  /*! Have all the fields of this group been staged? */
+  int complete;
+};
+
+/**
+ * @brief A snapshot whose data is being staged by the main thread and
+ * written by a dedicated i/o thread at the same time.
+ */
+struct io_async_snapshot {
+
+  /*! The thread writing the data */
+  pthread_t thread;
+
+  /*! Lock and condition protecting the staging progress */
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+
+  /*! The open HDF5 file */
+  hid_t h_file;
+
+  /*! The XMF file to complete */
+  FILE* xmfFile;
+
+  /*! The name of the HDF5 file */
+  char fileName[FILENAME_BUFFER_SIZE];
+
+  /*! The output number and time of that snapshot */
+  int output_count;
+  double time;
+
+  /*! The scale-factor at which the snapshot is taken */
+  double a;
+
+  /*! The lossless compression level */
+  int compression;
+
+  /*! The #unit_system used in the snapshots */
+  const struct unit_system* snapshot_units;
+
+  /*! The particle groups. Only the first num_groups ones have been
+   * published to the i/o thread. */
+  int num_groups;
+  struct io_staged_group groups[swift_type_count];
+
+  /*! Have all the groups been published? */
+  int complete;
+};
+
+/**
+ * @brief Waits until an item past a given count has been staged or until the
+ * staging of the list it belongs to is complete.
+ *
+ * @param snap The #io_async_snapshot.
+ * @param count The number of items published so far (updated under the lock).
+ * @param complete Whether the list is complete (updated under the lock).
+ * @param k The index of the item we want.
+ * @return 1 if item k is available, 0 if the list ended before it.
+ */
+static int io_async_wait_for(struct io_async_snapshot* snap,
+                             const int* count, const int* complete,
+                             const int k) {
+  pthread_mutex_lock(&snap->lock);
+  while (*count <= k && !*complete) pthread_cond_wait(&snap->cond, &snap->lock);
+  const int available = (*count > k);
+  pthread_mutex_unlock(&snap->lock);
+  return available;
+}
+
+/**
+ * @brief Publishes a newly staged item to the i/o thread.
+ *
+ * @param snap The #io_async_snapshot.
+ * @param counter The counter or flag to increment.
+ */
+static void io_async_publish(struct io_async_snapshot* snap, int* counter) {
+  pthread_mutex_lock(&snap->lock);
+  (*counter)++;
+  pthread_cond_signal(&snap->cond);
+  pthread_mutex_unlock(&snap->lock);
+}
+
+/**
+ * @brief Body of the thread writing the staged fields of an asynchronous
+ * snapshot.
+ *
+ * Each field is written as soon as the main thread has staged it, so that
+ * the conversion of the next fields overlaps with the writing of this one.
+ * The main thread does not call any HDF5 function from the moment this thread
+ * is started until it has been joined via write_output_single_wait().
+ *
+ * @param arg The #io_async_snapshot to write.
+ */
+static void* write_output_single_async_thread(void* arg) {
+
+  struct io_async_snapshot* snap = (struct io_async_snapshot*)arg;
+
+  for (int k = 0;
+       io_async_wait_for(snap, &snap->num_groups, &snap->complete, k); ++k) {
+    struct io_staged_group* g = &snap->groups[k];
+
+    xmf_write_groupheader(snap->xmfFile, snap->fileName, g->N, g->ptype);
+
+    /* Open the particle group in the file */
+    g->h_grp = H5Gcreate(snap->h_file, g->name, H5P_DEFAULT, H5P_DEFAULT,
+                         H5P_DEFAULT);
+    if (g->h_grp < 0) error("Error while creating particle group.\n");
+
+    for (int i = 0;
+         io_async_wait_for(snap, &g->num_fields, &g->complete, i); ++i) {
+      write_array_buffer(g->h_grp, snap->fileName, snap->xmfFile, g->name,
+                         g->fields[i].props, g->N, H5S_ALL,
+                         g->fields[i].buffer, snap->compression, snap->a,
+                         snap->snapshot_units);
+
+      swift_free("writebuff", g->fields[i].buffer);
+      g->fields[i].buffer = NULL;
+    }
+
+    H5Gclose(g->h_grp);
+    xmf_write_groupfooter(snap->xmfFile, g->ptype);
+  }
+
+  /* Write LXMF file descriptor */
+  xmf_write_outputfooter(snap->xmfFile, snap->output_count, snap->time);
+
+  /* Close file */
+  H5Fclose(snap->h_file);
+
+  return NULL;
+}
+
+/**
+ * @brief Waits for the asynchronous snapshot currently being written, if
+ * any, to be completed.
+ *
+ * @param e The #engine.
+ */
+void write_output_single_wait(struct engine* e) {
+
+  if (e->snapshot_async == NULL) return;
+
+  const ticks tic = getticks();
+
+  struct io_async_snapshot* snap = e->snapshot_async;
+  if (pthread_join(snap->thread, /*retval=*/NULL) != 0)
+    error("Failed to join the snapshot i/o thread.");
+  pthread_mutex_destroy(&snap->lock);
+  pthread_cond_destroy(&snap->cond);
+
+  if (e->verbose)
+    message("Waited %.3f %s for snapshot '%s' to be completed.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit(),
+            snap->fileName);
+
+  free(snap);
+  e->snapshot_async = NULL;
+}
+
 /**
  * @brief Writes an HDF5 output file (GADGET-3 type) with its XMF descriptor
  *
@@ -681,6 +851,12 @@ void read_ic_single(const char* fileName,
  * by the new one.
  * The companion XMF file is also updated accordingly.
  *
+ * If e->snapshot_asynchronous is set, the fields are only converted to
+ * staging buffers here and the (slow) writing of the datasets is handed to a
+ * dedicated thread, which starts on the first field while the next ones are
+ * being converted. The function then returns before the file is complete;
+ * write_output_single_wait() must be called before any other HDF5 operation.
+ *
  * Calls #error() if an error occurs.
  *
  */
@@ -706,6 +882,17 @@ void write_output_single(struct engine* e, const char* baseName,
   const int with_stf = 0;
 #endif
 
+  /* Make sure a previous asynchronous snapshot is complete */
+  write_output_single_wait(e);
+
+  /* Are we handing the writing to a separate thread? */
+  struct io_async_snapshot* snap = NULL;
+  if (e->snapshot_asynchronous) {
+    snap =
+        (struct io_async_snapshot*)calloc(1, sizeof(struct io_async_snapshot));
+    if (snap == NULL) error("Error allocating asynchronous snapshot data");
+  }
+
   /* Number of particles currently in the arrays */
   const size_t Ntot = e->s->nr_gparts;
   const size_t Ngas = e->s->nr_parts;
@@ -714,19 +901,27 @@ void write_output_single(struct engine* e, const char* baseName,
   // const size_t Nbaryons = Ngas + Nstars;
   // const size_t Ndm = Ntot > 0 ? Ntot - Nbaryons : 0;
 
+  /* Snipshots only keep a subsample of the particles */
+  const int snipshot = e->snapshot_is_snipshot;
+  const float fraction = snipshot ? e->snipshot_subsample_fraction : 1.f;
+  const float threshold = snipshot ? e->snipshot_density_threshold : FLT_MAX;
+
   /* Number of particles that we will write */
   const size_t Ntot_written =
       e->s->nr_gparts - e->s->nr_inhibited_gparts - e->s->nr_extra_gparts;
-  const size_t Ngas_written =
+  size_t Ngas_written =
       e->s->nr_parts - e->s->nr_inhibited_parts - e->s->nr_extra_parts;
-  const size_t Nstars_written =
+  size_t Nstars_written =
       e->s->nr_sparts - e->s->nr_inhibited_sparts - e->s->nr_extra_sparts;
-  const size_t Nblackholes_written =
+  size_t Nblackholes_written =
       e->s->nr_bparts - e->s->nr_inhibited_bparts - e->s->nr_extra_bparts;
   const size_t Nbaryons_written =
       Ngas_written + Nstars_written + Nblackholes_written;
-  const size_t Ndm_written =
-      Ntot_written > 0 ? Ntot_written - Nbaryons_written : 0;
+  size_t Ndm_written = Ntot_written > 0 ? Ntot_written - Nbaryons_written : 0;
+  if (snipshot)
+    io_count_snipshot_particles(e->s, fraction, threshold, &Ngas_written,
+                                &Ndm_written, &Nstars_written,
+                                &Nblackholes_written);
 
   /* Format things in a Gadget-friendly array */
   long long N_total[swift_type_count] = {
@@ -805,6 +1000,10 @@ void write_output_single(struct engine* e, const char* baseName,
   io_write_attribute(h_grp, "Flag_Entropy_ICs", UINT, flagEntropy,
                      swift_type_count);
   io_write_attribute(h_grp, "NumFilesPerSnapshot", INT, &numFiles, 1);
+  if (snipshot) {
+    io_write_attribute_i(h_grp, "Snipshot", 1);
+    io_write_attribute_f(h_grp, "SnipshotSubsampleFraction", fraction);
+  }
 
   /* Close header */
   H5Gclose(h_grp);
@@ -884,16 +1083,21 @@ void write_output_single(struct engine* e, const char* baseName,
   /* Print the system of Units used internally */
   io_write_unit_system(h_file, internal_units, "InternalCodeUnits");
 
-  /* Now write the top-level cell structure */
-  long long global_offsets[swift_type_count] = {0};
-  h_grp = H5Gcreate(h_file, "/Cells", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-  if (h_grp < 0) error("Error while creating cells group");
-
-  /* Write the location of the particles in the arrays */
-  io_write_cell_offsets(h_grp, e->s->cdim, e->s->cells_top, e->s->nr_cells,
-                        e->s->width, e->nodeID, N_total, global_offsets,
-                        internal_units, snapshot_units);
-  H5Gclose(h_grp);
+  /* Now write the top-level cell structure (snipshots have only a subset
+   * of the particles of each cell and are not indexed) */
+  if (!snipshot) {
+    long long global_offsets[swift_type_count] = {0};
+    h_grp =
+        H5Gcreate(h_file, "/Cells", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    if (h_grp < 0) error("Error while creating cells group");
+
+    /* Write the location of the particles in the arrays */
+    io_write_cell_offsets(h_grp, e->s->cdim, e->s->cells_top, e->s->nr_cells,
+                          e->s->cells_top_order, e->s->width, e->nodeID,
+                          N_total, global_offsets, internal_units,
+                          snapshot_units);
+    H5Gclose(h_grp);
+  }
 
   /* Tell the user if a conversion will be needed */
   if (e->verbose) {
@@ -928,6 +1132,24 @@ void write_output_single(struct engine* e, const char* baseName,
     }
   }
 
+  /* Start the i/o thread: from now on, it owns the file */
+  if (snap != NULL) {
+    snap->h_file = h_file;
+    snap->xmfFile = xmfFile;
+    strcpy(snap->fileName, fileName);
+    snap->output_count = e->snapshot_output_count;
+    snap->time = e->time;
+    snap->a = e->cosmology->a;
+    snap->compression = e->snapshot_compression;
+    snap->snapshot_units = snapshot_units;
+
+    pthread_mutex_init(&snap->lock, /*attr=*/NULL);
+    pthread_cond_init(&snap->cond, /*attr=*/NULL);
+    if (pthread_create(&snap->thread, /*attr=*/NULL,
+                       write_output_single_async_thread, snap) != 0)
+      error("Failed to create the snapshot i/o thread.");
+  }
+
   /* Loop over all particle types */
   for (int ptype = 0; ptype < swift_type_count; ptype++) {
 
@@ -935,16 +1157,25 @@ void write_output_single(struct engine* e, const char* baseName,
     if (numParticles[ptype] == 0) continue;
 
     /* Add the global information for that particle type to the XMF meta-file */
-    xmf_write_groupheader(xmfFile, fileName, numParticles[ptype],
-                          (enum part_type)ptype);
+    if (snap == NULL)
+      xmf_write_groupheader(xmfFile, fileName, numParticles[ptype],
+                            (enum part_type)ptype);
 
-    /* Open the particle group in the file */
+    /* Open the particle group in the file (or let the i/o thread do it) */
     char partTypeGroupName[PARTICLE_GROUP_BUFFER_SIZE];
     snprintf(partTypeGroupName, PARTICLE_GROUP_BUFFER_SIZE, "/PartType%d",
              ptype);
-    h_grp = H5Gcreate(h_file, partTypeGroupName, H5P_DEFAULT, H5P_DEFAULT,
-                      H5P_DEFAULT);
-    if (h_grp < 0) error("Error while creating particle group.\n");
+    if (snap == NULL) {
+      h_grp = H5Gcreate(h_file, partTypeGroupName, H5P_DEFAULT, H5P_DEFAULT,
+                        H5P_DEFAULT);
+      if (h_grp < 0) error("Error while creating particle group.\n");
+    } else {
+      struct io_staged_group* g = &snap->groups[snap->num_groups];
+      g->ptype = (enum part_type)ptype;
+      g->N = numParticles[ptype];
+      strcpy(g->name, partTypeGroupName);
+      io_async_publish(snap, &snap->num_groups);
+    }
 
     int num_fields = 0;
     struct io_props list[100];
@@ -966,7 +1197,8 @@ void write_output_single(struct engine* e, const char* baseName,
           /* No inhibted particles: easy case */
           N = Ngas;
           hydro_write_particles(parts, xparts, list, &num_fields);
-          num_fields += chemistry_write_particles(parts, list + num_fields);
+          num_fields +=
+              chemistry_write_particles(parts, xparts, list + num_fields);
           if (with_cooling || with_temperature) {
             num_fields += cooling_write_particles(
                 parts, xparts, list + num_fields, e->cooling_func);
@@ -997,13 +1229,15 @@ void write_output_single(struct engine* e, const char* baseName,
 
           /* Collect the particles we want to write */
           io_collect_parts_to_write(parts, xparts, parts_written,
-                                    xparts_written, Ngas, Ngas_written);
+                                    xparts_written, Ngas, Ngas_written,
+                                    fraction, threshold);
 
           /* Select the fields to write */
           hydro_write_particles(parts_written, xparts_written, list,
                                 &num_fields);
           num_fields +=
-              chemistry_write_particles(parts_written, list + num_fields);
+              chemistry_write_particles(parts_written, xparts_written,
+                                        list + num_fields);
           if (with_cooling || with_temperature) {
             num_fields +=
                 cooling_write_particles(parts_written, xparts_written,
@@ -1054,7 +1288,7 @@ void write_output_single(struct engine* e, const char* baseName,
           /* Collect the non-inhibited DM particles from gpart */
           io_collect_gparts_to_write(gparts, e->s->gpart_group_data,
                                      gparts_written, gpart_group_data_written,
-                                     Ntot, Ndm_written, with_stf);
+                                     Ntot, Ndm_written, with_stf, fraction);
 
           /* Select the fields to write */
           darkmatter_write_particles(gparts_written, list, &num_fields);
@@ -1090,7 +1324,7 @@ void write_output_single(struct engine* e, const char* baseName,
 
           /* Collect the particles we want to write */
           io_collect_sparts_to_write(sparts, sparts_written, Nstars,
-                                     Nstars_written);
+                                     Nstars_written, fraction);
 
           /* Select the fields to write */
           stars_write_particles(sparts_written, list, &num_fields);
@@ -1127,7 +1361,7 @@ void write_output_single(struct engine* e, const char* baseName,
 
           /* Collect the particles we want to write */
           io_collect_bparts_to_write(bparts, bparts_written, Nblackholes,
-                                     Nblackholes_written);
+                                     Nblackholes_written, fraction);
 
           /* Select the fields to write */
           black_holes_write_particles(bparts_written, list, &num_fields);
@@ -1145,15 +1379,31 @@ void write_output_single(struct engine* e, const char* baseName,
     /* Write everything that is not cancelled */
     for (int i = 0; i < num_fields; ++i) {
 
-      /* Did the user cancel this field? */
-      char field[PARSER_MAX_LINE_SIZE];
-      sprintf(field, "SelectOutput:%s_%s", list[i].name,
-              part_type_names[ptype]);
-      int should_write = parser_get_opt_param_int(params, field, 1);
+      /* Did the user cancel this field or ask for a lossy filter? */
+      list[i].lossy_compression = io_get_field_compression(
+          params, list[i].name, part_type_names[ptype],
+          list[i].lossy_compression, snipshot);
+
+      if (list[i].lossy_compression == compression_do_not_write) continue;
 
-      if (should_write)
+      if (snap == NULL) {
         writeArray(e, h_grp, fileName, xmfFile, partTypeGroupName, list[i], N,
                    internal_units, snapshot_units);
+      } else {
+
+        /* Convert the field to a staging buffer to be written later */
+        struct io_staged_group* g = &snap->groups[snap->num_groups - 1];
+        struct io_staged_field* f = &g->fields[g->num_fields];
+        const size_t size =
+            N * list[i].dimension * io_sizeof_type(list[i].type);
+        if (swift_memalign("writebuff", &f->buffer, IO_BUFFER_ALIGNMENT,
+                           size) != 0)
+          error("Unable to allocate staging i/o buffer");
+        io_copy_temp_buffer(f->buffer, e, list[i], N, internal_units,
+                            snapshot_units);
+        f->props = list[i];
+        io_async_publish(snap, &g->num_fields);
+      }
     }
 
     /* Free temporary arrays */
@@ -1165,20 +1415,37 @@ void write_output_single(struct engine* e, const char* baseName,
     if (sparts_written) swift_free("sparts_written", sparts_written);
     if (bparts_written) swift_free("bparts_written", bparts_written);
 
-    /* Close particle group */
-    H5Gclose(h_grp);
+    if (snap == NULL) {
+
+      /* Close particle group */
+      H5Gclose(h_grp);
 
-    /* Close this particle group in the XMF file as well */
-    xmf_write_groupfooter(xmfFile, (enum part_type)ptype);
+      /* Close this particle group in the XMF file as well */
+      xmf_write_groupfooter(xmfFile, (enum part_type)ptype);
+
+    } else {
+
+      /* No more fields for this group */
+      io_async_publish(snap, &snap->groups[snap->num_groups - 1].complete);
+    }
   }
 
-  /* Write LXMF file descriptor */
-  xmf_write_outputfooter(xmfFile, e->snapshot_output_count, e->time);
+  if (snap == NULL) {
 
-  /* message("Done writing particles..."); */
+    /* Write LXMF file descriptor */
+    xmf_write_outputfooter(xmfFile, e->snapshot_output_count, e->time);
 
-  /* Close file */
-  H5Fclose(h_file);
+    /* message("Done writing particles..."); */
+
+    /* Close file */
+    H5Fclose(h_file);
+
+  } else {
+
+    /* No more groups: the i/o thread finishes the file on its own */
+    io_async_publish(snap, &snap->complete);
+    e->snapshot_async = snap;
+  }
 
   e->snapshot_output_count++;
 }
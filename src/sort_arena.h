@@ -0,0 +1,185 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_SORT_ARENA_H
+#define SWIFT_SORT_ARENA_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <stddef.h>
+
+/* Local headers */
+#include "error.h"
+#include "inline.h"
+#include "memuse.h"
+#include "sort_part.h"
+
+/*! Minimal number of #entry in a chunk of a #sort_arena */
+#define sort_arena_min_chunk_size (1 << 16)
+
+/**
+ * @brief A chunk of memory from which the sort arrays are carved.
+ */
+struct sort_arena_chunk {
+
+  /*! The previous chunk of the arena */
+  struct sort_arena_chunk *next;
+
+  /*! Number of #entry in this chunk */
+  size_t size;
+
+  /*! Number of #entry already handed out */
+  size_t used;
+
+  /*! The entries themselves */
+  struct entry data[];
+};
+
+/**
+ * @brief A bump allocator for the sort arrays of the cells.
+ *
+ * Every #runner owns one such arena, so no locking is required. The arrays are
+ * never freed individually: the cells simply drop their pointers and the whole
+ * arena is emptied at once when the tree is rebuilt (sort_arena_reset()).
+ * Once the arena has grown to the size needed between two rebuilds, there are
+ * then no allocations at all for the sorts.
+ */
+struct sort_arena {
+
+  /*! The chunk we are currently allocating from (NULL if none) */
+  struct sort_arena_chunk *chunks;
+
+  /*! Total number of #entry in all the chunks */
+  size_t capacity;
+
+  /*! Total number of #entry handed out since the last reset */
+  size_t used;
+};
+
+/**
+ * @brief Adds a new chunk to a #sort_arena.
+ *
+ * @param a The #sort_arena.
+ * @param size The minimal number of #entry in the chunk.
+ */
+static INLINE void sort_arena_grow(struct sort_arena *a, size_t size) {
+
+  /* Grow geometrically to keep the number of chunks small */
+  if (size < a->capacity) size = a->capacity;
+  if (size < sort_arena_min_chunk_size) size = sort_arena_min_chunk_size;
+
+  const size_t bytes =
+      sizeof(struct sort_arena_chunk) + size * sizeof(struct entry);
+  struct sort_arena_chunk *chunk =
+      (struct sort_arena_chunk *)swift_malloc("sort_arena", bytes);
+  if (chunk == NULL) error("Failed to allocate sort arena memory.");
+
+  chunk->next = a->chunks;
+  chunk->size = size;
+  chunk->used = 0;
+  a->chunks = chunk;
+  a->capacity += size;
+}
+
+/**
+ * @brief Gets an array of #entry from a #sort_arena.
+ *
+ * @param a The #sort_arena.
+ * @param count The number of #entry required.
+ */
+__attribute__((always_inline)) INLINE static struct entry *sort_arena_alloc(
+    struct sort_arena *a, const size_t count) {
+
+  if (a->chunks == NULL || a->chunks->used + count > a->chunks->size)
+    sort_arena_grow(a, count);
+
+  struct sort_arena_chunk *chunk = a->chunks;
+  struct entry *ptr = &chunk->data[chunk->used];
+  chunk->used += count;
+  a->used += count;
+  return ptr;
+}
+
+/**
+ * @brief Gives the last array obtained from a #sort_arena back to it.
+ *
+ * Used for scratch space that is not needed beyond the current sort.
+ *
+ * @param a The #sort_arena.
+ * @param ptr The array returned by the last call to sort_arena_alloc().
+ * @param count The number of #entry in that array.
+ */
+__attribute__((always_inline)) INLINE static void sort_arena_pop(
+    struct sort_arena *a, const struct entry *ptr, const size_t count) {
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (a->chunks == NULL || a->chunks->used < count ||
+      ptr != &a->chunks->data[a->chunks->used - count])
+    error("Not the last array handed out by the arena.");
+#endif
+
+  a->chunks->used -= count;
+  a->used -= count;
+}
+
+/**
+ * @brief Empties a #sort_arena.
+ *
+ * If the arena had to grow since the last reset, the chunks are merged into a
+ * single one large enough for all of them.
+ *
+ * All the pointers handed out since the last reset become invalid.
+ *
+ * @param a The #sort_arena.
+ */
+static INLINE void sort_arena_reset(struct sort_arena *a) {
+
+  if (a->chunks != NULL && a->chunks->next != NULL) {
+    const size_t capacity = a->capacity;
+    while (a->chunks != NULL) {
+      struct sort_arena_chunk *next = a->chunks->next;
+      swift_free("sort_arena", a->chunks);
+      a->chunks = next;
+    }
+    a->capacity = 0;
+    sort_arena_grow(a, capacity);
+  } else if (a->chunks != NULL) {
+    a->chunks->used = 0;
+  }
+  a->used = 0;
+}
+
+/**
+ * @brief Frees all the memory of a #sort_arena.
+ *
+ * @param a The #sort_arena.
+ */
+static INLINE void sort_arena_clean(struct sort_arena *a) {
+
+  while (a->chunks != NULL) {
+    struct sort_arena_chunk *next = a->chunks->next;
+    swift_free("sort_arena", a->chunks);
+    a->chunks = next;
+  }
+  a->capacity = 0;
+  a->used = 0;
+}
+
+#endif /* SWIFT_SORT_ARENA_H */
@@ -20,6 +20,19 @@
 #ifndef SWIFT_SORT_PART_H
 #define SWIFT_SORT_PART_H
 
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <stdint.h>
+#include <string.h>
+
+/* Local headers. */
+#include "inline.h"
+
+/*! Below this number of entries, arrays are sorted with a quicksort */
+#define sort_radix_threshold 128
+
 /**
  * @brief Entry in a list of sorted indices.
  */
@@ -129,4 +142,187 @@ __attribute__((always_inline)) INLINE static int sort_is_face(int sid) {
   return (sid == 4 || sid == 10 || sid == 12);
 }
 
+/**
+ * @brief Sorts an array of #entry in ascending order of their distance using
+ * a quicksort, finishing small partitions with a selection sort.
+ *
+ * @param sort The array of #entry to sort.
+ * @param N The number of elements in the array.
+ */
+INLINE static void sort_entries_quicksort(struct entry *sort, const int N) {
+
+  struct {
+    int lo, hi;
+  } qstack[64];
+  int qpos, i, j, lo, hi, imin;
+  struct entry temp;
+  float pivot;
+
+  /* Nothing to do here. */
+  if (N < 2) return;
+
+  /* Sort the entries in increasing order with quicksort */
+  qstack[0].lo = 0;
+  qstack[0].hi = N - 1;
+  qpos = 0;
+  while (qpos >= 0) {
+    lo = qstack[qpos].lo;
+    hi = qstack[qpos].hi;
+    qpos -= 1;
+    if (hi - lo < 15) {
+      for (i = lo; i < hi; i++) {
+        imin = i;
+        for (j = i + 1; j <= hi; j++)
+          if (sort[j].d < sort[imin].d) imin = j;
+        if (imin != i) {
+          temp = sort[imin];
+          sort[imin] = sort[i];
+          sort[i] = temp;
+        }
+      }
+    } else {
+      pivot = sort[(lo + hi) / 2].d;
+      i = lo;
+      j = hi;
+      while (i <= j) {
+        while (sort[i].d < pivot) i++;
+        while (sort[j].d > pivot) j--;
+        if (i <= j) {
+          if (i < j) {
+            temp = sort[i];
+            sort[i] = sort[j];
+            sort[j] = temp;
+          }
+          i += 1;
+          j -= 1;
+        }
+      }
+      if (j > (lo + hi) / 2) {
+        if (lo < j) {
+          qpos += 1;
+          qstack[qpos].lo = lo;
+          qstack[qpos].hi = j;
+        }
+        if (i < hi) {
+          qpos += 1;
+          qstack[qpos].lo = i;
+          qstack[qpos].hi = hi;
+        }
+      } else {
+        if (i < hi) {
+          qpos += 1;
+          qstack[qpos].lo = i;
+          qstack[qpos].hi = hi;
+        }
+        if (lo < j) {
+          qpos += 1;
+          qstack[qpos].lo = lo;
+          qstack[qpos].hi = j;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Maps the bits of a float onto an unsigned integer with the same
+ * ordering.
+ *
+ * @param d The float to convert.
+ */
+__attribute__((always_inline)) INLINE static uint32_t sort_radix_key(
+    const float d) {
+
+  uint32_t u;
+  memcpy(&u, &d, sizeof(uint32_t));
+
+  /* Flip all the bits of negative numbers, only the sign of positive ones */
+  return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+
+/**
+ * @brief Sorts an array of #entry in ascending order of their distance using
+ * a least-significant-digit radix sort on the bits of the floats.
+ *
+ * The keys are processed in four passes of 8 bits. Passes for which all the
+ * entries have the same digit (e.g. the exponent bits of a small cell) are
+ * skipped.
+ *
+ * @param sort The array of #entry to sort.
+ * @param buff A scratch array of at least N #entry.
+ * @param N The number of elements in the array.
+ */
+INLINE static void sort_entries_radix(struct entry *restrict sort,
+                                      struct entry *restrict buff,
+                                      const int N) {
+
+  /* Nothing to do here. */
+  if (N < 2) return;
+
+  /* Build the histograms of the four digits in one go */
+  int hist[4][256];
+  memset(hist, 0, sizeof(hist));
+  for (int k = 0; k < N; k++) {
+    const uint32_t key = sort_radix_key(sort[k].d);
+    hist[0][key & 0xFF]++;
+    hist[1][(key >> 8) & 0xFF]++;
+    hist[2][(key >> 16) & 0xFF]++;
+    hist[3][key >> 24]++;
+  }
+
+  struct entry *restrict in = sort;
+  struct entry *restrict out = buff;
+  for (int pass = 0; pass < 4; pass++) {
+
+    const int shift = 8 * pass;
+    int *restrict h = hist[pass];
+
+    /* Skip the pass if all the entries land in the same bucket */
+    if (h[(sort_radix_key(in[0].d) >> shift) & 0xFF] == N) continue;
+
+    /* Turn the histogram into offsets */
+    int offset = 0;
+    for (int b = 0; b < 256; b++) {
+      const int count = h[b];
+      h[b] = offset;
+      offset += count;
+    }
+
+    /* Scatter the entries */
+    for (int k = 0; k < N; k++) {
+      const uint32_t digit = (sort_radix_key(in[k].d) >> shift) & 0xFF;
+      out[h[digit]++] = in[k];
+    }
+
+    /* Swap the arrays */
+    struct entry *temp = in;
+    in = out;
+    out = temp;
+  }
+
+  /* Did we end up in the scratch array? */
+  if (in != sort) memcpy(sort, in, N * sizeof(struct entry));
+}
+
+/**
+ * @brief Sorts an array of #entry in ascending order of their distance.
+ *
+ * Small arrays are sorted in-place with a quicksort, larger ones with a radix
+ * sort.
+ *
+ * @param sort The array of #entry to sort.
+ * @param buff A scratch array of at least N #entry. Only used if N is at least
+ * #sort_radix_threshold.
+ * @param N The number of elements in the array.
+ */
+INLINE static void sort_entries_ascending(struct entry *restrict sort,
+                                          struct entry *restrict buff,
+                                          const int N) {
+
+  if (N < sort_radix_threshold)
+    sort_entries_quicksort(sort, N);
+  else
+    sort_entries_radix(sort, buff, N);
+}
+
 #endif /* SWIFT_SORT_PART_H */
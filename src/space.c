@@ -30,12 +30,19 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /* MPI headers. */
 #ifdef WITH_MPI
 #include <mpi.h>
 #endif
 
+/* NUMA headers. */
+#if defined(HAVE_LIBNUMA) && defined(_GNU_SOURCE)
+#include <numa.h>
+#include <numaif.h>
+#endif
+
 /* This object's header. */
 #include "space.h"
 
@@ -48,6 +55,7 @@
 #include "debug.h"
 #include "engine.h"
 #include "error.h"
+#include "feedback.h"
 #include "gravity.h"
 #include "hydro.h"
 #include "kernel_hydro.h"
@@ -69,6 +77,7 @@
 int space_splitsize = space_splitsize_default;
 int space_subsize_pair_hydro = space_subsize_pair_hydro_default;
 int space_subsize_self_hydro = space_subsize_self_hydro_default;
+int space_nosort_pair_hydro = space_nosort_pair_hydro_default;
 int space_subsize_pair_grav = space_subsize_pair_grav_default;
 int space_subsize_self_grav = space_subsize_self_grav_default;
 int space_subdepth_diff_grav = space_subdepth_diff_grav_default;
@@ -80,6 +89,10 @@ int space_extra_parts = space_extra_parts_default;
 /*! Number of extra #spart we allocate memory for per top-level cell */
 int space_extra_sparts = space_extra_sparts_default;
 
+/*! Number of extra #spart per top-level cell we can grow up to when the
+ * cells run low on them */
+int space_extra_sparts_max = space_extra_sparts_default;
+
 /*! Number of extra #bpart we allocate memory for per top-level cell */
 int space_extra_bparts = space_extra_bparts_default;
 
@@ -177,121 +190,117 @@ void space_rebuild_recycle_rec(struct space *s, struct cell *c,
       }
 }
 
-void space_rebuild_recycle_mapper(void *map_data, int num_elements,
-                                  void *extra_data) {
+/**
+ * @brief Recycle all the progeny of a #cell and turn it into a leaf.
+ *
+ * @param s The #space.
+ * @param c The #cell.
+ */
+void space_recycle_progeny(struct space *s, struct cell *c) {
+
+  struct cell *cell_rec_begin = NULL, *cell_rec_end = NULL;
+  struct gravity_tensors *multipole_rec_begin = NULL, *multipole_rec_end = NULL;
+  space_rebuild_recycle_rec(s, c, &cell_rec_begin, &cell_rec_end,
+                            &multipole_rec_begin, &multipole_rec_end);
+  if (cell_rec_begin != NULL)
+    space_recycle_list(s, cell_rec_begin, cell_rec_end, multipole_rec_begin,
+                       multipole_rec_end);
+  c->split = 0;
+}
 
-  struct space *s = (struct space *)extra_data;
-  struct cell *cells = (struct cell *)map_data;
+/**
+ * @brief Reset a top-level #cell before a rebuild.
+ *
+ * @param s The #space.
+ * @param c The top-level #cell.
+ * @param keep_tree Do we keep the progeny and the task pointers? (see
+ * space_reset_cells())
+ */
+static void space_reset_top_cell(struct space *s, struct cell *c,
+                                 const int keep_tree) {
 
-  for (int k = 0; k < num_elements; k++) {
-    struct cell *c = &cells[k];
-    struct cell *cell_rec_begin = NULL, *cell_rec_end = NULL;
-    struct gravity_tensors *multipole_rec_begin = NULL,
-                           *multipole_rec_end = NULL;
-    space_rebuild_recycle_rec(s, c, &cell_rec_begin, &cell_rec_end,
-                              &multipole_rec_begin, &multipole_rec_end);
-    if (cell_rec_begin != NULL)
-      space_recycle_list(s, cell_rec_begin, cell_rec_end, multipole_rec_begin,
-                         multipole_rec_end);
-    c->hydro.sorts = NULL;
-    c->stars.sorts = NULL;
-    c->nr_tasks = 0;
-    c->grav.nr_mm_tasks = 0;
-    c->hydro.density = NULL;
-    c->hydro.gradient = NULL;
-    c->hydro.force = NULL;
-    c->hydro.limiter = NULL;
-    c->grav.grav = NULL;
-    c->grav.mm = NULL;
-    c->hydro.dx_max_part = 0.0f;
-    c->hydro.dx_max_sort = 0.0f;
-    c->stars.dx_max_part = 0.f;
-    c->stars.dx_max_sort = 0.f;
-    c->black_holes.dx_max_part = 0.f;
-    c->hydro.sorted = 0;
-    c->stars.sorted = 0;
-    c->hydro.count = 0;
-    c->hydro.count_total = 0;
-    c->hydro.updated = 0;
-    c->hydro.inhibited = 0;
-    c->grav.count = 0;
-    c->grav.count_total = 0;
-    c->grav.updated = 0;
-    c->grav.inhibited = 0;
-    c->stars.count = 0;
-    c->stars.count_total = 0;
-    c->stars.updated = 0;
-    c->stars.inhibited = 0;
-    c->black_holes.count = 0;
-    c->black_holes.count_total = 0;
-    c->black_holes.updated = 0;
-    c->black_holes.inhibited = 0;
-    c->grav.init = NULL;
-    c->grav.init_out = NULL;
-    c->hydro.extra_ghost = NULL;
-    c->hydro.ghost_in = NULL;
-    c->hydro.ghost_out = NULL;
-    c->hydro.ghost = NULL;
-    c->stars.ghost = NULL;
-    c->stars.density = NULL;
-    c->stars.feedback = NULL;
-    c->black_holes.ghost = NULL;
-    c->black_holes.density = NULL;
-    c->black_holes.feedback = NULL;
-    c->kick1 = NULL;
-    c->kick2 = NULL;
-    c->timestep = NULL;
-    c->timestep_limiter = NULL;
-    c->hydro.end_force = NULL;
-    c->hydro.drift = NULL;
-    c->stars.drift = NULL;
-    c->stars.stars_in = NULL;
-    c->stars.stars_out = NULL;
-    c->black_holes.drift = NULL;
-    c->black_holes.black_holes_in = NULL;
-    c->black_holes.black_holes_out = NULL;
-    c->grav.drift = NULL;
-    c->grav.drift_out = NULL;
-    c->hydro.cooling = NULL;
-    c->grav.long_range = NULL;
-    c->grav.down_in = NULL;
-    c->grav.down = NULL;
-    c->grav.mesh = NULL;
-    c->grav.end_force = NULL;
-    c->top = c;
+  if (!keep_tree) {
+    space_recycle_progeny(s, c);
+    cell_clean_task_pointers(c, NULL);
     c->super = c;
     c->hydro.super = c;
     c->grav.super = c;
-    c->hydro.parts = NULL;
-    c->hydro.xparts = NULL;
-    c->grav.parts = NULL;
-    c->stars.parts = NULL;
-    c->stars.parts_rebuild = NULL;
-    c->black_holes.parts = NULL;
-    c->flags = 0;
-    c->hydro.ti_end_min = -1;
-    c->hydro.ti_end_max = -1;
-    c->grav.ti_end_min = -1;
-    c->grav.ti_end_max = -1;
-    c->stars.ti_end_min = -1;
-    c->stars.ti_end_max = -1;
-    c->black_holes.ti_end_min = -1;
-    c->black_holes.ti_end_max = -1;
-    star_formation_logger_init(&c->stars.sfh);
-#if defined(SWIFT_DEBUG_CHECKS) || defined(SWIFT_CELL_GRAPH)
-    c->cellID = 0;
-#endif
-    if (s->with_self_gravity)
-      bzero(c->grav.multipole, sizeof(struct gravity_tensors));
-
-    cell_free_hydro_sorts(c);
-    cell_free_stars_sorts(c);
 #if WITH_MPI
     c->mpi.tag = -1;
-    c->mpi.recv = NULL;
-    c->mpi.send = NULL;
 #endif
   }
+  c->hydro.dx_max_part = 0.0f;
+  c->hydro.dx_max_sort = 0.0f;
+  c->stars.dx_max_part = 0.f;
+  c->stars.dx_max_sort = 0.f;
+  c->black_holes.dx_max_part = 0.f;
+  c->hydro.sorted = 0;
+  c->stars.sorted = 0;
+  cell_free_hydro_sorts(c);
+  cell_free_stars_sorts(c);
+  c->hydro.count = 0;
+  c->hydro.count_total = 0;
+  c->hydro.updated = 0;
+  c->hydro.inhibited = 0;
+  c->grav.count = 0;
+  c->grav.count_total = 0;
+  c->grav.updated = 0;
+  c->grav.inhibited = 0;
+  c->stars.count = 0;
+  c->stars.count_total = 0;
+  c->stars.updated = 0;
+  c->stars.inhibited = 0;
+  c->black_holes.count = 0;
+  c->black_holes.count_total = 0;
+  c->black_holes.updated = 0;
+  c->black_holes.inhibited = 0;
+  c->top = c;
+  c->hydro.parts = NULL;
+  c->hydro.xparts = NULL;
+  c->grav.parts = NULL;
+  c->stars.parts = NULL;
+  c->stars.parts_rebuild = NULL;
+  c->black_holes.parts = NULL;
+  c->flags = 0;
+  c->hydro.ti_end_min = -1;
+  c->hydro.ti_end_max = -1;
+  c->grav.ti_end_min = -1;
+  c->grav.ti_end_max = -1;
+  c->stars.ti_end_min = -1;
+  c->stars.ti_end_max = -1;
+  c->black_holes.ti_end_min = -1;
+  c->black_holes.ti_end_max = -1;
+  star_formation_logger_init(&c->stars.sfh);
+#if defined(SWIFT_DEBUG_CHECKS) || defined(SWIFT_CELL_GRAPH)
+  c->cellID = 0;
+#endif
+  if (s->with_self_gravity)
+    bzero(c->grav.multipole, sizeof(struct gravity_tensors));
+
+  cell_free_hydro_sorts(c);
+  cell_free_hydro_bins(c);
+  cell_free_hydro_soa(c);
+  cell_free_stars_sorts(c);
+}
+
+void space_rebuild_recycle_mapper(void *map_data, int num_elements,
+                                  void *extra_data) {
+
+  struct space *s = (struct space *)extra_data;
+  struct cell *cells = (struct cell *)map_data;
+
+  for (int k = 0; k < num_elements; k++)
+    space_reset_top_cell(s, &cells[k], /*keep_tree=*/0);
+}
+
+void space_reset_cells_mapper(void *map_data, int num_elements,
+                              void *extra_data) {
+
+  struct space *s = (struct space *)extra_data;
+  struct cell *cells = (struct cell *)map_data;
+
+  for (int k = 0; k < num_elements; k++)
+    space_reset_top_cell(s, &cells[k], /*keep_tree=*/1);
 }
 
 /**
@@ -307,6 +316,77 @@ void space_free_cells(struct space *s) {
                  s->nr_cells, sizeof(struct cell), 0, s);
   s->maxdepth = 0;
 
+  /* Any task graph made for the old tree is now invalid. */
+  s->tree_generation++;
+
+  if (s->e->verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+}
+
+/**
+ * @brief Reset the top-level cells but keep the sub-cells and the task
+ * pointers.
+ *
+ * The tree is then re-used by space_split_recursive() such that, when the
+ * new tree has the same structure, the cells keep their addresses and the
+ * task graph of the previous rebuild is still valid.
+ *
+ * @param s The #space.
+ */
+void space_reset_cells(struct space *s) {
+
+  ticks tic = getticks();
+
+  threadpool_map(&s->e->threadpool, space_reset_cells_mapper, s->cells_top,
+                 s->nr_cells, sizeof(struct cell), 0, s);
+  s->maxdepth = 0;
+
+  if (s->e->verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+}
+
+/**
+ * @brief Recursively clear the task pointers of a cell tree.
+ *
+ * @param c The #cell.
+ */
+static void space_clean_task_pointers_rec(struct cell *c) {
+
+  cell_clean_task_pointers(c, NULL);
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL) {
+        c->progeny[k]->super = NULL;
+        c->progeny[k]->hydro.super = NULL;
+        c->progeny[k]->grav.super = NULL;
+        space_clean_task_pointers_rec(c->progeny[k]);
+      }
+}
+
+void space_clean_task_pointers_mapper(void *map_data, int num_elements,
+                                      void *extra_data) {
+
+  struct cell *cells = (struct cell *)map_data;
+
+  for (int k = 0; k < num_elements; k++)
+    space_clean_task_pointers_rec(&cells[k]);
+}
+
+/**
+ * @brief Clear the task pointers of all the cells kept by
+ * space_reset_cells() such that new tasks can be made for them.
+ *
+ * @param s The #space.
+ */
+void space_clean_task_pointers(struct space *s) {
+
+  ticks tic = getticks();
+
+  threadpool_map(&s->e->threadpool, space_clean_task_pointers_mapper,
+                 s->cells_top, s->nr_cells, sizeof(struct cell), 0, NULL);
+
   if (s->e->verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
@@ -343,6 +423,225 @@ void space_free_foreign_parts(struct space *s) {
 #endif
 }
 
+/**
+ * @brief Position of a top-level cell along the Morton curve.
+ *
+ * @param i The index of the cell along x.
+ * @param j The index of the cell along y.
+ * @param k The index of the cell along z.
+ */
+static unsigned long long space_morton_key(const int i, const int j,
+                                           const int k) {
+
+  unsigned long long key = 0;
+  for (int b = 0; b < 21; b++)
+    key |= ((((unsigned long long)i >> b) & 1ULL) << (3 * b + 2)) |
+           ((((unsigned long long)j >> b) & 1ULL) << (3 * b + 1)) |
+           ((((unsigned long long)k >> b) & 1ULL) << (3 * b));
+  return key;
+}
+
+/**
+ * @brief Sort function for pairs of Morton keys and cell indices.
+ */
+static int space_morton_compare(const void *a, const void *b) {
+
+  const unsigned long long ka = ((const unsigned long long *)a)[0];
+  const unsigned long long kb = ((const unsigned long long *)b)[0];
+  return (ka > kb) - (ka < kb);
+}
+
+/**
+ * @brief Allocate the tuning state of the top-level cells, with all the
+ * split and sub-task sizes at their nominal values.
+ *
+ * @param s The #space.
+ */
+static void space_split_tuning_init(struct space *s) {
+
+  s->split_tuning = (struct space_split_tuning *)swift_malloc(
+      "split_tuning", s->nr_cells * sizeof(struct space_split_tuning));
+  if (s->split_tuning == NULL)
+    error("Failed to allocate the tuning state of the top-level cells.");
+  bzero(s->split_tuning, s->nr_cells * sizeof(struct space_split_tuning));
+  for (int k = 0; k < s->nr_cells; k++) {
+    s->split_tuning[k].factor = 1.f;
+    s->split_tuning[k].direction = 1.f;
+  }
+}
+
+/**
+ * @brief Order the top-level cells along a Morton curve.
+ *
+ * The particles are then stored in this order by space_rebuild(), such that
+ * neighbouring cells are also close in memory.
+ *
+ * @param s The #space.
+ */
+static void space_make_cells_top_order(struct space *s) {
+
+  const int *cdim = s->cdim;
+  unsigned long long *keys =
+      (unsigned long long *)malloc(2 * s->nr_cells * sizeof(*keys));
+  if (swift_memalign("cells_top_order", (void **)&s->cells_top_order,
+                     SWIFT_STRUCT_ALIGNMENT, s->nr_cells * sizeof(int)) != 0 ||
+      swift_memalign("cells_top_order", (void **)&s->cells_top_rank,
+                     SWIFT_STRUCT_ALIGNMENT, s->nr_cells * sizeof(int)) != 0 ||
+      keys == NULL)
+    error("Failed to allocate the order of the top-level cells.");
+
+  for (int i = 0; i < cdim[0]; i++)
+    for (int j = 0; j < cdim[1]; j++)
+      for (int k = 0; k < cdim[2]; k++) {
+        const int cid = cell_getid(cdim, i, j, k);
+        keys[2 * cid] = space_morton_key(i, j, k);
+        keys[2 * cid + 1] = cid;
+      }
+  qsort(keys, s->nr_cells, 2 * sizeof(*keys), space_morton_compare);
+
+  for (int k = 0; k < s->nr_cells; k++) {
+    s->cells_top_order[k] = (int)keys[2 * k + 1];
+    s->cells_top_rank[s->cells_top_order[k]] = k;
+  }
+  free(keys);
+}
+
+/**
+ * @brief Replace the top-level cell indices of the particles to sort by the
+ * position of their cell in the storage order of the cells.
+ *
+ * @param s The #space.
+ * @param ind The indices of the particles' cells.
+ * @param counts The number of particles in each cell, re-ordered as well.
+ * @param N The number of particles.
+ */
+static void space_cell_indices_to_ranks(const struct space *s, int *ind,
+                                        int *counts, const size_t N) {
+
+  const int *rank = s->cells_top_rank;
+  for (size_t k = 0; k < N; k++) ind[k] = rank[ind[k]];
+
+  int *temp = (int *)malloc(s->nr_cells * sizeof(int));
+  if (temp == NULL) error("Failed to allocate temporary cell counts.");
+  for (int k = 0; k < s->nr_cells; k++) temp[rank[k]] = counts[k];
+  memcpy(counts, temp, s->nr_cells * sizeof(int));
+  free(temp);
+}
+
+/**
+ * @brief Undo space_cell_indices_to_ranks() once the particles are sorted.
+ *
+ * @param s The #space.
+ * @param ind The positions of the particles' cells in the storage order.
+ * @param N The number of particles.
+ */
+static void space_cell_ranks_to_indices(const struct space *s, int *ind,
+                                        const size_t N) {
+
+  const int *order = s->cells_top_order;
+  for (size_t k = 0; k < N; k++) ind[k] = order[ind[k]];
+}
+
+/**
+ * @brief #threadpool mapper function initialising some newly allocated
+ * top-level cells and their multipoles.
+ *
+ * @param map_data Pointer towards the top-level cells.
+ * @param num_cells The number of cells to treat.
+ * @param extra_data Pointer to the #space.
+ */
+void space_regrid_init_cells_mapper(void *map_data, int num_cells,
+                                    void *extra_data) {
+
+  struct space *s = (struct space *)extra_data;
+  struct cell *cells = (struct cell *)map_data;
+  const int *cdim = s->cdim;
+  const int first = cells - s->cells_top;
+  const float dmin = min3(s->width[0], s->width[1], s->width[2]);
+  const integertime_t ti_current = (s->e != NULL) ? s->e->ti_current : 0;
+
+  /* Clear the cells and their multipoles. */
+  bzero(cells, num_cells * sizeof(struct cell));
+  if (s->with_self_gravity)
+    bzero(&s->multipoles_top[first],
+          num_cells * sizeof(struct gravity_tensors));
+
+  for (int ind = 0; ind < num_cells; ind++) {
+    const int cid = first + ind;
+    const int i = cid / (cdim[1] * cdim[2]);
+    const int j = (cid / cdim[2]) % cdim[1];
+    const int k = cid % cdim[2];
+    struct cell *restrict c = &cells[ind];
+
+    /* Set the cell's locks */
+    if (lock_init(&c->hydro.lock) != 0)
+      error("Failed to init spinlock for hydro.");
+    if (lock_init(&c->grav.plock) != 0)
+      error("Failed to init spinlock for gravity.");
+    if (lock_init(&c->grav.mlock) != 0)
+      error("Failed to init spinlock for multipoles.");
+    if (lock_init(&c->stars.lock) != 0)
+      error("Failed to init spinlock for stars.");
+    if (lock_init(&c->black_holes.lock) != 0)
+      error("Failed to init spinlock for black holes.");
+    if (lock_init(&c->stars.star_formation_lock) != 0)
+      error("Failed to init spinlock for star formation.");
+
+    /* Set the cell location and sizes. */
+    c->loc[0] = i * s->width[0];
+    c->loc[1] = j * s->width[1];
+    c->loc[2] = k * s->width[2];
+    c->width[0] = s->width[0];
+    c->width[1] = s->width[1];
+    c->width[2] = s->width[2];
+    c->dmin = dmin;
+    c->depth = 0;
+    c->split = 0;
+    c->hydro.count = 0;
+    c->grav.count = 0;
+    c->stars.count = 0;
+    c->top = c;
+    c->super = c;
+    c->hydro.super = c;
+    c->grav.super = c;
+    c->hydro.ti_old_part = ti_current;
+    c->grav.ti_old_part = ti_current;
+    c->stars.ti_old_part = ti_current;
+    c->black_holes.ti_old_part = ti_current;
+    c->grav.ti_old_multipole = ti_current;
+#ifdef WITH_MPI
+    c->mpi.tag = -1;
+    c->mpi.recv = NULL;
+    c->mpi.send = NULL;
+#endif  // WITH_MPI
+    if (s->with_self_gravity) c->grav.multipole = &s->multipoles_top[cid];
+#if defined(SWIFT_DEBUG_CHECKS) || defined(SWIFT_CELL_GRAPH)
+    c->cellID = -(last_cell_id + cid);
+#endif
+  }
+}
+
+#ifdef WITH_MPI
+/**
+ * @brief Distribute the top-level cells over the nodes without using any
+ * previous partition.
+ *
+ * @param s The #space.
+ */
+static void space_partition_afresh(struct space *s) {
+
+  struct partition initial_partition;
+  bzero(&initial_partition, sizeof(struct partition));
+#if defined(HAVE_PARMETIS) || defined(HAVE_METIS)
+  initial_partition.type = INITPART_METIS_NOWEIGHT;
+#else
+  initial_partition.type = INITPART_VECTORIZE;
+#endif
+  partition_initial_partition(&initial_partition, s->e->nodeID, s->e->nr_nodes,
+                              s);
+}
+#endif /* WITH_MPI */
+
 /**
  * @brief Re-build the top-level cell grid.
  *
@@ -355,7 +654,6 @@ void space_regrid(struct space *s, int verbose) {
   const size_t nr_sparts = s->nr_sparts;
   const size_t nr_bparts = s->nr_bparts;
   const ticks tic = getticks();
-  const integertime_t ti_current = (s->e != NULL) ? s->e->ti_current : 0;
 
   /* Run through the cells and get the current h_max. */
   // tic = getticks();
@@ -499,8 +797,19 @@ void space_regrid(struct space *s, int verbose) {
       swift_free("cells_with_particles_top", s->cells_with_particles_top);
       swift_free("local_cells_with_particles_top",
                  s->local_cells_with_particles_top);
+      swift_free("active_cells", s->active_cells_next);
+      swift_free("active_cells", s->active_cells_prev);
+      swift_free("active_cells", s->active_cells_bin);
+      swift_free("active_cells", s->active_cells_buffer);
       swift_free("cells_top", s->cells_top);
       swift_free("multipoles_top", s->multipoles_top);
+      swift_free("cells_top_order", s->cells_top_order);
+      swift_free("cells_top_order", s->cells_top_rank);
+      swift_free("split_tuning", s->split_tuning);
+      s->cells_top_order = NULL;
+      s->cells_top_rank = NULL;
+      s->split_tuning = NULL;
+      hydro_space_clean(&s->hs);
     }
 
     /* Also free the task arrays, these will be regenerated and we can use the
@@ -513,7 +822,6 @@ void space_regrid(struct space *s, int verbose) {
       s->width[k] = s->dim[k] / cdim[k];
       s->iwidth[k] = 1.0 / s->width[k];
     }
-    const float dmin = min3(s->width[0], s->width[1], s->width[2]);
 
     /* Allocate the highest level of cells. */
     s->tot_cells = s->nr_cells = cdim[0] * cdim[1] * cdim[2];
@@ -521,7 +829,6 @@ void space_regrid(struct space *s, int verbose) {
     if (swift_memalign("cells_top", (void **)&s->cells_top, cell_align,
                        s->nr_cells * sizeof(struct cell)) != 0)
       error("Failed to allocate top-level cells.");
-    bzero(s->cells_top, s->nr_cells * sizeof(struct cell));
 
     /* Allocate the multipoles for the top-level cells. */
     if (s->with_self_gravity) {
@@ -529,7 +836,6 @@ void space_regrid(struct space *s, int verbose) {
                          multipole_align,
                          s->nr_cells * sizeof(struct gravity_tensors)) != 0)
         error("Failed to allocate top-level multipoles.");
-      bzero(s->multipoles_top, s->nr_cells * sizeof(struct gravity_tensors));
     }
 
     /* Allocate the indices of local cells */
@@ -561,60 +867,39 @@ void space_regrid(struct space *s, int verbose) {
           "particles.");
     bzero(s->local_cells_with_particles_top, s->nr_cells * sizeof(int));
 
-    /* Set the cells' locks */
-    for (int k = 0; k < s->nr_cells; k++) {
-      if (lock_init(&s->cells_top[k].hydro.lock) != 0)
-        error("Failed to init spinlock for hydro.");
-      if (lock_init(&s->cells_top[k].grav.plock) != 0)
-        error("Failed to init spinlock for gravity.");
-      if (lock_init(&s->cells_top[k].grav.mlock) != 0)
-        error("Failed to init spinlock for multipoles.");
-      if (lock_init(&s->cells_top[k].stars.lock) != 0)
-        error("Failed to init spinlock for stars.");
-      if (lock_init(&s->cells_top[k].black_holes.lock) != 0)
-        error("Failed to init spinlock for black holes.");
-      if (lock_init(&s->cells_top[k].stars.star_formation_lock) != 0)
-        error("Failed to init spinlock for star formation.");
-    }
-
-    /* Set the cell location and sizes. */
-    for (int i = 0; i < cdim[0]; i++)
-      for (int j = 0; j < cdim[1]; j++)
-        for (int k = 0; k < cdim[2]; k++) {
-          const size_t cid = cell_getid(cdim, i, j, k);
-          struct cell *restrict c = &s->cells_top[cid];
-          c->loc[0] = i * s->width[0];
-          c->loc[1] = j * s->width[1];
-          c->loc[2] = k * s->width[2];
-          c->width[0] = s->width[0];
-          c->width[1] = s->width[1];
-          c->width[2] = s->width[2];
-          c->dmin = dmin;
-          c->depth = 0;
-          c->split = 0;
-          c->hydro.count = 0;
-          c->grav.count = 0;
-          c->stars.count = 0;
-          c->top = c;
-          c->super = c;
-          c->hydro.super = c;
-          c->grav.super = c;
-          c->hydro.ti_old_part = ti_current;
-          c->grav.ti_old_part = ti_current;
-          c->stars.ti_old_part = ti_current;
-          c->black_holes.ti_old_part = ti_current;
-          c->grav.ti_old_multipole = ti_current;
-#ifdef WITH_MPI
-          c->mpi.tag = -1;
-          c->mpi.recv = NULL;
-          c->mpi.send = NULL;
-#endif  // WITH_MPI
-          if (s->with_self_gravity) c->grav.multipole = &s->multipoles_top[cid];
+    /* Allocate the lists of active cells */
+    if (swift_memalign("active_cells", (void **)&s->active_cells_next,
+                       SWIFT_STRUCT_ALIGNMENT,
+                       s->nr_cells * sizeof(int)) != 0 ||
+        swift_memalign("active_cells", (void **)&s->active_cells_prev,
+                       SWIFT_STRUCT_ALIGNMENT,
+                       s->nr_cells * sizeof(int)) != 0 ||
+        swift_memalign("active_cells", (void **)&s->active_cells_bin,
+                       SWIFT_STRUCT_ALIGNMENT,
+                       s->nr_cells * sizeof(int)) != 0 ||
+        swift_memalign("active_cells", (void **)&s->active_cells_buffer,
+                       SWIFT_STRUCT_ALIGNMENT, s->nr_cells * sizeof(int)) != 0)
+      error("Failed to allocate the lists of active top-level cells.");
+    s->active_cells_valid = 0;
+
+    /* Set the cells' locks, location and sizes. */
+    if (s->e != NULL)
+      threadpool_map(&s->e->threadpool, space_regrid_init_cells_mapper,
+                     s->cells_top, s->nr_cells, sizeof(struct cell), 0, s);
+    else
+      space_regrid_init_cells_mapper(s->cells_top, s->nr_cells, s);
 #if defined(SWIFT_DEBUG_CHECKS) || defined(SWIFT_CELL_GRAPH)
-          c->cellID = -last_cell_id;
-          last_cell_id++;
+    last_cell_id += s->nr_cells;
 #endif
-        }
+
+    /* Store the particles of the cells along a Morton curve? */
+    if (s->morton_order) space_make_cells_top_order(s);
+
+    /* Start the tuning of the split sizes afresh on the new grid? */
+    if (s->adaptive_split) space_split_tuning_init(s);
+
+    /* Flag the top-level cells touching the walls of the box. */
+    hydro_space_init_cells(&s->hs, s);
 
     /* Be verbose about the change. */
     if (verbose)
@@ -635,14 +920,7 @@ void space_regrid(struct space *s, int verbose) {
 
         /* Failed, try another technique that requires no settings. */
         message("Failed to get a new partition, trying less optimal method");
-        struct partition initial_partition;
-#if defined(HAVE_PARMETIS) || defined(HAVE_METIS)
-        initial_partition.type = INITPART_METIS_NOWEIGHT;
-#else
-        initial_partition.type = INITPART_VECTORIZE;
-#endif
-        partition_initial_partition(&initial_partition, s->e->nodeID,
-                                    s->e->nr_nodes, s);
+        space_partition_afresh(s);
       }
 
       /* Re-distribute the particles to their new nodes. */
@@ -660,8 +938,12 @@ void space_regrid(struct space *s, int verbose) {
        * are not assigned to a node, we must do that and then associate the
        * particles with the cells. Note requires that
        * partition_store_celllist() was called once before, or just before
-       * dumping the restart files.*/
-      partition_restore_celllist(s, s->e->reparttype);
+       * dumping the restart files. When restarting on a different number of
+       * ranks, there is no such list and we start from a new partition. */
+      if (s->e->reparttype->ncelllist > 0)
+        partition_restore_celllist(s, s->e->reparttype);
+      else
+        space_partition_afresh(s);
 
       /* Now re-distribute the particles, should just add to cells? */
       engine_redistribute(s->e);
@@ -677,8 +959,12 @@ void space_regrid(struct space *s, int verbose) {
   }      /* re-build upper-level cells? */
   else { /* Otherwise, just clean up the cells. */
 
-    /* Free the old cells, if they were allocated. */
-    space_free_cells(s);
+    /* Free the old cells, if they were allocated, or keep them if we want
+     * to re-use the tasks. */
+    if (s->reuse_task_graph)
+      space_reset_cells(s);
+    else
+      space_free_cells(s);
   }
 
   if (verbose)
@@ -1151,6 +1437,12 @@ void space_rebuild(struct space *s, int repartitioned, int verbose) {
   last_cell_id = 1;
 #endif
 
+  /* The cells will change, so will their time-steps. */
+  s->active_cells_valid = 0;
+
+  /* Can we keep most of the tree? */
+  if (!repartitioned && space_rebuild_local(s, verbose)) return;
+
   /* Re-grid if necessary, or just re-set the cell data. */
   space_regrid(s, verbose);
 
@@ -1611,9 +1903,14 @@ void space_rebuild(struct space *s, int repartitioned, int verbose) {
 #endif /* WITH_MPI */
 
   /* Sort the parts according to their cells. */
-  if (nr_parts > 0)
-    space_parts_sort(s->parts, s->xparts, h_index, cell_part_counts,
-                     s->nr_cells, 0);
+  if (nr_parts > 0) {
+    if (s->cells_top_order != NULL)
+      space_cell_indices_to_ranks(s, h_index, cell_part_counts, nr_parts);
+    space_parts_sort(&s->e->threadpool, s->parts, s->xparts, h_index,
+                     cell_part_counts, s->nr_cells, 0);
+    if (s->cells_top_order != NULL)
+      space_cell_ranks_to_indices(s, h_index, nr_parts);
+  }
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Verify that the part have been sorted correctly. */
@@ -1642,8 +1939,14 @@ void space_rebuild(struct space *s, int repartitioned, int verbose) {
 #endif /* SWIFT_DEBUG_CHECKS */
 
   /* Sort the sparts according to their cells. */
-  if (nr_sparts > 0)
-    space_sparts_sort(s->sparts, s_index, cell_spart_counts, s->nr_cells, 0);
+  if (nr_sparts > 0) {
+    if (s->cells_top_order != NULL)
+      space_cell_indices_to_ranks(s, s_index, cell_spart_counts, nr_sparts);
+    space_sparts_sort(&s->e->threadpool, s->sparts, s_index,
+                      cell_spart_counts, s->nr_cells, 0);
+    if (s->cells_top_order != NULL)
+      space_cell_ranks_to_indices(s, s_index, nr_sparts);
+  }
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Verify that the spart have been sorted correctly. */
@@ -1672,8 +1975,14 @@ void space_rebuild(struct space *s, int repartitioned, int verbose) {
 #endif /* SWIFT_DEBUG_CHECKS */
 
   /* Sort the bparts according to their cells. */
-  if (nr_bparts > 0)
-    space_bparts_sort(s->bparts, b_index, cell_bpart_counts, s->nr_cells, 0);
+  if (nr_bparts > 0) {
+    if (s->cells_top_order != NULL)
+      space_cell_indices_to_ranks(s, b_index, cell_bpart_counts, nr_bparts);
+    space_bparts_sort(&s->e->threadpool, s->bparts, b_index,
+                      cell_bpart_counts, s->nr_cells, 0);
+    if (s->cells_top_order != NULL)
+      space_cell_ranks_to_indices(s, b_index, nr_bparts);
+  }
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Verify that the bpart have been sorted correctly. */
@@ -1706,7 +2015,7 @@ void space_rebuild(struct space *s, int repartitioned, int verbose) {
   size_t last_index = 0;
   h_index[nr_parts] = s->nr_cells;  // sentinel.
   for (size_t k = 0; k < nr_parts; k++) {
-    if (h_index[k] < h_index[k + 1]) {
+    if (h_index[k] != h_index[k + 1]) {
       cells_top[h_index[k]].hydro.count =
           k - last_index + 1 - space_extra_parts;
       last_index = k + 1;
@@ -1718,7 +2027,7 @@ void space_rebuild(struct space *s, int repartitioned, int verbose) {
   size_t last_sindex = 0;
   s_index[nr_sparts] = s->nr_cells;  // sentinel.
   for (size_t k = 0; k < nr_sparts; k++) {
-    if (s_index[k] < s_index[k + 1]) {
+    if (s_index[k] != s_index[k + 1]) {
       cells_top[s_index[k]].stars.count =
           k - last_sindex + 1 - space_extra_sparts;
       last_sindex = k + 1;
@@ -1730,7 +2039,7 @@ void space_rebuild(struct space *s, int repartitioned, int verbose) {
   size_t last_bindex = 0;
   b_index[nr_bparts] = s->nr_cells;  // sentinel.
   for (size_t k = 0; k < nr_bparts; k++) {
-    if (b_index[k] < b_index[k + 1]) {
+    if (b_index[k] != b_index[k + 1]) {
       cells_top[b_index[k]].black_holes.count =
           k - last_bindex + 1 - space_extra_bparts;
       last_bindex = k + 1;
@@ -1786,9 +2095,14 @@ void space_rebuild(struct space *s, int repartitioned, int verbose) {
   s->nr_inhibited_bparts = 0;
 
   /* Sort the gparts according to their cells. */
-  if (nr_gparts > 0)
-    space_gparts_sort(s->gparts, s->parts, s->sparts, s->bparts, g_index,
-                      cell_gpart_counts, s->nr_cells);
+  if (nr_gparts > 0) {
+    if (s->cells_top_order != NULL)
+      space_cell_indices_to_ranks(s, g_index, cell_gpart_counts, nr_gparts);
+    space_gparts_sort(&s->e->threadpool, s->gparts, s->parts, s->sparts,
+                      s->bparts, g_index, cell_gpart_counts, s->nr_cells);
+    if (s->cells_top_order != NULL)
+      space_cell_ranks_to_indices(s, g_index, nr_gparts);
+  }
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Verify that the gpart have been sorted correctly. */
@@ -1821,7 +2135,7 @@ void space_rebuild(struct space *s, int repartitioned, int verbose) {
   size_t last_gindex = 0;
   g_index[nr_gparts] = s->nr_cells;
   for (size_t k = 0; k < nr_gparts; k++) {
-    if (g_index[k] < g_index[k + 1]) {
+    if (g_index[k] != g_index[k + 1]) {
       cells_top[g_index[k]].grav.count =
           k - last_gindex + 1 - space_extra_gparts;
       last_gindex = k + 1;
@@ -1850,7 +2164,8 @@ void space_rebuild(struct space *s, int repartitioned, int verbose) {
   s->nr_cells_with_particles = 0;
   s->nr_local_cells_with_particles = 0;
   s->nr_local_cells = 0;
-  for (int k = 0; k < s->nr_cells; k++) {
+  for (int ind = 0; ind < s->nr_cells; ind++) {
+    const int k = s->cells_top_order != NULL ? s->cells_top_order[ind] : ind;
     struct cell *restrict c = &cells_top[k];
     c->hydro.ti_old_part = ti_current;
     c->grav.ti_old_part = ti_current;
@@ -1899,6 +2214,12 @@ void space_rebuild(struct space *s, int repartitioned, int verbose) {
       /* Add this cell to the list of non-empty cells */
       s->local_cells_with_particles_top[s->nr_local_cells_with_particles] = k;
       s->nr_local_cells_with_particles++;
+
+    } else if (c->split) {
+
+      /* This cell won't be split so get rid of the tree kept from the
+       * previous rebuild (see space_reset_cells()) */
+      space_recycle_progeny(s, c);
     }
   }
   if (verbose) {
@@ -1934,35 +2255,259 @@ void space_rebuild(struct space *s, int repartitioned, int verbose) {
 }
 
 /**
- * @brief Split particles between cells of a hierarchy.
+ * @brief Combine a 64-bit hash with a new value.
+ */
+__attribute__((always_inline)) INLINE static unsigned long long
+space_hash_combine(unsigned long long h, unsigned long long v) {
+  h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/**
+ * @brief Recursively compute the fingerprint of a cell tree.
  *
- * This is done in parallel using threads in the #threadpool.
- * Only do this for the local non-empty top-level cells.
+ * This covers everything the construction of the tasks depends on, apart from
+ * the smoothing lengths: the address, the node and the split status of every
+ * cell as well as which particle types it contains.
  *
- * @param s The #space.
- * @param verbose Are we talkative ?
+ * @param c The #cell.
  */
-void space_split(struct space *s, int verbose) {
+static unsigned long long space_fingerprint_rec(const struct cell *c) {
 
-  const ticks tic = getticks();
+  const unsigned long long bits = (c->split ? 1ULL : 0ULL) |
+                                  (c->hydro.count > 0 ? 2ULL : 0ULL) |
+                                  (c->grav.count > 0 ? 4ULL : 0ULL) |
+                                  (c->stars.count > 0 ? 8ULL : 0ULL) |
+                                  (c->black_holes.count > 0 ? 16ULL : 0ULL);
 
-  threadpool_map(&s->e->threadpool, space_split_mapper,
-                 s->local_cells_with_particles_top,
-                 s->nr_local_cells_with_particles, sizeof(int), 0, s);
+  unsigned long long h = space_hash_combine((uintptr_t)c, bits);
+  h = space_hash_combine(h, (unsigned long long)c->nodeID);
 
-  if (verbose)
-    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
-            clocks_getunit());
-}
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      h = space_hash_combine(
+          h, c->progeny[k] != NULL ? space_fingerprint_rec(c->progeny[k])
+                                   : (unsigned long long)k);
 
-void space_reorder_extra_parts_mapper(void *map_data, int num_cells,
-                                      void *extra_data) {
-  int *local_cells = (int *)map_data;
-  struct space *s = (struct space *)extra_data;
-  struct cell *cells_top = s->cells_top;
+  return h;
+}
 
-  for (int ind = 0; ind < num_cells; ind++) {
-    struct cell *c = &cells_top[local_cells[ind]];
+/**
+ * @brief #threadpool mapper function adding the fingerprint of the trees of
+ * some top-level cells to the one of the whole #space.
+ *
+ * @param map_data Pointer towards the top-cells.
+ * @param num_cells The number of cells to treat.
+ * @param extra_data Pointers to the #space.
+ */
+void space_fingerprint_mapper(void *map_data, int num_cells,
+                              void *extra_data) {
+
+  struct space *s = (struct space *)extra_data;
+  struct cell *cells = (struct cell *)map_data;
+
+  unsigned long long h = 0;
+  for (int k = 0; k < num_cells; k++)
+    h += space_hash_combine(space_fingerprint_rec(&cells[k]),
+                            (unsigned long long)(&cells[k] - s->cells_top));
+
+  atomic_add(&s->tree_fingerprint, h);
+}
+
+/**
+ * @brief Compute the fingerprint of the whole cell tree of a #space.
+ *
+ * @param s The #space.
+ */
+static void space_compute_fingerprint(struct space *s) {
+
+  s->tree_fingerprint = s->tree_generation + 1;
+  threadpool_map(&s->e->threadpool, space_fingerprint_mapper, s->cells_top,
+                 s->nr_cells, sizeof(struct cell), 0, s);
+  if (s->tree_fingerprint == 0) s->tree_fingerprint = 1;
+}
+
+/**
+ * @brief Scale a split or sub-task size by the tuned factor of the top-level
+ * cell of a cell.
+ *
+ * @param s The #space.
+ * @param c The #cell.
+ * @param size The nominal size.
+ * @param power The power of the factor to apply, 2 for the sizes of the
+ * pairs which are products of two counts.
+ */
+long long space_cell_split_size(const struct space *s, const struct cell *c,
+                                const long long size, const int power) {
+
+  if (s->split_tuning == NULL || c->top == NULL) return size;
+
+  const ptrdiff_t cid = c->top - s->cells_top;
+  if (cid < 0 || cid >= s->nr_cells) return size;
+
+  const double factor = s->split_tuning[cid].factor;
+  return (long long)(power == 2 ? size * factor * factor : size * factor);
+}
+
+/**
+ * @brief Add the run times of the tasks of the last step to the tuning state
+ * of their top-level cells.
+ *
+ * The time of a pair is shared between the two cells. The particle updates
+ * are counted from the second kicks, whose cells do not depend on the split
+ * sizes, so that the cost per update can be compared across rebuilds.
+ *
+ * @param s The #space.
+ * @param sched The #scheduler that ran the tasks.
+ * @param tic The time at which the tasks were launched.
+ */
+void space_split_tuning_collect(struct space *s, const struct scheduler *sched,
+                                const ticks tic) {
+
+  struct space_split_tuning *tuning = s->split_tuning;
+  if (tuning == NULL) return;
+
+  for (int k = 0; k < sched->nr_tasks; k++) {
+    const struct task *t = &sched->tasks[k];
+
+    /* Only the tasks that ran this step and did some work. The time of the
+     * communications is mostly latency. */
+    if (t->implicit || t->tic < tic || t->ci == NULL) continue;
+    if (t->type == task_type_send || t->type == task_type_recv) continue;
+
+    const struct cell *ci = t->ci;
+    const struct cell *cj = t->cj;
+    const ptrdiff_t cid = ci->top - s->cells_top;
+    const ptrdiff_t cjd = (cj != NULL) ? cj->top - s->cells_top : -1;
+    const double dt = t->toc - t->tic;
+
+    if (cjd >= 0 && cjd < s->nr_cells && cjd != cid) {
+      tuning[cjd].ticks += 0.5 * dt;
+      tuning[cjd].nr_tasks += 0.5;
+      if (cid >= 0 && cid < s->nr_cells) {
+        tuning[cid].ticks += 0.5 * dt;
+        tuning[cid].nr_tasks += 0.5;
+      }
+    } else if (cid >= 0 && cid < s->nr_cells) {
+      tuning[cid].ticks += dt;
+      tuning[cid].nr_tasks += 1.;
+      if (t == ci->kick2)
+        tuning[cid].updates +=
+            max(ci->grav.count, ci->hydro.count + ci->stars.count +
+                                    ci->black_holes.count);
+    }
+  }
+}
+
+/**
+ * @brief Move the split factor of each top-level cell towards the one that
+ * minimises the cost of its particle updates.
+ *
+ * The cost of a cell is the time of its tasks plus an assumed scheduling
+ * overhead per task, per particle update, since the last rebuild. The factor
+ * keeps moving in the same direction as long as this cost decreases, and
+ * turns back when it grows. Over MPI, the measurements of all the ranks are
+ * combined, so that they all agree on the factors.
+ *
+ * @param s The #space.
+ * @param verbose Are we talkative ?
+ */
+static void space_split_tuning_update(struct space *s, const int verbose) {
+
+  struct space_split_tuning *tuning = s->split_tuning;
+  const int nr_cells = s->nr_cells;
+
+#ifdef WITH_MPI
+  double *buff = (double *)malloc(3 * nr_cells * sizeof(double));
+  if (buff == NULL) error("Failed to allocate the tuning buffer.");
+  for (int k = 0; k < nr_cells; k++) {
+    buff[3 * k + 0] = tuning[k].ticks;
+    buff[3 * k + 1] = tuning[k].nr_tasks;
+    buff[3 * k + 2] = tuning[k].updates;
+  }
+  if (MPI_Allreduce(MPI_IN_PLACE, buff, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
+                    MPI_COMM_WORLD) != MPI_SUCCESS)
+    error("Failed to combine the costs of the top-level cells.");
+  for (int k = 0; k < nr_cells; k++) {
+    tuning[k].ticks = buff[3 * k + 0];
+    tuning[k].nr_tasks = buff[3 * k + 1];
+    tuning[k].updates = buff[3 * k + 2];
+  }
+  free(buff);
+#endif
+
+  int nr_coarser = 0, nr_finer = 0;
+  for (int k = 0; k < nr_cells; k++) {
+    struct space_split_tuning *st = &tuning[k];
+
+    if (st->updates > 0. && st->nr_tasks > 0.) {
+      const double cost =
+          (st->ticks + st->nr_tasks * s->split_task_overhead) / st->updates;
+
+      /* Did the last change make things worse? */
+      if (st->cost > 0. && cost > st->cost) st->direction = -st->direction;
+      st->cost = cost;
+
+      if (st->direction > 0.f) {
+        st->factor = min(st->factor * space_split_tuning_step,
+                         (float)space_split_tuning_max_factor);
+        nr_coarser++;
+      } else {
+        st->factor = max(st->factor / space_split_tuning_step,
+                         1.f / space_split_tuning_max_factor);
+        nr_finer++;
+      }
+    }
+
+    st->ticks = 0.;
+    st->nr_tasks = 0.;
+    st->updates = 0.;
+  }
+
+  if (verbose)
+    message("Split sizes made coarser in %d and finer in %d top-level cells.",
+            nr_coarser, nr_finer);
+}
+
+/**
+ * @brief Split particles between cells of a hierarchy.
+ *
+ * This is done in parallel using threads in the #threadpool.
+ * Only do this for the local non-empty top-level cells.
+ *
+ * @param s The #space.
+ * @param verbose Are we talkative ?
+ */
+void space_split(struct space *s, int verbose) {
+
+  const ticks tic = getticks();
+
+  /* Adjust the split sizes to the costs measured since the last rebuild. */
+  if (s->split_tuning != NULL) space_split_tuning_update(s, verbose);
+
+  threadpool_map(&s->e->threadpool, space_split_mapper,
+                 s->local_cells_with_particles_top,
+                 s->nr_local_cells_with_particles, sizeof(int), 0, s);
+
+  /* Identify the tree we just built. */
+  if (s->reuse_task_graph) space_compute_fingerprint(s);
+
+  if (verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+}
+
+void space_reorder_extra_parts_mapper(void *map_data, int num_cells,
+                                      void *extra_data) {
+  int *local_cells = (int *)map_data;
+  struct space *s = (struct space *)extra_data;
+  struct cell *cells_top = s->cells_top;
+
+  for (int ind = 0; ind < num_cells; ind++) {
+    struct cell *c = &cells_top[local_cells[ind]];
     cell_reorder_extra_parts(c, c->hydro.parts - s->parts);
   }
 }
@@ -2021,6 +2566,159 @@ void space_reorder_extras(struct space *s, int verbose) {
                    s->local_cells_top, s->nr_local_cells, sizeof(int), 0, s);
 }
 
+#if defined(HAVE_LIBNUMA) && defined(_GNU_SOURCE)
+/**
+ * @brief Bind the pages of one particle array to the NUMA domains of the
+ * queues owning them.
+ *
+ * The #cell::owner of a cell is given by the offset of its particles in the
+ * array, so queue q owns the slice [q * count / nr_queues, (q + 1) * count /
+ * nr_queues). Consecutive queues on the same domain are merged into a single
+ * range. Pages straddling two ranges go to the domain owning their start.
+ *
+ * @param base Start of the particle array.
+ * @param count Number of elements in the array.
+ * @param size Size in bytes of one element.
+ * @param nr_queues The number of queues.
+ * @param queue_domain The NUMA node of each queue.
+ *
+ * @return The number of failed mbind() calls.
+ */
+static int space_numa_place_array(void *base, const size_t count,
+                                  const size_t size, const int nr_queues,
+                                  const int *queue_domain) {
+
+  if (base == NULL || count == 0) return 0;
+
+  const uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+  const uintptr_t addr = (uintptr_t)base;
+  struct bitmask *mask = numa_allocate_nodemask();
+  int nr_failed = 0;
+
+  int q = 0;
+  while (q < nr_queues) {
+
+    /* Extend the range over all the queues on this domain. */
+    const int domain = queue_domain[q];
+    const int q_start = q;
+    while (q < nr_queues && queue_domain[q] == domain) q++;
+
+    const size_t first = (size_t)q_start * count / nr_queues;
+    const size_t last = (size_t)q * count / nr_queues;
+    if (first == last) continue;
+
+    /* Round both ends up to a page boundary. */
+    const uintptr_t start =
+        (addr + first * size + page_size - 1) & ~(page_size - 1);
+    const uintptr_t end =
+        (addr + last * size + page_size - 1) & ~(page_size - 1);
+    if (end <= start) continue;
+
+    numa_bitmask_clearall(mask);
+    numa_bitmask_setbit(mask, domain);
+    if (mbind((void *)start, end - start, MPOL_PREFERRED, mask->maskp,
+              mask->size + 1, MPOL_MF_MOVE) != 0)
+      nr_failed++;
+  }
+
+  numa_free_nodemask(mask);
+  return nr_failed;
+}
+#endif
+
+/**
+ * @brief Moves the particle arrays to the NUMA domains of the queues that
+ * own their cells.
+ *
+ * Page migration only moves the pages that are not already on the right
+ * node, so after the first rebuild this only pays for the particles that
+ * changed owner.
+ *
+ * @param s The #space.
+ * @param queue_domain The NUMA node of each of the #space::nr_queues queues.
+ * @param verbose Are we talkative?
+ */
+void space_numa_place_particles(const struct space *s, const int *queue_domain,
+                                int verbose) {
+
+#if defined(HAVE_LIBNUMA) && defined(_GNU_SOURCE)
+  const ticks tic = getticks();
+  const int nr_queues = s->nr_queues;
+
+  int nr_failed = 0;
+  nr_failed += space_numa_place_array(s->parts, s->nr_parts,
+                                      sizeof(struct part), nr_queues,
+                                      queue_domain);
+  nr_failed += space_numa_place_array(s->xparts, s->nr_parts,
+                                      sizeof(struct xpart), nr_queues,
+                                      queue_domain);
+  nr_failed += space_numa_place_array(s->gparts, s->nr_gparts,
+                                      sizeof(struct gpart), nr_queues,
+                                      queue_domain);
+  nr_failed += space_numa_place_array(s->sparts, s->nr_sparts,
+                                      sizeof(struct spart), nr_queues,
+                                      queue_domain);
+  nr_failed += space_numa_place_array(s->bparts, s->nr_bparts,
+                                      sizeof(struct bpart), nr_queues,
+                                      queue_domain);
+
+  if (nr_failed > 0 && verbose)
+    message("WARNING: %d particle ranges could not be moved to their domain.",
+            nr_failed);
+
+  if (verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+#else
+  error("SWIFT was not compiled with NUMA support.");
+#endif
+}
+
+/**
+ * @brief Moves the foreign particle arrays to the NUMA domains of the queues
+ * that own their cells.
+ *
+ * The owner of a foreign cell is given by the offset of its particles in the
+ * foreign arrays, as for the local cells.
+ *
+ * @param s The #space.
+ * @param queue_domain The NUMA node of each of the #space::nr_queues queues.
+ * @param verbose Are we talkative?
+ */
+void space_numa_place_foreign_particles(const struct space *s,
+                                        const int *queue_domain,
+                                        int verbose) {
+
+#if defined(HAVE_LIBNUMA) && defined(_GNU_SOURCE) && defined(WITH_MPI)
+  const ticks tic = getticks();
+  const int nr_queues = s->nr_queues;
+
+  int nr_failed = 0;
+  nr_failed += space_numa_place_array(s->parts_foreign, s->nr_parts_foreign,
+                                      sizeof(struct part), nr_queues,
+                                      queue_domain);
+  nr_failed += space_numa_place_array(s->gparts_foreign, s->nr_gparts_foreign,
+                                      sizeof(struct gpart), nr_queues,
+                                      queue_domain);
+  nr_failed += space_numa_place_array(s->sparts_foreign, s->nr_sparts_foreign,
+                                      sizeof(struct spart), nr_queues,
+                                      queue_domain);
+  nr_failed += space_numa_place_array(s->bparts_foreign, s->nr_bparts_foreign,
+                                      sizeof(struct bpart), nr_queues,
+                                      queue_domain);
+
+  if (nr_failed > 0 && verbose)
+    message("WARNING: %d foreign ranges could not be moved to their domain.",
+            nr_failed);
+
+  if (verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+#else
+  error("SWIFT was not compiled with NUMA and MPI support.");
+#endif
+}
+
 /**
  * @brief #threadpool mapper function to sanitize the cells
  *
@@ -2051,6 +2749,64 @@ void space_sanitize(struct space *s) {
                  s->nr_cells, sizeof(struct cell), 0, NULL);
 }
 
+/*! Number of particles whose cell index is computed in one go */
+#define space_index_block_size 256
+
+/**
+ * @brief Positions and cell indices of a block of particles.
+ *
+ * The positions are gathered out of the particle structs into separate
+ * arrays so that the wrapping and the index computation are a loop without
+ * dependencies that the compiler can vectorise.
+ */
+struct space_index_block {
+  double x[space_index_block_size];
+  double y[space_index_block_size];
+  double z[space_index_block_size];
+  int index[space_index_block_size];
+};
+
+/**
+ * @brief Put a block of positions back into the simulation volume and
+ * compute their top-level cell indices.
+ *
+ * @param s The #space.
+ * @param block The positions (updated in place) and the resulting indices.
+ * @param count The number of particles in the block.
+ */
+__attribute__((always_inline)) INLINE static void space_get_cell_index_block(
+    const struct space *s, struct space_index_block *restrict block,
+    const int count) {
+
+  const double dim_x = s->dim[0];
+  const double dim_y = s->dim[1];
+  const double dim_z = s->dim[2];
+  const int cdim[3] = {s->cdim[0], s->cdim[1], s->cdim[2]};
+  const double ih_x = s->iwidth[0];
+  const double ih_y = s->iwidth[1];
+  const double ih_z = s->iwidth[2];
+
+  double *restrict x = block->x;
+  double *restrict y = block->y;
+  double *restrict z = block->z;
+  int *restrict index = block->index;
+
+  for (int l = 0; l < count; l++) {
+
+    /* Put it back into the simulation volume */
+    const double pos_x = box_wrap(x[l], 0.0, dim_x);
+    const double pos_y = box_wrap(y[l], 0.0, dim_y);
+    const double pos_z = box_wrap(z[l], 0.0, dim_z);
+
+    /* Get its cell index */
+    index[l] = cell_getid(cdim, pos_x * ih_x, pos_y * ih_y, pos_z * ih_z);
+
+    x[l] = pos_x;
+    y[l] = pos_y;
+    z[l] = pos_z;
+  }
+}
+
 /**
  * @brief #threadpool mapper function to compute the particle cell indices.
  *
@@ -2067,14 +2823,16 @@ void space_parts_get_cell_index_mapper(void *map_data, int nr_parts,
   struct space *s = data->s;
   int *const ind = data->ind + (ptrdiff_t)(parts - s->parts);
 
+#ifdef SWIFT_DEBUG_CHECKS
   /* Get some constants */
   const double dim_x = s->dim[0];
   const double dim_y = s->dim[1];
   const double dim_z = s->dim[2];
-  const int cdim[3] = {s->cdim[0], s->cdim[1], s->cdim[2]};
-  const double ih_x = s->iwidth[0];
-  const double ih_y = s->iwidth[1];
-  const double ih_z = s->iwidth[2];
+  const int *cdim = s->cdim;
+#endif
+
+  /* Positions and cell indices of the current block of particles */
+  struct space_index_block block;
 
   /* Init the local count buffer. */
   int *cell_counts = (int *)calloc(sizeof(int), s->nr_cells);
@@ -2087,71 +2845,86 @@ void space_parts_get_cell_index_mapper(void *map_data, int nr_parts,
   size_t count_inhibited_part = 0;
   size_t count_extra_part = 0;
 
-  /* Loop over the parts. */
-  for (int k = 0; k < nr_parts; k++) {
+  /* Loop over the parts in blocks. */
+  for (int k_start = 0; k_start < nr_parts;
+       k_start += space_index_block_size) {
 
-    /* Get the particle */
-    struct part *restrict p = &parts[k];
+    const int count = min(space_index_block_size, nr_parts - k_start);
 
-    const double old_pos_x = p->x[0];
-    const double old_pos_y = p->x[1];
-    const double old_pos_z = p->x[2];
+    /* Gather the positions of the block */
+    for (int l = 0; l < count; l++) {
+      block.x[l] = parts[k_start + l].x[0];
+      block.y[l] = parts[k_start + l].x[1];
+      block.z[l] = parts[k_start + l].x[2];
+    }
+
+    /* Wrap them and get their cell indices */
+    space_get_cell_index_block(s, &block, count);
+
+    for (int l = 0; l < count; l++) {
+
+      /* Get the particle */
+      const int k = k_start + l;
+      struct part *restrict p = &parts[k];
 
 #ifdef SWIFT_DEBUG_CHECKS
-    if (!s->periodic && p->time_bin != time_bin_inhibited) {
-      if (old_pos_x < 0. || old_pos_x > dim_x)
-        error("Particle outside of volume along X.");
-      if (old_pos_y < 0. || old_pos_y > dim_y)
-        error("Particle outside of volume along Y.");
-      if (old_pos_z < 0. || old_pos_z > dim_z)
-        error("Particle outside of volume along Z.");
-    }
+      const double old_pos_x = p->x[0];
+      const double old_pos_y = p->x[1];
+      const double old_pos_z = p->x[2];
+
+      if (!s->periodic && p->time_bin != time_bin_inhibited) {
+        if (old_pos_x < 0. || old_pos_x > dim_x)
+          error("Particle outside of volume along X.");
+        if (old_pos_y < 0. || old_pos_y > dim_y)
+          error("Particle outside of volume along Y.");
+        if (old_pos_z < 0. || old_pos_z > dim_z)
+          error("Particle outside of volume along Z.");
+      }
 #endif
 
-    /* Put it back into the simulation volume */
-    const double pos_x = box_wrap(old_pos_x, 0.0, dim_x);
-    const double pos_y = box_wrap(old_pos_y, 0.0, dim_y);
-    const double pos_z = box_wrap(old_pos_z, 0.0, dim_z);
-
-    /* Get its cell index */
-    const int index =
-        cell_getid(cdim, pos_x * ih_x, pos_y * ih_y, pos_z * ih_z);
+      /* Its position back in the simulation volume and its cell index */
+      const double pos_x = block.x[l];
+      const double pos_y = block.y[l];
+      const double pos_z = block.z[l];
+      const int index = block.index[l];
 
 #ifdef SWIFT_DEBUG_CHECKS
-    if (index < 0 || index >= cdim[0] * cdim[1] * cdim[2])
-      error("Invalid index=%d cdim=[%d %d %d] p->x=[%e %e %e]", index, cdim[0],
-            cdim[1], cdim[2], pos_x, pos_y, pos_z);
-
-    if (pos_x >= dim_x || pos_y >= dim_y || pos_z >= dim_z || pos_x < 0. ||
-        pos_y < 0. || pos_z < 0.)
-      error("Particle outside of simulation box. p->x=[%e %e %e]", pos_x, pos_y,
-            pos_z);
+      if (index < 0 || index >= cdim[0] * cdim[1] * cdim[2])
+        error("Invalid index=%d cdim=[%d %d %d] p->x=[%e %e %e]", index,
+              cdim[0], cdim[1], cdim[2], pos_x, pos_y, pos_z);
+
+      if (pos_x >= dim_x || pos_y >= dim_y || pos_z >= dim_z || pos_x < 0. ||
+          pos_y < 0. || pos_z < 0.)
+        error("Particle outside of simulation box. p->x=[%e %e %e]", pos_x,
+              pos_y, pos_z);
 #endif
 
-    if (p->time_bin == time_bin_inhibited) {
-      /* Is this particle to be removed? */
-      ind[k] = -1;
-      ++count_inhibited_part;
-    } else if (p->time_bin == time_bin_not_created) {
-      /* Is this a place-holder for on-the-fly creation? */
-      ind[k] = index;
-      cell_counts[index]++;
-      ++count_extra_part;
-    } else {
-      /* Normal case: list its top-level cell index */
-      ind[k] = index;
-      cell_counts[index]++;
+      if (p->time_bin == time_bin_inhibited) {
+        /* Is this particle to be removed? */
+        ind[k] = -1;
+        ++count_inhibited_part;
+      } else if (p->time_bin == time_bin_not_created) {
+        /* Is this a place-holder for on-the-fly creation? */
+        ind[k] = index;
+        cell_counts[index]++;
+        ++count_extra_part;
+      } else {
+        /* Normal case: list its top-level cell index */
+        ind[k] = index;
+        cell_counts[index]++;
 
-      /* Compute minimal mass */
-      min_mass = min(min_mass, hydro_get_mass(p));
+        /* Compute minimal mass */
+        min_mass = min(min_mass, hydro_get_mass(p));
 
-      /* Compute sum of velocity norm */
-      sum_vel_norm += p->v[0] * p->v[0] + p->v[1] * p->v[1] + p->v[2] * p->v[2];
+        /* Compute sum of velocity norm */
+        sum_vel_norm +=
+            p->v[0] * p->v[0] + p->v[1] * p->v[1] + p->v[2] * p->v[2];
 
-      /* Update the position */
-      p->x[0] = pos_x;
-      p->x[1] = pos_y;
-      p->x[2] = pos_z;
+        /* Update the position */
+        p->x[0] = pos_x;
+        p->x[1] = pos_y;
+        p->x[2] = pos_z;
+      }
     }
   }
 
@@ -2186,14 +2959,16 @@ void space_gparts_get_cell_index_mapper(void *map_data, int nr_gparts,
   struct space *s = data->s;
   int *const ind = data->ind + (ptrdiff_t)(gparts - s->gparts);
 
+#ifdef SWIFT_DEBUG_CHECKS
   /* Get some constants */
   const double dim_x = s->dim[0];
   const double dim_y = s->dim[1];
   const double dim_z = s->dim[2];
-  const int cdim[3] = {s->cdim[0], s->cdim[1], s->cdim[2]};
-  const double ih_x = s->iwidth[0];
-  const double ih_y = s->iwidth[1];
-  const double ih_z = s->iwidth[2];
+  const int *cdim = s->cdim;
+#endif
+
+  /* Positions and cell indices of the current block of particles */
+  struct space_index_block block;
 
   /* Init the local count buffer. */
   int *cell_counts = (int *)calloc(sizeof(int), s->nr_cells);
@@ -2206,75 +2981,90 @@ void space_gparts_get_cell_index_mapper(void *map_data, int nr_gparts,
   size_t count_inhibited_gpart = 0;
   size_t count_extra_gpart = 0;
 
-  for (int k = 0; k < nr_gparts; k++) {
+  /* Loop over the gparts in blocks. */
+  for (int k_start = 0; k_start < nr_gparts;
+       k_start += space_index_block_size) {
 
-    /* Get the particle */
-    struct gpart *restrict gp = &gparts[k];
+    const int count = min(space_index_block_size, nr_gparts - k_start);
+
+    /* Gather the positions of the block */
+    for (int l = 0; l < count; l++) {
+      block.x[l] = gparts[k_start + l].x[0];
+      block.y[l] = gparts[k_start + l].x[1];
+      block.z[l] = gparts[k_start + l].x[2];
+    }
+
+    /* Wrap them and get their cell indices */
+    space_get_cell_index_block(s, &block, count);
 
-    const double old_pos_x = gp->x[0];
-    const double old_pos_y = gp->x[1];
-    const double old_pos_z = gp->x[2];
+    for (int l = 0; l < count; l++) {
+
+      /* Get the particle */
+      const int k = k_start + l;
+      struct gpart *restrict gp = &gparts[k];
 
 #ifdef SWIFT_DEBUG_CHECKS
-    if (!s->periodic && gp->time_bin != time_bin_inhibited) {
-      if (old_pos_x < 0. || old_pos_x > dim_x)
-        error("Particle outside of volume along X.");
-      if (old_pos_y < 0. || old_pos_y > dim_y)
-        error("Particle outside of volume along Y.");
-      if (old_pos_z < 0. || old_pos_z > dim_z)
-        error("Particle outside of volume along Z.");
-    }
+      const double old_pos_x = gp->x[0];
+      const double old_pos_y = gp->x[1];
+      const double old_pos_z = gp->x[2];
+
+      if (!s->periodic && gp->time_bin != time_bin_inhibited) {
+        if (old_pos_x < 0. || old_pos_x > dim_x)
+          error("Particle outside of volume along X.");
+        if (old_pos_y < 0. || old_pos_y > dim_y)
+          error("Particle outside of volume along Y.");
+        if (old_pos_z < 0. || old_pos_z > dim_z)
+          error("Particle outside of volume along Z.");
+      }
 #endif
 
-    /* Put it back into the simulation volume */
-    const double pos_x = box_wrap(old_pos_x, 0.0, dim_x);
-    const double pos_y = box_wrap(old_pos_y, 0.0, dim_y);
-    const double pos_z = box_wrap(old_pos_z, 0.0, dim_z);
-
-    /* Get its cell index */
-    const int index =
-        cell_getid(cdim, pos_x * ih_x, pos_y * ih_y, pos_z * ih_z);
+      /* Its position back in the simulation volume and its cell index */
+      const double pos_x = block.x[l];
+      const double pos_y = block.y[l];
+      const double pos_z = block.z[l];
+      const int index = block.index[l];
 
 #ifdef SWIFT_DEBUG_CHECKS
-    if (index < 0 || index >= cdim[0] * cdim[1] * cdim[2])
-      error("Invalid index=%d cdim=[%d %d %d] p->x=[%e %e %e]", index, cdim[0],
-            cdim[1], cdim[2], pos_x, pos_y, pos_z);
-
-    if (pos_x >= dim_x || pos_y >= dim_y || pos_z >= dim_z || pos_x < 0. ||
-        pos_y < 0. || pos_z < 0.)
-      error("Particle outside of simulation box. p->x=[%e %e %e]", pos_x, pos_y,
-            pos_z);
+      if (index < 0 || index >= cdim[0] * cdim[1] * cdim[2])
+        error("Invalid index=%d cdim=[%d %d %d] p->x=[%e %e %e]", index,
+              cdim[0], cdim[1], cdim[2], pos_x, pos_y, pos_z);
+
+      if (pos_x >= dim_x || pos_y >= dim_y || pos_z >= dim_z || pos_x < 0. ||
+          pos_y < 0. || pos_z < 0.)
+        error("Particle outside of simulation box. p->x=[%e %e %e]", pos_x,
+              pos_y, pos_z);
 #endif
 
-    if (gp->time_bin == time_bin_inhibited) {
-      /* Is this particle to be removed? */
-      ind[k] = -1;
-      ++count_inhibited_gpart;
-    } else if (gp->time_bin == time_bin_not_created) {
-      /* Is this a place-holder for on-the-fly creation? */
-      ind[k] = index;
-      cell_counts[index]++;
-      ++count_extra_gpart;
-    } else {
-      /* List its top-level cell index */
-      ind[k] = index;
-      cell_counts[index]++;
+      if (gp->time_bin == time_bin_inhibited) {
+        /* Is this particle to be removed? */
+        ind[k] = -1;
+        ++count_inhibited_gpart;
+      } else if (gp->time_bin == time_bin_not_created) {
+        /* Is this a place-holder for on-the-fly creation? */
+        ind[k] = index;
+        cell_counts[index]++;
+        ++count_extra_gpart;
+      } else {
+        /* List its top-level cell index */
+        ind[k] = index;
+        cell_counts[index]++;
 
-      if (gp->type == swift_type_dark_matter) {
+        if (gp->type == swift_type_dark_matter) {
 
-        /* Compute minimal mass */
-        min_mass = min(min_mass, gp->mass);
+          /* Compute minimal mass */
+          min_mass = min(min_mass, gp->mass);
 
-        /* Compute sum of velocity norm */
-        sum_vel_norm += gp->v_full[0] * gp->v_full[0] +
-                        gp->v_full[1] * gp->v_full[1] +
-                        gp->v_full[2] * gp->v_full[2];
-      }
+          /* Compute sum of velocity norm */
+          sum_vel_norm += gp->v_full[0] * gp->v_full[0] +
+                          gp->v_full[1] * gp->v_full[1] +
+                          gp->v_full[2] * gp->v_full[2];
+        }
 
-      /* Update the position */
-      gp->x[0] = pos_x;
-      gp->x[1] = pos_y;
-      gp->x[2] = pos_z;
+        /* Update the position */
+        gp->x[0] = pos_x;
+        gp->x[1] = pos_y;
+        gp->x[2] = pos_z;
+      }
     }
   }
 
@@ -2310,14 +3100,16 @@ void space_sparts_get_cell_index_mapper(void *map_data, int nr_sparts,
   struct space *s = data->s;
   int *const ind = data->ind + (ptrdiff_t)(sparts - s->sparts);
 
+#ifdef SWIFT_DEBUG_CHECKS
   /* Get some constants */
   const double dim_x = s->dim[0];
   const double dim_y = s->dim[1];
   const double dim_z = s->dim[2];
-  const int cdim[3] = {s->cdim[0], s->cdim[1], s->cdim[2]};
-  const double ih_x = s->iwidth[0];
-  const double ih_y = s->iwidth[1];
-  const double ih_z = s->iwidth[2];
+  const int *cdim = s->cdim;
+#endif
+
+  /* Positions and cell indices of the current block of particles */
+  struct space_index_block block;
 
   /* Init the local count buffer. */
   int *cell_counts = (int *)calloc(sizeof(int), s->nr_cells);
@@ -2330,71 +3122,86 @@ void space_sparts_get_cell_index_mapper(void *map_data, int nr_sparts,
   size_t count_inhibited_spart = 0;
   size_t count_extra_spart = 0;
 
-  for (int k = 0; k < nr_sparts; k++) {
+  /* Loop over the sparts in blocks. */
+  for (int k_start = 0; k_start < nr_sparts;
+       k_start += space_index_block_size) {
 
-    /* Get the particle */
-    struct spart *restrict sp = &sparts[k];
+    const int count = min(space_index_block_size, nr_sparts - k_start);
+
+    /* Gather the positions of the block */
+    for (int l = 0; l < count; l++) {
+      block.x[l] = sparts[k_start + l].x[0];
+      block.y[l] = sparts[k_start + l].x[1];
+      block.z[l] = sparts[k_start + l].x[2];
+    }
+
+    /* Wrap them and get their cell indices */
+    space_get_cell_index_block(s, &block, count);
+
+    for (int l = 0; l < count; l++) {
 
-    const double old_pos_x = sp->x[0];
-    const double old_pos_y = sp->x[1];
-    const double old_pos_z = sp->x[2];
+      /* Get the particle */
+      const int k = k_start + l;
+      struct spart *restrict sp = &sparts[k];
 
 #ifdef SWIFT_DEBUG_CHECKS
-    if (!s->periodic && sp->time_bin != time_bin_inhibited) {
-      if (old_pos_x < 0. || old_pos_x > dim_x)
-        error("Particle outside of volume along X.");
-      if (old_pos_y < 0. || old_pos_y > dim_y)
-        error("Particle outside of volume along Y.");
-      if (old_pos_z < 0. || old_pos_z > dim_z)
-        error("Particle outside of volume along Z.");
-    }
+      const double old_pos_x = sp->x[0];
+      const double old_pos_y = sp->x[1];
+      const double old_pos_z = sp->x[2];
+
+      if (!s->periodic && sp->time_bin != time_bin_inhibited) {
+        if (old_pos_x < 0. || old_pos_x > dim_x)
+          error("Particle outside of volume along X.");
+        if (old_pos_y < 0. || old_pos_y > dim_y)
+          error("Particle outside of volume along Y.");
+        if (old_pos_z < 0. || old_pos_z > dim_z)
+          error("Particle outside of volume along Z.");
+      }
 #endif
 
-    /* Put it back into the simulation volume */
-    const double pos_x = box_wrap(old_pos_x, 0.0, dim_x);
-    const double pos_y = box_wrap(old_pos_y, 0.0, dim_y);
-    const double pos_z = box_wrap(old_pos_z, 0.0, dim_z);
-
-    /* Get its cell index */
-    const int index =
-        cell_getid(cdim, pos_x * ih_x, pos_y * ih_y, pos_z * ih_z);
+      /* Its position back in the simulation volume and its cell index */
+      const double pos_x = block.x[l];
+      const double pos_y = block.y[l];
+      const double pos_z = block.z[l];
+      const int index = block.index[l];
 
 #ifdef SWIFT_DEBUG_CHECKS
-    if (index < 0 || index >= cdim[0] * cdim[1] * cdim[2])
-      error("Invalid index=%d cdim=[%d %d %d] p->x=[%e %e %e]", index, cdim[0],
-            cdim[1], cdim[2], pos_x, pos_y, pos_z);
-
-    if (pos_x >= dim_x || pos_y >= dim_y || pos_z >= dim_z || pos_x < 0. ||
-        pos_y < 0. || pos_z < 0.)
-      error("Particle outside of simulation box. p->x=[%e %e %e]", pos_x, pos_y,
-            pos_z);
+      if (index < 0 || index >= cdim[0] * cdim[1] * cdim[2])
+        error("Invalid index=%d cdim=[%d %d %d] p->x=[%e %e %e]", index,
+              cdim[0], cdim[1], cdim[2], pos_x, pos_y, pos_z);
+
+      if (pos_x >= dim_x || pos_y >= dim_y || pos_z >= dim_z || pos_x < 0. ||
+          pos_y < 0. || pos_z < 0.)
+        error("Particle outside of simulation box. p->x=[%e %e %e]", pos_x,
+              pos_y, pos_z);
 #endif
 
-    /* Is this particle to be removed? */
-    if (sp->time_bin == time_bin_inhibited) {
-      ind[k] = -1;
-      ++count_inhibited_spart;
-    } else if (sp->time_bin == time_bin_not_created) {
-      /* Is this a place-holder for on-the-fly creation? */
-      ind[k] = index;
-      cell_counts[index]++;
-      ++count_extra_spart;
-    } else {
-      /* List its top-level cell index */
-      ind[k] = index;
-      cell_counts[index]++;
+      /* Is this particle to be removed? */
+      if (sp->time_bin == time_bin_inhibited) {
+        ind[k] = -1;
+        ++count_inhibited_spart;
+      } else if (sp->time_bin == time_bin_not_created) {
+        /* Is this a place-holder for on-the-fly creation? */
+        ind[k] = index;
+        cell_counts[index]++;
+        ++count_extra_spart;
+      } else {
+        /* List its top-level cell index */
+        ind[k] = index;
+        cell_counts[index]++;
 
-      /* Compute minimal mass */
-      min_mass = min(min_mass, sp->mass);
+        /* Compute minimal mass */
+        min_mass = min(min_mass, sp->mass);
 
-      /* Compute sum of velocity norm */
-      sum_vel_norm +=
-          sp->v[0] * sp->v[0] + sp->v[1] * sp->v[1] + sp->v[2] * sp->v[2];
+        /* Compute sum of velocity norm */
+        sum_vel_norm +=
+            sp->v[0] * sp->v[0] + sp->v[1] * sp->v[1] + sp->v[2] * sp->v[2];
 
-      /* Update the position */
-      sp->x[0] = pos_x;
-      sp->x[1] = pos_y;
-      sp->x[2] = pos_z;
+        /* Update the position */
+        sp->x[0] = pos_x;
+        sp->x[1] = pos_y;
+        sp->x[2] = pos_z;
+      }
     }
   }
 
@@ -2430,14 +3237,16 @@ void space_bparts_get_cell_index_mapper(void *map_data, int nr_bparts,
   struct space *s = data->s;
   int *const ind = data->ind + (ptrdiff_t)(bparts - s->bparts);
 
+#ifdef SWIFT_DEBUG_CHECKS
   /* Get some constants */
   const double dim_x = s->dim[0];
   const double dim_y = s->dim[1];
   const double dim_z = s->dim[2];
-  const int cdim[3] = {s->cdim[0], s->cdim[1], s->cdim[2]};
-  const double ih_x = s->iwidth[0];
-  const double ih_y = s->iwidth[1];
-  const double ih_z = s->iwidth[2];
+  const int *cdim = s->cdim;
+#endif
+
+  /* Positions and cell indices of the current block of particles */
+  struct space_index_block block;
 
   /* Init the local count buffer. */
   int *cell_counts = (int *)calloc(sizeof(int), s->nr_cells);
@@ -2450,71 +3259,86 @@ void space_bparts_get_cell_index_mapper(void *map_data, int nr_bparts,
   size_t count_inhibited_bpart = 0;
   size_t count_extra_bpart = 0;
 
-  for (int k = 0; k < nr_bparts; k++) {
+  /* Loop over the bparts in blocks. */
+  for (int k_start = 0; k_start < nr_bparts;
+       k_start += space_index_block_size) {
 
-    /* Get the particle */
-    struct bpart *restrict bp = &bparts[k];
+    const int count = min(space_index_block_size, nr_bparts - k_start);
+
+    /* Gather the positions of the block */
+    for (int l = 0; l < count; l++) {
+      block.x[l] = bparts[k_start + l].x[0];
+      block.y[l] = bparts[k_start + l].x[1];
+      block.z[l] = bparts[k_start + l].x[2];
+    }
+
+    /* Wrap them and get their cell indices */
+    space_get_cell_index_block(s, &block, count);
+
+    for (int l = 0; l < count; l++) {
 
-    const double old_pos_x = bp->x[0];
-    const double old_pos_y = bp->x[1];
-    const double old_pos_z = bp->x[2];
+      /* Get the particle */
+      const int k = k_start + l;
+      struct bpart *restrict bp = &bparts[k];
 
 #ifdef SWIFT_DEBUG_CHECKS
-    if (!s->periodic) {
-      if (old_pos_x < 0. || old_pos_x > dim_x)
-        error("Particle outside of volume along X.");
-      if (old_pos_y < 0. || old_pos_y > dim_y)
-        error("Particle outside of volume along Y.");
-      if (old_pos_z < 0. || old_pos_z > dim_z)
-        error("Particle outside of volume along Z.");
-    }
+      const double old_pos_x = bp->x[0];
+      const double old_pos_y = bp->x[1];
+      const double old_pos_z = bp->x[2];
+
+      if (!s->periodic) {
+        if (old_pos_x < 0. || old_pos_x > dim_x)
+          error("Particle outside of volume along X.");
+        if (old_pos_y < 0. || old_pos_y > dim_y)
+          error("Particle outside of volume along Y.");
+        if (old_pos_z < 0. || old_pos_z > dim_z)
+          error("Particle outside of volume along Z.");
+      }
 #endif
 
-    /* Put it back into the simulation volume */
-    const double pos_x = box_wrap(old_pos_x, 0.0, dim_x);
-    const double pos_y = box_wrap(old_pos_y, 0.0, dim_y);
-    const double pos_z = box_wrap(old_pos_z, 0.0, dim_z);
-
-    /* Get its cell index */
-    const int index =
-        cell_getid(cdim, pos_x * ih_x, pos_y * ih_y, pos_z * ih_z);
+      /* Its position back in the simulation volume and its cell index */
+      const double pos_x = block.x[l];
+      const double pos_y = block.y[l];
+      const double pos_z = block.z[l];
+      const int index = block.index[l];
 
 #ifdef SWIFT_DEBUG_CHECKS
-    if (index < 0 || index >= cdim[0] * cdim[1] * cdim[2])
-      error("Invalid index=%d cdim=[%d %d %d] p->x=[%e %e %e]", index, cdim[0],
-            cdim[1], cdim[2], pos_x, pos_y, pos_z);
-
-    if (pos_x >= dim_x || pos_y >= dim_y || pos_z >= dim_z || pos_x < 0. ||
-        pos_y < 0. || pos_z < 0.)
-      error("Particle outside of simulation box. p->x=[%e %e %e]", pos_x, pos_y,
-            pos_z);
+      if (index < 0 || index >= cdim[0] * cdim[1] * cdim[2])
+        error("Invalid index=%d cdim=[%d %d %d] p->x=[%e %e %e]", index,
+              cdim[0], cdim[1], cdim[2], pos_x, pos_y, pos_z);
+
+      if (pos_x >= dim_x || pos_y >= dim_y || pos_z >= dim_z || pos_x < 0. ||
+          pos_y < 0. || pos_z < 0.)
+        error("Particle outside of simulation box. p->x=[%e %e %e]", pos_x,
+              pos_y, pos_z);
 #endif
 
-    /* Is this particle to be removed? */
-    if (bp->time_bin == time_bin_inhibited) {
-      ind[k] = -1;
-      ++count_inhibited_bpart;
-    } else if (bp->time_bin == time_bin_not_created) {
-      /* Is this a place-holder for on-the-fly creation? */
-      ind[k] = index;
-      cell_counts[index]++;
-      ++count_extra_bpart;
-    } else {
-      /* List its top-level cell index */
-      ind[k] = index;
-      cell_counts[index]++;
+      /* Is this particle to be removed? */
+      if (bp->time_bin == time_bin_inhibited) {
+        ind[k] = -1;
+        ++count_inhibited_bpart;
+      } else if (bp->time_bin == time_bin_not_created) {
+        /* Is this a place-holder for on-the-fly creation? */
+        ind[k] = index;
+        cell_counts[index]++;
+        ++count_extra_bpart;
+      } else {
+        /* List its top-level cell index */
+        ind[k] = index;
+        cell_counts[index]++;
 
-      /* Compute minimal mass */
-      min_mass = min(min_mass, bp->mass);
+        /* Compute minimal mass */
+        min_mass = min(min_mass, bp->mass);
 
-      /* Compute sum of velocity norm */
-      sum_vel_norm +=
-          bp->v[0] * bp->v[0] + bp->v[1] * bp->v[1] + bp->v[2] * bp->v[2];
+        /* Compute sum of velocity norm */
+        sum_vel_norm +=
+            bp->v[0] * bp->v[0] + bp->v[1] * bp->v[1] + bp->v[2] * bp->v[2];
 
-      /* Update the position */
-      bp->x[0] = pos_x;
-      bp->x[1] = pos_y;
-      bp->x[2] = pos_z;
+        /* Update the position */
+        bp->x[0] = pos_x;
+        bp->x[1] = pos_y;
+        bp->x[2] = pos_z;
+      }
     }
   }
 
@@ -2726,10 +3550,304 @@ void space_bparts_get_cell_index(struct space *s, int *bind, int *cell_counts,
             clocks_getunit());
 }
 
+/**
+ * @brief Shared information for the threaded counting sort of particle
+ * arrays.
+ */
+struct space_sort_data {
+
+  /*! The bin of each element */
+  int *ind;
+
+  /*! The sorted bins (scratch) */
+  int *ind_sorted;
+
+  /*! The arrays to sort and their sorted (scratch) counterparts */
+  char *arrays[2];
+  char *sorted[2];
+
+  /*! Size of the elements of each array */
+  size_t sizes[2];
+
+  /*! Number of arrays to sort in lock-step */
+  int nr_arrays;
+
+  /*! Total number of elements and of bins */
+  size_t count;
+  int num_bins;
+
+  /*! Start of each bin in the sorted arrays */
+  size_t *offsets;
+
+  /*! Number of contiguous chunks the elements are split into */
+  int nr_chunks;
+
+  /*! Per-chunk bin counts and then write positions (nr_chunks x num_bins) */
+  size_t *chunk_offsets;
+};
+
+/**
+ * @brief Threadpool mapper building the histogram of bins of a set of chunks.
+ */
+void space_sort_histogram_mapper(void *map_data, int num, void *extra) {
+
+  struct space_sort_data *data = (struct space_sort_data *)extra;
+  const int *chunks = (int *)map_data;
+
+  for (int c = 0; c < num; ++c) {
+    const int chunk = chunks[c];
+    const size_t lo = (data->count * chunk) / data->nr_chunks;
+    const size_t hi = (data->count * (chunk + 1)) / data->nr_chunks;
+    size_t *restrict hist = &data->chunk_offsets[chunk * data->num_bins];
+
+    for (size_t k = lo; k < hi; ++k) hist[data->ind[k]]++;
+  }
+}
+
+/**
+ * @brief Threadpool mapper turning the per-chunk histograms of a set of bins
+ * into write positions.
+ */
+void space_sort_prefix_mapper(void *map_data, int num, void *extra) {
+
+  struct space_sort_data *data = (struct space_sort_data *)extra;
+  const size_t *offsets = (size_t *)map_data;
+  const int first_bin = offsets - data->offsets;
+
+  for (int b = 0; b < num; ++b) {
+    const int bin = first_bin + b;
+    size_t pos = offsets[b];
+    for (int chunk = 0; chunk < data->nr_chunks; ++chunk) {
+      size_t *h = &data->chunk_offsets[chunk * data->num_bins + bin];
+      const size_t temp = *h;
+      *h = pos;
+      pos += temp;
+    }
+  }
+}
+
+/**
+ * @brief Threadpool mapper scattering the elements of a set of chunks to
+ * their sorted position in the scratch arrays.
+ */
+void space_sort_scatter_mapper(void *map_data, int num, void *extra) {
+
+  struct space_sort_data *data = (struct space_sort_data *)extra;
+  const int *chunks = (int *)map_data;
+
+  for (int c = 0; c < num; ++c) {
+    const int chunk = chunks[c];
+    const size_t lo = (data->count * chunk) / data->nr_chunks;
+    const size_t hi = (data->count * (chunk + 1)) / data->nr_chunks;
+    size_t *restrict pos = &data->chunk_offsets[chunk * data->num_bins];
+
+    for (size_t k = lo; k < hi; ++k) {
+      const int bin = data->ind[k];
+      const size_t dest = pos[bin]++;
+      data->ind_sorted[dest] = bin;
+      for (int a = 0; a < data->nr_arrays; ++a)
+        memcpy(data->sorted[a] + dest * data->sizes[a],
+               data->arrays[a] + k * data->sizes[a], data->sizes[a]);
+    }
+  }
+}
+
+/**
+ * @brief Threadpool mapper copying a range of the sorted scratch arrays back
+ * to the original ones.
+ */
+void space_sort_copy_back_mapper(void *map_data, int num, void *extra) {
+
+  struct space_sort_data *data = (struct space_sort_data *)extra;
+  const size_t first = (int *)map_data - data->ind_sorted;
+
+  memcpy(&data->ind[first], &data->ind_sorted[first], num * sizeof(int));
+  for (int a = 0; a < data->nr_arrays; ++a)
+    memcpy(data->arrays[a] + first * data->sizes[a],
+           data->sorted[a] + first * data->sizes[a], num * data->sizes[a]);
+}
+
+/**
+ * @brief Sort up to two arrays in lock-step according to the given bins using
+ * a threaded counting sort.
+ *
+ * Every thread builds the histogram of a contiguous chunk of the elements,
+ * the histograms are turned into write positions and the elements are then
+ * scattered in parallel to a scratch buffer that is finally copied back. The
+ * sort is stable, so the result does not depend on the number of threads.
+ *
+ * @param tp The #threadpool to use.
+ * @param ind The bin of each element.
+ * @param counts Number of elements per bin.
+ * @param num_bins Total number of bins (length of counts).
+ * @param array0 The first array to sort.
+ * @param size0 The size of the elements of the first array.
+ * @param array1 The second array to sort (or NULL).
+ * @param size1 The size of the elements of the second array.
+ */
+static void space_sort_threaded(struct threadpool *tp, int *ind,
+                                const int *counts, int num_bins, void *array0,
+                                size_t size0, void *array1, size_t size1) {
+
+  struct space_sort_data data;
+  data.ind = ind;
+  data.num_bins = num_bins;
+  data.nr_chunks = tp->num_threads;
+  data.nr_arrays = (array1 != NULL) ? 2 : 1;
+  data.arrays[0] = (char *)array0;
+  data.arrays[1] = (char *)array1;
+  data.sizes[0] = size0;
+  data.sizes[1] = size1;
+
+  /* Start of each bin */
+  if (swift_memalign("sort_offsets", (void **)&data.offsets,
+                     SWIFT_STRUCT_ALIGNMENT,
+                     sizeof(size_t) * (num_bins + 1)) != 0)
+    error("Failed to allocate temporary cell offsets array.");
+  data.offsets[0] = 0;
+  for (int k = 1; k <= num_bins; k++)
+    data.offsets[k] = data.offsets[k - 1] + counts[k - 1];
+  data.count = data.offsets[num_bins];
+
+  /* Scratch space */
+  data.chunk_offsets = (size_t *)swift_malloc(
+      "sort_chunk_offsets", sizeof(size_t) * data.nr_chunks * num_bins);
+  data.ind_sorted =
+      (int *)swift_malloc("sort_ind_sorted", sizeof(int) * data.count);
+  int *chunks = (int *)malloc(sizeof(int) * data.nr_chunks);
+  if (data.chunk_offsets == NULL || data.ind_sorted == NULL || chunks == NULL)
+    error("Failed to allocate the threaded sort buffers.");
+  for (int a = 0; a < data.nr_arrays; ++a) {
+    if (swift_memalign("sort_scratch", (void **)&data.sorted[a],
+                       SWIFT_STRUCT_ALIGNMENT, data.sizes[a] * data.count) != 0)
+      error("Failed to allocate the threaded sort scratch array.");
+  }
+  bzero(data.chunk_offsets, sizeof(size_t) * data.nr_chunks * num_bins);
+  for (int k = 0; k < data.nr_chunks; ++k) chunks[k] = k;
+
+  /* Per-chunk histograms */
+  threadpool_map(tp, space_sort_histogram_mapper, chunks, data.nr_chunks,
+                 sizeof(int), 1, &data);
+
+  /* Exclusive prefix sum over the chunks for each bin */
+  threadpool_map(tp, space_sort_prefix_mapper, data.offsets, num_bins,
+                 sizeof(size_t), 0, &data);
+
+  /* Move everything to its final position */
+  threadpool_map(tp, space_sort_scatter_mapper, chunks, data.nr_chunks,
+                 sizeof(int), 1, &data);
+
+  /* And copy back */
+  threadpool_map(tp, space_sort_copy_back_mapper, data.ind_sorted, data.count,
+                 sizeof(int), 0, &data);
+
+  for (int a = 0; a < data.nr_arrays; ++a)
+    swift_free("sort_scratch", data.sorted[a]);
+  swift_free("sort_ind_sorted", data.ind_sorted);
+  swift_free("sort_chunk_offsets", data.chunk_offsets);
+  swift_free("sort_offsets", data.offsets);
+  free(chunks);
+}
+
+/**
+ * @brief Total number of elements in a set of bins.
+ */
+INLINE static size_t space_sort_count(const int *counts, int num_bins) {
+
+  size_t count = 0;
+  for (int k = 0; k < num_bins; ++k) count += counts[k];
+  return count;
+}
+
+/**
+ * @brief Should we use the threaded sort for this number of elements?
+ */
+INLINE static int space_sort_use_threads(const struct threadpool *tp,
+                                         const int *counts, int num_bins) {
+
+  if (tp == NULL || tp->num_threads <= 1) return 0;
+  return space_sort_count(counts, num_bins) >= space_threaded_sort_min_count;
+}
+
+/**
+ * @brief Information passed to the mappers re-linking the particles after a
+ * threaded sort.
+ */
+struct space_sort_relink_data {
+  void *base;
+  ptrdiff_t offset;
+  struct part *parts;
+  struct spart *sparts;
+  struct bpart *bparts;
+};
+
+/**
+ * @brief Threadpool mapper updating the #gpart links of a set of #part.
+ */
+void space_sort_relink_parts_mapper(void *map_data, int num, void *extra) {
+
+  struct space_sort_relink_data *data = (struct space_sort_relink_data *)extra;
+  struct part *parts = (struct part *)map_data;
+  const ptrdiff_t first = parts - (struct part *)data->base + data->offset;
+
+  for (int k = 0; k < num; ++k)
+    if (parts[k].gpart) parts[k].gpart->id_or_neg_offset = -(k + first);
+}
+
+/**
+ * @brief Threadpool mapper updating the #gpart links of a set of #spart.
+ */
+void space_sort_relink_sparts_mapper(void *map_data, int num, void *extra) {
+
+  struct space_sort_relink_data *data = (struct space_sort_relink_data *)extra;
+  struct spart *sparts = (struct spart *)map_data;
+  const ptrdiff_t first = sparts - (struct spart *)data->base + data->offset;
+
+  for (int k = 0; k < num; ++k)
+    if (sparts[k].gpart) sparts[k].gpart->id_or_neg_offset = -(k + first);
+}
+
+/**
+ * @brief Threadpool mapper updating the #gpart links of a set of #bpart.
+ */
+void space_sort_relink_bparts_mapper(void *map_data, int num, void *extra) {
+
+  struct space_sort_relink_data *data = (struct space_sort_relink_data *)extra;
+  struct bpart *bparts = (struct bpart *)map_data;
+  const ptrdiff_t first = bparts - (struct bpart *)data->base + data->offset;
+
+  for (int k = 0; k < num; ++k)
+    if (bparts[k].gpart) bparts[k].gpart->id_or_neg_offset = -(k + first);
+}
+
+/**
+ * @brief Threadpool mapper updating the links of the particles pointed at by
+ * a set of #gpart.
+ */
+void space_sort_relink_gparts_mapper(void *map_data, int num, void *extra) {
+
+  struct space_sort_relink_data *data = (struct space_sort_relink_data *)extra;
+  struct gpart *gparts = (struct gpart *)map_data;
+
+  for (int k = 0; k < num; ++k) {
+    if (gparts[k].type == swift_type_gas) {
+      data->parts[-gparts[k].id_or_neg_offset].gpart = &gparts[k];
+    } else if (gparts[k].type == swift_type_stars) {
+      data->sparts[-gparts[k].id_or_neg_offset].gpart = &gparts[k];
+    } else if (gparts[k].type == swift_type_black_hole) {
+      data->bparts[-gparts[k].id_or_neg_offset].gpart = &gparts[k];
+    }
+  }
+}
+
 /**
  * @brief Sort the particles and condensed particles according to the given
  * indices.
  *
+ * Large arrays are sorted with a threaded counting sort when a #threadpool
+ * is provided, small ones with a serial in-place cycle sort.
+ *
+ * @param tp The #threadpool to use (can be NULL).
  * @param parts The array of #part to sort.
  * @param xparts The corresponding #xpart array to sort as well.
  * @param ind The indices with respect to which the parts are sorted.
@@ -2737,9 +3855,24 @@ void space_bparts_get_cell_index(struct space *s, int *bind, int *cell_counts,
  * @param num_bins Total number of bins (length of count).
  * @param parts_offset Offset of the #part array from the global #part array.
  */
-void space_parts_sort(struct part *parts, struct xpart *xparts,
-                      int *restrict ind, int *restrict counts, int num_bins,
+void space_parts_sort(struct threadpool *tp, struct part *parts,
+                      struct xpart *xparts, int *restrict ind,
+                      int *restrict counts, int num_bins,
                       ptrdiff_t parts_offset) {
+
+  if (space_sort_use_threads(tp, counts, num_bins)) {
+    space_sort_threaded(tp, ind, counts, num_bins, parts, sizeof(struct part),
+                        xparts, sizeof(struct xpart));
+
+    struct space_sort_relink_data data;
+    data.base = parts;
+    data.offset = parts_offset;
+    threadpool_map(tp, space_sort_relink_parts_mapper, parts,
+                   space_sort_count(counts, num_bins), sizeof(struct part), 0,
+                   &data);
+    return;
+  }
+
   /* Create the offsets array. */
   size_t *offsets = NULL;
   if (swift_memalign("parts_offsets", (void **)&offsets, SWIFT_STRUCT_ALIGNMENT,
@@ -2793,6 +3926,7 @@ void space_parts_sort(struct part *parts, struct xpart *xparts,
 /**
  * @brief Sort the s-particles according to the given indices.
  *
+ * @param tp The #threadpool to use (can be NULL).
  * @param sparts The array of #spart to sort.
  * @param ind The indices with respect to which the #spart are sorted.
  * @param counts Number of particles per index.
@@ -2800,9 +3934,23 @@ void space_parts_sort(struct part *parts, struct xpart *xparts,
  * @param sparts_offset Offset of the #spart array from the global #spart.
  * array.
  */
-void space_sparts_sort(struct spart *sparts, int *restrict ind,
-                       int *restrict counts, int num_bins,
+void space_sparts_sort(struct threadpool *tp, struct spart *sparts,
+                       int *restrict ind, int *restrict counts, int num_bins,
                        ptrdiff_t sparts_offset) {
+
+  if (space_sort_use_threads(tp, counts, num_bins)) {
+    space_sort_threaded(tp, ind, counts, num_bins, sparts,
+                        sizeof(struct spart), NULL, 0);
+
+    struct space_sort_relink_data data;
+    data.base = sparts;
+    data.offset = sparts_offset;
+    threadpool_map(tp, space_sort_relink_sparts_mapper, sparts,
+                   space_sort_count(counts, num_bins), sizeof(struct spart), 0,
+                   &data);
+    return;
+  }
+
   /* Create the offsets array. */
   size_t *offsets = NULL;
   if (swift_memalign("sparts_offsets", (void **)&offsets,
@@ -2854,6 +4002,7 @@ void space_sparts_sort(struct spart *sparts, int *restrict ind,
 /**
  * @brief Sort the b-particles according to the given indices.
  *
+ * @param tp The #threadpool to use (can be NULL).
  * @param bparts The array of #bpart to sort.
  * @param ind The indices with respect to which the #bpart are sorted.
  * @param counts Number of particles per index.
@@ -2861,9 +4010,23 @@ void space_sparts_sort(struct spart *sparts, int *restrict ind,
  * @param bparts_offset Offset of the #bpart array from the global #bpart.
  * array.
  */
-void space_bparts_sort(struct bpart *bparts, int *restrict ind,
-                       int *restrict counts, int num_bins,
+void space_bparts_sort(struct threadpool *tp, struct bpart *bparts,
+                       int *restrict ind, int *restrict counts, int num_bins,
                        ptrdiff_t bparts_offset) {
+
+  if (space_sort_use_threads(tp, counts, num_bins)) {
+    space_sort_threaded(tp, ind, counts, num_bins, bparts,
+                        sizeof(struct bpart), NULL, 0);
+
+    struct space_sort_relink_data data;
+    data.base = bparts;
+    data.offset = bparts_offset;
+    threadpool_map(tp, space_sort_relink_bparts_mapper, bparts,
+                   space_sort_count(counts, num_bins), sizeof(struct bpart), 0,
+                   &data);
+    return;
+  }
+
   /* Create the offsets array. */
   size_t *offsets = NULL;
   if (swift_memalign("bparts_offsets", (void **)&offsets,
@@ -2915,6 +4078,7 @@ void space_bparts_sort(struct bpart *bparts, int *restrict ind,
 /**
  * @brief Sort the g-particles according to the given indices.
  *
+ * @param tp The #threadpool to use (can be NULL).
  * @param gparts The array of #gpart to sort.
  * @param parts Global #part array for re-linking.
  * @param sparts Global #spart array for re-linking.
@@ -2923,9 +4087,25 @@ void space_bparts_sort(struct bpart *bparts, int *restrict ind,
  * @param counts Number of particles per index.
  * @param num_bins Total number of bins (length of counts).
  */
-void space_gparts_sort(struct gpart *gparts, struct part *parts,
-                       struct spart *sparts, struct bpart *bparts,
-                       int *restrict ind, int *restrict counts, int num_bins) {
+void space_gparts_sort(struct threadpool *tp, struct gpart *gparts,
+                       struct part *parts, struct spart *sparts,
+                       struct bpart *bparts, int *restrict ind,
+                       int *restrict counts, int num_bins) {
+
+  if (space_sort_use_threads(tp, counts, num_bins)) {
+    space_sort_threaded(tp, ind, counts, num_bins, gparts,
+                        sizeof(struct gpart), NULL, 0);
+
+    struct space_sort_relink_data data;
+    data.parts = parts;
+    data.sparts = sparts;
+    data.bparts = bparts;
+    threadpool_map(tp, space_sort_relink_gparts_mapper, gparts,
+                   space_sort_count(counts, num_bins), sizeof(struct gpart), 0,
+                   &data);
+    return;
+  }
+
   /* Create the offsets array. */
   size_t *offsets = NULL;
   if (swift_memalign("gparts_offsets", (void **)&offsets,
@@ -2990,6 +4170,8 @@ void space_gparts_sort(struct gpart *gparts, struct part *parts,
 void space_map_clearsort(struct cell *c, void *data) {
 
   cell_free_hydro_sorts(c);
+  cell_free_hydro_bins(c);
+  cell_free_hydro_soa(c);
   cell_free_stars_sorts(c);
 }
 
@@ -3176,6 +4358,12 @@ void space_split_recursive(struct space *s, struct cell *c,
   struct xpart *xparts = c->hydro.xparts;
   struct engine *e = s->e;
   const integertime_t ti_current = e->ti_current;
+  const int with_feedback = (e->policy & engine_policy_feedback);
+  const int with_cosmology = (e->policy & engine_policy_cosmology);
+  int stars_do_feedback = 0;
+
+  /* The particles are moving around, so the time-bin list is out of date. */
+  c->hydro.bins_count = -1;
 
   /* If the buff is NULL, allocate it, and remember to free it. */
   const int allocate_buffer =
@@ -3259,15 +4447,15 @@ void space_split_recursive(struct space *s, struct cell *c,
   }
 
   /* Split or let it be? */
-  if ((with_self_gravity && gcount > space_splitsize) ||
-      (!with_self_gravity &&
-       (count > space_splitsize || scount > space_splitsize))) {
+  const long long splitsize = space_cell_split_size(s, c, space_splitsize, 1);
+  if ((with_self_gravity && gcount > splitsize) ||
+      (!with_self_gravity && (count > splitsize || scount > splitsize))) {
+
+    /* Create the cell's progeny. */
+    space_getprogeny(s, c);
 
     /* No longer just a leaf. */
     c->split = 1;
-
-    /* Create the cell's progeny. */
-    space_getcells(s, 8, c->progeny);
     for (int k = 0; k < 8; k++) {
       struct cell *cp = c->progeny[k];
       cp->hydro.count = 0;
@@ -3294,7 +4482,6 @@ void space_split_recursive(struct space *s, struct cell *c,
       if (k & 2) cp->loc[1] += cp->width[1];
       if (k & 1) cp->loc[2] += cp->width[2];
       cp->depth = c->depth + 1;
-      cp->split = 0;
       cp->hydro.h_max = 0.f;
       cp->hydro.dx_max_part = 0.f;
       cp->hydro.dx_max_sort = 0.f;
@@ -3335,6 +4522,7 @@ void space_split_recursive(struct space *s, struct cell *c,
       if (cp->hydro.count == 0 && cp->grav.count == 0 && cp->stars.count == 0 &&
           cp->black_holes.count == 0) {
 
+        if (cp->split) space_recycle_progeny(s, cp);
         space_recycle(s, cp);
         c->progeny[k] = NULL;
 
@@ -3353,6 +4541,7 @@ void space_split_recursive(struct space *s, struct cell *c,
         /* Update the cell-wide properties */
         h_max = max(h_max, cp->hydro.h_max);
         stars_h_max = max(stars_h_max, cp->stars.h_max);
+        stars_do_feedback |= cp->stars.do_feedback;
         black_holes_h_max = max(black_holes_h_max, cp->black_holes.h_max);
         ti_hydro_end_min = min(ti_hydro_end_min, cp->hydro.ti_end_min);
         ti_hydro_end_max = max(ti_hydro_end_max, cp->hydro.ti_end_max);
@@ -3387,6 +4576,7 @@ void space_split_recursive(struct space *s, struct cell *c,
       double vel[3] = {0., 0., 0.};
       float max_delta_vel[3] = {0.f, 0.f, 0.f};
       float min_delta_vel[3] = {0.f, 0.f, 0.f};
+      float min_old_a_grav_norm = FLT_MAX;
       double mass = 0.;
 
       for (int k = 0; k < 8; ++k) {
@@ -3410,6 +4600,10 @@ void space_split_recursive(struct space *s, struct cell *c,
           min_delta_vel[0] = min(m->m_pole.min_delta_vel[0], min_delta_vel[0]);
           min_delta_vel[1] = min(m->m_pole.min_delta_vel[1], min_delta_vel[1]);
           min_delta_vel[2] = min(m->m_pole.min_delta_vel[2], min_delta_vel[2]);
+
+          if (m->m_pole.M_000 != 0.f)
+            min_old_a_grav_norm =
+                min(m->m_pole.min_old_a_grav_norm, min_old_a_grav_norm);
         }
       }
 
@@ -3429,6 +4623,7 @@ void space_split_recursive(struct space *s, struct cell *c,
       c->grav.multipole->m_pole.min_delta_vel[0] = min_delta_vel[0];
       c->grav.multipole->m_pole.min_delta_vel[1] = min_delta_vel[1];
       c->grav.multipole->m_pole.min_delta_vel[2] = min_delta_vel[2];
+      c->grav.multipole->m_pole.min_old_a_grav_norm = min_old_a_grav_norm;
 
       /* Now shift progeny multipoles and add them up */
       struct multipole temp;
@@ -3490,6 +4685,7 @@ void space_split_recursive(struct space *s, struct cell *c,
   else {
 
     /* Clear the progeny. */
+    if (c->split) space_recycle_progeny(s, c);
     bzero(c->progeny, sizeof(struct cell *) * 8);
     c->split = 0;
     maxdepth = c->depth;
@@ -3546,6 +4742,9 @@ void space_split_recursive(struct space *s, struct cell *c,
       stars_time_bin_min = min(stars_time_bin_min, sparts[k].time_bin);
       stars_time_bin_max = max(stars_time_bin_max, sparts[k].time_bin);
       stars_h_max = max(stars_h_max, sparts[k].h);
+      if (with_feedback &&
+          !feedback_is_exhausted(&sparts[k], e->feedback_props, with_cosmology))
+        stars_do_feedback = 1;
 
       /* Reset x_diff */
       sparts[k].x_diff[0] = 0.f;
@@ -3633,6 +4832,7 @@ void space_split_recursive(struct space *s, struct cell *c,
   c->stars.ti_end_max = ti_stars_end_max;
   c->stars.ti_beg_max = ti_stars_beg_max;
   c->stars.h_max = stars_h_max;
+  c->stars.do_feedback = stars_do_feedback;
   c->black_holes.ti_end_min = ti_black_holes_end_min;
   c->black_holes.ti_end_max = ti_black_holes_end_max;
   c->black_holes.ti_beg_max = ti_black_holes_beg_max;
@@ -3655,44 +4855,368 @@ void space_split_recursive(struct space *s, struct cell *c,
   else
     c->owner = 0; /* Ok, there is really nothing on this rank... */
 
-  /* Clean up. */
-  if (allocate_buffer) {
-    if (buff != NULL) swift_free("tempbuff", buff);
-    if (gbuff != NULL) swift_free("tempgbuff", gbuff);
-    if (sbuff != NULL) swift_free("tempsbuff", sbuff);
-    if (bbuff != NULL) swift_free("tempbbuff", bbuff);
+  /* Clean up. */
+  if (allocate_buffer) {
+    if (buff != NULL) swift_free("tempbuff", buff);
+    if (gbuff != NULL) swift_free("tempgbuff", gbuff);
+    if (sbuff != NULL) swift_free("tempsbuff", sbuff);
+    if (bbuff != NULL) swift_free("tempbbuff", bbuff);
+  }
+}
+
+/**
+ * @brief #threadpool mapper function to split cells if they contain
+ *        too many particles.
+ *
+ * @param map_data Pointer towards the top-cells.
+ * @param num_cells The number of cells to treat.
+ * @param extra_data Pointers to the #space.
+ */
+void space_split_mapper(void *map_data, int num_cells, void *extra_data) {
+
+  /* Unpack the inputs. */
+  struct space *s = (struct space *)extra_data;
+  struct cell *cells_top = s->cells_top;
+  int *local_cells_with_particles = (int *)map_data;
+
+  /* Loop over the non-empty cells */
+  for (int ind = 0; ind < num_cells; ind++) {
+    struct cell *c = &cells_top[local_cells_with_particles[ind]];
+    space_split_recursive(s, c, NULL, NULL, NULL, NULL);
+  }
+
+#ifdef SWIFT_DEBUG_CHECKS
+  /* All cells and particles should have consistent h_max values. */
+  for (int ind = 0; ind < num_cells; ind++) {
+    int depth = 0;
+    const struct cell *c = &cells_top[local_cells_with_particles[ind]];
+    if (!checkCellhdxmax(c, &depth)) message("    at cell depth %d", depth);
+  }
+#endif
+}
+
+/**
+ * @brief Data shared by the mappers of space_rebuild_local().
+ */
+struct space_rebuild_local_data {
+
+  /*! The #space */
+  struct space *s;
+
+  /*! Largest interaction radius of any particle */
+  float h_max;
+
+  /*! Number of particles of each type found in their top-level cell */
+  size_t counts[4];
+
+  /*! Did any particle leave its top-level cell? */
+  int moved;
+
+  /*! List of the top-level cells to split again */
+  int *dirty;
+
+  /*! Number of top-level cells to split again */
+  int nr_dirty;
+};
+
+/**
+ * @brief Is a position still within a given top-level cell?
+ *
+ * This uses the same arithmetic as the construction of the top-level cell
+ * indices in space_rebuild().
+ *
+ * @param s The #space.
+ * @param x The position.
+ * @param cid The index of the top-level cell.
+ */
+__attribute__((always_inline)) INLINE static int space_in_top_cell(
+    const struct space *s, const double x[3], const int cid) {
+
+  if (x[0] < 0. || x[0] >= s->dim[0] || x[1] < 0. || x[1] >= s->dim[1] ||
+      x[2] < 0. || x[2] >= s->dim[2])
+    return 0;
+
+  return cell_getid(s->cdim, x[0] * s->iwidth[0], x[1] * s->iwidth[1],
+                    x[2] * s->iwidth[2]) == cid;
+}
+
+/**
+ * @brief #threadpool mapper function checking that the particles of some
+ * top-level cells did not leave them and listing the cells whose tree has to
+ * be split again.
+ *
+ * @param map_data Pointer towards the indices of the top-level cells.
+ * @param num_cells The number of cells to treat.
+ * @param extra_data Pointer to the #space_rebuild_local_data.
+ */
+void space_rebuild_local_check_mapper(void *map_data, int num_cells,
+                                      void *extra_data) {
+
+  struct space_rebuild_local_data *data =
+      (struct space_rebuild_local_data *)extra_data;
+  const struct space *s = data->s;
+  const int *cell_ids = (int *)map_data;
+  size_t counts[4] = {0, 0, 0, 0};
+
+  for (int ind = 0; ind < num_cells && !data->moved; ind++) {
+    const int cid = cell_ids[ind];
+    const struct cell *c = &s->cells_top[cid];
+    int moved = 0;
+
+    for (int k = 0; k < c->hydro.count && !moved; k++)
+      moved = c->hydro.parts[k].time_bin == time_bin_inhibited ||
+              !space_in_top_cell(s, c->hydro.parts[k].x, cid);
+    for (int k = 0; k < c->grav.count && !moved; k++)
+      moved = c->grav.parts[k].time_bin == time_bin_inhibited ||
+              !space_in_top_cell(s, c->grav.parts[k].x, cid);
+    for (int k = 0; k < c->stars.count && !moved; k++)
+      moved = c->stars.parts[k].time_bin == time_bin_inhibited ||
+              !space_in_top_cell(s, c->stars.parts[k].x, cid);
+    for (int k = 0; k < c->black_holes.count && !moved; k++)
+      moved = c->black_holes.parts[k].time_bin == time_bin_inhibited ||
+              !space_in_top_cell(s, c->black_holes.parts[k].x, cid);
+
+    if (moved) {
+      data->moved = 1;
+      break;
+    }
+
+    counts[0] += c->hydro.count;
+    counts[1] += c->grav.count;
+    counts[2] += c->stars.count;
+    counts[3] += c->black_holes.count;
+
+    /* The pairs of this cell stay valid until the next rebuild only if it
+     * leaves room for the neighbours to move as much as it did (see
+     * cell_need_rebuild_for_hydro_pair()). */
+    const float dx_max = max3(c->hydro.dx_max_part, c->stars.dx_max_part,
+                              c->black_holes.dx_max_part);
+    if (data->h_max + 2.f * dx_max > c->dmin)
+      data->dirty[atomic_inc(&data->nr_dirty)] = cid;
+  }
+
+  for (int k = 0; k < 4; k++) atomic_add(&data->counts[k], counts[k]);
+}
+
+/**
+ * @brief Recursively prepare a cell tree kept across a rebuild.
+ *
+ * The sorts are dropped and the drift times updated as when building a new
+ * tree.
+ *
+ * @param c The #cell.
+ * @param ti_current The current time.
+ */
+static void space_rebuild_local_clean_rec(struct cell *c,
+                                          const integertime_t ti_current) {
+
+  cell_free_hydro_sorts(c);
+  cell_free_hydro_bins(c);
+  cell_free_hydro_soa(c);
+  cell_free_stars_sorts(c);
+  c->hydro.sorted = 0;
+  c->stars.sorted = 0;
+  c->hydro.dx_max_sort = 0.f;
+  c->stars.dx_max_sort = 0.f;
+  c->hydro.ti_old_part = ti_current;
+  c->grav.ti_old_part = ti_current;
+  c->grav.ti_old_multipole = ti_current;
+  c->stars.ti_old_part = ti_current;
+  c->black_holes.ti_old_part = ti_current;
+  c->flags = 0;
+
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL)
+        space_rebuild_local_clean_rec(c->progeny[k], ti_current);
+}
+
+/**
+ * @brief #threadpool mapper function preparing the trees of some top-level
+ * cells for a local rebuild.
+ *
+ * @param map_data Pointer towards the indices of the top-level cells.
+ * @param num_cells The number of cells to treat.
+ * @param extra_data Pointer to the #space.
+ */
+void space_rebuild_local_clean_mapper(void *map_data, int num_cells,
+                                      void *extra_data) {
+
+  struct space *s = (struct space *)extra_data;
+  const int *cell_ids = (int *)map_data;
+  const integertime_t ti_current = s->e->ti_current;
+
+  for (int ind = 0; ind < num_cells; ind++) {
+    struct cell *c = &s->cells_top[cell_ids[ind]];
+
+    space_rebuild_local_clean_rec(c, ti_current);
+    c->hydro.updated = 0;
+    c->hydro.inhibited = 0;
+    c->grav.updated = 0;
+    c->grav.inhibited = 0;
+    c->stars.updated = 0;
+    c->stars.inhibited = 0;
+    c->black_holes.updated = 0;
+    c->black_holes.inhibited = 0;
+
+    /* New tasks will be made for the whole tree. */
+    if (!s->reuse_task_graph) {
+      space_clean_task_pointers_rec(c);
+      c->super = c;
+      c->hydro.super = c;
+      c->grav.super = c;
+    }
   }
 }
 
 /**
- * @brief #threadpool mapper function to split cells if they contain
- *        too many particles.
+ * @brief #threadpool mapper function splitting some top-level cells again.
  *
- * @param map_data Pointer towards the top-cells.
+ * The cells keep their particles and only their tree is rebuilt.
+ *
+ * @param map_data Pointer towards the indices of the top-level cells.
  * @param num_cells The number of cells to treat.
- * @param extra_data Pointers to the #space.
+ * @param extra_data Pointer to the #space.
  */
-void space_split_mapper(void *map_data, int num_cells, void *extra_data) {
+void space_rebuild_local_split_mapper(void *map_data, int num_cells,
+                                      void *extra_data) {
 
-  /* Unpack the inputs. */
   struct space *s = (struct space *)extra_data;
-  struct cell *cells_top = s->cells_top;
-  int *local_cells_with_particles = (int *)map_data;
+  const int *cell_ids = (int *)map_data;
+  const integertime_t ti_current = s->e->ti_current;
 
-  /* Loop over the non-empty cells */
   for (int ind = 0; ind < num_cells; ind++) {
-    struct cell *c = &cells_top[local_cells_with_particles[ind]];
+    struct cell *c = &s->cells_top[cell_ids[ind]];
+
+    /* Keep what space_reset_top_cell() would forget. */
+    struct cell temp;
+    temp.hydro.parts = c->hydro.parts;
+    temp.hydro.xparts = c->hydro.xparts;
+    temp.grav.parts = c->grav.parts;
+    temp.stars.parts = c->stars.parts;
+    temp.black_holes.parts = c->black_holes.parts;
+    temp.hydro.count = c->hydro.count;
+    temp.grav.count = c->grav.count;
+    temp.stars.count = c->stars.count;
+    temp.black_holes.count = c->black_holes.count;
+    temp.hydro.count_total = c->hydro.count_total;
+    temp.grav.count_total = c->grav.count_total;
+    temp.stars.count_total = c->stars.count_total;
+    temp.black_holes.count_total = c->black_holes.count_total;
+
+    space_reset_top_cell(s, c, s->reuse_task_graph);
+
+    c->hydro.parts = temp.hydro.parts;
+    c->hydro.xparts = temp.hydro.xparts;
+    c->grav.parts = temp.grav.parts;
+    c->stars.parts = temp.stars.parts;
+    c->stars.parts_rebuild = temp.stars.parts;
+    c->black_holes.parts = temp.black_holes.parts;
+    c->hydro.count = temp.hydro.count;
+    c->grav.count = temp.grav.count;
+    c->stars.count = temp.stars.count;
+    c->black_holes.count = temp.black_holes.count;
+    c->hydro.count_total = temp.hydro.count_total;
+    c->grav.count_total = temp.grav.count_total;
+    c->stars.count_total = temp.stars.count_total;
+    c->black_holes.count_total = temp.black_holes.count_total;
+    c->hydro.ti_old_part = ti_current;
+    c->grav.ti_old_part = ti_current;
+    c->grav.ti_old_multipole = ti_current;
+    c->stars.ti_old_part = ti_current;
+    c->black_holes.ti_old_part = ti_current;
+
     space_split_recursive(s, c, NULL, NULL, NULL, NULL);
   }
+}
 
-#ifdef SWIFT_DEBUG_CHECKS
-  /* All cells and particles should have consistent h_max values. */
-  for (int ind = 0; ind < num_cells; ind++) {
-    int depth = 0;
-    const struct cell *c = &cells_top[local_cells_with_particles[ind]];
-    if (!checkCellhdxmax(c, &depth)) message("    at cell depth %d", depth);
+/**
+ * @brief Re-build only the cell trees that need it.
+ *
+ * When no particle left its top-level cell since the last rebuild, the
+ * top-level sort of the particles can be skipped and only the top-level
+ * cells whose particles moved too much for their pairs to remain valid need
+ * to be split again. The trees of the other cells, including the
+ * displacements accumulated by their particles, are kept. The tasks are then
+ * re-used if the cells kept their structure (see engine_reuse_tasks()) or
+ * made again for the whole space otherwise.
+ *
+ * This is only attempted when Scheduler:local_rebuild is set and the number
+ * of particles and the top-level grid do not change, i.e. without MPI,
+ * self-gravity or star formation. Otherwise, or if a particle changed
+ * top-level cell, nothing is done and a full space_rebuild() is required.
+ *
+ * @param s The #space.
+ * @param verbose Are we talkative?
+ *
+ * @return 1 if the space was re-built, 0 if a full rebuild is required.
+ */
+int space_rebuild_local(struct space *s, int verbose) {
+
+  const ticks tic = getticks();
+
+  if (!s->local_rebuild || s->cells_top == NULL ||
+      s->local_cells_with_particles_top == NULL || s->with_self_gravity ||
+      s->with_star_formation || s->e->nr_nodes > 1)
+    return 0;
+
+  /* Would the top-level grid change? (see space_regrid()) */
+  float h_max = s->cell_min / kernel_gamma / space_stretch;
+  for (int k = 0; k < s->nr_local_cells_with_particles; ++k) {
+    const struct cell *c = &s->cells_top[s->local_cells_with_particles_top[k]];
+    h_max = max4(h_max, c->hydro.h_max, c->stars.h_max, c->black_holes.h_max);
   }
-#endif
+  for (int k = 0; k < 3; k++)
+    if ((int)floor(s->dim[k] / fmax(h_max * kernel_gamma * space_stretch,
+                                    s->cell_min)) < s->cdim[k]) {
+      if (verbose) message("The top-level grid changes, full rebuild.");
+      return 0;
+    }
+
+  /* Find the cells to split again, checking that all the particles are still
+   * in their top-level cell. */
+  struct space_rebuild_local_data data;
+  bzero(&data, sizeof(struct space_rebuild_local_data));
+  data.s = s;
+  data.h_max = kernel_gamma * h_max;
+  data.dirty = (int *)swift_malloc(
+      "dirty_cells", sizeof(int) * max(s->nr_local_cells_with_particles, 1));
+  if (data.dirty == NULL) error("Failed to allocate list of dirty cells.");
+
+  threadpool_map(&s->e->threadpool, space_rebuild_local_check_mapper,
+                 s->local_cells_with_particles_top,
+                 s->nr_local_cells_with_particles, sizeof(int), 0, &data);
+
+  /* Particles still in the cells they were sorted into? */
+  if (data.moved || data.counts[0] != s->nr_parts - s->nr_extra_parts ||
+      data.counts[1] != s->nr_gparts - s->nr_extra_gparts ||
+      data.counts[2] != s->nr_sparts - s->nr_extra_sparts ||
+      data.counts[3] != s->nr_bparts - s->nr_extra_bparts) {
+    swift_free("dirty_cells", data.dirty);
+    if (verbose) message("Particles changed top-level cell, full rebuild.");
+    return 0;
+  }
+
+  /* Prepare the trees we keep, then build the new ones. */
+  threadpool_map(&s->e->threadpool, space_rebuild_local_clean_mapper,
+                 s->local_cells_with_particles_top,
+                 s->nr_local_cells_with_particles, sizeof(int), 0, s);
+  threadpool_map(&s->e->threadpool, space_rebuild_local_split_mapper,
+                 data.dirty, data.nr_dirty, sizeof(int), 0, s);
+
+  /* Identify the tree we now have. */
+  if (s->reuse_task_graph) space_compute_fingerprint(s);
+
+  /* Clean up any stray sort indices in the cell buffer. */
+  space_free_buff_sort_indices(s);
+
+  if (verbose)
+    message("Split %d out of %d top-level cells again, took %.3f %s.",
+            data.nr_dirty, s->nr_local_cells_with_particles,
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  swift_free("dirty_cells", data.dirty);
+  return 1;
 }
 
 /**
@@ -3722,7 +5246,7 @@ void space_recycle(struct space *s, struct cell *c) {
   /* Hook this cell into the buffer. */
   c->next = s->cells_sub;
   s->cells_sub = c;
-  s->tot_cells -= 1;
+  atomic_dec(&s->tot_cells);
 
   /* Unlock the space. */
   lock_unlock_blind(&s->lock);
@@ -3773,7 +5297,7 @@ void space_recycle_list(struct space *s, struct cell *cell_list_begin,
   /* Hook the cells into the buffer. */
   cell_list_end->next = s->cells_sub;
   s->cells_sub = cell_list_begin;
-  s->tot_cells -= count;
+  atomic_sub(&s->tot_cells, count);
 
   /* Hook the multipoles into the buffer. */
   if (s->with_self_gravity) {
@@ -3786,23 +5310,81 @@ void space_recycle_list(struct space *s, struct cell *cell_list_begin,
 }
 
 /**
- * @brief Get a new empty (sub-)#cell.
+ * @brief Initialise a sub-#cell taken from the buffer.
  *
- * If there are cells in the buffer, use the one at the end of the linked list.
- * If we have no cells, allocate a new chunk of memory and pick one from there.
+ * @param c The #cell.
+ */
+static void space_init_sub_cell(struct cell *c) {
+
+  cell_free_hydro_sorts(c);
+  cell_free_hydro_bins(c);
+  cell_free_hydro_soa(c);
+  cell_free_stars_sorts(c);
+
+  struct gravity_tensors *temp = c->grav.multipole;
+  bzero(c, sizeof(struct cell));
+  c->grav.multipole = temp;
+  c->nodeID = -1;
+  if (lock_init(&c->hydro.lock) != 0 || lock_init(&c->grav.plock) != 0 ||
+      lock_init(&c->grav.mlock) != 0 || lock_init(&c->stars.lock) != 0 ||
+      lock_init(&c->black_holes.lock) != 0 ||
+      lock_init(&c->stars.star_formation_lock) != 0)
+    error("Failed to initialize cell spinlocks.");
+}
+
+/**
+ * @brief Get the #space_cell_cache of the calling thread, creating it on
+ * first use.
  *
  * @param s The #space.
- * @param nr_cells Number of #cell to pick up.
- * @param cells Array of @c nr_cells #cell pointers in which to store the
- *        new cells.
  */
-void space_getcells(struct space *s, int nr_cells, struct cell **cells) {
+static struct space_cell_cache *space_get_cell_cache(struct space *s) {
+
+  struct space_cell_cache *cache =
+      (struct space_cell_cache *)pthread_getspecific(s->cells_cache_key);
+  if (cache != NULL) return cache;
+
+  cache = (struct space_cell_cache *)calloc(1, sizeof(struct space_cell_cache));
+  if (cache == NULL) error("Failed to allocate a cell cache.");
+  if (pthread_setspecific(s->cells_cache_key, cache) != 0)
+    error("Failed to set the cell cache of this thread.");
+
+  /* Register it so that it can be found and freed later */
+  lock_lock(&s->lock);
+  cache->next = s->cells_caches;
+  s->cells_caches = cache;
+  lock_unlock_blind(&s->lock);
+
+  return cache;
+}
+
+/**
+ * @brief Refill a #space_cell_cache from the buffers of the #space.
+ *
+ * The cells are appended in the order of the buffer, which is the address
+ * order for freshly allocated chunks. Consecutive requests hence get adjacent
+ * cells and the trees built by a thread are laid out depth-first in memory.
+ *
+ * @param s The #space.
+ * @param cache The #space_cell_cache to refill.
+ * @param nr_cells The minimal number of cells the cache must hold.
+ */
+static void space_refill_cell_cache(struct space *s,
+                                    struct space_cell_cache *cache,
+                                    int nr_cells) {
+
+  const int batch = max(space_cellcache_batch, nr_cells);
+
+  /* Find the ends of the lists in the cache */
+  struct cell **cell_tail = &cache->cells;
+  while (*cell_tail != NULL) cell_tail = &(*cell_tail)->next;
+  struct gravity_tensors **multipole_tail = &cache->multipoles;
+  while (*multipole_tail != NULL) multipole_tail = &(*multipole_tail)->next;
 
   /* Lock the space. */
   lock_lock(&s->lock);
 
-  /* For each requested cell... */
-  for (int j = 0; j < nr_cells; j++) {
+  for (int j = cache->count; j < batch; j++) {
 
     /* Is the cell buffer empty? */
     if (s->cells_sub == NULL) {
@@ -3832,37 +5414,120 @@ void space_getcells(struct space *s, int nr_cells, struct cell **cells) {
       s->multipoles_sub[space_cellallocchunk - 1].next = NULL;
     }
 
-    /* Pick off the next cell. */
-    cells[j] = s->cells_sub;
-    s->cells_sub = cells[j]->next;
-    s->tot_cells += 1;
+    /* Move the next cell to the cache. */
+    *cell_tail = s->cells_sub;
+    s->cells_sub = s->cells_sub->next;
+    cell_tail = &(*cell_tail)->next;
 
-    /* Hook the multipole */
+    /* And the next multipole */
     if (s->with_self_gravity) {
-      cells[j]->grav.multipole = s->multipoles_sub;
-      s->multipoles_sub = cells[j]->grav.multipole->next;
+      *multipole_tail = s->multipoles_sub;
+      s->multipoles_sub = s->multipoles_sub->next;
+      multipole_tail = &(*multipole_tail)->next;
     }
   }
 
   /* Unlock the space. */
   lock_unlock_blind(&s->lock);
 
-  /* Init some things in the cell we just got. */
+  /* Terminate the lists */
+  *cell_tail = NULL;
+  *multipole_tail = NULL;
+  cache->count = max(cache->count, batch);
+}
+
+/**
+ * @brief Get a new empty (sub-)#cell.
+ *
+ * The cells are taken from the cache of the calling thread, which is refilled
+ * from the buffer of the #space when it runs dry. If the buffer has no cells,
+ * a new chunk of memory is allocated and the cells are picked from there.
+ *
+ * @param s The #space.
+ * @param nr_cells Number of #cell to pick up.
+ * @param cells Array of @c nr_cells #cell pointers in which to store the
+ *        new cells.
+ */
+void space_getcells(struct space *s, int nr_cells, struct cell **cells) {
+
+  struct space_cell_cache *cache = space_get_cell_cache(s);
+
+  /* Do we need more cells? */
+  if (cache->count < nr_cells) space_refill_cell_cache(s, cache, nr_cells);
+
+  /* For each requested cell... */
   for (int j = 0; j < nr_cells; j++) {
-    cell_free_hydro_sorts(cells[j]);
-    cell_free_stars_sorts(cells[j]);
 
-    struct gravity_tensors *temp = cells[j]->grav.multipole;
-    bzero(cells[j], sizeof(struct cell));
-    cells[j]->grav.multipole = temp;
-    cells[j]->nodeID = -1;
-    if (lock_init(&cells[j]->hydro.lock) != 0 ||
-        lock_init(&cells[j]->grav.plock) != 0 ||
-        lock_init(&cells[j]->grav.mlock) != 0 ||
-        lock_init(&cells[j]->stars.lock) != 0 ||
-        lock_init(&cells[j]->black_holes.lock) != 0 ||
-        lock_init(&cells[j]->stars.star_formation_lock) != 0)
-      error("Failed to initialize cell spinlocks.");
+    /* Pick off the next cell. */
+    cells[j] = cache->cells;
+    cache->cells = cells[j]->next;
+
+    /* Hook the multipole */
+    if (s->with_self_gravity) {
+      cells[j]->grav.multipole = cache->multipoles;
+      cache->multipoles = cells[j]->grav.multipole->next;
+    }
+  }
+  cache->count -= nr_cells;
+  atomic_add(&s->tot_cells, nr_cells);
+
+  /* Init some things in the cell we just got. */
+  for (int j = 0; j < nr_cells; j++) space_init_sub_cell(cells[j]);
+}
+
+/**
+ * @brief Get the progeny of a #cell that we are about to split.
+ *
+ * The progeny kept from the previous rebuild (see space_reset_cells()) are
+ * re-used and re-initialised as if they had just been obtained from
+ * space_getcells(), except that they keep their own progeny and their task
+ * pointers. The missing ones are taken from the buffer.
+ *
+ * @param s The #space.
+ * @param c The #cell to get the progeny of.
+ */
+void space_getprogeny(struct space *s, struct cell *c) {
+
+  /* Nothing to re-use? */
+  if (!c->split) {
+    space_getcells(s, 8, c->progeny);
+    return;
+  }
+
+  /* Get the cells we can't re-use in one go. */
+  int nr_new_cells = 0;
+  struct cell *new_cells[8];
+  for (int k = 0; k < 8; k++)
+    if (c->progeny[k] == NULL) nr_new_cells++;
+  if (nr_new_cells > 0) space_getcells(s, nr_new_cells, new_cells);
+
+  for (int k = 0; k < 8; k++) {
+    struct cell *cp = c->progeny[k];
+
+    if (cp == NULL) {
+      c->progeny[k] = new_cells[--nr_new_cells];
+      continue;
+    }
+
+    if (lock_destroy(&cp->hydro.lock) != 0 ||
+        lock_destroy(&cp->grav.plock) != 0 ||
+        lock_destroy(&cp->grav.mlock) != 0 ||
+        lock_destroy(&cp->stars.lock) != 0 ||
+        lock_destroy(&cp->black_holes.lock) != 0 ||
+        lock_destroy(&cp->stars.star_formation_lock))
+      error("Failed to destroy spinlocks.");
+
+    /* Keep what we need of the old cell. */
+    struct cell temp;
+    cell_copy_task_pointers(&temp, cp);
+    memcpy(temp.progeny, cp->progeny, 8 * sizeof(struct cell *));
+    temp.split = cp->split;
+
+    space_init_sub_cell(cp);
+
+    cell_copy_task_pointers(cp, &temp);
+    memcpy(cp->progeny, temp.progeny, 8 * sizeof(struct cell *));
+    cp->split = temp.split;
   }
 }
 
@@ -3875,8 +5540,22 @@ void space_free_buff_sort_indices(struct space *s) {
   for (struct cell *finger = s->cells_sub; finger != NULL;
        finger = finger->next) {
     cell_free_hydro_sorts(finger);
+    cell_free_hydro_bins(finger);
+    cell_free_hydro_soa(finger);
     cell_free_stars_sorts(finger);
   }
+
+  /* And the cells waiting in the thread caches */
+  for (struct space_cell_cache *cache = s->cells_caches; cache != NULL;
+       cache = cache->next) {
+    for (struct cell *finger = cache->cells; finger != NULL;
+         finger = finger->next) {
+      cell_free_hydro_sorts(finger);
+      cell_free_hydro_bins(finger);
+      cell_free_hydro_soa(finger);
+      cell_free_stars_sorts(finger);
+    }
+  }
 }
 
 /**
@@ -3925,6 +5604,78 @@ void space_list_useful_top_level_cells(struct space *s) {
             clocks_getunit());
 }
 
+/**
+ * @brief Empty the lists of active top-level cells.
+ *
+ * @param s The #space.
+ */
+void space_active_cells_reset(struct space *s) {
+
+  for (int bin = 0; bin <= num_time_bins; bin++) s->active_cells_head[bin] = -1;
+  for (int k = 0; k < s->nr_cells; k++) s->active_cells_bin[k] = -1;
+}
+
+/**
+ * @brief Move a top-level cell to the list of the time bin of its next
+ * activation.
+ *
+ * Cells without particles to activate are removed from the lists. This is not
+ * thread-safe.
+ *
+ * @param s The #space.
+ * @param cid The index of the cell in the top-level cells.
+ * @param ti_next The next time at which the cell will be active, -1 if never.
+ */
+void space_active_cells_update(struct space *s, int cid,
+                               integertime_t ti_next) {
+
+  int *next = s->active_cells_next;
+  int *prev = s->active_cells_prev;
+  const int old_bin = s->active_cells_bin[cid];
+  const int new_bin = (ti_next > 0) ? get_max_active_bin(ti_next) : -1;
+
+  if (old_bin == new_bin) return;
+
+  /* Unlink the cell from its old list. */
+  if (old_bin >= 0) {
+    if (prev[cid] >= 0)
+      next[prev[cid]] = next[cid];
+    else
+      s->active_cells_head[old_bin] = next[cid];
+    if (next[cid] >= 0) prev[next[cid]] = prev[cid];
+  }
+
+  /* And put it at the front of the new one. */
+  if (new_bin >= 0) {
+    prev[cid] = -1;
+    next[cid] = s->active_cells_head[new_bin];
+    if (next[cid] >= 0) prev[next[cid]] = cid;
+    s->active_cells_head[new_bin] = cid;
+  }
+  s->active_cells_bin[cid] = new_bin;
+}
+
+/**
+ * @brief Collect the top-level cells from the list of a time bin.
+ *
+ * These are all the cells that may be active at a time when the given bin is
+ * the largest active one.
+ *
+ * @param s The #space.
+ * @param bin The time bin.
+ * @param list (return) The indices of the cells.
+ *
+ * @return The number of cells in the list.
+ */
+int space_active_cells_get(const struct space *s, timebin_t bin, int *list) {
+
+  int count = 0;
+  for (int cid = s->active_cells_head[bin]; cid >= 0;
+       cid = s->active_cells_next[cid])
+    list[count++] = cid;
+  return count;
+}
+
 void space_synchronize_particle_positions_mapper(void *map_data, int nr_gparts,
                                                  void *extra_data) {
   /* Unpack the data */
@@ -4624,6 +6375,9 @@ void space_init(struct space *s, struct swift_params *params,
   space_subsize_self_hydro =
       parser_get_opt_param_int(params, "Scheduler:cell_sub_size_self_hydro",
                                space_subsize_self_hydro_default);
+  space_nosort_pair_hydro =
+      parser_get_opt_param_int(params, "Scheduler:cell_nosort_size_pair_hydro",
+                               space_nosort_pair_hydro_default);
   space_subsize_pair_grav =
       parser_get_opt_param_int(params, "Scheduler:cell_sub_size_pair_grav",
                                space_subsize_pair_grav_default);
@@ -4644,6 +6398,24 @@ void space_init(struct space *s, struct swift_params *params,
   space_extra_bparts = parser_get_opt_param_int(
       params, "Scheduler:cell_extra_bparts", space_extra_bparts_default);
 
+  /* Do we want to keep the tree and the tasks across rebuilds? */
+  s->reuse_task_graph =
+      parser_get_opt_param_int(params, "Scheduler:reuse_task_graph", 0);
+
+  /* Do we want to store the particles along a Morton curve? */
+  s->morton_order =
+      parser_get_opt_param_int(params, "Scheduler:morton_order", 0);
+
+  /* Do we only want to split again the cells that need it? */
+  s->local_rebuild =
+      parser_get_opt_param_int(params, "Scheduler:local_rebuild", 0);
+
+  /* Do we want to tune the split sizes from the measured task costs? */
+  s->adaptive_split =
+      parser_get_opt_param_int(params, "Scheduler:adaptive_split", 0);
+  s->split_task_overhead = clocks_to_ticks(parser_get_opt_param_double(
+      params, "Scheduler:adaptive_split_task_overhead", 0.001));
+
   engine_max_parts_per_ghost =
       parser_get_opt_param_int(params, "Scheduler:engine_max_parts_per_ghost",
                                engine_max_parts_per_ghost_default);
@@ -4657,6 +6429,7 @@ void space_init(struct space *s, struct swift_params *params,
     message("subdepth_grav set to %d", space_subdepth_diff_grav);
     message("sub_size_pair_hydro set to %d, sub_size_self_hydro set to %d",
             space_subsize_pair_hydro, space_subsize_self_hydro);
+    message("nosort_size_pair_hydro set to %d", space_nosort_pair_hydro);
     message("sub_size_pair_grav set to %d, sub_size_self_grav set to %d",
             space_subsize_pair_grav, space_subsize_self_grav);
   }
@@ -4782,12 +6555,18 @@ void space_init(struct space *s, struct swift_params *params,
   /* Init the space lock. */
   if (lock_init(&s->lock) != 0) error("Failed to create space spin-lock.");
 
+  /* Init the per-thread caches of sub-cells. */
+  if (pthread_key_create(&s->cells_cache_key, NULL) != 0)
+    error("Failed to create the key of the cell caches.");
+  s->cells_caches = NULL;
+
 #if defined(SWIFT_DEBUG_CHECKS) || defined(SWIFT_CELL_GRAPH)
   last_cell_id = 1;
 #endif
 
   /* Do we want any spare particles for on the fly creation? */
   if (!star_formation) space_extra_sparts = 0;
+  space_extra_sparts_max = space_extra_sparts_max_growth * space_extra_sparts;
 
   /* Build the cells recursively. */
   if (!dry_run) space_regrid(s, verbose);
@@ -5269,15 +7048,31 @@ void space_clean(struct space *s) {
   for (int i = 0; i < s->nr_cells; ++i) cell_clean(&s->cells_top[i]);
   swift_free("cells_top", s->cells_top);
   swift_free("multipoles_top", s->multipoles_top);
+  swift_free("cells_top_order", s->cells_top_order);
+  swift_free("cells_top_order", s->cells_top_rank);
+  swift_free("split_tuning", s->split_tuning);
+  hydro_space_clean(&s->hs);
   swift_free("local_cells_top", s->local_cells_top);
   swift_free("local_cells_with_tasks_top", s->local_cells_with_tasks_top);
   swift_free("cells_with_particles_top", s->cells_with_particles_top);
   swift_free("local_cells_with_particles_top",
              s->local_cells_with_particles_top);
+  swift_free("active_cells", s->active_cells_next);
+  swift_free("active_cells", s->active_cells_prev);
+  swift_free("active_cells", s->active_cells_bin);
+  swift_free("active_cells", s->active_cells_buffer);
   swift_free("parts", s->parts);
   swift_free("xparts", s->xparts);
   swift_free("gparts", s->gparts);
   swift_free("sparts", s->sparts);
+
+  /* Free the per-thread caches of sub-cells. */
+  while (s->cells_caches != NULL) {
+    struct space_cell_cache *next = s->cells_caches->next;
+    free(s->cells_caches);
+    s->cells_caches = next;
+  }
+  pthread_key_delete(s->cells_cache_key);
 }
 
 /**
@@ -5301,6 +7096,8 @@ void space_struct_dump(struct space *s, FILE *stream) {
                        "space_subsize_pair_hydro", "space_subsize_pair_hydro");
   restart_write_blocks(&space_subsize_self_hydro, sizeof(int), 1, stream,
                        "space_subsize_self_hydro", "space_subsize_self_hydro");
+  restart_write_blocks(&space_nosort_pair_hydro, sizeof(int), 1, stream,
+                       "space_nosort_pair_hydro", "space_nosort_pair_hydro");
   restart_write_blocks(&space_subsize_pair_grav, sizeof(int), 1, stream,
                        "space_subsize_pair_grav", "space_subsize_pair_grav");
   restart_write_blocks(&space_subsize_self_grav, sizeof(int), 1, stream,
@@ -5313,6 +7110,8 @@ void space_struct_dump(struct space *s, FILE *stream) {
                        "space_extra_gparts", "space_extra_gparts");
   restart_write_blocks(&space_extra_sparts, sizeof(int), 1, stream,
                        "space_extra_sparts", "space_extra_sparts");
+  restart_write_blocks(&space_extra_sparts_max, sizeof(int), 1, stream,
+                       "space_extra_sparts_max", "space_extra_sparts_max");
   restart_write_blocks(&space_extra_bparts, sizeof(int), 1, stream,
                        "space_extra_bparts", "space_extra_bparts");
 
@@ -5336,17 +7135,12 @@ void space_struct_dump(struct space *s, FILE *stream) {
 }
 
 /**
- * @brief Re-create a space struct and its contents from the given FILE
- *        stream.
+ * @brief Read the global variables of the space from the given FILE stream.
  *
- * @param s the space
  * @param stream the file stream
  */
-void space_struct_restore(struct space *s, FILE *stream) {
-
-  restart_read_blocks(s, sizeof(struct space), 1, stream, NULL, "space struct");
+static void space_struct_restore_globals(FILE *stream) {
 
-  /* Now all our globals. */
   restart_read_blocks(&space_splitsize, sizeof(int), 1, stream, NULL,
                       "space_splitsize");
   restart_read_blocks(&space_maxsize, sizeof(int), 1, stream, NULL,
@@ -5355,6 +7149,8 @@ void space_struct_restore(struct space *s, FILE *stream) {
                       "space_subsize_pair_hydro");
   restart_read_blocks(&space_subsize_self_hydro, sizeof(int), 1, stream, NULL,
                       "space_subsize_self_hydro");
+  restart_read_blocks(&space_nosort_pair_hydro, sizeof(int), 1, stream, NULL,
+                      "space_nosort_pair_hydro");
   restart_read_blocks(&space_subsize_pair_grav, sizeof(int), 1, stream, NULL,
                       "space_subsize_pair_grav");
   restart_read_blocks(&space_subsize_self_grav, sizeof(int), 1, stream, NULL,
@@ -5367,18 +7163,49 @@ void space_struct_restore(struct space *s, FILE *stream) {
                       "space_extra_gparts");
   restart_read_blocks(&space_extra_sparts, sizeof(int), 1, stream, NULL,
                       "space_extra_sparts");
+  restart_read_blocks(&space_extra_sparts_max, sizeof(int), 1, stream, NULL,
+                      "space_extra_sparts_max");
   restart_read_blocks(&space_extra_bparts, sizeof(int), 1, stream, NULL,
                       "space_extra_bparts");
+}
+
+/**
+ * @brief Re-create a space struct and its contents from the given FILE
+ *        stream.
+ *
+ * @param s the space
+ * @param stream the file stream
+ */
+void space_struct_restore(struct space *s, FILE *stream) {
+
+  restart_read_blocks(s, sizeof(struct space), 1, stream, NULL, "space struct");
+
+  /* Now all our globals. */
+  space_struct_restore_globals(stream);
 
   /* Things that should be reconstructed in a rebuild. */
   s->cells_top = NULL;
   s->cells_sub = NULL;
   s->multipoles_top = NULL;
   s->multipoles_sub = NULL;
+  s->cells_caches = NULL;
+  if (pthread_key_create(&s->cells_cache_key, NULL) != 0)
+    error("Failed to create the key of the cell caches.");
+  s->cells_top_order = NULL;
+  s->cells_top_rank = NULL;
+  s->split_tuning = NULL;
+#ifdef SHADOWFAX_SPH
+  s->hs.walls = NULL;
+#endif
   s->local_cells_top = NULL;
   s->local_cells_with_tasks_top = NULL;
   s->cells_with_particles_top = NULL;
   s->local_cells_with_particles_top = NULL;
+  s->active_cells_next = NULL;
+  s->active_cells_prev = NULL;
+  s->active_cells_bin = NULL;
+  s->active_cells_buffer = NULL;
+  s->active_cells_valid = 0;
   s->nr_local_cells_with_tasks = 0;
   s->nr_cells_with_particles = 0;
 #ifdef WITH_MPI
@@ -5392,17 +7219,18 @@ void space_struct_restore(struct space *s, FILE *stream) {
   s->size_bparts_foreign = 0;
 #endif
 
-  /* More things to read. */
+  /* More things to read. The particle arrays start on a page so that they can
+   * be mapped from the restart file. */
   s->parts = NULL;
   s->xparts = NULL;
   if (s->nr_parts > 0) {
 
     /* Need the memory for these. */
-    if (swift_memalign("parts", (void **)&s->parts, part_align,
+    if (swift_memalign("parts", (void **)&s->parts, restart_align,
                        s->size_parts * sizeof(struct part)) != 0)
       error("Failed to allocate restore part array.");
 
-    if (swift_memalign("xparts", (void **)&s->xparts, xpart_align,
+    if (swift_memalign("xparts", (void **)&s->xparts, restart_align,
                        s->size_parts * sizeof(struct xpart)) != 0)
       error("Failed to allocate restore xpart array.");
 
@@ -5413,7 +7241,7 @@ void space_struct_restore(struct space *s, FILE *stream) {
   }
   s->gparts = NULL;
   if (s->nr_gparts > 0) {
-    if (swift_memalign("gparts", (void **)&s->gparts, gpart_align,
+    if (swift_memalign("gparts", (void **)&s->gparts, restart_align,
                        s->size_gparts * sizeof(struct gpart)) != 0)
       error("Failed to allocate restore gpart array.");
 
@@ -5423,7 +7251,7 @@ void space_struct_restore(struct space *s, FILE *stream) {
 
   s->sparts = NULL;
   if (s->nr_sparts > 0) {
-    if (swift_memalign("sparts", (void **)&s->sparts, spart_align,
+    if (swift_memalign("sparts", (void **)&s->sparts, restart_align,
                        s->size_sparts * sizeof(struct spart)) != 0)
       error("Failed to allocate restore spart array.");
 
@@ -5432,7 +7260,7 @@ void space_struct_restore(struct space *s, FILE *stream) {
   }
   s->bparts = NULL;
   if (s->nr_bparts > 0) {
-    if (swift_memalign("bparts", (void **)&s->bparts, bpart_align,
+    if (swift_memalign("bparts", (void **)&s->bparts, restart_align,
                        s->size_bparts * sizeof(struct bpart)) != 0)
       error("Failed to allocate restore bpart array.");
 
@@ -5460,6 +7288,155 @@ void space_struct_restore(struct space *s, FILE *stream) {
 #endif
 }
 
+/**
+ * @brief Grow a particle array, keeping its current content.
+ *
+ * @param array The array (can be NULL).
+ * @param count The number of elements in use.
+ * @param new_size The new number of elements the array must hold.
+ * @param elem_size The size of one element.
+ * @param label The label of the array for the memory use reports.
+ * @return The new array.
+ */
+static void *space_grow_particle_array(void *array, size_t count,
+                                       size_t new_size, size_t elem_size,
+                                       const char *label) {
+
+  void *new_array = NULL;
+  if (swift_memalign(label, &new_array, restart_align,
+                     new_size * elem_size) != 0)
+    error("Failed to grow the %s array.", label);
+  if (count > 0) memcpy(new_array, array, count * elem_size);
+  if (array != NULL) swift_free(label, array);
+  return new_array;
+}
+
+/**
+ * @brief Append the particles of a space stored in the given FILE stream to
+ *        the particles of a restored space.
+ *
+ * Used when restarting on a different number of ranks: the stream is another
+ * rank's restart file positioned after its engine struct. Everything but the
+ * particles is ignored, the rest of the space being the same on all ranks.
+ *
+ * @param s the space restored with space_struct_restore().
+ * @param stream the file stream
+ */
+void space_struct_append(struct space *s, FILE *stream) {
+
+  struct space other;
+  restart_read_blocks(&other, sizeof(struct space), 1, stream, NULL,
+                      "space struct");
+  space_struct_restore_globals(stream);
+
+  const size_t nr_parts = s->nr_parts;
+  const size_t nr_sparts = s->nr_sparts;
+  const size_t nr_bparts = s->nr_bparts;
+
+  /* Make room and read the new particles after the current ones. */
+  if (other.nr_parts > 0) {
+    if (s->parts == NULL || nr_parts + other.nr_parts > s->size_parts) {
+      const size_t new_size = nr_parts + other.nr_parts;
+      s->parts = (struct part *)space_grow_particle_array(
+          s->parts, nr_parts, new_size, sizeof(struct part), "parts");
+      s->xparts = (struct xpart *)space_grow_particle_array(
+          s->xparts, nr_parts, new_size, sizeof(struct xpart), "xparts");
+      s->size_parts = new_size;
+    }
+    restart_read_blocks(s->parts + nr_parts, other.nr_parts,
+                        sizeof(struct part), stream, NULL, "parts");
+    restart_read_blocks(s->xparts + nr_parts, other.nr_parts,
+                        sizeof(struct xpart), stream, NULL, "xparts");
+  }
+  if (other.nr_gparts > 0) {
+    if (s->gparts == NULL || s->nr_gparts + other.nr_gparts > s->size_gparts) {
+      const size_t new_size = s->nr_gparts + other.nr_gparts;
+      s->gparts = (struct gpart *)space_grow_particle_array(
+          s->gparts, s->nr_gparts, new_size, sizeof(struct gpart), "gparts");
+      s->size_gparts = new_size;
+    }
+    struct gpart *gparts = s->gparts + s->nr_gparts;
+    restart_read_blocks(gparts, other.nr_gparts, sizeof(struct gpart), stream,
+                        NULL, "gparts");
+
+    /* The offsets to the baryons were relative to the other arrays. */
+    for (size_t k = 0; k < other.nr_gparts; k++) {
+      if (gparts[k].type == swift_type_gas)
+        gparts[k].id_or_neg_offset -= nr_parts;
+      else if (gparts[k].type == swift_type_stars)
+        gparts[k].id_or_neg_offset -= nr_sparts;
+      else if (gparts[k].type == swift_type_black_hole)
+        gparts[k].id_or_neg_offset -= nr_bparts;
+    }
+  }
+  if (other.nr_sparts > 0) {
+    if (s->sparts == NULL || nr_sparts + other.nr_sparts > s->size_sparts) {
+      const size_t new_size = nr_sparts + other.nr_sparts;
+      s->sparts = (struct spart *)space_grow_particle_array(
+          s->sparts, nr_sparts, new_size, sizeof(struct spart), "sparts");
+      s->size_sparts = new_size;
+    }
+    restart_read_blocks(s->sparts + nr_sparts, other.nr_sparts,
+                        sizeof(struct spart), stream, NULL, "sparts");
+  }
+  if (other.nr_bparts > 0) {
+    if (s->bparts == NULL || nr_bparts + other.nr_bparts > s->size_bparts) {
+      const size_t new_size = nr_bparts + other.nr_bparts;
+      s->bparts = (struct bpart *)space_grow_particle_array(
+          s->bparts, nr_bparts, new_size, sizeof(struct bpart), "bparts");
+      s->size_bparts = new_size;
+    }
+    restart_read_blocks(s->bparts + nr_bparts, other.nr_bparts,
+                        sizeof(struct bpart), stream, NULL, "bparts");
+  }
+
+  s->nr_parts += other.nr_parts;
+  s->nr_gparts += other.nr_gparts;
+  s->nr_sparts += other.nr_sparts;
+  s->nr_bparts += other.nr_bparts;
+  s->nr_inhibited_parts += other.nr_inhibited_parts;
+  s->nr_inhibited_gparts += other.nr_inhibited_gparts;
+  s->nr_inhibited_sparts += other.nr_inhibited_sparts;
+  s->nr_inhibited_bparts += other.nr_inhibited_bparts;
+  s->nr_extra_parts += other.nr_extra_parts;
+  s->nr_extra_gparts += other.nr_extra_gparts;
+  s->nr_extra_sparts += other.nr_extra_sparts;
+  s->nr_extra_bparts += other.nr_extra_bparts;
+
+  /* The arrays may have moved, re-link everything. */
+  if (s->nr_parts > 0 && s->nr_gparts > 0)
+    part_relink_parts_to_gparts(s->gparts, s->nr_gparts, s->parts);
+  if (s->nr_sparts > 0 && s->nr_gparts > 0)
+    part_relink_sparts_to_gparts(s->gparts, s->nr_gparts, s->sparts);
+  if (s->nr_bparts > 0 && s->nr_gparts > 0)
+    part_relink_bparts_to_gparts(s->gparts, s->nr_gparts, s->bparts);
+}
+
+/**
+ * @brief Forget all the particles of a restored space.
+ *
+ * Used when restarting on more ranks than there are restart files: the
+ * surplus ranks restore the space of one of the files, but its particles
+ * belong to another rank.
+ *
+ * @param s the space restored with space_struct_restore().
+ */
+void space_struct_drop_particles(struct space *s) {
+
+  s->nr_parts = 0;
+  s->nr_gparts = 0;
+  s->nr_sparts = 0;
+  s->nr_bparts = 0;
+  s->nr_inhibited_parts = 0;
+  s->nr_inhibited_gparts = 0;
+  s->nr_inhibited_sparts = 0;
+  s->nr_inhibited_bparts = 0;
+  s->nr_extra_parts = 0;
+  s->nr_extra_gparts = 0;
+  s->nr_extra_sparts = 0;
+  s->nr_extra_bparts = 0;
+}
+
 #define root_cell_id 0
 /**
  * @brief write a single cell in a csv file.
@@ -27,37 +27,52 @@
 #include "../config.h"
 
 /* Some standard headers. */
+#include <pthread.h>
 #include <stddef.h>
 
 /* Includes. */
+#include "cycle.h"
 #include "gravity_properties.h"
 #include "hydro_space.h"
 #include "lock.h"
 #include "parser.h"
 #include "part.h"
+#include "timeline.h"
 #include "velociraptor_struct.h"
 
 /* Avoid cyclic inclusions */
 struct cell;
 struct cosmology;
+struct scheduler;
+struct threadpool;
 
 /* Some constants. */
 #define space_cellallocchunk 1000
+#define space_cellcache_batch 256
 #define space_splitsize_default 400
 #define space_maxsize_default 8000000
 #define space_extra_parts_default 0
 #define space_extra_gparts_default 0
 #define space_extra_sparts_default 100
 #define space_extra_bparts_default 0
+#define space_extra_sparts_low_fraction 0.25
+#define space_extra_sparts_max_growth 16
 #define space_expected_max_nr_strays_default 100
 #define space_subsize_pair_hydro_default 256000000
 #define space_subsize_self_hydro_default 32000
+#define space_nosort_pair_hydro_default 0
 #define space_subsize_pair_grav_default 256000000
 #define space_subsize_self_grav_default 32000
 #define space_subdepth_diff_grav_default 4
 #define space_max_top_level_cells_default 12
 #define space_stretch 1.10f
 #define space_maxreldx 0.1f
+#define space_threaded_sort_min_count 100000
+
+/* Change of the split factor of a top-level cell at each rebuild and its
+ * bounds when the split sizes are tuned. */
+#define space_split_tuning_step 1.25f
+#define space_split_tuning_max_factor 8
 
 /* Maximum allowed depth of cell splits. */
 #define space_cell_maxdepth 52
@@ -68,14 +83,63 @@ extern int space_splitsize;
 extern int space_maxsize;
 extern int space_subsize_pair_hydro;
 extern int space_subsize_self_hydro;
+extern int space_nosort_pair_hydro;
 extern int space_subsize_pair_grav;
 extern int space_subsize_self_grav;
 extern int space_subdepth_diff_grav;
 extern int space_extra_parts;
 extern int space_extra_gparts;
 extern int space_extra_sparts;
+extern int space_extra_sparts_max;
 extern int space_extra_bparts;
 
+/**
+ * @brief A per-thread cache of unused sub-cells and multipoles.
+ *
+ * The caches are refilled from the buffers of the #space in batches of
+ * space_cellcache_batch, so that the threads splitting cells in parallel
+ * only rarely need to take the lock of the space.
+ */
+struct space_cell_cache {
+
+  /*! Linked list of unused cells, in address order when freshly allocated. */
+  struct cell *cells;
+
+  /*! Linked list of unused multipoles. */
+  struct gravity_tensors *multipoles;
+
+  /*! Number of cells (and multipoles, with self-gravity) in the cache. */
+  int count;
+
+  /*! Next cache in the list of all the caches of the #space. */
+  struct space_cell_cache *next;
+};
+
+/**
+ * @brief State of the tuning of the split and sub-task sizes of a top-level
+ * cell from the measured run times of its tasks.
+ */
+struct space_split_tuning {
+
+  /*! Time spent in the tasks of the cell since the last rebuild, in ticks */
+  double ticks;
+
+  /*! Number of these tasks */
+  double nr_tasks;
+
+  /*! Number of particle updates in the cell since the last rebuild */
+  double updates;
+
+  /*! Cost per particle update measured with the previous factor, in ticks */
+  double cost;
+
+  /*! Factor applied to the split and sub-task sizes of the cell */
+  float factor;
+
+  /*! Direction of the next change of the factor, +1 coarser or -1 finer */
+  float direction;
+};
+
 /**
  * @brief The space in which the cells and particles reside.
  */
@@ -117,6 +181,30 @@ struct space {
   /*! Maximal depth reached by the tree */
   int maxdepth;
 
+  /*! Do we keep the cell tree across rebuilds to re-use the tasks? */
+  int reuse_task_graph;
+
+  /*! Do we only split again the top-level cells that need it at rebuild? */
+  int local_rebuild;
+
+  /*! Do we store the particles of the top-level cells along a Morton curve? */
+  int morton_order;
+
+  /*! Do we tune the split sizes of the top-level cells from their tasks? */
+  int adaptive_split;
+
+  /*! Scheduling overhead assumed for each task by the tuning, in ticks */
+  double split_task_overhead;
+
+  /*! The tuning state of each top-level cell, NULL if not tuning */
+  struct space_split_tuning *split_tuning;
+
+  /*! Number of times the cell tree was freed */
+  unsigned long long tree_generation;
+
+  /*! Fingerprint of the cell tree built at the last rebuild */
+  unsigned long long tree_fingerprint;
+
   /*! Number of top-level cells. */
   int nr_cells;
 
@@ -147,6 +235,19 @@ struct space {
   /*! Buffer of unused multipoles for the sub-cells. */
   struct gravity_tensors *multipoles_sub;
 
+  /*! Key to the #space_cell_cache of each thread. */
+  pthread_key_t cells_cache_key;
+
+  /*! All the per-thread caches of unused sub-cells. */
+  struct space_cell_cache *cells_caches;
+
+  /*! The indices of the top-level cells in the order their particles are
+   * stored in, NULL if this is the order of the indices */
+  int *cells_top_order;
+
+  /*! The position of each top-level cell in #cells_top_order */
+  int *cells_top_rank;
+
   /*! The indices of the *local* top-level cells */
   int *local_cells_top;
 
@@ -156,6 +257,23 @@ struct space {
   /*! The indices of the top-level cells that have >0 particles (of any kind) */
   int *cells_with_particles_top;
 
+  /*! Are the lists of active top-level cells up to date? */
+  int active_cells_valid;
+
+  /*! First top-level cell with tasks in the list of each time bin, -1 if the
+   * list is empty. A cell is in the list of the largest time bin active at
+   * the next time it will be active. */
+  int active_cells_head[num_time_bins + 1];
+
+  /*! Next and previous cell in the list of each top-level cell */
+  int *active_cells_next, *active_cells_prev;
+
+  /*! Time bin of the list each top-level cell is in, -1 if none */
+  int *active_cells_bin;
+
+  /*! Buffer of top-level cell indices used to update and read the lists */
+  int *active_cells_buffer;
+
   /*! The indices of the top-level cells that have >0 particles (of any kind) */
   int *local_cells_with_particles_top;
 
@@ -204,6 +322,9 @@ struct space {
   /*! Number of extra #spart we allocated (for on-the-fly creation) */
   size_t nr_extra_sparts;
 
+  /*! Did a top-level cell run low on extra #spart since the last rebuild? */
+  int extra_sparts_low;
+
   /*! Number of extra #bpart we allocated (for on-the-fly creation) */
   size_t nr_extra_bparts;
 
@@ -287,16 +408,19 @@ struct space {
 
 /* Function prototypes. */
 void space_free_buff_sort_indices(struct space *s);
-void space_parts_sort(struct part *parts, struct xpart *xparts, int *ind,
-                      int *counts, int num_bins, ptrdiff_t parts_offset);
-void space_gparts_sort(struct gpart *gparts, struct part *parts,
-                       struct spart *sparts, struct bpart *bparts, int *ind,
-                       int *counts, int num_bins);
-void space_sparts_sort(struct spart *sparts, int *ind, int *counts,
-                       int num_bins, ptrdiff_t sparts_offset);
-void space_bparts_sort(struct bpart *bparts, int *ind, int *counts,
-                       int num_bins, ptrdiff_t bparts_offset);
+void space_parts_sort(struct threadpool *tp, struct part *parts,
+                      struct xpart *xparts, int *ind, int *counts,
+                      int num_bins, ptrdiff_t parts_offset);
+void space_gparts_sort(struct threadpool *tp, struct gpart *gparts,
+                       struct part *parts, struct spart *sparts,
+                       struct bpart *bparts, int *ind, int *counts,
+                       int num_bins);
+void space_sparts_sort(struct threadpool *tp, struct spart *sparts, int *ind,
+                       int *counts, int num_bins, ptrdiff_t sparts_offset);
+void space_bparts_sort(struct threadpool *tp, struct bpart *bparts, int *ind,
+                       int *counts, int num_bins, ptrdiff_t bparts_offset);
 void space_getcells(struct space *s, int nr_cells, struct cell **cells);
+void space_getprogeny(struct space *s, struct cell *c);
 void space_init(struct space *s, struct swift_params *params,
                 const struct cosmology *cosmo, double dim[3],
                 struct part *parts, struct gpart *gparts, struct spart *sparts,
@@ -305,6 +429,11 @@ void space_init(struct space *s, struct swift_params *params,
                 int generate_gas_in_ics, int hydro, int gravity,
                 int star_formation, int verbose, int dry_run);
 void space_sanitize(struct space *s);
+void space_numa_place_particles(const struct space *s, const int *queue_domain,
+                                int verbose);
+void space_numa_place_foreign_particles(const struct space *s,
+                                        const int *queue_domain,
+                                        int verbose);
 void space_map_cells_pre(struct space *s, int full,
                          void (*fun)(struct cell *c, void *data), void *data);
 void space_map_parts(struct space *s,
@@ -317,14 +446,24 @@ void space_map_cells_post(struct space *s, int full,
                           void (*fun)(struct cell *c, void *data), void *data);
 void space_rebuild(struct space *s, int repartitioned, int verbose);
 void space_recycle(struct space *s, struct cell *c);
+void space_recycle_progeny(struct space *s, struct cell *c);
 void space_recycle_list(struct space *s, struct cell *cell_list_begin,
                         struct cell *cell_list_end,
                         struct gravity_tensors *multipole_list_begin,
                         struct gravity_tensors *multipole_list_end);
 void space_split(struct space *s, int verbose);
+long long space_cell_split_size(const struct space *s, const struct cell *c,
+                                long long size, int power);
+void space_split_tuning_collect(struct space *s, const struct scheduler *sched,
+                                ticks tic);
+int space_rebuild_local(struct space *s, int verbose);
 void space_reorder_extras(struct space *s, int verbose);
 void space_split_mapper(void *map_data, int num_elements, void *extra_data);
 void space_list_useful_top_level_cells(struct space *s);
+void space_active_cells_reset(struct space *s);
+void space_active_cells_update(struct space *s, int cid,
+                               integertime_t ti_next);
+int space_active_cells_get(const struct space *s, timebin_t bin, int *list);
 void space_parts_get_cell_index(struct space *s, int *ind, int *cell_counts,
                                 size_t *count_inhibited_parts,
                                 size_t *count_extra_parts, int verbose);
@@ -338,6 +477,8 @@ void space_bparts_get_cell_index(struct space *s, int *sind, int *cell_counts,
                                  size_t *count_inhibited_bparts,
                                  size_t *count_extra_bparts, int verbose);
 void space_synchronize_particle_positions(struct space *s);
+void space_synchronize_particle_positions_mapper(void *map_data, int nr_gparts,
+                                                 void *extra_data);
 void space_first_init_parts(struct space *s, int verbose);
 void space_first_init_gparts(struct space *s, int verbose);
 void space_first_init_sparts(struct space *s, int verbose);
@@ -363,11 +504,15 @@ void space_check_cosmology(struct space *s, const struct cosmology *cosmo,
 void space_reset_task_counters(struct space *s);
 void space_clean(struct space *s);
 void space_free_cells(struct space *s);
+void space_reset_cells(struct space *s);
+void space_clean_task_pointers(struct space *s);
 
 void space_free_foreign_parts(struct space *s);
 
 void space_struct_dump(struct space *s, FILE *stream);
 void space_struct_restore(struct space *s, FILE *stream);
+void space_struct_append(struct space *s, FILE *stream);
+void space_struct_drop_particles(struct space *s);
 void space_write_cell_hierarchy(const struct space *s);
 
 #endif /* SWIFT_SPACE_H */
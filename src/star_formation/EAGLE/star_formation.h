@@ -406,6 +406,7 @@ INLINE static void star_formation_copy_properties(
 
   /* Store the chemistry struct in the star particle */
   sp->chemistry_data = p->chemistry_data;
+  sp->chemistry_history = xp->chemistry_data;
 
   /* Store the tracers data */
   sp->tracers_data = xp->tracers_data;
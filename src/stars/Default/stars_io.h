@@ -134,6 +134,14 @@ INLINE static void stars_props_init(struct stars_props *sp,
   sp->max_smoothing_iterations = parser_get_opt_param_int(
       params, "Stars:max_ghost_iterations", p->max_smoothing_iterations);
 
+  /* Do we record the candidate neighbours for the ghost iterations? */
+  sp->ghost_neighbour_lists = parser_get_opt_param_int(
+      params, "Stars:ghost_neighbour_lists", p->ghost_neighbour_lists);
+
+  /* Do we record the neighbours of the density loop for the feedback? */
+  sp->feedback_neighbour_lists =
+      parser_get_opt_param_int(params, "Stars:feedback_neighbour_lists", 0);
+
   /* Time integration properties */
   const float max_volume_change =
       parser_get_opt_param_float(params, "Stars:max_volume_change", -1);
@@ -164,6 +172,12 @@ INLINE static void stars_props_print(const struct stars_props *sp) {
 
   message("Maximal iterations in ghost task set to %d",
           sp->max_smoothing_iterations);
+
+  if (sp->ghost_neighbour_lists)
+    message("Stars ghost iterations use lists of candidate neighbours.");
+
+  if (sp->feedback_neighbour_lists)
+    message("Stars feedback loop re-uses the neighbours of the density loop.");
 }
 
 #if defined(HAVE_HDF5)
@@ -100,6 +100,9 @@ struct spart {
   /*! Chemistry structure */
   struct chemistry_part_data chemistry_data;
 
+  /*! Enrichment history inherited from the progenitor gas particle */
+  struct chemistry_xpart_data chemistry_history;
+
   /*! Particle time bin */
   timebin_t time_bin;
 
@@ -150,6 +153,13 @@ struct stars_props {
   /*! Maximal number of iterations to converge h */
   int max_smoothing_iterations;
 
+  /*! Do the ghost iterations use lists of candidate neighbours? */
+  int ghost_neighbour_lists;
+
+  /*! Does the feedback loop re-use the neighbours found by the density loop?
+   */
+  int feedback_neighbour_lists;
+
   /*! Maximal change of h over one time-step */
   float log_max_h_change;
 
@@ -95,28 +95,23 @@ void stats_init(struct statistics *s) {
 }
 
 /**
- * @brief The #threadpool mapper function used to collect statistics for #part.
+ * @brief Adds the contribution of a #part to a #statistics aggregator.
  *
- * @param map_data Pointer to the particles.
- * @param nr_parts The number of particles in this chunk
- * @param extra_data The #statistics aggregator.
+ * @param p The #part.
+ * @param xp The #xpart of this #part.
+ * @param e The #engine.
+ * @param stats The (local) #statistics aggregator to add to.
  */
-void stats_collect_part_mapper(void *map_data, int nr_parts, void *extra_data) {
+__attribute__((always_inline)) INLINE static void stats_add_part(
+    const struct part *p, const struct xpart *xp, const struct engine *e,
+    struct statistics *stats) {
 
-  /* Unpack the data */
-  const struct index_data *data = (struct index_data *)extra_data;
-  const struct space *s = data->s;
-  const struct engine *e = s->e;
   const int with_cosmology = (e->policy & engine_policy_cosmology);
   const int with_ext_grav = (e->policy & engine_policy_external_gravity);
   const int with_self_grav = (e->policy & engine_policy_self_gravity);
   const integertime_t ti_current = e->ti_current;
   const double time_base = e->time_base;
   const double time = e->time;
-  const struct part *restrict parts = (struct part *)map_data;
-  const struct xpart *restrict xparts =
-      s->xparts + (ptrdiff_t)(parts - s->parts);
-  struct statistics *const global_stats = data->stats;
 
   /* Some information about the physical model */
   const struct external_potential *potential = e->external_potential;
@@ -127,81 +122,178 @@ void stats_collect_part_mapper(void *map_data, int nr_parts, void *extra_data) {
   const float a_inv = cosmo->a_inv;
   const float a_inv2 = a_inv * a_inv;
 
+  const struct gpart *gp = p->gpart;
+
+  /* Get useful time variables */
+  const integertime_t ti_beg = get_integer_time_begin(ti_current, p->time_bin);
+  const integertime_t ti_end = get_integer_time_end(ti_current, p->time_bin);
+
+  /* Get time-step since the last kick */
+  float dt_kick_grav, dt_kick_hydro, dt_therm;
+  if (with_cosmology) {
+    dt_kick_grav = cosmology_get_grav_kick_factor(cosmo, ti_beg, ti_current);
+    dt_kick_grav -=
+        cosmology_get_grav_kick_factor(cosmo, ti_beg, (ti_beg + ti_end) / 2);
+    dt_kick_hydro = cosmology_get_hydro_kick_factor(cosmo, ti_beg, ti_current);
+    dt_kick_hydro -=
+        cosmology_get_hydro_kick_factor(cosmo, ti_beg, (ti_beg + ti_end) / 2);
+    dt_therm = cosmology_get_therm_kick_factor(cosmo, ti_beg, ti_current);
+    dt_therm -=
+        cosmology_get_therm_kick_factor(cosmo, ti_beg, (ti_beg + ti_end) / 2);
+  } else {
+    dt_kick_grav = (ti_current - ((ti_beg + ti_end) / 2)) * time_base;
+    dt_kick_hydro = (ti_current - ((ti_beg + ti_end) / 2)) * time_base;
+    dt_therm = (ti_current - ((ti_beg + ti_end) / 2)) * time_base;
+  }
+
+  float v[3];
+  hydro_get_drifted_velocities(p, xp, dt_kick_hydro, dt_kick_grav, v);
+  const double x[3] = {p->x[0], p->x[1], p->x[2]};
+  const float m = hydro_get_mass(p);
+  const float entropy = hydro_get_drifted_physical_entropy(p, cosmo);
+  const float u_inter = hydro_get_drifted_physical_internal_energy(p, cosmo);
+
+  /* Collect mass */
+  stats->mass += m;
+
+  /* Collect centre of mass */
+  stats->centre_of_mass[0] += m * x[0];
+  stats->centre_of_mass[1] += m * x[1];
+  stats->centre_of_mass[2] += m * x[2];
+
+  /* Collect momentum */
+  stats->mom[0] += m * v[0];
+  stats->mom[1] += m * v[1];
+  stats->mom[2] += m * v[2];
+
+  /* Collect angular momentum */
+  stats->ang_mom[0] += m * (x[1] * v[2] - x[2] * v[1]);
+  stats->ang_mom[1] += m * (x[2] * v[0] - x[0] * v[2]);
+  stats->ang_mom[2] += m * (x[0] * v[1] - x[1] * v[0]);
+
+  /* Collect energies. */
+  stats->E_kin += 0.5f * m * (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]) *
+                  a_inv2; /* 1/2 m a^2 \dot{r}^2 */
+  stats->E_int += m * u_inter;
+  stats->E_rad += cooling_get_radiated_energy(xp);
+  if (gp != NULL && with_self_grav)
+    stats->E_pot_self += 0.5f * m * gravity_get_physical_potential(gp, cosmo);
+  if (gp != NULL && with_ext_grav)
+    stats->E_pot_ext += m * external_gravity_get_potential_energy(
+                                time, potential, phys_const, gp);
+
+  /* Collect entropy */
+  stats->entropy += m * entropy;
+}
+
+/**
+ * @brief Adds the contribution of a #gpart to a #statistics aggregator.
+ *
+ * The #gpart with a baryonic counterpart are ignored as they are accounted
+ * for with their counterpart.
+ *
+ * @param gp The #gpart.
+ * @param e The #engine.
+ * @param stats The (local) #statistics aggregator to add to.
+ */
+__attribute__((always_inline)) INLINE static void stats_add_gpart(
+    const struct gpart *gp, const struct engine *e,
+    struct statistics *stats) {
+
+  /* If the g-particle has a counterpart, ignore it */
+  if (gp->id_or_neg_offset < 0) return;
+
+  const int with_cosmology = (e->policy & engine_policy_cosmology);
+  const int with_ext_grav = (e->policy & engine_policy_external_gravity);
+  const int with_self_grav = (e->policy & engine_policy_self_gravity);
+  const integertime_t ti_current = e->ti_current;
+  const double time_base = e->time_base;
+  const double time = e->time;
+
+  /* Some information about the physical model */
+  const struct external_potential *potential = e->external_potential;
+  const struct phys_const *phys_const = e->physical_constants;
+  const struct cosmology *cosmo = e->cosmology;
+
+  /* Some constants from cosmology */
+  const float a_inv = cosmo->a_inv;
+  const float a_inv2 = a_inv * a_inv;
+
+  /* Get useful variables */
+  const integertime_t ti_beg = get_integer_time_begin(ti_current, gp->time_bin);
+  const integertime_t ti_end = get_integer_time_end(ti_current, gp->time_bin);
+
+  /* Get time-step since the last kick */
+  float dt_kick_grav;
+  if (with_cosmology) {
+    dt_kick_grav = cosmology_get_grav_kick_factor(cosmo, ti_beg, ti_current);
+    dt_kick_grav -=
+        cosmology_get_grav_kick_factor(cosmo, ti_beg, (ti_beg + ti_end) / 2);
+  } else {
+    dt_kick_grav = (ti_current - ((ti_beg + ti_end) / 2)) * time_base;
+  }
+
+  /* Extrapolate velocities */
+  const float v[3] = {gp->v_full[0] + gp->a_grav[0] * dt_kick_grav,
+                      gp->v_full[1] + gp->a_grav[1] * dt_kick_grav,
+                      gp->v_full[2] + gp->a_grav[2] * dt_kick_grav};
+
+  const float m = gravity_get_mass(gp);
+  const double x[3] = {gp->x[0], gp->x[1], gp->x[2]};
+
+  /* Collect mass */
+  stats->mass += m;
+
+  /* Collect centre of mass */
+  stats->centre_of_mass[0] += m * x[0];
+  stats->centre_of_mass[1] += m * x[1];
+  stats->centre_of_mass[2] += m * x[2];
+
+  /* Collect momentum */
+  stats->mom[0] += m * v[0];
+  stats->mom[1] += m * v[1];
+  stats->mom[2] += m * v[2];
+
+  /* Collect angular momentum */
+  stats->ang_mom[0] += m * (x[1] * v[2] - x[2] * v[1]);
+  stats->ang_mom[1] += m * (x[2] * v[0] - x[0] * v[2]);
+  stats->ang_mom[2] += m * (x[0] * v[1] - x[1] * v[0]);
+
+  /* Collect energies. */
+  stats->E_kin += 0.5f * m * (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]) *
+                  a_inv2; /* 1/2 m a^2 \dot{r}^2 */
+  if (with_self_grav)
+    stats->E_pot_self += 0.5f * m * gravity_get_physical_potential(gp, cosmo);
+  if (with_ext_grav)
+    stats->E_pot_ext += m * external_gravity_get_potential_energy(
+                                time, potential, phys_const, gp);
+}
+
+/**
+ * @brief The #threadpool mapper function used to collect statistics for #part.
+ *
+ * @param map_data Pointer to the particles.
+ * @param nr_parts The number of particles in this chunk
+ * @param extra_data The #statistics aggregator.
+ */
+void stats_collect_part_mapper(void *map_data, int nr_parts, void *extra_data) {
+
+  /* Unpack the data */
+  const struct index_data *data = (struct index_data *)extra_data;
+  const struct space *s = data->s;
+  const struct engine *e = s->e;
+  const struct part *restrict parts = (struct part *)map_data;
+  const struct xpart *restrict xparts =
+      s->xparts + (ptrdiff_t)(parts - s->parts);
+  struct statistics *const global_stats = data->stats;
+
   /* Local accumulator */
   struct statistics stats;
   stats_init(&stats);
 
   /* Loop over particles */
-  for (int k = 0; k < nr_parts; k++) {
-
-    /* Get the particle */
-    const struct part *p = &parts[k];
-    const struct xpart *xp = &xparts[k];
-    const struct gpart *gp = p->gpart;
-
-    /* Get useful time variables */
-    const integertime_t ti_beg =
-        get_integer_time_begin(ti_current, p->time_bin);
-    const integertime_t ti_end = get_integer_time_end(ti_current, p->time_bin);
-
-    /* Get time-step since the last kick */
-    float dt_kick_grav, dt_kick_hydro, dt_therm;
-    if (with_cosmology) {
-      dt_kick_grav = cosmology_get_grav_kick_factor(cosmo, ti_beg, ti_current);
-      dt_kick_grav -=
-          cosmology_get_grav_kick_factor(cosmo, ti_beg, (ti_beg + ti_end) / 2);
-      dt_kick_hydro =
-          cosmology_get_hydro_kick_factor(cosmo, ti_beg, ti_current);
-      dt_kick_hydro -=
-          cosmology_get_hydro_kick_factor(cosmo, ti_beg, (ti_beg + ti_end) / 2);
-      dt_therm = cosmology_get_therm_kick_factor(cosmo, ti_beg, ti_current);
-      dt_therm -=
-          cosmology_get_therm_kick_factor(cosmo, ti_beg, (ti_beg + ti_end) / 2);
-    } else {
-      dt_kick_grav = (ti_current - ((ti_beg + ti_end) / 2)) * time_base;
-      dt_kick_hydro = (ti_current - ((ti_beg + ti_end) / 2)) * time_base;
-      dt_therm = (ti_current - ((ti_beg + ti_end) / 2)) * time_base;
-    }
-
-    float v[3];
-    hydro_get_drifted_velocities(p, xp, dt_kick_hydro, dt_kick_grav, v);
-    const double x[3] = {p->x[0], p->x[1], p->x[2]};
-    const float m = hydro_get_mass(p);
-    const float entropy = hydro_get_drifted_physical_entropy(p, cosmo);
-    const float u_inter = hydro_get_drifted_physical_internal_energy(p, cosmo);
-
-    /* Collect mass */
-    stats.mass += m;
-
-    /* Collect centre of mass */
-    stats.centre_of_mass[0] += m * x[0];
-    stats.centre_of_mass[1] += m * x[1];
-    stats.centre_of_mass[2] += m * x[2];
-
-    /* Collect momentum */
-    stats.mom[0] += m * v[0];
-    stats.mom[1] += m * v[1];
-    stats.mom[2] += m * v[2];
-
-    /* Collect angular momentum */
-    stats.ang_mom[0] += m * (x[1] * v[2] - x[2] * v[1]);
-    stats.ang_mom[1] += m * (x[2] * v[0] - x[0] * v[2]);
-    stats.ang_mom[2] += m * (x[0] * v[1] - x[1] * v[0]);
-
-    /* Collect energies. */
-    stats.E_kin += 0.5f * m * (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]) *
-                   a_inv2; /* 1/2 m a^2 \dot{r}^2 */
-    stats.E_int += m * u_inter;
-    stats.E_rad += cooling_get_radiated_energy(xp);
-    if (gp != NULL && with_self_grav)
-      stats.E_pot_self += 0.5f * m * gravity_get_physical_potential(gp, cosmo);
-    if (gp != NULL && with_ext_grav)
-      stats.E_pot_ext += m * external_gravity_get_potential_energy(
-                                 time, potential, phys_const, gp);
-
-    /* Collect entropy */
-    stats.entropy += m * entropy;
-  }
+  for (int k = 0; k < nr_parts; k++)
+    stats_add_part(&parts[k], &xparts[k], e, &stats);
 
   /* Now write back to memory */
   if (lock_lock(&global_stats->lock) == 0) stats_add(global_stats, &stats);
@@ -222,93 +314,45 @@ void stats_collect_gpart_mapper(void *map_data, int nr_gparts,
   const struct index_data *data = (struct index_data *)extra_data;
   const struct space *s = data->s;
   const struct engine *e = s->e;
-  const int with_cosmology = (e->policy & engine_policy_cosmology);
-  const int with_ext_grav = (e->policy & engine_policy_external_gravity);
-  const int with_self_grav = (e->policy & engine_policy_self_gravity);
-  const integertime_t ti_current = e->ti_current;
-  const double time_base = e->time_base;
-  const double time = e->time;
   const struct gpart *restrict gparts = (struct gpart *)map_data;
   struct statistics *const global_stats = data->stats;
 
-  /* Some information about the physical model */
-  const struct external_potential *potential = e->external_potential;
-  const struct phys_const *phys_const = e->physical_constants;
-  const struct cosmology *cosmo = e->cosmology;
-
-  /* Some constants from cosmology */
-  const float a_inv = cosmo->a_inv;
-  const float a_inv2 = a_inv * a_inv;
-
   /* Local accumulator */
   struct statistics stats;
   stats_init(&stats);
 
   /* Loop over particles */
-  for (int k = 0; k < nr_gparts; k++) {
-
-    /* Get the particle */
-    const struct gpart *gp = &gparts[k];
-
-    /* If the g-particle has a counterpart, ignore it */
-    if (gp->id_or_neg_offset < 0) continue;
-
-    /* Get useful variables */
-    const integertime_t ti_beg =
-        get_integer_time_begin(ti_current, gp->time_bin);
-    const integertime_t ti_end = get_integer_time_end(ti_current, gp->time_bin);
-
-    /* Get time-step since the last kick */
-    float dt_kick_grav;
-    if (with_cosmology) {
-      dt_kick_grav = cosmology_get_grav_kick_factor(cosmo, ti_beg, ti_current);
-      dt_kick_grav -=
-          cosmology_get_grav_kick_factor(cosmo, ti_beg, (ti_beg + ti_end) / 2);
-    } else {
-      dt_kick_grav = (ti_current - ((ti_beg + ti_end) / 2)) * time_base;
-    }
-
-    /* Extrapolate velocities */
-    const float v[3] = {gp->v_full[0] + gp->a_grav[0] * dt_kick_grav,
-                        gp->v_full[1] + gp->a_grav[1] * dt_kick_grav,
-                        gp->v_full[2] + gp->a_grav[2] * dt_kick_grav};
-
-    const float m = gravity_get_mass(gp);
-    const double x[3] = {gp->x[0], gp->x[1], gp->x[2]};
-
-    /* Collect mass */
-    stats.mass += m;
-
-    /* Collect centre of mass */
-    stats.centre_of_mass[0] += m * x[0];
-    stats.centre_of_mass[1] += m * x[1];
-    stats.centre_of_mass[2] += m * x[2];
-
-    /* Collect momentum */
-    stats.mom[0] += m * v[0];
-    stats.mom[1] += m * v[1];
-    stats.mom[2] += m * v[2];
-
-    /* Collect angular momentum */
-    stats.ang_mom[0] += m * (x[1] * v[2] - x[2] * v[1]);
-    stats.ang_mom[1] += m * (x[2] * v[0] - x[0] * v[2]);
-    stats.ang_mom[2] += m * (x[0] * v[1] - x[1] * v[0]);
-
-    /* Collect energies. */
-    stats.E_kin += 0.5f * m * (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]) *
-                   a_inv2; /* 1/2 m a^2 \dot{r}^2 */
-    if (with_self_grav)
-      stats.E_pot_self += 0.5f * m * gravity_get_physical_potential(gp, cosmo);
-    if (with_ext_grav)
-      stats.E_pot_ext += m * external_gravity_get_potential_energy(
-                                 time, potential, phys_const, gp);
-  }
+  for (int k = 0; k < nr_gparts; k++) stats_add_gpart(&gparts[k], e, &stats);
 
   /* Now write back to memory */
   if (lock_lock(&global_stats->lock) == 0) stats_add(global_stats, &stats);
   if (lock_unlock(&global_stats->lock) != 0) error("Failed to unlock stats.");
 }
 
+/**
+ * @brief Adds the statistics of all the particles of a #cell to a (local)
+ * #statistics aggregator.
+ *
+ * This is used to collect the statistics while the particles of the cell are
+ * still in cache, e.g. right after they have been drifted.
+ *
+ * @param c The #cell.
+ * @param e The #engine.
+ * @param stats The #statistics aggregator to add to.
+ */
+void stats_collect_cell(const struct cell *c, const struct engine *e,
+                        struct statistics *stats) {
+
+  const struct part *restrict parts = c->hydro.parts;
+  const struct xpart *restrict xparts = c->hydro.xparts;
+  const struct gpart *restrict gparts = c->grav.parts;
+
+  for (int k = 0; k < c->hydro.count; k++)
+    stats_add_part(&parts[k], &xparts[k], e, stats);
+
+  for (int k = 0; k < c->grav.count; k++) stats_add_gpart(&gparts[k], e, stats);
+}
+
 /**
  * @brief Collect physical statistics over all particles in a #space.
  *
@@ -66,6 +66,8 @@ struct statistics {
 };
 
 void stats_collect(const struct space* s, struct statistics* stats);
+void stats_collect_cell(const struct cell* c, const struct engine* e,
+                        struct statistics* stats);
 void stats_add(struct statistics* a, const struct statistics* b);
 void stats_print_to_file(FILE* file, const struct statistics* stats,
                          double time);
@@ -31,6 +31,7 @@
 #include "chemistry.h"
 #include "clocks.h"
 #include "common_io.h"
+#include "concurrent_hashmap.h"
 #include "const.h"
 #include "cooling.h"
 #include "cooling_struct.h"
@@ -49,6 +50,8 @@
 #include "hashmap.h"
 #include "hydro.h"
 #include "hydro_properties.h"
+#include "ic_generator.h"
+#include "lightcone.h"
 #include "lock.h"
 #include "logger.h"
 #include "logger_io.h"
@@ -19,6 +19,9 @@
 #ifndef SWIFT_VELOCIRAPTOR_PART_H
 #define SWIFT_VELOCIRAPTOR_PART_H
 
+/* Some standard headers. */
+#include <stddef.h>
+
 #include "part_type.h"
 
 /**
@@ -62,4 +65,19 @@ struct swift_vel_part {
   int index;
 };
 
+/**
+ * @brief Function used by VELOCIraptor to read the SWIFT particles on demand.
+ *
+ * Fills the @p count particles starting at index @p offset of the local
+ * #gpart array into the buffer @p out provided by VELOCIraptor.
+ *
+ * @param swift_data The opaque pointer given to VELOCIraptor by SWIFT.
+ * @param offset The index of the first #gpart to convert.
+ * @param count The number of #gpart to convert.
+ * @param out The buffer of at least @p count particles to fill.
+ */
+typedef void (*swift_vel_fetch_function)(void *swift_data, size_t offset,
+                                         size_t count,
+                                         struct swift_vel_part *out);
+
 #endif /* SWIFT_VELOCIRAPTOR_PART_H */
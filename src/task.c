@@ -107,6 +107,9 @@ const char *subtaskID_names[task_subtype_count] = {
 #ifdef WITH_MPI
 /* MPI communicators for the subtypes. */
 MPI_Comm subtaskMPI_comms[task_subtype_count];
+
+/* MPI state of the communication tasks, see scheduler_set_comms(). */
+struct task_comm *task_comms = NULL;
 #endif
 
 /**
@@ -482,7 +485,8 @@ int task_lock(struct task *t) {
     case task_type_send:
 #ifdef WITH_MPI
       /* Check the status of the MPI request. */
-      if ((err = MPI_Test(&t->req, &res, &stat)) != MPI_SUCCESS) {
+      if ((err = MPI_Test(&task_get_comm(t)->req, &res, &stat)) !=
+          MPI_SUCCESS) {
         char buff[MPI_MAX_ERROR_STRING];
         int len;
         MPI_Error_string(err, buff, &len);
@@ -871,6 +875,338 @@ void task_dump_all(struct engine *e, int step) {
 #endif  // SWIFT_DEBUG_TASKS
 }
 
+#ifdef SWIFT_DEBUG_TASKS
+
+/**
+ * @brief A growing buffer of variable-length encoded integers.
+ */
+struct task_trace_buffer {
+
+  /*! The encoded data */
+  unsigned char *data;
+
+  /*! Number of bytes used and allocated */
+  size_t size, alloc;
+};
+
+/**
+ * @brief Append an unsigned integer to a #task_trace_buffer, 7 bits per byte
+ * with the high bit set on all the bytes but the last.
+ *
+ * @param b The #task_trace_buffer.
+ * @param v The value.
+ */
+static void task_trace_put(struct task_trace_buffer *b, unsigned long long v) {
+
+  if (b->size + 10 > b->alloc) {
+    b->alloc = 2 * b->alloc + 1024;
+    if ((b->data = (unsigned char *)realloc(b->data, b->alloc)) == NULL)
+      error("Failed to grow the task trace buffer.");
+  }
+  while (v >= 0x80ULL) {
+    b->data[b->size++] = (unsigned char)(v | 0x80ULL);
+    v >>= 7;
+  }
+  b->data[b->size++] = (unsigned char)v;
+}
+
+/**
+ * @brief Append a signed integer to a #task_trace_buffer, zig-zag encoded so
+ * that small negative values stay short.
+ *
+ * @param b The #task_trace_buffer.
+ * @param v The value.
+ */
+static void task_trace_put_signed(struct task_trace_buffer *b, long long v) {
+  task_trace_put(b,
+                 ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63));
+}
+
+/**
+ * @brief Append the location of a #cell to a #task_trace_buffer: the index
+ * of its top-level cell plus one, or zero for no cell, and its depth.
+ *
+ * @param b The #task_trace_buffer.
+ * @param s The #space.
+ * @param c The #cell, can be NULL.
+ */
+static void task_trace_put_cell(struct task_trace_buffer *b,
+                                const struct space *s, const struct cell *c) {
+  if (c == NULL) {
+    task_trace_put(b, 0);
+  } else {
+    task_trace_put(b, (c->top - s->cells_top) + 1);
+    task_trace_put(b, c->depth);
+  }
+}
+
+#ifdef WITH_MPI
+/**
+ * @brief The number of bytes of particle or cell data carried by a send or
+ * recv #task, as if sent in full and without compaction.
+ *
+ * @param t The communication #task.
+ */
+static size_t task_trace_comm_size(const struct task *t) {
+
+  const struct cell *c = t->ci;
+  switch (t->subtype) {
+    case task_subtype_xv:
+    case task_subtype_rho:
+    case task_subtype_gradient:
+      return c->hydro.count * sizeof(struct part);
+    case task_subtype_gpart:
+      return c->grav.count * sizeof(struct gpart);
+    case task_subtype_spart:
+      return c->stars.count * sizeof(struct spart);
+    case task_subtype_bpart:
+      return c->black_holes.count * sizeof(struct bpart);
+    case task_subtype_multipole:
+      return c->mpi.pcell_size * sizeof(struct gravity_tensors);
+    case task_subtype_tend_part:
+      return c->mpi.pcell_size * sizeof(struct pcell_step_hydro);
+    case task_subtype_tend_gpart:
+      return c->mpi.pcell_size * sizeof(struct pcell_step_grav);
+    case task_subtype_tend_spart:
+      return c->mpi.pcell_size * sizeof(struct pcell_step_stars);
+    case task_subtype_tend_bpart:
+      return c->mpi.pcell_size * sizeof(struct pcell_step_black_holes);
+    case task_subtype_sf_counts:
+      return c->mpi.pcell_size * sizeof(struct pcell_sf);
+    default:
+      return 0;
+  }
+}
+#endif
+
+/**
+ * @brief Sort comparison function for the tasks of a trace, by start time.
+ */
+static int task_trace_cmp(const void *a, const void *b) {
+  const struct task *ta = *(const struct task **)a;
+  const struct task *tb = *(const struct task **)b;
+  return (ta->tic > tb->tic) - (ta->tic < tb->tic);
+}
+
+#endif /* SWIFT_DEBUG_TASKS */
+
+/**
+ * @brief Dump all the tasks of all the known engines into a compact binary
+ * file for postprocessing.
+ *
+ * Holds the same information as task_dump_all(), plus the location of the
+ * cells and the peer and size of the communications, in a fraction of the
+ * space. The file "thread_info-stepn.bin", or "thread_info_MPI-stepn.bin"
+ * under MPI, starts with the 8 characters "SWIFTTRC" and three 32-bit
+ * integers: the format version, whether the run uses MPI, and the number of
+ * ranks. One block per traced rank follows, a 64-bit byte count and then
+ * variable-length integers. Each rank encodes its block in memory and all
+ * the blocks are written collectively. Only one rank in
+ * #engine::task_dumps_rank_stride is traced.
+ *
+ * tools/task_plots/convert_trace.py turns these files into the text format
+ * of task_dump_all().
+ *
+ * @param e the #engine
+ * @param step the current step.
+ */
+void task_dump_binary(struct engine *e, int step) {
+
+#ifdef SWIFT_DEBUG_TASKS
+
+  const struct space *s = e->s;
+  const struct scheduler *sched = &e->sched;
+  const int traced = (e->nodeID % e->task_dumps_rank_stride == 0);
+
+  /* Collect the tasks that ran, in the order they started. */
+  int nr_tasks = 0;
+  const struct task **tasks = NULL;
+  if (traced) {
+    if ((tasks = (const struct task **)malloc(sizeof(struct task *) *
+                                              (sched->nr_tasks + 1))) == NULL)
+      error("Failed to allocate the list of traced tasks.");
+    for (int k = 0; k < sched->nr_tasks; k++)
+      if (!sched->tasks[k].implicit && sched->tasks[k].toc != 0)
+        tasks[nr_tasks++] = &sched->tasks[k];
+    qsort(tasks, nr_tasks, sizeof(struct task *), task_trace_cmp);
+  }
+
+  /* Encode them, times as differences to the previous task. */
+  struct task_trace_buffer b = {NULL, 0, 0};
+  if (traced) {
+    task_trace_put(&b, e->nodeID);
+    task_trace_put(&b, nr_tasks);
+    task_trace_put(&b, e->tic_step);
+    task_trace_put(&b, e->toc_step);
+    task_trace_put(&b, e->updates);
+    task_trace_put(&b, e->g_updates);
+    task_trace_put(&b, e->s_updates);
+    task_trace_put(&b, clocks_get_cpufreq());
+
+    ticks last_tic = e->tic_step;
+    for (int k = 0; k < nr_tasks; k++) {
+      const struct task *t = tasks[k];
+      task_trace_put_signed(&b, (long long)t->tic - (long long)last_tic);
+      task_trace_put(&b, t->toc - t->tic);
+      last_tic = t->tic;
+      task_trace_put_signed(&b, t->rid);
+      task_trace_put(&b, t->type);
+      task_trace_put(&b, t->subtype);
+      task_trace_put_signed(&b, t->flags);
+      task_trace_put_signed(&b, t->sid);
+      task_trace_put_cell(&b, s, t->ci);
+      task_trace_put_cell(&b, s, t->cj);
+      task_trace_put(&b, t->ci != NULL ? t->ci->hydro.count : 0);
+      task_trace_put(&b, t->cj != NULL ? t->cj->hydro.count : 0);
+      task_trace_put(&b, t->ci != NULL ? t->ci->grav.count : 0);
+      task_trace_put(&b, t->cj != NULL ? t->cj->grav.count : 0);
+#ifdef WITH_MPI
+      /* The peer plus one, zero if not a communication, and the size. */
+      if (t->type == task_type_send) {
+        task_trace_put(&b, t->cj->nodeID + 1);
+        task_trace_put(&b, task_trace_comm_size(t));
+      } else if (t->type == task_type_recv) {
+        task_trace_put(&b, t->ci->nodeID + 1);
+        task_trace_put(&b, task_trace_comm_size(t));
+      } else {
+        task_trace_put(&b, 0);
+      }
+#endif
+    }
+  }
+  free(tasks);
+
+  /* The file header. */
+#ifdef WITH_MPI
+  const int with_mpi = 1;
+#else
+  const int with_mpi = 0;
+#endif
+  char header[20] = "SWIFTTRC";
+  const int header_ints[3] = {/*version=*/1, with_mpi, e->nr_nodes};
+  memcpy(header + 8, header_ints, sizeof(header_ints));
+
+  /* Our block goes with its size in front. */
+  const unsigned long long block_size = b.size;
+
+#ifdef WITH_MPI
+  char dumpfile[40];
+  snprintf(dumpfile, sizeof(dumpfile), "thread_info_MPI-step%d.bin", step);
+
+  /* Where does our block go? */
+  unsigned long long offset = 0;
+  unsigned long long my_size = traced ? sizeof(block_size) + b.size : 0;
+  MPI_Exscan(&my_size, &offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+             MPI_COMM_WORLD);
+  if (e->nodeID == 0) offset = 0;
+  offset += sizeof(header);
+
+  MPI_File fh;
+  int err =
+      MPI_File_open(MPI_COMM_WORLD, dumpfile, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                    MPI_INFO_NULL, &fh);
+  if (err != MPI_SUCCESS) mpi_error(err, "Failed to open the task trace.");
+  MPI_File_set_size(fh, 0);
+  if (e->nodeID == 0)
+    MPI_File_write_at(fh, 0, header, sizeof(header), MPI_BYTE,
+                      MPI_STATUS_IGNORE);
+  if (traced)
+    MPI_File_write_at(fh, offset, &block_size, sizeof(block_size), MPI_BYTE,
+                      MPI_STATUS_IGNORE);
+  err = MPI_File_write_at_all(fh, offset + sizeof(block_size), b.data,
+                              traced ? b.size : 0, MPI_BYTE,
+                              MPI_STATUS_IGNORE);
+  if (err != MPI_SUCCESS) mpi_error(err, "Failed to write the task trace.");
+  MPI_File_close(&fh);
+#else
+  char dumpfile[40];
+  snprintf(dumpfile, sizeof(dumpfile), "thread_info-step%d.bin", step);
+  FILE *file = fopen(dumpfile, "wb");
+  if (file == NULL) error("Failed to open the file '%s'.", dumpfile);
+  if (fwrite(header, 1, sizeof(header), file) != sizeof(header) ||
+      fwrite(&block_size, sizeof(block_size), 1, file) != 1 ||
+      fwrite(b.data, 1, b.size, file) != b.size)
+    error("Failed to write the task trace.");
+  fclose(file);
+#endif
+
+  free(b.data);
+#endif /* SWIFT_DEBUG_TASKS */
+}
+
+/**
+ * @brief Dump the performance counters sampled around the tasks of this
+ * engine, summed per type and sub-type of the tasks and depth of their cell.
+ *
+ * The time spent in the tasks, in millisec, comes before the counters. The
+ * cells deeper than #task_counters_max_depth are binned with that depth.
+ *
+ * @param dumpfile name of the file for the output.
+ * @param e the #engine
+ */
+void task_dump_counters(const char *dumpfile, struct engine *e) {
+
+#ifdef SWIFT_TASK_COUNTERS
+
+  const int nr_counters = task_counters_count();
+  const size_t nr_bins =
+      task_type_count * task_subtype_count * task_counters_max_depth;
+
+  int *count = (int *)calloc(nr_bins, sizeof(int));
+  double *time = (double *)calloc(nr_bins, sizeof(double));
+  long long *sum =
+      (long long *)calloc(nr_bins * task_counters_max, sizeof(long long));
+  if (count == NULL || time == NULL || sum == NULL)
+    error("Failed to allocate the task counter sums.");
+
+  for (int l = 0; l < e->sched.nr_tasks; l++) {
+    const struct task *t = &e->sched.tasks[l];
+    if (t->implicit || t->toc == 0) continue;
+
+    int depth = (t->ci != NULL) ? t->ci->depth : 0;
+    if (depth >= task_counters_max_depth) depth = task_counters_max_depth - 1;
+    const size_t bin =
+        ((size_t)t->type * task_subtype_count + t->subtype) *
+            task_counters_max_depth +
+        depth;
+
+    count[bin] += 1;
+    time[bin] += t->toc - t->tic;
+    for (int k = 0; k < nr_counters; k++)
+      sum[bin * task_counters_max + k] += t->counters[k];
+  }
+
+  FILE *dfile = fopen(dumpfile, "w");
+  if (dfile == NULL) error("Failed to open '%s'.", dumpfile);
+  fprintf(dfile, "# task depth ntasks time(ms)");
+  for (int k = 0; k < nr_counters; k++)
+    fprintf(dfile, " %s", task_counters_name(k));
+  fprintf(dfile, "\n");
+
+  for (int j = 0; j < task_type_count; j++) {
+    for (int k = 0; k < task_subtype_count; k++) {
+      for (int d = 0; d < task_counters_max_depth; d++) {
+        const size_t bin =
+            ((size_t)j * task_subtype_count + k) * task_counters_max_depth + d;
+        if (count[bin] == 0) continue;
+        fprintf(dfile, "%15s/%-10s %5d %10d %14.4f", taskID_names[j],
+                subtaskID_names[k], d, count[bin],
+                clocks_from_ticks(time[bin]));
+        for (int c = 0; c < nr_counters; c++)
+          fprintf(dfile, " %16lld", sum[bin * task_counters_max + c]);
+        fprintf(dfile, "\n");
+      }
+    }
+  }
+  fclose(dfile);
+
+  free(count);
+  free(time);
+  free(sum);
+
+#endif  // SWIFT_TASK_COUNTERS
+}
+
 /**
  * @brief Generate simple statistics about the times used by the tasks of
  *        all the engines and write these into two format, a human readable
@@ -999,3 +1335,143 @@ void task_dump_stats(const char *dumpfile, struct engine *e, int header,
   }
 #endif
 }
+
+/**
+ * @brief Add a task to the slowest ones of a #task_step_analysis, if it is
+ * slow enough.
+ *
+ * @param a The #task_step_analysis.
+ * @param ts The task.
+ */
+static void task_analysis_add_slowest(struct task_step_analysis *a,
+                                      const struct task_slowest *ts) {
+
+  if (a->nr_slowest == task_analysis_nr_slowest &&
+      ts->ticks <= a->slowest[task_analysis_nr_slowest - 1].ticks)
+    return;
+
+  int i = (a->nr_slowest < task_analysis_nr_slowest) ? a->nr_slowest++
+                                                     : a->nr_slowest - 1;
+  for (; i > 0 && a->slowest[i - 1].ticks < ts->ticks; i--)
+    a->slowest[i] = a->slowest[i - 1];
+  a->slowest[i] = *ts;
+}
+
+/**
+ * @brief Work out where the time of the last step went from the timings and
+ * dependencies of its tasks.
+ *
+ * The critical path is the longest chain of dependent tasks run during the
+ * step, the idle time is what the threads spent without a task and the recv
+ * wait is the mean, over the recvs, of the time between the last dependency
+ * of a recv being resolved and a runner picking it up with its data, i.e.
+ * mostly the latency of the messages. Over MPI, only the
+ * dependencies within each rank are followed and the results are combined
+ * on rank 0.
+ *
+ * @param e The #engine.
+ * @param tic The start of the launch of the tasks.
+ * @param toc The end of the launch of the tasks.
+ * @param a (output) The analysis, only complete on rank 0.
+ */
+void task_analyse_step(const struct engine *e, const ticks tic,
+                       const ticks toc, struct task_step_analysis *a) {
+
+  const struct scheduler *s = &e->sched;
+  const struct task *tasks = s->tasks;
+  const int *tid = s->tasks_ind;
+  const int nr_tasks = s->nr_tasks;
+
+  memset(a, 0, sizeof(struct task_step_analysis));
+
+  /* When each task could have started and the longest chain from it. */
+  ticks *ready = NULL;
+  double *path = NULL;
+  if ((ready = (ticks *)malloc(nr_tasks * sizeof(ticks))) == NULL ||
+      (path = (double *)malloc(nr_tasks * sizeof(double))) == NULL)
+    error("Failed to allocate the step analysis arrays.");
+  for (int k = 0; k < nr_tasks; k++) ready[k] = tic;
+
+  /* Run forwards through the tasks to get their ready times. The tasks that
+   * ran this step are the ones that started after the launch. */
+  double busy = 0., nr_recvs = 0.;
+  for (int k = 0; k < nr_tasks; k++) {
+    const struct task *t = &tasks[tid[k]];
+    if (t->tic < tic) continue;
+    for (int j = 0; j < t->nr_unlock_tasks; j++) {
+      const int ind = t->unlock_tasks[j] - tasks;
+      if (t->toc > ready[ind]) ready[ind] = t->toc;
+    }
+    if (t->implicit) continue;
+    busy += t->toc - t->tic;
+    if (t->type == task_type_recv) {
+      nr_recvs += 1.;
+      if (t->tic > ready[tid[k]]) a->recv_wait += t->tic - ready[tid[k]];
+    }
+  }
+
+  /* Run backwards through the tasks to get the longest chains. */
+  for (int k = nr_tasks - 1; k >= 0; k--) {
+    const struct task *t = &tasks[tid[k]];
+    path[tid[k]] = 0.;
+    if (t->tic < tic) continue;
+    for (int j = 0; j < t->nr_unlock_tasks; j++) {
+      const int ind = t->unlock_tasks[j] - tasks;
+      if (path[ind] > path[tid[k]]) path[tid[k]] = path[ind];
+    }
+    if (t->implicit) continue;
+
+    const double dt = t->toc - t->tic;
+    path[tid[k]] += dt;
+    if (path[tid[k]] > a->critical_path) a->critical_path = path[tid[k]];
+
+    const struct task_slowest ts = {t->type, t->subtype,
+                                    (t->ci != NULL) ? t->ci->depth : 0,
+                                    e->nodeID, dt};
+    task_analysis_add_slowest(a, &ts);
+  }
+  free(path);
+  free(ready);
+
+  a->idle = (double)e->nr_threads * (toc - tic) - busy;
+  if (a->idle < 0.) a->idle = 0.;
+
+#ifdef WITH_MPI
+  if (e->nr_nodes > 1) {
+    double sums[3] = {a->idle, a->recv_wait, nr_recvs};
+    int res = MPI_Reduce((engine_rank == 0 ? MPI_IN_PLACE : sums), sums, 3,
+                         MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (res != MPI_SUCCESS) mpi_error(res, "Failed to reduce the idle times");
+    res = MPI_Reduce((engine_rank == 0 ? MPI_IN_PLACE : &a->critical_path),
+                     &a->critical_path, 1, MPI_DOUBLE, MPI_MAX, 0,
+                     MPI_COMM_WORLD);
+    if (res != MPI_SUCCESS)
+      mpi_error(res, "Failed to reduce the critical paths");
+    a->idle = sums[0];
+    a->recv_wait = sums[1];
+    nr_recvs = sums[2];
+
+    /* Gather the slowest tasks of all the ranks and keep the slowest. */
+    const int size = task_analysis_nr_slowest * sizeof(struct task_slowest);
+    struct task_slowest *all = NULL;
+    if (engine_rank == 0 &&
+        (all = (struct task_slowest *)malloc(e->nr_nodes * size)) == NULL)
+      error("Failed to allocate the slowest tasks of all the ranks.");
+    for (int k = a->nr_slowest; k < task_analysis_nr_slowest; k++)
+      a->slowest[k].ticks = -1.;
+    res = MPI_Gather(a->slowest, size, MPI_BYTE, all, size, MPI_BYTE, 0,
+                     MPI_COMM_WORLD);
+    if (res != MPI_SUCCESS)
+      mpi_error(res, "Failed to gather the slowest tasks");
+
+    if (engine_rank == 0) {
+      a->nr_slowest = 0;
+      for (int k = 0; k < e->nr_nodes * task_analysis_nr_slowest; k++)
+        if (all[k].ticks >= 0.) task_analysis_add_slowest(a, &all[k]);
+      free(all);
+    }
+  }
+#endif
+
+  if (nr_recvs > 0.) a->recv_wait /= nr_recvs;
+}
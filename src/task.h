@@ -28,6 +28,8 @@
 /* Includes. */
 #include "align.h"
 #include "cycle.h"
+#include "inline.h"
+#include "task_counters.h"
 #include "timeline.h"
 
 /* Forward declarations to avoid circular inclusion dependencies. */
@@ -152,6 +154,38 @@ extern const char *subtaskID_names[];
 extern MPI_Comm subtaskMPI_comms[task_subtype_count];
 #endif
 
+#ifdef WITH_MPI
+/**
+ * @brief The MPI state of a send or recv task.
+ *
+ * Only the communication tasks need this, so it is kept out of the #task
+ * in a table indexed by #task::comm.
+ */
+struct task_comm {
+
+  /*! Buffer for this task's communications */
+  void *buff;
+
+  /*! MPI request corresponding to this task */
+  MPI_Request req;
+
+  /*! Persistent request re-used by the task between rebuilds, if any, and
+   *  the buffer and number of elements it was made for */
+  MPI_Request persistent;
+  void *persistent_buff;
+  int persistent_count;
+
+  /*! Does the sending node wait for us to release the particles we read in
+   *  place? */
+  int release;
+};
+
+/**
+ * @brief The MPI state of the communication tasks of the #scheduler.
+ */
+extern struct task_comm *task_comms;
+#endif
+
 /**
  * @brief A task to be run by the #scheduler.
  */
@@ -167,17 +201,14 @@ struct task {
   long long flags;
 
 #ifdef WITH_MPI
-
-  /*! Buffer for this task's communications */
-  void *buff;
-
-  /*! MPI request corresponding to this task */
-  MPI_Request req;
-
+  /*! Index of the MPI state of a send/recv task in #task_comms */
+  int comm;
 #endif
 
+#ifdef SWIFT_DEBUG_CHECKS
   /*! Rank of a task in the order */
   int rank;
+#endif
 
   /*! Weight of the task */
   float weight;
@@ -211,6 +242,11 @@ struct task {
   /*! Start and end time of this task */
   ticks tic, toc;
 
+#ifdef SWIFT_TASK_COUNTERS
+  /*! Performance counters sampled while running this task */
+  long long counters[task_counters_max];
+#endif
+
 #ifdef SWIFT_DEBUG_CHECKS
   /* When was this task last run? */
   integertime_t ti_run;
@@ -218,6 +254,44 @@ struct task {
 
 } SWIFT_STRUCT_ALIGN;
 
+/*! Number of slowest tasks reported by the analysis of a step */
+#define task_analysis_nr_slowest 5
+
+/**
+ * @brief One of the slowest tasks of a step.
+ */
+struct task_slowest {
+
+  /*! Type, sub-type and cell depth of the task */
+  int type, subtype, depth;
+
+  /*! Rank that ran the task */
+  int nodeID;
+
+  /*! Time the task took, in ticks */
+  double ticks;
+};
+
+/**
+ * @brief Where the time of a step went, as derived from its task graph.
+ */
+struct task_step_analysis {
+
+  /*! Longest chain of dependent tasks, in ticks (maximum over the ranks) */
+  double critical_path;
+
+  /*! Time the threads had no task to run, in ticks (sum over the ranks) */
+  double idle;
+
+  /*! Mean time the recvs waited for their data once ready, in ticks (over
+   * all the ranks) */
+  double recv_wait;
+
+  /*! The slowest tasks, slowest first */
+  int nr_slowest;
+  struct task_slowest slowest[task_analysis_nr_slowest];
+};
+
 /* Function prototypes. */
 void task_unlock(struct task *t);
 float task_overlap(const struct task *ta, const struct task *tb);
@@ -225,12 +299,26 @@ int task_lock(struct task *t);
 void task_do_rewait(struct task *t);
 void task_print(const struct task *t);
 void task_dump_all(struct engine *e, int step);
+void task_dump_binary(struct engine *e, int step);
 void task_dump_stats(const char *dumpfile, struct engine *e, int header,
                      int allranks);
+void task_dump_counters(const char *dumpfile, struct engine *e);
+void task_analyse_step(const struct engine *e, ticks tic, ticks toc,
+                       struct task_step_analysis *a);
 void task_get_full_name(int type, int subtype, char *name);
 void task_get_group_name(int type, int subtype, char *cluster);
 
 #ifdef WITH_MPI
 void task_create_mpi_comms(void);
+
+/**
+ * @brief Get the MPI state of a send or recv #task.
+ *
+ * @param t The communication #task.
+ */
+__attribute__((always_inline)) INLINE static struct task_comm *task_get_comm(
+    const struct task *t) {
+  return &task_comms[t->comm];
+}
 #endif
 #endif /* SWIFT_TASK_H */
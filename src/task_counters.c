@@ -0,0 +1,223 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+#ifdef SWIFT_TASK_COUNTERS
+
+/* Some standard headers. */
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* This object's header. */
+#include "task_counters.h"
+
+/* Local headers. */
+#include "error.h"
+
+/**
+ * @brief A performance counter we know by name.
+ */
+struct task_counters_event {
+
+  /*! Name used in the parameter file and the dumps */
+  const char *name;
+
+  /*! perf_event type and configuration of the counter */
+  unsigned int type;
+  unsigned long long config;
+};
+
+/*! The counters known by name, raw counters are given as raw:<hex code> */
+static const struct task_counters_event task_counters_known[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"ref_cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache_references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"l1d_misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"llc_misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"task_clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES}};
+
+/*! Number of counters sampled around each task */
+static int task_counters_nr = 0;
+
+/*! Names of the counters sampled around each task */
+static char task_counters_names[task_counters_max][32];
+
+/*! Attributes of the counters sampled around each task */
+static struct perf_event_attr task_counters_attr[task_counters_max];
+
+/**
+ * @brief Open a counter for the calling thread.
+ *
+ * @param attr The attributes of the counter.
+ * @param group_fd The leader of the group, -1 to start a new group.
+ *
+ * @return The file descriptor of the counter, -1 on failure.
+ */
+static int task_counters_perf_open(struct perf_event_attr *attr,
+                                   const int group_fd) {
+  return syscall(__NR_perf_event_open, attr, /*pid=*/0, /*cpu=*/-1, group_fd,
+                 /*flags=*/0);
+}
+
+/**
+ * @brief Select the counters sampled around each task.
+ *
+ * The counters that cannot be opened, e.g. the hardware ones in a virtual
+ * machine, are ignored. Must be called before the runners start.
+ *
+ * @param names Comma-separated names of the counters, or raw:<hex code>.
+ * @param verbose Report the counters that are ignored?
+ */
+void task_counters_init(const char *names, int verbose) {
+
+  char list[200];
+  strncpy(list, names, sizeof(list) - 1);
+  list[sizeof(list) - 1] = '\0';
+
+  task_counters_nr = 0;
+  char *save = NULL;
+  for (char *name = strtok_r(list, ", ", &save); name != NULL;
+       name = strtok_r(NULL, ", ", &save)) {
+
+    if (task_counters_nr == task_counters_max)
+      error("Cannot sample more than %d task counters.", task_counters_max);
+
+    /* Find the counter. */
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(struct perf_event_attr));
+    attr.size = sizeof(struct perf_event_attr);
+    if (strncmp(name, "raw:", 4) == 0) {
+      char *end = NULL;
+      attr.type = PERF_TYPE_RAW;
+      attr.config = strtoull(name + 4, &end, 16);
+      if (end == name + 4 || *end != '\0')
+        error("Invalid raw task counter '%s'.", name);
+    } else {
+      const int nr_known =
+          sizeof(task_counters_known) / sizeof(struct task_counters_event);
+      int k = 0;
+      while (k < nr_known && strcmp(task_counters_known[k].name, name) != 0)
+        k++;
+      if (k == nr_known) error("Unknown task counter '%s'.", name);
+      attr.type = task_counters_known[k].type;
+      attr.config = task_counters_known[k].config;
+    }
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    /* Is it available here? */
+    const int fd = task_counters_perf_open(&attr, -1);
+    if (fd < 0) {
+      if (verbose)
+        message(
+            "WARNING: Task counter '%s' is not available (%s), ignoring it.",
+            name, strerror(errno));
+      continue;
+    }
+    close(fd);
+
+    task_counters_attr[task_counters_nr] = attr;
+    strncpy(task_counters_names[task_counters_nr], name, 31);
+    task_counters_names[task_counters_nr][31] = '\0';
+    task_counters_nr++;
+  }
+}
+
+/**
+ * @brief Number of counters sampled around each task.
+ */
+int task_counters_count(void) { return task_counters_nr; }
+
+/**
+ * @brief Name of a counter sampled around each task.
+ *
+ * @param k The index of the counter.
+ */
+const char *task_counters_name(int k) { return task_counters_names[k]; }
+
+/**
+ * @brief Open the counters of the calling thread, as a single group.
+ *
+ * @param tc The #task_counters of the thread.
+ */
+void task_counters_open(struct task_counters *tc) {
+
+  for (int k = 0; k < task_counters_max; k++) tc->fd[k] = -1;
+  for (int k = 0; k < task_counters_nr; k++) {
+    struct perf_event_attr attr = task_counters_attr[k];
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = (k == 0);
+    if ((tc->fd[k] = task_counters_perf_open(&attr, tc->fd[0])) < 0)
+      error("Failed to open the task counter '%s' (%s).",
+            task_counters_names[k], strerror(errno));
+  }
+
+  if (tc->fd[0] >= 0 &&
+      (ioctl(tc->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) != 0 ||
+       ioctl(tc->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0))
+    error("Failed to start the task counters (%s).", strerror(errno));
+}
+
+/**
+ * @brief Read the current values of the counters of the calling thread.
+ *
+ * @param tc The #task_counters of the thread.
+ * @param values (output) The values, #task_counters_count() of them.
+ */
+void task_counters_read(const struct task_counters *tc, long long *values) {
+
+  if (tc->fd[0] < 0) return;
+
+  /* The group is read as its size followed by the values. */
+  unsigned long long buff[1 + task_counters_max];
+  if (read(tc->fd[0], buff, sizeof(buff)) < 0)
+    error("Failed to read the task counters (%s).", strerror(errno));
+  for (int k = 0; k < task_counters_nr; k++) values[k] = buff[1 + k];
+}
+
+/**
+ * @brief Close the counters of the calling thread.
+ *
+ * @param tc The #task_counters of the thread.
+ */
+void task_counters_close(struct task_counters *tc) {
+
+  for (int k = task_counters_max - 1; k >= 0; k--) {
+    if (tc->fd[k] >= 0) close(tc->fd[k]);
+    tc->fd[k] = -1;
+  }
+}
+
+#endif /* SWIFT_TASK_COUNTERS */
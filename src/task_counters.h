@@ -0,0 +1,48 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_TASK_COUNTERS_H
+#define SWIFT_TASK_COUNTERS_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/*! Maximal number of performance counters sampled around each task */
+#define task_counters_max 4
+
+/*! Depth of the cells beyond which the counters are aggregated together */
+#define task_counters_max_depth 32
+
+/**
+ * @brief The performance counters of a thread, read around each of its tasks.
+ */
+struct task_counters {
+
+  /*! File descriptors of the counters, the first one leads the group */
+  int fd[task_counters_max];
+};
+
+/* API. */
+void task_counters_init(const char *names, int verbose);
+int task_counters_count(void);
+const char *task_counters_name(int k);
+void task_counters_open(struct task_counters *tc);
+void task_counters_read(const struct task_counters *tc, long long *values);
+void task_counters_close(struct task_counters *tc);
+
+#endif /* SWIFT_TASK_COUNTERS_H */
@@ -0,0 +1,250 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <stdlib.h>
+#include <string.h>
+
+/* This object's header. */
+#include "task_histograms.h"
+
+/* Local headers. */
+#include "cell.h"
+#include "clocks.h"
+#include "error.h"
+#include "intrinsics.h"
+#include "task.h"
+
+/**
+ * @brief Allocate and clear a #task_histograms.
+ *
+ * @param h The #task_histograms.
+ */
+void task_histograms_init(struct task_histograms *h) {
+
+  if ((h->entries = (struct task_histogram *)malloc(
+           task_histograms_size * sizeof(struct task_histogram))) == NULL)
+    error("Failed to allocate the task histograms.");
+  task_histograms_reset(h);
+}
+
+/**
+ * @brief Clear all the entries of a #task_histograms.
+ *
+ * @param h The #task_histograms.
+ */
+void task_histograms_reset(struct task_histograms *h) {
+
+  memset(h->entries, 0, task_histograms_size * sizeof(struct task_histogram));
+  for (int k = 0; k < task_histograms_size; k++) h->entries[k].key = -1;
+  h->nr_dropped = 0;
+}
+
+/**
+ * @brief Free the memory of a #task_histograms.
+ *
+ * @param h The #task_histograms.
+ */
+void task_histograms_clean(struct task_histograms *h) {
+
+  free(h->entries);
+  h->entries = NULL;
+}
+
+/**
+ * @brief Find the entry of a key in a #task_histograms, adding it if need be.
+ *
+ * @param h The #task_histograms.
+ * @param key The key.
+ *
+ * @return The entry, NULL if the table is full.
+ */
+static struct task_histogram *task_histograms_get(struct task_histograms *h,
+                                                  const int key) {
+
+  unsigned int ind = ((unsigned int)key * 2654435761u) % task_histograms_size;
+  for (int k = 0; k < task_histograms_size; k++) {
+    struct task_histogram *entry = &h->entries[ind];
+    if (entry->key == key) return entry;
+    if (entry->key < 0) {
+      entry->key = key;
+      return entry;
+    }
+    ind = (ind + 1) % task_histograms_size;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Index of the power of two just below a value.
+ */
+static int task_histograms_log2(const unsigned long long v) {
+  return (v == 0) ? -1 : 63 - intrinsics_clzll(v);
+}
+
+/**
+ * @brief Add a task that just ran to a #task_histograms.
+ *
+ * The particle count of a task is the sum of the hydro, gravity and stars
+ * particle counts of its cells.
+ *
+ * @param h The #task_histograms.
+ * @param t The #task.
+ * @param dt The time the task took, in ticks.
+ */
+void task_histograms_add(struct task_histograms *h, const struct task *t,
+                         const ticks dt) {
+
+  const struct cell *ci = t->ci, *cj = t->cj;
+  int depth = (ci != NULL) ? ci->depth : 0;
+  if (depth >= task_histograms_max_depth) depth = task_histograms_max_depth - 1;
+  const int key = ((int)t->type * task_subtype_count + (int)t->subtype) *
+                      task_histograms_max_depth +
+                  depth;
+
+  struct task_histogram *entry = task_histograms_get(h, key);
+  if (entry == NULL) {
+    h->nr_dropped++;
+    return;
+  }
+
+  long long count = 0;
+  if (ci != NULL) count += ci->hydro.count + ci->grav.count + ci->stars.count;
+  if (cj != NULL) count += cj->hydro.count + cj->grav.count + cj->stars.count;
+
+  int tbin = task_histograms_log2(dt) - (task_histograms_time_first - 1);
+  if (tbin < 0) tbin = 0;
+  if (tbin >= task_histograms_time_bins) tbin = task_histograms_time_bins - 1;
+  int cbin = task_histograms_log2(count + 1);
+  if (cbin >= task_histograms_count_bins) cbin = task_histograms_count_bins - 1;
+
+  entry->nr_tasks += 1;
+  entry->ticks += dt;
+  entry->time[tbin] += 1;
+  entry->count[cbin] += 1;
+}
+
+/**
+ * @brief Add some entries to a #task_histograms.
+ *
+ * @param h The #task_histograms.
+ * @param entries The entries to add.
+ * @param nr The number of entries.
+ */
+void task_histograms_merge(struct task_histograms *h,
+                           const struct task_histogram *entries,
+                           const int nr) {
+
+  for (int k = 0; k < nr; k++) {
+    const struct task_histogram *in = &entries[k];
+    if (in->key < 0) continue;
+    struct task_histogram *entry = task_histograms_get(h, in->key);
+    if (entry == NULL) {
+      h->nr_dropped += in->nr_tasks;
+      continue;
+    }
+    entry->nr_tasks += in->nr_tasks;
+    entry->ticks += in->ticks;
+    for (int b = 0; b < task_histograms_time_bins; b++)
+      entry->time[b] += in->time[b];
+    for (int b = 0; b < task_histograms_count_bins; b++)
+      entry->count[b] += in->count[b];
+  }
+}
+
+/**
+ * @brief Copy the used entries of a #task_histograms next to each other.
+ *
+ * @param h The #task_histograms.
+ * @param entries (output) The entries, at least #task_histograms_size of them.
+ *
+ * @return The number of entries copied.
+ */
+int task_histograms_pack(const struct task_histograms *h,
+                         struct task_histogram *entries) {
+
+  int nr = 0;
+  for (int k = 0; k < task_histograms_size; k++)
+    if (h->entries[k].key >= 0) entries[nr++] = h->entries[k];
+  return nr;
+}
+
+/**
+ * @brief Write the description of the columns of the task histograms file.
+ *
+ * @param file The file.
+ */
+void task_histograms_write_header(FILE *file) {
+
+  fprintf(file, "# CPU frequency: %lld Hz\n",
+          (long long)clocks_get_cpufreq());
+  fprintf(file,
+          "# Step, task, cell depth (the last one includes the deeper "
+          "cells), number of tasks, time [%s],\n",
+          clocks_getunit());
+  fprintf(file,
+          "# then %d bins of durations: bin i > 0 counts the tasks taking "
+          "[2^(i+%d), 2^(i+%d)) ticks, the first and last bins are open,\n",
+          task_histograms_time_bins, task_histograms_time_first - 1,
+          task_histograms_time_first);
+  fprintf(file,
+          "# then %d bins of particle counts: bin i counts the tasks with "
+          "[2^i - 1, 2^(i+1) - 1) particles, the last bin is open.\n",
+          task_histograms_count_bins);
+}
+
+/**
+ * @brief Write the entries of a #task_histograms, one line each.
+ *
+ * @param h The #task_histograms.
+ * @param file The file.
+ * @param step The current step.
+ */
+void task_histograms_write(const struct task_histograms *h, FILE *file,
+                           const int step) {
+
+  for (int k = 0; k < task_histograms_size; k++) {
+    const struct task_histogram *entry = &h->entries[k];
+    if (entry->key < 0) continue;
+
+    const int depth = entry->key % task_histograms_max_depth;
+    const int subtype =
+        (entry->key / task_histograms_max_depth) % task_subtype_count;
+    const int type =
+        entry->key / (task_histograms_max_depth * task_subtype_count);
+
+    char name[80];
+    snprintf(name, sizeof(name), "%s/%s", taskID_names[type],
+             subtaskID_names[subtype]);
+    fprintf(file, "%7d %26s %2d %10u %14.3f", step, name, depth,
+            entry->nr_tasks, clocks_from_ticks(entry->ticks));
+    for (int b = 0; b < task_histograms_time_bins; b++)
+      fprintf(file, " %u", entry->time[b]);
+    for (int b = 0; b < task_histograms_count_bins; b++)
+      fprintf(file, " %u", entry->count[b]);
+    fprintf(file, "\n");
+  }
+
+  if (h->nr_dropped > 0)
+    fprintf(file, "# Step %d: %u tasks did not fit in the histograms.\n", step,
+            h->nr_dropped);
+}
@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_TASK_HISTOGRAMS_H
+#define SWIFT_TASK_HISTOGRAMS_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <stdio.h>
+
+/* Includes. */
+#include "cycle.h"
+
+/* Forward declarations. */
+struct task;
+
+/*! Number of entries of a #task_histograms, i.e. of distinct combinations of
+ * task type, sub-type and cell depth it can hold */
+#define task_histograms_size 1024
+
+/*! Depth of the cells beyond which the tasks are binned together */
+#define task_histograms_max_depth 16
+
+/*! Number of bins of the durations, in powers of two of ticks */
+#define task_histograms_time_bins 32
+
+/*! Power of two of the upper edge, in ticks, of the first bin of durations */
+#define task_histograms_time_first 10
+
+/*! Number of bins of the particle counts, in powers of two */
+#define task_histograms_count_bins 24
+
+/**
+ * @brief Histograms of the duration and particle count of the tasks of a
+ * given type and sub-type acting on cells of a given depth.
+ */
+struct task_histogram {
+
+  /*! Type, sub-type and depth of the tasks, -1 for an unused entry */
+  int key;
+
+  /*! Number of tasks */
+  unsigned int nr_tasks;
+
+  /*! Time spent in the tasks, in ticks */
+  double ticks;
+
+  /*! Number of tasks per bin of duration */
+  unsigned int time[task_histograms_time_bins];
+
+  /*! Number of tasks per bin of particle count */
+  unsigned int count[task_histograms_count_bins];
+};
+
+/**
+ * @brief A fixed-size table of #task_histogram, one per thread.
+ */
+struct task_histograms {
+
+  /*! The entries, hashed on their key */
+  struct task_histogram *entries;
+
+  /*! Number of tasks that did not fit in the table */
+  unsigned int nr_dropped;
+};
+
+/* API. */
+void task_histograms_init(struct task_histograms *h);
+void task_histograms_reset(struct task_histograms *h);
+void task_histograms_clean(struct task_histograms *h);
+void task_histograms_add(struct task_histograms *h, const struct task *t,
+                         ticks dt);
+void task_histograms_merge(struct task_histograms *h,
+                           const struct task_histogram *entries, int nr);
+int task_histograms_pack(const struct task_histograms *h,
+                         struct task_histogram *entries);
+void task_histograms_write_header(FILE *file);
+void task_histograms_write(const struct task_histograms *h, FILE *file,
+                           int step);
+
+#endif /* SWIFT_TASK_HISTOGRAMS_H */
@@ -129,6 +129,59 @@ void threadpool_dump_log(struct threadpool *tp, const char *filename,
 }
 #endif  // SWIFT_DEBUG_THREADPOOL
 
+/**
+ * @brief Get the next chunk of a weighted map, holding about half of the
+ * remaining cost per thread.
+ *
+ * @param tp The #threadpool.
+ * @param task_ind (return) The index of the first element of the chunk.
+ * @param chunk_size (return) The number of elements in the chunk.
+ * @return 0 if there is nothing left to map, 1 otherwise.
+ */
+static int threadpool_get_weighted_chunk(struct threadpool *tp,
+                                         size_t *task_ind,
+                                         size_t *chunk_size) {
+
+  const size_t size = tp->map_data_size;
+  const double *cost = tp->map_data_cost;
+
+  while (1) {
+    const size_t start = tp->map_data_count;
+    if (start >= size) return 0;
+
+    /* Cost left and the cost we want in this chunk. */
+    const double done = start > 0 ? cost[start - 1] : 0.;
+    const double left = cost[size - 1] - done;
+
+    size_t end;
+    if (left > 0.) {
+
+      /* Smallest end such that the chunk holds the cost we want. */
+      const double target = done + left / (2 * tp->num_threads);
+      size_t lo = start + 1, hi = size;
+      while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (cost[mid - 1] >= target)
+          hi = mid;
+        else
+          lo = mid + 1;
+      }
+      end = lo;
+    } else {
+
+      /* Nothing but free elements left, share them out by number. */
+      end = start + max((size - start) / (2 * tp->num_threads), (size_t)1);
+    }
+
+    /* Claim the chunk, unless another thread beat us to it. */
+    if (atomic_cas(&tp->map_data_count, start, end) == start) {
+      *task_ind = start;
+      *chunk_size = end - start;
+      return 1;
+    }
+  }
+}
+
 /**
  * @brief Runner main loop, get a chunk and call the mapper function.
  */
@@ -136,27 +189,43 @@ void threadpool_chomp(struct threadpool *tp, int tid) {
 
   /* Loop until we can't get a chunk. */
   while (1) {
-    /* Desired chunk size. */
-    size_t chunk_size =
-        (tp->map_data_size - tp->map_data_count) / (2 * tp->num_threads);
-    if (chunk_size > tp->map_data_chunk) chunk_size = tp->map_data_chunk;
-    if (chunk_size < 1) chunk_size = 1;
-
-    /* Get a chunk and check its size. */
-    size_t task_ind = atomic_add(&tp->map_data_count, chunk_size);
-    if (task_ind >= tp->map_data_size) break;
-    if (task_ind + chunk_size > tp->map_data_size)
-      chunk_size = tp->map_data_size - task_ind;
+    size_t task_ind, chunk_size;
+
+    if (tp->map_data_cost != NULL) {
+
+      /* Chunks of similar cost. */
+      if (!threadpool_get_weighted_chunk(tp, &task_ind, &chunk_size)) break;
+
+    } else {
+
+      /* Desired chunk size. */
+      chunk_size =
+          (tp->map_data_size - tp->map_data_count) / (2 * tp->num_threads);
+      if (chunk_size > tp->map_data_chunk) chunk_size = tp->map_data_chunk;
+      if (chunk_size < 1) chunk_size = 1;
+
+      /* Get a chunk and check its size. */
+      task_ind = atomic_add(&tp->map_data_count, chunk_size);
+      if (task_ind >= tp->map_data_size) break;
+      if (task_ind + chunk_size > tp->map_data_size)
+        chunk_size = tp->map_data_size - task_ind;
+    }
 
 /* Call the mapper function. */
 #ifdef SWIFT_DEBUG_THREADPOOL
     ticks tic = getticks();
+#else
+    const ticks tic = tp->collect_stats ? getticks() : 0;
 #endif
     tp->map_function((char *)tp->map_data + (tp->map_data_stride * task_ind),
                      chunk_size, tp->map_extra_data);
 #ifdef SWIFT_DEBUG_THREADPOOL
     threadpool_log(tp, tid, chunk_size, tic, getticks());
 #endif
+    if (tp->collect_stats) {
+      tp->thread_busy[tid] += getticks() - tic;
+      tp->thread_chunks[tid] += 1;
+    }
   }
 }
 
@@ -193,6 +262,24 @@ void threadpool_init(struct threadpool *tp, int num_threads) {
 
   /* Initialize the thread counters. */
   tp->num_threads = num_threads;
+  tp->launch_function = NULL;
+  tp->launch_data = NULL;
+  tp->threads = NULL;
+
+  /* Space for the statistics of the mappers, only collected on demand. */
+  tp->collect_stats = 0;
+  tp->nr_stats = 0;
+  if ((tp->thread_busy = (ticks *)calloc(num_threads, sizeof(ticks))) ==
+          NULL ||
+      (tp->thread_chunks = (int *)calloc(num_threads, sizeof(int))) == NULL ||
+      (tp->stats = (struct threadpool_mapper_stats *)calloc(
+           threadpool_stats_max_mappers,
+           sizeof(struct threadpool_mapper_stats))) == NULL)
+    error("Failed to allocate mapper statistics.");
+
+  /* The cumulative costs of weighted maps, allocated when first needed. */
+  tp->map_costs = NULL;
+  tp->map_costs_size = 0;
 
 #ifdef SWIFT_DEBUG_THREADPOOL
   if ((tp->logs = (struct mapper_log *)malloc(sizeof(struct mapper_log) *
@@ -221,6 +308,7 @@ void threadpool_init(struct threadpool *tp, int num_threads) {
   tp->map_data_count = 0;
   tp->map_data_stride = 0;
   tp->map_data_chunk = 0;
+  tp->map_data_cost = NULL;
   tp->map_function = NULL;
 
   /* Allocate the threads, one less than requested since the calling thread
@@ -240,29 +328,136 @@ void threadpool_init(struct threadpool *tp, int num_threads) {
   swift_barrier_wait(&tp->wait_barrier);
 }
 
+/**
+ * @brief Run the map set up in the #threadpool on all its threads, the
+ * calling thread included, and wait for it to be done.
+ *
+ * @param tp The #threadpool.
+ */
+static void threadpool_run(struct threadpool *tp) {
+
+  /* Let the owner of the threads we borrow wake them up. */
+  if (tp->launch_function != NULL) {
+    tp->launch_function(tp, tp->launch_data);
+    return;
+  }
+
+  /* No threads left to help, do it all ourselves. */
+  if (tp->threads == NULL) {
+    threadpool_chomp(tp, tp->num_threads - 1);
+    return;
+  }
+
+  /* Wait for all the threads to be up and running. */
+  swift_barrier_wait(&tp->run_barrier);
+
+  /* Do some work while I'm at it. */
+  threadpool_chomp(tp, tp->num_threads - 1);
+
+  /* Wait for all threads to be done. */
+  swift_barrier_wait(&tp->wait_barrier);
+}
+
+/**
+ * @brief Stop the threads of the #threadpool and release them.
+ *
+ * @param tp The #threadpool.
+ */
+static void threadpool_stop_threads(struct threadpool *tp) {
+
+  /* Destroy the runner threads by calling them with a NULL mapper function
+   * and waiting for all the threads to terminate. This ensures that no
+   * thread is still waiting at a barrier. */
+  tp->map_function = NULL;
+  swift_barrier_wait(&tp->run_barrier);
+  for (int k = 0; k < tp->num_threads - 1; k++) {
+    void *retval;
+    pthread_join(tp->threads[k], &retval);
+  }
+
+  /* Release the barriers. */
+  if (swift_barrier_destroy(&tp->wait_barrier) != 0 ||
+      swift_barrier_destroy(&tp->run_barrier) != 0)
+    error("Failed to destroy threadpool barriers.");
+
+  /* Clean up memory. */
+  free(tp->threads);
+  tp->threads = NULL;
+}
+
+/**
+ * @brief Add the timings of the last call of a mapper to its statistics.
+ *
+ * @param tp The #threadpool.
+ * @param map_function The mapper function.
+ * @param name The name of the mapper function.
+ * @param N The number of elements mapped.
+ * @param chunk The chunk size used.
+ * @param total The wall-clock time of the call.
+ */
+static void threadpool_record_stats(struct threadpool *tp,
+                                    threadpool_map_function map_function,
+                                    const char *name, size_t N, size_t chunk,
+                                    ticks total) {
+
+  /* Find the entry of this mapper, making a new one if needed. */
+  int ind = 0;
+  while (ind < tp->nr_stats && tp->stats[ind].map_function != map_function)
+    ind++;
+  if (ind == tp->nr_stats) {
+    if (tp->nr_stats == threadpool_stats_max_mappers) return;
+    tp->stats[ind].map_function = map_function;
+    tp->stats[ind].name = name;
+    tp->nr_stats++;
+  }
+  struct threadpool_mapper_stats *stats = &tp->stats[ind];
+
+  /* Collect what the threads did. */
+  ticks busy = 0, max_busy = 0;
+  long long chunks = 0;
+  for (int k = 0; k < tp->num_threads; k++) {
+    busy += tp->thread_busy[k];
+    max_busy = max(max_busy, tp->thread_busy[k]);
+    chunks += tp->thread_chunks[k];
+    tp->thread_busy[k] = 0;
+    tp->thread_chunks[k] = 0;
+  }
+
+  stats->calls += 1;
+  stats->elements += N;
+  stats->chunks += chunks;
+  stats->chunk_size += chunk > 0 ? chunk : N / max(chunks, 1LL);
+  stats->total += total;
+  stats->busy += busy;
+  stats->max_busy += max_busy;
+}
+
 /**
  * @brief Map a function to an array of data in parallel using a #threadpool.
  *
  * The function @c map_function is called on each element of @c map_data
- * in parallel.
+ * in parallel. Usually called through the threadpool_map() macro, which
+ * provides the name of the mapper function.
  *
  * @param tp The #threadpool on which to run.
  * @param map_function The function that will be applied to the map data.
+ * @param name The name of the mapper function, used in the statistics.
  * @param map_data The data on which the mapping function will be called.
  * @param N Number of elements in @c map_data.
  * @param stride Size, in bytes, of each element of @c map_data.
  * @param chunk Number of map data elements to pass to the function at a time,
- *        or zero to choose the number automatically.
+ *        #threadpool_auto_chunk_size to choose the number automatically, or
+ *        #threadpool_guided_chunk_size for chunks decreasing in size as the
+ *        work runs out.
  * @param extra_data Addtitional pointer that will be passed to the mapping
  *        function, may contain additional data.
  */
-void threadpool_map(struct threadpool *tp, threadpool_map_function map_function,
-                    void *map_data, size_t N, int stride, int chunk,
-                    void *extra_data) {
+void threadpool_map_named(struct threadpool *tp,
+                          threadpool_map_function map_function,
+                          const char *name, void *map_data, size_t N,
+                          int stride, int chunk, void *extra_data) {
 
-#ifdef SWIFT_DEBUG_THREADPOOL
   ticks tic = getticks();
-#endif
 
   /* If we just have a single thread, call the map function directly. */
   if (tp->num_threads == 1) {
@@ -271,6 +466,12 @@ void threadpool_map(struct threadpool *tp, threadpool_map_function map_function,
     tp->map_function = map_function;
     threadpool_log(tp, 0, N, tic, getticks());
 #endif
+    if (tp->collect_stats) {
+      const ticks toc = getticks();
+      tp->thread_busy[0] = toc - tic;
+      tp->thread_chunks[0] = 1;
+      threadpool_record_stats(tp, map_function, name, N, N, toc - tic);
+    }
     return;
   }
 
@@ -278,28 +479,213 @@ void threadpool_map(struct threadpool *tp, threadpool_map_function map_function,
   tp->map_data_stride = stride;
   tp->map_data_size = N;
   tp->map_data_count = 0;
-  tp->map_data_chunk =
-      chunk ? chunk
-            : max((int)(N / (tp->num_threads * threadpool_default_chunk_ratio)),
-                  1);
+  if (chunk == threadpool_guided_chunk_size)
+    tp->map_data_chunk = N;
+  else if (chunk == threadpool_auto_chunk_size)
+    tp->map_data_chunk =
+        max((int)(N / (tp->num_threads * threadpool_default_chunk_ratio)), 1);
+  else
+    tp->map_data_chunk = chunk;
+  tp->map_data_cost = NULL;
   tp->map_function = map_function;
   tp->map_data = map_data;
   tp->map_extra_data = extra_data;
   tp->num_threads_running = 0;
 
-  /* Wait for all the threads to be up and running. */
-  swift_barrier_wait(&tp->run_barrier);
+  /* Get all the threads to work. */
+  threadpool_run(tp);
 
-  /* Do some work while I'm at it. */
-  threadpool_chomp(tp, tp->num_threads - 1);
+#ifdef SWIFT_DEBUG_THREADPOOL
+  /* Log the total call time to thread id -1. */
+  threadpool_log(tp, -1, N, tic, getticks());
+#endif
 
-  /* Wait for all threads to be done. */
-  swift_barrier_wait(&tp->wait_barrier);
+  if (tp->collect_stats)
+    threadpool_record_stats(
+        tp, map_function, name, N,
+        chunk == threadpool_guided_chunk_size ? 0 : tp->map_data_chunk,
+        getticks() - tic);
+}
+
+/**
+ * @brief Map a function to an array of data in parallel using a #threadpool,
+ * splitting the data in chunks of similar cost.
+ *
+ * The cost of each element is given by @c cost_function, e.g. the number of
+ * particles in a cell, and each chunk handed out holds about half the
+ * remaining cost per thread, so that the threads finish together even when
+ * the work per element varies wildly. Usually called through the
+ * threadpool_map_weighted() macro.
+ *
+ * @param tp The #threadpool on which to run.
+ * @param map_function The function that will be applied to the map data.
+ * @param name The name of the mapper function, used in the statistics.
+ * @param map_data The data on which the mapping function will be called.
+ * @param N Number of elements in @c map_data.
+ * @param stride Size, in bytes, of each element of @c map_data.
+ * @param cost_function The function returning the cost of an element.
+ * @param extra_data Addtitional pointer that will be passed to the mapping
+ *        and cost functions, may contain additional data.
+ */
+void threadpool_map_weighted_named(struct threadpool *tp,
+                                   threadpool_map_function map_function,
+                                   const char *name, void *map_data, size_t N,
+                                   int stride,
+                                   threadpool_cost_function cost_function,
+                                   void *extra_data) {
+
+  /* Nothing to balance with a single thread. */
+  if (tp->num_threads == 1 || N == 0) {
+    threadpool_map_named(tp, map_function, name, map_data, N, stride,
+                         threadpool_auto_chunk_size, extra_data);
+    return;
+  }
+
+  const ticks tic = getticks();
+
+  /* Make sure we have space for the costs. */
+  if (tp->map_costs_size < N) {
+    free(tp->map_costs);
+    tp->map_costs_size = N;
+    if ((tp->map_costs = (double *)malloc(sizeof(double) * N)) == NULL)
+      error("Failed to allocate the costs of the map.");
+  }
+
+  /* Cumulative cost of the elements. */
+  double total = 0.;
+  for (size_t k = 0; k < N; k++) {
+    total += cost_function((char *)map_data + (size_t)stride * k, extra_data);
+    tp->map_costs[k] = total;
+  }
+
+  /* Set the map data and signal the threads. */
+  tp->map_data_stride = stride;
+  tp->map_data_size = N;
+  tp->map_data_count = 0;
+  tp->map_data_chunk = N;
+  tp->map_data_cost = tp->map_costs;
+  tp->map_function = map_function;
+  tp->map_data = map_data;
+  tp->map_extra_data = extra_data;
+  tp->num_threads_running = 0;
+
+  /* Get all the threads to work. */
+  threadpool_run(tp);
+  tp->map_data_cost = NULL;
 
 #ifdef SWIFT_DEBUG_THREADPOOL
   /* Log the total call time to thread id -1. */
   threadpool_log(tp, -1, N, tic, getticks());
 #endif
+
+  if (tp->collect_stats)
+    threadpool_record_stats(tp, map_function, name, N, 0, getticks() - tic);
+}
+
+/**
+ * @brief Switch the collection of the mapper statistics on or off.
+ *
+ * @param tp The #threadpool.
+ * @param collect Whether to collect the statistics.
+ */
+void threadpool_collect_stats(struct threadpool *tp, int collect) {
+  for (int k = 0; k < tp->num_threads; k++) {
+    tp->thread_busy[k] = 0;
+    tp->thread_chunks[k] = 0;
+  }
+  tp->collect_stats = collect;
+}
+
+/**
+ * @brief Compare two #threadpool_mapper_stats by decreasing total time.
+ */
+static int threadpool_stats_cmp(const void *a, const void *b) {
+  const struct threadpool_mapper_stats *sa =
+      (const struct threadpool_mapper_stats *)a;
+  const struct threadpool_mapper_stats *sb =
+      (const struct threadpool_mapper_stats *)b;
+  return (sa->total < sb->total) - (sa->total > sb->total);
+}
+
+/**
+ * @brief Write the statistics of the mappers to a file, slowest first.
+ *
+ * The imbalance is the time of the busiest thread over the mean time of
+ * the threads, and the efficiency the time spent in the mapper over the
+ * wall-clock time of the calls of all the threads.
+ *
+ * @param tp The #threadpool.
+ * @param filename The name of the file.
+ * @param reset Whether to clear the statistics.
+ */
+void threadpool_dump_stats(struct threadpool *tp, const char *filename,
+                           int reset) {
+
+  /* Open the output file. */
+  FILE *fd;
+  if ((fd = fopen(filename, "w")) == NULL)
+    error("Failed to create mapper statistics file '%s'.", filename);
+
+  qsort(tp->stats, tp->nr_stats, sizeof(struct threadpool_mapper_stats),
+        threadpool_stats_cmp);
+
+  fprintf(fd, "# num_threads: %d, time unit: %s\n", tp->num_threads,
+          clocks_getunit());
+  fprintf(fd, "# %-48s %10s %14s %12s %12s %12s %12s %10s %10s\n", "mapper",
+          "calls", "elements", "chunks", "chunk_size", "total", "per_call",
+          "imbalance", "efficiency");
+
+  for (int k = 0; k < tp->nr_stats; k++) {
+    const struct threadpool_mapper_stats *stats = &tp->stats[k];
+    const double mean_busy = (double)stats->busy / tp->num_threads;
+    const double imbalance =
+        mean_busy > 0. ? (double)stats->max_busy / mean_busy : 1.;
+    const double efficiency =
+        stats->total > 0
+            ? (double)stats->busy / ((double)stats->total * tp->num_threads)
+            : 1.;
+    fprintf(fd,
+            "  %-48s %10lld %14lld %12lld %12.1f %12.3f %12.5f %10.3f "
+            "%10.3f\n",
+            stats->name, stats->calls, stats->elements, stats->chunks,
+            (double)stats->chunk_size / stats->calls,
+            clocks_from_ticks(stats->total),
+            clocks_from_ticks(stats->total) / stats->calls, imbalance,
+            efficiency);
+  }
+
+  fclose(fd);
+
+  if (reset) {
+    bzero(tp->stats, sizeof(struct threadpool_mapper_stats) *
+                         threadpool_stats_max_mappers);
+    tp->nr_stats = 0;
+  }
+}
+
+/**
+ * @brief Let the #threadpool use the threads of someone else instead of its
+ * own, which are stopped.
+ *
+ * Every map then calls @c launch_function, which must get @c num_threads - 1
+ * other threads to call threadpool_chomp() with a unique id from
+ * @c tp->num_threads_running (incremented atomically) while the calling
+ * thread calls threadpool_chomp() with the id @c num_threads - 1, and
+ * return once they are all done. Without @c launch_function the maps are
+ * run by the calling thread alone, e.g. once the borrowed threads are gone.
+ *
+ * @param tp The #threadpool.
+ * @param launch_function The function waking up the borrowed threads.
+ * @param launch_data Data passed to @c launch_function.
+ */
+void threadpool_share_threads(struct threadpool *tp,
+                              threadpool_launch_function launch_function,
+                              void *launch_data) {
+
+  if (tp->threads != NULL) threadpool_stop_threads(tp);
+
+  tp->launch_data = launch_data;
+  tp->launch_function = launch_function;
 }
 
 /**
@@ -316,25 +702,8 @@ void threadpool_reset_log(struct threadpool *tp) {
  */
 void threadpool_clean(struct threadpool *tp) {
 
-  if (tp->num_threads > 1) {
-    /* Destroy the runner threads by calling them with a NULL mapper function
-     * and waiting for all the threads to terminate. This ensures that no
-     * thread is still waiting at a barrier. */
-    tp->map_function = NULL;
-    swift_barrier_wait(&tp->run_barrier);
-    for (int k = 0; k < tp->num_threads - 1; k++) {
-      void *retval;
-      pthread_join(tp->threads[k], &retval);
-    }
-
-    /* Release the barriers. */
-    if (swift_barrier_destroy(&tp->wait_barrier) != 0 ||
-        swift_barrier_destroy(&tp->run_barrier) != 0)
-      error("Failed to destroy threadpool barriers.");
-
-    /* Clean up memory. */
-    free(tp->threads);
-  }
+  /* Borrowed threads are not ours to stop. */
+  if (tp->threads != NULL) threadpool_stop_threads(tp);
 
 #ifdef SWIFT_DEBUG_THREADPOOL
   for (int k = 0; k < tp->num_threads; k++) {
@@ -342,4 +711,9 @@ void threadpool_clean(struct threadpool *tp) {
   }
   free(tp->logs);
 #endif
+
+  free(tp->map_costs);
+  free(tp->thread_busy);
+  free(tp->thread_chunks);
+  free(tp->stats);
 }
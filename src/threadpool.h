@@ -32,11 +32,26 @@
 /* Local defines. */
 #define threadpool_log_initial_size 1000
 #define threadpool_default_chunk_ratio 7
+#define threadpool_stats_max_mappers 256
+
+/* Special values of the chunk size of threadpool_map(). */
+#define threadpool_auto_chunk_size 0
+#define threadpool_guided_chunk_size -1
 
 /* Function type for mappings. */
 typedef void (*threadpool_map_function)(void *map_data, int num_elements,
                                         void *extra_data);
 
+/* Forward declaration. */
+struct threadpool;
+
+/* Function type waking up borrowed threads to run a map. */
+typedef void (*threadpool_launch_function)(struct threadpool *tp,
+                                           void *launch_data);
+
+/* Function type for the cost of an element of a weighted map. */
+typedef double (*threadpool_cost_function)(void *map_data, void *extra_data);
+
 /* Data for threadpool logging. */
 struct mapper_log_entry {
 
@@ -64,6 +79,27 @@ struct mapper_log {
   int count;
 };
 
+/* Statistics aggregated over all the calls of a mapper function. */
+struct threadpool_mapper_stats {
+
+  /* The mapper function and its name. */
+  threadpool_map_function map_function;
+  const char *name;
+
+  /* Number of calls, of elements mapped and of chunks processed. */
+  long long calls, elements, chunks;
+
+  /* Sum over the calls of the chunk size chosen. */
+  long long chunk_size;
+
+  /* Wall-clock time spent in the calls. */
+  ticks total;
+
+  /* Time spent in the mapper summed over the threads, and the sum over the
+   * calls of the time of the busiest thread. */
+  ticks busy, max_busy;
+};
+
 /* Data of a threadpool. */
 struct threadpool {
 
@@ -80,23 +116,72 @@ struct threadpool {
       map_data_chunk;
   volatile threadpool_map_function map_function;
 
+  /* Cumulative cost of the elements when splitting by cost, NULL otherwise,
+   * and the buffer holding it. */
+  const double *volatile map_data_cost;
+  double *map_costs;
+  size_t map_costs_size;
+
   /* Number of threads in this pool. */
   int num_threads;
 
   /* Counter for the number of threads that are done. */
   volatile int num_threads_running;
 
+  /* Wakes up the threads we borrow instead of our own, if any. */
+  threadpool_launch_function launch_function;
+  void *launch_data;
+
 #ifdef SWIFT_DEBUG_THREADPOOL
   struct mapper_log *logs;
 #endif
+
+  /* Are we collecting the statistics of the mappers? */
+  int collect_stats;
+
+  /* Time spent in the mapper and chunks processed by each thread in the
+   * current call. */
+  ticks *thread_busy;
+  int *thread_chunks;
+
+  /* The statistics of each mapper function. */
+  struct threadpool_mapper_stats *stats;
+  int nr_stats;
 };
 
 /* Function prototypes. */
 void threadpool_init(struct threadpool *tp, int num_threads);
-void threadpool_map(struct threadpool *tp, threadpool_map_function map_function,
-                    void *map_data, size_t N, int stride, int chunk,
-                    void *extra_data);
+void threadpool_map_named(struct threadpool *tp,
+                          threadpool_map_function map_function,
+                          const char *name, void *map_data, size_t N,
+                          int stride, int chunk, void *extra_data);
+void threadpool_map_weighted_named(struct threadpool *tp,
+                                   threadpool_map_function map_function,
+                                   const char *name, void *map_data, size_t N,
+                                   int stride,
+                                   threadpool_cost_function cost_function,
+                                   void *extra_data);
 void threadpool_clean(struct threadpool *tp);
+void threadpool_share_threads(struct threadpool *tp,
+                              threadpool_launch_function launch_function,
+                              void *launch_data);
+void threadpool_chomp(struct threadpool *tp, int tid);
+void threadpool_collect_stats(struct threadpool *tp, int collect);
+void threadpool_dump_stats(struct threadpool *tp, const char *filename,
+                           int reset);
+
+/* Map using the name of the mapper function for the statistics. */
+#define threadpool_map(tp, map_function, map_data, N, stride, chunk,     \
+                       extra_data)                                       \
+  threadpool_map_named(tp, map_function, #map_function, map_data, N,     \
+                       stride, chunk, extra_data)
+
+/* Weighted map using the name of the mapper function for the statistics. */
+#define threadpool_map_weighted(tp, map_function, map_data, N, stride,     \
+                                cost_function, extra_data)                 \
+  threadpool_map_weighted_named(tp, map_function, #map_function, map_data, \
+                                N, stride, cost_function, extra_data)
+
 #ifdef SWIFT_DEBUG_THREADPOOL
 void threadpool_reset_log(struct threadpool *tp);
 void threadpool_dump_log(struct threadpool *tp, const char *filename,
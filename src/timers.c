@@ -91,6 +91,7 @@ const char* timers_names[timer_count] = {
     "do_ghost",
     "do_extra_ghost",
     "do_stars_ghost",
+    "do_stars_ghost_redo",
     "dorecv_part",
     "dorecv_gpart",
     "dorecv_spart",
@@ -110,20 +111,30 @@ const char* timers_names[timer_count] = {
     "fof_pair",
 };
 
+/* The counters. */
+long long counters[counter_count];
+
+/* Counter names. */
+const char* counters_names[counter_count] = {
+    "cooling_parts",
+    "cooling_skipped",
+};
+
 /* File to store the timers */
 static FILE* timers_file;
 
 /**
- * @brief Re-set all the timers.
+ * @brief Re-set all the timers and counters.
  *
  */
 void timers_reset_all(void) {
 
   for (int k = 0; k < timer_count; k++) timers[k] = 0;
+  for (int k = 0; k < counter_count; k++) counters[k] = 0;
 }
 
 /**
- * @brief Outputs all the timers to the timers dump file.
+ * @brief Outputs all the timers and counters to the timers dump file.
  *
  * @param step The current step.
  */
@@ -131,6 +142,16 @@ void timers_print(int step) {
   fprintf(timers_file, "%d\t", step);
   for (int k = 0; k < timer_count; k++)
     fprintf(timers_file, "%25.3f ", clocks_from_ticks(timers[k]));
+  for (int k = 0; k < counter_count; k++)
+    fprintf(timers_file, "%25lld ", counters[k]);
+
+  /* Fraction of the particles the cooling did not have to solve for */
+  const double cooling_skipped_frac =
+      counters[counter_cooling_parts] > 0
+          ? (double)counters[counter_cooling_skipped] /
+                counters[counter_cooling_parts]
+          : 0.;
+  fprintf(timers_file, "%25.3f ", cooling_skipped_frac);
   fprintf(timers_file, "\n");
   fflush(timers_file);
 }
@@ -149,6 +170,9 @@ void timers_open_file(int rank) {
   fprintf(timers_file, "# timers: \n# step |");
   for (int k = 0; k < timer_count; k++)
     fprintf(timers_file, "%25s ", timers_names[k]);
+  for (int k = 0; k < counter_count; k++)
+    fprintf(timers_file, "%25s ", counters_names[k]);
+  fprintf(timers_file, "%25s ", "cooling_skipped_frac");
   fprintf(timers_file, "\n");
 }
 
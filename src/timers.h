@@ -92,6 +92,7 @@ enum {
   timer_do_ghost,
   timer_do_extra_ghost,
   timer_do_stars_ghost,
+  timer_do_stars_ghost_redo,
   timer_dorecv_part,
   timer_dorecv_gpart,
   timer_dorecv_spart,
@@ -118,6 +119,21 @@ extern ticks timers[timer_count];
 /* The timer names. */
 extern const char *timers_names[];
 
+/**
+ * @brief The list of event counters, reported after the timers.
+ */
+enum {
+  counter_cooling_parts = 0,
+  counter_cooling_skipped,
+  counter_count,
+};
+
+/* The counters. */
+extern long long counters[counter_count];
+
+/* The counter names. */
+extern const char *counters_names[];
+
 /* Define the timer macros. */
 #ifdef SWIFT_USE_TIMERS
 #define TIMER_TIC const ticks tic = getticks();
@@ -136,6 +152,13 @@ INLINE static ticks timers_toc(unsigned int t, ticks tic) {
 #define TIMER_TOC2(t) (void)0
 #endif
 
+/* Define the counter macros. */
+#ifdef SWIFT_USE_TIMERS
+#define COUNTER_ADD(c, n) atomic_add(&counters[c], n)
+#else
+#define COUNTER_ADD(c, n) (void)(n)
+#endif
+
 /* Function prototypes. */
 void timers_reset_all(void);
 void timers_open_file(int rank);
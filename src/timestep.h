@@ -114,10 +114,11 @@ __attribute__((always_inline)) INLINE static integertime_t get_gpart_timestep(
  * @param p The #part.
  * @param xp The #xpart partner of p.
  * @param e The #engine (used to get some constants).
+ * @param with_cooling Are we running with cooling?
  */
 __attribute__((always_inline)) INLINE static integertime_t get_part_timestep(
     const struct part *restrict p, const struct xpart *restrict xp,
-    const struct engine *restrict e) {
+    const struct engine *restrict e, const int with_cooling) {
 
   /* Compute the next timestep (hydro condition) */
   const float new_dt_hydro =
@@ -125,7 +126,7 @@ __attribute__((always_inline)) INLINE static integertime_t get_part_timestep(
 
   /* Compute the next timestep (cooling condition) */
   float new_dt_cooling = FLT_MAX;
-  if (e->policy & engine_policy_cooling)
+  if (with_cooling)
     new_dt_cooling =
         cooling_timestep(e->cooling_func, e->physical_constants, e->cosmology,
                          e->internal_units, e->hydro_properties, p, xp);
@@ -444,7 +444,9 @@ void pairs_all_stars_density(struct runner *r, struct cell *ci,
 
     /* Skip inactive particles. */
     if (!spart_is_active(spi, e)) continue;
-    if (!feedback_is_active(spi, e->time, cosmo, with_cosmology)) continue;
+    if (!feedback_is_active(spi, e->feedback_props, e->time, cosmo,
+                            with_cosmology))
+      continue;
 
     for (int j = 0; j < cj->hydro.count; ++j) {
 
@@ -478,7 +480,9 @@ void pairs_all_stars_density(struct runner *r, struct cell *ci,
 
     /* Skip inactive particles. */
     if (!spart_is_active(spj, e)) continue;
-    if (!feedback_is_active(spj, e->time, cosmo, with_cosmology)) continue;
+    if (!feedback_is_active(spj, e->feedback_props, e->time, cosmo,
+                            with_cosmology))
+      continue;
 
     for (int i = 0; i < ci->hydro.count; ++i) {
 
@@ -674,7 +678,9 @@ void self_all_stars_density(struct runner *r, struct cell *ci) {
     hig2 = hi * hi * kernel_gamma2;
 
     if (!spart_is_active(spi, e)) continue;
-    if (!feedback_is_active(spi, e->time, cosmo, with_cosmology)) continue;
+    if (!feedback_is_active(spi, e->feedback_props, e->time, cosmo,
+                            with_cosmology))
+      continue;
 
     for (int j = 0; j < ci->hydro.count; ++j) {
 
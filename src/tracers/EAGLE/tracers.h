@@ -24,9 +24,14 @@
 
 /* Local includes */
 #include "cooling.h"
+#include "hydro.h"
 #include "part.h"
 #include "tracers_struct.h"
 
+/*! Upper bound on the mean molecular weight of any gas (fully neutral pure
+ * Helium). Used to bound the temperature of a particle from above. */
+#define tracers_max_mean_molecular_weight 4.
+
 /**
  * @brief Update the particle tracers just after it has been initialised at the
  * start of a step.
@@ -78,6 +83,12 @@ static INLINE void tracers_after_drift(
  *
  * In EAGLE we record the highest temperature reached.
  *
+ * Interpolating the temperature in the cooling tables is by far the most
+ * expensive part of this. The table is only used when the temperature the
+ * particle would have at the largest possible mean molecular weight could
+ * beat the current record, which is rarely the case once a particle has been
+ * heated.
+ *
  * @param p Pointer to the particle data.
  * @param xp Pointer to the extended particle data (containing the tracers
  * struct).
@@ -95,6 +106,18 @@ static INLINE void tracers_after_timestep(
     const struct cosmology *cosmo, const struct hydro_props *hydro_props,
     const struct cooling_function_data *cooling, const double time) {
 
+  /* Upper bound on the current temperature. The cooling models return it
+   * either in Kelvin or in internal units so take the larger of the two. */
+  const double u = hydro_get_physical_internal_energy(p, xp, cosmo);
+  const double T_max = hydro_gamma_minus_one * u *
+                       tracers_max_mean_molecular_weight *
+                       phys_const->const_proton_mass /
+                       phys_const->const_boltzmann_k *
+                       max(us->UnitTemperature_in_cgs, 1.);
+
+  /* No chance of a new record? */
+  if (T_max <= xp->tracers_data.maximum_temperature) return;
+
   /* Current temperature */
   const float temperature = cooling_get_temperature(phys_const, hydro_props, us,
                                                     cosmo, cooling, p, xp);
@@ -72,6 +72,7 @@
 #define vec_rcp(a) _mm512_rcp14_ps(a)
 #define vec_rsqrt(a) _mm512_rsqrt14_ps(a)
 #define vec_ftoi(a) _mm512_cvttps_epi32(a)
+#define vec_itof(a) _mm512_cvtepi32_ps(a)
 #define vec_fmin(a, b) _mm512_min_ps(a, b)
 #define vec_fmax(a, b) _mm512_max_ps(a, b)
 #define vec_fabs(a) _mm512_andnot_ps(_mm512_set1_ps(-0.f), a)
@@ -170,6 +171,7 @@
 #define vec_rcp(a) _mm256_rcp_ps(a)
 #define vec_rsqrt(a) _mm256_rsqrt_ps(a)
 #define vec_ftoi(a) _mm256_cvttps_epi32(a)
+#define vec_itof(a) _mm256_cvtepi32_ps(a)
 #define vec_fmin(a, b) _mm256_min_ps(a, b)
 #define vec_fmax(a, b) _mm256_max_ps(a, b)
 #define vec_fabs(a) _mm256_andnot_ps(_mm256_set1_ps(-0.f), a)
@@ -336,6 +338,7 @@
 #define vec_rcp(a) _mm_rcp_ps(a)
 #define vec_rsqrt(a) _mm_rsqrt_ps(a)
 #define vec_ftoi(a) _mm_cvttps_epi32(a)
+#define vec_itof(a) _mm_cvtepi32_ps(a)
 #define vec_fmin(a, b) _mm_min_ps(a, b)
 #define vec_fmax(a, b) _mm_max_ps(a, b)
 #define vec_fabs(a) _mm_andnot_ps(_mm_set1_ps(-0.f), a)
@@ -70,4 +70,15 @@ struct groupinfo *InvokeVelociraptor(
   return 0;
 }
 
+struct groupinfo *InvokeVelociraptorStreamed(
+    const int snapnum, char *output_name, struct cosmoinfo cosmo_info,
+    struct siminfo sim_info, const size_t num_gravity_parts,
+    const size_t num_hydro_parts, const size_t num_star_parts,
+    swift_vel_fetch_function fetch, void *swift_data,
+    const int *cell_node_ids, const int numthreads,
+    const int return_group_flags, int *const num_in_groups) {
+  error("This is only a dummy. Call the real one!");
+  return 0;
+}
+
 #endif /* HAVE_DUMMY_VELOCIRAPTOR */
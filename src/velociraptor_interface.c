@@ -182,34 +182,32 @@ struct groupinfo *InvokeVelociraptor(
     const int numthreads, const int return_group_flags,
     int *const num_in_groups);
 
-#endif /* HAVE_VELOCIRAPTOR */
+#ifdef HAVE_VELOCIRAPTOR_STREAMED
+struct groupinfo *InvokeVelociraptorStreamed(
+    const int snapnum, char *output_name, struct cosmoinfo cosmo_info,
+    struct siminfo sim_info, const size_t num_gravity_parts,
+    const size_t num_hydro_parts, const size_t num_star_parts,
+    swift_vel_fetch_function fetch, void *swift_data,
+    const int *cell_node_ids, const int numthreads,
+    const int return_group_flags, int *const num_in_groups);
+#endif /* HAVE_VELOCIRAPTOR_STREAMED */
 
-/**
- * @brief Temporary structure used for the data copy mapper.
- */
-struct velociraptor_copy_data {
-  const struct engine *e;
-  struct swift_vel_part *swift_parts;
-};
+#endif /* HAVE_VELOCIRAPTOR */
 
 /**
- * @brief Mapper function to conver the #gpart into VELOCIraptor Particles.
+ * @brief Convert a range of #gpart into VELOCIraptor particles.
  *
- * @param map_data The array of #gpart.
- * @param nr_gparts The number of #gpart.
- * @param extra_data Pointer to the #engine and to the array to fill.
+ * @param e The #engine.
+ * @param offset The index of the first #gpart to convert.
+ * @param count The number of #gpart to convert.
+ * @param swift_parts The array of @p count particles to fill.
  */
-void velociraptor_convert_particles_mapper(void *map_data, int nr_gparts,
-                                           void *extra_data) {
+static void velociraptor_convert_particles(
+    const struct engine *e, const size_t offset, const size_t count,
+    struct swift_vel_part *restrict swift_parts) {
 
-  /* Unpack the data */
-  struct gpart *restrict gparts = (struct gpart *)map_data;
-  struct velociraptor_copy_data *data =
-      (struct velociraptor_copy_data *)extra_data;
-  const struct engine *e = data->e;
   const struct space *s = e->s;
-  struct swift_vel_part *swift_parts =
-      data->swift_parts + (ptrdiff_t)(gparts - s->gparts);
+  const struct gpart *restrict gparts = s->gparts + offset;
 
   /* Handle on the other particle types */
   const struct part *parts = s->parts;
@@ -233,7 +231,7 @@ void velociraptor_convert_particles_mapper(void *map_data, int nr_gparts,
    * - Physical internal energy (for the gas),
    * - Temperatures (for the gas).
    */
-  for (int i = 0; i < nr_gparts; i++) {
+  for (size_t i = 0; i < count; i++) {
 
     swift_parts[i].x[0] = gparts[i].x[0];
     swift_parts[i].x[1] = gparts[i].x[1];
@@ -248,7 +246,7 @@ void velociraptor_convert_particles_mapper(void *map_data, int nr_gparts,
 
     swift_parts[i].type = gparts[i].type;
 
-    swift_parts[i].index = i;
+    swift_parts[i].index = offset + i;
 #ifdef WITH_MPI
     swift_parts[i].task = e->nodeID;
 #else
@@ -289,6 +287,137 @@ void velociraptor_convert_particles_mapper(void *map_data, int nr_gparts,
   }
 }
 
+/**
+ * @brief Temporary structure used for the data copy mapper.
+ */
+struct velociraptor_copy_data {
+  const struct engine *e;
+  struct swift_vel_part *swift_parts;
+};
+
+/**
+ * @brief Mapper function to convert the #gpart into VELOCIraptor Particles.
+ *
+ * @param map_data The array of #gpart.
+ * @param nr_gparts The number of #gpart.
+ * @param extra_data Pointer to the #engine and to the array to fill.
+ */
+void velociraptor_convert_particles_mapper(void *map_data, int nr_gparts,
+                                           void *extra_data) {
+
+  /* Unpack the data */
+  struct gpart *restrict gparts = (struct gpart *)map_data;
+  struct velociraptor_copy_data *data =
+      (struct velociraptor_copy_data *)extra_data;
+  const struct engine *e = data->e;
+  const size_t offset = gparts - e->s->gparts;
+
+  velociraptor_convert_particles(e, offset, nr_gparts,
+                                 data->swift_parts + offset);
+}
+
+/**
+ * @brief Read a range of #gpart on behalf of VELOCIraptor.
+ *
+ * This is the #swift_vel_fetch_function handed over to VELOCIraptor in
+ * place of a full copy of the particles. The conversion is done lazily,
+ * one chunk at a time, into the buffer provided by the halo finder.
+ * It only reads the particles and can be called from several threads.
+ *
+ * @param swift_data The #engine.
+ * @param offset The index of the first #gpart to convert.
+ * @param count The number of #gpart to convert.
+ * @param out The buffer of at least @p count particles to fill.
+ */
+void velociraptor_fetch_particles(void *swift_data, size_t offset,
+                                  size_t count, struct swift_vel_part *out) {
+
+  const struct engine *e = (const struct engine *)swift_data;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (offset + count > e->s->nr_gparts)
+    error("VELOCIraptor requested particles beyond the end of the array.");
+#endif
+
+  velociraptor_convert_particles(e, offset, count, out);
+}
+
+#ifdef HAVE_VELOCIRAPTOR
+
+/* A call to VELOCIraptor running in a separate thread. */
+struct velociraptor_async {
+
+  /* The thread running VELOCIraptor. */
+  pthread_t thread;
+
+  /* Arguments of the call. */
+  int snapnum;
+  char output_name[PARSER_MAX_LINE_SIZE + 128];
+  struct cosmoinfo cosmo_info;
+  struct siminfo sim_info;
+  size_t nr_gparts, nr_parts, nr_sparts;
+  struct swift_vel_part *swift_parts;
+  int *cell_node_ids;
+  int nr_threads;
+
+  /* Rank and verbosity, for the reports. */
+  int nodeID;
+  int verbose;
+};
+
+/**
+ * @brief Allow a thread to run on any core so that the OpenMP threads spawned
+ * by VELOCIraptor can run on any core of the processor.
+ *
+ * @param thread The thread calling VELOCIraptor.
+ */
+static void velociraptor_set_affinity(pthread_t thread) {
+
+  const int nr_cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+  /* Set affinity mask to include all cores on the CPU for VELOCIraptor. */
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (int j = 0; j < nr_cores; j++) CPU_SET(j, &cpuset);
+  pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset);
+}
+
+/**
+ * @brief Body of the thread running VELOCIraptor asynchronously.
+ *
+ * @param arg The #velociraptor_async call to make.
+ */
+static void *velociraptor_invoke_async_thread(void *arg) {
+
+  struct velociraptor_async *async = (struct velociraptor_async *)arg;
+
+  velociraptor_set_affinity(pthread_self());
+
+  const ticks tic = getticks();
+
+  /* Call VELOCIraptor. No group information is returned for the
+   * catalogues not linked with a snapshot. */
+  int num_gparts_in_groups = -1;
+  struct groupinfo *group_info = (struct groupinfo *)InvokeVelociraptor(
+      async->snapnum, async->output_name, async->cosmo_info, async->sim_info,
+      async->nr_gparts, async->nr_parts, async->nr_sparts, async->swift_parts,
+      async->cell_node_ids, async->nr_threads, /*return_group_flags=*/0,
+      &num_gparts_in_groups);
+
+  if (group_info != NULL)
+    error("VELOCIraptor returned an array whilst it should not have.");
+
+  if (async->verbose)
+    message("VR Asynchronous invokation of velociraptor on rank %d took "
+            "%.3f %s.",
+            async->nodeID, clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+
+  return NULL;
+}
+
+#endif /* HAVE_VELOCIRAPTOR */
+
 /**
  * @brief Initialise VELOCIraptor with configuration, units,
  * simulation info needed to run.
@@ -391,17 +520,18 @@ void velociraptor_invoke(struct engine *e, const int linked_with_snap) {
   const int nr_cells = s->nr_cells;
   const struct cell *cells_top = s->cells_top;
 
+  /* Only one call to VELOCIraptor in flight at a time. */
+  velociraptor_wait(e);
+
+  /* Run in a separate thread while the simulation continues? The catalogues
+   * written along with a snapshot are needed by the snapshot itself. */
+  const int async = !linked_with_snap && e->stf_asynchronous;
+
   /* Allow thread to run on any core for the duration of the call to
    * VELOCIraptor so that  when OpenMP threads are spawned
    * they can run on any core on the processor. */
-  const int nr_cores = sysconf(_SC_NPROCESSORS_ONLN);
   pthread_t thread = pthread_self();
-
-  /* Set affinity mask to include all cores on the CPU for VELOCIraptor. */
-  cpu_set_t cpuset;
-  CPU_ZERO(&cpuset);
-  for (int j = 0; j < nr_cores; j++) CPU_SET(j, &cpuset);
-  pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset);
+  if (!async) velociraptor_set_affinity(thread);
 
   /* Set cosmology information for this point in time */
   struct cosmoinfo cosmo_info;
@@ -535,35 +665,89 @@ void velociraptor_invoke(struct engine *e, const int linked_with_snap) {
     snapnum = e->stf_output_count;
   }
 
-  tic = getticks();
+  /* The particles keep moving during an asynchronous call, so VELOCIraptor
+   * can only read them on demand when we wait for it. */
+#ifdef HAVE_VELOCIRAPTOR_STREAMED
+  const int copy_parts = async;
+#else
+  const int copy_parts = 1;
+#endif
 
   /* Allocate and populate an array of swift_vel_parts to be passed to
    * VELOCIraptor. */
   struct swift_vel_part *swift_parts = NULL;
-  if (posix_memalign((void **)&swift_parts, part_align,
-                     nr_gparts * sizeof(struct swift_vel_part)) != 0)
-    error("Failed to allocate array of particles for VELOCIraptor.");
+  if (copy_parts) {
 
-  struct velociraptor_copy_data copy_data = {e, swift_parts};
-  threadpool_map(&e->threadpool, velociraptor_convert_particles_mapper,
-                 s->gparts, nr_gparts, sizeof(struct gpart), 0, &copy_data);
+    tic = getticks();
 
-  /* Report timing */
-  if (e->verbose)
-    message("VR Collecting particle info took %.3f %s.",
-            clocks_from_ticks(getticks() - tic), clocks_getunit());
+    if (posix_memalign((void **)&swift_parts, part_align,
+                       nr_gparts * sizeof(struct swift_vel_part)) != 0)
+      error("Failed to allocate array of particles for VELOCIraptor.");
 
-  tic = getticks();
+    struct velociraptor_copy_data copy_data = {e, swift_parts};
+    threadpool_map(&e->threadpool, velociraptor_convert_particles_mapper,
+                   s->gparts, nr_gparts, sizeof(struct gpart), 0, &copy_data);
+
+    /* Report timing */
+    if (e->verbose)
+      message("VR Collecting particle info took %.3f %s.",
+              clocks_from_ticks(getticks() - tic), clocks_getunit());
+  }
+
+  /* Hand everything over to a separate thread and carry on? */
+  if (async) {
+
+    struct velociraptor_async *staged = (struct velociraptor_async *)calloc(
+        1, sizeof(struct velociraptor_async));
+    if (staged == NULL)
+      error("Error allocating asynchronous VELOCIraptor data");
+
+    staged->snapnum = snapnum;
+    strcpy(staged->output_name, outputFileName);
+    staged->cosmo_info = cosmo_info;
+    staged->sim_info = sim_info;
+    staged->nr_gparts = nr_gparts;
+    staged->nr_parts = nr_parts;
+    staged->nr_sparts = nr_sparts;
+    staged->swift_parts = swift_parts;
+    staged->cell_node_ids = cell_node_ids;
+    staged->nr_threads = e->nr_threads;
+    staged->nodeID = e->nodeID;
+    staged->verbose = e->verbose;
+
+    if (pthread_create(&staged->thread, /*attr=*/NULL,
+                       velociraptor_invoke_async_thread, staged) != 0)
+      error("Failed to create the VELOCIraptor thread.");
+
+    e->stf_async = staged;
+
+    /* Increase output counter */
+    e->stf_output_count++;
+    return;
+  }
 
   /* Values returned by VELOCIRaptor */
   int num_gparts_in_groups = -1;
   struct groupinfo *group_info = NULL;
 
+  tic = getticks();
+
   /* Call VELOCIraptor. */
-  group_info = (struct groupinfo *)InvokeVelociraptor(
-      snapnum, outputFileName, cosmo_info, sim_info, nr_gparts, nr_parts,
-      nr_sparts, swift_parts, cell_node_ids, e->nr_threads, linked_with_snap,
-      &num_gparts_in_groups);
+#ifdef HAVE_VELOCIRAPTOR_STREAMED
+  if (!copy_parts)
+
+    /* Let it read the particles on demand, chunk by chunk, rather than
+     * handing it a converted copy of all of them. */
+    group_info = (struct groupinfo *)InvokeVelociraptorStreamed(
+        snapnum, outputFileName, cosmo_info, sim_info, nr_gparts, nr_parts,
+        nr_sparts, velociraptor_fetch_particles, (void *)e, cell_node_ids,
+        e->nr_threads, linked_with_snap, &num_gparts_in_groups);
+  else
+#endif
+    group_info = (struct groupinfo *)InvokeVelociraptor(
+        snapnum, outputFileName, cosmo_info, sim_info, nr_gparts, nr_parts,
+        nr_sparts, swift_parts, cell_node_ids, e->nr_threads,
+        linked_with_snap, &num_gparts_in_groups);
 
   /* Check that the ouput is valid */
   if (linked_with_snap && group_info == NULL && num_gparts_in_groups < 0) {
@@ -616,3 +800,30 @@ void velociraptor_invoke(struct engine *e, const int linked_with_snap) {
   error("SWIFT not configure to run with VELOCIraptor.");
 #endif /* HAVE_VELOCIRAPTOR */
 }
+
+/**
+ * @brief Waits for a call to VELOCIraptor running asynchronously (if any) to
+ * be complete.
+ *
+ * @param e The #engine.
+ */
+void velociraptor_wait(struct engine *e) {
+
+  if (e->stf_async == NULL) return;
+
+#ifdef HAVE_VELOCIRAPTOR
+  const ticks tic = getticks();
+
+  struct velociraptor_async *async = e->stf_async;
+  if (pthread_join(async->thread, /*retval=*/NULL) != 0)
+    error("Failed to join the VELOCIraptor thread.");
+
+  if (e->verbose)
+    message("Waited %.3f %s for VELOCIraptor output '%s' to be completed.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit(),
+            async->output_name);
+
+  free(async);
+  e->stf_async = NULL;
+#endif /* HAVE_VELOCIRAPTOR */
+}
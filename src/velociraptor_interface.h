@@ -28,5 +28,6 @@ struct engine;
 /* VELOCIraptor wrapper functions. */
 void velociraptor_init(struct engine *e);
 void velociraptor_invoke(struct engine *e, const int linked_with_snap);
+void velociraptor_wait(struct engine *e);
 
 #endif /* SWIFT_VELOCIRAPTOR_INTERFACE_H */
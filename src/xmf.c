@@ -25,6 +25,7 @@
 #include <libgen.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 /* This object's header. */
 #include "xmf.h"
@@ -51,47 +52,49 @@ static const char* xmf_basename(const char* hdfFileName) {
 /**
  * @brief Prepare the XMF file corresponding to a snapshot.
  *
+ * Cuts the three closing lines off the end of the file and leaves it open
+ * for the description of the next snapshot to be appended. Only the tail
+ * of the file is read so this does not get slower as the file grows over
+ * the run.
+ *
  * @param baseName The common part of the file name.
  */
 FILE* xmf_prepare_file(const char* baseName) {
   char buffer[1024];
 
   char fileName[FILENAME_BUFFER_SIZE];
-  char tempFileName[FILENAME_BUFFER_SIZE];
   snprintf(fileName, FILENAME_BUFFER_SIZE, "%s.xmf", baseName);
-  snprintf(tempFileName, FILENAME_BUFFER_SIZE, "%s_temp.xmf", baseName);
-  FILE* xmfFile = fopen(fileName, "r");
-  FILE* tempFile = fopen(tempFileName, "w");
+  FILE* xmfFile = fopen(fileName, "r+");
 
   if (xmfFile == NULL) error("Unable to open current XMF file.");
 
-  if (tempFile == NULL) error("Unable to open temporary file.");
+  /* Read the tail of the file */
+  if (fseek(xmfFile, 0, SEEK_END) != 0) error("Unable to seek in XMF file.");
+  const long size = ftell(xmfFile);
+  const long tail = size < (long)sizeof(buffer) ? size : (long)sizeof(buffer);
+  if (fseek(xmfFile, size - tail, SEEK_SET) != 0 ||
+      fread(buffer, 1, tail, xmfFile) != (size_t)tail)
+    error("Unable to read the end of the XMF file.");
 
-  /* First we make a temporary copy of the XMF file and count the lines */
-  int counter = 0;
-  while (fgets(buffer, 1024, xmfFile) != NULL) {
-    counter++;
-    fprintf(tempFile, "%s", buffer);
+  /* Find the start of the third line from the end, i.e. the character after
+   * the fourth newline counting backwards from the last one. */
+  long start = -1;
+  int newlines = 0;
+  for (long k = tail - 1; k >= 0; k--) {
+    if (buffer[k] == '\n' && ++newlines == 4) {
+      start = size - tail + k + 1;
+      break;
+    }
   }
-  fclose(tempFile);
-  fclose(xmfFile);
-
-  /* We then copy the XMF file back up to the closing lines */
-  xmfFile = fopen(fileName, "w");
-  tempFile = fopen(tempFileName, "r");
+  if (start < 0) error("Could not find the closing lines of the XMF file.");
 
-  if (xmfFile == NULL) error("Unable to open current XMF file.");
-
-  if (tempFile == NULL) error("Unable to open temporary file.");
-
-  int i = 0;
-  while (fgets(buffer, 1024, tempFile) != NULL && i < counter - 3) {
-    i++;
-    fprintf(xmfFile, "%s", buffer);
-  }
+  /* Chop them off and get ready to append */
+  fflush(xmfFile);
+  if (ftruncate(fileno(xmfFile), start) != 0)
+    error("Unable to truncate XMF file.");
+  if (fseek(xmfFile, start, SEEK_SET) != 0)
+    error("Unable to seek in XMF file.");
   fprintf(xmfFile, "\n");
-  fclose(tempFile);
-  remove(tempFileName);
 
   return xmfFile;
 }
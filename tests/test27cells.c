@@ -208,8 +208,7 @@ struct cell *make_cell(size_t n, double *offset, double size, double h,
 
 void clean_up(struct cell *ci) {
   free(ci->hydro.parts);
-  for (int k = 0; k < 13; k++)
-    if (ci->hydro.sort[k] != NULL) free(ci->hydro.sort[k]);
+  cell_free_hydro_sorts(ci);
   free(ci);
 }
 
@@ -490,6 +489,7 @@ int main(int argc, char *argv[]) {
 
   struct runner runner;
   runner.e = &engine;
+  bzero(&runner.sort_arena, sizeof(struct sort_arena));
 
   /* Construct some cells */
   struct cell *cells[27];
@@ -634,5 +634,7 @@ int main(int argc, char *argv[]) {
   cache_clean(&runner.cj_cache);
 #endif
 
+  sort_arena_clean(&runner.sort_arena);
+
   return 0;
 }
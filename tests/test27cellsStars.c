@@ -200,8 +200,7 @@ struct cell *make_cell(size_t n, size_t n_stars, double *offset, double size,
 void clean_up(struct cell *ci) {
   free(ci->hydro.parts);
   free(ci->stars.parts);
-  for (int k = 0; k < 13; k++)
-    if (ci->hydro.sort[k] != NULL) free(ci->hydro.sort[k]);
+  cell_free_hydro_sorts(ci);
   free(ci);
 }
 
@@ -406,6 +405,7 @@ int main(int argc, char *argv[]) {
 
   struct runner runner;
   runner.e = &engine;
+  bzero(&runner.sort_arena, sizeof(struct sort_arena));
 
   /* Construct some cells */
   struct cell *cells[27];
@@ -544,5 +544,7 @@ int main(int argc, char *argv[]) {
   /* Clean things to make the sanitizer happy ... */
   for (int i = 0; i < 27; ++i) clean_up(cells[i]);
 
+  sort_arena_clean(&runner.sort_arena);
+
   return 0;
 }
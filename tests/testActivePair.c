@@ -591,6 +591,7 @@ int main(int argc, char *argv[]) {
   }
 
   runner->e = &engine;
+  bzero(&runner->sort_arena, sizeof(struct sort_arena));
 
   /* Create output file names. */
   sprintf(swiftOutputFileName, "swift_dopair_%.150s.dat",
@@ -683,5 +684,8 @@ int main(int argc, char *argv[]) {
                              perturbation, h_pert, swiftOutputFileName,
                              bruteForceOutputFileName, serial_inter_func,
                              vec_inter_func, init, finalise);
+
+  sort_arena_clean(&runner->sort_arena);
+
   return 0;
 }
@@ -0,0 +1,26 @@
+#!/bin/bash
+
+echo ""
+
+rm -f brute_force_pair_active.dat swift_dopair_active.dat
+
+echo "Running ./testActivePair -n 6 -r 1 -d 0 -f active"
+
+./testActivePair -n 6 -r 1 -d 0 -f active
+
+python ./difffloat.py brute_force_pair_active.dat swift_dopair_active.dat ./tolerance_pair_active.dat
+
+python ./difffloat.py brute_force_dopair2_active.dat swift_dopair2_force_active.dat ./tolerance_pair_force_active.dat
+
+rm -f brute_force_pair_active.dat swift_dopair_active.dat
+
+# Run the special case that triggered a bug. See merge request !435.
+echo "Running ./testActivePair -n 6 -r 1 -d 0 -f active -s 1506434777"
+
+./testActivePair -n 6 -r 1 -d 0 -f active -s 1506434777
+
+python ./difffloat.py brute_force_pair_active.dat swift_dopair_active.dat ./tolerance_pair_active.dat
+
+python ./difffloat.py brute_force_dopair2_active.dat swift_dopair2_force_active.dat ./tolerance_pair_force_active.dat
+
+exit $?
@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+#include <fenv.h>
+
+/* Local headers. */
+#include "swift.h"
+
+#define NUM_KEYS (1000 * 1000)
+#define NUM_ADDS_PER_KEY (8)
+#define NUM_THREADS (8)
+
+/* Every mapped element adds to the key element / NUM_ADDS_PER_KEY, so that
+ * all the keys are hit concurrently by different chunks. */
+void add_mapper(void *map_data, int num_elements, void *extra_data) {
+
+  concurrent_hashmap_t *m = (concurrent_hashmap_t *)extra_data;
+  const size_t *elements = (const size_t *)map_data;
+
+  for (int k = 0; k < num_elements; k++) {
+    const hashmap_key_t key = elements[k] % NUM_KEYS;
+    if (!concurrent_hashmap_add(m, key, 1, 0.5))
+      error("Couldn't find key (%zu) or create new one.", key);
+  }
+}
+
+/* Checks the values and counts the elements visited. */
+void check_mapper(hashmap_key_t key, hashmap_value_t *value, void *data) {
+
+  size_t *count = (size_t *)data;
+
+  if (key >= NUM_KEYS) error("Invalid key found: %zu", key);
+  if (value->value_st != NUM_ADDS_PER_KEY)
+    error("Incorrect count (%lld) found for key: %zu", value->value_st, key);
+  if (value->value_dbl != 0.5 * NUM_ADDS_PER_KEY)
+    error("Incorrect sum (%e) found for key: %zu", value->value_dbl, key);
+
+  atomic_inc(count);
+}
+
+int main(int argc, char *argv[]) {
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+/* Choke on FPEs */
+#ifdef HAVE_FE_ENABLE_EXCEPT
+  feenableexcept(FE_DIVBYZERO | FE_INVALID | FE_OVERFLOW);
+#endif
+
+  struct threadpool tp;
+  threadpool_init(&tp, NUM_THREADS);
+
+  /* The list of elements to add, with the keys interleaved */
+  const size_t num_elements = NUM_KEYS * NUM_ADDS_PER_KEY;
+  size_t *elements = (size_t *)malloc(num_elements * sizeof(size_t));
+  if (elements == NULL) error("Impossible to allocate the elements.");
+  for (size_t k = 0; k < num_elements; k++) elements[k] = k;
+
+  concurrent_hashmap_t m;
+
+  message("Initialising hash table...");
+  concurrent_hashmap_init(&m, NUM_KEYS);
+
+  message("Populating hash table concurrently...");
+  threadpool_map(&tp, add_mapper, elements, num_elements, sizeof(size_t), 0,
+                 &m);
+
+  message("Checking hash table size...");
+  if (concurrent_hashmap_size(&m) != NUM_KEYS)
+    error(
+        "The no. of elements stored in the hash table are not equal to the no. "
+        "of keys. No. of elements: %zu, no. of keys: %d",
+        concurrent_hashmap_size(&m), NUM_KEYS);
+
+  message("Retrieving elements from the hash table...");
+  for (hashmap_key_t key = 0; key < NUM_KEYS; key++) {
+    hashmap_value_t *value = concurrent_hashmap_lookup(&m, key);
+
+    if (value == NULL) error("Key: %zu not found.", key);
+    if (value->value_st != NUM_ADDS_PER_KEY)
+      error("Incorrect value (%lld) found for key: %zu", value->value_st, key);
+  }
+
+  message("Checking for invalid key...");
+  if (concurrent_hashmap_lookup(&m, NUM_KEYS + 1) != NULL)
+    error("Key: %d shouldn't exist or be created.", NUM_KEYS + 1);
+
+  message("Iterating over the hash table...");
+  size_t count = 0;
+  concurrent_hashmap_iterate(&m, check_mapper, &count);
+  if (count != NUM_KEYS)
+    error("Serial iteration visited %zu elements instead of %d.", count,
+          NUM_KEYS);
+
+  count = 0;
+  concurrent_hashmap_iterate_parallel(&m, &tp, check_mapper, &count);
+  if (count != NUM_KEYS)
+    error("Parallel iteration visited %zu elements instead of %d.", count,
+          NUM_KEYS);
+
+  message("Freeing hash table...");
+  concurrent_hashmap_free(&m);
+  free(elements);
+  threadpool_clean(&tp);
+
+  return 0;
+}
@@ -63,7 +63,7 @@ int main(int argc, char *argv[]) {
 
   /* Prepare a dump. */
   struct dump d;
-  dump_init(&d, filename, 1024);
+  dump_init(&d, filename, 1024, /*sync_interval=*/1e-3);
 
   /* Print the page size for reference. */
   printf("Will dump %i bytes, page size is %zi bytes.\n",
@@ -90,6 +90,21 @@ int main(int argc, char *argv[]) {
   /* Clean the threads */
   threadpool_clean(&t);
 
+  /* Check that every record made it to the file, in order. */
+  FILE *file = fopen(filename, "r");
+  if (file == NULL) error("Failed to re-open the dump file.");
+  char line[8];
+  int num_lines = 0;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (atoi(line) != num_lines)
+      error("Wrong record %i in the dump file: '%s'.", num_lines, line);
+    num_lines++;
+  }
+  fclose(file);
+  if (num_lines != num_runs * chunk_size)
+    error("Found %i records in the dump file instead of %i.", num_lines,
+          num_runs * chunk_size);
+
   /* Be clean */
   remove(filename);
 
@@ -87,6 +87,70 @@
  */
 
 #ifdef EOS_PLANETARY
+
+/**
+ * @brief Times the SESAME P(rho, u) and c(rho, u) lookups with the standard
+ * searches in the tables and with the uniformly re-sampled tables, and
+ * reports the largest relative difference between the two within the table.
+ *
+ * @param mat The SESAME material.
+ */
+void benchmark_SESAME(struct SESAME_params *mat) {
+
+  if (!mat->use_fast_table) error("The SESAME tables were not re-sampled.");
+
+  const int num_samples = 1000000;
+  const float log_rho_min = mat->log_rho_min_fast;
+  const float log_rho_max =
+      log_rho_min + (mat->num_rho_fast - 1) / mat->inv_dlog_rho_fast;
+  const float log_u_min = mat->log_u_min_fast;
+  const float log_u_max =
+      log_u_min + (mat->num_u_fast - 1) / mat->inv_dlog_u_fast;
+  float *rho = (float *)malloc(num_samples * sizeof(float));
+  float *u = (float *)malloc(num_samples * sizeof(float));
+  float *P_slow = (float *)malloc(num_samples * sizeof(float));
+  float *P_fast = (float *)malloc(num_samples * sizeof(float));
+  if (rho == NULL || u == NULL || P_slow == NULL || P_fast == NULL)
+    error("Impossible to allocate memory for the benchmark.");
+
+  for (int i = 0; i < num_samples; i++) {
+    rho[i] = expf(log_rho_min +
+                  (log_rho_max - log_rho_min) * rand() / (float)RAND_MAX);
+    u[i] = expf(log_u_min + (log_u_max - log_u_min) * rand() / (float)RAND_MAX);
+  }
+
+  /* Standard searches */
+  mat->use_fast_table = 0;
+  ticks tic = getticks();
+  for (int i = 0; i < num_samples; i++)
+    P_slow[i] = SESAME_pressure_from_internal_energy(rho[i], u[i], mat) +
+                SESAME_soundspeed_from_internal_energy(rho[i], u[i], mat);
+  const ticks toc_slow = getticks() - tic;
+
+  /* Re-sampled tables */
+  mat->use_fast_table = 1;
+  tic = getticks();
+  for (int i = 0; i < num_samples; i++)
+    P_fast[i] = SESAME_pressure_from_internal_energy(rho[i], u[i], mat) +
+                SESAME_soundspeed_from_internal_energy(rho[i], u[i], mat);
+  const ticks toc_fast = getticks() - tic;
+
+  float max_diff = 0.f;
+  for (int i = 0; i < num_samples; i++)
+    if (P_slow[i] > 0.f)
+      max_diff = max(max_diff, fabsf(P_fast[i] - P_slow[i]) / P_slow[i]);
+
+  printf("SESAME lookups: standard %.3f %s, re-sampled %.3f %s ",
+         clocks_from_ticks(toc_slow), clocks_getunit(),
+         clocks_from_ticks(toc_fast), clocks_getunit());
+  printf("(max. relative difference of P + c: %.3e) \n", max_diff);
+
+  free(rho);
+  free(u);
+  free(P_slow);
+  free(P_fast);
+}
+
 int main(int argc, char *argv[]) {
   float rho, u, log_rho, log_u, P, c;
   struct unit_system us;
@@ -229,6 +293,7 @@ int main(int argc, char *argv[]) {
                                         &us, UNIT_CONV_ENERGY_PER_UNIT_MASS));
 
   // Set the input parameters
+  parser_init("", params);
   // Which EOS to initialise
   parser_set_param(params, "EoS:planetary_use_Til:1");
   parser_set_param(params, "EoS:planetary_use_HM80:1");
@@ -255,10 +320,30 @@ int main(int argc, char *argv[]) {
   parser_set_param(params,
                    "EoS:planetary_SS08_water_table_file:"
                    "../examples/planetary_SS08_water.txt");
+  parser_set_param(params, "EoS:planetary_SESAME_fast_table_factor:4");
 
   // Initialise the EOS materials
   eos_init(&eos, phys_const, &us, params);
 
+  // Compare the speed of the SESAME lookups
+  if (type == eos_planetary_type_SESAME) {
+    struct SESAME_params *mat = NULL;
+    switch (mat_id) {
+      case eos_planetary_id_SESAME_iron:
+        mat = &eos.SESAME_iron;
+        break;
+      case eos_planetary_id_SESAME_basalt:
+        mat = &eos.SESAME_basalt;
+        break;
+      case eos_planetary_id_SESAME_water:
+        mat = &eos.SESAME_water;
+        break;
+      default:
+        mat = &eos.SS08_water;
+    }
+    benchmark_SESAME(mat);
+  }
+
   // Manual debug testing
   if (1) {
     printf("\n ### MANUAL DEBUG TESTING ### \n");
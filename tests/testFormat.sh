@@ -0,0 +1,6 @@
+#!/bin/bash
+
+set -e
+
+cd ./..
+./format.sh --test
@@ -960,7 +960,8 @@ int main(int argc, char* argv[]) {
     /* Compute all derivatives */
     struct potential_derivatives_M2L pot;
     potential_derivatives_compute_M2L(dx, dy, dz, r2, r_inv, eps, eps_inv,
-                                      periodic, r_s_inv, &pot);
+                                      periodic, r_s_inv, &pot,
+                                      SELF_GRAVITY_MULTIPOLE_ORDER);
 
     /* Minimal value we care about */
     const double min = 1e-9;
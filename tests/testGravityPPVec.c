@@ -0,0 +1,198 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include "../config.h"
+
+/* Some standard headers. */
+#include <fenv.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Local headers. */
+#include "gravity_iact.h"
+#include "swift.h"
+
+#ifdef WITH_VECTORIZATION
+
+const int num_points = 1 << 10;
+const int num_runs = 20000;
+
+/**
+ * @brief Check that a and b are consistent (up to some absolute error)
+ *
+ * @param a The vector value.
+ * @param b The scalar reference.
+ * @param s String used to identify this check in messages.
+ * @param abs_tol Maximal absolute error.
+ * @param rel_tol Maximal relative error.
+ */
+void check_value(float a, float b, const char *s, float abs_tol,
+                 float rel_tol) {
+  if (fabsf(a - b) > abs_tol && fabsf(a - b) > rel_tol * fabsf(b))
+    error("Values are inconsistent: vector= %e scalar= %e (%s)!", a, b, s);
+}
+
+int main(int argc, char *argv[]) {
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+  /* Choke on FP-exceptions */
+#ifdef HAVE_FE_ENABLE_EXCEPT
+  feenableexcept(FE_DIVBYZERO | FE_INVALID | FE_OVERFLOW);
+#endif
+
+  message("Testing the gravity vector kernels with VEC_SIZE=%d", VEC_SIZE);
+
+  /* Test the softening kernels over [0, 1[ */
+  for (int k = 0; k < num_points; k += VEC_SIZE) {
+
+    vector u, W_f, W_pot;
+    for (int l = 0; l < VEC_SIZE; ++l) u.f[l] = (float)(k + l) / num_points;
+
+    kernel_grav_force_eval_vec(&u, &W_f);
+    kernel_grav_pot_eval_vec(&u, &W_pot);
+
+    for (int l = 0; l < VEC_SIZE; ++l) {
+      float W_f_ref, W_pot_ref;
+      kernel_grav_force_eval(u.f[l], &W_f_ref);
+      kernel_grav_pot_eval(u.f[l], &W_pot_ref);
+      check_value(W_f.f[l], W_f_ref, "softened force", 1e-5f, 1e-6f);
+      check_value(W_pot.f[l], W_pot_ref, "softened potential", 1e-5f, 1e-6f);
+    }
+  }
+
+  /* Test the long-range kernels over [0, 10[ */
+  for (int k = 0; k < num_points; k += VEC_SIZE) {
+
+    vector u, W_f, W_pot;
+    for (int l = 0; l < VEC_SIZE; ++l)
+      u.f[l] = 10.f * (float)(k + l) / num_points;
+
+    kernel_long_grav_force_eval_vec(&u, &W_f);
+    kernel_long_grav_pot_eval_vec(&u, &W_pot);
+
+    for (int l = 0; l < VEC_SIZE; ++l) {
+      float W_f_ref, W_pot_ref;
+      kernel_long_grav_force_eval(u.f[l], &W_f_ref);
+      kernel_long_grav_pot_eval(u.f[l], &W_pot_ref);
+      check_value(W_f.f[l], W_f_ref, "long-range force", 1e-6f, 1e-5f);
+      check_value(W_pot.f[l], W_pot_ref, "long-range potential", 1e-6f,
+                  1e-5f);
+    }
+  }
+
+  /* Build a set of distances spanning both sides of the softening length and
+   * a good fraction of the mesh scale */
+  const float h = 0.1f;
+  const float h2 = h * h;
+  const float h_inv = 1.f / h;
+  const float h_inv3 = h_inv * h_inv * h_inv;
+  const float r_s_inv = 1.f / 0.25f;
+  const float mass = 1.5f;
+
+  float *r2 = NULL;
+  float *f_scalar = NULL, *pot_scalar = NULL;
+  float *f_vector = NULL, *pot_vector = NULL;
+  if (posix_memalign((void **)&r2, SWIFT_CACHE_ALIGNMENT,
+                     num_points * sizeof(float)) != 0 ||
+      posix_memalign((void **)&f_scalar, SWIFT_CACHE_ALIGNMENT,
+                     num_points * sizeof(float)) != 0 ||
+      posix_memalign((void **)&pot_scalar, SWIFT_CACHE_ALIGNMENT,
+                     num_points * sizeof(float)) != 0 ||
+      posix_memalign((void **)&f_vector, SWIFT_CACHE_ALIGNMENT,
+                     num_points * sizeof(float)) != 0 ||
+      posix_memalign((void **)&pot_vector, SWIFT_CACHE_ALIGNMENT,
+                     num_points * sizeof(float)) != 0)
+    error("Impossible to allocate the test arrays.");
+
+  for (int k = 0; k < num_points; ++k) {
+    const float r = 2.f * (float)(k + 1) / num_points;
+    r2[k] = r * r;
+  }
+
+  /* Compare the full and truncated P-P interactions */
+  for (int truncated = 0; truncated < 2; ++truncated) {
+
+    const vector v_h2 = vector_set1(h2);
+    const vector v_h_inv = vector_set1(h_inv);
+    const vector v_h_inv3 = vector_set1(h_inv3);
+    const vector v_r_s_inv = vector_set1(r_s_inv);
+    const vector v_mass = vector_set1(mass);
+
+    /* Scalar reference */
+    const ticks tic_scalar = getticks();
+    for (int n = 0; n < num_runs; ++n) {
+      for (int k = 0; k < num_points; ++k) {
+        if (truncated)
+          runner_iact_grav_pp_truncated(r2[k], h2, h_inv, h_inv3, mass,
+                                        r_s_inv, &f_scalar[k], &pot_scalar[k]);
+        else
+          runner_iact_grav_pp_full(r2[k], h2, h_inv, h_inv3, mass,
+                                   &f_scalar[k], &pot_scalar[k]);
+      }
+    }
+    const ticks toc_scalar = getticks();
+
+    /* Vector version */
+    const ticks tic_vector = getticks();
+    for (int n = 0; n < num_runs; ++n) {
+      for (int k = 0; k < num_points; k += VEC_SIZE) {
+        vector v_r2, v_f, v_pot;
+        v_r2.v = vec_load(&r2[k]);
+        if (truncated)
+          runner_iact_grav_pp_truncated_vec(&v_r2, &v_h2, &v_h_inv, &v_h_inv3,
+                                            &v_mass, &v_r_s_inv, &v_f, &v_pot);
+        else
+          runner_iact_grav_pp_full_vec(&v_r2, &v_h2, &v_h_inv, &v_h_inv3,
+                                       &v_mass, &v_f, &v_pot);
+        vec_store(v_f.v, &f_vector[k]);
+        vec_store(v_pot.v, &pot_vector[k]);
+      }
+    }
+    const ticks toc_vector = getticks();
+
+    for (int k = 0; k < num_points; ++k) {
+      check_value(f_vector[k], f_scalar[k], "P-P force", 1e-6f, 1e-4f);
+      check_value(pot_vector[k], pot_scalar[k], "P-P potential", 1e-6f,
+                  1e-4f);
+    }
+
+    message("%s P-P scalar took %9.3f %s.", truncated ? "truncated" : "full",
+            clocks_from_ticks(toc_scalar - tic_scalar), clocks_getunit());
+    message("%s P-P vector took %9.3f %s.", truncated ? "truncated" : "full",
+            clocks_from_ticks(toc_vector - tic_vector), clocks_getunit());
+  }
+
+  free(r2);
+  free(f_scalar);
+  free(pot_scalar);
+  free(f_vector);
+  free(pot_vector);
+
+  message("All values are consistent");
+  return 0;
+}
+
+#else
+
+int main(int argc, char *argv[]) { return 0; }
+
+#endif /* WITH_VECTORIZATION */
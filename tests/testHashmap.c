@@ -27,6 +27,18 @@
 
 #define NUM_KEYS (26 * 1000 * 1000)
 
+/* Number of keys after which the table is in the middle of being moved to a
+ * larger one. */
+#define NUM_KEYS_MOVING (15 * 1000 * 1000)
+
+/* Mapper counting the elements and checking their values. */
+void count_mapper(hashmap_key_t key, hashmap_value_t *value, void *data) {
+  if (value->value_st != (long long)key)
+    error("Incorrect value (%lld) iterated for key: %lld", value->value_st,
+          (long long)key);
+  *(size_t *)data += 1;
+}
+
 int main(int argc, char *argv[]) {
 
   /* Initialize CPU frequency, this also starts time. */
@@ -44,16 +56,30 @@ int main(int argc, char *argv[]) {
   hashmap_init(&m);
 
   message("Populating hash table...");
+  ticks tic = getticks();
   for (hashmap_key_t key = 0; key < NUM_KEYS; key++) {
     hashmap_value_t value;
     value.value_st = (long long)key;
     hashmap_put(&m, key, value);
+
+    /* Check the elements split between the old and new tables. */
+    if (key == NUM_KEYS_MOVING) {
+      if (m.old_table.ctrl == NULL) error("Expected an incremental growth.");
+      for (hashmap_key_t k = 0; k <= key; k += 997) {
+        hashmap_value_t *v = hashmap_lookup(&m, k);
+        if (v == NULL || v->value_st != (long long)k)
+          error("Key: %lld lost while growing.", (long long)k);
+      }
+    }
   }
+  message("Inserting %d keys took %.3f %s.", NUM_KEYS,
+          clocks_from_ticks(getticks() - tic), clocks_getunit());
 
   message("Dumping hashmap stats.");
   hashmap_print_stats(&m);
 
   message("Retrieving elements from the hash table...");
+  tic = getticks();
   for (hashmap_key_t key = 0; key < NUM_KEYS; key++) {
     hashmap_value_t value = *hashmap_lookup(&m, key);
 
@@ -62,6 +88,25 @@ int main(int argc, char *argv[]) {
             (long long)key);
     // else message("Retrieved element, Key: %zu Value: %zu", key, value);
   }
+  message("Looking up %d keys took %.3f %s.", NUM_KEYS,
+          clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  message("Checking that existing keys are not re-created...");
+  tic = getticks();
+  for (hashmap_key_t key = 0; key < NUM_KEYS; key++) {
+    int created_new_element = 0;
+    hashmap_value_t *value = hashmap_get_new(&m, key, &created_new_element);
+    if (created_new_element || value->value_st != (long long)key)
+      error("Key: %lld was re-created or has a wrong value.", (long long)key);
+  }
+  message("Getting %d existing keys took %.3f %s.", NUM_KEYS,
+          clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  message("Iterating over the hash table...");
+  size_t count = 0;
+  hashmap_iterate(&m, count_mapper, &count);
+  if (count != NUM_KEYS)
+    error("Iterated over %zu elements instead of %d.", count, NUM_KEYS);
 
   message("Checking for invalid key...");
   if (hashmap_lookup(&m, NUM_KEYS + 1) != NULL)
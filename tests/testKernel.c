@@ -25,10 +25,36 @@
 
 #include <fenv.h>
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
 
 const int numPoints = (1 << 28);
 
+#ifdef KERNEL_TABULATED
+/**
+ * @brief Evaluates the kernel polynomial in double precision.
+ *
+ * @param u The ratio of the distance to the smoothing length.
+ * @param W (return) The value of the kernel function.
+ * @param dW_dx (return) The norm of the gradient of the kernel.
+ */
+void kernel_deval_double(float u, double *W, double *dW_dx) {
+
+  const double x = min((double)u * kernel_gamma_inv, 1.);
+  const int ind = min((int)(x * kernel_ivals), kernel_ivals);
+  const float *const coeffs = &kernel_coeffs[ind * (kernel_degree + 1)];
+
+  double w = coeffs[0], dw_dx = 0.;
+  for (int k = 1; k <= kernel_degree; k++) {
+    dw_dx = dw_dx * x + w;
+    w = w * x + coeffs[k];
+  }
+
+  *W = max(w, 0.) * kernel_constant * kernel_gamma_inv_dim;
+  *dW_dx = min(dw_dx, 0.) * kernel_constant * kernel_gamma_inv_dim_plus_one;
+}
+#endif
+
 int main(int argc, char *argv[]) {
 
   /* Initialize CPU frequency, this also starts time. */
@@ -76,6 +102,62 @@ int main(int argc, char *argv[]) {
   if (dWtest > 0.f)
     error("Kernel derivative is positive u=%e dW=%e", 1.930290, dWtest);
 
+#ifdef KERNEL_TABULATED
+
+  message("Tabulated kernel vs. polynomial");
+  message("-------------");
+
+  /* Time the polynomial and keep its values as the reference */
+  float *W_poly, *dW_poly;
+  if (posix_memalign((void **)&W_poly, SWIFT_CACHE_ALIGNMENT,
+                     numPoints * sizeof(float)) != 0)
+    error("Error allocating W_poly");
+  if (posix_memalign((void **)&dW_poly, SWIFT_CACHE_ALIGNMENT,
+                     numPoints * sizeof(float)) != 0)
+    error("Error allocating dW_poly");
+
+  ticks tic = getticks();
+  for (int i = 0; i < numPoints; ++i)
+    kernel_deval_poly(u[i], &W_poly[i], &dW_poly[i]);
+  const ticks toc_poly = getticks() - tic;
+
+  tic = getticks();
+  for (int i = 0; i < numPoints; ++i) kernel_deval(u[i], &W[i], &dW[i]);
+  const ticks toc_table = getticks() - tic;
+
+  message("Polynomial: %.3f %s, table: %.3f %s", clocks_from_ticks(toc_poly),
+          clocks_getunit(), clocks_from_ticks(toc_table), clocks_getunit());
+
+  /* Errors relative to the largest value of the kernel and its derivative,
+   * measured against the polynomial evaluated in double precision */
+  double W_max = 0., dW_max = 0.;
+  double W_err = 0., dW_err = 0., W_poly_err = 0., dW_poly_err = 0.;
+  for (int i = 0; i < numPoints; ++i) {
+    double W_ref, dW_ref;
+    kernel_deval_double(u[i], &W_ref, &dW_ref);
+    W_max = max(W_max, fabs(W_ref));
+    dW_max = max(dW_max, fabs(dW_ref));
+    W_err = max(W_err, fabs(W[i] - W_ref));
+    dW_err = max(dW_err, fabs(dW[i] - dW_ref));
+    W_poly_err = max(W_poly_err, fabs(W_poly[i] - W_ref));
+    dW_poly_err = max(dW_poly_err, fabs(dW_poly[i] - dW_ref));
+  }
+  message("Max. error of the table:      W: %e, dW/dx: %e", W_err / W_max,
+          dW_err / dW_max);
+  message("Max. error of the polynomial: W: %e, dW/dx: %e",
+          W_poly_err / W_max, dW_poly_err / dW_max);
+
+  if (W_err > 1e-5 * W_max) error("Tabulated W is inaccurate");
+  if (dW_err > 1e-5 * dW_max) error("Tabulated dW/dx is inaccurate");
+
+  /* Compare the vector versions to the polynomial */
+  memcpy(W, W_poly, numPoints * sizeof(float));
+  memcpy(dW, dW_poly, numPoints * sizeof(float));
+  free(W_poly);
+  free(dW_poly);
+
+#endif
+
 #ifdef WITH_VECTORIZATION
 
   message("Vector Output for VEC_SIZE=%d", VEC_SIZE);
@@ -0,0 +1,164 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+#if defined(HAVE_POSIX_FALLOCATE) && \
+    defined(WITH_LOGGER) /* Are we on a sensible platform? */
+
+/* Some standard headers. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local headers. */
+#include "../logger/logger_reader.h"
+#include "swift.h"
+
+/* Number of particles and of steps in the log */
+#define num_parts 100
+#define num_steps 10
+
+/**
+ * @brief Position of a particle at a given time.
+ *
+ * The particles move at constant velocity and are logged every
+ * (id % 3) + 1 steps.
+ */
+double position(long long id, double time) { return id + 0.5 * time; }
+
+/**
+ * @brief Write a log and check the positions read back from it.
+ *
+ * @param params The parameters of the #logger.
+ * @param tolerance The allowed error on the positions.
+ */
+void test_log(struct swift_params *params, double tolerance) {
+
+  /* Prepare a logger. */
+  struct logger log;
+  logger_init(&log, params);
+  logger_write_file_header(&log, NULL);
+
+  struct part parts_in[num_parts];
+  struct xpart xparts[num_parts];
+  bzero(parts_in, sizeof(parts_in));
+  for (int id = 0; id < num_parts; id++) {
+    parts_in[id].id = id;
+    parts_in[id].mass = 1.f;
+    parts_in[id].v[0] = 0.5f;
+    logger_part_data_init(&xparts[id].logger_data);
+  }
+  size_t time_offset = 0;
+  const unsigned int mask =
+      logger_mask_data[logger_x].mask | logger_mask_data[logger_v].mask |
+      logger_mask_data[logger_a].mask | logger_mask_data[logger_u].mask |
+      logger_mask_data[logger_h].mask | logger_mask_data[logger_rho].mask |
+      logger_mask_data[logger_consts].mask;
+
+  /* Write the log */
+  for (int step = 0; step < num_steps; step++) {
+    const double time = step;
+    logger_log_timestamp(&log, step, time, &time_offset);
+
+    int ind[num_parts];
+    size_t count = 0;
+    for (int id = 0; id < num_parts; id++) {
+      if (step % ((id % 3) + 1) != 0) continue;
+      parts_in[id].x[0] = position(id, time);
+      ind[count++] = id;
+    }
+    logger_log_parts(&log, parts_in, xparts, ind, count, mask, time);
+  }
+  logger_clean(&log);
+
+  size_t offsets[num_parts];
+  for (int id = 0; id < num_parts; id++)
+    offsets[id] = xparts[id].logger_data.last_offset;
+
+  /* Read it back at a few times */
+  struct logger_reader reader;
+  logger_reader_init(&reader, log.base_name, /*nr_threads=*/4,
+                     /*verbose=*/0);
+  logger_reader_read_timestamps(&reader, time_offset);
+  if (reader.nr_times != num_steps) error("Wrong number of timestamps.");
+
+  struct logger_reader_particle parts[num_parts];
+  const double times[4] = {0., 2.5, 4.75, 8.};
+  for (int k = 0; k < 4; k++) {
+    logger_reader_read_particles(&reader, times[k], offsets, num_parts, parts);
+
+    for (long long id = 0; id < num_parts; id++) {
+      if (parts[id].id != id)
+        error("Wrong ID %lld for %lld.", parts[id].id, id);
+      const double expected = position(id, times[k]);
+      if (fabs(parts[id].x[0] - expected) > tolerance)
+        error("Wrong position of particle %lld at t=%e: %e instead of %e.", id,
+              times[k], parts[id].x[0], expected);
+    }
+  }
+
+  /* Particles beyond their last record are in their last state */
+  const double time_end = num_steps + 2.;
+  logger_reader_read_particles(&reader, time_end, offsets, num_parts, parts);
+  for (long long id = 0; id < num_parts; id++) {
+    const int last_step = ((num_steps - 1) / ((id % 3) + 1)) * ((id % 3) + 1);
+    if (fabs(parts[id].x[0] - position(id, last_step)) > tolerance ||
+        parts[id].time != last_step)
+      error("Wrong last state of particle %lld.", id);
+  }
+
+  logger_reader_clean(&reader);
+
+  /* Be clean */
+  char filename[256];
+  sprintf(filename, "%s.dump", log.base_name);
+  remove(filename);
+}
+
+int main(int argc, char *argv[]) {
+
+  struct swift_params params;
+  parser_read_file("logger.yml", &params);
+  parser_set_param(&params, "Logger:basename:reader");
+
+  /* Raw records */
+  test_log(&params, 1e-10);
+
+  /* Delta-encoded records, with a keyframe every 3 records */
+  struct swift_params params_delta;
+  parser_read_file("logger.yml", &params_delta);
+  parser_set_param(&params_delta, "Logger:basename:reader");
+  parser_set_param(&params_delta, "Logger:delta_encoding:1");
+  parser_set_param(&params_delta, "Logger:position_tolerance:1e-3");
+  parser_set_param(&params_delta, "Logger:velocity_tolerance:1e-3");
+  parser_set_param(&params_delta, "Logger:keyframe_interval:3");
+  test_log(&params_delta, 1e-3);
+
+  /* Return a happy number. */
+  return 0;
+}
+
+#else
+
+int main(int argc, char *argv[]) { return 0; }
+
+#endif /* HAVE_POSIX_FALLOCATE */
@@ -20,6 +20,8 @@
 #include "../config.h"
 
 #include "approx_math.h"
+#include "cbrt.h"
+#include "exp10.h"
 #include "vector.h"
 
 #include <math.h>
@@ -66,6 +68,63 @@ int main(int argc, char *argv[]) {
     }
   }
 
+#ifdef WITH_VECTORIZATION
+
+  /* The vector versions of the approximations must agree with the scalar
+   * ones, and the ones with no scalar approximation with libm. */
+  for (int i = 0; i < numPoints; i += VEC_SIZE) {
+
+    vector x_exp, x_exp10, x_cbrt;
+    for (int k = 0; k < VEC_SIZE; k++) {
+      x_exp.f[k] = 0.6f * ((i + k) / (float)numPoints) - 0.3f;
+      x_exp10.f[k] = 70.f * ((i + k) / (float)numPoints) - 35.f;
+      x_cbrt.f[k] = (((i + k) % 2) ? -1.f : 1.f) *
+                    powf(10.f, 60.f * ((i + k) / (float)numPoints) - 30.f);
+    }
+
+    const vector exp_vec = approx_expf_vec(x_exp);
+    const vector good_exp_vec = good_approx_expf_vec(x_exp);
+    const vector exp10_vec = exp10f_vec(x_exp10);
+    const vector cbrt_vec = icbrtf_vec(x_cbrt);
+
+    for (int k = 0; k < VEC_SIZE; k++) {
+
+      const float exp_approx = approx_expf(x_exp.f[k]);
+      const float good_exp_approx = good_approx_expf(x_exp.f[k]);
+      const double exp10_correct = pow(10., x_exp10.f[k]);
+      const double cbrt_correct = 1. / cbrt(x_cbrt.f[k]);
+
+      const float rel_exp =
+          fabsf(exp_vec.f[k] - exp_approx) / fabsf(exp_approx);
+      const float rel_good_exp =
+          fabsf(good_exp_vec.f[k] - good_exp_approx) / fabsf(good_exp_approx);
+      const double rel_exp10 =
+          fabs(exp10_vec.f[k] - exp10_correct) / fabs(exp10_correct);
+      const double rel_cbrt =
+          fabs(cbrt_vec.f[k] - cbrt_correct) / fabs(cbrt_correct);
+
+      if (rel_exp > 2e-7 || rel_good_exp > 2e-7) {
+        printf("x= %e approx_expf_vec=%e (%e) good_approx_expf_vec=%e (%e)\n",
+               x_exp.f[k], exp_vec.f[k], exp_approx, good_exp_vec.f[k],
+               good_exp_approx);
+        return 1;
+      }
+      if (rel_exp10 > 5e-6 ||
+          (fabsf(x_exp10.f[k]) < 10.f && rel_exp10 > 2e-6)) {
+        printf("x= %e exp10f_vec=%e exp10=%e rel=%e\n", x_exp10.f[k],
+               exp10_vec.f[k], exp10_correct, rel_exp10);
+        return 1;
+      }
+      if (rel_cbrt > 1e-6) {
+        printf("x= %e icbrtf_vec=%e 1/cbrt=%e rel=%e\n", x_cbrt.f[k],
+               cbrt_vec.f[k], cbrt_correct, rel_cbrt);
+        return 1;
+      }
+    }
+  }
+
+#endif
+
   printf("\nAll values are consistent\n");
 
   return 0;
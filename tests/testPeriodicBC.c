@@ -187,8 +187,7 @@ struct cell *make_cell(size_t n, double *offset, double size, double h,
 
 void clean_up(struct cell *ci) {
   free(ci->hydro.parts);
-  for (int k = 0; k < 13; k++)
-    if (ci->hydro.sort[k] != NULL) free(ci->hydro.sort[k]);
+  cell_free_hydro_sorts(ci);
   free(ci);
 }
 
@@ -488,6 +487,7 @@ int main(int argc, char *argv[]) {
 
   struct runner runner;
   runner.e = &engine;
+  bzero(&runner.sort_arena, sizeof(struct sort_arena));
 
   struct cosmology cosmo;
   cosmology_init_no_cosmo(&cosmo);
@@ -589,5 +589,7 @@ int main(int argc, char *argv[]) {
   /* Clean things to make the sanitizer happy ... */
   for (int i = 0; i < dim * dim * dim; ++i) clean_up(cells[i]);
 
+  sort_arena_clean(&runner.sort_arena);
+
   return 0;
 }
@@ -0,0 +1,30 @@
+#!/bin/bash
+
+for v in {0..3}
+do
+    echo ""
+	
+    rm -f brute_force_periodic_BC_standard.dat swift_periodic_BC_standard.dat
+
+    echo "Running ./testPeriodicBC -n 6 -r 1 -d 0 -f standard -v $v"
+    ./testPeriodicBC -n 6 -r 1 -d 0 -f standard -v $v
+
+    if [ -e brute_force_periodic_BC_standard.dat ]
+    then
+	if python ./difffloat.py brute_force_periodic_BC_standard.dat swift_periodic_BC_standard.dat ./tolerance_periodic_BC_normal.dat
+  then
+	    echo "Accuracy test passed"
+	else
+	    echo "Accuracy test failed"
+	    exit 1
+	fi
+    else
+	echo "Error Missing test output file"
+	exit 1
+    fi
+
+    echo "------------"
+    
+done
+
+exit $?
@@ -0,0 +1,5 @@
+#!/bin/bash
+
+python ./makeInput.py
+./testReading
+
@@ -0,0 +1,140 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local includes. */
+#include "error.h"
+#include "restart.h"
+
+/* Size of the largest buffer tested, as the pieces of the restart files. */
+#define MAX_LEN (8 << 20)
+
+/**
+ * @brief Compresses and uncompresses a buffer and checks the result.
+ *
+ * @param in the data.
+ * @param len the number of bytes.
+ * @param name the kind of data, for the error messages.
+ * @return the size of the compressed data.
+ */
+size_t round_trip(const char *in, const size_t len, const char *name) {
+
+  /* The worst case: a token and length bytes on top of the literals. */
+  const size_t max = len + len / 255 + 16;
+  char *comp = (char *)malloc(max);
+  char *out = (char *)malloc(len + 1);
+  if (comp == NULL || out == NULL) error("Failed to allocate buffers");
+
+  const size_t size = restart_compress(in, len, comp, max);
+  if (size == 0 || size > max)
+    error("%s: failed to compress %zu bytes (size=%zu)", name, len, size);
+
+  /* Guard byte, to spot writes past the end of the data. */
+  out[len] = 'x';
+  restart_uncompress(comp, size, out, len);
+  if (memcmp(in, out, len) != 0)
+    error("%s: data of %zu bytes changed by the round trip", name, len);
+  if (out[len] != 'x') error("%s: wrote past the %zu bytes", name, len);
+
+  free(out);
+  free(comp);
+  return size;
+}
+
+/**
+ * @brief Fills a buffer with an array of small structs with few distinct
+ * values and zero padding, like the particle arrays.
+ */
+void fill_structs(char *buff, const size_t len) {
+  for (size_t k = 0; k < len; k++) {
+    const size_t field = k % 24;
+    buff[k] = (field < 8) ? (char)((k / 24) % 7) : (field < 12) ? 0x3f : 0;
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  srand(42);
+
+  char *in = (char *)malloc(MAX_LEN);
+  if (in == NULL) error("Failed to allocate buffer");
+
+  /* Empty data. */
+  round_trip(in, 0, "empty");
+
+  /* All the short lengths and those around the length codes: literal and
+   * copy lengths switch to extra bytes at 15 and 15 + 255. */
+  const size_t lens[] = {1,   2,   3,   4,   5,   14,  15,   16,   18,
+                         19,  20,  269, 270, 271, 273, 274,  275,  528,
+                         529, 530, 784, 785, 786, 65535, 65536, 65537};
+  for (size_t n = 0; n < sizeof(lens) / sizeof(size_t); n++) {
+    const size_t len = lens[n];
+
+    for (size_t k = 0; k < len; k++) in[k] = rand();
+    round_trip(in, len, "random");
+
+    memset(in, 0, len);
+    round_trip(in, len, "zeros");
+
+    /* A literal run of the given length followed by a long copy. */
+    for (size_t k = 0; k < len; k++) in[k] = rand();
+    memset(in + len, 0, 4 * len < MAX_LEN - len ? 4 * len : 0);
+    round_trip(in, len + (4 * len < MAX_LEN - len ? 4 * len : 0),
+               "literals + copy");
+
+    fill_structs(in, len);
+    round_trip(in, len, "structs");
+  }
+  for (size_t len = 0; len < 300; len++) {
+    for (size_t k = 0; k < len; k++) in[k] = (k % 3 == 0) ? rand() : 'a';
+    round_trip(in, len, "mixed");
+  }
+
+  /* Incompressible data does not fit in fewer bytes than the input. */
+  for (size_t k = 0; k < MAX_LEN; k++) in[k] = rand();
+  char *comp = (char *)malloc(MAX_LEN);
+  if (comp == NULL) error("Failed to allocate buffer");
+  if (restart_compress(in, MAX_LEN, comp, MAX_LEN - 1) != 0)
+    error("Random data compressed below its size");
+  round_trip(in, MAX_LEN, "random");
+  free(comp);
+
+  /* Highly repetitive data, including copies over the 64k distance limit. */
+  memset(in, 0, MAX_LEN);
+  size_t size = round_trip(in, MAX_LEN, "zeros");
+  if (size > MAX_LEN / 200) error("Zeros compressed to %zu bytes", size);
+
+  fill_structs(in, MAX_LEN);
+  size = round_trip(in, MAX_LEN, "structs");
+  if (size > MAX_LEN / 20) error("Structs compressed to %zu bytes", size);
+
+  for (size_t k = 0; k < MAX_LEN; k++)
+    in[k] = (k % 100000 < 50) ? rand() : in[k % 100000];
+  round_trip(in, MAX_LEN, "far copies");
+
+  free(in);
+  return 0;
+}
@@ -147,6 +147,104 @@ void check_riemann_symmetry(void) {
   }
 }
 
+/**
+ * @brief Checks whether two numbers are equal up to rounding errors of the
+ * given magnitude (the fluxes suffer from cancellations in the deboost).
+ */
+int are_equal(float a, float b, float scale) {
+
+  const float abs_error = fabsf(a - b);
+  if (abs_error > max_rel_error * scale) {
+    message("Error too large a=%.8e b=%.8e scale=%.8e", a, b, scale);
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief Check that the batched solver gives the same fluxes as the scalar
+ * one, including for interfaces with or generating vacuum.
+ */
+void check_riemann_batch(void) {
+
+  struct riemann_batch batch;
+  batch.count = 0;
+
+  /* Fill the batch with random interfaces, leaving the last vector of the
+     batch partially filled to exercise the scalar remainder */
+  const int count = riemann_batch_size - 3;
+  for (int k = 0; k < count; k++) {
+    float WL[5], WR[5], n_unit[3], vij[3];
+
+    WL[0] = random_uniform(0.1f, 1.0f);
+    WL[1] = random_uniform(-10.0f, 10.0f);
+    WL[2] = random_uniform(-10.0f, 10.0f);
+    WL[3] = random_uniform(-10.0f, 10.0f);
+    WL[4] = random_uniform(0.1f, 1.0f);
+    WR[0] = random_uniform(0.1f, 1.0f);
+    WR[1] = random_uniform(-10.0f, 10.0f);
+    WR[2] = random_uniform(-10.0f, 10.0f);
+    WR[3] = random_uniform(-10.0f, 10.0f);
+    WR[4] = random_uniform(0.1f, 1.0f);
+
+    n_unit[0] = random_uniform(-1.0f, 1.0f);
+    n_unit[1] = random_uniform(-1.0f, 1.0f);
+    n_unit[2] = random_uniform(-1.0f, 1.0f);
+    const float n_norm = sqrtf(n_unit[0] * n_unit[0] + n_unit[1] * n_unit[1] +
+                               n_unit[2] * n_unit[2]);
+    n_unit[0] /= n_norm;
+    n_unit[1] /= n_norm;
+    n_unit[2] /= n_norm;
+
+    /* Sprinkle some interfaces generating vacuum (the scalar solver cannot
+       be fed a zero density with floating point exceptions enabled) */
+    if (k % 7 == 3) {
+      for (int i = 0; i < 3; i++) {
+        WL[i + 1] = -30.f * n_unit[i];
+        WR[i + 1] = 30.f * n_unit[i];
+      }
+    }
+
+    vij[0] = random_uniform(-10.0f, 10.0f);
+    vij[1] = random_uniform(-10.0f, 10.0f);
+    vij[2] = random_uniform(-10.0f, 10.0f);
+
+    riemann_batch_add(&batch, WL, WR, n_unit, vij);
+  }
+
+  /* Keep the states as the batch will be emptied */
+  struct riemann_batch ref = batch;
+  riemann_solve_batch_for_flux(&batch);
+  if (batch.count != 0) error("Batch not emptied after solve!");
+
+  for (int k = 0; k < count; k++) {
+    float WL[5], WR[5], n_unit[3], vij[3], totflux[5];
+    for (int i = 0; i < 5; i++) {
+      WL[i] = ref.WL[i][k];
+      WR[i] = ref.WR[i][k];
+    }
+    for (int i = 0; i < 3; i++) {
+      n_unit[i] = ref.n[i][k];
+      vij[i] = ref.vij[i][k];
+    }
+    riemann_solve_for_flux(WL, WR, n_unit, vij, totflux);
+
+    float scale = min_threshold;
+    for (int i = 0; i < 5; i++) scale = max(scale, fabsf(totflux[i]));
+
+    for (int i = 0; i < 5; i++) {
+      if (!are_equal(totflux[i], batch.flux[i][k], scale)) {
+        message("WL=[%.8e, %.8e, %.8e, %.8e, %.8e]", WL[0], WL[1], WL[2],
+                WL[3], WL[4]);
+        message("WR=[%.8e, %.8e, %.8e, %.8e, %.8e]", WR[0], WR[1], WR[2],
+                WR[3], WR[4]);
+        error("Batched flux %d of interface %d differs: %.8e != %.8e", i, k,
+              batch.flux[i][k], totflux[i]);
+      }
+    }
+  }
+}
+
 /**
  * @brief Check the HLLC Riemann solver
  */
@@ -171,5 +269,10 @@ int main(int argc, char *argv[]) {
     check_riemann_symmetry();
   }
 
+  /* batched solver test */
+  for (int i = 0; i < 10000; i++) {
+    check_riemann_batch();
+  }
+
   return 0;
 }
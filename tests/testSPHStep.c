@@ -211,8 +211,7 @@ int main(int argc, char *argv[]) {
   for (int j = 0; j < 27; ++j) {
     free(cells[j]->hydro.parts);
     free(cells[j]->hydro.xparts);
-    for (int k = 0; k < 13; k++)
-      if (cells[j]->hydro.sort[k] != NULL) free(cells[j]->hydro.sort[k]);
+    cell_free_hydro_sorts(cells[j]);
     free(cells[j]);
   }
 
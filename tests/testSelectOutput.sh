@@ -0,0 +1,14 @@
+#!/bin/bash
+
+echo "Creating initial conditions"
+python ./makeInput.py
+
+echo "Generating output"
+./testSelectOutput 2>&1 | tee select_output.log
+
+echo "Checking output"
+python ./testSelectOutput.py
+
+rm -f testSelectOutput_0000.hdf5 testSelectOutput.xmf select_output.log
+
+echo "Test passed"
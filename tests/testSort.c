@@ -0,0 +1,142 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2020 The SWIFT collaboration.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local includes. */
+#include "clocks.h"
+#include "error.h"
+#include "sort_part.h"
+
+/**
+ * @brief Checks that an array of #entry is sorted and is a permutation of
+ * the indices 0..N-1.
+ */
+void check_sorted(const struct entry *sort, const int N, int *seen,
+                  const char *name) {
+
+  memset(seen, 0, N * sizeof(int));
+  for (int k = 0; k < N; k++) {
+    if (k > 0 && sort[k].d < sort[k - 1].d)
+      error("%s: array not sorted at k=%d (%e < %e)", name, k, sort[k].d,
+            sort[k - 1].d);
+    if (sort[k].i < 0 || sort[k].i >= N || seen[sort[k].i])
+      error("%s: indices borked at k=%d", name, k);
+    seen[sort[k].i] = 1;
+  }
+}
+
+/**
+ * @brief Fills an array of #entry with the projected positions of particles
+ * in a cell of size 1 around pos.
+ */
+void fill(struct entry *sort, const int N, const float pos) {
+  for (int k = 0; k < N; k++) {
+    sort[k].i = k;
+    sort[k].d = pos + ((float)rand() / RAND_MAX - 0.5f);
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+  /* Initialise a few things to get us going */
+  srand(42);
+
+  /* Some constants for this test. */
+  const int max_N = 100000;
+  const int sizes[] = {1,   2,   15,   16,   64,   127,
+                       128, 256, 512, 1024, 4096, max_N};
+  const int num_sizes = sizeof(sizes) / sizeof(int);
+  const int total_entries = 5000000;
+
+  struct entry *data = (struct entry *)malloc(max_N * sizeof(struct entry));
+  struct entry *sort = (struct entry *)malloc(max_N * sizeof(struct entry));
+  struct entry *buff = (struct entry *)malloc(max_N * sizeof(struct entry));
+  int *seen = (int *)malloc(max_N * sizeof(int));
+  if (data == NULL || sort == NULL || buff == NULL || seen == NULL)
+    error("Impossible to allocate memory for the test.");
+
+  /* Check the correctness with negative, positive and mixed keys */
+  const float positions[] = {-1e5f, -0.2f, 0.f, 0.3f, 17.f, 1e6f};
+  for (int p = 0; p < 6; p++) {
+    for (int s = 0; s < num_sizes; s++) {
+      const int N = sizes[s];
+      fill(data, N, positions[p]);
+
+      memcpy(sort, data, N * sizeof(struct entry));
+      sort_entries_quicksort(sort, N);
+      check_sorted(sort, N, seen, "quicksort");
+
+      memcpy(sort, data, N * sizeof(struct entry));
+      sort_entries_radix(sort, buff, N);
+      check_sorted(sort, N, seen, "radix");
+
+      memcpy(sort, data, N * sizeof(struct entry));
+      sort_entries_ascending(sort, buff, N);
+      check_sorted(sort, N, seen, "ascending");
+
+      /* Same again with many identical keys */
+      for (int k = 0; k < N; k++) data[k].d = (float)(k % 7) + positions[p];
+      memcpy(sort, data, N * sizeof(struct entry));
+      sort_entries_radix(sort, buff, N);
+      check_sorted(sort, N, seen, "radix (repeated keys)");
+    }
+  }
+
+  /* Compare the speed of the two algorithms */
+  for (int s = 0; s < num_sizes; s++) {
+    const int N = sizes[s];
+    const int num_runs = total_entries / N;
+    fill(data, N, 10.f);
+
+    ticks tic = getticks();
+    for (int r = 0; r < num_runs; r++) {
+      memcpy(sort, data, N * sizeof(struct entry));
+      sort_entries_quicksort(sort, N);
+    }
+    const ticks toc_quick = getticks() - tic;
+
+    tic = getticks();
+    for (int r = 0; r < num_runs; r++) {
+      memcpy(sort, data, N * sizeof(struct entry));
+      sort_entries_radix(sort, buff, N);
+    }
+    const ticks toc_radix = getticks() - tic;
+
+    message("N=%6d: quicksort took %9.3f %s, radix sort took %9.3f %s.", N,
+            clocks_from_ticks(toc_quick), clocks_getunit(),
+            clocks_from_ticks(toc_radix), clocks_getunit());
+  }
+
+  free(data);
+  free(sort);
+  free(buff);
+  free(seen);
+  return 0;
+}
@@ -48,6 +48,26 @@ void map_function_second(void *map_data, int num_elements, void *extra_data) {
   }
 }
 
+void map_function_count(void *map_data, int num_elements, void *extra_data) {
+  int *counts = (int *)map_data;
+  for (int ind = 0; ind < num_elements; ind++) atomic_inc(&counts[ind]);
+}
+
+double cost_function(void *map_data, void *extra_data) {
+  /* Very uneven costs, with long runs of free elements. */
+  const int ind = (int *)map_data - (int *)extra_data;
+  return (ind % 97 == 0) ? 1000. : (ind % 5 == 0 ? 1. : 0.);
+}
+
+void check_counts(const int *counts, int N, const char *what) {
+  for (int k = 0; k < N; k++)
+    if (counts[k] != 1) {
+      printf("Element %i was mapped %i times by the %s map.\n", k, counts[k],
+             what);
+      abort();
+    }
+}
+
 int main(int argc, char *argv[]) {
 
   // Some constants for this test.
@@ -82,6 +102,18 @@ int main(int argc, char *argv[]) {
       threadpool_map(&tp, map_function_first, data, N, sizeof(int), 2, NULL);
     }
 
+    // Check that the guided and weighted maps cover every element once.
+    const int num_counts = 10000;
+    int *counts = (int *)calloc(num_counts, sizeof(int));
+    threadpool_map(&tp, map_function_count, counts, num_counts, sizeof(int),
+                   threadpool_guided_chunk_size, NULL);
+    check_counts(counts, num_counts, "guided");
+    for (int k = 0; k < num_counts; k++) counts[k] = 0;
+    threadpool_map_weighted(&tp, map_function_count, counts, num_counts,
+                            sizeof(int), cost_function, counts);
+    check_counts(counts, num_counts, "weighted");
+    free(counts);
+
 /* If logging was enabled, dump the log. */
 #ifdef SWIFT_DEBUG_THREADPOOL
     char filename[80];
@@ -92,7 +92,6 @@ labels = [
     ["engine_marktasks:", 1],
     ["Reading initial conditions", 0],
     ["engine_print_task_counts:", 0],
-    ["engine_drift_top_multipoles:", 0],
     ["Communicating rebuild flag", 0],
     ["engine_split:", 0],
     ["space_init", 0],
@@ -0,0 +1,106 @@
+#!/bin/bash
+#
+# Usage:
+#  run_scaling.sh [-s steps] [-r "replicates"] [-t "threads"] [-m "ranks"]
+#                 [-g] [-o summary] [-f "swift flags"] parameter_file
+#
+# Description:
+#  Run a strong and weak scaling experiment with the given parameter file.
+#
+#  The initial conditions are replicated (InitialConditions:replicate) by
+#  each of the factors in the "replicates" list, with gas generated from the
+#  dark matter if -g is given (InitialConditions:generate_gas_in_ics). Each
+#  problem size is run for a fixed number of steps with every thread count in
+#  "threads" and every rank count in "ranks", using the swift binary for one
+#  rank and swift_mpi under $MPIRUN (default "mpirun -np") otherwise.
+#
+#  Every run appends one line with the time spent in the rebuilds, tasks,
+#  communications and i/o to the summary file (default
+#  scaling_summary.txt), see the --phase-summary option of swift. The output
+#  of each run is kept in scaling_r<replicate>_m<ranks>_t<threads>.log.
+#
+#  The swift binaries are looked for in $SWIFT_BINDIR, by default the
+#  examples directory of this source tree.
+#
+# This file is part of SWIFT:
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU Lesser General Public License as published
+#  by the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#  Locate script.
+SCRIPTHOME=$(cd $(dirname "$0") && pwd)
+BINDIR=${SWIFT_BINDIR:-$SCRIPTHOME/../examples}
+MPIRUN=${MPIRUN:-"mpirun -np"}
+
+#  Defaults.
+STEPS=64
+REPLICATES="1"
+THREADS="1"
+RANKS="1"
+GENERATE_GAS=0
+SUMMARY=scaling_summary.txt
+FLAGS="-s -G"
+
+#  Handle command-line
+while getopts "s:r:t:m:go:f:" opt; do
+    case $opt in
+        s) STEPS=$OPTARG ;;
+        r) REPLICATES=$OPTARG ;;
+        t) THREADS=$OPTARG ;;
+        m) RANKS=$OPTARG ;;
+        g) GENERATE_GAS=1 ;;
+        o) SUMMARY=$OPTARG ;;
+        f) FLAGS=$OPTARG ;;
+        *) echo "Usage: $0 [-s steps] [-r \"replicates\"] [-t \"threads\"]" \
+                "[-m \"ranks\"] [-g] [-o summary] [-f \"swift flags\"]" \
+                "parameter_file"
+           exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+if test "$1" == ""; then
+    echo "Usage: $0 [-s steps] [-r \"replicates\"] [-t \"threads\"]" \
+         "[-m \"ranks\"] [-g] [-o summary] [-f \"swift flags\"] parameter_file"
+    exit 1
+fi
+PARAMS=$1
+EXTRA=""
+if test $GENERATE_GAS -eq 1; then
+    EXTRA="-P InitialConditions:generate_gas_in_ics:1"
+fi
+
+#  And run all the combinations.
+for r in $REPLICATES; do
+    for m in $RANKS; do
+        for t in $THREADS; do
+            log=scaling_r${r}_m${m}_t${t}.log
+            echo "Running with replicate=$r, ranks=$m, threads=$t..."
+
+            if test $m -eq 1; then
+                cmd="$BINDIR/swift"
+            else
+                cmd="$MPIRUN $m $BINDIR/swift_mpi"
+            fi
+            $cmd $FLAGS -a -t $t -n $STEPS --phase-summary=$SUMMARY \
+                -P InitialConditions:replicate:$r $EXTRA $PARAMS > $log 2>&1
+            if test $? != 0; then
+                echo "Run failed, see $log"
+                exit 1
+            fi
+        done
+    done
+done
+
+echo "Finished, the timings are in $SUMMARY"
+
+exit
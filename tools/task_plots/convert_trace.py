@@ -0,0 +1,153 @@
+#!/usr/bin/env python
+"""
+Usage:
+    convert_trace.py [options] input.bin output.dat
+
+where input.bin is a binary task dump for a step, written when running with
+Scheduler:task_dumps_binary set to 1 and the '-y interval' flag of the swift
+and swift_mpi commands (you will also need to configure with the
+--enable-task-debugging option).
+
+The output is the text thread info file of the step, as written without
+the binary format, for the plot_tasks.py and analyse_tasks.py scripts. With
+--cells, the top-level cell and depth of the cells of each task and the peer
+and size of the communications, which only the binary dumps contain, are
+printed as extra columns.
+
+This file is part of SWIFT.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published
+by the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+"""
+
+import argparse
+import struct
+import sys
+
+#  Handle the command line.
+parser = argparse.ArgumentParser(description="Convert binary task dumps")
+
+parser.add_argument("input", help="Binary thread data file (-y output)")
+parser.add_argument("output", help="Text thread data file")
+parser.add_argument(
+    "-c",
+    "--cells",
+    dest="cells",
+    help="Add the cells and communications as extra columns (default: False)",
+    default=False,
+    action="store_true",
+)
+args = parser.parse_args()
+
+with open(args.input, "rb") as f:
+    data = f.read()
+
+if data[0:8] != b"SWIFTTRC":
+    print("Not a binary task dump: " + args.input)
+    sys.exit(1)
+version, with_mpi, nr_nodes = struct.unpack("<3i", data[8:20])
+if version != 1:
+    print("Unknown version of the binary task dumps: " + str(version))
+    sys.exit(1)
+
+
+class Reader:
+    """Decodes the variable-length integers of a block."""
+
+    def __init__(self, data, pos):
+        self.data = data
+        self.pos = pos
+
+    def get(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self.data[self.pos]
+            self.pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if byte < 0x80:
+                return value
+
+    def get_signed(self):
+        value = self.get()
+        return (value >> 1) ^ -(value & 1)
+
+    def get_cell(self):
+        top = self.get()
+        if top == 0:
+            return "-1 -1"
+        return "%d %d" % (top - 1, self.get())
+
+
+out = open(args.output, "w")
+pos = 20
+while pos < len(data):
+    (size,) = struct.unpack("<Q", data[pos : pos + 8])
+    r = Reader(data, pos + 8)
+    pos += 8 + size
+
+    rank = r.get()
+    nr_tasks = r.get()
+    tic_step = r.get()
+    toc_step = r.get()
+    updates = r.get()
+    g_updates = r.get()
+    s_updates = r.get()
+    cpufreq = r.get()
+
+    if with_mpi:
+        out.write(
+            " %03d 0 0 0 0 %d %d %d %d %d 0 0 %d\n"
+            % (rank, tic_step, toc_step, updates, g_updates, s_updates, cpufreq)
+        )
+    else:
+        out.write(
+            " %d %d %d %d %d %d %d %d %d %d %d\n"
+            % (-2, -1, -1, 1, tic_step, toc_step, updates, g_updates, s_updates,
+               0, cpufreq)
+        )
+
+    tic = tic_step
+    for k in range(nr_tasks):
+        tic += r.get_signed()
+        toc = tic + r.get()
+        rid = r.get_signed()
+        ttype = r.get()
+        subtype = r.get()
+        flags = r.get_signed()
+        sid = r.get_signed()
+        ci = r.get_cell()
+        cj = r.get_cell()
+        single = 1 if cj == "-1 -1" else 0
+        counts = (r.get(), r.get(), r.get(), r.get())
+
+        #  The peer and size of the communications, peer -1 for the others.
+        extra = ""
+        if with_mpi:
+            peer = r.get() - 1
+            extra = " %d %d" % (peer, r.get() if peer >= 0 else 0)
+
+        if with_mpi:
+            line = " %03d %d %d %d %d %d %d %d %d %d %d %d %d" % (
+                (rank, rid, ttype, subtype, single, tic, toc) + counts + (flags, sid)
+            )
+        else:
+            line = " %d %d %d %d %d %d %d %d %d %d %d" % (
+                (rid, ttype, subtype, single, tic, toc) + counts + (sid,)
+            )
+        if args.cells:
+            line += " " + ci + " " + cj + extra
+        out.write(line + "\n")
+
+out.close()